@@ -111,6 +111,9 @@ ERRHAND_DBG=y
 ERRHAND_MIN_LEVEL=DBG_LVL_WARN
 # Select the subsytems which will have the debug on. See liberrhand file errhand_opts.h for more info.
 ERRHAND_SUBSYS_ON='"(DBG_DEV_MNGR | DBG_DEV_IO | DBG_SM_IO | DBG_LIB_CLIENT | DBG_SM_PR | DBG_SM_CH | DBG_LL_IO | DBG_HAL_UTILS)"'
+# Select if we want to compile the fast trace channel in. Options are: y(es) or n(o).
+# It is still off at runtime, until a trace file is set. See liberrhand file errhand_print.h for more info.
+ERRHAND_TRACE=y
 # Select the FMC ADC board type. Options are: passive or active
 FMC130M_4CH_TYPE=passive
 # Select if we should program FMC EEPROM with some code or not. Option are:
@@ -149,6 +152,7 @@ COMMAND_LIBS="\
     ERRHAND_DBG=${ERRHAND_DBG} \
     ERRHAND_MIN_LEVEL=${ERRHAND_MIN_LEVEL} \
     ERRHAND_SUBSYS_ON='"${ERRHAND_SUBSYS_ON}"' \
+    ERRHAND_TRACE=${ERRHAND_TRACE} \
     LOCAL_MSG_DBG=${LOCAL_MSG_DBG}  \
     libs_compile_install"
 
@@ -161,6 +165,7 @@ COMMAND_CORE="\
     ERRHAND_DBG=${ERRHAND_DBG} \
     ERRHAND_MIN_LEVEL=${ERRHAND_MIN_LEVEL} \
     ERRHAND_SUBSYS_ON='"${ERRHAND_SUBSYS_ON}"' \
+    ERRHAND_TRACE=${ERRHAND_TRACE} \
     LOCAL_MSG_DBG=${LOCAL_MSG_DBG} \
     FMC130M_4CH_TYPE=${FMC130M_4CH_TYPE} \
     FMC130M_4CH_EEPROM_PROGRAM=${FMC130M_4CH_EEPROM_PROGRAM} \
@@ -76,6 +76,76 @@ void print_data (uint32_t chan, uint32_t *data, uint32_t size, file_fmt_e file_f
     }
 }
 
+/* Acquire a curve and stream it to a capture file, one block at a time */
+bpm_client_err_e capture_curve (bpm_client_t *bpm_client, char *service,
+        uint32_t chan, uint32_t num_samples, const char *capture_file)
+{
+    acq_trans_t acq_trans = {.req =   {
+                                        .num_samples_pre = num_samples,
+                                        .num_samples_post = 0,
+                                        .num_shots = 1,
+                                        .chan = chan,
+                                      },
+                            };
+    bpm_capture_info_t capture_info = {.req = acq_trans.req};
+
+    bpm_client_err_e err = bpm_acq_start (bpm_client, service, &acq_trans.req);
+    if (err != BPM_CLIENT_SUCCESS) {
+        fprintf (stderr, "[client:acq]: bpm_acq_start failed\n");
+        goto err_acq_start;
+    }
+
+    err = bpm_acq_check_timed (bpm_client, service, 50000);
+    if (err != BPM_CLIENT_SUCCESS) {
+        fprintf (stderr, "[client:acq]: Acquisition did not complete in time\n");
+        goto err_acq_check;
+    }
+
+    /* Stamp the capture with the trigger and completion time seen by the
+     * server, rather than the time the readout finishes */
+    smio_acq_curve_info_t curve_info;
+    err = bpm_acq_get_curve_info (bpm_client, service, chan, &curve_info);
+    if (err == BPM_CLIENT_SUCCESS) {
+        capture_info.trig_addr = curve_info.trig_addr;
+        capture_info.timestamp = curve_info.timestamp;
+    }
+
+    bpm_capture_t *capture = bpm_capture_new (capture_file, &capture_info);
+    if (capture == NULL) {
+        fprintf (stderr, "[client:acq]: Could not create capture file %s\n",
+                capture_file);
+        err = BPM_CLIENT_ERR_INV_PARAM;
+        goto err_capture_new;
+    }
+
+    /* Only one block is kept in memory */
+    acq_trans.block.data = (uint32_t *) zmalloc (BLOCK_SIZE);
+    acq_trans.block.data_size = BLOCK_SIZE;
+    if (acq_trans.block.data == NULL) {
+        err = BPM_CLIENT_ERR_ALLOC;
+        goto err_data_alloc;
+    }
+
+    err = bpm_acq_get_curve_capture (bpm_client, service, &acq_trans,
+            BLOCK_SIZE, capture);
+    if (err != BPM_CLIENT_SUCCESS) {
+        fprintf (stderr, "[client:acq]: bpm_acq_get_curve_capture failed\n");
+        goto err_get_curve_capture;
+    }
+
+    fprintf (stderr, "[client:acq]: %u bytes written to %s\n",
+            acq_trans.block.bytes_read, capture_file);
+
+err_get_curve_capture:
+    free (acq_trans.block.data);
+err_data_alloc:
+    bpm_capture_destroy (&capture);
+err_capture_new:
+err_acq_check:
+err_acq_start:
+    return err;
+}
+
 static struct option long_options[] =
 {
     {"help",                no_argument,         NULL, 'h'},
@@ -86,10 +156,11 @@ static struct option long_options[] =
     {"channumber",          required_argument,   NULL, 'c'},
     {"numsamples",          required_argument,   NULL, 'n'},
     {"filefmt",             required_argument,   NULL, 'f'},
+    {"capturefile",         required_argument,   NULL, 'w'},
     {NULL, 0, NULL, 0}
 };
 
-static const char* shortopt = "hb:vo:s:c:n:f:";
+static const char* shortopt = "hb:vo:s:c:n:f:w:";
 
 void print_help (char *program_name)
 {
@@ -111,7 +182,9 @@ void print_help (char *program_name)
             "                                     13 -> FOFB Pos; 14 -> Monit Amp; 15 -> Monit Pha; 16 -> Monit Pos]\n"
             "  -n  --numsamples <Number of samples> Number of samples\n"
             "  -f  --filefmt <Output format = [0 = text | 1=binary]>\n"
-            "                                       Output format\n",
+            "                                       Output format\n"
+            "  -w  --capturefile <File>             Write the curve to a binary capture\n"
+            "                                       file instead of the standard output\n",
             program_name);
 }
 
@@ -124,6 +197,7 @@ int main (int argc, char *argv [])
     char *bpm_number_str = NULL;
     char *chan_str = NULL;
     char *file_fmt_str = NULL;
+    char *capture_file = NULL;
     int opt;
 
     while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
@@ -163,6 +237,10 @@ int main (int argc, char *argv [])
                 file_fmt_str = strdup (optarg);
                 break;
 
+            case 'w':
+                capture_file = strdup (optarg);
+                break;
+
             case '?':
                 fprintf (stderr, "[client:acq] Option not recognized or missing argument\n");
                 print_help (argv [0]);
@@ -282,6 +360,11 @@ int main (int argc, char *argv [])
         goto err_bpm_set_acq_trig;
     }
 
+    if (capture_file != NULL) {
+        err = capture_curve (bpm_client, service, chan, num_samples, capture_file);
+        goto err_capture_curve;
+    }
+
     uint32_t data_size = num_samples*acq_chan[chan].sample_size;
     uint32_t *data = (uint32_t *) zmalloc (data_size*sizeof (uint8_t));
     bool new_acq = true;
@@ -311,8 +394,13 @@ int main (int argc, char *argv [])
 
 err_set_file_mode:
 err_bpm_get_curve:
+    free (data);
+    data = NULL;
+err_capture_curve:
 err_bpm_set_acq_trig:
 err_bpm_client_new:
+    free (capture_file);
+    capture_file = NULL;
     free (file_fmt_str);
     file_fmt_str = NULL;
     free (chan_str);
@@ -0,0 +1,333 @@
+/*
+ *  * Benchmark of the acquisition readout throughput as a function
+ *   * of the block size negotiated with the server
+ *    */
+
+#include <getopt.h>
+#include <czmq.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <bpm_client.h>
+
+#define DFLT_BIND_FOLDER            "/tmp/bpm"
+
+#define DFLT_NUM_SAMPLES            (1 << 20)
+#define DFLT_CHAN_NUM               0
+#define DFLT_NUM_ITER               10
+
+#define DFLT_BPM_NUMBER             0
+#define MAX_BPM_NUMBER              1
+
+#define DFLT_BOARD_NUMBER           0
+
+#define MIN_NUM_SAMPLES             4
+/* Arbitrary hard limits */
+#define MAX_NUM_SAMPLES             (1 << 28)
+
+#define MIN_BENCH_BLOCK_SIZE        (1 << 17)
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"verbose",             no_argument,         NULL, 'v'},
+    {"bpmnumber",           required_argument,   NULL, 's'},
+    {"boardslot",           required_argument,   NULL, 'o'},
+    {"channumber",          required_argument,   NULL, 'c'},
+    {"numsamples",          required_argument,   NULL, 'n'},
+    {"iterations",          required_argument,   NULL, 'i'},
+    {"csv",                 no_argument,         NULL, 'x'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:vo:s:c:n:i:x";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM Acquisition Block Size Benchmark\n"
+            "Usage: %s [options]\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint\n"
+            "  -v  --verbose                        Verbose output\n"
+            "  -o  --boardslot <Board slot number = [1-12]> \n"
+            "                                       Board slot number\n"
+            "  -s  --bpmnumber <BPM number = [0|1]> BPM number\n"
+            "  -c  --channumber <Channel>           Channel number\n"
+            "  -n  --numsamples <Number of samples> Number of samples\n"
+            "  -i  --iterations <Number of iterations>\n"
+            "                                       Curve reads per block size\n"
+            "  -x  --csv                            Machine-readable (CSV) output\n",
+            program_name);
+}
+
+int main (int argc, char *argv [])
+{
+    int verbose = 0;
+    int csv = 0;
+    char *broker_endp = NULL;
+    char *num_samples_str = NULL;
+    char *board_number_str = NULL;
+    char *bpm_number_str = NULL;
+    char *chan_str = NULL;
+    char *num_iter_str = NULL;
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'o':
+                board_number_str = strdup (optarg);
+                break;
+
+            case 's':
+                bpm_number_str = strdup (optarg);
+                break;
+
+            case 'c':
+                chan_str = strdup (optarg);
+                break;
+
+            case 'n':
+                num_samples_str = strdup (optarg);
+                break;
+
+            case 'i':
+                num_iter_str = strdup (optarg);
+                break;
+
+            case 'x':
+                csv = 1;
+                break;
+
+            case '?':
+                fprintf (stderr, "[client:acq_block_size_bench] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                fprintf (stderr, "[client:acq_block_size_bench] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+         }
+    }
+
+    /* Set default broker address */
+    if (broker_endp == NULL) {
+        fprintf (stderr, "[client:acq_block_size_bench]: Setting default broker endpoint: %s\n",
+                "ipc://"DFLT_BIND_FOLDER);
+        broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    /* Set default number samples */
+    uint32_t num_samples;
+    if (num_samples_str == NULL) {
+        fprintf (stderr, "[client:acq_block_size_bench]: Setting default value to number of samples: %u\n",
+                DFLT_NUM_SAMPLES);
+        num_samples = DFLT_NUM_SAMPLES;
+    }
+    else {
+        num_samples = strtoul (num_samples_str, NULL, 10);
+
+        if (num_samples < MIN_NUM_SAMPLES) {
+            fprintf (stderr, "[client:acq_block_size_bench]: Number of samples too small! Defaulting to: %u\n",
+                    MIN_NUM_SAMPLES);
+            num_samples = MIN_NUM_SAMPLES;
+        }
+        else if (num_samples > MAX_NUM_SAMPLES) {
+            fprintf (stderr, "[client:acq_block_size_bench]: Number of samples too big! Defaulting to: %u\n",
+                    MAX_NUM_SAMPLES);
+            num_samples = MAX_NUM_SAMPLES;
+        }
+    }
+
+    /* Set default channel */
+    uint32_t chan;
+    if (chan_str == NULL) {
+        fprintf (stderr, "[client:acq_block_size_bench]: Setting default value to 'chan'\n");
+        chan = DFLT_CHAN_NUM;
+    }
+    else {
+        chan = strtoul (chan_str, NULL, 10);
+
+        if (chan > END_CHAN_ID-1) {
+            fprintf (stderr, "[client:acq_block_size_bench]: Channel number too big! Defaulting to: %u\n",
+                    END_CHAN_ID-1);
+            chan = END_CHAN_ID-1;
+        }
+    }
+
+    /* Set default number of iterations */
+    uint32_t num_iter;
+    if (num_iter_str == NULL) {
+        num_iter = DFLT_NUM_ITER;
+    }
+    else {
+        num_iter = strtoul (num_iter_str, NULL, 10);
+        num_iter = (num_iter == 0) ? 1 : num_iter;
+    }
+
+    /* Set default board number */
+    uint32_t board_number;
+    if (board_number_str == NULL) {
+        fprintf (stderr, "[client:acq_block_size_bench]: Setting default value to BOARD number: %u\n",
+                DFLT_BOARD_NUMBER);
+        board_number = DFLT_BOARD_NUMBER;
+    }
+    else {
+        board_number = strtoul (board_number_str, NULL, 10);
+    }
+
+    /* Set default bpm number */
+    uint32_t bpm_number;
+    if (bpm_number_str == NULL) {
+        fprintf (stderr, "[client:acq_block_size_bench]: Setting default value to BPM number: %u\n",
+                DFLT_BPM_NUMBER);
+        bpm_number = DFLT_BPM_NUMBER;
+    }
+    else {
+        bpm_number = strtoul (bpm_number_str, NULL, 10);
+
+        if (bpm_number > MAX_BPM_NUMBER) {
+            fprintf (stderr, "[client:acq_block_size_bench]: BPM number too big! Defaulting to: %u\n",
+                    MAX_BPM_NUMBER);
+            bpm_number = MAX_BPM_NUMBER;
+        }
+    }
+
+    char service[50];
+    snprintf (service, sizeof (service), "BPM%u:DEVIO:ACQ%u", board_number, bpm_number);
+
+    bpm_client_t *bpm_client = bpm_client_new (broker_endp, verbose, NULL);
+    if (bpm_client == NULL) {
+        fprintf (stderr, "[client:acq_block_size_bench]: bpm_client could be created\n");
+        goto err_bpm_client_new;
+    }
+
+    /* Set trigger to skip */
+    uint32_t acq_trig = 0;
+    bpm_client_err_e err = bpm_set_acq_trig (bpm_client, service, acq_trig);
+    if (err != BPM_CLIENT_SUCCESS){
+        fprintf (stderr, "[client:acq_block_size_bench]: bpm_acq_set_trig failed\n");
+        goto err_bpm_set_acq_trig;
+    }
+
+    /* Allow the largest blocks for the duration of the benchmark */
+    uint32_t block_size_max = 0;
+    err = bpm_get_acq_block_size_max (bpm_client, service, &block_size_max);
+    if (err != BPM_CLIENT_SUCCESS){
+        fprintf (stderr, "[client:acq_block_size_bench]: bpm_get_acq_block_size_max failed\n");
+        goto err_bpm_get_block_size_max;
+    }
+
+    err = bpm_set_acq_block_size_max (bpm_client, service, ACQ_BLOCK_SIZE_MAX);
+    if (err != BPM_CLIENT_SUCCESS){
+        fprintf (stderr, "[client:acq_block_size_bench]: bpm_set_acq_block_size_max failed\n");
+        goto err_bpm_set_block_size_max;
+    }
+
+    uint32_t data_size = num_samples*acq_chan[chan].sample_size;
+    uint32_t *data = (uint32_t *) zmalloc (data_size*sizeof (uint8_t));
+    acq_trans_t acq_trans = {.req =   {
+                                        .num_samples_pre = num_samples,
+                                        .num_samples_post = 0,
+                                        .num_shots = 1,
+                                        .chan = chan,
+                                      },
+                             .block = {
+                                        .data = data,
+                                        .data_size = data_size,
+                                      }
+                            };
+
+    /* Acquire only once, so every block size reads the same curve */
+    err = bpm_full_acq (bpm_client, service, &acq_trans, 50000);
+    if (err != BPM_CLIENT_SUCCESS){
+        fprintf (stderr, "[client:acq_block_size_bench]: bpm_full_acq failed\n");
+        goto err_bpm_full_acq;
+    }
+
+    if (csv) {
+        fprintf (stdout, "bench,chan,num_samples,block_size,iterations,"
+                "time_ms,mb_s\n");
+    }
+    else {
+        fprintf (stdout, "%12s %12s %12s\n", "block size", "time (ms)", "MB/s");
+    }
+    for (uint32_t block_size = MIN_BENCH_BLOCK_SIZE; block_size <= ACQ_BLOCK_SIZE_MAX;
+            block_size <<= 1) {
+        int64_t start = zclock_usecs ();
+        uint64_t total_bytes = 0;
+
+        for (uint32_t i = 0; i < num_iter; i++) {
+            if (zsys_interrupted) {
+                goto err_interrupted;
+            }
+
+            err = bpm_acq_get_curve_sized (bpm_client, service, &acq_trans,
+                    block_size);
+            if (err != BPM_CLIENT_SUCCESS){
+                fprintf (stderr, "[client:acq_block_size_bench]: bpm_acq_get_curve_sized "
+                        "failed for block size %u\n", block_size);
+                goto err_bpm_get_curve;
+            }
+            total_bytes += acq_trans.block.bytes_read;
+        }
+
+        int64_t elapsed = zclock_usecs () - start;
+        elapsed = (elapsed == 0) ? 1 : elapsed;
+        if (csv) {
+            fprintf (stdout, "acq_block_size,%u,%u,%u,%u,%.3f,%.3f\n", chan,
+                    num_samples, block_size, num_iter,
+                    (double) elapsed / 1000.0 / num_iter,
+                    (double) total_bytes / (double) elapsed);
+        }
+        else {
+            fprintf (stdout, "%12u %12.3f %12.3f\n", block_size,
+                    (double) elapsed / 1000.0 / num_iter,
+                    (double) total_bytes / (double) elapsed);
+        }
+    }
+
+err_bpm_get_curve:
+err_interrupted:
+err_bpm_full_acq:
+    free (data);
+    /* Restore the original configuration */
+    bpm_set_acq_block_size_max (bpm_client, service, block_size_max);
+err_bpm_set_block_size_max:
+err_bpm_get_block_size_max:
+err_bpm_set_acq_trig:
+err_bpm_client_new:
+    free (num_iter_str);
+    num_iter_str = NULL;
+    free (chan_str);
+    chan_str = NULL;
+    free (board_number_str);
+    board_number_str = NULL;
+    free (bpm_number_str);
+    bpm_number_str = NULL;
+    free (num_samples_str);
+    num_samples_str = NULL;
+    free (broker_endp);
+    broker_endp = NULL;
+    bpm_client_destroy (&bpm_client);
+
+    return 0;
+}
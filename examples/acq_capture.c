@@ -0,0 +1,532 @@
+/*
+ *  * Parallel multi-board capture. The same acquisition is armed on the ACQ
+ *   * services of many boards at once, and their curves are read in parallel
+ *    * and written to binary capture files (see bpm_capture_hdr_t)
+ *     */
+
+#include <getopt.h>
+#include <czmq.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bpm_client.h>
+
+#define DFLT_BIND_FOLDER            "/tmp/bpm"
+
+#define DFLT_BOARD_LIST             "0"
+#define DFLT_BPM_LIST               "0"
+#define DFLT_CHAN_LIST              "0"
+#define DFLT_NUM_SAMPLES_PRE        4096
+#define DFLT_NUM_SAMPLES_POST       0
+#define DFLT_NUM_SHOTS              1
+#define DFLT_TIMEOUT                50000       /* in ms */
+#define DFLT_WINDOW                 4
+#define DFLT_BATCH                  16
+#define DFLT_OUTPUT_DIR             "."
+
+#define MAX_BPM_NUMBER              1
+#define MAX_SERVICES                256
+#define SERVICE_NAME_LEN            50
+/* Arbitrary hard limits */
+#define MAX_NUM_SAMPLES             (1 << 28)
+#define MAX_WINDOW                  64
+#define MAX_BATCH                   64
+
+#define CAPTURE_FILE_SUFFIX         ".cap"
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"verbose",             no_argument,         NULL, 'v'},
+    {"boardslots",          required_argument,   NULL, 'o'},
+    {"bpmnumbers",          required_argument,   NULL, 's'},
+    {"channumbers",         required_argument,   NULL, 'c'},
+    {"numsamples",          required_argument,   NULL, 'n'},
+    {"numsamplespost",      required_argument,   NULL, 'p'},
+    {"numshots",            required_argument,   NULL, 'S'},
+    {"readonly",            no_argument,         NULL, 'r'},
+    {"timeout",             required_argument,   NULL, 'T'},
+    {"window",              required_argument,   NULL, 'w'},
+    {"batch",               required_argument,   NULL, 'm'},
+    {"outputdir",           required_argument,   NULL, 'd'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:vo:s:c:n:p:S:rT:w:m:d:";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM Parallel Capture Utility\n"
+            "Usage: %s [options]\n"
+            "\n"
+            "Arms the same acquisition on every BPM at once, waits for all of them\n"
+            "to complete and reads their curves in parallel. Each curve is written\n"
+            "to <Output dir>/<service>_CH<chan>_<seq>_<timestamp>"CAPTURE_FILE_SUFFIX",\n"
+            "in the format of the post-mortem recorder (see bpm_capture_hdr_t).\n"
+            "Channels are taken one after the other, each waiting for its trigger.\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint\n"
+            "  -v  --verbose                        Verbose output\n"
+            "  -o  --boardslots <Board slot list>   Comma-separated board slot numbers\n"
+            "                                       (default: "DFLT_BOARD_LIST")\n"
+            "  -s  --bpmnumbers <BPM number list>   Comma-separated BPM numbers [0|1]\n"
+            "                                       (default: "DFLT_BPM_LIST")\n"
+            "  -c  --channumbers <Channel list>     Comma-separated channel numbers\n"
+            "                                       (default: "DFLT_CHAN_LIST")\n"
+            "  -n  --numsamples <Number of samples> Number of pre-trigger samples\n"
+            "  -p  --numsamplespost <Number of samples>\n"
+            "                                       Number of post-trigger samples\n"
+            "  -S  --numshots <Number of shots>     Number of shots\n"
+            "  -r  --readonly                       Do not arm anything, capture the\n"
+            "                                       last completed acquisition of each\n"
+            "                                       channel instead (e.g., after a\n"
+            "                                       beam loss). -n, -p and -S are\n"
+            "                                       taken from the acquisition\n"
+            "  -T  --timeout <Timeout>              Arming and completion timeout, in ms\n"
+            "  -w  --window <Window>                Block requests in flight per curve\n"
+            "  -m  --batch <Number of curves>       Curves read at once. Bounds the\n"
+            "                                       memory used to batch * curve size\n"
+            "  -d  --outputdir <Directory>          Directory of the capture files\n"
+            "                                       (default: "DFLT_OUTPUT_DIR")\n",
+            program_name);
+}
+
+static uint32_t _parse_list (const char *str, uint32_t *list, uint32_t max)
+{
+    char *copy = strdup (str);
+    char *saveptr = NULL;
+    uint32_t num = 0;
+
+    if (copy == NULL) {
+        return 0;
+    }
+
+    for (char *tok = strtok_r (copy, ",", &saveptr); tok != NULL && num < max;
+            tok = strtok_r (NULL, ",", &saveptr)) {
+        char *endptr = NULL;
+        list [num++] = strtoul (tok, &endptr, 10);
+        if (*endptr != '\0') {
+            num = 0;
+            break;
+        }
+    }
+
+    free (copy);
+    return num;
+}
+
+/* Write the curve read into acq_trans to a capture file of its own */
+static bpm_client_err_e _write_capture (const char *output_dir, const char *service,
+        const acq_trans_t *acq_trans, const smio_acq_curve_info_t *curve_info,
+        uint64_t *bytes_written)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    char path [PATH_MAX];
+    int len = snprintf (path, sizeof (path), "%s/%s_CH%u_%u_%"PRIu64
+            CAPTURE_FILE_SUFFIX, output_dir, service, acq_trans->req.chan,
+            curve_info->seq, curve_info->timestamp);
+    if (len < 0 || (size_t) len >= sizeof (path)) {
+        fprintf (stderr, "[client:acq_capture]: Capture file path too long\n");
+        err = BPM_CLIENT_ERR_INV_PARAM;
+        goto err_path;
+    }
+
+    /* Stamp the capture with the trigger and completion time seen by the
+     * server, so captures of different boards can be lined up */
+    bpm_capture_info_t capture_info = {
+        .req = acq_trans->req,
+        .trig_addr = curve_info->trig_addr,
+        .timestamp = curve_info->timestamp};
+    bpm_capture_t *capture = bpm_capture_new (path, &capture_info);
+    if (capture == NULL) {
+        fprintf (stderr, "[client:acq_capture]: Could not create capture file %s\n",
+                path);
+        err = BPM_CLIENT_ERR_INV_PARAM;
+        goto err_capture_new;
+    }
+
+    err = bpm_capture_write (capture, acq_trans->block.data,
+            acq_trans->block.bytes_read);
+    if (err != BPM_CLIENT_SUCCESS) {
+        fprintf (stderr, "[client:acq_capture]: Could not write capture file %s\n",
+                path);
+        goto err_capture_write;
+    }
+    *bytes_written += acq_trans->block.bytes_read;
+
+err_capture_write:
+    bpm_capture_destroy (&capture);
+err_capture_new:
+err_path:
+    return err;
+}
+
+/* Read the curves of channel "chan" of services [0..num_services-1] at once
+ * and write each of them to its capture file. acq_req is the acquisition
+ * armed, or NULL to capture the last completed one of each service.
+ * Returns the number of curves captured */
+static uint32_t _capture_batch (bpm_client_t *bpm_client, char **services,
+        uint32_t num_services, uint32_t chan, const acq_req_t *acq_req,
+        uint32_t window, const char *output_dir, int verbose,
+        uint64_t *bytes_written)
+{
+    acq_trans_t acq_trans [MAX_BATCH];
+    smio_acq_curve_info_t curve_info [MAX_BATCH];
+    bpm_client_err_e errs [MAX_BATCH];
+    char *valid_services [MAX_BATCH];
+    uint32_t num_valid = 0;
+    uint32_t num_captured = 0;
+
+    /* The metadata is needed before the curve in read-only mode, to know
+     * its size, and is taken before the read otherwise as well, so it can
+     * not be of a later acquisition than the curve */
+    for (uint32_t i = 0; i < num_services; ++i) {
+        bpm_client_err_e err = bpm_acq_get_curve_info (bpm_client, services [i],
+                chan, &curve_info [num_valid]);
+        if (err != BPM_CLIENT_SUCCESS || curve_info [num_valid].timestamp == 0) {
+            fprintf (stderr, "[client:acq_capture]: %s: No completed acquisition "
+                    "of channel %u\n", services [i], chan);
+            continue;
+        }
+
+        acq_trans_t *trans = &acq_trans [num_valid];
+        memset (trans, 0, sizeof (*trans));
+        if (acq_req != NULL) {
+            trans->req = *acq_req;
+        }
+        else {
+            trans->req.num_samples_pre = curve_info [num_valid].num_samples_pre;
+            trans->req.num_samples_post = curve_info [num_valid].num_samples_post;
+            trans->req.num_shots = curve_info [num_valid].num_shots;
+        }
+        trans->req.chan = chan;
+
+        uint64_t curve_size = (uint64_t) (trans->req.num_samples_pre +
+                trans->req.num_samples_post) * trans->req.num_shots *
+                acq_chan [chan].sample_size;
+        if (curve_size == 0 || curve_size > UINT32_MAX) {
+            fprintf (stderr, "[client:acq_capture]: %s: Invalid curve size of "
+                    "channel %u\n", services [i], chan);
+            continue;
+        }
+
+        trans->block.data = (uint32_t *) zmalloc (curve_size);
+        trans->block.data_size = (uint32_t) curve_size;
+        if (trans->block.data == NULL) {
+            fprintf (stderr, "[client:acq_capture]: %s: Could not allocate "
+                    "%"PRIu64" bytes\n", services [i], curve_size);
+            continue;
+        }
+
+        valid_services [num_valid++] = services [i];
+    }
+
+    if (num_valid == 0) {
+        goto err_no_valid;
+    }
+
+    /* All of the curves are read at the same time, each DEVIO serving its
+     * share of the block requests */
+    bpm_acq_group_get_curve (bpm_client, valid_services, num_valid, acq_trans,
+            window, errs);
+
+    for (uint32_t i = 0; i < num_valid; ++i) {
+        if (errs [i] != BPM_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:acq_capture]: %s: Could not read curve of "
+                    "channel %u: %s\n", valid_services [i], chan,
+                    bpm_client_err_str (errs [i]));
+            continue;
+        }
+
+        if (_write_capture (output_dir, valid_services [i], &acq_trans [i],
+                    &curve_info [i], bytes_written) == BPM_CLIENT_SUCCESS) {
+            num_captured++;
+            if (verbose) {
+                fprintf (stderr, "[client:acq_capture]: %s: Captured acquisition "
+                        "#%u of channel %u, %u bytes\n", valid_services [i],
+                        curve_info [i].seq, chan, acq_trans [i].block.bytes_read);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < num_valid; ++i) {
+        free (acq_trans [i].block.data);
+    }
+
+err_no_valid:
+    return num_captured;
+}
+
+int main (int argc, char *argv [])
+{
+    int verbose = 0;
+    int read_only = 0;
+    char *broker_endp = NULL;
+    char *board_list_str = NULL;
+    char *bpm_list_str = NULL;
+    char *chan_list_str = NULL;
+    char *num_samples_str = NULL;
+    char *num_samples_post_str = NULL;
+    char *num_shots_str = NULL;
+    char *timeout_str = NULL;
+    char *window_str = NULL;
+    char *batch_str = NULL;
+    char *output_dir = NULL;
+    uint32_t num_failed = 0;
+    int ret = 1;
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'o':
+                board_list_str = strdup (optarg);
+                break;
+
+            case 's':
+                bpm_list_str = strdup (optarg);
+                break;
+
+            case 'c':
+                chan_list_str = strdup (optarg);
+                break;
+
+            case 'n':
+                num_samples_str = strdup (optarg);
+                break;
+
+            case 'p':
+                num_samples_post_str = strdup (optarg);
+                break;
+
+            case 'S':
+                num_shots_str = strdup (optarg);
+                break;
+
+            case 'r':
+                read_only = 1;
+                break;
+
+            case 'T':
+                timeout_str = strdup (optarg);
+                break;
+
+            case 'w':
+                window_str = strdup (optarg);
+                break;
+
+            case 'm':
+                batch_str = strdup (optarg);
+                break;
+
+            case 'd':
+                output_dir = strdup (optarg);
+                break;
+
+            case '?':
+                fprintf (stderr, "[client:acq_capture] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                fprintf (stderr, "[client:acq_capture] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+         }
+    }
+
+    /* Set default broker address */
+    if (broker_endp == NULL) {
+        fprintf (stderr, "[client:acq_capture]: Setting default broker endpoint: %s\n",
+                "ipc://"DFLT_BIND_FOLDER);
+        broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    if (output_dir == NULL) {
+        output_dir = strdup (DFLT_OUTPUT_DIR);
+    }
+
+    acq_req_t acq_req = {
+        .num_samples_pre = (num_samples_str == NULL) ? DFLT_NUM_SAMPLES_PRE :
+            strtoul (num_samples_str, NULL, 10),
+        .num_samples_post = (num_samples_post_str == NULL) ? DFLT_NUM_SAMPLES_POST :
+            strtoul (num_samples_post_str, NULL, 10),
+        .num_shots = (num_shots_str == NULL) ? DFLT_NUM_SHOTS :
+            strtoul (num_shots_str, NULL, 10)};
+    if (!read_only && (acq_req.num_shots == 0 ||
+            acq_req.num_samples_pre + acq_req.num_samples_post == 0 ||
+            acq_req.num_samples_pre > MAX_NUM_SAMPLES ||
+            acq_req.num_samples_post > MAX_NUM_SAMPLES)) {
+        fprintf (stderr, "[client:acq_capture]: Invalid number of samples or shots\n");
+        goto err_parse;
+    }
+
+    int timeout = (timeout_str == NULL) ? DFLT_TIMEOUT : atoi (timeout_str);
+
+    uint32_t window = (window_str == NULL) ? DFLT_WINDOW :
+        strtoul (window_str, NULL, 10);
+    if (window == 0 || window > MAX_WINDOW) {
+        fprintf (stderr, "[client:acq_capture]: Window must be within [1, %u]\n",
+                MAX_WINDOW);
+        goto err_parse;
+    }
+
+    uint32_t batch = (batch_str == NULL) ? DFLT_BATCH :
+        strtoul (batch_str, NULL, 10);
+    if (batch == 0 || batch > MAX_BATCH) {
+        fprintf (stderr, "[client:acq_capture]: Batch must be within [1, %u]\n",
+                MAX_BATCH);
+        goto err_parse;
+    }
+
+    uint32_t chans [END_CHAN_ID];
+    uint32_t num_chans = _parse_list ((chan_list_str == NULL) ? DFLT_CHAN_LIST :
+            chan_list_str, chans, END_CHAN_ID);
+    if (num_chans == 0) {
+        fprintf (stderr, "[client:acq_capture]: Invalid channel list\n");
+        goto err_parse;
+    }
+    for (uint32_t i = 0; i < num_chans; ++i) {
+        if (chans [i] >= END_CHAN_ID) {
+            fprintf (stderr, "[client:acq_capture]: Invalid channel %u\n", chans [i]);
+            goto err_parse;
+        }
+    }
+
+    /* Services, each board with each BPM */
+    uint32_t boards [MAX_SERVICES];
+    uint32_t bpms [MAX_BPM_NUMBER + 1];
+    uint32_t num_boards = _parse_list ((board_list_str == NULL) ? DFLT_BOARD_LIST :
+            board_list_str, boards, MAX_SERVICES);
+    uint32_t num_bpms = _parse_list ((bpm_list_str == NULL) ? DFLT_BPM_LIST :
+            bpm_list_str, bpms, MAX_BPM_NUMBER + 1);
+    if (num_boards == 0 || num_bpms == 0) {
+        fprintf (stderr, "[client:acq_capture]: Invalid board or BPM list\n");
+        goto err_parse;
+    }
+
+    static char service_names [MAX_SERVICES][SERVICE_NAME_LEN];
+    char *services [MAX_SERVICES];
+    uint32_t num_services = 0;
+    for (uint32_t i = 0; i < num_boards; ++i) {
+        for (uint32_t j = 0; j < num_bpms && num_services < MAX_SERVICES; ++j) {
+            uint32_t bpm_number = (bpms [j] > MAX_BPM_NUMBER) ? MAX_BPM_NUMBER : bpms [j];
+            snprintf (service_names [num_services], SERVICE_NAME_LEN,
+                    "BPM%u:DEVIO:ACQ%u", boards [i], bpm_number);
+            services [num_services] = service_names [num_services];
+            num_services++;
+        }
+    }
+
+    bpm_client_t *bpm_client = bpm_client_new (broker_endp, verbose, NULL);
+    if (bpm_client == NULL) {
+        fprintf (stderr, "[client:acq_capture]: bpm_client could not be created\n");
+        goto err_bpm_client_new;
+    }
+
+    for (uint32_t c = 0; c < num_chans && !zctx_interrupted; ++c) {
+        uint32_t chan = chans [c];
+        char *armed [MAX_SERVICES];
+        uint32_t num_armed = 0;
+        int64_t start = zclock_mono ();
+
+        if (read_only) {
+            memcpy (armed, services, num_services * sizeof (*armed));
+            num_armed = num_services;
+        }
+        else {
+            /* Arm every service before waiting for any of them, so all of
+             * them see the same trigger */
+            bpm_client_err_e errs [MAX_SERVICES];
+            acq_req.chan = chan;
+            bpm_acq_group_start (bpm_client, services, num_services, &acq_req,
+                    errs, timeout);
+            for (uint32_t i = 0; i < num_services; ++i) {
+                if (errs [i] != BPM_CLIENT_SUCCESS) {
+                    fprintf (stderr, "[client:acq_capture]: %s: Could not start "
+                            "acquisition of channel %u: %s\n", services [i], chan,
+                            bpm_client_err_str (errs [i]));
+                    continue;
+                }
+                armed [num_armed++] = services [i];
+            }
+
+            bpm_acq_group_wait (bpm_client, armed, num_armed, errs, timeout);
+            uint32_t num_done = 0;
+            for (uint32_t i = 0; i < num_armed; ++i) {
+                if (errs [i] != BPM_CLIENT_SUCCESS) {
+                    fprintf (stderr, "[client:acq_capture]: %s: Acquisition of "
+                            "channel %u did not complete: %s\n", armed [i], chan,
+                            bpm_client_err_str (errs [i]));
+                    continue;
+                }
+                armed [num_done++] = armed [i];
+            }
+            num_armed = num_done;
+        }
+
+        uint32_t num_captured = 0;
+        uint64_t bytes_written = 0;
+        for (uint32_t i = 0; i < num_armed && !zctx_interrupted; i += batch) {
+            uint32_t num = (num_armed - i < batch) ? num_armed - i : batch;
+            num_captured += _capture_batch (bpm_client, &armed [i], num, chan,
+                    read_only ? NULL : &acq_req, window, output_dir, verbose,
+                    &bytes_written);
+        }
+        num_failed += num_services - num_captured;
+
+        double elapsed_s = (zclock_mono () - start) / 1000.0;
+        fprintf (stderr, "[client:acq_capture]: Channel %u: %u of %u curves "
+                "captured, %"PRIu64" bytes in %.3f s\n", chan, num_captured,
+                num_services, bytes_written, elapsed_s);
+    }
+
+    ret = (num_failed == 0) ? 0 : 1;
+
+    bpm_client_destroy (&bpm_client);
+err_bpm_client_new:
+err_parse:
+    free (output_dir);
+    output_dir = NULL;
+    free (batch_str);
+    batch_str = NULL;
+    free (window_str);
+    window_str = NULL;
+    free (timeout_str);
+    timeout_str = NULL;
+    free (num_shots_str);
+    num_shots_str = NULL;
+    free (num_samples_post_str);
+    num_samples_post_str = NULL;
+    free (num_samples_str);
+    num_samples_str = NULL;
+    free (chan_list_str);
+    chan_list_str = NULL;
+    free (bpm_list_str);
+    bpm_list_str = NULL;
+    free (board_list_str);
+    board_list_str = NULL;
+    free (broker_endp);
+    broker_endp = NULL;
+
+    return ret;
+}
@@ -0,0 +1,579 @@
+/*
+ *  * Synthetic multi-client load generator. Each thread is a client of its
+ *   * own, running a weighted mix of parameter reads/writes, monitoring polls
+ *    * and full acquisitions over many services
+ *     */
+
+#include <getopt.h>
+#include <czmq.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bpm_client.h>
+
+#define DFLT_BIND_FOLDER            "/tmp/bpm"
+
+#define DFLT_BOARD_LIST             "0"
+#define DFLT_BPM_LIST               "0"
+#define DFLT_NUM_THREADS            4
+#define DFLT_DURATION               10          /* in s */
+#define DFLT_TIMEOUT                5000        /* in ms */
+#define DFLT_MIX                    "60,10,25,5"
+#define DFLT_NUM_SAMPLES            1024
+#define DFLT_CHAN_NUM               0
+
+#define MAX_BPM_NUMBER              1
+#define MAX_SERVICES                256
+#define SERVICE_NAME_LEN            50
+
+/* Initial number of latencies stored per operation type and thread */
+#define LAT_INITIAL_SIZE            4096
+
+typedef enum {
+    OP_READ = 0,                    /* Get DSP KX */
+    OP_WRITE,                       /* Set DSP KX, to the value read */
+    OP_POLL,                        /* Get the amplitudes and positions */
+    OP_ACQ,                         /* bpm_full_acq of the ACQ service */
+    OP_END
+} op_type_e;
+
+static const char *op_names [OP_END] = {"read", "write", "poll", "acq"};
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"verbose",             no_argument,         NULL, 'v'},
+    {"boardslots",          required_argument,   NULL, 'o'},
+    {"bpmnumbers",          required_argument,   NULL, 's'},
+    {"threads",             required_argument,   NULL, 't'},
+    {"duration",            required_argument,   NULL, 'd'},
+    {"mix",                 required_argument,   NULL, 'm'},
+    {"numsamples",          required_argument,   NULL, 'n'},
+    {"channumber",          required_argument,   NULL, 'c'},
+    {"timeout",             required_argument,   NULL, 'T'},
+    {"csv",                 no_argument,         NULL, 'x'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:vo:s:t:d:m:n:c:T:x";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM Synthetic Multi-Client Load Generator\n"
+            "Usage: %s [options]\n"
+            "\n"
+            "Works the same against boards and against DEVIOs of the simulated\n"
+            "(sim) llio backend, as only the services are talked to.\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint\n"
+            "  -v  --verbose                        Verbose output\n"
+            "  -o  --boardslots <Board slot list>   Comma-separated board slot numbers\n"
+            "                                       (default: "DFLT_BOARD_LIST")\n"
+            "  -s  --bpmnumbers <BPM number list>   Comma-separated BPM numbers [0|1]\n"
+            "                                       (default: "DFLT_BPM_LIST")\n"
+            "  -t  --threads <Number of threads>    Concurrent clients\n"
+            "  -d  --duration <Duration>            Duration of the run, in s\n"
+            "  -m  --mix <read,write,poll,acq>      Relative weight of each operation\n"
+            "                                       (default: "DFLT_MIX")\n"
+            "  -n  --numsamples <Number of samples> Samples of each acquisition\n"
+            "  -c  --channumber <Channel>           Channel of each acquisition\n"
+            "  -T  --timeout <Timeout>              Client timeout, in ms\n"
+            "  -x  --csv                            Machine-readable (CSV) output\n",
+            program_name);
+}
+
+/* Latencies of one operation type, in us */
+typedef struct {
+    int64_t *lat;
+    size_t num_lat;
+    size_t size;
+    uint64_t num_errors;
+} op_result_t;
+
+/* Arguments and results of a worker. Results are only read once the
+ * worker is gone */
+typedef struct {
+    char *broker_endp;
+    int verbose;
+    int timeout;
+    char (*services) [SERVICE_NAME_LEN];    /* DSP services */
+    char (*acq_services) [SERVICE_NAME_LEN];/* ACQ service of each DSP one */
+    uint32_t num_services;
+    uint32_t mix [OP_END];
+    uint32_t mix_total;
+    uint32_t num_samples;
+    uint32_t chan;
+    int64_t deadline;                       /* zclock_mono () to stop at */
+    unsigned int seed;
+    op_result_t results [OP_END];
+} worker_args_t;
+
+static int _cmp_int64 (const void *a, const void *b)
+{
+    int64_t va = *(const int64_t *) a;
+    int64_t vb = *(const int64_t *) b;
+    return (va > vb) - (va < vb);
+}
+
+static void _result_add (op_result_t *result, int64_t lat, bool ok)
+{
+    if (!ok) {
+        result->num_errors++;
+        return;
+    }
+
+    if (result->num_lat == result->size) {
+        size_t size = (result->size == 0) ? LAT_INITIAL_SIZE : result->size * 2;
+        int64_t *new_lat = (int64_t *) realloc (result->lat, size * sizeof (*new_lat));
+        if (new_lat == NULL) {
+            /* Not counted, but we go on */
+            return;
+        }
+        result->lat = new_lat;
+        result->size = size;
+    }
+
+    result->lat [result->num_lat++] = lat;
+}
+
+static op_type_e _pick_op (worker_args_t *args)
+{
+    uint32_t pick = (uint32_t) rand_r (&args->seed) % args->mix_total;
+
+    for (int op = 0; op < OP_END; ++op) {
+        if (pick < args->mix [op]) {
+            return (op_type_e) op;
+        }
+        pick -= args->mix [op];
+    }
+
+    return OP_READ;
+}
+
+static bpm_client_err_e _run_poll (bpm_client_t *bpm_client, char *service)
+{
+    uint32_t value;
+    bpm_client_err_e err = bpm_get_monit_amp_ch0 (bpm_client, service, &value);
+    err = (err != BPM_CLIENT_SUCCESS) ? err :
+        bpm_get_monit_amp_ch1 (bpm_client, service, &value);
+    err = (err != BPM_CLIENT_SUCCESS) ? err :
+        bpm_get_monit_amp_ch2 (bpm_client, service, &value);
+    err = (err != BPM_CLIENT_SUCCESS) ? err :
+        bpm_get_monit_amp_ch3 (bpm_client, service, &value);
+    err = (err != BPM_CLIENT_SUCCESS) ? err :
+        bpm_get_monit_pos_x (bpm_client, service, &value);
+    err = (err != BPM_CLIENT_SUCCESS) ? err :
+        bpm_get_monit_pos_y (bpm_client, service, &value);
+    return err;
+}
+
+static void _worker (zsock_t *pipe, void *args_p)
+{
+    worker_args_t *args = (worker_args_t *) args_p;
+    uint32_t *kx = NULL;
+    bool *kx_valid = NULL;
+    uint32_t *data = NULL;
+
+    zsock_signal (pipe, 0);
+
+    bpm_client_t *bpm_client = bpm_client_new_time (args->broker_endp,
+            args->verbose, NULL, args->timeout);
+    if (bpm_client == NULL) {
+        fprintf (stderr, "[client:load_gen_bench]: bpm_client could be created\n");
+        goto err_bpm_client_new;
+    }
+
+    kx = (uint32_t *) zmalloc (args->num_services * sizeof (*kx));
+    kx_valid = (bool *) zmalloc (args->num_services * sizeof (*kx_valid));
+    uint32_t data_size = args->num_samples * acq_chan [args->chan].sample_size;
+    data = (uint32_t *) zmalloc (data_size);
+    if (kx == NULL || kx_valid == NULL || data == NULL) {
+        fprintf (stderr, "[client:load_gen_bench]: Could not allocate buffers\n");
+        goto err_alloc;
+    }
+
+    while (!zsys_interrupted && zclock_mono () < args->deadline) {
+        op_type_e op = _pick_op (args);
+        uint32_t idx = (uint32_t) rand_r (&args->seed) % args->num_services;
+        char *service = args->services [idx];
+        bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+        int64_t start = 0;
+
+        /* Writes only put back the value read, so the run does not change
+         * the device configuration */
+        if (op == OP_WRITE && !kx_valid [idx]) {
+            op = OP_READ;
+        }
+
+        switch (op) {
+            case OP_READ:
+                start = zclock_usecs ();
+                err = bpm_get_kx (bpm_client, service, &kx [idx]);
+                kx_valid [idx] = kx_valid [idx] || (err == BPM_CLIENT_SUCCESS);
+                break;
+
+            case OP_WRITE:
+                start = zclock_usecs ();
+                err = bpm_set_kx (bpm_client, service, kx [idx]);
+                break;
+
+            case OP_POLL:
+                start = zclock_usecs ();
+                err = _run_poll (bpm_client, service);
+                break;
+
+            case OP_ACQ:
+                {
+                    acq_trans_t acq_trans = {.req =   {
+                                                        .num_samples_pre = args->num_samples,
+                                                        .num_samples_post = 0,
+                                                        .num_shots = 1,
+                                                        .chan = args->chan,
+                                                      },
+                                             .block = {
+                                                        .data = data,
+                                                        .data_size = data_size,
+                                                      }
+                                            };
+                    start = zclock_usecs ();
+                    err = bpm_full_acq (bpm_client, args->acq_services [idx],
+                            &acq_trans, args->timeout);
+                }
+                break;
+
+            default:
+                continue;
+        }
+
+        _result_add (&args->results [op], zclock_usecs () - start,
+                err == BPM_CLIENT_SUCCESS);
+    }
+
+err_alloc:
+    free (data);
+    free (kx_valid);
+    free (kx);
+    bpm_client_destroy (&bpm_client);
+err_bpm_client_new:
+    /* Wait to be told to go, so zactor_destroy () finds us */
+    free (zstr_recv (pipe));
+}
+
+static void _print_header (int csv)
+{
+    if (csv) {
+        fprintf (stdout, "bench,op,threads,services,ops,errors,ops_per_s,"
+                "p50_us,p99_us,p999_us,max_us\n");
+    }
+    else {
+        fprintf (stdout, "%-6s %10s %8s %10s %10s %10s %10s %10s\n",
+                "op", "ops", "errors", "ops/s", "p50 (us)", "p99 (us)",
+                "p999 (us)", "max (us)");
+    }
+}
+
+/* "lat" is sorted in place */
+static void _print_result (int csv, const char *op, uint32_t num_threads,
+        uint32_t num_services, int64_t *lat, size_t num_lat,
+        uint64_t num_errors, double elapsed_s)
+{
+    int64_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+
+    if (num_lat > 0) {
+        qsort (lat, num_lat, sizeof (*lat), _cmp_int64);
+        p50 = lat [num_lat / 2];
+        p99 = lat [(uint64_t) num_lat * 99 / 100];
+        p999 = lat [(uint64_t) num_lat * 999 / 1000];
+        max = lat [num_lat - 1];
+    }
+    double ops_per_s = (elapsed_s > 0) ? num_lat / elapsed_s : 0;
+
+    if (csv) {
+        fprintf (stdout, "load_gen,%s,%u,%u,%zu,%"PRIu64",%.1f,%"PRId64",%"PRId64
+                ",%"PRId64",%"PRId64"\n", op, num_threads, num_services,
+                num_lat, num_errors, ops_per_s, p50, p99, p999, max);
+    }
+    else {
+        fprintf (stdout, "%-6s %10zu %8"PRIu64" %10.1f %10"PRId64" %10"PRId64
+                " %10"PRId64" %10"PRId64"\n", op, num_lat, num_errors,
+                ops_per_s, p50, p99, p999, max);
+    }
+}
+
+/* Parse a comma-separated list of numbers into "list". Returns the
+ * number of entries, 0 on error */
+static uint32_t _parse_list (const char *str, uint32_t *list, uint32_t max)
+{
+    char *copy = strdup (str);
+    char *saveptr = NULL;
+    uint32_t num = 0;
+
+    if (copy == NULL) {
+        return 0;
+    }
+
+    for (char *tok = strtok_r (copy, ",", &saveptr); tok != NULL && num < max;
+            tok = strtok_r (NULL, ",", &saveptr)) {
+        char *endptr = NULL;
+        list [num++] = strtoul (tok, &endptr, 10);
+        if (*endptr != '\0') {
+            num = 0;
+            break;
+        }
+    }
+
+    free (copy);
+    return num;
+}
+
+int main (int argc, char *argv [])
+{
+    int verbose = 0;
+    int csv = 0;
+    char *broker_endp = NULL;
+    char *board_list_str = NULL;
+    char *bpm_list_str = NULL;
+    char *num_threads_str = NULL;
+    char *duration_str = NULL;
+    char *mix_str = NULL;
+    char *num_samples_str = NULL;
+    char *chan_str = NULL;
+    char *timeout_str = NULL;
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'o':
+                board_list_str = strdup (optarg);
+                break;
+
+            case 's':
+                bpm_list_str = strdup (optarg);
+                break;
+
+            case 't':
+                num_threads_str = strdup (optarg);
+                break;
+
+            case 'd':
+                duration_str = strdup (optarg);
+                break;
+
+            case 'm':
+                mix_str = strdup (optarg);
+                break;
+
+            case 'n':
+                num_samples_str = strdup (optarg);
+                break;
+
+            case 'c':
+                chan_str = strdup (optarg);
+                break;
+
+            case 'T':
+                timeout_str = strdup (optarg);
+                break;
+
+            case 'x':
+                csv = 1;
+                break;
+
+            case '?':
+                fprintf (stderr, "[client:load_gen_bench] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                fprintf (stderr, "[client:load_gen_bench] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+         }
+    }
+
+    /* Set default broker address */
+    if (broker_endp == NULL) {
+        fprintf (stderr, "[client:load_gen_bench]: Setting default broker endpoint: %s\n",
+                "ipc://"DFLT_BIND_FOLDER);
+        broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    uint32_t num_threads = (num_threads_str == NULL) ? DFLT_NUM_THREADS :
+        strtoul (num_threads_str, NULL, 10);
+    num_threads = (num_threads == 0) ? 1 : num_threads;
+    uint32_t duration = (duration_str == NULL) ? DFLT_DURATION :
+        strtoul (duration_str, NULL, 10);
+    duration = (duration == 0) ? 1 : duration;
+    uint32_t num_samples = (num_samples_str == NULL) ? DFLT_NUM_SAMPLES :
+        strtoul (num_samples_str, NULL, 10);
+    num_samples = (num_samples == 0) ? 1 : num_samples;
+    int timeout = (timeout_str == NULL) ? DFLT_TIMEOUT :
+        (int) strtol (timeout_str, NULL, 10);
+
+    uint32_t chan = (chan_str == NULL) ? DFLT_CHAN_NUM :
+        strtoul (chan_str, NULL, 10);
+    if (chan >= END_CHAN_ID) {
+        fprintf (stderr, "[client:load_gen_bench]: Channel number too big! Defaulting to: %u\n",
+                DFLT_CHAN_NUM);
+        chan = DFLT_CHAN_NUM;
+    }
+
+    /* Operation mix */
+    uint32_t mix [OP_END];
+    uint32_t mix_total = 0;
+    if (_parse_list ((mix_str == NULL) ? DFLT_MIX : mix_str, mix, OP_END) != OP_END) {
+        fprintf (stderr, "[client:load_gen_bench]: Invalid operation mix\n");
+        goto err_parse_mix;
+    }
+    for (int op = 0; op < OP_END; ++op) {
+        mix_total += mix [op];
+    }
+    if (mix_total == 0) {
+        fprintf (stderr, "[client:load_gen_bench]: Operation mix is all zeros\n");
+        goto err_parse_mix;
+    }
+
+    /* Services, each board with each BPM */
+    uint32_t boards [MAX_SERVICES];
+    uint32_t bpms [MAX_BPM_NUMBER + 1];
+    uint32_t num_boards = _parse_list ((board_list_str == NULL) ? DFLT_BOARD_LIST :
+            board_list_str, boards, MAX_SERVICES);
+    uint32_t num_bpms = _parse_list ((bpm_list_str == NULL) ? DFLT_BPM_LIST :
+            bpm_list_str, bpms, MAX_BPM_NUMBER + 1);
+    if (num_boards == 0 || num_bpms == 0) {
+        fprintf (stderr, "[client:load_gen_bench]: Invalid board or BPM list\n");
+        goto err_parse_services;
+    }
+
+    static char services [MAX_SERVICES][SERVICE_NAME_LEN];
+    static char acq_services [MAX_SERVICES][SERVICE_NAME_LEN];
+    uint32_t num_services = 0;
+    for (uint32_t i = 0; i < num_boards; ++i) {
+        for (uint32_t j = 0; j < num_bpms && num_services < MAX_SERVICES; ++j) {
+            uint32_t bpm_number = (bpms [j] > MAX_BPM_NUMBER) ? MAX_BPM_NUMBER : bpms [j];
+            snprintf (services [num_services], SERVICE_NAME_LEN,
+                    "BPM%u:DEVIO:DSP%u", boards [i], bpm_number);
+            snprintf (acq_services [num_services], SERVICE_NAME_LEN,
+                    "BPM%u:DEVIO:ACQ%u", boards [i], bpm_number);
+            num_services++;
+        }
+    }
+
+    worker_args_t *args = (worker_args_t *) zmalloc (num_threads * sizeof (*args));
+    zactor_t **workers = (zactor_t **) zmalloc (num_threads * sizeof (*workers));
+    if (args == NULL || workers == NULL) {
+        fprintf (stderr, "[client:load_gen_bench]: Could not allocate workers\n");
+        goto err_workers_alloc;
+    }
+
+    int64_t start = zclock_mono ();
+    int64_t deadline = start + (int64_t) duration * 1000;
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        args [i] = (worker_args_t) {
+            .broker_endp = broker_endp,
+            .verbose = verbose,
+            .timeout = timeout,
+            .services = services,
+            .acq_services = acq_services,
+            .num_services = num_services,
+            .mix_total = mix_total,
+            .num_samples = num_samples,
+            .chan = chan,
+            .deadline = deadline,
+            .seed = (unsigned int) (zclock_usecs () + i)};
+        memcpy (args [i].mix, mix, sizeof (mix));
+
+        workers [i] = zactor_new (_worker, &args [i]);
+        if (workers [i] == NULL) {
+            fprintf (stderr, "[client:load_gen_bench]: Could not start worker %u\n", i);
+            break;
+        }
+    }
+
+    /* Each worker stops at the deadline or when interrupted */
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        zactor_destroy (&workers [i]);
+    }
+    double elapsed_s = (zclock_mono () - start) / 1000.0;
+
+    _print_header (csv);
+    for (int op = 0; op < OP_END; ++op) {
+        size_t num_lat = 0;
+        uint64_t num_errors = 0;
+        for (uint32_t i = 0; i < num_threads; ++i) {
+            num_lat += args [i].results [op].num_lat;
+            num_errors += args [i].results [op].num_errors;
+        }
+
+        int64_t *lat = (num_lat == 0) ? NULL :
+            (int64_t *) malloc (num_lat * sizeof (*lat));
+        if (num_lat > 0 && lat == NULL) {
+            fprintf (stderr, "[client:load_gen_bench]: Could not allocate latency buffer\n");
+            continue;
+        }
+
+        size_t offset = 0;
+        for (uint32_t i = 0; i < num_threads; ++i) {
+            op_result_t *result = &args [i].results [op];
+            if (result->num_lat > 0) {
+                memcpy (lat + offset, result->lat, result->num_lat * sizeof (*lat));
+            }
+            offset += result->num_lat;
+        }
+
+        _print_result (csv, op_names [op], num_threads, num_services, lat,
+                num_lat, num_errors, elapsed_s);
+        free (lat);
+    }
+
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        for (int op = 0; op < OP_END; ++op) {
+            free (args [i].results [op].lat);
+        }
+    }
+
+err_workers_alloc:
+    free (workers);
+    free (args);
+err_parse_services:
+err_parse_mix:
+    free (timeout_str);
+    timeout_str = NULL;
+    free (chan_str);
+    chan_str = NULL;
+    free (num_samples_str);
+    num_samples_str = NULL;
+    free (mix_str);
+    mix_str = NULL;
+    free (duration_str);
+    duration_str = NULL;
+    free (num_threads_str);
+    num_threads_str = NULL;
+    free (bpm_list_str);
+    bpm_list_str = NULL;
+    free (board_list_str);
+    board_list_str = NULL;
+    free (broker_endp);
+    broker_endp = NULL;
+
+    return 0;
+}
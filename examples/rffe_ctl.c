@@ -237,42 +237,22 @@ int main (int argc, char *argv [])
         }
     }
 
-    double temp;
-    err = bpm_get_rffe_temp1 (bpm_client, service, &temp);
+    smio_rffe_monit_t monit;
+    err = bpm_get_rffe_monit (bpm_client, service, &monit);
     if (err != BPM_CLIENT_SUCCESS) {
         fprintf (stderr, "[client:rffe_ctl]: Error executing remote "
                 "function: %s\n", bpm_client_err_str (err));
     }
-    fprintf (stdout, "[client:rffe_ctl]: Temp1: %f\n", temp);
-
-    err = bpm_get_rffe_temp2 (bpm_client, service, &temp);
-    if (err != BPM_CLIENT_SUCCESS) {
-        fprintf (stderr, "[client:rffe_ctl]: Error executing remote "
-                "function: %s\n", bpm_client_err_str (err));
-    }
-    fprintf (stdout, "[client:rffe_ctl]: Temp2: %f\n", temp);
-
-    err = bpm_get_rffe_temp3 (bpm_client, service, &temp);
-    if (err != BPM_CLIENT_SUCCESS) {
-        fprintf (stderr, "[client:rffe_ctl]: Error executing remote "
-                "function: %s\n", bpm_client_err_str (err));
-    }
-    fprintf (stdout, "[client:rffe_ctl]: Temp3: %f\n", temp);
-
-    err = bpm_get_rffe_temp4 (bpm_client, service, &temp);
-    if (err != BPM_CLIENT_SUCCESS) {
-        fprintf (stderr, "[client:rffe_ctl]: Error executing remote "
-                "function: %s\n", bpm_client_err_str (err));
-    }
-    fprintf (stdout, "[client:rffe_ctl]: Temp4: %f\n", temp);
-
-    double att;
-    err = bpm_get_rffe_att1 (bpm_client, service, &att);
-    if (err != BPM_CLIENT_SUCCESS) {
-        fprintf (stderr, "[client:rffe_ctl]: Error executing remote "
-                "function: %s\n", bpm_client_err_str (err));
+    else {
+        fprintf (stdout, "[client:rffe_ctl]: Temp1: %f\n", monit.temp1);
+        fprintf (stdout, "[client:rffe_ctl]: Temp2: %f\n", monit.temp2);
+        fprintf (stdout, "[client:rffe_ctl]: Temp3: %f\n", monit.temp3);
+        fprintf (stdout, "[client:rffe_ctl]: Temp4: %f\n", monit.temp4);
+        fprintf (stdout, "[client:rffe_ctl]: Att1: %f\n", monit.att1);
+        fprintf (stdout, "[client:rffe_ctl]: Att2: %f\n", monit.att2);
+        fprintf (stdout, "[client:rffe_ctl]: Set point 1: %f\n", monit.set_point1);
+        fprintf (stdout, "[client:rffe_ctl]: Set point 2: %f\n", monit.set_point2);
     }
-    fprintf (stdout, "[client:rffe_ctl]: Att1: %f\n", att);
 
 err_bpm_client_new:
     bpm_client_destroy (&bpm_client);
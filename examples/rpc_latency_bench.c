@@ -0,0 +1,355 @@
+/*
+ *  * Benchmark of the parameter get/set round-trip latency, as seen by the
+ *   * client (bpm_func_exec) and by the server (SMIO operation statistics),
+ *    * waiting for the replies blocking and, optionally, spinning
+ *     */
+
+#include <getopt.h>
+#include <czmq.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bpm_client.h>
+
+#define DFLT_BIND_FOLDER            "/tmp/bpm"
+
+#define DFLT_FUNC_NAME              DSP_NAME_SET_GET_KX
+#define DFLT_SMIO_NAME              "DSP"
+#define DFLT_NUM_ITER               10000
+
+#define DFLT_BPM_NUMBER             0
+#define MAX_BPM_NUMBER              1
+
+#define DFLT_BOARD_NUMBER           0
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"verbose",             no_argument,         NULL, 'v'},
+    {"bpmnumber",           required_argument,   NULL, 's'},
+    {"boardslot",           required_argument,   NULL, 'o'},
+    {"smio",                required_argument,   NULL, 'm'},
+    {"function",            required_argument,   NULL, 'f'},
+    {"iterations",          required_argument,   NULL, 'i'},
+    {"busypoll",            required_argument,   NULL, 'p'},
+    {"csv",                 no_argument,         NULL, 'x'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:vo:s:m:f:i:p:x";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM Parameter Round-Trip Latency Benchmark\n"
+            "Usage: %s [options]\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint\n"
+            "  -v  --verbose                        Verbose output\n"
+            "  -o  --boardslot <Board slot number = [1-12]> \n"
+            "                                       Board slot number\n"
+            "  -s  --bpmnumber <BPM number = [0|1]> BPM number\n"
+            "  -m  --smio <SMIO name>               SMIO name, as in the service name\n"
+            "                                       (default: "DFLT_SMIO_NAME")\n"
+            "  -f  --function <Function name>       Exported get/set function name\n"
+            "                                       (default: "DFLT_FUNC_NAME")\n"
+            "  -i  --iterations <Number of iterations>\n"
+            "                                       Round-trips per operation\n"
+            "  -p  --busypoll <Busy poll time>      Also run spinning on the replies for\n"
+            "                                       up to this long before blocking, in us\n"
+            "  -x  --csv                            Machine-readable (CSV) output\n",
+            program_name);
+}
+
+static int _cmp_int64 (const void *a, const void *b)
+{
+    int64_t va = *(const int64_t *) a;
+    int64_t vb = *(const int64_t *) b;
+    return (va > vb) - (va < vb);
+}
+
+static void _print_header (int csv)
+{
+    if (csv) {
+        fprintf (stdout, "bench,func,op,busy_poll_us,iterations,min_us,avg_us,"
+                "p50_us,p99_us,max_us,srv_p50_us,srv_p99_us\n");
+    }
+    else {
+        fprintf (stdout, "%-4s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+                "op", "spin (us)", "iter", "min (us)", "avg (us)", "p50 (us)", "p99 (us)",
+                "max (us)", "srv p50", "srv p99");
+    }
+}
+
+/* Client latencies are sorted in place */
+static void _print_result (int csv, const char *func_name, const char *op,
+        uint32_t busy_poll, int64_t *lat, uint32_t num_iter,
+        const smio_op_stats_t *srv_stats)
+{
+    qsort (lat, num_iter, sizeof (*lat), _cmp_int64);
+
+    int64_t total = 0;
+    for (uint32_t i = 0; i < num_iter; i++) {
+        total += lat [i];
+    }
+
+    double avg = (double) total / num_iter;
+    int64_t p50 = lat [num_iter / 2];
+    int64_t p99 = lat [(uint64_t) num_iter * 99 / 100];
+    double srv_p50 = smio_op_stats_percentile (srv_stats, 50.0) / 1000.0;
+    double srv_p99 = smio_op_stats_percentile (srv_stats, 99.0) / 1000.0;
+
+    if (csv) {
+        fprintf (stdout, "rpc_latency,%s,%s,%u,%u,%"PRId64",%.3f,%"PRId64",%"PRId64
+                ",%"PRId64",%.3f,%.3f\n", func_name, op, busy_poll, num_iter,
+                lat [0], avg, p50, p99, lat [num_iter-1], srv_p50, srv_p99);
+    }
+    else {
+        fprintf (stdout, "%-4s %10u %10u %10"PRId64" %10.3f %10"PRId64" %10"PRId64
+                " %10"PRId64" %10.3f %10.3f\n", op, busy_poll, num_iter, lat [0],
+                avg, p50, p99, lat [num_iter-1], srv_p50, srv_p99);
+    }
+}
+
+/* Run "num_iter" round-trips of "func" in "rw" mode. "value" is the value
+ * to be written, or receives the value read */
+static bpm_client_err_e _bench_op (bpm_client_t *bpm_client, char *service,
+        const disp_op_t *func, uint32_t rw, uint32_t *value, int64_t *lat,
+        uint32_t num_iter, smio_op_stats_t *srv_stats)
+{
+    /* Start from a clean slate on the server side */
+    bpm_client_err_e err = bpm_get_op_stats (bpm_client, service, func->opcode,
+            SMIO_OP_STATS_FLAG_RESET, srv_stats);
+    if (err != BPM_CLIENT_SUCCESS) {
+        return err;
+    }
+
+    uint32_t input [2] = {rw, *value};
+    for (uint32_t i = 0; i < num_iter; i++) {
+        if (zsys_interrupted) {
+            return BPM_CLIENT_INT;
+        }
+
+        int64_t start = zclock_usecs ();
+        err = bpm_func_exec (bpm_client, func, service, input, value);
+        lat [i] = zclock_usecs () - start;
+
+        if (err != BPM_CLIENT_SUCCESS) {
+            return err;
+        }
+    }
+
+    return bpm_get_op_stats (bpm_client, service, func->opcode, 0, srv_stats);
+}
+
+int main (int argc, char *argv [])
+{
+    int verbose = 0;
+    int csv = 0;
+    char *broker_endp = NULL;
+    char *board_number_str = NULL;
+    char *bpm_number_str = NULL;
+    char *smio_name = NULL;
+    char *func_name = NULL;
+    char *num_iter_str = NULL;
+    char *busy_poll_str = NULL;
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'o':
+                board_number_str = strdup (optarg);
+                break;
+
+            case 's':
+                bpm_number_str = strdup (optarg);
+                break;
+
+            case 'm':
+                smio_name = strdup (optarg);
+                break;
+
+            case 'f':
+                func_name = strdup (optarg);
+                break;
+
+            case 'i':
+                num_iter_str = strdup (optarg);
+                break;
+
+            case 'p':
+                busy_poll_str = strdup (optarg);
+                break;
+
+            case 'x':
+                csv = 1;
+                break;
+
+            case '?':
+                fprintf (stderr, "[client:rpc_latency_bench] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                fprintf (stderr, "[client:rpc_latency_bench] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+         }
+    }
+
+    /* Set default broker address */
+    if (broker_endp == NULL) {
+        fprintf (stderr, "[client:rpc_latency_bench]: Setting default broker endpoint: %s\n",
+                "ipc://"DFLT_BIND_FOLDER);
+        broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    if (smio_name == NULL) {
+        smio_name = strdup (DFLT_SMIO_NAME);
+    }
+
+    if (func_name == NULL) {
+        func_name = strdup (DFLT_FUNC_NAME);
+    }
+
+    /* Set default number of iterations */
+    uint32_t num_iter;
+    if (num_iter_str == NULL) {
+        num_iter = DFLT_NUM_ITER;
+    }
+    else {
+        num_iter = strtoul (num_iter_str, NULL, 10);
+        num_iter = (num_iter == 0) ? 1 : num_iter;
+    }
+
+    uint32_t busy_poll = (busy_poll_str == NULL) ? 0 :
+        strtoul (busy_poll_str, NULL, 10);
+
+    /* Set default board number */
+    uint32_t board_number;
+    if (board_number_str == NULL) {
+        fprintf (stderr, "[client:rpc_latency_bench]: Setting default value to BOARD number: %u\n",
+                DFLT_BOARD_NUMBER);
+        board_number = DFLT_BOARD_NUMBER;
+    }
+    else {
+        board_number = strtoul (board_number_str, NULL, 10);
+    }
+
+    /* Set default bpm number */
+    uint32_t bpm_number;
+    if (bpm_number_str == NULL) {
+        fprintf (stderr, "[client:rpc_latency_bench]: Setting default value to BPM number: %u\n",
+                DFLT_BPM_NUMBER);
+        bpm_number = DFLT_BPM_NUMBER;
+    }
+    else {
+        bpm_number = strtoul (bpm_number_str, NULL, 10);
+
+        if (bpm_number > MAX_BPM_NUMBER) {
+            fprintf (stderr, "[client:rpc_latency_bench]: BPM number too big! Defaulting to: %u\n",
+                    MAX_BPM_NUMBER);
+            bpm_number = MAX_BPM_NUMBER;
+        }
+    }
+
+    char service[50];
+    snprintf (service, sizeof (service), "BPM%u:DEVIO:%s%u", board_number,
+            smio_name, bpm_number);
+
+    int64_t *lat = NULL;
+    bpm_client_t *bpm_client = bpm_client_new (broker_endp, verbose, NULL);
+    if (bpm_client == NULL) {
+        fprintf (stderr, "[client:rpc_latency_bench]: bpm_client could be created\n");
+        goto err_bpm_client_new;
+    }
+
+    /* Translate only once, so we measure the round-trip only */
+    const disp_op_t *func = bpm_func_translate (func_name);
+    if (func == NULL) {
+        fprintf (stderr, "[client:rpc_latency_bench]: Unknown function %s\n",
+                func_name);
+        goto err_func_translate;
+    }
+
+    lat = (int64_t *) zmalloc (num_iter * sizeof (*lat));
+    if (lat == NULL) {
+        fprintf (stderr, "[client:rpc_latency_bench]: Could not allocate latency buffer\n");
+        goto err_lat_alloc;
+    }
+
+    _print_header (csv);
+
+    /* Blocking first and then spinning, if asked for, so both can be
+     * compared */
+    uint32_t busy_polls [2] = {0, busy_poll};
+    uint32_t num_modes = (busy_poll == 0) ? 1 : 2;
+    for (uint32_t m = 0; m < num_modes; m++) {
+        bpm_client_set_busy_poll (bpm_client, busy_polls [m]);
+
+        /* Get the current value and write it back, so the benchmark does not
+         * change the device configuration */
+        uint32_t value = 0;
+        smio_op_stats_t srv_stats;
+        bpm_client_err_e err = _bench_op (bpm_client, service, func, READ_MODE,
+                &value, lat, num_iter, &srv_stats);
+        if (err != BPM_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:rpc_latency_bench]: %s get failed: %s\n",
+                    func_name, bpm_client_err_str (err));
+            goto err_bench;
+        }
+        _print_result (csv, func_name, "get", busy_polls [m], lat, num_iter,
+                &srv_stats);
+
+        err = _bench_op (bpm_client, service, func, WRITE_MODE, &value, lat,
+                num_iter, &srv_stats);
+        if (err != BPM_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:rpc_latency_bench]: %s set failed: %s\n",
+                    func_name, bpm_client_err_str (err));
+            goto err_bench;
+        }
+        _print_result (csv, func_name, "set", busy_polls [m], lat, num_iter,
+                &srv_stats);
+    }
+
+err_bench:
+    free (lat);
+err_lat_alloc:
+err_func_translate:
+err_bpm_client_new:
+    free (busy_poll_str);
+    busy_poll_str = NULL;
+    free (num_iter_str);
+    num_iter_str = NULL;
+    free (func_name);
+    func_name = NULL;
+    free (smio_name);
+    smio_name = NULL;
+    free (board_number_str);
+    board_number_str = NULL;
+    free (bpm_number_str);
+    bpm_number_str = NULL;
+    free (broker_endp);
+    broker_endp = NULL;
+    bpm_client_destroy (&bpm_client);
+
+    return 0;
+}
@@ -0,0 +1,608 @@
+/*
+ *  * Replay of a request trace recorded by an SMIO (see the dev_io_trace
+ *   * section of the configuration file), re-issuing the same requests, from
+ *    * as many clients as sent them, at the original pace or faster
+ *     */
+
+#include <getopt.h>
+#include <czmq.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <bpm_client.h>
+
+#define DFLT_BIND_FOLDER            "/tmp/bpm"
+
+#define DFLT_SPEED                  1.0
+#define DFLT_WINDOW                 256
+#define DFLT_TIMEOUT                5000        /* in ms */
+
+/* Original senders beyond this share the clients */
+#define MAX_CLIENTS                 64
+/* Requests waiting for a reply, at most */
+#define MAX_WINDOW                  4096
+/* Opcodes of the SMIOs are below this. The ones above are counted together */
+#define MAX_OPCODES                 256
+/* Initial number of latencies stored per opcode */
+#define LAT_INITIAL_SIZE            1024
+/* Replies of these subjects are not parsed for the reply code */
+#define PACKED_SUBJECT_PREFIX       "RW_PACKED"
+/* Reply code of the requests served, RW_OK on the server side */
+#define REPLY_OK                    0
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"verbose",             no_argument,         NULL, 'v'},
+    {"tracefile",           required_argument,   NULL, 'f'},
+    {"service",             required_argument,   NULL, 'S'},
+    {"speed",               required_argument,   NULL, 'r'},
+    {"window",              required_argument,   NULL, 'w'},
+    {"timeout",             required_argument,   NULL, 'T'},
+    {"csv",                 no_argument,         NULL, 'x'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:vf:S:r:w:T:x";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM Request Trace Replay\n"
+            "Usage: %s [options]\n"
+            "\n"
+            "Each sender in the trace gets a client of its own (up to %u), so the\n"
+            "fair queueing of the server sees the same senders. Requests recorded\n"
+            "from the local fast path are sent through the broker.\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint\n"
+            "  -v  --verbose                        Verbose output\n"
+            "  -f  --tracefile <Trace file>         Trace to replay\n"
+            "  -S  --service <Service name>         Service to send the requests to\n"
+            "                                       (default: the one traced)\n"
+            "  -r  --speed <Speed factor>           Pace, relative to the original one.\n"
+            "                                       0 sends as fast as the window lets\n"
+            "                                       (default: 1)\n"
+            "  -w  --window <Requests>              Requests waiting for a reply, at most\n"
+            "                                       (default: %u)\n"
+            "  -T  --timeout <Timeout>              Time to wait for any reply, in ms\n"
+            "  -x  --csv                            Machine-readable (CSV) output\n",
+            program_name, MAX_CLIENTS, DFLT_WINDOW);
+}
+
+/* Latencies of one opcode, in us */
+typedef struct {
+    int64_t *lat;
+    size_t num_lat;
+    size_t size;
+    uint64_t num_errors;
+} op_result_t;
+
+/* Request waiting for its reply */
+typedef struct {
+    bool busy;
+    uint64_t seq;                   /* Also the tracker */
+    uint32_t opcode;
+    bool packed;                    /* Reply can't be checked */
+    int64_t sent_us;
+} pending_t;
+
+typedef struct {
+    mlm_client_t *clients [MAX_CLIENTS];
+    uint32_t num_clients;
+    uint32_t next_shared;           /* Next client shared by extra senders */
+    zhashx_t *senders;              /* Original sender to one of "clients" */
+    zpoller_t *poller;
+    char *broker_endp;
+    pending_t pending [MAX_WINDOW];
+    uint32_t window;
+    uint32_t in_flight;
+    op_result_t results [MAX_OPCODES + 1];
+    uint64_t num_sent;
+    uint64_t num_replies;
+    uint64_t num_unknown;           /* Replies to no request of ours */
+} replay_t;
+
+static int _cmp_int64 (const void *a, const void *b)
+{
+    int64_t va = *(const int64_t *) a;
+    int64_t vb = *(const int64_t *) b;
+    return (va > vb) - (va < vb);
+}
+
+static void _result_add (op_result_t *result, int64_t lat, bool ok)
+{
+    if (!ok) {
+        result->num_errors++;
+        return;
+    }
+
+    if (result->num_lat == result->size) {
+        size_t size = (result->size == 0) ? LAT_INITIAL_SIZE : result->size * 2;
+        int64_t *new_lat = (int64_t *) realloc (result->lat, size * sizeof (*new_lat));
+        if (new_lat == NULL) {
+            /* Not counted, but we go on */
+            return;
+        }
+        result->lat = new_lat;
+        result->size = size;
+    }
+
+    result->lat [result->num_lat++] = lat;
+}
+
+/* Read the next record of "trace" and the bytes following it into "*body",
+ * growing it as needed. Returns 1 at the end of the trace, -1 on error */
+static int _trace_next (FILE *trace, smio_trace_rec_t *rec, uint8_t **body,
+        size_t *body_size)
+{
+    size_t rc = fread (rec, 1, sizeof (*rec), trace);
+    if (rc == 0 && feof (trace)) {
+        return 1;
+    }
+    if (rc != sizeof (*rec)) {
+        return -1;
+    }
+
+    if (rec->size > *body_size) {
+        uint8_t *new_body = (uint8_t *) realloc (*body, rec->size);
+        if (new_body == NULL) {
+            return -1;
+        }
+        *body = new_body;
+        *body_size = rec->size;
+    }
+
+    return (fread (*body, 1, rec->size, trace) == rec->size) ? 0 : -1;
+}
+
+/* Build the request of "rec" and its "body", copying its subject to
+ * "subject". Returns NULL if the record is malformed */
+static zmsg_t *_trace_msg (const smio_trace_rec_t *rec, const uint8_t *body,
+        char *subject, size_t subject_size)
+{
+    size_t offs = rec->sender_len;
+    if (offs + rec->subject_len > rec->size || rec->subject_len >= subject_size) {
+        return NULL;
+    }
+    memcpy (subject, body + offs, rec->subject_len);
+    subject [rec->subject_len] = '\0';
+    offs += rec->subject_len;
+
+    zmsg_t *msg = zmsg_new ();
+    if (msg == NULL) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < rec->num_frames; ++i) {
+        uint32_t frame_size = 0;
+        if (offs + sizeof (frame_size) > rec->size) {
+            goto err_malformed;
+        }
+        memcpy (&frame_size, body + offs, sizeof (frame_size));
+        offs += sizeof (frame_size);
+        if (offs + frame_size > rec->size ||
+                zmsg_addmem (msg, body + offs, frame_size) != 0) {
+            goto err_malformed;
+        }
+        offs += frame_size;
+    }
+
+    return msg;
+
+err_malformed:
+    zmsg_destroy (&msg);
+    return NULL;
+}
+
+/* Client replaying the requests of "sender", created on its first request */
+static mlm_client_t *_replay_client (replay_t *self, const char *sender)
+{
+    mlm_client_t *client = (mlm_client_t *) zhashx_lookup (self->senders, sender);
+    if (client != NULL) {
+        return client;
+    }
+
+    if (self->num_clients < MAX_CLIENTS) {
+        client = mlm_client_new ();
+        if (client == NULL) {
+            return NULL;
+        }
+
+        char address [64];
+        snprintf (address, sizeof (address), "rpc_replay-%d-%u", (int) getpid (),
+                self->num_clients);
+        if (mlm_client_connect (client, self->broker_endp, 5000, address) < 0 ||
+                zpoller_add (self->poller, mlm_client_msgpipe (client)) != 0) {
+            fprintf (stderr, "[client:rpc_replay]: Could not connect to %s\n",
+                    self->broker_endp);
+            mlm_client_destroy (&client);
+            return NULL;
+        }
+        self->clients [self->num_clients++] = client;
+    }
+    else {
+        client = self->clients [self->next_shared++ % MAX_CLIENTS];
+    }
+
+    zhashx_insert (self->senders, sender, client);
+    return client;
+}
+
+/* Take the replies received so far, waiting up to "timeout" ms for the
+ * first one. Returns the number of replies taken, -1 if interrupted */
+static int _replay_recv (replay_t *self, int timeout)
+{
+    int num_replies = 0;
+    void *which = zpoller_wait (self->poller, timeout);
+    while (which != NULL) {
+        mlm_client_t *client = NULL;
+        for (uint32_t i = 0; i < self->num_clients && client == NULL; ++i) {
+            if (mlm_client_msgpipe (self->clients [i]) == which) {
+                client = self->clients [i];
+            }
+        }
+
+        zmsg_t *reply = (client != NULL) ? mlm_client_recv (client) : NULL;
+        if (reply == NULL) {
+            return -1;
+        }
+
+        int64_t now_us = zclock_usecs ();
+        const char *tracker = mlm_client_tracker (client);
+        uint64_t seq = (tracker != NULL) ? strtoull (tracker, NULL, 10) : 0;
+        pending_t *pending = &self->pending [seq % MAX_WINDOW];
+        if (tracker == NULL || !pending->busy || pending->seq != seq) {
+            self->num_unknown++;
+        }
+        else {
+            /* Failed requests reply with the error code alone */
+            zframe_t *code = zmsg_first (reply);
+            uint32_t reply_code = REPLY_OK;
+            if (!pending->packed && code != NULL &&
+                    zframe_size (code) == sizeof (reply_code)) {
+                memcpy (&reply_code, zframe_data (code), sizeof (reply_code));
+            }
+
+            uint32_t slot = (pending->opcode < MAX_OPCODES) ?
+                pending->opcode : MAX_OPCODES;
+            _result_add (&self->results [slot], now_us - pending->sent_us,
+                    reply_code == REPLY_OK);
+            pending->busy = false;
+            self->in_flight--;
+            self->num_replies++;
+        }
+        zmsg_destroy (&reply);
+        num_replies++;
+
+        which = zpoller_wait (self->poller, 0);
+    }
+
+    return zpoller_terminated (self->poller) ? -1 : num_replies;
+}
+
+/* Send "*msg_p" of "rec" to "service", as "sender" did */
+static int _replay_send (replay_t *self, const char *service,
+        const smio_trace_rec_t *rec, const char *sender, const char *subject,
+        zmsg_t **msg_p)
+{
+    mlm_client_t *client = _replay_client (self, sender);
+    if (client == NULL) {
+        zmsg_destroy (msg_p);
+        return -1;
+    }
+
+    uint64_t seq = self->num_sent++;
+    pending_t *pending = &self->pending [seq % MAX_WINDOW];
+    /* The slot was taken MAX_WINDOW requests ago and got no reply since,
+     * so that one is given up on */
+    if (pending->busy) {
+        uint32_t slot = (pending->opcode < MAX_OPCODES) ?
+            pending->opcode : MAX_OPCODES;
+        _result_add (&self->results [slot], 0, false);
+        self->in_flight--;
+    }
+    *pending = (pending_t) {
+        .busy = true,
+        .seq = seq,
+        .opcode = rec->opcode,
+        .packed = strncmp (subject, PACKED_SUBJECT_PREFIX,
+                strlen (PACKED_SUBJECT_PREFIX)) == 0,
+        .sent_us = zclock_usecs ()
+    };
+    self->in_flight++;
+
+    char tracker [32];
+    snprintf (tracker, sizeof (tracker), "%"PRIu64, seq);
+    return mlm_client_sendto (client, service, subject, tracker, 0, msg_p);
+}
+
+static void _print_results (replay_t *self, int csv, double duration_s,
+        double orig_duration_s, int64_t max_lag_us, double avg_lag_us)
+{
+    if (csv) {
+        fprintf (stdout, "bench,opcode,requests,errors,avg_us,p50_us,p99_us,max_us\n");
+    }
+    else {
+        fprintf (stdout, "%-8s %10s %8s %10s %10s %10s %10s\n", "opcode",
+                "requests", "errors", "avg (us)", "p50 (us)", "p99 (us)", "max (us)");
+    }
+
+    for (uint32_t op = 0; op <= MAX_OPCODES; ++op) {
+        op_result_t *result = &self->results [op];
+        if (result->num_lat == 0 && result->num_errors == 0) {
+            continue;
+        }
+
+        char opcode [16];
+        snprintf (opcode, sizeof (opcode), (op < MAX_OPCODES) ? "%u" : "other", op);
+        int64_t total = 0, p50 = 0, p99 = 0, max = 0;
+        if (result->num_lat > 0) {
+            qsort (result->lat, result->num_lat, sizeof (*result->lat), _cmp_int64);
+            for (size_t i = 0; i < result->num_lat; ++i) {
+                total += result->lat [i];
+            }
+            p50 = result->lat [result->num_lat / 2];
+            p99 = result->lat [(uint64_t) result->num_lat * 99 / 100];
+            max = result->lat [result->num_lat - 1];
+        }
+        double avg = (result->num_lat > 0) ? (double) total / result->num_lat : 0;
+
+        if (csv) {
+            fprintf (stdout, "rpc_replay,%s,%zu,%"PRIu64",%.3f,%"PRId64",%"PRId64
+                    ",%"PRId64"\n", opcode, result->num_lat, result->num_errors,
+                    avg, p50, p99, max);
+        }
+        else {
+            fprintf (stdout, "%-8s %10zu %8"PRIu64" %10.3f %10"PRId64" %10"PRId64
+                    " %10"PRId64"\n", opcode, result->num_lat, result->num_errors,
+                    avg, p50, p99, max);
+        }
+    }
+
+    /* A lag close to the request intervals means the replay did not keep
+     * the pace, e.g., for a window too small */
+    fprintf (csv ? stderr : stdout, "\n%"PRIu64" requests sent from %u clients "
+            "in %.3f s (%.3f s traced), %"PRIu64" replied, %"PRIu64" unknown "
+            "replies\nSend lag behind the trace: avg %.3f us, max %"PRId64" us\n",
+            self->num_sent, self->num_clients, duration_s, orig_duration_s,
+            self->num_replies, self->num_unknown, avg_lag_us, max_lag_us);
+}
+
+int main (int argc, char *argv [])
+{
+    int verbose = 0;
+    int csv = 0;
+    char *broker_endp = NULL;
+    char *trace_file = NULL;
+    char *service = NULL;
+    char *speed_str = NULL;
+    char *window_str = NULL;
+    char *timeout_str = NULL;
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'f':
+                trace_file = strdup (optarg);
+                break;
+
+            case 'S':
+                service = strdup (optarg);
+                break;
+
+            case 'r':
+                speed_str = strdup (optarg);
+                break;
+
+            case 'w':
+                window_str = strdup (optarg);
+                break;
+
+            case 'T':
+                timeout_str = strdup (optarg);
+                break;
+
+            case 'x':
+                csv = 1;
+                break;
+
+            case '?':
+                fprintf (stderr, "[client:rpc_replay] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                fprintf (stderr, "[client:rpc_replay] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+         }
+    }
+
+    if (trace_file == NULL) {
+        fprintf (stderr, "[client:rpc_replay]: No trace file given\n");
+        print_help (argv [0]);
+        exit (1);
+    }
+
+    /* Set default broker address */
+    if (broker_endp == NULL) {
+        fprintf (stderr, "[client:rpc_replay]: Setting default broker endpoint: %s\n",
+                "ipc://"DFLT_BIND_FOLDER);
+        broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    double speed = (speed_str == NULL) ? DFLT_SPEED : strtod (speed_str, NULL);
+    speed = (speed < 0) ? 0 : speed;
+    uint32_t window = (window_str == NULL) ? DFLT_WINDOW :
+        strtoul (window_str, NULL, 10);
+    window = (window == 0) ? 1 : window;
+    window = (window > MAX_WINDOW) ? MAX_WINDOW : window;
+    int timeout = (timeout_str == NULL) ? DFLT_TIMEOUT :
+        (int) strtol (timeout_str, NULL, 10);
+
+    int err = 1;
+    uint8_t *body = NULL;
+    size_t body_size = 0;
+    replay_t *replay = NULL;
+    FILE *trace = fopen (trace_file, "rb");
+    if (trace == NULL) {
+        fprintf (stderr, "[client:rpc_replay]: Could not open %s\n", trace_file);
+        goto err_trace_open;
+    }
+
+    smio_trace_file_hdr_t hdr;
+    if (fread (&hdr, 1, sizeof (hdr), trace) != sizeof (hdr) ||
+            hdr.magic != SMIO_TRACE_MAGIC || hdr.version != SMIO_TRACE_VERSION) {
+        fprintf (stderr, "[client:rpc_replay]: %s is not a request trace\n",
+                trace_file);
+        goto err_trace_hdr;
+    }
+    hdr.service [sizeof (hdr.service) - 1] = '\0';
+    if (service == NULL) {
+        service = strdup (hdr.service);
+    }
+
+    replay = (replay_t *) zmalloc (sizeof *replay);
+    if (replay == NULL) {
+        goto err_replay_alloc;
+    }
+    replay->broker_endp = broker_endp;
+    replay->window = window;
+    replay->senders = zhashx_new ();
+    replay->poller = zpoller_new (NULL);
+    if (replay->senders == NULL || replay->poller == NULL) {
+        fprintf (stderr, "[client:rpc_replay]: Could not allocate clients\n");
+        goto err_replay_init;
+    }
+
+    if (verbose) {
+        fprintf (stderr, "[client:rpc_replay]: Replaying the requests to %s "
+                "traced on %s, at %.3fx\n", hdr.service, service, speed);
+    }
+
+    smio_trace_rec_t rec;
+    char subject [256];
+    int64_t start_us = zclock_usecs ();
+    int64_t max_lag_us = 0, total_lag_us = 0;
+    uint64_t last_timestamp = 0;
+    int rc = 0;
+    while (!zsys_interrupted &&
+            (rc = _trace_next (trace, &rec, &body, &body_size)) == 0) {
+        last_timestamp = rec.timestamp;
+        int64_t due_us = (speed > 0) ?
+            start_us + (int64_t) (rec.timestamp / 1000 / speed) : 0;
+
+        /* Wait for the request to be due and for room in the window,
+         * taking the replies meanwhile. Short waits are spun */
+        int64_t wait_start_us = zclock_usecs ();
+        int64_t now_us = wait_start_us;
+        while (now_us < due_us || replay->in_flight >= replay->window) {
+            int poll_ms = (replay->in_flight >= replay->window) ? timeout :
+                (int) ((due_us - now_us) / 1000);
+            int num_replies = _replay_recv (replay, poll_ms);
+            if (num_replies < 0) {
+                goto err_interrupted;
+            }
+            now_us = zclock_usecs ();
+            if (num_replies == 0 && replay->in_flight >= replay->window &&
+                    now_us - wait_start_us >= (int64_t) timeout * 1000) {
+                fprintf (stderr, "[client:rpc_replay]: No replies from %s for "
+                        "%d ms. Giving up\n", service, timeout);
+                goto err_no_replies;
+            }
+        }
+
+        if (due_us != 0) {
+            int64_t lag_us = now_us - due_us;
+            max_lag_us = (lag_us > max_lag_us) ? lag_us : max_lag_us;
+            total_lag_us += lag_us;
+        }
+
+        char *sender = strndup ((const char *) body, rec.sender_len);
+        zmsg_t *msg = _trace_msg (&rec, body, subject, sizeof (subject));
+        if (sender == NULL || msg == NULL) {
+            fprintf (stderr, "[client:rpc_replay]: Malformed record %"PRIu64
+                    " in %s\n", replay->num_sent, trace_file);
+            free (sender);
+            zmsg_destroy (&msg);
+            goto err_trace_rec;
+        }
+
+        rc = _replay_send (replay, service, &rec, sender, subject, &msg);
+        free (sender);
+        if (rc != 0) {
+            fprintf (stderr, "[client:rpc_replay]: Could not send request %"PRIu64
+                    "\n", replay->num_sent);
+            zmsg_destroy (&msg);
+            goto err_send;
+        }
+    }
+
+    if (rc < 0) {
+        fprintf (stderr, "[client:rpc_replay]: Trace %s is truncated. Replaying "
+                "up to there\n", trace_file);
+    }
+
+    /* Whatever is not replied to by now won't be */
+    while (replay->in_flight > 0 && !zsys_interrupted) {
+        int num_replies = _replay_recv (replay, timeout);
+        if (num_replies <= 0) {
+            break;
+        }
+    }
+
+    double duration_s = (zclock_usecs () - start_us) / 1e6;
+    _print_results (replay, csv, duration_s, last_timestamp / 1e9, max_lag_us,
+            (replay->num_sent > 0 && speed > 0) ?
+            (double) total_lag_us / replay->num_sent : 0);
+    err = (replay->in_flight > 0) ? 1 : 0;
+
+err_send:
+err_trace_rec:
+err_no_replies:
+err_interrupted:
+err_replay_init:
+    if (replay != NULL) {
+        for (uint32_t i = 0; i < replay->num_clients; ++i) {
+            mlm_client_destroy (&replay->clients [i]);
+        }
+        for (uint32_t op = 0; op <= MAX_OPCODES; ++op) {
+            free (replay->results [op].lat);
+        }
+        zpoller_destroy (&replay->poller);
+        zhashx_destroy (&replay->senders);
+        free (replay);
+    }
+err_replay_alloc:
+err_trace_hdr:
+    free (body);
+    fclose (trace);
+err_trace_open:
+    free (timeout_str);
+    free (window_str);
+    free (speed_str);
+    free (service);
+    free (trace_file);
+    free (broker_endp);
+    return err;
+}
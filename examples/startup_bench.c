@@ -0,0 +1,261 @@
+/*
+ *  * Startup time breakdown of the SMIOs of a DEVIO. Waits for each SMIO to
+ *   * be up and reports where its startup time went
+ *    */
+
+#include <getopt.h>
+#include <czmq.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bpm_client.h>
+
+#define DFLT_BIND_FOLDER            "/tmp/bpm"
+
+#define DFLT_SMIO_LIST              "ACQ,DSP,SWAP"
+#define DFLT_BPM_NUMBER             0
+#define MAX_BPM_NUMBER              1
+#define DFLT_BOARD_NUMBER           0
+#define DFLT_WAIT                   30          /* in s */
+
+/* Each try waits this long for the SMIO to answer */
+#define TRY_TIMEOUT                 200         /* in ms */
+#define TRY_INTERVAL                50          /* in ms */
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"verbose",             no_argument,         NULL, 'v'},
+    {"bpmnumber",           required_argument,   NULL, 's'},
+    {"boardslot",           required_argument,   NULL, 'o'},
+    {"smios",               required_argument,   NULL, 'm'},
+    {"wait",                required_argument,   NULL, 'w'},
+    {"csv",                 no_argument,         NULL, 'x'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:vo:s:m:w:x";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM SMIO Startup Time Benchmark\n"
+            "Usage: %s [options]\n"
+            "\n"
+            "Meant to be run right after the DEVIO is spawned, see\n"
+            "startup_bench.sh for running it on the simulated (sim) backend.\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint\n"
+            "  -v  --verbose                        Verbose output\n"
+            "  -o  --boardslot <Board slot number = [1-12]> \n"
+            "                                       Board slot number\n"
+            "  -s  --bpmnumber <BPM number = [0|1]> BPM number\n"
+            "  -m  --smios <SMIO name list>         Comma-separated SMIO names, as in\n"
+            "                                       the service names (default: "DFLT_SMIO_LIST")\n"
+            "  -w  --wait <Wait time>               Time to wait for the SMIOs to be up, in s\n"
+            "  -x  --csv                            Machine-readable (CSV) output\n",
+            program_name);
+}
+
+static void _print_header (int csv)
+{
+    if (csv) {
+        fprintf (stdout, "bench,smio,wait_ms,spawn_us,boot_us,connect_us,"
+                "init_us,snapshot_us,export_us,dir_us,config_us,up_us\n");
+    }
+    else {
+        fprintf (stdout, "%-14s %8s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+                "smio", "wait(ms)", "spawn", "boot", "connect", "init",
+                "snapshot", "export", "dir", "config", "up (us)");
+    }
+}
+
+static void _print_result (int csv, const char *smio, int64_t wait_ms,
+        const smio_startup_stats_t *stats)
+{
+    if (csv) {
+        fprintf (stdout, "startup,%s,%"PRId64",%"PRIu64",%"PRIu64",%"PRIu64
+                ",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+                smio, wait_ms, stats->spawn_us, stats->boot_us,
+                stats->connect_us, stats->init_us, stats->snapshot_us,
+                stats->export_us, stats->dir_us, stats->config_us, stats->up_us);
+    }
+    else {
+        fprintf (stdout, "%-14s %8"PRId64" %10"PRIu64" %10"PRIu64" %10"PRIu64
+                " %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64
+                " %10"PRIu64"\n", smio, wait_ms, stats->spawn_us, stats->boot_us,
+                stats->connect_us, stats->init_us, stats->snapshot_us,
+                stats->export_us, stats->dir_us, stats->config_us, stats->up_us);
+    }
+}
+
+/* Wait up to "deadline" (zclock_mono ()) for the SMIO to be up, i.e.,
+ * configured */
+static bpm_client_err_e _wait_up (bpm_client_t *bpm_client, char *service,
+        int64_t deadline, smio_startup_stats_t *stats)
+{
+    bpm_client_err_e err = BPM_CLIENT_ERR_TIMEOUT;
+
+    while (!zsys_interrupted && zclock_mono () < deadline) {
+        err = bpm_get_startup_stats (bpm_client, service, stats);
+        if (err == BPM_CLIENT_SUCCESS && stats->up_us != 0) {
+            return err;
+        }
+        zclock_sleep (TRY_INTERVAL);
+    }
+
+    return (err == BPM_CLIENT_SUCCESS) ? BPM_CLIENT_ERR_TIMEOUT : err;
+}
+
+int main (int argc, char *argv [])
+{
+    int verbose = 0;
+    int csv = 0;
+    int ret = 1;
+    char *broker_endp = NULL;
+    char *board_number_str = NULL;
+    char *bpm_number_str = NULL;
+    char *smio_list_str = NULL;
+    char *wait_str = NULL;
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'o':
+                board_number_str = strdup (optarg);
+                break;
+
+            case 's':
+                bpm_number_str = strdup (optarg);
+                break;
+
+            case 'm':
+                smio_list_str = strdup (optarg);
+                break;
+
+            case 'w':
+                wait_str = strdup (optarg);
+                break;
+
+            case 'x':
+                csv = 1;
+                break;
+
+            case '?':
+                fprintf (stderr, "[client:startup_bench] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                fprintf (stderr, "[client:startup_bench] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+         }
+    }
+
+    /* Set default broker address */
+    if (broker_endp == NULL) {
+        fprintf (stderr, "[client:startup_bench]: Setting default broker endpoint: %s\n",
+                "ipc://"DFLT_BIND_FOLDER);
+        broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    if (smio_list_str == NULL) {
+        smio_list_str = strdup (DFLT_SMIO_LIST);
+    }
+
+    uint32_t wait = (wait_str == NULL) ? DFLT_WAIT : strtoul (wait_str, NULL, 10);
+
+    /* Set default board number */
+    uint32_t board_number;
+    if (board_number_str == NULL) {
+        fprintf (stderr, "[client:startup_bench]: Setting default value to BOARD number: %u\n",
+                DFLT_BOARD_NUMBER);
+        board_number = DFLT_BOARD_NUMBER;
+    }
+    else {
+        board_number = strtoul (board_number_str, NULL, 10);
+    }
+
+    /* Set default bpm number */
+    uint32_t bpm_number;
+    if (bpm_number_str == NULL) {
+        fprintf (stderr, "[client:startup_bench]: Setting default value to BPM number: %u\n",
+                DFLT_BPM_NUMBER);
+        bpm_number = DFLT_BPM_NUMBER;
+    }
+    else {
+        bpm_number = strtoul (bpm_number_str, NULL, 10);
+
+        if (bpm_number > MAX_BPM_NUMBER) {
+            fprintf (stderr, "[client:startup_bench]: BPM number too big! Defaulting to: %u\n",
+                    MAX_BPM_NUMBER);
+            bpm_number = MAX_BPM_NUMBER;
+        }
+    }
+
+    /* Started along with the DEVIO, so time from now on */
+    int64_t start = zclock_mono ();
+    int64_t deadline = start + (int64_t) wait * 1000;
+    bpm_client_t *bpm_client = bpm_client_new_time (broker_endp, verbose, NULL,
+            TRY_TIMEOUT);
+    if (bpm_client == NULL) {
+        fprintf (stderr, "[client:startup_bench]: bpm_client could be created\n");
+        goto err_bpm_client_new;
+    }
+
+    _print_header (csv);
+
+    ret = 0;
+    char *saveptr = NULL;
+    for (char *smio = strtok_r (smio_list_str, ",", &saveptr); smio != NULL;
+            smio = strtok_r (NULL, ",", &saveptr)) {
+        char service[50];
+        snprintf (service, sizeof (service), "BPM%u:DEVIO:%s%u", board_number,
+                smio, bpm_number);
+
+        smio_startup_stats_t stats;
+        bpm_client_err_e err = _wait_up (bpm_client, service, deadline, &stats);
+        if (err != BPM_CLIENT_SUCCESS) {
+            fprintf (stderr, "[client:startup_bench]: %s is not up: %s\n",
+                    service, bpm_client_err_str (err));
+            ret = 1;
+            continue;
+        }
+
+        _print_result (csv, smio, zclock_mono () - start, &stats);
+    }
+
+err_bpm_client_new:
+    free (wait_str);
+    wait_str = NULL;
+    free (smio_list_str);
+    smio_list_str = NULL;
+    free (board_number_str);
+    board_number_str = NULL;
+    free (bpm_number_str);
+    bpm_number_str = NULL;
+    free (broker_endp);
+    broker_endp = NULL;
+    bpm_client_destroy (&bpm_client);
+
+    return ret;
+}
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Start the server on the simulated (sim) device a number of times and
+# report the startup time breakdown of its SMIOs. Output is CSV, one line
+# per SMIO and round. Usable in CI, as no board is needed
+
+EXPECTED_ARGS=2
+DFLT_ROUNDS=5
+DFLT_WAIT=30                        # in seconds
+DFLT_BROKER_ENDP="ipc:///tmp/bpm"
+
+if [ $# -lt $EXPECTED_ARGS ]
+then
+	echo "Usage: `basename $0` {ebpm binary} {ebpm config file} [rounds] [wait time] [broker endpoint]"
+	exit 1;
+fi
+
+ebpm_bin=$1
+ebpm_cfg=$2
+rounds=${3:-$DFLT_ROUNDS}
+wait_time=${4:-$DFLT_WAIT}
+broker_endp=${5:-$DFLT_BROKER_ENDP}
+
+bench_bin="$(dirname $0)/startup_bench"
+ret=0
+
+for round in $(seq 1 $rounds)
+do
+    "$ebpm_bin" -f "$ebpm_cfg" -n be -t sim -e sim0 -i 0 -b "$broker_endp" &
+    ebpm_pid=$!
+
+    # Only the first round prints the CSV header
+    "$bench_bin" -b "$broker_endp" -o 0 -s 0 -w "$wait_time" -x 2>/dev/null | \
+        if [ $round -eq 1 ]; then cat; else tail -n +2; fi
+    if [ ${PIPESTATUS[0]} -ne 0 ]
+    then
+        echo "`basename $0`: round $round: not every SMIO came up" >&2
+        ret=1
+    fi
+
+    kill $ebpm_pid
+    wait $ebpm_pid 2>/dev/null
+done
+
+exit $ret
@@ -0,0 +1,483 @@
+/*
+ *  * Benchmark of the software trigger to data latency: time from
+ *   * bpm_set_acq_sw_trig to the acquisition completion being seen and to
+ *    * the first and last blocks of the curve being read
+ *     */
+
+#include <getopt.h>
+#include <czmq.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <bpm_client.h>
+
+#define DFLT_BIND_FOLDER            "/tmp/bpm"
+
+#define DFLT_NUM_SAMPLES            4096
+#define DFLT_CHAN_NUM               0
+#define DFLT_NUM_ITER               1000
+#define DFLT_BLOCK_SIZE             (1 << 16)
+#define DFLT_TIMEOUT                5000        /* in ms */
+
+#define DFLT_BPM_NUMBER             0
+#define MAX_BPM_NUMBER              1
+
+#define DFLT_BOARD_NUMBER           0
+
+#define MIN_NUM_SAMPLES             4
+/* Arbitrary hard limits */
+#define MAX_NUM_SAMPLES             (1 << 28)
+
+/* Trigger types, see acq_trig */
+#define ACQ_TRIG_SKIP               0
+#define ACQ_TRIG_SW                 3
+
+/* Histogram buckets are powers of 2 of us: bucket i holds [2^(i-1), 2^i) */
+#define HIST_NUM_BUCKETS            32
+
+/* Stages, all of them timed from the software trigger request */
+typedef enum {
+    STAGE_TRIG = 0,                 /* bpm_set_acq_sw_trig returned */
+    STAGE_DONE,                     /* Acquisition completion seen */
+    STAGE_FIRST_BLOCK,              /* First block of the curve read */
+    STAGE_LAST_BLOCK,               /* Whole curve read */
+    STAGE_END
+} stage_e;
+
+static const char *stage_names [STAGE_END] = {
+    "trig", "done", "first_block", "last_block"
+};
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"verbose",             no_argument,         NULL, 'v'},
+    {"bpmnumber",           required_argument,   NULL, 's'},
+    {"boardslot",           required_argument,   NULL, 'o'},
+    {"channumber",          required_argument,   NULL, 'c'},
+    {"numsamples",          required_argument,   NULL, 'n'},
+    {"iterations",          required_argument,   NULL, 'i'},
+    {"blocksize",           required_argument,   NULL, 'k'},
+    {"csv",                 no_argument,         NULL, 'x'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:vo:s:c:n:i:k:x";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM Software Trigger to Data Latency Benchmark\n"
+            "Usage: %s [options]\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint\n"
+            "  -v  --verbose                        Verbose output\n"
+            "  -o  --boardslot <Board slot number = [1-12]> \n"
+            "                                       Board slot number\n"
+            "  -s  --bpmnumber <BPM number = [0|1]> BPM number\n"
+            "  -c  --channumber <Channel>           Acquisition channel\n"
+            "  -n  --numsamples <Number of samples> Pre and post-trigger samples each\n"
+            "  -i  --iterations <Number of iterations>\n"
+            "                                       Triggers to time\n"
+            "  -k  --blocksize <Block size>         Curve block size, in bytes. Power of 2\n"
+            "                                       not larger than the server maximum\n"
+            "  -x  --csv                            Machine-readable (CSV) output\n",
+            program_name);
+}
+
+static int _cmp_int64 (const void *a, const void *b)
+{
+    int64_t va = *(const int64_t *) a;
+    int64_t vb = *(const int64_t *) b;
+    return (va > vb) - (va < vb);
+}
+
+static uint32_t _hist_bucket (int64_t lat)
+{
+    uint32_t bucket = 0;
+    while (lat > 0 && bucket < HIST_NUM_BUCKETS-1) {
+        lat >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+/* Latencies are sorted in place */
+static void _print_result (int csv, const char *stage, int64_t *lat,
+        uint32_t num_iter)
+{
+    qsort (lat, num_iter, sizeof (*lat), _cmp_int64);
+
+    int64_t total = 0;
+    for (uint32_t i = 0; i < num_iter; i++) {
+        total += lat [i];
+    }
+
+    double avg = (double) total / num_iter;
+    int64_t p50 = lat [num_iter / 2];
+    int64_t p99 = lat [(uint64_t) num_iter * 99 / 100];
+    int64_t p999 = lat [(uint64_t) num_iter * 999 / 1000];
+
+    if (csv) {
+        fprintf (stdout, "trig_latency,%s,%u,%"PRId64",%.3f,%"PRId64",%"PRId64
+                ",%"PRId64",%"PRId64"\n", stage, num_iter, lat [0], avg,
+                p50, p99, p999, lat [num_iter-1]);
+    }
+    else {
+        fprintf (stdout, "%-12s %8u %10"PRId64" %10.3f %10"PRId64" %10"PRId64
+                " %10"PRId64" %10"PRId64"\n", stage, num_iter, lat [0], avg,
+                p50, p99, p999, lat [num_iter-1]);
+    }
+}
+
+/* Latencies must be sorted */
+static void _print_hist (int csv, const char *stage, const int64_t *lat,
+        uint32_t num_iter)
+{
+    uint32_t hist [HIST_NUM_BUCKETS] = {0};
+    for (uint32_t i = 0; i < num_iter; i++) {
+        ++hist [_hist_bucket (lat [i])];
+    }
+
+    if (!csv) {
+        fprintf (stdout, "\n%s:\n", stage);
+    }
+
+    for (uint32_t i = 0; i < HIST_NUM_BUCKETS; i++) {
+        if (hist [i] == 0) {
+            continue;
+        }
+
+        uint64_t lo = (i == 0) ? 0 : (1ULL << (i-1));
+        uint64_t hi = 1ULL << i;
+        if (csv) {
+            fprintf (stdout, "trig_latency_hist,%s,%"PRIu64",%"PRIu64",%u\n",
+                    stage, lo, hi, hist [i]);
+        }
+        else {
+            /* Bars are scaled to 50 columns */
+            uint32_t bar = (uint32_t) ((uint64_t) hist [i] * 50 / num_iter);
+            fprintf (stdout, "  [%9"PRIu64", %9"PRIu64") us %8u %.*s\n", lo, hi,
+                    hist [i], bar, "##################################################");
+        }
+    }
+}
+
+int main (int argc, char *argv [])
+{
+    int verbose = 0;
+    int csv = 0;
+    int ret = 1;
+    char *broker_endp = NULL;
+    char *board_number_str = NULL;
+    char *bpm_number_str = NULL;
+    char *chan_str = NULL;
+    char *num_samples_str = NULL;
+    char *num_iter_str = NULL;
+    char *block_size_str = NULL;
+    int opt;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'v':
+                verbose = 1;
+                break;
+
+            case 'o':
+                board_number_str = strdup (optarg);
+                break;
+
+            case 's':
+                bpm_number_str = strdup (optarg);
+                break;
+
+            case 'c':
+                chan_str = strdup (optarg);
+                break;
+
+            case 'n':
+                num_samples_str = strdup (optarg);
+                break;
+
+            case 'i':
+                num_iter_str = strdup (optarg);
+                break;
+
+            case 'k':
+                block_size_str = strdup (optarg);
+                break;
+
+            case 'x':
+                csv = 1;
+                break;
+
+            case '?':
+                fprintf (stderr, "[client:trig_latency_bench] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                fprintf (stderr, "[client:trig_latency_bench] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+         }
+    }
+
+    /* Set default broker address */
+    if (broker_endp == NULL) {
+        fprintf (stderr, "[client:trig_latency_bench]: Setting default broker endpoint: %s\n",
+                "ipc://"DFLT_BIND_FOLDER);
+        broker_endp = strdup ("ipc://"DFLT_BIND_FOLDER);
+    }
+
+    /* Set default number samples */
+    uint32_t num_samples;
+    if (num_samples_str == NULL) {
+        fprintf (stderr, "[client:trig_latency_bench]: Setting default value to number of samples: %u\n",
+                DFLT_NUM_SAMPLES);
+        num_samples = DFLT_NUM_SAMPLES;
+    }
+    else {
+        num_samples = strtoul (num_samples_str, NULL, 10);
+
+        if (num_samples < MIN_NUM_SAMPLES) {
+            fprintf (stderr, "[client:trig_latency_bench]: Number of samples too small! Defaulting to: %u\n",
+                    MIN_NUM_SAMPLES);
+            num_samples = MIN_NUM_SAMPLES;
+        }
+        else if (num_samples > MAX_NUM_SAMPLES) {
+            fprintf (stderr, "[client:trig_latency_bench]: Number of samples too big! Defaulting to: %u\n",
+                    MAX_NUM_SAMPLES);
+            num_samples = MAX_NUM_SAMPLES;
+        }
+    }
+
+    /* Set default channel */
+    uint32_t chan;
+    if (chan_str == NULL) {
+        fprintf (stderr, "[client:trig_latency_bench]: Setting default value to 'chan'\n");
+        chan = DFLT_CHAN_NUM;
+    }
+    else {
+        chan = strtoul (chan_str, NULL, 10);
+
+        if (chan > END_CHAN_ID-1) {
+            fprintf (stderr, "[client:trig_latency_bench]: Channel number too big! Defaulting to: %u\n",
+                    END_CHAN_ID-1);
+            chan = END_CHAN_ID-1;
+        }
+    }
+
+    /* Set default number of iterations */
+    uint32_t num_iter;
+    if (num_iter_str == NULL) {
+        num_iter = DFLT_NUM_ITER;
+    }
+    else {
+        num_iter = strtoul (num_iter_str, NULL, 10);
+        num_iter = (num_iter == 0) ? 1 : num_iter;
+    }
+
+    uint32_t block_size = (block_size_str == NULL) ? DFLT_BLOCK_SIZE :
+        strtoul (block_size_str, NULL, 10);
+
+    /* Set default board number */
+    uint32_t board_number;
+    if (board_number_str == NULL) {
+        fprintf (stderr, "[client:trig_latency_bench]: Setting default value to BOARD number: %u\n",
+                DFLT_BOARD_NUMBER);
+        board_number = DFLT_BOARD_NUMBER;
+    }
+    else {
+        board_number = strtoul (board_number_str, NULL, 10);
+    }
+
+    /* Set default bpm number */
+    uint32_t bpm_number;
+    if (bpm_number_str == NULL) {
+        fprintf (stderr, "[client:trig_latency_bench]: Setting default value to BPM number: %u\n",
+                DFLT_BPM_NUMBER);
+        bpm_number = DFLT_BPM_NUMBER;
+    }
+    else {
+        bpm_number = strtoul (bpm_number_str, NULL, 10);
+
+        if (bpm_number > MAX_BPM_NUMBER) {
+            fprintf (stderr, "[client:trig_latency_bench]: BPM number too big! Defaulting to: %u\n",
+                    MAX_BPM_NUMBER);
+            bpm_number = MAX_BPM_NUMBER;
+        }
+    }
+
+    char service[50];
+    snprintf (service, sizeof (service), "BPM%u:DEVIO:ACQ%u", board_number, bpm_number);
+
+    bpm_client_t *bpm_client = bpm_client_new (broker_endp, verbose, NULL);
+    if (bpm_client == NULL) {
+        fprintf (stderr, "[client:trig_latency_bench]: bpm_client could be created\n");
+        goto err_bpm_client_new;
+    }
+
+    uint32_t acq_trig = ACQ_TRIG_SKIP;
+    bpm_client_err_e err = bpm_get_acq_trig (bpm_client, service, &acq_trig);
+    if (err != BPM_CLIENT_SUCCESS){
+        fprintf (stderr, "[client:trig_latency_bench]: bpm_get_acq_trig failed\n");
+        goto err_bpm_get_acq_trig;
+    }
+
+    err = bpm_set_acq_trig (bpm_client, service, ACQ_TRIG_SW);
+    if (err != BPM_CLIENT_SUCCESS){
+        fprintf (stderr, "[client:trig_latency_bench]: bpm_set_acq_trig failed\n");
+        goto err_bpm_set_acq_trig;
+    }
+
+    uint32_t data_size = 2*num_samples*acq_chan[chan].sample_size;
+    uint32_t *data = (uint32_t *) zmalloc (data_size*sizeof (uint8_t));
+    int64_t *lat [STAGE_END] = {NULL};
+    for (uint32_t i = 0; i < STAGE_END; i++) {
+        lat [i] = (int64_t *) zmalloc (num_iter * sizeof (int64_t));
+        if (lat [i] == NULL) {
+            fprintf (stderr, "[client:trig_latency_bench]: Could not allocate latency buffer\n");
+            goto err_lat_alloc;
+        }
+    }
+
+    acq_trans_t acq_trans = {.req =   {
+                                        .num_samples_pre = num_samples,
+                                        .num_samples_post = num_samples,
+                                        .num_shots = 1,
+                                        .chan = chan,
+                                      },
+                             .block = {
+                                        .data = data,
+                                        .data_size = data_size,
+                                      }
+                            };
+
+    for (uint32_t i = 0; i < num_iter; i++) {
+        if (zsys_interrupted) {
+            goto err_interrupted;
+        }
+
+        /* Arming is not timed, only what comes after the trigger */
+        err = bpm_acq_start (bpm_client, service, &acq_trans.req);
+        if (err != BPM_CLIENT_SUCCESS){
+            fprintf (stderr, "[client:trig_latency_bench]: bpm_acq_start failed: %s\n",
+                    bpm_client_err_str (err));
+            goto err_bpm_acq;
+        }
+
+        int64_t start = zclock_usecs ();
+        err = bpm_set_acq_sw_trig (bpm_client, service, 1);
+        lat [STAGE_TRIG][i] = zclock_usecs () - start;
+        if (err != BPM_CLIENT_SUCCESS){
+            fprintf (stderr, "[client:trig_latency_bench]: bpm_set_acq_sw_trig failed: %s\n",
+                    bpm_client_err_str (err));
+            goto err_bpm_acq;
+        }
+
+        err = bpm_acq_check_timed (bpm_client, service, DFLT_TIMEOUT);
+        lat [STAGE_DONE][i] = zclock_usecs () - start;
+        if (err != BPM_CLIENT_SUCCESS){
+            fprintf (stderr, "[client:trig_latency_bench]: bpm_acq_check_timed failed: %s\n",
+                    bpm_client_err_str (err));
+            goto err_bpm_acq;
+        }
+
+        /* Read the curve block by block, to time the first one */
+        uint32_t bytes_done = 0;
+        uint32_t *block_data = data;
+        for (uint32_t idx = 0; bytes_done < data_size; idx++) {
+            acq_trans.block.idx = idx;
+            acq_trans.block.data = block_data;
+            acq_trans.block.data_size = data_size - bytes_done;
+            err = bpm_acq_get_data_block_sized (bpm_client, service, &acq_trans,
+                    block_size);
+            if (err != BPM_CLIENT_SUCCESS){
+                fprintf (stderr, "[client:trig_latency_bench]: bpm_acq_get_data_block_sized "
+                        "failed for block %u: %s\n", idx, bpm_client_err_str (err));
+                goto err_bpm_acq;
+            }
+
+            if (idx == 0) {
+                lat [STAGE_FIRST_BLOCK][i] = zclock_usecs () - start;
+            }
+
+            /* Short block, this was the last one */
+            bytes_done += acq_trans.block.bytes_read;
+            block_data = (uint32_t *) ((uint8_t *) data + bytes_done);
+            if (acq_trans.block.bytes_read < block_size) {
+                break;
+            }
+        }
+        lat [STAGE_LAST_BLOCK][i] = zclock_usecs () - start;
+
+        acq_trans.block.data = data;
+        acq_trans.block.data_size = data_size;
+    }
+
+    if (csv) {
+        fprintf (stdout, "bench,stage,iterations,min_us,avg_us,p50_us,"
+                "p99_us,p999_us,max_us\n");
+    }
+    else {
+        fprintf (stdout, "%-12s %8s %10s %10s %10s %10s %10s %10s\n",
+                "stage", "iter", "min (us)", "avg (us)", "p50 (us)", "p99 (us)",
+                "p999 (us)", "max (us)");
+    }
+    for (uint32_t i = 0; i < STAGE_END; i++) {
+        _print_result (csv, stage_names [i], lat [i], num_iter);
+    }
+
+    if (csv) {
+        fprintf (stdout, "bench,stage,lo_us,hi_us,count\n");
+    }
+    for (uint32_t i = 0; i < STAGE_END; i++) {
+        _print_hist (csv, stage_names [i], lat [i], num_iter);
+    }
+    ret = 0;
+
+err_bpm_acq:
+err_interrupted:
+err_lat_alloc:
+    for (uint32_t i = 0; i < STAGE_END; i++) {
+        free (lat [i]);
+    }
+    free (data);
+    /* Restore the original configuration */
+    bpm_set_acq_trig (bpm_client, service, acq_trig);
+err_bpm_set_acq_trig:
+err_bpm_get_acq_trig:
+err_bpm_client_new:
+    free (block_size_str);
+    block_size_str = NULL;
+    free (num_iter_str);
+    num_iter_str = NULL;
+    free (chan_str);
+    chan_str = NULL;
+    free (board_number_str);
+    board_number_str = NULL;
+    free (bpm_number_str);
+    bpm_number_str = NULL;
+    free (num_samples_str);
+    num_samples_str = NULL;
+    free (broker_endp);
+    broker_endp = NULL;
+    bpm_client_destroy (&bpm_client);
+
+    return ret;
+}
@@ -39,6 +39,20 @@
 #define MONIT1POS0_CHAN_ID              (MONITPOS0_CHAN_ID + 1)
 #define MONIT1POS0_SAMPLE_SIZE          16 /* 16 Bytes -> X = 32-bit / Y = 32-bit ... */
 
+/* All of the channels above, in channel ID order, for generating the tables
+ * indexed by channel (e.g., the DDR3 map and the client channel table).
+ * X (name) is called with the channel name without its core index, i.e.,
+ * ADC for ADC0_CHAN_ID */
+#define ACQ_CHAN_FOREACH(X)             \
+    X(ADC)                              \
+    X(TBTAMP)                           \
+    X(TBTPOS)                           \
+    X(FOFBAMP)                          \
+    X(FOFBPOS)                          \
+    X(MONITAMP)                         \
+    X(MONITPOS)                         \
+    X(MONIT1POS)
+
 /* End of channels placeholder */
 #define END_CHAN_ID                     (MONIT1POS0_CHAN_ID + 1)
 
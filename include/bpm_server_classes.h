@@ -63,13 +63,23 @@ typedef enum _dmngr_err_e dmngr_err_e;
 typedef struct _devio_info_t devio_info_t;
 /* Opaque dmngr_t class structure */
 typedef struct _dmngr_t dmngr_t;
+/* Opaque dmngr_dir_t class structure */
+typedef struct _dmngr_dir_t dmngr_dir_t;
 
 /* Forward devio_err_e declaration enumeration */
 typedef enum _devio_err_e devio_err_e;
 /* Forward devio_type_e declaration enumeration */
 typedef enum _devio_type_e devio_type_e;
+/* Forward devio_prio_e declaration enumeration */
+typedef enum _devio_prio_e devio_prio_e;
 /* Opaque devio_t structure */
 typedef struct _devio_t devio_t;
+/* Opaque devio_metrics_t structure */
+typedef struct _devio_metrics_t devio_metrics_t;
+/* Opaque devio_metrics_node_t structure */
+typedef struct _devio_metrics_node_t devio_metrics_node_t;
+/* Opaque devio_status_t structure */
+typedef struct _devio_status_t devio_status_t;
 
 /* Forward smpr_err_e declaration enumeration */
 typedef enum _smpr_err_e smpr_err_e;
@@ -105,12 +115,18 @@ typedef enum _msg_err_e msg_err_e;
 typedef struct _exp_msg_zmq_t exp_msg_zmq_t;
 /* Forward zmq_server_args_t declaration structure */
 typedef struct _zmq_server_args_t zmq_server_args_t;
+typedef struct _thsafe_ring_t thsafe_ring_t;
+/* Opaque msg_stats_t structure */
+typedef struct _msg_stats_t msg_stats_t;
+/* Opaque msg_deferred_t structure */
+typedef struct _msg_deferred_t msg_deferred_t;
 
 /* Public API classes */
 
 /* DEV MNGR */
 #include "dev_mngr_err.h"
 #include "dev_mngr_dev_info.h"
+#include "dev_mngr_dir.h"
 #include "dev_mngr_core.h"
 
 /* DEV_IO */
@@ -118,6 +134,8 @@ typedef struct _zmq_server_args_t zmq_server_args_t;
 #include "dev_io_utils.h"
 #include "dev_io_exports.h"
 #include "dev_io_core.h"
+#include "dev_io_metrics.h"
+#include "dev_io_status.h"
 #include "dev_io.h"
 
 /* SM_PR */
@@ -136,6 +154,8 @@ typedef struct _zmq_server_args_t zmq_server_args_t;
 
 /* SM_CH */
 #include "sm_ch_err.h"
+#include "sm_ch_reg_tbl.h"
+#include "sm_ch_shadow.h"
 #include "sm_ch_24aa64.h"
 #include "chips/e24aa64_regs.h"
 #include "sm_ch_ad9510.h"
@@ -158,7 +178,12 @@ typedef struct _zmq_server_args_t zmq_server_args_t;
 #include "sm_io_thsafe_codes.h"
 #include "sm_io_bootstrap.h"
 #include "sm_io_mod_dispatch.h"
+#include "sm_io_cache.h"
+#include "sm_io_tasks.h"
+#include "sm_io_fairq.h"
+#include "sm_io_trace.h"
 #include "sm_io.h"
+#include "sm_io_reactor.h"
 
 /* MSG */
 #include "msg_macros.h"
@@ -169,12 +194,16 @@ typedef struct _zmq_server_args_t zmq_server_args_t;
 /* MSG SMIO THSAFE ops */
 #include "smio_thsafe_zmq_server.h"
 #include "smio_thsafe_zmq_client.h"
+#include "smio_thsafe_ring.h"
+#include "smio_thsafe_direct_client.h"
 /* General MSG */
 #include "thsafe_msg_zmq.h"
 #include "msg.h"
 
 /* Other headers */
 #include "bpm_client.h"
+/* Needs smio_op_stats_t from the client headers */
+#include "msg_stats.h"
 #include "rw_param.h"
 #include "rw_param_codes.h"
 
@@ -29,6 +29,9 @@
 #define E24AA64_BYTE_TRANS_SIZE                             (E24AA64_ADDR_TRANS_SIZE + \
                                                                E24AA64_DATA_TRANS_SIZE) /* in bits */
 
+/* 64 Kbit array, 13-bit addresses */
+#define E24AA64_SIZE                                        8192       /* in bytes */
+
 /* Max of 16 address bytes + 32 data bytes */
 #define E24AA64_PAGE_DATA_BYTES_MAX                         32
 #define E24AA64_PAGE_TRANS_SIZE_MAX                         (E24AA64_ADDR_TRANS_SIZE + \
@@ -7,8 +7,15 @@ typedef struct {
   uint32_t end_addr;
   uint32_t max_samples;
   uint32_t sample_size;
+  /* Start of the second half of the region, for ping-pong acquisitions */
+  uint32_t split_addr;
 } acq_buf_t;
 
+/* Split a region of "mem_size" DDR3 regions into two halves. Regions are
+ * a whole number of DDR3 payloads, so both halves are aligned */
+#define DDR3_SPLIT_ADDR(start_addr, mem_size)                       \
+    ((start_addr) + (mem_size)*(MEM_REGION_SIZE/2))
+
 extern const acq_buf_t __acq_buf[NUM_ACQ_CORE_SMIOS][END_CHAN_ID];
 
 #endif
@@ -14,7 +14,13 @@ extern "C" {
 
 /* SMIO hash key length in chars */
 #define SMIO_HKEY_LEN                   8
-#define NODES_MAX_LEN                   20
+/* Maximum number of reactor threads shared by the SMIOs of a DEVIO */
+#define DEVIO_MAX_SMIO_REACTORS         8
+/* Sent to the DEVIO actor pipe when all of its SMIOs are configured */
+#define DEVIO_READY_STR                 "$READY"
+/* Sent to the DEVIO actor pipe when its SMIOs were handed off to a new
+ * DEVIO, see devio_set_snapshot_dir () */
+#define DEVIO_HANDOFF_STR               "$HANDED_OFF"
 
 /* Node of sig_ops list */
 typedef struct {
@@ -71,8 +77,12 @@ devio_err_e devio_register_sm (void *pipe, uint32_t smio_id,
  * according to the device information stored in the SDB */
 devio_err_e devio_register_all_sm (void *pipe);
 devio_err_e devio_unregister_sm (void *pipe, const char *smio_key);
+/* Unregister the SMIO "smio_id" of instance "inst_id", if registered */
+devio_err_e devio_unregister_sm_id (void *pipe, uint32_t smio_id,
+        uint32_t inst_id);
 devio_err_e devio_unregister_all_sm (void *pipe);
-/* Poll all PIPE sockets */
+/* Poll all PIPE sockets. Once all the SMIOs registered so far have been
+ * configured, DEVIO_READY_STR is sent to the pipe */
 void devio_loop (zsock_t *pipe, void *args);
 /* Router for all the opcodes registered for this dev_io */
 /* devio_err_e devio_do_op (devio_t *self, uint32_t opcode, int nargs, ...); */
@@ -82,6 +92,85 @@ devio_err_e devio_do_smio_op (devio_t *self, void *msg);
 devio_err_e devio_set_llio (devio_t *self, llio_t *llio);
 /* Get LLIO instance from DEVIO */
 llio_t *devio_get_llio (devio_t *self);
+/* Get the dispatch table of the low-level operations of DEVIO */
+disp_table_t *devio_get_thsafe_disp_table (devio_t *self);
+/* Set the priority class of the requests of the SMIOs named "smio_name",
+ * e.g., "ACQ". Only SMIOs registered afterwards are affected. This must
+ * be called before devio_loop () is started */
+devio_err_e devio_set_smio_prio (devio_t *self, const char *smio_name,
+        devio_prio_e prio);
+/* Set whether the SMIOs named "smio_name", e.g., "ACQ", are lazy. Lazy
+ * SMIOs are registered with the broker only, and spawned (with their
+ * thread, worker and default configuration) on their first request. The
+ * others are spawned on registration. Only SMIOs registered afterwards
+ * are affected. This must be called before devio_loop () is started */
+devio_err_e devio_set_smio_lazy (devio_t *self, const char *smio_name, bool lazy);
+/* Set whether the SMIOs with no policy of their own, see
+ * devio_set_smio_lazy (), are lazy. They are not by default */
+devio_err_e devio_set_smio_lazy_dflt (devio_t *self, bool lazy);
+/* Set the CPU placement of the DEVIO thread. It is applied when
+ * devio_loop () starts */
+devio_err_e devio_set_sched (devio_t *self, const hutils_sched_t *sched);
+/* Set the CPU placement of the threads of the SMIOs with instance ID
+ * "inst_id" registered afterwards. SMIOs without one inherit the placement
+ * of the DEVIO thread */
+devio_err_e devio_set_smio_sched (devio_t *self, uint32_t inst_id,
+        const hutils_sched_t *sched);
+/* Move the running DEVIO thread to "sched", through its PIPE */
+devio_err_e devio_update_sched (void *pipe, const hutils_sched_t *sched);
+/* As devio_set_smio_sched (), through the PIPE of a running DEVIO. The
+ * SMIOs of instance "inst_id" already running with a thread of their own
+ * move to "sched" too. The ones on a reactor keep their placement */
+devio_err_e devio_update_smio_sched (void *pipe, uint32_t inst_id,
+        const hutils_sched_t *sched);
+/* Run the SMIOs registered afterwards on up to "nreactors" threads, shared
+ * among them, instead of one thread per SMIO. Each SMIO goes to the least
+ * loaded reactor. SMIOs of the low priority class (e.g., doing long block
+ * reads) keep a thread of their own, so they don't hold the others back.
+ * Reactors have the CPU placement of the DEVIO thread. 0 for one thread
+ * per SMIO */
+devio_err_e devio_set_smio_reactors (devio_t *self, uint32_t nreactors);
+/* Run the SMIOs registered afterwards on the "nreactors" running "reactors",
+ * as devio_set_smio_reactors () does, so several DEVIOs of a process share
+ * the same threads. The reactors are owned by the caller and must be
+ * destroyed only after all of the DEVIOs sharing them */
+devio_err_e devio_share_smio_reactors (devio_t *self, smio_reactor_t **reactors,
+        uint32_t nreactors);
+/* Keep the shadow register caches of the SMIOs registered afterwards in
+ * snapshot files in "snapshot_dir", so a restarted DEVIO only reprograms
+ * the registers that changed (see smio_map_cache_snapshot ()). NULL
+ * disables it.
+ *
+ * Once all of its SMIOs are up, the DEVIO also listens on a socket in
+ * "snapshot_dir" for a new DEVIO of the same name starting. When
+ * devio_loop () starts, the new one asks the old one there to stop its
+ * SMIOs, without touching the hardware, and spawns the same ones without
+ * their default configuration. Requests wait in the broker meanwhile. The
+ * old DEVIO sends DEVIO_HANDOFF_STR to its pipe then. This must be called
+ * before devio_loop () is started */
+devio_err_e devio_set_snapshot_dir (devio_t *self, const char *snapshot_dir);
+/* Whether the DEVIO took over the SMIOs of a previous one when its loop
+ * started, see devio_set_snapshot_dir () */
+bool devio_took_over (devio_t *self);
+
+/* Let the SMIOs registered afterwards read their own sections of the
+ * configuration file "cfg_file" (see smio_get_cfg_file ()). NULL if none */
+devio_err_e devio_set_cfg_file (devio_t *self, const char *cfg_file);
+
+/* Record the requests received by the SMIOs registered afterwards in
+ * "<trace_dir>/<service>"SMIO_TRACE_FILE_SUFFIX, up to "max_size" bytes
+ * each (0 for no limit), so the same load can be replayed later (see
+ * smio_start_trace ()). Traces of a previous run are overwritten. NULL
+ * disables it */
+devio_err_e devio_set_trace (devio_t *self, const char *trace_dir,
+        uint64_t max_size);
+
+/* Publish the load metrics of the DEVIO and its SMIOs (see
+ * devio_metrics_render ()) to the collector at "endpoint" every "interval"
+ * ms, 0 for the default. Must be set before the DEVIO loop starts. NULL
+ * for none */
+devio_err_e devio_set_metrics (devio_t *self, const char *endpoint,
+        uint32_t interval);
 
 /* Register signals to Device Manager instance */
 devio_err_e devio_set_sig_handler (devio_t *self, devio_sig_handler_t *sig_handler);
@@ -99,6 +188,8 @@ devio_err_e devio_wait_chld_timed (devio_t *self, int timeout);
 devio_err_e devio_set_spawn_clhd_handler (devio_t *self, spawn_chld_handler_fp fp);
 /* Execute function to spawn a all child process */
 devio_err_e devio_spawn_chld (devio_t *self, const char *program, char *const argv[]);
+/* As devio_spawn_chld (), returning the PID of the child, or -1 on error */
+int devio_spawn_chld_pid (devio_t *self, const char *program, char *const argv[]);
 
 /* Setting all operations at once */
 devio_err_e devio_set_ops (devio_t *self, devio_ops_t *devio_ops);
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _DEV_IO_METRICS_H_
+#define _DEV_IO_METRICS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _smio_queue_stats_t;
+
+/* Default publishing period, in ms */
+#define DEVIO_METRICS_DFLT_INTERVAL         1000
+/* Number of latency histogram buckets, one per decade from 1 us up to
+ * 10 s, plus one for everything above */
+#define DEVIO_METRICS_HIST_BUCKETS          9
+
+/* Load metrics of a DEVIO and its SMIOs. Each SMIO updates the counters
+ * of its own node, which are only read by the DEVIO thread, so no lock
+ * or atomic read-modify-write is needed on the hot paths. The DEVIO
+ * thread renders them in the Prometheus text format, see
+ * devio_metrics_render () */
+
+/***************** Our methods *****************/
+
+/* Creates a new instance of the DEVIO metrics. "name" labels every metric */
+devio_metrics_t *devio_metrics_new (const char *name);
+/* Destroy an instance of the DEVIO metrics. The SMIOs must be gone */
+devio_err_e devio_metrics_destroy (devio_metrics_t **self_p);
+
+/* Get the node "idx", for the SMIO "smio_key", resetting its counters.
+ * Nodes are allocated as needed. Returns NULL in case of error */
+devio_metrics_node_t *devio_metrics_node_get (devio_metrics_t *self,
+        uint32_t idx, const char *smio_key);
+/* Set the node "idx" inactive, leaving it out of the metrics, after its
+ * SMIO is gone */
+void devio_metrics_node_release (devio_metrics_t *self, uint32_t idx);
+
+/* Account a request of "bytes" bytes served by the SMIO of "node" in
+ * "elapsed_ns" nanoseconds */
+void devio_metrics_node_request (devio_metrics_node_t *node, size_t bytes,
+        uint64_t elapsed_ns, bool is_err);
+/* Account a request rejected by the SMIO of "node", as its sender had too
+ * many waiting */
+void devio_metrics_node_rejected (devio_metrics_node_t *node);
+/* Account a write superseded by a newer one in the queue of the SMIO of
+ * "node" */
+void devio_metrics_node_coalesced (devio_metrics_node_t *node);
+/* Account "num" reads answered with the reply of an identical one by the
+ * SMIO of "node" */
+void devio_metrics_node_shared (devio_metrics_node_t *node, size_t num);
+/* Account a register or block access of the SMIO of "node", "bytes" bytes
+ * moved, with a round trip of "elapsed_ns" nanoseconds */
+void devio_metrics_node_thsafe (devio_metrics_node_t *node, bool is_write,
+        size_t bytes, uint64_t elapsed_ns, bool is_err);
+/* Set the request queue depth and senders of the SMIO of "node" */
+void devio_metrics_node_queue (devio_metrics_node_t *node,
+        const struct _smio_queue_stats_t *stats);
+
+/* Render the metrics of the active nodes, of the thsafe operations served
+ * by the DEVIO, "thsafe_stats", and of the PCIe timeouts, "pcie_stats"
+ * (NULL for other devices), in the Prometheus text format. Returns a
+ * string to be freed by the caller or NULL on error */
+char *devio_metrics_render (devio_metrics_t *self, msg_stats_t *thsafe_stats,
+        const llio_pcie_timeout_stats_t *pcie_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _DEV_IO_STATUS_H_
+#define _DEV_IO_STATUS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _smio_status_page_t;
+struct _smio_status_hdr_t;
+
+/* Status page of a DEVIO, shared with the readers on the same host. See
+ * sm_io_status_codes.h for its layout and locking */
+
+/***************** Our methods *****************/
+
+/* Creates the status page of the DEVIO "name". Returns NULL if the shared
+ * memory region could not be created */
+devio_status_t *devio_status_new (const char *name);
+/* Destroy the status page, removing the shared memory region. The SMIOs
+ * must be gone */
+devio_err_e devio_status_destroy (devio_status_t **self_p);
+/* Get the mapped status page */
+struct _smio_status_page_t *devio_status_get_page (devio_status_t *self);
+
+/* Start updating the section of "hdr". Only one thread may write a section */
+void devio_status_write_begin (struct _smio_status_hdr_t *hdr);
+/* Done updating the section of "hdr", stamping it with the current time */
+void devio_status_write_end (struct _smio_status_hdr_t *hdr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
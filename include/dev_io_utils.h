@@ -25,12 +25,33 @@ enum _devio_type_e {
 #define FE_DEVIO_STR                    "fe"
 #define INVALID_DEVIO_STR               "invalid"
 
+/* SMIO request priority class */
+enum _devio_prio_e {
+    DEVIO_PRIO_HIGH = 0,                /* Served in between the other requests */
+    DEVIO_PRIO_NORMAL,                  /* Default */
+    DEVIO_PRIO_LOW,                     /* Served one request at a time */
+    DEVIO_PRIO_INVALID,
+    /* Give this enum the ability to represent CONVC_TYPE_END */
+    DEVIO_PRIO_END = CONVC_TYPE_END
+};
+
+#define DEVIO_PRIO_HIGH_STR             "high"
+#define DEVIO_PRIO_NORMAL_STR           "normal"
+#define DEVIO_PRIO_LOW_STR              "low"
+#define DEVIO_PRIO_INVALID_STR          "invalid"
+
 /* Converts the devio_type enumeration into a string */
 devio_type_e devio_str_to_type (const char *type_str);
 /* Converts a string to the devio_type enumeration. If no match if found,
  * a INVALID_DEV is returned as the devio device */
 char *devio_type_to_str (devio_type_e type);
 
+/* Converts a string to the devio_prio enumeration. If no match if found,
+ * DEVIO_PRIO_INVALID is returned */
+devio_prio_e devio_str_to_prio (const char *prio_str);
+/* Converts the devio_prio enumeration into a string */
+char *devio_prio_to_str (devio_prio_e prio);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,13 @@ extern int dmngr_daemonize;
 extern char *dmngr_work_dir;
 extern char *dmngr_spawn_broker_cfg_str;
 extern int dmngr_spawn_broker_cfg;
+extern char *dmngr_broker_shards_str;
+extern uint32_t dmngr_broker_shards;
+
+/* Sent by a DEVIO to the dev_mngr that spawned it once all of its SMIOs
+ * are configured. The dev_mngr PID is passed down in DMNGR_PID_ENV */
+#define DMNGR_READY_SIGNAL          SIGRTMIN
+#define DMNGR_PID_ENV               "DMNGR_PID"
 
 /* Node of sig_ops list */
 typedef struct {
@@ -53,7 +60,8 @@ dmngr_err_e dmngr_set_sig_handler (dmngr_t *self, dmngr_sig_handler_t *sig_handl
 dmngr_err_e dmngr_register_sig_handlers (dmngr_t *self);
 /* Register function to wait a all child process */
 dmngr_err_e dmngr_set_wait_clhd_handler (dmngr_t *self, wait_chld_handler_fp fp);
-/* Execute function to wait a all child process */
+/* Execute function to wait a all child process. DEVIOs whose process
+ * exited are marked as KILLED */
 dmngr_err_e dmngr_wait_chld (dmngr_t *self);
 /* Register function to spawn a all child process */
 dmngr_err_e dmngr_set_spawn_clhd_handler (dmngr_t *self, spawn_chld_handler_fp fp);
@@ -70,13 +78,37 @@ const char * dmngr_get_cfg_file (dmngr_t *self);
 char * dmngr_clone_cfg_file (dmngr_t *self);
 /* Is broker Running? */
 bool dmngr_is_broker_running (dmngr_t *self);
-/* Spawn broker if not running */
+/* Set the number of broker shards. DEVIOs are connected to the shard of
+ * their board, see hutils_broker_shard (). Default is 1 */
+dmngr_err_e dmngr_set_broker_shards (dmngr_t *self, uint32_t num_shards);
+/* Spawn broker if not running. With more than one shard, each one is a
+ * broker thread of this process, bound to hutils_broker_shard_endp () */
 dmngr_err_e dmngr_spawn_broker (dmngr_t *self, char *broker_endp);
+/* Start answering for SMIO_DIR_SERVICE on every broker shard, for the
+ * clients to find all of the DEVIOs and SMIOs in one request. Does nothing
+ * if already started */
+dmngr_err_e dmngr_start_dir (dmngr_t *self, char *broker_endp);
 /* Scan for Devices to control */
 dmngr_err_e dmngr_scan_devs (dmngr_t *self, uint32_t *num_devs_found);
-/* Spwan all devices previously found by dmngr_scan_devs () */
+/* File descriptor that gets readable when devices come or go. -1 if
+ * devices cannot be watched */
+int dmngr_get_devs_fd (dmngr_t *self);
+/* Handle the device events pending on dmngr_get_devs_fd (). The DEVIOs of
+ * removed devices are stopped. New devices are left for dmngr_scan_devs () */
+dmngr_err_e dmngr_handle_devs_events (dmngr_t *self);
+/* File descriptor that gets readable when a DEVIO exits. -1 if they
+ * cannot be watched, in which case only SIGCHLD tells so */
+int dmngr_get_chld_fd (dmngr_t *self);
+/* Reap the DEVIOs that exited, as dmngr_wait_chld () does, consuming the
+ * events pending on dmngr_get_chld_fd () */
+dmngr_err_e dmngr_handle_chld_events (dmngr_t *self);
+/* Spwan all devices previously found by dmngr_scan_devs (). At most
+ * DMNGR_MAX_STARTING_DEVIOS DEVIOs are starting up at any time. The others
+ * are left for the next calls */
 dmngr_err_e dmngr_spawn_all_devios (dmngr_t *self, char *broker_endp,
         char *devio_log_filename, bool respawn_killed_devio);
+/* Mark the DEVIO running as process "pid" as ready */
+dmngr_err_e dmngr_devio_ready (dmngr_t *self, pid_t pid);
 
 #ifdef __cplusplus
 }
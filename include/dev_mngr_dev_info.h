@@ -15,6 +15,7 @@ extern "C" {
 typedef enum {
     INACTIVE = 0,                       /* Nothing found yet */
     READY_TO_RUN,                       /* Device found but not yet initialized */
+    STARTING,                           /* Device spawned, but not ready yet */
     RUNNING,                            /* Device is running */
     STOPPED,                            /* Device is stopped momentarily */
     KILLED                              /* Device is dead. Clean it and restart, if needed */
@@ -54,6 +55,12 @@ char *devio_info_clone_dev_pathname (devio_info_t *self);
 dmngr_err_e devio_info_set_state (devio_info_t *self, devio_state_e state);
 /* Get Device Info Device state */
 devio_state_e devio_info_get_state (devio_info_t *self);
+/* Set Device Info PID of the DEVIO process. Also sets the spawn time to now */
+dmngr_err_e devio_info_set_pid (devio_info_t *self, pid_t pid);
+/* Get Device Info PID of the DEVIO process. 0 if not spawned */
+pid_t devio_info_get_pid (devio_info_t *self);
+/* Get Device Info spawn time of the DEVIO process, in ms */
+int64_t devio_info_get_spawn_time (devio_info_t *self);
 
 #ifdef __cplusplus
 }
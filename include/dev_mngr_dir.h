@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _DEV_MNGR_DIR_H_
+#define _DEV_MNGR_DIR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Directory of the DEVIOs and of the services of their SMIOs, answering at
+ * SMIO_DIR_SERVICE on every broker shard, see sm_io_codes.h. It is run by
+ * an actor of its own, so requests are answered while the dev_mngr is busy
+ * spawning DEVIOs */
+
+/***************** Our methods *****************/
+
+/* Creates the directory, connected to the "num_shards" shards of
+ * "broker_endp". Returns NULL if any of them could not be connected to */
+dmngr_dir_t *dmngr_dir_new (const char *broker_endp, uint32_t num_shards);
+/* Destroy the directory */
+dmngr_err_e dmngr_dir_destroy (dmngr_dir_t **self_p);
+
+/* Set the state (SMIO_DIR_DEVIO_*) and PID of the DEVIO of board "board_id"
+ * and BPM "bpm_id". The services of the DEVIO are dropped once it is
+ * SMIO_DIR_DEVIO_KILLED */
+dmngr_err_e dmngr_dir_set_devio (dmngr_dir_t *self, uint32_t board_id,
+        uint32_t bpm_id, uint32_t state, pid_t pid);
+/* Remove the DEVIO of board "board_id" and BPM "bpm_id", along with its
+ * services */
+dmngr_err_e dmngr_dir_remove_devio (dmngr_dir_t *self, uint32_t board_id,
+        uint32_t bpm_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,7 +20,29 @@ struct _exp_msg_zmq_t {
      * CZMQ 3.0.0 available at https://github.com/zeromq/czmq/blob/master/src/zmsg.c */
     uint32_t tag;
     zmsg_t **msg;
+    /* Unused in the MLM protocol. Client identity on the local fast path */
     zframe_t *reply_to;
+    /* Request envelope. Requests might wait in the fair queue, so these
+     * are copied from the worker, which only holds the ones of the last
+     * message received */
+    const char *sender;                 /* NULL on the local fast path */
+    const char *subject;
+    const char *tracker;
+    /* Local fast path requests only, see RW_LOCAL_ENDP_SEP. NULL otherwise */
+    zsock_t *local_sock;
+    /* Filled by msg_handle_mlm_request (), so the request can be
+     * replied to after the handler returns. See msg_defer_reply () */
+    mlm_client_t *worker;
+    uint32_t opcode;
+    uint64_t start_ns;
+    msg_stats_t *stats;
+    bool deferred;
+    /* Identical requests served along with this one, which get the same
+     * reply (see RW_REQ_SHARED_SUBJECT). msg_handle_mlm_request () sets
+     * "followers_replied" once it replied to them too */
+    struct _exp_msg_zmq_t *followers;
+    uint32_t num_followers;
+    bool followers_replied;
 };
 
 /* SMIO THSAFE ZMQ server function arguments macros */
@@ -34,6 +56,9 @@ struct _exp_msg_zmq_t {
 #define EXP_MSG_ZMQ_PEEK_EXIT(args)                     GEN_MSG_ZMQ_PEEK_EXIT(EXP_MSG_ZMQ(args))
 #define EXP_MSG_ZMQ_PEEK_RESTART(args)                  GEN_MSG_ZMQ_PEEK_RESTART(EXP_MSG_ZMQ(args))
 
+#define EXP_MSG_ZMQ_SENDER(args)                        (__EXP_MSG_ZMQ_ARGS_2_MSG(args)->sender)
+#define EXP_MSG_ZMQ_IS_LOCAL(args)                      (__EXP_MSG_ZMQ_ARGS_2_MSG(args)->local_sock != NULL)
+
 #define EXP_MSG_ZMQ_ARG_TYPE                            GEN_MSG_ZMQ_ARG_TYPE
 
 #define EXP_MSG_ZMQ_ARG_SIZE(arg)                       GEN_MSG_ZMQ_ARG_SIZE(arg)
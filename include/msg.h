@@ -31,15 +31,47 @@ msg_type_e msg_guess_type (void *msg);
 msg_err_e msg_validate (void *msg, msg_type_e expected_msg_type);
 
 /* Utility function for helping other classes in implementing their
- * message checking */
-msg_err_e msg_check_gen_zmq_args (const disp_op_t *disp_op, zmsg_t *zmq_msg);
+ * message checking. "sig" is the shape of the arguments of "disp_op" */
+msg_err_e msg_check_gen_zmq_args (const disp_op_t *disp_op,
+        const disp_op_sig_t *sig, zmsg_t *zmq_msg);
 
-/* Handle MLM protocol (used by SMIOs, for instance) request */
+/* Handle MLM protocol (used by SMIOs, for instance) request. If "stats"
+ * is not NULL, the request is accounted in it */
 msg_err_e msg_handle_mlm_request (void *owner, void *args,
-        disp_table_t *disp_table);
-/* Handle regular protocol (used by DEVIOs, for instance) request */
+        disp_table_t *disp_table, msg_stats_t *stats);
+/* Serve the "num_ops" operations of a SMIO_OPCODE_BATCH request, "batch",
+ * in order, writing their replies to "out". "args" is the batch request.
+ * Returns the size of the replies or -PARAM_ERR if the batch is malformed */
+int msg_handle_mlm_batch (void *owner, void *args, disp_table_t *disp_table,
+        msg_stats_t *stats, uint32_t num_ops, const uint8_t *batch,
+        size_t batch_size, uint8_t *out, size_t out_size);
+/* Get the opcode of an MLM protocol request received with "subject",
+ * without changing the request */
+msg_err_e msg_peek_mlm_opcode (zmsg_t *zmq_msg, const char *subject,
+        uint32_t *opcode);
+/* Reply with an error to an MLM protocol request, without serving it */
+msg_err_e msg_reject_mlm_request (void *owner, void *args);
+/* Reply with success to an MLM protocol request, without serving it */
+msg_err_e msg_ack_mlm_request (void *owner, void *args);
+/* Handle regular protocol (used by DEVIOs, for instance) request. If "stats"
+ * is not NULL, the request is accounted in it */
 msg_err_e msg_handle_sock_request (void *owner, void *args,
-        disp_table_t *disp_table);
+        disp_table_t *disp_table, msg_stats_t *stats);
+
+/* Called by an MLM or regular protocol handler that will reply to the
+ * request later. The handler return value is then ignored and the reply is
+ * only sent by msg_deferred_reply () */
+msg_deferred_t *msg_defer_reply (void *args);
+/* Drop a deferred request without replying to it, e.g., when its owner
+ * is going away */
+void msg_deferred_destroy (msg_deferred_t **self_p);
+/* Send the reply of a deferred request, as if "ret" and "data" were
+ * the handler return value and output */
+void msg_deferred_reply (msg_deferred_t **self_p, int ret, void *data);
+/* Same as msg_deferred_reply (), but "data" must come from
+ * disp_table_get_ret () and is sent without copying it. The reply owns
+ * "data" from then on, giving it back with disp_table_put_ret () */
+void msg_deferred_reply_zero_copy (msg_deferred_t **self_p, int ret, void *data);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _MSG_STATS_H_
+#define _MSG_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per-opcode request counters and latency histograms. Instances are not
+ * thread safe and must only be used by the owner thread (SMIO or DEVIO) */
+
+/***************** Our methods *****************/
+
+/* Creates a new instance of the operation statistics */
+msg_stats_t *msg_stats_new (void);
+/* Destroy an instance of the operation statistics */
+msg_err_e msg_stats_destroy (msg_stats_t **self_p);
+
+/* Get a monotonic timestamp, in nanoseconds */
+uint64_t msg_stats_now_ns (void);
+/* Account a request of "opcode" that took "elapsed_ns" nanoseconds.
+ * Opcodes outside of the valid range are silently ignored */
+void msg_stats_record (msg_stats_t *self, uint32_t opcode, uint64_t elapsed_ns,
+        bool is_err);
+/* Get the statistics of "opcode". Returns NULL if the opcode is out of
+ * the valid range */
+const smio_op_stats_t *msg_stats_get (msg_stats_t *self, uint32_t opcode);
+/* Get the opcode of the last failed request and when it failed, as
+ * msg_stats_now_ns (), 0 if none did. Returns the number of failed
+ * requests of all opcodes. These are not cleared by msg_stats_reset () */
+uint64_t msg_stats_get_last_err (msg_stats_t *self, uint32_t *opcode,
+        uint64_t *ns);
+/* Reset the statistics of "opcode" */
+void msg_stats_reset (msg_stats_t *self, uint32_t opcode);
+/* Log a summary of every opcode with at least one request */
+void msg_stats_print (msg_stats_t *self, const char *owner_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -217,6 +217,9 @@ typedef int (*rw_param_format_fp) (uint32_t *param);
             set_param_return = SET_PARAM_GEN(self, module, base_addr,           \
                     prefix, reg, field, single_bit, value, min, max, chk_funcp, \
                     clr_field, read_32_fp, write_32_fp);                        \
+            if (set_param_return == RW_OK) {                                    \
+                smio_set_param_changed (self);                                  \
+            }                                                                   \
             return -set_param_return;                                           \
         }                                                                       \
     } while (0)
@@ -269,6 +272,9 @@ typedef int (*rw_param_format_fp) (uint32_t *param);
                     (base_addr + (chan*chan_offset)),                           \
                     prefix, reg, field, single_bit, value, min, max, chk_funcp, \
                     clr_field, read_32_fp, write_32_fp);                        \
+            if (set_param_return == RW_OK) {                                    \
+                smio_set_param_changed (self);                                  \
+            }                                                                   \
             return -set_param_return;                                           \
         }                                                                       \
     } while (0)
@@ -280,7 +286,95 @@ typedef int (*rw_param_format_fp) (uint32_t *param);
                     fmt_funcp, clr_field, smio_thsafe_client_read_32,           \
                     smio_thsafe_client_write_32)
 
+/* Same as SET_GET_PARAM and SET_GET_PARAM_CHANNEL, but accessing the register
+ * through the SMIO shadow register cache (see smio_add_cache_region ()).
+ * Reads of cached registers do not reach the hardware and read-modify-write
+ * updates turn into a single write */
+#define SET_GET_PARAM_CACHED(module, base_addr, prefix, reg, field, single_bit, \
+        min, max, chk_funcp, fmt_funcp, clr_field)                              \
+            SET_GET_PARAM_GEN(module, base_addr, prefix, reg, field, single_bit, min,   \
+                max, chk_funcp, fmt_funcp, clr_field, smio_thsafe_client_cached_read_32, \
+                    smio_thsafe_client_cached_write_32)
+
+#define SET_GET_PARAM_CHANNEL_CACHED(module, base_addr, prefix, reg, field,    \
+        chan_offset, chan_num, single_bit, min, max, chk_funcp, fmt_funcp, clr_field) \
+            SET_GET_PARAM_CHANNEL_GEN(module, base_addr, prefix, reg, field,    \
+                    chan_offset, chan_num, single_bit, min, max, chk_funcp,     \
+                    fmt_funcp, clr_field, smio_thsafe_client_cached_read_32,    \
+                    smio_thsafe_client_cached_write_32)
+
+/***************************** Table driven parameters ***********************/
+
+/* Instead of expanding SET_GET_PARAM into a handler of its own, a parameter
+ * might be described by a constant descriptor, built from the same macro
+ * arguments by RW_PARAM_DESC, and served by rw_param_set_get (), which is
+ * shared by all of them. Fields with _R/_W macros other than a shift and a
+ * mask must still use SET_GET_PARAM */
+typedef struct {
+    uint64_t addr;                  /* Register offset of channel 0 */
+    uint64_t chan_offset;           /* Offset between channels */
+    uint32_t chan_num;              /* Number of channels. 0 if the parameter
+                                       has no channel frame */
+    uint32_t mask;                  /* Field bits, in place */
+    uint32_t shift;                 /* Position of the field LSB */
+    uint32_t min;                   /* Minimum value, if check_lim is set */
+    uint32_t max;                   /* Maximum value, if check_lim is set */
+    bool check_lim;                 /* Check min/max on SET */
+    bool single_bit;                /* Read as BIT_SET/BIT_CLR and written
+                                       as a flag */
+    bool clr_field;                 /* SET clears the field, instead of
+                                       writing the value */
+    rw_param_check_fp chk_funcp;    /* Called on SET. NULL for none */
+    rw_param_format_fp fmt_funcp;   /* Called on GET. NULL for none */
+} rw_param_desc_t;
+
+#define RW_PARAM_DESC_FIELD_MASK(prefix, reg, field, single_bit)                \
+    WHEN(single_bit)(CONCAT_NAME3(prefix, reg, field))                          \
+    WHENNOT(single_bit)(CONCAT_NAME4_RW(prefix, reg, field, MASK))
+
+/* Descriptor of a parameter, with the same arguments as SET_GET_PARAM or
+ * SET_GET_PARAM_CHANNEL */
+#define RW_PARAM_DESC_CHANNEL(base_addr, prefix, reg, field, chan_offset_,      \
+        chan_num_, single_bit_, min_, max_, chk_funcp_, fmt_funcp_, clr_field_) \
+    {                                                                           \
+        .addr = (base_addr) | CONCAT_NAME3(prefix, REG, reg),                   \
+        .chan_offset = chan_offset_,                                            \
+        .chan_num = chan_num_,                                                  \
+        .mask = RW_PARAM_DESC_FIELD_MASK(prefix, reg, field, single_bit_),      \
+        .shift = __builtin_ctzll (                                              \
+                RW_PARAM_DESC_FIELD_MASK(prefix, reg, field, single_bit_)),     \
+        .min = 0 WHENNOT(ISEMPTY(min_))(+ (min_)),                              \
+        .max = 0 WHENNOT(ISEMPTY(max_))(+ (max_)),                              \
+        .check_lim = false WHENNOT(ISEMPTY(min_))(WHENNOT(ISEMPTY(max_))(|| true)), \
+        .single_bit = single_bit_,                                              \
+        .clr_field = clr_field_,                                                \
+        .chk_funcp = (rw_param_check_fp) chk_funcp_,                            \
+        .fmt_funcp = (rw_param_format_fp) fmt_funcp_                            \
+    }
+
+#define RW_PARAM_DESC(base_addr, prefix, reg, field, single_bit, min, max,      \
+        chk_funcp, fmt_funcp, clr_field)                                        \
+    RW_PARAM_DESC_CHANNEL(base_addr, prefix, reg, field, 0, 0, single_bit, min, \
+            max, chk_funcp, fmt_funcp, clr_field)
+
+/* Define the handler RW_PARAM_FUNC_NAME(module, reg) of a parameter
+ * described by "desc", e.g.:
+ *
+ * RW_PARAM_DESC_FUNC(module, reg, RW_PARAM_DESC(...))
+ */
+#define RW_PARAM_DESC_FUNC(module, reg, desc)                                   \
+    static const rw_param_desc_t _##module##_##reg##_desc = desc;               \
+    RW_PARAM_FUNC(module, reg) {                                                \
+        return rw_param_set_get (owner, args, ret, &_##module##_##reg##_desc);  \
+    }
+
 uint32_t check_param_limits (uint32_t value, uint32_t min, uint32_t max);
 
+/* Serve the SET/GET request "args" of the parameter described by "desc",
+ * with the same messages and replies as SET_GET_PARAM and
+ * SET_GET_PARAM_CHANNEL */
+int rw_param_set_get (void *owner, void *args, void *ret,
+        const rw_param_desc_t *desc);
+
 #endif
 
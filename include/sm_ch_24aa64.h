@@ -14,7 +14,9 @@ extern "C" {
 
 /***************** Our methods *****************/
 
-/* Creates a new instance of the SMCH 24AA64 */
+/* Creates a new instance of the SMCH 24AA64. The whole EEPROM is read
+ * at creation, so the I2C bus must already reach the chip, and reads are
+ * served from memory afterwards; writes go to both */
 smch_24aa64_t * smch_24aa64_new (smio_t *parent, uint64_t base, uint32_t addr,
         int verbose);
 /* Destroy an instance of the SMCH 24AA64 */
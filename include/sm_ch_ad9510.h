@@ -12,6 +12,29 @@
 extern "C" {
 #endif
 
+/* Clock tree settings applied at once. Fields set to SMCH_AD9510_CFG_KEEP
+ * are left unchanged. The values are the ones of the single setting
+ * functions below */
+#define SMCH_AD9510_CFG_KEEP                0xFFFFFFFF
+
+typedef struct {
+    uint32_t pll_a_div;
+    uint32_t pll_b_div;
+    uint32_t pll_prescaler;
+    uint32_t r_div;
+    uint32_t cp_current;
+    uint32_t outputs;
+    uint32_t pll_clk_sel;
+} smch_ad9510_cfg_t;
+
+/* Register writes of a smch_ad9510_cfg_t, sorted by address */
+#define SMCH_AD9510_PROG_MAX_REGS           16
+
+typedef struct {
+    size_t num_regs;
+    smch_reg_t regs [SMCH_AD9510_PROG_MAX_REGS];
+} smch_ad9510_prog_t;
+
 /***************** Our methods *****************/
 
 /* Creates a new instance of the SMCH AD9510 */
@@ -20,12 +43,17 @@ smch_ad9510_t * smch_ad9510_new (smio_t *parent, uint64_t base, uint32_t ss,
 /* Destroy an instance of the SMCH AD9510 */
 smch_err_e smch_ad9510_destroy (smch_ad9510_t **self_p);
 
-/* Read/Write to/from AD9510 Registers */
+/* Read/Write to/from AD9510 Registers. Reads are served from a shadow copy
+ * of the registers, when known */
 smch_err_e smch_ad9510_write_8 (smch_ad9510_t *self, uint8_t addr,
         const uint8_t *data);
 smch_err_e smch_ad9510_read_8 (smch_ad9510_t *self, uint8_t addr,
         uint8_t *data);
 
+/* Drop the shadow copy of the registers, so they are read from the chip
+ * again. Needed if the chip is changed behind our back */
+smch_err_e smch_ad9510_resync (smch_ad9510_t *self);
+
 /* Read/Write to/from AD9510 Registers with Update command */
 smch_err_e smch_ad9510_write_8_update (smch_ad9510_t *self, uint8_t addr,
         const uint8_t *data);
@@ -38,6 +66,16 @@ smch_err_e smch_ad9510_reg_update (smch_ad9510_t *self);
 /* Simple test for configuring a few AD9510 registers */
 smch_err_e smch_ad9510_cfg_defaults (smch_ad9510_t *self);
 
+/* Check the settings of "cfg" and compile them into "prog", without
+ * touching the chip. Returns SMCH_ERR_INV_FUNC_PARAM if any of them is out
+ * of range */
+smch_err_e smch_ad9510_cfg_compile (const smch_ad9510_cfg_t *cfg,
+        smch_ad9510_prog_t *prog);
+/* Write the registers of "prog", in bursts, and make them effective with a
+ * single register update */
+smch_err_e smch_ad9510_cfg_apply (smch_ad9510_t *self,
+        const smch_ad9510_prog_t *prog);
+
 /* AD9510 PLL divider functions */
 smch_err_e smch_ad9510_set_pll_a_div (smch_ad9510_t *self, uint32_t *div);
 smch_err_e smch_ad9510_get_pll_a_div (smch_ad9510_t *self, uint32_t *div);
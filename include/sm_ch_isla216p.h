@@ -20,12 +20,22 @@ smch_isla216p_t * smch_isla216p_new (smio_t *parent, uint64_t base, uint32_t ss,
 /* Destroy an instance of the SMCH ISLA216P */
 smch_err_e smch_isla216p_destroy (smch_isla216p_t **self_p);
 
-/* Read/Write to/from ISLA216P Registers */
+/* Read/Write to/from ISLA216P Registers. Reads are served from a shadow
+ * copy of the registers, when known */
 smch_err_e smch_isla216p_write_8 (smch_isla216p_t *self, uint8_t addr,
         const uint8_t *data);
 smch_err_e smch_isla216p_read_8 (smch_isla216p_t *self, uint8_t addr,
         uint8_t *data);
 
+/* Drop the shadow copy of the registers, so they are read from the chip
+ * again. Needed if the chip is changed behind our back */
+smch_err_e smch_isla216p_resync (smch_isla216p_t *self);
+
+/* Wait for the chip to finish its calibration, polling its status until
+ * "deadline", a zclock_mono () time, in ms. Returns SMCH_ERR_TIMEOUT if it
+ * is not done by then */
+smch_err_e smch_isla216p_wait_cal (smch_isla216p_t *self, int64_t deadline);
+
 /* ISLA216P Test functions */
 smch_err_e smch_isla216p_set_test_mode (smch_isla216p_t *self, uint8_t mode);
 
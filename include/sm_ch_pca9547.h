@@ -26,7 +26,8 @@ smch_err_e smch_pca9547_destroy (smch_pca9547_t **self_p);
 smch_err_e smch_pca9547_write_8 (smch_pca9547_t *self, const uint8_t *data);
 smch_err_e smch_pca9547_read_8 (smch_pca9547_t *self, uint8_t *data);
 
-/* Enable specific I2C channel */
+/* Enable specific I2C channel. The control byte last written or read is
+ * kept, so nothing goes to the bus if "chan" is selected already */
 smch_err_e smch_pca9547_en_chan (smch_pca9547_t *self, uint8_t chan);
 
 #ifdef __cplusplus
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SMCH_REG_TBL_H_
+#define _SMCH_REG_TBL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Table driven register programming. Chips describe their configuration as
+ * const tables of 8-bit register writes, and consecutive entries that hit
+ * contiguous registers are issued as a single burst by the chip "write"
+ * function */
+
+/* Largest burst supported */
+#define SMCH_REG_TBL_BURST_MAX              32
+/* Mask to overwrite a whole register */
+#define SMCH_REG_TBL_MASK_ALL               0xFF
+
+/* Single register write. Only the bits in "mask" are changed, the others
+ * are read back from the chip first */
+typedef struct {
+    uint16_t addr;                  /* Register address */
+    uint8_t value;                  /* Register value */
+    uint8_t mask;                   /* Bits to write */
+} smch_reg_t;
+
+/* Write "size" contiguous registers, starting at "addr", in a single
+ * transaction. Returns the number of registers written */
+typedef ssize_t (*smch_reg_tbl_write_fp) (void *chip, uint16_t addr,
+        const uint8_t *data, size_t size);
+/* Read a single register. Returns the number of registers read */
+typedef ssize_t (*smch_reg_tbl_read_fp) (void *chip, uint16_t addr,
+        uint8_t *data);
+
+typedef struct {
+    smch_reg_tbl_write_fp write;    /* Burst write */
+    smch_reg_tbl_read_fp read;      /* Single read. Only needed for tables
+                                       with masked entries */
+    size_t burst_max;               /* Maximum number of registers written
+                                       by a single "write" call */
+} smch_reg_tbl_ops_t;
+
+/* Write the "num_regs" registers of "regs", in order, merging runs of
+ * contiguous addresses in bursts of at most ops->burst_max registers */
+smch_err_e smch_reg_tbl_write (void *chip, const smch_reg_tbl_ops_t *ops,
+        const smch_reg_t *regs, size_t num_regs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -44,6 +44,17 @@ smch_err_e smch_rffe_write_var (smch_rffe_t *self, uint32_t id, uint8_t *data,
 /* Read RFFE variable */
 smch_err_e smch_rffe_read_var (smch_rffe_t *self, uint32_t id, uint8_t *data,
         size_t size);
+/* Read several RFFE variables in a single round trip. The value of ids [i]
+ * goes to data [i], which can hold "size" bytes */
+smch_err_e smch_rffe_read_vars (smch_rffe_t *self, const uint32_t *ids,
+        uint8_t **data, size_t size, size_t num_ids);
+/* Create a group of RFFE variables, replacing any group created before */
+smch_err_e smch_rffe_create_group (smch_rffe_t *self, const uint32_t *ids,
+        size_t num_ids, uint32_t *group_id);
+/* Read RFFE group. The value of the i-th variable of the group goes to
+ * data [i], which can hold "size" bytes */
+smch_err_e smch_rffe_read_group (smch_rffe_t *self, uint32_t group_id,
+        uint8_t **data, size_t size, size_t num_vars);
 
 #ifdef __cplusplus
 }
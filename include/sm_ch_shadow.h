@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SMCH_SHADOW_H_
+#define _SMCH_SHADOW_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Shadow copy of an 8-bit register map. The chips we drive only change
+ * their registers when we tell them to, so the drivers keep the last value
+ * written to (or read from) each register and serve reads from here. A
+ * register is valid once it has been written or read */
+
+/* Number of registers covered, enough for any 8-bit address */
+#define SMCH_SHADOW_REGS                    256
+
+typedef struct {
+    uint8_t value [SMCH_SHADOW_REGS];       /* Register contents */
+    uint8_t valid [SMCH_SHADOW_REGS/8];     /* Bitmap of valid registers */
+} smch_shadow_t;
+
+/* Invalidate all of the registers, so they are read from the chip again */
+void smch_shadow_reset (smch_shadow_t *self);
+/* Set the contents of "addr" */
+void smch_shadow_set (smch_shadow_t *self, uint16_t addr, uint8_t value);
+/* Get the contents of "addr". Returns false if they are not known */
+bool smch_shadow_get (smch_shadow_t *self, uint16_t addr, uint8_t *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,7 +20,8 @@ smch_si57x_t * smch_si57x_new (smio_t *parent, uint64_t base, uint32_t addr,
 /* Destroy an instance of the SMCH SI57X */
 smch_err_e smch_si57x_destroy (smch_si57x_t **self_p);
 
-/* Read/Write to SI57X */
+/* Read/Write to SI57X. Reads are served from a shadow copy of the
+ * registers, when known */
 smch_err_e smch_si57x_write_8 (smch_si57x_t *self, uint8_t addr,
         const uint8_t *data);
 smch_err_e smch_si57x_write_block (smch_si57x_t *self, uint8_t addr,
@@ -30,6 +31,10 @@ smch_err_e smch_si57x_read_8 (smch_si57x_t *self, uint8_t addr,
 smch_err_e smch_si57x_read_block (smch_si57x_t *self, uint8_t addr,
         uint8_t *data, size_t size);
 
+/* Drop the shadow copy of the registers, so they are read from the chip
+ * again. Needed if the chip is changed behind our back */
+smch_err_e smch_si57x_resync (smch_si57x_t *self);
+
 /* Probe bus for I2C devices */
 ssize_t smch_si57x_probe_bus (smch_si57x_t *self);
 
@@ -12,6 +12,9 @@
 extern "C" {
 #endif
 
+struct _smio_status_page_t;
+struct _smio_startup_stats_t;
+
 /* SMIO sockets IDs */
 #define SMIO_PIPE_MGMT_SOCK         0
 #define SMIO_MLM_SOCK               1
@@ -51,6 +54,8 @@ typedef smio_err_e (*export_ops_fp)(smio_t *self, const disp_op_t** smio_exp_ops
 typedef smio_err_e (*unexport_ops_fp)(smio_t *self);
 /* Generic wrapper for receiving opcodes and arguments to specific funtions function pointer */
 typedef smio_err_e (*do_op_fp)(void *owner, void *msg);
+/* Periodic handler called by the SMIO poll timer function pointer */
+typedef smio_err_e (*poll_fp)(smio_t *self);
 
 typedef struct {
     attach_fp attach;                   /* Attach sm_io instance to dev_io */
@@ -58,6 +63,8 @@ typedef struct {
     export_ops_fp export_ops;           /* Export sm_io operations to dev_io */
     unexport_ops_fp unexport_ops;       /* Unexport sm_io operations to dev_io */
     do_op_fp do_op;                     /* Generic wrapper for handling specific operations */
+    poll_fp poll;                       /* Periodic handler. Only called if a poll interval
+                                           was set with smio_set_poll_interval () */
 } smio_ops_t;
 
 /* Open device */
@@ -80,6 +87,12 @@ typedef ssize_t (*thsafe_client_write_block_fp) (smio_t *self, uint64_t offs, si
 typedef ssize_t (*thsafe_client_read_dma_fp) (smio_t *self, uint64_t offs, size_t size, uint32_t *data);
 /* Write data block via DMA from device, size in bytes */
 typedef ssize_t (*thsafe_client_write_dma_fp) (smio_t *self, uint64_t offs, size_t size, const uint32_t *data);
+/* Execute a batch of register operations, in order, size in number of operations */
+typedef ssize_t (*thsafe_client_batch_fp) (smio_t *self, thsafe_batch_op_t *ops, size_t num_ops);
+/* Read scattered data blocks from device, in a single request */
+typedef ssize_t (*thsafe_client_read_blockv_fp) (smio_t *self, const llio_iov_t *iov, size_t iovcnt);
+/* Wait for the completion of the writes posted so far */
+typedef ssize_t (*thsafe_client_fence_fp) (smio_t *self);
 /* Read device information */
 /* typedef int (*thsafe_client_read_info_fp) (smio_t *self, llio_dev_info_t *dev_info); Moved to dev_io */
 
@@ -100,6 +113,11 @@ typedef struct {
                                                      parameter size in bytes */
     thsafe_client_write_dma_fp thsafe_client_write_dma;         /* Write arbitrary block size data via DMA,
                                                      parameter size in bytes */
+    thsafe_client_batch_fp thsafe_client_batch;                 /* Execute a batch of register
+                                                     operations in a single request */
+    thsafe_client_read_blockv_fp thsafe_client_read_blockv;     /* Read scattered blocks in a
+                                                     single request */
+    thsafe_client_fence_fp thsafe_client_fence;                 /* Wait for the posted writes */
     /*thsafe_client_read_info_fp thsafe_client_read_info; Moved to dev_io */         /* Read device information data */
 } smio_thsafe_client_ops_t;
 
@@ -108,13 +126,56 @@ typedef struct {
     struct _devio_t *parent;                                    /* Pointer back to devo parent */
     volatile const smio_mod_dispatch_t *smio_handler;           /* SMIO table handler */
     zsock_t *pipe_msg;                                          /* Message PIPE to actor */
+    thsafe_ring_t *ring;                                        /* Register access ring to
+                                                                   parent. Owned by the DEVIO */
+    llio_t *llio;                                               /* Device the SMIO accesses
+                                                                   registers of directly. Owned
+                                                                   by the DEVIO. NULL if the
+                                                                   device can't be shared */
     char *broker;                                               /* Endpoint to connect to broker */
     char *service;                                              /* (part of) the service name to be exported */
     int verbose;                                                /* Print trace information to stdout*/
     uint64_t base;                                              /* SMIO base address */
     uint32_t inst_id;                                           /* SMIO instance ID */
+    hutils_sched_t sched;                                       /* CPU placement of the thread */
+    const char *snapshot_dir;                                   /* Directory of the register
+                                                                   snapshots. NULL if none */
+    const char *trace_dir;                                      /* Directory of the request
+                                                                   traces. NULL if none */
+    uint64_t trace_max_size;                                    /* Size limit of each trace,
+                                                                   in bytes. 0 for none */
+    const char *cfg_file;                                       /* Configuration file. NULL
+                                                                   if none */
+    zloop_t *loop;                                              /* Reactor shared with other
+                                                                   SMIOs. NULL for a reactor
+                                                                   of its own */
+    devio_metrics_node_t *metrics;                              /* Load metrics of the SMIO.
+                                                                   Owned by the DEVIO. NULL
+                                                                   if none */
+    struct _smio_status_page_t *status;                         /* Status page of the DEVIO.
+                                                                   Owned by the DEVIO. NULL
+                                                                   if none */
+    zlistx_t *reqs;                                             /* Requests of a lazy SMIO
+                                                                   received before it was
+                                                                   spawned, served first.
+                                                                   Taken by the SMIO. NULL
+                                                                   if none */
+    struct _smio_startup_stats_t *startup;                      /* Startup phases of the SMIO.
+                                                                   Owned by the DEVIO. NULL
+                                                                   if none */
 } th_boot_args_t;
 
+/* Set "phase" of the smio_startup_stats_t "stats", if any, to the time
+ * since "start_us" (zclock_usecs ()). Phases are written by the DEVIO, SMIO
+ * and config threads, while the SMIO one might be reading them */
+#define SMIO_STARTUP_SET(stats, phase, start_us)                        \
+    do {                                                                \
+        if ((stats) != NULL) {                                          \
+            __atomic_store_n (&(stats)->phase,                          \
+                    (uint64_t) (zclock_usecs () - (start_us)), __ATOMIC_RELAXED); \
+        }                                                               \
+    } while (0)
+
 /***************** Our methods *****************/
 
 /* Creates a new instance of the SMIO */
@@ -122,11 +183,26 @@ smio_t *smio_new (th_boot_args_t *args, zsock_t *pipe_mgmt, zsock_t *pipe_msg,
         char *service);
 /* Destroy an instance of the Low-level I/O */
 smio_err_e smio_destroy (smio_t **self_p);
+/* Boot an SMIO, up to exporting its operations, on the reactor of its own
+ * or on the shared one in "args". Returns NULL on error */
+smio_t *smio_boot (th_boot_args_t *args, zsock_t *pipe_mgmt);
+/* Halt an SMIO booted with smio_boot () */
+void smio_halt (smio_t **self_p, th_boot_args_t *args);
 /* Loop through all interface sockets */
 smio_err_e smio_loop (smio_t *self);
+/* Start serving the client requests on a reactor shared with other SMIOs
+ * ("loop" boot argument), which the caller runs. Unlike smio_loop (), the
+ * management PIPE is left to the caller */
+smio_err_e smio_start (smio_t *self);
 /* Register SMIO */
 smio_err_e smio_register_sm (smio_t *self, uint32_t smio_id, uint64_t base,
         uint32_t inst_id);
+/* Write "data" to the register "offs" of the SMIO "smio_id" with our
+ * instance ID, e.g., the ACQ core of the same BPM. The parent DEVIO, which
+ * knows where the SMIO is, does the write, so it is posted: nothing tells
+ * if it was done. SMIOs not spawned are skipped */
+smio_err_e smio_sibling_write_32 (smio_t *self, uint32_t smio_id, uint64_t offs,
+        uint32_t data);
 
 smio_err_e smio_init_exp_ops (smio_t *self, disp_op_t** smio_exp_ops,
         const disp_table_func_fp *func_fps);
@@ -148,6 +224,10 @@ smio_err_e smio_set_name (smio_t *self, const char *name);
 const char *smio_get_name (smio_t *self);
 /* Clone SMIO name */
 char *smio_clone_name (smio_t *self);
+/* Get SMIO exported service name */
+const char *smio_get_service (smio_t *self);
+/* Get the configuration file the DEVIO was started with. NULL if none */
+const char *smio_get_cfg_file (smio_t *self);
 /* Set SMIO exported operations */
 smio_err_e smio_set_exp_ops (smio_t *self, const disp_op_t **exp_ops);
 /* Get SMIO exported operation */
@@ -167,10 +247,78 @@ smio_err_e smio_set_handler (smio_t *self, void *smio_handler);
 void *smio_get_handler (smio_t *self);
 /* Get SMIO Worker */
 mlm_client_t *smio_get_worker (smio_t *self);
+/* Mark the request being served as having changed a parameter. Called by
+ * the SET operations on success, so caching clients are told about it */
+void smio_set_param_changed (smio_t *self);
+/* Publish a SMIO_EVENT_SUBJECT_PARAM_CHANGED event for "opcode" if the
+ * request just served changed a parameter, clearing the mark */
+smio_err_e smio_publish_param_change (smio_t *self, uint32_t opcode);
+/* Set the service specific information of our directory registration, see
+ * SMIO_DIR_SERVICE. At most SMIO_DIR_INFO_MAX_SIZE bytes, copied. Must be
+ * set by the init operation to be sent */
+smio_err_e smio_set_dir_info (smio_t *self, const void *info, size_t size);
+/* Register our service, its exported operations and the information set
+ * by smio_set_dir_info () in the dev_mngr directory */
+smio_err_e smio_dir_register (smio_t *self);
+/* Remove our service from the dev_mngr directory */
+smio_err_e smio_dir_unregister (smio_t *self);
 /* Get SMIO PIPE Message */
 zsock_t *smio_get_pipe_msg (smio_t *self);
 /* Get SMIO PIPE Management */
 zsock_t *smio_get_pipe_mgmt (smio_t *self);
+/* Get SMIO register access ring. NULL if there is none */
+thsafe_ring_t *smio_get_thsafe_ring (smio_t *self);
+/* Get the device the SMIO thread accesses registers of directly, see
+ * smio_thsafe_client_direct_ops. NULL if there is none */
+llio_t *smio_get_direct_llio (smio_t *self);
+/* Get the status page of the DEVIO, where the SMIO updates its section, see
+ * sm_io_status_codes.h. NULL if there is none */
+struct _smio_status_page_t *smio_get_status_page (smio_t *self);
+/* Set the SMIO register writes posted or not. Posted writes return as soon
+ * as they are queued to the DEVIO, and their status is only known at the
+ * next fence, see smio_thsafe_client_fence (), or read. Without a ring,
+ * writes are always synchronous. Setting them back to synchronous fences
+ * the ones posted, returning SMIO_ERR_LLIO if any of them failed */
+smio_err_e smio_set_posted_writes (smio_t *self, bool posted);
+/* Get if SMIO register writes are posted */
+bool smio_get_posted_writes (smio_t *self);
+/* Set SMIO poll interval in msec. The "poll" operation is called
+ * every interval msec. 0 disables the poll timer */
+smio_err_e smio_set_poll_interval (smio_t *self, size_t interval);
+/* Add a periodic task, run by the SMIO loop between client requests, calling
+ * "task_fp" with the SMIO and "arg" every "period" msec. 0 adds it paused.
+ * Runs starting more than "jitter" msec late (0 for a whole period) are
+ * counted as overruns in the task statistics. Returns the task ID, or -1
+ * if there are already SMIO_TASKS_MAX tasks */
+int smio_add_task (smio_t *self, const char *name, size_t period,
+        size_t jitter, smio_task_fp task_fp, void *arg);
+/* Change the period of a task in msec. 0 pauses it */
+smio_err_e smio_set_task_period (smio_t *self, int task_id, size_t period);
+/* Remove a task */
+smio_err_e smio_remove_task (smio_t *self, int task_id);
+/* Get the run statistics of a task */
+smio_err_e smio_get_task_stats (smio_t *self, int task_id,
+        smio_task_stats_t *stats);
+/* Register "size" bytes of configuration registers starting at "offset"
+ * (relative to the SMIO base address) in the shadow register cache. Every
+ * access to these registers must then go through the cached read/write
+ * functions, so the cache is kept coherent with the hardware. Registers
+ * that might be changed by the hardware must not be cached */
+smio_err_e smio_add_cache_region (smio_t *self, uint64_t offset, size_t size);
+/* Invalidate a single cached register, so the next read goes to the hardware */
+void smio_invalidate_cache_reg (smio_t *self, uint64_t offs);
+/* Invalidate all cached registers, e.g., after a device reset */
+void smio_invalidate_cache (smio_t *self);
+/* Keep the shadow register cache in the snapshot file "path" for warm
+ * restarts (see smio_cache_map_snapshot ()). The registers the hardware
+ * still holds from the last run are valid in the cache right away, so
+ * writing them the same value again is skipped */
+smio_err_e smio_map_cache_snapshot (smio_t *self, const char *path);
+/* Record the requests received from now on in the trace file "path", up
+ * to "max_size" bytes (0 for no limit), to be replayed later, see
+ * sm_io_trace_codes.h. Records are written by the SMIO thread itself, as
+ * the requests arrive, through a buffer of SMIO_TRACE_BUF_SIZE bytes */
+smio_err_e smio_start_trace (smio_t *self, const char *path, uint64_t max_size);
 
 /************************************************************/
 /**************** Smio OPS generic methods API **************/
@@ -186,6 +334,8 @@ smio_err_e smio_export_ops (smio_t *self, const disp_op_t** smio_exp_ops);
 smio_err_e smio_unexport_ops (smio_t *self);
 /* Handle the operation */
 smio_err_e smio_do_op (void *owner, void *msg);
+/* Periodic handler */
+smio_err_e smio_poll (smio_t *self);
 
 /************************************************************/
 /***************** Thsafe generic methods API ***************/
@@ -214,6 +364,18 @@ ssize_t smio_thsafe_raw_client_write_16 (smio_t *self, uint64_t offs, const uint
 ssize_t smio_thsafe_raw_client_write_32 (smio_t *self, uint64_t offs, const uint32_t *data);
 ssize_t smio_thsafe_raw_client_write_64 (smio_t *self, uint64_t offs, const uint64_t *data);
 
+/* Read/Write data to device through the shadow register cache. Reads of
+ * cached registers with a valid value are served locally and writes update
+ * the cache. Registers outside of the cacheable regions are accessed as
+ * with smio_thsafe_client_read_32/smio_thsafe_client_write_32 */
+ssize_t smio_thsafe_client_cached_read_32 (smio_t *self, uint64_t offs, uint32_t *data);
+ssize_t smio_thsafe_client_cached_write_32 (smio_t *self, uint64_t offs, const uint32_t *data);
+/* Write data block to device through the shadow register cache, size in
+ * bytes. The write is skipped if the cache shows the hardware already holds
+ * all of the block */
+ssize_t smio_thsafe_client_cached_write_block (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data);
+
 /* Read data block from device, size in bytes */
 ssize_t smio_thsafe_client_read_block (smio_t *self, uint64_t offs, size_t size, uint32_t *data);
 /* Read data block from device, size in bytes, with raw address (no base address mangling) */
@@ -234,6 +396,30 @@ ssize_t smio_thsafe_client_write_dma (smio_t *self, uint64_t offs, size_t size,
 /* Write data block via DMA from device, size in bytes, with raw address (no base address mangling) */
 ssize_t smio_thsafe_raw_client_write_dma (smio_t *self, uint64_t offs, size_t size, const uint32_t *data);
 
+/* Execute a batch of register operations in a single request. The operations
+ * are executed in order by the DEVIO, without any other request in between.
+ * Runs of reads to consecutive registers are served with a single block read.
+ * Offsets are relative to the SMIO base address. Returns the number of bytes
+ * of operations executed or a negative number in case of error, in which
+ * case the operations before the failed one might have been executed */
+ssize_t smio_thsafe_client_batch (smio_t *self, thsafe_batch_op_t *ops, size_t num_ops);
+/* Execute a batch of register operations, with raw addresses (no base address mangling) */
+ssize_t smio_thsafe_raw_client_batch (smio_t *self, thsafe_batch_op_t *ops, size_t num_ops);
+
+/* Read "iovcnt" data blocks, up to THSAFE_BLOCKV_MAX_EXTS and
+ * ZMQ_SERVER_BLOCK_SIZE bytes in total, in a single request. The DEVIO moves
+ * them in a single transfer if the device can, e.g., with a DMA chain.
+ * Offsets are relative to the SMIO base address. Returns the total number
+ * of bytes read or a negative number in case of error */
+ssize_t smio_thsafe_client_read_blockv (smio_t *self, const llio_iov_t *iov, size_t iovcnt);
+/* Read data blocks in a single request, with raw addresses (no base address mangling) */
+ssize_t smio_thsafe_raw_client_read_blockv (smio_t *self, const llio_iov_t *iov, size_t iovcnt);
+
+/* Wait for the completion of the writes posted so far. Returns 0 or a
+ * negative number if any of them failed. Reads, and block, DMA and batch
+ * operations, wait for them as well, failing in that case */
+ssize_t smio_thsafe_client_fence (smio_t *self);
+
 /* Read device information */
 /* int smio_thsafe_client_read_info (smio_t *self, llio_dev_info_t *dev_info) */
 
@@ -12,6 +12,8 @@
 extern "C" {
 #endif
 
+struct _smio_startup_stats_t;
+
 /* Create instance of sm_io function pointer. This tells how to create
  * such an object */
 typedef smio_err_e (*smio_init_fp)(smio_t *self);
@@ -36,6 +38,9 @@ typedef struct {
     char *broker;                                               /* Endpoint to connect to broker */
     char *service;                                              /* Full name of the exported service */
     char *log_file;                                             /* Thread log file */
+    struct _smio_startup_stats_t *startup;                      /* Startup phases of the SMIO.
+                                                                   Owned by the DEVIO. NULL
+                                                                   if none */
 } th_config_args_t;
 
 /************************************************************/
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SM_IO_CACHE_H_
+#define _SM_IO_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of cached register regions per SMIO */
+#define SMIO_CACHE_MAX_REGIONS              8
+/* Maximum size of a single cached register region, in bytes */
+#define SMIO_CACHE_MAX_REGION_SIZE          4096
+
+typedef struct _smio_cache_t smio_cache_t;
+
+/* Reads the register at "offset" from the hardware. Returns the number of
+ * bytes read */
+typedef ssize_t (*smio_cache_read_fp) (void *owner, uint64_t offset, uint32_t *value);
+
+/***************** Our methods *****************/
+
+/* Creates a new instance of the shadow register cache */
+smio_cache_t *smio_cache_new (void);
+/* Destroy an instance of the shadow register cache */
+smio_err_e smio_cache_destroy (smio_cache_t **self_p);
+/* Mark "size" bytes of 32-bit registers starting at "offset" as cacheable.
+ * Only registers that are not changed by the hardware should be cached */
+smio_err_e smio_cache_add_region (smio_cache_t *self, uint64_t offset, size_t size);
+/* Check if the register at "offset" is cacheable */
+bool smio_cache_is_cached (smio_cache_t *self, uint64_t offset);
+/* Look up the register at "offset". Returns true and sets "value" if the
+ * register has a valid cached value, false otherwise */
+bool smio_cache_lookup (smio_cache_t *self, uint64_t offset, uint32_t *value);
+/* Update the cached value of the register at "offset". Registers outside
+ * of the cacheable regions are silently ignored */
+void smio_cache_update (smio_cache_t *self, uint64_t offset, uint32_t value);
+/* Invalidate the cached value of the register at "offset" */
+void smio_cache_invalidate (smio_cache_t *self, uint64_t offset);
+/* Invalidate all of the cached values */
+void smio_cache_invalidate_all (smio_cache_t *self);
+/* Keep the cached values in the snapshot file "path", so they outlive the
+ * process. Must be called after all of the regions are added. If "path"
+ * holds a snapshot of the same regions, each of its valid registers is
+ * read back with "read_fp" and kept only if the hardware still holds the
+ * same value. "num_warm" is set to the number of registers kept. Otherwise
+ * the file is started anew and "num_warm" is 0 */
+smio_err_e smio_cache_map_snapshot (smio_cache_t *self, const char *path,
+        smio_cache_read_fp read_fp, void *owner, uint32_t *num_warm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
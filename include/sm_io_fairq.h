@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SM_IO_FAIRQ_H_
+#define _SM_IO_FAIRQ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _smio_queue_stats_t;
+
+/* Maximum number of requests waiting from a single sender. Requests
+ * beyond that are rejected */
+#define SMIO_FAIRQ_SENDER_DEPTH_MAX         64
+/* Most requests answered with the reply of a single identical one, see
+ * smio_fairq_take_identical () */
+#define SMIO_FAIRQ_SHARED_MAX               64
+/* Idle senders are forgotten once there are more than this */
+#define SMIO_FAIRQ_SENDERS_GC               256
+
+/* Requests waiting to be served, queued by sender. See
+ * SMIO_OPCODE_SET_GET_RATE_LIMIT */
+typedef struct _smio_fairq_t smio_fairq_t;
+
+/* Called from the loop when a sender held back by the rate limit might be
+ * served again */
+typedef void (*smio_fairq_wake_fp) (void *owner);
+
+/* Request waiting in the queue, with its envelope */
+typedef struct {
+    zmsg_t *msg;                        /* Request frames */
+    char *sender;                       /* Sender address, or client identity on
+                                           the local fast path */
+    char *subject;                      /* Request subject */
+    char *tracker;                      /* Request tracker */
+    zsock_t *local_sock;                /* Local fast path socket. NULL if the
+                                           request came through the broker */
+    zframe_t *reply_to;                 /* Client identity on the local fast path */
+    bool throttled;                     /* Held back by the rate limit already */
+} smio_fairq_req_t;
+
+/***************** Our methods *****************/
+
+/* Creates a new request queue. "wake_fp" is called with "owner" from
+ * "loop" */
+smio_fairq_t *smio_fairq_new (zloop_t *loop, smio_fairq_wake_fp wake_fp,
+        void *owner);
+/* Destroy a request queue, dropping the requests waiting */
+smio_err_e smio_fairq_destroy (smio_fairq_t **self_p);
+/* Queue "*req_p", taking ownership of it. Returns SMIO_ERR_ALLOC, leaving
+ * the request to the caller, if its sender has too many requests waiting.
+ * A write sent with RW_REQ_COALESCE_SUBJECT takes the place of the one of
+ * its sender to the same parameter still waiting, if any, which is then
+ * given to the caller in "*superseded_p" to be answered. It is set to NULL
+ * otherwise */
+smio_err_e smio_fairq_push (smio_fairq_t *self, smio_fairq_req_t **req_p,
+        smio_fairq_req_t **superseded_p);
+/* Take the next request to serve, from the senders in turns. Returns NULL
+ * if there is none, or if the senders waiting are held back by the rate
+ * limit. "wake_fp" is called when these might be served */
+smio_fairq_req_t *smio_fairq_pop (smio_fairq_t *self);
+/* Take up to "max" requests identical to "req", just taken from the queue,
+ * into "identical", if it was sent with RW_REQ_SHARED_SUBJECT, so they are
+ * answered with its reply. Only the first request waiting of each sender
+ * is looked at, and no more than SMIO_FAIRQ_SHARED_MAX are taken. Returns
+ * the number of requests taken */
+size_t smio_fairq_take_identical (smio_fairq_t *self, const smio_fairq_req_t *req,
+        smio_fairq_req_t **identical, size_t max);
+/* Set the requests per second allowed to each sender. 0 for no limit */
+void smio_fairq_set_rate_limit (smio_fairq_t *self, uint32_t rate_limit);
+/* Get the requests per second allowed to each sender */
+uint32_t smio_fairq_get_rate_limit (smio_fairq_t *self);
+/* Get the queue counters, resetting them afterwards if "reset" is set */
+void smio_fairq_get_stats (smio_fairq_t *self, struct _smio_queue_stats_t *stats,
+        bool reset);
+
+/* Destroy a request */
+void smio_fairq_req_destroy (smio_fairq_req_t **self_p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SM_IO_REACTOR_H_
+#define _SM_IO_REACTOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of SMIOs per reactor */
+#define SMIO_REACTOR_MAX_SMIOS              32
+
+/* Thread running the reactor of several SMIOs, instead of one thread per
+ * SMIO. An SMIO stays on the reactor it was added to, so its requests are
+ * still served one at a time and in order. While one of them is served,
+ * the other SMIOs of the reactor wait. A reactor might be shared by several
+ * DEVIOs, each adding and removing its SMIOs from its own thread */
+typedef struct _smio_reactor_t smio_reactor_t;
+
+/***************** Our methods *****************/
+
+/* Creates a new reactor thread, named "name" in the logs, with the CPU
+ * placement "sched" */
+smio_reactor_t *smio_reactor_new (const char *name, const hutils_sched_t *sched);
+/* Destroy a reactor thread. Its SMIOs must have been removed before */
+smio_err_e smio_reactor_destroy (smio_reactor_t **self_p);
+/* Boot an SMIO on the reactor, as smio_startup () does on a thread of its
+ * own. The reactor takes ownership of "args" on success. Returns the
+ * management PIPE to the SMIO, the counterpart of the pipe of an SMIO actor,
+ * or NULL on error */
+zsock_t *smio_reactor_add (smio_reactor_t *self, th_boot_args_t *args);
+/* Halt the SMIO of the management PIPE "pipe_mgmt_p", returned by
+ * smio_reactor_add (), and destroy the PIPE, as zactor_destroy () does for
+ * an SMIO actor */
+void smio_reactor_remove (smio_reactor_t *self, zsock_t **pipe_mgmt_p);
+/* Number of SMIOs on the reactor */
+uint32_t smio_reactor_get_nsmios (smio_reactor_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SM_IO_TASKS_H_
+#define _SM_IO_TASKS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of periodic tasks per SMIO */
+#define SMIO_TASKS_MAX                      8
+/* Maximum task name length, including the terminating null character */
+#define SMIO_TASK_NAME_MAX                  32
+
+typedef struct _smio_tasks_t smio_tasks_t;
+
+/* Periodic task. Tasks run in the owner thread, between the client requests,
+ * so they must do a bounded amount of work on each run */
+typedef smio_err_e (*smio_task_fp) (void *owner, void *arg);
+
+/* Task run statistics */
+typedef struct {
+    uint64_t runs;                      /* Number of runs */
+    uint64_t errors;                    /* Runs that returned an error */
+    uint64_t overruns;                  /* Runs started later than the jitter budget */
+    uint64_t max_late;                  /* Largest delay of a run, in msec */
+    uint64_t max_duration;              /* Longest run, in usec */
+} smio_task_stats_t;
+
+/***************** Our methods *****************/
+
+/* Creates a new set of periodic tasks run by "loop". "owner" is passed
+ * to every task */
+smio_tasks_t *smio_tasks_new (zloop_t *loop, void *owner);
+/* Destroy a set of periodic tasks, stopping all of them */
+smio_err_e smio_tasks_destroy (smio_tasks_t **self_p);
+/* Add a task calling "task_fp" every "period" msec, 0 adding it paused.
+ * A run starting more than "jitter" msec after it was due is counted as an
+ * overrun, 0 meaning a whole period. Returns the task ID or -1 on error */
+int smio_tasks_add (smio_tasks_t *self, const char *name, size_t period,
+        size_t jitter, smio_task_fp task_fp, void *arg);
+/* Change the period of a task, restarting it. 0 pauses the task. This is
+ * safe to call from the task itself */
+smio_err_e smio_tasks_set_period (smio_tasks_t *self, int task_id, size_t period);
+/* Remove a task. This is safe to call from the task itself */
+smio_err_e smio_tasks_remove (smio_tasks_t *self, int task_id);
+/* Get the run statistics of a task */
+smio_err_e smio_tasks_get_stats (smio_tasks_t *self, int task_id,
+        smio_task_stats_t *stats);
+/* Print the run statistics of all of the tasks that ran */
+void smio_tasks_print_stats (smio_tasks_t *self, const char *owner_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
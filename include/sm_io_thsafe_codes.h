@@ -46,9 +46,53 @@ extern "C" {
 #define THSAFE_NAME_READ_DMA                "read_dma"
 #define THSAFE_OPCODE_WRITE_DMA             11
 #define THSAFE_NAME_WRITE_DMA               "write_dma"
-//#define THSAFE_OPCODE_READ_INFO           12
-#define THSAFE_OPCODE_END                   12
-//#define THSAFE_OPCODE_END                 13
+#define THSAFE_OPCODE_BATCH                 12
+#define THSAFE_NAME_BATCH                   "batch"
+#define THSAFE_OPCODE_READ_BLOCKV           13
+#define THSAFE_NAME_READ_BLOCKV             "read_blockv"
+//#define THSAFE_OPCODE_READ_INFO           14
+#define THSAFE_OPCODE_END                   14
+//#define THSAFE_OPCODE_END                 15
+
+/* Batch operation codes. All of the operations are 32-bit wide */
+#define THSAFE_BATCH_OP_READ_32             0
+#define THSAFE_BATCH_OP_WRITE_32            1
+/* Read-modify-write: reg = (reg & ~mask) | (value & mask) */
+#define THSAFE_BATCH_OP_WRITE_MASK_32       2
+/* Poll until (reg & mask) == value. Fails the batch if that does not happen
+ * within THSAFE_BATCH_POLL_TIMEOUT_US */
+#define THSAFE_BATCH_OP_POLL_32             3
+#define THSAFE_BATCH_OP_END                 4
+
+/* POLL_32 timeout */
+#define THSAFE_BATCH_POLL_TIMEOUT_US        10000
+
+/* Maximum number of operations in a single batch */
+#define THSAFE_BATCH_MAX_OPS                256
+/* Runs of READ_32 operations to consecutive registers are served by the
+ * DEVIO with a single block read of up to this many registers */
+#define THSAFE_BATCH_COMBINE_MAX            64
+
+/* Single operation of a batch. The batch is executed in order and
+ * the "value" field is updated with the register contents read (READ_32,
+ * the last one read for POLL_32) or written (WRITE_32/WRITE_MASK_32) */
+typedef struct {
+    uint64_t offset;                        /* Register offset */
+    uint32_t op;                            /* THSAFE_BATCH_OP_* */
+    uint32_t value;                         /* Value to be written/read */
+    uint32_t mask;                          /* Bits affected by WRITE_MASK_32 */
+    uint32_t reserved;
+} thsafe_batch_op_t;
+
+/* Maximum number of extents of a single vectored read */
+#define THSAFE_BLOCKV_MAX_EXTS              64
+
+/* Extent of a vectored read. The data of all of the extents is replied in
+ * order, in a single frame */
+typedef struct {
+    uint64_t offset;                        /* Block offset */
+    uint64_t size;                          /* Block size, in bytes */
+} thsafe_blockv_ext_t;
 
 /* Messaging Reply OPCODES */
 #define THSAFE_REPLY_TYPE                   uint32_t
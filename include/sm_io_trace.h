@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SM_IO_TRACE_H_
+#define _SM_IO_TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of the write buffer of a trace. Records are written to the file
+ * once it fills up, so the SMIO thread does a write syscall only every
+ * so many requests */
+#define SMIO_TRACE_BUF_SIZE                 (64 << 10)  /* in bytes */
+
+/* Trace of the requests received by an SMIO, see sm_io_trace_codes.h for
+ * the file format */
+typedef struct _smio_trace_t smio_trace_t;
+
+/***************** Our methods *****************/
+
+/* Creates a new trace of "service" at "path", truncating it. Requests stop
+ * being recorded once the file reaches "max_size" bytes (0 for no limit) */
+smio_trace_t *smio_trace_new (const char *path, const char *service,
+        uint64_t max_size);
+/* Destroy a trace, writing the records still buffered */
+smio_err_e smio_trace_destroy (smio_trace_t **self_p);
+/* Record the request "req", just received, with its arrival time. The
+ * request is not changed */
+smio_err_e smio_trace_record (smio_trace_t *self, const smio_fairq_req_t *req);
+/* Get the number of requests recorded and the number of the ones left out
+ * for the size limit */
+void smio_trace_get_stats (smio_trace_t *self, uint64_t *num_recs,
+        uint64_t *num_dropped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -68,6 +68,20 @@ typedef struct {
                                                      parameter size in bytes */
 } smpr_proto_ops_t;
 
+/* Transfer completion wait. Busy polls while the transfer is expected to be
+ * still in flight, then sleeps with an exponential backoff until the
+ * timeout */
+#define SMPR_WAIT_SPIN_MARGIN_NS            2000    /* Added to the expected time */
+#define SMPR_WAIT_SLEEP_MIN_US              10
+#define SMPR_WAIT_SLEEP_MAX_US              1000
+
+typedef struct {
+    uint64_t start_ns;                  /* Time the wait started */
+    uint64_t spin_ns;                   /* Busy poll for this long */
+    uint64_t timeout_ns;                /* Give up after this long */
+    uint32_t sleep_us;                  /* Next backoff sleep */
+} smpr_wait_t;
+
 /***************** Our methods *****************/
 
 /* Creates a new instance of the Low-level I/O */
@@ -82,6 +96,11 @@ void *smpr_get_handler (smpr_t *self);
 void *smpr_unset_handler (smpr_t *self);
 /* Get parent handler */
 smio_t *smpr_get_parent (smpr_t *self);
+/* Start waiting for a transfer expected to take "expected_ns" */
+void smpr_wait_init (smpr_wait_t *self, uint64_t expected_ns, uint64_t timeout_ns);
+/* Wait before polling the transfer status again. Returns false if the
+ * timeout has expired */
+bool smpr_wait_next (smpr_wait_t *self);
 
 /************************************************************/
 /***************** Thsafe generic methods API ***************/
@@ -15,6 +15,9 @@ extern "C" {
 /* For use by llio_t general structure */
 extern const smpr_proto_ops_t smpr_proto_ops_bsmp;
 
+/* Maximum number of variables of a pipelined read or of a group */
+#define SMPR_BSMP_PIPELINE_MAX              16
+
 /***************** SMPR proto BSMP methods ************************************/
 
 /* Read/Write to RFFE vars by ID */
@@ -22,6 +25,20 @@ smpr_err_e smpr_bsmp_read_var_by_id (smpr_t *self, uint32_t id, uint8_t *data,
         size_t size);
 smpr_err_e smpr_bsmp_write_var_by_id (smpr_t *self, uint32_t id, uint8_t *data,
         size_t size);
+/* Read several RFFE vars by ID with a single round trip to the server. The
+ * value of ids [i] goes to data [i], which can hold "size" bytes */
+smpr_err_e smpr_bsmp_read_vars_by_id (smpr_t *self, const uint32_t *ids,
+        uint8_t **data, size_t size, size_t num_ids);
+/* Create a group of RFFE vars, to be read in a single transaction with
+ * smpr_bsmp_read_group_by_id (). The group ID is returned in "group_id" */
+smpr_err_e smpr_bsmp_create_group (smpr_t *self, const uint32_t *ids,
+        size_t num_ids, uint32_t *group_id);
+/* Remove all of the groups created with smpr_bsmp_create_group () */
+smpr_err_e smpr_bsmp_remove_groups (smpr_t *self);
+/* Read RFFE group by ID. The value of the i-th variable of the group goes to
+ * data [i], which can hold "size" bytes */
+smpr_err_e smpr_bsmp_read_group_by_id (smpr_t *self, uint32_t id,
+        uint8_t **data, size_t size, size_t num_vars);
 /* Call RFFE functions by ID */
 smpr_err_e smpr_bsmp_func_exec_by_id (smpr_t *self, uint32_t id, uint8_t *write_data,
         size_t write_size, uint8_t *read_data, size_t read_size);
@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SMIO_THSAFE_DIRECT_CLIENT_H_
+#define _SMIO_THSAFE_DIRECT_CLIENT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* For use by smio_t general structure. Single register accesses are done by
+ * the SMIO thread on the device of the DEVIO, when it can be shared among
+ * threads (see llio_get_mt_safe), e.g., the PCIe BARs mapped by the DEVIO.
+ * Otherwise, e.g., for Ethernet devices, they go through the SMIO ring. The
+ * remaining operations go to the DEVIO as with smio_thsafe_client_ring_ops */
+extern const smio_thsafe_client_ops_t smio_thsafe_client_direct_ops;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SMIO_THSAFE_RING_H_
+#define _SMIO_THSAFE_RING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lock-free single-producer (SMIO thread) / single-consumer (DEVIO thread)
+ * ring of fixed size slots, used for single register accesses. Requests are
+ * signalled to the DEVIO with an eventfd doorbell, so it can be polled by
+ * the DEVIO reactor alongside the zeroMQ sockets. Control and bulk
+ * operations (open/release, blocks, DMA and batches) still go through
+ * the zeroMQ PIPEs.
+ *
+ * Writes might also be posted: the producer goes on without waiting for
+ * them and the consumer counts the ones that failed. The count is returned,
+ * and cleared, by the next fence or synchronous call */
+
+/* Number of slots. Must be a power of 2 */
+#define THSAFE_RING_NUM_SLOTS               64
+/* Number of times the producer checks for the reply before sleeping
+ * on the reply doorbell */
+#define THSAFE_RING_SPIN_TRIES              2048
+
+typedef struct {
+    uint32_t opcode;                    /* THSAFE_OPCODE_<READ|WRITE>_<16|32|64> */
+    int32_t ret;                        /* Return code of the operation, filled
+                                           by the consumer */
+    uint64_t offset;                    /* Register offset */
+    uint64_t data;                      /* Data to be written or data read */
+    bool posted;                        /* Nobody waits for the completion.
+                                           Failures are counted by the
+                                           consumer instead */
+} thsafe_ring_slot_t;
+
+/* Execute the operation described by the slot and fill its return
+ * code/data */
+typedef void (*thsafe_ring_exec_fp) (void *owner, thsafe_ring_slot_t *slot);
+
+/***************** Our methods *****************/
+
+/* Creates a new instance of the register access ring */
+thsafe_ring_t *thsafe_ring_new (void);
+/* Destroy an instance of the register access ring */
+msg_err_e thsafe_ring_destroy (thsafe_ring_t **self_p);
+/* Get the request doorbell file descriptor. This becomes readable
+ * when there are requests to be consumed */
+int thsafe_ring_get_fd (thsafe_ring_t *self);
+
+/* Producer side. Submit a request and wait for its completion. "data" holds
+ * the data to be written and receives the data read. Returns the operation
+ * return code or -1 in case of error, also if any of the writes posted
+ * before it failed */
+ssize_t thsafe_ring_call (thsafe_ring_t *self, uint32_t opcode, uint64_t offset,
+        uint64_t *data);
+/* Producer side. Submit a write request without waiting for its completion.
+ * Returns 0 if the request was submitted or -1 in case of error */
+ssize_t thsafe_ring_post (thsafe_ring_t *self, uint32_t opcode, uint64_t offset,
+        uint64_t data);
+/* Producer side. Wait for the completion of all of the requests submitted.
+ * Returns 0 or -1 if any of the writes posted since the last fence or
+ * synchronous call failed */
+ssize_t thsafe_ring_fence (thsafe_ring_t *self);
+
+/* Consumer side. Execute all of the pending requests with "exec_fp" and
+ * notify the producer */
+msg_err_e thsafe_ring_consume (thsafe_ring_t *self, thsafe_ring_exec_fp exec_fp,
+        void *owner);
+
+/* DEVIO side executor of ring requests, for use with thsafe_ring_consume () */
+void smio_thsafe_ring_server_exec (void *owner, thsafe_ring_slot_t *slot);
+
+/* For use by smio_t general structure. Single register accesses go through
+ * the SMIO ring, if any, and the remaining operations through zeroMQ */
+extern const smio_thsafe_client_ops_t smio_thsafe_client_ring_ops;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
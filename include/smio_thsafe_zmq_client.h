@@ -15,6 +15,21 @@ extern "C" {
 /* For use by smio_t general structure */
 extern const smio_thsafe_client_ops_t smio_thsafe_client_zmq_ops;
 
+/* Individual operations, so other thsafe clients can reuse them */
+int thsafe_zmq_client_open (smio_t *self, llio_endpoint_t *endpoint);
+int thsafe_zmq_client_release (smio_t *self, llio_endpoint_t *endpoint);
+ssize_t thsafe_zmq_client_read_block (smio_t *self, uint64_t offs, size_t size,
+        uint32_t *data);
+ssize_t thsafe_zmq_client_write_block (smio_t *self, uint64_t offs, size_t size,
+        const uint32_t *data);
+ssize_t thsafe_zmq_client_read_dma (smio_t *self, uint64_t offs, size_t size,
+        uint32_t *data);
+ssize_t thsafe_zmq_client_write_dma (smio_t *self, uint64_t offs, size_t size,
+        const uint32_t *data);
+ssize_t thsafe_zmq_client_batch (smio_t *self, thsafe_batch_op_t *ops, size_t num_ops);
+ssize_t thsafe_zmq_client_read_blockv (smio_t *self, const llio_iov_t *iov,
+        size_t iovcnt);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,14 @@ typedef struct {
     uint8_t data[ZMQ_SERVER_BLOCK_SIZE];
 } zmq_server_data_block_t;
 
+typedef struct {
+    thsafe_batch_op_t ops[THSAFE_BATCH_MAX_OPS];
+} zmq_server_batch_t;
+
+typedef struct {
+    thsafe_blockv_ext_t exts[THSAFE_BLOCKV_MAX_EXTS];
+} zmq_server_blockv_t;
+
 /* For use by smio_t general structure */
 extern const disp_op_t *smio_thsafe_zmq_server_ops [];
 
@@ -20,6 +20,12 @@ struct _zmq_server_args_t {
     uint32_t tag;
     zmsg_t **msg;
     void *reply_to;
+    /* Filled by msg_handle_sock_request (), so the request can be
+     * replied to after the handler returns. See msg_defer_reply () */
+    uint32_t opcode;
+    uint64_t start_ns;
+    msg_stats_t *stats;
+    bool deferred;
 };
 
 /* SMIO THSAFE ZMQ server function arguments macros */
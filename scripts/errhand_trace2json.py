@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2015 LNLS (www.lnls.br)
+#
+# Released according to the GNU GPL, version 3 or any later version.
+#
+# Convert liberrhand trace files (see errhand_print.h) to the Chrome trace
+# event format, viewable with chrome://tracing or Perfetto.
+#
+# Usage: errhand_trace2json.py [-o out.json] trace.<pid> [trace.<pid> ...]
+#
+# Give the trace files of all the processes involved (clients, DEVIOs) to
+# follow requests across them. Stages of the same request are linked with
+# flow arrows. Stages recorded without a request id (DEVIO ones) get the id
+# of the thsafe stage of the same process they fall in.
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+MAGIC = b"ERRTRCE\0"
+REC_FMT = 0
+REC_EVENT = 1
+REC_STAGE = 2
+PHASE_BEGIN = 0
+PHASE_END = 1
+
+FILE_HDR = struct.Struct("=8sII")
+REC_HDR = struct.Struct("=II")
+FMT_REC = struct.Struct("=IIII")
+EVENT_REC = struct.Struct("=IIQIIII4Q")
+
+
+def read_trace(path):
+    """Yield (type, name, timestamp, tid, dbg, args) for each record"""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    magic, version, hdr_size = FILE_HDR.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError("%s: not a trace file" % path)
+    if version != 1:
+        raise ValueError("%s: unsupported version %u" % (path, version))
+
+    fmts = {}
+    offs = hdr_size
+    while offs + REC_HDR.size <= len(data):
+        rec_type, rec_id = REC_HDR.unpack_from(data, offs)
+        if rec_type == REC_FMT:
+            _, _, length, _ = FMT_REC.unpack_from(data, offs)
+            offs += FMT_REC.size
+            fmts[rec_id] = data[offs:offs + length].split(b"\0")[0].decode(
+                "utf-8", "replace")
+            offs += length
+        elif rec_type in (REC_EVENT, REC_STAGE):
+            if offs + EVENT_REC.size > len(data):
+                break   # Truncated by a crash
+            (_, _, ts, tid, dbg, num_args, _,
+                a0, a1, a2, a3) = EVENT_REC.unpack_from(data, offs)
+            offs += EVENT_REC.size
+            yield (rec_type, fmts.get(rec_id, "?"), ts, tid, dbg,
+                   [a0, a1, a2, a3][:num_args])
+        else:
+            raise ValueError("%s: bad record type %u at offset %u" %
+                             (path, rec_type, offs))
+
+
+def file_pid(path, index):
+    """errhand_set_log () names trace files <prefix>.<pid>"""
+    ext = os.path.splitext(path)[1][1:]
+    return int(ext) if ext.isdigit() else index
+
+
+def attribute_requests(stages):
+    """Give the stages without a request id the id of the thsafe stage, of
+    another thread of the same process, they started in"""
+    thsafe = {}
+    for s in stages:
+        if s["name"].startswith("thsafe") and s["req"] != 0:
+            thsafe.setdefault(s["pid"], []).append(s)
+
+    for s in stages:
+        if s["req"] != 0:
+            continue
+        for t in thsafe.get(s["pid"], []):
+            if t["tid"] != s["tid"] and t["begin"] <= s["begin"] <= t["end"]:
+                s["req"] = t["req"]
+                break
+
+
+def convert(paths):
+    events = []
+    stages = []
+
+    for index, path in enumerate(paths):
+        pid = file_pid(path, index)
+        open_stages = {}
+        for rec_type, name, ts, tid, dbg, args in read_trace(path):
+            if rec_type == REC_EVENT:
+                events.append({"name": name.strip(), "ph": "i", "s": "t",
+                               "ts": ts / 1000.0, "pid": pid, "tid": tid,
+                               "args": {"dbg": hex(dbg), "args": args}})
+                continue
+
+            req, phase = args[0], args[1]
+            stack = open_stages.setdefault(tid, [])
+            if phase == PHASE_BEGIN:
+                stack.append({"name": name, "pid": pid, "tid": tid,
+                              "req": req, "begin": ts, "end": None})
+            elif stack:
+                # The end of a stage might not repeat its name (thsafe)
+                stage = stack.pop()
+                stage["end"] = ts
+                stages.append(stage)
+
+    attribute_requests(stages)
+
+    flows = {}
+    for s in stages:
+        args = {"req": "%016x" % s["req"]} if s["req"] != 0 else {}
+        events.append({"name": s["name"], "ph": "X", "ts": s["begin"] / 1000.0,
+                       "dur": (s["end"] - s["begin"]) / 1000.0,
+                       "pid": s["pid"], "tid": s["tid"], "args": args})
+        if s["req"] != 0:
+            flows.setdefault(s["req"], []).append(s)
+
+    # Link the stages of each request, in time order
+    for req, req_stages in flows.items():
+        req_stages.sort(key=lambda s: s["begin"])
+        if len(req_stages) < 2:
+            continue
+        for i, s in enumerate(req_stages):
+            ph = "s" if i == 0 else ("f" if i == len(req_stages) - 1 else "t")
+            events.append({"name": "request", "cat": "request", "ph": ph,
+                           "id": "%016x" % req, "bp": "e",
+                           "ts": s["begin"] / 1000.0, "pid": s["pid"],
+                           "tid": s["tid"]})
+
+    return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert liberrhand trace "
+                                     "files to Chrome trace JSON")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    parser.add_argument("traces", nargs="+", help="trace files")
+    opts = parser.parse_args()
+
+    trace = convert(opts.traces)
+    out = open(opts.output, "w") if opts.output else sys.stdout
+    json.dump(trace, out)
+    out.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -6,7 +6,9 @@
  */
 
 #include <libgen.h>
+#include <signal.h>
 #include "bpm_server.h"
+#include "hw/wb_afc_diag_regs.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
 #ifdef ASSERT_TEST
@@ -47,30 +49,103 @@
 /* Arbitrary hard limit for the maximum number of AFE DEVIOs
  * for each DBE DEVIO */
 #define DEVIO_MAX_FE_DEVIOS             16
+/* Arbitrary hard limit for the maximum number of boards managed by
+ * a single DEVIO process */
+#define DEVIO_MAX_BOARDS                12
+/* Separator of the device entry and ID lists */
+#define DEVIO_BOARD_LIST_SEP            ","
 
 #define DEVIO_SERVICE_LEN               50
 #define DEVIO_NAME                      "/usr/local/bin/ebpm"
-#define DEVIO_CFG_NAME                  "/usr/local/bin/ebpm_cfg"
-#define DEVIO_CFG_TIMEOUT               5000       /* in ms */
+/* Name of the LLIO the slot number is read with */
+#define DEVIO_CARD_SLOT_LLIO_NAME       "card_slot_llio"
 #define EPICS_PROCSERV_NAME             "/usr/local/bin/procServ"
 #define EPICS_BPM_RUN_SCRIPT_NAME       "./run.sh"
 
-#define DEVIO_LIBBPMCLIENT_LOG_MODE    "a"
-#define DEVIO_KILL_CFG_SIGNAL       SIGINT
-
+/* FMC SMIOs, selected by the "fmc_board" hint */
+#define FMC130M_4CH_NAME                "fmc130m_4ch"
+#define FMC250M_4CH_NAME                "fmc250m_4ch"
+#define FMC130M_4CH_SMIO_ID             0x7085ef15
+#define FMC250M_4CH_SMIO_ID             0x68e3b1af
+
+/* Interval in which the configuration file is checked for changes. A
+ * change is applied once the file stays the same for a whole interval,
+ * so a file being written is not read half way */
+#define EBPM_CFG_WATCH_INTERVAL         1000    /* in msec */
+
+/* Children spawned for an SMIO instance of a board. 0 if none */
+typedef struct {
+    pid_t rffe;                         /* RFFE DEVIO */
+    pid_t dbe_ioc;                      /* DBE EPICS IOC */
+    pid_t afe_ioc;                      /* AFE EPICS IOC */
+} ebpm_chld_t;
+
+/* Board managed by this process. Each one has a DEVIO of its own, with
+ * its own LLIO */
+typedef struct {
+    char *dev_entry;                    /* Device entry */
+    char *dev_id_str;                   /* Device ID. NULL if not given */
+    uint32_t dev_id;                    /* Device ID in use */
+    devio_t *devio;                     /* DEVIO instance */
+    zactor_t *server;                   /* DEVIO thread */
+    bool ready;                         /* All of its SMIOs are configured */
+    bool handed_off;                    /* Its SMIOs were taken over by a new
+                                           process */
+    ebpm_chld_t chld [DEVIO_MAX_FE_DEVIOS];
+                                        /* Children of each instance. Unknown
+                                           if the DEVIO took over */
+} ebpm_board_t;
+
+static int _parse_boards (ebpm_board_t *boards, const char *dev_entries,
+        const char *dev_ids);
+static int _split_list (const char *list, char **items, int max_items);
+static devio_err_e _get_dev_id (ebpm_board_t *board, llio_type_e llio_type);
+#if defined (__BOARD_AFCV3__) && (__WITH_APP_CFG__)
+static devio_err_e _get_card_slot (ebpm_board_t *board, llio_type_e llio_type,
+        devio_type_e devio_type);
+#endif
+static devio_err_e _board_new (ebpm_board_t *board, llio_type_e llio_type,
+        char *broker_endp, int verbose, char *log_filename, char *cfg_file,
+        zconfig_t *root_cfg, zhashx_t *hints, uint32_t nreactors,
+        hutils_sched_t *reactors_sched);
+static devio_err_e _share_smio_reactors (ebpm_board_t *boards, int nboards,
+        smio_reactor_t **reactors, uint32_t nreactors, const hutils_sched_t *sched);
 static devio_err_e _spawn_assoc_devios (devio_t *devio, uint32_t dev_id,
         devio_type_e devio_type, char *cfg_file, char *broker_endp,
-        char *log_prefix, zhashx_t *hints);
+        char *log_prefix, zhashx_t *hints, ebpm_chld_t *chld);
 static devio_err_e _spawn_rffe_devios (devio_t *devio, uint32_t dev_id,
-        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints);
+        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints,
+        ebpm_chld_t *chld);
 static devio_err_e _spawn_epics_iocs (devio_t *devio, uint32_t dev_id,
-        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints);
+        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints,
+        ebpm_chld_t *chld);
 static char *_create_log_filename (char *log_prefix, uint32_t dev_id,
         const char *devio_type, uint32_t smio_inst_id);
 static devio_err_e _spawn_platform_smios (void *pipe, devio_type_e devio_type,
         uint32_t smio_inst_id, zhashx_t *hints, uint32_t dev_id);
 static devio_err_e _spawn_be_platform_smios (void *pipe, zhashx_t *hints, uint32_t dev_id);
+static devio_err_e _spawn_fmc_smio (void *pipe, zhashx_t *hints, uint32_t dev_id,
+        uint32_t inst_id);
+static void _reload_cfg (ebpm_board_t *boards, int nboards, char *cfg_file,
+        char *broker_endp, char *log_prefix, zhashx_t **hints_p);
+static void _reload_board (ebpm_board_t *board, zhashx_t *old_hints,
+        zhashx_t *new_hints, char *cfg_file, char *broker_endp, char *log_prefix);
+static void _stop_fmc_smios (void *pipe);
+static void _stop_chld (pid_t *pid);
+static bool _hints_str_eq (const char *a, const char *b);
+static bool _sched_eq (const hutils_sched_t *a, const hutils_sched_t *b);
+static void _sched_merge (hutils_sched_t *dst, const hutils_sched_t *src);
+static devio_err_e _set_smio_prios (devio_t *devio, zconfig_t *root_cfg);
+static devio_err_e _set_smio_lazy (devio_t *devio, zconfig_t *root_cfg);
+static devio_err_e _set_scheds (devio_t *devio, zhashx_t *hints, uint32_t dev_id,
+        hutils_sched_t *reactors_sched);
+static devio_err_e _set_snapshot_dir (devio_t *devio, zconfig_t *root_cfg);
+static devio_err_e _set_metrics (devio_t *devio, zconfig_t *root_cfg);
+static devio_err_e _set_trace (devio_t *devio, zconfig_t *root_cfg);
+static devio_err_e _get_smio_reactors (zconfig_t *root_cfg, uint32_t *nreactors);
+static devio_err_e _set_rt (zconfig_t *root_cfg);
 static devio_err_e _spawn_fe_platform_smios (void *pipe, uint32_t smio_inst_id);
+static void _notify_dmngr_ready (void);
 
 static struct option long_options[] =
 {
@@ -104,10 +179,14 @@ void print_help (char *program_name)
             "  -w  --daemonworkdir <Work Directory> Daemon working directory.\n"
             "  -v  --verbose                        Verbose output\n"
             "  -n  --deviotype <[be|fe]>            Devio type\n"
-            "  -t  --devicetype <[eth|pcie]>        Device type\n"
+            "  -t  --devicetype <[eth|pcie|sim|vfio]>\n"
+            "                                       Device type\n"
             "  -e  --deviceentry <[ip_addr|/dev entry]>\n"
-            "                                       Device entry\n"
-            "  -i  --deviceid <Device ID>           Device ID\n"
+            "                                       Device entry. A comma separated\n"
+            "                                       list runs several boards (only\n"
+            "                                       valid with --deviotype = be)\n"
+            "  -i  --deviceid <Device ID>           Device ID. A comma separated list\n"
+            "                                       gives one for each device entry\n"
             "  -s  --fesmioid <FE SMIO ID> (only valid with --deviotype = fe)\n"
             "                                       FE SMIO ID\n"
             "  -l  --logprefix <Log prefix>         Log prefix filename\n",
@@ -130,6 +209,16 @@ int main (int argc, char *argv[])
     char *log_prefix = NULL;
     char *cfg_file = NULL;
     int opt;
+    devio_err_e err = DEVIO_SUCCESS;
+    ebpm_board_t boards [DEVIO_MAX_BOARDS] = {{0}};
+    int nboards = 0;
+    int i;
+    smio_reactor_t *smio_reactors [DEVIO_MAX_SMIO_REACTORS] = {NULL};
+    uint32_t nreactors = 0;
+    char *devio_log_filename = NULL;
+    zhashx_t *devio_hints = NULL;
+    zconfig_t *root_cfg = NULL;
+    zpoller_t *poller = NULL;
 
     while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
         /* Get the user selected options */
@@ -250,128 +339,48 @@ int main (int argc, char *argv[])
         goto err_exit;
     }
 
-    uint32_t dev_id = 0;
-    /* Check for device ID */
-    if (dev_id_str == NULL) {
-        switch (llio_type) {
-            case ETH_DEV:
-                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Dev_id parameter was not set. Exiting ...\n");
-                goto err_exit;
-                break;
-
-            case PCIE_DEV:
-                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Dev_id parameter was not set.\n"
-                        "\tDefaulting it to the /dev file number ...\n");
-
-                /* Our device follows the convention of having the ID in hexadecimal
-                 * code. For instance, /dev/fpga-0c00 would be a valid ID */
-                int matches = sscanf (dev_entry, "/dev/fpga-%u", &dev_id);
-                if (matches == 0) {
-                    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Dev_entry parameter is invalid.\n"
-                            "\tIt must be in the format \"/dev/fpga-<device_number>\". Exiting ...\n");
-                    goto err_exit;
-                }
-                break;
-
-            default:
-                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Dev_id parameter was not set. Exiting ...\n");
-                goto err_exit;
-        }
-    }
-    /* Use the passed ID, interpret it as hexadecimal number */
-    else {
-        dev_id = strtoul (dev_id_str, NULL, 10);
+    /* Several boards might be given, as lists of device entries and IDs */
+    nboards = _parse_boards (boards, dev_entry, dev_id_str);
+    if (nboards <= 0) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Dev_entry or dev_id "
+                "parameter is invalid\n");
+        goto err_exit;
     }
 
-    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Dev_id parameter was set to %u.\n",
-            dev_id);
+    /* FE DEVIOs are bound to a single FE SMIO */
+    if (nboards > 1 && devio_type != BE_DEVIO) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Only BE DEVIOs might "
+                "manage several boards\n");
+        goto err_boards;
+    }
 
     uint32_t fe_smio_id = 0;
     /* Check for FE SMIO ID */
     if (devio_type == FE_DEVIO && fe_smio_id_str == NULL) {
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Fe_smio_id parameter was not set. Exiting ...\n");
-        goto err_exit;
+        goto err_boards;
     }
     else {
         fe_smio_id = strtoul (fe_smio_id_str, NULL, 10);
     }
 
-    /* Spawn the Configure DEVIO to get the uTCA slot number. This is only
-     * available in AFCv3 */
-#if defined (__BOARD_AFCV3__) && (__WITH_APP_CFG__)
-    int child_devio_cfg_pid = 0;
-    if (llio_type == PCIE_DEV) {
-        /* Argument options are "process name", "device type" and
-         *"dev entry" */
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Spawing DEVIO Config\n");
-        char *argv_exec [] = {DEVIO_CFG_NAME, "-n", devio_type_str,"-t", dev_type,
-            "-i", dev_id_str, "-e", dev_entry, "-b", broker_endp, NULL};
-        /* Spawn Config DEVIO. */
-        /* We can't use devio_spawn_chld as DEVIO does not exist
-         * just yet. So, we stick with "hutils" implementation */
-        child_devio_cfg_pid = hutils_spawn_chld (DEVIO_CFG_NAME, argv_exec);
-
-        if (child_devio_cfg_pid < 0) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not create "
-                    "DEVIO Config instance\n");
-            goto err_exit;
-        }
-
-        /* FIXME: Wait for DEVIO CFG initialization. If we try to create a client instance
-         * prior to DEVIO CFG creation, Malamute does not transmit the message (To be investigated) */
-        sleep (2);
-    }
-
-    /* FE DEVIO is expected to have a correct dev_id. So, we don't need to get it
-     * from Hardware */
-    bpm_client_t *client_cfg = NULL;
-    if (devio_type == BE_DEVIO) {
-        /* At this point, the Config DEVIO is ready to receive our commands */
-        char devio_config_service_str [DEVIO_SERVICE_LEN];
-        snprintf (devio_config_service_str, DEVIO_SERVICE_LEN-1, "BPM%u:DEVIO_CFG:AFC_DIAG%u",
-                dev_id, 0);
-        devio_config_service_str [DEVIO_SERVICE_LEN-1] = '\0'; /* Just in case ... */
-
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Creating libclient for DEVIO config\n");
-        bpm_client_err_e client_err = BPM_CLIENT_SUCCESS;
-
-        /* Give DEVIO CFG some time more to answer (DEVIO_CFG_TIMEOUT) as it was just spawned... */
-        client_cfg = bpm_client_new_log_mode_time (broker_endp, 0,
-                "stdout", DEVIO_LIBBPMCLIENT_LOG_MODE, DEVIO_CFG_TIMEOUT);
-
-        if (client_cfg == NULL) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not create "
-                    "DEVIO Config libclient instance\n");
-            goto err_client_cfg;
-        }
-
-        /* Get uTCA card slot number */
-        client_err = bpm_get_afc_diag_card_slot (client_cfg, devio_config_service_str,
-                &dev_id);
-
-        if (client_err != BPM_CLIENT_SUCCESS) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not retrieve "
-                    "slot number. Unsupported board?\n");
-            goto err_card_slot;
+    for (i = 0; i < nboards; ++i) {
+        err = _get_dev_id (&boards [i], llio_type);
+        if (err != DEVIO_SUCCESS) {
+            goto err_boards;
         }
 
-/* We could just leave DEVIO CFG arounf and not kill it. We do it just
- * for the sake not having unnecessary things running, as the regular
- * DEVIO already spwan the same service (i.e., AFC DIAG) as DEVIO CFG */
-#if 1
-        if (llio_type == PCIE_DEV) {
-            /* Kill DEVIO cfg as we've already got our slot number */
-            if (child_devio_cfg_pid > 0) {
-                kill (child_devio_cfg_pid, DEVIO_KILL_CFG_SIGNAL);
-            }
+        /* Get the uTCA slot number. This is only available in AFCv3 */
+#if defined (__BOARD_AFCV3__) && (__WITH_APP_CFG__)
+        err = _get_card_slot (&boards [i], llio_type, devio_type);
+        if (err != DEVIO_SUCCESS) {
+            goto err_boards;
         }
-        /* Destroy libclient */
-        bpm_client_destroy (&client_cfg);
-    }
-#endif
 #endif
 
-    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Slot number: 0x%08X\n", dev_id);
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Slot number: 0x%08X\n",
+                boards [i].dev_id);
+    }
 
     /* We don't need it anymore */
     free (fe_smio_id_str);
@@ -380,30 +389,10 @@ int main (int argc, char *argv[])
     dev_type = NULL;
     free (dev_id_str);
     dev_id_str = NULL;
-
-    /* Initilialize dev_io */
-    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[ebpm] Creating DEVIO instance ...\n");
-
-    /* Create LOG filename path */
-    char *devio_log_filename = _create_log_filename (log_prefix, dev_id,
-            devio_type_str, fe_smio_id);
-    ASSERT_ALLOC (devio_log_filename, err_devio_log_filename_alloc);
-
-    char devio_service_str [DEVIO_SERVICE_LEN];
-    snprintf (devio_service_str, DEVIO_SERVICE_LEN-1, "BPM%u:DEVIO", dev_id);
-    devio_service_str [DEVIO_SERVICE_LEN-1] = '\0'; /* Just in case ... */
-    devio_t *devio = devio_new (devio_service_str, dev_id, dev_entry, llio_type,
-            broker_endp, verbose, devio_log_filename);
-    ASSERT_ALLOC (devio, err_devio_alloc);
-
-    /* We don't need it anymore */
     free (dev_entry);
     dev_entry = NULL;
 
-    /* Print SDB devices */
-    devio_print_info (devio);
-
-    zhashx_t *devio_hints = zhashx_new ();
+    devio_hints = zhashx_new ();
     if (devio_hints == NULL) {
         DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_FATAL, "[ebpm] Could allocate "
                 "hints hash table\n");
@@ -414,13 +403,7 @@ int main (int argc, char *argv[])
     /************ Read configuration variables from config file ***************/
     /**************************************************************************/
 
-    /* Check for field not found */
-    if (cfg_file == NULL) {
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Configuration file not set\n");
-        goto err_cfg_load;
-    }
-
-    zconfig_t *root_cfg = zconfig_load (cfg_file);
+    root_cfg = zconfig_load (cfg_file);
     if (root_cfg == NULL) {
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not load "
                 "configuration file\n");
@@ -436,6 +419,64 @@ int main (int argc, char *argv[])
         goto err_cfg_get_hints;
     }
 
+    /* Lock the memory early, so the stacks of the threads created from now
+     * on are locked as they are mapped */
+    err = _set_rt (root_cfg);
+    if (err != DEVIO_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not get real-time "
+                "mode from configuration file\n");
+        goto err_cfg_get_hints;
+    }
+
+    /* Tune ZeroMQ for the acquisition traffic. This must come before any
+     * socket is created, so the I/O threads and HWMs take effect */
+    hutils_zmq_opts_t zmq_opts = HUTILS_ZMQ_OPTS_DFLT;
+    herr = hutils_get_zmq_opts (root_cfg, "/dev_io_zmq", &zmq_opts);
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not get ZeroMQ "
+                "options from configuration file\n");
+        goto err_cfg_get_hints;
+    }
+    hutils_set_zmq_opts (&zmq_opts);
+
+    /* Get the number of threads shared by the SMIOs, if any */
+    err = _get_smio_reactors (root_cfg, &nreactors);
+    if (err != DEVIO_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not get SMIO "
+                "reactors from configuration file\n");
+        goto err_cfg_get_hints;
+    }
+
+    /* Create LOG filename path. The log is set for the whole process, so
+     * all of the boards log to the one of the first board */
+    devio_log_filename = _create_log_filename (log_prefix, boards [0].dev_id,
+            devio_type_str, fe_smio_id);
+    ASSERT_ALLOC (devio_log_filename, err_devio_log_filename_alloc);
+
+    /* Initilialize dev_io */
+    hutils_sched_t reactors_sched = {0};
+    for (i = 0; i < nboards; ++i) {
+        /* With several boards, they all share the reactors started below */
+        err = _board_new (&boards [i], llio_type, broker_endp, verbose,
+                devio_log_filename, cfg_file, root_cfg, devio_hints,
+                (nboards == 1) ? nreactors : 0, &reactors_sched);
+        if (err != DEVIO_SUCCESS) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not create "
+                    "DEVIO instance of device %u\n", boards [i].dev_id);
+            goto err_board_new;
+        }
+    }
+
+    if (nboards > 1 && nreactors > 0) {
+        err = _share_smio_reactors (boards, nboards, smio_reactors, nreactors,
+                &reactors_sched);
+        if (err != DEVIO_SUCCESS) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not start "
+                    "shared SMIO reactors\n");
+            goto err_share_reactors;
+        }
+    }
+
     /*  Start DEVIO loop */
 
     /* Step 1: Loop though all the SDB records and intialize (boot) the
@@ -446,39 +487,107 @@ int main (int argc, char *argv[])
      * handle, like messages from smios */
     /*      Step 3.5: If we do, call devio_handle_smio () and treat its
      *      request as appropriate */
-    zactor_t *server = zactor_new (devio_loop, devio);
-    if (server == NULL) {
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not spawn "
-                "server\n");
-        goto err_server;
-    }
+    for (i = 0; i < nboards; ++i) {
+        boards [i].server = zactor_new (devio_loop, boards [i].devio);
+        if (boards [i].server == NULL) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not spawn "
+                    "server\n");
+            goto err_server;
+        }
 
-    /* TODO: Implement and Send SPAWN messages to spawn SMIOs */
+        /* TODO: Implement and Send SPAWN messages to spawn SMIOs */
+
+        /* Spawn associated DEVIOs. The ones of the process we took over
+         * from keep running */
+        if (!devio_took_over (boards [i].devio)) {
+            err = _spawn_assoc_devios (boards [i].devio, boards [i].dev_id, devio_type,
+                    cfg_file, broker_endp, log_prefix, devio_hints, boards [i].chld);
+            if (err != DEVIO_SUCCESS) {
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not spawn "
+                        "associated DEVIOs!\n");
+                goto err_assoc_devio;
+            }
+        }
 
-    /* Spawn associated DEVIOs */
-    devio_err_e err = _spawn_assoc_devios (devio, dev_id, devio_type,
-            cfg_file, broker_endp, log_prefix, devio_hints);
-    if (err != DEVIO_SUCCESS) {
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not spawn "
-                "associated DEVIOs!\n");
-        goto err_assoc_devio;
+        /* Spawn platform SMIOSs */
+        err = _spawn_platform_smios (boards [i].server, devio_type, fe_smio_id,
+                devio_hints, boards [i].dev_id);
+        if (err != DEVIO_SUCCESS) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] _spawn_platform_smios error!\n");
+            goto err_plat_devio;
+        }
     }
 
-    free (broker_endp);
-    broker_endp = NULL;
-
-    /* Spawn platform SMIOSs */
-    err = _spawn_platform_smios (server, devio_type, fe_smio_id, devio_hints,
-            dev_id);
-    if (err != DEVIO_SUCCESS) {
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] _spawn_platform_smios error!\n");
-        goto err_plat_devio;
+    poller = zpoller_new (NULL);
+    ASSERT_ALLOC (poller, err_poller_alloc);
+    for (i = 0; i < nboards; ++i) {
+        zpoller_add (poller, boards [i].server);
     }
 
-    /*  Accept and print any message back from server */
+    /*  Accept and print any message back from the servers. In between,
+     * watch the configuration file. Changes to the hints are applied to
+     * the running boards, see _reload_cfg () */
+    int nready = 0;
+    int nhanded_off = 0;
+    time_t cfg_mtime = zsys_file_modified (cfg_file);
+    time_t cfg_mtime_seen = cfg_mtime;
     while (true) {
+        zactor_t *server = (zactor_t *) zpoller_wait (poller,
+                EBPM_CFG_WATCH_INTERVAL);
+        if (server == NULL && zpoller_expired (poller)) {
+            time_t mtime = zsys_file_modified (cfg_file);
+            if (devio_type == BE_DEVIO && mtime != cfg_mtime &&
+                    mtime == cfg_mtime_seen) {
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Configuration "
+                        "file changed. Reloading it\n");
+                _reload_cfg (boards, nboards, cfg_file, broker_endp, log_prefix,
+                        &devio_hints);
+                cfg_mtime = mtime;
+            }
+            cfg_mtime_seen = mtime;
+            continue;
+        }
+
+        if (server == NULL) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[ebpm] Interrupted\n");
+            break;
+        }
+
+        ebpm_board_t *board = &boards [0];
+        for (i = 0; i < nboards; ++i) {
+            if (boards [i].server == server) {
+                board = &boards [i];
+            }
+        }
+
         char *message = zstr_recv (server);
-        if (message) {
+        if (message && streq (message, DEVIO_READY_STR)) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] All SMIOs of device %u "
+                    "are configured\n", board->dev_id);
+            if (!board->ready) {
+                board->ready = true;
+                nready++;
+            }
+            /* DEV_MNGR waits for the whole process */
+            if (nready == nboards) {
+                _notify_dmngr_ready ();
+            }
+            free (message);
+        }
+        else if (message && streq (message, DEVIO_HANDOFF_STR)) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] SMIOs of device %u "
+                    "handed off to a new process\n", board->dev_id);
+            if (!board->handed_off) {
+                board->handed_off = true;
+                nhanded_off++;
+            }
+            free (message);
+            /* Nothing left to serve */
+            if (nhanded_off == nboards) {
+                break;
+            }
+        }
+        else if (message) {
             DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[ebpm] %s\n", message);
             free (message);
         }
@@ -488,28 +597,35 @@ int main (int argc, char *argv[])
         }
     }
 
+    zpoller_destroy (&poller);
+err_poller_alloc:
 err_plat_devio:
 err_assoc_devio:
-    zactor_destroy (&server);
 err_server:
+    for (i = 0; i < nboards; ++i) {
+        zactor_destroy (&boards [i].server);
+    }
+err_share_reactors:
+err_board_new:
+    for (i = 0; i < nboards; ++i) {
+        devio_destroy (&boards [i].devio);
+    }
+    /* Shared reactors go only after all of the DEVIOs using them */
+    for (i = 0; i < DEVIO_MAX_SMIO_REACTORS; ++i) {
+        smio_reactor_destroy (&smio_reactors [i]);
+    }
+    free (devio_log_filename);
+err_devio_log_filename_alloc:
 err_cfg_get_hints:
     zconfig_destroy (&root_cfg);
 err_cfg_load:
     zhashx_destroy (&devio_hints);
 err_devio_hints_alloc:
-    devio_destroy (&devio);
-err_devio_alloc:
-    free (devio_log_filename);
-err_devio_log_filename_alloc:
-#if defined (__BOARD_AFCV3__) && (__WITH_APP_CFG__)
-err_card_slot:
-    if (client_cfg != NULL) {
-        bpm_client_destroy (&client_cfg);
+err_boards:
+    for (i = 0; i < nboards; ++i) {
+        free (boards [i].dev_entry);
+        free (boards [i].dev_id_str);
     }
-err_client_cfg:
-    /* Kill DEVIO Config process */
-    kill (child_devio_cfg_pid, DEVIO_KILL_CFG_SIGNAL);
-#endif
 err_exit:
     free (log_prefix);
     free (fe_smio_id_str);
@@ -525,9 +641,775 @@ err_parse_cfg:
     return 0;
 }
 
+/* Read the optional SMIO priority classes from the configuration file,
+ * in the form:
+ *
+ * dev_io_sched
+ *     priority
+ *         <SMIO name> = <high | normal | low>
+ */
+static devio_err_e _set_smio_prios (devio_t *devio, zconfig_t *root_cfg)
+{
+    assert (devio);
+    assert (root_cfg);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    zconfig_t *prio_cfg = zconfig_locate (root_cfg, "/dev_io_sched/priority");
+    /* Not an error. Every SMIO has the normal priority then */
+    if (prio_cfg == NULL) {
+        goto err_no_prio_cfg;
+    }
+
+    zconfig_t *smio_cfg = zconfig_child (prio_cfg);
+    for (; smio_cfg != NULL; smio_cfg = zconfig_next (smio_cfg)) {
+        devio_prio_e prio = devio_str_to_prio (zconfig_value (smio_cfg));
+        ASSERT_TEST (prio != DEVIO_PRIO_INVALID, "Invalid SMIO priority class "
+                "(options are: high, normal or low) in configuration file",
+                err_inv_prio, DEVIO_ERR_CFG);
+
+        err = devio_set_smio_prio (devio, zconfig_name (smio_cfg), prio);
+        ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set SMIO priority class",
+                err_set_prio);
+    }
+
+err_set_prio:
+err_inv_prio:
+err_no_prio_cfg:
+    return err;
+}
+
+/* Parse an SMIO spawn policy, "eager" or "lazy". Returns -1 if invalid */
+static int _smio_lazy_from_str (const char *lazy_str)
+{
+    if (streq (lazy_str, "lazy")) {
+        return 1;
+    }
+    if (streq (lazy_str, "eager")) {
+        return 0;
+    }
+    return -1;
+}
+
+/* Read the optional SMIO spawn policies from the configuration file,
+ * in the form:
+ *
+ * dev_io_lazy
+ *     default = <eager | lazy>
+ *     smio
+ *         <SMIO name> = <eager | lazy>
+ */
+static devio_err_e _set_smio_lazy (devio_t *devio, zconfig_t *root_cfg)
+{
+    assert (devio);
+    assert (root_cfg);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    char *dflt_str = zconfig_get (root_cfg, "/dev_io_lazy/default", NULL);
+    /* Not an error. Every SMIO is spawned on startup then */
+    if (dflt_str != NULL && *dflt_str != '\0') {
+        int lazy = _smio_lazy_from_str (dflt_str);
+        ASSERT_TEST (lazy >= 0, "Invalid default SMIO spawn policy (options "
+                "are: eager or lazy) in configuration file", err_inv_lazy,
+                DEVIO_ERR_CFG);
+
+        err = devio_set_smio_lazy_dflt (devio, lazy);
+        ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set default SMIO spawn "
+                "policy", err_set_lazy);
+    }
+
+    zconfig_t *lazy_cfg = zconfig_locate (root_cfg, "/dev_io_lazy/smio");
+    if (lazy_cfg == NULL) {
+        goto err_no_lazy_cfg;
+    }
+
+    zconfig_t *smio_cfg = zconfig_child (lazy_cfg);
+    for (; smio_cfg != NULL; smio_cfg = zconfig_next (smio_cfg)) {
+        int lazy = _smio_lazy_from_str (zconfig_value (smio_cfg));
+        ASSERT_TEST (lazy >= 0, "Invalid SMIO spawn policy (options are: "
+                "eager or lazy) in configuration file", err_inv_lazy,
+                DEVIO_ERR_CFG);
+
+        err = devio_set_smio_lazy (devio, zconfig_name (smio_cfg), lazy);
+        ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set SMIO spawn policy",
+                err_set_lazy);
+    }
+
+err_no_lazy_cfg:
+err_set_lazy:
+err_inv_lazy:
+    return err;
+}
+
+/* Read the optional number of threads shared by the SMIOs,
+ * "/dev_io_sched/smio_reactors" */
+static devio_err_e _get_smio_reactors (zconfig_t *root_cfg, uint32_t *nreactors)
+{
+    assert (root_cfg);
+    assert (nreactors);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    char *reactors_str = zconfig_get (root_cfg, "/dev_io_sched/smio_reactors", NULL);
+    /* Not an error. Every SMIO has a thread of its own then */
+    if (reactors_str == NULL || *reactors_str == '\0') {
+        goto err_no_reactors_cfg;
+    }
+
+    char *endptr = NULL;
+    unsigned long nreactors_cfg = strtoul (reactors_str, &endptr, 10);
+    ASSERT_TEST (*endptr == '\0' && nreactors_cfg <= DEVIO_MAX_SMIO_REACTORS,
+            "Invalid number of SMIO reactors in configuration file",
+            err_inv_reactors, DEVIO_ERR_CFG);
+
+    *nreactors = nreactors_cfg;
+
+err_inv_reactors:
+err_no_reactors_cfg:
+    return err;
+}
+
+/* Enter real-time mode if "/dev_io_rt/enable" is set */
+static devio_err_e _set_rt (zconfig_t *root_cfg)
+{
+    assert (root_cfg);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    char *enable_str = zconfig_get (root_cfg, "/dev_io_rt/enable", NULL);
+    /* Not an error. Real-time mode is just off then */
+    if (enable_str == NULL || *enable_str == '\0' || streq (enable_str, "no")) {
+        goto err_no_rt_cfg;
+    }
+    ASSERT_TEST (streq (enable_str, "yes"), "Invalid real-time mode in "
+            "configuration file", err_inv_rt, DEVIO_ERR_CFG);
+
+    /* Not fatal. Requests are still served, with page faults */
+    hutils_err_e herr = hutils_mem_rt_enable ();
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[ebpm] Could not lock memory "
+                "for real-time mode: %s\n", hutils_err_str (herr));
+    }
+
+err_inv_rt:
+err_no_rt_cfg:
+    return err;
+}
+
+static devio_err_e _set_snapshot_dir (devio_t *devio, zconfig_t *root_cfg)
+{
+    assert (devio);
+    assert (root_cfg);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    char *snapshot_dir = zconfig_get (root_cfg, "/dev_io_warm_restart/snapshot_dir", NULL);
+    /* Not an error. Every DEVIO start is a cold one then */
+    if (snapshot_dir == NULL || *snapshot_dir == '\0') {
+        goto err_no_snapshot_dir;
+    }
+
+    int rc = zsys_dir_create ("%s", snapshot_dir);
+    ASSERT_TEST (rc == 0, "Could not create register snapshot directory",
+            err_dir_create, DEVIO_ERR_CFG);
+
+    err = devio_set_snapshot_dir (devio, snapshot_dir);
+
+err_dir_create:
+err_no_snapshot_dir:
+    return err;
+}
+
+/* Read the optional metrics collector, "/dev_io_metrics/endpoint", and
+ * publishing period, "/dev_io_metrics/interval" */
+static devio_err_e _set_metrics (devio_t *devio, zconfig_t *root_cfg)
+{
+    assert (devio);
+    assert (root_cfg);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    char *endpoint = zconfig_get (root_cfg, "/dev_io_metrics/endpoint", NULL);
+    /* Not an error. Metrics are just not published then */
+    if (endpoint == NULL || *endpoint == '\0') {
+        goto err_no_metrics_cfg;
+    }
+
+    unsigned long interval = 0;
+    char *interval_str = zconfig_get (root_cfg, "/dev_io_metrics/interval", NULL);
+    if (interval_str != NULL && *interval_str != '\0') {
+        char *endptr = NULL;
+        interval = strtoul (interval_str, &endptr, 10);
+        ASSERT_TEST (*endptr == '\0' && interval <= UINT32_MAX,
+                "Invalid metrics interval in configuration file",
+                err_inv_interval, DEVIO_ERR_CFG);
+    }
+
+    err = devio_set_metrics (devio, endpoint, interval);
+
+err_inv_interval:
+err_no_metrics_cfg:
+    return err;
+}
+
+/* Read the optional request trace directory, "/dev_io_trace/trace_dir",
+ * and size limit of each trace, "/dev_io_trace/max_size", in MB */
+static devio_err_e _set_trace (devio_t *devio, zconfig_t *root_cfg)
+{
+    assert (devio);
+    assert (root_cfg);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    char *trace_dir = zconfig_get (root_cfg, "/dev_io_trace/trace_dir", NULL);
+    /* Not an error. Requests are just not recorded then */
+    if (trace_dir == NULL || *trace_dir == '\0') {
+        goto err_no_trace_dir;
+    }
+
+    unsigned long max_size = 0;
+    char *max_size_str = zconfig_get (root_cfg, "/dev_io_trace/max_size", NULL);
+    if (max_size_str != NULL && *max_size_str != '\0') {
+        char *endptr = NULL;
+        max_size = strtoul (max_size_str, &endptr, 10);
+        ASSERT_TEST (*endptr == '\0' && max_size <= UINT32_MAX,
+                "Invalid trace size limit in configuration file",
+                err_inv_max_size, DEVIO_ERR_CFG);
+    }
+
+    int rc = zsys_dir_create ("%s", trace_dir);
+    ASSERT_TEST (rc == 0, "Could not create request trace directory",
+            err_dir_create, DEVIO_ERR_CFG);
+
+    err = devio_set_trace (devio, trace_dir, (uint64_t) max_size << 20);
+
+err_dir_create:
+err_inv_max_size:
+err_no_trace_dir:
+    return err;
+}
+
+/* The SMIOs of each BPM run with the placement of that BPM. The DEVIO thread
+ * serves all of them, so it may run on any of their CPUs, with the highest
+ * of their priorities. The same goes for the reactors shared by several
+ * boards, so the placement of the DEVIO is merged into "reactors_sched" */
+static devio_err_e _set_scheds (devio_t *devio, zhashx_t *hints, uint32_t dev_id,
+        hutils_sched_t *reactors_sched)
+{
+    assert (devio);
+    assert (hints);
+    assert (reactors_sched);
+
+    devio_err_e err = DEVIO_SUCCESS;
+    hutils_sched_t devio_sched = {0};
+
+    uint32_t j;
+    for (j = 0; j < DEVIO_MAX_FE_DEVIOS; ++j) {
+        char hints_key [HUTILS_CFG_HASH_KEY_MAX_LEN];
+        int errs = snprintf (hints_key, sizeof (hints_key),
+                HUTILS_CFG_HASH_KEY_PATTERN_COMPL, dev_id, j);
+
+        /* Only when the number of characters written is less than the whole buffer,
+         * it is guaranteed that the string was written successfully */
+        ASSERT_TEST (errs >= 0 && (size_t) errs < sizeof (hints_key),
+                "Could not generate configuration hash key for configuration "
+                "file", err_cfg_exit, DEVIO_ERR_CFG);
+
+        hutils_hints_t *cfg_item = zhashx_lookup (hints, hints_key);
+        if (cfg_item == NULL) {
+            continue;
+        }
+
+        err = devio_set_smio_sched (devio, j, &cfg_item->sched);
+        ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set SMIO CPU placement",
+                err_set_smio_sched);
+
+        _sched_merge (&devio_sched, &cfg_item->sched);
+    }
+
+    err = devio_set_sched (devio, &devio_sched);
+    _sched_merge (reactors_sched, &devio_sched);
+
+err_set_smio_sched:
+err_cfg_exit:
+    return err;
+}
+
+/* Apply the changes to the hints of the configuration file to the boards
+ * that are still ours. Any other setting needs a restart. The old hints
+ * are kept if the file can't be read */
+static void _reload_cfg (ebpm_board_t *boards, int nboards, char *cfg_file,
+        char *broker_endp, char *log_prefix, zhashx_t **hints_p)
+{
+    assert (boards);
+    assert (hints_p);
+
+    zconfig_t *root_cfg = NULL;
+    zhashx_t *new_hints = zhashx_new ();
+    if (new_hints == NULL) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_ERR, "[ebpm] Could not allocate "
+                "hints hash table\n");
+        goto err_hints_alloc;
+    }
+
+    root_cfg = zconfig_load (cfg_file);
+    if (root_cfg == NULL) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_ERR, "[ebpm] Could not load "
+                "configuration file. Keeping the old one\n");
+        goto err_cfg_load;
+    }
+
+    hutils_err_e herr = hutils_get_hints (root_cfg, new_hints);
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_ERR, "[ebpm] Could not get hints "
+                "from configuration file. Keeping the old ones\n");
+        goto err_cfg_get_hints;
+    }
+
+    int i;
+    for (i = 0; i < nboards; ++i) {
+        if (!boards [i].handed_off) {
+            _reload_board (&boards [i], *hints_p, new_hints, cfg_file,
+                    broker_endp, log_prefix);
+        }
+    }
+
+    zhashx_destroy (hints_p);
+    *hints_p = new_hints;
+    new_hints = NULL;
+
+err_cfg_get_hints:
+    zconfig_destroy (&root_cfg);
+err_cfg_load:
+    zhashx_destroy (&new_hints);
+err_hints_alloc:
+    return;
+}
+
+/* Diff the hints of each instance of the board. The SMIOs are moved to
+ * their new placement, the FMC SMIOs are registered again if the FMC board
+ * type changed and only the children whose hints changed are stopped and
+ * spawned again */
+static void _reload_board (ebpm_board_t *board, zhashx_t *old_hints,
+        zhashx_t *new_hints, char *cfg_file, char *broker_endp, char *log_prefix)
+{
+    assert (board);
+    assert (old_hints);
+    assert (new_hints);
+
+    hutils_hints_t none = {0};
+    /* Hints of the IOCs to spawn again, with only their flags set */
+    hutils_hints_t ioc_items [DEVIO_MAX_FE_DEVIOS];
+    hutils_sched_t old_devio_sched = {0};
+    hutils_sched_t new_devio_sched = {0};
+    bool fmc_changed = false;
+    bool took_over = devio_took_over (board->devio);
+
+    /* No destructor, the items belong to "new_hints" */
+    zhashx_t *rffe_hints = zhashx_new ();
+    zhashx_t *ioc_hints = zhashx_new ();
+    if (rffe_hints == NULL || ioc_hints == NULL) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_ERR, "[ebpm] Could not allocate "
+                "hints hash table\n");
+        goto err_hints_alloc;
+    }
+
+    uint32_t j;
+    for (j = 0; j < DEVIO_MAX_FE_DEVIOS; ++j) {
+        char hints_key [HUTILS_CFG_HASH_KEY_MAX_LEN];
+        int errs = snprintf (hints_key, sizeof (hints_key),
+                HUTILS_CFG_HASH_KEY_PATTERN_COMPL, board->dev_id, j);
+        if (errs < 0 || (size_t) errs >= sizeof (hints_key)) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_ERR, "[ebpm] Could not generate "
+                    "configuration hash key for configuration file\n");
+            goto err_cfg_key;
+        }
+
+        hutils_hints_t *old_item = zhashx_lookup (old_hints, hints_key);
+        hutils_hints_t *new_item = zhashx_lookup (new_hints, hints_key);
+        old_item = (old_item == NULL) ? &none : old_item;
+        new_item = (new_item == NULL) ? &none : new_item;
+
+        _sched_merge (&old_devio_sched, &old_item->sched);
+        _sched_merge (&new_devio_sched, &new_item->sched);
+        if (!_sched_eq (&old_item->sched, &new_item->sched)) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Moving SMIOs of "
+                    "board %u, bpm %u to their new CPU placement\n",
+                    board->dev_id, j);
+            devio_update_smio_sched (board->server, j, &new_item->sched);
+        }
+
+        /* The first instance selects the FMC board type of the board */
+        if (j == 0 && !_hints_str_eq (old_item->fmc_board, new_item->fmc_board)) {
+            fmc_changed = true;
+        }
+
+        bool bind_changed = !_hints_str_eq (old_item->bind, new_item->bind);
+        bool dbe_ioc_changed = old_item->spawn_dbe_epics_ioc !=
+            new_item->spawn_dbe_epics_ioc;
+        /* The AFE IOC talks to the RFFE DEVIO bound to "bind" */
+        bool afe_ioc_changed = bind_changed || old_item->spawn_afe_epics_ioc !=
+            new_item->spawn_afe_epics_ioc;
+
+        if (!bind_changed && !dbe_ioc_changed && !afe_ioc_changed) {
+            continue;
+        }
+
+        /* The children of the process we took over from are not ours */
+        if (took_over) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[ebpm] Children of board "
+                    "%u, bpm %u were not spawned by us. Restart to apply the "
+                    "new hints to them\n", board->dev_id, j);
+            continue;
+        }
+
+        if (bind_changed) {
+            _stop_chld (&board->chld [j].rffe);
+            zhashx_insert (rffe_hints, hints_key, new_item);
+        }
+
+        ioc_items [j] = *new_item;
+        ioc_items [j].spawn_dbe_epics_ioc = dbe_ioc_changed &&
+            new_item->spawn_dbe_epics_ioc;
+        ioc_items [j].spawn_afe_epics_ioc = afe_ioc_changed &&
+            new_item->spawn_afe_epics_ioc;
+        if (dbe_ioc_changed) {
+            _stop_chld (&board->chld [j].dbe_ioc);
+        }
+        if (afe_ioc_changed) {
+            _stop_chld (&board->chld [j].afe_ioc);
+        }
+        zhashx_insert (ioc_hints, hints_key, &ioc_items [j]);
+    }
+
+    if (!_sched_eq (&old_devio_sched, &new_devio_sched)) {
+        devio_update_sched (board->server, &new_devio_sched);
+    }
+
+    if (fmc_changed) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] FMC board type of "
+                "board %u changed. Registering its FMC SMIOs again\n",
+                board->dev_id);
+        _stop_fmc_smios (board->server);
+        _spawn_fmc_smio (board->server, new_hints, board->dev_id, 0);
+#if defined (__BOARD_AFCV3__)
+        _spawn_fmc_smio (board->server, new_hints, board->dev_id, 1);
+#endif
+    }
+
+    /* Only the children with changed hints are in these */
+    if (zhashx_size (rffe_hints) > 0) {
+        _spawn_rffe_devios (board->devio, board->dev_id, cfg_file, broker_endp,
+                log_prefix, rffe_hints, board->chld);
+    }
+    if (zhashx_size (ioc_hints) > 0) {
+        _spawn_epics_iocs (board->devio, board->dev_id, cfg_file, broker_endp,
+                log_prefix, ioc_hints, board->chld);
+    }
+
+err_cfg_key:
+err_hints_alloc:
+    zhashx_destroy (&ioc_hints);
+    zhashx_destroy (&rffe_hints);
+}
+
+static void _stop_fmc_smios (void *pipe)
+{
+    uint32_t inst_id;
+    for (inst_id = 0; inst_id < 2; ++inst_id) {
+        devio_unregister_sm_id (pipe, FMC130M_4CH_SMIO_ID, inst_id);
+        devio_unregister_sm_id (pipe, FMC250M_4CH_SMIO_ID, inst_id);
+    }
+}
+
+static void _stop_chld (pid_t *pid)
+{
+    if (*pid > 0) {
+        kill (*pid, SIGTERM);
+    }
+    *pid = 0;
+}
+
+/* NULL and empty strings are the same hint */
+static bool _hints_str_eq (const char *a, const char *b)
+{
+    return streq ((a == NULL) ? "" : a, (b == NULL) ? "" : b);
+}
+
+static bool _sched_eq (const hutils_sched_t *a, const hutils_sched_t *b)
+{
+    return a->cpu_mask == b->cpu_mask && a->fifo_prio == b->fifo_prio;
+}
+
+/* Merge the placement "src" into "dst": any of their CPUs, with the
+ * highest of their priorities */
+static void _sched_merge (hutils_sched_t *dst, const hutils_sched_t *src)
+{
+    dst->cpu_mask |= src->cpu_mask;
+    if (src->fifo_prio > dst->fifo_prio) {
+        dst->fifo_prio = src->fifo_prio;
+    }
+}
+
+/* Fill "boards" from the comma separated lists of device entries and,
+ * optionally, device IDs, one for each entry. Returns the number of boards
+ * or -1 on error */
+static int _parse_boards (ebpm_board_t *boards, const char *dev_entries,
+        const char *dev_ids)
+{
+    assert (boards);
+    assert (dev_entries);
+
+    char *entries [DEVIO_MAX_BOARDS] = {NULL};
+    char *ids [DEVIO_MAX_BOARDS] = {NULL};
+    int nboards = _split_list (dev_entries, entries, DEVIO_MAX_BOARDS);
+    int nids = (dev_ids != NULL) ?
+        _split_list (dev_ids, ids, DEVIO_MAX_BOARDS) : nboards;
+    ASSERT_TEST (nboards > 0 && nids == nboards, "Device entry and device ID "
+            "lists must have the same number of boards", err_inv_lists);
+
+    int i;
+    for (i = 0; i < nboards; ++i) {
+        boards [i].dev_entry = entries [i];
+        boards [i].dev_id_str = ids [i];
+    }
+
+    return nboards;
+
+err_inv_lists:
+    for (i = 0; i < DEVIO_MAX_BOARDS; ++i) {
+        free (entries [i]);
+        free (ids [i]);
+    }
+    return -1;
+}
+
+/* Split a comma separated list into up to "max_items" allocated strings.
+ * Returns the number of items or -1 on error */
+static int _split_list (const char *list, char **items, int max_items)
+{
+    assert (list);
+    assert (items);
+
+    int nitems = 0;
+    char *saveptr = NULL;
+    char *list_copy = strdup (list);
+    ASSERT_ALLOC (list_copy, err_list_copy_alloc);
+
+    char *item = strtok_r (list_copy, DEVIO_BOARD_LIST_SEP, &saveptr);
+    for (; item != NULL; item = strtok_r (NULL, DEVIO_BOARD_LIST_SEP, &saveptr)) {
+        ASSERT_TEST (nitems < max_items, "Too many boards", err_max_items);
+        items [nitems] = strdup (item);
+        ASSERT_ALLOC (items [nitems], err_item_alloc);
+        nitems++;
+    }
+
+    free (list_copy);
+    return nitems;
+
+err_item_alloc:
+err_max_items:
+    while (nitems > 0) {
+        nitems--;
+        free (items [nitems]);
+        items [nitems] = NULL;
+    }
+    free (list_copy);
+err_list_copy_alloc:
+    return -1;
+}
+
+/* Get the device ID of a board, either the given one or, for PCIe devices,
+ * the number of its /dev entry */
+static devio_err_e _get_dev_id (ebpm_board_t *board, llio_type_e llio_type)
+{
+    assert (board);
+
+    devio_err_e err = DEVIO_SUCCESS;
+
+    /* Use the passed ID */
+    if (board->dev_id_str != NULL) {
+        board->dev_id = strtoul (board->dev_id_str, NULL, 10);
+        goto dev_id_set;
+    }
+
+    switch (llio_type) {
+        case PCIE_DEV:
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Dev_id parameter was not set.\n"
+                    "\tDefaulting it to the /dev file number ...\n");
+
+            /* Our device follows the convention of having the ID in hexadecimal
+             * code. For instance, /dev/fpga-0c00 would be a valid ID */
+            int matches = sscanf (board->dev_entry, "/dev/fpga-%u", &board->dev_id);
+            ASSERT_TEST (matches == 1, "Dev_entry parameter is invalid. It must "
+                    "be in the format \"/dev/fpga-<device_number>\"",
+                    err_inv_dev_entry, DEVIO_ERR_CFG);
+            break;
+
+        default:
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Dev_id parameter was not set. Exiting ...\n");
+            err = DEVIO_ERR_CFG;
+            goto err_no_dev_id;
+    }
+
+dev_id_set:
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Dev_id parameter was set to %u.\n",
+            board->dev_id);
+
+err_inv_dev_entry:
+err_no_dev_id:
+    return err;
+}
+
+#if defined (__BOARD_AFCV3__) && (__WITH_APP_CFG__)
+/* Get the uTCA slot number of a board, used as its device ID. It is read
+ * straight from the AFC_DIAG core through an LLIO of our own, before the
+ * DEVIO of the board exists. This is only available in AFCv3 */
+static devio_err_e _get_card_slot (ebpm_board_t *board, llio_type_e llio_type,
+        devio_type_e devio_type)
+{
+    assert (board);
+
+    devio_err_e err = DEVIO_SUCCESS;
+
+    /* FE DEVIO is expected to have a correct dev_id. So, we don't need to get it
+     * from Hardware. Simulated devices have no slot to ask for */
+    if (devio_type != BE_DEVIO || llio_type == SIM_DEV) {
+        goto err_no_slot;
+    }
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Reading slot number of "
+            "%s\n", board->dev_entry);
+    llio_t *llio = llio_new (DEVIO_CARD_SLOT_LLIO_NAME, board->dev_entry,
+            llio_type, 0);
+    ASSERT_ALLOC (llio, err_llio_alloc, DEVIO_ERR_ALLOC);
+
+    int rc = llio_open (llio, NULL);
+    ASSERT_TEST (rc == 0, "Could not open device to read slot number",
+            err_llio_open, DEVIO_ERR_MOD_LLIO);
+
+    /* Same register the AFC_DIAG SMIO reads, see sm_io_afc_diag_exp.c */
+    uint32_t geo_id = 0;
+    ssize_t ret = llio_read_32 (llio, WB_AFC_DIAG_BASE_ADDR |
+            WB_AFC_DIAG_CTRL_RAW_REGS_OFFS | BPM_AFC_DIAG_REG_GEO_ID, &geo_id);
+    ASSERT_TEST (ret == sizeof (geo_id), "Could not retrieve slot number. "
+            "Unsupported board?", err_card_slot, DEVIO_ERR_CFG);
+    board->dev_id = BPM_AFC_DIAG_GEO_ID_CARD_SLOT_R(geo_id);
+
+err_card_slot:
+    /* The DEVIO opens the device again for itself */
+    llio_release (llio, NULL);
+err_llio_open:
+    llio_destroy (&llio);
+err_llio_alloc:
+err_no_slot:
+    return err;
+}
+#endif
+
+/* Create the DEVIO of a board and apply the settings of the configuration
+ * file to it. "nreactors" is the number of SMIO reactors of its own */
+static devio_err_e _board_new (ebpm_board_t *board, llio_type_e llio_type,
+        char *broker_endp, int verbose, char *log_filename, char *cfg_file,
+        zconfig_t *root_cfg, zhashx_t *hints, uint32_t nreactors,
+        hutils_sched_t *reactors_sched)
+{
+    assert (board);
+    assert (root_cfg);
+    assert (hints);
+
+    devio_err_e err = DEVIO_SUCCESS;
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[ebpm] Creating DEVIO instance "
+            "of device %u ...\n", board->dev_id);
+
+    char devio_service_str [DEVIO_SERVICE_LEN];
+    snprintf (devio_service_str, DEVIO_SERVICE_LEN-1, "BPM%u:DEVIO", board->dev_id);
+    devio_service_str [DEVIO_SERVICE_LEN-1] = '\0'; /* Just in case ... */
+    board->devio = devio_new (devio_service_str, board->dev_id, board->dev_entry,
+            llio_type, broker_endp, verbose, log_filename);
+    ASSERT_ALLOC (board->devio, err_devio_alloc, DEVIO_ERR_ALLOC);
+
+    /* Print SDB devices */
+    devio_print_info (board->devio);
+
+    /* Set the SMIO priority classes, if any */
+    err = _set_smio_prios (board->devio, root_cfg);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set SMIO priorities from "
+            "configuration file", err_cfg);
+
+    /* Set which SMIOs are spawned on their first request only, if any */
+    err = _set_smio_lazy (board->devio, root_cfg);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set SMIO spawn policies "
+            "from configuration file", err_cfg);
+
+    /* Set the number of threads shared by the SMIOs, if any */
+    err = devio_set_smio_reactors (board->devio, nreactors);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set SMIO reactors", err_cfg);
+
+    /* Set the directory of the register snapshots, if any */
+    err = _set_snapshot_dir (board->devio, root_cfg);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set register snapshot "
+            "directory from configuration file", err_cfg);
+
+    /* Set the metrics collector, if any */
+    err = _set_metrics (board->devio, root_cfg);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set metrics collector "
+            "from configuration file", err_cfg);
+
+    /* Set the directory of the request traces, if any */
+    err = _set_trace (board->devio, root_cfg);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set request trace "
+            "directory from configuration file", err_cfg);
+
+    /* SMIOs with settings of their own (e.g., clock profiles) read them
+     * from the same file */
+    err = devio_set_cfg_file (board->devio, cfg_file);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set configuration file "
+            "of the SMIOs", err_cfg);
+
+    /* Set the CPU placement of the DEVIO and SMIO threads, if any */
+    err = _set_scheds (board->devio, hints, board->dev_id, reactors_sched);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not set CPU placement from "
+            "configuration file", err_cfg);
+
+err_cfg:
+err_devio_alloc:
+    return err;
+}
+
+/* Start the "nreactors" SMIO reactors shared by all of the boards, with the
+ * CPU placement "sched". They are left in "reactors" for the caller to
+ * destroy, even on error */
+static devio_err_e _share_smio_reactors (ebpm_board_t *boards, int nboards,
+        smio_reactor_t **reactors, uint32_t nreactors, const hutils_sched_t *sched)
+{
+    assert (boards);
+    assert (reactors);
+    assert (sched);
+
+    devio_err_e err = DEVIO_SUCCESS;
+
+    uint32_t j;
+    for (j = 0; j < nreactors; ++j) {
+        char *name = zsys_sprintf ("ebpm:reactor%u", j);
+        ASSERT_ALLOC (name, err_name_alloc, DEVIO_ERR_ALLOC);
+        reactors [j] = smio_reactor_new (name, sched);
+        zstr_free (&name);
+        ASSERT_TEST (reactors [j] != NULL, "Could not start shared SMIO reactor",
+                err_reactor_alloc, DEVIO_ERR_ALLOC);
+    }
+
+    int i;
+    for (i = 0; i < nboards; ++i) {
+        err = devio_share_smio_reactors (boards [i].devio, reactors, nreactors);
+        ASSERT_TEST (err == DEVIO_SUCCESS, "Could not share SMIO reactors",
+                err_share);
+    }
+
+err_share:
+err_reactor_alloc:
+err_name_alloc:
+    return err;
+}
+
 static devio_err_e _spawn_assoc_devios (devio_t *devio, uint32_t dev_id,
         devio_type_e devio_type, char *cfg_file, char *broker_endp,
-        char *log_prefix, zhashx_t *hints)
+        char *log_prefix, zhashx_t *hints, ebpm_chld_t *chld)
 {
     assert (devio);
     assert (broker_endp);
@@ -539,10 +1421,10 @@ static devio_err_e _spawn_assoc_devios (devio_t *devio, uint32_t dev_id,
         case BE_DEVIO:
             /* Spawn RFFE devios */
             err = _spawn_rffe_devios (devio, dev_id, cfg_file, broker_endp, log_prefix,
-                    hints);
+                    hints, chld);
             /* Spawn EPICS IOC */
             err |= _spawn_epics_iocs (devio, dev_id, cfg_file, broker_endp, log_prefix,
-                    hints);
+                    hints, chld);
             break;
 
         case FE_DEVIO:
@@ -563,8 +1445,10 @@ err_spwan_assoc_devios:
     return err;
 }
 
+/* The PIDs of the children go to "chld", by instance */
 static devio_err_e _spawn_rffe_devios (devio_t *devio, uint32_t dev_id,
-        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints)
+        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints,
+        ebpm_chld_t *chld)
 {
     assert (devio);
     assert (broker_endp);
@@ -611,13 +1495,14 @@ static devio_err_e _spawn_rffe_devios (devio_t *devio, uint32_t dev_id,
             ETH_DEV_STR, "-i", dev_id_c, "-e", cfg_item->bind, "-s", smio_inst_id_c,
             "-b", broker_endp, "-l", log_prefix, NULL};
         /* Spawn Config DEVIO */
-        int child_devio_cfg_pid = devio_spawn_chld (devio, DEVIO_NAME, argv_exec);
+        int child_devio_cfg_pid = devio_spawn_chld_pid (devio, DEVIO_NAME, argv_exec);
 
         if (child_devio_cfg_pid < 0) {
             DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not create "
                     "DEVIO RFFE instance\n");
             goto err_spawn;
         }
+        chld [j].rffe = child_devio_cfg_pid;
 
         free (dev_id_c);
         dev_id_c = NULL;
@@ -636,8 +1521,10 @@ err_cfg_exit:
     return err;
 }
 
+/* The PIDs of the children go to "chld", by instance */
 static devio_err_e _spawn_epics_iocs (devio_t *devio, uint32_t dev_id,
-        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints)
+        char *cfg_file, char *broker_endp, char *log_prefix, zhashx_t *hints,
+        ebpm_chld_t *chld)
 {
     assert (devio);
     assert (broker_endp);
@@ -718,13 +1605,14 @@ static devio_err_e _spawn_epics_iocs (devio_t *devio, uint32_t dev_id,
             char *argv_exec [] = {EPICS_PROCSERV_NAME, "-f", "-n", epics_hostname, "-i",
                 "^D^C", telnet_port_c, EPICS_BPM_RUN_SCRIPT_NAME, broker_endp, bpm_id_c,
                 NULL};
-            int child_devio_cfg_pid = devio_spawn_chld (devio, EPICS_PROCSERV_NAME, argv_exec);
+            int child_devio_cfg_pid = devio_spawn_chld_pid (devio, EPICS_PROCSERV_NAME, argv_exec);
 
             if (child_devio_cfg_pid < 0) {
                 DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not create "
                         "DBE EPICS instance for board %u, bpm %u\n", dev_id, j);
                 goto err_spawn_dbe_epics;
             }
+            chld [j].dbe_ioc = child_devio_cfg_pid;
         }
 
         /* Check if we want DBE EPICS IOC */
@@ -743,13 +1631,14 @@ static devio_err_e _spawn_epics_iocs (devio_t *devio, uint32_t dev_id,
             char *argv_exec [] = {EPICS_PROCSERV_NAME, "-f", "-n", epics_hostname, "-i",
                 "^D^C", telnet_afe_port_c, EPICS_BPM_RUN_SCRIPT_NAME, broker_endp, bpm_id_c,
                 NULL};
-            int child_devio_cfg_pid = devio_spawn_chld (devio, EPICS_PROCSERV_NAME, argv_exec);
+            int child_devio_cfg_pid = devio_spawn_chld_pid (devio, EPICS_PROCSERV_NAME, argv_exec);
 
             if (child_devio_cfg_pid < 0) {
                 DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] Could not create "
                         "AFE EPICS instance for board %u, bpm %u\n", dev_id, j);
                 goto err_spawn_afe_epics;
             }
+            chld [j].afe_ioc = child_devio_cfg_pid;
         }
 
         free (bpm_id_c);
@@ -830,10 +1719,6 @@ err_register_sm:
 
 static devio_err_e _spawn_be_platform_smios (void *pipe, zhashx_t *hints, uint32_t dev_id)
 {
-    const char *fmc_board_130m_4ch = "fmc130m_4ch";
-    const char *fmc_board_250m_4ch = "fmc250m_4ch";
-    uint32_t fmc130m_4ch_id = 0x7085ef15;
-    uint32_t fmc250m_4ch_id = 0x68e3b1af;
     uint32_t acq_id = 0x4519a0ad;
     uint32_t dsp_id = 0x1bafbf1e;
     uint32_t swap_id = 0x12897592;
@@ -843,29 +1728,7 @@ static devio_err_e _spawn_be_platform_smios (void *pipe, zhashx_t *hints, uint32
 #if defined (__BOARD_ML605__) || (__BOARD_AFCV3__)
     DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Spawning default SMIOs ...\n");
 
-    /* Look for which FMC board to spawn */
-    char hints_key [HUTILS_CFG_HASH_KEY_MAX_LEN];
-    snprintf (hints_key, sizeof (hints_key),
-            HUTILS_CFG_HASH_KEY_PATTERN_COMPL, dev_id, 0);
-
-    hutils_hints_t *cfg_item = zhashx_lookup (hints, hints_key);
-    /* If key is not found, assume the fmc130m default FMC board */
-    if (cfg_item == NULL || cfg_item->fmc_board == NULL ||
-            streq (cfg_item->fmc_board, "") || streq (cfg_item->fmc_board,
-                fmc_board_130m_4ch)) {
-        /* Default FMC Board */
-        err = devio_register_sm (pipe, fmc130m_4ch_id, FMC1_130M_BASE_ADDR, 0);
-        if (err != DEVIO_SUCCESS) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] devio_register_sm error!\n");
-        }
-    }
-    else if (streq (cfg_item->fmc_board, fmc_board_250m_4ch)) {
-        /* FMC250m Board */
-        err = devio_register_sm (pipe, fmc250m_4ch_id, FMC1_250M_BASE_ADDR, 0);
-        if (err != DEVIO_SUCCESS) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] devio_register_sm error!\n");
-        }
-    }
+    err = _spawn_fmc_smio (pipe, hints, dev_id, 0);
 
     err = devio_register_sm (pipe, acq_id, WB_ACQ1_BASE_ADDR, 0);
     if (err != DEVIO_SUCCESS) {
@@ -889,27 +1752,7 @@ static devio_err_e _spawn_be_platform_smios (void *pipe, zhashx_t *hints, uint32
 
     DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[ebpm] Spawning AFCv3 specific SMIOs ...\n");
 
-    snprintf (hints_key, sizeof (hints_key),
-            HUTILS_CFG_HASH_KEY_PATTERN_COMPL, dev_id, 0);
-
-    cfg_item = zhashx_lookup (hints, hints_key);
-    /* If key is not found, assume the fmc130m default FMC board */
-    if (cfg_item == NULL || cfg_item->fmc_board == NULL ||
-            streq (cfg_item->fmc_board, "") || streq (cfg_item->fmc_board,
-                fmc_board_130m_4ch)) {
-        /* Default FMC Board */
-        err = devio_register_sm (pipe, fmc130m_4ch_id, FMC2_130M_BASE_ADDR, 1);
-        if (err != DEVIO_SUCCESS) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] devio_register_sm error!\n");
-        }
-    }
-    else if (streq (cfg_item->fmc_board, fmc_board_250m_4ch)) {
-        /* FMC250m Board */
-        err = devio_register_sm (pipe, fmc250m_4ch_id, FMC2_250M_BASE_ADDR, 1);
-        if (err != DEVIO_SUCCESS) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] devio_register_sm error!\n");
-        }
-    }
+    err = _spawn_fmc_smio (pipe, hints, dev_id, 1);
 
     err = devio_register_sm (pipe, acq_id, WB_ACQ2_BASE_ADDR, 1);
     if (err != DEVIO_SUCCESS) {
@@ -953,6 +1796,51 @@ static devio_err_e _spawn_be_platform_smios (void *pipe, zhashx_t *hints, uint32
     return err;
 }
 
+/* Register the FMC SMIO of instance "inst_id". Both FMCs are of the type
+ * given by the "fmc_board" hint of the first instance of the board,
+ * fmc130m_4ch if none */
+static devio_err_e _spawn_fmc_smio (void *pipe, zhashx_t *hints, uint32_t dev_id,
+        uint32_t inst_id)
+{
+    devio_err_e err = DEVIO_SUCCESS;
+    uint64_t fmc130m_4ch_base = FMC1_130M_BASE_ADDR;
+    uint64_t fmc250m_4ch_base = FMC1_250M_BASE_ADDR;
+#if defined (__BOARD_AFCV3__)
+    if (inst_id == 1) {
+        fmc130m_4ch_base = FMC2_130M_BASE_ADDR;
+        fmc250m_4ch_base = FMC2_250M_BASE_ADDR;
+    }
+#endif
+
+    /* Look for which FMC board to spawn */
+    char hints_key [HUTILS_CFG_HASH_KEY_MAX_LEN];
+    snprintf (hints_key, sizeof (hints_key),
+            HUTILS_CFG_HASH_KEY_PATTERN_COMPL, dev_id, 0);
+
+    hutils_hints_t *cfg_item = zhashx_lookup (hints, hints_key);
+    /* If key is not found, assume the fmc130m default FMC board */
+    if (cfg_item == NULL || cfg_item->fmc_board == NULL ||
+            streq (cfg_item->fmc_board, "") || streq (cfg_item->fmc_board,
+                FMC130M_4CH_NAME)) {
+        /* Default FMC Board */
+        err = devio_register_sm (pipe, FMC130M_4CH_SMIO_ID, fmc130m_4ch_base,
+                inst_id);
+        if (err != DEVIO_SUCCESS) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] devio_register_sm error!\n");
+        }
+    }
+    else if (streq (cfg_item->fmc_board, FMC250M_4CH_NAME)) {
+        /* FMC250m Board */
+        err = devio_register_sm (pipe, FMC250M_4CH_SMIO_ID, fmc250m_4ch_base,
+                inst_id);
+        if (err != DEVIO_SUCCESS) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[ebpm] devio_register_sm error!\n");
+        }
+    }
+
+    return err;
+}
+
 static devio_err_e _spawn_fe_platform_smios (void *pipe, uint32_t smio_inst_id)
 {
     uint32_t rffe_id = 0x7af21909;
@@ -972,3 +1860,18 @@ static devio_err_e _spawn_fe_platform_smios (void *pipe, uint32_t smio_inst_id)
 
     return err;
 }
+
+/* Tell the dev_mngr that spawned us that we are up */
+static void _notify_dmngr_ready (void)
+{
+    const char *dmngr_pid_str = getenv (DMNGR_PID_ENV);
+    if (dmngr_pid_str == NULL) {
+        return;
+    }
+
+    /* The DEVIOs we spawn ourselves inherit the variable too */
+    pid_t dmngr_pid = (pid_t) strtol (dmngr_pid_str, NULL, 10);
+    if (dmngr_pid > 0 && dmngr_pid == getppid ()) {
+        kill (dmngr_pid, DMNGR_READY_SIGNAL);
+    }
+}
@@ -2,6 +2,10 @@ ebpm_DIR = $(SRC_DIR)/apps/ebpm
 
 ebpm_OBJS = $(ebpm_DIR)/ebpm.o
 
+ifneq ($(filter y,$(RT_ALLOC_CHECK) $(ALLOC_ACCT)),)
+ebpm_OBJS += $(ebpm_DIR)/ebpm_rt.o
+endif
+
 ebpm_OUT = ebpm
 
 ifeq ($(WITH_APP_CFG),y)
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Allocator wrappers counting the allocations made inside the real-time
+ * guard of the handlers, see hutils_mem_rt_guard_begin (), and the ones of
+ * the threads with allocation accounting attached, see
+ * hutils_mem_acct_attach (). Only linked in with RT_ALLOC_CHECK=y or
+ * ALLOC_ACCT=y, as they replace the glibc ones for the whole program */
+
+#include "bpm_server.h"
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static void __attribute__ ((constructor)) _ebpm_rt_init (void)
+{
+    hutils_mem_acct_wrapped = true;
+}
+
+static inline void _ebpm_rt_count (size_t size)
+{
+    if (hutils_mem_rt_guard) {
+        hutils_mem_rt_allocs++;
+    }
+
+    hutils_mem_acct_t *acct = hutils_mem_acct;
+    if (acct != NULL) {
+        uint32_t subsys = hutils_mem_acct_subsys;
+        uint32_t opcode = hutils_mem_acct_opcode;
+        acct->allocs [subsys]++;
+        acct->bytes [subsys] += size;
+        if (opcode < HUTILS_MEM_ACCT_MAX_OPCODES) {
+            acct->op_allocs [opcode]++;
+            acct->op_bytes [opcode] += size;
+        }
+    }
+}
+
+void *malloc (size_t size)
+{
+    _ebpm_rt_count (size);
+    return __libc_malloc (size);
+}
+
+void *calloc (size_t nmemb, size_t size)
+{
+    _ebpm_rt_count (nmemb * size);
+    return __libc_calloc (nmemb, size);
+}
+
+void *realloc (void *ptr, size_t size)
+{
+    _ebpm_rt_count (size);
+    return __libc_realloc (ptr, size);
+}
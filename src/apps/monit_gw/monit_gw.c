@@ -0,0 +1,806 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <inttypes.h>
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...)  \
+    ASSERT_HAL_TEST(test_boolean, DEV_IO, "[monit_gw]",             \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)       \
+    ASSERT_HAL_ALLOC(ptr, DEV_IO, "[monit_gw]",                     \
+            devio_err_str (DEVIO_ERR_ALLOC),                        \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                    \
+    CHECK_HAL_ERR(err, DEV_IO, "[monit_gw]",                        \
+            devio_err_str (err_type))
+
+/* Monitoring aggregation gateway. Subscribes once to the monitoring stream
+ * of every BPM of every crate and republishes them merged into orbit-wide
+ * records on its own broker, see bpm_client_monit_gw.h */
+
+#define MONIT_GW_MAX_CRATES             32
+/* Arbitrary hard limit for the number of boards of a crate */
+#define MONIT_GW_MAX_BOARDS             12
+#define MONIT_GW_MAX_BPM_NUMBER         1
+#define MONIT_GW_MAX_SHARDS             16
+#define MONIT_GW_MAX_BPMS               (MONIT_GW_MAX_CRATES * MONIT_GW_MAX_BOARDS * \
+                                            (MONIT_GW_MAX_BPM_NUMBER + 1))
+/* At most one connection to each broker shard of each crate */
+#define MONIT_GW_MAX_LINKS              (MONIT_GW_MAX_CRATES * MONIT_GW_MAX_SHARDS)
+/* Records being merged at once. Updates more than this many periods ahead
+ * of the oldest one get it published */
+#define MONIT_GW_SLOTS                  8
+
+#define MONIT_GW_LIST_SEP               ","
+#define MONIT_GW_CRATE_SEP              '='
+#define MONIT_GW_SERVICE_LEN            50
+#define MONIT_GW_SERVICE_PATTERN        "BPM%u:DEVIO:DSP%u"
+
+#define MONIT_GW_DFLT_NAME              "MONIT_GW"
+#define MONIT_GW_DFLT_BPM_LIST          "0,1"
+#define MONIT_GW_DFLT_SHARDS            1
+#define MONIT_GW_DFLT_PERIOD            100     /* in msec, the default monitoring
+                                                   period of the DSP SMIO */
+#define MONIT_GW_PERIOD_MAX             60000   /* in msec */
+#define MONIT_GW_STATS_INTERVAL         10000   /* in msec */
+#define MONIT_GW_CONNECT_TIMEOUT        5000    /* in msec */
+#define MONIT_GW_LOG_MODE               "w"
+
+#define MONIT_GW_NS_PER_MS              1000000LL
+
+/* BPM merged into the records */
+typedef struct {
+    char service [MONIT_GW_SERVICE_LEN];
+    char *endp;                             /* Broker shard the service is on */
+} monit_gw_bpm_t;
+
+/* Connection to a broker shard of a crate, subscribed to the monitoring
+ * streams of the BPMs on it */
+typedef struct {
+    char *endp;
+    mlm_client_t *client;
+    zhashx_t *bpms;                         /* BPM index + 1, keyed by stream */
+} monit_gw_link_t;
+
+/* Record being merged */
+typedef struct {
+    bool open;
+    int64_t slot;
+    uint32_t num_valid;
+    bpm_monit_gw_bpm_t *bpms;
+} monit_gw_rec_t;
+
+typedef struct {
+    monit_gw_bpm_t bpms [MONIT_GW_MAX_BPMS];
+    uint32_t num_bpms;
+    monit_gw_link_t links [MONIT_GW_MAX_LINKS];
+    uint32_t num_links;
+    mlm_client_t *producer;                 /* Publishes the records */
+    int64_t period;                         /* Slot length, in ns */
+    int64_t latency;                        /* Time a record waits for late
+                                               updates after its slot, in ns */
+    monit_gw_rec_t recs [MONIT_GW_SLOTS];   /* Slot s at s%MONIT_GW_SLOTS */
+    uint32_t num_open;
+    int64_t base;                           /* Oldest slot not published yet,
+                                               -1 before the first update */
+    uint32_t seq;
+    uint8_t *frame;                         /* Record being published */
+    size_t frame_size;
+    /* Statistics */
+    uint64_t updates;
+    uint64_t records;
+    uint64_t incomplete;                    /* Records published without all
+                                               of the BPMs */
+    uint64_t late;                          /* Updates of published slots */
+    uint64_t dups;
+} monit_gw_t;
+
+static int _parse_list (const char *str, uint32_t *list, uint32_t max);
+static devio_err_e _add_crate (monit_gw_t *gw, const char *spec,
+        const uint32_t *bpm_nums, uint32_t num_bpm_nums, uint32_t num_shards);
+static devio_err_e _add_board (monit_gw_t *gw, const char *endp, uint32_t board,
+        const uint32_t *bpm_nums, uint32_t num_bpm_nums);
+static monit_gw_link_t *_get_link (monit_gw_t *gw, const char *endp);
+static devio_err_e _connect_links (monit_gw_t *gw, zpoller_t *poller);
+static void _handle_update (monit_gw_t *gw, uint32_t bpm,
+        const smio_dsp_monit_t *monit);
+static void _expire (monit_gw_t *gw, int64_t now);
+static int _next_deadline (monit_gw_t *gw, int64_t now);
+static void _publish_base (monit_gw_t *gw);
+static void _publish_map (monit_gw_t *gw);
+static int64_t _now (void);
+
+static struct option long_options[] =
+{
+    {"help",                no_argument,         NULL, 'h'},
+    {"brokerendp",          required_argument,   NULL, 'b'},
+    {"crate",               required_argument,   NULL, 'c'},
+    {"bpmnumbers",          required_argument,   NULL, 's'},
+    {"shards",              required_argument,   NULL, 'S'},
+    {"period",              required_argument,   NULL, 'p'},
+    {"latency",             required_argument,   NULL, 'L'},
+    {"name",                required_argument,   NULL, 'n'},
+    {"daemon",              no_argument,         NULL, 'd'},
+    {"daemonworkdir",       required_argument,   NULL, 'w'},
+    {"logfilename",         required_argument,   NULL, 'l'},
+    {NULL, 0, NULL, 0}
+};
+
+static const char* shortopt = "hb:c:s:S:p:L:n:dw:l:";
+
+void print_help (char *program_name)
+{
+    fprintf (stdout, "EBPM Monitoring Aggregation Gateway\n"
+            "Usage: %s [options]\n"
+            "Version %s\n, Build by: %s, %s\n"
+            "\n"
+            "Merges the monitoring streams of the DSP services of several crates\n"
+            "into orbit-wide records, republished on \"<name>:"
+            BPM_MONIT_GW_STREAM_SUFFIX "\".\n"
+            "\n"
+            "  -h  --help                           Display this usage information\n"
+            "  -b  --brokerendp <Broker endpoint>   Broker endpoint the records are\n"
+            "                                       published on\n"
+            "  -c  --crate <Broker endpoint>=<Board slot list>\n"
+            "                                       Crate broker and comma-separated\n"
+            "                                       board slot numbers. Once per crate\n"
+            "  -s  --bpmnumbers <BPM number list>   Comma-separated BPM numbers [0|1]\n"
+            "                                       of each board (default: "
+            MONIT_GW_DFLT_BPM_LIST ")\n"
+            "  -S  --shards <Number of shards>      Broker shards of each crate\n"
+            "  -p  --period <Period>                Record period, in ms. It should\n"
+            "                                       be the monitoring period of the\n"
+            "                                       BPMs\n"
+            "  -L  --latency <Latency>              Time a record waits for late\n"
+            "                                       updates, in ms (default: period)\n"
+            "  -n  --name <Name>                    Gateway name (default: "
+            MONIT_GW_DFLT_NAME ")\n"
+            "  -d  --daemon                         Run as system daemon.\n"
+            "  -w  --daemonworkdir <Work Directory> Daemon working directory.\n"
+            "  -l  --logfilename <Log filename>     Log filename\n",
+            program_name,
+            revision_get_build_version (),
+            revision_get_build_user_name (), revision_get_build_date ());
+}
+
+int main (int argc, char *argv[])
+{
+    int gw_daemonize = 0;
+    char *gw_work_dir = NULL;
+    char *broker_endp = NULL;
+    char *crate_specs [MONIT_GW_MAX_CRATES];
+    int ncrates = 0;
+    char *bpm_list_str = NULL;
+    char *shards_str = NULL;
+    char *period_str = NULL;
+    char *latency_str = NULL;
+    char *name = NULL;
+    char *log_filename = NULL;
+    int opt;
+    int i;
+
+    while ((opt = getopt_long (argc, argv, shortopt, long_options, NULL)) != -1) {
+        /* Get the user selected options */
+        switch (opt) {
+            /* Display Help */
+            case 'h':
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            case 'b':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set broker_endp parameter\n");
+                broker_endp = strdup (optarg);
+                break;
+
+            case 'c':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will add crate\n");
+                if (ncrates == MONIT_GW_MAX_CRATES) {
+                    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] Too many crates\n");
+                    exit (1);
+                }
+                crate_specs [ncrates++] = strdup (optarg);
+                break;
+
+            case 's':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set bpm_list parameter\n");
+                bpm_list_str = strdup (optarg);
+                break;
+
+            case 'S':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set shards parameter\n");
+                shards_str = strdup (optarg);
+                break;
+
+            case 'p':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set period parameter\n");
+                period_str = strdup (optarg);
+                break;
+
+            case 'L':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set latency parameter\n");
+                latency_str = strdup (optarg);
+                break;
+
+            case 'n':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set name parameter\n");
+                name = strdup (optarg);
+                break;
+
+            case 'd':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set daemon parameter\n");
+                gw_daemonize = 1;
+                break;
+
+            case 'w':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set gw_work_dir parameter\n");
+                gw_work_dir = strdup (optarg);
+                break;
+
+            case 'l':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Will set log filename\n");
+                log_filename = strdup (optarg);
+                break;
+
+            case '?':
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] Option not recognized or missing argument\n");
+                print_help (argv [0]);
+                exit (1);
+                break;
+
+            default:
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] Could not parse options\n");
+                print_help (argv [0]);
+                exit (1);
+        }
+    }
+
+    zpoller_t *poller = NULL;
+    monit_gw_t *gw = NULL;
+    char *stream = NULL;
+
+    /* Check command-line parse options */
+    if (broker_endp == NULL || ncrates == 0) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] Broker endpoint "
+                "and crates must be specified\n");
+        print_help (argv [0]);
+        goto err_exit;
+    }
+
+    uint32_t period = (period_str == NULL) ? MONIT_GW_DFLT_PERIOD :
+        strtoul (period_str, NULL, 10);
+    uint32_t latency = (latency_str == NULL) ? period :
+        strtoul (latency_str, NULL, 10);
+    uint32_t num_shards = (shards_str == NULL) ? MONIT_GW_DFLT_SHARDS :
+        strtoul (shards_str, NULL, 10);
+    if (period == 0 || period > MONIT_GW_PERIOD_MAX ||
+            latency > MONIT_GW_PERIOD_MAX ||
+            num_shards == 0 || num_shards > MONIT_GW_MAX_SHARDS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] Period, latency or "
+                "shards parameter is out of range\n");
+        goto err_exit;
+    }
+
+    uint32_t bpm_nums [MONIT_GW_MAX_BPM_NUMBER + 1];
+    int num_bpm_nums = _parse_list ((bpm_list_str == NULL) ?
+            MONIT_GW_DFLT_BPM_LIST : bpm_list_str, bpm_nums,
+            MONIT_GW_MAX_BPM_NUMBER + 1);
+    if (num_bpm_nums <= 0) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] BPM numbers "
+                "parameter is invalid\n");
+        goto err_exit;
+    }
+    for (i = 0; i < num_bpm_nums; ++i) {
+        if (bpm_nums [i] > MONIT_GW_MAX_BPM_NUMBER) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] BPM number "
+                    "%u is out of range\n", bpm_nums [i]);
+            goto err_exit;
+        }
+    }
+
+    /* Daemonize gateway */
+    if (gw_daemonize != 0) {
+        if (gw_work_dir == NULL) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] Daemon working directory not specified\n");
+            goto err_exit;
+        }
+
+        int rc = zsys_daemonize (gw_work_dir);
+        if (rc != 0) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_FATAL, "[monit_gw] Fail to daemonize\n");
+            goto err_exit;
+        }
+    }
+
+    if (log_filename != NULL) {
+        errhand_set_log (log_filename, MONIT_GW_LOG_MODE);
+    }
+
+    gw = (monit_gw_t *) zmalloc (sizeof *gw);
+    ASSERT_ALLOC(gw, err_exit);
+    gw->period = (int64_t) period * MONIT_GW_NS_PER_MS;
+    gw->latency = (int64_t) latency * MONIT_GW_NS_PER_MS;
+    gw->base = -1;
+
+    for (i = 0; i < ncrates; ++i) {
+        devio_err_e err = _add_crate (gw, crate_specs [i], bpm_nums,
+                num_bpm_nums, num_shards);
+        ASSERT_TEST(err == DEVIO_SUCCESS, "Could not add crate", err_cleanup);
+    }
+
+    gw->frame_size = sizeof (bpm_monit_gw_hdr_t) +
+        gw->num_bpms * sizeof (bpm_monit_gw_bpm_t);
+    gw->frame = (uint8_t *) zmalloc (gw->frame_size);
+    ASSERT_ALLOC(gw->frame, err_cleanup);
+    for (i = 0; i < MONIT_GW_SLOTS; ++i) {
+        gw->recs [i].bpms = (bpm_monit_gw_bpm_t *) zmalloc (gw->num_bpms *
+                sizeof (bpm_monit_gw_bpm_t));
+        ASSERT_ALLOC(gw->recs [i].bpms, err_cleanup);
+    }
+
+    /* Records go to our own broker */
+    stream = hutils_concat_strings ((name == NULL) ? MONIT_GW_DFLT_NAME : name,
+            BPM_MONIT_GW_STREAM_SUFFIX, ':');
+    ASSERT_ALLOC(stream, err_cleanup);
+    gw->producer = mlm_client_new ();
+    ASSERT_ALLOC(gw->producer, err_cleanup);
+    int rc = mlm_client_connect (gw->producer, broker_endp,
+            MONIT_GW_CONNECT_TIMEOUT, "");
+    ASSERT_TEST(rc >= 0, "Could not connect to the broker", err_cleanup);
+    rc = mlm_client_set_producer (gw->producer, stream);
+    ASSERT_TEST(rc >= 0, "Could not publish records", err_cleanup);
+
+    poller = zpoller_new (NULL);
+    ASSERT_ALLOC(poller, err_cleanup);
+    devio_err_e err = _connect_links (gw, poller);
+    ASSERT_TEST(err == DEVIO_SUCCESS, "Could not subscribe to the monitoring "
+            "streams", err_cleanup);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[monit_gw] Merging %u BPMs from "
+            "%u broker shards into %s, every %u ms\n", gw->num_bpms,
+            gw->num_links, stream, period);
+
+    _publish_map (gw);
+    int64_t map_time = zclock_mono ();
+    int64_t stats_time = map_time;
+    while (!zsys_interrupted) {
+        void *which = zpoller_wait (poller, _next_deadline (gw, _now ()));
+        if (which == NULL && zpoller_terminated (poller)) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE, "[monit_gw] Interrupted\n");
+            break;
+        }
+
+        if (which != NULL) {
+            monit_gw_link_t *link = NULL;
+            uint32_t l;
+            for (l = 0; l < gw->num_links; ++l) {
+                if (mlm_client_msgpipe (gw->links [l].client) == which) {
+                    link = &gw->links [l];
+                    break;
+                }
+            }
+
+            zmsg_t *msg = (link != NULL) ? mlm_client_recv (link->client) : NULL;
+            if (msg != NULL) {
+                /* Message is:
+                 * frame 0: smio_dsp_monit_t */
+                zframe_t *frame = zmsg_first (msg);
+                uintptr_t bpm = (uintptr_t) zhashx_lookup (link->bpms,
+                        mlm_client_address (link->client));
+                if (frame != NULL && zframe_size (frame) == sizeof (smio_dsp_monit_t) &&
+                        bpm != 0) {
+                    smio_dsp_monit_t monit;
+                    memcpy (&monit, zframe_data (frame), sizeof (monit));
+                    _handle_update (gw, bpm - 1, &monit);
+                }
+                zmsg_destroy (&msg);
+            }
+        }
+
+        _expire (gw, _now ());
+
+        int64_t mono = zclock_mono ();
+        if (mono - map_time >= BPM_MONIT_GW_MAP_INTERVAL) {
+            _publish_map (gw);
+            map_time = mono;
+        }
+        if (mono - stats_time >= MONIT_GW_STATS_INTERVAL) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[monit_gw] %"PRIu64" updates, "
+                    "%"PRIu64" records (%"PRIu64" incomplete), %"PRIu64" late "
+                    "and %"PRIu64" duplicated updates\n", gw->updates,
+                    gw->records, gw->incomplete, gw->late, gw->dups);
+            stats_time = mono;
+        }
+    }
+
+err_cleanup:
+    zpoller_destroy (&poller);
+    if (gw != NULL) {
+        uint32_t l;
+        for (l = 0; l < gw->num_links; ++l) {
+            mlm_client_destroy (&gw->links [l].client);
+            zhashx_destroy (&gw->links [l].bpms);
+            free (gw->links [l].endp);
+        }
+        uint32_t b;
+        for (b = 0; b < gw->num_bpms; ++b) {
+            free (gw->bpms [b].endp);
+        }
+        for (i = 0; i < MONIT_GW_SLOTS; ++i) {
+            free (gw->recs [i].bpms);
+        }
+        mlm_client_destroy (&gw->producer);
+        free (gw->frame);
+        free (gw);
+    }
+    free (stream);
+err_exit:
+    for (i = 0; i < ncrates; ++i) {
+        free (crate_specs [i]);
+    }
+    free (log_filename);
+    free (name);
+    free (latency_str);
+    free (period_str);
+    free (shards_str);
+    free (bpm_list_str);
+    free (gw_work_dir);
+    free (broker_endp);
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[monit_gw] Exiting ...\n");
+    return 0;
+}
+
+/* Current time, in ns since the Epoch. Updates are stamped with the host
+ * wall clock of their crates, so this is the clock to compare them to */
+static int64_t _now (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+    return (int64_t) now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* Parse the comma-separated list "str" into "list". Returns the number of
+ * items or -1 if there are more than "max" */
+static int _parse_list (const char *str, uint32_t *list, uint32_t max)
+{
+    assert (str);
+    assert (list);
+
+    int num = 0;
+    char *saveptr = NULL;
+    char *copy = strdup (str);
+    ASSERT_ALLOC (copy, err_copy_alloc);
+
+    char *item = strtok_r (copy, MONIT_GW_LIST_SEP, &saveptr);
+    for (; item != NULL; item = strtok_r (NULL, MONIT_GW_LIST_SEP, &saveptr)) {
+        ASSERT_TEST ((uint32_t) num < max, "Too many items", err_max_items);
+        list [num++] = strtoul (item, NULL, 10);
+    }
+
+    free (copy);
+    return num;
+
+err_max_items:
+    free (copy);
+err_copy_alloc:
+    return -1;
+}
+
+/* Get the link to the broker shard "endp", adding it if there is none */
+static monit_gw_link_t *_get_link (monit_gw_t *gw, const char *endp)
+{
+    uint32_t l;
+    for (l = 0; l < gw->num_links; ++l) {
+        if (streq (gw->links [l].endp, endp)) {
+            return &gw->links [l];
+        }
+    }
+
+    ASSERT_TEST (gw->num_links < MONIT_GW_MAX_LINKS, "Too many broker shards",
+            err_max_links);
+    monit_gw_link_t *link = &gw->links [gw->num_links];
+    link->endp = strdup (endp);
+    ASSERT_ALLOC (link->endp, err_endp_alloc);
+    link->bpms = zhashx_new ();
+    ASSERT_ALLOC (link->bpms, err_bpms_alloc);
+    gw->num_links++;
+
+    return link;
+
+err_bpms_alloc:
+    free (link->endp);
+    link->endp = NULL;
+err_endp_alloc:
+err_max_links:
+    return NULL;
+}
+
+/* Add the BPMs "bpm_nums" of board "board", on the broker shard "endp" */
+static devio_err_e _add_board (monit_gw_t *gw, const char *endp, uint32_t board,
+        const uint32_t *bpm_nums, uint32_t num_bpm_nums)
+{
+    devio_err_e err = DEVIO_SUCCESS;
+
+    monit_gw_link_t *link = _get_link (gw, endp);
+    ASSERT_TEST (link != NULL, "Could not add broker shard", err_link,
+            DEVIO_ERR_ALLOC);
+
+    uint32_t i;
+    for (i = 0; i < num_bpm_nums; ++i) {
+        ASSERT_TEST (gw->num_bpms < MONIT_GW_MAX_BPMS, "Too many BPMs",
+                err_max_bpms, DEVIO_ERR_CFG);
+        monit_gw_bpm_t *bpm = &gw->bpms [gw->num_bpms];
+        snprintf (bpm->service, sizeof (bpm->service),
+                MONIT_GW_SERVICE_PATTERN, board, bpm_nums [i]);
+
+        char *stream = hutils_concat_strings (bpm->service,
+                DSP_MONIT_STREAM_SUFFIX, ':');
+        ASSERT_ALLOC (stream, err_stream_alloc, DEVIO_ERR_ALLOC);
+        int rc = zhashx_insert (link->bpms, stream,
+                (void *) (uintptr_t) (gw->num_bpms + 1));
+        free (stream);
+        ASSERT_TEST (rc == 0, "BPM given twice", err_insert, DEVIO_ERR_CFG);
+
+        bpm->endp = strdup (endp);
+        ASSERT_ALLOC (bpm->endp, err_endp_alloc, DEVIO_ERR_ALLOC);
+        gw->num_bpms++;
+    }
+
+err_endp_alloc:
+err_insert:
+err_stream_alloc:
+err_max_bpms:
+err_link:
+    return err;
+}
+
+/* Add the BPMs of the crate "spec", "<broker endpoint>=<board slot list>".
+ * Each BPM is on the broker shard of its board */
+static devio_err_e _add_crate (monit_gw_t *gw, const char *spec,
+        const uint32_t *bpm_nums, uint32_t num_bpm_nums, uint32_t num_shards)
+{
+    devio_err_e err = DEVIO_SUCCESS;
+    char *endp = NULL;
+
+    const char *sep = strrchr (spec, MONIT_GW_CRATE_SEP);
+    ASSERT_TEST (sep != NULL && sep != spec, "Crate must be given as <broker "
+            "endpoint>=<board slot list>", err_inv_spec, DEVIO_ERR_CFG);
+    endp = strndup (spec, sep - spec);
+    ASSERT_ALLOC (endp, err_endp_alloc, DEVIO_ERR_ALLOC);
+
+    uint32_t boards [MONIT_GW_MAX_BOARDS];
+    int num_boards = _parse_list (sep + 1, boards, MONIT_GW_MAX_BOARDS);
+    ASSERT_TEST (num_boards > 0, "Invalid board slot list", err_inv_boards,
+            DEVIO_ERR_CFG);
+
+    int i;
+    for (i = 0; i < num_boards; ++i) {
+        char *shard_endp = hutils_broker_shard_endp (endp,
+                hutils_broker_shard (boards [i], num_shards));
+        ASSERT_ALLOC (shard_endp, err_shard_endp_alloc, DEVIO_ERR_ALLOC);
+        err = _add_board (gw, shard_endp, boards [i], bpm_nums, num_bpm_nums);
+        free (shard_endp);
+        ASSERT_TEST (err == DEVIO_SUCCESS, "Could not add board", err_add_board);
+    }
+
+err_add_board:
+err_shard_endp_alloc:
+err_inv_boards:
+    free (endp);
+err_endp_alloc:
+err_inv_spec:
+    return err;
+}
+
+/* Connect to every broker shard and subscribe to the monitoring streams of
+ * its BPMs */
+static devio_err_e _connect_links (monit_gw_t *gw, zpoller_t *poller)
+{
+    devio_err_e err = DEVIO_SUCCESS;
+
+    uint32_t l;
+    for (l = 0; l < gw->num_links; ++l) {
+        monit_gw_link_t *link = &gw->links [l];
+        link->client = mlm_client_new ();
+        ASSERT_ALLOC (link->client, err_client_alloc, DEVIO_ERR_ALLOC);
+        int rc = mlm_client_connect (link->client, link->endp,
+                MONIT_GW_CONNECT_TIMEOUT, "");
+        ASSERT_TEST (rc >= 0, "Could not connect to a crate broker",
+                err_client_connect, DEVIO_ERR_INV_SOCKET);
+
+        void *bpm;
+        for (bpm = zhashx_first (link->bpms); bpm != NULL;
+                bpm = zhashx_next (link->bpms)) {
+            const char *stream = (const char *) zhashx_cursor (link->bpms);
+            rc = mlm_client_set_consumer (link->client, stream,
+                    DSP_MONIT_SUBJECT_DATA);
+            ASSERT_TEST (rc >= 0, "Could not subscribe to a monitoring stream",
+                    err_set_consumer, DEVIO_ERR_BAD_MSG);
+        }
+
+        rc = zpoller_add (poller, mlm_client_msgpipe (link->client));
+        ASSERT_TEST (rc == 0, "Could not poll a crate broker", err_poller_add,
+                DEVIO_ERR_ALLOC);
+    }
+
+    return err;
+
+err_poller_add:
+err_set_consumer:
+err_client_connect:
+err_client_alloc:
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_ERR, "[monit_gw] Broker shard %s failed\n",
+            gw->links [l].endp);
+    return err;
+}
+
+/* Merge the update "monit" of BPM "bpm" into the record of its slot */
+static void _handle_update (monit_gw_t *gw, uint32_t bpm,
+        const smio_dsp_monit_t *monit)
+{
+    int64_t slot = (int64_t) (monit->timestamp / gw->period);
+    gw->updates++;
+
+    if (gw->base < 0) {
+        gw->base = slot;
+    }
+
+    if (slot < gw->base) {
+        gw->late++;
+        return;
+    }
+
+    /* Make room for the slot, keeping the records in order */
+    while (slot >= gw->base + MONIT_GW_SLOTS) {
+        if (gw->num_open == 0) {
+            gw->base = slot - MONIT_GW_SLOTS + 1;
+            break;
+        }
+        _publish_base (gw);
+    }
+
+    monit_gw_rec_t *rec = &gw->recs [slot % MONIT_GW_SLOTS];
+    if (!rec->open) {
+        memset (rec->bpms, 0, gw->num_bpms * sizeof (*rec->bpms));
+        rec->open = true;
+        rec->slot = slot;
+        rec->num_valid = 0;
+        gw->num_open++;
+    }
+
+    bpm_monit_gw_bpm_t *entry = &rec->bpms [bpm];
+    if (entry->flags & BPM_MONIT_GW_BPM_VALID) {
+        entry->flags |= BPM_MONIT_GW_BPM_DUP;
+        gw->dups++;
+    }
+    else {
+        entry->flags = BPM_MONIT_GW_BPM_VALID;
+        rec->num_valid++;
+    }
+    entry->seq = monit->seq;
+    entry->dt = (int32_t) ((int64_t) (monit->timestamp - slot * gw->period) / 1000);
+    entry->pos_x = monit->pos_x;
+    entry->pos_y = monit->pos_y;
+    entry->pos_q = monit->pos_q;
+    entry->pos_sum = monit->pos_sum;
+
+    /* Complete records go right away, but only once the ones before them
+     * are gone */
+    while (gw->num_open > 0) {
+        monit_gw_rec_t *base = &gw->recs [gw->base % MONIT_GW_SLOTS];
+        if (!base->open || base->num_valid < gw->num_bpms) {
+            break;
+        }
+        _publish_base (gw);
+    }
+}
+
+/* Publish the records whose slot ended more than "latency" before "now" */
+static void _expire (monit_gw_t *gw, int64_t now)
+{
+    while (gw->base >= 0 && (gw->base + 1) * gw->period + gw->latency <= now) {
+        /* With nothing to publish, skip to the first slot that can still
+         * take updates */
+        if (gw->num_open == 0) {
+            gw->base = (now - gw->latency) / gw->period;
+            break;
+        }
+        _publish_base (gw);
+    }
+}
+
+/* Time until the oldest record expires, in ms, for waiting on updates */
+static int _next_deadline (monit_gw_t *gw, int64_t now)
+{
+    if (gw->num_open == 0) {
+        return BPM_MONIT_GW_MAP_INTERVAL;
+    }
+
+    int64_t deadline = (gw->base + 1) * gw->period + gw->latency;
+    int64_t wait = (deadline - now) / MONIT_GW_NS_PER_MS + 1;
+    if (wait < 0) {
+        wait = 0;
+    }
+    return (wait < BPM_MONIT_GW_MAP_INTERVAL) ? (int) wait : BPM_MONIT_GW_MAP_INTERVAL;
+}
+
+/* Publish the record of the oldest slot, if any BPM updated in it, and move
+ * on to the next slot */
+static void _publish_base (monit_gw_t *gw)
+{
+    monit_gw_rec_t *rec = &gw->recs [gw->base % MONIT_GW_SLOTS];
+    if (!rec->open || rec->slot != gw->base) {
+        gw->base++;
+        return;
+    }
+
+    bpm_monit_gw_hdr_t *hdr = (bpm_monit_gw_hdr_t *) gw->frame;
+    hdr->timestamp = (uint64_t) (rec->slot * gw->period);
+    hdr->seq = gw->seq++;
+    hdr->period = (uint32_t) (gw->period / MONIT_GW_NS_PER_MS);
+    hdr->num_bpms = gw->num_bpms;
+    hdr->num_valid = rec->num_valid;
+    memcpy (gw->frame + sizeof (*hdr), rec->bpms,
+            gw->num_bpms * sizeof (*rec->bpms));
+
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC (msg, err_msg_alloc);
+    int rc = zmsg_addmem (msg, gw->frame, gw->frame_size);
+    ASSERT_TEST (rc == 0, "Could not add record to message", err_msg_addmem);
+    rc = mlm_client_send (gw->producer, BPM_MONIT_GW_SUBJECT_ORBIT, &msg);
+    ASSERT_TEST (rc == 0, "Could not publish record", err_msg_send);
+
+    gw->records++;
+    if (rec->num_valid < gw->num_bpms) {
+        gw->incomplete++;
+    }
+
+err_msg_send:
+err_msg_addmem:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    /* Records that could not be published are dropped */
+    rec->open = false;
+    gw->num_open--;
+    gw->base++;
+}
+
+/* Publish the order of the BPMs in the records */
+static void _publish_map (monit_gw_t *gw)
+{
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC (msg, err_msg_alloc);
+
+    uint32_t b;
+    for (b = 0; b < gw->num_bpms; ++b) {
+        int rc = zmsg_addstrf (msg, "%s %s", gw->bpms [b].endp,
+                gw->bpms [b].service);
+        ASSERT_TEST (rc == 0, "Could not add BPM to message", err_msg_addstr);
+    }
+
+    int rc = mlm_client_send (gw->producer, BPM_MONIT_GW_SUBJECT_MAP, &msg);
+    ASSERT_TEST (rc == 0, "Could not publish BPM map", err_msg_send);
+
+err_msg_send:
+err_msg_addstr:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    return;
+}
@@ -0,0 +1,11 @@
+monit_gw_DIR = $(SRC_DIR)/apps/monit_gw
+
+monit_gw_OBJS = $(monit_gw_DIR)/monit_gw.o
+
+monit_gw_OUT = monit_gw
+
+monit_gw_all_OUT = monit_gw
+monit_gw_all_OBJS = $(monit_gw_OBJS)
+
+monit_gw_LIBS = -lbsmp
+monit_gw_STATIC_LIBS =
@@ -11,64 +11,24 @@
 #include "ddr3_map_structs.h"
 #include "ddr3_map.h"
 
+/* Every channel of the board description, "ACQ_CHAN_FOREACH" in acq_chan.h,
+ * gets its entry from the "DDR3_<name><core>_*" region of ddr3_map.h. The
+ * sample size is the same for all of the cores */
+#define DDR3_ACQ_BUF(name, core)                                    \
+    {                                                               \
+        .id = name##0_CHAN_ID,                                      \
+        .start_addr = DDR3_##name##core##_START_ADDR,               \
+        .end_addr = DDR3_##name##core##_END_ADDR,                   \
+        .max_samples = DDR3_##name##core##_MAX_SAMPLES,             \
+        .sample_size = DDR3_##name##0_SAMPLE_SIZE,                  \
+        .split_addr = DDR3_SPLIT_ADDR(DDR3_##name##core##_START_ADDR, \
+                DDR3_##name##core##_MEM_SIZE)                       \
+    },
+#define DDR3_ACQ_BUF_CORE0(name)       DDR3_ACQ_BUF(name, 0)
+
 const acq_buf_t __acq_buf[NUM_ACQ_CORE_SMIOS][END_CHAN_ID] = {
     /*** Acquistion 0 Channel Parameters ***/
     {
-        {
-            .id = ADC0_CHAN_ID,
-            .start_addr = DDR3_ADC0_START_ADDR,
-            .end_addr = DDR3_ADC0_END_ADDR,
-            .max_samples = DDR3_ADC0_MAX_SAMPLES,
-            .sample_size = DDR3_ADC0_SAMPLE_SIZE
-        },
-        {
-            .id = TBTAMP0_CHAN_ID,
-            .start_addr = DDR3_TBTAMP0_START_ADDR,
-            .end_addr = DDR3_TBTAMP0_END_ADDR,
-            .max_samples =  DDR3_TBTAMP0_MAX_SAMPLES,
-            .sample_size = DDR3_TBTAMP0_SAMPLE_SIZE
-        },
-        {
-            .id = TBTPOS0_CHAN_ID,
-            .start_addr = DDR3_TBTPOS0_START_ADDR,
-            .end_addr = DDR3_TBTPOS0_END_ADDR,
-            .max_samples =DDR3_TBTPOS0_MAX_SAMPLES,
-            .sample_size = DDR3_TBTPOS0_SAMPLE_SIZE
-        },
-        {
-            .id = FOFBAMP0_CHAN_ID,
-            .start_addr = DDR3_FOFBAMP0_START_ADDR,
-            .end_addr = DDR3_FOFBAMP0_END_ADDR,
-            .max_samples =  DDR3_FOFBAMP0_MAX_SAMPLES,
-            .sample_size = DDR3_FOFBAMP0_SAMPLE_SIZE
-        },
-        {
-            .id = FOFBPOS0_CHAN_ID,
-            .start_addr = DDR3_FOFBPOS0_START_ADDR,
-            .end_addr = DDR3_FOFBPOS0_END_ADDR,
-            .max_samples = DDR3_FOFBPOS0_MAX_SAMPLES,
-            .sample_size = DDR3_FOFBPOS0_SAMPLE_SIZE
-        },
-        {
-            .id = MONITAMP0_CHAN_ID,
-            .start_addr = DDR3_MONITAMP0_START_ADDR,
-            .end_addr = DDR3_MONITAMP0_END_ADDR,
-            .max_samples = DDR3_MONITAMP0_MAX_SAMPLES,
-            .sample_size = DDR3_MONITAMP0_SAMPLE_SIZE
-        },
-        {
-            .id = MONITPOS0_CHAN_ID,
-            .start_addr = DDR3_MONITPOS0_START_ADDR,
-            .end_addr = DDR3_MONITPOS0_END_ADDR,
-            .max_samples = DDR3_MONITPOS0_MAX_SAMPLES,
-            .sample_size = DDR3_MONITPOS0_SAMPLE_SIZE
-        },
-        {
-            .id = MONIT1POS0_CHAN_ID,
-            .start_addr = DDR3_MONIT1POS0_START_ADDR,
-            .end_addr = DDR3_MONIT1POS0_END_ADDR,
-            .max_samples = DDR3_MONIT1POS0_MAX_SAMPLES,
-            .sample_size = DDR3_MONIT1POS0_SAMPLE_SIZE
-        }
+        ACQ_CHAN_FOREACH(DDR3_ACQ_BUF_CORE0)
     }
 };
@@ -7,5 +7,7 @@ dev_io_core_utils_OBJS = $(dev_io_DIR)/dev_io_utils.o
 # makefile
 dev_io_core_OBJS = $(dev_io_DIR)/dev_io_core.o \
 		   $(dev_io_DIR)/dev_io_err.o \
+		   $(dev_io_DIR)/dev_io_metrics.o \
+		   $(dev_io_DIR)/dev_io_status.o \
 		   $(dev_io_core_utils_OBJS)
 
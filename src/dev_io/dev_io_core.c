@@ -5,6 +5,9 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include "bpm_server.h"
 /* Private headers */
 #include "sm_io_mod_dispatch.h"
@@ -40,23 +43,100 @@
 
 #define DEVIO_MAX_DESTRUCT_MSG_TRIES        10
 #define DEVIO_LINGER_TIME                   100         /* in ms */
+/* Maximum number of requests served from a PIPE each time it is polled,
+ * by priority class. Higher priority PIPEs are checked in between */
+#define DEVIO_SCHED_HIGH_BURST              UINT_MAX
+#define DEVIO_SCHED_NORMAL_BURST            8
+#define DEVIO_SCHED_LOW_BURST               1
+/* Metrics messages queued for a collector that is not keeping up (or not
+ * connected yet). Older ones are dropped beyond that */
+#define DEVIO_METRICS_SNDHWM                4
+/* SMIO spawn policies, see devio_set_smio_lazy () */
+#define DEVIO_SMIO_LAZY_STR                 "lazy"
+#define DEVIO_SMIO_EAGER_STR                "eager"
+#define DEVIO_LAZY_CONNECT_TIMEOUT          1000        /* in ms */
+/* Initial number of SMIO node slots. They are doubled as needed */
+#define DEVIO_NODES_INIT_LEN                16
+/* Handoff of the SMIOs to a new DEVIO process, see _devio_takeover ().
+ * The socket is "<snapshot_dir>/<name>" DEVIO_HANDOFF_SUFFIX */
+#define DEVIO_HANDOFF_SUFFIX                ".handoff"
+#define DEVIO_HANDOFF_CMD_STR               "$HANDOFF"
+#define DEVIO_HANDOFF_OK_STR                "$HANDOFF_OK"
+#define DEVIO_HANDOFF_ERR_STR               "$HANDOFF_ERR"
+#define DEVIO_HANDOFF_TIMEOUT               5000        /* in ms */
+
+/* SMIO registered to this DEVIO. Nodes are found by (smio_id, inst_id) in
+ * nodes_h, and kept in slots that are reused once their SMIO is gone */
+typedef struct {
+    uint32_t smio_id;                   /* SMIO ID, as in the SDB */
+    uint32_t inst_id;                   /* Instance ID */
+    uint64_t base;                      /* SMIO base address */
+    unsigned int slot;                  /* Slot in "nodes", also the one of
+                                           its metrics */
+    volatile const smio_mod_dispatch_t *smio_handler;   /* SMIO table handler */
+    char key [HUTILS_CFG_HASH_KEY_MAX_LEN];     /* Name + instance ID, e.g., ACQ0 */
+    void *pipe_mgmt;                    /* Management PIPE actor. SMIOs on a reactor
+                                           have a zsock_t instead. NULL if not spawned */
+    smio_reactor_t *reactor;            /* Reactor of the SMIO. NULL for SMIOs
+                                           with a thread of their own */
+    zsock_t *pipe_msg;                  /* Message PIPE */
+    thsafe_ring_t *ring;                /* Single register access ring */
+    devio_prio_e prio;                  /* Priority class */
+    zactor_t *pipe_config;              /* Config actor. NULL once configured */
+    int64_t reg_time;                   /* Spawn time, in ms */
+    int64_t reg_time_us;                /* Spawn time, in us */
+    smio_startup_stats_t startup;       /* Startup phases of the SMIO, written
+                                           by its threads too */
+    mlm_client_t *lazy_worker;          /* Holds the address of a lazy SMIO in the
+                                           broker until it is spawned, see
+                                           _devio_node_lazy (). NULL otherwise */
+    bool handoff;                       /* Taken over from a previous DEVIO,
+                                           so it is not configured again */
+} devio_node_t;
 
 struct _devio_t {
     /* General information */
-    zactor_t **pipes_mgmt;              /* Address nodes using this array of actors (Management PIPES) */
-    zsock_t **pipes_msg;                /* Address nodes using this array of actors (Message PIPES) */
-    zactor_t **pipes_config;            /* Address config actors using this array of actors (Config PIPES) */
+    devio_node_t **nodes;               /* SMIO nodes, by slot. NULL for a free slot */
+    unsigned int nnodes;                /* Number of slots in use, free ones in
+                                           between included */
+    unsigned int nodes_cap;             /* Number of slots allocated */
+    unsigned int nconfigs;              /* Number of config actors running */
     zsock_t *pipe;                      /* Address the DEVIO instance using this sock */
     zsock_t *pipe_frontend;             /* Force zloop to interrupt and rebuild poll set. This is used to send messages */
     zsock_t *pipe_backend;              /* Force zloop to interrupt and rebuild poll set. This is used to receive messages */
     zloop_t *loop;                      /* Reactor for server sockets */
-    unsigned int nnodes;                /* Number of actual nodes */
     char *name;                         /* Identification of this worker instance */
     uint32_t id;                        /* ID number of this instance */
     char *log_file;                     /* Log filename for tracing and debugging */
+    char *snapshot_dir;                 /* Directory of the SMIO register snapshots.
+                                           NULL for no warm restarts */
+    char *trace_dir;                    /* Directory of the SMIO request traces.
+                                           NULL for none */
+    uint64_t trace_max_size;            /* Size limit of each trace. 0 if none */
+    zsock_t *handoff;                   /* Socket a new DEVIO asks for our SMIOs
+                                           on. NULL if not listening */
+    zhashx_t *handoff_h;                /* Keys of the SMIOs taken over from a
+                                           previous DEVIO. NULL if none */
+    char *cfg_file;                     /* Configuration file, for the SMIOs
+                                           reading their own sections. NULL if none */
     char *endpoint_broker;              /* Broker location to connect to */
     int verbose;                        /* Print activity to stdout */
     int timer_id;                       /* Timer ID */
+    hutils_sched_t sched;               /* CPU placement of the DEVIO thread */
+    hutils_sched_t *smio_sched;         /* CPU placement of the SMIO threads,
+                                           by instance ID. Grown as needed */
+    uint32_t nsmio_sched;               /* Number of entries in smio_sched */
+    smio_reactor_t *smio_reactors [DEVIO_MAX_SMIO_REACTORS];
+                                        /* Reactor threads shared by the SMIOs.
+                                           Started on demand */
+    uint32_t nsmio_reactors;            /* Maximum number of reactor threads.
+                                           0 for one thread per SMIO */
+    bool smio_reactors_shared;          /* Reactors are owned by the caller */
+    int64_t startup_time;               /* Time of the first registration of the
+                                           startup, in ms. 0 when not starting up */
+    unsigned int startup_nnodes;        /* Number of nodes configured in the startup */
+    int64_t create_time_us;             /* Creation time, in us. SMIO spawn times
+                                           are taken from it */
 
     /* General management operations */
     devio_ops_t *ops;
@@ -66,18 +146,40 @@ struct _devio_t {
      * smio client part of the llio operations and the de-facto
      * llio operations */
     const disp_op_t **thsafe_server_ops;
-    /* Hash containing all the sm_io objects that
-     * this dev_io can handle. It is composed
-     * of key (10-char ID) / value (sm_io instance) */
-    zhashx_t *sm_io_h;
-    /* Hash containing all the Config sm_io objects that
-     * this dev_io can handle. It is composed
-     * of key (10-char ID) / value (sm_io instance) */
-    zhashx_t *sm_io_cfg_h;
+    /* Hash containing all the SMIO nodes registered to this dev_io. It
+     * is composed of key ((smio_id, inst_id), see _devio_node_key ()) /
+     * value (devio_node_t) */
+    zhashx_t *nodes_h;
+    /* Hash containing all the sm_io modules this dev_io can handle, from
+     * the .smio_mod_dispatch section. It is composed of key (smio_id) /
+     * value (smio_mod_dispatch_t) */
+    zhashx_t *smio_mods_h;
+    /* Hash containing the priority class of the SMIOs. It is composed
+     * of key (SMIO name) / value (priority class string) */
+    zhashx_t *smio_prio_h;
+    /* Hash containing the spawn policy of the SMIOs. It is composed
+     * of key (SMIO name) / value (DEVIO_SMIO_LAZY_STR or DEVIO_SMIO_EAGER_STR) */
+    zhashx_t *smio_lazy_h;
+    bool smio_lazy_dflt;                /* Policy of the SMIOs not in smio_lazy_h */
     /* Dispatch table containing all the sm_io thsafe operations
      * that we need to handle. It is composed
      * of key (4-char ID) / value (pointer to function) */
     disp_table_t *disp_table_thsafe_ops;
+    /* Per-opcode counters and latency histograms of the thsafe
+     * operations, both from the PIPEs and the rings */
+    msg_stats_t *thsafe_stats;
+    /* Type of the LLIO device */
+    llio_type_e llio_type;
+    /* Load metrics of the SMIOs, published to the collector at
+     * "metrics_endp" every "metrics_interval" ms. NULL for none */
+    devio_metrics_t *metrics;
+    char *metrics_endp;
+    int metrics_interval;
+    zsock_t *metrics_pub;               /* Socket to the metrics collector */
+    int metrics_timer_id;               /* Publishing timer ID */
+    /* Status page for the readers on the same host. NULL if it could not
+     * be created */
+    devio_status_t *status;
 };
 
 
@@ -86,13 +188,39 @@ const disp_table_ops_t devio_disp_table_ops;
 
 /* Dispatch table message check handler */
 static disp_table_err_e _devio_check_msg_args (disp_table_t *disp_table,
-        const disp_op_t *disp_op, void *args);
+        const disp_op_t *disp_op, const disp_op_sig_t *sig, void *args);
 
 /* Do the SMIO operation */
 static devio_err_e _devio_do_smio_op (devio_t *self, void *msg);
 static devio_err_e _devio_destroy_actor (devio_t *self, zactor_t **actor);
-static devio_err_e _devio_destroy_smio (devio_t *self, zhashx_t *smio_h, const char *smio_key);
-static devio_err_e _devio_destroy_smio_all (devio_t *self, zhashx_t *smio_h);
+static smio_reactor_t *_devio_get_smio_reactor (devio_t *self, devio_prio_e prio);
+static void _devio_report_smio_config (devio_t *self, devio_node_t *node);
+static void _devio_check_ready (devio_t *self);
+
+/* Handoff to a new DEVIO process */
+static char *_devio_handoff_path (devio_t *self);
+static void _devio_takeover (devio_t *self);
+static void _devio_handoff_listen (devio_t *self);
+static int _devio_handle_handoff (zloop_t *loop, zsock_t *reader, void *args);
+
+/* SMIO nodes */
+static zhashx_t *_devio_key_hash_new (void);
+static uint64_t _devio_node_key (uint32_t smio_id, uint32_t inst_id);
+static devio_node_t *_devio_node_new (devio_t *self,
+        volatile const smio_mod_dispatch_t *smio_mod_handler, uint64_t base,
+        uint32_t inst_id);
+static void _devio_node_destroy (devio_t *self, devio_node_t **node_p);
+static devio_node_t *_devio_lookup_node (devio_t *self, uint32_t smio_id,
+        uint32_t inst_id);
+static devio_node_t *_devio_lookup_node_by_key (devio_t *self, const char *smio_key);
+static devio_err_e _devio_node_spawn (devio_t *self, devio_node_t *node,
+        zlistx_t *reqs);
+static devio_err_e _devio_node_lazy (devio_t *self, devio_node_t *node);
+static void _devio_node_stop_config (devio_t *self, devio_node_t *node);
+static void _devio_node_stop_smio (devio_t *self, devio_node_t *node);
+static void _devio_node_stop_lazy (devio_t *self, devio_node_t *node);
+static void _devio_release_node (devio_t *self, devio_node_t **node_p);
+static void _devio_release_nodes_all (devio_t *self);
 
 /* General operations set handlers */
 static devio_err_e _devio_set_wait_clhd_handler (devio_t *self, wait_chld_handler_fp fp);
@@ -106,21 +234,55 @@ static volatile const smio_mod_dispatch_t *_devio_search_sm_by_id (devio_t *self
 static devio_err_e _devio_engine_handle_socket (devio_t *devio, void *sock,
         zloop_reader_fn handler);
 static int _devio_handle_timer (zloop_t *loop, int timer_id, void *arg);
+static void _devio_metrics_start (devio_t *self);
+static int _devio_handle_metrics_timer (zloop_t *loop, int timer_id, void *arg);
 static int _devio_handle_pipe_backend (zloop_t *loop, zsock_t *reader, void *args);
+static int _devio_handle_chld (zloop_t *loop, zmq_pollitem_t *item, void *args);
+static devio_err_e _devio_engine_handle_ring (devio_t *self, thsafe_ring_t *ring,
+        zloop_fn handler);
+static int _devio_handle_ring (zloop_t *loop, zmq_pollitem_t *item, void *args);
+static devio_err_e _devio_engine_handle_llio (devio_t *self, zloop_fn handler);
+static int _devio_handle_llio (zloop_t *loop, zmq_pollitem_t *item, void *args);
+static int _devio_pipe_msg_exec (devio_t *self, zsock_t *reader);
+static void _devio_sched_serve_higher (devio_t *self, devio_prio_e prio);
+static devio_prio_e _devio_get_pipe_prio (devio_t *self, zsock_t *reader);
+static devio_prio_e _devio_get_smio_prio (devio_t *self, const char *smio_name);
+static bool _devio_is_smio_lazy (devio_t *self, const char *smio_name);
+/* Execute a ring request, accounting it in the thsafe statistics */
+static void _devio_ring_exec (void *owner, thsafe_ring_slot_t *slot);
 
 static devio_err_e _devio_register_sm_raw (devio_t *self, uint32_t smio_id, uint64_t base,
         uint32_t inst_id);
+static int _devio_handle_lazy_smio (zloop_t *loop, zsock_t *reader, void *args);
 static devio_err_e _devio_register_all_sm_raw (devio_t *self);
 static devio_err_e _devio_unregister_sm_raw (devio_t *self, const char *smio_key);
+static void _devio_update_sched_raw (devio_t *self, const hutils_sched_t *sched);
+static void _devio_update_smio_sched_raw (devio_t *self, uint32_t inst_id,
+        const hutils_sched_t *sched);
 static devio_err_e _devio_unregister_all_sm_raw (devio_t *self);
 
+/* Signalled by SIGCHLD and polled by the zloop of every DEVIO of the
+ * process, so the children are reaped out of the signal handler. Shared
+ * by all of them, as the signal handler is */
+static int devio_chld_fd = -1;
+
 /* Default signal handlers */
 void devio_sigchld_h (int sig, siginfo_t *siginfo, void *context)
 {
     (void) sig;
     (void) siginfo;
     (void) context;
-    while (hutils_wait_chld () > 0);
+
+    if (devio_chld_fd < 0) {
+        while (hutils_wait_chld () > 0);
+        return;
+    }
+
+    int saved_errno = errno;
+    uint64_t one = 1;
+    ssize_t rc = write (devio_chld_fd, &one, sizeof (one));
+    (void) rc;
+    errno = saved_errno;
 }
 
 /* Creates a new instance of Device Information */
@@ -161,16 +323,17 @@ devio_t * devio_new (char *name, uint32_t id, char *endpoint_dev,
             || (self->log_file != NULL && log_file_name != NULL),
             "Error setting log file!", err_log_file);
 
-    /* Initialize the sockets structure to talk to nodes */
-    self->pipes_mgmt = zmalloc (sizeof (*self->pipes_mgmt) * NODES_MAX_LEN);
-    ASSERT_ALLOC(self->pipes_mgmt, err_pipes_mgmt_alloc);
-    self->pipes_msg = zmalloc (sizeof (*self->pipes_msg) * NODES_MAX_LEN);
-    ASSERT_ALLOC(self->pipes_msg, err_pipes_msg_alloc);
-    self->pipes_config = zmalloc (sizeof (*self->pipes_config) * NODES_MAX_LEN);
-    ASSERT_ALLOC(self->pipes_config, err_pipes_config_alloc);
+    /* Initialize the slots of the nodes. They grow as SMIOs are registered */
+    self->nodes = zmalloc (sizeof (*self->nodes) * DEVIO_NODES_INIT_LEN);
+    ASSERT_ALLOC(self->nodes, err_nodes_alloc);
+    self->nodes_cap = DEVIO_NODES_INIT_LEN;
     self->pipe = NULL;
     /* 0 nodes for now... */
     self->nnodes = 0;
+    self->nconfigs = 0;
+    self->startup_time = 0;
+    self->startup_nnodes = 0;
+    self->create_time_us = zclock_usecs ();
 
     /* Setup pipes for zloop interrupting */
     self->pipe_frontend = zsys_create_pipe (&self->pipe_backend);
@@ -191,6 +354,26 @@ devio_t * devio_new (char *name, uint32_t id, char *endpoint_dev,
      * interrupting the loop to check for rebuilds */
     _devio_engine_handle_socket (self, self->pipe_backend, _devio_handle_pipe_backend);
 
+    /* Reap the children (FE DEVIOs, IOCs) as soon as they exit. DEVIOs are
+     * created by the main thread, one at a time */
+    if (devio_chld_fd < 0) {
+        devio_chld_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (devio_chld_fd < 0) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] Could not "
+                    "create eventfd: %s. Children will be reaped in the signal "
+                    "handler\n", strerror (errno));
+        }
+    }
+    if (devio_chld_fd >= 0) {
+        zmq_pollitem_t chld_item = {
+            .socket = NULL,
+            .fd = devio_chld_fd,
+            .events = ZMQ_POLLIN};
+        int rc = zloop_poller (self->loop, &chld_item, _devio_handle_chld, self);
+        ASSERT_TEST(rc == 0, "Could not register zloop_poller", err_chld_poller);
+        zloop_poller_set_tolerant (self->loop, &chld_item);
+    }
+
     /* Setup strings/options */
     self->name = strdup (name);
     ASSERT_ALLOC(self->name, err_name_alloc);
@@ -242,17 +425,51 @@ devio_t * devio_new (char *name, uint32_t id, char *endpoint_dev,
     free (llio_name);
     llio_name = NULL; /* Avoid double free error */
 
+    /* Do the block reads in the llio worker thread, so the other SMIOs
+     * are still served while a long acquisition is read. This is not
+     * fatal, block reads are just done synchronously then */
+    llio_err_e lerr = llio_enable_async (self->llio);
+    if (lerr == LLIO_SUCCESS) {
+        derr = _devio_engine_handle_llio (self, _devio_handle_llio);
+        if (derr != DEVIO_SUCCESS) {
+            llio_disable_async (self->llio);
+        }
+    }
+
     /* Init sm_io_thsafe_server_ops_h. For now, we assume we want zmq
      * for exchanging messages between smio and devio instances */
     self->thsafe_server_ops = smio_thsafe_zmq_server_ops;
 
-    /* Init sm_io_h hash */
-    self->sm_io_h = zhashx_new ();
-    ASSERT_ALLOC(self->sm_io_h, err_sm_io_h_alloc);
+    /* Init nodes_h hash. The nodes are owned by their slots */
+    self->nodes_h = _devio_key_hash_new ();
+    ASSERT_ALLOC(self->nodes_h, err_nodes_h_alloc);
+
+    /* Init smio_mods_h hash, so registering is not a search of the whole
+     * section each time */
+    self->smio_mods_h = _devio_key_hash_new ();
+    ASSERT_ALLOC(self->smio_mods_h, err_smio_mods_h_alloc);
+    const smio_mod_dispatch_t *smio_mod_handler;
+    for_each_smio(smio_mod_handler) {
+        uint64_t mod_key = smio_mod_handler->id;
+        if (zhashx_insert (self->smio_mods_h, &mod_key,
+                    (void *) smio_mod_handler) != 0) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] SMIO %s has "
+                    "a duplicated ID 0x%08X. Ignoring it\n",
+                    smio_mod_handler->name, smio_mod_handler->id);
+        }
+    }
+
+    /* Init smio_prio_h hash */
+    self->smio_prio_h = zhashx_new ();
+    ASSERT_ALLOC(self->smio_prio_h, err_smio_prio_h_alloc);
+    zhashx_set_destructor (self->smio_prio_h, (zhashx_destructor_fn *) zstr_free);
 
-    /* Init sm_io_cfg_h hash */
-    self->sm_io_cfg_h = zhashx_new ();
-    ASSERT_ALLOC(self->sm_io_cfg_h, err_sm_io_cfg_h_alloc);
+    /* Init smio_lazy_h hash. Every SMIO is spawned on registration unless
+     * told otherwise */
+    self->smio_lazy_h = zhashx_new ();
+    ASSERT_ALLOC(self->smio_lazy_h, err_smio_lazy_h_alloc);
+    zhashx_set_destructor (self->smio_lazy_h, (zhashx_destructor_fn *) zstr_free);
+    self->smio_lazy_dflt = false;
 
     /* Init sm_io_thsafe_ops_h dispatch table */
     self->disp_table_thsafe_ops = disp_table_new (&devio_disp_table_ops);
@@ -263,6 +480,35 @@ devio_t * devio_new (char *name, uint32_t id, char *endpoint_dev,
     ASSERT_TEST(disp_err==DISP_TABLE_SUCCESS, "Could not initialize dispatch table",
             err_disp_table_init);
 
+    /* The deferred block reads take their reply buffers from here */
+    if (hutils_mem_rt_enabled ()) {
+        for (const disp_op_t **op = self->thsafe_server_ops; *op != NULL; ++op) {
+            if (disp_table_prealloc_ret (self->disp_table_thsafe_ops,
+                        (*op)->opcode) != DISP_TABLE_SUCCESS) {
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] Could not "
+                        "preallocate reply buffers of %s\n", (*op)->name);
+            }
+        }
+    }
+
+    self->thsafe_stats = msg_stats_new ();
+    ASSERT_ALLOC(self->thsafe_stats, err_thsafe_stats_alloc);
+
+    /* The metrics are always kept, as they are cheap. Publishing them is
+     * optional, see devio_set_metrics () */
+    self->llio_type = type;
+    self->metrics = devio_metrics_new (name);
+    ASSERT_ALLOC(self->metrics, err_metrics_alloc);
+    self->metrics_interval = DEVIO_METRICS_DFLT_INTERVAL;
+    self->metrics_timer_id = -1;
+
+    /* The SMIOs still serve everything else without it */
+    self->status = devio_status_new (name);
+    if (self->status == NULL) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] Could not "
+                "create the status page. Going on without it\n");
+    }
+
     /* Adjust linger time for our sockets */
     /* A non-zero linger value is required for DISCONNECT to be sent
      * when the worker is destroyed. 100 is arbitrary but chosen to be
@@ -271,13 +517,20 @@ devio_t * devio_new (char *name, uint32_t id, char *endpoint_dev,
 
     return self;
 
+err_metrics_alloc:
+    msg_stats_destroy (&self->thsafe_stats);
+err_thsafe_stats_alloc:
 err_disp_table_init:
     disp_table_destroy (&self->disp_table_thsafe_ops);
 err_disp_table_thsafe_ops_alloc:
-    zhashx_destroy (&self->sm_io_cfg_h);
-err_sm_io_cfg_h_alloc:
-    zhashx_destroy (&self->sm_io_h);
-err_sm_io_h_alloc:
+    zhashx_destroy (&self->smio_lazy_h);
+err_smio_lazy_h_alloc:
+    zhashx_destroy (&self->smio_prio_h);
+err_smio_prio_h_alloc:
+    zhashx_destroy (&self->smio_mods_h);
+err_smio_mods_h_alloc:
+    zhashx_destroy (&self->nodes_h);
+err_nodes_h_alloc:
     llio_release (self->llio, NULL);
 err_llio_open:
     llio_destroy (&self->llio);
@@ -296,6 +549,7 @@ err_ops_alloc:
 err_endp_broker_alloc:
     free (self->name);
 err_name_alloc:
+err_chld_poller:
     zloop_timer_end (self->loop, self->timer_id);
 err_timer_alloc:
     zloop_destroy (&self->loop);
@@ -303,12 +557,8 @@ err_loop_alloc:
     zsock_destroy (&self->pipe_backend);
     zsock_destroy (&self->pipe_frontend);
 err_pipe_frontend_alloc:
-    free (self->pipes_config);
-err_pipes_config_alloc:
-    free (self->pipes_msg);
-err_pipes_msg_alloc:
-    free (self->pipes_mgmt);
-err_pipes_mgmt_alloc:
+    free (self->nodes);
+err_nodes_alloc:
     free (self->log_file);
 err_log_file:
     free (self);
@@ -326,13 +576,15 @@ devio_err_e devio_destroy (devio_t **self_p)
                 "[dev_io_core:destroy] Destroying DEVIO instance\n");
         devio_t *self = *self_p;
 
+        /* Reply to the block reads in flight, as the SMIOs might be
+         * waiting for them */
+        _devio_engine_handle_llio (self, NULL);
+        llio_disable_async (self->llio);
+
         /* Destroy children threads before proceeding */
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
-                "[dev_io_core:destroy] Destroying sm_io_cfg_h\n");
-        _devio_destroy_smio_all (self, self->sm_io_cfg_h);
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
-                "[dev_io_core:destroy] Destroying sm_io_h\n");
-        _devio_destroy_smio_all (self, self->sm_io_h);
+                "[dev_io_core:destroy] Destroying SMIO nodes\n");
+        _devio_release_nodes_all (self);
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
                 "[dev_io_core:destroy] All SMIOs destroyed\n");
 
@@ -341,12 +593,14 @@ devio_err_e devio_destroy (devio_t **self_p)
          * unregister from broker as soon as possible to avoid
          * loosing requests from clients */
         disp_table_destroy (&self->disp_table_thsafe_ops);
+        msg_stats_print (self->thsafe_stats, self->name);
+        msg_stats_destroy (&self->thsafe_stats);
+        zhashx_destroy (&self->smio_lazy_h);
+        zhashx_destroy (&self->smio_prio_h);
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
-                "[dev_io_core:destroy] Destroying sm_io_cfg_h hash\n");
-        zhashx_destroy (&self->sm_io_cfg_h);
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
-                "[dev_io_core:destroy] Destroying sm_io_h hash\n");
-        zhashx_destroy (&self->sm_io_h);
+                "[dev_io_core:destroy] Destroying nodes_h hash\n");
+        zhashx_destroy (&self->nodes_h);
+        zhashx_destroy (&self->smio_mods_h);
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
                 "[dev_io_core:destroy] All hashes destroyed\n");
         self->thsafe_server_ops = NULL;
@@ -384,24 +638,30 @@ devio_err_e devio_destroy (devio_t **self_p)
          *  zsock_destroy(&self->pipe);
          * */
 
-        /* Destroy all remamining sockets if any */
-        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
-                "[dev_io_core:destroy] Destroying all actors\n");
+        /* Reactors are gone only after all of their SMIOs. Shared ones
+         * might still have the SMIOs of other DEVIOs */
         uint32_t i;
-        for (i = 0; i < NODES_MAX_LEN; ++i) {
-            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
-                    "[dev_io_core:destroy] Destroying possible remaining actors, instance #%u\n", i);
-            zactor_destroy (&self->pipes_config [i]);
-            zsock_destroy (&self->pipes_msg [i]);
-            zactor_destroy (&self->pipes_mgmt [i]);
+        for (i = 0; i < DEVIO_MAX_SMIO_REACTORS; ++i) {
+            if (!self->smio_reactors_shared) {
+                smio_reactor_destroy (&self->smio_reactors [i]);
+            }
         }
 
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
                 "[dev_io_core:destroy] All actors destroyed\n");
-        free (self->pipes_config);
-        free (self->pipes_msg);
-        free (self->pipes_mgmt);
+        free (self->nodes);
+        free (self->smio_sched);
         free (self->log_file);
+        free (self->snapshot_dir);
+        free (self->trace_dir);
+        free (self->cfg_file);
+        zsock_destroy (&self->handoff);
+        zhashx_destroy (&self->handoff_h);
+        /* The SMIOs writing to the metrics are gone by now */
+        zsock_destroy (&self->metrics_pub);
+        free (self->metrics_endp);
+        devio_metrics_destroy (&self->metrics);
+        devio_status_destroy (&self->status);
         free (self);
         *self_p = NULL;
     }
@@ -472,17 +732,8 @@ err_sdbfs_create:
 static volatile const smio_mod_dispatch_t *_devio_search_sm_by_id (devio_t *self,
         uint32_t smio_id)
 {
-    (void) self;
-
-    const smio_mod_dispatch_t *smio_mod_handler;
-
-    for_each_smio(smio_mod_handler) {
-        if (smio_mod_handler->id == smio_id) {
-            return smio_mod_handler;
-        }
-    }
-
-    return NULL;
+    uint64_t mod_key = smio_id;
+    return (const smio_mod_dispatch_t *) zhashx_lookup (self->smio_mods_h, &mod_key);
 }
 
 /* From Malamute https://github.com/zeromq/malamute/blob/master/src/mlm_server_engine.inc
@@ -530,6 +781,70 @@ err_zsock_is:
     return err;
 }
 
+/* Poll the ring request doorbell and invoke handler on any request. Handler
+ * must be a CZMQ zloop_fn function; receives server as arg. A NULL handler
+ * stops polling the ring */
+static devio_err_e _devio_engine_handle_ring (devio_t *self, thsafe_ring_t *ring,
+        zloop_fn handler)
+{
+    assert (self);
+    assert (ring);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    zmq_pollitem_t item = {
+        .socket = NULL,
+        .fd = thsafe_ring_get_fd (ring),
+        .events = ZMQ_POLLIN};
+
+    if (handler != NULL) {
+        int rc = zloop_poller (self->loop, &item, handler, self);
+        ASSERT_TEST(rc == 0, "Could not register zloop_poller",
+                err_zloop_poller, DEVIO_ERR_ALLOC);
+        zloop_poller_set_tolerant (self->loop, &item);
+
+        /* Send message to pipe_backend to force zloop to rebuild poll_set */
+        zstr_sendx (self->pipe_frontend, "$REBUILD_POLL", NULL);
+    }
+    else {
+        zloop_poller_end (self->loop, &item);
+    }
+
+err_zloop_poller:
+    return err;
+}
+
+/* Poll the llio completion fd and invoke handler on any finished asynchronous
+ * request. Handler must be a CZMQ zloop_fn function; receives server as arg.
+ * A NULL handler stops polling */
+static devio_err_e _devio_engine_handle_llio (devio_t *self, zloop_fn handler)
+{
+    assert (self);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    zmq_pollitem_t item = {
+        .socket = NULL,
+        .fd = llio_get_completion_fd (self->llio),
+        .events = ZMQ_POLLIN};
+
+    if (item.fd == -1) {
+        goto err_completion_fd;
+    }
+
+    if (handler != NULL) {
+        int rc = zloop_poller (self->loop, &item, handler, self);
+        ASSERT_TEST(rc == 0, "Could not register zloop_poller",
+                err_zloop_poller, DEVIO_ERR_ALLOC);
+        zloop_poller_set_tolerant (self->loop, &item);
+    }
+    else {
+        zloop_poller_end (self->loop, &item);
+    }
+
+err_zloop_poller:
+err_completion_fd:
+    return err;
+}
+
 /************************************************************/
 /********************** zloop handlers **********************/
 /************************************************************/
@@ -544,6 +859,65 @@ static int _devio_handle_timer (zloop_t *loop, int timer_id, void *arg)
     return 0;
 }
 
+/* Connect to the metrics collector and start the publishing timer. Errors
+ * only leave the metrics unpublished */
+static void _devio_metrics_start (devio_t *self)
+{
+    if (self->metrics_endp == NULL) {
+        return;
+    }
+
+    /* We connect to the collector, as one collector serves many DEVIOs.
+     * It never blocks us: messages are dropped if it is not there */
+    self->metrics_pub = zsock_new (ZMQ_PUB);
+    ASSERT_ALLOC(self->metrics_pub, err_pub_alloc);
+    zsock_set_sndhwm (self->metrics_pub, DEVIO_METRICS_SNDHWM);
+    zsock_set_linger (self->metrics_pub, 0);
+    int rc = zsock_connect (self->metrics_pub, "%s", self->metrics_endp);
+    ASSERT_TEST(rc == 0, "Could not connect to the metrics collector",
+            err_pub_connect);
+
+    self->metrics_timer_id = zloop_timer (self->loop, self->metrics_interval, 0,
+            _devio_handle_metrics_timer, self);
+    ASSERT_TEST(self->metrics_timer_id != -1, "Could not create metrics timer",
+            err_timer_alloc);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] Publishing metrics "
+            "to %s every %d ms\n", self->metrics_endp, self->metrics_interval);
+    return;
+
+err_timer_alloc:
+err_pub_connect:
+    zsock_destroy (&self->metrics_pub);
+err_pub_alloc:
+    return;
+}
+
+/* zloop handler for the metrics timer. Metrics are published as a message
+ * of two frames: the DEVIO name, for the collector to subscribe to, and the
+ * metrics in the Prometheus text format */
+static int _devio_handle_metrics_timer (zloop_t *loop, int timer_id, void *arg)
+{
+    (void) loop;
+    (void) timer_id;
+    devio_t *self = (devio_t *) arg;
+
+    llio_pcie_timeout_stats_t pcie_stats;
+    bool has_pcie_stats = ((self->llio_type == PCIE_DEV ||
+                self->llio_type == VFIO_DEV) &&
+            llio_pcie_get_timeout_stats (self->llio, &pcie_stats) == LLIO_SUCCESS);
+
+    char *text = devio_metrics_render (self->metrics, self->thsafe_stats,
+            has_pcie_stats ? &pcie_stats : NULL);
+    if (text == NULL) {
+        return 0;
+    }
+
+    zsock_send (self->metrics_pub, "ss", self->name, text);
+    free (text);
+    return 0;
+}
+
 /* zloop handler for MSG PIPE */
 static int _devio_handle_pipe_msg (zloop_t *loop, zsock_t *reader, void *args)
 {
@@ -552,25 +926,146 @@ static int _devio_handle_pipe_msg (zloop_t *loop, zsock_t *reader, void *args)
     devio_t *devio = (devio_t *) args;
     (void) devio;
 
-    /* We process as many messages as we can, to reduce the overhead
-     * of polling and the reactor */
-    while (zsock_events (reader) & ZMQ_POLLIN) {
-        /* Receive message */
-        zmsg_t *recv_msg = zmsg_recv (reader);
-        if (recv_msg == NULL) {
+    /* We process as many messages as the PIPE priority class allows, to
+     * reduce the overhead of polling and the reactor. Whatever is left is
+     * served on the next zloop iteration */
+    static const unsigned int burst [DEVIO_PRIO_INVALID] = {
+        [DEVIO_PRIO_HIGH]   = DEVIO_SCHED_HIGH_BURST,
+        [DEVIO_PRIO_NORMAL] = DEVIO_SCHED_NORMAL_BURST,
+        [DEVIO_PRIO_LOW]    = DEVIO_SCHED_LOW_BURST
+    };
+    devio_prio_e prio = _devio_get_pipe_prio (devio, reader);
+
+    unsigned int served;
+    for (served = 0; served < burst [prio] &&
+            (zsock_events (reader) & ZMQ_POLLIN); ++served) {
+        /* Don't make higher priority PIPEs wait for our whole burst */
+        if (served > 0) {
+            _devio_sched_serve_higher (devio, prio);
+        }
+
+        if (_devio_pipe_msg_exec (devio, reader) != 0) {
             return -1; /* Interrupted */
         }
+    }
 
-        /* Prepare the args structure */
-        zmq_server_args_t server_args = {
-            .tag = ZMQ_SERVER_ARGS_TAG,
-            .msg = &recv_msg,
-            .reply_to = reader};
-        /* Do the actual work */
-        _devio_do_smio_op (devio, &server_args);
+    return 0;
+}
 
-        /* Cleanup */
-        zmsg_destroy (&recv_msg);
+/* Receive and execute a single request from a message PIPE */
+static int _devio_pipe_msg_exec (devio_t *self, zsock_t *reader)
+{
+    /* Receive message */
+    zmsg_t *recv_msg = zmsg_recv (reader);
+    if (recv_msg == NULL) {
+        return -1; /* Interrupted */
+    }
+
+    /* Prepare the args structure */
+    zmq_server_args_t server_args = {
+        .tag = ZMQ_SERVER_ARGS_TAG,
+        .msg = &recv_msg,
+        .reply_to = reader};
+    /* Do the actual work. The request id is not known here, as the SMIO
+     * requests carry none. The dump tool matches it by time with the
+     * SMIO thsafe stage this falls in */
+    DBE_TRACE_STAGE (DBG_DEV_IO | DBG_LVL_TRACE, "devio:exec", ERRHAND_TRACE_BEGIN);
+    _devio_do_smio_op (self, &server_args);
+    DBE_TRACE_STAGE (DBG_DEV_IO | DBG_LVL_TRACE, "devio:exec", ERRHAND_TRACE_END);
+
+    /* Cleanup */
+    zmsg_destroy (&recv_msg);
+    return 0;
+}
+
+/* Serve everything pending on the PIPEs and rings of a higher priority
+ * class than "prio" */
+static void _devio_sched_serve_higher (devio_t *self, devio_prio_e prio)
+{
+    unsigned int i;
+    for (i = 0; i < self->nnodes; ++i) {
+        devio_node_t *node = self->nodes [i];
+        if (node == NULL || node->prio >= prio) {
+            continue;
+        }
+
+        if (node->ring != NULL) {
+            thsafe_ring_consume (node->ring, _devio_ring_exec, self);
+        }
+
+        while (node->pipe_msg != NULL &&
+                (zsock_events (node->pipe_msg) & ZMQ_POLLIN)) {
+            if (_devio_pipe_msg_exec (self, node->pipe_msg) != 0) {
+                return;
+            }
+        }
+    }
+}
+
+static devio_prio_e _devio_get_pipe_prio (devio_t *self, zsock_t *reader)
+{
+    unsigned int i;
+    for (i = 0; i < self->nnodes; ++i) {
+        if (self->nodes [i] != NULL && self->nodes [i]->pipe_msg == reader) {
+            return self->nodes [i]->prio;
+        }
+    }
+
+    return DEVIO_PRIO_NORMAL;
+}
+
+static devio_prio_e _devio_get_smio_prio (devio_t *self, const char *smio_name)
+{
+    const char *prio_str = zhashx_lookup (self->smio_prio_h, smio_name);
+    return (prio_str != NULL) ? devio_str_to_prio (prio_str) : DEVIO_PRIO_NORMAL;
+}
+
+static bool _devio_is_smio_lazy (devio_t *self, const char *smio_name)
+{
+    const char *lazy_str = zhashx_lookup (self->smio_lazy_h, smio_name);
+    return (lazy_str != NULL) ? streq (lazy_str, DEVIO_SMIO_LAZY_STR) :
+        self->smio_lazy_dflt;
+}
+
+/* zloop handler for the register access rings */
+/* Execute a ring request, accounting it in the thsafe statistics */
+static void _devio_ring_exec (void *owner, thsafe_ring_slot_t *slot)
+{
+    devio_t *devio = (devio_t *) owner;
+
+    uint64_t start_ns = msg_stats_now_ns ();
+    smio_thsafe_ring_server_exec (owner, slot);
+    msg_stats_record (devio->thsafe_stats, slot->opcode,
+            msg_stats_now_ns () - start_ns, slot->ret < 0);
+}
+
+/* Reply to the finished asynchronous block requests */
+static int _devio_handle_llio (zloop_t *loop, zmq_pollitem_t *item, void *args)
+{
+    (void) loop;
+    (void) item;
+    /* We expect a devio instance e as reference */
+    devio_t *devio = (devio_t *) args;
+
+    llio_process_completions (devio->llio);
+    return 0;
+}
+
+static int _devio_handle_ring (zloop_t *loop, zmq_pollitem_t *item, void *args)
+{
+    (void) loop;
+    /* We expect a devio instance e as reference */
+    devio_t *devio = (devio_t *) args;
+
+    /* Find out which ring rang the doorbell */
+    unsigned int i;
+    for (i = 0; i < devio->nnodes; ++i) {
+        devio_node_t *node = devio->nodes [i];
+        if (node != NULL && node->ring != NULL &&
+                thsafe_ring_get_fd (node->ring) == item->fd) {
+            thsafe_ring_consume (node->ring, _devio_ring_exec, devio);
+            break;
+        }
     }
 
     return 0;
@@ -587,14 +1082,24 @@ static int _devio_handle_pipe_mgmt (zloop_t *loop, zsock_t *reader, void *args)
     uint32_t smio_id;
     uint64_t base;
     uint32_t inst_id;
+    uint32_t data;
 
     /* This command expects the following */
     /* Command: (string) $REGISTER_SMIO
      * Arg1:    (uint32_t) smio_id
      * Arg2:    (uint64_t) base
      * Arg3:    (uint32_t) inst_id
+     *
+     * Command: (string) $WRITE_SMIO
+     * Arg1:    (uint32_t) smio_id
+     * Arg2:    (uint64_t) register offset
+     * Arg3:    (uint32_t) inst_id
+     * Arg4:    (uint32_t) data
+     *
+     * The missing arguments of shorter messages are zeroed
      * */
-    int zerr = zsock_recv (reader, "s484", &command, &smio_id, &base, &inst_id);
+    int zerr = zsock_recv (reader, "s4844", &command, &smio_id, &base, &inst_id,
+            &data);
     if (zerr == -1) {
         return 0; /* Malformed message */
     }
@@ -603,6 +1108,18 @@ static int _devio_handle_pipe_mgmt (zloop_t *loop, zsock_t *reader, void *args)
         /* Register new SMIO */
         _devio_register_sm_raw (devio, smio_id, base, inst_id);
     }
+    else if (streq (command, "$WRITE_SMIO")) {
+        /* We serve the register accesses of every SMIO, so this goes in
+         * order with them */
+        devio_node_t *node = _devio_lookup_node (devio, smio_id, inst_id);
+        if (node != NULL && node->pipe_mgmt != NULL) {
+            ssize_t ret = llio_write_32 (devio->llio, node->base | base, &data);
+            if (ret != sizeof (data)) {
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core:_devio_handle_pipe_mgmt] "
+                        "Could not write to SMIO %s\n", node->key);
+            }
+        }
+    }
     else {
         /* Invalid message received. Discard message and continue normally */
         DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[dev_io_core:_devio_handle_pipe_mgmt] PIPE "
@@ -645,12 +1162,25 @@ static int _devio_handle_pipe_cfg (zloop_t *loop, zsock_t *reader, void *args)
         DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
                 "[dev_io_core:poll_all_sm] Config thread signalled "
                 "CONFIG DONE. Terminating thread\n");
+        /* The node is the one owning this config actor */
+        devio_node_t *node = NULL;
+        unsigned int i;
+        for (i = 0; i < devio->nnodes; ++i) {
+            if (devio->nodes [i] != NULL && devio->nodes [i]->pipe_config != NULL &&
+                    zactor_sock (devio->nodes [i]->pipe_config) == reader) {
+                node = devio->nodes [i];
+                break;
+            }
+        }
+        ASSERT_TEST(node != NULL, "devio_loop: Could not find SMIO of config thread",
+                err_poller_destroy_cfg_smio, -1);
+
+        _devio_report_smio_config (devio, node);
         /* Terminate config thread */
         zstr_sendx (reader, "$TERM", NULL);
         /* Lastly, destroy the actor */
-        err = _devio_destroy_smio (devio, devio->sm_io_cfg_h, service_id);
-        ASSERT_TEST(err == DEVIO_SUCCESS, "devio_loop: Could not destroy SMIO",
-                err_poller_destroy_cfg_smio, -1);
+        _devio_node_stop_config (devio, node);
+        _devio_check_ready (devio);
     }
 
 err_poller_destroy_cfg_smio:
@@ -688,6 +1218,16 @@ static int _devio_handle_pipe (zloop_t *loop, zsock_t *reader, void *args)
      * Arg2:    (uint64_t) base
      * Arg3:    (uint32_t) inst_id
      *
+     * Command: (string) $UNREGISTER_SMIO_ID
+     * Arg1:    (uint32_t) smio_id
+     * Arg2:    (uint64_t) unused
+     * Arg3:    (uint32_t) inst_id
+     *
+     * Command: (string) $SET_SCHED or $SET_SMIO_SCHED
+     * Arg1:    (uint32_t) SCHED_FIFO priority
+     * Arg2:    (uint64_t) CPU mask
+     * Arg3:    (uint32_t) inst_id, for $SET_SMIO_SCHED only
+     *
      * Command: (string) $TERM
      *
      * Either way, the following zsock_recv is able to handle both cases. In
@@ -723,6 +1263,20 @@ static int _devio_handle_pipe (zloop_t *loop, zsock_t *reader, void *args)
         /* Unregister SMIO */
         _devio_unregister_sm_raw (devio, NULL);
     }
+    else if (streq (command, "$UNREGISTER_SMIO_ID")) {
+        devio_node_t *node = _devio_lookup_node (devio, smio_id, inst_id);
+        if (node != NULL) {
+            _devio_unregister_sm_raw (devio, node->key);
+        }
+    }
+    else if (streq (command, "$SET_SCHED")) {
+        hutils_sched_t sched = {.cpu_mask = base, .fifo_prio = (int) smio_id};
+        _devio_update_sched_raw (devio, &sched);
+    }
+    else if (streq (command, "$SET_SMIO_SCHED")) {
+        hutils_sched_t sched = {.cpu_mask = base, .fifo_prio = (int) smio_id};
+        _devio_update_smio_sched_raw (devio, inst_id, &sched);
+    }
     else {
         /* Invalid message received. Discard message and continue normally */
         DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[dev_io_core:_devio_handle_pipe] PIPE "
@@ -768,105 +1322,176 @@ static int _devio_handle_pipe_backend (zloop_t *loop, zsock_t *reader, void *arg
     return 0;
 }
 
+/* Reap the children that exited. Any of the DEVIOs gets to do it */
+static int _devio_handle_chld (zloop_t *loop, zmq_pollitem_t *item, void *args)
+{
+    (void) loop;
+    (void) args;
+
+    uint64_t count;
+    if (read (item->fd, &count, sizeof (count)) == sizeof (count)) {
+        while (hutils_wait_chld () > 0);
+    }
+
+    return 0;
+}
+
 /************************************************************/
 /*********************** API methods ************************/
 /************************************************************/
 
-/* Register an specific sm_io modules to this device */
+/* Register an specific sm_io module to this device, either spawning it
+ * or leaving it for its first request, according to its spawn policy */
 static devio_err_e _devio_register_sm_raw (devio_t *self, uint32_t smio_id, uint64_t base,
         uint32_t inst_id)
 {
     assert (self);
 
-    devio_err_e err = DEVIO_ERR_ALLOC;
-    ASSERT_TEST (self->nnodes <= NODES_MAX_LEN, "Maximum number of SMIOs reached",
-            err_max_smios_reached, DEVIO_ERR_MAX_SMIOS);
-
-    /* Search the sm_io_mod_dsapatch table for the smio_id and,
-     * if found, call the correspondent bootstrap code to initilize
-     * the sm_io module */
-    uint32_t pipe_mgmt_idx = 0;
-    uint32_t pipe_msg_idx = 0;
-    uint32_t pipe_config_idx = 0;
-    volatile const smio_mod_dispatch_t *smio_mod_handler = NULL;
-
+    devio_err_e err = DEVIO_ERR_NO_SMIO_ID;
     DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
             "[dev_io_core:register_sm] searching for SMIO ID match\n");
 
     /* Search for the SMIO */
-    smio_mod_handler = _devio_search_sm_by_id (self, smio_id);
+    volatile const smio_mod_dispatch_t *smio_mod_handler =
+        _devio_search_sm_by_id (self, smio_id);
     ASSERT_TEST (smio_mod_handler != NULL, "Could find specified SMIO",
             err_search_smio);
+    ASSERT_TEST (_devio_lookup_node (self, smio_id, inst_id) == NULL,
+            "SMIO is already registered", err_dup_node, DEVIO_ERR_ALLOC);
 
-    /* Found! Call bootstrap code and insert in
-     * hash table */
+    devio_node_t *node = _devio_node_new (self, smio_mod_handler, base, inst_id);
+    ASSERT_ALLOC (node, err_node_alloc, DEVIO_ERR_ALLOC);
+    node->handoff = self->handoff_h != NULL &&
+        zhashx_lookup (self->handoff_h, node->key) != NULL;
 
-    /* Stringify ID. We do it before spawning a new thread as
-     * alloc can fail */
-    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
-            "[dev_io_core:register_sm] Stringify hash ID\n");
-    char *inst_id_str = hutils_stringify_dec_key (inst_id);
-    ASSERT_ALLOC(inst_id_str, err_inst_id_str_alloc);
-    char *key = hutils_concat_strings_no_sep (smio_mod_handler->name,
-            inst_id_str);
-    /* We don't need this anymore */
-    free (inst_id_str);
-    inst_id_str = NULL;
-    ASSERT_ALLOC (key, err_key_alloc);
+    err = _devio_is_smio_lazy (self, smio_mod_handler->name) ?
+        _devio_node_lazy (self, node) : _devio_node_spawn (self, node, NULL);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not register SMIO", err_node_start);
 
-    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
-            "[dev_io_core:register_sm] Allocating thread args\n");
+    return DEVIO_SUCCESS;
+
+err_node_start:
+    _devio_node_destroy (self, &node);
+err_node_alloc:
+err_dup_node:
+err_search_smio:
+    return err;
+}
+
+/* Spawn the SMIO of a node. "reqs" are the requests received for it while
+ * it was lazy, which it serves first. They are taken in any case */
+static devio_err_e _devio_node_spawn (devio_t *self, devio_node_t *node,
+        zlistx_t *reqs)
+{
+    assert (self);
+    assert (node);
+
+    devio_err_e err = DEVIO_ERR_ALLOC;
+    volatile const smio_mod_dispatch_t *smio_mod_handler = node->smio_handler;
+
+    /* The SMIOs come up concurrently, each one in its own thread and
+     * configured by its own config thread. Time them from here */
+    node->reg_time = zclock_mono ();
+    node->reg_time_us = zclock_usecs ();
+    if (self->startup_time == 0) {
+        self->startup_time = node->reg_time;
+    }
+    /* No thread of the SMIO is running yet */
+    memset (&node->startup, 0, sizeof (node->startup));
+    SMIO_STARTUP_SET(&node->startup, spawn_us, self->create_time_us);
 
-    /* Increment PIPE indexes */
-    pipe_mgmt_idx = self->nnodes++;
-    pipe_msg_idx = pipe_mgmt_idx;
-    pipe_config_idx = pipe_mgmt_idx;
+    node->prio = _devio_get_smio_prio (self, smio_mod_handler->name);
 
     /* Create PIPE message to talk to SMIO */
     zsock_t *pipe_msg_backend;
-    self->pipes_msg [pipe_msg_idx] = zsys_create_pipe (&pipe_msg_backend);
-    ASSERT_TEST (self->pipes_msg [pipe_msg_idx] != NULL, "Could not create message PIPE",
+    node->pipe_msg = zsys_create_pipe (&pipe_msg_backend);
+    ASSERT_TEST (node->pipe_msg != NULL, "Could not create message PIPE",
             err_create_pipe_msg);
 
     /* Register socket handlers */
-    err = _devio_engine_handle_socket (self, self->pipes_msg [pipe_msg_idx],
+    err = _devio_engine_handle_socket (self, node->pipe_msg,
         _devio_handle_pipe_msg);
     ASSERT_TEST (err == DEVIO_SUCCESS, "Could not register message socket handler",
             err_pipes_msg_handle);
 
+    /* Create ring for single register accesses from the SMIO */
+    node->ring = thsafe_ring_new ();
+    ASSERT_ALLOC (node->ring, err_ring_alloc, DEVIO_ERR_ALLOC);
+
+    err = _devio_engine_handle_ring (self, node->ring, _devio_handle_ring);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not register ring handler",
+            err_ring_handle);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
+            "[dev_io_core:register_sm] Allocating thread args\n");
+
     /* Alloacate thread arguments struct and pass it to the
      * thread. It is the responsability of the calling thread
      * to clear this structure after using it! */
     th_boot_args_t *th_args = zmalloc (sizeof *th_args);
-    ASSERT_ALLOC (th_args, err_th_args_alloc);
+    ASSERT_ALLOC (th_args, err_th_args_alloc, DEVIO_ERR_ALLOC);
     th_args->parent = self;
     th_args->smio_handler = smio_mod_handler;
     th_args->pipe_msg = pipe_msg_backend;
+    th_args->ring = node->ring;
+    /* Devices that serialize the register accesses themselves are
+     * accessed by the SMIO thread directly */
+    th_args->llio = llio_get_mt_safe (self->llio) ? self->llio : NULL;
     th_args->broker = self->endpoint_broker;
     th_args->service = self->name;
     th_args->verbose = self->verbose;
-    th_args->base = base;
-    th_args->inst_id = inst_id;
+    th_args->base = node->base;
+    th_args->inst_id = node->inst_id;
+    th_args->snapshot_dir = self->snapshot_dir;
+    th_args->trace_dir = self->trace_dir;
+    th_args->trace_max_size = self->trace_max_size;
+    th_args->cfg_file = self->cfg_file;
+    th_args->metrics = devio_metrics_node_get (self->metrics, node->slot, node->key);
+    th_args->status = (self->status != NULL) ?
+        devio_status_get_page (self->status) : NULL;
+    th_args->reqs = reqs;
+    reqs = NULL;
+    th_args->startup = &node->startup;
+    /* SMIOs without a placement of their own run where the DEVIO does */
+    if (node->inst_id < self->nsmio_sched) {
+        th_args->sched = self->smio_sched [node->inst_id];
+    }
 
     DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
             "[dev_io_core:register_sm] Calling boot func\n");
 
-    self->pipes_mgmt [pipe_mgmt_idx] = zactor_new (smio_startup, th_args);
-    ASSERT_TEST (self->pipes_mgmt [pipe_mgmt_idx] != NULL, "Could not spawn SMIO thread",
-            err_spawn_smio_thread);
+    /* Either on a shared reactor, which takes the thread arguments, or on
+     * a thread of its own */
+    smio_reactor_t *reactor = _devio_get_smio_reactor (self, node->prio);
+    if (reactor != NULL) {
+        node->pipe_mgmt = smio_reactor_add (reactor, th_args);
+        node->reactor = reactor;
+    }
+    else {
+        node->pipe_mgmt = zactor_new (smio_startup, th_args);
+        node->reactor = NULL;
+    }
+    ASSERT_TEST (node->pipe_mgmt != NULL, "Could not spawn SMIO thread",
+            err_spawn_smio_thread, DEVIO_ERR_ALLOC);
 
-    err = _devio_engine_handle_socket (self, self->pipes_mgmt [pipe_mgmt_idx],
+    err = _devio_engine_handle_socket (self, node->pipe_mgmt,
         _devio_handle_pipe_mgmt);
     ASSERT_TEST (err == DEVIO_SUCCESS, "Could not register management socket handler",
             err_pipes_mgmt_handle);
 
-    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
-            "[dev_io_core:register_sm] Inserting hash with key: %s\n", key);
-    int zerr = zhashx_insert (self->sm_io_h, key, &self->pipes_mgmt [pipe_mgmt_idx]);
-    /* We must not fail here, as we will loose our reference to the SMIO
-     * thread otherwise */
-    ASSERT_TEST (zerr == 0, "Could not insert PIPE hash key. Duplicated value?",
-            err_pipe_hash_insert);
+    /* SMIOs taken over from a previous DEVIO find the hardware configured
+     * already, and their registers in the snapshot. Registrations come in
+     * a row, so wait for the last one, as for the lazy SMIOs */
+    if (node->handoff) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
+                "[dev_io_core:register_sm] SMIO %s taken over in slot %u. "
+                "Skipping its default configuration\n", node->key, node->slot);
+        self->startup_nnodes++;
+        if (self->pipe != NULL && !(zsock_events (self->pipe) & ZMQ_POLLIN)) {
+            _devio_check_ready (self);
+        }
+        return DEVIO_SUCCESS;
+    }
 
     /* Configure default values of the recently created SMIO using the
      * bootstrap registered function config_defaults () */
@@ -876,74 +1501,181 @@ static devio_err_e _devio_register_sm_raw (devio_t *self, uint32_t smio_id, uint
      * thread. It is the responsability of the calling thread
      * to clear this structure after using it! */
     th_config_args_t *th_config_args = zmalloc (sizeof *th_config_args);
-    ASSERT_ALLOC (th_config_args, err_th_config_args_alloc);
+    ASSERT_ALLOC (th_config_args, err_th_config_args_alloc, DEVIO_ERR_ALLOC);
 
     th_config_args->broker = self->endpoint_broker;
     th_config_args->smio_handler = smio_mod_handler;
     th_config_args->service = self->name;
     th_config_args->log_file = self->log_file;
-    th_config_args->inst_id = inst_id;
+    th_config_args->inst_id = node->inst_id;
+    th_config_args->startup = &node->startup;
 
     /* Create actor just for configuring the new recently created SMIO. We will
        check for its end later on poll_all_sm function */
-    self->pipes_config [pipe_config_idx] = zactor_new (smio_config_defaults,
-            th_config_args);
-    ASSERT_TEST (self->pipes_config [pipe_config_idx] != NULL,
-            "Could not spawn config thread", err_spawn_config_thread);
-
-    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
-            "[dev_io_core:register_sm] Inserting config hash with key: %s\n", key);
-    zerr = zhashx_insert (self->sm_io_cfg_h, key, &self->pipes_config [pipe_config_idx]);
-    /* We must not fail here, as we will loose our reference to the SMIO
-     * thread otherwise */
-    ASSERT_TEST (zerr == 0, "Could not insert Config PIPE hash key. Duplicated value?",
-            err_cfg_pipe_hash_insert);
-
-    /* key is not needed anymore, as all the hashes have taken a copy of it */
-    free (key);
-    key = NULL;
+    node->pipe_config = zactor_new (smio_config_defaults, th_config_args);
+    ASSERT_TEST (node->pipe_config != NULL, "Could not spawn config thread",
+            err_spawn_config_thread, DEVIO_ERR_ALLOC);
+    self->nconfigs++;
 
     /* Register socket handlers */
-    err = _devio_engine_handle_socket (self, self->pipes_config [pipe_config_idx],
+    err = _devio_engine_handle_socket (self, node->pipe_config,
         _devio_handle_pipe_cfg);
     ASSERT_TEST (err == DEVIO_SUCCESS, "Could not register message socket handler",
             err_pipes_cfg_handle);
 
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
+            "[dev_io_core:register_sm] SMIO %s spawned in slot %u\n",
+            node->key, node->slot);
     return DEVIO_SUCCESS;
 
 err_pipes_cfg_handle:
-    zhashx_delete (self->sm_io_cfg_h, key);
-err_cfg_pipe_hash_insert:
-    /* If we can't insert the SMIO thread key in hash,
-     * destroy it as we won't have a reference to it later! */
-    _devio_destroy_actor (self, &self->pipes_config [pipe_config_idx]);
+    _devio_node_stop_config (self, node);
+    th_config_args = NULL;
 err_spawn_config_thread:
     /* FIXME: Destroy SMIO thread as we could configure it? */
     free (th_config_args);
 err_th_config_args_alloc:
-    zhashx_delete (self->sm_io_h, key);
-err_pipe_hash_insert:
-    _devio_engine_handle_socket (self, self->pipes_mgmt [pipe_mgmt_idx], NULL);
 err_pipes_mgmt_handle:
-    /* If we can't insert the SMIO thread key in hash,
-     * destroy it as we won't have a reference to it later! */
-    _devio_destroy_actor (self, &self->pipes_mgmt [pipe_mgmt_idx]);
+    _devio_node_stop_smio (self, node);
+    /* Either the SMIO thread or the reactor freed the thread arguments */
+    th_args = NULL;
 err_spawn_smio_thread:
+    if (th_args != NULL) {
+        zlistx_destroy (&th_args->reqs);
+    }
     free (th_args);
 err_th_args_alloc:
-    _devio_engine_handle_socket (self, self->pipes_msg [pipe_msg_idx], NULL);
+    _devio_engine_handle_ring (self, node->ring, NULL);
+err_ring_handle:
+    thsafe_ring_destroy (&node->ring);
+err_ring_alloc:
+    _devio_engine_handle_socket (self, node->pipe_msg, NULL);
 err_pipes_msg_handle:
-    zsock_destroy (&self->pipes_msg [pipe_msg_idx]);
+    zsock_destroy (&node->pipe_msg);
     zsock_destroy (&pipe_msg_backend);
 err_create_pipe_msg:
-    free (key);
-err_key_alloc:
-err_inst_id_str_alloc:
-err_search_smio:
-err_max_smios_reached:
+    /* Clients of a lazy SMIO that could not be spawned time out */
+    zlistx_destroy (&reqs);
+    return err;
+}
+
+/* Leave the SMIO of a node for its first request, without spawning it.
+ * Its address in the broker is held by a placeholder worker, so the
+ * requests sent to it are queued there until its first request comes.
+ * The SMIO is spawned then, taking over its address and the requests the
+ * placeholder received */
+static devio_err_e _devio_node_lazy (devio_t *self, devio_node_t *node)
+{
+    assert (self);
+    assert (node);
+
+    devio_err_e err = DEVIO_ERR_ALLOC;
+    char inst_id_str [HUTILS_KEY_STR_MAX_LEN];
+    hutils_stringify_dec_key_buf (inst_id_str, sizeof (inst_id_str), node->inst_id);
+
+    /* Same service name the SMIO exports, see smio_boot () */
+    char *service = hutils_concat_strings3 (self->name, node->smio_handler->name,
+            inst_id_str, ':');
+    ASSERT_ALLOC (service, err_service_alloc);
+
+    node->lazy_worker = mlm_client_new ();
+    ASSERT_ALLOC (node->lazy_worker, err_worker_alloc);
+    int rc = mlm_client_connect (node->lazy_worker, self->endpoint_broker,
+            DEVIO_LAZY_CONNECT_TIMEOUT, service);
+    ASSERT_TEST (rc >= 0, "Could not connect lazy SMIO to broker",
+            err_mlm_connect, DEVIO_ERR_ALLOC);
+
+    err = _devio_engine_handle_socket (self, mlm_client_msgpipe (node->lazy_worker),
+            _devio_handle_lazy_smio);
+    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not register lazy SMIO handler",
+            err_worker_handle);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] SMIO %s registered. "
+            "It is spawned on its first request\n", service);
+    free (service);
+
+    /* Nothing to wait for if every SMIO is lazy. Registrations come in a
+     * row, so wait for the last one */
+    if (self->startup_time == 0) {
+        self->startup_time = zclock_mono ();
+    }
+    if (self->pipe != NULL && !(zsock_events (self->pipe) & ZMQ_POLLIN)) {
+        _devio_check_ready (self);
+    }
+
+    return DEVIO_SUCCESS;
+
+err_worker_handle:
+err_mlm_connect:
+    mlm_client_destroy (&node->lazy_worker);
+err_worker_alloc:
+    free (service);
+err_service_alloc:
     return err;
 }
 
+/* zloop handler for the placeholder workers of the lazy SMIOs. Spawn the
+ * SMIO of the first request */
+static int _devio_handle_lazy_smio (zloop_t *loop, zsock_t *reader, void *args)
+{
+    (void) loop;
+    /* We expect a devio instance e as reference */
+    devio_t *devio = (devio_t *) args;
+
+    /* Find out which SMIO the request is for */
+    devio_node_t *node = NULL;
+    unsigned int i;
+    for (i = 0; i < devio->nnodes; ++i) {
+        if (devio->nodes [i] != NULL && devio->nodes [i]->lazy_worker != NULL &&
+                mlm_client_msgpipe (devio->nodes [i]->lazy_worker) == reader) {
+            node = devio->nodes [i];
+            break;
+        }
+    }
+    if (node == NULL) {
+        return 0;
+    }
+
+    /* Take whatever the broker gave the placeholder, with the envelope the
+     * SMIO needs to reply */
+    zlistx_t *reqs = zlistx_new ();
+    if (reqs != NULL) {
+        zlistx_set_destructor (reqs, (zlistx_destructor_fn *) smio_fairq_req_destroy);
+    }
+    while (zsock_events (reader) & ZMQ_POLLIN) {
+        zmsg_t *recv_msg = mlm_client_recv (node->lazy_worker);
+        if (recv_msg == NULL) {
+            break; /* Interrupted */
+        }
+
+        const char *subject = mlm_client_subject (node->lazy_worker);
+        const char *tracker = mlm_client_tracker (node->lazy_worker);
+        smio_fairq_req_t *req = (reqs != NULL) ?
+            (smio_fairq_req_t *) zmalloc (sizeof *req) : NULL;
+        if (req == NULL) {
+            zmsg_destroy (&recv_msg);
+            continue;
+        }
+        req->msg = recv_msg;
+        req->sender = strdup (mlm_client_sender (node->lazy_worker));
+        req->subject = (subject != NULL) ? strdup (subject) : NULL;
+        req->tracker = (tracker != NULL) ? strdup (tracker) : NULL;
+        zlistx_add_end (reqs, req);
+    }
+
+    /* Requests coming in the meantime wait in the broker for the SMIO to
+     * connect to the same address */
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] Spawning lazy SMIO "
+            "%s for its first %zu requests\n", node->key,
+            (reqs != NULL) ? zlistx_size (reqs) : 0);
+    _devio_node_stop_lazy (devio, node);
+    if (_devio_node_spawn (devio, node, reqs) != DEVIO_SUCCESS) {
+        _devio_release_node (devio, &node);
+    }
+
+    return 0;
+}
+
 devio_err_e devio_register_sm (void *pipe, uint32_t smio_id, uint64_t base,
         uint32_t inst_id)
 {
@@ -982,14 +1714,16 @@ err_register_sm_all:
 
 static devio_err_e _devio_unregister_sm_raw (devio_t *self, const char *smio_key)
 {
-    /* Don't care for errors here, as the Config actor is probably already
-     * gone */
-    _devio_destroy_smio (self, self->sm_io_cfg_h, smio_key);
-    devio_err_e err = _devio_destroy_smio (self, self->sm_io_h, smio_key);
-    ASSERT_TEST(err == DEVIO_SUCCESS, "Could not destroy SMIO",
-            err_destroy_smio, DEVIO_ERR_SMIO_DESTROY);
+    devio_err_e err = DEVIO_SUCCESS;
+    devio_node_t *node = _devio_lookup_node_by_key (self, smio_key);
+    ASSERT_TEST(node != NULL, "Could not find SMIO registered with this ID",
+            err_lookup_node, DEVIO_ERR_SMIO_DESTROY);
+
+    /* Whatever the node has, a lazy worker, a config actor or both of its
+     * PIPEs, goes with it */
+    _devio_release_node (self, &node);
 
-err_destroy_smio:
+err_lookup_node:
     return err;
 }
 
@@ -1006,27 +1740,34 @@ err_unregister_sm:
     return err;
 }
 
-static devio_err_e _devio_unregister_all_sm_raw (devio_t *self)
-{
-    devio_err_e err = _devio_destroy_smio_all (self, self->sm_io_cfg_h);
-    ASSERT_TEST(err == DEVIO_SUCCESS, "Could not destroy Config SMIOs",
-            err_destroy_cfg_smios, DEVIO_ERR_SMIO_DESTROY);
-    err = _devio_destroy_smio_all (self, self->sm_io_h);
-    ASSERT_TEST(err == DEVIO_SUCCESS, "Could not destroy SMIOs",
-            err_destroy_smios, DEVIO_ERR_SMIO_DESTROY);
-
-err_destroy_cfg_smios:
-err_destroy_smios:
-    return err;
-}
-
-devio_err_e devio_unregister_all_sm (void *pipe)
+devio_err_e devio_unregister_sm_id (void *pipe, uint32_t smio_id,
+        uint32_t inst_id)
 {
     assert (pipe);
     devio_err_e err = DEVIO_SUCCESS;
 
-    int zerr = zsock_send (pipe, "s", "$UNREGISTER_SMIO_ALL");
-    ASSERT_TEST(zerr == 0, "Could not unregister all SMIOs", err_unregister_sm_all,
+    int zerr = zsock_send (pipe, "s484", "$UNREGISTER_SMIO_ID", smio_id,
+            (uint64_t) 0, inst_id);
+    ASSERT_TEST(zerr == 0, "Could not unregister SMIO", err_unregister_sm,
+           DEVIO_ERR_INV_SOCKET /* TODO: improve error handling? */);
+
+err_unregister_sm:
+    return err;
+}
+
+static devio_err_e _devio_unregister_all_sm_raw (devio_t *self)
+{
+    _devio_release_nodes_all (self);
+    return DEVIO_SUCCESS;
+}
+
+devio_err_e devio_unregister_all_sm (void *pipe)
+{
+    assert (pipe);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    int zerr = zsock_send (pipe, "s", "$UNREGISTER_SMIO_ALL");
+    ASSERT_TEST(zerr == 0, "Could not unregister all SMIOs", err_unregister_sm_all,
            DEVIO_ERR_INV_SOCKET /* TODO: improve error handling? */);
 
 err_unregister_sm_all:
@@ -1042,12 +1783,39 @@ void devio_loop (zsock_t *pipe, void *args)
     devio_t *self = (devio_t *) args;
     self->pipe = pipe;
 
+    /* Pin ourselves before anything else. The SMIO threads inherit it */
+    hutils_err_e herr = hutils_set_thread_sched (&self->sched, self->name);
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] Could not set "
+                "CPU placement of DEVIO thread %s. Using the default one\n",
+                self->name);
+    }
+    hutils_mem_rt_thread_init ();
+
+    /* Prefer the memory of the board NUMA node, so acquisition buffers
+     * allocated by us and by the SMIO threads (which inherit our policy)
+     * are close to the device */
+    herr = hutils_mem_set_thread_node (hutils_mem_dev_numa_node (
+                llio_get_endpoint_name (self->llio)));
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] Could not set "
+                "NUMA memory policy of DEVIO thread %s. Using the default one\n",
+                self->name);
+    }
+
+    /* Take over the SMIOs of a previous DEVIO, if any, before the parent
+     * registers ours */
+    _devio_takeover (self);
+
     /* Tell parent we are initializing */
     zsock_signal (pipe, 0);
 
     /* Set-up server register commands handler */
     _devio_engine_handle_socket (self, pipe, _devio_handle_pipe);
 
+    /* Start publishing the metrics, if asked to */
+    _devio_metrics_start (self);
+
     /* Run reactor until there's a termination signal */
     zloop_start (self->loop);
 }
@@ -1083,6 +1851,322 @@ llio_t *devio_get_llio (devio_t *self)
     return self->llio;
 }
 
+disp_table_t *devio_get_thsafe_disp_table (devio_t *self)
+{
+    assert (self);
+    return self->disp_table_thsafe_ops;
+}
+
+devio_err_e devio_set_smio_prio (devio_t *self, const char *smio_name,
+        devio_prio_e prio)
+{
+    assert (self);
+    assert (smio_name);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    ASSERT_TEST(prio < DEVIO_PRIO_INVALID, "Invalid priority class",
+            err_inv_prio, DEVIO_ERR_CFG);
+
+    /* SMIO names are upper case */
+    char *key = strdup (smio_name);
+    ASSERT_ALLOC(key, err_key_alloc, DEVIO_ERR_ALLOC);
+    char *c;
+    for (c = key; *c != '\0'; ++c) {
+        *c = toupper ((unsigned char) *c);
+    }
+
+    char *prio_str = devio_prio_to_str (prio);
+    ASSERT_ALLOC(prio_str, err_prio_str_alloc, DEVIO_ERR_ALLOC);
+    zhashx_update (self->smio_prio_h, key, prio_str);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
+            "[dev_io_core] SMIO %s priority class set to %s\n", key, prio_str);
+
+err_prio_str_alloc:
+    free (key);
+err_key_alloc:
+err_inv_prio:
+    return err;
+}
+
+devio_err_e devio_set_smio_lazy (devio_t *self, const char *smio_name, bool lazy)
+{
+    assert (self);
+    assert (smio_name);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    /* SMIO names are upper case */
+    char *key = strdup (smio_name);
+    ASSERT_ALLOC(key, err_key_alloc, DEVIO_ERR_ALLOC);
+    char *c;
+    for (c = key; *c != '\0'; ++c) {
+        *c = toupper ((unsigned char) *c);
+    }
+
+    char *lazy_str = strdup (lazy ? DEVIO_SMIO_LAZY_STR : DEVIO_SMIO_EAGER_STR);
+    ASSERT_ALLOC(lazy_str, err_lazy_str_alloc, DEVIO_ERR_ALLOC);
+    zhashx_update (self->smio_lazy_h, key, lazy_str);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO,
+            "[dev_io_core] SMIO %s spawn policy set to %s\n", key, lazy_str);
+
+err_lazy_str_alloc:
+    free (key);
+err_key_alloc:
+    return err;
+}
+
+devio_err_e devio_set_smio_lazy_dflt (devio_t *self, bool lazy)
+{
+    assert (self);
+
+    self->smio_lazy_dflt = lazy;
+    return DEVIO_SUCCESS;
+}
+
+devio_err_e devio_set_sched (devio_t *self, const hutils_sched_t *sched)
+{
+    assert (self);
+    assert (sched);
+
+    self->sched = *sched;
+    return DEVIO_SUCCESS;
+}
+
+devio_err_e devio_set_smio_sched (devio_t *self, uint32_t inst_id,
+        const hutils_sched_t *sched)
+{
+    assert (self);
+    assert (sched);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    ASSERT_TEST(inst_id < UINT32_MAX, "SMIO instance ID is out of range",
+            err_inv_inst_id, DEVIO_ERR_CFG);
+
+    /* Instances without a placement of their own are left zeroed, so they
+     * run where the DEVIO does */
+    if (inst_id >= self->nsmio_sched) {
+        hutils_sched_t *smio_sched = (hutils_sched_t *) realloc (self->smio_sched,
+                (inst_id + 1) * sizeof (*smio_sched));
+        ASSERT_ALLOC(smio_sched, err_smio_sched_alloc, DEVIO_ERR_ALLOC);
+        memset (smio_sched + self->nsmio_sched, 0,
+                (inst_id + 1 - self->nsmio_sched) * sizeof (*smio_sched));
+        self->smio_sched = smio_sched;
+        self->nsmio_sched = inst_id + 1;
+    }
+
+    self->smio_sched [inst_id] = *sched;
+
+err_smio_sched_alloc:
+err_inv_inst_id:
+    return err;
+}
+
+/* Move ourselves to "sched". The SMIOs with no placement of their own
+ * follow only the ones spawned afterwards */
+static void _devio_update_sched_raw (devio_t *self, const hutils_sched_t *sched)
+{
+    self->sched = *sched;
+    hutils_err_e herr = hutils_set_thread_sched (&self->sched, self->name);
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] Could not update "
+                "CPU placement of DEVIO thread %s\n", self->name);
+    }
+}
+
+/* SMIOs with a thread of their own move themselves when told over their
+ * management PIPE. The ones on a reactor share its thread, so they stay */
+static void _devio_update_smio_sched_raw (devio_t *self, uint32_t inst_id,
+        const hutils_sched_t *sched)
+{
+    devio_err_e err = devio_set_smio_sched (self, inst_id, sched);
+    if (err != DEVIO_SUCCESS) {
+        return;
+    }
+
+    /* Parts not given follow the DEVIO, as on spawn */
+    hutils_sched_t smio_sched = *sched;
+    if (smio_sched.cpu_mask == 0) {
+        smio_sched.cpu_mask = self->sched.cpu_mask;
+    }
+    if (smio_sched.fifo_prio == 0) {
+        smio_sched.fifo_prio = self->sched.fifo_prio;
+    }
+
+    unsigned int i;
+    for (i = 0; i < self->nnodes; ++i) {
+        devio_node_t *node = self->nodes [i];
+        if (node == NULL || node->inst_id != inst_id || node->pipe_mgmt == NULL) {
+            continue;
+        }
+
+        if (node->reactor != NULL) {
+            DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] SMIO %s is on "
+                    "a reactor. Keeping its CPU placement\n", node->key);
+            continue;
+        }
+
+        zsock_send (node->pipe_mgmt, "sb", "$SET_SCHED", &smio_sched,
+                sizeof (smio_sched));
+    }
+}
+
+devio_err_e devio_update_sched (void *pipe, const hutils_sched_t *sched)
+{
+    assert (pipe);
+    assert (sched);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    int zerr = zsock_send (pipe, "s484", "$SET_SCHED", (uint32_t) sched->fifo_prio,
+            sched->cpu_mask, (uint32_t) 0);
+    ASSERT_TEST(zerr == 0, "Could not update DEVIO CPU placement", err_send,
+           DEVIO_ERR_INV_SOCKET);
+
+err_send:
+    return err;
+}
+
+devio_err_e devio_update_smio_sched (void *pipe, uint32_t inst_id,
+        const hutils_sched_t *sched)
+{
+    assert (pipe);
+    assert (sched);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    int zerr = zsock_send (pipe, "s484", "$SET_SMIO_SCHED",
+            (uint32_t) sched->fifo_prio, sched->cpu_mask, inst_id);
+    ASSERT_TEST(zerr == 0, "Could not update SMIO CPU placement", err_send,
+           DEVIO_ERR_INV_SOCKET);
+
+err_send:
+    return err;
+}
+
+devio_err_e devio_set_smio_reactors (devio_t *self, uint32_t nreactors)
+{
+    assert (self);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    ASSERT_TEST(nreactors <= DEVIO_MAX_SMIO_REACTORS, "Too many SMIO reactors",
+            err_inv_nreactors, DEVIO_ERR_CFG);
+    ASSERT_TEST(!self->smio_reactors_shared, "SMIO reactors are already "
+            "shared", err_shared, DEVIO_ERR_CFG);
+
+    self->nsmio_reactors = nreactors;
+
+err_shared:
+err_inv_nreactors:
+    return err;
+}
+
+devio_err_e devio_share_smio_reactors (devio_t *self, smio_reactor_t **reactors,
+        uint32_t nreactors)
+{
+    assert (self);
+    assert (reactors);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    ASSERT_TEST(nreactors <= DEVIO_MAX_SMIO_REACTORS, "Too many SMIO reactors",
+            err_inv_nreactors, DEVIO_ERR_CFG);
+    /* Our own reactors are started only when registering SMIOs */
+    ASSERT_TEST(self->nnodes == 0, "SMIOs already registered",
+            err_registered, DEVIO_ERR_CFG);
+
+    uint32_t i;
+    for (i = 0; i < nreactors; ++i) {
+        ASSERT_TEST(reactors [i] != NULL, "Invalid SMIO reactor",
+                err_inv_reactor, DEVIO_ERR_CFG);
+        self->smio_reactors [i] = reactors [i];
+    }
+
+    self->nsmio_reactors = nreactors;
+    self->smio_reactors_shared = true;
+
+err_inv_reactor:
+err_registered:
+err_inv_nreactors:
+    return err;
+}
+
+devio_err_e devio_set_snapshot_dir (devio_t *self, const char *snapshot_dir)
+{
+    assert (self);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    free (self->snapshot_dir);
+    self->snapshot_dir = NULL;
+
+    if (snapshot_dir != NULL) {
+        self->snapshot_dir = strdup (snapshot_dir);
+        ASSERT_ALLOC(self->snapshot_dir, err_snapshot_dir_alloc, DEVIO_ERR_ALLOC);
+    }
+
+err_snapshot_dir_alloc:
+    return err;
+}
+
+bool devio_took_over (devio_t *self)
+{
+    assert (self);
+    return self->handoff_h != NULL;
+}
+
+devio_err_e devio_set_cfg_file (devio_t *self, const char *cfg_file)
+{
+    assert (self);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    free (self->cfg_file);
+    self->cfg_file = NULL;
+
+    if (cfg_file != NULL) {
+        self->cfg_file = strdup (cfg_file);
+        ASSERT_ALLOC(self->cfg_file, err_cfg_file_alloc, DEVIO_ERR_ALLOC);
+    }
+
+err_cfg_file_alloc:
+    return err;
+}
+
+devio_err_e devio_set_trace (devio_t *self, const char *trace_dir,
+        uint64_t max_size)
+{
+    assert (self);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    free (self->trace_dir);
+    self->trace_dir = NULL;
+    self->trace_max_size = max_size;
+
+    if (trace_dir != NULL) {
+        self->trace_dir = strdup (trace_dir);
+        ASSERT_ALLOC(self->trace_dir, err_trace_dir_alloc, DEVIO_ERR_ALLOC);
+    }
+
+err_trace_dir_alloc:
+    return err;
+}
+
+devio_err_e devio_set_metrics (devio_t *self, const char *endpoint,
+        uint32_t interval)
+{
+    assert (self);
+    devio_err_e err = DEVIO_SUCCESS;
+
+    free (self->metrics_endp);
+    self->metrics_endp = NULL;
+
+    if (endpoint != NULL) {
+        self->metrics_endp = strdup (endpoint);
+        ASSERT_ALLOC(self->metrics_endp, err_metrics_endp_alloc, DEVIO_ERR_ALLOC);
+    }
+    self->metrics_interval = (interval > 0) ? (int) interval :
+        DEVIO_METRICS_DFLT_INTERVAL;
+
+err_metrics_endp_alloc:
+    return err;
+}
+
 devio_err_e devio_set_sig_handler (devio_t *self, devio_sig_handler_t *sig_handler)
 {
     assert (self);
@@ -1199,6 +2283,17 @@ devio_err_e devio_spawn_chld (devio_t *self, const char *program,
     return _devio_spawn_chld (self, program, argv);
 }
 
+int devio_spawn_chld_pid (devio_t *self, const char *program,
+        char *const argv[])
+{
+    assert (self);
+
+    if (self->ops->devio_spawn_chld == NULL) {
+        return -1;
+    }
+    return self->ops->devio_spawn_chld (program, argv);
+}
+
 devio_err_e devio_set_ops (devio_t *self, devio_ops_t *devio_ops)
 {
     assert (self);
@@ -1214,7 +2309,7 @@ devio_err_e devio_set_ops (devio_t *self, devio_ops_t *devio_ops)
 /************************************************************/
 
 static disp_table_err_e _devio_check_msg_args (disp_table_t *disp_table,
-        const disp_op_t *disp_op, void *args)
+        const disp_op_t *disp_op, const disp_op_sig_t *sig, void *args)
 {
     assert (disp_table);
     assert (disp_op);
@@ -1225,7 +2320,7 @@ static disp_table_err_e _devio_check_msg_args (disp_table_t *disp_table,
     /* Check if the message is the correct one */
     ASSERT_TEST (msg_guess_type (args) == MSG_THSAFE_ZMQ, "Invalid message tag",
             err_inv_msg, DISP_TABLE_ERR_BAD_MSG);
-    msg_err_e merr = msg_check_gen_zmq_args (disp_op, THSAFE_MSG_ZMQ(args));
+    msg_err_e merr = msg_check_gen_zmq_args (disp_op, sig, THSAFE_MSG_ZMQ(args));
     ASSERT_TEST (merr == MSG_SUCCESS, "Unrecognized message. Message arguments "
             "checking failed", err_msg_args_check, DISP_TABLE_ERR_BAD_MSG);
 
@@ -1250,7 +2345,8 @@ static devio_err_e _devio_do_smio_op (devio_t *self, void *msg)
     devio_err_e err = DEVIO_SUCCESS;
 
     disp_table_t *disp_table = self->disp_table_thsafe_ops;
-    msg_err_e merr = msg_handle_sock_request (self, msg, disp_table);
+    msg_err_e merr = msg_handle_sock_request (self, msg, disp_table,
+            self->thsafe_stats);
     ASSERT_TEST (merr == MSG_SUCCESS, "Error handling request", err_hand_req,
             DEVIO_ERR_SMIO_DO_OP /* returning a more meaningful error? */);
 
@@ -1258,27 +2354,154 @@ err_hand_req:
     return err;
 }
 
-static devio_err_e _devio_destroy_smio_all (devio_t *self, zhashx_t *smio_h)
+/* The keys of nodes_h and smio_mods_h are 64-bit integers, see
+ * _devio_node_key (). Mix the bits, as the IDs of the SMIO modules
+ * differ in a few of them only. This is the finalizer of MurmurHash3 */
+static size_t _devio_key_hasher (const void *key)
 {
-    assert (self);
+    uint64_t k = *(const uint64_t *) key;
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return (size_t) k;
+}
 
-    devio_err_e err = DEVIO_SUCCESS;
-    /* Get all hash keys */
-    zlistx_t *hash_keys = zhashx_keys (smio_h);
-    ASSERT_ALLOC (hash_keys, err_hash_keys_alloc, DEVIO_ERR_ALLOC);
-    char *hash_item = zlistx_first (hash_keys);
+static int _devio_key_comparator (const void *key1, const void *key2)
+{
+    uint64_t k1 = *(const uint64_t *) key1;
+    uint64_t k2 = *(const uint64_t *) key2;
+    return (k1 < k2) ? -1 : (k1 > k2);
+}
 
-    /* Iterate over all keys removing each of one */
-    for (; hash_item != NULL; hash_item = zlistx_next (hash_keys)) {
-        err = _devio_destroy_smio (self, smio_h, hash_item);
-        ASSERT_TEST (err == DEVIO_SUCCESS, "Could not destroy SMIO "
-                "instance", err_smio_destroy, DEVIO_ERR_SMIO_DESTROY);
+static void *_devio_key_duplicator (const void *key)
+{
+    uint64_t *key_dup = (uint64_t *) malloc (sizeof *key_dup);
+    if (key_dup != NULL) {
+        *key_dup = *(const uint64_t *) key;
     }
+    return key_dup;
+}
 
-err_smio_destroy:
-    zlistx_destroy (&hash_keys);
-err_hash_keys_alloc:
-    return err;
+static void _devio_key_destructor (void **key)
+{
+    free (*key);
+    *key = NULL;
+}
+
+static zhashx_t *_devio_key_hash_new (void)
+{
+    zhashx_t *hash = zhashx_new ();
+    if (hash != NULL) {
+        zhashx_set_key_hasher (hash, _devio_key_hasher);
+        zhashx_set_key_comparator (hash, _devio_key_comparator);
+        zhashx_set_key_duplicator (hash, _devio_key_duplicator);
+        zhashx_set_key_destructor (hash, _devio_key_destructor);
+    }
+    return hash;
+}
+
+static uint64_t _devio_node_key (uint32_t smio_id, uint32_t inst_id)
+{
+    return ((uint64_t) smio_id << 32) | inst_id;
+}
+
+/* Allocate a node and insert it in the registry, in the first free slot.
+ * The slots grow as needed */
+static devio_node_t *_devio_node_new (devio_t *self,
+        volatile const smio_mod_dispatch_t *smio_mod_handler, uint64_t base,
+        uint32_t inst_id)
+{
+    devio_node_t *node = (devio_node_t *) zmalloc (sizeof *node);
+    ASSERT_ALLOC (node, err_node_alloc);
+    node->smio_id = smio_mod_handler->id;
+    node->inst_id = inst_id;
+    node->base = base;
+    node->smio_handler = smio_mod_handler;
+
+    /* Stringify ID. This is the name the SMIO is unregistered by */
+    char inst_id_str [HUTILS_KEY_STR_MAX_LEN];
+    hutils_stringify_dec_key_buf (inst_id_str, sizeof (inst_id_str), inst_id);
+    int key_len = hutils_concat_strings_no_sep_buf (node->key, sizeof (node->key),
+            smio_mod_handler->name, inst_id_str);
+    ASSERT_TEST (key_len >= 0, "SMIO hash key is too long", err_key_len);
+
+    unsigned int slot;
+    for (slot = 0; slot < self->nnodes && self->nodes [slot] != NULL; ++slot);
+
+    if (slot == self->nodes_cap) {
+        unsigned int nodes_cap = self->nodes_cap * 2;
+        devio_node_t **nodes = (devio_node_t **) realloc (self->nodes,
+                nodes_cap * sizeof (*nodes));
+        ASSERT_ALLOC (nodes, err_nodes_alloc);
+        memset (nodes + self->nodes_cap, 0,
+                (nodes_cap - self->nodes_cap) * sizeof (*nodes));
+        self->nodes = nodes;
+        self->nodes_cap = nodes_cap;
+    }
+
+    uint64_t node_key = _devio_node_key (node->smio_id, inst_id);
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_TRACE,
+            "[dev_io_core:register_sm] Inserting hash with key: %s\n", node->key);
+    int zerr = zhashx_insert (self->nodes_h, &node_key, node);
+    ASSERT_TEST (zerr == 0, "Could not insert node hash key. Duplicated value?",
+            err_node_hash_insert);
+
+    node->slot = slot;
+    self->nodes [slot] = node;
+    if (slot == self->nnodes) {
+        self->nnodes++;
+    }
+
+    return node;
+
+err_node_hash_insert:
+err_nodes_alloc:
+err_key_len:
+    free (node);
+err_node_alloc:
+    return NULL;
+}
+
+/* Remove a node from the registry, with nothing left running on it */
+static void _devio_node_destroy (devio_t *self, devio_node_t **node_p)
+{
+    assert (node_p);
+
+    if (*node_p) {
+        devio_node_t *node = *node_p;
+
+        uint64_t node_key = _devio_node_key (node->smio_id, node->inst_id);
+        zhashx_delete (self->nodes_h, &node_key);
+        self->nodes [node->slot] = NULL;
+        while (self->nnodes > 0 && self->nodes [self->nnodes-1] == NULL) {
+            self->nnodes--;
+        }
+
+        free (node);
+        *node_p = NULL;
+    }
+}
+
+static devio_node_t *_devio_lookup_node (devio_t *self, uint32_t smio_id,
+        uint32_t inst_id)
+{
+    uint64_t node_key = _devio_node_key (smio_id, inst_id);
+    return (devio_node_t *) zhashx_lookup (self->nodes_h, &node_key);
+}
+
+/* smio_key is the name of the SMIO + instance number, e.g.,
+ * FMC130M_4CH0. Only used to unregister SMIOs, so the slots are just
+ * scanned */
+static devio_node_t *_devio_lookup_node_by_key (devio_t *self, const char *smio_key)
+{
+    unsigned int i;
+    for (i = 0; i < self->nnodes; ++i) {
+        if (self->nodes [i] != NULL && streq (self->nodes [i]->key, smio_key)) {
+            return self->nodes [i];
+        }
+    }
+
+    return NULL;
 }
 
 static devio_err_e _devio_destroy_actor (devio_t *self, zactor_t **actor)
@@ -1300,28 +2523,351 @@ static devio_err_e _devio_destroy_actor (devio_t *self, zactor_t **actor)
     return err;
 }
 
-/* smio_key is the name of the SMIO + instance number, e.g.,
- * FMC130M_4CH0*/
-static devio_err_e _devio_destroy_smio (devio_t *self, zhashx_t *smio_h, const char *smio_key)
+/* Config actors are always actors of their own */
+static void _devio_node_stop_config (devio_t *self, devio_node_t *node)
 {
-    assert (self);
+    if (node->pipe_config == NULL) {
+        return;
+    }
 
-    devio_err_e err = DEVIO_SUCCESS;
-    /* Lookup SMIO reference in hash table */
-    zactor_t **actor = (zactor_t **) zhashx_lookup (smio_h, smio_key);
-    ASSERT_TEST (actor != NULL, "Could not find SMIO registered with this ID",
-            err_hash_lookup, DEVIO_ERR_SMIO_DESTROY);
+    _devio_destroy_actor (self, &node->pipe_config);
+    self->nconfigs--;
+}
 
-    err = _devio_destroy_actor (self, actor);
-    ASSERT_TEST (err == DEVIO_SUCCESS, "Could not send self-destruct message to "
-            "PIPE management", err_send_msg, DEVIO_ERR_SMIO_DESTROY);
+/* Destroy the SMIO of a node, whether it has a thread of its own or runs
+ * on a reactor */
+static void _devio_node_stop_smio (devio_t *self, devio_node_t *node)
+{
+    if (node->pipe_mgmt == NULL) {
+        return;
+    }
 
-    /* Finally, remove the pipe from hash. FIXME: What if the SMIO does not
-     * exit? We will loose its reference ...*/
-    zhashx_delete (smio_h, smio_key);
+    devio_metrics_node_release (self->metrics, node->slot);
 
-err_send_msg:
-err_hash_lookup:
-    return err;
+    smio_reactor_t *reactor = node->reactor;
+    if (reactor == NULL) {
+        _devio_destroy_actor (self, (zactor_t **) &node->pipe_mgmt);
+        return;
+    }
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] Destroying reactor "
+            "SMIO %p\n", node->pipe_mgmt);
+    _devio_engine_handle_socket (self, node->pipe_mgmt, NULL);
+    smio_reactor_remove (reactor, (zsock_t **) &node->pipe_mgmt);
+    node->reactor = NULL;
+}
+
+/* The placeholder worker of a lazy SMIO gives its address up */
+static void _devio_node_stop_lazy (devio_t *self, devio_node_t *node)
+{
+    if (node->lazy_worker == NULL) {
+        return;
+    }
+
+    _devio_engine_handle_socket (self, mlm_client_msgpipe (node->lazy_worker), NULL);
+    mlm_client_destroy (&node->lazy_worker);
+}
+
+/* Stop everything running on a node and remove it from the registry */
+static void _devio_release_node (devio_t *self, devio_node_t **node_p)
+{
+    assert (node_p);
+
+    if (*node_p) {
+        devio_node_t *node = *node_p;
+        DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] Releasing SMIO "
+                "%s\n", node->key);
+
+        /* Don't leave any reply to a PIPE that is about to go away */
+        llio_flush_async (self->llio);
+
+        /* The config thread talks to the SMIO, so it goes first */
+        _devio_node_stop_config (self, node);
+        _devio_node_stop_smio (self, node);
+        _devio_node_stop_lazy (self, node);
+
+        /* Nobody else accesses the PIPE and ring of the SMIO now */
+        if (node->ring != NULL) {
+            _devio_engine_handle_ring (self, node->ring, NULL);
+            thsafe_ring_destroy (&node->ring);
+        }
+        if (node->pipe_msg != NULL) {
+            _devio_engine_handle_socket (self, node->pipe_msg, NULL);
+            zsock_destroy (&node->pipe_msg);
+        }
+
+        _devio_node_destroy (self, node_p);
+    }
+}
+
+static void _devio_release_nodes_all (devio_t *self)
+{
+    unsigned int i;
+    for (i = self->nnodes; i > 0; --i) {
+        _devio_release_node (self, &self->nodes [i-1]);
+    }
+}
+
+/* Reactor to run an SMIO of priority class "prio" on, NULL for a thread of
+ * its own. Reactors are started as needed, up to the maximum number */
+static smio_reactor_t *_devio_get_smio_reactor (devio_t *self, devio_prio_e prio)
+{
+    if (self->nsmio_reactors == 0 || prio == DEVIO_PRIO_LOW) {
+        return NULL;
+    }
+
+    smio_reactor_t *reactor = NULL;
+    uint32_t i;
+    for (i = 0; i < self->nsmio_reactors; ++i) {
+        if (self->smio_reactors [i] == NULL) {
+            char *name = zsys_sprintf ("%s:reactor%u", self->name, i);
+            if (name != NULL) {
+                self->smio_reactors [i] = smio_reactor_new (name, &self->sched);
+            }
+            zstr_free (&name);
+            /* Fall back to the running reactors */
+            if (self->smio_reactors [i] == NULL) {
+                DBE_DEBUG (DBG_DEV_IO | DBG_LVL_WARN, "[dev_io_core] Could "
+                        "not start SMIO reactor %u\n", i);
+                continue;
+            }
+        }
+
+        if (smio_reactor_get_nsmios (self->smio_reactors [i]) >=
+                SMIO_REACTOR_MAX_SMIOS) {
+            continue;
+        }
+
+        if (reactor == NULL || smio_reactor_get_nsmios (self->smio_reactors [i]) <
+                smio_reactor_get_nsmios (reactor)) {
+            reactor = self->smio_reactors [i];
+        }
+    }
+
+    return reactor;
+}
+
+/* Report how long the SMIO took to come up, from its registration
+ * to the end of its configuration, and where the time went. It is kept
+ * for SMIO_OPCODE_GET_STARTUP_STATS */
+static void _devio_report_smio_config (devio_t *self, devio_node_t *node)
+{
+    SMIO_STARTUP_SET(&node->startup, up_us, node->reg_time_us);
+
+    smio_startup_stats_t *startup = &node->startup;
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] SMIO %s up in "
+            "%"PRId64" ms. Spawned at %"PRIu64" us, boot %"PRIu64" us (connect "
+            "%"PRIu64", init %"PRIu64", snapshot %"PRIu64", export %"PRIu64
+            ", directory %"PRIu64"), config %"PRIu64" us\n", node->key,
+            zclock_mono () - node->reg_time,
+            __atomic_load_n (&startup->spawn_us, __ATOMIC_RELAXED),
+            __atomic_load_n (&startup->boot_us, __ATOMIC_RELAXED),
+            __atomic_load_n (&startup->connect_us, __ATOMIC_RELAXED),
+            __atomic_load_n (&startup->init_us, __ATOMIC_RELAXED),
+            __atomic_load_n (&startup->snapshot_us, __ATOMIC_RELAXED),
+            __atomic_load_n (&startup->export_us, __ATOMIC_RELAXED),
+            __atomic_load_n (&startup->dir_us, __ATOMIC_RELAXED),
+            __atomic_load_n (&startup->config_us, __ATOMIC_RELAXED));
+    /* Supress compiler warnings if we are not debugging */
+    (void) startup;
+
+    if (self->startup_time != 0) {
+        self->startup_nnodes++;
+    }
+}
+
+/* Signal the parent when the last pending config actor of the startup is
+ * gone. SMIOs registered from then on are reported only on their own */
+static void _devio_check_ready (devio_t *self)
+{
+    if (self->startup_time == 0 || self->nconfigs != 0) {
+        return;
+    }
+
+    /* The SMIOs come up concurrently, so the slowest one is the one
+     * holding the startup back */
+    devio_node_t *slowest = NULL;
+    uint64_t boot_us = 0, config_us = 0;
+    for (unsigned int i = 0; i < self->nnodes; ++i) {
+        devio_node_t *node = self->nodes [i];
+        if (node == NULL || node->pipe_mgmt == NULL ||
+                node->reg_time < self->startup_time) {
+            continue;
+        }
+
+        boot_us += __atomic_load_n (&node->startup.boot_us, __ATOMIC_RELAXED);
+        config_us += __atomic_load_n (&node->startup.config_us, __ATOMIC_RELAXED);
+        if (slowest == NULL || node->startup.up_us > slowest->startup.up_us) {
+            slowest = node;
+        }
+    }
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] %s: %u SMIOs up in "
+            "%"PRId64" ms. Boot %"PRIu64" us and config %"PRIu64" us in all, "
+            "slowest SMIO %s\n", self->name, self->startup_nnodes,
+            zclock_mono () - self->startup_time, boot_us, config_us,
+            (slowest != NULL) ? slowest->key : "none");
+    /* Supress compiler warnings if we are not debugging */
+    (void) boot_us;
+    (void) config_us;
+    (void) slowest;
+    self->startup_time = 0;
+    self->startup_nnodes = 0;
+
+    /* Only a DEVIO with all of its SMIOs up hands them off */
+    _devio_handoff_listen (self);
+    zstr_send (self->pipe, DEVIO_READY_STR);
+}
+
+/* Path of the handoff socket of DEVIOs named as this one */
+static char *_devio_handoff_path (devio_t *self)
+{
+    return zsys_sprintf ("%s/%s%s", self->snapshot_dir, self->name,
+            DEVIO_HANDOFF_SUFFIX);
+}
+
+/* Take over the SMIOs of a previous DEVIO of the same name, if it listens
+ * for a handoff (see _devio_handoff_listen ()). It stops its SMIOs, leaving
+ * the hardware as it is, and replies with their keys, which are kept in
+ * handoff_h. Without one, or if it does not reply in time, we start from
+ * scratch */
+static void _devio_takeover (devio_t *self)
+{
+    if (self->snapshot_dir == NULL) {
+        return;
+    }
+
+    char *path = _devio_handoff_path (self);
+    ASSERT_ALLOC(path, err_path_alloc);
+    if (access (path, F_OK) != 0) {
+        goto err_no_handoff;
+    }
+
+    zsock_t *req = zsock_new (ZMQ_REQ);
+    ASSERT_ALLOC(req, err_req_alloc);
+    zsock_set_sndtimeo (req, DEVIO_HANDOFF_TIMEOUT);
+    zsock_set_rcvtimeo (req, DEVIO_HANDOFF_TIMEOUT);
+    int rc = zsock_connect (req, "ipc://%s", path);
+    ASSERT_TEST(rc == 0, "Could not connect to the previous DEVIO", err_req_connect);
+
+    rc = zstr_send (req, DEVIO_HANDOFF_CMD_STR);
+    ASSERT_TEST(rc == 0, "Could not ask the previous DEVIO for a handoff",
+            err_req_send);
+
+    zmsg_t *reply = zmsg_recv (req);
+    ASSERT_TEST(reply != NULL, "Previous DEVIO did not hand off in time. "
+            "Starting from scratch", err_reply_recv);
+
+    char *status = zmsg_popstr (reply);
+    ASSERT_TEST(status != NULL && streq (status, DEVIO_HANDOFF_OK_STR),
+            "Previous DEVIO refused the handoff. Starting from scratch",
+            err_reply_status);
+
+    self->handoff_h = zhashx_new ();
+    ASSERT_ALLOC(self->handoff_h, err_handoff_h_alloc);
+    zhashx_set_destructor (self->handoff_h, (zhashx_destructor_fn *) zstr_free);
+    char *key;
+    while ((key = zmsg_popstr (reply)) != NULL) {
+        zhashx_update (self->handoff_h, key, key);
+    }
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] %s: took over %zu "
+            "SMIOs from the previous DEVIO\n", self->name,
+            zhashx_size (self->handoff_h));
+
+err_handoff_h_alloc:
+err_reply_status:
+    free (status);
+    zmsg_destroy (&reply);
+err_reply_recv:
+err_req_send:
+err_req_connect:
+    zsock_destroy (&req);
+err_req_alloc:
+err_no_handoff:
+    free (path);
+err_path_alloc:
+    return;
+}
+
+/* Listen for a new DEVIO of the same name taking over our SMIOs. Not
+ * fatal, restarts are just cold then */
+static void _devio_handoff_listen (devio_t *self)
+{
+    if (self->snapshot_dir == NULL || self->handoff != NULL) {
+        return;
+    }
+
+    char *path = _devio_handoff_path (self);
+    ASSERT_ALLOC(path, err_path_alloc);
+
+    zsock_t *rep = zsock_new (ZMQ_REP);
+    ASSERT_ALLOC(rep, err_rep_alloc);
+    /* A file left by a DEVIO that did not exit cleanly is replaced */
+    int rc = zsock_bind (rep, "ipc://%s", path);
+    ASSERT_TEST(rc != -1, "Could not listen for DEVIO handoffs", err_rep_bind);
+
+    devio_err_e err = _devio_engine_handle_socket (self, rep, _devio_handle_handoff);
+    ASSERT_TEST(err == DEVIO_SUCCESS, "Could not register handoff socket handler",
+            err_rep_handle);
+    self->handoff = rep;
+    rep = NULL;
+
+err_rep_handle:
+err_rep_bind:
+    zsock_destroy (&rep);
+err_rep_alloc:
+    free (path);
+err_path_alloc:
+    return;
 }
 
+/* zloop handler for the handoff socket. Stop all of the SMIOs and reply
+ * with their keys, see _devio_takeover () */
+static int _devio_handle_handoff (zloop_t *loop, zsock_t *reader, void *args)
+{
+    (void) loop;
+
+    /* We expect a devio instance e as reference */
+    devio_t *devio = (devio_t *) args;
+
+    char *command = zstr_recv (reader);
+    if (command == NULL) {
+        return 0; /* Malformed message */
+    }
+
+    zmsg_t *reply = NULL;
+    ASSERT_TEST(streq (command, DEVIO_HANDOFF_CMD_STR), "Handoff socket "
+            "received an invalid command", err_inv_command);
+
+    reply = zmsg_new ();
+    ASSERT_ALLOC(reply, err_reply_alloc);
+    zmsg_addstr (reply, DEVIO_HANDOFF_OK_STR);
+    unsigned int i;
+    for (i = 0; i < devio->nnodes; ++i) {
+        if (devio->nodes [i] != NULL) {
+            zmsg_addstr (reply, devio->nodes [i]->key);
+        }
+    }
+
+    /* The SMIOs disconnect from the broker, so requests coming in the
+     * meantime wait there for the ones of the new DEVIO, which connect to
+     * the same addresses. Stopping them does not touch the hardware */
+    _devio_release_nodes_all (devio);
+    zmsg_send (&reply, reader);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_core] %s: SMIOs handed "
+            "off to a new DEVIO\n", devio->name);
+
+    /* Only one handoff. The socket goes with us, once the reply is out */
+    _devio_engine_handle_socket (devio, devio->handoff, NULL);
+    free (command);
+    zstr_send (devio->pipe, DEVIO_HANDOFF_STR);
+    return 0;
+
+err_reply_alloc:
+err_inv_command:
+    zstr_send (reader, DEVIO_HANDOFF_ERR_STR);
+    free (command);
+    return 0;
+}
@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <stdio.h>
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...)  \
+    ASSERT_HAL_TEST(test_boolean, DEV_IO, "[dev_io_metrics]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, DEV_IO, "[dev_io_metrics]",       \
+            devio_err_str(DEVIO_ERR_ALLOC),                 \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, DEV_IO, "[dev_io_metrics]",          \
+            devio_err_str (err_type))
+
+/* Upper bound of the first latency histogram bucket, in ns */
+#define DEVIO_METRICS_HIST_FIRST_NS         1000ULL
+/* Nodes are written by their SMIO thread only, so a relaxed load and
+ * store are enough for the DEVIO thread never to read a torn value,
+ * without the cost of a locked read-modify-write */
+#define DEVIO_METRICS_ADD(var, val)                                     \
+    __atomic_store_n (&(var), __atomic_load_n (&(var), __ATOMIC_RELAXED) + (val), \
+            __ATOMIC_RELAXED)
+#define DEVIO_METRICS_SET(var, val)                                     \
+    __atomic_store_n (&(var), (val), __ATOMIC_RELAXED)
+#define DEVIO_METRICS_GET(var)                                          \
+    __atomic_load_n (&(var), __ATOMIC_RELAXED)
+
+/* Counters of a single SMIO. Nodes are kept in cache lines of their own,
+ * as they are written by different threads */
+struct _devio_metrics_node_t {
+    char smio_key [HUTILS_CFG_HASH_KEY_MAX_LEN];    /* SMIO name + instance ID */
+    bool active;                                    /* SMIO is running. Only
+                                                       used by the DEVIO thread */
+    uint64_t requests;                              /* Requests served */
+    uint64_t request_errors;                        /* Requests not handled */
+    uint64_t request_bytes;                         /* Bytes received in requests */
+    uint64_t request_ns;                            /* Sum of the request latencies */
+    uint64_t request_hist [DEVIO_METRICS_HIST_BUCKETS];
+    uint64_t rejected;                              /* Requests rejected, as their
+                                                       sender had too many waiting */
+    uint64_t coalesced;                             /* Writes superseded while
+                                                       waiting */
+    uint64_t shared;                                /* Reads answered with the
+                                                       reply of an identical one */
+    uint64_t queue_depth;                           /* Requests waiting */
+    uint64_t queue_senders;                         /* Senders with requests waiting */
+    uint64_t thsafe;                                /* Register and block accesses */
+    uint64_t thsafe_errors;                         /* Failed accesses */
+    uint64_t thsafe_read_bytes;                     /* Bytes read from the device */
+    uint64_t thsafe_write_bytes;                    /* Bytes written to the device */
+    uint64_t thsafe_ns;                             /* Sum of the round trips */
+    uint64_t thsafe_hist [DEVIO_METRICS_HIST_BUCKETS];
+} __attribute__ ((aligned (64)));
+
+/* Our structure */
+struct _devio_metrics_t {
+    char *name;                                     /* DEVIO name */
+    devio_metrics_node_t **nodes;                   /* One for each SMIO node, by
+                                                       slot. NULL if never used */
+    uint32_t nnodes;                                /* Number of slots allocated */
+};
+
+/* Metric of the nodes, rendered from the field at "offs" */
+typedef struct {
+    const char *name;
+    const char *type;
+    const char *help;
+    size_t offs;
+} devio_metrics_field_t;
+
+static const devio_metrics_field_t devio_metrics_node_fields [] = {
+    {"bpm_smio_requests_total", "counter", "Requests served by the SMIO",
+        offsetof (devio_metrics_node_t, requests)},
+    {"bpm_smio_request_errors_total", "counter", "Requests the SMIO could not handle",
+        offsetof (devio_metrics_node_t, request_errors)},
+    {"bpm_smio_request_bytes_total", "counter", "Bytes received in requests",
+        offsetof (devio_metrics_node_t, request_bytes)},
+    {"bpm_smio_requests_rejected_total", "counter", "Requests rejected, as "
+        "their sender had too many waiting", offsetof (devio_metrics_node_t, rejected)},
+    {"bpm_smio_writes_coalesced_total", "counter", "Writes superseded by a "
+        "newer one before being served", offsetof (devio_metrics_node_t, coalesced)},
+    {"bpm_smio_reads_shared_total", "counter", "Reads answered with the reply "
+        "of an identical one", offsetof (devio_metrics_node_t, shared)},
+    {"bpm_smio_queue_depth", "gauge", "Requests waiting to be served",
+        offsetof (devio_metrics_node_t, queue_depth)},
+    {"bpm_smio_queue_senders", "gauge", "Senders with requests waiting",
+        offsetof (devio_metrics_node_t, queue_senders)},
+    {"bpm_smio_thsafe_errors_total", "counter", "Failed register and block accesses",
+        offsetof (devio_metrics_node_t, thsafe_errors)},
+    {"bpm_smio_thsafe_read_bytes_total", "counter", "Bytes read from the device",
+        offsetof (devio_metrics_node_t, thsafe_read_bytes)},
+    {"bpm_smio_thsafe_write_bytes_total", "counter", "Bytes written to the device",
+        offsetof (devio_metrics_node_t, thsafe_write_bytes)},
+    {NULL, NULL, NULL, 0}
+};
+
+static const char *devio_metrics_thsafe_names [THSAFE_OPCODE_END] = {
+    [THSAFE_OPCODE_OPEN]                = THSAFE_NAME_OPEN,
+    [THSAFE_OPCODE_RELEASE]             = THSAFE_NAME_RELEASE,
+    [THSAFE_OPCODE_READ_16]             = THSAFE_NAME_READ_16,
+    [THSAFE_OPCODE_READ_32]             = THSAFE_NAME_READ_32,
+    [THSAFE_OPCODE_READ_64]             = THSAFE_NAME_READ_64,
+    [THSAFE_OPCODE_WRITE_16]            = THSAFE_NAME_WRITE_16,
+    [THSAFE_OPCODE_WRITE_32]            = THSAFE_NAME_WRITE_32,
+    [THSAFE_OPCODE_WRITE_64]            = THSAFE_NAME_WRITE_64,
+    [THSAFE_OPCODE_READ_BLOCK]          = THSAFE_NAME_READ_BLOCK,
+    [THSAFE_OPCODE_WRITE_BLOCK]         = THSAFE_NAME_WRITE_BLOCK,
+    [THSAFE_OPCODE_READ_DMA]            = THSAFE_NAME_READ_DMA,
+    [THSAFE_OPCODE_WRITE_DMA]           = THSAFE_NAME_WRITE_DMA,
+    [THSAFE_OPCODE_BATCH]               = THSAFE_NAME_BATCH,
+    [THSAFE_OPCODE_READ_BLOCKV]         = THSAFE_NAME_READ_BLOCKV
+};
+
+static uint32_t _devio_metrics_bucket (uint64_t ns);
+static void _devio_metrics_render_hist (devio_metrics_t *self, FILE *out,
+        const char *name, const char *help, size_t hist_offs, size_t sum_offs);
+
+/* Creates a new instance of the DEVIO metrics */
+devio_metrics_t *devio_metrics_new (const char *name)
+{
+    assert (name);
+
+    devio_metrics_t *self = (devio_metrics_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+    self->name = strdup (name);
+    ASSERT_ALLOC(self->name, err_name_alloc);
+
+    /* Nodes are allocated as the SMIOs come up */
+    return self;
+
+err_name_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy an instance of the DEVIO metrics */
+devio_err_e devio_metrics_destroy (devio_metrics_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        devio_metrics_t *self = *self_p;
+
+        uint32_t i;
+        for (i = 0; i < self->nnodes; ++i) {
+            free (self->nodes [i]);
+        }
+        free (self->nodes);
+        free (self->name);
+        free (self);
+        *self_p = NULL;
+    }
+
+    return DEVIO_SUCCESS;
+}
+
+devio_metrics_node_t *devio_metrics_node_get (devio_metrics_t *self,
+        uint32_t idx, const char *smio_key)
+{
+    assert (self);
+    assert (smio_key);
+
+    if (idx >= self->nnodes) {
+        uint32_t nnodes = (idx < 8) ? 8 : idx * 2;
+        devio_metrics_node_t **nodes = (devio_metrics_node_t **) realloc (
+                self->nodes, nnodes * sizeof (*nodes));
+        ASSERT_ALLOC(nodes, err_nodes_alloc);
+        memset (nodes + self->nnodes, 0, (nnodes - self->nnodes) * sizeof (*nodes));
+        self->nodes = nodes;
+        self->nnodes = nnodes;
+    }
+
+    /* Nodes are reused by the SMIOs coming up in the same slot */
+    if (self->nodes [idx] == NULL) {
+        int rc = posix_memalign ((void **) &self->nodes [idx],
+                __alignof__ (devio_metrics_node_t), sizeof (devio_metrics_node_t));
+        ASSERT_TEST(rc == 0, "Could not allocate metrics node", err_node_alloc);
+    }
+
+    /* The SMIO thread is not running yet */
+    devio_metrics_node_t *node = self->nodes [idx];
+    memset (node, 0, sizeof (*node));
+    snprintf (node->smio_key, sizeof (node->smio_key), "%s", smio_key);
+    node->active = true;
+
+    return node;
+
+err_node_alloc:
+    self->nodes [idx] = NULL;
+err_nodes_alloc:
+    return NULL;
+}
+
+void devio_metrics_node_release (devio_metrics_t *self, uint32_t idx)
+{
+    assert (self);
+
+    if (idx < self->nnodes && self->nodes [idx] != NULL) {
+        self->nodes [idx]->active = false;
+    }
+}
+
+void devio_metrics_node_request (devio_metrics_node_t *node, size_t bytes,
+        uint64_t elapsed_ns, bool is_err)
+{
+    assert (node);
+
+    DEVIO_METRICS_ADD(node->requests, 1);
+    if (is_err) {
+        DEVIO_METRICS_ADD(node->request_errors, 1);
+    }
+    DEVIO_METRICS_ADD(node->request_bytes, bytes);
+    DEVIO_METRICS_ADD(node->request_ns, elapsed_ns);
+    DEVIO_METRICS_ADD(node->request_hist [_devio_metrics_bucket (elapsed_ns)], 1);
+}
+
+void devio_metrics_node_rejected (devio_metrics_node_t *node)
+{
+    assert (node);
+    DEVIO_METRICS_ADD(node->rejected, 1);
+}
+
+void devio_metrics_node_coalesced (devio_metrics_node_t *node)
+{
+    assert (node);
+    DEVIO_METRICS_ADD(node->coalesced, 1);
+}
+
+void devio_metrics_node_shared (devio_metrics_node_t *node, size_t num)
+{
+    assert (node);
+    DEVIO_METRICS_ADD(node->shared, num);
+}
+
+void devio_metrics_node_thsafe (devio_metrics_node_t *node, bool is_write,
+        size_t bytes, uint64_t elapsed_ns, bool is_err)
+{
+    assert (node);
+
+    DEVIO_METRICS_ADD(node->thsafe, 1);
+    if (is_err) {
+        DEVIO_METRICS_ADD(node->thsafe_errors, 1);
+    }
+    if (is_write) {
+        DEVIO_METRICS_ADD(node->thsafe_write_bytes, bytes);
+    }
+    else {
+        DEVIO_METRICS_ADD(node->thsafe_read_bytes, bytes);
+    }
+    DEVIO_METRICS_ADD(node->thsafe_ns, elapsed_ns);
+    DEVIO_METRICS_ADD(node->thsafe_hist [_devio_metrics_bucket (elapsed_ns)], 1);
+}
+
+void devio_metrics_node_queue (devio_metrics_node_t *node,
+        const smio_queue_stats_t *stats)
+{
+    assert (node);
+    assert (stats);
+
+    DEVIO_METRICS_SET(node->queue_depth, stats->depth);
+    DEVIO_METRICS_SET(node->queue_senders, stats->senders);
+}
+
+char *devio_metrics_render (devio_metrics_t *self, msg_stats_t *thsafe_stats,
+        const llio_pcie_timeout_stats_t *pcie_stats)
+{
+    assert (self);
+
+    char *text = NULL;
+    size_t text_size = 0;
+    FILE *out = open_memstream (&text, &text_size);
+    ASSERT_ALLOC(out, err_out_alloc);
+
+    /* SMIO metrics */
+    const devio_metrics_field_t *field;
+    for (field = devio_metrics_node_fields; field->name != NULL; ++field) {
+        fprintf (out, "# HELP %s %s\n# TYPE %s %s\n", field->name, field->help,
+                field->name, field->type);
+
+        uint32_t i;
+        for (i = 0; i < self->nnodes; ++i) {
+            devio_metrics_node_t *node = self->nodes [i];
+            if (node == NULL || !node->active) {
+                continue;
+            }
+
+            uint64_t *value = (uint64_t *) ((char *) node + field->offs);
+            fprintf (out, "%s{devio=\"%s\",smio=\"%s\"} %"PRIu64"\n",
+                    field->name, self->name, node->smio_key,
+                    DEVIO_METRICS_GET(*value));
+        }
+    }
+
+    _devio_metrics_render_hist (self, out, "bpm_smio_request_seconds",
+            "Time to serve a request",
+            offsetof (devio_metrics_node_t, request_hist),
+            offsetof (devio_metrics_node_t, request_ns));
+    _devio_metrics_render_hist (self, out, "bpm_smio_thsafe_seconds",
+            "Round trip of a register or block access",
+            offsetof (devio_metrics_node_t, thsafe_hist),
+            offsetof (devio_metrics_node_t, thsafe_ns));
+
+    /* Thsafe operations, as served by the DEVIO. We are the owner of
+     * these, so they are read as is */
+    if (thsafe_stats != NULL) {
+        fprintf (out, "# HELP bpm_devio_thsafe_ops_total Register and block "
+                "accesses served\n# TYPE bpm_devio_thsafe_ops_total counter\n");
+        fprintf (out, "# HELP bpm_devio_thsafe_op_errors_total Register and block "
+                "accesses failed\n# TYPE bpm_devio_thsafe_op_errors_total counter\n");
+        fprintf (out, "# HELP bpm_devio_thsafe_op_seconds_total Time serving "
+                "register and block accesses\n"
+                "# TYPE bpm_devio_thsafe_op_seconds_total counter\n");
+
+        uint32_t opcode;
+        for (opcode = 0; opcode < THSAFE_OPCODE_END; ++opcode) {
+            const smio_op_stats_t *stats = msg_stats_get (thsafe_stats, opcode);
+            if (stats == NULL || stats->count == 0) {
+                continue;
+            }
+
+            const char *op = devio_metrics_thsafe_names [opcode];
+            fprintf (out, "bpm_devio_thsafe_ops_total{devio=\"%s\",op=\"%s\"} %"PRIu64"\n",
+                    self->name, op, stats->count);
+            fprintf (out, "bpm_devio_thsafe_op_errors_total{devio=\"%s\",op=\"%s\"} "
+                    "%"PRIu64"\n", self->name, op, stats->errors);
+            fprintf (out, "bpm_devio_thsafe_op_seconds_total{devio=\"%s\",op=\"%s\"} "
+                    "%.9f\n", self->name, op, stats->total_ns / 1e9);
+        }
+    }
+
+    if (pcie_stats != NULL) {
+        fprintf (out, "# HELP bpm_devio_pcie_timeouts_total Block accesses "
+                "timed out\n# TYPE bpm_devio_pcie_timeouts_total counter\n"
+                "bpm_devio_pcie_timeouts_total{devio=\"%s\"} %"PRIu64"\n",
+                self->name, pcie_stats->timeouts);
+        fprintf (out, "# HELP bpm_devio_pcie_timeout_chunks_total Chunks "
+                "retried after a timeout\n"
+                "# TYPE bpm_devio_pcie_timeout_chunks_total counter\n"
+                "bpm_devio_pcie_timeout_chunks_total{devio=\"%s\"} %"PRIu64"\n",
+                self->name, pcie_stats->chunks);
+        fprintf (out, "# HELP bpm_devio_pcie_timeout_recovered_total Chunks "
+                "read correctly after a timeout\n"
+                "# TYPE bpm_devio_pcie_timeout_recovered_total counter\n"
+                "bpm_devio_pcie_timeout_recovered_total{devio=\"%s\"} %"PRIu64"\n",
+                self->name, pcie_stats->recovered);
+        fprintf (out, "# HELP bpm_devio_pcie_timeout_failures_total Chunks "
+                "still timing out after all the tries\n"
+                "# TYPE bpm_devio_pcie_timeout_failures_total counter\n"
+                "bpm_devio_pcie_timeout_failures_total{devio=\"%s\"} %"PRIu64"\n",
+                self->name, pcie_stats->failures);
+    }
+
+    int rc = fclose (out);
+    ASSERT_TEST(rc == 0, "Could not render metrics", err_render);
+
+    return text;
+
+err_render:
+    free (text);
+err_out_alloc:
+    return NULL;
+}
+
+/************************************************************/
+/********************* Helper Functions *********************/
+/************************************************************/
+
+/* Buckets are decades, from DEVIO_METRICS_HIST_FIRST_NS up */
+static uint32_t _devio_metrics_bucket (uint64_t ns)
+{
+    uint32_t bucket = 0;
+    uint64_t bound = DEVIO_METRICS_HIST_FIRST_NS;
+    while (bucket < DEVIO_METRICS_HIST_BUCKETS-1 && ns > bound) {
+        ++bucket;
+        bound *= 10;
+    }
+
+    return bucket;
+}
+
+/* Render the histogram of the nodes at "hist_offs", with the sum of the
+ * values at "sum_offs" */
+static void _devio_metrics_render_hist (devio_metrics_t *self, FILE *out,
+        const char *name, const char *help, size_t hist_offs, size_t sum_offs)
+{
+    fprintf (out, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+
+    uint32_t i;
+    for (i = 0; i < self->nnodes; ++i) {
+        devio_metrics_node_t *node = self->nodes [i];
+        if (node == NULL || !node->active) {
+            continue;
+        }
+
+        /* Prometheus buckets are cumulative */
+        uint64_t *hist = (uint64_t *) ((char *) node + hist_offs);
+        uint64_t cumulative = 0;
+        uint64_t bound = DEVIO_METRICS_HIST_FIRST_NS;
+        uint32_t j;
+        for (j = 0; j < DEVIO_METRICS_HIST_BUCKETS; ++j) {
+            cumulative += DEVIO_METRICS_GET(hist [j]);
+            if (j < DEVIO_METRICS_HIST_BUCKETS-1) {
+                fprintf (out, "%s_bucket{devio=\"%s\",smio=\"%s\",le=\"%g\"} "
+                        "%"PRIu64"\n", name, self->name, node->smio_key,
+                        bound / 1e9, cumulative);
+                bound *= 10;
+            }
+            else {
+                fprintf (out, "%s_bucket{devio=\"%s\",smio=\"%s\",le=\"+Inf\"} "
+                        "%"PRIu64"\n", name, self->name, node->smio_key,
+                        cumulative);
+            }
+        }
+
+        uint64_t *sum = (uint64_t *) ((char *) node + sum_offs);
+        fprintf (out, "%s_sum{devio=\"%s\",smio=\"%s\"} %.9f\n", name,
+                self->name, node->smio_key, DEVIO_METRICS_GET(*sum) / 1e9);
+        /* The count must match the last bucket, so it is not read again */
+        fprintf (out, "%s_count{devio=\"%s\",smio=\"%s\"} %"PRIu64"\n", name,
+                self->name, node->smio_key, cumulative);
+    }
+}
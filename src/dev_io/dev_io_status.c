@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <sys/mman.h>
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...)  \
+    ASSERT_HAL_TEST(test_boolean, DEV_IO, "[dev_io_status]",    \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, DEV_IO, "[dev_io_status]",        \
+            devio_err_str(DEVIO_ERR_ALLOC),                 \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, DEV_IO, "[dev_io_status]",           \
+            devio_err_str (err_type))
+
+struct _devio_status_t {
+    char shm_name [SMIO_STATUS_SHM_NAME_MAX_LEN];   /* Shared memory object name */
+    smio_status_page_t *page;                       /* Mapped status page */
+};
+
+static uint64_t _devio_status_now_ns (void);
+
+/* Creates the status page of a DEVIO */
+devio_status_t *devio_status_new (const char *name)
+{
+    assert (name);
+
+    devio_status_t *self = (devio_status_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    int rc = snprintf (self->shm_name, sizeof (self->shm_name), "%s%s",
+            SMIO_STATUS_SHM_NAME_PREFIX, name);
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (self->shm_name),
+            "Shared memory name is too long", err_shm_name);
+
+    int fd = shm_open (self->shm_name, O_CREAT | O_RDWR, 0644);
+    ASSERT_TEST(fd >= 0, "Could not open shared memory object", err_shm_open);
+
+    /* Readers of a page left by a previous instance see it zeroed, until
+     * the SMIOs update it again */
+    rc = ftruncate (fd, 0);
+    ASSERT_TEST(rc == 0, "Could not reset shared memory size", err_shm_truncate);
+    rc = ftruncate (fd, sizeof (*self->page));
+    ASSERT_TEST(rc == 0, "Could not set shared memory size", err_shm_truncate);
+
+    void *page = mmap (NULL, sizeof (*self->page), PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    ASSERT_TEST(page != MAP_FAILED, "Could not map shared memory region",
+            err_shm_mmap);
+    /* The mapping stays valid after closing the descriptor */
+    close (fd);
+
+    self->page = (smio_status_page_t *) page;
+    self->page->version = SMIO_STATUS_VERSION;
+    self->page->size = sizeof (*self->page);
+    self->page->max_inst = SMIO_STATUS_MAX_INST;
+    self->page->start_time = _devio_status_now_ns ();
+    /* Readers check for the magic number to know the page is set up */
+    __atomic_store_n (&self->page->magic, SMIO_STATUS_MAGIC, __ATOMIC_RELEASE);
+
+    DBE_DEBUG (DBG_DEV_IO | DBG_LVL_INFO, "[dev_io_status] Status page %s "
+            "with %zu bytes created\n", self->shm_name, sizeof (*self->page));
+
+    return self;
+
+err_shm_mmap:
+err_shm_truncate:
+    close (fd);
+    shm_unlink (self->shm_name);
+err_shm_open:
+err_shm_name:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy the status page of a DEVIO */
+devio_err_e devio_status_destroy (devio_status_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        devio_status_t *self = *self_p;
+
+        munmap (self->page, sizeof (*self->page));
+        shm_unlink (self->shm_name);
+        free (self);
+        *self_p = NULL;
+    }
+
+    return DEVIO_SUCCESS;
+}
+
+smio_status_page_t *devio_status_get_page (devio_status_t *self)
+{
+    assert (self);
+    return self->page;
+}
+
+void devio_status_write_begin (smio_status_hdr_t *hdr)
+{
+    assert (hdr);
+
+    /* The section must not be written before readers can see it is odd */
+    uint32_t seq = __atomic_load_n (&hdr->seq, __ATOMIC_RELAXED);
+    __atomic_store_n (&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+void devio_status_write_end (smio_status_hdr_t *hdr)
+{
+    assert (hdr);
+
+    hdr->timestamp = _devio_status_now_ns ();
+    /* The section must be written before readers can see it is even */
+    uint32_t seq = __atomic_load_n (&hdr->seq, __ATOMIC_RELAXED);
+    __atomic_store_n (&hdr->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/***************** Static functions *****************/
+
+static uint64_t _devio_status_now_ns (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
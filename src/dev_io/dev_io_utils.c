@@ -50,3 +50,23 @@ devio_type_e devio_str_to_type (const char *type_str)
 
     return (ret == CONVC_TYPE_END)? INVALID_DEVIO: ret;
 }
+
+static const convc_types_t devio_prios_map [] = {
+    {.name = DEVIO_PRIO_HIGH_STR,       .type = DEVIO_PRIO_HIGH},
+    {.name = DEVIO_PRIO_NORMAL_STR,     .type = DEVIO_PRIO_NORMAL},
+    {.name = DEVIO_PRIO_LOW_STR,        .type = DEVIO_PRIO_LOW},
+    {.name = DEVIO_PRIO_INVALID_STR,    .type = DEVIO_PRIO_INVALID},
+    {.name = CONVC_TYPE_NAME_END,       .type = CONVC_TYPE_END}        /* End marker */
+};
+
+char *devio_prio_to_str (devio_prio_e prio)
+{
+    return convc_gen_type_to_str (prio, devio_prios_map);
+}
+
+devio_prio_e devio_str_to_prio (const char *prio_str)
+{
+    devio_prio_e ret = convc_str_to_gen_type (prio_str, devio_prios_map);
+
+    return (ret == CONVC_TYPE_END)? DEVIO_PRIO_INVALID: ret;
+}
@@ -5,6 +5,7 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+#include <poll.h>
 #include "bpm_server.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
@@ -36,6 +37,10 @@
 
 #define DFLT_LOG_DIR                "stdout"
 
+/* Devices and children are checked at this interval, or as soon as a
+ * device comes or goes, a child changes state or a DEVIO gets ready */
+#define DMNGR_MONITOR_INTERVAL      1           /* in s */
+
 static struct option long_options[] =
 {
     {"help",                no_argument,         NULL, 'h'},
@@ -45,6 +50,52 @@ static struct option long_options[] =
 
 static const char* shortopt = "hf:";
 
+/* PIDs of the DEVIOs that signalled DMNGR_READY_SIGNAL. The signal
+ * handler is the only writer of the head and the main loop the only one of
+ * the tail. The signal is a realtime one, so none is lost while another is
+ * being handled */
+#define DMNGR_READY_PIDS_LEN        64
+static pid_t _dmngr_ready_pids [DMNGR_READY_PIDS_LEN];
+static unsigned int _dmngr_ready_head = 0;
+static unsigned int _dmngr_ready_tail = 0;
+
+static void _dmngr_ready_h (int sig, siginfo_t *siginfo, void *context)
+{
+    (void) sig;
+    (void) context;
+
+    unsigned int head = __atomic_load_n (&_dmngr_ready_head, __ATOMIC_RELAXED);
+    /* Full. The DEVIO will be taken as running after the startup timeout */
+    if (head - __atomic_load_n (&_dmngr_ready_tail, __ATOMIC_ACQUIRE) >=
+            DMNGR_READY_PIDS_LEN) {
+        return;
+    }
+
+    _dmngr_ready_pids [head % DMNGR_READY_PIDS_LEN] = siginfo->si_pid;
+    __atomic_store_n (&_dmngr_ready_head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void _dmngr_handle_ready (dmngr_t *dmngr)
+{
+    unsigned int tail = _dmngr_ready_tail;
+    unsigned int head = __atomic_load_n (&_dmngr_ready_head, __ATOMIC_ACQUIRE);
+
+    for (; tail != head; ++tail) {
+        dmngr_devio_ready (dmngr, _dmngr_ready_pids [tail % DMNGR_READY_PIDS_LEN]);
+        __atomic_store_n (&_dmngr_ready_tail, tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* Nothing to do here. Catching SIGCHLD (without SA_RESTART) is enough to
+ * cut short the sleep of the monitoring loop, so dead children are reaped
+ * and respawned right away */
+static void _dmngr_sigchld_h (int sig, siginfo_t *siginfo, void *context)
+{
+    (void) sig;
+    (void) siginfo;
+    (void) context;
+}
+
 void print_help (char *program_name)
 {
     fprintf (stdout, "EBPM Device Manager\n"
@@ -243,6 +294,22 @@ int main (int argc, char *argv[])
     DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO,
             "[dev_mngr] spawn_broker set to \"%d\"\n", dmngr_spawn_broker_cfg);
 
+    /* Read the number of broker shards. Not an error if not found */
+    dmngr_broker_shards_str = zconfig_resolve (root_cfg, "/dev_mngr/broker/shards", NULL);
+    if (dmngr_broker_shards_str != NULL && !streq (dmngr_broker_shards_str, "")) {
+        char *endptr = NULL;
+        unsigned long shards = strtoul (dmngr_broker_shards_str, &endptr, 10);
+        if (*endptr != '\0' || shards == 0 || shards > UINT32_MAX) {
+            DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_FATAL, "[dev_mngr] Invalid option "
+                    "for broker shards configuration variable\n");
+            goto err_cfg_exit;
+        }
+        dmngr_broker_shards = (uint32_t) shards;
+    }
+
+    DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO,
+            "[dev_mngr] Broker shards set to \"%u\"\n", dmngr_broker_shards);
+
     /* Read DEVIO suggested bind endpoints and fill the hash table with
      * the corresponding keys */
     hutils_err_e herr = hutils_get_hints (root_cfg, dmngr_hints);
@@ -281,6 +348,12 @@ int main (int argc, char *argv[])
         goto err_dmngr_set_cfg_file;
     }
 
+    err = dmngr_set_broker_shards (dmngr, dmngr_broker_shards);
+    if (err != DMNGR_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_FATAL, "[dev_mngr] Fail set broker shards\n");
+        goto err_dmngr_set_broker_shards;
+    }
+
 #if 0
     dmngr_sig_handler_t dmngr_sigkill_handler =
     {   .signal = SIGKILL,
@@ -305,6 +378,31 @@ int main (int argc, char *argv[])
     dmngr_set_wait_clhd_handler (dmngr, &hutils_wait_chld);
     dmngr_set_spawn_clhd_handler (dmngr, &hutils_spawn_chld);
 
+    dmngr_sig_handler_t dmngr_sigchld_handler =
+    {   .signal = SIGCHLD,
+        .dmngr_sig_h = _dmngr_sigchld_h};
+
+    err = dmngr_set_sig_handler (dmngr, &dmngr_sigchld_handler);
+    if (err != DMNGR_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_FATAL, "[dev_mngr] dmngr_set_sig_handler error!\n");
+        goto err_sig_handlers;
+    }
+
+    /* DEVIOs tell us they are ready with DMNGR_READY_SIGNAL */
+    dmngr_sig_handler_t dmngr_ready_handler =
+    {   .signal = DMNGR_READY_SIGNAL,
+        .dmngr_sig_h = _dmngr_ready_h};
+
+    err = dmngr_set_sig_handler (dmngr, &dmngr_ready_handler);
+    if (err != DMNGR_SUCCESS) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_FATAL, "[dev_mngr] dmngr_set_sig_handler error!\n");
+        goto err_sig_handlers;
+    }
+
+    char dmngr_pid_str [16];
+    snprintf (dmngr_pid_str, sizeof (dmngr_pid_str), "%d", getpid ());
+    setenv (DMNGR_PID_ENV, dmngr_pid_str, 1);
+
     err = dmngr_register_sig_handlers (dmngr);
     if (err != DMNGR_SUCCESS) {
         DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_FATAL, "[dev_mngr] dmngr_register_sig_handler error!\n");
@@ -333,6 +431,14 @@ int main (int argc, char *argv[])
             }
         }
 
+        /* Not fatal. Clients can still find the SMIOs one by one, and we
+         * try again on the next round */
+        err = dmngr_start_dir (dmngr, dmngr_broker_endp);
+        if (err != DMNGR_SUCCESS) {
+            DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_WARN, "[dev_mngr] Could not start "
+                    "directory. Retrying later\n");
+        }
+
         /* Search for new devices */
         err = dmngr_scan_devs (dmngr, NULL);
         if (err != DMNGR_SUCCESS) {
@@ -358,8 +464,22 @@ int main (int argc, char *argv[])
             goto err_wait_chld;
         }
 
-        /* Do some monitoring activities */
-        sleep(1);
+        /* Do some monitoring activities. Interrupted by SIGCHLD and
+         * DMNGR_READY_SIGNAL. SIGCHLD might come right before poll (),
+         * so exits are watched on the pidfds as well. Negative fds are
+         * ignored by poll () */
+        struct pollfd pollfds [] = {
+            {.fd = dmngr_get_devs_fd (dmngr), .events = POLLIN},
+            {.fd = dmngr_get_chld_fd (dmngr), .events = POLLIN}};
+        if (poll (pollfds, 2, DMNGR_MONITOR_INTERVAL*1000) > 0) {
+            if (pollfds [0].revents & POLLIN) {
+                dmngr_handle_devs_events (dmngr);
+            }
+            if (pollfds [1].revents & POLLIN) {
+                dmngr_handle_chld_events (dmngr);
+            }
+        }
+        _dmngr_handle_ready (dmngr);
     }
 
     DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_FATAL, "[dev_mngr] Monitoring loop interrupted!\n");
@@ -369,6 +489,7 @@ err_spawn_devios:
 err_scan_devs:
 err_spawn_broker:
 err_sig_handlers:
+err_dmngr_set_broker_shards:
     dmngr_destroy (&dmngr);
 err_dmngr_set_cfg_file:
 err_dmngr_alloc:
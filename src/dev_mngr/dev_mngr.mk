@@ -5,7 +5,8 @@ dev_mngr_DIR = $(SRC_DIR)/dev_mngr
 # makefile
 dev_mngr_core_OBJS = $(dev_mngr_DIR)/dev_mngr_core.o \
 		     $(dev_mngr_DIR)/dev_mngr_err.o \
-		     $(dev_mngr_DIR)/dev_mngr_dev_info.o
+		     $(dev_mngr_DIR)/dev_mngr_dev_info.o \
+		     $(dev_mngr_DIR)/dev_mngr_dir.o
 
 # Compile Digital Back-End DEVIO
 ifeq ($(WITH_DEV_MNGR),y)
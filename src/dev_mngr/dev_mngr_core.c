@@ -6,6 +6,8 @@
  */
 
 #include <glob.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include "bpm_server.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
@@ -37,8 +39,15 @@
 
 #define DEVIO_DEV_NAME_LEN          40
 
-#define DEVIO_BE_DEV_PATTERN        "/dev/fpga/%d"
-#define DEVIO_BE_DEV_GLOB           "/dev/fpga/*"
+#define DEVIO_BE_DEV_DIR            "/dev/fpga"
+#define DEVIO_BE_DEV_PATTERN        DEVIO_BE_DEV_DIR"/%d"
+#define DEVIO_BE_DEV_GLOB           DEVIO_BE_DEV_DIR"/*"
+/* Enough for a few events at a time. The rest is read in the next calls */
+#define DMNGR_DEVS_EVENTS_LEN       4096
+/* Exited children handled per epoll_wait (). The rest is left for the
+ * next calls */
+#define DMNGR_CHLD_EVENTS_LEN       16
+#define DMNGR_PID_KEY_LEN           16
 
 #define DEVIO_NAME                  "dev_io"
 
@@ -66,6 +75,12 @@
 #define DEVIO_MLM_CFG_DIR           "/etc/malamute"
 #define DEVIO_MLM_CFG_FILENAME      "malamute.cfg"
 
+/* Bound on the number of DEVIOs starting up at the same time. Each one
+ * brings up its SMIOs in parallel already */
+#define DMNGR_MAX_STARTING_DEVIOS   4
+/* DEVIOs not reporting ready by then are taken as running anyway */
+#define DMNGR_DEVIO_STARTUP_TIMEOUT 30000       /* in ms */
+
 struct _dmngr_t {
     /* General information */
     zsock_t *dealer;            /* zeroMQ Dealer socket */
@@ -79,10 +94,22 @@ struct _dmngr_t {
 
     /* zeroMQ broker management */
     bool broker_running;        /* true if broker is already running */
+    uint32_t broker_shards;     /* Number of broker shards */
+    zlistx_t *brokers;          /* Broker shards run by us (zactor_t) */
+    dmngr_dir_t *dir;           /* Directory of DEVIOs and SMIOs. NULL until
+                                   dmngr_start_dir () */
 
     /* Device managment */
+    int devs_fd;                /* inotify instance watching DEVIO_BE_DEV_DIR */
+    int devs_wd;                /* Watch of DEVIO_BE_DEV_DIR. -1 if not watching */
     zhashx_t *devio_info_h;
     zhashx_t *hints_h;           /* Config hints from configuration file */
+
+    /* Child process supervision */
+    int chld_fd;                /* epoll instance watching the pidfd of each
+                                   DEVIO. -1 if children cannot be watched */
+    zhashx_t *chld_pidfds;      /* pidfd of each DEVIO. It is composed of
+                                   key (PID) / value (int *) */
 };
 
 /* Configuration variables. To be filled by dev_mngr */
@@ -96,8 +123,20 @@ int dmngr_daemonize = 0;
 char *dmngr_work_dir = NULL;
 char *dmngr_spawn_broker_cfg_str = NULL;
 int dmngr_spawn_broker_cfg = 0;
+char *dmngr_broker_shards_str = NULL;
+uint32_t dmngr_broker_shards = 1;
 
 static void _devio_hash_free_item (void **data);
+static void _dmngr_pidfd_free_item (void **data);
+static void _dmngr_watch_chld (dmngr_t *self, pid_t pid);
+static void _dmngr_unwatch_chld (dmngr_t *self, pid_t pid);
+static devio_info_t *_dmngr_lookup_devio_pid (dmngr_t *self, pid_t pid);
+static unsigned int _dmngr_count_starting (dmngr_t *self);
+static void _dmngr_watch_devs (dmngr_t *self);
+static dmngr_err_e _dmngr_spawn_broker_shards (dmngr_t *self, char *broker_endp);
+static void _dmngr_remove_dev (dmngr_t *self, const char *dev_name);
+static void _dmngr_dir_update (dmngr_t *self, devio_info_t *devio_info,
+        pid_t pid);
 static dmngr_err_e _dmngr_scan_devs (dmngr_t *self, uint32_t *num_devs_found);
 static dmngr_err_e _dmngr_prepare_devio (dmngr_t *self, const char *key,
         char *dev_pathname, uint32_t id, llio_type_e type,
@@ -153,6 +192,10 @@ dmngr_t * dmngr_new (char *name, char *endpoint, int verbose,
     ASSERT_ALLOC(self->hints_h, err_hints_h_alloc);
 
     self->broker_running = false;
+    self->broker_shards = 1;
+    self->brokers = zlistx_new ();
+    ASSERT_ALLOC(self->brokers, err_brokers_alloc);
+    zlistx_set_destructor (self->brokers, (zlistx_destructor_fn *) zactor_destroy);
 
     /* Create Dealer for use with zbeacon and bind it to the endpoint */
     self->dealer = zsock_new_dealer (NULL);
@@ -161,6 +204,31 @@ dmngr_t * dmngr_new (char *name, char *endpoint, int verbose,
     ASSERT_TEST(rc > -1, "Dealer socket could not bind to specified endpoint",
             err_dealer_bind);
 
+    /* Watch the boards coming and going, before the first scan so none is
+     * missed. Without it, new boards are still found by the periodic scans,
+     * but removed ones are not noticed */
+    self->devs_wd = -1;
+    self->devs_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (self->devs_fd < 0) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_WARN, "[dev_mngr_core] Could not "
+                "create inotify instance: %s. Device removal will not be "
+                "detected\n", strerror (errno));
+    }
+    _dmngr_watch_devs (self);
+
+    /* Watch the DEVIOs exiting, so they are reaped as soon as they do.
+     * Without it, they are still reaped on SIGCHLD and by the periodic
+     * monitoring */
+    self->chld_pidfds = zhashx_new ();
+    ASSERT_ALLOC(self->chld_pidfds, err_chld_pidfds_alloc);
+    zhashx_set_destructor (self->chld_pidfds, _dmngr_pidfd_free_item);
+    self->chld_fd = epoll_create1 (EPOLL_CLOEXEC);
+    if (self->chld_fd < 0) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_WARN, "[dev_mngr_core] Could not "
+                "create epoll instance: %s. DEVIO exits will be noticed on "
+                "SIGCHLD only\n", strerror (errno));
+    }
+
     /* Scan devios for the first time */
     uint32_t num_devs_found = 0;
     dmngr_err_e err = _dmngr_scan_devs (self, &num_devs_found);
@@ -174,10 +242,21 @@ dmngr_t * dmngr_new (char *name, char *endpoint, int verbose,
     return self;
 
 err_scan_devs:
+    if (self->chld_fd >= 0) {
+        close (self->chld_fd);
+    }
+    zhashx_destroy (&self->chld_pidfds);
+err_chld_pidfds_alloc:
+    if (self->devs_fd >= 0) {
+        close (self->devs_fd);
+    }
     zsock_unbind (self->dealer, "%s", endpoint);
 err_dealer_bind:
     zsock_destroy (&self->dealer);
 err_dealer_alloc:
+    zlistx_destroy (&self->brokers);
+err_brokers_alloc:
+    zhashx_destroy (&self->hints_h);
 err_hints_h_alloc:
     zhashx_destroy (&self->devio_info_h);
 err_devio_info_h_alloc:
@@ -203,8 +282,18 @@ dmngr_err_e dmngr_destroy (dmngr_t **self_p)
         dmngr_t *self = *self_p;
 
         /* Starting destructing by the last resource */
+        if (self->chld_fd >= 0) {
+            close (self->chld_fd);
+        }
+        zhashx_destroy (&self->chld_pidfds);
+        if (self->devs_fd >= 0) {
+            close (self->devs_fd);
+        }
         zsock_unbind (self->dealer, "%s", self->endpoint);
         zsock_destroy (&self->dealer);
+        /* Before the brokers it is connected to */
+        dmngr_dir_destroy (&self->dir);
+        zlistx_destroy (&self->brokers);
         zhashx_destroy (&self->hints_h);
         zhashx_destroy (&self->devio_info_h);
         zlistx_destroy (&self->ops->sig_ops);
@@ -273,12 +362,50 @@ dmngr_err_e dmngr_set_wait_clhd_handler (dmngr_t *self, wait_chld_handler_fp fp)
     return DMNGR_SUCCESS;
 }
 
-static dmngr_err_e _dmngr_wait_chld (dmngr_t *self)
-    DMNGR_FUNC_WRAPPER(dmngr_wait_chld, DMNGR_ERR_WAITCHLD)
-
 dmngr_err_e dmngr_wait_chld (dmngr_t *self)
 {
-    return _dmngr_wait_chld (self);
+    assert (self);
+    CHECK_ERR(((self->ops->dmngr_wait_chld == NULL) ? -1 : 0),
+        DMNGR_ERR_FUNC_NOT_IMPL);
+
+    /* Reap all of the children that exited, so they can be respawned */
+    int pid;
+    while ((pid = self->ops->dmngr_wait_chld ()) > 0) {
+        _dmngr_unwatch_chld (self, pid);
+
+        devio_info_t *devio_info = _dmngr_lookup_devio_pid (self, pid);
+        if (devio_info == NULL) {
+            continue;
+        }
+
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_WARN, "[dev_mngr_core] DEVIO of %s, "
+                "PID %d, exited\n", devio_info_get_dev_pathname (devio_info), pid);
+        devio_info_set_state (devio_info, KILLED);
+        /* The SMIOs of the old PID are gone from the directory */
+        _dmngr_dir_update (self, devio_info, pid);
+        devio_info_set_pid (devio_info, 0);
+    }
+    CHECK_ERR (pid, DMNGR_ERR_WAITCHLD);
+
+    return DMNGR_SUCCESS;
+}
+
+dmngr_err_e dmngr_devio_ready (dmngr_t *self, pid_t pid)
+{
+    assert (self);
+
+    devio_info_t *devio_info = _dmngr_lookup_devio_pid (self, pid);
+    if (devio_info == NULL || devio_info_get_state (devio_info) != STARTING) {
+        return DMNGR_ERR_INCOMP_STATE;
+    }
+
+    DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO, "[dev_mngr_core] DEVIO of %s up "
+            "in %"PRId64" ms\n", devio_info_get_dev_pathname (devio_info),
+            zclock_mono () - devio_info_get_spawn_time (devio_info));
+    devio_info_set_state (devio_info, RUNNING);
+    _dmngr_dir_update (self, devio_info, pid);
+
+    return DMNGR_SUCCESS;
 }
 
 dmngr_err_e dmngr_set_spawn_clhd_handler (dmngr_t *self, spawn_chld_handler_fp fp)
@@ -354,6 +481,23 @@ bool dmngr_is_broker_running (dmngr_t *self)
     return _dmngr_is_broker_running (self);
 }
 
+dmngr_err_e dmngr_set_broker_shards (dmngr_t *self, uint32_t num_shards)
+{
+    assert (self);
+
+    dmngr_err_e err = DMNGR_SUCCESS;
+    ASSERT_TEST(num_shards > 0, "Invalid number of broker shards", err_inv_shards,
+            DMNGR_ERR_CFG);
+    ASSERT_TEST(!self->broker_running, "Broker is already running", err_broker_run,
+            DMNGR_ERR_BROK_RUNN);
+
+    self->broker_shards = num_shards;
+
+err_broker_run:
+err_inv_shards:
+    return err;
+}
+
 dmngr_err_e dmngr_spawn_broker (dmngr_t *self, char *broker_endp)
 {
     (void) broker_endp;
@@ -373,6 +517,16 @@ dmngr_err_e dmngr_spawn_broker (dmngr_t *self, char *broker_endp)
 
     DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_TRACE, "[dev_mngr_core] Spawning Broker ...\n");
 
+    /* One broker thread each, so the shards do not share a CPU */
+    if (self->broker_shards > 1) {
+        err = _dmngr_spawn_broker_shards (self, broker_endp);
+        ASSERT_TEST(err == DMNGR_SUCCESS, "Could not spawn broker shards",
+                err_spawn_broker);
+
+        self->broker_running = true;
+        goto err_broker_run;
+    }
+
     /* Specify if broker is to be run in verbose mode or not */
     char *argv_exec[] = {"malamute", "-f", DEVIO_MLM_PREFIX_CFG_DIR ""
         DEVIO_MLM_CFG_DIR"/"DEVIO_MLM_CFG_FILENAME, NULL};
@@ -390,11 +544,100 @@ err_broker_run:
     return err;
 }
 
+dmngr_err_e dmngr_start_dir (dmngr_t *self, char *broker_endp)
+{
+    assert (self);
+    assert (broker_endp);
+
+    dmngr_err_e err = DMNGR_SUCCESS;
+
+    /* This is not an error */
+    if (self->dir != NULL) {
+        goto err_dir_running;
+    }
+
+    self->dir = dmngr_dir_new (broker_endp, self->broker_shards);
+    ASSERT_TEST(self->dir != NULL, "Could not start directory",
+            err_dir_alloc, DMNGR_ERR_ALLOC);
+
+    /* The DEVIOs found so far */
+    devio_info_t *devio_info = zhashx_first (self->devio_info_h);
+    for (; devio_info != NULL; devio_info = zhashx_next (self->devio_info_h)) {
+        _dmngr_dir_update (self, devio_info, devio_info_get_pid (devio_info));
+    }
+
+err_dir_alloc:
+err_dir_running:
+    return err;
+}
+
 dmngr_err_e dmngr_scan_devs (dmngr_t *self, uint32_t *num_devs_found)
 {
     return _dmngr_scan_devs (self, num_devs_found);
 }
 
+int dmngr_get_devs_fd (dmngr_t *self)
+{
+    assert (self);
+    return self->devs_fd;
+}
+
+int dmngr_get_chld_fd (dmngr_t *self)
+{
+    assert (self);
+    return self->chld_fd;
+}
+
+dmngr_err_e dmngr_handle_chld_events (dmngr_t *self)
+{
+    assert (self);
+
+    if (self->chld_fd >= 0) {
+        /* The pidfds stay readable until their children are reaped below,
+         * so the events only need to be consumed */
+        struct epoll_event events [DMNGR_CHLD_EVENTS_LEN];
+        while (epoll_wait (self->chld_fd, events, DMNGR_CHLD_EVENTS_LEN, 0) ==
+                DMNGR_CHLD_EVENTS_LEN);
+    }
+
+    return dmngr_wait_chld (self);
+}
+
+dmngr_err_e dmngr_handle_devs_events (dmngr_t *self)
+{
+    assert (self);
+
+    if (self->devs_fd < 0) {
+        return DMNGR_SUCCESS;
+    }
+
+    char events [DMNGR_DEVS_EVENTS_LEN]
+        __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    ssize_t len;
+
+    while ((len = read (self->devs_fd, events, sizeof (events))) > 0) {
+        char *p = events;
+        for (; p < events + len; p += sizeof (struct inotify_event) +
+                ((struct inotify_event *) p)->len) {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+
+            /* The directory itself went away. Watch it again when it is
+             * back, on the next scans */
+            if (event->mask & IN_IGNORED) {
+                self->devs_wd = -1;
+                continue;
+            }
+
+            if (event->len > 0 && (event->mask & (IN_DELETE | IN_MOVED_FROM))) {
+                _dmngr_remove_dev (self, event->name);
+            }
+            /* New devices are picked up by the next dmngr_scan_devs () */
+        }
+    }
+
+    return DMNGR_SUCCESS;
+}
+
 dmngr_err_e dmngr_spawn_all_devios (dmngr_t *self, char *broker_endp,
         char *devio_log_prefix, bool respawn_killed_devio)
 {
@@ -416,6 +659,7 @@ dmngr_err_e dmngr_spawn_all_devios (dmngr_t *self, char *broker_endp,
     ASSERT_ALLOC (devio_info_key_list, err_hash_keys_alloc, DMNGR_ERR_ALLOC);
 
     char *devio_info_key = zlistx_first (devio_info_key_list);
+    unsigned int num_starting = _dmngr_count_starting (self);
 
     /* Iterate over all keys spawning the DEVIOs */
     for (; devio_info_key != NULL; devio_info_key = zlistx_next (devio_info_key_list)) {
@@ -455,6 +699,11 @@ dmngr_err_e dmngr_spawn_all_devios (dmngr_t *self, char *broker_endp,
             continue;
         }
 
+        /* Leave it for the next call if too many DEVIOs are starting up */
+        if (num_starting >= DMNGR_MAX_STARTING_DEVIOS) {
+            continue;
+        }
+
         /* Get DEVIO type to set-up correct log filename */
         devio_type_c = devio_type_to_str (devio_type);
         ASSERT_ALLOC (devio_type_c, err_devio_type_c_alloc, DMNGR_ERR_ALLOC);
@@ -473,10 +722,16 @@ dmngr_err_e dmngr_spawn_all_devios (dmngr_t *self, char *broker_endp,
                 " for a %s device \n\tlocated on %s, ID %u, broker address %s, with "
                 "logfile on %s ...\n", dev_type_c, dev_pathname, id,
                 broker_endp, devio_log_prefix);
+        char *devio_broker_endp = hutils_broker_shard_endp (broker_endp,
+                hutils_broker_shard (id, self->broker_shards));
+        ASSERT_ALLOC (devio_broker_endp, err_devio_broker_endp_alloc, DMNGR_ERR_ALLOC);
         char *argv_exec [] = {DEVIO_NAME, "-f", cfg_file, "-n", devio_type_c,"-t", dev_type_c,
             "-i", dev_id_c, "-e", dev_pathname, "-s", smio_inst_id_c,
-            "-b", broker_endp, "-l", devio_log_prefix, NULL};
-        int spawn_err = _dmngr_spawn_chld (self, DEVIO_NAME, argv_exec);
+            "-b", devio_broker_endp, "-l", devio_log_prefix, NULL};
+        /* Call the spawn handler directly, as we need the PID back */
+        int pid = (self->ops->dmngr_spawn_chld == NULL) ? -1 :
+            self->ops->dmngr_spawn_chld (DEVIO_NAME, argv_exec);
+        free (devio_broker_endp);
 
         free (dev_type_c);
         dev_type_c = NULL;
@@ -489,14 +744,20 @@ dmngr_err_e dmngr_spawn_all_devios (dmngr_t *self, char *broker_endp,
         free (dev_pathname);
         dev_pathname = NULL;
         /* Just fail miserably, for now */
-        ASSERT_TEST(spawn_err == 0, "Could not spawn DEVIO instance",
+        ASSERT_TEST(pid > 0, "Could not spawn DEVIO instance",
                 err_spawn, DMNGR_ERR_SPAWNCHLD);
 
-        state = RUNNING;
+        /* Running for real once it tells us so (dmngr_devio_ready ()) */
+        state = STARTING;
         devio_info_set_state (devio_info, state);
+        devio_info_set_pid (devio_info, pid);
+        _dmngr_dir_update (self, devio_info, pid);
+        _dmngr_watch_chld (self, pid);
+        ++num_starting;
     }
 
 err_spawn:
+err_devio_broker_endp_alloc:
     free (smio_inst_id_c);
 err_smio_inst_id_c_alloc:
     free (dev_id_c);
@@ -519,6 +780,154 @@ static void _devio_hash_free_item (void **data)
     devio_info_destroy ((devio_info_t **) data);
 }
 
+/* Hash free function. Closing the pidfd removes it from the epoll
+ * instance as well */
+static void _dmngr_pidfd_free_item (void **data)
+{
+    int *pidfd = (int *) *data;
+    close (*pidfd);
+    free (pidfd);
+    *data = NULL;
+}
+
+/* Add the pidfd of "pid" to the epoll instance */
+static void _dmngr_watch_chld (dmngr_t *self, pid_t pid)
+{
+    if (self->chld_fd < 0) {
+        return;
+    }
+
+    int *pidfd = (int *) zmalloc (sizeof *pidfd);
+    ASSERT_ALLOC(pidfd, err_pidfd_alloc);
+    *pidfd = hutils_pidfd_open (pid);
+    ASSERT_TEST(*pidfd >= 0, "Could not open pidfd. The child exit will be "
+            "noticed on SIGCHLD only", err_pidfd_open);
+
+    struct epoll_event event = {.events = EPOLLIN};
+    int rc = epoll_ctl (self->chld_fd, EPOLL_CTL_ADD, *pidfd, &event);
+    ASSERT_TEST(rc == 0, "Could not watch pidfd", err_epoll_ctl);
+
+    char key [DMNGR_PID_KEY_LEN];
+    snprintf (key, sizeof (key), "%d", pid);
+    rc = zhashx_insert (self->chld_pidfds, key, pidfd);
+    ASSERT_TEST(rc == 0, "Could not insert pidfd into hash", err_hash_insert);
+
+    return;
+
+err_hash_insert:
+err_epoll_ctl:
+    close (*pidfd);
+err_pidfd_open:
+    free (pidfd);
+err_pidfd_alloc:
+    return;
+}
+
+/* Stop watching "pid", once it is reaped */
+static void _dmngr_unwatch_chld (dmngr_t *self, pid_t pid)
+{
+    char key [DMNGR_PID_KEY_LEN];
+    snprintf (key, sizeof (key), "%d", pid);
+    zhashx_delete (self->chld_pidfds, key);
+}
+
+static devio_info_t *_dmngr_lookup_devio_pid (dmngr_t *self, pid_t pid)
+{
+    devio_info_t *devio_info = zhashx_first (self->devio_info_h);
+
+    for (; devio_info != NULL; devio_info = zhashx_next (self->devio_info_h)) {
+        if (devio_info_get_pid (devio_info) == pid) {
+            break;
+        }
+    }
+
+    return devio_info;
+}
+
+/* Number of DEVIOs starting up. The ones that are taking too long to tell
+ * us they are ready are taken as running */
+static unsigned int _dmngr_count_starting (dmngr_t *self)
+{
+    unsigned int num_starting = 0;
+    int64_t now = zclock_mono ();
+    devio_info_t *devio_info = zhashx_first (self->devio_info_h);
+
+    for (; devio_info != NULL; devio_info = zhashx_next (self->devio_info_h)) {
+        if (devio_info_get_state (devio_info) != STARTING) {
+            continue;
+        }
+
+        if (now - devio_info_get_spawn_time (devio_info) >= DMNGR_DEVIO_STARTUP_TIMEOUT) {
+            DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_WARN, "[dev_mngr_core] DEVIO of %s "
+                    "did not report ready. Taking it as running\n",
+                    devio_info_get_dev_pathname (devio_info));
+            devio_info_set_state (devio_info, RUNNING);
+            _dmngr_dir_update (self, devio_info, devio_info_get_pid (devio_info));
+            continue;
+        }
+
+        ++num_starting;
+    }
+
+    return num_starting;
+}
+
+static void _dmngr_watch_devs (dmngr_t *self)
+{
+    if (self->devs_fd < 0 || self->devs_wd >= 0) {
+        return;
+    }
+
+    self->devs_wd = inotify_add_watch (self->devs_fd, DEVIO_BE_DEV_DIR,
+            IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM);
+    if (self->devs_wd >= 0) {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO, "[dev_mngr_core] Watching "
+                "%s for devices\n", DEVIO_BE_DEV_DIR);
+    }
+}
+
+/* Stop the DEVIO of a device that is gone and forget about the device. It
+ * is found again as a new one when it comes back */
+static void _dmngr_remove_dev (dmngr_t *self, const char *dev_name)
+{
+    char dev_pathname [DEVIO_DEV_NAME_LEN];
+    snprintf (dev_pathname, sizeof (dev_pathname), "%s/%s", DEVIO_BE_DEV_DIR,
+            dev_name);
+
+    uint32_t devio_info_id;
+    if (sscanf (dev_pathname, DEVIO_BE_DEV_PATTERN, &devio_info_id) != 1) {
+        return;
+    }
+
+    char key [HUTILS_CFG_HASH_KEY_MAX_LEN];
+    int errs = snprintf (key, sizeof (key), HUTILS_CFG_HASH_KEY_PATTERN_COMPL,
+            devio_info_id, /* BPM ID does not matter for DBE DEVIOs */ 0);
+    if (errs < 0 || (size_t) errs >= sizeof (key)) {
+        return;
+    }
+
+    devio_info_t *devio_info = zhashx_lookup (self->devio_info_h, key);
+    if (devio_info == NULL) {
+        return;
+    }
+
+    DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO, "[dev_mngr_core] Device %s "
+            "removed\n", dev_pathname);
+
+    /* Its exit is reaped by dmngr_wait_chld () as any other */
+    pid_t pid = devio_info_get_pid (devio_info);
+    devio_state_e state = devio_info_get_state (devio_info);
+    if (pid > 0 && (state == STARTING || state == RUNNING)) {
+        kill (pid, SIGTERM);
+    }
+
+    if (self->dir != NULL) {
+        dmngr_dir_remove_devio (self->dir, devio_info_get_id (devio_info),
+                devio_info_get_smio_inst_id (devio_info));
+    }
+    zhashx_delete (self->devio_info_h, key);
+}
+
 static dmngr_err_e _dmngr_scan_devs (dmngr_t *self, uint32_t *num_devs_found)
 {
     assert (self);
@@ -526,6 +935,9 @@ static dmngr_err_e _dmngr_scan_devs (dmngr_t *self, uint32_t *num_devs_found)
     dmngr_err_e err = DMNGR_SUCCESS;
     glob_t glob_dev;
 
+    /* The directory might have been created just now */
+    _dmngr_watch_devs (self);
+
     /* Scan just the PCIe bus for now. We expect to find devices of
      * the form: /dev/fpga0 .. /dev/fpga5 */
     glob (DEVIO_BE_DEV_GLOB, 0, NULL, &glob_dev);
@@ -604,8 +1016,70 @@ static dmngr_err_e _dmngr_prepare_devio (dmngr_t *self, const char *key,
     DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO,
             "[dev_mngr_core:prepare_devio] Inserting device with key: %s\n", key);
     zhashx_insert (self->devio_info_h, key, devio_info);
+    _dmngr_dir_update (self, devio_info, 0);
 
 err_devio_info_alloc:
     return err;
 }
 
+/* Tell the directory about a DEVIO state change. "pid" is the PID of its
+ * process, or of the one that just exited */
+static void _dmngr_dir_update (dmngr_t *self, devio_info_t *devio_info,
+        pid_t pid)
+{
+    if (self->dir == NULL) {
+        return;
+    }
+
+    uint32_t state = SMIO_DIR_DEVIO_READY_TO_RUN;
+    switch (devio_info_get_state (devio_info)) {
+        case STARTING:
+            state = SMIO_DIR_DEVIO_STARTING;
+            break;
+        case RUNNING:
+            state = SMIO_DIR_DEVIO_RUNNING;
+            break;
+        case STOPPED:
+            state = SMIO_DIR_DEVIO_STOPPED;
+            break;
+        case KILLED:
+            state = SMIO_DIR_DEVIO_KILLED;
+            break;
+        default:
+            break;
+    }
+
+    dmngr_dir_set_devio (self->dir, devio_info_get_id (devio_info),
+            devio_info_get_smio_inst_id (devio_info), state, pid);
+}
+
+/* Run every broker shard as a broker thread of our own */
+static dmngr_err_e _dmngr_spawn_broker_shards (dmngr_t *self, char *broker_endp)
+{
+    dmngr_err_e err = DMNGR_SUCCESS;
+    char *shard_endp = NULL;
+
+    for (uint32_t shard = 0; shard < self->broker_shards; ++shard) {
+        shard_endp = hutils_broker_shard_endp (broker_endp, shard);
+        ASSERT_ALLOC(shard_endp, err_shard_endp_alloc, DMNGR_ERR_ALLOC);
+
+        zactor_t *broker = zactor_new (mlm_server, "Malamute");
+        ASSERT_TEST(broker != NULL, "Could not spawn broker shard",
+                err_broker_alloc, DMNGR_ERR_SPAWNCHLD);
+        zstr_sendx (broker, "BIND", shard_endp, NULL);
+        zlistx_add_end (self->brokers, broker);
+
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO, "[dev_mngr_core] Broker shard "
+                "%u bound to %s\n", shard, shard_endp);
+        free (shard_endp);
+        shard_endp = NULL;
+    }
+
+    return err;
+
+err_broker_alloc:
+    free (shard_endp);
+err_shard_endp_alloc:
+    zlistx_purge (self->brokers);
+    return err;
+}
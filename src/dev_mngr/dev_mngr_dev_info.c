@@ -38,6 +38,8 @@ struct _devio_info_t {
                                            with a single SMIO */
     char *dev_pathname;                 /* /dev pathname */
     devio_state_e state;                /* Device IO state */
+    pid_t pid;                          /* PID of the DEVIO process */
+    int64_t spawn_time;                 /* When the DEVIO process was spawned, in ms */
 };
 
 /* Creates a new instance of the Device Manager */
@@ -222,3 +224,25 @@ devio_state_e devio_info_get_state (devio_info_t *self)
     assert (self);
     return self->state;
 }
+
+dmngr_err_e devio_info_set_pid (devio_info_t *self, pid_t pid)
+{
+    assert (self);
+
+    self->pid = pid;
+    self->spawn_time = zclock_mono ();
+
+    return DMNGR_SUCCESS;
+}
+
+pid_t devio_info_get_pid (devio_info_t *self)
+{
+    assert (self);
+    return self->pid;
+}
+
+int64_t devio_info_get_spawn_time (devio_info_t *self)
+{
+    assert (self);
+    return self->spawn_time;
+}
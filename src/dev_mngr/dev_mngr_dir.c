@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...)  \
+    ASSERT_HAL_TEST(test_boolean, DEV_MNGR, "[dev_mngr_dir]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)   \
+    ASSERT_HAL_ALLOC(ptr, DEV_MNGR, "[dev_mngr_dir]",           \
+            dmngr_err_str(DMNGR_ERR_ALLOC),                     \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                \
+    CHECK_HAL_ERR(err, DEV_MNGR, "[dev_mngr_dir]",              \
+            dmngr_err_str (err_type))
+
+#define DMNGR_DIR_CONNECT_TIMEOUT   1000        /* in ms */
+
+/* Commands to the actor */
+#define DMNGR_DIR_CMD_DEVIO         "DEVIO"
+#define DMNGR_DIR_CMD_REMOVE        "REMOVE"
+
+struct _dmngr_dir_t {
+    zactor_t *actor;                /* Directory actor */
+};
+
+/* Arguments of the actor. Only valid until it signals */
+typedef struct {
+    const char *broker_endp;
+    uint32_t num_shards;
+    int rc;                         /* 0 if all shards were connected to */
+} dmngr_dir_args_t;
+
+/* Service registered by an SMIO */
+typedef struct {
+    smio_dir_service_t desc;
+    char *ops;                      /* Exported operation names */
+    zframe_t *info;                 /* Service specific information */
+} dmngr_dir_service_t;
+
+/* State of the actor */
+typedef struct {
+    mlm_client_t **clients;         /* Client of each shard */
+    uint32_t num_shards;
+    zhashx_t *devios;               /* smio_dir_devio_t, keyed by
+                                       HUTILS_CFG_HASH_KEY_PATTERN_COMPL */
+    zhashx_t *services;             /* dmngr_dir_service_t, keyed by service */
+} dmngr_dir_state_t;
+
+static void _dmngr_dir_actor (zsock_t *pipe, void *args);
+
+dmngr_dir_t *dmngr_dir_new (const char *broker_endp, uint32_t num_shards)
+{
+    assert (broker_endp);
+
+    dmngr_dir_t *self = (dmngr_dir_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    /* The actor connects to the shards before signalling us */
+    dmngr_dir_args_t args = {.broker_endp = broker_endp,
+        .num_shards = num_shards, .rc = -1};
+    self->actor = zactor_new (_dmngr_dir_actor, &args);
+    ASSERT_ALLOC(self->actor, err_actor_alloc);
+    ASSERT_TEST(args.rc == 0, "Could not connect directory to the broker",
+            err_actor_connect);
+
+    DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_INFO, "[dev_mngr_dir] Directory "
+            "answering at %s on %u broker shard(s)\n", SMIO_DIR_SERVICE,
+            num_shards);
+    return self;
+
+err_actor_connect:
+    zactor_destroy (&self->actor);
+err_actor_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+dmngr_err_e dmngr_dir_destroy (dmngr_dir_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        dmngr_dir_t *self = *self_p;
+
+        zactor_destroy (&self->actor);
+        free (self);
+        *self_p = NULL;
+    }
+
+    return DMNGR_SUCCESS;
+}
+
+dmngr_err_e dmngr_dir_set_devio (dmngr_dir_t *self, uint32_t board_id,
+        uint32_t bpm_id, uint32_t state, pid_t pid)
+{
+    assert (self);
+
+    int rc = zsock_send (self->actor, "s4444", DMNGR_DIR_CMD_DEVIO, board_id,
+            bpm_id, state, (uint32_t) pid);
+    return (rc == 0) ? DMNGR_SUCCESS : DMNGR_ERR_ALLOC;
+}
+
+dmngr_err_e dmngr_dir_remove_devio (dmngr_dir_t *self, uint32_t board_id,
+        uint32_t bpm_id)
+{
+    assert (self);
+
+    int rc = zsock_send (self->actor, "s44", DMNGR_DIR_CMD_REMOVE, board_id,
+            bpm_id);
+    return (rc == 0) ? DMNGR_SUCCESS : DMNGR_ERR_ALLOC;
+}
+
+/**************** Helper Functions ***************/
+
+static void _dmngr_dir_service_destroy (void **item)
+{
+    dmngr_dir_service_t *service = (dmngr_dir_service_t *) *item;
+    free (service->ops);
+    zframe_destroy (&service->info);
+    free (service);
+    *item = NULL;
+}
+
+static void _dmngr_dir_devio_destroy (void **item)
+{
+    free (*item);
+    *item = NULL;
+}
+
+/* Services of a DEVIO that is gone */
+static void _dmngr_dir_drop_services (dmngr_dir_state_t *state, int32_t pid)
+{
+    if (pid <= 0) {
+        return;
+    }
+
+    zlistx_t *keys = zhashx_keys (state->services);
+    ASSERT_ALLOC(keys, err_keys_alloc);
+
+    const char *key = (const char *) zlistx_first (keys);
+    for (; key != NULL; key = (const char *) zlistx_next (keys)) {
+        dmngr_dir_service_t *service = zhashx_lookup (state->services, key);
+        if (service->desc.pid == pid) {
+            zhashx_delete (state->services, key);
+        }
+    }
+
+    zlistx_destroy (&keys);
+err_keys_alloc:
+    return;
+}
+
+static void _dmngr_dir_handle_cmd (dmngr_dir_state_t *state,
+        const char *command, zmsg_t *cmd)
+{
+    uint32_t board_id = 0;
+    uint32_t bpm_id = 0;
+    zframe_t *frame;
+
+    /* Frames are the fields of the command, see dmngr_dir_set_devio () */
+    frame = zmsg_pop (cmd);
+    if (frame != NULL && zframe_size (frame) == sizeof (uint32_t)) {
+        memcpy (&board_id, zframe_data (frame), sizeof (board_id));
+    }
+    zframe_destroy (&frame);
+    frame = zmsg_pop (cmd);
+    if (frame != NULL && zframe_size (frame) == sizeof (uint32_t)) {
+        memcpy (&bpm_id, zframe_data (frame), sizeof (bpm_id));
+    }
+    zframe_destroy (&frame);
+
+    char key [HUTILS_CFG_HASH_KEY_MAX_LEN];
+    snprintf (key, sizeof (key), HUTILS_CFG_HASH_KEY_PATTERN_COMPL, board_id,
+            bpm_id);
+    smio_dir_devio_t *devio = zhashx_lookup (state->devios, key);
+
+    if (streq (command, DMNGR_DIR_CMD_REMOVE)) {
+        if (devio != NULL) {
+            _dmngr_dir_drop_services (state, devio->pid);
+            zhashx_delete (state->devios, key);
+        }
+        return;
+    }
+
+    if (!streq (command, DMNGR_DIR_CMD_DEVIO)) {
+        return;
+    }
+
+    if (devio == NULL) {
+        devio = (smio_dir_devio_t *) zmalloc (sizeof *devio);
+        ASSERT_ALLOC(devio, err_devio_alloc);
+        devio->board_id = board_id;
+        devio->bpm_id = bpm_id;
+        if (zhashx_insert (state->devios, key, devio) != 0) {
+            free (devio);
+            return;
+        }
+    }
+
+    uint32_t devio_state = devio->state;
+    uint32_t pid = 0;
+    frame = zmsg_pop (cmd);
+    if (frame != NULL && zframe_size (frame) == sizeof (uint32_t)) {
+        memcpy (&devio_state, zframe_data (frame), sizeof (devio_state));
+    }
+    zframe_destroy (&frame);
+    frame = zmsg_pop (cmd);
+    if (frame != NULL && zframe_size (frame) == sizeof (uint32_t)) {
+        memcpy (&pid, zframe_data (frame), sizeof (pid));
+    }
+    zframe_destroy (&frame);
+
+    /* A new process does not serve the services of the old one */
+    if (devio_state == SMIO_DIR_DEVIO_KILLED || (int32_t) pid != devio->pid) {
+        _dmngr_dir_drop_services (state, devio->pid);
+    }
+    devio->state = devio_state;
+    devio->pid = (int32_t) pid;
+
+err_devio_alloc:
+    return;
+}
+
+static void _dmngr_dir_register (dmngr_dir_state_t *state, zmsg_t *msg)
+{
+    /* Message is:
+     * frame 0: smio_dir_service_t
+     * frame 1: exported operation names
+     * frame 2: service specific information */
+    zframe_t *desc_frame = zmsg_pop (msg);
+    char *ops = zmsg_popstr (msg);
+    zframe_t *info = zmsg_pop (msg);
+    ASSERT_TEST(desc_frame != NULL && zframe_size (desc_frame) ==
+            sizeof (smio_dir_service_t) && ops != NULL && info != NULL &&
+            zframe_size (info) <= SMIO_DIR_INFO_MAX_SIZE,
+            "Malformed directory registration", err_malformed);
+
+    dmngr_dir_service_t *service = (dmngr_dir_service_t *) zmalloc (sizeof *service);
+    ASSERT_ALLOC(service, err_service_alloc);
+    memcpy (&service->desc, zframe_data (desc_frame), sizeof (service->desc));
+    service->desc.service [sizeof (service->desc.service) - 1] = '\0';
+    service->ops = ops;
+    ops = NULL;
+    service->info = info;
+    info = NULL;
+
+    DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_TRACE, "[dev_mngr_dir] Service %s "
+            "registered by PID %d\n", service->desc.service, service->desc.pid);
+    /* A restarted SMIO replaces its old entry */
+    zhashx_update (state->services, service->desc.service, service);
+
+err_service_alloc:
+err_malformed:
+    zframe_destroy (&info);
+    free (ops);
+    zframe_destroy (&desc_frame);
+}
+
+static void _dmngr_dir_unregister (dmngr_dir_state_t *state, zmsg_t *msg)
+{
+    /* Message is:
+     * frame 0: service name */
+    char *service = zmsg_popstr (msg);
+    if (service != NULL) {
+        zhashx_delete (state->services, service);
+    }
+    free (service);
+}
+
+static void _dmngr_dir_list (dmngr_dir_state_t *state, mlm_client_t *client)
+{
+    zmsg_t *reply = zmsg_new ();
+    ASSERT_ALLOC(reply, err_reply_alloc);
+
+    /* Message is:
+     * frame 0: number of DEVIOs
+     * frame 1 .. n: smio_dir_devio_t of each DEVIO
+     * frame n+1 ..: smio_dir_service_t, operation names and information
+     *               of each service */
+    uint32_t num_devios = (uint32_t) zhashx_size (state->devios);
+    int rc = zmsg_addmem (reply, &num_devios, sizeof (num_devios));
+
+    smio_dir_devio_t *devio = zhashx_first (state->devios);
+    for (; devio != NULL; devio = zhashx_next (state->devios)) {
+        smio_dir_devio_t desc = *devio;
+        desc.num_services = 0;
+
+        dmngr_dir_service_t *service = zhashx_first (state->services);
+        for (; service != NULL; service = zhashx_next (state->services)) {
+            if (devio->pid > 0 && service->desc.pid == devio->pid) {
+                desc.num_services++;
+            }
+        }
+        rc |= zmsg_addmem (reply, &desc, sizeof (desc));
+    }
+
+    dmngr_dir_service_t *service = zhashx_first (state->services);
+    for (; service != NULL; service = zhashx_next (state->services)) {
+        rc |= zmsg_addmem (reply, &service->desc, sizeof (service->desc));
+        rc |= zmsg_addstr (reply, service->ops);
+        rc |= zmsg_addmem (reply, zframe_data (service->info),
+                zframe_size (service->info));
+    }
+    ASSERT_TEST(rc == 0, "Could not build directory listing", err_reply_add);
+
+    rc = mlm_client_sendto (client, mlm_client_sender (client),
+            SMIO_DIR_SUBJECT_LIST, mlm_client_tracker (client), 0, &reply);
+    ASSERT_TEST(rc == 0, "Could not send directory listing", err_reply_send);
+
+err_reply_send:
+err_reply_add:
+    zmsg_destroy (&reply);
+err_reply_alloc:
+    return;
+}
+
+static void _dmngr_dir_handle_msg (dmngr_dir_state_t *state, mlm_client_t *client)
+{
+    zmsg_t *msg = mlm_client_recv (client);
+    if (msg == NULL) {
+        return;
+    }
+
+    const char *subject = mlm_client_subject (client);
+    if (subject == NULL) {
+        /* Nothing to do */
+    }
+    else if (streq (subject, SMIO_DIR_SUBJECT_REGISTER)) {
+        _dmngr_dir_register (state, msg);
+    }
+    else if (streq (subject, SMIO_DIR_SUBJECT_UNREGISTER)) {
+        _dmngr_dir_unregister (state, msg);
+    }
+    else if (streq (subject, SMIO_DIR_SUBJECT_LIST)) {
+        _dmngr_dir_list (state, client);
+    }
+    else {
+        DBE_DEBUG (DBG_DEV_MNGR | DBG_LVL_WARN, "[dev_mngr_dir] Unknown "
+                "directory request %s from %s\n", subject,
+                mlm_client_sender (client));
+    }
+
+    zmsg_destroy (&msg);
+}
+
+/* Serve the directory requests of all shards and the commands of the
+ * dev_mngr. Both come from one thread, so the state is not locked */
+static void _dmngr_dir_actor (zsock_t *pipe, void *args)
+{
+    dmngr_dir_args_t *dir_args = (dmngr_dir_args_t *) args;
+    dmngr_dir_state_t state = {.num_shards = dir_args->num_shards};
+    zpoller_t *poller = NULL;
+    bool signalled = false;
+
+    state.devios = zhashx_new ();
+    ASSERT_ALLOC(state.devios, err_devios_alloc);
+    zhashx_set_destructor (state.devios, _dmngr_dir_devio_destroy);
+    state.services = zhashx_new ();
+    ASSERT_ALLOC(state.services, err_services_alloc);
+    zhashx_set_destructor (state.services, _dmngr_dir_service_destroy);
+
+    state.clients = (mlm_client_t **) zmalloc (state.num_shards *
+            sizeof (*state.clients));
+    ASSERT_ALLOC(state.clients, err_clients_alloc);
+    poller = zpoller_new (pipe, NULL);
+    ASSERT_ALLOC(poller, err_poller_alloc);
+
+    for (uint32_t shard = 0; shard < state.num_shards; ++shard) {
+        char *shard_endp = hutils_broker_shard_endp (dir_args->broker_endp, shard);
+        ASSERT_ALLOC(shard_endp, err_client_connect);
+
+        state.clients [shard] = mlm_client_new ();
+        int rc = (state.clients [shard] == NULL) ? -1 :
+            mlm_client_connect (state.clients [shard], shard_endp,
+                    DMNGR_DIR_CONNECT_TIMEOUT, SMIO_DIR_SERVICE);
+        free (shard_endp);
+        ASSERT_TEST(rc == 0, "Could not connect to broker shard",
+                err_client_connect);
+        zpoller_add (poller, mlm_client_msgpipe (state.clients [shard]));
+    }
+
+    /* Arguments are gone after this */
+    dir_args->rc = 0;
+    zsock_signal (pipe, 0);
+    signalled = true;
+
+    while (true) {
+        void *which = zpoller_wait (poller, -1);
+        if (which == NULL) {
+            break;
+        }
+
+        if (which == pipe) {
+            zmsg_t *cmd = zmsg_recv (pipe);
+            if (cmd == NULL) {
+                break;
+            }
+
+            char *command = zmsg_popstr (cmd);
+            bool term = (command == NULL || streq (command, "$TERM"));
+            if (!term) {
+                _dmngr_dir_handle_cmd (&state, command, cmd);
+            }
+            free (command);
+            zmsg_destroy (&cmd);
+            if (term) {
+                break;
+            }
+            continue;
+        }
+
+        for (uint32_t i = 0; i < state.num_shards; ++i) {
+            if (which == mlm_client_msgpipe (state.clients [i])) {
+                _dmngr_dir_handle_msg (&state, state.clients [i]);
+                break;
+            }
+        }
+    }
+
+err_client_connect:
+    for (uint32_t shard = 0; shard < state.num_shards; ++shard) {
+        mlm_client_destroy (&state.clients [shard]);
+    }
+    zpoller_destroy (&poller);
+err_poller_alloc:
+    free (state.clients);
+err_clients_alloc:
+    zhashx_destroy (&state.services);
+err_services_alloc:
+    zhashx_destroy (&state.devios);
+err_devios_alloc:
+    /* Tell dmngr_dir_new () we failed, with args->rc still set */
+    if (!signalled) {
+        zsock_signal (pipe, 0);
+    }
+    return;
+}
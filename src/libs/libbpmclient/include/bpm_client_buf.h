@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_BUF_H_
+#define _BPM_CLIENT_BUF_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pools of acquisition buffers (e.g., for acq_trans->block.data). All the
+ * buffers of a pool are carved out of one mapping, backed by huge pages if
+ * the system has them, placed on a given NUMA node and faulted in when the
+ * pool is created, so readouts don't pay for page faults or cross-node
+ * traffic. Getting and putting buffers is thread-safe */
+
+/* Buffers are aligned to this */
+#define BPM_BUF_ALIGN                   4096
+
+/* Creates a pool of "num_bufs" buffers of at least "buf_size" bytes on
+ * "numa_node". Use hutils_mem_dev_numa_node () to get the node of the board
+ * and HUTILS_MEM_NODE_ANY for no particular node */
+bpm_buf_pool_t *bpm_buf_pool_new (size_t buf_size, uint32_t num_bufs,
+        int numa_node);
+/* Destroy a pool. All of its buffers must have been put back */
+void bpm_buf_pool_destroy (bpm_buf_pool_t **self_p);
+
+/* Get a buffer from the pool. NULL if all of them are in use */
+void *bpm_buf_pool_get (bpm_buf_pool_t *self);
+/* Give a buffer back to the pool */
+void bpm_buf_pool_put (bpm_buf_pool_t *self, void *buf);
+/* Size of each buffer of the pool, bpm_buf_pool_new () "buf_size" rounded up
+ * to BPM_BUF_ALIGN */
+size_t bpm_buf_pool_get_buf_size (bpm_buf_pool_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
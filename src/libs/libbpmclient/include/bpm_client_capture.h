@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_CAPTURE_H_
+#define _BPM_CLIENT_CAPTURE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Binary capture files. A capture file starts with a bpm_capture_hdr_t
+ * describing the acquisition, followed by the raw samples, exactly as read
+ * from the board, at offset payload_offs. The payload starts at a page
+ * boundary, so readers can mmap () it and use the samples in place. The
+ * header fields are in the byte order of the machine that wrote the file */
+
+#define BPM_CAPTURE_MAGIC               "BPMCAPT"
+#define BPM_CAPTURE_MAGIC_SIZE          8
+#define BPM_CAPTURE_VERSION             1
+/* The payload is aligned to this. Must be a multiple of the page size of
+ * any machine reading the file */
+#define BPM_CAPTURE_PAYLOAD_ALIGN       4096
+
+/* Capture file header */
+typedef struct {
+    char magic [BPM_CAPTURE_MAGIC_SIZE];        /* BPM_CAPTURE_MAGIC, NUL terminated */
+    uint32_t version;                           /* BPM_CAPTURE_VERSION */
+    uint32_t hdr_size;                          /* Size of this header */
+    uint32_t chan;                              /* Acquisition channel number */
+    uint32_t sample_size;                       /* Sample size in bytes */
+    uint32_t num_samples_pre;                   /* Number of pre-trigger samples */
+    uint32_t num_samples_post;                  /* Number of post-trigger samples */
+    uint32_t num_shots;                         /* Number of shots */
+    uint32_t trig_addr;                         /* Trigger address. 0 if unknown */
+    uint64_t timestamp;                         /* Capture time in ns since the Epoch */
+    uint64_t payload_offs;                      /* File offset of the first sample */
+    uint64_t payload_size;                      /* Payload size in bytes. Only valid
+                                                   after the file is closed */
+} bpm_capture_hdr_t;
+
+/* Acquisition described by a capture file */
+typedef struct {
+    acq_req_t req;                              /* Request the samples come from */
+    uint32_t sample_size;                       /* Sample size in bytes. 0 to use
+                                                   the one of req.chan */
+    uint32_t trig_addr;                         /* Trigger address. 0 if unknown */
+    uint64_t timestamp;                         /* Capture time in ns since the Epoch.
+                                                   0 to use the current time */
+} bpm_capture_info_t;
+
+/* Create the capture file "path" for the acquisition described by "info",
+ * truncating it if it already exists. Returns NULL on error */
+bpm_capture_t *bpm_capture_new (const char *path, const bpm_capture_info_t *info);
+
+/* Write the final payload size to the header and close the capture file */
+void bpm_capture_destroy (bpm_capture_t **self_p);
+
+/* Append "size" bytes of samples to the payload.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_INV_PARAM if the data
+ * could not be written */
+bpm_client_err_e bpm_capture_write (bpm_capture_t *self, const void *data,
+        size_t size);
+
+/* Number of payload bytes written so far */
+uint64_t bpm_capture_get_size (bpm_capture_t *self);
+
+/* Same as bpm_acq_get_curve_sized, but each block is appended to "capture"
+ * as soon as it arrives, so the curve does not need to fit in memory.
+ * acq_trans->block.data is only used as a staging buffer and must hold
+ * at least block_size bytes. The number of bytes captured is returned in
+ * acq_trans->block.bytes_read */
+bpm_client_err_e bpm_acq_get_curve_capture (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size, bpm_capture_t *capture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -53,9 +53,48 @@
 /* Opaque bpm_client_t structure */
 typedef struct _bpm_client_t bpm_client_t;
 
+/* Opaque bpm_capture_t structure */
+typedef struct _bpm_capture_t bpm_capture_t;
+
+/* Opaque bpm_buf_pool_t structure */
+typedef struct _bpm_buf_pool_t bpm_buf_pool_t;
+
+/* Opaque bpm_param_batch_t structure */
+typedef struct _bpm_param_batch_t bpm_param_batch_t;
+
+/* Opaque bpm_spec_t structure */
+typedef struct _bpm_spec_t bpm_spec_t;
+
+/* Opaque bpm_status_t structure */
+typedef struct _bpm_status_t bpm_status_t;
+
+/* Opaque bpm_pstream_t structure */
+typedef struct _bpm_pstream_t bpm_pstream_t;
+
+/* Opaque bpm_shared_client_t structure */
+typedef struct _bpm_shared_client_t bpm_shared_client_t;
+
+/* Opaque bpm_broker_dir_t structure */
+typedef struct _bpm_broker_dir_t bpm_broker_dir_t;
+
+/* Opaque bpm_crate_dir_t structure */
+typedef struct _bpm_crate_dir_t bpm_crate_dir_t;
+
 /* BPM CLIENT */
 #include "bpm_client_err.h"
 #include "bpm_client_rw_param.h"
 #include "bpm_client_core.h"
+#include "bpm_client_capture.h"
+#include "bpm_client_swap.h"
+#include "bpm_client_pos.h"
+#include "bpm_client_conv.h"
+#include "bpm_client_monit_gw.h"
+#include "bpm_client_integ.h"
+#include "bpm_client_buf.h"
+#include "bpm_client_spec.h"
+#include "bpm_client_status.h"
+#include "bpm_client_pstream.h"
+#include "bpm_client_shared.h"
+#include "bpm_client_dir.h"
 
 #endif
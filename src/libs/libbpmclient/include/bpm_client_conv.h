@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_CONV_H_
+#define _BPM_CLIENT_CONV_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Conversion of raw curves to floats in physical units. Samples are made of
+ * BPM_CONV_NUM_ATOMS interleaved signed atoms of sample_size/BPM_CONV_NUM_ATOMS
+ * bytes, as given by the channel map: 16-bit ADC counts (e.g., ADC0), 32-bit
+ * positions in nm (e.g., TBTPOS0) or 32-bit I/Q pairs (e.g., MIXIQ120 or
+ * TBTDECIMIQ120). Each value written is raw * scale [j] + offset [j], j
+ * being its place in the sample, e.g., a scale of 1e-6 gives positions in mm.
+ *
+ * bpm_acq_get_curve_conv () converts each block of the curve as it arrives,
+ * so the raw curve is never stored and the samples are only gone through
+ * once */
+
+#define BPM_CONV_NUM_ATOMS              4
+
+/* Values of each sample */
+typedef enum {
+    BPM_CONV_ATOMS = 0,             /* Every atom, BPM_CONV_NUM_ATOMS values */
+    BPM_CONV_IQ_MAG,                /* Magnitude of the I/Q pairs made of atoms
+                                       0/1 and 2/3, 2 values. 32-bit atoms only */
+    BPM_CONV_END                    /* End of enum marker */
+} bpm_conv_e;
+
+/* Output format */
+typedef struct {
+    bpm_conv_e conv;                /* Values of each sample */
+    bool planar;                    /* One array per value, instead of the
+                                       values of each sample side by side */
+    float scale [BPM_CONV_NUM_ATOMS];   /* Scale of value j */
+    float offset [BPM_CONV_NUM_ATOMS];  /* Offset of value j */
+} bpm_conv_fmt_t;
+
+/* Name of the kernels used on this CPU (e.g., "avx2"), for diagnostics */
+const char *bpm_conv_kernel_name (void);
+
+/* Number of values of each sample converted with "fmt" */
+uint32_t bpm_conv_num_values (const bpm_conv_fmt_t *fmt);
+
+/* Convert the "num_samples" samples of "src", of "sample_size" bytes, to
+ * "dst". Planar values j go to dst [j*plane_size] on, so "plane_size" must
+ * be at least "num_samples". It is not used otherwise.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_INV_PARAM if the
+ * format does not apply to the samples */
+bpm_client_err_e bpm_conv_samples (const bpm_conv_fmt_t *fmt, const void *src,
+        uint32_t sample_size, size_t num_samples, float *dst, size_t plane_size);
+
+/* Same as bpm_acq_get_curve_cb (), with each block converted with "fmt" to
+ * its place in the "dst_size" bytes of "dst" instead of being handed to a
+ * callback. acq_trans->block.data is not used. Planar curves have each
+ * value in a plane of dst_size/bpm_conv_num_values () bytes. Samples that
+ * don't fit are left out. The size of the samples converted, in bytes of
+ * floats, is returned in acq_trans->block.bytes_read.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_INV_PARAM if the format
+ * does not apply to the channel and BPM_CLIIENT_ERR_SERVER otherwise */
+bpm_client_err_e bpm_acq_get_curve_conv (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t window, const bpm_conv_fmt_t *fmt,
+        float *dst, size_t dst_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,9 @@ extern "C" {
 struct _smio_rffe_data_block_t;
 struct _smio_rffe_version_t;
 struct _smio_afc_diag_revision_data_t;
+struct _smio_afc_diag_identity_t;
+struct _smio_startup_stats_t;
+struct _smio_alloc_stats_t;
 
 /********************************************************/
 /************************ Our API ***********************/
@@ -48,6 +51,16 @@ bpm_client_t *bpm_client_new_log_mode (char *broker_endp, int verbose,
 bpm_client_t *bpm_client_new_log_mode_time (char *broker_endp, int verbose,
         const char *log_file_name, const char *log_mode, int timeout);
 
+/* Same as bpm_client_new_log_mode_time (), tuning ZeroMQ with "zmq_opts"
+ * for multi-MB acquisitions. NULL selects the defaults for bulk transfers,
+ * HUTILS_ZMQ_OPTS_DFLT. The I/O threads and HWMs are process-wide, so they
+ * are only honored for sockets created afterwards, and the I/O threads only
+ * if the client is the first ZeroMQ user of the process. The kernel buffers
+ * apply to the direct data path and local fast path sockets of this client */
+bpm_client_t *bpm_client_new_zmq_opts (char *broker_endp, int verbose,
+        const char *log_file_name, const char *log_mode, int timeout,
+        const hutils_zmq_opts_t *zmq_opts);
+
 /* Destroy an instance of the BPM client. This must be called
  * after all operations involving the communication with the BPM
  * server */
@@ -57,11 +70,195 @@ void bpm_client_destroy (bpm_client_t **self_p);
 bpm_client_err_e bpm_func_exec (bpm_client_t *self, const disp_op_t *func,
         char *service, uint32_t *input, uint32_t *output);
 
-/* Translate function's name and returns its structure */
+/* Reply data left in the received message by bpm_func_exec_view () */
+typedef struct {
+    zmsg_t *msg;                    /* Message holding the data */
+    const uint8_t *data;            /* Reply data. NULL if there is none */
+    size_t size;                    /* Size of data, in bytes */
+} bpm_func_reply_t;
+
+/* Same as bpm_func_exec (), but the reply data is not copied out, so bulk
+ * data can be consumed in place. "reply" must be released with
+ * bpm_func_reply_release () whatever the result */
+bpm_client_err_e bpm_func_exec_view (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, bpm_func_reply_t *reply);
+/* Release the message of a bpm_func_exec_view () reply */
+void bpm_func_reply_release (bpm_func_reply_t *reply);
+
+/* Asynchronous function execution. Requests are sent right away and their
+ * replies are matched by a tracker the server sends back, so many requests,
+ * to any number of services, can be in flight at the same time. Requests
+ * time out after the client timeout, like synchronous ones.
+ *
+ * Replies are only processed inside bpm_func_async_dispatch (),
+ * bpm_func_async_wait () and the synchronous functions. To drive this from
+ * an event loop, wait for bpm_client_get_poller () (or the msgpipe of
+ * bpm_get_mlm_client ()) to be readable and call
+ * bpm_func_async_dispatch (self, 0) */
+#define BPM_FUNC_ASYNC_TRACKER_PREFIX   "bpm_async:"
+#define BPM_FUNC_ASYNC_TRACKER_FMT      BPM_FUNC_ASYNC_TRACKER_PREFIX "%"PRIu32
+#define BPM_FUNC_ASYNC_TRACKER_LEN      32
+/* Synchronous requests carry a tracker as well, so a late reply to one that
+ * timed out is not taken for the reply to the next. While tracing, it also
+ * identifies the request (see errhand_trace_req_id ()) */
+#define BPM_FUNC_SYNC_TRACKER_FMT       "bpm_sync:%"PRIu32
+
+/* Handle of a service not resolved, see bpm_client_service_resolve () */
+#define BPM_CLIENT_SERVICE_INVALID      UINT32_MAX
+/* Longest service name bpm_client_service_resolve_smio () builds */
+#define BPM_CLIENT_SERVICE_NAME_MAX     64
+
+/* Completion callback. "output" is the buffer passed to bpm_func_exec_async,
+ * filled with the reply if err is BPM_CLIENT_SUCCESS. Callbacks can be called
+ * while a synchronous request waits for its reply, so they can only issue
+ * asynchronous requests */
+typedef void (*bpm_func_async_fp) (bpm_client_t *self, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg);
+
+/* Send a function request without waiting for its reply. "output" must stay
+ * valid until the request completes. If "cb" is not NULL, it is called with
+ * "arg" when the request completes. Otherwise, the request must be waited
+ * for with bpm_func_async_wait (). The request ID is returned in "req_id",
+ * if not NULL.
+ * Returns BPM_CLIENT_SUCCESS if the request was sent or error (see
+ * bpm_client_err.h for all possible errors) */
+bpm_client_err_e bpm_func_exec_async (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, uint32_t *output, bpm_func_async_fp cb,
+        void *arg, uint32_t *req_id);
+
+/* Process replies, waiting up to "timeout" ms (-1 for infinite) for the
+ * first one, and time out the requests past their deadline.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_INT if interrupted */
+bpm_client_err_e bpm_func_async_dispatch (bpm_client_t *self, int timeout);
+
+/* Wait for a request sent without a callback to complete. Replies to other
+ * requests are processed meanwhile.
+ * Returns the completion status of the request or BPM_CLIENT_ERR_INV_PARAM
+ * if req_id is not a pending request without callback */
+bpm_client_err_e bpm_func_async_wait (bpm_client_t *self, uint32_t req_id);
+
+/* Forget about a request. Its reply is discarded when it arrives. The
+ * callback, if any, is not called */
+void bpm_func_async_cancel (bpm_client_t *self, uint32_t req_id);
+
+/* Number of requests sent and not yet completed or waited for */
+size_t bpm_func_async_pending (bpm_client_t *self);
+
+/* Send the same request to "num_services" services at once and wait for all
+ * of the replies, up to "timeout" ms in total (-1 for infinite). The reply of
+ * services [i] is copied to "outputs" + i*output_size and its status to
+ * errs [i], if "errs" is not NULL.
+ * Returns BPM_CLIENT_SUCCESS if all of the services replied successfully or
+ * the error of the first one that did not */
+bpm_client_err_e bpm_func_exec_multi (bpm_client_t *self, const disp_op_t *func,
+        char **services, size_t num_services, uint32_t *input, void *outputs,
+        size_t output_size, bpm_client_err_e *errs, int timeout);
+
+/* Parameter batches. Get and set operations of any kind, for a single
+ * service, are added to a batch, which is then sent as a single request
+ * (see SMIO_OPCODE_BATCH). The service executes them in order and replies
+ * to all of them at once. Up to SMIO_BATCH_MAX_OPS operations, taking up
+ * to SMIO_BATCH_MAX_SIZE bytes of arguments and of replies, fit in a
+ * batch. A batch can be executed as many times as needed */
+
+/* Create a new, empty, batch for "service" */
+bpm_param_batch_t *bpm_param_batch_new (char *service);
+/* Destroy a batch */
+void bpm_param_batch_destroy (bpm_param_batch_t **self_p);
+/* Add an operation to the batch, with the same arguments as
+ * bpm_func_exec (). "input" is copied right away, but "output" is only
+ * written by bpm_param_batch_exec (), so it must stay valid until then.
+ * Returns BPM_CLIENT_ERR_INV_PARAM if the batch is full */
+bpm_client_err_e bpm_param_batch_add (bpm_param_batch_t *self,
+        const disp_op_t *func, uint32_t *input, uint32_t *output);
+/* Remove all of the operations of the batch */
+void bpm_param_batch_clear (bpm_param_batch_t *self);
+/* Get the number of operations in the batch */
+uint32_t bpm_param_batch_get_num_ops (bpm_param_batch_t *self);
+/* Get the status of operation "idx", in the order they were added, for
+ * the last bpm_param_batch_exec () */
+bpm_client_err_e bpm_param_batch_get_err (bpm_param_batch_t *self,
+        uint32_t idx);
+/* Execute the operations of the batch, copying the reply of each one to
+ * its output. The parameter cache of the service is dropped, as any of
+ * them might change a parameter.
+ * Returns BPM_CLIENT_SUCCESS if all of the operations succeeded, the error
+ * of the first one that did not or the error of the batch request itself */
+bpm_client_err_e bpm_param_batch_exec (bpm_client_t *self,
+        bpm_param_batch_t *batch);
+
+/* Complete the asynchronous request "*report_p" is a reply to, taking
+ * ownership of it. Returns false, leaving the reply alone, if it is not
+ * a reply to an asynchronous request. Used by the synchronous functions
+ * to tell their replies apart */
+bool bpm_func_async_complete (bpm_client_t *self, zmsg_t **report_p);
+
+/* Get the tracker of a new synchronous request, valid until the next call */
+const char *bpm_func_sync_tracker_new (bpm_client_t *self);
+
+/* Check the message just received is the reply to the last synchronous
+ * request, and not a late reply to an earlier one */
+bool bpm_func_sync_reply_match (bpm_client_t *self);
+
+/* Send "*msg_p" to "service", as mlm_client_sendto () does, taking ownership
+ * of it. If "local" is set, the message goes through the local fast path of
+ * the service instead, when it has one (see RW_LOCAL_ENDP_SEP). Only
+ * requests answered by a single reply may go through it. Returns 0 if ok */
+int bpm_client_sendto (bpm_client_t *self, char *service, const char *subject,
+        const char *tracker, uint32_t timeout, zmsg_t **msg_p, bool local);
+
+/* Get the poller for the replies to the synchronous requests, which watches
+ * the local fast path sockets as well as the broker */
+zpoller_t *bpm_client_get_reply_poller (bpm_client_t *self);
+
+/* Receive the reply that arrived on the local fast path socket "sock".
+ * Returns NULL for late replies, which are dropped */
+zmsg_t *bpm_client_local_recv (bpm_client_t *self, zsock_t *sock);
+
+/* The reply to the last request was not received in time. If it went
+ * through a local fast path, the following ones go through the broker */
+void bpm_client_local_expired (bpm_client_t *self);
+
+/* Adaptive timeouts (see bpm_client_set_adaptive_timeout ()), used by the
+ * synchronous requests. bpm_client_sync_op_begin () times the request to
+ * "opcode" of "service" just sent, whose reply takes up to "size" bytes (0
+ * if unknown). bpm_client_sync_op_timeout () returns the timeout of its
+ * reply, in ms, or the fixed one if no request is timed, and
+ * bpm_client_sync_op_end () learns from its reply "report", or from it
+ * timing out if NULL */
+void bpm_client_sync_op_begin (bpm_client_t *self, const char *service,
+        uint32_t opcode, size_t size);
+int bpm_client_sync_op_timeout (bpm_client_t *self);
+void bpm_client_sync_op_end (bpm_client_t *self, zmsg_t *report);
+
+/* Parameter cache (see bpm_client_set_param_cache ()), used by the
+ * param_client_* functions. bpm_param_cache_get () copies a cached read of
+ * "operation" with argument "arg" to "output", returning false if it is not
+ * cached. bpm_param_cache_put () caches a read, if "operation" is cached for
+ * the service, and bpm_param_cache_invalidate () drops all of the cached
+ * reads of a service */
+bool bpm_param_cache_get (bpm_client_t *self, char *service, uint32_t operation,
+        const void *arg, size_t arg_size, void *output, size_t output_size);
+void bpm_param_cache_put (bpm_client_t *self, char *service, uint32_t operation,
+        const void *arg, size_t arg_size, const void *data, size_t size);
+void bpm_param_cache_invalidate (bpm_client_t *self, char *service);
+
+/* Write-behind writes (see bpm_client_set_write_behind ()), used by the
+ * param_client_* functions. bpm_param_write_behind () sends the write
+ * "*msg_p", of the RW_WIRE_FRAMES form, without waiting for its reply,
+ * taking ownership of it, and bpm_param_write_behind_wait () waits for the
+ * replies of all of the writes sent so */
+bpm_client_err_e bpm_param_write_behind (bpm_client_t *self, char *service,
+        zmsg_t **msg_p);
+bpm_client_err_e bpm_param_write_behind_wait (bpm_client_t *self);
+
+/* Translate function's name and returns its structure. This searches all
+ * of the exported functions, so callers issuing the same function at a high
+ * rate should translate it once and reuse the result with bpm_func_exec () */
 const disp_op_t* bpm_func_translate (char *name);
 
 /* Wrapper to bpm_func_exec which translates the function name to
- * its exp_ops structure */
+ * its exp_ops structure, using the client's function name index */
 bpm_client_err_e bpm_func_trans_exec (bpm_client_t *self, char *name,
         char *service, uint32_t *input, uint32_t *output);
 
@@ -79,6 +276,140 @@ bpm_client_err_e bpm_client_set_timeout (bpm_client_t *self, int timeout);
 /* Get the timeout parameter */
 uint32_t bpm_client_get_timeout (bpm_client_t *self);
 
+/* Spin on the reply sockets for up to "busy_poll" us before blocking while
+ * waiting for a reply, or block right away with 0. Spinning saves the
+ * wake-up of the thread on fast replies at the cost of a busy core, so it is
+ * meant for callers pinned to a core of their own, e.g., feedback loops.
+ * Default is 0 */
+void bpm_client_set_busy_poll (bpm_client_t *self, uint32_t busy_poll);
+
+/* Get the time spent spinning on the reply sockets, in us */
+uint32_t bpm_client_get_busy_poll (bpm_client_t *self);
+
+/* Derive the timeout of each synchronous request from the latencies and
+ * bandwidth observed on its service and op, so a board that does not reply
+ * is told apart in a few times its usual latency instead of the fixed
+ * timeout meant for the slowest block read. The fixed timeout (see
+ * bpm_client_set_timeout ()) is still the longest one and is used until
+ * enough replies were seen. Asynchronous requests and curve streams keep
+ * the fixed one. Default is false */
+void bpm_client_set_adaptive_timeout (bpm_client_t *self, bool adaptive);
+
+/* Check if the timeouts are derived from the latencies observed */
+bool bpm_client_get_adaptive_timeout (bpm_client_t *self);
+
+/* Set the shortest adaptive timeout, in ms. Default is 5 */
+void bpm_client_set_timeout_floor (bpm_client_t *self, uint32_t timeout_floor);
+
+/* Get the shortest adaptive timeout, in ms */
+uint32_t bpm_client_get_timeout_floor (bpm_client_t *self);
+
+/* Set the codec (ACQ_CODEC_*) requested for ACQ block transfers. Blocks are
+ * decoded transparently by bpm_acq_get_data_block, bpm_acq_get_curve and the
+ * sized variants. The server only encodes blocks when that makes them
+ * smaller. Useful for remote clients on slow links. ACQ_CODEC_SCALED16 is
+ * lossy, see sm_io_acq_codes.h for its precision, and only applies to
+ * channels of 32-bit atoms. Default is ACQ_CODEC_NONE */
+bpm_client_err_e bpm_client_set_acq_codec (bpm_client_t *self, uint32_t codec);
+
+/* Get the codec requested for ACQ block transfers */
+uint32_t bpm_client_get_acq_codec (bpm_client_t *self);
+
+/* Check the ACQ blocks against a CRC32C computed by the ACQ SMIO, or not.
+ * Blocks are then transferred as with a codec (see
+ * bpm_client_set_acq_codec ()), and blocks whose CRC does not match fail
+ * with BPM_CLIENT_ERR_MSG, so bpm_acq_get_curve requests them again. Only
+ * understood by servers that support it. Default is disabled */
+void bpm_client_set_acq_crc (bpm_client_t *self, bool enable);
+
+/* Get whether the ACQ blocks are checked against a CRC32C */
+bool bpm_client_get_acq_crc (bpm_client_t *self);
+
+/* Set the number of times bpm_acq_get_curve and bpm_acq_get_curve_resume
+ * request a block again, after it failed, before giving up. Default is
+ * ACQ_BLOCK_DFLT_RETRIES */
+void bpm_client_set_acq_block_retries (bpm_client_t *self, uint32_t retries);
+
+/* Get the number of times a block of a curve is requested again */
+uint32_t bpm_client_get_acq_block_retries (bpm_client_t *self);
+
+/* Set the memory, in bytes, all of the curves prefetched by this client (see
+ * bpm_acq_prefetch_enable ()) can take. Default is ACQ_PREFETCH_DFLT_MAX.
+ * Returns BPM_CLIENT_SUCCESS if ok or BPM_CLIENT_ERR_INV_PARAM if the
+ * prefetches enabled already take more than that */
+bpm_client_err_e bpm_client_set_acq_prefetch_max (bpm_client_t *self, size_t max);
+
+/* Get the memory all of the prefetched curves can take */
+size_t bpm_client_get_acq_prefetch_max (bpm_client_t *self);
+
+/* Set the wire format (RW_WIRE_*) of the requests sent by this client.
+ * RW_WIRE_PACKED_V1 sends each request as a single frame, which cuts the
+ * framing overhead of small requests through the broker, but is only
+ * understood by servers that support it. Choose it right after connecting.
+ * Default is RW_WIRE_FRAMES */
+bpm_client_err_e bpm_client_set_wire_format (bpm_client_t *self, uint32_t format);
+
+/* Get the wire format of the requests sent by this client */
+uint32_t bpm_client_get_wire_format (bpm_client_t *self);
+
+/* Send the requests to the services on this host through their local fast
+ * path, skipping the broker, or not. This only applies to "ipc://" broker
+ * endpoints, and a service whose fast path stops replying is reached
+ * through the broker from then on. Streamed and asynchronous requests
+ * always go through the broker. Default is enabled */
+bpm_client_err_e bpm_client_set_local_path (bpm_client_t *self, bool enable);
+
+/* Get whether the local fast path is used */
+bool bpm_client_get_local_path (bpm_client_t *self);
+
+/* Make the single parameter writes (param_client_write () and friends)
+ * return as soon as they are sent, or not. These are sent with
+ * RW_REQ_COALESCE_SUBJECT, so a burst of writes to the same parameter,
+ * e.g., from a slider, only applies the latest value once the service gets
+ * to it. Reads and waiting writes wait for the writes sent before, so they
+ * see their effect, but other requests might overtake them. Failures are
+ * returned by bpm_client_write_behind_flush (). Disabling it flushes the
+ * writes, returning the same. Default is disabled */
+bpm_client_err_e bpm_client_set_write_behind (bpm_client_t *self, bool enable);
+
+/* Get whether the parameter writes are written behind */
+bool bpm_client_get_write_behind (bpm_client_t *self);
+
+/* Wait for the write-behind writes sent to be answered. Returns
+ * BPM_CLIENT_SUCCESS if all of them, since the last flush, were applied, or
+ * the error of the first one that was not */
+bpm_client_err_e bpm_client_write_behind_flush (bpm_client_t *self);
+
+/* Resolve "service", e.g., "BPM0:DEVIO:ACQ0", to a handle, valid for the
+ * lifetime of the client. The same service always gets the same handle.
+ * Returns BPM_CLIENT_SERVICE_INVALID if too many services were resolved.
+ * High rate callers resolve their services once and pass the name returned
+ * by bpm_client_service_name () to every request. Requests recognize it
+ * without formatting or hashing the name, and reuse whatever was looked up
+ * for the service before (e.g., its local fast path or channel map) */
+uint32_t bpm_client_service_resolve (bpm_client_t *self, const char *service);
+
+/* Resolve the service of instance "inst_id" of the SMIO "smio_name", e.g.,
+ * "ACQ", of board "board", as bpm_client_service_resolve () does */
+uint32_t bpm_client_service_resolve_smio (bpm_client_t *self, uint32_t board,
+        const char *smio_name, uint32_t inst_id);
+
+/* Name of the service resolved to "handle", to be passed as the service of
+ * the requests. NULL if the handle is invalid */
+char *bpm_client_service_name (bpm_client_t *self, uint32_t handle);
+
+/* Cache the reads of the parameter of opcode "operation" of "service", such
+ * as DSP_OPCODE_SET_GET_KX, or stop caching them. Cached reads are answered
+ * by the client itself until any parameter of the service changes, which
+ * SMIOs notify on their event stream after every successful SET operation.
+ * Only parameters that change through SET operations alone should be cached,
+ * not status or monitoring values. Changes made while the broker connection
+ * is lost are not seen, so this is opt-in.
+ * Returns BPM_CLIENT_SUCCESS if ok or BPM_CLIENT_ERR_ALLOC if we could not
+ * subscribe to the change events */
+bpm_client_err_e bpm_client_set_param_cache (bpm_client_t *self, char *service,
+        uint32_t operation, bool enable);
+
 /******************** FMC130M SMIO Functions ******************/
 
 /* Blink the FMC Leds. This is only used for debug and for demostration
@@ -178,6 +509,14 @@ bpm_client_err_e bpm_set_adc_data3 (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_get_adc_data3 (bpm_client_t *self, char *service,
         uint32_t *adc_data3);
 
+/* Read num_samples samples (up to FMC_ADC_DATA_MAX_SAMPLES) of the four ADC
+ * channels at once, as opposed to the functions above, which read one channel
+ * per request. Works for both FMC130M and FMC250M services.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_SERVER if the data
+ * could not be read */
+bpm_client_err_e bpm_get_adc_data_all (bpm_client_t *self, char *service,
+        uint32_t num_samples, smio_fmc_adc_data_t *adc_data);
+
 /* ADC delay value functions */
 
 /* The three set of group functions provide a low-lovel interface to the FPGA
@@ -277,6 +616,15 @@ bpm_client_err_e bpm_set_adc_dly2 (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_set_adc_dly3 (bpm_client_t *self, char *service,
         uint32_t dly_type3, uint32_t dly_val3);
 
+/* Calibrate the ADC delays of the four channels on the server, sweeping all
+ * of the delay taps of the lines selected by dly_type with the ADC test ramp
+ * and reading the ADC data num_reads times per tap (see
+ * smio_fmc130m_4ch_dly_cal_t). Each channel is left at the center of its eye.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if the
+ * calibrated delays could not be applied */
+bpm_client_err_e bpm_adc_dly_cal (bpm_client_t *self, char *service,
+        uint32_t dly_type, uint32_t num_reads, smio_fmc130m_4ch_dly_cal_t *cal);
+
 /* FMC TEST data enable. Sets or clears the ADC test data switch. This
  * enables or disables the ADC test RAMP output.
  * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if
@@ -376,6 +724,26 @@ bpm_client_err_e bpm_get_si571_freq (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_set_si571_defaults (bpm_client_t *self, char *service,
         double si571_defaults);
 
+/* FMC clock tree profiles.
+ * Up to FMC_ACTIVE_CLK_PROFILE_NUM named profiles of AD9510 and SI571
+ * settings are read by the server from the "fmc_active_clk/profile" section
+ * of its configuration file and checked at startup. bpm_get_fmc_clk_profile ()
+ * reads the profile in "slot", failing past the last one.
+ * bpm_set_fmc_clk_profile_sel () applies a profile: the SI571 frequency, then
+ * all of the AD9510 registers followed by a single register update and,
+ * unless disabled in the profile, a wait for the PLL to lock.
+ * bpm_get_fmc_clk_profile_sel () returns the slot last applied, or
+ * FMC_ACTIVE_CLK_PROFILE_NONE if none was or the last one failed. Changes
+ * made with the single parameter functions above are not tracked.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_SERVER if
+ * if server could not complete the request */
+bpm_client_err_e bpm_get_fmc_clk_profile (bpm_client_t *self, char *service,
+        uint32_t slot, struct _smio_fmc_active_clk_profile_t *profile);
+bpm_client_err_e bpm_set_fmc_clk_profile_sel (bpm_client_t *self, char *service,
+        uint32_t fmc_clk_profile_sel);
+bpm_client_err_e bpm_get_fmc_clk_profile_sel (bpm_client_t *self, char *service,
+        uint32_t *fmc_clk_profile_sel);
+
 /******************** FMC250M SMIO Functions ******************/
 
 /* ADC ISLA216P Control */
@@ -429,8 +797,18 @@ typedef struct {
 typedef struct {
     acq_req_t req;                              /* Request */
     acq_block_t block;                          /* Block or whole curve read */
+    /* Progress of bpm_acq_get_curve (), kept when it fails, so the read
+     * can be finished by bpm_acq_get_curve_resume () */
+    uint32_t blocks_done;                       /* Blocks of the curve read */
+    uint32_t bytes_done;                        /* Bytes of block.data filled */
 } acq_trans_t;
 
+/* Default number of times a block of a curve is requested again, after
+ * failing, before the curve read fails */
+#define ACQ_BLOCK_DFLT_RETRIES                  2
+/* Default memory of the prefetched curves, see bpm_client_set_acq_prefetch_max () */
+#define ACQ_PREFETCH_DFLT_MAX                   (64 << 20)
+
 /* Acquisition channel definitions */
 typedef struct {
     uint32_t chan;
@@ -447,6 +825,16 @@ extern acq_chan_t acq_chan[END_CHAN_ID];
 bpm_client_err_e bpm_acq_start (bpm_client_t *self, char *service,
         acq_req_t *acq_req);
 
+/* Start an acquisition of all the channels selected by chan_mask (bit i
+ * selects channel i), with the parameters in acq_req. acq_req->chan is
+ * ignored. The channels are acquired one after the other, in increasing
+ * order, and bpm_acq_check/bpm_acq_wait_event report the acquisition as done
+ * when the last one is. Channels sharing the same memory can not be acquired
+ * together. Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if
+ * the server could not complete the request */
+bpm_client_err_e bpm_acq_start_multi (bpm_client_t *self, char *service,
+        acq_req_t *acq_req, uint32_t chan_mask);
+
 /* Check if apreviouly started acquisition finished.
  * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_AGAIN if the acquistion
  * did not complete */
@@ -459,6 +847,84 @@ bpm_client_err_e bpm_acq_check (bpm_client_t *self, char *service);
 bpm_client_err_e bpm_acq_check_timed (bpm_client_t *self, char *service,
         int timeout);
 
+/* Wait for the previouly started acquistion to complete with a maximum tolerated
+ * wait. Instead of polling the server, this waits for the completion event
+ * published on the "<service>:EVENTS" malamute stream. bpm_acq_check_timed
+ * uses this when possible.
+ * Returns BPM_CLIENT_SUCCESS if the acquistion finished under the specified
+ * timeout, BPM_CLIIENT_ERR_TIMEOUT if the acquistion did not completed in time
+ * or BPM_CLIENT_ERR_ALLOC if the event stream could not be subscribed */
+bpm_client_err_e bpm_acq_wait_event (bpm_client_t *self, char *service,
+        int timeout);
+
+/* Group acquisitions. The same acquisition is armed on "num_services" ACQ
+ * services at once, so all of them are waiting for the trigger before it
+ * comes. The completion events of all of them are gathered in a single
+ * wait. Status of services [i] is returned in errs [i], if "errs" is not
+ * NULL. Each function returns BPM_CLIENT_SUCCESS if all of the services
+ * succeeded, or the error of the first one that did not */
+
+/* Subscribe to the completion events of all the services, then start the
+ * acquisition described by acq_req on all of them through asynchronous
+ * requests, sent back to back. They are armed once this returns
+ * successfully, within "timeout" ms (-1 for infinite) */
+bpm_client_err_e bpm_acq_group_start (bpm_client_t *self, char **services,
+        size_t num_services, acq_req_t *acq_req, bpm_client_err_e *errs,
+        int timeout);
+
+/* Wait up to "timeout" ms (-1 for infinite) for the acquisitions started
+ * with bpm_acq_group_start () to complete on all of the services. Every
+ * completion event is confirmed with a status check, all of them in
+ * parallel, and the services no event came from are checked once more on
+ * timeout */
+bpm_client_err_e bpm_acq_group_wait (bpm_client_t *self, char **services,
+        size_t num_services, bpm_client_err_e *errs, int timeout);
+
+/* Same as bpm_acq_group_start () followed by bpm_acq_group_wait (), both
+ * within "timeout" ms (-1 for infinite) */
+bpm_client_err_e bpm_acq_group_acquire (bpm_client_t *self, char **services,
+        size_t num_services, acq_req_t *acq_req, bpm_client_err_e *errs,
+        int timeout);
+
+/* Read the curves described by acq_trans [i] from services [i] (e.g., ACQ0
+ * and ACQ1 of a board) at once. Up to "window" block requests of each
+ * service are kept in flight, so the DEVIO serves the ACQ cores in turns
+ * and none of them waits for the others to be read. Each block goes to its
+ * place in acq_trans [i].block.data as it arrives, and the number of bytes
+ * read is returned in acq_trans [i].block.bytes_read */
+bpm_client_err_e bpm_acq_group_get_curve (bpm_client_t *self, char **services,
+        size_t num_services, acq_trans_t *acq_trans, uint32_t window,
+        bpm_client_err_e *errs);
+
+/* Curve prefetch. Once enabled for a service, the curve described by
+ * acq_req is read into memory of the client as soon as its completion event
+ * is received, which happens while bpm_acq_wait_event (), bpm_acq_check_timed (),
+ * bpm_acq_group_wait () or bpm_acq_prefetch_dispatch () wait for events. A
+ * bpm_acq_get_curve () or bpm_get_curve () (with new_acq = false) of the same
+ * curve is then served from memory, once. Starting a new acquisition on the
+ * service drops the prefetched curve */
+
+/* Enable the prefetch of the curve described by acq_req on "service",
+ * replacing the one enabled before, if any. Memory for the whole curve is
+ * taken right away.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_INV_PARAM for an invalid
+ * channel, BPM_CLIENT_ERR_ALLOC if the curve does not fit in what is left of
+ * bpm_client_get_acq_prefetch_max () or the event stream could not be
+ * subscribed */
+bpm_client_err_e bpm_acq_prefetch_enable (bpm_client_t *self, char *service,
+        acq_req_t *acq_req);
+
+/* Disable the prefetch of the curves of "service", freeing its memory */
+void bpm_acq_prefetch_disable (bpm_client_t *self, char *service);
+
+/* Process the completion events received, prefetching the curves they are
+ * for, waiting up to "timeout" ms (-1 for infinite) for the first one. The
+ * events of services without prefetch are discarded. For applications that
+ * would otherwise only get to bpm_acq_get_curve () later on.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_INV_FUNCTION if no
+ * prefetch is enabled and BPM_CLIENT_INT if interrupted */
+bpm_client_err_e bpm_acq_prefetch_dispatch (bpm_client_t *self, int timeout);
+
 /* Get an specific data block from a previously completed acquisiton by setting
  * the desired block index in acq_trans->block.idx and the desired channel in
  * acq_trans->req.channel.
@@ -476,19 +942,318 @@ bpm_client_err_e bpm_acq_get_data_block (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_acq_get_curve (bpm_client_t *self, char *service,
         acq_trans_t *acq_trans);
 
+/* Finish a bpm_acq_get_curve () that failed, e.g., timed out or was
+ * interrupted, with the same acq_trans. Only the blocks not read yet,
+ * tracked in acq_trans->blocks_done and acq_trans->bytes_done, are
+ * requested, so the data already transferred is kept. The acquisition
+ * must not have been restarted meanwhile.
+ * Returns the same as bpm_acq_get_curve () */
+bpm_client_err_e bpm_acq_get_curve_resume (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+
 /* Perform a full acquisition process (Acquisition request, checking if
- * its done and receiving the full curve).
+ * its done and receiving the full curve). This takes a single request: the
+ * server waits for the acquisition to complete and streams the curve back.
  * Returns BPM_CLIENT_SUCCESS if the curve was read or BPM_CLIENT_ERR_SERVER
  * otherwise. The data read is returned in acq_trans->block.data along with
  * the number of bytes effectivly read in acq_trans->block.bytes_read */
 bpm_client_err_e bpm_full_acq (bpm_client_t *self, char *service,
         acq_trans_t *acq_trans, int timeout);
 
+/* Same as bpm_full_acq, but with the timeout in us, for acquisitions that
+ * must be answered in a few ms. A negative timeout waits forever */
+bpm_client_err_e bpm_full_acq_us (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, int64_t timeout_us);
+
 /* Compatibility version of the old bpm_full_acq. Performs a full acquisition
  * if new_acq = 1 and a curve readout if new_acq = 0*/
 bpm_client_err_e bpm_full_acq_compat (bpm_client_t *self, char *service,
         acq_trans_t *acq_trans, int timeout, bool new_acq);
 
+/* Zero-copy version of bpm_acq_get_data_block for clients running on the same
+ * host as the server. The server reads the block into a shared memory region
+ * and only a descriptor is sent back. acq_trans->block.data is set to point
+ * to the block inside the region, which must not be written by the user.
+ * The samples are valid until a new acquisition is started on the same service.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if the block could
+ * not be read or the region could not be mapped */
+bpm_client_err_e bpm_acq_get_data_block_shm (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+
+/* Zero-copy version of bpm_acq_get_curve. acq_trans->block.data is set to point
+ * to the start of the whole curve inside the shared memory region and the
+ * number of bytes available is returned in acq_trans->block.bytes_read.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_AGAIN if a new acquisition
+ * was started while the curve was being read and BPM_CLIIENT_ERR_SERVER
+ * otherwise */
+bpm_client_err_e bpm_acq_get_curve_shm (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+
+/* Streaming version of bpm_acq_get_curve. Instead of one request per block,
+ * the server pushes the blocks back-to-back and the client only grants
+ * credits for a number of blocks at a time.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER otherwise.
+ * The data read is returned in acq_trans->block.data along with the number
+ * of bytes effectively read in acq_trans->block.bytes_read */
+bpm_client_err_e bpm_acq_get_curve_stream (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+
+/* Same as bpm_acq_get_curve_stream, but the blocks are pushed by the server
+ * straight to this client, through a direct data path connection, instead of
+ * being relayed by the broker. Only the control messages go through the
+ * broker. The connection is set up on the first call for each service.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_TIMEOUT if the blocks did
+ * not arrive in time and BPM_CLIIENT_ERR_SERVER otherwise.
+ * The data read is returned in acq_trans->block.data along with the number
+ * of bytes effectively read in acq_trans->block.bytes_read */
+bpm_client_err_e bpm_acq_get_curve_direct (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+
+/* Pipelined version of bpm_acq_get_curve. Up to "window" block requests are
+ * kept in flight, so network and readout latencies overlap. A window of 1
+ * behaves exactly as bpm_acq_get_curve.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER otherwise.
+ * The data read is returned in acq_trans->block.data along with the number
+ * of bytes effectively read in acq_trans->block.bytes_read */
+bpm_client_err_e bpm_acq_get_curve_pipelined (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t window);
+
+/* Block callback of bpm_acq_get_curve_cb. "data" holds the "size" bytes of
+ * the curve from byte "offset" on, and is only valid during the call.
+ * Returns 0 to go on or anything else to stop the transfer */
+typedef int (*bpm_acq_block_fp) (bpm_client_t *self, const void *data,
+        uint64_t offset, uint32_t size, void *arg);
+
+/* Same as bpm_acq_get_curve_pipelined, but each block is handed to "cb",
+ * with "arg", as it arrives instead of being copied to acq_trans->block.data,
+ * which is not used. The blocks go through a single buffer of one block, so
+ * the memory used does not depend on the curve size, e.g., to write long
+ * multishot curves through to disk. acq_trans->blocks_done is set to the
+ * number of blocks handed to "cb".
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_AGAIN if "cb" stopped the
+ * transfer and BPM_CLIIENT_ERR_SERVER otherwise */
+bpm_client_err_e bpm_acq_get_curve_cb (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t window, bpm_acq_block_fp cb, void *arg);
+
+/* Same as bpm_acq_get_data_block, but the block size is chosen by the client.
+ * block_size must be a power of 2, not smaller than ACQ_BLOCK_SIZE_MIN and not
+ * larger than the maximum block size configured on the server (see
+ * bpm_set_acq_block_size_max). Block indexes are counted in units of block_size.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if the block could
+ * not be read or the block size was not accepted */
+bpm_client_err_e bpm_acq_get_data_block_sized (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size);
+
+/* Same as bpm_acq_get_curve, but the curve is transferred in blocks of
+ * block_size bytes. Local clients benefit from large blocks (up to a few MB),
+ * while remote ones are usually better off with smaller ones.
+ * The data read is returned in acq_trans->block.data along with the number
+ * of bytes effectively read in acq_trans->block.bytes_read */
+bpm_client_err_e bpm_acq_get_curve_sized (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size);
+
+/* Same as bpm_acq_get_data_block_sized, but the server only returns the atoms
+ * selected by atom_mask (e.g., 0x1 for the first ADC channel, see
+ * ACQ_REDUCE_NUM_ATOMS) of one out of every decim samples of the curve.
+ * Block indexes are still counted in units of block_size bytes of the
+ * full curve. Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if
+ * the block could not be read or the reduction was not accepted */
+bpm_client_err_e bpm_acq_get_data_block_reduced (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size, uint32_t atom_mask,
+        uint32_t decim);
+
+/* Same as bpm_acq_get_curve_sized, but reduced as in
+ * bpm_acq_get_data_block_reduced. The reduced curve is returned in
+ * acq_trans->block.data along with its size in acq_trans->block.bytes_read */
+bpm_client_err_e bpm_acq_get_curve_reduced (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size, uint32_t atom_mask,
+        uint32_t decim);
+
+/* Get the curves of a multi-channel acquisition. acq_trans is an array of
+ * num_trans transactions, one per channel, each with its own request and
+ * buffer. Blocks of block_size bytes of all the channels are read in a
+ * single request per block index, so block_size*num_trans must not exceed
+ * the maximum block size of the server. The data read is returned in each
+ * acq_trans[i].block.data along with its size in acq_trans[i].block.bytes_read */
+bpm_client_err_e bpm_acq_get_curve_multi (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t num_trans, uint32_t block_size);
+
+/* Start a continuous acquisition on channel chan. The channel memory is used
+ * as a ring of segments of seg_samples samples each, which must be a multiple
+ * of the channel alignment and leave room for at least ACQ_RING_MIN_NUM_SEGS
+ * segments. Only the skip trigger is supported. A few samples are lost
+ * between segments. Returns BPM_CLIENT_SUCCESS if ok and
+ * BPM_CLIIENT_ERR_SERVER if the acquisition could not be started */
+bpm_client_err_e bpm_acq_ring_start (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t seg_samples);
+
+/* Stop the continuous acquisition. Its samples can still be read with
+ * bpm_acq_ring_read until a new acquisition is started */
+bpm_client_err_e bpm_acq_ring_stop (bpm_client_t *self, char *service);
+
+/* Read up to data_size bytes of the continuous acquisition of channel chan,
+ * starting at sample *cursor (0 for the first one). On return, *cursor is
+ * the sample to read next, *bytes_read the number of bytes copied to data
+ * and *flags a combination of ACQ_RING_FLAG_*. ACQ_RING_FLAG_OVERRUN means
+ * samples were overwritten before being read and the read started at the
+ * oldest one available. Returns BPM_CLIENT_SUCCESS if ok and
+ * BPM_CLIIENT_ERR_SERVER if nothing could be read */
+bpm_client_err_e bpm_acq_ring_read (bpm_client_t *self, char *service,
+        uint32_t chan, uint64_t *cursor, uint32_t *data, uint32_t data_size,
+        uint32_t *bytes_read, uint32_t *flags);
+
+/* Start a queue of num_acqs acquisitions as described by acq_req, up to
+ * ACQ_QUEUE_MAX_ACQS. The server starts each one as soon as the previous one
+ * is done, so back-to-back triggers are not lost waiting for the client.
+ * All of the curves must fit in the channel memory. Returns
+ * BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if the queue could not
+ * be started */
+bpm_client_err_e bpm_acq_queue_start (bpm_client_t *self, char *service,
+        acq_req_t *acq_req, uint32_t num_acqs);
+
+/* Stop the acquisition queue. The acquisitions done can still be read until
+ * a new acquisition is started */
+bpm_client_err_e bpm_acq_queue_stop (bpm_client_t *self, char *service);
+
+/* Get the progress of the acquisition queue and the metadata of its
+ * acquisition index (see smio_acq_queue_info_t). Returns BPM_CLIENT_SUCCESS
+ * if ok and BPM_CLIIENT_ERR_SERVER if index is not in the queue */
+bpm_client_err_e bpm_acq_queue_get_info (bpm_client_t *self, char *service,
+        uint32_t index, smio_acq_queue_info_t *info);
+
+/* Read the curve of acquisition index of the queue into acq_trans->block.data,
+ * up to acq_trans->block.data_size bytes. acq_trans->req is set to the
+ * parameters of the acquisition and acq_trans->block.bytes_read to the number
+ * of bytes read. Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_AGAIN if the
+ * acquisition is not done yet and BPM_CLIIENT_ERR_SERVER on error */
+bpm_client_err_e bpm_acq_queue_get_curve (bpm_client_t *self, char *service,
+        uint32_t index, acq_trans_t *acq_trans);
+
+/* Get the metadata of the last acquisition of channel chan: its sequence
+ * number, trigger address, parameters and the host time its completion was
+ * detected (see smio_acq_curve_info_t). Returns BPM_CLIENT_SUCCESS if ok and
+ * BPM_CLIIENT_ERR_SERVER if the acquisition is not completed */
+bpm_client_err_e bpm_acq_get_curve_info (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_curve_info_t *info);
+
+/* Get the trigger information of the acquisition of channel chan in progress,
+ * or of its last one on ping-pong or once done: the host time its trigger was
+ * seen and how much of its curve can be read already (see
+ * smio_acq_trig_info_t). Returns BPM_CLIENT_SUCCESS if ok and
+ * BPM_CLIIENT_ERR_SERVER otherwise */
+bpm_client_err_e bpm_acq_get_trig_info (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_trig_info_t *info);
+
+/* Wait up to timeout ms (timeout < 0 waits forever) until part of the curve
+ * of the acquisition of channel chan can be read, i.e., its pre-trigger
+ * samples once its trigger was seen or the whole curve once done. The
+ * trigger events of the ACQ SMIO are used, see ACQ_EVENT_SUBJECT_TRIG.
+ * info is set as by bpm_acq_get_trig_info (). Returns BPM_CLIENT_SUCCESS if
+ * ok, BPM_CLIENT_ERR_TIMEOUT on timeout and BPM_CLIIENT_ERR_SERVER
+ * otherwise */
+bpm_client_err_e bpm_acq_wait_trig (bpm_client_t *self, char *service,
+        uint32_t chan, int timeout, smio_acq_trig_info_t *info);
+
+/* Read the part of the curve of the acquisition of channel acq_trans->req.chan
+ * that can be read already, e.g., its pre-trigger samples while the
+ * post-trigger ones are being acquired, into acq_trans->block.data, up to
+ * acq_trans->block.data_size bytes. acq_trans->block.bytes_read is set to the
+ * number of bytes read, and acq_trans->blocks_done and acq_trans->bytes_done
+ * to the whole blocks read, so bpm_acq_get_curve_resume () reads the rest of
+ * the curve once the acquisition is done. Returns BPM_CLIENT_SUCCESS if ok,
+ * BPM_CLIENT_ERR_AGAIN if nothing can be read yet and BPM_CLIIENT_ERR_SERVER
+ * otherwise */
+bpm_client_err_e bpm_acq_get_pre_trig (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+
+/* Get the statistics of the last acquisition of channel chan, per atom,
+ * computed by the server without the curve being transferred. flags is a
+ * mask of ACQ_STATS_FLAGS_*, e.g., ACQ_STATS_FLAGS_PCTL for percentiles.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if the
+ * acquisition is not completed */
+bpm_client_err_e bpm_acq_get_curve_stats (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t flags, smio_acq_curve_stats_t *stats);
+
+/* Get the min/max/mean envelope of "num_samples" samples of the last
+ * acquisition of channel chan, from sample "start" of the curve on, in at
+ * most "num_buckets" buckets (up to ACQ_ENV_MAX_BUCKETS). The range is
+ * clipped to the end of the curve, and env->num_buckets buckets of
+ * env->bucket_samples samples are returned. flags is a mask of
+ * ACQ_ENV_FLAGS_*, e.g., ACQ_ENV_FLAGS_PYRAMID to have the server keep a
+ * pyramid of the curve and serve the next envelopes of it from there.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if the
+ * acquisition is not completed or the range is not valid */
+bpm_client_err_e bpm_acq_get_envelope (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t start, uint32_t num_samples,
+        uint32_t num_buckets, uint32_t flags, smio_acq_envelope_t *env);
+
+/* Get the log of the last ACQ_TRIG_LOG_SIZE acquisitions completed on any
+ * channel, oldest first. Returns BPM_CLIENT_SUCCESS if ok and
+ * BPM_CLIIENT_ERR_SERVER if the log could not be read */
+bpm_client_err_e bpm_acq_get_trig_log (bpm_client_t *self, char *service,
+        smio_acq_trig_log_t *trig_log);
+
+/* Get the channel map of the ACQ service: the sample size and maximum number
+ * of samples of each channel. Returns BPM_CLIENT_SUCCESS if ok and
+ * BPM_CLIIENT_ERR_SERVER if the map could not be read */
+bpm_client_err_e bpm_acq_get_chan_map (bpm_client_t *self, char *service,
+        smio_acq_chan_map_t *chan_map);
+
+/* Get the descriptor of channel chan of the ACQ service, from the channel map
+ * read the first time the service is used. A curve of N samples takes
+ * N*desc->sample_size bytes. This works whatever board the service runs on.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_INV_PARAM if the
+ * channel does not exist */
+bpm_client_err_e bpm_acq_get_chan_desc (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_chan_desc_t *desc);
+
+/* Split the DDR3 of the ACQ service among its channels, part->chan_size [i]
+ * bytes for channel i (see smio_acq_partition_t), so the channels used by an
+ * operating mode get all of the memory. The last acquisition of every
+ * channel is lost. The channel map kept by this client is read again; other
+ * clients get the new one from the server or the directory. Returns
+ * BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER if the partition is
+ * not valid or an acquisition is in progress */
+bpm_client_err_e bpm_acq_set_partition (bpm_client_t *self, char *service,
+        smio_acq_partition_t *part);
+/* Get the partition of the DDR3 of the ACQ service among its channels, along
+ * with the size of the whole memory in part->mem_size */
+bpm_client_err_e bpm_acq_get_partition (bpm_client_t *self, char *service,
+        smio_acq_partition_t *part);
+
+/* Get the layout of the shots of the last acquisition of channel chan: where
+ * each shot starts and how many samples were acquired and requested, as the
+ * ACQ core acquires a few more to keep them aligned. Only the requested ones
+ * are read back (see smio_acq_shot_index_t).
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIIENT_ERR_SERVER otherwise */
+bpm_client_err_e bpm_acq_get_shot_index (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_shot_index_t *index);
+
+/* Get a single shot of the last multishot acquisition of channel
+ * acq_trans->req.chan, in blocks of block_size bytes (see
+ * bpm_acq_get_data_block_sized). The samples requested of the shot are
+ * returned in acq_trans->block.data along with their size in
+ * acq_trans->block.bytes_read. If index is not NULL, the shot index is
+ * returned in it. Returns BPM_CLIENT_SUCCESS if ok,
+ * BPM_CLIENT_ERR_INV_PARAM if the shot is out of range and
+ * BPM_CLIIENT_ERR_SERVER if it could not be read */
+bpm_client_err_e bpm_acq_get_shot (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t shot, uint32_t block_size,
+        smio_acq_shot_index_t *index);
+
+/* Get "num_samples" samples of shot "shot" (0 for single shot acquisitions)
+ * of the last acquisition of channel acq_trans->req.chan, from sample
+ * "start_sample" of the shot on. Only the range asked for is transferred,
+ * so a few samples around the trigger of a large curve are quickly read.
+ * The samples are returned in acq_trans->block.data along with their size
+ * in acq_trans->block.bytes_read, which is smaller if the range goes past
+ * the end of the shot. Returns BPM_CLIENT_SUCCESS if ok,
+ * BPM_CLIENT_ERR_INV_PARAM if the channel does not exist and
+ * BPM_CLIIENT_ERR_SERVER if the range could not be read */
+bpm_client_err_e bpm_acq_get_range (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t shot, uint32_t start_sample,
+        uint32_t num_samples);
+
 /* Macros for compatibility */
 #define bpm_data_acquire bpm_acq_start
 #define bpm_check_data_acquire bpm_acq_check
@@ -505,6 +1270,81 @@ bpm_client_err_e bpm_set_acq_trig (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_get_acq_trig (bpm_client_t *self, char *service,
         uint32_t *trig);
 
+/* Configure ping-pong acquisitions on channel chan. Options are:
+ * ACQ_PINGPONG_DISABLED, ACQ_PINGPONG_ENABLED. With ping-pong, each
+ * acquisition fills the half of the channel memory not holding the last one,
+ * so the last curve can be read while the next one is acquired, until the
+ * next one completes. Curves are then limited to half of the channel memory.
+ * The mode can not be changed while an acquisition of chan is in progress.
+ * Returns BPM_CLIENT_SUCCESS if the option was correctly set or
+ * or an error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_acq_pingpong (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t pingpong);
+bpm_client_err_e bpm_get_acq_pingpong (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t *pingpong);
+
+/* Arm the post-mortem recorder of the ACQ service for the channels of
+ * chan_mask (bit i for channel i), or disarm it with 0. From then on, every
+ * acquisition completed on these channels is written by the server to a
+ * capture file (see bpm_capture_hdr_t) in the directory given by the
+ * BPM_ACQ_PM_DIR environment variable of the server, without the curve
+ * going through the broker.
+ * Returns BPM_CLIENT_SUCCESS if the recorder was correctly set or
+ * or an error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_acq_pm (bpm_client_t *self, char *service,
+        uint32_t chan_mask);
+bpm_client_err_e bpm_get_acq_pm (bpm_client_t *self, char *service,
+        uint32_t *chan_mask);
+
+/* Set the capacity, in samples, of the position stream of the ACQ service,
+ * or disable it with 0. The capacity must be a power of 2 from
+ * ACQ_PSTREAM_MIN_SAMPLES to ACQ_PSTREAM_MAX_SAMPLES. Every continuous
+ * acquisition started from then on (see bpm_acq_ring_start) also copies each
+ * of its segments to a shared memory ring that consumers on the same host
+ * read with bpm_pstream_open, with no request to the server.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_SERVER if the
+ * capacity is not valid or a continuous acquisition is in progress */
+bpm_client_err_e bpm_set_acq_pstream (bpm_client_t *self, char *service,
+        uint32_t capacity);
+bpm_client_err_e bpm_get_acq_pstream (bpm_client_t *self, char *service,
+        uint32_t *capacity);
+
+/* Publish every acquisition completed from then on on the channels of
+ * chan_mask (bit i for channel i) to all the clients subscribed with
+ * bpm_acq_mcast_subscribe, or stop it with 0. The server reads each curve
+ * once, whatever the number of subscribers. See ACQ_EVENT_SUBJECT_DATA.
+ * Returns BPM_CLIENT_SUCCESS if the multicast was correctly set or
+ * or an error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_acq_mcast (bpm_client_t *self, char *service,
+        uint32_t chan_mask);
+bpm_client_err_e bpm_get_acq_mcast (bpm_client_t *self, char *service,
+        uint32_t *chan_mask);
+
+/* Subscribe to the blocks of the acquisitions published by the ACQ service,
+ * see bpm_set_acq_mcast. Blocks published before subscribing are not
+ * received. Several services can be subscribed to.
+ * Returns BPM_CLIENT_SUCCESS if ok or an error (see bpm_client_err.h for
+ * all possible errors)*/
+bpm_client_err_e bpm_acq_mcast_subscribe (bpm_client_t *self, char *service);
+
+/* Receive the next block published by any of the services subscribed to,
+ * waiting up to "timeout" ms (-1 for no limit). "hdr" tells the curve the
+ * block belongs to and where, and its data is copied to "data", of "size"
+ * bytes, which must hold up to ACQ_MCAST_BLOCK_SIZE bytes. Blocks of a
+ * curve come in order, but a curve overwritten while being published
+ * is cut short, so check "hdr->seq" and "hdr->offs".
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_TIMEOUT if no block came
+ * in time or an error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_acq_mcast_recv (bpm_client_t *self,
+        smio_acq_mcast_hdr_t *hdr, void *data, uint32_t size, int timeout);
+
+/* Get the state and counters of the post-mortem recorder of the ACQ
+ * service, see smio_acq_pm_info_t.
+ * Returns BPM_CLIENT_SUCCESS if ok or an error (see bpm_client_err.h for
+ * all possible errors)*/
+bpm_client_err_e bpm_acq_get_pm_info (bpm_client_t *self, char *service,
+        smio_acq_pm_info_t *info);
+
 /* Configure data-driven trigger polarity. Options are: 0 -> positive slope (
  * 0 -> 1), 1 -> negative slope (1 -> 0).
  * Returns BPM_CLIENT_SUCCESS if the trigger was correctly set or
@@ -582,6 +1422,16 @@ bpm_client_err_e bpm_set_acq_data_trig_chan (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_get_acq_data_trig_chan (bpm_client_t *self, char *service,
         uint32_t *data_trig_chan);
 
+/* Configure the maximum block size clients can request with
+ * bpm_acq_get_data_block_sized. block_size_max must be a power of 2 between
+ * ACQ_BLOCK_SIZE_MIN and ACQ_BLOCK_SIZE_MAX.
+ * Returns BPM_CLIENT_SUCCESS if the value was correctly set or
+ * or an error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_acq_block_size_max (bpm_client_t *self, char *service,
+        uint32_t block_size_max);
+bpm_client_err_e bpm_get_acq_block_size_max (bpm_client_t *self, char *service,
+        uint32_t *block_size_max);
+
 /********************** DSP Functions ********************/
 
 /* K<direction> functions */
@@ -678,6 +1528,117 @@ bpm_client_err_e bpm_set_monit_updt (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_get_monit_updt (bpm_client_t *self, char *service,
         uint32_t *monit_updt);
 
+/* Read all of the monitoring AMP/POS values and the MONIT_UPDT register in a
+ * single request. The values are read in one sweep, so they always belong to
+ * the same update, unlike reading them one by one. If "updt" is not 0, new
+ * values are latched before reading, as with bpm_set_monit_updt ().
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_SERVER if the values
+ * could not be read */
+bpm_client_err_e bpm_get_monit_snapshot (bpm_client_t *self, char *service,
+        uint32_t updt, smio_dsp_monit_t *monit);
+
+/* Same as bpm_get_monit_snapshot, for many DSP services at once. See
+ * bpm_func_exec_multi () */
+bpm_client_err_e bpm_get_monit_snapshot_multi (bpm_client_t *self, char **services,
+        size_t num_services, uint32_t updt, smio_dsp_monit_t *monits,
+        bpm_client_err_e *errs, int timeout);
+
+/* Read the monitoring updates kept by the DSP SMIO after "since", a sequence
+ * number if "by" is DSP_MONIT_HIST_SINCE_SEQ or a timestamp if it is
+ * DSP_MONIT_HIST_SINCE_TS, oldest first. At most DSP_MONIT_HIST_BATCH
+ * records are returned at a time, so call it again from the last one when
+ * hist->num_records is DSP_MONIT_HIST_BATCH. Updates are only kept while the
+ * monitoring stream is enabled, see bpm_set_monit_poll_time ().
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_SERVER if the history
+ * could not be read */
+bpm_client_err_e bpm_get_monit_history (bpm_client_t *self, char *service,
+        uint32_t by, uint64_t since, smio_dsp_monit_hist_t *hist);
+
+/* Monitoring stream period */
+/* These set of functions write (set) or read (get) the period, in ms, in
+ * which the DSP SMIO updates the AMP/POS values and publishes them on the
+ * "<service>:MONIT" malamute stream. 0 disables the stream.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the
+ * parameter was correctly set or error (see bpm_client_err.h
+ * for all possible errors)*/
+bpm_client_err_e bpm_set_monit_poll_time (bpm_client_t *self, char *service,
+        uint32_t monit_poll_time);
+bpm_client_err_e bpm_get_monit_poll_time (bpm_client_t *self, char *service,
+        uint32_t *monit_poll_time);
+
+/* Monitoring stream encodings */
+/* These set of functions write (set) or read (get) the encodings in which
+ * the DSP SMIO publishes the monitoring stream, any combination of
+ * DSP_MONIT_ENC_FULL and DSP_MONIT_ENC_DELTA. Only DSP_MONIT_ENC_FULL is
+ * published by default.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the
+ * parameter was correctly set or error (see bpm_client_err.h
+ * for all possible errors)*/
+bpm_client_err_e bpm_set_monit_enc (bpm_client_t *self, char *service,
+        uint32_t monit_enc);
+bpm_client_err_e bpm_get_monit_enc (bpm_client_t *self, char *service,
+        uint32_t *monit_enc);
+
+/* Set the conditions on the monitoring stream of the DSP service that fire
+ * the software trigger of the ACQ service of the same BPM, evaluated by the
+ * DSP SMIO on every update (see smio_dsp_trig_t). This reacts within the
+ * monitoring stream period, bpm_set_monit_poll_time (), with no round trip
+ * to any client. DSP_TRIG_MODE_OFF disarms it. Returns BPM_CLIENT_SUCCESS
+ * if ok and BPM_CLIENT_ERR_SERVER if the conditions are not valid */
+bpm_client_err_e bpm_set_monit_trig (bpm_client_t *self, char *service,
+        smio_dsp_trig_t *trig);
+/* Get the conditions firing the software trigger */
+bpm_client_err_e bpm_get_monit_trig (bpm_client_t *self, char *service,
+        smio_dsp_trig_t *trig);
+
+/* These set of functions write (set) or read (get) the times the software
+ * trigger of bpm_set_monit_trig () fired.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the
+ * parameter was correctly set or error (see bpm_client_err.h
+ * for all possible errors)*/
+bpm_client_err_e bpm_set_monit_trig_count (bpm_client_t *self, char *service,
+        uint32_t monit_trig_count);
+bpm_client_err_e bpm_get_monit_trig_count (bpm_client_t *self, char *service,
+        uint32_t *monit_trig_count);
+
+/* Set the decimations of the downsampled monitoring streams of the DSP
+ * service (see smio_dsp_monit_ds_t), each one publishing the mean of every
+ * "decim [i]" updates and 0 disabling it. Returns BPM_CLIENT_SUCCESS if ok
+ * and BPM_CLIENT_ERR_SERVER if any decimation is out of range */
+bpm_client_err_e bpm_set_monit_ds (bpm_client_t *self, char *service,
+        smio_dsp_monit_ds_t *monit_ds);
+/* Get the decimations of the downsampled monitoring streams */
+bpm_client_err_e bpm_get_monit_ds (bpm_client_t *self, char *service,
+        smio_dsp_monit_ds_t *monit_ds);
+
+/* Subscribe to the monitoring stream of a DSP service. Streams of several
+ * services can be subscribed to. The data is received with bpm_monit_recv.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_ALLOC if the stream
+ * could not be subscribed */
+bpm_client_err_e bpm_monit_subscribe (bpm_client_t *self, char *service);
+
+/* Same as bpm_monit_subscribe, for the delta encoded monitoring stream of a
+ * DSP service, which must be enabled with bpm_set_monit_enc (). Updates are
+ * decoded by bpm_monit_recv, which skips the ones following a missed update
+ * until the next keyframe arrives */
+bpm_client_err_e bpm_monit_subscribe_delta (bpm_client_t *self, char *service);
+
+/* Same as bpm_monit_subscribe, for the downsampled monitoring stream "ds"
+ * (< DSP_MONIT_DS_MAX) of a DSP service, enabled with bpm_set_monit_ds ().
+ * Only the averaged updates are received, so a slow consumer does not get
+ * the full rate ones to average on its own */
+bpm_client_err_e bpm_monit_subscribe_ds (bpm_client_t *self, char *service,
+        uint32_t ds);
+
+/* Wait up to "timeout" ms (-1 for infinite) for the next monitoring update of
+ * any subscribed service. If "service" is not NULL, the name of the service
+ * the update came from is returned in it, and must be freed by the caller.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_TIMEOUT if no update
+ * arrived in time or BPM_CLIENT_ERR_INV_FUNCTION if no stream was
+ * subscribed to */
+bpm_client_err_e bpm_monit_recv (bpm_client_t *self, smio_dsp_monit_t *monit,
+        char **service, int timeout);
+
 /********************** SWAP Functions ********************/
 
 /* Switching functions */
@@ -763,6 +1724,32 @@ bpm_client_err_e bpm_set_gain_d (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_get_gain_d (bpm_client_t *self, char *service,
         uint32_t *gain_dir, uint32_t *gain_inv);
 
+/* Switching and gain profile functions */
+/* A profile holds the switching mode, switching clock enable and divisor,
+ * delays, windowing and the four gains, all applied with a single register
+ * block write, so the measurement never sees a partially applied setup.
+ * bpm_set_swap_profile () applies a profile right away and bpm_get_swap_profile
+ * () reads the current one. Up to SWAP_PROFILE_NUM named profiles can be
+ * stored in the server with bpm_set_swap_profile_slot (), without applying
+ * them, and then applied with bpm_set_swap_profile_sel (). bpm_get_swap_profile_sel
+ * () returns the slot last applied, or SWAP_PROFILE_NONE if a profile was
+ * applied directly since. Changes made with the single parameter functions
+ * above are not tracked.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_swap_profile (bpm_client_t *self, char *service,
+        struct _smio_swap_profile_t *profile);
+bpm_client_err_e bpm_get_swap_profile (bpm_client_t *self, char *service,
+        struct _smio_swap_profile_t *profile);
+bpm_client_err_e bpm_set_swap_profile_slot (bpm_client_t *self, char *service,
+        uint32_t slot, struct _smio_swap_profile_t *profile);
+bpm_client_err_e bpm_get_swap_profile_slot (bpm_client_t *self, char *service,
+        uint32_t slot, struct _smio_swap_profile_t *profile);
+bpm_client_err_e bpm_set_swap_profile_sel (bpm_client_t *self, char *service,
+        uint32_t swap_profile_sel);
+bpm_client_err_e bpm_get_swap_profile_sel (bpm_client_t *self, char *service,
+        uint32_t *swap_profile_sel);
+
 /********************** RFFE Functions ********************/
 
 /* Switching functions */
@@ -879,6 +1866,28 @@ bpm_client_err_e bpm_set_rffe_sw_lvl (bpm_client_t *self, char *service,
 bpm_client_err_e bpm_get_rffe_sw_lvl (bpm_client_t *self, char *service,
         uint32_t *rffe_sw_lvl);
 
+/* Monitoring functions */
+/* Read (get) the RFFE attenuators, temperatures and temperature set points
+ * in a single request. The RFFE is asked for all of them at once, so this
+ * is much faster than reading them one by one. Values come from the server
+ * cache while it is fresh, and rffe_monit->age tells how old they are.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_SERVER if the values
+ * could not be read */
+bpm_client_err_e bpm_get_rffe_monit (bpm_client_t *self, char *service,
+        smio_rffe_monit_t *rffe_monit);
+
+/* Cache poll time functions */
+/* These set of functions write (set) or read (get) the period, in ms, in
+ * which the server refreshes its cache of the RFFE monitored variables.
+ * While the cache is fresh, reads of these variables are served from it,
+ * without going to the RFFE. 0 disables the cache.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_rffe_cache_poll_time (bpm_client_t *self, char *service,
+        uint32_t rffe_cache_poll_time);
+bpm_client_err_e bpm_get_rffe_cache_poll_time (bpm_client_t *self, char *service,
+        uint32_t *rffe_cache_poll_time);
+
 /********************** AFC Diagnostics Functions ********************/
 /* AFC Card Slot functions */
 /* These set of functions write (set) read (get) the card slot.
@@ -912,6 +1921,16 @@ bpm_client_err_e bpm_get_afc_diag_build_user_name (bpm_client_t *self, char *ser
 bpm_client_err_e bpm_get_afc_diag_build_user_email (bpm_client_t *self, char *service,
         struct _smio_afc_diag_revision_data_t *revision_data);
 
+/* AFC Identity function */
+/* Reads (gets) the card slot, IPMI address and all of the revision
+ * information at once. None of it changes while the FPGA is loaded, so it is
+ * only read from the service the first time, until bpm_set_afc_diag_card_slot ()
+ * or bpm_set_afc_diag_ipmi_addr () is called for it. Returns BPM_CLIENT_SUCCESS
+ * if the identity was read or error (see bpm_client_err.h for all possible
+ * errors)*/
+bpm_client_err_e bpm_get_afc_diag_identity (bpm_client_t *self, char *service,
+        struct _smio_afc_diag_identity_t *identity);
+
 /****************************** Trigger Functions ****************************/
 
 /* Trigger Direction functions */
@@ -1020,6 +2039,123 @@ bpm_client_err_e bpm_set_trigger_transm_out_sel (bpm_client_t *self, char *servi
 bpm_client_err_e bpm_get_trigger_transm_out_sel (bpm_client_t *self, char *service,
         uint32_t chan, uint32_t *transm_out_sel);
 
+/* Trigger Table functions */
+/* These set of functions write (set) or read (get) the configuration of all
+ * of the trigger channels at once, with a single register block access. This
+ * replaces the per-channel functions above when reconfiguring the whole
+ * timing system. The interface table holds the direction, polarity, counter
+ * resets and lengths of each channel and the mux table holds its routing.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_trigger_iface_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_iface_table_t *table);
+bpm_client_err_e bpm_get_trigger_iface_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_iface_table_t *table);
+bpm_client_err_e bpm_set_trigger_mux_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_mux_table_t *table);
+bpm_client_err_e bpm_get_trigger_mux_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_mux_table_t *table);
+
+/* Trigger Counters function */
+/* This function reads (get) the receive and transmit pulse counters of all
+ * of the trigger channels at once, with a single register block read, along
+ * with the host time they were read at. It is meant for polling the
+ * counters of all of the channels at a high rate.
+ * It returns BPM_CLIENT_SUCCESS if the counters were correctly read or error
+ * (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_get_trigger_iface_counters (bpm_client_t *self, char *service,
+        struct _smio_trigger_iface_counters_t *counters);
+
+/* Trigger event stream period */
+/* These set of functions write (set) or read (get) the period, in ms, in
+ * which the TRIGGER_IFACE SMIO reads the pulse counters and publishes a
+ * trigger event for each channel whose counters changed on the
+ * "<service>:EVENTS" malamute stream. 0 disables the stream.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the
+ * parameter was correctly set or error (see bpm_client_err.h
+ * for all possible errors)*/
+bpm_client_err_e bpm_set_trigger_event_poll_time (bpm_client_t *self, char *service,
+        uint32_t trigger_event_poll_time);
+bpm_client_err_e bpm_get_trigger_event_poll_time (bpm_client_t *self, char *service,
+        uint32_t *trigger_event_poll_time);
+
+/* Subscribe to the trigger events of channel "chan" of a TRIGGER_IFACE
+ * service, or of all of its channels if "chan" is TRIGGER_IFACE_NUM_CHAN.
+ * Events of several services and channels can be subscribed to. They are
+ * received with bpm_trigger_event_recv, instead of polling the counters.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_ALLOC if the stream
+ * could not be subscribed */
+bpm_client_err_e bpm_trigger_event_subscribe (bpm_client_t *self, char *service,
+        uint32_t chan);
+
+/* Wait up to "timeout" ms (-1 for infinite) for the next trigger event of
+ * any subscribed service and channel. If "service" is not NULL, the name of
+ * the service the event came from is returned in it, and must be freed by
+ * the caller. Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_TIMEOUT if no
+ * event arrived in time or BPM_CLIENT_ERR_INV_FUNCTION if no stream was
+ * subscribed to */
+bpm_client_err_e bpm_trigger_event_recv (bpm_client_t *self,
+        struct _smio_trigger_iface_event_t *event, char **service, int timeout);
+
+/************************** Generic SMIO Functions **************************/
+
+/* Operation statistics functions */
+/* This function reads (get) the counters and latency histogram of the
+ * operation "opcode" of any SMIO, as measured by the SMIO from receiving
+ * the request to sending the reply. If "flags" has SMIO_OP_STATS_FLAG_RESET
+ * set, the counters are reset after being read. Latency percentiles can be
+ * estimated from the histogram with smio_op_stats_percentile ().
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_get_op_stats (bpm_client_t *self, char *service,
+        uint32_t opcode, uint32_t flags, struct _smio_op_stats_t *stats);
+
+/* Request queue functions */
+/* These set or get the requests per second any SMIO serves to each client
+ * ("rate_limit"), 0 meaning no limit. Clients take turns regardless, so a
+ * client flooding a service only delays its own requests. Limited clients
+ * may still send a second worth of requests at once.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_set_rate_limit (bpm_client_t *self, char *service,
+        uint32_t rate_limit);
+bpm_client_err_e bpm_get_rate_limit (bpm_client_t *self, char *service,
+        uint32_t *rate_limit);
+
+/* This function reads (get) the request queue counters of any SMIO, such
+ * as the number of requests waiting. If "flags" has
+ * SMIO_QUEUE_STATS_FLAG_RESET set, the counters are reset after being read.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_get_queue_stats (bpm_client_t *self, char *service,
+        uint32_t flags, struct _smio_queue_stats_t *stats);
+
+/* This function reads (get) where the startup time of any SMIO went, from
+ * its spawn by the DEVIO to the end of its default configuration. The
+ * phases of an SMIO that is still starting up are 0 until done.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_get_startup_stats (bpm_client_t *self, char *service,
+        struct _smio_startup_stats_t *stats);
+
+/* This function reads (get) the allocations made by any SMIO by subsystem
+ * and by opcode, to tell where allocation churn goes. They are only counted
+ * ("stats->enabled") by DEVIOs built with ALLOC_ACCT=y. If "flags" has
+ * SMIO_ALLOC_STATS_FLAG_RESET set, the counters are reset after being read.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_get_alloc_stats (bpm_client_t *self, char *service,
+        uint32_t flags, struct _smio_alloc_stats_t *stats);
+
+/* This function reads (get) the liveness of any SMIO: its uptime, the
+ * requests waiting and its last failed request. It is served ahead of any
+ * request waiting and never touches the hardware, so it is cheap enough
+ * for scanning the health of every board.
+ * All of the functions returns BPM_CLIENT_SUCCESS if the parameter was
+ * correctly set or error (see bpm_client_err.h for all possible errors)*/
+bpm_client_err_e bpm_ping (bpm_client_t *self, char *service,
+        struct _smio_ping_t *ping);
+
 /****************************** Helper Functions ****************************/
 /* Helper Function */
 
@@ -1031,6 +2167,12 @@ bpm_client_err_e bpm_get_trigger_transm_out_sel (bpm_client_t *self, char *servi
 bpm_client_err_e func_polling (bpm_client_t *self, char *name,
         char *service, uint32_t *input, uint32_t *output, int timeout);
 
+/* Same as func_polling, but with the timeout in us. The function is tried
+ * again after a wait that starts at a few us and doubles up to 1 ms, and
+ * neither the waits nor the tries go past the timeout */
+bpm_client_err_e func_polling_us (bpm_client_t *self, char *name,
+        char *service, uint32_t *input, uint32_t *output, int64_t timeout_us);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_DIR_H_
+#define _BPM_CLIENT_DIR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Broker directory. With the broker sharded by board (see the shards
+ * property of the dev_mngr broker), each service is on the shard of its
+ * board, see hutils_broker_shard (). A directory knows the endpoint of
+ * every shard and keeps one client connected to each of the shards used,
+ * created on demand with the same settings. Services whose names carry no
+ * board ID are on shard 0 */
+
+/* Creates a directory of "num_shards" broker shards, the first one at
+ * "broker_endp". The clients are created as with bpm_client_new_time () */
+bpm_broker_dir_t *bpm_broker_dir_new (char *broker_endp, uint32_t num_shards,
+        int verbose, const char *log_file_name, int timeout);
+/* Creates a directory from the broker section of the configuration file
+ * "cfg_file", i.e., the /dev_mngr/broker/bind and /dev_mngr/broker/shards
+ * properties of the file the dev_mngr runs with */
+bpm_broker_dir_t *bpm_broker_dir_new_cfg (const char *cfg_file, int verbose,
+        const char *log_file_name, int timeout);
+/* Destroy a directory and all of its clients */
+void bpm_broker_dir_destroy (bpm_broker_dir_t **self_p);
+
+/* Get the number of shards of the directory */
+uint32_t bpm_broker_dir_get_shards (bpm_broker_dir_t *self);
+/* Get the shard "service" is on */
+uint32_t bpm_broker_dir_lookup (bpm_broker_dir_t *self, const char *service);
+/* Get the endpoint of the shard "service" is on. Owned by the directory */
+const char *bpm_broker_dir_lookup_endp (bpm_broker_dir_t *self,
+        const char *service);
+/* Get the client connected to the shard "service" is on, connecting it if
+ * needed. The client is owned by the directory, so it must not be destroyed.
+ * Returns NULL if it could not be connected */
+bpm_client_t *bpm_broker_dir_get_client (bpm_broker_dir_t *self,
+        const char *service);
+
+/* Crate directory. The dev_mngr answers for SMIO_DIR_SERVICE on every
+ * shard with all of the DEVIOs it manages and all of the SMIOs registered
+ * by them, so clients need not probe each service. SMIOs spawned on demand
+ * are only listed once running */
+
+/* Get the crate directory through "client", in a single request. Returns
+ * BPM_CLIENT_SUCCESS if the directory was read or error (see
+ * bpm_client_err.h for all possible errors) */
+bpm_client_err_e bpm_get_crate_dir (bpm_client_t *client,
+        bpm_crate_dir_t **dir_p);
+/* Same as bpm_get_crate_dir (), through the client of shard 0 */
+bpm_client_err_e bpm_broker_dir_get_crate_dir (bpm_broker_dir_t *self,
+        bpm_crate_dir_t **dir_p);
+/* Destroy a crate directory */
+void bpm_crate_dir_destroy (bpm_crate_dir_t **self_p);
+
+/* Get the number of DEVIOs in the crate directory */
+uint32_t bpm_crate_dir_get_num_devios (bpm_crate_dir_t *self);
+/* Get DEVIO "index", from 0 to bpm_crate_dir_get_num_devios () - 1. Its
+ * state is one of the SMIO_DIR_DEVIO_* ones. Owned by the directory */
+const smio_dir_devio_t *bpm_crate_dir_get_devio (bpm_crate_dir_t *self,
+        uint32_t index);
+/* Get the number of services in the crate directory */
+uint32_t bpm_crate_dir_get_num_services (bpm_crate_dir_t *self);
+/* Get service "index", from 0 to bpm_crate_dir_get_num_services () - 1.
+ * Its DEVIO is the one with the same PID. Owned by the directory */
+const smio_dir_service_t *bpm_crate_dir_get_service (bpm_crate_dir_t *self,
+        uint32_t index);
+/* Get the names of the operations exported by service "index", separated
+ * by spaces. Owned by the directory */
+const char *bpm_crate_dir_get_service_ops (bpm_crate_dir_t *self,
+        uint32_t index);
+/* Get the information registered by service "index", setting its size in
+ * "size", e.g., the smio_acq_chan_map_t of an ACQ service. NULL if it
+ * registered none. Owned by the directory */
+const void *bpm_crate_dir_get_service_info (bpm_crate_dir_t *self,
+        uint32_t index, size_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_INTEG_H_
+#define _BPM_CLIENT_INTEG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Integrity check of ADC acquisitions (e.g., ADC0) taken with the ADC test
+ * data enabled (see bpm_set_adc_test_data_en ()), in which each channel is a
+ * 16-bit counter. Samples are made of BPM_INTEG_NUM_CHAN interleaved signed
+ * 16-bit channels, and each one must be the previous one plus 1, wrapping
+ * around from 32767 to -32768. Blocks of the same acquisition can be checked
+ * as they arrive, the state carrying the last sample over to the next block */
+
+#define BPM_INTEG_NUM_CHAN              4
+
+/* Sample out of sequence */
+typedef struct {
+    uint64_t offset;                            /* Sample number since
+                                                   bpm_integ_reset () */
+    uint32_t chan_mask;                         /* Channels out of sequence.
+                                                   Bit 0 is channel A */
+    int16_t expected [BPM_INTEG_NUM_CHAN];      /* Previous sample plus 1 */
+    int16_t found [BPM_INTEG_NUM_CHAN];         /* Sample read */
+} bpm_integ_gap_t;
+
+/* Check state */
+typedef struct {
+    uint64_t num_samples;                       /* Samples checked */
+    uint64_t num_gaps;                          /* Gaps found, including the
+                                                   ones not reported */
+    int16_t last [BPM_INTEG_NUM_CHAN];          /* Last sample checked */
+} bpm_integ_state_t;
+
+/* Start a new check. The first sample checked after it is never a gap */
+void bpm_integ_reset (bpm_integ_state_t *state);
+
+/* Name of the kernels used on this CPU (e.g., "avx2"), for diagnostics */
+const char *bpm_integ_kernel_name (void);
+
+/* Check the "num_samples" samples of "data", following the ones already
+ * checked with "state". The sequence restarts at each gap, so a single
+ * missing block is reported once. Up to "max_gaps" gaps are written to
+ * "gaps", in order, and their number is returned. All of them are counted
+ * in state->num_gaps */
+size_t bpm_integ_check (bpm_integ_state_t *state, const int16_t *data,
+        size_t num_samples, bpm_integ_gap_t *gaps, size_t max_gaps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_MONIT_GW_H_
+#define _BPM_CLIENT_MONIT_GW_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Orbit-wide monitoring records, as published by the monitoring gateway
+ * (monit_gw). The gateway subscribes once to the monitoring stream of every
+ * BPM of every crate and merges the updates into one record per period,
+ * published on the "<gateway name>:EVENTS" malamute stream of its own
+ * broker, so consumers need a single subscription instead of one per BPM.
+ *
+ * Updates are aligned by their timestamp: the record of slot "s" holds the
+ * updates taken from s*period to (s+1)*period ns since the Epoch. A record
+ * is published once all of the BPMs updated in its slot, or "latency" ms
+ * after the slot ended. BPMs that did not update in time are left out of
+ * it, without BPM_MONIT_GW_BPM_VALID. Records are published in slot order,
+ * with no record for the slots no BPM updated in.
+ *
+ * A BPM_MONIT_GW_SUBJECT_ORBIT message is a single frame, a
+ * bpm_monit_gw_hdr_t followed by "num_bpms" bpm_monit_gw_bpm_t. The BPMs
+ * are always in the same order, given by the BPM_MONIT_GW_SUBJECT_MAP
+ * message published every BPM_MONIT_GW_MAP_INTERVAL ms, whose frame i
+ * holds the "<broker endpoint> <service>" of BPM i */
+#define BPM_MONIT_GW_STREAM_SUFFIX          SMIO_EVENT_STREAM_SUFFIX
+#define BPM_MONIT_GW_SUBJECT_ORBIT          "ORBIT"
+#define BPM_MONIT_GW_SUBJECT_MAP            "ORBIT_MAP"
+#define BPM_MONIT_GW_MAP_INTERVAL           1000    /* in msec */
+
+/* Flags of the BPMs of a record */
+#define BPM_MONIT_GW_BPM_VALID              (1 << 0)    /* Updated in the slot */
+#define BPM_MONIT_GW_BPM_DUP                (1 << 1)    /* Updated more than once
+                                                           in the slot. The last
+                                                           update is kept */
+
+typedef struct {
+    uint64_t timestamp;             /* slot start in ns since the Epoch */
+    uint32_t seq;                   /* record sequence number */
+    uint32_t period;                /* slot length in ms */
+    uint32_t num_bpms;              /* number of BPMs following */
+    uint32_t num_valid;             /* BPMs updated in the slot */
+} bpm_monit_gw_hdr_t;
+
+typedef struct {
+    uint32_t seq;                   /* update sequence number of the BPM */
+    uint32_t flags;                 /* BPM_MONIT_GW_BPM_* */
+    int32_t dt;                     /* update time relative to the slot
+                                       start, in us */
+    int32_t pos_x;                  /* monitoring position X */
+    int32_t pos_y;                  /* monitoring position Y */
+    int32_t pos_q;                  /* monitoring position Q */
+    int32_t pos_sum;                /* monitoring position SUM */
+} bpm_monit_gw_bpm_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
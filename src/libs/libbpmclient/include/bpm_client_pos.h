@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_POS_H_
+#define _BPM_CLIENT_POS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Position calculation from amplitude curves (e.g., TBTAMP0 or FOFBAMP0
+ * acquisitions), as the POS_CALC core does in the FPGA. Samples are made of
+ * BPM_POS_NUM_CHAN interleaved amplitudes, A to D, and are replaced by
+ * X, Y, Q and SUM, using the delta-over-sum of the diagonal arrangement:
+ *
+ *   X   = KX * ((A + D) - (B + C)) / S
+ *   Y   = KY * ((A + B) - (C + D)) / S
+ *   Q   =      ((A + C) - (B + D)) / S
+ *   SUM = KSUM * S, with S = A + B + C + D
+ *
+ * If S is 0 or below the delta-over-sum threshold, X, Y and Q are 0 */
+
+#define BPM_POS_NUM_CHAN                4
+/* Fractional bits of Q in the fixed-point results */
+#define BPM_POS_Q_FRAC_BITS             24
+
+/* Parameters of the calculation, as read with bpm_get_kx (), bpm_get_ky (),
+ * bpm_get_ksum () and bpm_get_ds_tbt_thres () (or fofb) */
+typedef struct {
+    uint32_t kx;                    /* nm */
+    uint32_t ky;                    /* nm */
+    uint32_t ksum;                  /* FIX25_0 */
+    uint32_t thres;                 /* Minimum S */
+} bpm_pos_k_t;
+
+/* Name of the kernels used on this CPU (e.g., "avx"), for diagnostics */
+const char *bpm_pos_kernel_name (void);
+
+/* Replace each of the "num_samples" samples of "data", 4 unsigned 32-bit
+ * amplitudes, in place by its X, Y, Q and SUM as signed 32-bit, laid out
+ * as TBTPOS0 samples. X and Y are in nm, truncated towards 0, Q has
+ * BPM_POS_Q_FRAC_BITS fractional bits and SUM saturates at INT32_MAX.
+ * The result is the same on all of the kernels */
+void bpm_pos_calc (uint32_t *data, size_t num_samples, const bpm_pos_k_t *k);
+
+/* Same as bpm_pos_calc (), in single precision, for amplitudes already
+ * converted to floats. X and Y are in nm and Q is a fraction of 1 */
+void bpm_pos_calc_float (float *data, size_t num_samples, const bpm_pos_k_t *k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_PSTREAM_H_
+#define _BPM_CLIENT_PSTREAM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Position stream of an ACQ service running on the same host, see
+ * smio_acq_pstream_hdr_t. The ring is mapped once and the samples are
+ * copied straight from it, with no request to the server, as soon as every
+ * segment of the continuous acquisition is done. The stream exists only
+ * while the continuous acquisition runs with a position stream capacity
+ * set (see bpm_set_acq_pstream), so open it again for the next one. A
+ * reader that falls more than the ring capacity behind skips the samples
+ * overwritten meanwhile, see bpm_pstream_get_lost. A bpm_pstream_t must not
+ * be shared among threads */
+
+/* Map the position stream of "service" (e.g., "BPM0:DEVIO:ACQ0"). Reading
+ * starts from the newest sample. Returns NULL if there is no stream */
+bpm_pstream_t *bpm_pstream_open (const char *service);
+/* Unmap the position stream */
+void bpm_pstream_close (bpm_pstream_t **self_p);
+
+/* Channel streamed */
+uint32_t bpm_pstream_get_chan (bpm_pstream_t *self);
+/* Sample size, in bytes */
+uint32_t bpm_pstream_get_sample_size (bpm_pstream_t *self);
+/* Samples skipped so far for being overwritten before they were read */
+uint64_t bpm_pstream_get_lost (bpm_pstream_t *self);
+
+/* Copy up to "max_samples" of the samples after the last ones read to
+ * "data", waiting up to "timeout_us" us (-1 for no limit) for any of them.
+ * The wait spins, so it uses a core. "*num_samples" is set to the samples
+ * copied and "*start", if not NULL, to the index of the first one in the
+ * stream. Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_TIMEOUT if no
+ * samples came in time and BPM_CLIENT_ERR_SERVER if the continuous
+ * acquisition stopped and all of its samples were read */
+bpm_client_err_e bpm_pstream_read (bpm_pstream_t *self, void *data,
+        uint32_t max_samples, int64_t timeout_us, uint32_t *num_samples,
+        uint64_t *start);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -103,6 +103,16 @@ bpm_client_err_e param_client_write_read_double (bpm_client_t *self, char *servi
 
 /* Utility functions */
 zmsg_t *param_client_recv_timeout (bpm_client_t *self);
+/* Decode a reply in either the frame per field or the packed encoding.
+ * "data" points into "report" and is NULL if the reply has no payload.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_MSG if the reply is
+ * malformed */
+bpm_client_err_e param_client_reply_parse (zmsg_t *report, uint32_t *code,
+        const uint8_t **data, size_t *data_size);
+/* Replace the frames of "msg" by a single RW_WIRE_PACKED_V1 frame.
+ * Returns BPM_CLIENT_SUCCESS if ok and BPM_CLIENT_ERR_ALLOC if the frame
+ * could not be allocated */
+bpm_client_err_e param_client_msg_pack (zmsg_t *msg);
 
 #ifdef __cplusplus
 }
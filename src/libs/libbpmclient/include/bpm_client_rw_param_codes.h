@@ -27,6 +27,50 @@ extern "C" {
 #define PARAM_OK                        0
 #define PARAM_ERR                       1
 
+/* Requests sent with this subject are answered with a single frame holding
+ * the reply code, the payload size and the payload, in this order, instead
+ * of one frame for each. This saves two frame allocations per reply. Replies
+ * without payload are the same in both encodings */
+#define RW_REPLY_PACKED_SUBJECT         "RW_PACKED"
+#define RW_REPLY_PACKED_HDR_SIZE        (2*RW_REPLY_SIZE)
+
+/* Request wire formats. RW_WIRE_FRAMES sends the opcode and each argument
+ * in its own frame. RW_WIRE_PACKED_V1 sends a single frame with the same
+ * fields, each one preceded by its size as a uint32_t, and the request
+ * subject set to RW_REQ_PACKED_V1_SUBJECT. Packed requests get packed
+ * replies. Servers that predate it only understand RW_WIRE_FRAMES */
+#define RW_WIRE_FRAMES                  0
+#define RW_WIRE_PACKED_V1               1
+#define RW_WIRE_END                     2
+
+#define RW_REQ_PACKED_V1_SUBJECT        "RW_PACKED_V1"
+#define RW_REQ_PACKED_ARG_HDR_SIZE      sizeof (uint32_t)
+
+/* Parameter writes sent with this subject may be superseded. If another one
+ * to the same opcode, from the same sender, is received while it still
+ * waits to be served, only the newest is applied and the older one is
+ * answered with RW_OK right away. Only requests of exactly three frames
+ * (opcode, rw and value, as in RW_WIRE_FRAMES) are sent this way. Replies
+ * are packed, as with RW_REPLY_PACKED_SUBJECT */
+#define RW_REQ_COALESCE_SUBJECT         "RW_PACKED_COALESCE"
+
+/* Parameter reads sent with this subject have no side effects, so
+ * identical ones (same opcode and arguments) waiting at the same time, from
+ * any senders, may all be answered with the reply of a single one. Only
+ * RW_WIRE_FRAMES requests are sent this way. Replies are packed, as with
+ * RW_REPLY_PACKED_SUBJECT */
+#define RW_REQ_SHARED_SUBJECT           "RW_PACKED_SHARED"
+
+/* Local fast path. With an "ipc://" broker endpoint, every service also
+ * binds a ROUTER socket at the broker endpoint followed by
+ * RW_LOCAL_ENDP_SEP and the service name, so clients on the same host can
+ * skip the broker hop. Requests are sent from a DEALER socket as the
+ * subject, the tracker and then the same frames as through the broker.
+ * Replies are the tracker followed by the same frames as through the
+ * broker. Streamed replies are only sent through the broker */
+#define RW_LOCAL_ENDP_PREFIX            "ipc://"
+#define RW_LOCAL_ENDP_SEP               '.'
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_SHARED_H_
+#define _BPM_CLIENT_SHARED_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Client shared by many threads over a single broker connection. An I/O
+ * thread of its own owns the underlying bpm_client_t: the requests of all
+ * the threads are sent by it as asynchronous requests and each reply, told
+ * apart by its tracker, wakes the thread waiting for it. Threads don't wait
+ * for each other's replies, so a slow service only holds up its callers */
+
+/* Creates a shared client connected to the broker at "broker_endp", with
+ * the same arguments as bpm_client_new_time () */
+bpm_shared_client_t *bpm_shared_client_new (char *broker_endp, int verbose,
+        const char *log_file_name, int timeout);
+/* Destroy a shared client. No thread may be using it. Requests still
+ * queued complete with BPM_CLIENT_INT */
+void bpm_shared_client_destroy (bpm_shared_client_t **self_p);
+
+/* Same as bpm_func_exec (), but can be called by any number of threads at
+ * once. The calling thread blocks until the reply arrives or the timeout
+ * of the client expires. "output" is filled by the I/O thread meanwhile.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_INT if the client is being
+ * destroyed, or the error of the request (see bpm_client_err.h for all
+ * possible errors) */
+bpm_client_err_e bpm_shared_func_exec (bpm_shared_client_t *self,
+        const disp_op_t *func, char *service, uint32_t *input, uint32_t *output);
+
+/* Number of requests queued or waiting for their replies */
+size_t bpm_shared_client_pending (bpm_shared_client_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_SPEC_H_
+#define _BPM_CLIENT_SPEC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Spectral analysis of curves as filled by bpm_get_curve (), e.g., TBTPOS0
+ * for tune measurements. Samples are made of BPM_SPEC_NUM_CHAN interleaved
+ * signed 32-bit atoms (X, Y, Q and SUM for positions) and one of them is
+ * analysed at a time. The mean of the curve is removed, the window applied
+ * and the curve zero padded (or cut) to the FFT size of the plan.
+ *
+ * Plans are read-only once created, so they can be shared by threads. The
+ * tunes of many curves, e.g., of all of the BPMs of a ring, are computed in
+ * parallel with bpm_spec_tune_batch () */
+
+#define BPM_SPEC_NUM_CHAN               4
+/* FFT sizes must be powers of 2 in this range */
+#define BPM_SPEC_FFT_SIZE_MIN           16
+#define BPM_SPEC_FFT_SIZE_MAX           (1 << 24)
+
+typedef enum {
+    BPM_SPEC_WIN_RECT = 0,          /* No window */
+    BPM_SPEC_WIN_HANN,              /* Hann window */
+    BPM_SPEC_WIN_END                /* End of enum marker */
+} bpm_spec_win_e;
+
+/* Tune found */
+typedef struct {
+    double tune;                    /* Fractional tune, in [0, 0.5] */
+    double amplitude;               /* Amplitude of the oscillation, in the
+                                       units of the curve */
+} bpm_spec_tune_t;
+
+/* Curve of a batch */
+typedef struct {
+    const int32_t *data;            /* Samples */
+    size_t num_samples;             /* Number of samples */
+    uint32_t chan;                  /* Atom analysed */
+    bpm_spec_tune_t tune;           /* Tune found */
+    bpm_client_err_e err;           /* BPM_CLIENT_SUCCESS if "tune" is valid */
+} bpm_spec_job_t;
+
+/* Creates a plan for FFTs of "fft_size" points with window "win". Returns
+ * NULL if "fft_size" is not valid */
+bpm_spec_t *bpm_spec_new (size_t fft_size, bpm_spec_win_e win);
+/* Destroy a plan */
+void bpm_spec_destroy (bpm_spec_t **self_p);
+/* FFT size of the plan */
+size_t bpm_spec_get_fft_size (bpm_spec_t *self);
+
+/* Name of the kernels used on this CPU (e.g., "avx"), for diagnostics */
+const char *bpm_spec_kernel_name (void);
+
+/* Amplitude spectrum of atom "chan" of the "num_samples" samples of "data".
+ * fft_size/2 + 1 amplitudes, from 0 to half the sampling frequency, are
+ * written to "spectrum", scaled so a sine centered on a bin reads its
+ * amplitude there. Returns BPM_CLIENT_SUCCESS if ok */
+bpm_client_err_e bpm_spec_amplitude (bpm_spec_t *self, const int32_t *data,
+        size_t num_samples, uint32_t chan, float *spectrum);
+
+/* Tune of atom "chan" of the "num_samples" samples of "data": the highest
+ * peak with a fractional tune in [tune_min, tune_max], interpolated between
+ * bins. Its amplitude is corrected for the scalloping of the window.
+ * Returns BPM_CLIENT_SUCCESS if ok */
+bpm_client_err_e bpm_spec_tune (bpm_spec_t *self, const int32_t *data,
+        size_t num_samples, uint32_t chan, double tune_min, double tune_max,
+        bpm_spec_tune_t *tune);
+
+/* bpm_spec_tune () of each of the "num_jobs" curves of "jobs", using up to
+ * "num_threads" threads, 0 for one per online CPU. The result of each curve
+ * is in its job. Returns BPM_CLIENT_SUCCESS if all of them are ok, or the
+ * error of one of the others */
+bpm_client_err_e bpm_spec_tune_batch (bpm_spec_t *self, bpm_spec_job_t *jobs,
+        size_t num_jobs, double tune_min, double tune_max, uint32_t num_threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
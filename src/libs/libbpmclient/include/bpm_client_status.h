@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_STATUS_H_
+#define _BPM_CLIENT_STATUS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Status page of a DEVIO running on the same host, see sm_io_status_codes.h.
+ * The page is mapped once and the sections are read straight from it, with
+ * no request to the server. A section that was not updated recently (see
+ * "hdr.timestamp") belongs to an SMIO that is not polling, e.g., with the
+ * DSP monitoring stream disabled, or to a DEVIO that is gone. A restarted
+ * DEVIO has a new page, so open it again then. Reading is thread-safe */
+
+/* Times a section is copied before giving up on a writer that keeps
+ * changing it */
+#define BPM_STATUS_READ_TRIES           1000
+
+/* Map the status page of the DEVIO "devio_name" (e.g., "BPM0:DEVIO"), the
+ * prefix of its SMIO service names. Returns NULL if the DEVIO is not
+ * running on this host or has no status page */
+bpm_status_t *bpm_status_open (const char *devio_name);
+/* Unmap the status page */
+void bpm_status_close (bpm_status_t **self_p);
+
+/* Read the section of instance "inst_id" of the DSP, ACQ or RFFE SMIO.
+ * Returns BPM_CLIENT_SUCCESS if ok, BPM_CLIENT_ERR_INV_PARAM if "inst_id"
+ * is not below SMIO_STATUS_MAX_INST and BPM_CLIENT_ERR_AGAIN if the
+ * section was never updated or could not be read consistently */
+bpm_client_err_e bpm_status_read_dsp (bpm_status_t *self, uint32_t inst_id,
+        smio_status_dsp_t *dsp);
+bpm_client_err_e bpm_status_read_acq (bpm_status_t *self, uint32_t inst_id,
+        smio_status_acq_t *acq);
+bpm_client_err_e bpm_status_read_rffe (bpm_status_t *self, uint32_t inst_id,
+        smio_status_rffe_t *rffe);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
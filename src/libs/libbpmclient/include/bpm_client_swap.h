@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _BPM_CLIENT_SWAP_H_
+#define _BPM_CLIENT_SWAP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Software deswitching of ADC data (e.g., ADCSWAP0 acquisitions). Samples
+ * are made of BPM_SWAP_NUM_CHAN interleaved signed 16-bit channels, A to D.
+ * The RF switches alternate between the direct state, in which channel X
+ * carries signal X, and the inverted state, in which A and C, and B and D,
+ * are crossed. Each signal is rebuilt from the channel carrying it, scaled
+ * by the gain of that path, as the SWAP core does in the FPGA */
+
+#define BPM_SWAP_NUM_CHAN               4
+/* Unity gain of the SWAP gain registers */
+#define BPM_SWAP_GAIN_UNITY             (1 << 15)
+
+/* Gains of each signal, by the channel carrying it in the direct ("dir")
+ * and inverted ("inv") states. 1.0 keeps the ADC counts */
+typedef struct {
+    float dir [BPM_SWAP_NUM_CHAN];
+    float inv [BPM_SWAP_NUM_CHAN];
+} bpm_swap_gains_t;
+
+/* Fill "gains" from the gain registers of a SWAP profile, as read with
+ * bpm_get_swap_profile () */
+void bpm_swap_gains_from_profile (bpm_swap_gains_t *gains,
+        const struct _smio_swap_profile_t *profile);
+
+/* Name of the kernels used on this CPU (e.g., "avx2"), for diagnostics */
+const char *bpm_swap_kernel_name (void);
+
+/* Deswitch "num_samples" samples of "src", writing the signals to the
+ * "num_samples" floats of each of "dst" [0] to "dst" [3]. Each switching
+ * state lasts "half_period" samples and "src" starts "phase" samples into
+ * a direct state. A "half_period" of 0 means no switching, all of the samples
+ * being in the direct state */
+void bpm_swap_deswitch (float *dst [BPM_SWAP_NUM_CHAN], const int16_t *src,
+        size_t num_samples, const bpm_swap_gains_t *gains, uint32_t half_period,
+        uint32_t phase);
+
+/* Average each of the "num_samples" floats of "src" [0] to "src" [3] over
+ * whole switching periods of 2*"half_period" samples, starting at the first
+ * sample, removing the switching artifacts. Average k of each signal is
+ * written to "dst" [c][k]. Returns the number of averages per signal */
+size_t bpm_swap_average (float *dst [BPM_SWAP_NUM_CHAN],
+        float *const src [BPM_SWAP_NUM_CHAN], size_t num_samples,
+        uint32_t half_period);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
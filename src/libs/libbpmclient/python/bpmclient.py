@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2015 LNLS (www.lnls.br)
+#
+# Released according to the GNU GPL, version 3 or any later version.
+#
+# Python bindings of libbpmclient acquisition functions. Curves are returned
+# as NumPy arrays of shape (num_samples, ACQ_NUM_ATOMS), with the sample
+# layout of the channel, e.g., int16 for the ADC channels and int32 for the
+# others.
+#
+# There is no copy on the Python side: get_curve () has the library read the
+# curve right into the array, which might also be given by the caller to be
+# reused, and get_curve_shm () returns a read-only array over the shared
+# memory region of a local server.
+#
+# The library is called through ctypes.CDLL, which releases the GIL for the
+# duration of every call, so acquisitions from different Python threads run
+# concurrently. A Client, as a bpm_client_t, serves one request at a time, so
+# use one Client per thread to fetch several BPMs in parallel:
+#
+#   def fetch(service):
+#       with bpmclient.Client("ipc:///tmp/bpm") as client:
+#           return client.get_curve(service, chan=0, num_samples_pre=1024)
+#
+#   with concurrent.futures.ThreadPoolExecutor() as pool:
+#       curves = list(pool.map(fetch, ["BPM0:DEVIO:ACQ0", "BPM1:DEVIO:ACQ0"]))
+
+import ctypes
+import ctypes.util
+import threading
+
+import numpy as np
+
+# Atoms per sample, e.g., the 4 ADC channels, see ACQ_REDUCE_NUM_ATOMS
+ACQ_NUM_ATOMS = 4
+# Default acquisition timeout, in ms
+ACQ_DFLT_TIMEOUT = 10000
+
+BPM_CLIENT_SUCCESS = 0
+BPM_CLIENT_ERR_ALLOC = 1
+
+# Atom type by atom size, in bytes
+_ATOM_DTYPES = {2: np.dtype("<i2"), 4: np.dtype("<i4"), 8: np.dtype("<i8")}
+
+
+class AcqReq(ctypes.Structure):
+    """acq_req_t"""
+    _fields_ = [("num_samples_pre", ctypes.c_uint32),
+                ("num_samples_post", ctypes.c_uint32),
+                ("num_shots", ctypes.c_uint32),
+                ("chan", ctypes.c_uint32)]
+
+
+class AcqBlock(ctypes.Structure):
+    """acq_block_t"""
+    _fields_ = [("idx", ctypes.c_uint32),
+                ("data", ctypes.POINTER(ctypes.c_uint32)),
+                ("data_size", ctypes.c_uint32),
+                ("bytes_read", ctypes.c_uint32)]
+
+
+class AcqTrans(ctypes.Structure):
+    """acq_trans_t"""
+    _fields_ = [("req", AcqReq),
+                ("block", AcqBlock),
+                ("blocks_done", ctypes.c_uint32),
+                ("bytes_done", ctypes.c_uint32)]
+
+
+class AcqChanDesc(ctypes.Structure):
+    """smio_acq_chan_desc_t"""
+    _fields_ = [("id", ctypes.c_uint32),
+                ("sample_size", ctypes.c_uint32),
+                ("max_samples", ctypes.c_uint32),
+                ("start_addr", ctypes.c_uint32),
+                ("end_addr", ctypes.c_uint32)]
+
+
+def _load_lib():
+    name = ctypes.util.find_library("bpmclient") or "libbpmclient.so"
+    lib = ctypes.CDLL(name)
+
+    client_p = ctypes.c_void_p
+    trans_p = ctypes.POINTER(AcqTrans)
+
+    lib.bpm_client_new.argtypes = [ctypes.c_char_p, ctypes.c_int,
+                                   ctypes.c_char_p]
+    lib.bpm_client_new.restype = client_p
+    lib.bpm_client_new_time.argtypes = [ctypes.c_char_p, ctypes.c_int,
+                                        ctypes.c_char_p, ctypes.c_int]
+    lib.bpm_client_new_time.restype = client_p
+    lib.bpm_client_destroy.argtypes = [ctypes.POINTER(client_p)]
+    lib.bpm_client_destroy.restype = None
+    lib.bpm_client_err_str.argtypes = [ctypes.c_int]
+    lib.bpm_client_err_str.restype = ctypes.c_char_p
+
+    lib.bpm_acq_get_chan_desc.argtypes = [client_p, ctypes.c_char_p,
+                                          ctypes.c_uint32,
+                                          ctypes.POINTER(AcqChanDesc)]
+    lib.bpm_acq_get_chan_desc.restype = ctypes.c_int
+    # bpm_get_curve () is a macro for bpm_full_acq_compat ()
+    lib.bpm_full_acq_compat.argtypes = [client_p, ctypes.c_char_p, trans_p,
+                                        ctypes.c_int, ctypes.c_bool]
+    lib.bpm_full_acq_compat.restype = ctypes.c_int
+    lib.bpm_acq_get_curve_shm.argtypes = [client_p, ctypes.c_char_p, trans_p]
+    lib.bpm_acq_get_curve_shm.restype = ctypes.c_int
+
+    return lib
+
+
+_lib = _load_lib()
+
+
+class BpmClientError(Exception):
+    """Error returned by libbpmclient, with its bpm_client_err_e code"""
+
+    def __init__(self, err, func):
+        self.err = err
+        msg = _lib.bpm_client_err_str(err)
+        super().__init__("%s: %s" % (func, msg.decode() if msg else err))
+
+
+def _check(err, func):
+    if err != BPM_CLIENT_SUCCESS:
+        raise BpmClientError(err, func)
+
+
+class Client:
+    """libbpmclient instance connected to the broker at broker_endp"""
+
+    def __init__(self, broker_endp, verbose=0, log_file="stdout",
+                 timeout=None):
+        # Calls sharing the client are serialized, as they share its sockets
+        self._lock = threading.Lock()
+        self._sample_dtypes = {}
+        self._client = None
+
+        if timeout is None:
+            self._client = _lib.bpm_client_new(broker_endp.encode(), verbose,
+                                               log_file.encode())
+        else:
+            self._client = _lib.bpm_client_new_time(broker_endp.encode(),
+                                                    verbose,
+                                                    log_file.encode(), timeout)
+        if not self._client:
+            raise BpmClientError(BPM_CLIENT_ERR_ALLOC, "bpm_client_new")
+
+    def close(self):
+        """Destroy the client. Arrays from get_curve_shm () are invalid
+        afterwards"""
+        with self._lock:
+            if self._client:
+                client = ctypes.c_void_p(self._client)
+                _lib.bpm_client_destroy(ctypes.byref(client))
+                self._client = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    def chan_desc(self, service, chan):
+        """Descriptor of channel chan of the ACQ service"""
+        desc = AcqChanDesc()
+        with self._lock:
+            err = _lib.bpm_acq_get_chan_desc(self._client, service.encode(),
+                                             chan, ctypes.byref(desc))
+        _check(err, "bpm_acq_get_chan_desc")
+        return desc
+
+    def sample_dtype(self, service, chan):
+        """Type of the atoms of a sample of channel chan"""
+        key = (service, chan)
+        if key not in self._sample_dtypes:
+            sample_size = self.chan_desc(service, chan).sample_size
+            dtype = _ATOM_DTYPES.get(sample_size // ACQ_NUM_ATOMS)
+            if dtype is None or sample_size % ACQ_NUM_ATOMS != 0:
+                raise ValueError("Unsupported sample size of %u bytes"
+                                 % sample_size)
+            self._sample_dtypes[key] = dtype
+        return self._sample_dtypes[key]
+
+    def get_curve(self, service, chan, num_samples_pre, num_samples_post=0,
+                  num_shots=1, timeout=ACQ_DFLT_TIMEOUT, new_acq=True,
+                  out=None):
+        """Acquire a curve of channel chan, as bpm_get_curve () does, and
+        return it as an array of shape (num_samples, ACQ_NUM_ATOMS). With
+        new_acq=False, the last acquisition is read instead. The curve is
+        read into out if given, which must be a C-contiguous array of the
+        channel sample type, large enough for the whole curve. Only the
+        samples read are returned, as a view of out"""
+        dtype = self.sample_dtype(service, chan)
+        num_samples = (num_samples_pre + num_samples_post) * num_shots
+
+        if out is None:
+            out = np.empty((num_samples, ACQ_NUM_ATOMS), dtype=dtype)
+        elif (out.dtype != dtype or not out.flags.c_contiguous or
+              not out.flags.writeable or
+              out.nbytes < num_samples * ACQ_NUM_ATOMS * dtype.itemsize):
+            raise ValueError("out must be a writeable C-contiguous %s array "
+                             "of at least %u samples" % (dtype, num_samples))
+
+        trans = AcqTrans()
+        trans.req.num_samples_pre = num_samples_pre
+        trans.req.num_samples_post = num_samples_post
+        trans.req.num_shots = num_shots
+        trans.req.chan = chan
+        trans.block.data = out.ctypes.data_as(ctypes.POINTER(ctypes.c_uint32))
+        trans.block.data_size = out.nbytes
+
+        with self._lock:
+            err = _lib.bpm_full_acq_compat(self._client, service.encode(),
+                                           ctypes.byref(trans), timeout,
+                                           new_acq)
+        _check(err, "bpm_full_acq_compat")
+
+        num_read = trans.block.bytes_read // (ACQ_NUM_ATOMS * dtype.itemsize)
+        return out.reshape(-1)[:num_read * ACQ_NUM_ATOMS].reshape(
+            num_read, ACQ_NUM_ATOMS)
+
+    def get_curve_shm(self, service, chan, num_samples_pre,
+                      num_samples_post=0, num_shots=1):
+        """Read the last acquisition of channel chan of a server on the same
+        host, as bpm_acq_get_curve_shm () does. The array returned is a
+        read-only view of the shared memory region, valid until a new
+        acquisition is started on the service or the client is closed"""
+        dtype = self.sample_dtype(service, chan)
+
+        trans = AcqTrans()
+        trans.req.num_samples_pre = num_samples_pre
+        trans.req.num_samples_post = num_samples_post
+        trans.req.num_shots = num_shots
+        trans.req.chan = chan
+
+        with self._lock:
+            err = _lib.bpm_acq_get_curve_shm(self._client, service.encode(),
+                                             ctypes.byref(trans))
+        _check(err, "bpm_acq_get_curve_shm")
+
+        num_read = trans.block.bytes_read // (ACQ_NUM_ATOMS * dtype.itemsize)
+        if num_read == 0:
+            return np.empty((0, ACQ_NUM_ATOMS), dtype=dtype)
+
+        addr = ctypes.cast(trans.block.data, ctypes.c_void_p).value
+        buf = (ctypes.c_char * (num_read * ACQ_NUM_ATOMS *
+                                dtype.itemsize)).from_address(addr)
+        # Keep the region mapped while the array is in use
+        buf.client = self
+        curve = np.frombuffer(buf, dtype=dtype).reshape(num_read,
+                                                        ACQ_NUM_ATOMS)
+        curve.flags.writeable = False
+        return curve
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <pthread.h>
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:buf]",    \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:buf]",    \
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:buf]",       \
+            bpm_client_err_str (err_type))
+
+/* Our structure */
+struct _bpm_buf_pool_t {
+    uint8_t *base;                              /* Mapping with all the buffers */
+    size_t map_size;                            /* Size of the mapping */
+    size_t buf_size;                            /* Size of each buffer */
+    uint32_t num_bufs;                          /* Number of buffers */
+    void **free_bufs;                           /* Stack of free buffers */
+    uint32_t num_free;                          /* Number of free buffers */
+    pthread_mutex_t lock;                       /* Protects the stack */
+};
+
+bpm_buf_pool_t *bpm_buf_pool_new (size_t buf_size, uint32_t num_bufs,
+        int numa_node)
+{
+    ASSERT_TEST(buf_size > 0 && num_bufs > 0, "Invalid pool size", err_inv_param);
+
+    bpm_buf_pool_t *self = (bpm_buf_pool_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->buf_size = (buf_size + BPM_BUF_ALIGN - 1) & ~((size_t) BPM_BUF_ALIGN - 1);
+    self->num_bufs = num_bufs;
+    ASSERT_TEST(self->buf_size <= SIZE_MAX / num_bufs, "Pool is too large",
+            err_too_large);
+
+    self->base = (uint8_t *) hutils_mem_map (self->buf_size * num_bufs,
+            numa_node, &self->map_size);
+    ASSERT_TEST(self->base != NULL, "Could not map pool memory", err_map);
+
+    self->free_bufs = (void **) zmalloc (num_bufs * sizeof (*self->free_bufs));
+    ASSERT_ALLOC(self->free_bufs, err_free_bufs_alloc);
+
+    /* Hand out the buffers in address order */
+    for (uint32_t i = 0; i < num_bufs; ++i) {
+        self->free_bufs [i] = self->base + (size_t) (num_bufs - 1 - i) * self->buf_size;
+    }
+    self->num_free = num_bufs;
+    pthread_mutex_init (&self->lock, NULL);
+
+    return self;
+
+err_free_bufs_alloc:
+    hutils_mem_unmap (self->base, self->map_size);
+err_map:
+err_too_large:
+    free (self);
+err_self_alloc:
+err_inv_param:
+    return NULL;
+}
+
+void bpm_buf_pool_destroy (bpm_buf_pool_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_buf_pool_t *self = *self_p;
+
+        if (self->num_free != self->num_bufs) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient:buf] Destroying "
+                    "pool with %u buffers still in use\n",
+                    self->num_bufs - self->num_free);
+        }
+
+        pthread_mutex_destroy (&self->lock);
+        free (self->free_bufs);
+        hutils_mem_unmap (self->base, self->map_size);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+void *bpm_buf_pool_get (bpm_buf_pool_t *self)
+{
+    assert (self);
+    void *buf = NULL;
+
+    pthread_mutex_lock (&self->lock);
+    if (self->num_free > 0) {
+        buf = self->free_bufs [--self->num_free];
+    }
+    pthread_mutex_unlock (&self->lock);
+
+    return buf;
+}
+
+void bpm_buf_pool_put (bpm_buf_pool_t *self, void *buf)
+{
+    assert (self);
+    assert (buf);
+    assert ((uint8_t *) buf >= self->base &&
+            (uint8_t *) buf < self->base + self->buf_size * self->num_bufs &&
+            ((uint8_t *) buf - self->base) % self->buf_size == 0);
+
+    pthread_mutex_lock (&self->lock);
+    assert (self->num_free < self->num_bufs);
+    self->free_bufs [self->num_free++] = buf;
+    pthread_mutex_unlock (&self->lock);
+}
+
+size_t bpm_buf_pool_get_buf_size (bpm_buf_pool_t *self)
+{
+    assert (self);
+    return self->buf_size;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:capture]",\
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:capture]",\
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:capture]",   \
+            bpm_client_err_str (err_type))
+
+/* Our structure */
+struct _bpm_capture_t {
+    int fd;                                     /* Capture file */
+    bpm_capture_hdr_t hdr;                      /* Header, rewritten on close */
+};
+
+static bool _bpm_capture_pwrite (int fd, const void *data, size_t size,
+        uint64_t offs);
+
+bpm_capture_t *bpm_capture_new (const char *path, const bpm_capture_info_t *info)
+{
+    assert (path);
+    assert (info);
+
+    ASSERT_TEST(info->req.chan < END_CHAN_ID, "Invalid channel", err_inv_param);
+
+    bpm_capture_t *self = (bpm_capture_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->fd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ASSERT_TEST(self->fd != -1, "Could not create capture file", err_open);
+
+    bpm_capture_hdr_t *hdr = &self->hdr;
+    strncpy (hdr->magic, BPM_CAPTURE_MAGIC, sizeof (hdr->magic));
+    hdr->version = BPM_CAPTURE_VERSION;
+    hdr->hdr_size = sizeof (*hdr);
+    hdr->chan = info->req.chan;
+    hdr->sample_size = (info->sample_size != 0) ? info->sample_size :
+        acq_chan[info->req.chan].sample_size;
+    hdr->num_samples_pre = info->req.num_samples_pre;
+    hdr->num_samples_post = info->req.num_samples_post;
+    hdr->num_shots = info->req.num_shots;
+    hdr->trig_addr = info->trig_addr;
+    hdr->timestamp = info->timestamp;
+    if (hdr->timestamp == 0) {
+        struct timespec now;
+        clock_gettime (CLOCK_REALTIME, &now);
+        hdr->timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+    }
+    hdr->payload_offs = (sizeof (*hdr) + BPM_CAPTURE_PAYLOAD_ALIGN - 1) &
+        ~((uint64_t) BPM_CAPTURE_PAYLOAD_ALIGN - 1);
+    hdr->payload_size = 0;
+
+    /* The payload size is only known on close. Until then, write the header
+     * and leave the file positioned at the start of the payload */
+    ASSERT_TEST(_bpm_capture_pwrite (self->fd, hdr, sizeof (*hdr), 0),
+            "Could not write capture file header", err_write_hdr);
+    ASSERT_TEST(lseek (self->fd, hdr->payload_offs, SEEK_SET) != -1,
+            "Could not seek to the capture file payload", err_write_hdr);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient:capture] Created "
+            "capture file %s for channel %u\n", path, hdr->chan);
+    return self;
+
+err_write_hdr:
+    close (self->fd);
+err_open:
+    free (self);
+err_self_alloc:
+err_inv_param:
+    return NULL;
+}
+
+void bpm_capture_destroy (bpm_capture_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_capture_t *self = *self_p;
+
+        /* Make sure the file is at least as big as the payload offset, so
+         * empty captures can still be mapped */
+        if (ftruncate (self->fd, self->hdr.payload_offs +
+                    self->hdr.payload_size) == -1 ||
+                !_bpm_capture_pwrite (self->fd, &self->hdr,
+                    sizeof (self->hdr), 0)) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_ERR, "[libclient:capture] "
+                    "Could not finalize capture file header\n");
+        }
+
+        close (self->fd);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+bpm_client_err_e bpm_capture_write (bpm_capture_t *self, const void *data,
+        size_t size)
+{
+    assert (self);
+    assert (data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    ASSERT_TEST(_bpm_capture_pwrite (self->fd, data, size,
+                self->hdr.payload_offs + self->hdr.payload_size),
+            "Could not write to capture file", err_write, BPM_CLIENT_ERR_INV_PARAM);
+    self->hdr.payload_size += size;
+
+err_write:
+    return err;
+}
+
+uint64_t bpm_capture_get_size (bpm_capture_t *self)
+{
+    assert (self);
+    return self->hdr.payload_size;
+}
+
+bpm_client_err_e bpm_acq_get_curve_capture (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size, bpm_capture_t *capture)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+    assert (capture);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    ASSERT_TEST(acq_trans->block.data_size >= block_size,
+            "Staging buffer is smaller than a block", err_inv_param,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    uint32_t num_samples_multishot = (acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post) * acq_trans->req.num_shots;
+    uint32_t n_max_samples = block_size/acq_chan[acq_trans->req.chan].sample_size;
+    ASSERT_TEST(n_max_samples > 0, "Block size is smaller than a sample",
+            err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
+    /* When the last block is full 'block_n_valid' exceeds by one */
+    if (block_n_valid != 0 && (num_samples_multishot % n_max_samples) == 0) {
+        block_n_valid--;
+    }
+
+    /* Total bytes captured */
+    uint32_t total_bread = 0;
+
+    for (uint32_t block_n = 0; block_n <= block_n_valid; block_n++) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        acq_trans->block.idx = block_n;
+        err = bpm_acq_get_data_block_sized (self, service, acq_trans, block_size);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+                "bpm_acq_get_data_block_sized failed. block_n is probably out of range",
+                err_get_data_block);
+
+        err = bpm_capture_write (capture, acq_trans->block.data,
+                acq_trans->block.bytes_read);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not write block to "
+                "capture file", err_capture_write);
+
+        total_bread += acq_trans->block.bytes_read;
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient:capture] "
+            "bpm_acq_get_curve_capture: Data curve of %u bytes was successfully "
+            "captured\n", total_bread);
+
+bpm_zsys_interrupted:
+err_capture_write:
+err_get_data_block:
+    /* Return to client the total number of bytes captured */
+    acq_trans->block.bytes_read = total_bread;
+err_inv_param:
+    return err;
+}
+
+/**************** Helper Functions ***************/
+
+/* Write all of "data" at offset "offs", retrying on short writes */
+static bool _bpm_capture_pwrite (int fd, const void *data, size_t size,
+        uint64_t offs)
+{
+    const uint8_t *p = (const uint8_t *) data;
+
+    while (size > 0) {
+        ssize_t ret = pwrite (fd, p, size, offs);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        p += ret;
+        offs += ret;
+        size -= ret;
+    }
+
+    return true;
+}
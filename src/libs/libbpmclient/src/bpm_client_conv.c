@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define BPM_CONV_X86
+#include <immintrin.h>
+#elif defined (__aarch64__)
+/* vsqrtq_f32 is AArch64 only */
+#define BPM_CONV_NEON
+#include <arm_neon.h>
+#endif
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...)  \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:conv]",           \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)               \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:conv]",                   \
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),                       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:conv]",                      \
+            bpm_client_err_str (err_type))
+
+/* Samples converted at a time to a buffer before being split into planes.
+ * 16 KB of floats, so the buffer stays in the L1 cache */
+#define BPM_CONV_CHUNK_SAMPLES          1024
+
+/* Convert "num_samples" samples to interleaved values */
+typedef void (*bpm_conv_s16_fp) (float *dst, const int16_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt);
+typedef void (*bpm_conv_s32_fp) (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt);
+/* Split "num_samples" interleaved values into planes */
+typedef void (*bpm_conv_split_fp) (float *const dst [BPM_CONV_NUM_ATOMS],
+        const float *src, size_t num_samples);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    bpm_conv_s16_fp atoms_s16;
+    bpm_conv_s32_fp atoms_s32;
+    bpm_conv_s32_fp iq_mag_s32;
+    bpm_conv_split_fp split4;
+    bpm_conv_split_fp split2;
+} bpm_conv_ops_t;
+
+/* Both must give the same results, so the SIMD kernels do a multiply and
+ * then an add, like the scalar ones, and not a fused multiply-add */
+
+/************ Scalar kernels **********/
+
+static void _bpm_conv_atoms_s16_scalar (float *dst, const int16_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    for (size_t i = 0; i < num_samples*BPM_CONV_NUM_ATOMS; ++i) {
+        uint32_t j = i % BPM_CONV_NUM_ATOMS;
+        dst [i] = src [i] * fmt->scale [j] + fmt->offset [j];
+    }
+}
+
+static void _bpm_conv_atoms_s32_scalar (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    for (size_t i = 0; i < num_samples*BPM_CONV_NUM_ATOMS; ++i) {
+        uint32_t j = i % BPM_CONV_NUM_ATOMS;
+        dst [i] = (float) src [i] * fmt->scale [j] + fmt->offset [j];
+    }
+}
+
+static void _bpm_conv_iq_mag_s32_scalar (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    for (size_t i = 0; i < num_samples*2; ++i) {
+        uint32_t j = i % 2;
+        float re = (float) src [2*i];
+        float im = (float) src [2*i + 1];
+        float re2 = re * re;
+        float im2 = im * im;
+        dst [i] = sqrtf (re2 + im2) * fmt->scale [j] + fmt->offset [j];
+    }
+}
+
+static void _bpm_conv_split4_scalar (float *const dst [BPM_CONV_NUM_ATOMS],
+        const float *src, size_t num_samples)
+{
+    for (size_t i = 0; i < num_samples; ++i) {
+        dst [0][i] = src [4*i];
+        dst [1][i] = src [4*i + 1];
+        dst [2][i] = src [4*i + 2];
+        dst [3][i] = src [4*i + 3];
+    }
+}
+
+static void _bpm_conv_split2_scalar (float *const dst [BPM_CONV_NUM_ATOMS],
+        const float *src, size_t num_samples)
+{
+    for (size_t i = 0; i < num_samples; ++i) {
+        dst [0][i] = src [2*i];
+        dst [1][i] = src [2*i + 1];
+    }
+}
+
+#if defined (BPM_CONV_X86)
+
+/************ SSE2 kernels **********/
+
+/* 2 samples per iteration. Sign extension puts the atoms in the upper
+ * halves and shifts them back */
+__attribute__ ((target ("sse2")))
+static void _bpm_conv_atoms_s16_sse2 (float *dst, const int16_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    const __m128 scale = _mm_loadu_ps (fmt->scale);
+    const __m128 offset = _mm_loadu_ps (fmt->offset);
+    size_t i = 0;
+
+    for (; i + 2 <= num_samples; i += 2) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i*BPM_CONV_NUM_ATOMS));
+        __m128 lo = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16));
+        __m128 hi = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16));
+
+        _mm_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS,
+                _mm_add_ps (_mm_mul_ps (lo, scale), offset));
+        _mm_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS + 4,
+                _mm_add_ps (_mm_mul_ps (hi, scale), offset));
+    }
+
+    _bpm_conv_atoms_s16_scalar (dst + i*BPM_CONV_NUM_ATOMS,
+            src + i*BPM_CONV_NUM_ATOMS, num_samples - i, fmt);
+}
+
+/* 2 samples per iteration */
+__attribute__ ((target ("sse2")))
+static void _bpm_conv_atoms_s32_sse2 (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    const __m128 scale = _mm_loadu_ps (fmt->scale);
+    const __m128 offset = _mm_loadu_ps (fmt->offset);
+    size_t i = 0;
+
+    for (; i + 2 <= num_samples; i += 2) {
+        const int32_t *p = src + i*BPM_CONV_NUM_ATOMS;
+        __m128 s0 = _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i *) p));
+        __m128 s1 = _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i *) (p + 4)));
+
+        _mm_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS,
+                _mm_add_ps (_mm_mul_ps (s0, scale), offset));
+        _mm_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS + 4,
+                _mm_add_ps (_mm_mul_ps (s1, scale), offset));
+    }
+
+    _bpm_conv_atoms_s32_scalar (dst + i*BPM_CONV_NUM_ATOMS,
+            src + i*BPM_CONV_NUM_ATOMS, num_samples - i, fmt);
+}
+
+/* 2 samples per iteration. The squares of the I atoms and of the Q atoms
+ * are gathered in a vector each, which leaves the magnitudes in the order
+ * they are stored in */
+__attribute__ ((target ("sse2")))
+static void _bpm_conv_iq_mag_s32_sse2 (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    const __m128 scale = _mm_setr_ps (fmt->scale [0], fmt->scale [1],
+            fmt->scale [0], fmt->scale [1]);
+    const __m128 offset = _mm_setr_ps (fmt->offset [0], fmt->offset [1],
+            fmt->offset [0], fmt->offset [1]);
+    size_t i = 0;
+
+    for (; i + 2 <= num_samples; i += 2) {
+        const int32_t *p = src + i*BPM_CONV_NUM_ATOMS;
+        __m128 s0 = _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i *) p));
+        __m128 s1 = _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i *) (p + 4)));
+        s0 = _mm_mul_ps (s0, s0);
+        s1 = _mm_mul_ps (s1, s1);
+
+        __m128 re2 = _mm_shuffle_ps (s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im2 = _mm_shuffle_ps (s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 mag = _mm_sqrt_ps (_mm_add_ps (re2, im2));
+
+        _mm_storeu_ps (dst + i*2, _mm_add_ps (_mm_mul_ps (mag, scale), offset));
+    }
+
+    _bpm_conv_iq_mag_s32_scalar (dst + i*2, src + i*BPM_CONV_NUM_ATOMS,
+            num_samples - i, fmt);
+}
+
+/* 4 samples per iteration */
+__attribute__ ((target ("sse2")))
+static void _bpm_conv_split4_sse2 (float *const dst [BPM_CONV_NUM_ATOMS],
+        const float *src, size_t num_samples)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        const float *p = src + i*4;
+        __m128 s0 = _mm_loadu_ps (p);
+        __m128 s1 = _mm_loadu_ps (p + 4);
+        __m128 s2 = _mm_loadu_ps (p + 8);
+        __m128 s3 = _mm_loadu_ps (p + 12);
+        _MM_TRANSPOSE4_PS (s0, s1, s2, s3);
+
+        _mm_storeu_ps (dst [0] + i, s0);
+        _mm_storeu_ps (dst [1] + i, s1);
+        _mm_storeu_ps (dst [2] + i, s2);
+        _mm_storeu_ps (dst [3] + i, s3);
+    }
+
+    float *const rest [BPM_CONV_NUM_ATOMS] = {dst [0] + i, dst [1] + i,
+        dst [2] + i, dst [3] + i};
+    _bpm_conv_split4_scalar (rest, src + i*4, num_samples - i);
+}
+
+/* 4 samples per iteration */
+__attribute__ ((target ("sse2")))
+static void _bpm_conv_split2_sse2 (float *const dst [BPM_CONV_NUM_ATOMS],
+        const float *src, size_t num_samples)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        __m128 s0 = _mm_loadu_ps (src + i*2);
+        __m128 s1 = _mm_loadu_ps (src + i*2 + 4);
+
+        _mm_storeu_ps (dst [0] + i, _mm_shuffle_ps (s0, s1, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps (dst [1] + i, _mm_shuffle_ps (s0, s1, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    float *const rest [BPM_CONV_NUM_ATOMS] = {dst [0] + i, dst [1] + i,
+        NULL, NULL};
+    _bpm_conv_split2_scalar (rest, src + i*2, num_samples - i);
+}
+
+/************ AVX2 kernels **********/
+
+/* 4 samples per iteration. Each vector holds 2 samples, one per lane, so
+ * the scale and offset are the same in both lanes */
+__attribute__ ((target ("avx2")))
+static void _bpm_conv_atoms_s16_avx2 (float *dst, const int16_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    const __m256 scale = _mm256_broadcast_ps ((const __m128 *) fmt->scale);
+    const __m256 offset = _mm256_broadcast_ps ((const __m128 *) fmt->offset);
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        const int16_t *p = src + i*BPM_CONV_NUM_ATOMS;
+        __m256 s01 = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (
+                    _mm_loadu_si128 ((const __m128i *) p)));
+        __m256 s23 = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (
+                    _mm_loadu_si128 ((const __m128i *) (p + 8))));
+
+        _mm256_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS,
+                _mm256_add_ps (_mm256_mul_ps (s01, scale), offset));
+        _mm256_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS + 8,
+                _mm256_add_ps (_mm256_mul_ps (s23, scale), offset));
+    }
+
+    _bpm_conv_atoms_s16_scalar (dst + i*BPM_CONV_NUM_ATOMS,
+            src + i*BPM_CONV_NUM_ATOMS, num_samples - i, fmt);
+}
+
+/* 4 samples per iteration */
+__attribute__ ((target ("avx2")))
+static void _bpm_conv_atoms_s32_avx2 (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    const __m256 scale = _mm256_broadcast_ps ((const __m128 *) fmt->scale);
+    const __m256 offset = _mm256_broadcast_ps ((const __m128 *) fmt->offset);
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        const int32_t *p = src + i*BPM_CONV_NUM_ATOMS;
+        __m256 s01 = _mm256_cvtepi32_ps (_mm256_loadu_si256 ((const __m256i *) p));
+        __m256 s23 = _mm256_cvtepi32_ps (_mm256_loadu_si256 ((const __m256i *) (p + 8)));
+
+        _mm256_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS,
+                _mm256_add_ps (_mm256_mul_ps (s01, scale), offset));
+        _mm256_storeu_ps (dst + i*BPM_CONV_NUM_ATOMS + 8,
+                _mm256_add_ps (_mm256_mul_ps (s23, scale), offset));
+    }
+
+    _bpm_conv_atoms_s32_scalar (dst + i*BPM_CONV_NUM_ATOMS,
+            src + i*BPM_CONV_NUM_ATOMS, num_samples - i, fmt);
+}
+
+#endif
+
+#if defined (BPM_CONV_NEON)
+
+/************ NEON kernels **********/
+
+/* 2 samples per iteration */
+static void _bpm_conv_atoms_s16_neon (float *dst, const int16_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    const float32x4_t scale = vld1q_f32 (fmt->scale);
+    const float32x4_t offset = vld1q_f32 (fmt->offset);
+    size_t i = 0;
+
+    for (; i + 2 <= num_samples; i += 2) {
+        int16x8_t v = vld1q_s16 (src + i*BPM_CONV_NUM_ATOMS);
+        float32x4_t lo = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (v)));
+        float32x4_t hi = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (v)));
+
+        vst1q_f32 (dst + i*BPM_CONV_NUM_ATOMS,
+                vaddq_f32 (vmulq_f32 (lo, scale), offset));
+        vst1q_f32 (dst + i*BPM_CONV_NUM_ATOMS + 4,
+                vaddq_f32 (vmulq_f32 (hi, scale), offset));
+    }
+
+    _bpm_conv_atoms_s16_scalar (dst + i*BPM_CONV_NUM_ATOMS,
+            src + i*BPM_CONV_NUM_ATOMS, num_samples - i, fmt);
+}
+
+/* 2 samples per iteration */
+static void _bpm_conv_atoms_s32_neon (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    const float32x4_t scale = vld1q_f32 (fmt->scale);
+    const float32x4_t offset = vld1q_f32 (fmt->offset);
+    size_t i = 0;
+
+    for (; i + 2 <= num_samples; i += 2) {
+        const int32_t *p = src + i*BPM_CONV_NUM_ATOMS;
+        float32x4_t s0 = vcvtq_f32_s32 (vld1q_s32 (p));
+        float32x4_t s1 = vcvtq_f32_s32 (vld1q_s32 (p + 4));
+
+        vst1q_f32 (dst + i*BPM_CONV_NUM_ATOMS,
+                vaddq_f32 (vmulq_f32 (s0, scale), offset));
+        vst1q_f32 (dst + i*BPM_CONV_NUM_ATOMS + 4,
+                vaddq_f32 (vmulq_f32 (s1, scale), offset));
+    }
+
+    _bpm_conv_atoms_s32_scalar (dst + i*BPM_CONV_NUM_ATOMS,
+            src + i*BPM_CONV_NUM_ATOMS, num_samples - i, fmt);
+}
+
+/* 4 samples per iteration. The de-interleaving load gives one vector per
+ * atom and the interleaving store puts the two magnitudes back together */
+static void _bpm_conv_iq_mag_s32_neon (float *dst, const int32_t *src,
+        size_t num_samples, const bpm_conv_fmt_t *fmt)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        int32x4x4_t v = vld4q_s32 (src + i*BPM_CONV_NUM_ATOMS);
+        float32x4_t re0 = vcvtq_f32_s32 (v.val [0]);
+        float32x4_t im0 = vcvtq_f32_s32 (v.val [1]);
+        float32x4_t re1 = vcvtq_f32_s32 (v.val [2]);
+        float32x4_t im1 = vcvtq_f32_s32 (v.val [3]);
+        float32x4x2_t mag;
+
+        mag.val [0] = vsqrtq_f32 (vaddq_f32 (vmulq_f32 (re0, re0),
+                    vmulq_f32 (im0, im0)));
+        mag.val [1] = vsqrtq_f32 (vaddq_f32 (vmulq_f32 (re1, re1),
+                    vmulq_f32 (im1, im1)));
+        mag.val [0] = vaddq_f32 (vmulq_f32 (mag.val [0],
+                    vdupq_n_f32 (fmt->scale [0])), vdupq_n_f32 (fmt->offset [0]));
+        mag.val [1] = vaddq_f32 (vmulq_f32 (mag.val [1],
+                    vdupq_n_f32 (fmt->scale [1])), vdupq_n_f32 (fmt->offset [1]));
+        vst2q_f32 (dst + i*2, mag);
+    }
+
+    _bpm_conv_iq_mag_s32_scalar (dst + i*2, src + i*BPM_CONV_NUM_ATOMS,
+            num_samples - i, fmt);
+}
+
+/* 4 samples per iteration */
+static void _bpm_conv_split4_neon (float *const dst [BPM_CONV_NUM_ATOMS],
+        const float *src, size_t num_samples)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        float32x4x4_t v = vld4q_f32 (src + i*4);
+        vst1q_f32 (dst [0] + i, v.val [0]);
+        vst1q_f32 (dst [1] + i, v.val [1]);
+        vst1q_f32 (dst [2] + i, v.val [2]);
+        vst1q_f32 (dst [3] + i, v.val [3]);
+    }
+
+    float *const rest [BPM_CONV_NUM_ATOMS] = {dst [0] + i, dst [1] + i,
+        dst [2] + i, dst [3] + i};
+    _bpm_conv_split4_scalar (rest, src + i*4, num_samples - i);
+}
+
+/* 4 samples per iteration */
+static void _bpm_conv_split2_neon (float *const dst [BPM_CONV_NUM_ATOMS],
+        const float *src, size_t num_samples)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        float32x4x2_t v = vld2q_f32 (src + i*2);
+        vst1q_f32 (dst [0] + i, v.val [0]);
+        vst1q_f32 (dst [1] + i, v.val [1]);
+    }
+
+    float *const rest [BPM_CONV_NUM_ATOMS] = {dst [0] + i, dst [1] + i,
+        NULL, NULL};
+    _bpm_conv_split2_scalar (rest, src + i*2, num_samples - i);
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used. AVX2 only pays off for the plain conversions, the others
+ * keep the SSE2 kernels */
+static const bpm_conv_ops_t bpm_conv_ops [] = {
+#if defined (BPM_CONV_X86)
+    {.name = "avx2",    .atoms_s16 = _bpm_conv_atoms_s16_avx2,
+        .atoms_s32 = _bpm_conv_atoms_s32_avx2,
+        .iq_mag_s32 = _bpm_conv_iq_mag_s32_sse2,
+        .split4 = _bpm_conv_split4_sse2,
+        .split2 = _bpm_conv_split2_sse2},
+    {.name = "sse2",    .atoms_s16 = _bpm_conv_atoms_s16_sse2,
+        .atoms_s32 = _bpm_conv_atoms_s32_sse2,
+        .iq_mag_s32 = _bpm_conv_iq_mag_s32_sse2,
+        .split4 = _bpm_conv_split4_sse2,
+        .split2 = _bpm_conv_split2_sse2},
+#endif
+#if defined (BPM_CONV_NEON)
+    {.name = "neon",    .atoms_s16 = _bpm_conv_atoms_s16_neon,
+        .atoms_s32 = _bpm_conv_atoms_s32_neon,
+        .iq_mag_s32 = _bpm_conv_iq_mag_s32_neon,
+        .split4 = _bpm_conv_split4_neon,
+        .split2 = _bpm_conv_split2_neon},
+#endif
+    {.name = "scalar",  .atoms_s16 = _bpm_conv_atoms_s16_scalar,
+        .atoms_s32 = _bpm_conv_atoms_s32_scalar,
+        .iq_mag_s32 = _bpm_conv_iq_mag_s32_scalar,
+        .split4 = _bpm_conv_split4_scalar,
+        .split2 = _bpm_conv_split2_scalar}
+};
+
+#define BPM_CONV_OPS_NUM                (sizeof (bpm_conv_ops) / \
+                                            sizeof (bpm_conv_ops [0]))
+
+static bool _bpm_conv_supported (const bpm_conv_ops_t *ops)
+{
+#if defined (BPM_CONV_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "avx2")) {
+        return __builtin_cpu_supports ("avx2");
+    }
+    if (streq (ops->name, "sse2")) {
+        return __builtin_cpu_supports ("sse2");
+    }
+#endif
+    /* NEON is part of the architecture if the compiler targets it */
+    return true;
+}
+
+static const bpm_conv_ops_t *_bpm_conv_get_ops (void)
+{
+    /* Selecting it twice from different threads is harmless */
+    static const bpm_conv_ops_t *ops = NULL;
+
+    if (ops == NULL) {
+        size_t i;
+        for (i = 0; i < BPM_CONV_OPS_NUM - 1; ++i) {
+            if (_bpm_conv_supported (&bpm_conv_ops [i])) {
+                break;
+            }
+        }
+        /* The scalar kernels are always supported */
+        ops = &bpm_conv_ops [i];
+    }
+
+    return ops;
+}
+
+/* Whether "fmt" applies to samples of "sample_size" bytes */
+static bool _bpm_conv_fmt_valid (const bpm_conv_fmt_t *fmt, uint32_t sample_size)
+{
+    uint32_t atom_size = sample_size / BPM_CONV_NUM_ATOMS;
+
+    if (sample_size % BPM_CONV_NUM_ATOMS != 0 ||
+            (atom_size != sizeof (int16_t) && atom_size != sizeof (int32_t))) {
+        return false;
+    }
+
+    switch (fmt->conv) {
+        case BPM_CONV_ATOMS:
+            return true;
+        case BPM_CONV_IQ_MAG:
+            return atom_size == sizeof (int32_t);
+        default:
+            return false;
+    }
+}
+
+/* Convert to interleaved values. "fmt" is valid for "sample_size" */
+static void _bpm_conv_run (const bpm_conv_ops_t *ops, const bpm_conv_fmt_t *fmt,
+        const void *src, uint32_t sample_size, size_t num_samples, float *dst)
+{
+    if (fmt->conv == BPM_CONV_IQ_MAG) {
+        ops->iq_mag_s32 (dst, (const int32_t *) src, num_samples, fmt);
+    }
+    else if (sample_size == BPM_CONV_NUM_ATOMS*sizeof (int16_t)) {
+        ops->atoms_s16 (dst, (const int16_t *) src, num_samples, fmt);
+    }
+    else {
+        ops->atoms_s32 (dst, (const int32_t *) src, num_samples, fmt);
+    }
+}
+
+const char *bpm_conv_kernel_name (void)
+{
+    return _bpm_conv_get_ops ()->name;
+}
+
+uint32_t bpm_conv_num_values (const bpm_conv_fmt_t *fmt)
+{
+    assert (fmt);
+    return (fmt->conv == BPM_CONV_IQ_MAG) ? 2 : BPM_CONV_NUM_ATOMS;
+}
+
+bpm_client_err_e bpm_conv_samples (const bpm_conv_fmt_t *fmt, const void *src,
+        uint32_t sample_size, size_t num_samples, float *dst, size_t plane_size)
+{
+    assert (fmt);
+    assert (src);
+    assert (dst);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    ASSERT_TEST(_bpm_conv_fmt_valid (fmt, sample_size), "Output format does "
+            "not apply to the samples", err_inv_fmt, BPM_CLIENT_ERR_INV_PARAM);
+    ASSERT_TEST(!fmt->planar || plane_size >= num_samples, "Planes are "
+            "smaller than the samples", err_inv_fmt, BPM_CLIENT_ERR_INV_PARAM);
+
+    const bpm_conv_ops_t *ops = _bpm_conv_get_ops ();
+
+    if (!fmt->planar) {
+        _bpm_conv_run (ops, fmt, src, sample_size, num_samples, dst);
+        return err;
+    }
+
+    /* Planes are filled from a chunk converted to interleaved values, which
+     * is still in cache when it is split */
+    uint32_t num_values = bpm_conv_num_values (fmt);
+    bpm_conv_split_fp split = (num_values == BPM_CONV_NUM_ATOMS) ?
+        ops->split4 : ops->split2;
+    float chunk [BPM_CONV_CHUNK_SAMPLES*BPM_CONV_NUM_ATOMS];
+
+    for (size_t i = 0; i < num_samples; i += BPM_CONV_CHUNK_SAMPLES) {
+        size_t n = num_samples - i;
+        if (n > BPM_CONV_CHUNK_SAMPLES) {
+            n = BPM_CONV_CHUNK_SAMPLES;
+        }
+
+        _bpm_conv_run (ops, fmt, (const uint8_t *) src + i*sample_size,
+                sample_size, n, chunk);
+
+        float *planes [BPM_CONV_NUM_ATOMS] = {NULL};
+        for (uint32_t j = 0; j < num_values; ++j) {
+            planes [j] = dst + j*plane_size + i;
+        }
+        split (planes, chunk, n);
+    }
+
+err_inv_fmt:
+    return err;
+}
+
+/**************** Curve conversion ****************/
+
+typedef struct {
+    const bpm_conv_fmt_t *fmt;
+    uint32_t sample_size;           /* Raw sample size, in bytes */
+    float *dst;
+    size_t max_samples;             /* Samples "dst" has room for */
+    size_t num_samples;             /* Samples converted so far */
+} bpm_conv_curve_t;
+
+/* Convert a block of the curve to its place in the output */
+static int _bpm_conv_curve_block (bpm_client_t *self, const void *data,
+        uint64_t offset, uint32_t size, void *arg)
+{
+    (void) self;
+    bpm_conv_curve_t *curve = (bpm_conv_curve_t *) arg;
+
+    /* Blocks hold whole samples, except maybe for the last one */
+    size_t first = offset / curve->sample_size;
+    size_t n = size / curve->sample_size;
+    if (first >= curve->max_samples) {
+        return 0;
+    }
+    if (n > curve->max_samples - first) {
+        n = curve->max_samples - first;
+    }
+
+    float *dst = curve->fmt->planar ? curve->dst + first :
+        curve->dst + first*bpm_conv_num_values (curve->fmt);
+    bpm_conv_samples (curve->fmt, data, curve->sample_size, n, dst,
+            curve->max_samples);
+
+    if (first + n > curve->num_samples) {
+        curve->num_samples = first + n;
+    }
+
+    return 0;
+}
+
+bpm_client_err_e bpm_acq_get_curve_conv (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t window, const bpm_conv_fmt_t *fmt,
+        float *dst, size_t dst_size)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (fmt);
+    assert (dst);
+
+    smio_acq_chan_desc_t chan_desc;
+    bpm_client_err_e err = bpm_acq_get_chan_desc (self, service,
+            acq_trans->req.chan, &chan_desc);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not get the channel "
+            "description", err_chan_desc);
+    ASSERT_TEST(_bpm_conv_fmt_valid (fmt, chan_desc.sample_size), "Output "
+            "format does not apply to the channel", err_inv_fmt,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    uint32_t num_values = bpm_conv_num_values (fmt);
+    bpm_conv_curve_t curve = {
+        .fmt = fmt,
+        .sample_size = chan_desc.sample_size,
+        .dst = dst,
+        .max_samples = dst_size / (num_values*sizeof (float)),
+        .num_samples = 0
+    };
+
+    err = bpm_acq_get_curve_cb (self, service, acq_trans, window,
+            _bpm_conv_curve_block, &curve);
+    acq_trans->block.bytes_read = curve.num_samples*num_values*sizeof (float);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient:conv] "
+            "bpm_acq_get_curve_conv: %zu samples converted with the %s "
+            "kernels\n", curve.num_samples, bpm_conv_kernel_name ());
+
+err_inv_fmt:
+err_chan_desc:
+    return err;
+}
@@ -5,6 +5,11 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "bpm_client.h"
 /* Private headers */
 #include "errhand.h"
@@ -39,55 +44,281 @@
 #define BPMCLIENT_DFLT_LOG_MODE             "w"
 #define BPMCLIENT_MLM_CONNECT_TIMEOUT       1000        /* in ms */
 #define BPMCLIENT_DFLT_TIMEOUT              1000        /* in ms */
+/* Adaptive timeouts (see bpm_client_set_adaptive_timeout ()). Replies an op
+ * needs before its latency is trusted, largest opcode tracked, smallest
+ * reply the bandwidth is measured with and margin the timeouts get over the
+ * latencies expected */
+#define BPMCLIENT_DFLT_TIMEOUT_FLOOR        5           /* in ms */
+#define BPMCLIENT_LAT_MIN_SAMPLES           4
+#define BPMCLIENT_LAT_OPS_MAX               64
+#define BPMCLIENT_LAT_BW_MIN_SIZE           4096        /* in bytes */
+#define BPMCLIENT_LAT_MARGIN                2
+/* Number of streaming credit grants kept in flight */
+#define BPMCLIENT_ACQ_STREAM_GRANTS         2
+/* Number of times the first grant of a direct transfer is retried while
+ * the direct data path connection is being set up, and the interval
+ * between retries */
+#define BPMCLIENT_ACQ_DIRECT_RETRIES        50
+#define BPMCLIENT_ACQ_DIRECT_RETRY_INTERVAL 10          /* in ms */
+/* Largest argument a cached parameter read is keyed by, in bytes, and the
+ * size of the resulting key */
+#define BPMCLIENT_PARAM_CACHE_ARG_MAX       16
+#define BPMCLIENT_PARAM_CACHE_KEY_LEN       (16 + 2*BPMCLIENT_PARAM_CACHE_ARG_MAX)
+/* Most services a client might resolve, and the room for their names */
+#define BPMCLIENT_SERVICES_MAX              512
+#define BPMCLIENT_SERVICES_ARENA_SIZE       (BPMCLIENT_SERVICES_MAX * 32)
+
+/* Latency of the replies to an op, smoothed as TCP does with the round trip
+ * time (RFC 6298) */
+typedef struct {
+    double srtt;                                /* Smoothed latency, in usec */
+    double rttvar;                              /* Smoothed deviation, in usec */
+    double bytes;                               /* Smoothed reply size */
+    uint32_t samples;                           /* Replies measured */
+} bpm_lat_t;
+
+/* Latencies observed on a service */
+typedef struct _bpm_service_lat_t {
+    bpm_lat_t ops [BPMCLIENT_LAT_OPS_MAX];      /* Per opcode */
+    bpm_lat_t small;                            /* Replies of any op smaller than
+                                                   BPMCLIENT_LAT_BW_MIN_SIZE */
+    double bw;                                  /* Smoothed bandwidth of the larger
+                                                   replies, in bytes/usec. 0 if
+                                                   none yet */
+} bpm_service_lat_t;
 
 /* Our structure */
 struct _bpm_client_t {
     zuuid_t * uuid;                             /* Client UUID */
     mlm_client_t *mlm_client;                   /* Malamute client instance */
     int timeout;                                /* Timeout in msec for send/recv */
+    uint32_t busy_poll;                         /* Time in usec to spin on the reply
+                                                   sockets before blocking. 0 to
+                                                   block right away */
+    bool adaptive_timeout;                      /* Derive the timeouts from the
+                                                   latencies observed */
+    uint32_t timeout_floor;                     /* Shortest adaptive timeout, in msec */
+    zhashx_t *service_lats;                     /* Latencies (bpm_service_lat_t),
+                                                   keyed by service. Only created
+                                                   when first needed */
+    bpm_service_lat_t lat_all;                  /* Latencies of every service, for
+                                                   the ones not seen enough yet */
+    bpm_service_lat_t *sync_lat;                /* Latencies of the service of the
+                                                   synchronous request waited for.
+                                                   NULL if none is timed */
+    uint32_t sync_opcode;                       /* Its opcode */
+    size_t sync_size;                           /* Its largest reply expected */
+    int64_t sync_start;                         /* Time it was sent, in the
+                                                   zclock_usecs () time base */
+    int sync_timeout;                           /* Its timeout, in msec */
+    hutils_zmq_opts_t zmq_opts;                 /* ZeroMQ tuning. Only the kernel
+                                                   buffers are per client */
     zpoller_t *poller;                          /* Poller for receiving messages */
     const acq_chan_t *acq_chan;                 /* Acquisition buffer table */
+    zhashx_t *acq_shm_maps;                     /* Shared memory regions mapped, keyed by service */
+    zhashx_t *acq_direct_socks;                 /* Direct data path sockets, keyed by service */
+    zhashx_t *acq_chan_maps;                    /* Channel maps of the ACQ services,
+                                                   keyed by service */
+    char *broker_endp;                          /* Broker endpoint */
+    mlm_client_t *acq_event_client;             /* Malamute client for ACQ events. Only
+                                                   created when first needed */
+    zpoller_t *acq_event_poller;                /* Poller for ACQ events */
+    zhashx_t *acq_event_streams;                /* ACQ event streams subscribed to */
+    mlm_client_t *acq_mcast_client;             /* Malamute client for multicast
+                                                   acquisition blocks. Only created
+                                                   when first subscribing */
+    zpoller_t *acq_mcast_poller;                /* Poller for multicast blocks */
+    zhashx_t *acq_mcast_streams;                /* ACQ event streams whose blocks
+                                                   are subscribed to */
+    zhashx_t *acq_prefetches;                   /* Prefetched curves
+                                                   (bpm_acq_prefetch_t), keyed by
+                                                   service */
+    size_t acq_prefetch_max;                    /* Memory prefetched curves can take */
+    size_t acq_prefetch_used;                   /* Memory prefetched curves take */
+    mlm_client_t *monit_client;                 /* Malamute client for monitoring data.
+                                                   Only created when first needed */
+    zpoller_t *monit_poller;                    /* Poller for monitoring data */
+    mlm_client_t *trig_event_client;            /* Malamute client for trigger events.
+                                                   Only created when first needed */
+    zpoller_t *trig_event_poller;               /* Poller for trigger events */
+    zhashx_t *monit_decoders;                   /* Delta decoders of the monitoring
+                                                   streams, keyed by stream. Only
+                                                   created when first needed */
+    mlm_client_t *param_cache_client;           /* Malamute client for parameter change
+                                                   events. Only created when first
+                                                   needed */
+    zpoller_t *param_cache_poller;              /* Poller for parameter change events */
+    zhashx_t *param_caches;                     /* Parameter caches, keyed by service */
+    zhashx_t *afc_diag_identities;              /* Identities of the AFC_DIAG services,
+                                                   keyed by service. Only created
+                                                   when first needed */
+    zhashx_t *func_table;                       /* Exported functions, keyed by name */
+    uint32_t acq_codec;                         /* Codec requested for ACQ blocks */
+    uint32_t acq_block_retries;                 /* Times a curve block is requested
+                                                   again before giving up */
+    bool acq_crc;                               /* Check ACQ blocks against their
+                                                   CRC32C */
+    uint32_t wire_format;                       /* Request wire format (RW_WIRE_*) */
+    bool write_behind;                          /* Parameter writes do not wait
+                                                   for their reply */
+    uint32_t wb_in_flight;                      /* Write-behind writes not answered
+                                                   yet */
+    bpm_client_err_e wb_err;                    /* First write-behind write failed
+                                                   since the last flush */
+    zhashx_t *async_reqs;                       /* Asynchronous requests in flight,
+                                                   keyed by tracker */
+    uint32_t async_next_id;                     /* Next asynchronous request ID */
+    uint32_t sync_next_id;                      /* Next synchronous request ID */
+    char sync_tracker [BPM_FUNC_ASYNC_TRACKER_LEN]; /* Tracker of the last synchronous
+                                                   request sent */
+    bool local_path;                            /* Use the local fast paths */
+    zhashx_t *local_paths;                      /* Local fast paths, keyed by service */
+    zpoller_t *local_poller;                    /* Poller for the replies, including
+                                                   the local fast paths. Only created
+                                                   when first needed */
+    struct _bpm_local_path_t *local_last;       /* Local fast path the last request was
+                                                   sent through. NULL if the broker */
+    zhashx_t *services;                         /* Resolved services (bpm_service_t),
+                                                   keyed by name */
+    struct _bpm_service_t *service_tbl;         /* Resolved services, by handle. Only
+                                                   allocated when first needed */
+    uint32_t nservices;                         /* Number of resolved services */
+    char *services_arena;                       /* Names of the resolved services, each
+                                                   one after its handle */
+    size_t services_arena_used;                 /* Bytes of the arena in use */
 };
 
+/* Resolved service. Whatever is looked up by service name is kept here, so
+ * the requests to it don't hash the name again */
+typedef struct _bpm_service_t {
+    char *name;                                 /* Name, in the arena */
+    struct _bpm_local_path_t *local_path;       /* Local fast path, owned by
+                                                   local_paths. NULL if not
+                                                   looked up yet */
+    const smio_acq_chan_map_t *chan_map;        /* Channel map, owned by
+                                                   acq_chan_maps. NULL if not
+                                                   fetched yet */
+    bpm_service_lat_t *lat;                     /* Latencies, owned by
+                                                   service_lats. NULL if not
+                                                   looked up yet */
+} bpm_service_t;
+
+/* Local fast path to a service on this host */
+typedef struct _bpm_local_path_t {
+    zsock_t *sock;                              /* DEALER socket to the service */
+    bool failed;                                /* Not available, so the broker
+                                                   is used */
+} bpm_local_path_t;
+
+/* Asynchronous request */
+typedef struct {
+    uint32_t id;                                /* Request ID */
+    uint8_t *output;                            /* User buffer for the reply data */
+    bpm_func_async_fp cb;                       /* Completion callback. NULL if the
+                                                   request is waited for */
+    void *arg;                                  /* Callback argument */
+    int64_t deadline;                           /* Time the reply is due, in the
+                                                   zclock_mono () time base. -1 if
+                                                   none */
+    bool done;                                  /* Request completed, but was not
+                                                   waited for yet */
+    bpm_client_err_e err;                       /* Completion status */
+} bpm_async_req_t;
+
+/* Cached parameter reads of a service */
+typedef struct {
+    zhashx_t *opcodes;                          /* Opcodes whose reads are cached */
+    zhashx_t *values;                           /* Replies (zchunk_t), keyed by opcode
+                                                   and argument */
+} bpm_param_cache_t;
+
+/* Delta decoder of a monitoring stream */
+typedef struct {
+    smio_dsp_monit_t last;                      /* Last update decoded */
+    uint8_t count;                              /* Delta frame counter of "last" */
+    bool valid;                                 /* A keyframe was received since
+                                                   the last update missed */
+} bpm_monit_decoder_t;
+
+/* Curve prefetched from an ACQ service on its completion event */
+typedef struct {
+    acq_trans_t trans;                          /* Curve to prefetch. Its block holds
+                                                   the whole curve */
+    size_t size;                                /* Size of the curve buffer */
+    bool valid;                                 /* Curve of the last acquisition was
+                                                   read, and not consumed yet */
+} bpm_acq_prefetch_t;
+
+/* Shared memory region mapped from an ACQ service */
+typedef struct {
+    uint8_t *base;                              /* Start of the mapped region */
+    size_t size;                                /* Size of the mapped region */
+} acq_shm_map_t;
+
 static bpm_client_t *_bpm_client_new (char *broker_endp, int verbose,
-        const char *log_file_name, const char *log_mode, int timeout);
+        const char *log_file_name, const char *log_mode, int timeout,
+        const hutils_zmq_opts_t *zmq_opts);
+static void _bpm_sock_bufs_set (bpm_client_t *self, zsock_t *sock);
 static bpm_client_err_e _func_polling (bpm_client_t *self, char *name,
-        char *service, uint32_t *input, uint32_t *output, int timeout);
-
-/* Acquisition channel definitions for user's application */
-#if defined(__BOARD_ML605__)
-/* Global structure merging all of the channel's sample sizes */
-acq_chan_t acq_chan[END_CHAN_ID] =  {   [0] = {.chan = ADC0_CHAN_ID, .sample_size = ADC0_SAMPLE_SIZE},
-                                        [1] = {.chan = TBTAMP0_CHAN_ID, .sample_size = TBTAMP0_SAMPLE_SIZE},
-                                        [2] = {.chan = TBTPOS0_CHAN_ID, .sample_size = TBTPOS0_SAMPLE_SIZE},
-                                        [3] = {.chan = FOFBAMP0_CHAN_ID, .sample_size = FOFBAMP0_SAMPLE_SIZE},
-                                        [4] = {.chan = FOFBPOS0_CHAN_ID, .sample_size = FOFBPOS0_SAMPLE_SIZE},
-                                        [5] = {.chan = MONITAMP0_CHAN_ID, .sample_size = MONITAMP0_SAMPLE_SIZE},
-                                        [6] = {.chan = MONITPOS0_CHAN_ID, .sample_size = MONITPOS0_SAMPLE_SIZE},
-                                        [7] = {.chan = MONIT1POS0_CHAN_ID, .sample_size = MONIT1POS0_SAMPLE_SIZE}
-                                    };
-#elif defined(__BOARD_AFCV3__)
-acq_chan_t acq_chan[END_CHAN_ID] =  {   [0]   =  {.chan = ADC0_CHAN_ID, .sample_size = ADC0_SAMPLE_SIZE},
-                                        [1]   =  {.chan = ADCSWAP0_CHAN_ID, .sample_size = ADCSWAP0_SAMPLE_SIZE},
-                                        [2]   =  {.chan = MIXIQ120_CHAN_ID, .sample_size = MIXIQ120_SAMPLE_SIZE},
-                                        [3]   =  {.chan = MIXIQ340_CHAN_ID, .sample_size = MIXIQ340_SAMPLE_SIZE},
-                                        [4]   =  {.chan = TBTDECIMIQ120_CHAN_ID, .sample_size = TBTDECIMIQ120_SAMPLE_SIZE},
-                                        [5]   =  {.chan = TBTDECIMIQ340_CHAN_ID, .sample_size = TBTDECIMIQ340_SAMPLE_SIZE},
-                                        [6]   =  {.chan = TBTAMP0_CHAN_ID, .sample_size = TBTAMP0_SAMPLE_SIZE},
-                                        [7]   =  {.chan = TBTPHA0_CHAN_ID, .sample_size = TBTPHA0_SAMPLE_SIZE},
-                                        [8]   =  {.chan = TBTPOS0_CHAN_ID, .sample_size = TBTPOS0_SAMPLE_SIZE},
-                                        [9]   =  {.chan = FOFBDECIMIQ120_CHAN_ID, .sample_size = FOFBDECIMIQ120_SAMPLE_SIZE},
-                                        [10]  =  {.chan = FOFBDECIMIQ340_CHAN_ID, .sample_size = FOFBDECIMIQ340_SAMPLE_SIZE},
-                                        [11]  =  {.chan = FOFBAMP0_CHAN_ID, .sample_size = FOFBAMP0_SAMPLE_SIZE},
-                                        [12]  =  {.chan = FOFBPHA0_CHAN_ID, .sample_size = FOFBPHA0_SAMPLE_SIZE},
-                                        [13]  =  {.chan = FOFBPOS0_CHAN_ID, .sample_size = FOFBPOS0_SAMPLE_SIZE},
-                                        [14]  =  {.chan = MONITAMP0_CHAN_ID, .sample_size = MONITAMP0_SAMPLE_SIZE},
-                                        [15]  =  {.chan = MONITPOS0_CHAN_ID, .sample_size = MONITPOS0_SAMPLE_SIZE},
-                                        [16]  =  {.chan = MONIT1POS0_CHAN_ID, .sample_size = MONIT1POS0_SAMPLE_SIZE}
-                                    };
-#else
-#error "Unsupported board!"
-#endif
+        char *service, uint32_t *input, uint32_t *output, int64_t timeout_us);
+static int64_t _bpm_mono_usecs (void);
+static void _acq_shm_map_destroy (void **item);
+static void _acq_prefetch_destroy (void **item);
+static void _monit_decoder_destroy (void **item);
+static void _acq_direct_sock_destroy (void **item);
+static void _acq_chan_map_destroy (void **item);
+static void _afc_diag_identity_destroy (void **item);
+static void _bpm_async_req_destroy (void **item);
+static void _bpm_param_cache_destroy (void **item);
+static void _bpm_local_path_destroy (void **item);
+static bpm_local_path_t *_bpm_local_path_get (bpm_client_t *self, char *service);
+static bpm_service_t *_bpm_service_interned (bpm_client_t *self, const char *service);
+static void _bpm_service_lat_destroy (void **item);
+static bpm_service_lat_t *_bpm_service_lat_get (bpm_client_t *self,
+        const char *service);
+static bool _bpm_lat_expected (const bpm_service_lat_t *slat, uint32_t opcode,
+        size_t size, double *expected);
+static void _bpm_lat_update (bpm_lat_t *lat, double latency, double bytes);
+static bool _bpm_func_sync_tracker_match (bpm_client_t *self, const char *tracker);
+static bpm_client_err_e _bpm_param_cache_subscribe (bpm_client_t *self,
+        char *service);
+static void _bpm_param_cache_drain (bpm_client_t *self);
+static bpm_param_cache_t *_bpm_param_cache_values (bpm_client_t *self,
+        char *service, uint32_t operation, const void *arg, size_t arg_size,
+        char *key, size_t key_len);
+static bpm_client_err_e _bpm_func_exec (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, uint32_t *output, bpm_func_reply_t *reply);
+static bpm_client_err_e _bpm_func_exec_send (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, bool has_output, const char *tracker,
+        bool local);
+static bpm_client_err_e _bpm_func_exec_recv (bpm_client_t *self, uint8_t *output8);
+static bpm_client_err_e _bpm_func_exec_recv_view (bpm_client_t *self,
+        bpm_func_reply_t *reply);
+static bpm_client_err_e _bpm_func_exec_reply (zmsg_t **report_p, uint8_t *output8);
+static void _bpm_func_async_finish (bpm_client_t *self, bpm_async_req_t *req,
+        bpm_client_err_e err);
+static void _bpm_func_async_expire (bpm_client_t *self);
+static bpm_client_err_e _bpm_func_exec_async (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, uint32_t *output, bpm_func_async_fp cb,
+        void *arg, int64_t deadline, uint32_t *req_id);
+static void _bpm_func_multi_done (bpm_client_t *self, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg);
+static void _bpm_param_write_behind_done (bpm_client_t *self, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg);
+static bpm_client_err_e _bpm_param_batch_send (bpm_client_t *self,
+        bpm_param_batch_t *batch);
+static zhashx_t *_bpm_func_table_new (void);
+static const disp_op_t *_bpm_func_translate (bpm_client_t *self, const char *name);
+
+/* Acquisition channel definitions for user's application, generated from the
+ * board description, so they match the ones of the server built for the same
+ * board. Clients get the actual ones from each server, see _bpm_acq_chan_map () */
+#define ACQ_CHAN_DEF(name)                                          \
+    [name##0_CHAN_ID] = {.chan = name##0_CHAN_ID, .sample_size = name##0_SAMPLE_SIZE},
+
+acq_chan_t acq_chan[END_CHAN_ID] = {
+    ACQ_CHAN_FOREACH(ACQ_CHAN_DEF)
+};
 
 
 /********************************************************/
@@ -97,28 +328,38 @@ bpm_client_t *bpm_client_new (char *broker_endp, int verbose,
         const char *log_file_name)
 {
     return _bpm_client_new (broker_endp, verbose, log_file_name,
-            BPMCLIENT_DFLT_LOG_MODE, BPMCLIENT_DFLT_TIMEOUT);
+            BPMCLIENT_DFLT_LOG_MODE, BPMCLIENT_DFLT_TIMEOUT, NULL);
 }
 
 bpm_client_t *bpm_client_new_log_mode (char *broker_endp, int verbose,
         const char *log_file_name, const char *log_mode)
 {
     return _bpm_client_new (broker_endp, verbose, log_file_name,
-            log_mode, BPMCLIENT_DFLT_TIMEOUT);
+            log_mode, BPMCLIENT_DFLT_TIMEOUT, NULL);
 }
 
 bpm_client_t *bpm_client_new_log_mode_time (char *broker_endp, int verbose,
         const char *log_file_name, const char *log_mode, int timeout)
 {
     return _bpm_client_new (broker_endp, verbose, log_file_name,
-            log_mode, timeout);
+            log_mode, timeout, NULL);
 }
 
 bpm_client_t *bpm_client_new_time (char *broker_endp, int verbose,
         const char *log_file_name, int timeout)
 {
     return _bpm_client_new (broker_endp, verbose, log_file_name,
-            BPMCLIENT_DFLT_LOG_MODE, timeout);
+            BPMCLIENT_DFLT_LOG_MODE, timeout, NULL);
+}
+
+bpm_client_t *bpm_client_new_zmq_opts (char *broker_endp, int verbose,
+        const char *log_file_name, const char *log_mode, int timeout,
+        const hutils_zmq_opts_t *zmq_opts)
+{
+    const hutils_zmq_opts_t zmq_opts_dflt = HUTILS_ZMQ_OPTS_DFLT;
+
+    return _bpm_client_new (broker_endp, verbose, log_file_name,
+            log_mode, timeout, (zmq_opts != NULL) ? zmq_opts : &zmq_opts_dflt);
 }
 
 void bpm_client_destroy (bpm_client_t **self_p)
@@ -128,6 +369,41 @@ void bpm_client_destroy (bpm_client_t **self_p)
     if (*self_p) {
         bpm_client_t *self = *self_p;
 
+        /* Writes the user was told were done are applied before leaving */
+        if (bpm_client_write_behind_flush (self) != BPM_CLIENT_SUCCESS) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] "
+                    "bpm_client_destroy: Write-behind writes failed\n");
+        }
+
+        zhashx_destroy (&self->services);
+        zhashx_destroy (&self->service_lats);
+        free (self->service_tbl);
+        free (self->services_arena);
+        self->local_last = NULL;
+        zpoller_destroy (&self->local_poller);
+        zhashx_destroy (&self->local_paths);
+        zhashx_destroy (&self->async_reqs);
+        zhashx_destroy (&self->func_table);
+        zhashx_destroy (&self->afc_diag_identities);
+        zhashx_destroy (&self->param_caches);
+        zpoller_destroy (&self->param_cache_poller);
+        mlm_client_destroy (&self->param_cache_client);
+        zpoller_destroy (&self->trig_event_poller);
+        mlm_client_destroy (&self->trig_event_client);
+        zpoller_destroy (&self->monit_poller);
+        mlm_client_destroy (&self->monit_client);
+        zhashx_destroy (&self->monit_decoders);
+        zhashx_destroy (&self->acq_prefetches);
+        zhashx_destroy (&self->acq_mcast_streams);
+        zpoller_destroy (&self->acq_mcast_poller);
+        mlm_client_destroy (&self->acq_mcast_client);
+        zhashx_destroy (&self->acq_event_streams);
+        zpoller_destroy (&self->acq_event_poller);
+        mlm_client_destroy (&self->acq_event_client);
+        free (self->broker_endp);
+        zhashx_destroy (&self->acq_chan_maps);
+        zhashx_destroy (&self->acq_direct_socks);
+        zhashx_destroy (&self->acq_shm_maps);
         self->acq_chan = NULL;
         zpoller_destroy (&self->poller);
         mlm_client_destroy (&self->mlm_client);
@@ -156,9 +432,388 @@ uint32_t bpm_client_get_timeout (bpm_client_t *self)
     return self->timeout;
 }
 
+void bpm_client_set_busy_poll (bpm_client_t *self, uint32_t busy_poll)
+{
+    self->busy_poll = busy_poll;
+}
+
+uint32_t bpm_client_get_busy_poll (bpm_client_t *self)
+{
+    return self->busy_poll;
+}
+
+void bpm_client_set_adaptive_timeout (bpm_client_t *self, bool adaptive)
+{
+    self->adaptive_timeout = adaptive;
+    self->sync_lat = NULL;
+}
+
+bool bpm_client_get_adaptive_timeout (bpm_client_t *self)
+{
+    return self->adaptive_timeout;
+}
+
+void bpm_client_set_timeout_floor (bpm_client_t *self, uint32_t timeout_floor)
+{
+    self->timeout_floor = timeout_floor;
+}
+
+uint32_t bpm_client_get_timeout_floor (bpm_client_t *self)
+{
+    return self->timeout_floor;
+}
+
+bpm_client_err_e bpm_client_set_acq_codec (bpm_client_t *self, uint32_t codec)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    ASSERT_TEST(codec < ACQ_CODEC_END, "Invalid ACQ codec", err_inv_codec,
+            BPM_CLIENT_ERR_INV_PARAM);
+    self->acq_codec = codec;
+
+err_inv_codec:
+    return err;
+}
+
+uint32_t bpm_client_get_acq_codec (bpm_client_t *self)
+{
+    return self->acq_codec;
+}
+
+void bpm_client_set_acq_crc (bpm_client_t *self, bool enable)
+{
+    self->acq_crc = enable;
+}
+
+bool bpm_client_get_acq_crc (bpm_client_t *self)
+{
+    return self->acq_crc;
+}
+
+void bpm_client_set_acq_block_retries (bpm_client_t *self, uint32_t retries)
+{
+    self->acq_block_retries = retries;
+}
+
+uint32_t bpm_client_get_acq_block_retries (bpm_client_t *self)
+{
+    return self->acq_block_retries;
+}
+
+bpm_client_err_e bpm_client_set_acq_prefetch_max (bpm_client_t *self, size_t max)
+{
+    if (max < self->acq_prefetch_used) {
+        return BPM_CLIENT_ERR_INV_PARAM;
+    }
+
+    self->acq_prefetch_max = max;
+    return BPM_CLIENT_SUCCESS;
+}
+
+size_t bpm_client_get_acq_prefetch_max (bpm_client_t *self)
+{
+    return self->acq_prefetch_max;
+}
+
+bpm_client_err_e bpm_client_set_wire_format (bpm_client_t *self, uint32_t format)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    ASSERT_TEST(format < RW_WIRE_END, "Invalid wire format", err_inv_format,
+            BPM_CLIENT_ERR_INV_PARAM);
+    self->wire_format = format;
+
+err_inv_format:
+    return err;
+}
+
+uint32_t bpm_client_get_wire_format (bpm_client_t *self)
+{
+    return self->wire_format;
+}
+
+bpm_client_err_e bpm_client_set_local_path (bpm_client_t *self, bool enable)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    self->local_path = enable;
+    return err;
+}
+
+bool bpm_client_get_local_path (bpm_client_t *self)
+{
+    return self->local_path;
+}
+
+bpm_client_err_e bpm_client_set_write_behind (bpm_client_t *self, bool enable)
+{
+    /* Whatever was written behind is applied before writes wait again */
+    bpm_client_err_e err = bpm_client_write_behind_flush (self);
+    self->write_behind = enable;
+    return err;
+}
+
+bool bpm_client_get_write_behind (bpm_client_t *self)
+{
+    return self->write_behind;
+}
+
+bpm_client_err_e bpm_client_write_behind_flush (bpm_client_t *self)
+{
+    assert (self);
+
+    bpm_client_err_e err = bpm_param_write_behind_wait (self);
+    if (err == BPM_CLIENT_SUCCESS) {
+        err = self->wb_err;
+    }
+    self->wb_err = BPM_CLIENT_SUCCESS;
+    return err;
+}
+
+uint32_t bpm_client_service_resolve (bpm_client_t *self, const char *service)
+{
+    assert (self);
+    assert (service);
+
+    bpm_service_t *svc = (bpm_service_t *) zhashx_lookup (self->services, service);
+    if (svc != NULL) {
+        return svc - self->service_tbl;
+    }
+
+    if (self->service_tbl == NULL) {
+        self->service_tbl = (bpm_service_t *) zmalloc (sizeof (*self->service_tbl) *
+                BPMCLIENT_SERVICES_MAX);
+        ASSERT_ALLOC(self->service_tbl, err_service_tbl_alloc);
+        self->services_arena = (char *) zmalloc (BPMCLIENT_SERVICES_ARENA_SIZE);
+        ASSERT_ALLOC(self->services_arena, err_services_arena_alloc);
+    }
+
+    /* Each name goes after its handle, aligned to it */
+    uint32_t handle = self->nservices;
+    size_t name_len = strlen (service) + 1;
+    size_t entry_size = (sizeof (handle) + name_len + sizeof (handle) - 1) &
+        ~(sizeof (handle) - 1);
+    ASSERT_TEST(handle < BPMCLIENT_SERVICES_MAX &&
+            self->services_arena_used + entry_size <= BPMCLIENT_SERVICES_ARENA_SIZE,
+            "Too many services resolved", err_services_full);
+
+    char *entry = self->services_arena + self->services_arena_used;
+    memcpy (entry, &handle, sizeof (handle));
+    memcpy (entry + sizeof (handle), service, name_len);
+
+    svc = &self->service_tbl [handle];
+    svc->name = entry + sizeof (handle);
+    int rc = zhashx_insert (self->services, svc->name, svc);
+    ASSERT_TEST(rc == 0, "Could not insert service into hash", err_hash_insert);
+
+    self->services_arena_used += entry_size;
+    ++self->nservices;
+    return handle;
+
+err_hash_insert:
+    memset (svc, 0, sizeof (*svc));
+err_services_full:
+    return BPM_CLIENT_SERVICE_INVALID;
+
+err_services_arena_alloc:
+    free (self->service_tbl);
+    self->service_tbl = NULL;
+err_service_tbl_alloc:
+    return BPM_CLIENT_SERVICE_INVALID;
+}
+
+uint32_t bpm_client_service_resolve_smio (bpm_client_t *self, uint32_t board,
+        const char *smio_name, uint32_t inst_id)
+{
+    assert (self);
+    assert (smio_name);
+
+    char service [BPM_CLIENT_SERVICE_NAME_MAX];
+    int len = snprintf (service, sizeof (service), "BPM%u:DEVIO:%s%u", board,
+            smio_name, inst_id);
+    ASSERT_TEST(len > 0 && (size_t) len < sizeof (service), "Service name "
+            "is too long", err_service_len);
+
+    return bpm_client_service_resolve (self, service);
+
+err_service_len:
+    return BPM_CLIENT_SERVICE_INVALID;
+}
+
+char *bpm_client_service_name (bpm_client_t *self, uint32_t handle)
+{
+    assert (self);
+    return (handle < self->nservices) ? self->service_tbl [handle].name : NULL;
+}
+
+bpm_client_err_e bpm_client_set_param_cache (bpm_client_t *self, char *service,
+        uint32_t operation, bool enable)
+{
+    assert (self);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    char opcode_key [BPMCLIENT_PARAM_CACHE_KEY_LEN];
+    snprintf (opcode_key, sizeof (opcode_key), "%"PRIu32, operation);
+
+    bpm_param_cache_t *cache = zhashx_lookup (self->param_caches, service);
+    if (!enable) {
+        if (cache != NULL) {
+            zhashx_delete (cache->opcodes, opcode_key);
+            zhashx_purge (cache->values);
+        }
+        goto param_cache_disabled;
+    }
+
+    /* Nothing is cached before we are subscribed to the change events of
+     * the service, so none of them can be missed */
+    if (cache == NULL) {
+        err = _bpm_param_cache_subscribe (self, service);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not subscribe to "
+                "parameter change events", err_subscribe);
+
+        cache = zmalloc (sizeof *cache);
+        ASSERT_ALLOC(cache, err_cache_alloc, BPM_CLIENT_ERR_ALLOC);
+        zhashx_insert (self->param_caches, service, cache);
+
+        cache->opcodes = zhashx_new ();
+        ASSERT_ALLOC(cache->opcodes, err_cache_opcodes_alloc, BPM_CLIENT_ERR_ALLOC);
+        zhashx_set_destructor (cache->opcodes, (zhashx_destructor_fn *) zstr_free);
+        zhashx_set_duplicator (cache->opcodes, (zhashx_duplicator_fn *) strdup);
+
+        cache->values = zhashx_new ();
+        ASSERT_ALLOC(cache->values, err_cache_values_alloc, BPM_CLIENT_ERR_ALLOC);
+        zhashx_set_destructor (cache->values, (zhashx_destructor_fn *) zchunk_destroy);
+    }
+
+    zhashx_insert (cache->opcodes, opcode_key, opcode_key);
+    return err;
+
+err_cache_values_alloc:
+err_cache_opcodes_alloc:
+    zhashx_delete (self->param_caches, service);
+err_cache_alloc:
+err_subscribe:
+param_cache_disabled:
+    return err;
+}
+
+bool bpm_param_cache_get (bpm_client_t *self, char *service, uint32_t operation,
+        const void *arg, size_t arg_size, void *output, size_t output_size)
+{
+    assert (self);
+    assert (service);
+
+    char key [BPMCLIENT_PARAM_CACHE_KEY_LEN];
+    bpm_param_cache_t *cache = _bpm_param_cache_values (self, service, operation,
+            arg, arg_size, key, sizeof (key));
+    if (cache == NULL) {
+        return false;
+    }
+
+    /* Changes notified so far must not be served from the cache */
+    _bpm_param_cache_drain (self);
+
+    zchunk_t *value = zhashx_lookup (cache->values, key);
+    if (value == NULL || zchunk_size (value) > output_size) {
+        return false;
+    }
+
+    memcpy (output, zchunk_data (value), zchunk_size (value));
+    return true;
+}
+
+void bpm_param_cache_put (bpm_client_t *self, char *service, uint32_t operation,
+        const void *arg, size_t arg_size, const void *data, size_t size)
+{
+    assert (self);
+    assert (service);
+
+    char key [BPMCLIENT_PARAM_CACHE_KEY_LEN];
+    bpm_param_cache_t *cache = _bpm_param_cache_values (self, service, operation,
+            arg, arg_size, key, sizeof (key));
+    if (cache == NULL) {
+        return;
+    }
+
+    zchunk_t *value = zchunk_new (data, size);
+    if (value == NULL) {
+        return;
+    }
+
+    zhashx_update (cache->values, key, value);
+}
+
+void bpm_param_cache_invalidate (bpm_client_t *self, char *service)
+{
+    assert (self);
+    assert (service);
+
+    bpm_param_cache_t *cache = zhashx_lookup (self->param_caches, service);
+    if (cache != NULL) {
+        zhashx_purge (cache->values);
+    }
+}
+
+bpm_client_err_e bpm_param_write_behind (bpm_client_t *self, char *service,
+        zmsg_t **msg_p)
+{
+    assert (self);
+    assert (service);
+    assert (msg_p);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint32_t id = self->async_next_id++;
+
+    bpm_async_req_t *req = (bpm_async_req_t *) zmalloc (sizeof *req);
+    ASSERT_ALLOC(req, err_req_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    req->id = id;
+    req->output = NULL;
+    req->cb = _bpm_param_write_behind_done;
+    req->arg = NULL;
+    req->deadline = (self->timeout < 0) ? -1 : zclock_mono () + self->timeout;
+    req->done = false;
+    req->err = BPM_CLIENT_SUCCESS;
+
+    char tracker [BPM_FUNC_ASYNC_TRACKER_LEN];
+    snprintf (tracker, sizeof (tracker), BPM_FUNC_ASYNC_TRACKER_FMT, req->id);
+
+    /* Replies to asynchronous requests only come through the broker */
+    int rc = bpm_client_sendto (self, service, RW_REQ_COALESCE_SUBJECT, tracker,
+            0, msg_p, false);
+    ASSERT_TEST(rc >= 0, "Could not send write-behind write", err_send,
+            BPM_CLIENT_ERR_SERVER);
+
+    zhashx_insert (self->async_reqs, tracker, req);
+    self->wb_in_flight++;
+    return err;
+
+err_send:
+    free (req);
+err_req_alloc:
+    zmsg_destroy (msg_p);
+    return err;
+}
+
+bpm_client_err_e bpm_param_write_behind_wait (bpm_client_t *self)
+{
+    assert (self);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* Each write expires on its own deadline, so this always returns */
+    while (self->wb_in_flight > 0) {
+        err = bpm_func_async_dispatch (self, self->timeout);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Interrupted while waiting for "
+                "write-behind writes", err_dispatch);
+    }
+
+err_dispatch:
+    return err;
+}
+
 /**************** Static LIB Client Functions ****************/
 static bpm_client_t *_bpm_client_new (char *broker_endp, int verbose,
-        const char *log_file_name, const char *log_mode, int timeout)
+        const char *log_file_name, const char *log_mode, int timeout,
+        const hutils_zmq_opts_t *zmq_opts)
 {
     (void) verbose;
 
@@ -186,6 +841,14 @@ static bpm_client_t *_bpm_client_new (char *broker_endp, int verbose,
     self->uuid = zuuid_new ();
     ASSERT_ALLOC(self->uuid, err_uuid_alloc);
 
+    /* The I/O threads and HWMs are process-wide and must be set before the
+     * MLM client sockets are created. The I/O threads are only changed by
+     * the first client of the process */
+    if (zmq_opts != NULL) {
+        self->zmq_opts = *zmq_opts;
+        hutils_set_zmq_opts (zmq_opts);
+    }
+
     self->mlm_client = mlm_client_new ();
     ASSERT_TEST(self->mlm_client!=NULL, "Could not create MLM client",
             err_mlm_client);
@@ -208,9 +871,122 @@ static bpm_client_t *_bpm_client_new (char *broker_endp, int verbose,
     self->acq_chan = acq_chan;
     /* Initialize timeout */
     self->timeout = timeout;
+    /* Replies are waited for blocking, unless asked for */
+    self->busy_poll = 0;
+    /* And for the fixed timeout, unless asked for */
+    self->adaptive_timeout = false;
+    self->timeout_floor = BPMCLIENT_DFLT_TIMEOUT_FLOOR;
+    self->service_lats = NULL;
+    self->sync_lat = NULL;
+    /* ACQ blocks are not encoded, unless asked for */
+    self->acq_codec = ACQ_CODEC_NONE;
+    self->acq_block_retries = ACQ_BLOCK_DFLT_RETRIES;
+    self->acq_crc = false;
+    /* Requests use the multi-frame form, understood by every server */
+    self->wire_format = RW_WIRE_FRAMES;
+    /* Writes wait for their reply, unless asked otherwise */
+    self->write_behind = false;
+    self->wb_in_flight = 0;
+    self->wb_err = BPM_CLIENT_SUCCESS;
+
+    /* Shared memory regions are only mapped on demand */
+    self->acq_shm_maps = zhashx_new ();
+    ASSERT_ALLOC(self->acq_shm_maps, err_acq_shm_maps_alloc);
+    zhashx_set_destructor (self->acq_shm_maps, _acq_shm_map_destroy);
+    /* Same for the direct data path connections */
+    self->acq_direct_socks = zhashx_new ();
+    ASSERT_ALLOC(self->acq_direct_socks, err_acq_direct_socks_alloc);
+    zhashx_set_destructor (self->acq_direct_socks, _acq_direct_sock_destroy);
+    /* Channel maps are fetched from each ACQ service when first used */
+    self->acq_chan_maps = zhashx_new ();
+    ASSERT_ALLOC(self->acq_chan_maps, err_acq_chan_maps_alloc);
+    zhashx_set_destructor (self->acq_chan_maps, _acq_chan_map_destroy);
+
+    /* ACQ events client is only connected on demand */
+    self->broker_endp = strdup (broker_endp);
+    ASSERT_ALLOC(self->broker_endp, err_broker_endp_alloc);
+    self->acq_event_client = NULL;
+    self->acq_event_poller = NULL;
+    self->acq_event_streams = zhashx_new ();
+    ASSERT_ALLOC(self->acq_event_streams, err_acq_event_streams_alloc);
+    zhashx_set_destructor (self->acq_event_streams,
+            (zhashx_destructor_fn *) zstr_free);
+    zhashx_set_duplicator (self->acq_event_streams,
+            (zhashx_duplicator_fn *) strdup);
+    self->acq_mcast_client = NULL;
+    self->acq_mcast_poller = NULL;
+    self->acq_mcast_streams = NULL;
+    /* No curve is prefetched unless asked for */
+    self->acq_prefetches = zhashx_new ();
+    ASSERT_ALLOC(self->acq_prefetches, err_acq_prefetches_alloc);
+    zhashx_set_destructor (self->acq_prefetches, _acq_prefetch_destroy);
+    self->acq_prefetch_max = ACQ_PREFETCH_DFLT_MAX;
+    self->acq_prefetch_used = 0;
+    /* Same for the monitoring data client */
+    self->monit_client = NULL;
+    self->monit_poller = NULL;
+    self->monit_decoders = NULL;
+    /* Same for the trigger event client */
+    self->trig_event_client = NULL;
+    self->trig_event_poller = NULL;
+    /* AFC_DIAG identities are memoized when first read */
+    self->afc_diag_identities = NULL;
+    /* And for the parameter change events client. No parameter is cached
+     * unless asked for */
+    self->param_cache_client = NULL;
+    self->param_cache_poller = NULL;
+    self->param_caches = zhashx_new ();
+    ASSERT_ALLOC(self->param_caches, err_param_caches_alloc);
+    zhashx_set_destructor (self->param_caches, _bpm_param_cache_destroy);
+
+    /* Index all of the exported functions by name, so we don't have to
+     * search every SMIO table on each call */
+    self->func_table = _bpm_func_table_new ();
+    ASSERT_ALLOC(self->func_table, err_func_table_alloc);
+
+    /* No asynchronous requests in flight */
+    self->async_reqs = zhashx_new ();
+    ASSERT_ALLOC(self->async_reqs, err_async_reqs_alloc);
+    zhashx_set_destructor (self->async_reqs, _bpm_async_req_destroy);
+    self->async_next_id = 0;
+    self->sync_next_id = 0;
+
+    /* Local fast paths are only connected on demand */
+    self->local_path = true;
+    self->local_paths = zhashx_new ();
+    ASSERT_ALLOC(self->local_paths, err_local_paths_alloc);
+    zhashx_set_destructor (self->local_paths, _bpm_local_path_destroy);
+    self->local_poller = NULL;
+    self->local_last = NULL;
+
+    /* Services are resolved on demand */
+    self->services = zhashx_new ();
+    ASSERT_ALLOC(self->services, err_services_alloc);
 
     return self;
 
+err_services_alloc:
+    zhashx_destroy (&self->local_paths);
+err_local_paths_alloc:
+    zhashx_destroy (&self->async_reqs);
+err_async_reqs_alloc:
+    zhashx_destroy (&self->func_table);
+err_func_table_alloc:
+    zhashx_destroy (&self->param_caches);
+err_param_caches_alloc:
+    zhashx_destroy (&self->acq_prefetches);
+err_acq_prefetches_alloc:
+    zhashx_destroy (&self->acq_event_streams);
+err_acq_event_streams_alloc:
+    free (self->broker_endp);
+err_broker_endp_alloc:
+    zhashx_destroy (&self->acq_chan_maps);
+err_acq_chan_maps_alloc:
+    zhashx_destroy (&self->acq_direct_socks);
+err_acq_direct_socks_alloc:
+    zhashx_destroy (&self->acq_shm_maps);
+err_acq_shm_maps_alloc:
+    zpoller_destroy (&self->poller);
 err_init_poller:
 err_mlm_inv_client_socket:
 err_mlm_connect:
@@ -228,549 +1004,1233 @@ err_self_alloc:
 bpm_client_err_e bpm_func_exec (bpm_client_t *self, const disp_op_t *func,
         char *service, uint32_t *input, uint32_t *output)
 {
-    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
-    uint8_t *input8 = (uint8_t *) input;
-    uint8_t *output8 = (uint8_t *) output;
+    return _bpm_func_exec (self, func, service, input, output, NULL);
+}
 
-    /* Check input arguments */
-    ASSERT_TEST(self != NULL, "Bpm_client is NULL", err_null_exp,
-            BPM_CLIENT_ERR_INV_FUNCTION);
-    ASSERT_TEST(func != NULL, "Function structure is NULL", err_null_exp,
-            BPM_CLIENT_ERR_INV_FUNCTION);
-    ASSERT_TEST(!(func->args[0] != DISP_ARG_END && input8 == NULL),
-            "Invalid input arguments!", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
-    ASSERT_TEST(!(func->retval != DISP_ARG_END && output8 == NULL),
-            "Invalid output arguments!", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+bpm_client_err_e bpm_func_exec_view (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, bpm_func_reply_t *reply)
+{
+    assert (reply);
+    *reply = (bpm_func_reply_t) {0};
+    return _bpm_func_exec (self, func, service, input, NULL, reply);
+}
 
-    /* Create the message */
-    zmsg_t *msg = zmsg_new ();
-    ASSERT_ALLOC(msg, err_msg_alloc, BPM_CLIENT_ERR_ALLOC);
+void bpm_func_reply_release (bpm_func_reply_t *reply)
+{
+    assert (reply);
+    zmsg_destroy (&reply->msg);
+    reply->data = NULL;
+    reply->size = 0;
+}
 
-    /* Add the frame containing the opcode for the function desired (always first) */
-    zmsg_addmem (msg, &func->opcode, sizeof (func->opcode));
+/* Execute a function, copying the reply data to "output" or, if "reply" is
+ * not NULL, leaving it in the received message */
+static bpm_client_err_e _bpm_func_exec (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, uint32_t *output, bpm_func_reply_t *reply)
+{
+    /* While tracing, the tracker also tells the server which request its
+     * trace records belong to */
+    const char *tracker = NULL;
+    bool tracing = false;
+    if (self != NULL) {
+        tracker = bpm_func_sync_tracker_new (self);
+        tracing = DBE_TRACING ();
+    }
+    if (tracing) {
+        errhand_trace_set_req (errhand_trace_req_id (
+                    zuuid_str_canonical (self->uuid), tracker));
+    }
 
-    /* Add the arguments in their respective frames in the message */
-    for (int i = 0; func->args[i] != DISP_ARG_END; ++i) {
-        /* Get the size of the message being sent */
-        uint32_t in_size = DISP_GET_ASIZE(func->args[i]);
-        /* Create a frame to compose the message */
-        zmsg_addmem (msg, input8, in_size);
-        /* Moves along the pointer */
-        input8 += in_size;
+    DBE_TRACE_STAGE (DBG_LIB_CLIENT | DBG_LVL_TRACE, "client:send", ERRHAND_TRACE_BEGIN);
+    bpm_client_err_e err = _bpm_func_exec_send (self, func, service, input,
+            output != NULL || reply != NULL, tracker, true);
+    DBE_TRACE_STAGE (DBG_LIB_CLIENT | DBG_LVL_TRACE, "client:send", ERRHAND_TRACE_END);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not send function request",
+            err_send);
+    bpm_client_sync_op_begin (self, service, func->opcode,
+            (func->retval != DISP_ARG_END) ? DISP_GET_ASIZE(func->retval) : 0);
+
+    DBE_TRACE_STAGE (DBG_LIB_CLIENT | DBG_LVL_TRACE, "client:recv", ERRHAND_TRACE_BEGIN);
+    if (reply != NULL) {
+        err = _bpm_func_exec_recv_view (self, reply);
     }
+    else {
+        err = _bpm_func_exec_recv (self, (uint8_t *) output);
+    }
+    DBE_TRACE_STAGE (DBG_LIB_CLIENT | DBG_LVL_TRACE, "client:recv", ERRHAND_TRACE_END);
 
-    mlm_client_sendto (self->mlm_client, service, NULL, NULL, 0, &msg);
+err_send:
+    if (tracing) {
+        errhand_trace_set_req (0);
+    }
+    return err;
+}
 
-    /* Receive report */
-    zmsg_t *report = param_client_recv_timeout (self);
-    ASSERT_TEST(report != NULL, "Report received is NULL", err_msg);
+/**************** Asynchronous Function Execution *********/
 
-    /* Message is:
-     * frame 0: Error code
-     * frame 1: Number of bytes received
-     * frame 2+: Data received      */
-
-    /* Handling malformed messages */
-    size_t msg_size = zmsg_size (report);
-    ASSERT_TEST(msg_size == MSG_ERR_CODE_SIZE || msg_size == MSG_FULL_SIZE,
-            "Unexpected message received", err_msg);
-
-    /* Get message contents */
-    zframe_t *err_code = zmsg_pop(report);
-    ASSERT_TEST(err_code != NULL, "Could not receive error code", err_msg);
-    err = *(uint32_t *)zframe_data(err_code);
-
-    zframe_t *data_size_frm = NULL;
-    zframe_t *data_frm = NULL;
-    if (msg_size == MSG_FULL_SIZE)
-    {
-        data_size_frm = zmsg_pop (report);
-        ASSERT_TEST(data_size_frm != NULL, "Could not receive data size", err_null_data_size);
-        data_frm = zmsg_pop (report);
-        ASSERT_TEST(data_frm != NULL, "Could not receive data", err_null_data);
-
-        ASSERT_TEST(zframe_size (data_size_frm) == RW_REPLY_SIZE,
-                "Wrong <number of payload bytes> parameter size", err_msg_fmt);
-
-        /* Size in the second frame must match the frame size of the third */
-        RW_REPLY_TYPE data_size = *(RW_REPLY_TYPE *) zframe_data(data_size_frm);
-        ASSERT_TEST(data_size == zframe_size (data_frm),
-                "<payload> parameter size does not match size in <number of payload bytes> parameter",
-                err_msg_fmt);
+bpm_client_err_e bpm_func_exec_async (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, uint32_t *output, bpm_func_async_fp cb,
+        void *arg, uint32_t *req_id)
+{
+    int64_t deadline = (self->timeout < 0) ? -1 : zclock_mono () + self->timeout;
+    return _bpm_func_exec_async (self, func, service, input, output, cb, arg,
+            deadline, req_id);
+}
 
-        uint32_t *data_out = (uint32_t *)zframe_data(data_frm);
-        /* Copy message contents to user */
-        memcpy (output8, data_out, data_size);
+/* Same as bpm_func_exec_async, but the reply is due at "deadline" */
+static bpm_client_err_e _bpm_func_exec_async (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, uint32_t *output, bpm_func_async_fp cb,
+        void *arg, int64_t deadline, uint32_t *req_id)
+{
+    assert (self);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    /* IDs are used up even if the request fails, so consecutive calls
+     * always get consecutive IDs */
+    uint32_t id = self->async_next_id++;
+
+    bpm_async_req_t *req = (bpm_async_req_t *) zmalloc (sizeof *req);
+    ASSERT_ALLOC(req, err_req_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    req->id = id;
+    req->output = (uint8_t *) output;
+    req->cb = cb;
+    req->arg = arg;
+    req->deadline = deadline;
+    req->done = false;
+    req->err = BPM_CLIENT_SUCCESS;
+
+    /* The server sends the tracker back with the reply, so we can tell our
+     * replies apart */
+    char tracker [BPM_FUNC_ASYNC_TRACKER_LEN];
+    snprintf (tracker, sizeof (tracker), BPM_FUNC_ASYNC_TRACKER_FMT, req->id);
+
+    err = _bpm_func_exec_send (self, func, service, input, output != NULL, tracker,
+            false);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not send asynchronous function "
+            "request", err_send);
+
+    zhashx_insert (self->async_reqs, tracker, req);
+    if (req_id != NULL) {
+        *req_id = req->id;
     }
 
-err_msg_fmt:
-    zframe_destroy (&data_frm);
-err_null_data:
-    zframe_destroy (&data_size_frm);
-err_null_data_size:
-    zframe_destroy (&err_code);
-err_msg:
-    zmsg_destroy (&report);
-err_msg_alloc:
-    zmsg_destroy (&msg);
-err_null_exp:
-err_inv_param:
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_func_exec_async: "
+            "Request %u (%s) sent to %s\n", req->id, func->name, service);
+    return err;
+
+err_send:
+    free (req);
+err_req_alloc:
     return err;
 }
 
-const disp_op_t *bpm_func_translate (char *name)
+bool bpm_func_async_complete (bpm_client_t *self, zmsg_t **report_p)
 {
-    assert (name);
+    assert (self);
+    assert (report_p);
 
-    /* Search the function table for a match in the 'name' field */
-    for (int i=0; smio_exp_ops[i] != NULL; i++) {
-        for (int j=0; smio_exp_ops[i][j] != NULL; j++) {
-            if (streq(name, smio_exp_ops[i][j]->name)) {
-                return smio_exp_ops[i][j];
-            }
-        }
+    /* Synchronous requests might have a tracker too */
+    const char *tracker = mlm_client_tracker (self->mlm_client);
+    if (tracker == NULL || strncmp (tracker, BPM_FUNC_ASYNC_TRACKER_PREFIX,
+                strlen (BPM_FUNC_ASYNC_TRACKER_PREFIX)) != 0) {
+        return false;
     }
 
-    return 0;
+    bpm_async_req_t *req = (bpm_async_req_t *) zhashx_lookup (self->async_reqs,
+            tracker);
+    if (req == NULL || req->done) {
+        /* Reply to a request which was cancelled or already timed out */
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_func_async_complete: "
+                "Discarding reply to unknown request %s\n", tracker);
+        zmsg_destroy (report_p);
+        return true;
+    }
+
+    bpm_client_err_e err = _bpm_func_exec_reply (report_p, req->output);
+    _bpm_func_async_finish (self, req, err);
+    return true;
 }
 
-bpm_client_err_e bpm_func_trans_exec (bpm_client_t *self, char *name, char *service, uint32_t *input, uint32_t *output)
+const char *bpm_func_sync_tracker_new (bpm_client_t *self)
 {
-    const disp_op_t *func = bpm_func_translate(name);
-    bpm_client_err_e err = bpm_func_exec (self, func, service, input, output);
-    return err;
-}
+    assert (self);
 
-/********************** Accessor Methods **********************/
+    snprintf (self->sync_tracker, sizeof (self->sync_tracker),
+            BPM_FUNC_SYNC_TRACKER_FMT, self->sync_next_id++);
+    return self->sync_tracker;
+}
 
-mlm_client_t *bpm_get_mlm_client (bpm_client_t *self)
+bool bpm_func_sync_reply_match (bpm_client_t *self)
 {
     assert (self);
-    return self->mlm_client;
+    return _bpm_func_sync_tracker_match (self,
+            mlm_client_tracker (self->mlm_client));
 }
 
-/**************** FMC ADC COMMON SMIO Functions ****************/
-
-PARAM_FUNC_CLIENT_WRITE(fmc_leds)
+static bool _bpm_func_sync_tracker_match (bpm_client_t *self, const char *tracker)
 {
-    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_LEDS,
-            fmc_leds);
-}
+    /* Streamed data carries no tracker and neither do the replies of
+     * servers that do not send it back. These cannot be told apart */
+    if (tracker == NULL || *tracker == '\0') {
+        return true;
+    }
 
-PARAM_FUNC_CLIENT_READ(fmc_leds)
-{
-    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_LEDS,
-            fmc_leds);
-}
+    if (streq (tracker, self->sync_tracker)) {
+        return true;
+    }
 
-PARAM_FUNC_CLIENT_WRITE(adc_test_data_en)
-{
-    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TEST_DATA_EN, adc_test_data_en);
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_func_sync_reply_match: "
+            "Discarding late reply to request %s, waiting for %s\n", tracker,
+            self->sync_tracker);
+    return false;
 }
 
-PARAM_FUNC_CLIENT_READ(adc_test_data_en)
-{
-     return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TEST_DATA_EN, adc_test_data_en);
-}
+/**************** Local fast path *********/
 
-PARAM_FUNC_CLIENT_WRITE(trig_dir)
+int bpm_client_sendto (bpm_client_t *self, char *service, const char *subject,
+        const char *tracker, uint32_t timeout, zmsg_t **msg_p, bool local)
 {
-    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TRIG_DIR, trig_dir);
-}
+    assert (self);
+    assert (service);
+    assert (msg_p);
+
+    bpm_local_path_t *path = (local && self->local_path) ?
+        _bpm_local_path_get (self, service) : NULL;
+    self->local_last = path;
+    if (path == NULL) {
+        return mlm_client_sendto (self->mlm_client, service, subject, tracker,
+                timeout, msg_p);
+    }
 
-PARAM_FUNC_CLIENT_READ(trig_dir)
-{
-    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TRIG_DIR, trig_dir);
+    /* Message is:
+     * frame 0: subject
+     * frame 1: tracker
+     * frame n: same as through the broker */
+    int rc = zmsg_pushstr (*msg_p, (tracker != NULL) ? tracker : "");
+    if (rc == 0) {
+        rc = zmsg_pushstr (*msg_p, (subject != NULL) ? subject : "");
+    }
+    if (rc == 0) {
+        rc = zmsg_send (msg_p, path->sock);
+    }
+    zmsg_destroy (msg_p);
+    return rc;
 }
 
-PARAM_FUNC_CLIENT_WRITE(trig_term)
+zpoller_t *bpm_client_get_reply_poller (bpm_client_t *self)
 {
-    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TRIG_TERM, trig_term);
+    assert (self);
+    return (self->local_poller != NULL) ? self->local_poller : self->poller;
 }
 
-PARAM_FUNC_CLIENT_READ(trig_term)
+zmsg_t *bpm_client_local_recv (bpm_client_t *self, zsock_t *sock)
 {
-    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TRIG_TERM, trig_term);
-}
+    assert (self);
+    assert (sock);
 
-PARAM_FUNC_CLIENT_WRITE(trig_val)
-{
-    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TRIG_VAL, trig_val);
+    /* Message is:
+     * frame 0: tracker
+     * frame n: same as through the broker */
+    zmsg_t *msg = zmsg_recv (sock);
+    if (msg == NULL) {
+        return NULL;
+    }
+
+    char *tracker = zmsg_popstr (msg);
+    if (tracker == NULL || !_bpm_func_sync_tracker_match (self, tracker)) {
+        zmsg_destroy (&msg);
+    }
+    free (tracker);
+    return msg;
 }
 
-PARAM_FUNC_CLIENT_READ(trig_val)
+void bpm_client_local_expired (bpm_client_t *self)
 {
-    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TRIG_VAL, trig_val);
-}
+    assert (self);
 
-/**************** FMC ACTIVE CLOCK SMIO Functions ****************/
+    bpm_local_path_t *path = self->local_last;
+    if (path == NULL || path->failed) {
+        return;
+    }
 
-/* FUNCTION pin functions */
-PARAM_FUNC_CLIENT_WRITE(fmc_pll_function)
-{
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_FUNCTION,
-            fmc_pll_function);
+    /* The service might have moved or hung up. The socket is dropped, so a
+     * late reply cannot be taken for the reply to a later request */
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] Local fast path did "
+            "not reply, falling back to the broker\n");
+    zpoller_remove (self->local_poller, path->sock);
+    zsock_destroy (&path->sock);
+    path->failed = true;
+    self->local_last = NULL;
 }
 
-PARAM_FUNC_CLIENT_READ(fmc_pll_function)
-{
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_FUNCTION,
-            fmc_pll_function);
-}
+/**************** Adaptive timeouts *********/
 
-/* STATUS pin functions */
-PARAM_FUNC_CLIENT_WRITE(fmc_pll_status)
+void bpm_client_sync_op_begin (bpm_client_t *self, const char *service,
+        uint32_t opcode, size_t size)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_STATUS,
-            fmc_pll_status);
-}
+    assert (self);
+    assert (service);
 
-PARAM_FUNC_CLIENT_READ(fmc_pll_status)
-{
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_STATUS,
-            fmc_pll_status);
-}
+    self->sync_lat = NULL;
+    if (!self->adaptive_timeout || opcode >= BPMCLIENT_LAT_OPS_MAX) {
+        return;
+    }
 
-/* CLK_SEL pin functions */
-PARAM_FUNC_CLIENT_WRITE(fmc_clk_sel)
-{
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_CLK_SEL,
-            fmc_clk_sel);
-}
+    bpm_service_lat_t *slat = _bpm_service_lat_get (self, service);
+    if (slat == NULL) {
+        return;
+    }
 
-PARAM_FUNC_CLIENT_READ(fmc_clk_sel)
-{
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_CLK_SEL,
-            fmc_clk_sel);
-}
+    /* The service own latencies first, then the ones of every service, as
+     * the same ops of different boards take about as long */
+    double expected;
+    int timeout = self->timeout;
+    if (_bpm_lat_expected (slat, opcode, size, &expected) ||
+            _bpm_lat_expected (&self->lat_all, opcode, size, &expected)) {
+        double ms = BPMCLIENT_LAT_MARGIN * expected / 1000 + 1;
+        ms = (ms < self->timeout_floor) ? self->timeout_floor : ms;
+        if (self->timeout < 0 || ms < self->timeout) {
+            timeout = (int) ms;
+        }
+    }
 
-PARAM_FUNC_CLIENT_WRITE(si571_oe)
-{
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_OE, si571_oe);
+    self->sync_lat = slat;
+    self->sync_opcode = opcode;
+    self->sync_size = size;
+    self->sync_timeout = timeout;
+    self->sync_start = zclock_usecs ();
 }
 
-PARAM_FUNC_CLIENT_READ(si571_oe)
+int bpm_client_sync_op_timeout (bpm_client_t *self)
 {
-     return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_OE, si571_oe);
+    assert (self);
+    return (self->sync_lat != NULL) ? self->sync_timeout : self->timeout;
 }
 
-PARAM_FUNC_CLIENT_WRITE(ad9510_defaults)
+void bpm_client_sync_op_end (bpm_client_t *self, zmsg_t *report)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CFG_DEFAULTS,
-            ad9510_defaults);
+    assert (self);
+
+    bpm_service_lat_t *slat = self->sync_lat;
+    if (slat == NULL) {
+        return;
+    }
+    self->sync_lat = NULL;
+
+    double latency = (double) (zclock_usecs () - self->sync_start);
+    bpm_lat_t *lat = &slat->ops [self->sync_opcode];
+
+    /* A timeout counts as a reply that took the whole timeout, so the
+     * timeouts of a service grow while it keeps timing out, and a slower
+     * one is learned too. Only replies count for every service, though */
+    if (report == NULL) {
+        _bpm_lat_update (lat, latency, lat->bytes);
+        return;
+    }
+
+    double bytes = (double) zmsg_content_size (report);
+    bpm_service_lat_t *slats [] = {slat, &self->lat_all};
+    for (size_t i = 0; i < sizeof (slats) / sizeof (slats [0]); ++i) {
+        _bpm_lat_update (&slats [i]->ops [self->sync_opcode], latency, bytes);
+        if (bytes < BPMCLIENT_LAT_BW_MIN_SIZE) {
+            _bpm_lat_update (&slats [i]->small, latency, bytes);
+        }
+        else {
+            double bw = bytes / ((latency > 1) ? latency : 1);
+            slats [i]->bw = (slats [i]->bw == 0) ? bw :
+                0.875 * slats [i]->bw + 0.125 * bw;
+        }
+    }
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_defaults)
+bpm_client_err_e bpm_func_async_dispatch (bpm_client_t *self, int timeout)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CFG_DEFAULTS,
-            ad9510_defaults);
+    assert (self);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* timeout < 0 means "infinite" wait for the first reply. The others
+     * are only processed if they have already arrived */
+    int wait = timeout;
+    while (true) {
+        void *which = zpoller_wait (self->poller, wait);
+        if (which == NULL) {
+            if (zpoller_terminated (self->poller)) {
+                err = BPM_CLIENT_INT;
+            }
+            break;
+        }
+
+        zmsg_t *report = mlm_client_recv (self->mlm_client);
+        if (report == NULL) {
+            err = BPM_CLIENT_INT;
+            break;
+        }
+
+        /* Not a reply to an asynchronous request. As no synchronous one is
+         * in progress, it can only be a late reply to an old one */
+        if (!bpm_func_async_complete (self, &report)) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] "
+                    "bpm_func_async_dispatch: Discarding late synchronous reply\n");
+            zmsg_destroy (&report);
+        }
+
+        wait = 0;
+    }
+
+    _bpm_func_async_expire (self);
+    return err;
 }
 
-/* AD9510 PLL A divider */
-PARAM_FUNC_CLIENT_WRITE(ad9510_pll_a_div)
+bpm_client_err_e bpm_func_async_wait (bpm_client_t *self, uint32_t req_id)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_A_DIV,
-            ad9510_pll_a_div);
+    assert (self);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    char tracker [BPM_FUNC_ASYNC_TRACKER_LEN];
+    snprintf (tracker, sizeof (tracker), BPM_FUNC_ASYNC_TRACKER_FMT, req_id);
+
+    bpm_async_req_t *req = (bpm_async_req_t *) zhashx_lookup (self->async_reqs,
+            tracker);
+    ASSERT_TEST(req != NULL && req->cb == NULL, "Unknown asynchronous request",
+            err_inv_req, BPM_CLIENT_ERR_INV_PARAM);
+
+    /* Replies to the other requests are processed as they arrive. Each
+     * request expires on its own deadline, so this always returns */
+    while (!req->done) {
+        int wait = -1;
+        if (req->deadline >= 0) {
+            int64_t remaining = req->deadline - zclock_mono ();
+            wait = (remaining > 0) ? (int) remaining : 0;
+        }
+
+        err = bpm_func_async_dispatch (self, wait);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Interrupted while waiting for "
+                "asynchronous request", err_dispatch);
+    }
+
+    err = req->err;
+    zhashx_delete (self->async_reqs, tracker);
+
+err_dispatch:
+err_inv_req:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_pll_a_div)
+void bpm_func_async_cancel (bpm_client_t *self, uint32_t req_id)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_A_DIV,
-            ad9510_pll_a_div);
+    assert (self);
+
+    char tracker [BPM_FUNC_ASYNC_TRACKER_LEN];
+    snprintf (tracker, sizeof (tracker), BPM_FUNC_ASYNC_TRACKER_FMT, req_id);
+    zhashx_delete (self->async_reqs, tracker);
 }
 
-/* AD9510 PLL B divider */
-PARAM_FUNC_CLIENT_WRITE(ad9510_pll_b_div)
+size_t bpm_func_async_pending (bpm_client_t *self)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_B_DIV,
-            ad9510_pll_b_div);
+    assert (self);
+    return zhashx_size (self->async_reqs);
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_pll_b_div)
+/* Fan-out request in progress */
+typedef struct {
+    uint32_t first_id;                          /* ID of the request to the
+                                                   first service */
+    bpm_client_err_e *errs;                     /* Status of each service */
+    size_t pending;                             /* Replies still expected */
+} bpm_func_multi_t;
+
+bpm_client_err_e bpm_func_exec_multi (bpm_client_t *self, const disp_op_t *func,
+        char **services, size_t num_services, uint32_t *input, void *outputs,
+        size_t output_size, bpm_client_err_e *errs, int timeout)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_B_DIV,
-            ad9510_pll_b_div);
+    assert (self);
+    assert (services);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    bpm_client_err_e *errs_alloc = NULL;
+    uint8_t *outputs8 = (uint8_t *) outputs;
+
+    if (errs == NULL) {
+        errs_alloc = (bpm_client_err_e *) zmalloc (num_services * sizeof (*errs));
+        ASSERT_ALLOC(errs_alloc, err_errs_alloc, BPM_CLIENT_ERR_ALLOC);
+        errs = errs_alloc;
+    }
+
+    /* Request IDs are handed out in sequence, so the reply to service "i"
+     * is the one to request first_id + i */
+    bpm_func_multi_t multi = {
+        .first_id = self->async_next_id,
+        .errs = errs,
+        .pending = 0
+    };
+
+    /* A single deadline for all of the services */
+    int64_t deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+
+    for (size_t i = 0; i < num_services; ++i) {
+        uint32_t *output = (outputs8 != NULL) ?
+            (uint32_t *) (outputs8 + i*output_size) : NULL;
+        errs [i] = _bpm_func_exec_async (self, func, services [i], input, output,
+                _bpm_func_multi_done, &multi, deadline, NULL);
+        if (errs [i] == BPM_CLIENT_SUCCESS) {
+            multi.pending++;
+        }
+    }
+
+    /* Requests expire on the deadline, so every one of them completes */
+    while (multi.pending > 0) {
+        int wait = -1;
+        if (deadline >= 0) {
+            int64_t remaining = deadline - zclock_mono ();
+            wait = (remaining > 0) ? (int) remaining : 0;
+        }
+
+        bpm_client_err_e derr = bpm_func_async_dispatch (self, wait);
+        if (derr != BPM_CLIENT_SUCCESS) {
+            /* The buffers are going away, so drop the replies still due */
+            for (size_t i = 0; i < num_services; ++i) {
+                if (errs [i] == BPM_CLIENT_SUCCESS) {
+                    bpm_func_async_cancel (self, multi.first_id + i);
+                }
+            }
+            err = derr;
+            goto err_dispatch;
+        }
+    }
+
+    /* Report the first failure, if any */
+    for (size_t i = 0; i < num_services; ++i) {
+        if (errs [i] != BPM_CLIENT_SUCCESS) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] bpm_func_exec_multi: "
+                    "%s failed for service %s: %s\n", func->name, services [i],
+                    bpm_client_err_str (errs [i]));
+            if (err == BPM_CLIENT_SUCCESS) {
+                err = errs [i];
+            }
+        }
+    }
+
+err_dispatch:
+    free (errs_alloc);
+err_errs_alloc:
+    return err;
 }
 
-/* AD9510 PLL Prescaler */
-PARAM_FUNC_CLIENT_WRITE(ad9510_pll_prescaler)
+static void _bpm_func_multi_done (bpm_client_t *self, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PRESCALER,
-            ad9510_pll_prescaler);
+    (void) self;
+    (void) output;
+    bpm_func_multi_t *multi = (bpm_func_multi_t *) arg;
+
+    multi->errs [req_id - multi->first_id] = err;
+    multi->pending--;
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_pll_prescaler)
+/**************** Parameter Batches *********/
+
+/* Operation of a parameter batch */
+typedef struct {
+    const disp_op_t *func;                      /* Function descriptor */
+    uint32_t *output;                           /* Where the reply goes. NULL
+                                                   for none */
+    bpm_client_err_e err;                       /* Completion status */
+} bpm_param_batch_op_t;
+
+struct _bpm_param_batch_t {
+    char *service;                              /* Service the batch is for */
+    uint32_t num_ops;                           /* Operations added */
+    bpm_param_batch_op_t ops [SMIO_BATCH_MAX_OPS];
+    size_t size;                                /* Bytes of "data" used */
+    uint8_t data [SMIO_BATCH_MAX_SIZE];         /* Operations, as sent */
+};
+
+bpm_param_batch_t *bpm_param_batch_new (char *service)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PRESCALER,
-            ad9510_pll_prescaler);
+    assert (service);
+
+    bpm_param_batch_t *self = (bpm_param_batch_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+    self->service = strdup (service);
+    ASSERT_ALLOC(self->service, err_service_alloc);
+
+    return self;
+
+err_service_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
 }
 
-/* AD9510 R divider */
-PARAM_FUNC_CLIENT_WRITE(ad9510_r_div)
+void bpm_param_batch_destroy (bpm_param_batch_t **self_p)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_R_DIV,
-            ad9510_r_div);
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_param_batch_t *self = *self_p;
+
+        free (self->service);
+        free (self);
+        *self_p = NULL;
+    }
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_r_div)
+bpm_client_err_e bpm_param_batch_add (bpm_param_batch_t *self,
+        const disp_op_t *func, uint32_t *input, uint32_t *output)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_R_DIV,
-            ad9510_r_div);
+    assert (self);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint8_t *input8 = (uint8_t *) input;
+
+    ASSERT_TEST(func != NULL, "Function structure is NULL", err_inv_func,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+    ASSERT_TEST(func->opcode != SMIO_OPCODE_BATCH, "Batches cannot be nested",
+            err_inv_func, BPM_CLIENT_ERR_INV_FUNCTION);
+    ASSERT_TEST(!(func->args[0] != DISP_ARG_END && input8 == NULL),
+            "Invalid input arguments!", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+    ASSERT_TEST(!(func->retval != DISP_ARG_END && output == NULL),
+            "Invalid output arguments!", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+    ASSERT_TEST(self->num_ops < SMIO_BATCH_MAX_OPS, "Too many operations in "
+            "batch", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+
+    /* The operation is its size followed by the RW_WIRE_PACKED_V1 encoding
+     * of the request, the same as bpm_func_exec () sends */
+    size_t op_size = RW_REQ_PACKED_ARG_HDR_SIZE + sizeof (func->opcode);
+    for (int i = 0; func->args[i] != DISP_ARG_END; ++i) {
+        op_size += RW_REQ_PACKED_ARG_HDR_SIZE + DISP_GET_ASIZE(func->args[i]);
+    }
+    ASSERT_TEST(RW_REQ_PACKED_ARG_HDR_SIZE + op_size <=
+            sizeof (self->data) - self->size, "Batch is full", err_inv_param,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    uint8_t *p = self->data + self->size;
+    uint32_t field_size = op_size;
+    memcpy (p, &field_size, RW_REQ_PACKED_ARG_HDR_SIZE);
+    p += RW_REQ_PACKED_ARG_HDR_SIZE;
+
+    field_size = sizeof (func->opcode);
+    memcpy (p, &field_size, RW_REQ_PACKED_ARG_HDR_SIZE);
+    memcpy (p + RW_REQ_PACKED_ARG_HDR_SIZE, &func->opcode, field_size);
+    p += RW_REQ_PACKED_ARG_HDR_SIZE + field_size;
+
+    for (int i = 0; func->args[i] != DISP_ARG_END; ++i) {
+        field_size = DISP_GET_ASIZE(func->args[i]);
+        memcpy (p, &field_size, RW_REQ_PACKED_ARG_HDR_SIZE);
+        memcpy (p + RW_REQ_PACKED_ARG_HDR_SIZE, input8, field_size);
+        p += RW_REQ_PACKED_ARG_HDR_SIZE + field_size;
+        input8 += field_size;
+    }
+
+    self->ops [self->num_ops] = (bpm_param_batch_op_t) {
+        .func = func,
+        .output = output,
+        .err = BPM_CLIENT_ERR_AGAIN
+    };
+    self->num_ops++;
+    self->size += RW_REQ_PACKED_ARG_HDR_SIZE + op_size;
+
+err_inv_param:
+err_inv_func:
+    return err;
 }
 
-/* AD9510 PLL Power Down */
-PARAM_FUNC_CLIENT_WRITE(ad9510_pll_pdown)
+void bpm_param_batch_clear (bpm_param_batch_t *self)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PDOWN,
-            ad9510_pll_pdown);
+    assert (self);
+    self->num_ops = 0;
+    self->size = 0;
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_pll_pdown)
+uint32_t bpm_param_batch_get_num_ops (bpm_param_batch_t *self)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PDOWN,
-            ad9510_pll_pdown);
+    assert (self);
+    return self->num_ops;
 }
 
-/* AD9510 Mux Status */
-PARAM_FUNC_CLIENT_WRITE(ad9510_mux_status)
+bpm_client_err_e bpm_param_batch_get_err (bpm_param_batch_t *self,
+        uint32_t idx)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_MUX_STATUS,
-            ad9510_mux_status);
+    assert (self);
+    return (idx < self->num_ops) ? self->ops [idx].err :
+        BPM_CLIENT_ERR_INV_PARAM;
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_mux_status)
+bpm_client_err_e bpm_param_batch_exec (bpm_client_t *self,
+        bpm_param_batch_t *batch)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_MUX_STATUS,
-            ad9510_mux_status);
-}
+    assert (self);
+    assert (batch);
 
-/* AD9510 CP current */
-PARAM_FUNC_CLIENT_WRITE(ad9510_cp_current)
-{
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CP_CURRENT,
-            ad9510_cp_current);
-}
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    bpm_func_reply_t reply = {0};
 
-PARAM_FUNC_CLIENT_READ(ad9510_cp_current)
-{
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CP_CURRENT,
-            ad9510_cp_current);
+    for (uint32_t i = 0; i < batch->num_ops; ++i) {
+        batch->ops [i].err = BPM_CLIENT_ERR_AGAIN;
+    }
+
+    err = _bpm_param_batch_send (self, batch);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not send batch request",
+            err_send);
+    /* Any of the operations might change a parameter. Our own changes are
+     * seen right away, without waiting for the change event */
+    bpm_param_cache_invalidate (self, batch->service);
+
+    err = _bpm_func_exec_recv_view (self, &reply);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Batch request failed", err_recv);
+
+    /* Reply is, for each operation:
+     * error code, number of bytes and data, as a packed reply */
+    const uint8_t *p = reply.data;
+    size_t left = (p != NULL) ? reply.size : 0;
+    for (uint32_t i = 0; i < batch->num_ops; ++i) {
+        bpm_param_batch_op_t *op = &batch->ops [i];
+        RW_REPLY_TYPE reply_code;
+        uint32_t size;
+
+        ASSERT_TEST(left >= RW_REPLY_PACKED_HDR_SIZE, "Truncated batch reply",
+                err_msg, BPM_CLIENT_ERR_MSG);
+        memcpy (&reply_code, p, RW_REPLY_SIZE);
+        memcpy (&size, p + RW_REPLY_SIZE, RW_REPLY_SIZE);
+        p += RW_REPLY_PACKED_HDR_SIZE;
+        left -= RW_REPLY_PACKED_HDR_SIZE;
+        ASSERT_TEST(size <= left && size <= DISP_GET_ASIZE(op->func->retval),
+                "Wrong batch reply size", err_msg, BPM_CLIENT_ERR_MSG);
+
+        if (size > 0) {
+            memcpy (op->output, p, size);
+        }
+        p += size;
+        left -= size;
+
+        op->err = reply_code;
+        if (op->err != BPM_CLIENT_SUCCESS) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] bpm_param_batch_exec: "
+                    "%s failed for service %s: %s\n", op->func->name,
+                    batch->service, bpm_client_err_str (op->err));
+            if (err == BPM_CLIENT_SUCCESS) {
+                err = op->err;
+            }
+        }
+    }
+
+err_msg:
+err_recv:
+    bpm_func_reply_release (&reply);
+err_send:
+    return err;
 }
 
-/* AD9510 Outputs */
-PARAM_FUNC_CLIENT_WRITE(ad9510_outputs)
+/* Send a SMIO_OPCODE_BATCH request with the operations of "batch" */
+static bpm_client_err_e _bpm_param_batch_send (bpm_client_t *self,
+        bpm_param_batch_t *batch)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_OUTPUTS,
-            ad9510_outputs);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint32_t opcode = SMIO_OPCODE_BATCH;
+
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, BPM_CLIENT_ERR_ALLOC);
+    zmsg_addmem (msg, &opcode, sizeof (opcode));
+    zmsg_addmem (msg, &batch->num_ops, sizeof (batch->num_ops));
+    zmsg_addmem (msg, batch->data, batch->size);
+
+    const char *subject = RW_REPLY_PACKED_SUBJECT;
+    if (self->wire_format == RW_WIRE_PACKED_V1) {
+        err = param_client_msg_pack (msg);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not pack message", err_pack);
+        subject = RW_REQ_PACKED_V1_SUBJECT;
+    }
+
+    int rc = bpm_client_sendto (self, batch->service, subject,
+            bpm_func_sync_tracker_new (self), 0, &msg, true);
+    ASSERT_TEST(rc >= 0, "Could not send message", err_send,
+            BPM_CLIENT_ERR_SERVER);
+
+err_send:
+err_pack:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_outputs)
+const disp_op_t *bpm_func_translate (char *name)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_OUTPUTS,
-            ad9510_outputs);
+    assert (name);
+
+    /* Search the function table for a match in the 'name' field */
+    for (int i=0; smio_exp_ops[i] != NULL; i++) {
+        for (int j=0; smio_exp_ops[i][j] != NULL; j++) {
+            if (streq(name, smio_exp_ops[i][j]->name)) {
+                return smio_exp_ops[i][j];
+            }
+        }
+    }
+
+    return 0;
 }
 
-/* AD9510 PLL CLK Selection */
-PARAM_FUNC_CLIENT_WRITE(ad9510_pll_clk_sel)
+bpm_client_err_e bpm_func_trans_exec (bpm_client_t *self, char *name, char *service, uint32_t *input, uint32_t *output)
 {
-    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_CLK_SEL,
-            ad9510_pll_clk_sel);
+    const disp_op_t *func = _bpm_func_translate (self, name);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, input, output);
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ(ad9510_pll_clk_sel)
+/********************** Accessor Methods **********************/
+
+mlm_client_t *bpm_get_mlm_client (bpm_client_t *self)
 {
-    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_CLK_SEL,
-            ad9510_pll_clk_sel);
+    assert (self);
+    return self->mlm_client;
 }
 
-/* SI571 Set frequency */
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(si571_freq)
+/**************** FMC ADC COMMON SMIO Functions ****************/
+
+PARAM_FUNC_CLIENT_WRITE(fmc_leds)
 {
-    return param_client_write_double (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_FREQ,
-            si571_freq);
+    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_LEDS,
+            fmc_leds);
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(si571_freq)
+PARAM_FUNC_CLIENT_READ(fmc_leds)
 {
-    return param_client_read_double (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_FREQ,
-            si571_freq);
+    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_LEDS,
+            fmc_leds);
 }
 
-/* SI571 Get defaults */
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(si571_defaults)
+PARAM_FUNC_CLIENT_WRITE(adc_test_data_en)
 {
-    return param_client_write_double (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_GET_DEFAULTS,
-            si571_defaults);
+    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TEST_DATA_EN, adc_test_data_en);
 }
 
-/**************** FMC 130M SMIO Functions ****************/
-
-/* ADC LTC2208 RAND */
-PARAM_FUNC_CLIENT_WRITE(adc_rand)
+PARAM_FUNC_CLIENT_READ(adc_test_data_en)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_RAND, adc_rand);
+     return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TEST_DATA_EN, adc_test_data_en);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_rand)
+PARAM_FUNC_CLIENT_WRITE(trig_dir)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_RAND, adc_rand);
+    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TRIG_DIR, trig_dir);
 }
 
-/* ADC LTC2208 DITH */
-PARAM_FUNC_CLIENT_WRITE(adc_dith)
+PARAM_FUNC_CLIENT_READ(trig_dir)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DITH, adc_dith);
+    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TRIG_DIR, trig_dir);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dith)
+PARAM_FUNC_CLIENT_WRITE(trig_term)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DITH, adc_dith);
+    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TRIG_TERM, trig_term);
 }
 
-/* ADC LTC2208 SHDN */
-PARAM_FUNC_CLIENT_WRITE(adc_shdn)
+PARAM_FUNC_CLIENT_READ(trig_term)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_SHDN, adc_shdn);
+    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TRIG_TERM, trig_term);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_shdn)
+PARAM_FUNC_CLIENT_WRITE(trig_val)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_SHDN, adc_shdn);
+    return param_client_write (self, service, FMC_ADC_COMMON_OPCODE_TRIG_VAL, trig_val);
 }
 
-/* ADC LTC2208 PGA */
-PARAM_FUNC_CLIENT_WRITE(adc_pga)
+PARAM_FUNC_CLIENT_READ(trig_val)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_PGA, adc_pga);
+    return param_client_read (self, service, FMC_ADC_COMMON_OPCODE_TRIG_VAL, trig_val);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_pga)
+/**************** FMC ACTIVE CLOCK SMIO Functions ****************/
+
+/* FUNCTION pin functions */
+PARAM_FUNC_CLIENT_WRITE(fmc_pll_function)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_PGA, adc_pga);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_FUNCTION,
+            fmc_pll_function);
 }
 
-/* RAW ADC data 0 value */
-PARAM_FUNC_CLIENT_WRITE(adc_data0)
+PARAM_FUNC_CLIENT_READ(fmc_pll_function)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA0, adc_data0);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_FUNCTION,
+            fmc_pll_function);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_data0)
+/* STATUS pin functions */
+PARAM_FUNC_CLIENT_WRITE(fmc_pll_status)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA0, adc_data0);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_STATUS,
+            fmc_pll_status);
 }
 
-/* RAW ADC data 1 value */
-PARAM_FUNC_CLIENT_WRITE(adc_data1)
+PARAM_FUNC_CLIENT_READ(fmc_pll_status)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA1, adc_data1);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_PLL_STATUS,
+            fmc_pll_status);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_data1)
+/* CLK_SEL pin functions */
+PARAM_FUNC_CLIENT_WRITE(fmc_clk_sel)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA1, adc_data1);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_CLK_SEL,
+            fmc_clk_sel);
 }
 
-/* RAW ADC data 2 value */
-PARAM_FUNC_CLIENT_WRITE(adc_data2)
+PARAM_FUNC_CLIENT_READ(fmc_clk_sel)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA2, adc_data2);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_CLK_SEL,
+            fmc_clk_sel);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_data2)
+PARAM_FUNC_CLIENT_WRITE(si571_oe)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA2, adc_data2);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_OE, si571_oe);
 }
 
-/* RAW ADC data 3 value */
-PARAM_FUNC_CLIENT_WRITE(adc_data3)
+PARAM_FUNC_CLIENT_READ(si571_oe)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA3, adc_data3);
+     return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_OE, si571_oe);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_data3)
+PARAM_FUNC_CLIENT_WRITE(ad9510_defaults)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA3, adc_data3);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CFG_DEFAULTS,
+            ad9510_defaults);
 }
 
-/****************** FMC130M Delay Value Functions ****************/
-
-/* ADC delay value 0 */
-PARAM_FUNC_CLIENT_WRITE(adc_dly_val0)
+PARAM_FUNC_CLIENT_READ(ad9510_defaults)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL0, adc_dly_val0);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CFG_DEFAULTS,
+            ad9510_defaults);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dly_val0)
+/* AD9510 PLL A divider */
+PARAM_FUNC_CLIENT_WRITE(ad9510_pll_a_div)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL0, adc_dly_val0);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_A_DIV,
+            ad9510_pll_a_div);
 }
 
-/* ADC delay value 1 */
-PARAM_FUNC_CLIENT_WRITE(adc_dly_val1)
+PARAM_FUNC_CLIENT_READ(ad9510_pll_a_div)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL1, adc_dly_val1);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_A_DIV,
+            ad9510_pll_a_div);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dly_val1)
+/* AD9510 PLL B divider */
+PARAM_FUNC_CLIENT_WRITE(ad9510_pll_b_div)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL1, adc_dly_val1);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_B_DIV,
+            ad9510_pll_b_div);
 }
 
-/* ADC delay value 2 */
-PARAM_FUNC_CLIENT_WRITE(adc_dly_val2)
+PARAM_FUNC_CLIENT_READ(ad9510_pll_b_div)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL2, adc_dly_val2);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_B_DIV,
+            ad9510_pll_b_div);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dly_val2)
+/* AD9510 PLL Prescaler */
+PARAM_FUNC_CLIENT_WRITE(ad9510_pll_prescaler)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL2, adc_dly_val2);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PRESCALER,
+            ad9510_pll_prescaler);
 }
 
-/* ADC delay value 3 */
-PARAM_FUNC_CLIENT_WRITE(adc_dly_val3)
+PARAM_FUNC_CLIENT_READ(ad9510_pll_prescaler)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL3, adc_dly_val3);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PRESCALER,
+            ad9510_pll_prescaler);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dly_val3)
+/* AD9510 R divider */
+PARAM_FUNC_CLIENT_WRITE(ad9510_r_div)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL3, adc_dly_val3);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_R_DIV,
+            ad9510_r_div);
 }
 
-/****************** FMC130M Delay Line selection Functions ****************/
-
-/* ADC line value 0 */
-PARAM_FUNC_CLIENT_WRITE(adc_dly_line0)
+PARAM_FUNC_CLIENT_READ(ad9510_r_div)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE0, adc_dly_line0);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_R_DIV,
+            ad9510_r_div);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dly_line0)
+/* AD9510 PLL Power Down */
+PARAM_FUNC_CLIENT_WRITE(ad9510_pll_pdown)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE0, adc_dly_line0);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PDOWN,
+            ad9510_pll_pdown);
 }
 
-/* ADC line value 1 */
-PARAM_FUNC_CLIENT_WRITE(adc_dly_line1)
+PARAM_FUNC_CLIENT_READ(ad9510_pll_pdown)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE1, adc_dly_line1);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_PDOWN,
+            ad9510_pll_pdown);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dly_line1)
+/* AD9510 Mux Status */
+PARAM_FUNC_CLIENT_WRITE(ad9510_mux_status)
 {
-     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE1, adc_dly_line1);
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_MUX_STATUS,
+            ad9510_mux_status);
 }
 
-/* ADC line value 2 */
-PARAM_FUNC_CLIENT_WRITE(adc_dly_line2)
+PARAM_FUNC_CLIENT_READ(ad9510_mux_status)
 {
-    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE2, adc_dly_line2);
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_MUX_STATUS,
+            ad9510_mux_status);
 }
 
-PARAM_FUNC_CLIENT_READ(adc_dly_line2)
-{
+/* AD9510 CP current */
+PARAM_FUNC_CLIENT_WRITE(ad9510_cp_current)
+{
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CP_CURRENT,
+            ad9510_cp_current);
+}
+
+PARAM_FUNC_CLIENT_READ(ad9510_cp_current)
+{
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_CP_CURRENT,
+            ad9510_cp_current);
+}
+
+/* AD9510 Outputs */
+PARAM_FUNC_CLIENT_WRITE(ad9510_outputs)
+{
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_OUTPUTS,
+            ad9510_outputs);
+}
+
+PARAM_FUNC_CLIENT_READ(ad9510_outputs)
+{
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_OUTPUTS,
+            ad9510_outputs);
+}
+
+/* AD9510 PLL CLK Selection */
+PARAM_FUNC_CLIENT_WRITE(ad9510_pll_clk_sel)
+{
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_CLK_SEL,
+            ad9510_pll_clk_sel);
+}
+
+PARAM_FUNC_CLIENT_READ(ad9510_pll_clk_sel)
+{
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_AD9510_PLL_CLK_SEL,
+            ad9510_pll_clk_sel);
+}
+
+/* SI571 Set frequency */
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(si571_freq)
+{
+    return param_client_write_double (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_FREQ,
+            si571_freq);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(si571_freq)
+{
+    return param_client_read_double (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_FREQ,
+            si571_freq);
+}
+
+/* SI571 Get defaults */
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(si571_defaults)
+{
+    return param_client_write_double (self, service, FMC_ACTIVE_CLK_OPCODE_SI571_GET_DEFAULTS,
+            si571_defaults);
+}
+
+/* Clock tree profiles */
+bpm_client_err_e bpm_get_fmc_clk_profile (bpm_client_t *self, char *service,
+        uint32_t slot, struct _smio_fmc_active_clk_profile_t *profile)
+{
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, FMC_ACTIVE_CLK_OPCODE_PROFILE,
+            rw, &slot, sizeof (slot), NULL, 0, profile, sizeof (*profile));
+}
+
+PARAM_FUNC_CLIENT_WRITE(fmc_clk_profile_sel)
+{
+    return param_client_write (self, service, FMC_ACTIVE_CLK_OPCODE_PROFILE_SEL,
+            fmc_clk_profile_sel);
+}
+
+PARAM_FUNC_CLIENT_READ(fmc_clk_profile_sel)
+{
+    return param_client_read (self, service, FMC_ACTIVE_CLK_OPCODE_PROFILE_SEL,
+            fmc_clk_profile_sel);
+}
+
+/**************** FMC 130M SMIO Functions ****************/
+
+/* ADC LTC2208 RAND */
+PARAM_FUNC_CLIENT_WRITE(adc_rand)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_RAND, adc_rand);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_rand)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_RAND, adc_rand);
+}
+
+/* ADC LTC2208 DITH */
+PARAM_FUNC_CLIENT_WRITE(adc_dith)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DITH, adc_dith);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dith)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DITH, adc_dith);
+}
+
+/* ADC LTC2208 SHDN */
+PARAM_FUNC_CLIENT_WRITE(adc_shdn)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_SHDN, adc_shdn);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_shdn)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_SHDN, adc_shdn);
+}
+
+/* ADC LTC2208 PGA */
+PARAM_FUNC_CLIENT_WRITE(adc_pga)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_PGA, adc_pga);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_pga)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_PGA, adc_pga);
+}
+
+/* RAW ADC data 0 value */
+PARAM_FUNC_CLIENT_WRITE(adc_data0)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA0, adc_data0);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_data0)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA0, adc_data0);
+}
+
+/* RAW ADC data 1 value */
+PARAM_FUNC_CLIENT_WRITE(adc_data1)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA1, adc_data1);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_data1)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA1, adc_data1);
+}
+
+/* RAW ADC data 2 value */
+PARAM_FUNC_CLIENT_WRITE(adc_data2)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA2, adc_data2);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_data2)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA2, adc_data2);
+}
+
+/* RAW ADC data 3 value */
+PARAM_FUNC_CLIENT_WRITE(adc_data3)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DATA3, adc_data3);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_data3)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DATA3, adc_data3);
+}
+
+/****************** FMC130M Delay Value Functions ****************/
+
+/* ADC delay value 0 */
+PARAM_FUNC_CLIENT_WRITE(adc_dly_val0)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL0, adc_dly_val0);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dly_val0)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL0, adc_dly_val0);
+}
+
+/* ADC delay value 1 */
+PARAM_FUNC_CLIENT_WRITE(adc_dly_val1)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL1, adc_dly_val1);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dly_val1)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL1, adc_dly_val1);
+}
+
+/* ADC delay value 2 */
+PARAM_FUNC_CLIENT_WRITE(adc_dly_val2)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL2, adc_dly_val2);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dly_val2)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL2, adc_dly_val2);
+}
+
+/* ADC delay value 3 */
+PARAM_FUNC_CLIENT_WRITE(adc_dly_val3)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL3, adc_dly_val3);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dly_val3)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_VAL3, adc_dly_val3);
+}
+
+/****************** FMC130M Delay Line selection Functions ****************/
+
+/* ADC line value 0 */
+PARAM_FUNC_CLIENT_WRITE(adc_dly_line0)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE0, adc_dly_line0);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dly_line0)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE0, adc_dly_line0);
+}
+
+/* ADC line value 1 */
+PARAM_FUNC_CLIENT_WRITE(adc_dly_line1)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE1, adc_dly_line1);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dly_line1)
+{
+     return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE1, adc_dly_line1);
+}
+
+/* ADC line value 2 */
+PARAM_FUNC_CLIENT_WRITE(adc_dly_line2)
+{
+    return param_client_write (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE2, adc_dly_line2);
+}
+
+PARAM_FUNC_CLIENT_READ(adc_dly_line2)
+{
      return param_client_read (self, service, FMC130M_4CH_OPCODE_ADC_DLY_LINE2, adc_dly_line2);
 }
 
@@ -860,6 +2320,48 @@ PARAM_FUNC_CLIENT_WRITE2(adc_dly3, type, val)
             type, val);
 }
 
+bpm_client_err_e bpm_get_adc_data_all (bpm_client_t *self, char *service,
+        uint32_t num_samples, smio_fmc_adc_data_t *adc_data)
+{
+    assert (self);
+    assert (service);
+    assert (adc_data);
+
+    uint32_t write_val[1] = {0};
+    write_val[0] = num_samples;
+
+    /* FMC250M uses the same opcode */
+    const disp_op_t* func = _bpm_func_translate (self, FMC130M_4CH_NAME_ADC_DATA_ALL);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) adc_data);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_get_adc_data_all: ADC data "
+            "could not be read", err_get_adc_data_all, BPM_CLIENT_ERR_SERVER);
+
+err_get_adc_data_all:
+    return err;
+}
+
+bpm_client_err_e bpm_adc_dly_cal (bpm_client_t *self, char *service,
+        uint32_t dly_type, uint32_t num_reads, smio_fmc130m_4ch_dly_cal_t *cal)
+{
+    assert (self);
+    assert (service);
+    assert (cal);
+
+    uint32_t write_val[2] = {0};
+    write_val[0] = dly_type;
+    write_val[1] = num_reads;
+
+    const disp_op_t* func = _bpm_func_translate (self, FMC130M_4CH_NAME_ADC_DLY_CAL);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) cal);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_adc_dly_cal: ADC delays "
+            "could not be calibrated", err_adc_dly_cal, BPM_CLIENT_ERR_SERVER);
+
+err_adc_dly_cal:
+    return err;
+}
+
 /*************************** FMC250M Chips Functions *************************/
 
 /* ISLA216P RST ADCs */
@@ -929,6 +2431,10 @@ PARAM_FUNC_CLIENT_WRITE(test_mode3)
 /****************** ACQ SMIO Functions ****************/
 #define MIN_WAIT_TIME           1                           /* in ms */
 #define MSECS                   1000                        /* in seconds */
+/* Polling backoff. The wait between tries starts short, so fast operations
+ * are seen right away, and doubles up to MIN_WAIT_TIME */
+#define POLL_WAIT_MIN_US        20                          /* in us */
+#define POLL_WAIT_MAX_US        (MIN_WAIT_TIME*MSECS)       /* in us */
 
 static bpm_client_err_e _bpm_acq_start (bpm_client_t *self, char *service,
         acq_req_t *acq_req);
@@ -939,10 +2445,62 @@ static bpm_client_err_e _bpm_acq_get_data_block (bpm_client_t *self,
         char *service, acq_trans_t *acq_trans);
 static bpm_client_err_e _bpm_acq_get_curve (bpm_client_t *self, char *service,
         acq_trans_t *acq_trans);
+static bpm_client_err_e _bpm_acq_get_curve_blocks (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans);
 static bpm_client_err_e _bpm_full_acq (bpm_client_t *self, char *service,
-        acq_trans_t *acq_trans, int timeout);
+        acq_trans_t *acq_trans, int64_t timeout_us);
 static bpm_client_err_e _bpm_full_acq_compat (bpm_client_t *self, char *service,
         acq_trans_t *acq_trans, int timeout, bool new_acq);
+static bpm_client_err_e _bpm_acq_get_data_block_shm (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t *seq);
+static bpm_client_err_e _bpm_acq_get_curve_shm (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+static acq_shm_map_t *_bpm_acq_shm_map (bpm_client_t *self, char *service);
+static const smio_acq_chan_map_t *_bpm_acq_chan_map (bpm_client_t *self,
+        char *service);
+static uint32_t _bpm_acq_sample_size (bpm_client_t *self, char *service,
+        uint32_t chan);
+static bpm_client_err_e _bpm_acq_get_curve_stream (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+static bpm_client_err_e _bpm_acq_stream_copy_block (zmsg_t *report, uint8_t *data,
+        uint32_t data_size, uint32_t *total_bread);
+static bpm_client_err_e _bpm_acq_acquire_curve (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, int64_t timeout_us);
+static bpm_client_err_e _bpm_acq_stream_grant (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t block_start, uint32_t num_blocks,
+        const smio_acq_direct_peer_t *peer);
+static bpm_client_err_e _bpm_acq_get_curve_direct (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
+static zsock_t *_bpm_acq_direct_connect (bpm_client_t *self, char *service);
+static bpm_client_err_e _bpm_acq_get_curve_pipelined (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t window);
+static bpm_client_err_e _bpm_acq_get_curve_cb (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t window,
+        bpm_acq_block_fp cb, void *arg);
+static bpm_client_err_e _bpm_acq_copy_data_block (acq_trans_t *acq_trans,
+        const bpm_func_reply_t *reply);
+static bpm_client_err_e _bpm_acq_get_data_block_var (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size,
+        uint32_t atom_mask, uint32_t decim);
+static bpm_client_err_e _bpm_acq_get_data_block_sized (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size,
+        uint32_t atom_mask, uint32_t decim);
+static bpm_client_err_e _bpm_acq_get_curve_sized (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size,
+        uint32_t atom_mask, uint32_t decim);
+static bpm_client_err_e _bpm_acq_get_data_block_coded (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size);
+static bpm_client_err_e _bpm_acq_event_subscribe (bpm_client_t *self,
+        char *service, char **stream);
+static bpm_client_err_e _bpm_acq_wait_event (bpm_client_t *self, char *service,
+        int timeout);
+static bpm_client_err_e _bpm_acq_trig_subscribe (bpm_client_t *self,
+        char *stream);
+static void _bpm_acq_prefetch_event (bpm_client_t *self, const char *stream,
+        zmsg_t *msg);
+static void _bpm_acq_prefetch_drop (bpm_client_t *self, char *service);
+static bool _bpm_acq_prefetch_get (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans);
 
 bpm_client_err_e bpm_acq_start (bpm_client_t *self, char *service, acq_req_t *acq_req)
 {
@@ -972,10 +2530,33 @@ bpm_client_err_e bpm_acq_get_curve (bpm_client_t *self, char *service,
     return _bpm_acq_get_curve (self, service, acq_trans);
 }
 
+bpm_client_err_e bpm_acq_get_curve_resume (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
+{
+    assert (acq_trans);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    ASSERT_TEST(acq_trans->bytes_done <= acq_trans->block.data_size,
+            "Curve progress does not match the buffer", err_inv_progress,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    err = _bpm_acq_get_curve_blocks (self, service, acq_trans);
+
+err_inv_progress:
+    return err;
+}
+
 bpm_client_err_e bpm_full_acq (bpm_client_t *self, char *service,
         acq_trans_t *acq_trans, int timeout)
 {
-    return _bpm_full_acq (self, service, acq_trans, timeout);
+    return _bpm_full_acq (self, service, acq_trans,
+            (timeout < 0) ? -1 : (int64_t) timeout*MSECS);
+}
+
+bpm_client_err_e bpm_full_acq_us (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, int64_t timeout_us)
+{
+    return _bpm_full_acq (self, service, acq_trans, timeout_us);
 }
 
 bpm_client_err_e bpm_full_acq_compat (bpm_client_t *self, char *service,
@@ -984,1128 +2565,5703 @@ bpm_client_err_e bpm_full_acq_compat (bpm_client_t *self, char *service,
     return _bpm_full_acq_compat (self, service, acq_trans, timeout, new_acq);
 }
 
-static bpm_client_err_e _bpm_acq_check_timed (bpm_client_t *self, char *service,
-        int timeout)
+bpm_client_err_e bpm_acq_get_data_block_shm (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
 {
-    return func_polling (self, ACQ_NAME_CHECK_DATA_ACQUIRE, service, NULL,
-            NULL, timeout);
+    return _bpm_acq_get_data_block_shm (self, service, acq_trans, NULL);
 }
 
-bpm_client_err_e bpm_set_acq_trig (bpm_client_t *self, char *service,
-        uint32_t trig)
+bpm_client_err_e bpm_acq_get_curve_shm (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
 {
-    return param_client_write (self, service, ACQ_OPCODE_CFG_TRIG, trig);
+    return _bpm_acq_get_curve_shm (self, service, acq_trans);
 }
 
-bpm_client_err_e bpm_get_acq_trig (bpm_client_t *self, char *service,
-        uint32_t *trig)
+bpm_client_err_e bpm_acq_get_curve_stream (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
 {
-    return param_client_read (self, service, ACQ_OPCODE_CFG_TRIG, trig);
+    return _bpm_acq_get_curve_stream (self, service, acq_trans);
 }
 
-bpm_client_err_e bpm_set_acq_data_trig_pol (bpm_client_t *self, char *service,
-        uint32_t data_trig_pol)
+bpm_client_err_e bpm_acq_get_curve_direct (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
 {
-    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_POL,
-            data_trig_pol);
+    return _bpm_acq_get_curve_direct (self, service, acq_trans);
 }
 
-bpm_client_err_e bpm_get_acq_data_trig_pol (bpm_client_t *self, char *service,
-        uint32_t *data_trig_pol)
+bpm_client_err_e bpm_acq_get_curve_pipelined (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t window)
 {
-    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_POL,
-            data_trig_pol);
+    return _bpm_acq_get_curve_pipelined (self, service, acq_trans, window);
 }
 
-bpm_client_err_e bpm_set_acq_data_trig_sel (bpm_client_t *self, char *service,
-        uint32_t data_trig_sel)
+bpm_client_err_e bpm_acq_get_curve_cb (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t window, bpm_acq_block_fp cb, void *arg)
 {
-    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_SEL,
-            data_trig_sel);
+    return _bpm_acq_get_curve_cb (self, service, acq_trans, window, cb, arg);
 }
 
-bpm_client_err_e bpm_get_acq_data_trig_sel (bpm_client_t *self, char *service,
-        uint32_t *data_trig_sel)
+bpm_client_err_e bpm_acq_get_data_block_sized (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size)
 {
-    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_SEL,
-            data_trig_sel);
+    return _bpm_acq_get_data_block_sized (self, service, acq_trans, block_size,
+            ACQ_REDUCE_ATOM_MASK_ALL, 1);
 }
 
-bpm_client_err_e bpm_set_acq_data_trig_filt (bpm_client_t *self, char *service,
-        uint32_t data_trig_filt)
-{
-    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_FILT,
-            data_trig_filt);
-}
-bpm_client_err_e bpm_get_acq_data_trig_filt (bpm_client_t *self, char *service,
-        uint32_t *data_trig_filt)
+bpm_client_err_e bpm_acq_get_curve_sized (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size)
 {
-    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_FILT,
-            data_trig_filt);
+    return _bpm_acq_get_curve_sized (self, service, acq_trans, block_size,
+            ACQ_REDUCE_ATOM_MASK_ALL, 1);
 }
 
-bpm_client_err_e bpm_set_acq_data_trig_thres (bpm_client_t *self, char *service,
-        uint32_t data_trig_thres)
+bpm_client_err_e bpm_acq_get_data_block_reduced (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size, uint32_t atom_mask,
+        uint32_t decim)
 {
-    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_THRES,
-            data_trig_thres);
+    return _bpm_acq_get_data_block_sized (self, service, acq_trans, block_size,
+            atom_mask, decim);
 }
 
-bpm_client_err_e bpm_get_acq_data_trig_thres (bpm_client_t *self, char *service,
-        uint32_t *data_trig_thres)
+bpm_client_err_e bpm_acq_get_curve_reduced (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t block_size, uint32_t atom_mask,
+        uint32_t decim)
 {
-    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_THRES,
-            data_trig_thres);
+    return _bpm_acq_get_curve_sized (self, service, acq_trans, block_size,
+            atom_mask, decim);
 }
 
-bpm_client_err_e bpm_set_acq_hw_trig_dly (bpm_client_t *self, char *service,
-        uint32_t hw_trig_dly)
+bpm_client_err_e bpm_acq_start_multi (bpm_client_t *self, char *service,
+        acq_req_t *acq_req, uint32_t chan_mask)
 {
-    return param_client_write (self, service, ACQ_OPCODE_HW_TRIG_DLY,
-            hw_trig_dly);
-}
+    assert (self);
+    assert (service);
+    assert (acq_req);
 
-bpm_client_err_e bpm_get_acq_hw_trig_dly (bpm_client_t *self, char *service,
-        uint32_t *hw_trig_dly)
-{
-    return param_client_read (self, service, ACQ_OPCODE_HW_TRIG_DLY,
-            hw_trig_dly);
-}
+    uint32_t write_val[4] = {0};
+    write_val[0] = acq_req->num_samples_pre;
+    write_val[1] = acq_req->num_samples_post;
+    write_val[2] = acq_req->num_shots;
+    write_val[3] = chan_mask;
 
-bpm_client_err_e bpm_set_acq_sw_trig (bpm_client_t *self, char *service,
-        uint32_t sw_trig)
-{
-    return param_client_write (self, service, ACQ_OPCODE_SW_TRIG,
-            sw_trig);
-}
+    _bpm_acq_prefetch_drop (self, service);
 
-bpm_client_err_e bpm_get_acq_sw_trig (bpm_client_t *self, char *service,
-        uint32_t *sw_trig)
-{
-    return param_client_read (self, service, ACQ_OPCODE_SW_TRIG,
-            sw_trig);
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_DATA_ACQUIRE_MULTI);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val, NULL);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_start_multi: Data acquire "
+            "was not requested correctly", err_data_acquire, BPM_CLIENT_ERR_SERVER);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_start_multi: "
+            "Data acquire was successfully required for channels 0x%08X\n",
+            chan_mask);
+
+err_data_acquire:
+    return err;
 }
 
-bpm_client_err_e bpm_set_acq_fsm_stop (bpm_client_t *self, char *service,
-        uint32_t fsm_stop)
+bpm_client_err_e bpm_acq_get_curve_multi (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t num_trans, uint32_t block_size)
 {
-    return param_client_write (self, service, ACQ_OPCODE_FSM_STOP,
-            fsm_stop);
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint32_t block_n_valid [ACQ_MULTI_MAX_CHANS] = {0};
+    uint32_t block_n_max = 0;
+
+    ASSERT_TEST(num_trans > 0 && num_trans <= ACQ_MULTI_MAX_CHANS,
+            "Invalid number of channels", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+
+    /* Number of blocks of each channel, as in bpm_acq_get_curve_sized */
+    for (uint32_t i = 0; i < num_trans; ++i) {
+        assert (acq_trans[i].block.data);
+        uint32_t sample_size = _bpm_acq_sample_size (self, service,
+                acq_trans[i].req.chan);
+        ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_param,
+                BPM_CLIENT_ERR_INV_PARAM);
+
+        uint32_t num_samples = (acq_trans[i].req.num_samples_pre +
+                acq_trans[i].req.num_samples_post) * acq_trans[i].req.num_shots;
+        uint32_t n_max_samples = block_size / sample_size;
+        ASSERT_TEST(n_max_samples > 0, "Block size is smaller than a sample",
+                err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+
+        block_n_valid [i] = num_samples / n_max_samples;
+        /* When the last block is full 'block_n_valid' exceeds by one */
+        if (block_n_valid [i] != 0 && (num_samples % n_max_samples) == 0) {
+            block_n_valid [i]--;
+        }
+        if (block_n_valid [i] > block_n_max) {
+            block_n_max = block_n_valid [i];
+        }
+
+        acq_trans[i].block.bytes_read = 0;
+    }
+
+    /* The same receive buffer is reused for all blocks */
+    smio_acq_data_block_multi_t *read_val = zmalloc (sizeof (*read_val) -
+            sizeof (read_val->data) + (size_t) block_size * num_trans);
+    ASSERT_ALLOC(read_val, err_read_val_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    for (uint32_t block_n = 0; block_n <= block_n_max; block_n++) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        /* Only ask for the channels that still have blocks */
+        uint32_t chan_mask = 0;
+        for (uint32_t i = 0; i < num_trans; ++i) {
+            if (block_n <= block_n_valid [i]) {
+                chan_mask |= 1U << acq_trans[i].req.chan;
+            }
+        }
+
+        /* Sent Message is:
+         * frame 0: operation code
+         * frame 1: channel mask
+         * frame 2: block required
+         * frame 3: block size */
+        uint32_t write_val[3] = {chan_mask, block_n, block_size};
+        const disp_op_t* func = _bpm_func_translate (self,
+                ACQ_NAME_GET_DATA_BLOCK_MULTI);
+        err = bpm_func_exec (self, func, service, write_val, (uint32_t *) read_val);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_curve_multi: "
+                "Data blocks were not acquired", err_get_data_block,
+                BPM_CLIENT_ERR_SERVER);
+
+        /* Blocks come in increasing channel order */
+        uint8_t *data = read_val->data;
+        for (uint32_t chan = 0; chan < ACQ_MULTI_MAX_CHANS; ++chan) {
+            if (!(chan_mask & (1U << chan))) {
+                continue;
+            }
+
+            uint32_t valid_bytes = read_val->valid_bytes [chan];
+            for (uint32_t i = 0; i < num_trans; ++i) {
+                acq_block_t *block = &acq_trans[i].block;
+                if (acq_trans[i].req.chan != chan) {
+                    continue;
+                }
+
+                uint32_t read_size = block->data_size - block->bytes_read;
+                if (read_size > valid_bytes) {
+                    read_size = valid_bytes;
+                }
+                memcpy ((uint8_t *) block->data + block->bytes_read, data, read_size);
+                block->bytes_read += read_size;
+                break;
+            }
+            data += valid_bytes;
+        }
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_curve_multi: "
+            "Data curves of %u channels were successfully acquired\n", num_trans);
+
+err_get_data_block:
+bpm_zsys_interrupted:
+    free (read_val);
+err_read_val_alloc:
+err_inv_param:
+    return err;
 }
 
-bpm_client_err_e bpm_get_acq_fsm_stop (bpm_client_t *self, char *service,
-        uint32_t *fsm_stop)
+bpm_client_err_e bpm_acq_ring_start (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t seg_samples)
 {
-    return param_client_read (self, service, ACQ_OPCODE_FSM_STOP,
-            fsm_stop);
+    assert (self);
+    assert (service);
+
+    uint32_t write_val[2] = {0};
+    write_val[0] = chan;
+    write_val[1] = seg_samples;
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_RING_START);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val, NULL);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_ring_start: Continuous "
+            "acquisition was not started", err_ring_start, BPM_CLIENT_ERR_SERVER);
+
+err_ring_start:
+    return err;
 }
 
-bpm_client_err_e bpm_set_acq_data_trig_chan (bpm_client_t *self, char *service,
-        uint32_t data_trig_chan)
+bpm_client_err_e bpm_acq_ring_stop (bpm_client_t *self, char *service)
 {
-    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_CHAN,
-            data_trig_chan);
+    assert (self);
+    assert (service);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_RING_STOP);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL, NULL);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_ring_stop: Continuous "
+            "acquisition was not stopped", err_ring_stop, BPM_CLIENT_ERR_SERVER);
+
+err_ring_stop:
+    return err;
 }
 
-bpm_client_err_e bpm_get_acq_data_trig_chan (bpm_client_t *self, char *service,
-        uint32_t *data_trig_chan)
+bpm_client_err_e bpm_acq_ring_read (bpm_client_t *self, char *service,
+        uint32_t chan, uint64_t *cursor, uint32_t *data, uint32_t data_size,
+        uint32_t *bytes_read, uint32_t *flags)
 {
-    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_CHAN,
-            data_trig_chan);
+    assert (self);
+    assert (service);
+    assert (cursor);
+    assert (data);
+    assert (bytes_read);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service, chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: cursor (64-bit)
+     * frame 3: maximum number of bytes */
+    uint32_t write_val[4] = {0};
+    uint8_t *write_p = (uint8_t *) write_val;
+    memcpy (write_p, &chan, sizeof (chan));
+    write_p += sizeof (chan);
+    memcpy (write_p, cursor, sizeof (*cursor));
+    write_p += sizeof (*cursor);
+    memcpy (write_p, &data_size, sizeof (data_size));
+
+    /* Only allocate what the server can send us back */
+    smio_acq_ring_data_t *read_val = zmalloc (sizeof (*read_val) -
+            sizeof (read_val->data) + data_size);
+    ASSERT_ALLOC(read_val, err_read_val_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_RING_GET_DATA);
+    err = bpm_func_exec (self, func, service, write_val, (uint32_t *) read_val);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_ring_read: Continuous "
+            "acquisition data was not read", err_ring_read, BPM_CLIENT_ERR_SERVER);
+
+    uint32_t read_size = (data_size < read_val->valid_bytes) ?
+        data_size : read_val->valid_bytes;
+    memcpy (data, read_val->data, read_size);
+
+    *bytes_read = read_size;
+    *cursor = read_val->start + read_size/sample_size;
+    if (flags != NULL) {
+        *flags = read_val->flags;
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_ring_read: "
+            "read_size: %u, head: %"PRIu64", flags: 0x%08X\n", read_size,
+            read_val->head, read_val->flags);
+
+err_ring_read:
+    free (read_val);
+err_read_val_alloc:
+err_inv_chan:
+    return err;
 }
 
-static bpm_client_err_e _bpm_acq_start (bpm_client_t *self, char *service, acq_req_t *acq_req)
+bpm_client_err_e bpm_acq_queue_start (bpm_client_t *self, char *service,
+        acq_req_t *acq_req, uint32_t num_acqs)
 {
     assert (self);
     assert (service);
     assert (acq_req);
 
-    uint32_t write_val[4] = {0};
+    uint32_t write_val[5] = {0};
     write_val[0] = acq_req->num_samples_pre;
     write_val[1] = acq_req->num_samples_post;
     write_val[2] = acq_req->num_shots;
     write_val[3] = acq_req->chan;
+    write_val[4] = num_acqs;
 
-    const disp_op_t* func = bpm_func_translate(ACQ_NAME_DATA_ACQUIRE);
-    bpm_client_err_e err = bpm_func_exec(self, func, service, write_val, NULL);
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_QUEUE_START);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val, NULL);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_queue_start: Acquisition "
+            "queue was not started", err_queue_start, BPM_CLIENT_ERR_SERVER);
 
-    /* Check if any error occurred */
-    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_data_acquire: Data acquire was "
-            "not requested correctly", err_data_acquire, BPM_CLIENT_ERR_AGAIN);
+err_queue_start:
+    return err;
+}
 
-    /* If we are here, then the request was successfully acquired*/
-    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_data_acquire: "
-            "Data acquire was successfully required\n");
+bpm_client_err_e bpm_acq_queue_stop (bpm_client_t *self, char *service)
+{
+    assert (self);
+    assert (service);
 
-err_data_acquire:
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_QUEUE_STOP);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL, NULL);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_queue_stop: Acquisition "
+            "queue was not stopped", err_queue_stop, BPM_CLIENT_ERR_SERVER);
+
+err_queue_stop:
     return err;
 }
 
-static bpm_client_err_e _bpm_acq_check (bpm_client_t *self, char *service)
+bpm_client_err_e bpm_acq_queue_get_info (bpm_client_t *self, char *service,
+        uint32_t index, smio_acq_queue_info_t *info)
 {
     assert (self);
     assert (service);
+    assert (info);
 
-    const disp_op_t* func = bpm_func_translate(ACQ_NAME_CHECK_DATA_ACQUIRE);
-    bpm_client_err_e err = bpm_func_exec(self, func, service, NULL, NULL);
+    uint32_t write_val[1] = {0};
+    write_val[0] = index;
 
-    if (err != BPM_CLIENT_SUCCESS) {
-        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] data acquisition "
-                "was not completed\n");
-    }
-    else {
-        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] data acquisition "
-                "was completed\n");
-    }
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_QUEUE_GET_INFO);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) info);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_queue_get_info: Queue "
+            "information could not be read", err_get_info, BPM_CLIENT_ERR_SERVER);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_queue_get_info: "
+            "%u of %u acquisitions done\n", info->num_done, info->num_acqs);
 
+err_get_info:
     return err;
 }
 
-static bpm_client_err_e _bpm_acq_get_data_block (bpm_client_t *self, char *service, acq_trans_t *acq_trans)
+bpm_client_err_e bpm_acq_queue_get_curve (bpm_client_t *self, char *service,
+        uint32_t index, acq_trans_t *acq_trans)
 {
     assert (self);
     assert (service);
     assert (acq_trans);
     assert (acq_trans->block.data);
 
-    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    smio_acq_queue_info_t info;
+    bpm_client_err_e err = bpm_acq_queue_get_info (self, service, index, &info);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_queue_get_curve: Could "
+            "not get the acquisition parameters", err_get_info);
+    ASSERT_TEST(index < info.num_done, "bpm_acq_queue_get_curve: Acquisition "
+            "not done yet", err_get_info, BPM_CLIENT_ERR_AGAIN);
 
-    uint32_t write_val[2] = {0};
-    write_val[0] = acq_trans->req.chan;
-    write_val[1] = acq_trans->block.idx;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service, info.curve.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_get_info,
+            BPM_CLIENT_ERR_INV_PARAM);
 
-    smio_acq_data_block_t read_val[1];
+    /* The curve is as large as the aligned parameters */
+    uint64_t curve_size = (uint64_t) (info.curve.num_samples_pre +
+            info.curve.num_samples_post) * info.curve.num_shots * sample_size;
+    uint32_t total_bread = 0;
+    uint32_t block_n = 0;
+
+    while (total_bread < curve_size && total_bread < acq_trans->block.data_size) {
+        /* Sent Message is:
+         * frame 0: operation code
+         * frame 1: acquisition index
+         * frame 2: block required */
+        uint32_t write_val[2] = {0};
+        write_val[0] = index;
+        write_val[1] = block_n;
+
+        bpm_func_reply_t reply;
+        const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_QUEUE_GET_BLOCK);
+        err = bpm_func_exec_view (self, func, service, write_val, &reply);
+        if (err == BPM_CLIENT_SUCCESS) {
+            acq_trans_t block_trans = *acq_trans;
+            block_trans.block.data = (uint32_t *) ((uint8_t *)
+                    acq_trans->block.data + total_bread);
+            block_trans.block.data_size = acq_trans->block.data_size - total_bread;
+            err = _bpm_acq_copy_data_block (&block_trans, &reply);
+            total_bread += block_trans.block.bytes_read;
+            if (block_trans.block.bytes_read == 0) {
+                err = BPM_CLIENT_ERR_SERVER;
+            }
+        }
+        bpm_func_reply_release (&reply);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_queue_get_curve: Data "
+                "block was not read", err_get_block, BPM_CLIENT_ERR_SERVER);
 
-    /* Sent Message is:
-     * frame 0: operation code
-     * frame 1: channel
-     * frame 2: block required */
+        block_n++;
+    }
 
-    const disp_op_t* func = bpm_func_translate(ACQ_NAME_GET_DATA_BLOCK);
-    err = bpm_func_exec(self, func, service, write_val, (uint32_t *) read_val);
+err_get_block:
+    acq_trans->req.chan = info.curve.chan;
+    acq_trans->req.num_samples_pre = info.curve.num_samples_pre;
+    acq_trans->req.num_samples_post = info.curve.num_samples_post;
+    acq_trans->req.num_shots = info.curve.num_shots;
+    acq_trans->block.bytes_read = total_bread;
 
-    /* Message is:
-     * frame 0: error code
-     * frame 1: number of bytes read (optional)
-     * frame 2: data read (optional) */
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_queue_get_curve: "
+            "%u bytes of acquisition %u read\n", total_bread, index);
 
-    /* Check if any error occurred */
-    ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
-            "bpm_get_data_block: Data block was not acquired",
-            err_get_data_block, BPM_CLIENT_ERR_SERVER);
+err_get_info:
+    return err;
+}
 
-    /* Data size effectively returned */
-    uint32_t read_size = (acq_trans->block.data_size < read_val->valid_bytes) ?
-        acq_trans->block.data_size : read_val->valid_bytes;
+bpm_client_err_e bpm_acq_get_curve_info (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_curve_info_t *info)
+{
+    assert (self);
+    assert (service);
+    assert (info);
 
-    /* Copy message contents to user */
-    memcpy (acq_trans->block.data, read_val->data, read_size);
+    uint32_t write_val[1] = {0};
+    write_val[0] = chan;
 
-    /* Inform user about the number of bytes effectively copied */
-    acq_trans->block.bytes_read = read_size;
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_CURVE_INFO);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) info);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_curve_info: Curve "
+            "information could not be read", err_get_curve_info,
+            BPM_CLIENT_ERR_SERVER);
 
-    /* Print some debug messages */
-    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_data_block: "
-            "read_size: %u\n", read_size);
-    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_data_block: "
-            "acq_trans->block.data: %p\n", acq_trans->block.data);
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_curve_info: "
+            "Acquisition #%u of channel %u completed at %"PRIu64" ns\n",
+            info->seq, info->chan, info->timestamp);
 
-err_get_data_block:
+err_get_curve_info:
     return err;
 }
 
-static bpm_client_err_e _bpm_acq_get_curve (bpm_client_t *self, char *service, acq_trans_t *acq_trans)
+bpm_client_err_e bpm_acq_get_trig_info (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_trig_info_t *info)
 {
     assert (self);
     assert (service);
-    assert (acq_trans);
-    assert (acq_trans->block.data);
+    assert (info);
 
-    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint32_t write_val[1] = {0};
+    write_val[0] = chan;
 
-    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
-        acq_trans->req.num_samples_post;
-    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
-    uint32_t n_max_samples = BLOCK_SIZE/self->acq_chan[acq_trans->req.chan].sample_size;
-    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
-    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
-            "block_n_valid = %u\n", block_n_valid);
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_TRIG_INFO);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) info);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_trig_info: Trigger "
+            "information could not be read", err_get_trig_info,
+            BPM_CLIENT_ERR_SERVER);
 
-    /* Total bytes read */
-    uint32_t total_bread = 0;
-    /* Save the original buffer size for later */
-    uint32_t data_size = acq_trans->block.data_size;
-    uint32_t *original_data_pt = acq_trans->block.data;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_trig_info: "
+            "Acquisition #%u of channel %u has %"PRIu64" bytes to read\n",
+            info->seq, info->chan, info->size);
 
-    /* Fill all blocks */
-    for (uint32_t block_n = 0; block_n <= block_n_valid; block_n++) {
-        if (zsys_interrupted) {
-            err = BPM_CLIENT_INT;
-            goto bpm_zsys_interrupted;
-        }
+err_get_trig_info:
+    return err;
+}
 
-        acq_trans->block.idx = block_n;
-        err = _bpm_acq_get_data_block (self, service, acq_trans);
+bpm_client_err_e bpm_acq_wait_trig (bpm_client_t *self, char *service,
+        uint32_t chan, int timeout, smio_acq_trig_info_t *info)
+{
+    assert (self);
+    assert (service);
+    assert (info);
 
-        /* Check for return code */
-        ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
-                "_bpm_get_data_block failed. block_n is probably out of range",
-                err_bpm_get_data_block);
+    char *stream = NULL;
+    bpm_client_err_e err = _bpm_acq_event_subscribe (self, service, &stream);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_wait_trig: Could not "
+            "subscribe to ACQ events", err_subscribe);
+    err = _bpm_acq_trig_subscribe (self, stream);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_wait_trig: Could not "
+            "subscribe to ACQ trigger events", err_trig_subscribe);
 
-        total_bread += acq_trans->block.bytes_read;
-        acq_trans->block.data = (uint32_t *)((uint8_t *)acq_trans->block.data + acq_trans->block.bytes_read);
-        acq_trans->block.data_size -= acq_trans->block.bytes_read;
+    /* timeout < 0 means "infinite" wait */
+    int64_t deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+
+    /* As in _bpm_acq_wait_event (), every event is confirmed with a
+     * request, as it might be from an earlier acquisition */
+    err = bpm_acq_get_trig_info (self, service, chan, info);
+    while (err == BPM_CLIENT_SUCCESS && info->size == 0) {
+        int wait = -1;
+        if (deadline >= 0) {
+            int64_t remaining = deadline - zclock_mono ();
+            if (remaining <= 0) {
+                err = BPM_CLIENT_ERR_TIMEOUT;
+                goto err_timeout;
+            }
+            wait = (int) remaining;
+        }
 
-        /* Print some debug messages */
-        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
-                "Total bytes read up to now: %u\n", total_bread);
-        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
-                "Data pointer addr: %p\n", acq_trans->block.data);
-        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
-                "Data buffer size: %u\n", acq_trans->block.data_size);
-    }
+        void *which = zpoller_wait (self->acq_event_poller, wait);
+        if (which == NULL) {
+            err = zpoller_terminated (self->acq_event_poller) ?
+                BPM_CLIENT_INT : BPM_CLIENT_ERR_TIMEOUT;
+            goto err_poller;
+        }
 
-    /* Return to client the total number of bytes read */
-    acq_trans->block.bytes_read = total_bread;
-    acq_trans->block.data_size = data_size;
-    acq_trans->block.data = original_data_pt;
+        zmsg_t *msg = mlm_client_recv (self->acq_event_client);
+        const char *address = mlm_client_address (self->acq_event_client);
+        bool ours = streq (address, stream);
+        if (streq (mlm_client_subject (self->acq_event_client),
+                    ACQ_EVENT_SUBJECT_DONE)) {
+            _bpm_acq_prefetch_event (self, address, msg);
+        }
+        zmsg_destroy (&msg);
 
-    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
-            "Data curve of %u bytes was successfully acquired\n", total_bread);
+        if (!ours) {
+            continue;
+        }
 
-bpm_zsys_interrupted:
-err_bpm_get_data_block:
+        err = bpm_acq_get_trig_info (self, service, chan, info);
+    }
+
+err_poller:
+err_timeout:
+err_trig_subscribe:
+    free (stream);
+err_subscribe:
     return err;
 }
 
-static bpm_client_err_e _bpm_full_acq (bpm_client_t *self, char *service,
-        acq_trans_t *acq_trans, int timeout)
+bpm_client_err_e bpm_acq_get_pre_trig (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
 {
     assert (self);
     assert (service);
     assert (acq_trans);
     assert (acq_trans->block.data);
 
-    /* Send Acquisition Request */
-    _bpm_acq_start (self, service, &acq_trans->req);
+    smio_acq_trig_info_t info;
+    bpm_client_err_e err = bpm_acq_get_trig_info (self, service,
+            acq_trans->req.chan, &info);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_pre_trig: Trigger "
+            "information could not be read", err_get_trig_info);
+
+    if (info.size == 0) {
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_pre_trig: "
+                "Nothing to read yet of acquisition #%u\n", info.seq);
+        err = BPM_CLIENT_ERR_AGAIN;
+        goto err_nothing_yet;
+    }
 
-    /* Wait until the acquisition is finished */
-    bpm_client_err_e err = _func_polling (self, ACQ_NAME_CHECK_DATA_ACQUIRE,
-            service, NULL, NULL, timeout);
+    /* Save the original buffer for later */
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t *original_data_pt = acq_trans->block.data;
+    uint32_t size = (info.size < data_size) ? (uint32_t) info.size : data_size;
+    uint32_t bytes_read = 0;
 
-    ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
-            "Data acquisition was not completed",
-            err_check_data_acquire, BPM_CLIENT_ERR_SERVER);
+    /* The server leaves out what is not acquired yet of the last block */
+    for (uint32_t block_n = 0; bytes_read < size; block_n++) {
+        acq_trans->block.idx = block_n;
+        acq_trans->block.data = (uint32_t *) ((uint8_t *) original_data_pt +
+                bytes_read);
+        acq_trans->block.data_size = size - bytes_read;
 
-    /* If we are here, then the acquisition was successfully completed*/
-    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] "
-            "Data acquisition was successfully completed\n");
+        err = _bpm_acq_get_data_block (self, service, acq_trans);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_pre_trig: Data "
+                "block could not be read", err_get_data_block);
+        if (acq_trans->block.bytes_read == 0) {
+            break;
+        }
+        bytes_read += acq_trans->block.bytes_read;
+    }
 
-    err = _bpm_acq_get_curve (self, service, acq_trans);
-    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not get requested curve",
-            err_get_curve, BPM_CLIENT_ERR_SERVER);
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_pre_trig: "
+            "%u bytes of acquisition #%u read\n", bytes_read, info.seq);
 
-err_get_curve:
-err_check_data_acquire:
+err_get_data_block:
+    /* Only whole blocks are done. A partial last one is read again, with
+     * the rest of the curve, on resume */
+    acq_trans->blocks_done = bytes_read / BLOCK_SIZE;
+    acq_trans->bytes_done = acq_trans->blocks_done * BLOCK_SIZE;
+    acq_trans->block.bytes_read = bytes_read;
+    acq_trans->block.data_size = data_size;
+    acq_trans->block.data = original_data_pt;
+err_nothing_yet:
+err_get_trig_info:
     return err;
 }
 
-/* Wrapper to be compatible with old function behavior */
-static bpm_client_err_e _bpm_full_acq_compat (bpm_client_t *self, char *service,
-        acq_trans_t *acq_trans, int timeout, bool new_acq)
+bpm_client_err_e bpm_acq_get_curve_stats (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t flags, smio_acq_curve_stats_t *stats)
 {
-    if (new_acq) {
-        return _bpm_full_acq (self, service, acq_trans, timeout);
-    }
-    else {
-        return _bpm_acq_get_curve (self, service, acq_trans);
-    }
-}
+    assert (self);
+    assert (service);
+    assert (stats);
 
-/**************** DSP SMIO Functions ****************/
+    uint32_t write_val[2] = {0};
+    write_val[0] = chan;
+    write_val[1] = flags;
 
-/* Kx functions */
-PARAM_FUNC_CLIENT_WRITE(kx)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_KX, kx);
-}
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_CURVE_STATS);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) stats);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_curve_stats: Curve "
+            "statistics could not be read", err_get_curve_stats,
+            BPM_CLIENT_ERR_SERVER);
 
-PARAM_FUNC_CLIENT_READ(kx)
-{
-    return param_client_read (self, service, DSP_OPCODE_SET_GET_KX, kx);
-}
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_curve_stats: "
+            "Statistics of %u samples of acquisition #%u of channel %u read\n",
+            stats->num_samples, stats->seq, stats->chan);
 
-/* Ky functions */
-PARAM_FUNC_CLIENT_WRITE(ky)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_KY, ky);
+err_get_curve_stats:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ(ky)
+bpm_client_err_e bpm_acq_get_envelope (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t start, uint32_t num_samples,
+        uint32_t num_buckets, uint32_t flags, smio_acq_envelope_t *env)
 {
-    return param_client_read (self, service, DSP_OPCODE_SET_GET_KY, ky);
+    assert (self);
+    assert (service);
+    assert (env);
+
+    uint32_t write_val[5] = {0};
+    write_val[0] = chan;
+    write_val[1] = start;
+    write_val[2] = num_samples;
+    write_val[3] = num_buckets;
+    write_val[4] = flags;
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_ENVELOPE);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) env);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_envelope: Curve "
+            "envelope could not be read", err_get_envelope,
+            BPM_CLIENT_ERR_SERVER);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_envelope: "
+            "%u buckets of %u samples of acquisition #%u of channel %u read\n",
+            env->num_buckets, env->bucket_samples, env->seq, env->chan);
+
+err_get_envelope:
+    return err;
 }
 
-/* Ksum functions */
-PARAM_FUNC_CLIENT_WRITE(ksum)
+bpm_client_err_e bpm_acq_get_trig_log (bpm_client_t *self, char *service,
+        smio_acq_trig_log_t *trig_log)
 {
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_KSUM, ksum);
-}
+    assert (self);
+    assert (service);
+    assert (trig_log);
 
-PARAM_FUNC_CLIENT_READ(ksum)
-{
-    return param_client_read (self, service, DSP_OPCODE_SET_GET_KSUM, ksum);
-}
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_TRIG_LOG);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL,
+            (uint32_t *) trig_log);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_trig_log: Trigger "
+            "log could not be read", err_get_trig_log, BPM_CLIENT_ERR_SERVER);
 
-/* Delta/Sigma TBT threshold calculation functions */
-PARAM_FUNC_CLIENT_WRITE(ds_tbt_thres)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_DS_TBT_THRES, ds_tbt_thres);
-}
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_trig_log: "
+            "%u entries read\n", trig_log->num_entries);
 
-PARAM_FUNC_CLIENT_READ(ds_tbt_thres)
-{
-    return param_client_read (self, service, DSP_OPCODE_SET_GET_DS_TBT_THRES, ds_tbt_thres);
+err_get_trig_log:
+    return err;
 }
 
-/* Delta/Sigma FOFB threshold calculation functions */
-PARAM_FUNC_CLIENT_WRITE(ds_fofb_thres)
+bpm_client_err_e bpm_acq_get_chan_map (bpm_client_t *self, char *service,
+        smio_acq_chan_map_t *chan_map)
 {
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_DS_FOFB_THRES, ds_fofb_thres);
-}
+    assert (self);
+    assert (service);
+    assert (chan_map);
 
-PARAM_FUNC_CLIENT_READ(ds_fofb_thres)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_DS_FOFB_THRES, ds_fofb_thres);
-}
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_CHAN_MAP);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL,
+            (uint32_t *) chan_map);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_chan_map: Channel "
+            "map could not be read", err_get_chan_map, BPM_CLIENT_ERR_SERVER);
 
-/* Delta/Sigma MONIT. threshold calculation functions */
-PARAM_FUNC_CLIENT_WRITE(ds_monit_thres)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_DS_MONIT_THRES, ds_monit_thres);
-}
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_chan_map: "
+            "%u channels read\n", chan_map->num_chans);
 
-PARAM_FUNC_CLIENT_READ(ds_monit_thres)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_DS_MONIT_THRES, ds_monit_thres);
+err_get_chan_map:
+    return err;
 }
 
-/* Monitoring Amplitude channel 0 value */
-PARAM_FUNC_CLIENT_WRITE(monit_amp_ch0)
+bpm_client_err_e bpm_acq_get_chan_desc (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_chan_desc_t *desc)
 {
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH0, monit_amp_ch0);
-}
+    assert (self);
+    assert (service);
+    assert (desc);
 
-PARAM_FUNC_CLIENT_READ(monit_amp_ch0)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH0, monit_amp_ch0);
-}
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    const smio_acq_chan_map_t *chan_map = _bpm_acq_chan_map (self, service);
+    ASSERT_TEST(chan_map != NULL, "bpm_acq_get_chan_desc: Could not get the "
+            "channel map", err_chan_map, BPM_CLIENT_ERR_ALLOC);
+    ASSERT_TEST(chan < chan_map->num_chans, "bpm_acq_get_chan_desc: Invalid "
+            "channel", err_inv_chan, BPM_CLIENT_ERR_INV_PARAM);
 
-/* Monitoring Amplitude channel 1 value */
-PARAM_FUNC_CLIENT_WRITE(monit_amp_ch1)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH1, monit_amp_ch1);
-}
+    *desc = chan_map->chans[chan];
 
-PARAM_FUNC_CLIENT_READ(monit_amp_ch1)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH1, monit_amp_ch1);
+err_inv_chan:
+err_chan_map:
+    return err;
 }
 
-/* Monitoring Amplitude channel 2 value */
-PARAM_FUNC_CLIENT_WRITE(monit_amp_ch2)
+bpm_client_err_e bpm_acq_set_partition (bpm_client_t *self, char *service,
+        smio_acq_partition_t *part)
 {
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH2, monit_amp_ch2);
-}
+    assert (self);
+    assert (service);
+    assert (part);
 
-PARAM_FUNC_CLIENT_READ(monit_amp_ch2)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH2, monit_amp_ch2);
-}
+    uint32_t rw = WRITE_MODE;
+    bpm_client_err_e err = param_client_write_gen (self, service,
+            ACQ_OPCODE_CFG_PARTITION, rw, part, sizeof (*part), NULL, 0);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_set_partition: Memory "
+            "could not be repartitioned", err_set_partition);
+
+    /* The channel regions changed, so the channel map we keep is read
+     * again, in place, as it might be referenced by the service */
+    smio_acq_chan_map_t *chan_map = (smio_acq_chan_map_t *) zhashx_lookup (
+            self->acq_chan_maps, service);
+    if (chan_map != NULL) {
+        smio_acq_chan_map_t new_map;
+        if (bpm_acq_get_chan_map (self, service, &new_map) == BPM_CLIENT_SUCCESS &&
+                new_map.num_chans == chan_map->num_chans) {
+            *chan_map = new_map;
+        }
+    }
 
-/* Monitoring Amplitude channel 3 value */
-PARAM_FUNC_CLIENT_WRITE(monit_amp_ch3)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH3, monit_amp_ch3);
+err_set_partition:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ(monit_amp_ch3)
+bpm_client_err_e bpm_acq_get_partition (bpm_client_t *self, char *service,
+        smio_acq_partition_t *part)
 {
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH3, monit_amp_ch3);
-}
+    assert (self);
+    assert (service);
+    assert (part);
 
-/* Monitoring Position X value */
-PARAM_FUNC_CLIENT_WRITE(monit_pos_x)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_X, monit_pos_x);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, ACQ_OPCODE_CFG_PARTITION,
+            rw, part, sizeof (*part), NULL, 0, part, sizeof (*part));
 }
 
-PARAM_FUNC_CLIENT_READ(monit_pos_x)
+bpm_client_err_e bpm_acq_get_shot_index (bpm_client_t *self, char *service,
+        uint32_t chan, smio_acq_shot_index_t *index)
 {
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_X, monit_pos_x);
-}
+    assert (self);
+    assert (service);
+    assert (index);
 
-/* Monitoring Position Y value */
-PARAM_FUNC_CLIENT_WRITE(monit_pos_y)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Y, monit_pos_y);
-}
+    uint32_t write_val[1] = {0};
+    write_val[0] = chan;
 
-PARAM_FUNC_CLIENT_READ(monit_pos_y)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Y, monit_pos_y);
-}
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_SHOT_INDEX);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) index);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_shot_index: Shot "
+            "index could not be read", err_get_shot_index, BPM_CLIENT_ERR_SERVER);
 
-/* Monitoring Position Q value */
-PARAM_FUNC_CLIENT_WRITE(monit_pos_q)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Q, monit_pos_q);
-}
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_shot_index: "
+            "%u shots of %"PRIu64" bytes\n", index->num_shots, index->shot_size);
 
-PARAM_FUNC_CLIENT_READ(monit_pos_q)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Q, monit_pos_q);
+err_get_shot_index:
+    return err;
 }
 
-/* Monitoring Position Sum value */
-PARAM_FUNC_CLIENT_WRITE(monit_pos_sum)
+bpm_client_err_e bpm_acq_get_shot (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t shot, uint32_t block_size,
+        smio_acq_shot_index_t *index)
 {
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_SUM, monit_pos_sum);
-}
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
 
-PARAM_FUNC_CLIENT_READ(monit_pos_sum)
-{
-     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_SUM, monit_pos_sum);
-}
+    smio_acq_shot_index_t shot_index;
+    bpm_client_err_e err = bpm_acq_get_shot_index (self, service,
+            acq_trans->req.chan, &shot_index);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_shot: Could not get "
+            "shot index", err_get_shot_index);
+    ASSERT_TEST(shot < shot_index.num_shots, "bpm_acq_get_shot: Shot is out "
+            "of range", err_get_shot_index, BPM_CLIENT_ERR_INV_PARAM);
 
-/* Monitoring Update value */
-PARAM_FUNC_CLIENT_WRITE(monit_updt)
-{
-    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_UPDT, monit_updt);
-}
+    /* The same receive buffer is reused for all blocks */
+    smio_acq_data_block_var_t *read_val = zmalloc (sizeof (read_val->valid_bytes) +
+            block_size);
+    ASSERT_ALLOC(read_val, err_read_val_alloc, BPM_CLIENT_ERR_ALLOC);
 
-PARAM_FUNC_CLIENT_READ(monit_updt)
-{
-    return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_UPDT, monit_updt);
-}
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: shot required
+     * frame 3: block required
+     * frame 4: block size */
+    uint32_t write_val[4] = {0};
+    write_val[0] = acq_trans->req.chan;
+    write_val[1] = shot;
+    write_val[3] = block_size;
 
-/**************** Swap SMIO Functions ****************/
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_SHOT_BLOCK);
+    uint8_t *data = (uint8_t *) acq_trans->block.data;
+    uint32_t total_bread = 0;
 
-/* Switching functions */
-PARAM_FUNC_CLIENT_WRITE(sw)
-{
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_SW, sw);
-}
+    for (uint32_t block_n = 0; (uint64_t) block_n * block_size < shot_index.shot_size &&
+            total_bread < acq_trans->block.data_size; block_n++) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
 
-PARAM_FUNC_CLIENT_READ(sw)
-{
-    return param_client_read (self, service, SWAP_OPCODE_SET_GET_SW, sw);
-}
+        write_val[2] = block_n;
+        err = bpm_func_exec (self, func, service, write_val, (uint32_t *) read_val);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_shot: Shot block "
+                "was not read", err_get_shot_block, BPM_CLIENT_ERR_SERVER);
 
-/* Switching enabling functions */
-PARAM_FUNC_CLIENT_WRITE(sw_en)
-{
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_SW_EN, sw_en);
-}
+        uint32_t read_size = acq_trans->block.data_size - total_bread;
+        if (read_size > read_val->valid_bytes) {
+            read_size = read_val->valid_bytes;
+        }
+        memcpy (data + total_bread, read_val->data, read_size);
+        total_bread += read_size;
+    }
 
-PARAM_FUNC_CLIENT_READ(sw_en)
-{
-    return param_client_read (self, service, SWAP_OPCODE_SET_GET_SW_EN, sw_en);
-}
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_shot: "
+            "Shot %u of %u bytes was successfully read\n", shot, total_bread);
 
-/* Switching Clock division functions */
-PARAM_FUNC_CLIENT_WRITE(div_clk)
-{
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_DIV_CLK, div_clk);
+    if (index != NULL) {
+        *index = shot_index;
+    }
+
+bpm_zsys_interrupted:
+err_get_shot_block:
+    acq_trans->block.bytes_read = total_bread;
+    free (read_val);
+err_read_val_alloc:
+err_get_shot_index:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_get_range (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, uint32_t shot, uint32_t start_sample,
+        uint32_t num_samples)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service,
+            acq_trans->req.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_RANGE);
+    uint8_t *data = (uint8_t *) acq_trans->block.data;
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t total_bread = 0;
+
+    /* The server returns up to its maximum block size at a time */
+    uint32_t samples_done = 0;
+    bool shot_end = false;
+    while (!shot_end && samples_done < num_samples &&
+            total_bread + sample_size <= data_size) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        /* Sent Message is:
+         * frame 0: operation code
+         * frame 1: channel
+         * frame 2: shot required
+         * frame 3: first sample
+         * frame 4: number of samples */
+        uint32_t write_val[4] = {0};
+        write_val[0] = acq_trans->req.chan;
+        write_val[1] = shot;
+        write_val[2] = start_sample + samples_done;
+        write_val[3] = num_samples - samples_done;
+
+        bpm_func_reply_t reply;
+        err = bpm_func_exec_view (self, func, service, write_val, &reply);
+        if (err == BPM_CLIENT_SUCCESS) {
+            acq_trans_t block_trans = *acq_trans;
+            block_trans.block.data = (uint32_t *) (data + total_bread);
+            block_trans.block.data_size = data_size - total_bread;
+            err = _bpm_acq_copy_data_block (&block_trans, &reply);
+            total_bread += block_trans.block.bytes_read;
+            samples_done += block_trans.block.bytes_read / sample_size;
+            shot_end = block_trans.block.bytes_read < sample_size;
+        }
+        bpm_func_reply_release (&reply);
+
+        /* Past the end of the shot, once part of the range was read */
+        if (err != BPM_CLIENT_SUCCESS && samples_done > 0) {
+            err = BPM_CLIENT_SUCCESS;
+            shot_end = true;
+        }
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_range: Range "
+                "was not read", err_get_range, BPM_CLIENT_ERR_SERVER);
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_range: "
+            "%u samples at %u of shot %u were read\n", samples_done,
+            start_sample, shot);
+
+bpm_zsys_interrupted:
+err_get_range:
+    acq_trans->block.bytes_read = total_bread;
+err_inv_chan:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_wait_event (bpm_client_t *self, char *service,
+        int timeout)
+{
+    return _bpm_acq_wait_event (self, service, timeout);
+}
+
+static bpm_client_err_e _bpm_acq_group_check (bpm_client_t *self,
+        char **services, size_t num_services, bool *sel,
+        bpm_client_err_e *errs, int64_t deadline);
+
+/* Curve of one of the services of a group read */
+typedef struct {
+    acq_trans_t *acq_trans;                     /* Curve description and buffer */
+    uint32_t block_n_valid;                     /* Last block of the curve */
+    uint32_t block_bytes;                       /* Bytes of a full block */
+    uint32_t next_block;                        /* Next block to request */
+    bpm_client_err_e err;                       /* Status of the curve */
+} bpm_acq_group_curve_t;
+
+/* Group read in progress, see bpm_acq_group_get_curve () */
+typedef struct {
+    char **services;
+    bpm_acq_group_curve_t *curves;              /* Curve of each service */
+    const disp_op_t *func;                      /* Data block function */
+    size_t in_flight;                           /* Block requests not done */
+} bpm_acq_group_read_t;
+
+/* Block request of a group read. Its buffer takes the next blocks of the
+ * same curve, one after the other */
+typedef struct {
+    bpm_acq_group_read_t *read;
+    size_t curve;                               /* Index of the curve */
+    uint32_t block;                             /* Block requested */
+    uint32_t req_id;                            /* Asynchronous request ID */
+    bool pending;                               /* Reply not received yet */
+    smio_acq_data_block_t data;                 /* Reply buffer */
+} bpm_acq_group_slot_t;
+
+static void _bpm_acq_group_request (bpm_client_t *self,
+        bpm_acq_group_slot_t *slot);
+static void _bpm_acq_group_block_done (bpm_client_t *self, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg);
+
+bpm_client_err_e bpm_acq_group_start (bpm_client_t *self, char **services,
+        size_t num_services, acq_req_t *acq_req, bpm_client_err_e *errs,
+        int timeout)
+{
+    assert (self);
+    assert (services);
+    assert (acq_req);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* Subscribe before arming, so no completion event is missed */
+    for (size_t i = 0; i < num_services; ++i) {
+        char *stream = NULL;
+        err = _bpm_acq_event_subscribe (self, services [i], &stream);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_group_start: Could "
+                "not subscribe to ACQ events", err_subscribe);
+        free (stream);
+    }
+
+    /* Events of earlier acquisitions are of no use. The ones still in
+     * flight are told apart by the status checks of bpm_acq_group_wait () */
+    while (zpoller_wait (self->acq_event_poller, 0) != NULL) {
+        zmsg_t *msg = mlm_client_recv (self->acq_event_client);
+        ASSERT_TEST(msg != NULL, "bpm_acq_group_start: Could not receive "
+                "ACQ event", err_drain, BPM_CLIENT_INT);
+        zmsg_destroy (&msg);
+    }
+
+    uint32_t write_val[4] = {0};
+    write_val[0] = acq_req->num_samples_pre;
+    write_val[1] = acq_req->num_samples_post;
+    write_val[2] = acq_req->num_shots;
+    write_val[3] = acq_req->chan;
+
+    for (size_t i = 0; i < num_services; ++i) {
+        _bpm_acq_prefetch_drop (self, services [i]);
+    }
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_DATA_ACQUIRE);
+    err = bpm_func_exec_multi (self, func, services, num_services, write_val,
+            NULL, 0, errs, timeout);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_group_start: Data acquire "
+            "was not requested correctly on all of the services", err_data_acquire);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_group_start: "
+            "Channel %u armed on %zu services\n", acq_req->chan, num_services);
+
+err_data_acquire:
+err_drain:
+err_subscribe:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_group_wait (bpm_client_t *self, char **services,
+        size_t num_services, bpm_client_err_e *errs, int timeout)
+{
+    assert (self);
+    assert (services);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    int64_t deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+    size_t num_pending = num_services;
+
+    bool *done = (bool *) zmalloc (num_services * sizeof (*done));
+    ASSERT_ALLOC(done, err_done_alloc, BPM_CLIENT_ERR_ALLOC);
+    bool *evented = (bool *) zmalloc (num_services * sizeof (*evented));
+    ASSERT_ALLOC(evented, err_evented_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    ASSERT_TEST(self->acq_event_poller != NULL, "bpm_acq_group_wait: Not "
+            "subscribed to ACQ events", err_streams_alloc,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* Service index + 1 of each event stream */
+    zhashx_t *streams = zhashx_new ();
+    ASSERT_ALLOC(streams, err_streams_alloc, BPM_CLIENT_ERR_ALLOC);
+    for (size_t i = 0; i < num_services; ++i) {
+        char *stream = hutils_concat_strings (services [i],
+                ACQ_EVENT_STREAM_SUFFIX, ':');
+        ASSERT_ALLOC(stream, err_stream_alloc, BPM_CLIENT_ERR_ALLOC);
+        zhashx_update (streams, stream, (void *) (uintptr_t) (i + 1));
+        free (stream);
+    }
+
+    while (num_pending > 0) {
+        /* Gather the events that arrived, then confirm them all at once */
+        bool any_event = false;
+        int wait = -1;
+        if (deadline >= 0) {
+            int64_t remaining = deadline - zclock_mono ();
+            wait = (remaining > 0) ? (int) remaining : 0;
+        }
+
+        while (zpoller_wait (self->acq_event_poller, any_event ? 0 : wait) != NULL) {
+            zmsg_t *msg = mlm_client_recv (self->acq_event_client);
+            ASSERT_TEST(msg != NULL, "bpm_acq_group_wait: Could not receive "
+                    "ACQ event", err_recv, BPM_CLIENT_INT);
+            const char *address = mlm_client_address (self->acq_event_client);
+            uintptr_t idx = (uintptr_t) zhashx_lookup (streams, address);
+            _bpm_acq_prefetch_event (self, address, msg);
+            zmsg_destroy (&msg);
+
+            if (idx != 0 && !done [idx - 1]) {
+                evented [idx - 1] = true;
+                any_event = true;
+            }
+        }
+
+        if (zpoller_terminated (self->acq_event_poller)) {
+            err = BPM_CLIENT_INT;
+            goto err_recv;
+        }
+
+        bool timed_out = deadline >= 0 && zclock_mono () >= deadline;
+        if (!any_event && !timed_out) {
+            continue;
+        }
+
+        /* On timeout, the services no event came from are checked as
+         * well, in case their events were lost */
+        for (size_t i = 0; i < num_services; ++i) {
+            if (timed_out && !done [i]) {
+                evented [i] = true;
+            }
+        }
+
+        err = _bpm_acq_group_check (self, services, num_services, evented,
+                errs, timed_out ? zclock_mono () + self->timeout : deadline);
+        ASSERT_TEST(err != BPM_CLIENT_INT, "bpm_acq_group_wait: Interrupted",
+                err_recv);
+
+        /* Only the completed services are left selected by the check */
+        num_pending = 0;
+        for (size_t i = 0; i < num_services; ++i) {
+            done [i] = done [i] || evented [i];
+            evented [i] = false;
+            num_pending += done [i] ? 0 : 1;
+        }
+
+        if (timed_out) {
+            break;
+        }
+    }
+
+    err = BPM_CLIENT_SUCCESS;
+    for (size_t i = 0; i < num_services; ++i) {
+        if (errs != NULL) {
+            errs [i] = done [i] ? BPM_CLIENT_SUCCESS : BPM_CLIENT_ERR_TIMEOUT;
+        }
+        if (!done [i] && err == BPM_CLIENT_SUCCESS) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] bpm_acq_group_wait: "
+                    "Acquisition of %s did not complete in time\n", services [i]);
+            err = BPM_CLIENT_ERR_TIMEOUT;
+        }
+    }
+
+err_recv:
+err_stream_alloc:
+    zhashx_destroy (&streams);
+err_streams_alloc:
+    free (evented);
+err_evented_alloc:
+    free (done);
+err_done_alloc:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_group_acquire (bpm_client_t *self, char **services,
+        size_t num_services, acq_req_t *acq_req, bpm_client_err_e *errs,
+        int timeout)
+{
+    int64_t deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+
+    bpm_client_err_e err = bpm_acq_group_start (self, services, num_services,
+            acq_req, errs, timeout);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_group_acquire: Could not "
+            "arm all of the services", err_start);
+
+    int remaining = -1;
+    if (deadline >= 0) {
+        int64_t left = deadline - zclock_mono ();
+        remaining = (left > 0) ? (int) left : 0;
+    }
+    err = bpm_acq_group_wait (self, services, num_services, errs, remaining);
+
+err_start:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_group_get_curve (bpm_client_t *self, char **services,
+        size_t num_services, acq_trans_t *acq_trans, uint32_t window,
+        bpm_client_err_e *errs)
+{
+    assert (self);
+    assert (services);
+    assert (acq_trans);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    window = (window == 0) ? 1 : window;
+
+    bpm_acq_group_read_t read = {
+        .services = services,
+        .curves = NULL,
+        .func = _bpm_func_translate (self, ACQ_NAME_GET_DATA_BLOCK),
+        .in_flight = 0
+    };
+    ASSERT_TEST(read.func != NULL, "Could not find data block function", err_func,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    read.curves = (bpm_acq_group_curve_t *) zmalloc (num_services *
+            sizeof (*read.curves));
+    ASSERT_ALLOC(read.curves, err_curves_alloc, BPM_CLIENT_ERR_ALLOC);
+    bpm_acq_group_slot_t *slots = (bpm_acq_group_slot_t *) zmalloc (
+            num_services * window * sizeof (*slots));
+    ASSERT_ALLOC(slots, err_slots_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    for (size_t i = 0; i < num_services; ++i) {
+        bpm_acq_group_curve_t *curve = &read.curves [i];
+        curve->acq_trans = &acq_trans [i];
+        acq_trans [i].blocks_done = 0;
+        acq_trans [i].bytes_done = 0;
+
+        uint32_t sample_size = _bpm_acq_sample_size (self, services [i],
+                acq_trans [i].req.chan);
+        if (sample_size == 0) {
+            curve->err = BPM_CLIENT_ERR_INV_PARAM;
+            continue;
+        }
+        uint32_t num_samples_shot = acq_trans [i].req.num_samples_pre +
+            acq_trans [i].req.num_samples_post;
+        uint32_t n_max_samples = BLOCK_SIZE/sample_size;
+        curve->block_n_valid = num_samples_shot*acq_trans [i].req.num_shots /
+            n_max_samples;
+        curve->block_bytes = n_max_samples*sample_size;
+    }
+
+    /* Fill the windows a request of each service at a time, so all of
+     * the ACQ cores are read from the start */
+    for (uint32_t w = 0; w < window; ++w) {
+        for (size_t i = 0; i < num_services; ++i) {
+            bpm_acq_group_slot_t *slot = &slots [i*window + w];
+            slot->read = &read;
+            slot->curve = i;
+            _bpm_acq_group_request (self, slot);
+        }
+    }
+
+    /* Requests expire on their deadlines, so every one of them completes */
+    while (read.in_flight > 0) {
+        bpm_client_err_e derr = zsys_interrupted ? BPM_CLIENT_INT :
+            bpm_func_async_dispatch (self, self->timeout);
+        if (derr != BPM_CLIENT_SUCCESS) {
+            /* The buffers are going away, so drop the replies still due */
+            for (size_t s = 0; s < num_services * window; ++s) {
+                if (slots [s].pending) {
+                    bpm_func_async_cancel (self, slots [s].req_id);
+                }
+            }
+            err = derr;
+            goto err_dispatch;
+        }
+    }
+
+    /* Report the first failure, if any */
+    for (size_t i = 0; i < num_services; ++i) {
+        if (read.curves [i].err != BPM_CLIENT_SUCCESS) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] bpm_acq_group_get_curve: "
+                    "Curve of %s was not read: %s\n", services [i],
+                    bpm_client_err_str (read.curves [i].err));
+            if (err == BPM_CLIENT_SUCCESS) {
+                err = read.curves [i].err;
+            }
+        }
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_group_get_curve: "
+            "Curves of %zu services read\n", num_services);
+
+err_dispatch:
+    for (size_t i = 0; i < num_services; ++i) {
+        acq_trans [i].block.bytes_read = acq_trans [i].bytes_done;
+        if (errs != NULL) {
+            errs [i] = (err == BPM_CLIENT_INT) ? err : read.curves [i].err;
+        }
+    }
+    free (slots);
+err_slots_alloc:
+    free (read.curves);
+err_curves_alloc:
+err_func:
+    return err;
+}
+
+/* Request the next block of the curve of "slot", if any is left */
+static void _bpm_acq_group_request (bpm_client_t *self,
+        bpm_acq_group_slot_t *slot)
+{
+    bpm_acq_group_read_t *read = slot->read;
+    bpm_acq_group_curve_t *curve = &read->curves [slot->curve];
+
+    if (curve->err != BPM_CLIENT_SUCCESS || curve->next_block > curve->block_n_valid) {
+        return;
+    }
+
+    uint32_t write_val[2] = {0};
+    write_val[0] = curve->acq_trans->req.chan;
+    write_val[1] = curve->next_block;
+    slot->block = curve->next_block;
+
+    bpm_client_err_e err = bpm_func_exec_async (self, read->func,
+            read->services [slot->curve], write_val, (uint32_t *) &slot->data,
+            _bpm_acq_group_block_done, slot, &slot->req_id);
+    if (err != BPM_CLIENT_SUCCESS) {
+        curve->err = err;
+        return;
+    }
+
+    curve->next_block++;
+    slot->pending = true;
+    read->in_flight++;
+}
+
+/* Copy a block of a group read to its place in the curve and request the
+ * next one with the same buffer */
+static void _bpm_acq_group_block_done (bpm_client_t *self, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg)
+{
+    (void) req_id;
+    (void) output;
+    bpm_acq_group_slot_t *slot = (bpm_acq_group_slot_t *) arg;
+    bpm_acq_group_curve_t *curve = &slot->read->curves [slot->curve];
+    acq_trans_t *acq_trans = curve->acq_trans;
+
+    slot->pending = false;
+    slot->read->in_flight--;
+
+    if (err != BPM_CLIENT_SUCCESS) {
+        if (curve->err == BPM_CLIENT_SUCCESS) {
+            curve->err = err;
+        }
+        return;
+    }
+
+    /* Replies of different services come in any order */
+    uint64_t offs = (uint64_t) slot->block * curve->block_bytes;
+    uint32_t valid_bytes = (slot->data.valid_bytes > sizeof (slot->data.data)) ?
+        sizeof (slot->data.data) : slot->data.valid_bytes;
+    if (offs < acq_trans->block.data_size) {
+        uint32_t read_size = (acq_trans->block.data_size - offs < valid_bytes) ?
+            acq_trans->block.data_size - offs : valid_bytes;
+        memcpy ((uint8_t *) acq_trans->block.data + offs, slot->data.data,
+                read_size);
+        acq_trans->bytes_done += read_size;
+    }
+    acq_trans->blocks_done++;
+
+    _bpm_acq_group_request (self, slot);
+}
+
+/* Check the acquisitions of the services selected by "sel" in parallel.
+ * Status of each one is returned in errs [i], if "errs" is not NULL */
+static bpm_client_err_e _bpm_acq_group_check (bpm_client_t *self,
+        char **services, size_t num_services, bool *sel,
+        bpm_client_err_e *errs, int64_t deadline)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    size_t num_sel = 0;
+
+    char **sel_services = (char **) zmalloc (num_services * sizeof (*sel_services));
+    ASSERT_ALLOC(sel_services, err_sel_services_alloc, BPM_CLIENT_ERR_ALLOC);
+    bpm_client_err_e *sel_errs = (bpm_client_err_e *) zmalloc (num_services *
+            sizeof (*sel_errs));
+    ASSERT_ALLOC(sel_errs, err_sel_errs_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    for (size_t i = 0; i < num_services; ++i) {
+        if (sel [i]) {
+            sel_services [num_sel++] = services [i];
+        }
+    }
+
+    int timeout = -1;
+    if (deadline >= 0) {
+        int64_t remaining = deadline - zclock_mono ();
+        timeout = (remaining > 0) ? (int) remaining : 0;
+    }
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_CHECK_DATA_ACQUIRE);
+    err = bpm_func_exec_multi (self, func, sel_services, num_sel, NULL, NULL, 0,
+            sel_errs, timeout);
+
+    /* Services not completed are deselected */
+    for (size_t i = 0, j = 0; i < num_services; ++i) {
+        if (sel [i]) {
+            if (errs != NULL) {
+                errs [i] = sel_errs [j];
+            }
+            sel [i] = (sel_errs [j] == BPM_CLIENT_SUCCESS);
+            j++;
+        }
+    }
+
+    free (sel_errs);
+err_sel_errs_alloc:
+    free (sel_services);
+err_sel_services_alloc:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_prefetch_enable (bpm_client_t *self, char *service,
+        acq_req_t *acq_req)
+{
+    assert (self);
+    assert (service);
+    assert (acq_req);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    uint32_t sample_size = _bpm_acq_sample_size (self, service, acq_req->chan);
+    ASSERT_TEST(sample_size != 0, "bpm_acq_prefetch_enable: Invalid channel",
+            err_inv_chan, BPM_CLIENT_ERR_INV_PARAM);
+    size_t size = (size_t) (acq_req->num_samples_pre + acq_req->num_samples_post) *
+        acq_req->num_shots * sample_size;
+
+    /* The curve enabled before, if any, is replaced */
+    bpm_acq_prefetch_disable (self, service);
+    ASSERT_TEST(size <= self->acq_prefetch_max - self->acq_prefetch_used,
+            "bpm_acq_prefetch_enable: Curve does not fit in the prefetch memory",
+            err_no_room, BPM_CLIENT_ERR_ALLOC);
+
+    char *stream = NULL;
+    err = _bpm_acq_event_subscribe (self, service, &stream);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_prefetch_enable: Could not "
+            "subscribe to ACQ events", err_subscribe);
+    free (stream);
+
+    bpm_acq_prefetch_t *prefetch = (bpm_acq_prefetch_t *) zmalloc (sizeof *prefetch);
+    ASSERT_ALLOC(prefetch, err_prefetch_alloc, BPM_CLIENT_ERR_ALLOC);
+    prefetch->trans.req = *acq_req;
+    prefetch->trans.block.data = (uint32_t *) zmalloc (size);
+    ASSERT_ALLOC(prefetch->trans.block.data, err_data_alloc, BPM_CLIENT_ERR_ALLOC);
+    prefetch->trans.block.data_size = size;
+    prefetch->size = size;
+    prefetch->valid = false;
+
+    zhashx_insert (self->acq_prefetches, service, prefetch);
+    self->acq_prefetch_used += size;
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_prefetch_enable: "
+            "Prefetching %zu bytes of channel %u from %s\n", size, acq_req->chan,
+            service);
+    return err;
+
+err_data_alloc:
+    free (prefetch);
+err_prefetch_alloc:
+err_subscribe:
+err_no_room:
+err_inv_chan:
+    return err;
+}
+
+void bpm_acq_prefetch_disable (bpm_client_t *self, char *service)
+{
+    assert (self);
+    assert (service);
+
+    bpm_acq_prefetch_t *prefetch = (bpm_acq_prefetch_t *) zhashx_lookup (
+            self->acq_prefetches, service);
+    if (prefetch != NULL) {
+        self->acq_prefetch_used -= prefetch->size;
+        zhashx_delete (self->acq_prefetches, service);
+    }
+}
+
+bpm_client_err_e bpm_acq_prefetch_dispatch (bpm_client_t *self, int timeout)
+{
+    assert (self);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    ASSERT_TEST(zhashx_size (self->acq_prefetches) > 0 && self->acq_event_poller != NULL,
+            "bpm_acq_prefetch_dispatch: No prefetch enabled", err_no_prefetch,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* timeout < 0 means "infinite" wait for the first event. The others
+     * are only processed if they have already arrived */
+    int wait = timeout;
+    while (zpoller_wait (self->acq_event_poller, wait) != NULL) {
+        zmsg_t *msg = mlm_client_recv (self->acq_event_client);
+        ASSERT_TEST(msg != NULL, "bpm_acq_prefetch_dispatch: Could not receive "
+                "ACQ event", err_recv, BPM_CLIENT_INT);
+        _bpm_acq_prefetch_event (self, mlm_client_address (self->acq_event_client),
+                msg);
+        zmsg_destroy (&msg);
+        wait = 0;
+    }
+
+    if (zpoller_terminated (self->acq_event_poller)) {
+        err = BPM_CLIENT_INT;
+    }
+
+err_recv:
+err_no_prefetch:
+    return err;
+}
+
+/* Prefetch the curve a completion event from "stream" is for, if enabled */
+static void _bpm_acq_prefetch_event (bpm_client_t *self, const char *stream,
+        zmsg_t *msg)
+{
+    if (zhashx_size (self->acq_prefetches) == 0 || stream == NULL || msg == NULL) {
+        return;
+    }
+
+    /* Streams are "<service>:EVENTS" */
+    size_t suffix_len = strlen (ACQ_EVENT_STREAM_SUFFIX) + 1;
+    size_t stream_len = strlen (stream);
+    if (stream_len <= suffix_len) {
+        return;
+    }
+    char *service = strndup (stream, stream_len - suffix_len);
+    if (service == NULL) {
+        return;
+    }
+
+    bpm_acq_prefetch_t *prefetch = (bpm_acq_prefetch_t *) zhashx_lookup (
+            self->acq_prefetches, service);
+    if (prefetch == NULL || prefetch->valid) {
+        goto out;
+    }
+
+    /* Only events of acquisitions including our channel */
+    zframe_t *frame = zmsg_first (msg);
+    if (frame == NULL || zframe_size (frame) != sizeof (smio_acq_event_t)) {
+        goto out;
+    }
+    smio_acq_event_t event;
+    memcpy (&event, zframe_data (frame), sizeof (event));
+    uint32_t chan = prefetch->trans.req.chan;
+    if (chan >= 32 || (event.chan_mask & (1U << chan)) == 0) {
+        goto out;
+    }
+
+    /* Events might be stale, as in _bpm_acq_wait_event () */
+    if (_bpm_acq_check (self, service) != BPM_CLIENT_SUCCESS) {
+        goto out;
+    }
+
+    prefetch->trans.blocks_done = 0;
+    prefetch->trans.bytes_done = 0;
+    bpm_client_err_e err = _bpm_acq_get_curve_blocks (self, service,
+            &prefetch->trans);
+    prefetch->valid = (err == BPM_CLIENT_SUCCESS);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_prefetch: "
+            "Curve of %s %s: %s\n", service, prefetch->valid ? "prefetched" :
+            "not prefetched", bpm_client_err_str (err));
+
+out:
+    free (service);
+}
+
+/* The acquisition a prefetched curve of "service" is from is over */
+static void _bpm_acq_prefetch_drop (bpm_client_t *self, char *service)
+{
+    if (zhashx_size (self->acq_prefetches) == 0) {
+        return;
+    }
+
+    bpm_acq_prefetch_t *prefetch = (bpm_acq_prefetch_t *) zhashx_lookup (
+            self->acq_prefetches, service);
+    if (prefetch != NULL) {
+        prefetch->valid = false;
+    }
+}
+
+/* Serve acq_trans from the prefetched curve of "service", if it is the same
+ * curve and fits. A prefetched curve is only served once */
+static bool _bpm_acq_prefetch_get (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
+{
+    if (zhashx_size (self->acq_prefetches) == 0) {
+        return false;
+    }
+
+    bpm_acq_prefetch_t *prefetch = (bpm_acq_prefetch_t *) zhashx_lookup (
+            self->acq_prefetches, service);
+    if (prefetch == NULL || !prefetch->valid ||
+            memcmp (&prefetch->trans.req, &acq_trans->req, sizeof (acq_req_t)) != 0 ||
+            acq_trans->block.data_size < prefetch->trans.bytes_done) {
+        return false;
+    }
+
+    memcpy (acq_trans->block.data, prefetch->trans.block.data,
+            prefetch->trans.bytes_done);
+    acq_trans->block.bytes_read = prefetch->trans.bytes_done;
+    acq_trans->bytes_done = prefetch->trans.bytes_done;
+    acq_trans->blocks_done = prefetch->trans.blocks_done;
+    prefetch->valid = false;
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
+            "Curve of %u bytes served from prefetch\n", acq_trans->bytes_done);
+    return true;
+}
+
+static bpm_client_err_e _bpm_acq_check_timed (bpm_client_t *self, char *service,
+        int timeout)
+{
+    /* Wait for the completion event, if we can subscribe to it */
+    bpm_client_err_e err = _bpm_acq_wait_event (self, service, timeout);
+    if (err != BPM_CLIENT_ERR_ALLOC) {
+        return err;
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] bpm_acq_check_timed: "
+            "Could not subscribe to ACQ events. Falling back to polling\n");
+    return func_polling (self, ACQ_NAME_CHECK_DATA_ACQUIRE, service, NULL,
+            NULL, timeout);
+}
+
+bpm_client_err_e bpm_set_acq_trig (bpm_client_t *self, char *service,
+        uint32_t trig)
+{
+    return param_client_write (self, service, ACQ_OPCODE_CFG_TRIG, trig);
+}
+
+bpm_client_err_e bpm_get_acq_trig (bpm_client_t *self, char *service,
+        uint32_t *trig)
+{
+    return param_client_read (self, service, ACQ_OPCODE_CFG_TRIG, trig);
+}
+
+bpm_client_err_e bpm_set_acq_pingpong (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t pingpong)
+{
+    return param_client_write2 (self, service, ACQ_OPCODE_CFG_PINGPONG,
+            chan, pingpong);
+}
+
+bpm_client_err_e bpm_get_acq_pingpong (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t *pingpong)
+{
+    return param_client_write_read (self, service, ACQ_OPCODE_CFG_PINGPONG,
+            chan, pingpong);
+}
+
+bpm_client_err_e bpm_set_acq_pm (bpm_client_t *self, char *service,
+        uint32_t chan_mask)
+{
+    return param_client_write (self, service, ACQ_OPCODE_CFG_PM, chan_mask);
+}
+
+bpm_client_err_e bpm_get_acq_pm (bpm_client_t *self, char *service,
+        uint32_t *chan_mask)
+{
+    return param_client_read (self, service, ACQ_OPCODE_CFG_PM, chan_mask);
+}
+
+bpm_client_err_e bpm_set_acq_pstream (bpm_client_t *self, char *service,
+        uint32_t capacity)
+{
+    return param_client_write (self, service, ACQ_OPCODE_CFG_PSTREAM, capacity);
+}
+
+bpm_client_err_e bpm_get_acq_pstream (bpm_client_t *self, char *service,
+        uint32_t *capacity)
+{
+    return param_client_read (self, service, ACQ_OPCODE_CFG_PSTREAM, capacity);
+}
+
+bpm_client_err_e bpm_set_acq_mcast (bpm_client_t *self, char *service,
+        uint32_t chan_mask)
+{
+    return param_client_write (self, service, ACQ_OPCODE_CFG_MCAST, chan_mask);
+}
+
+bpm_client_err_e bpm_get_acq_mcast (bpm_client_t *self, char *service,
+        uint32_t *chan_mask)
+{
+    return param_client_read (self, service, ACQ_OPCODE_CFG_MCAST, chan_mask);
+}
+
+bpm_client_err_e bpm_acq_mcast_subscribe (bpm_client_t *self, char *service)
+{
+    assert (self);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    char *stream = hutils_concat_strings (service, ACQ_EVENT_STREAM_SUFFIX, ':');
+    ASSERT_ALLOC(stream, err_stream_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    /* Blocks go to a client of their own, so the completion events and
+     * the replies are not held behind them */
+    if (self->acq_mcast_client == NULL) {
+        self->acq_mcast_streams = zhashx_new ();
+        ASSERT_ALLOC(self->acq_mcast_streams, err_mcast_streams_alloc,
+                BPM_CLIENT_ERR_ALLOC);
+        zhashx_set_destructor (self->acq_mcast_streams,
+                (zhashx_destructor_fn *) zstr_free);
+        zhashx_set_duplicator (self->acq_mcast_streams,
+                (zhashx_duplicator_fn *) strdup);
+
+        self->acq_mcast_client = mlm_client_new ();
+        ASSERT_TEST(self->acq_mcast_client != NULL, "Could not create MLM "
+                "multicast client", err_mcast_client_alloc, BPM_CLIENT_ERR_ALLOC);
+
+        int rc = mlm_client_connect (self->acq_mcast_client, self->broker_endp,
+                BPMCLIENT_MLM_CONNECT_TIMEOUT, "");
+        ASSERT_TEST(rc >= 0, "Could not connect MLM multicast client to broker",
+                err_mcast_client_connect, BPM_CLIENT_ERR_ALLOC);
+
+        self->acq_mcast_poller = zpoller_new (
+                mlm_client_msgpipe (self->acq_mcast_client), NULL);
+        ASSERT_TEST(self->acq_mcast_poller != NULL, "Could not initialize "
+                "multicast poller", err_mcast_poller_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+
+    if (zhashx_lookup (self->acq_mcast_streams, stream) == NULL) {
+        int rc = mlm_client_set_consumer (self->acq_mcast_client, stream,
+                ACQ_EVENT_SUBJECT_DATA);
+        ASSERT_TEST(rc >= 0, "Could not subscribe to multicast blocks",
+                err_set_consumer, BPM_CLIENT_ERR_ALLOC);
+        zhashx_insert (self->acq_mcast_streams, stream, stream);
+    }
+
+    free (stream);
+    return err;
+
+err_mcast_poller_alloc:
+err_mcast_client_connect:
+    mlm_client_destroy (&self->acq_mcast_client);
+err_mcast_client_alloc:
+    zhashx_destroy (&self->acq_mcast_streams);
+err_mcast_streams_alloc:
+err_set_consumer:
+    free (stream);
+err_stream_alloc:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_mcast_recv (bpm_client_t *self,
+        smio_acq_mcast_hdr_t *hdr, void *data, uint32_t size, int timeout)
+{
+    assert (self);
+    assert (hdr);
+    assert (data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    zmsg_t *msg = NULL;
+    ASSERT_TEST(self->acq_mcast_client != NULL, "bpm_acq_mcast_recv: No "
+            "multicast blocks subscribed to", err_not_subscribed,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    void *which = zpoller_wait (self->acq_mcast_poller, timeout);
+    if (which == NULL) {
+        err = zpoller_terminated (self->acq_mcast_poller) ?
+            BPM_CLIENT_INT : BPM_CLIENT_ERR_TIMEOUT;
+        goto err_poller;
+    }
+
+    /* Message is:
+     * frame 0: smio_acq_mcast_hdr_t
+     * frame 1: data of the block */
+    msg = mlm_client_recv (self->acq_mcast_client);
+    ASSERT_TEST(msg != NULL && zmsg_size (msg) == 2, "bpm_acq_mcast_recv: "
+            "Unexpected multicast message", err_msg, BPM_CLIENT_ERR_MSG);
+
+    zframe_t *hdr_frame = zmsg_first (msg);
+    zframe_t *data_frame = zmsg_next (msg);
+    ASSERT_TEST(zframe_size (hdr_frame) == sizeof (*hdr), "bpm_acq_mcast_recv: "
+            "Unexpected multicast header", err_msg, BPM_CLIENT_ERR_MSG);
+    memcpy (hdr, zframe_data (hdr_frame), sizeof (*hdr));
+    ASSERT_TEST(zframe_size (data_frame) == hdr->size, "bpm_acq_mcast_recv: "
+            "Block size does not match its header", err_msg, BPM_CLIENT_ERR_MSG);
+    ASSERT_TEST(hdr->size <= size, "bpm_acq_mcast_recv: Block does not fit "
+            "in the buffer", err_msg, BPM_CLIENT_ERR_INV_PARAM);
+    memcpy (data, zframe_data (data_frame), hdr->size);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_mcast_recv: "
+            "Received %u bytes at offset %"PRIu64" of acquisition #%u of "
+            "channel %u from %s\n", hdr->size, hdr->offs, hdr->seq, hdr->chan,
+            mlm_client_address (self->acq_mcast_client));
+
+err_msg:
+    zmsg_destroy (&msg);
+err_poller:
+err_not_subscribed:
+    return err;
+}
+
+bpm_client_err_e bpm_acq_get_pm_info (bpm_client_t *self, char *service,
+        smio_acq_pm_info_t *info)
+{
+    assert (self);
+    assert (service);
+    assert (info);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_PM_INFO);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL,
+            (uint32_t *) info);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_acq_get_pm_info: Post-mortem "
+            "recorder state could not be read", err_get_pm_info,
+            BPM_CLIENT_ERR_SERVER);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_get_pm_info: "
+            "%u files recorded, %u failed, %u curves dropped\n", info->num_files,
+            info->num_failed, info->num_dropped);
+
+err_get_pm_info:
+    return err;
+}
+
+bpm_client_err_e bpm_set_acq_data_trig_pol (bpm_client_t *self, char *service,
+        uint32_t data_trig_pol)
+{
+    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_POL,
+            data_trig_pol);
+}
+
+bpm_client_err_e bpm_get_acq_data_trig_pol (bpm_client_t *self, char *service,
+        uint32_t *data_trig_pol)
+{
+    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_POL,
+            data_trig_pol);
+}
+
+bpm_client_err_e bpm_set_acq_data_trig_sel (bpm_client_t *self, char *service,
+        uint32_t data_trig_sel)
+{
+    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_SEL,
+            data_trig_sel);
+}
+
+bpm_client_err_e bpm_get_acq_data_trig_sel (bpm_client_t *self, char *service,
+        uint32_t *data_trig_sel)
+{
+    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_SEL,
+            data_trig_sel);
+}
+
+bpm_client_err_e bpm_set_acq_data_trig_filt (bpm_client_t *self, char *service,
+        uint32_t data_trig_filt)
+{
+    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_FILT,
+            data_trig_filt);
+}
+bpm_client_err_e bpm_get_acq_data_trig_filt (bpm_client_t *self, char *service,
+        uint32_t *data_trig_filt)
+{
+    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_FILT,
+            data_trig_filt);
+}
+
+bpm_client_err_e bpm_set_acq_data_trig_thres (bpm_client_t *self, char *service,
+        uint32_t data_trig_thres)
+{
+    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_THRES,
+            data_trig_thres);
+}
+
+bpm_client_err_e bpm_get_acq_data_trig_thres (bpm_client_t *self, char *service,
+        uint32_t *data_trig_thres)
+{
+    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_THRES,
+            data_trig_thres);
+}
+
+bpm_client_err_e bpm_set_acq_hw_trig_dly (bpm_client_t *self, char *service,
+        uint32_t hw_trig_dly)
+{
+    return param_client_write (self, service, ACQ_OPCODE_HW_TRIG_DLY,
+            hw_trig_dly);
+}
+
+bpm_client_err_e bpm_get_acq_hw_trig_dly (bpm_client_t *self, char *service,
+        uint32_t *hw_trig_dly)
+{
+    return param_client_read (self, service, ACQ_OPCODE_HW_TRIG_DLY,
+            hw_trig_dly);
+}
+
+bpm_client_err_e bpm_set_acq_sw_trig (bpm_client_t *self, char *service,
+        uint32_t sw_trig)
+{
+    return param_client_write (self, service, ACQ_OPCODE_SW_TRIG,
+            sw_trig);
+}
+
+bpm_client_err_e bpm_get_acq_sw_trig (bpm_client_t *self, char *service,
+        uint32_t *sw_trig)
+{
+    return param_client_read (self, service, ACQ_OPCODE_SW_TRIG,
+            sw_trig);
+}
+
+bpm_client_err_e bpm_set_acq_fsm_stop (bpm_client_t *self, char *service,
+        uint32_t fsm_stop)
+{
+    return param_client_write (self, service, ACQ_OPCODE_FSM_STOP,
+            fsm_stop);
+}
+
+bpm_client_err_e bpm_get_acq_fsm_stop (bpm_client_t *self, char *service,
+        uint32_t *fsm_stop)
+{
+    return param_client_read (self, service, ACQ_OPCODE_FSM_STOP,
+            fsm_stop);
+}
+
+bpm_client_err_e bpm_set_acq_data_trig_chan (bpm_client_t *self, char *service,
+        uint32_t data_trig_chan)
+{
+    return param_client_write (self, service, ACQ_OPCODE_HW_DATA_TRIG_CHAN,
+            data_trig_chan);
+}
+
+bpm_client_err_e bpm_get_acq_data_trig_chan (bpm_client_t *self, char *service,
+        uint32_t *data_trig_chan)
+{
+    return param_client_read (self, service, ACQ_OPCODE_HW_DATA_TRIG_CHAN,
+            data_trig_chan);
+}
+
+bpm_client_err_e bpm_set_acq_block_size_max (bpm_client_t *self, char *service,
+        uint32_t block_size_max)
+{
+    return param_client_write (self, service, ACQ_OPCODE_BLOCK_SIZE_MAX,
+            block_size_max);
+}
+
+bpm_client_err_e bpm_get_acq_block_size_max (bpm_client_t *self, char *service,
+        uint32_t *block_size_max)
+{
+    return param_client_read (self, service, ACQ_OPCODE_BLOCK_SIZE_MAX,
+            block_size_max);
+}
+
+static bpm_client_err_e _bpm_acq_start (bpm_client_t *self, char *service, acq_req_t *acq_req)
+{
+    assert (self);
+    assert (service);
+    assert (acq_req);
+
+    uint32_t write_val[4] = {0};
+    write_val[0] = acq_req->num_samples_pre;
+    write_val[1] = acq_req->num_samples_post;
+    write_val[2] = acq_req->num_shots;
+    write_val[3] = acq_req->chan;
+
+    _bpm_acq_prefetch_drop (self, service);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_DATA_ACQUIRE);
+    bpm_client_err_e err = bpm_func_exec(self, func, service, write_val, NULL);
+
+    /* Check if any error occurred */
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_data_acquire: Data acquire was "
+            "not requested correctly", err_data_acquire, BPM_CLIENT_ERR_AGAIN);
+
+    /* If we are here, then the request was successfully acquired*/
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_data_acquire: "
+            "Data acquire was successfully required\n");
+
+err_data_acquire:
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_check (bpm_client_t *self, char *service)
+{
+    assert (self);
+    assert (service);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_CHECK_DATA_ACQUIRE);
+    bpm_client_err_e err = bpm_func_exec(self, func, service, NULL, NULL);
+
+    if (err != BPM_CLIENT_SUCCESS) {
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] data acquisition "
+                "was not completed\n");
+    }
+    else {
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] data acquisition "
+                "was completed\n");
+    }
+
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_get_data_block (bpm_client_t *self, char *service, acq_trans_t *acq_trans)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    if (self->acq_codec != ACQ_CODEC_NONE || self->acq_crc) {
+        return _bpm_acq_get_data_block_coded (self, service, acq_trans, BLOCK_SIZE);
+    }
+
+    uint32_t write_val[2] = {0};
+    write_val[0] = acq_trans->req.chan;
+    write_val[1] = acq_trans->block.idx;
+
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: block required */
+
+    /* The data is copied straight from the reply to the user buffer */
+    bpm_func_reply_t reply;
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_DATA_BLOCK);
+    err = bpm_func_exec_view (self, func, service, write_val, &reply);
+
+    /* Message is:
+     * frame 0: error code
+     * frame 1: number of bytes read (optional)
+     * frame 2: data read (optional) */
+
+    /* Check if any error occurred */
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+            "bpm_get_data_block: Data block was not acquired",
+            err_get_data_block, BPM_CLIENT_ERR_SERVER);
+
+    err = _bpm_acq_copy_data_block (acq_trans, &reply);
+
+    /* Print some debug messages */
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_data_block: "
+            "read_size: %u\n", acq_trans->block.bytes_read);
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_data_block: "
+            "acq_trans->block.data: %p\n", acq_trans->block.data);
+
+err_get_data_block:
+    bpm_func_reply_release (&reply);
+    return err;
+}
+
+/* Copy the data of a "reply" laid out as smio_acq_data_block_t (or its _var
+ * variant) to the user buffer of "acq_trans" */
+static bpm_client_err_e _bpm_acq_copy_data_block (acq_trans_t *acq_trans,
+        const bpm_func_reply_t *reply)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    const size_t hdr_size = offsetof (smio_acq_data_block_t, data);
+
+    ASSERT_TEST(reply->data != NULL && reply->size >= hdr_size,
+            "Data block reply is too short", err_reply_size,
+            BPM_CLIENT_ERR_SERVER);
+
+    uint32_t valid_bytes;
+    memcpy (&valid_bytes, reply->data, sizeof (valid_bytes));
+
+    /* Data size effectively returned */
+    size_t read_size = reply->size - hdr_size;
+    if (read_size > valid_bytes) {
+        read_size = valid_bytes;
+    }
+    if (read_size > acq_trans->block.data_size) {
+        read_size = acq_trans->block.data_size;
+    }
+
+    /* Copy message contents to user */
+    memcpy (acq_trans->block.data, reply->data + hdr_size, read_size);
+
+    /* Inform user about the number of bytes effectively copied */
+    acq_trans->block.bytes_read = read_size;
+
+err_reply_size:
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_get_curve (bpm_client_t *self, char *service, acq_trans_t *acq_trans)
+{
+    assert (acq_trans);
+
+    if (_bpm_acq_prefetch_get (self, service, acq_trans)) {
+        return BPM_CLIENT_SUCCESS;
+    }
+
+    acq_trans->blocks_done = 0;
+    acq_trans->bytes_done = 0;
+    return _bpm_acq_get_curve_blocks (self, service, acq_trans);
+}
+
+/* Read the blocks of a curve from acq_trans->blocks_done on, appending them
+ * to the acq_trans->bytes_done bytes already read. Blocks are requested up
+ * to acq_block_retries more times, and the progress is kept if one still
+ * fails, so the read can be resumed */
+static bpm_client_err_e _bpm_acq_get_curve_blocks (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post;
+    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service,
+            acq_trans->req.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t n_max_samples = BLOCK_SIZE/sample_size;
+    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
+            "block_n_valid = %u\n", block_n_valid);
+
+    /* Save the original buffer for later */
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t *original_data_pt = acq_trans->block.data;
+
+    /* Fill the blocks not read yet */
+    for (uint32_t block_n = acq_trans->blocks_done; block_n <= block_n_valid;
+            block_n++) {
+        acq_trans->block.idx = block_n;
+        acq_trans->block.data = (uint32_t *) ((uint8_t *) original_data_pt +
+                acq_trans->bytes_done);
+        acq_trans->block.data_size = data_size - acq_trans->bytes_done;
+
+        for (uint32_t attempt = 0; ; ++attempt) {
+            if (zsys_interrupted) {
+                err = BPM_CLIENT_INT;
+                goto bpm_zsys_interrupted;
+            }
+
+            err = _bpm_acq_get_data_block (self, service, acq_trans);
+            if (err == BPM_CLIENT_SUCCESS || attempt >= self->acq_block_retries) {
+                break;
+            }
+
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] bpm_get_curve: "
+                    "Block %u failed, trying again (%u of %u)\n", block_n,
+                    attempt + 1, self->acq_block_retries);
+        }
+
+        /* Check for return code */
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+                "_bpm_get_data_block failed. block_n is probably out of range",
+                err_bpm_get_data_block);
+
+        acq_trans->bytes_done += acq_trans->block.bytes_read;
+        acq_trans->blocks_done = block_n + 1;
+
+        /* Print some debug messages */
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
+                "Total bytes read up to now: %u\n", acq_trans->bytes_done);
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
+                "Data buffer size left: %u\n", data_size - acq_trans->bytes_done);
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve: "
+            "Data curve of %u bytes was successfully acquired\n",
+            acq_trans->bytes_done);
+
+bpm_zsys_interrupted:
+err_bpm_get_data_block:
+    /* Return to client the total number of bytes read, up to now if the
+     * read is to be resumed */
+    acq_trans->block.bytes_read = acq_trans->bytes_done;
+    acq_trans->block.data_size = data_size;
+    acq_trans->block.data = original_data_pt;
+err_inv_chan:
+    return err;
+}
+
+static bpm_client_err_e _bpm_full_acq (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, int64_t timeout_us)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    _bpm_acq_prefetch_drop (self, service);
+
+    /* The server starts the acquisition, waits for it and streams the
+     * curve back, all in a single request */
+    bpm_client_err_e err = _bpm_acq_acquire_curve (self, service, acq_trans,
+            timeout_us);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not get requested curve",
+            err_acquire_curve, BPM_CLIENT_ERR_SERVER);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] "
+            "Data acquisition was successfully completed\n");
+
+err_acquire_curve:
+    return err;
+}
+
+/* Wrapper to be compatible with old function behavior */
+static bpm_client_err_e _bpm_full_acq_compat (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, int timeout, bool new_acq)
+{
+    if (new_acq) {
+        return _bpm_full_acq (self, service, acq_trans,
+                (timeout < 0) ? -1 : (int64_t) timeout*MSECS);
+    }
+    else {
+        return _bpm_acq_get_curve (self, service, acq_trans);
+    }
+}
+
+/* Get the channel map of an ACQ service. It is read from the server the
+ * first time and kept for the lifetime of the client, so the channels are
+ * the ones of the board the server runs on. Servers not exporting a valid
+ * channel map get the table of the board we were built for */
+static const smio_acq_chan_map_t *_bpm_acq_chan_map (bpm_client_t *self,
+        char *service)
+{
+    bpm_service_t *svc = _bpm_service_interned (self, service);
+    if (svc != NULL && svc->chan_map != NULL) {
+        return svc->chan_map;
+    }
+
+    smio_acq_chan_map_t *chan_map = (smio_acq_chan_map_t *) zhashx_lookup (
+            self->acq_chan_maps, service);
+    if (chan_map != NULL) {
+        if (svc != NULL) {
+            svc->chan_map = chan_map;
+        }
+        return chan_map;
+    }
+
+    chan_map = (smio_acq_chan_map_t *) zmalloc (sizeof *chan_map);
+    ASSERT_ALLOC(chan_map, err_chan_map_alloc);
+
+    bpm_client_err_e err = bpm_acq_get_chan_map (self, service, chan_map);
+    bool valid = (err == BPM_CLIENT_SUCCESS && chan_map->num_chans > 0 &&
+            chan_map->num_chans <= ACQ_CHAN_MAP_MAX_CHANS);
+    for (uint32_t i = 0; valid && i < chan_map->num_chans; ++i) {
+        valid = (chan_map->chans[i].sample_size != 0);
+    }
+
+    if (!valid) {
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] bpm_acq_chan_map: "
+                "Could not get a valid channel map from %s. Using the built-in "
+                "channel table\n", service);
+        memset (chan_map, 0, sizeof *chan_map);
+        chan_map->num_chans = END_CHAN_ID;
+        for (uint32_t i = 0; i < END_CHAN_ID; ++i) {
+            chan_map->chans[i].id = self->acq_chan[i].chan;
+            chan_map->chans[i].sample_size = self->acq_chan[i].sample_size;
+        }
+    }
+
+    int rc = zhashx_insert (self->acq_chan_maps, service, chan_map);
+    ASSERT_TEST(rc == 0, "Could not insert channel map into hash",
+            err_hash_insert);
+    if (svc != NULL) {
+        svc->chan_map = chan_map;
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_INFO, "[libclient] bpm_acq_chan_map: "
+            "%u channels on %s\n", chan_map->num_chans, service);
+
+    return chan_map;
+
+err_hash_insert:
+    free (chan_map);
+err_chan_map_alloc:
+    return NULL;
+}
+
+/* Sample size of channel "chan" of an ACQ service. 0 if the channel does
+ * not exist */
+static uint32_t _bpm_acq_sample_size (bpm_client_t *self, char *service,
+        uint32_t chan)
+{
+    const smio_acq_chan_map_t *chan_map = _bpm_acq_chan_map (self, service);
+    if (chan_map == NULL || chan >= chan_map->num_chans) {
+        return 0;
+    }
+
+    return chan_map->chans[chan].sample_size;
+}
+
+static acq_shm_map_t *_bpm_acq_shm_map (bpm_client_t *self, char *service)
+{
+    acq_shm_map_t *shm_map = (acq_shm_map_t *) zhashx_lookup (self->acq_shm_maps,
+            service);
+    if (shm_map != NULL) {
+        return shm_map;
+    }
+
+    char shm_name[ACQ_SHM_NAME_MAX_LEN];
+    int rc = snprintf (shm_name, sizeof (shm_name), "%s%s", ACQ_SHM_NAME_PREFIX,
+            service);
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (shm_name),
+           "Shared memory name is too long", err_shm_name);
+
+    int fd = shm_open (shm_name, O_RDONLY, 0);
+    ASSERT_TEST(fd >= 0, "Could not open shared memory object", err_shm_open);
+
+    struct stat shm_stat;
+    rc = fstat (fd, &shm_stat);
+    ASSERT_TEST(rc == 0 && shm_stat.st_size > 0, "Could not get shared memory size",
+            err_shm_stat);
+
+    void *base = mmap (NULL, shm_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ASSERT_TEST(base != MAP_FAILED, "Could not map shared memory region",
+            err_shm_mmap);
+    /* The mapping stays valid after closing the descriptor */
+    close (fd);
+
+    shm_map = (acq_shm_map_t *) zmalloc (sizeof *shm_map);
+    ASSERT_ALLOC(shm_map, err_shm_map_alloc);
+    shm_map->base = (uint8_t *) base;
+    shm_map->size = shm_stat.st_size;
+
+    rc = zhashx_insert (self->acq_shm_maps, service, shm_map);
+    ASSERT_TEST(rc == 0, "Could not insert shared memory map into hash",
+            err_hash_insert);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_INFO, "[libclient] bpm_acq_shm_map: "
+            "Mapped %s with %zu bytes\n", shm_name, shm_map->size);
+
+    return shm_map;
+
+err_hash_insert:
+    free (shm_map);
+err_shm_map_alloc:
+    munmap (base, shm_stat.st_size);
+    return NULL;
+err_shm_mmap:
+err_shm_stat:
+    close (fd);
+err_shm_open:
+err_shm_name:
+    return NULL;
+}
+
+static bpm_client_err_e _bpm_acq_get_data_block_shm (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t *seq)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    uint32_t write_val[2] = {0};
+    write_val[0] = acq_trans->req.chan;
+    write_val[1] = acq_trans->block.idx;
+
+    smio_acq_shm_desc_t read_val[1];
+
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: block required */
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_DATA_BLOCK_SHM);
+    err = bpm_func_exec(self, func, service, write_val, (uint32_t *) read_val);
+
+    /* Message is:
+     * frame 0: error code
+     * frame 1: number of bytes read (optional)
+     * frame 2: shared memory descriptor (optional) */
+
+    /* Check if any error occurred */
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+            "bpm_get_data_block_shm: Data block was not acquired",
+            err_get_data_block, BPM_CLIENT_ERR_SERVER);
+
+    /* Only map the region after the server had the chance to create it */
+    acq_shm_map_t *shm_map = _bpm_acq_shm_map (self, service);
+    ASSERT_TEST(shm_map != NULL, "bpm_get_data_block_shm: Could not map "
+            "shared memory region", err_get_data_block, BPM_CLIENT_ERR_SERVER);
+
+    ASSERT_TEST((size_t) read_val->offset + read_val->valid_bytes <= shm_map->size,
+            "bpm_get_data_block_shm: Descriptor is out of the shared memory region",
+            err_get_data_block, BPM_CLIENT_ERR_MSG);
+
+    /* Point the user to the data in place */
+    acq_trans->block.data = (uint32_t *) (shm_map->base + read_val->offset);
+    acq_trans->block.bytes_read = read_val->valid_bytes;
+    if (seq != NULL) {
+        *seq = read_val->seq;
+    }
+
+    /* Print some debug messages */
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_data_block_shm: "
+            "seq: %u, offset: %u, valid_bytes: %u\n", read_val->seq,
+            read_val->offset, read_val->valid_bytes);
+
+err_get_data_block:
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_get_curve_shm (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post;
+    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service,
+            acq_trans->req.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t n_max_samples = BLOCK_SIZE/sample_size;
+    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_shm: "
+            "block_n_valid = %u\n", block_n_valid);
+
+    /* Total bytes read */
+    uint32_t total_bread = 0;
+    uint32_t *curve_start = NULL;
+    uint32_t first_seq = 0;
+    uint32_t seq = 0;
+
+    /* Blocks are placed contiguously in the shared memory region,
+     * so we only need to ask the server to fill them */
+    for (uint32_t block_n = 0; block_n <= block_n_valid; block_n++) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        acq_trans->block.idx = block_n;
+        err = _bpm_acq_get_data_block_shm (self, service, acq_trans, &seq);
+
+        /* Check for return code */
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+                "_bpm_get_data_block_shm failed. block_n is probably out of range",
+                err_bpm_get_data_block);
+
+        if (block_n == 0) {
+            curve_start = acq_trans->block.data;
+            first_seq = seq;
+        }
+
+        /* A new acquisition was started in the meantime */
+        ASSERT_TEST(seq == first_seq, "bpm_get_curve_shm: Acquisition changed "
+                "while reading the curve", err_bpm_get_data_block,
+                BPM_CLIENT_ERR_AGAIN);
+
+        total_bread += acq_trans->block.bytes_read;
+
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_shm: "
+                "Total bytes read up to now: %u\n", total_bread);
+    }
+
+    /* Return to client the whole curve in place */
+    acq_trans->block.data = curve_start;
+    acq_trans->block.bytes_read = total_bread;
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_shm: "
+            "Data curve of %u bytes was successfully acquired\n", total_bread);
+
+bpm_zsys_interrupted:
+err_bpm_get_data_block:
+err_inv_chan:
+    return err;
+}
+
+/* Request the server to push "num_blocks" blocks starting at "block_start",
+ * through the broker or, if "peer" is set, through the direct data path.
+ * This does not wait for any reply */
+static bpm_client_err_e _bpm_acq_stream_grant (bpm_client_t *self, char *service,
+        uint32_t chan, uint32_t block_start, uint32_t num_blocks,
+        const smio_acq_direct_peer_t *peer)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    const disp_op_t* func = _bpm_func_translate (self, (peer == NULL) ?
+            ACQ_NAME_GET_CURVE_STREAM : ACQ_NAME_GET_CURVE_DIRECT);
+    ASSERT_TEST(func != NULL, "Could not find streaming function", err_func,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: first block
+     * frame 3: number of blocks
+     * frame 4: identity on the direct data path (direct transfers only) */
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, BPM_CLIENT_ERR_ALLOC);
+    zmsg_addmem (msg, &func->opcode, sizeof (func->opcode));
+    zmsg_addmem (msg, &chan, sizeof (chan));
+    zmsg_addmem (msg, &block_start, sizeof (block_start));
+    zmsg_addmem (msg, &num_blocks, sizeof (num_blocks));
+    if (peer != NULL) {
+        zmsg_addmem (msg, peer, sizeof (*peer));
+    }
+
+    int rc = bpm_client_sendto (self, service, NULL, NULL, 0, &msg, false);
+    ASSERT_TEST(rc == 0, "Could not send streaming request", err_send,
+            BPM_CLIENT_ERR_SERVER);
+
+err_send:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+err_func:
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_get_curve_stream (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    uint32_t chan = acq_trans->req.chan;
+    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post;
+    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service, chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t n_max_samples = BLOCK_SIZE/sample_size;
+    uint32_t num_blocks = num_samples_multishot / n_max_samples + 1;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_stream: "
+            "num_blocks = %u\n", num_blocks);
+
+    uint8_t *data = (uint8_t *) acq_trans->block.data;
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t total_bread = 0;
+    uint32_t next_block = 0;
+    uint32_t grants_pending = 0;
+    zmsg_t *report = NULL;
+
+    /* Keep a few grants in flight so the server always has work queued */
+    while (grants_pending < BPMCLIENT_ACQ_STREAM_GRANTS && next_block < num_blocks) {
+        uint32_t grant = num_blocks - next_block;
+        grant = (grant > ACQ_STREAM_MAX_BLOCKS) ? ACQ_STREAM_MAX_BLOCKS : grant;
+        err = _bpm_acq_stream_grant (self, service, chan, next_block, grant,
+                NULL);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not grant streaming credits",
+                err_grant);
+        next_block += grant;
+        grants_pending++;
+    }
+
+    while (grants_pending > 0) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        report = param_client_recv_timeout (self);
+        ASSERT_TEST(report != NULL, "Streamed block was not received", err_recv,
+                BPM_CLIENT_ERR_TIMEOUT);
+
+        size_t msg_size = zmsg_size (report);
+        if (msg_size == ACQ_STREAM_MSG_SIZE) {
+            err = _bpm_acq_stream_copy_block (report, data, data_size,
+                    &total_bread);
+            ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Malformed streamed block",
+                    err_msg_fmt);
+        }
+        else {
+            /* End of grant. Message is:
+             * frame 0: error code
+             * frame 1: number of bytes (optional)
+             * frame 2: number of blocks sent (optional) */
+            ASSERT_TEST(msg_size == MSG_ERR_CODE_SIZE || msg_size == MSG_FULL_SIZE,
+                    "Unexpected message received", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+            uint32_t reply_code = *(uint32_t *) zframe_data (zmsg_first (report));
+            ASSERT_TEST(reply_code == BPM_CLIENT_SUCCESS, "Server could not stream "
+                    "the requested blocks", err_msg_fmt, BPM_CLIENT_ERR_SERVER);
+
+            grants_pending--;
+            if (next_block < num_blocks) {
+                uint32_t grant = num_blocks - next_block;
+                grant = (grant > ACQ_STREAM_MAX_BLOCKS) ? ACQ_STREAM_MAX_BLOCKS : grant;
+                err = _bpm_acq_stream_grant (self, service, chan, next_block,
+                        grant, NULL);
+                ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not grant streaming "
+                        "credits", err_msg_fmt);
+                next_block += grant;
+                grants_pending++;
+            }
+        }
+
+        zmsg_destroy (&report);
+    }
+
+    acq_trans->block.bytes_read = total_bread;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_stream: "
+            "Data curve of %u bytes was successfully acquired\n", total_bread);
+
+    return err;
+
+err_msg_fmt:
+    zmsg_destroy (&report);
+err_recv:
+bpm_zsys_interrupted:
+err_grant:
+    /* Drain whatever the server still has queued for us */
+    while (grants_pending > 0 && (report = param_client_recv_timeout (self)) != NULL) {
+        if (zmsg_size (report) != ACQ_STREAM_MSG_SIZE) {
+            grants_pending--;
+        }
+        zmsg_destroy (&report);
+    }
+err_inv_chan:
+    return err;
+}
+
+/* Copy a streamed block in "report" to its place in "data", of "data_size"
+ * bytes, adding the number of bytes copied to "total_bread" */
+static bpm_client_err_e _bpm_acq_stream_copy_block (zmsg_t *report, uint8_t *data,
+        uint32_t data_size, uint32_t *total_bread)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* Message is:
+     * frame 0: stream header
+     * frame 1: data */
+    zframe_t *hdr_frm = zmsg_first (report);
+    zframe_t *data_frm = zmsg_next (report);
+    ASSERT_TEST(zframe_size (hdr_frm) == sizeof (smio_acq_stream_hdr_t),
+            "Malformed stream header", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+    smio_acq_stream_hdr_t *hdr = (smio_acq_stream_hdr_t *) zframe_data (hdr_frm);
+    ASSERT_TEST(hdr->valid_bytes == zframe_size (data_frm),
+            "Stream data size does not match header", err_msg_fmt,
+            BPM_CLIENT_ERR_MSG);
+
+    /* Blocks are all BLOCK_SIZE long, except for the last one */
+    uint64_t offset = (uint64_t) hdr->block_n * BLOCK_SIZE;
+    if (offset < data_size) {
+        uint32_t copy_size = (data_size - offset < hdr->valid_bytes) ?
+            data_size - offset : hdr->valid_bytes;
+        memcpy (data + offset, zframe_data (data_frm), copy_size);
+        *total_bread += copy_size;
+    }
+
+err_msg_fmt:
+    return err;
+}
+
+/* Acquire a curve with a single request. The server starts the acquisition,
+ * waits for it to complete within "timeout_us" and pushes the blocks back,
+ * as in streaming transfers, followed by the regular reply */
+static bpm_client_err_e _bpm_acq_acquire_curve (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans, int64_t timeout_us)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_ACQUIRE_CURVE);
+    ASSERT_TEST(func != NULL, "Could not find acquisition function", err_func,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* The server has msec resolution. Never round a timeout down to 0, as
+     * that means no timeout at all */
+    uint32_t timeout_ms = ACQ_ACQUIRE_CURVE_NO_TIMEOUT;
+    if (timeout_us >= 0) {
+        int64_t ms = (timeout_us + MSECS - 1) / MSECS;
+        timeout_ms = (ms < 1) ? 1 : (ms > UINT32_MAX) ? UINT32_MAX : (uint32_t) ms;
+    }
+
+    uint32_t write_val[5] = {0};
+    write_val[0] = acq_trans->req.num_samples_pre;
+    write_val[1] = acq_trans->req.num_samples_post;
+    write_val[2] = acq_trans->req.num_shots;
+    write_val[3] = acq_trans->req.chan;
+    write_val[4] = timeout_ms;
+
+    err = _bpm_func_exec_send (self, func, service, write_val, true,
+            bpm_func_sync_tracker_new (self), false);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not send acquisition request",
+            err_send);
+
+    /* Nothing arrives before the acquisition is over, so the first message
+     * is waited for as long as the acquisition itself, and then some */
+    int client_timeout = self->timeout;
+    if (client_timeout >= 0) {
+        int64_t wait = (timeout_us < 0) ? -1 : client_timeout + (int64_t) timeout_ms;
+        self->timeout = (wait < 0 || wait > INT32_MAX) ? -1 : (int) wait;
+    }
+
+    uint8_t *data = (uint8_t *) acq_trans->block.data;
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t total_bread = 0;
+    uint32_t blocks_sent = 0;
+    zmsg_t *report = NULL;
+
+    while (true) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        report = param_client_recv_timeout (self);
+        ASSERT_TEST(report != NULL, "Acquired curve was not received", err_recv,
+                BPM_CLIENT_ERR_TIMEOUT);
+
+        if (zmsg_size (report) != ACQ_STREAM_MSG_SIZE) {
+            break;
+        }
+
+        err = _bpm_acq_stream_copy_block (report, data, data_size, &total_bread);
+        zmsg_destroy (&report);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Malformed streamed block",
+                err_msg_fmt);
+    }
+
+    /* Regular reply. Message is:
+     * frame 0: error code
+     * frame 1: number of bytes
+     * frame 2: number of blocks sent */
+    err = _bpm_func_exec_reply (&report, (uint8_t *) &blocks_sent);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Server could not acquire the "
+            "requested curve", err_reply, BPM_CLIENT_ERR_SERVER);
+
+    acq_trans->block.bytes_read = total_bread;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_acquire_curve: "
+            "Data curve of %u bytes in %u blocks was successfully acquired\n",
+            total_bread, blocks_sent);
+
+err_reply:
+err_msg_fmt:
+err_recv:
+bpm_zsys_interrupted:
+    self->timeout = client_timeout;
+err_send:
+err_func:
+    return err;
+}
+
+/* Same as _bpm_acq_get_curve_stream, but the blocks come through the direct
+ * data path of the service. Since blocks and grant replies take different
+ * paths, the transfer is over when every grant was replied to and all of
+ * the blocks announced in the replies arrived */
+static bpm_client_err_e _bpm_acq_get_curve_direct (bpm_client_t *self, char *service,
+        acq_trans_t *acq_trans)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    uint32_t sample_size = _bpm_acq_sample_size (self, service,
+            acq_trans->req.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    zsock_t *direct_sock = _bpm_acq_direct_connect (self, service);
+    ASSERT_TEST(direct_sock != NULL, "Could not connect to the direct data path",
+            err_connect, BPM_CLIENT_ERR_SERVER);
+
+    /* Blocks left over from an aborted transfer */
+    while (zsock_events (direct_sock) & ZMQ_POLLIN) {
+        zmsg_t *stale = zmsg_recv (direct_sock);
+        zmsg_destroy (&stale);
+    }
+
+    zpoller_t *poller = zpoller_new (direct_sock,
+            mlm_client_msgpipe (self->mlm_client), NULL);
+    ASSERT_ALLOC(poller, err_poller_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    smio_acq_direct_peer_t peer;
+    memset (&peer, 0, sizeof (peer));
+    strncpy (peer.id, zuuid_str_canonical (self->uuid), sizeof (peer.id) - 1);
+
+    uint32_t chan = acq_trans->req.chan;
+    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post;
+    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
+    uint32_t n_max_samples = BLOCK_SIZE/sample_size;
+    uint32_t num_blocks = num_samples_multishot / n_max_samples + 1;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_direct: "
+            "num_blocks = %u\n", num_blocks);
+
+    uint8_t *data = (uint8_t *) acq_trans->block.data;
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t total_bread = 0;
+    uint32_t next_block = 0;
+    uint32_t grants_pending = 0;
+    uint32_t blocks_announced = 0;
+    uint32_t blocks_received = 0;
+    uint32_t retries = 0;
+    /* Until a block comes through, the server may not know about our
+     * connection yet, so a single grant is kept in flight */
+    bool peer_seen = false;
+    zmsg_t *report = NULL;
+
+    uint32_t grant = (num_blocks > ACQ_STREAM_MAX_BLOCKS) ? ACQ_STREAM_MAX_BLOCKS :
+        num_blocks;
+    err = _bpm_acq_stream_grant (self, service, chan, next_block, grant, &peer);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not grant direct transfer "
+            "credits", err_grant);
+    next_block += grant;
+    grants_pending++;
+
+    while (grants_pending > 0 || blocks_received < blocks_announced) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        void *which = zpoller_wait (poller, self->timeout);
+        ASSERT_TEST(which != NULL, "Direct transfer timed out", err_recv,
+                BPM_CLIENT_ERR_TIMEOUT);
+
+        if (which == direct_sock) {
+            report = zmsg_recv (direct_sock);
+            ASSERT_TEST(report != NULL, "Could not receive direct block", err_recv,
+                    BPM_CLIENT_ERR_SERVER);
+
+            /* Message is:
+             * frame 0: stream header
+             * frame 1: data */
+            ASSERT_TEST(zmsg_size (report) == ACQ_STREAM_MSG_SIZE,
+                    "Unexpected message received", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+            zframe_t *hdr_frm = zmsg_first (report);
+            zframe_t *data_frm = zmsg_next (report);
+            ASSERT_TEST(zframe_size (hdr_frm) == sizeof (smio_acq_stream_hdr_t),
+                    "Malformed stream header", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+            smio_acq_stream_hdr_t *hdr = (smio_acq_stream_hdr_t *) zframe_data (hdr_frm);
+            ASSERT_TEST(hdr->valid_bytes == zframe_size (data_frm),
+                    "Stream data size does not match header", err_msg_fmt,
+                    BPM_CLIENT_ERR_MSG);
+
+            /* Blocks are all BLOCK_SIZE long, except for the last one */
+            uint64_t offset = (uint64_t) hdr->block_n * BLOCK_SIZE;
+            if (offset < data_size) {
+                uint32_t copy_size = (data_size - offset < hdr->valid_bytes) ?
+                    data_size - offset : hdr->valid_bytes;
+                memcpy (data + offset, zframe_data (data_frm), copy_size);
+                total_bread += copy_size;
+            }
+            blocks_received++;
+            peer_seen = true;
+        }
+        else {
+            report = param_client_recv_timeout (self);
+            ASSERT_TEST(report != NULL, "Grant reply was not received", err_recv,
+                    BPM_CLIENT_ERR_TIMEOUT);
+
+            /* End of grant. Message is:
+             * frame 0: error code
+             * frame 1: number of bytes (optional)
+             * frame 2: number of blocks sent (optional) */
+            RW_REPLY_TYPE reply_code;
+            const uint8_t *reply_data;
+            size_t reply_size;
+            err = param_client_reply_parse (report, &reply_code, &reply_data,
+                    &reply_size);
+            ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Unexpected message received",
+                    err_msg_fmt);
+            grants_pending--;
+
+            if (reply_code == ACQ_PEER_UNREACH && !peer_seen &&
+                    retries < BPMCLIENT_ACQ_DIRECT_RETRIES) {
+                /* Our connection was not set up on the server side yet */
+                retries++;
+                zclock_sleep (BPMCLIENT_ACQ_DIRECT_RETRY_INTERVAL);
+                next_block -= grant;
+            }
+            else {
+                ASSERT_TEST(reply_code == BPM_CLIENT_SUCCESS && reply_data != NULL &&
+                        reply_size == sizeof (uint32_t), "Server could not push "
+                        "the requested blocks", err_msg_fmt, BPM_CLIENT_ERR_SERVER);
+                uint32_t blocks_sent;
+                memcpy (&blocks_sent, reply_data, sizeof (blocks_sent));
+                blocks_announced += blocks_sent;
+            }
+        }
+        zmsg_destroy (&report);
+
+        /* Keep a few grants in flight so the server always has work queued */
+        uint32_t max_grants = peer_seen ? BPMCLIENT_ACQ_STREAM_GRANTS : 1;
+        while (grants_pending < max_grants && next_block < num_blocks) {
+            grant = num_blocks - next_block;
+            grant = (grant > ACQ_STREAM_MAX_BLOCKS) ? ACQ_STREAM_MAX_BLOCKS : grant;
+            err = _bpm_acq_stream_grant (self, service, chan, next_block, grant,
+                    &peer);
+            ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not grant direct "
+                    "transfer credits", err_grant);
+            next_block += grant;
+            grants_pending++;
+        }
+    }
+
+    acq_trans->block.bytes_read = total_bread;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_direct: "
+            "Data curve of %u bytes was successfully acquired\n", total_bread);
+
+    zpoller_destroy (&poller);
+    return err;
+
+err_msg_fmt:
+    zmsg_destroy (&report);
+err_recv:
+bpm_zsys_interrupted:
+err_grant:
+    /* Drain the grant replies still queued for us. Blocks still in flight
+     * are dropped on the next transfer */
+    while (grants_pending > 0 && (report = param_client_recv_timeout (self)) != NULL) {
+        grants_pending--;
+        zmsg_destroy (&report);
+    }
+    zpoller_destroy (&poller);
+err_poller_alloc:
+err_connect:
+err_inv_chan:
+    return err;
+}
+
+/* Connect to the direct data path of the service, if not done already */
+static zsock_t *_bpm_acq_direct_connect (bpm_client_t *self, char *service)
+{
+    zsock_t *direct_sock = (zsock_t *) zhashx_lookup (self->acq_direct_socks,
+            service);
+    if (direct_sock != NULL) {
+        return direct_sock;
+    }
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_DIRECT_ENDP);
+    ASSERT_TEST(func != NULL, "Could not find direct data path function",
+            err_func);
+
+    smio_acq_direct_endp_t direct_endp;
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL,
+            (uint32_t *) &direct_endp);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not get the direct data path "
+            "endpoint", err_get_endp);
+    direct_endp.endp[sizeof (direct_endp.endp) - 1] = '\0';
+
+    direct_sock = zsock_new (ZMQ_DEALER);
+    ASSERT_TEST(direct_sock != NULL, "Could not create direct data path socket",
+            err_sock_alloc);
+    _bpm_sock_bufs_set (self, direct_sock);
+    /* The server routes the blocks to us by this identity */
+    zsock_set_identity (direct_sock, zuuid_str_canonical (self->uuid));
+    int rc = zsock_connect (direct_sock, "%s", direct_endp.endp);
+    ASSERT_TEST(rc == 0, "Could not connect to the direct data path",
+            err_sock_connect);
+
+    rc = zhashx_insert (self->acq_direct_socks, service, direct_sock);
+    ASSERT_TEST(rc == 0, "Could not keep the direct data path socket",
+            err_sock_connect);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_INFO, "[libclient] Connected to the "
+            "direct data path of %s at %s\n", service, direct_endp.endp);
+    return direct_sock;
+
+err_sock_connect:
+    zsock_destroy (&direct_sock);
+err_sock_alloc:
+err_get_endp:
+err_func:
+    return NULL;
+}
+
+static bpm_client_err_e _bpm_acq_get_curve_pipelined (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t window)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    window = (window == 0) ? 1 : window;
+
+    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post;
+    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service,
+            acq_trans->req.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t n_max_samples = BLOCK_SIZE/sample_size;
+    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_pipelined: "
+            "block_n_valid = %u, window = %u\n", block_n_valid, window);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_DATA_BLOCK);
+    ASSERT_TEST(func != NULL, "Could not find data block function", err_func,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* Replies from the same service are delivered in request order, so
+     * we only need a single buffer to receive them one at a time */
+    smio_acq_data_block_t *read_val = zmalloc (sizeof *read_val);
+    ASSERT_ALLOC(read_val, err_read_val_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    uint8_t *data = (uint8_t *) acq_trans->block.data;
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t total_bread = 0;
+    uint32_t next_block = 0;
+    uint32_t in_flight = 0;
+    uint32_t write_val[2] = {0};
+    write_val[0] = acq_trans->req.chan;
+
+    while (next_block <= block_n_valid || in_flight > 0) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        /* Keep the window full */
+        while (in_flight < window && next_block <= block_n_valid) {
+            write_val[1] = next_block;
+            err = _bpm_func_exec_send (self, func, service, write_val, true, NULL,
+                    false);
+            ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not request data block",
+                    err_send_block);
+            next_block++;
+            in_flight++;
+        }
+
+        err = _bpm_func_exec_recv (self, (uint8_t *) read_val);
+        in_flight--;
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+                "bpm_get_curve_pipelined: Data block was not acquired",
+                err_recv_block, BPM_CLIENT_ERR_SERVER);
+
+        uint32_t read_size = (data_size - total_bread < read_val->valid_bytes) ?
+            data_size - total_bread : read_val->valid_bytes;
+        memcpy (data + total_bread, read_val->data, read_size);
+        total_bread += read_size;
+
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_pipelined: "
+                "Total bytes read up to now: %u\n", total_bread);
+    }
+
+    /* Return to client the total number of bytes read */
+    acq_trans->block.bytes_read = total_bread;
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_pipelined: "
+            "Data curve of %u bytes was successfully acquired\n", total_bread);
+
+err_recv_block:
+err_send_block:
+bpm_zsys_interrupted:
+    /* Discard replies still in flight so they don't get mixed with the
+     * next request */
+    while (in_flight > 0) {
+        _bpm_func_exec_recv (self, (uint8_t *) read_val);
+        in_flight--;
+    }
+    free (read_val);
+err_read_val_alloc:
+err_func:
+err_inv_chan:
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_get_curve_cb (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t window,
+        bpm_acq_block_fp cb, void *arg)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (cb);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    window = (window == 0) ? 1 : window;
+
+    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post;
+    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service,
+            acq_trans->req.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t n_max_samples = BLOCK_SIZE/sample_size;
+    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_cb: "
+            "block_n_valid = %u, window = %u\n", block_n_valid, window);
+
+    const disp_op_t* func = _bpm_func_translate (self, ACQ_NAME_GET_DATA_BLOCK);
+    ASSERT_TEST(func != NULL, "Could not find data block function", err_func,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* Replies come in request order, as in _bpm_acq_get_curve_pipelined (),
+     * and each one is done with once the callback returns */
+    smio_acq_data_block_t *read_val = zmalloc (sizeof *read_val);
+    ASSERT_ALLOC(read_val, err_read_val_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    uint64_t total_bread = 0;
+    uint32_t next_block = 0;
+    uint32_t in_flight = 0;
+    uint32_t write_val[2] = {0};
+    write_val[0] = acq_trans->req.chan;
+    acq_trans->blocks_done = 0;
+
+    while (next_block <= block_n_valid || in_flight > 0) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        /* Keep the window full */
+        while (in_flight < window && next_block <= block_n_valid) {
+            write_val[1] = next_block;
+            err = _bpm_func_exec_send (self, func, service, write_val, true, NULL,
+                    false);
+            ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not request data block",
+                    err_send_block);
+            next_block++;
+            in_flight++;
+        }
+
+        err = _bpm_func_exec_recv (self, (uint8_t *) read_val);
+        in_flight--;
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+                "bpm_get_curve_cb: Data block was not acquired",
+                err_recv_block, BPM_CLIENT_ERR_SERVER);
+
+        uint32_t read_size = (read_val->valid_bytes > sizeof (read_val->data)) ?
+            sizeof (read_val->data) : read_val->valid_bytes;
+        int rc = cb (self, read_val->data, total_bread, read_size, arg);
+        ASSERT_TEST(rc == 0, "bpm_get_curve_cb: Transfer stopped by the callback",
+                err_cb_stop, BPM_CLIENT_ERR_AGAIN);
+        total_bread += read_size;
+        acq_trans->blocks_done++;
+
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_cb: "
+                "Total bytes read up to now: %"PRIu64"\n", total_bread);
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_cb: "
+            "Data curve of %"PRIu64" bytes was successfully acquired\n",
+            total_bread);
+
+err_cb_stop:
+err_recv_block:
+err_send_block:
+bpm_zsys_interrupted:
+    /* Discard replies still in flight so they don't get mixed with the
+     * next request */
+    while (in_flight > 0) {
+        _bpm_func_exec_recv (self, (uint8_t *) read_val);
+        in_flight--;
+    }
+    free (read_val);
+err_read_val_alloc:
+err_func:
+err_inv_chan:
+    return err;
+}
+
+/* read_val must be able to hold at least block_size bytes of data. The
+ * reduced variant is only used if some reduction was asked for, so this
+ * works with older servers otherwise */
+static bpm_client_err_e _bpm_acq_get_data_block_var (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size,
+        uint32_t atom_mask, uint32_t decim)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* Reduced blocks are small enough already */
+    if ((self->acq_codec != ACQ_CODEC_NONE || self->acq_crc) &&
+            atom_mask == ACQ_REDUCE_ATOM_MASK_ALL && decim == 1) {
+        return _bpm_acq_get_data_block_coded (self, service, acq_trans, block_size);
+    }
+
+    uint32_t write_val[5] = {0};
+    write_val[0] = acq_trans->req.chan;
+    write_val[1] = acq_trans->block.idx;
+    write_val[2] = block_size;
+    write_val[3] = atom_mask;
+    write_val[4] = decim;
+
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: block required
+     * frame 3: block size
+     * frame 4: atom mask (reduced only)
+     * frame 5: decimation factor (reduced only) */
+
+    const char *func_name = (atom_mask == ACQ_REDUCE_ATOM_MASK_ALL && decim == 1) ?
+        ACQ_NAME_GET_DATA_BLOCK_VAR : ACQ_NAME_GET_DATA_BLOCK_REDUCED;
+    /* The data is copied straight from the reply to the user buffer */
+    bpm_func_reply_t reply;
+    const disp_op_t* func = _bpm_func_translate (self, func_name);
+    err = bpm_func_exec_view (self, func, service, write_val, &reply);
+
+    /* Check if any error occurred */
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+            "bpm_get_data_block_var: Data block was not acquired",
+            err_get_data_block, BPM_CLIENT_ERR_SERVER);
+
+    err = _bpm_acq_copy_data_block (acq_trans, &reply);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_data_block_var: "
+            "read_size: %u\n", acq_trans->block.bytes_read);
+
+err_get_data_block:
+    bpm_func_reply_release (&reply);
+    return err;
+}
+
+/* Same as _bpm_acq_get_data_block_var, but the block is requested with the
+ * codec of the client and decoded, if the server encoded it. If asked for,
+ * it is checked against its CRC32C as well */
+static bpm_client_err_e _bpm_acq_get_data_block_coded (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint8_t *raw = NULL;
+
+    uint32_t write_val[4] = {0};
+    write_val[0] = acq_trans->req.chan;
+    write_val[1] = acq_trans->block.idx;
+    write_val[2] = block_size;
+    write_val[3] = self->acq_codec;
+
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: block required
+     * frame 3: block size
+     * frame 4: codec */
+
+    /* Only allocate what the server can send us back */
+    const size_t hdr_size = offsetof (smio_acq_data_block_coded_t, data);
+    const size_t crc_hdr_size = self->acq_crc ?
+        offsetof (smio_acq_data_block_crc_t, block) : 0;
+    uint8_t *reply_buf = zmalloc (crc_hdr_size + hdr_size + block_size);
+    ASSERT_ALLOC(reply_buf, err_read_val_alloc, BPM_CLIENT_ERR_ALLOC);
+    smio_acq_data_block_coded_t *read_val = (smio_acq_data_block_coded_t *)
+        (reply_buf + crc_hdr_size);
+
+    const disp_op_t* func = _bpm_func_translate (self, self->acq_crc ?
+            ACQ_NAME_GET_DATA_BLOCK_CRC : ACQ_NAME_GET_DATA_BLOCK_CODED);
+    err = bpm_func_exec(self, func, service, write_val, (uint32_t *) reply_buf);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+            "bpm_get_data_block_coded: Data block was not acquired",
+            err_get_data_block, BPM_CLIENT_ERR_SERVER);
+
+    if (self->acq_crc) {
+        const smio_acq_data_block_crc_t *crc_val =
+            (const smio_acq_data_block_crc_t *) reply_buf;
+        ASSERT_TEST(read_val->valid_bytes <= block_size,
+                "bpm_get_data_block_coded: Data block is too large",
+                err_get_data_block, BPM_CLIENT_ERR_MSG);
+        uint32_t crc = hutils_crc32c (0, read_val, hdr_size + read_val->valid_bytes);
+        ASSERT_TEST(crc == crc_val->crc,
+                "bpm_get_data_block_coded: Data block CRC does not match",
+                err_get_data_block, BPM_CLIENT_ERR_MSG);
+    }
+
+    uint32_t read_size = (acq_trans->block.data_size < read_val->raw_bytes) ?
+        acq_trans->block.data_size : read_val->raw_bytes;
+
+    if (read_val->codec == ACQ_CODEC_NONE) {
+        memcpy (acq_trans->block.data, read_val->data, read_size);
+    }
+    else {
+        /* Decode straight to the user buffer, unless it is too small */
+        raw = (read_size == read_val->raw_bytes) ? (uint8_t *) acq_trans->block.data :
+            zmalloc (read_val->raw_bytes);
+        ASSERT_ALLOC(raw, err_get_data_block, BPM_CLIENT_ERR_ALLOC);
+
+        ssize_t raw_bytes = -1;
+        if (read_val->codec == ACQ_CODEC_DELTA) {
+            raw_bytes = hutils_codec_delta_decode (raw, read_val->raw_bytes,
+                    read_val->data, read_val->valid_bytes, read_val->atom_size,
+                    ACQ_REDUCE_NUM_ATOMS);
+        }
+        else if (read_val->codec == ACQ_CODEC_SCALED16 &&
+                read_val->atom_size == sizeof (uint32_t)) {
+            raw_bytes = hutils_codec_scaled16_decode (raw, read_val->raw_bytes,
+                    read_val->data, read_val->valid_bytes, ACQ_REDUCE_NUM_ATOMS);
+        }
+        ASSERT_TEST(raw_bytes == read_val->raw_bytes,
+                "bpm_get_data_block_coded: Data block could not be decoded",
+                err_decode, BPM_CLIENT_ERR_SERVER);
+
+        if (raw != (uint8_t *) acq_trans->block.data) {
+            memcpy (acq_trans->block.data, raw, read_size);
+        }
+    }
+
+    /* Inform user about the number of bytes effectively copied */
+    acq_trans->block.bytes_read = read_size;
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_data_block_coded: "
+            "read_size: %u, received: %u, codec: %u\n", read_size,
+            read_val->valid_bytes, read_val->codec);
+
+err_decode:
+    if (raw != (uint8_t *) acq_trans->block.data) {
+        free (raw);
+    }
+err_get_data_block:
+    free (reply_buf);
+err_read_val_alloc:
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_get_data_block_sized (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size,
+        uint32_t atom_mask, uint32_t decim)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    return _bpm_acq_get_data_block_var (self, service, acq_trans, block_size,
+            atom_mask, decim);
+}
+
+static bpm_client_err_e _bpm_acq_get_curve_sized (bpm_client_t *self,
+        char *service, acq_trans_t *acq_trans, uint32_t block_size,
+        uint32_t atom_mask, uint32_t decim)
+{
+    assert (self);
+    assert (service);
+    assert (acq_trans);
+    assert (acq_trans->block.data);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    uint32_t num_samples_shot = acq_trans->req.num_samples_pre +
+        acq_trans->req.num_samples_post;
+    uint32_t num_samples_multishot = num_samples_shot*acq_trans->req.num_shots;
+    uint32_t sample_size = _bpm_acq_sample_size (self, service,
+            acq_trans->req.chan);
+    ASSERT_TEST(sample_size != 0, "Invalid channel", err_inv_chan,
+            BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t n_max_samples = block_size/sample_size;
+    ASSERT_TEST(n_max_samples > 0, "Block size is smaller than a sample",
+            err_inv_block_size, BPM_CLIENT_ERR_INV_PARAM);
+    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
+    /* When the last block is full 'block_n_valid' exceeds by one */
+    if (block_n_valid != 0 && (num_samples_multishot % n_max_samples) == 0) {
+        block_n_valid--;
+    }
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_sized: "
+            "block_n_valid = %u, block_size = %u\n", block_n_valid, block_size);
+
+    /* Total bytes read */
+    uint32_t total_bread = 0;
+    /* Save the original buffer size for later */
+    uint32_t data_size = acq_trans->block.data_size;
+    uint32_t *original_data_pt = acq_trans->block.data;
+
+    /* Fill all blocks */
+    for (uint32_t block_n = 0; block_n <= block_n_valid; block_n++) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        acq_trans->block.idx = block_n;
+        err = _bpm_acq_get_data_block_var (self, service, acq_trans, block_size,
+                atom_mask, decim);
+
+        /* Check for return code */
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS,
+                "_bpm_get_data_block_var failed. block_n is probably out of range",
+                err_bpm_get_data_block);
+
+        total_bread += acq_trans->block.bytes_read;
+        acq_trans->block.data = (uint32_t *)((uint8_t *)acq_trans->block.data + acq_trans->block.bytes_read);
+        acq_trans->block.data_size -= acq_trans->block.bytes_read;
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_curve_sized: "
+            "Data curve of %u bytes was successfully acquired\n", total_bread);
+
+bpm_zsys_interrupted:
+err_bpm_get_data_block:
+    /* Return to client the total number of bytes read */
+    acq_trans->block.bytes_read = total_bread;
+    acq_trans->block.data_size = data_size;
+    acq_trans->block.data = original_data_pt;
+err_inv_block_size:
+err_inv_chan:
+    return err;
+}
+
+/* Subscribe to the ACQ event stream of the specified service, connecting to
+ * the broker on the first call. The stream name is returned in "stream" and
+ * is owned by the caller */
+static bpm_client_err_e _bpm_acq_event_subscribe (bpm_client_t *self,
+        char *service, char **stream)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    *stream = hutils_concat_strings (service, ACQ_EVENT_STREAM_SUFFIX, ':');
+    ASSERT_ALLOC(*stream, err_stream_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    /* Events go to a separate client, so they are not mixed up with
+     * the replies received by the main one */
+    if (self->acq_event_client == NULL) {
+        self->acq_event_client = mlm_client_new ();
+        ASSERT_TEST(self->acq_event_client != NULL, "Could not create MLM event client",
+                err_event_client_alloc, BPM_CLIENT_ERR_ALLOC);
+
+        int rc = mlm_client_connect (self->acq_event_client, self->broker_endp,
+                BPMCLIENT_MLM_CONNECT_TIMEOUT, "");
+        ASSERT_TEST(rc >= 0, "Could not connect MLM event client to broker",
+                err_event_client_connect, BPM_CLIENT_ERR_ALLOC);
+
+        self->acq_event_poller = zpoller_new (
+                mlm_client_msgpipe (self->acq_event_client), NULL);
+        ASSERT_TEST(self->acq_event_poller != NULL, "Could not initialize event poller",
+                err_event_poller_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+
+    if (zhashx_lookup (self->acq_event_streams, *stream) == NULL) {
+        int rc = mlm_client_set_consumer (self->acq_event_client, *stream,
+                ACQ_EVENT_SUBJECT_DONE);
+        ASSERT_TEST(rc >= 0, "Could not subscribe to ACQ event stream",
+                err_set_consumer, BPM_CLIENT_ERR_ALLOC);
+        zhashx_insert (self->acq_event_streams, *stream, *stream);
+    }
+
+    return err;
+
+err_event_poller_alloc:
+err_event_client_connect:
+    mlm_client_destroy (&self->acq_event_client);
+err_event_client_alloc:
+err_set_consumer:
+    free (*stream);
+    *stream = NULL;
+err_stream_alloc:
+    return err;
+}
+
+/* Subscribe to the trigger events of "stream", already subscribed to with
+ * _bpm_acq_event_subscribe (), as well. The other waits take them as any
+ * other event of the stream, confirmed with a status check */
+static bpm_client_err_e _bpm_acq_trig_subscribe (bpm_client_t *self,
+        char *stream)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* Kept along with the streams, as "<stream>:ACQ_TRIG" */
+    char *key = hutils_concat_strings (stream, ACQ_EVENT_SUBJECT_TRIG, ':');
+    ASSERT_ALLOC(key, err_key_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    if (zhashx_lookup (self->acq_event_streams, key) == NULL) {
+        int rc = mlm_client_set_consumer (self->acq_event_client, stream,
+                ACQ_EVENT_SUBJECT_TRIG);
+        ASSERT_TEST(rc >= 0, "Could not subscribe to ACQ trigger events",
+                err_set_consumer, BPM_CLIENT_ERR_ALLOC);
+        zhashx_insert (self->acq_event_streams, key, key);
+    }
+
+err_set_consumer:
+    free (key);
+err_key_alloc:
+    return err;
+}
+
+static bpm_client_err_e _bpm_acq_wait_event (bpm_client_t *self, char *service,
+        int timeout)
+{
+    assert (self);
+    assert (service);
+
+    char *stream = NULL;
+    bpm_client_err_e err = _bpm_acq_event_subscribe (self, service, &stream);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not subscribe to ACQ events",
+            err_subscribe);
+
+    /* timeout < 0 means "infinite" wait */
+    int64_t deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+
+    /* The acquisition might have completed before we subscribed. Events from
+     * previous acquisitions might still be queued as well, so every event
+     * is confirmed with a single status check */
+    err = _bpm_acq_check (self, service);
+    while (err != BPM_CLIENT_SUCCESS) {
+        int wait = -1;
+        if (deadline >= 0) {
+            int64_t remaining = deadline - zclock_mono ();
+            if (remaining <= 0) {
+                err = BPM_CLIENT_ERR_TIMEOUT;
+                goto err_timeout;
+            }
+            wait = (int) remaining;
+        }
+
+        void *which = zpoller_wait (self->acq_event_poller, wait);
+        if (which == NULL) {
+            err = zpoller_terminated (self->acq_event_poller) ?
+                BPM_CLIENT_INT : BPM_CLIENT_ERR_TIMEOUT;
+            goto err_poller;
+        }
+
+        zmsg_t *msg = mlm_client_recv (self->acq_event_client);
+        const char *address = mlm_client_address (self->acq_event_client);
+        bool ours = streq (address, stream);
+        _bpm_acq_prefetch_event (self, address, msg);
+        zmsg_destroy (&msg);
+
+        if (!ours) {
+            continue;
+        }
+
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_acq_wait_event: "
+                "Received completion event from %s\n", stream);
+        err = _bpm_acq_check (self, service);
+    }
+
+err_poller:
+err_timeout:
+    free (stream);
+err_subscribe:
+    return err;
+}
+
+/**************** DSP SMIO Functions ****************/
+
+/* Kx functions */
+PARAM_FUNC_CLIENT_WRITE(kx)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_KX, kx);
+}
+
+PARAM_FUNC_CLIENT_READ(kx)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_KX, kx);
+}
+
+/* Ky functions */
+PARAM_FUNC_CLIENT_WRITE(ky)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_KY, ky);
+}
+
+PARAM_FUNC_CLIENT_READ(ky)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_KY, ky);
+}
+
+/* Ksum functions */
+PARAM_FUNC_CLIENT_WRITE(ksum)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_KSUM, ksum);
+}
+
+PARAM_FUNC_CLIENT_READ(ksum)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_KSUM, ksum);
+}
+
+/* Delta/Sigma TBT threshold calculation functions */
+PARAM_FUNC_CLIENT_WRITE(ds_tbt_thres)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_DS_TBT_THRES, ds_tbt_thres);
+}
+
+PARAM_FUNC_CLIENT_READ(ds_tbt_thres)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_DS_TBT_THRES, ds_tbt_thres);
+}
+
+/* Delta/Sigma FOFB threshold calculation functions */
+PARAM_FUNC_CLIENT_WRITE(ds_fofb_thres)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_DS_FOFB_THRES, ds_fofb_thres);
+}
+
+PARAM_FUNC_CLIENT_READ(ds_fofb_thres)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_DS_FOFB_THRES, ds_fofb_thres);
+}
+
+/* Delta/Sigma MONIT. threshold calculation functions */
+PARAM_FUNC_CLIENT_WRITE(ds_monit_thres)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_DS_MONIT_THRES, ds_monit_thres);
+}
+
+PARAM_FUNC_CLIENT_READ(ds_monit_thres)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_DS_MONIT_THRES, ds_monit_thres);
+}
+
+/* Monitoring Amplitude channel 0 value */
+PARAM_FUNC_CLIENT_WRITE(monit_amp_ch0)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH0, monit_amp_ch0);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_amp_ch0)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH0, monit_amp_ch0);
+}
+
+/* Monitoring Amplitude channel 1 value */
+PARAM_FUNC_CLIENT_WRITE(monit_amp_ch1)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH1, monit_amp_ch1);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_amp_ch1)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH1, monit_amp_ch1);
+}
+
+/* Monitoring Amplitude channel 2 value */
+PARAM_FUNC_CLIENT_WRITE(monit_amp_ch2)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH2, monit_amp_ch2);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_amp_ch2)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH2, monit_amp_ch2);
+}
+
+/* Monitoring Amplitude channel 3 value */
+PARAM_FUNC_CLIENT_WRITE(monit_amp_ch3)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH3, monit_amp_ch3);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_amp_ch3)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_AMP_CH3, monit_amp_ch3);
+}
+
+/* Monitoring Position X value */
+PARAM_FUNC_CLIENT_WRITE(monit_pos_x)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_X, monit_pos_x);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_pos_x)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_X, monit_pos_x);
+}
+
+/* Monitoring Position Y value */
+PARAM_FUNC_CLIENT_WRITE(monit_pos_y)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Y, monit_pos_y);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_pos_y)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Y, monit_pos_y);
+}
+
+/* Monitoring Position Q value */
+PARAM_FUNC_CLIENT_WRITE(monit_pos_q)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Q, monit_pos_q);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_pos_q)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_Q, monit_pos_q);
+}
+
+/* Monitoring Position Sum value */
+PARAM_FUNC_CLIENT_WRITE(monit_pos_sum)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POS_SUM, monit_pos_sum);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_pos_sum)
+{
+     return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POS_SUM, monit_pos_sum);
+}
+
+/* Monitoring Update value */
+PARAM_FUNC_CLIENT_WRITE(monit_updt)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_UPDT, monit_updt);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_updt)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_UPDT, monit_updt);
+}
+
+/* Monitoring stream period */
+PARAM_FUNC_CLIENT_WRITE(monit_poll_time)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_POLL_TIME,
+            monit_poll_time);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_poll_time)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_POLL_TIME,
+            monit_poll_time);
+}
+
+/* Monitoring stream encodings */
+PARAM_FUNC_CLIENT_WRITE(monit_enc)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_MONIT_ENC,
+            monit_enc);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_enc)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_MONIT_ENC,
+            monit_enc);
+}
+
+/* Software trigger on the monitoring stream */
+bpm_client_err_e bpm_set_monit_trig (bpm_client_t *self, char *service,
+        smio_dsp_trig_t *trig)
+{
+    assert (self);
+    assert (service);
+    assert (trig);
+
+    uint32_t rw = WRITE_MODE;
+    bpm_client_err_e err = param_client_write_gen (self, service,
+            DSP_OPCODE_SET_GET_TRIG, rw, trig, sizeof (*trig), NULL, 0);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_set_monit_trig: Software "
+            "trigger could not be set", err_set_trig);
+
+err_set_trig:
+    return err;
+}
+
+bpm_client_err_e bpm_get_monit_trig (bpm_client_t *self, char *service,
+        smio_dsp_trig_t *trig)
+{
+    assert (self);
+    assert (service);
+    assert (trig);
+
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, DSP_OPCODE_SET_GET_TRIG,
+            rw, trig, sizeof (*trig), NULL, 0, trig, sizeof (*trig));
+}
+
+PARAM_FUNC_CLIENT_WRITE(monit_trig_count)
+{
+    return param_client_write (self, service, DSP_OPCODE_SET_GET_TRIG_COUNT,
+            monit_trig_count);
+}
+
+PARAM_FUNC_CLIENT_READ(monit_trig_count)
+{
+    return param_client_read (self, service, DSP_OPCODE_SET_GET_TRIG_COUNT,
+            monit_trig_count);
+}
+
+/* Downsampled monitoring streams */
+bpm_client_err_e bpm_set_monit_ds (bpm_client_t *self, char *service,
+        smio_dsp_monit_ds_t *monit_ds)
+{
+    assert (self);
+    assert (service);
+    assert (monit_ds);
+
+    uint32_t rw = WRITE_MODE;
+    bpm_client_err_e err = param_client_write_gen (self, service,
+            DSP_OPCODE_SET_GET_MONIT_DS, rw, monit_ds, sizeof (*monit_ds), NULL, 0);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_set_monit_ds: Downsampled "
+            "streams could not be set", err_set_monit_ds);
+
+err_set_monit_ds:
+    return err;
+}
+
+bpm_client_err_e bpm_get_monit_ds (bpm_client_t *self, char *service,
+        smio_dsp_monit_ds_t *monit_ds)
+{
+    assert (self);
+    assert (service);
+    assert (monit_ds);
+
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, DSP_OPCODE_SET_GET_MONIT_DS,
+            rw, monit_ds, sizeof (*monit_ds), NULL, 0, monit_ds, sizeof (*monit_ds));
+}
+
+/* Monitoring snapshot */
+bpm_client_err_e bpm_get_monit_snapshot (bpm_client_t *self, char *service,
+        uint32_t updt, smio_dsp_monit_t *monit)
+{
+    assert (self);
+    assert (service);
+    assert (monit);
+
+    uint32_t write_val[1] = {0};
+    write_val[0] = updt;
+
+    const disp_op_t* func = _bpm_func_translate (self, DSP_NAME_GET_MONIT_SNAPSHOT);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) monit);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_get_monit_snapshot: Monitoring "
+            "values could not be read", err_get_monit_snapshot,
+            BPM_CLIENT_ERR_SERVER);
+
+err_get_monit_snapshot:
+    return err;
+}
+
+bpm_client_err_e bpm_get_monit_snapshot_multi (bpm_client_t *self, char **services,
+        size_t num_services, uint32_t updt, smio_dsp_monit_t *monits,
+        bpm_client_err_e *errs, int timeout)
+{
+    assert (self);
+    assert (services);
+    assert (monits);
+
+    uint32_t write_val[1] = {0};
+    write_val[0] = updt;
+
+    const disp_op_t* func = _bpm_func_translate (self, DSP_NAME_GET_MONIT_SNAPSHOT);
+    return bpm_func_exec_multi (self, func, services, num_services, write_val,
+            monits, sizeof (*monits), errs, timeout);
+}
+
+bpm_client_err_e bpm_get_monit_history (bpm_client_t *self, char *service,
+        uint32_t by, uint64_t since, smio_dsp_monit_hist_t *hist)
+{
+    assert (self);
+    assert (service);
+    assert (hist);
+
+    /* Sent Message is:
+     * frame 0: operation code
+     * frame 1: DSP_MONIT_HIST_SINCE_SEQ or DSP_MONIT_HIST_SINCE_TS
+     * frame 2: sequence number or timestamp (64-bit) */
+    uint32_t write_val[3] = {0};
+    uint8_t *write_p = (uint8_t *) write_val;
+    memcpy (write_p, &by, sizeof (by));
+    write_p += sizeof (by);
+    memcpy (write_p, &since, sizeof (since));
+
+    const disp_op_t* func = _bpm_func_translate (self, DSP_NAME_GET_MONIT_HISTORY);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, write_val,
+            (uint32_t *) hist);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_get_monit_history: Monitoring "
+            "history could not be read", err_get_monit_history,
+            BPM_CLIENT_ERR_SERVER);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_get_monit_history: "
+            "%u records read\n", hist->num_records);
+
+err_get_monit_history:
+    return err;
+}
+
+/* Monitoring stream */
+static bpm_client_err_e _bpm_monit_subscribe (bpm_client_t *self, char *service,
+        const char *subject)
+{
+    assert (self);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    char *stream = hutils_concat_strings (service, DSP_MONIT_STREAM_SUFFIX, ':');
+    ASSERT_ALLOC(stream, err_stream_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    /* Monitoring data goes to a separate client, so it is not mixed up with
+     * replies or ACQ events */
+    if (self->monit_client == NULL) {
+        self->monit_client = mlm_client_new ();
+        ASSERT_TEST(self->monit_client != NULL, "Could not create MLM monitoring client",
+                err_monit_client_alloc, BPM_CLIENT_ERR_ALLOC);
+
+        int rc = mlm_client_connect (self->monit_client, self->broker_endp,
+                BPMCLIENT_MLM_CONNECT_TIMEOUT, "");
+        ASSERT_TEST(rc >= 0, "Could not connect MLM monitoring client to broker",
+                err_monit_client_connect, BPM_CLIENT_ERR_ALLOC);
+
+        self->monit_poller = zpoller_new (mlm_client_msgpipe (self->monit_client),
+                NULL);
+        ASSERT_TEST(self->monit_poller != NULL, "Could not initialize monitoring poller",
+                err_monit_poller_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+
+    int rc = mlm_client_set_consumer (self->monit_client, stream, subject);
+    ASSERT_TEST(rc >= 0, "Could not subscribe to monitoring stream",
+            err_set_consumer, BPM_CLIENT_ERR_ALLOC);
+
+    free (stream);
+    return err;
+
+err_monit_poller_alloc:
+err_monit_client_connect:
+    mlm_client_destroy (&self->monit_client);
+err_monit_client_alloc:
+err_set_consumer:
+    free (stream);
+err_stream_alloc:
+    return err;
+}
+
+bpm_client_err_e bpm_monit_subscribe (bpm_client_t *self, char *service)
+{
+    return _bpm_monit_subscribe (self, service, DSP_MONIT_SUBJECT_DATA);
+}
+
+bpm_client_err_e bpm_monit_subscribe_delta (bpm_client_t *self, char *service)
+{
+    assert (self);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    if (self->monit_decoders == NULL) {
+        self->monit_decoders = zhashx_new ();
+        ASSERT_ALLOC(self->monit_decoders, err_monit_decoders_alloc,
+                BPM_CLIENT_ERR_ALLOC);
+        zhashx_set_destructor (self->monit_decoders, _monit_decoder_destroy);
+    }
+
+    err = _bpm_monit_subscribe (self, service, DSP_MONIT_SUBJECT_DELTA);
+
+err_monit_decoders_alloc:
+    return err;
+}
+
+bpm_client_err_e bpm_monit_subscribe_ds (bpm_client_t *self, char *service,
+        uint32_t ds)
+{
+    assert (self);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    ASSERT_TEST(ds < DSP_MONIT_DS_MAX, "Invalid downsampled monitoring stream",
+            err_inv_ds, BPM_CLIENT_ERR_INV_PARAM);
+
+    char subject [DSP_MONIT_SUBJECT_DS_MAX_LEN];
+    snprintf (subject, sizeof (subject), DSP_MONIT_SUBJECT_DS_PREFIX "%u", ds);
+    err = _bpm_monit_subscribe (self, service, subject);
+
+err_inv_ds:
+    return err;
+}
+
+/* Apply the delta encoded update "frame" of "stream" to its decoder,
+ * writing the decoded update to "monit". Returns BPM_CLIENT_ERR_AGAIN if
+ * the update cannot be decoded yet, as an earlier one was missed and no
+ * keyframe arrived since */
+static bpm_client_err_e _bpm_monit_delta_decode (bpm_client_t *self,
+        const char *stream, zframe_t *frame, smio_dsp_monit_t *monit)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    const uint8_t *data = zframe_data (frame);
+    size_t size = zframe_size (frame);
+
+    ASSERT_TEST(self->monit_decoders != NULL && size > DSP_MONIT_DELTA_HDR_SIZE,
+            "Malformed delta encoded monitoring data", err_msg_size,
+            BPM_CLIENT_ERR_SERVER);
+
+    bpm_monit_decoder_t *decoder = zhashx_lookup (self->monit_decoders, stream);
+    if (decoder == NULL) {
+        decoder = zmalloc (sizeof (*decoder));
+        ASSERT_ALLOC(decoder, err_decoder_alloc, BPM_CLIENT_ERR_ALLOC);
+        int rc = zhashx_insert (self->monit_decoders, stream, decoder);
+        ASSERT_TEST(rc == 0, "Could not insert monitoring decoder",
+                err_decoder_insert, BPM_CLIENT_ERR_ALLOC);
+    }
+
+    bool keyframe = (data [0] & DSP_MONIT_DELTA_KEYFRAME) != 0;
+    uint8_t count = data [1];
+    if (keyframe) {
+        memset (&decoder->last, 0, sizeof (decoder->last));
+    }
+    else if (!decoder->valid || count != (uint8_t) (decoder->count + 1)) {
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] Monitoring "
+                "update of %s missed, waiting for a keyframe\n", stream);
+        decoder->valid = false;
+        err = BPM_CLIENT_ERR_AGAIN;
+        goto err_missed;
+    }
+
+    /* smio_dsp_monit_t is made of 32-bit words only */
+    uint32_t fields [DSP_MONIT_NUM_FIELDS];
+    memcpy (fields, &decoder->last, sizeof (fields));
+    ssize_t consumed = hutils_codec_fields_decode (fields, DSP_MONIT_NUM_FIELDS,
+            data + DSP_MONIT_DELTA_HDR_SIZE, size - DSP_MONIT_DELTA_HDR_SIZE);
+    if (consumed < 0) {
+        decoder->valid = false;
+    }
+    ASSERT_TEST(consumed >= 0, "Malformed delta encoded monitoring data",
+            err_decode, BPM_CLIENT_ERR_SERVER);
+
+    memcpy (&decoder->last, fields, sizeof (decoder->last));
+    decoder->count = count;
+    decoder->valid = true;
+    *monit = decoder->last;
+    return err;
+
+err_decoder_insert:
+    free (decoder);
+err_decode:
+err_missed:
+err_decoder_alloc:
+err_msg_size:
+    return err;
+}
+
+bpm_client_err_e bpm_monit_recv (bpm_client_t *self, smio_dsp_monit_t *monit,
+        char **service, int timeout)
+{
+    assert (self);
+    assert (monit);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    zmsg_t *msg = NULL;
+
+    ASSERT_TEST(self->monit_poller != NULL, "Not subscribed to any monitoring "
+            "stream", err_not_subscribed, BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* Delta encoded updates which cannot be decoded are skipped, so wait
+     * until the deadline for one that can */
+    int64_t deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+    do {
+        zmsg_destroy (&msg);
+
+        int wait = timeout;
+        if (deadline >= 0) {
+            int64_t remaining = deadline - zclock_mono ();
+            wait = (remaining > 0) ? (int) remaining : 0;
+        }
+
+        void *which = zpoller_wait (self->monit_poller, wait);
+        if (which == NULL) {
+            err = zpoller_terminated (self->monit_poller) ?
+                BPM_CLIENT_INT : BPM_CLIENT_ERR_TIMEOUT;
+            goto err_poller;
+        }
+
+        msg = mlm_client_recv (self->monit_client);
+        ASSERT_TEST(msg != NULL, "Could not receive monitoring data",
+                err_msg_recv, BPM_CLIENT_INT);
+
+        /* Message is:
+         * frame 0: smio_dsp_monit_t, or its delta encoding for
+         *      DSP_MONIT_SUBJECT_DELTA. Downsampled streams carry a
+         *      smio_dsp_monit_t too */
+        zframe_t *frame = zmsg_first (msg);
+        ASSERT_TEST(frame != NULL, "Malformed monitoring data", err_msg_size,
+                BPM_CLIENT_ERR_SERVER);
+
+        if (streq (mlm_client_subject (self->monit_client),
+                    DSP_MONIT_SUBJECT_DELTA)) {
+            err = _bpm_monit_delta_decode (self,
+                    mlm_client_address (self->monit_client), frame, monit);
+        }
+        else {
+            ASSERT_TEST(zframe_size (frame) == sizeof (*monit),
+                    "Malformed monitoring data", err_msg_size,
+                    BPM_CLIENT_ERR_SERVER);
+            memcpy (monit, zframe_data (frame), sizeof (*monit));
+            err = BPM_CLIENT_SUCCESS;
+        }
+    } while (err == BPM_CLIENT_ERR_AGAIN);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not decode monitoring data",
+            err_msg_size);
+
+    /* Stream name is "<service>:EVENTS" */
+    if (service != NULL) {
+        const char *stream = mlm_client_address (self->monit_client);
+        size_t service_len = strlen (stream) - strlen (DSP_MONIT_STREAM_SUFFIX) - 1;
+        *service = strndup (stream, service_len);
+        ASSERT_ALLOC(*service, err_service_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+
+err_service_alloc:
+err_msg_size:
+err_msg_recv:
+err_poller:
+    zmsg_destroy (&msg);
+err_not_subscribed:
+    return err;
+}
+
+/**************** Swap SMIO Functions ****************/
+
+/* Switching functions */
+PARAM_FUNC_CLIENT_WRITE(sw)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_SW, sw);
+}
+
+PARAM_FUNC_CLIENT_READ(sw)
+{
+    return param_client_read (self, service, SWAP_OPCODE_SET_GET_SW, sw);
+}
+
+/* Switching enabling functions */
+PARAM_FUNC_CLIENT_WRITE(sw_en)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_SW_EN, sw_en);
+}
+
+PARAM_FUNC_CLIENT_READ(sw_en)
+{
+    return param_client_read (self, service, SWAP_OPCODE_SET_GET_SW_EN, sw_en);
+}
+
+/* Switching Clock division functions */
+PARAM_FUNC_CLIENT_WRITE(div_clk)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_DIV_CLK, div_clk);
 }
 
 PARAM_FUNC_CLIENT_READ(div_clk)
 {
-    return param_client_read (self, service, SWAP_OPCODE_SET_GET_DIV_CLK, div_clk);
+    return param_client_read (self, service, SWAP_OPCODE_SET_GET_DIV_CLK, div_clk);
+}
+
+/* Switching delay functions */
+PARAM_FUNC_CLIENT_WRITE(sw_dly)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_SW_DLY, sw_dly);
+}
+
+PARAM_FUNC_CLIENT_READ(sw_dly)
+{
+    return param_client_read (self, service, SWAP_OPCODE_SET_GET_SW_DLY, sw_dly);
+}
+
+/* Windowing functions */
+/* FIXME: Change client function wdw () to wdw_en (), which is a more semantic name */
+PARAM_FUNC_CLIENT_WRITE(wdw)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_WDW_EN, wdw);
+}
+
+/* FIXME: Change client function wdw () to wdw_en (), which is a more semantic name */
+PARAM_FUNC_CLIENT_READ(wdw)
+{
+    return param_client_read (self, service, SWAP_OPCODE_SET_GET_WDW_EN, wdw);
+}
+
+PARAM_FUNC_CLIENT_WRITE(wdw_dly)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_WDW_DLY, wdw_dly);
+}
+
+PARAM_FUNC_CLIENT_READ(wdw_dly)
+{
+    return param_client_read (self, service, SWAP_OPCODE_SET_GET_WDW_DLY, wdw_dly);
+}
+
+/* Gain functions */
+/* TODO: reduce code repetition by, possibilly, group the OPCODES in
+ * structure and merge all functions in a single
+ * generic one for all channels (A, B, C, D) */
+PARAM_FUNC_CLIENT_WRITE2(gain_a, dir_gain, inv_gain)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_A,
+            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+}
+
+PARAM_FUNC_CLIENT_READ2(gain_a, dir_gain, inv_gain)
+{
+    uint32_t gain;
+    bpm_client_err_e err = param_client_read (self, service,
+            SWAP_OPCODE_SET_GET_GAIN_A, &gain);
+
+    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
+    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+
+    return err;
+}
+
+PARAM_FUNC_CLIENT_WRITE2(gain_b, dir_gain, inv_gain)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_B,
+            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+}
+
+PARAM_FUNC_CLIENT_READ2(gain_b, dir_gain, inv_gain)
+{
+    uint32_t gain;
+    bpm_client_err_e err = param_client_read (self, service,
+            SWAP_OPCODE_SET_GET_GAIN_B, &gain);
+
+    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
+    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+
+    return err;
+}
+
+PARAM_FUNC_CLIENT_WRITE2(gain_c, dir_gain, inv_gain)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_C,
+            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+}
+
+PARAM_FUNC_CLIENT_READ2(gain_c, dir_gain, inv_gain)
+{
+    uint32_t gain;
+    bpm_client_err_e err = param_client_read (self, service,
+            SWAP_OPCODE_SET_GET_GAIN_C, &gain);
+
+    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
+    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+
+    return err;
+}
+
+PARAM_FUNC_CLIENT_WRITE2(gain_d, dir_gain, inv_gain)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_D,
+            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+}
+
+PARAM_FUNC_CLIENT_READ2(gain_d, dir_gain, inv_gain)
+{
+    uint32_t gain;
+    bpm_client_err_e err = param_client_read (self, service,
+            SWAP_OPCODE_SET_GET_GAIN_D, &gain);
+
+    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
+    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+
+    return err;
+}
+
+/* Switching and gain profiles */
+bpm_client_err_e bpm_set_swap_profile (bpm_client_t *self, char *service,
+        struct _smio_swap_profile_t *profile)
+{
+    uint32_t rw = WRITE_MODE;
+    return param_client_write_gen (self, service, SWAP_OPCODE_SET_GET_PROFILE,
+            rw, profile, sizeof (*profile), NULL, 0);
+}
+
+bpm_client_err_e bpm_get_swap_profile (bpm_client_t *self, char *service,
+        struct _smio_swap_profile_t *profile)
+{
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, SWAP_OPCODE_SET_GET_PROFILE,
+            rw, profile, sizeof (*profile), NULL, 0, profile, sizeof (*profile));
+}
+
+bpm_client_err_e bpm_set_swap_profile_slot (bpm_client_t *self, char *service,
+        uint32_t slot, struct _smio_swap_profile_t *profile)
+{
+    uint32_t rw = WRITE_MODE;
+    return param_client_write_gen (self, service, SWAP_OPCODE_SET_GET_PROFILE_SLOT,
+            rw, &slot, sizeof (slot), profile, sizeof (*profile));
+}
+
+bpm_client_err_e bpm_get_swap_profile_slot (bpm_client_t *self, char *service,
+        uint32_t slot, struct _smio_swap_profile_t *profile)
+{
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, SWAP_OPCODE_SET_GET_PROFILE_SLOT,
+            rw, &slot, sizeof (slot), profile, sizeof (*profile), profile,
+            sizeof (*profile));
+}
+
+PARAM_FUNC_CLIENT_WRITE(swap_profile_sel)
+{
+    return param_client_write (self, service, SWAP_OPCODE_SET_GET_PROFILE_SEL,
+            swap_profile_sel);
+}
+
+PARAM_FUNC_CLIENT_READ(swap_profile_sel)
+{
+    return param_client_read (self, service, SWAP_OPCODE_SET_GET_PROFILE_SEL,
+            swap_profile_sel);
+}
+
+/**************** RFFE SMIO Functions ****************/
+
+/* RFFE get/set switching state */
+PARAM_FUNC_CLIENT_WRITE(rffe_sw)
+{
+    return param_client_write (self, service, RFFE_OPCODE_SET_GET_SW,
+            rffe_sw);
+}
+
+PARAM_FUNC_CLIENT_READ(rffe_sw)
+{
+    return param_client_read (self, service, RFFE_OPCODE_SET_GET_SW,
+            rffe_sw);
+}
+
+/* RFFE get/set attenuator */
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_att1)
+{
+    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_ATT1,
+            rffe_att1);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_att1)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_ATT1,
+            rffe_att1);
+}
+
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_att2)
+{
+    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_ATT2,
+            rffe_att2);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_att2)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_ATT2,
+            rffe_att2);
+}
+
+/* RFFE get temperatures */
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp1)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP1,
+            rffe_temp1);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp2)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP2,
+            rffe_temp2);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp3)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP3,
+            rffe_temp3);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp4)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP4,
+            rffe_temp4);
+}
+
+/* RFFE get/set set points */
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_set_point1)
+{
+    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT1,
+            rffe_set_point1);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_set_point1)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT1,
+            rffe_set_point1);
+}
+
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_set_point2)
+{
+    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT2,
+            rffe_set_point2);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_set_point2)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT2,
+            rffe_set_point2);
+}
+
+/* RFFE get/set temperature control */
+PARAM_FUNC_CLIENT_WRITE(rffe_temp_control)
+{
+    return param_client_write (self, service, RFFE_OPCODE_SET_GET_TEMP_CONTROL,
+            rffe_temp_control);
+}
+
+PARAM_FUNC_CLIENT_READ(rffe_temp_control)
+{
+    return param_client_read (self, service, RFFE_OPCODE_SET_GET_TEMP_CONTROL,
+            rffe_temp_control);
+}
+
+/* RFFE outputs */
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_output1)
+{
+    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT1,
+            rffe_output1);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_output1)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT1,
+            rffe_output1);
+}
+
+PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_output2)
+{
+    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT2,
+            rffe_output2);
+}
+
+PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_output2)
+{
+    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT2,
+            rffe_output2);
+}
+
+/* RFFE get/set reset */
+PARAM_FUNC_CLIENT_WRITE(rffe_reset)
+{
+    return param_client_write (self, service, RFFE_OPCODE_SET_GET_RESET,
+            rffe_reset);
+}
+
+PARAM_FUNC_CLIENT_READ(rffe_reset)
+{
+    return param_client_read (self, service, RFFE_OPCODE_SET_GET_RESET,
+            rffe_reset);
+}
+
+/* RFFE get/set reprogram */
+PARAM_FUNC_CLIENT_WRITE(rffe_reprog)
+{
+    return param_client_write (self, service, RFFE_OPCODE_SET_GET_REPROG,
+            rffe_reprog);
+}
+
+PARAM_FUNC_CLIENT_READ(rffe_reprog)
+{
+    return param_client_read (self, service, RFFE_OPCODE_SET_GET_REPROG,
+            rffe_reprog);
+}
+
+/* RFFE set/get data */
+bpm_client_err_e bpm_set_rffe_data (bpm_client_t *self, char *service,
+        struct _smio_rffe_data_block_t *rffe_data_block)
+{
+    uint32_t rw = WRITE_MODE;
+    return param_client_write_gen (self, service, RFFE_OPCODE_SET_GET_DATA,
+            rw, rffe_data_block, sizeof (*rffe_data_block), NULL, 0);
+}
+
+bpm_client_err_e bpm_get_rffe_data (bpm_client_t *self, char *service,
+        struct _smio_rffe_data_block_t *rffe_data_block)
+{
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, RFFE_OPCODE_SET_GET_DATA,
+            rw, rffe_data_block, sizeof (*rffe_data_block), NULL, 0,
+            rffe_data_block, sizeof (*rffe_data_block));
+}
+
+/* RFFE get version */
+bpm_client_err_e bpm_get_rffe_version (bpm_client_t *self, char *service,
+        struct _smio_rffe_version_t *rffe_version)
+{
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, RFFE_OPCODE_SET_GET_VERSION,
+            rw, rffe_version, sizeof (*rffe_version), NULL, 0,
+            rffe_version, sizeof (*rffe_version));
+}
+
+/* RFFE get/set switching level */
+PARAM_FUNC_CLIENT_WRITE(rffe_sw_lvl)
+{
+    return param_client_write (self, service, RFFE_OPCODE_SET_GET_SW_LVL,
+            rffe_sw_lvl);
+}
+
+PARAM_FUNC_CLIENT_READ(rffe_sw_lvl)
+{
+    return param_client_read (self, service, RFFE_OPCODE_SET_GET_SW_LVL,
+            rffe_sw_lvl);
+}
+
+/* RFFE get monitored variables */
+bpm_client_err_e bpm_get_rffe_monit (bpm_client_t *self, char *service,
+        smio_rffe_monit_t *rffe_monit)
+{
+    assert (self);
+    assert (service);
+    assert (rffe_monit);
+
+    const disp_op_t* func = _bpm_func_translate (self, RFFE_NAME_GET_MONIT);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL,
+            (uint32_t *) rffe_monit);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_get_rffe_monit: RFFE "
+            "monitored variables could not be read", err_get_monit,
+            BPM_CLIENT_ERR_SERVER);
+
+err_get_monit:
+    return err;
+}
+
+/* RFFE get/set cache poll time */
+PARAM_FUNC_CLIENT_WRITE(rffe_cache_poll_time)
+{
+    return param_client_write (self, service, RFFE_OPCODE_SET_GET_CACHE_POLL_TIME,
+            rffe_cache_poll_time);
+}
+
+PARAM_FUNC_CLIENT_READ(rffe_cache_poll_time)
+{
+    return param_client_read (self, service, RFFE_OPCODE_SET_GET_CACHE_POLL_TIME,
+            rffe_cache_poll_time);
+}
+
+/********************** AFC Diagnostics Functions ********************/
+
+/* The memoized identity of a service is stale once its GEO_ID is written */
+static void _bpm_afc_diag_forget_identity (bpm_client_t *self, char *service)
+{
+    if (self->afc_diag_identities != NULL) {
+        zhashx_delete (self->afc_diag_identities, service);
+    }
+}
+
+/* AFC card slot */
+PARAM_FUNC_CLIENT_WRITE(afc_diag_card_slot)
+{
+    _bpm_afc_diag_forget_identity (self, service);
+    return param_client_write (self, service, AFC_DIAG_OPCODE_SET_GET_CARD_SLOT,
+            afc_diag_card_slot);
 }
 
-/* Switching delay functions */
-PARAM_FUNC_CLIENT_WRITE(sw_dly)
+PARAM_FUNC_CLIENT_READ(afc_diag_card_slot)
 {
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_SW_DLY, sw_dly);
+    return param_client_read (self, service, AFC_DIAG_OPCODE_SET_GET_CARD_SLOT,
+            afc_diag_card_slot);
 }
 
-PARAM_FUNC_CLIENT_READ(sw_dly)
+/* AFC IPMI address */
+PARAM_FUNC_CLIENT_WRITE(afc_diag_ipmi_addr)
 {
-    return param_client_read (self, service, SWAP_OPCODE_SET_GET_SW_DLY, sw_dly);
+    _bpm_afc_diag_forget_identity (self, service);
+    return param_client_write (self, service, AFC_DIAG_OPCODE_SET_GET_IPMI_ADDR,
+            afc_diag_ipmi_addr);
 }
 
-/* Windowing functions */
-/* FIXME: Change client function wdw () to wdw_en (), which is a more semantic name */
-PARAM_FUNC_CLIENT_WRITE(wdw)
+PARAM_FUNC_CLIENT_READ(afc_diag_ipmi_addr)
 {
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_WDW_EN, wdw);
+    return param_client_read (self, service, AFC_DIAG_OPCODE_SET_GET_IPMI_ADDR,
+            afc_diag_ipmi_addr);
 }
 
-/* FIXME: Change client function wdw () to wdw_en (), which is a more semantic name */
-PARAM_FUNC_CLIENT_READ(wdw)
+/* Build Revision */
+bpm_client_err_e bpm_get_afc_diag_build_revision (bpm_client_t *self, char *service,
+        struct _smio_afc_diag_revision_data_t *revision_data)
 {
-    return param_client_read (self, service, SWAP_OPCODE_SET_GET_WDW_EN, wdw);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_REVISION,
+            rw, revision_data, sizeof (*revision_data), NULL, 0,
+            revision_data, sizeof (*revision_data));
 }
 
-PARAM_FUNC_CLIENT_WRITE(wdw_dly)
+/* Build Date */
+bpm_client_err_e bpm_get_afc_diag_build_date (bpm_client_t *self, char *service,
+        struct _smio_afc_diag_revision_data_t *revision_data)
 {
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_WDW_DLY, wdw_dly);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_DATE,
+            rw, revision_data, sizeof (*revision_data), NULL, 0,
+            revision_data, sizeof (*revision_data));
 }
 
-PARAM_FUNC_CLIENT_READ(wdw_dly)
+/* Build User Name */
+bpm_client_err_e bpm_get_afc_diag_build_user_name (bpm_client_t *self, char *service,
+        struct _smio_afc_diag_revision_data_t *revision_data)
 {
-    return param_client_read (self, service, SWAP_OPCODE_SET_GET_WDW_DLY, wdw_dly);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_USER_NAME,
+            rw, revision_data, sizeof (*revision_data), NULL, 0,
+            revision_data, sizeof (*revision_data));
 }
 
-/* Gain functions */
-/* TODO: reduce code repetition by, possibilly, group the OPCODES in
- * structure and merge all functions in a single
- * generic one for all channels (A, B, C, D) */
-PARAM_FUNC_CLIENT_WRITE2(gain_a, dir_gain, inv_gain)
+/* Build User Email */
+bpm_client_err_e bpm_get_afc_diag_build_user_email (bpm_client_t *self, char *service,
+        struct _smio_afc_diag_revision_data_t *revision_data)
 {
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_A,
-            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_USER_EMAIL,
+            rw, revision_data, sizeof (*revision_data), NULL, 0,
+            revision_data, sizeof (*revision_data));
 }
 
-PARAM_FUNC_CLIENT_READ2(gain_a, dir_gain, inv_gain)
+/* Identity, read from the service once */
+bpm_client_err_e bpm_get_afc_diag_identity (bpm_client_t *self, char *service,
+        struct _smio_afc_diag_identity_t *identity)
 {
-    uint32_t gain;
-    bpm_client_err_e err = param_client_read (self, service,
-            SWAP_OPCODE_SET_GET_GAIN_A, &gain);
+    assert (self);
+    assert (service);
+    assert (identity);
 
-    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
-    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    if (self->afc_diag_identities == NULL) {
+        self->afc_diag_identities = zhashx_new ();
+        ASSERT_ALLOC(self->afc_diag_identities, err_identities_alloc,
+                BPM_CLIENT_ERR_ALLOC);
+        zhashx_set_destructor (self->afc_diag_identities,
+                _afc_diag_identity_destroy);
+    }
+
+    smio_afc_diag_identity_t *cached = zhashx_lookup (self->afc_diag_identities,
+            service);
+    if (cached != NULL) {
+        *identity = *cached;
+        goto out;
+    }
 
+    uint32_t rw = READ_MODE;
+    uint32_t param = 0;
+    err = param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_IDENTITY,
+            rw, &param, sizeof (param), NULL, 0, identity, sizeof (*identity));
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not get AFC_DIAG identity",
+            err_get_identity);
+
+    /* Not memoizing it is not an error, it is just read again */
+    cached = (smio_afc_diag_identity_t *) zmalloc (sizeof (*cached));
+    if (cached != NULL) {
+        *cached = *identity;
+        if (zhashx_insert (self->afc_diag_identities, service, cached) != 0) {
+            free (cached);
+        }
+    }
+
+out:
+err_get_identity:
+err_identities_alloc:
     return err;
 }
 
-PARAM_FUNC_CLIENT_WRITE2(gain_b, dir_gain, inv_gain)
+/********************** Trigger Interface Functions ********************/
+
+/* Trigger direction */
+PARAM_FUNC_CLIENT_WRITE2(trigger_dir, chan, dir)
 {
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_B,
-            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_DIR,
+            chan, dir);
 }
 
-PARAM_FUNC_CLIENT_READ2(gain_b, dir_gain, inv_gain)
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_dir, chan, dir)
 {
-    uint32_t gain;
-    bpm_client_err_e err = param_client_read (self, service,
-            SWAP_OPCODE_SET_GET_GAIN_B, &gain);
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_DIR,
+            chan, dir);
+}
 
-    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
-    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+/* Trigger direction */
+PARAM_FUNC_CLIENT_WRITE2(trigger_dir_pol, chan, dir_pol)
+{
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_DIR_POL,
+            chan, dir_pol);
+}
 
-    return err;
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_dir_pol, chan, dir_pol)
+{
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_DIR_POL,
+                chan, dir_pol);
 }
 
-PARAM_FUNC_CLIENT_WRITE2(gain_c, dir_gain, inv_gain)
+/* Trigger receive counter reset */
+PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_count_rst, chan, rcv_count_rst)
 {
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_C,
-            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_RCV_COUNT_RST,
+            chan, rcv_count_rst);
 }
 
-PARAM_FUNC_CLIENT_READ2(gain_c, dir_gain, inv_gain)
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_count_rst, chan, rcv_count_rst)
 {
-    uint32_t gain;
-    bpm_client_err_e err = param_client_read (self, service,
-            SWAP_OPCODE_SET_GET_GAIN_C, &gain);
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_RCV_COUNT_RST,
+            chan, rcv_count_rst);
+}
 
-    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
-    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+/* Trigger transmit counter reset */
+PARAM_FUNC_CLIENT_WRITE2(trigger_transm_count_rst, chan, transm_count_rst)
+{
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_TRANSM_COUNT_RST,
+            chan, transm_count_rst);
+}
 
-    return err;
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_count_rst, chan, transm_count_rst)
+{
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_TRANSM_COUNT_RST,
+            chan, transm_count_rst);
 }
 
-PARAM_FUNC_CLIENT_WRITE2(gain_d, dir_gain, inv_gain)
+/* Trigger receive length debounce */
+PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_len, chan, rcv_len)
 {
-    return param_client_write (self, service, SWAP_OPCODE_SET_GET_GAIN_D,
-            RW_SWAP_GAIN_UPPER_W(inv_gain) | RW_SWAP_GAIN_LOWER_W(dir_gain));
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_RCV_LEN,
+            chan, rcv_len);
 }
 
-PARAM_FUNC_CLIENT_READ2(gain_d, dir_gain, inv_gain)
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_len, chan, rcv_len)
 {
-    uint32_t gain;
-    bpm_client_err_e err = param_client_read (self, service,
-            SWAP_OPCODE_SET_GET_GAIN_D, &gain);
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_RCV_LEN,
+            chan, rcv_len);
+}
 
-    *dir_gain = RW_SWAP_GAIN_LOWER_R(gain);
-    *inv_gain = RW_SWAP_GAIN_UPPER_R(gain);
+/* Trigger transmit length debounce */
+PARAM_FUNC_CLIENT_WRITE2(trigger_transm_len, chan, transm_len)
+{
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_TRANSM_LEN,
+            chan, transm_len);
+}
 
-    return err;
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_len, chan, transm_len)
+{
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_TRANSM_LEN,
+            chan, transm_len);
 }
 
-/**************** RFFE SMIO Functions ****************/
+/* Trigger count_receive */
+PARAM_FUNC_CLIENT_WRITE2(trigger_count_rcv, chan, count_rcv)
+{
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_COUNT_RCV,
+            chan, count_rcv);
+}
 
-/* RFFE get/set switching state */
-PARAM_FUNC_CLIENT_WRITE(rffe_sw)
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_count_rcv, chan, count_rcv)
 {
-    return param_client_write (self, service, RFFE_OPCODE_SET_GET_SW,
-            rffe_sw);
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_COUNT_RCV,
+            chan, count_rcv);
 }
 
-PARAM_FUNC_CLIENT_READ(rffe_sw)
+/* Trigger count transmit */
+PARAM_FUNC_CLIENT_WRITE2(trigger_count_transm, chan, count_transm)
 {
-    return param_client_read (self, service, RFFE_OPCODE_SET_GET_SW,
-            rffe_sw);
+    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_COUNT_TRANSM,
+            chan, count_transm);
 }
 
-/* RFFE get/set attenuator */
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_att1)
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_count_transm, chan, count_transm)
+{
+    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_COUNT_TRANSM,
+            chan, count_transm);
+}
+
+/********************** Trigger Mux Functions ********************/
+
+/* Trigger receive source */
+PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_src, chan, rcv_src)
+{
+    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_RCV_SRC,
+            chan, rcv_src);
+}
+
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_src, chan, rcv_src)
+{
+    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_RCV_SRC,
+            chan, rcv_src);
+}
+
+/* Trigger receive in selection */
+PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_in_sel, chan, rcv_in_sel)
+{
+    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_RCV_IN_SEL,
+            chan, rcv_in_sel);
+}
+
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_in_sel, chan, rcv_in_sel)
+{
+    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_RCV_IN_SEL,
+            chan, rcv_in_sel);
+}
+
+/* Trigger transmit source */
+PARAM_FUNC_CLIENT_WRITE2(trigger_transm_src, chan, transm_src)
+{
+    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_TRANSM_SRC,
+            chan, transm_src);
+}
+
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_src, chan, transm_src)
+{
+    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_TRANSM_SRC,
+            chan, transm_src);
+}
+
+/* Trigger transmit selection */
+PARAM_FUNC_CLIENT_WRITE2(trigger_transm_out_sel, chan, transm_out_sel)
+{
+    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_TRANSM_OUT_SEL,
+            chan, transm_out_sel);
+}
+
+PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_out_sel, chan, transm_out_sel)
+{
+    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_TRANSM_OUT_SEL,
+            chan, transm_out_sel);
+}
+
+/* Trigger interface table */
+bpm_client_err_e bpm_set_trigger_iface_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_iface_table_t *table)
+{
+    uint32_t rw = WRITE_MODE;
+    return param_client_write_gen (self, service, TRIGGER_IFACE_OPCODE_TABLE,
+            rw, table, sizeof (*table), NULL, 0);
+}
+
+bpm_client_err_e bpm_get_trigger_iface_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_iface_table_t *table)
 {
-    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_ATT1,
-            rffe_att1);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, TRIGGER_IFACE_OPCODE_TABLE,
+            rw, table, sizeof (*table), NULL, 0, table, sizeof (*table));
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_att1)
+/* Trigger counters */
+bpm_client_err_e bpm_get_trigger_iface_counters (bpm_client_t *self, char *service,
+        smio_trigger_iface_counters_t *counters)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_ATT1,
-            rffe_att1);
+    assert (self);
+    assert (service);
+    assert (counters);
+
+    const disp_op_t* func = _bpm_func_translate (self, TRIGGER_IFACE_NAME_GET_COUNTERS);
+    bpm_client_err_e err = bpm_func_exec (self, func, service, NULL,
+            (uint32_t *) counters);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "bpm_get_trigger_iface_counters: "
+            "Trigger counters could not be read", err_get_counters,
+            BPM_CLIENT_ERR_SERVER);
+
+err_get_counters:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_att2)
+/* Trigger event stream period */
+PARAM_FUNC_CLIENT_WRITE(trigger_event_poll_time)
 {
-    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_ATT2,
-            rffe_att2);
+    return param_client_write (self, service,
+            TRIGGER_IFACE_OPCODE_SET_GET_EVENT_POLL_TIME, trigger_event_poll_time);
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_att2)
+PARAM_FUNC_CLIENT_READ(trigger_event_poll_time)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_ATT2,
-            rffe_att2);
+    return param_client_read (self, service,
+            TRIGGER_IFACE_OPCODE_SET_GET_EVENT_POLL_TIME, trigger_event_poll_time);
 }
 
-/* RFFE get temperatures */
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp1)
+/* Trigger event stream */
+bpm_client_err_e bpm_trigger_event_subscribe (bpm_client_t *self, char *service,
+        uint32_t chan)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP1,
-            rffe_temp1);
+    assert (self);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    ASSERT_TEST(chan <= TRIGGER_IFACE_NUM_CHAN, "Invalid trigger channel",
+            err_inv_chan, BPM_CLIENT_ERR_INV_PARAM);
+
+    char *stream = hutils_concat_strings (service, TRIGGER_IFACE_EVENT_STREAM_SUFFIX, ':');
+    ASSERT_ALLOC(stream, err_stream_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    /* Subjects are patterns, so anchor them, or channel 1 would match
+     * channels 10 to 19 too */
+    char pattern [TRIGGER_IFACE_EVENT_SUBJECT_MAX_LEN + 2];
+    if (chan == TRIGGER_IFACE_NUM_CHAN) {
+        snprintf (pattern, sizeof (pattern), "^" TRIGGER_IFACE_EVENT_SUBJECT_PREFIX);
+    }
+    else {
+        snprintf (pattern, sizeof (pattern), "^" TRIGGER_IFACE_EVENT_SUBJECT_PREFIX
+                "%u$", chan);
+    }
+
+    /* Trigger events go to a separate client, so they are not mixed up with
+     * replies or other events */
+    if (self->trig_event_client == NULL) {
+        self->trig_event_client = mlm_client_new ();
+        ASSERT_TEST(self->trig_event_client != NULL, "Could not create MLM "
+                "trigger event client", err_trig_event_client_alloc,
+                BPM_CLIENT_ERR_ALLOC);
+
+        int rc = mlm_client_connect (self->trig_event_client, self->broker_endp,
+                BPMCLIENT_MLM_CONNECT_TIMEOUT, "");
+        ASSERT_TEST(rc >= 0, "Could not connect MLM trigger event client to broker",
+                err_trig_event_client_connect, BPM_CLIENT_ERR_ALLOC);
+
+        self->trig_event_poller = zpoller_new (
+                mlm_client_msgpipe (self->trig_event_client), NULL);
+        ASSERT_TEST(self->trig_event_poller != NULL, "Could not initialize "
+                "trigger event poller", err_trig_event_poller_alloc,
+                BPM_CLIENT_ERR_ALLOC);
+    }
+
+    int rc = mlm_client_set_consumer (self->trig_event_client, stream, pattern);
+    ASSERT_TEST(rc >= 0, "Could not subscribe to trigger event stream",
+            err_set_consumer, BPM_CLIENT_ERR_ALLOC);
+
+    free (stream);
+    return err;
+
+err_trig_event_poller_alloc:
+err_trig_event_client_connect:
+    mlm_client_destroy (&self->trig_event_client);
+err_trig_event_client_alloc:
+err_set_consumer:
+    free (stream);
+err_stream_alloc:
+err_inv_chan:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp2)
+bpm_client_err_e bpm_trigger_event_recv (bpm_client_t *self,
+        smio_trigger_iface_event_t *event, char **service, int timeout)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP2,
-            rffe_temp2);
+    assert (self);
+    assert (event);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    zmsg_t *msg = NULL;
+
+    ASSERT_TEST(self->trig_event_poller != NULL, "Not subscribed to any trigger "
+            "event stream", err_not_subscribed, BPM_CLIENT_ERR_INV_FUNCTION);
+
+    void *which = zpoller_wait (self->trig_event_poller, timeout);
+    if (which == NULL) {
+        err = zpoller_terminated (self->trig_event_poller) ?
+            BPM_CLIENT_INT : BPM_CLIENT_ERR_TIMEOUT;
+        goto err_poller;
+    }
+
+    msg = mlm_client_recv (self->trig_event_client);
+    ASSERT_TEST(msg != NULL, "Could not receive trigger event",
+            err_msg_recv, BPM_CLIENT_INT);
+
+    /* Message is:
+     * frame 0: smio_trigger_iface_event_t */
+    zframe_t *frame = zmsg_first (msg);
+    ASSERT_TEST(frame != NULL && zframe_size (frame) == sizeof (*event),
+            "Malformed trigger event", err_msg_size, BPM_CLIENT_ERR_SERVER);
+    memcpy (event, zframe_data (frame), sizeof (*event));
+
+    /* Stream name is "<service>:EVENTS" */
+    if (service != NULL) {
+        const char *stream = mlm_client_address (self->trig_event_client);
+        size_t service_len = strlen (stream) -
+            strlen (TRIGGER_IFACE_EVENT_STREAM_SUFFIX) - 1;
+        *service = strndup (stream, service_len);
+        ASSERT_ALLOC(*service, err_service_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+
+err_service_alloc:
+err_msg_size:
+err_msg_recv:
+err_poller:
+    zmsg_destroy (&msg);
+err_not_subscribed:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp3)
+/* Trigger mux table */
+bpm_client_err_e bpm_set_trigger_mux_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_mux_table_t *table)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP3,
-            rffe_temp3);
+    uint32_t rw = WRITE_MODE;
+    return param_client_write_gen (self, service, TRIGGER_MUX_OPCODE_TABLE,
+            rw, table, sizeof (*table), NULL, 0);
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_temp4)
+bpm_client_err_e bpm_get_trigger_mux_table (bpm_client_t *self, char *service,
+        struct _smio_trigger_mux_table_t *table)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_TEMP4,
-            rffe_temp4);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, TRIGGER_MUX_OPCODE_TABLE,
+            rw, table, sizeof (*table), NULL, 0, table, sizeof (*table));
 }
 
-/* RFFE get/set set points */
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_set_point1)
+/********************** Generic SMIO Functions ********************/
+
+/* Operation statistics */
+bpm_client_err_e bpm_get_op_stats (bpm_client_t *self, char *service,
+        uint32_t opcode, uint32_t flags, struct _smio_op_stats_t *stats)
 {
-    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT1,
-            rffe_set_point1);
+    return param_client_read_gen (self, service, SMIO_OPCODE_GET_OP_STATS,
+            opcode, &flags, sizeof (flags), NULL, 0, stats, sizeof (*stats));
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_set_point1)
+/* Request queue */
+bpm_client_err_e bpm_set_rate_limit (bpm_client_t *self, char *service,
+        uint32_t rate_limit)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT1,
-            rffe_set_point1);
+    return param_client_write (self, service, SMIO_OPCODE_SET_GET_RATE_LIMIT,
+            rate_limit);
 }
 
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_set_point2)
+bpm_client_err_e bpm_get_rate_limit (bpm_client_t *self, char *service,
+        uint32_t *rate_limit)
 {
-    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT2,
-            rffe_set_point2);
+    return param_client_read (self, service, SMIO_OPCODE_SET_GET_RATE_LIMIT,
+            rate_limit);
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_set_point2)
+bpm_client_err_e bpm_get_queue_stats (bpm_client_t *self, char *service,
+        uint32_t flags, struct _smio_queue_stats_t *stats)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_SET_POINT2,
-            rffe_set_point2);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, SMIO_OPCODE_GET_QUEUE_STATS,
+            rw, &flags, sizeof (flags), NULL, 0, stats, sizeof (*stats));
 }
 
-/* RFFE get/set temperature control */
-PARAM_FUNC_CLIENT_WRITE(rffe_temp_control)
+bpm_client_err_e bpm_get_startup_stats (bpm_client_t *self, char *service,
+        struct _smio_startup_stats_t *stats)
 {
-    return param_client_write (self, service, RFFE_OPCODE_SET_GET_TEMP_CONTROL,
-            rffe_temp_control);
+    uint32_t rw = READ_MODE;
+    uint32_t reserved = 0;
+    return param_client_read_gen (self, service, SMIO_OPCODE_GET_STARTUP_STATS,
+            rw, &reserved, sizeof (reserved), NULL, 0, stats, sizeof (*stats));
 }
 
-PARAM_FUNC_CLIENT_READ(rffe_temp_control)
+bpm_client_err_e bpm_get_alloc_stats (bpm_client_t *self, char *service,
+        uint32_t flags, struct _smio_alloc_stats_t *stats)
 {
-    return param_client_read (self, service, RFFE_OPCODE_SET_GET_TEMP_CONTROL,
-            rffe_temp_control);
+    uint32_t rw = READ_MODE;
+    return param_client_read_gen (self, service, SMIO_OPCODE_GET_ALLOC_STATS,
+            rw, &flags, sizeof (flags), NULL, 0, stats, sizeof (*stats));
 }
 
-/* RFFE outputs */
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_output1)
+bpm_client_err_e bpm_ping (bpm_client_t *self, char *service,
+        struct _smio_ping_t *ping)
 {
-    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT1,
-            rffe_output1);
+    uint32_t rw = READ_MODE;
+    uint32_t reserved = 0;
+    return param_client_read_gen (self, service, SMIO_OPCODE_PING,
+            rw, &reserved, sizeof (reserved), NULL, 0, ping, sizeof (*ping));
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_output1)
+/**************** Helper Function ****************/
+
+/* Send a function request without waiting for its reply. "tracker" is
+ * sent back by the server with the reply. NULL for none. "local" allows
+ * the local fast path, see bpm_client_sendto () */
+static bpm_client_err_e _bpm_func_exec_send (bpm_client_t *self, const disp_op_t *func,
+        char *service, uint32_t *input, bool has_output, const char *tracker,
+        bool local)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT1,
-            rffe_output1);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    uint8_t *input8 = (uint8_t *) input;
+
+    /* Check input arguments */
+    ASSERT_TEST(self != NULL, "Bpm_client is NULL", err_null_exp,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+    ASSERT_TEST(func != NULL, "Function structure is NULL", err_null_exp,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+    ASSERT_TEST(!(func->args[0] != DISP_ARG_END && input8 == NULL),
+            "Invalid input arguments!", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+    ASSERT_TEST(!(func->retval != DISP_ARG_END && !has_output),
+            "Invalid output arguments!", err_inv_param, BPM_CLIENT_ERR_INV_PARAM);
+
+    /* Create the message */
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    /* Add the frame containing the opcode for the function desired (always first) */
+    zmsg_addmem (msg, &func->opcode, sizeof (func->opcode));
+
+    /* Add the arguments in their respective frames in the message */
+    for (int i = 0; func->args[i] != DISP_ARG_END; ++i) {
+        /* Get the size of the message being sent */
+        uint32_t in_size = DISP_GET_ASIZE(func->args[i]);
+        /* Create a frame to compose the message */
+        zmsg_addmem (msg, input8, in_size);
+        /* Moves along the pointer */
+        input8 += in_size;
+    }
+
+    const char *subject = RW_REPLY_PACKED_SUBJECT;
+    if (self->wire_format == RW_WIRE_PACKED_V1) {
+        err = param_client_msg_pack (msg);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not pack message", err_pack);
+        subject = RW_REQ_PACKED_V1_SUBJECT;
+    }
+
+    int rc = bpm_client_sendto (self, service, subject, tracker, 0, &msg,
+            local);
+    ASSERT_TEST(rc >= 0, "Could not send message", err_send,
+            BPM_CLIENT_ERR_SERVER);
+
+err_send:
+err_pack:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+err_null_exp:
+err_inv_param:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_WRITE_DOUBLE(rffe_output2)
+/* Receive the reply of a previously sent function request */
+static bpm_client_err_e _bpm_func_exec_recv (bpm_client_t *self, uint8_t *output8)
 {
-    return param_client_write_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT2,
-            rffe_output2);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* Receive report */
+    zmsg_t *report = param_client_recv_timeout (self);
+    ASSERT_TEST(report != NULL, "Report received is NULL", err_msg,
+            BPM_CLIENT_ERR_TIMEOUT);
+
+    err = _bpm_func_exec_reply (&report, output8);
+
+err_msg:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ_DOUBLE(rffe_output2)
+/* Same as _bpm_func_exec_recv, but the reply is kept in "reply" instead of
+ * being copied and destroyed */
+static bpm_client_err_e _bpm_func_exec_recv_view (bpm_client_t *self,
+        bpm_func_reply_t *reply)
 {
-    return param_client_read_double (self, service, RFFE_OPCODE_SET_GET_OUTPUT2,
-            rffe_output2);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    zmsg_t *report = param_client_recv_timeout (self);
+    ASSERT_TEST(report != NULL, "Report received is NULL", err_msg,
+            BPM_CLIENT_ERR_TIMEOUT);
+
+    RW_REPLY_TYPE reply_code;
+    err = param_client_reply_parse (report, &reply_code, &reply->data,
+            &reply->size);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Unexpected message received",
+            err_parse);
+    err = reply_code;
+
+    reply->msg = report;
+    return err;
+
+err_parse:
+    zmsg_destroy (&report);
+err_msg:
+    return err;
 }
 
-/* RFFE get/set reset */
-PARAM_FUNC_CLIENT_WRITE(rffe_reset)
+/* Decode a function reply, copying its data to output8, and destroy it */
+static bpm_client_err_e _bpm_func_exec_reply (zmsg_t **report_p, uint8_t *output8)
 {
-    return param_client_write (self, service, RFFE_OPCODE_SET_GET_RESET,
-            rffe_reset);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    zmsg_t *report = *report_p;
+
+    /* Message is:
+     * frame 0: Error code
+     * frame 1: Number of bytes received
+     * frame 2+: Data received
+     * or the packed equivalent */
+    RW_REPLY_TYPE reply_code;
+    const uint8_t *data;
+    size_t data_size;
+    err = param_client_reply_parse (report, &reply_code, &data, &data_size);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Unexpected message received", err_msg);
+    err = reply_code;
+
+    if (data != NULL && output8 != NULL) {
+        /* Copy message contents to user */
+        memcpy (output8, data, data_size);
+    }
+
+err_msg:
+    zmsg_destroy (report_p);
+    return err;
 }
 
-PARAM_FUNC_CLIENT_READ(rffe_reset)
+/* Complete an asynchronous request. Requests with a callback are forgotten
+ * right away, the others when they are waited for */
+static void _bpm_func_async_finish (bpm_client_t *self, bpm_async_req_t *req,
+        bpm_client_err_e err)
 {
-    return param_client_read (self, service, RFFE_OPCODE_SET_GET_RESET,
-            rffe_reset);
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] bpm_func_async: "
+            "Request %u completed: %s\n", req->id, bpm_client_err_str (err));
+
+    req->done = true;
+    req->err = err;
+
+    if (req->cb != NULL) {
+        char tracker [BPM_FUNC_ASYNC_TRACKER_LEN];
+        snprintf (tracker, sizeof (tracker), BPM_FUNC_ASYNC_TRACKER_FMT, req->id);
+
+        /* The callback might issue new requests, so it is only called
+         * after the request is gone */
+        bpm_func_async_fp cb = req->cb;
+        void *arg = req->arg;
+        uint32_t id = req->id;
+        uint32_t *output = (uint32_t *) req->output;
+        zhashx_delete (self->async_reqs, tracker);
+
+        cb (self, id, err, output, arg);
+    }
 }
 
-/* RFFE get/set reprogram */
-PARAM_FUNC_CLIENT_WRITE(rffe_reprog)
+/* Completion of a write-behind write. Only the first failure is kept, to
+ * be returned by the next flush */
+static void _bpm_param_write_behind_done (bpm_client_t *self, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg)
 {
-    return param_client_write (self, service, RFFE_OPCODE_SET_GET_REPROG,
-            rffe_reprog);
+    (void) output;
+    (void) arg;
+
+    self->wb_in_flight--;
+    if (err == BPM_CLIENT_SUCCESS) {
+        return;
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient] "
+            "bpm_param_write_behind: Write %u failed: %s\n", req_id,
+            bpm_client_err_str (err));
+    if (self->wb_err == BPM_CLIENT_SUCCESS) {
+        /* Same as the synchronous writes, the server reply codes are not
+         * client errors */
+        self->wb_err = (err == BPM_CLIENT_ERR_TIMEOUT) ? err :
+            BPM_CLIENT_ERR_AGAIN;
+    }
 }
 
-PARAM_FUNC_CLIENT_READ(rffe_reprog)
+/* Complete the requests whose reply did not arrive in time */
+static void _bpm_func_async_expire (bpm_client_t *self)
 {
-    return param_client_read (self, service, RFFE_OPCODE_SET_GET_REPROG,
-            rffe_reprog);
+    int64_t now = zclock_mono ();
+
+    /* Completing a request changes the table, so iteration restarts after
+     * each one */
+    bool expired = true;
+    while (expired) {
+        expired = false;
+        bpm_async_req_t *req = (bpm_async_req_t *) zhashx_first (self->async_reqs);
+        while (req != NULL) {
+            if (!req->done && req->deadline >= 0 && now >= req->deadline) {
+                _bpm_func_async_finish (self, req, BPM_CLIENT_ERR_TIMEOUT);
+                expired = true;
+                break;
+            }
+            req = (bpm_async_req_t *) zhashx_next (self->async_reqs);
+        }
+    }
 }
 
-/* RFFE set/get data */
-bpm_client_err_e bpm_set_rffe_data (bpm_client_t *self, char *service,
-        struct _smio_rffe_data_block_t *rffe_data_block)
+
+bpm_client_err_e func_polling (bpm_client_t *self, char *name, char *service,
+        uint32_t *input, uint32_t *output, int timeout)
 {
-    uint32_t rw = WRITE_MODE;
-    return param_client_write_gen (self, service, RFFE_OPCODE_SET_GET_DATA,
-            rw, rffe_data_block, sizeof (*rffe_data_block), NULL, 0);
+    return _func_polling (self, name, service, input, output,
+            (timeout < 0) ? -1 : (int64_t) timeout*MSECS);
 }
 
-bpm_client_err_e bpm_get_rffe_data (bpm_client_t *self, char *service,
-        struct _smio_rffe_data_block_t *rffe_data_block)
+bpm_client_err_e func_polling_us (bpm_client_t *self, char *name, char *service,
+        uint32_t *input, uint32_t *output, int64_t timeout_us)
 {
-    uint32_t rw = READ_MODE;
-    return param_client_read_gen (self, service, RFFE_OPCODE_SET_GET_DATA,
-            rw, rffe_data_block, sizeof (*rffe_data_block), NULL, 0,
-            rffe_data_block, sizeof (*rffe_data_block));
+    return _func_polling (self, name, service, input, output, timeout_us);
 }
 
-/* RFFE get version */
-bpm_client_err_e bpm_get_rffe_version (bpm_client_t *self, char *service,
-        struct _smio_rffe_version_t *rffe_version)
+/* Polling Function. The timeout is measured against a monotonic clock, so
+ * it is not affected by changes of the system time */
+static bpm_client_err_e _func_polling (bpm_client_t *self, char *name,
+        char *service, uint32_t *input, uint32_t *output, int64_t timeout_us)
 {
-    uint32_t rw = READ_MODE;
-    return param_client_read_gen (self, service, RFFE_OPCODE_SET_GET_VERSION,
-            rw, rffe_version, sizeof (*rffe_version), NULL, 0,
-            rffe_version, sizeof (*rffe_version));
+    assert (self);
+    assert (name);
+    assert (service);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    /* Translate only once, as the function doesn't change between tries */
+    const disp_op_t* func = _bpm_func_translate (self, name);
+    ASSERT_TEST(func != NULL, "Could not find polling function", err_func,
+            BPM_CLIENT_ERR_INV_FUNCTION);
+
+    /* timeout < 0 means "infinite" wait */
+    int64_t deadline = (timeout_us < 0) ? -1 : _bpm_mono_usecs () + timeout_us;
+    int64_t wait = POLL_WAIT_MIN_US;
+    /* No try waits for its reply past the deadline */
+    int client_timeout = self->timeout;
+
+    while (true) {
+        if (zsys_interrupted) {
+            err = BPM_CLIENT_INT;
+            goto bpm_zsys_interrupted;
+        }
+
+        int64_t remaining = (deadline < 0) ? -1 : deadline - _bpm_mono_usecs ();
+        if (deadline >= 0 && remaining <= 0) {
+            break;
+        }
+
+        if (remaining >= 0) {
+            int64_t remaining_ms = (remaining + MSECS - 1) / MSECS;
+            if (client_timeout < 0 || remaining_ms < client_timeout) {
+                self->timeout = (int) remaining_ms;
+            }
+        }
+        err = bpm_func_exec (self, func, service, input, output);
+        self->timeout = client_timeout;
+
+        if (err == BPM_CLIENT_SUCCESS) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] "
+                    "func_polling: finished waiting\n");
+            goto exit;
+        }
+
+        /* Do not sleep past the deadline */
+        if (deadline >= 0) {
+            remaining = deadline - _bpm_mono_usecs ();
+            if (remaining <= 0) {
+                break;
+            }
+            if (remaining < wait) {
+                wait = remaining;
+            }
+        }
+        usleep ((useconds_t) wait);
+
+        wait *= 2;
+        if (wait > POLL_WAIT_MAX_US) {
+            wait = POLL_WAIT_MAX_US;
+        }
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] "
+            "func_polling: number of tries was exceeded\n");
+    /* timeout occured */
+    err = BPM_CLIENT_ERR_TIMEOUT;
+
+bpm_zsys_interrupted:
+err_func:
+exit:
+    return err;
 }
 
-/* RFFE get/set switching level */
-PARAM_FUNC_CLIENT_WRITE(rffe_sw_lvl)
+/* Monotonic time, in usecs */
+static int64_t _bpm_mono_usecs (void)
 {
-    return param_client_write (self, service, RFFE_OPCODE_SET_GET_SW_LVL,
-            rffe_sw_lvl);
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-PARAM_FUNC_CLIENT_READ(rffe_sw_lvl)
+/* Build a table of all the exported functions, keyed by name. Functions
+ * with the same name are resolved to the first one found, as in
+ * bpm_func_translate () */
+static zhashx_t *_bpm_func_table_new (void)
 {
-    return param_client_read (self, service, RFFE_OPCODE_SET_GET_SW_LVL,
-            rffe_sw_lvl);
-}
+    zhashx_t *func_table = zhashx_new ();
+    ASSERT_ALLOC(func_table, err_func_table_alloc);
 
-/********************** AFC Diagnostics Functions ********************/
+    for (int i=0; smio_exp_ops[i] != NULL; i++) {
+        for (int j=0; smio_exp_ops[i][j] != NULL; j++) {
+            /* zhashx_insert () fails for duplicated keys, which is exactly
+             * what we want here */
+            zhashx_insert (func_table, smio_exp_ops[i][j]->name,
+                    (void *) smio_exp_ops[i][j]);
+        }
+    }
 
-/* AFC card slot */
-PARAM_FUNC_CLIENT_WRITE(afc_diag_card_slot)
-{
-    return param_client_write (self, service, AFC_DIAG_OPCODE_SET_GET_CARD_SLOT,
-            afc_diag_card_slot);
+err_func_table_alloc:
+    return func_table;
 }
 
-PARAM_FUNC_CLIENT_READ(afc_diag_card_slot)
+static const disp_op_t *_bpm_func_translate (bpm_client_t *self, const char *name)
 {
-    return param_client_read (self, service, AFC_DIAG_OPCODE_SET_GET_CARD_SLOT,
-            afc_diag_card_slot);
-}
+    assert (self);
+    assert (name);
 
-/* AFC IPMI address */
-PARAM_FUNC_CLIENT_WRITE(afc_diag_ipmi_addr)
-{
-    return param_client_write (self, service, AFC_DIAG_OPCODE_SET_GET_IPMI_ADDR,
-            afc_diag_ipmi_addr);
+    return (const disp_op_t *) zhashx_lookup (self->func_table, name);
 }
 
-PARAM_FUNC_CLIENT_READ(afc_diag_ipmi_addr)
+/* Shared memory map destructor, called by the hash */
+static void _bpm_async_req_destroy (void **item)
 {
-    return param_client_read (self, service, AFC_DIAG_OPCODE_SET_GET_IPMI_ADDR,
-            afc_diag_ipmi_addr);
+    if (*item) {
+        free (*item);
+        *item = NULL;
+    }
 }
 
-/* Build Revision */
-bpm_client_err_e bpm_get_afc_diag_build_revision (bpm_client_t *self, char *service,
-        struct _smio_afc_diag_revision_data_t *revision_data)
+static void _bpm_param_cache_destroy (void **item)
 {
-    uint32_t rw = READ_MODE;
-    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_REVISION,
-            rw, revision_data, sizeof (*revision_data), NULL, 0,
-            revision_data, sizeof (*revision_data));
+    if (*item) {
+        bpm_param_cache_t *cache = (bpm_param_cache_t *) *item;
+
+        zhashx_destroy (&cache->values);
+        zhashx_destroy (&cache->opcodes);
+        free (cache);
+        *item = NULL;
+    }
 }
 
-/* Build Date */
-bpm_client_err_e bpm_get_afc_diag_build_date (bpm_client_t *self, char *service,
-        struct _smio_afc_diag_revision_data_t *revision_data)
+/* Applies the kernel buffers of the client to a bulk data socket, before it
+ * is connected */
+static void _bpm_sock_bufs_set (bpm_client_t *self, zsock_t *sock)
 {
-    uint32_t rw = READ_MODE;
-    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_DATE,
-            rw, revision_data, sizeof (*revision_data), NULL, 0,
-            revision_data, sizeof (*revision_data));
+    if (self->zmq_opts.sndbuf > 0) {
+        zsock_set_sndbuf (sock, self->zmq_opts.sndbuf);
+    }
+    if (self->zmq_opts.rcvbuf > 0) {
+        zsock_set_rcvbuf (sock, self->zmq_opts.rcvbuf);
+    }
 }
 
-/* Build User Name */
-bpm_client_err_e bpm_get_afc_diag_build_user_name (bpm_client_t *self, char *service,
-        struct _smio_afc_diag_revision_data_t *revision_data)
+static void _bpm_local_path_destroy (void **item)
 {
-    uint32_t rw = READ_MODE;
-    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_USER_NAME,
-            rw, revision_data, sizeof (*revision_data), NULL, 0,
-            revision_data, sizeof (*revision_data));
+    if (*item) {
+        bpm_local_path_t *path = (bpm_local_path_t *) *item;
+
+        zsock_destroy (&path->sock);
+        free (path);
+        *item = NULL;
+    }
 }
 
-/* Build User Email */
-bpm_client_err_e bpm_get_afc_diag_build_user_email (bpm_client_t *self, char *service,
-        struct _smio_afc_diag_revision_data_t *revision_data)
+/* Get the resolved service whose name is "service", if it is one of our
+ * names, as returned by bpm_client_service_name (). This is a couple of
+ * compares, instead of hashing the name */
+static bpm_service_t *_bpm_service_interned (bpm_client_t *self, const char *service)
 {
-    uint32_t rw = READ_MODE;
-    return param_client_read_gen (self, service, AFC_DIAG_OPCODE_GET_BUILD_USER_EMAIL,
-            rw, revision_data, sizeof (*revision_data), NULL, 0,
-            revision_data, sizeof (*revision_data));
-}
+    uintptr_t addr = (uintptr_t) service;
+    uintptr_t arena = (uintptr_t) self->services_arena;
+    uint32_t handle;
+    if (self->services_arena == NULL || addr < arena + sizeof (handle) ||
+            addr >= arena + self->services_arena_used) {
+        return NULL;
+    }
 
-/********************** Trigger Interface Functions ********************/
+    /* Anything in the arena but the start of a name is told apart by the
+     * name of the entry */
+    memcpy (&handle, service - sizeof (handle), sizeof (handle));
+    if (handle >= self->nservices || self->service_tbl [handle].name != service) {
+        return NULL;
+    }
 
-/* Trigger direction */
-PARAM_FUNC_CLIENT_WRITE2(trigger_dir, chan, dir)
-{
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_DIR,
-            chan, dir);
+    return &self->service_tbl [handle];
 }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_dir, chan, dir)
+static void _bpm_service_lat_destroy (void **item)
 {
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_DIR,
-            chan, dir);
+    if (*item) {
+        free (*item);
+        *item = NULL;
+    }
 }
 
-/* Trigger direction */
-PARAM_FUNC_CLIENT_WRITE2(trigger_dir_pol, chan, dir_pol)
+/* Get the latencies observed on "service", creating them on the first call.
+ * Returns NULL if they could not be allocated */
+static bpm_service_lat_t *_bpm_service_lat_get (bpm_client_t *self,
+        const char *service)
 {
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_DIR_POL,
-            chan, dir_pol);
-}
+    bpm_service_t *svc = _bpm_service_interned (self, service);
+    if (svc != NULL && svc->lat != NULL) {
+        return svc->lat;
+    }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_dir_pol, chan, dir_pol)
-{
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_DIR_POL,
-                chan, dir_pol);
-}
+    if (self->service_lats == NULL) {
+        self->service_lats = zhashx_new ();
+        ASSERT_ALLOC(self->service_lats, err_service_lats_alloc);
+        zhashx_set_destructor (self->service_lats, _bpm_service_lat_destroy);
+    }
 
-/* Trigger receive counter reset */
-PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_count_rst, chan, rcv_count_rst)
-{
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_RCV_COUNT_RST,
-            chan, rcv_count_rst);
-}
+    bpm_service_lat_t *slat = (bpm_service_lat_t *) zhashx_lookup (
+            self->service_lats, service);
+    if (slat == NULL) {
+        slat = (bpm_service_lat_t *) zmalloc (sizeof *slat);
+        ASSERT_ALLOC(slat, err_slat_alloc);
+        zhashx_insert (self->service_lats, service, slat);
+    }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_count_rst, chan, rcv_count_rst)
-{
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_RCV_COUNT_RST,
-            chan, rcv_count_rst);
-}
+    if (svc != NULL) {
+        svc->lat = slat;
+    }
+    return slat;
 
-/* Trigger transmit counter reset */
-PARAM_FUNC_CLIENT_WRITE2(trigger_transm_count_rst, chan, transm_count_rst)
-{
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_TRANSM_COUNT_RST,
-            chan, transm_count_rst);
+err_slat_alloc:
+err_service_lats_alloc:
+    return NULL;
 }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_count_rst, chan, transm_count_rst)
+/* Latency expected of a reply of up to "size" bytes to "opcode", in usec.
+ * The latencies of the op itself are used once they were measured enough,
+ * and the ones of the small replies of any op otherwise. Larger replies
+ * than the ones measured take longer by their extra bytes. Returns false
+ * if not enough was measured yet */
+static bool _bpm_lat_expected (const bpm_service_lat_t *slat, uint32_t opcode,
+        size_t size, double *expected)
 {
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_TRANSM_COUNT_RST,
-            chan, transm_count_rst);
-}
+    const bpm_lat_t *lat = &slat->ops [opcode];
+    double bytes = lat->bytes;
 
-/* Trigger receive length debounce */
-PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_len, chan, rcv_len)
-{
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_RCV_LEN,
-            chan, rcv_len);
-}
+    if (lat->samples < BPMCLIENT_LAT_MIN_SAMPLES) {
+        lat = &slat->small;
+        bytes = 0;
+        if (lat->samples < BPMCLIENT_LAT_MIN_SAMPLES ||
+                (size >= BPMCLIENT_LAT_BW_MIN_SIZE && slat->bw == 0)) {
+            return false;
+        }
+    }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_len, chan, rcv_len)
-{
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_RCV_LEN,
-            chan, rcv_len);
+    *expected = lat->srtt + 4 * lat->rttvar;
+    if (size > bytes && slat->bw > 0) {
+        *expected += (size - bytes) / slat->bw;
+    }
+    return true;
 }
 
-/* Trigger transmit length debounce */
-PARAM_FUNC_CLIENT_WRITE2(trigger_transm_len, chan, transm_len)
+/* Smooth "latency" and "bytes" into "lat" */
+static void _bpm_lat_update (bpm_lat_t *lat, double latency, double bytes)
 {
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_TRANSM_LEN,
-            chan, transm_len);
-}
+    if (lat->samples == 0) {
+        lat->srtt = latency;
+        lat->rttvar = latency / 2;
+        lat->bytes = bytes;
+    }
+    else {
+        double dev = (lat->srtt > latency) ? lat->srtt - latency :
+            latency - lat->srtt;
+        lat->rttvar = 0.75 * lat->rttvar + 0.25 * dev;
+        lat->srtt = 0.875 * lat->srtt + 0.125 * latency;
+        lat->bytes = 0.875 * lat->bytes + 0.125 * bytes;
+    }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_len, chan, transm_len)
-{
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_TRANSM_LEN,
-            chan, transm_len);
+    if (lat->samples < UINT32_MAX) {
+        lat->samples++;
+    }
 }
 
-/* Trigger count_receive */
-PARAM_FUNC_CLIENT_WRITE2(trigger_count_rcv, chan, count_rcv)
+/* Get the local fast path to "service", connecting to it on the first call.
+ * Returns NULL if the service has none */
+static bpm_local_path_t *_bpm_local_path_get (bpm_client_t *self, char *service)
 {
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_COUNT_RCV,
-            chan, count_rcv);
-}
+    bpm_service_t *svc = _bpm_service_interned (self, service);
+    bpm_local_path_t *path = (svc != NULL) ? svc->local_path : NULL;
+    if (path == NULL) {
+        path = (bpm_local_path_t *) zhashx_lookup (self->local_paths, service);
+    }
+    if (path != NULL) {
+        if (svc != NULL) {
+            svc->local_path = path;
+        }
+        return path->failed ? NULL : path;
+    }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_count_rcv, chan, count_rcv)
-{
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_COUNT_RCV,
-            chan, count_rcv);
-}
+    /* Services without a fast path are remembered as failed, so this is
+     * only checked once */
+    path = (bpm_local_path_t *) zmalloc (sizeof *path);
+    ASSERT_ALLOC(path, err_path_alloc);
+    path->failed = true;
+    zhashx_insert (self->local_paths, service, path);
+    if (svc != NULL) {
+        svc->local_path = path;
+    }
 
-/* Trigger count transmit */
-PARAM_FUNC_CLIENT_WRITE2(trigger_count_transm, chan, count_transm)
-{
-    return param_client_write2 (self, service, TRIGGER_IFACE_OPCODE_COUNT_TRANSM,
-            chan, count_transm);
-}
+    char *endp = NULL;
+    const char *prefix = RW_LOCAL_ENDP_PREFIX;
+    if (strncmp (self->broker_endp, prefix, strlen (prefix)) != 0) {
+        goto err_no_local_path;
+    }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_count_transm, chan, count_transm)
-{
-    return param_client_write_read (self, service, TRIGGER_IFACE_OPCODE_COUNT_TRANSM,
-            chan, count_transm);
-}
+    endp = hutils_concat_strings (self->broker_endp, service, RW_LOCAL_ENDP_SEP);
+    ASSERT_ALLOC(endp, err_endp_alloc);
+    /* zmq would connect to a path nobody is bound to just as well, and
+     * every request would time out */
+    if (access (endp + strlen (prefix), F_OK) != 0) {
+        goto err_no_endp;
+    }
 
-/********************** Trigger Mux Functions ********************/
+    if (self->local_poller == NULL) {
+        self->local_poller = zpoller_new (mlm_client_msgpipe (self->mlm_client),
+                NULL);
+        ASSERT_ALLOC(self->local_poller, err_poller_alloc);
+    }
 
-/* Trigger receive source */
-PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_src, chan, rcv_src)
-{
-    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_RCV_SRC,
-            chan, rcv_src);
+    path->sock = zsock_new (ZMQ_DEALER);
+    ASSERT_ALLOC(path->sock, err_sock_alloc);
+    _bpm_sock_bufs_set (self, path->sock);
+    int rc = zsock_connect (path->sock, "%s", endp);
+    ASSERT_TEST(rc == 0, "Could not connect to local fast path", err_connect);
+    rc = zpoller_add (self->local_poller, path->sock);
+    ASSERT_TEST(rc == 0, "Could not poll local fast path", err_connect);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_INFO, "[libclient] Local fast path "
+            "to %s through %s\n", service, endp);
+    free (endp);
+    path->failed = false;
+    return path;
+
+err_connect:
+    zsock_destroy (&path->sock);
+err_sock_alloc:
+err_poller_alloc:
+err_no_endp:
+err_endp_alloc:
+err_no_local_path:
+    free (endp);
+err_path_alloc:
+    return NULL;
 }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_src, chan, rcv_src)
+/* Subscribe to the parameter change events of the specified service,
+ * connecting to the broker on the first call */
+static bpm_client_err_e _bpm_param_cache_subscribe (bpm_client_t *self,
+        char *service)
 {
-    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_RCV_SRC,
-            chan, rcv_src);
-}
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
 
-/* Trigger receive in selection */
-PARAM_FUNC_CLIENT_WRITE2(trigger_rcv_in_sel, chan, rcv_in_sel)
-{
-    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_RCV_IN_SEL,
-            chan, rcv_in_sel);
+    char *stream = hutils_concat_strings (service, SMIO_EVENT_STREAM_SUFFIX, ':');
+    ASSERT_ALLOC(stream, err_stream_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    /* Change events go to a separate client, so draining them never takes
+     * replies, ACQ events or monitoring data */
+    if (self->param_cache_client == NULL) {
+        self->param_cache_client = mlm_client_new ();
+        ASSERT_TEST(self->param_cache_client != NULL, "Could not create MLM "
+                "parameter change client", err_client_alloc, BPM_CLIENT_ERR_ALLOC);
+
+        int rc = mlm_client_connect (self->param_cache_client, self->broker_endp,
+                BPMCLIENT_MLM_CONNECT_TIMEOUT, "");
+        ASSERT_TEST(rc >= 0, "Could not connect MLM parameter change client "
+                "to broker", err_client_connect, BPM_CLIENT_ERR_ALLOC);
+
+        self->param_cache_poller = zpoller_new (
+                mlm_client_msgpipe (self->param_cache_client), NULL);
+        ASSERT_TEST(self->param_cache_poller != NULL, "Could not initialize "
+                "parameter change poller", err_poller_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+
+    int rc = mlm_client_set_consumer (self->param_cache_client, stream,
+            SMIO_EVENT_SUBJECT_PARAM_CHANGED);
+    ASSERT_TEST(rc >= 0, "Could not subscribe to parameter change events",
+            err_set_consumer, BPM_CLIENT_ERR_ALLOC);
+
+    free (stream);
+    return err;
+
+err_poller_alloc:
+err_client_connect:
+    mlm_client_destroy (&self->param_cache_client);
+err_client_alloc:
+err_set_consumer:
+    free (stream);
+err_stream_alloc:
+    return err;
 }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_rcv_in_sel, chan, rcv_in_sel)
+/* Drop the cached reads of every service that notified a parameter change.
+ * Any change drops all of the reads of the service, as a SET might affect
+ * more than one parameter */
+static void _bpm_param_cache_drain (bpm_client_t *self)
 {
-    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_RCV_IN_SEL,
-            chan, rcv_in_sel);
+    while (zpoller_wait (self->param_cache_poller, 0) != NULL) {
+        zmsg_t *msg = mlm_client_recv (self->param_cache_client);
+        if (msg == NULL) {
+            break;
+        }
+        zmsg_destroy (&msg);
+
+        /* Stream name is "<service>:EVENTS" */
+        const char *stream = mlm_client_address (self->param_cache_client);
+        size_t service_len = strlen (stream) - strlen (SMIO_EVENT_STREAM_SUFFIX) - 1;
+        char *service = strndup (stream, service_len);
+        if (service == NULL) {
+            /* We cannot tell which service it was, so drop every one */
+            zhashx_purge (self->param_caches);
+            break;
+        }
+
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] Parameter "
+                "of %s changed. Dropping its cached reads\n", service);
+        bpm_param_cache_invalidate (self, service);
+        free (service);
+    }
 }
 
-/* Trigger transmit source */
-PARAM_FUNC_CLIENT_WRITE2(trigger_transm_src, chan, transm_src)
+/* Get the cache of a read, if it is cacheable, and its key in "key" */
+static bpm_param_cache_t *_bpm_param_cache_values (bpm_client_t *self,
+        char *service, uint32_t operation, const void *arg, size_t arg_size,
+        char *key, size_t key_len)
 {
-    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_TRANSM_SRC,
-            chan, transm_src);
+    /* Don't hash the service name when nothing is cached at all */
+    if (zhashx_size (self->param_caches) == 0) {
+        return NULL;
+    }
+
+    bpm_param_cache_t *cache = zhashx_lookup (self->param_caches, service);
+    if (cache == NULL || arg_size > BPMCLIENT_PARAM_CACHE_ARG_MAX) {
+        return NULL;
+    }
+
+    int len = snprintf (key, key_len, "%"PRIu32, operation);
+    if (zhashx_lookup (cache->opcodes, key) == NULL) {
+        return NULL;
+    }
+
+    /* Reads taking an argument are cached per argument */
+    const uint8_t *arg8 = (const uint8_t *) arg;
+    size_t i;
+    for (i = 0; arg8 != NULL && i < arg_size; ++i) {
+        len += snprintf (key + len, key_len - len, "%s%02x", (i == 0) ? ":" : "",
+                arg8 [i]);
+    }
+
+    return cache;
 }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_src, chan, transm_src)
+static void _acq_direct_sock_destroy (void **item)
 {
-    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_TRANSM_SRC,
-            chan, transm_src);
+    zsock_destroy ((zsock_t **) item);
 }
 
-/* Trigger transmit selection */
-PARAM_FUNC_CLIENT_WRITE2(trigger_transm_out_sel, chan, transm_out_sel)
+static void _acq_chan_map_destroy (void **item)
 {
-    return param_client_write2 (self, service, TRIGGER_MUX_OPCODE_TRANSM_OUT_SEL,
-            chan, transm_out_sel);
+    free (*item);
+    *item = NULL;
 }
 
-PARAM_FUNC_CLIENT_WRITE_READ(trigger_transm_out_sel, chan, transm_out_sel)
+static void _afc_diag_identity_destroy (void **item)
 {
-    return param_client_write_read (self, service, TRIGGER_MUX_OPCODE_TRANSM_OUT_SEL,
-            chan, transm_out_sel);
+    free (*item);
+    *item = NULL;
 }
 
-/**************** Helper Function ****************/
-
-bpm_client_err_e func_polling (bpm_client_t *self, char *name, char *service,
-        uint32_t *input, uint32_t *output, int timeout)
+static void _monit_decoder_destroy (void **item)
 {
-    return _func_polling (self, name, service, input, output, timeout);
+    bpm_monit_decoder_t *decoder = (bpm_monit_decoder_t *) *item;
+    free (decoder);
+    *item = NULL;
 }
 
-/* Polling Function */
-static bpm_client_err_e _func_polling (bpm_client_t *self, char *name,
-        char *service, uint32_t *input, uint32_t *output, int timeout)
+static void _acq_prefetch_destroy (void **item)
 {
-    assert (self);
-    assert (name);
-    assert (service);
+    if (*item) {
+        bpm_acq_prefetch_t *prefetch = (bpm_acq_prefetch_t *) *item;
 
-    /* timeout < 0 means "infinite" wait */
-    if (timeout < 0) {
-        /* FIXME! Very unportable way! We assume that time_t is at least of
-         * size INT */
-        timeout = INT_MAX;
+        free (prefetch->trans.block.data);
+        free (prefetch);
+        *item = NULL;
     }
+}
 
-    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
-    time_t start = time (NULL);
-    while ((time(NULL) - start)*1000 < timeout) {
-        if (zsys_interrupted) {
-            err = BPM_CLIENT_INT;
-            goto bpm_zsys_interrupted;
-        }
-
-        const disp_op_t* func = bpm_func_translate(name);
-        err = bpm_func_exec (self, func, service, input, output);
-
-        if (err == BPM_CLIENT_SUCCESS) {
-            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] "
-                    "func_polling: finished waiting\n");
-            goto exit;
-        }
+static void _acq_shm_map_destroy (void **item)
+{
+    if (*item) {
+        acq_shm_map_t *shm_map = (acq_shm_map_t *) *item;
 
-        usleep (MSECS*MIN_WAIT_TIME);
+        munmap (shm_map->base, shm_map->size);
+        free (shm_map);
+        *item = NULL;
     }
-
-    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient] "
-            "func_polling: number of tries was exceeded\n");
-    /* timeout occured */
-    err = BPM_CLIENT_ERR_TIMEOUT;
-
-bpm_zsys_interrupted:
-exit:
-    return err;
 }
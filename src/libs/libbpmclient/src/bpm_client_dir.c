@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:dir]",    \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:dir]",    \
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:dir]",       \
+            bpm_client_err_str (err_type))
+
+/* Our structure */
+struct _bpm_broker_dir_t {
+    uint32_t num_shards;                        /* Number of shards */
+    char **endps;                               /* Endpoint of each shard */
+    bpm_client_t **clients;                     /* Client of each shard. NULL
+                                                   until first used */
+    int verbose;                                /* Settings of the clients */
+    char *log_file_name;
+    int timeout;
+};
+
+bpm_broker_dir_t *bpm_broker_dir_new (char *broker_endp, uint32_t num_shards,
+        int verbose, const char *log_file_name, int timeout)
+{
+    assert (broker_endp);
+    ASSERT_TEST(num_shards > 0, "Invalid number of shards", err_inv_shards);
+
+    bpm_broker_dir_t *self = (bpm_broker_dir_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->num_shards = num_shards;
+    self->verbose = verbose;
+    self->timeout = timeout;
+    if (log_file_name != NULL) {
+        self->log_file_name = strdup (log_file_name);
+        ASSERT_ALLOC(self->log_file_name, err_log_file_name_alloc);
+    }
+
+    self->endps = (char **) zmalloc (num_shards * sizeof (*self->endps));
+    ASSERT_ALLOC(self->endps, err_endps_alloc);
+    self->clients = (bpm_client_t **) zmalloc (num_shards * sizeof (*self->clients));
+    ASSERT_ALLOC(self->clients, err_clients_alloc);
+
+    uint32_t shard;
+    for (shard = 0; shard < num_shards; ++shard) {
+        self->endps [shard] = hutils_broker_shard_endp (broker_endp, shard);
+        ASSERT_ALLOC(self->endps [shard], err_endp_alloc);
+    }
+
+    return self;
+
+err_endp_alloc:
+    while (shard-- > 0) {
+        free (self->endps [shard]);
+    }
+    free (self->clients);
+err_clients_alloc:
+    free (self->endps);
+err_endps_alloc:
+    free (self->log_file_name);
+err_log_file_name_alloc:
+    free (self);
+err_self_alloc:
+err_inv_shards:
+    return NULL;
+}
+
+bpm_broker_dir_t *bpm_broker_dir_new_cfg (const char *cfg_file, int verbose,
+        const char *log_file_name, int timeout)
+{
+    assert (cfg_file);
+
+    bpm_broker_dir_t *self = NULL;
+    zconfig_t *root_cfg = zconfig_load (cfg_file);
+    ASSERT_TEST(root_cfg != NULL, "Could not load configuration file",
+            err_cfg_load);
+
+    char *broker_endp = zconfig_resolve (root_cfg, "/dev_mngr/broker/bind", NULL);
+    ASSERT_TEST(broker_endp != NULL && !streq (broker_endp, ""), "Could not "
+            "find broker endpoint in configuration file", err_cfg_endp);
+
+    /* A single shard if not found */
+    uint32_t num_shards = 1;
+    char *shards_str = zconfig_resolve (root_cfg, "/dev_mngr/broker/shards", NULL);
+    if (shards_str != NULL && !streq (shards_str, "")) {
+        char *endptr = NULL;
+        unsigned long shards = strtoul (shards_str, &endptr, 10);
+        ASSERT_TEST(*endptr == '\0' && shards > 0 && shards <= UINT32_MAX,
+                "Invalid number of broker shards in configuration file",
+                err_cfg_shards);
+        num_shards = (uint32_t) shards;
+    }
+
+    self = bpm_broker_dir_new (broker_endp, num_shards, verbose, log_file_name,
+            timeout);
+
+err_cfg_shards:
+err_cfg_endp:
+    zconfig_destroy (&root_cfg);
+err_cfg_load:
+    return self;
+}
+
+void bpm_broker_dir_destroy (bpm_broker_dir_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_broker_dir_t *self = *self_p;
+
+        for (uint32_t shard = 0; shard < self->num_shards; ++shard) {
+            bpm_client_destroy (&self->clients [shard]);
+            free (self->endps [shard]);
+        }
+        free (self->clients);
+        free (self->endps);
+        free (self->log_file_name);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+uint32_t bpm_broker_dir_get_shards (bpm_broker_dir_t *self)
+{
+    assert (self);
+    return self->num_shards;
+}
+
+uint32_t bpm_broker_dir_lookup (bpm_broker_dir_t *self, const char *service)
+{
+    assert (self);
+    assert (service);
+
+    int64_t board_id = hutils_service_board_id (service);
+    return (board_id < 0) ? 0 : hutils_broker_shard ((uint32_t) board_id,
+            self->num_shards);
+}
+
+const char *bpm_broker_dir_lookup_endp (bpm_broker_dir_t *self,
+        const char *service)
+{
+    return self->endps [bpm_broker_dir_lookup (self, service)];
+}
+
+bpm_client_t *bpm_broker_dir_get_client (bpm_broker_dir_t *self,
+        const char *service)
+{
+    uint32_t shard = bpm_broker_dir_lookup (self, service);
+
+    if (self->clients [shard] == NULL) {
+        self->clients [shard] = bpm_client_new_time (self->endps [shard],
+                self->verbose, self->log_file_name, self->timeout);
+        ASSERT_TEST(self->clients [shard] != NULL, "Could not connect to "
+                "broker shard", err_client_alloc);
+
+        DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_INFO, "[libclient:dir] Connected "
+                "to broker shard %u at %s\n", shard, self->endps [shard]);
+    }
+
+err_client_alloc:
+    return self->clients [shard];
+}
+
+/**************** Crate directory ****************/
+
+/* Service of a crate directory */
+typedef struct {
+    smio_dir_service_t desc;
+    char *ops;
+    void *info;                                 /* NULL if none */
+    size_t info_size;
+} bpm_crate_dir_service_t;
+
+/* Our structure */
+struct _bpm_crate_dir_t {
+    uint32_t num_devios;
+    smio_dir_devio_t *devios;
+    uint32_t num_services;
+    bpm_crate_dir_service_t *services;
+};
+
+static bpm_client_err_e _bpm_crate_dir_parse (bpm_crate_dir_t *self,
+        zmsg_t *reply);
+
+bpm_client_err_e bpm_get_crate_dir (bpm_client_t *client,
+        bpm_crate_dir_t **dir_p)
+{
+    assert (client);
+    assert (dir_p);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    bpm_crate_dir_t *self = (bpm_crate_dir_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, BPM_CLIENT_ERR_ALLOC);
+    int rc = bpm_client_sendto (client, SMIO_DIR_SERVICE, SMIO_DIR_SUBJECT_LIST,
+            bpm_func_sync_tracker_new (client), 0, &msg, false);
+    ASSERT_TEST(rc == 0, "Could not send directory request", err_send,
+            BPM_CLIENT_ERR_SERVER);
+
+    zmsg_t *reply = param_client_recv_timeout (client);
+    ASSERT_TEST(reply != NULL, "Directory was not received", err_recv,
+            BPM_CLIENT_ERR_TIMEOUT);
+
+    err = _bpm_crate_dir_parse (self, reply);
+    zmsg_destroy (&reply);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Malformed directory", err_parse);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient:dir] Crate directory "
+            "with %u DEVIO(s) and %u service(s)\n", self->num_devios,
+            self->num_services);
+    *dir_p = self;
+    return err;
+
+err_parse:
+err_recv:
+err_send:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    bpm_crate_dir_destroy (&self);
+err_self_alloc:
+    return err;
+}
+
+bpm_client_err_e bpm_broker_dir_get_crate_dir (bpm_broker_dir_t *self,
+        bpm_crate_dir_t **dir_p)
+{
+    assert (self);
+
+    /* Shard 0 takes the services with no board ID */
+    bpm_client_t *client = bpm_broker_dir_get_client (self, SMIO_DIR_SERVICE);
+    if (client == NULL) {
+        return BPM_CLIENT_ERR_SERVER;
+    }
+
+    return bpm_get_crate_dir (client, dir_p);
+}
+
+void bpm_crate_dir_destroy (bpm_crate_dir_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_crate_dir_t *self = *self_p;
+
+        for (uint32_t i = 0; self->services != NULL && i < self->num_services; ++i) {
+            free (self->services [i].ops);
+            free (self->services [i].info);
+        }
+        free (self->services);
+        free (self->devios);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+uint32_t bpm_crate_dir_get_num_devios (bpm_crate_dir_t *self)
+{
+    assert (self);
+    return self->num_devios;
+}
+
+const smio_dir_devio_t *bpm_crate_dir_get_devio (bpm_crate_dir_t *self,
+        uint32_t index)
+{
+    assert (self);
+    return (index < self->num_devios) ? &self->devios [index] : NULL;
+}
+
+uint32_t bpm_crate_dir_get_num_services (bpm_crate_dir_t *self)
+{
+    assert (self);
+    return self->num_services;
+}
+
+const smio_dir_service_t *bpm_crate_dir_get_service (bpm_crate_dir_t *self,
+        uint32_t index)
+{
+    assert (self);
+    return (index < self->num_services) ? &self->services [index].desc : NULL;
+}
+
+const char *bpm_crate_dir_get_service_ops (bpm_crate_dir_t *self,
+        uint32_t index)
+{
+    assert (self);
+    return (index < self->num_services) ? self->services [index].ops : NULL;
+}
+
+const void *bpm_crate_dir_get_service_info (bpm_crate_dir_t *self,
+        uint32_t index, size_t *size)
+{
+    assert (self);
+    assert (size);
+
+    if (index >= self->num_services) {
+        *size = 0;
+        return NULL;
+    }
+
+    *size = self->services [index].info_size;
+    return self->services [index].info;
+}
+
+/**************** Helper Functions ***************/
+
+static bpm_client_err_e _bpm_crate_dir_parse (bpm_crate_dir_t *self,
+        zmsg_t *reply)
+{
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    /* Message is:
+     * frame 0: number of DEVIOs
+     * frame 1 .. n: smio_dir_devio_t of each DEVIO
+     * frame n+1 ..: smio_dir_service_t, operation names and information
+     *               of each service */
+    zframe_t *frame = zmsg_first (reply);
+    ASSERT_TEST(frame != NULL && zframe_size (frame) == sizeof (uint32_t),
+            "Invalid number of DEVIOs", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+    uint32_t num_devios = *(uint32_t *) zframe_data (frame);
+
+    size_t num_frames = zmsg_size (reply);
+    ASSERT_TEST(num_frames >= 1 + (size_t) num_devios &&
+            (num_frames - 1 - num_devios) % 3 == 0, "Unexpected number of "
+            "frames", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+    uint32_t num_services = (uint32_t) ((num_frames - 1 - num_devios) / 3);
+
+    if (num_devios > 0) {
+        self->devios = (smio_dir_devio_t *) zmalloc (num_devios *
+                sizeof (*self->devios));
+        ASSERT_ALLOC(self->devios, err_devios_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+    for (uint32_t i = 0; i < num_devios; ++i) {
+        frame = zmsg_next (reply);
+        ASSERT_TEST(zframe_size (frame) == sizeof (smio_dir_devio_t),
+                "Invalid DEVIO", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+        memcpy (&self->devios [i], zframe_data (frame), sizeof (self->devios [i]));
+        self->num_devios++;
+    }
+
+    if (num_services > 0) {
+        self->services = (bpm_crate_dir_service_t *) zmalloc (num_services *
+                sizeof (*self->services));
+        ASSERT_ALLOC(self->services, err_services_alloc, BPM_CLIENT_ERR_ALLOC);
+    }
+    for (uint32_t i = 0; i < num_services; ++i) {
+        bpm_crate_dir_service_t *service = &self->services [i];
+
+        frame = zmsg_next (reply);
+        ASSERT_TEST(zframe_size (frame) == sizeof (smio_dir_service_t),
+                "Invalid service", err_msg_fmt, BPM_CLIENT_ERR_MSG);
+        memcpy (&service->desc, zframe_data (frame), sizeof (service->desc));
+        service->desc.service [sizeof (service->desc.service) - 1] = '\0';
+        /* Counted once there is something to free */
+        self->num_services++;
+
+        frame = zmsg_next (reply);
+        service->ops = zframe_strdup (frame);
+        ASSERT_ALLOC(service->ops, err_ops_alloc, BPM_CLIENT_ERR_ALLOC);
+
+        frame = zmsg_next (reply);
+        service->info_size = zframe_size (frame);
+        if (service->info_size > 0) {
+            service->info = zmalloc (service->info_size);
+            ASSERT_ALLOC(service->info, err_info_alloc, BPM_CLIENT_ERR_ALLOC);
+            memcpy (service->info, zframe_data (frame), service->info_size);
+        }
+    }
+
+err_info_alloc:
+err_ops_alloc:
+err_services_alloc:
+err_devios_alloc:
+err_msg_fmt:
+    return err;
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define BPM_INTEG_X86
+#include <immintrin.h>
+#elif defined (__ARM_NEON)
+#define BPM_INTEG_NEON
+#include <arm_neon.h>
+#endif
+
+/* Return the first sample from "start" to "num_samples" that is not the
+ * previous one plus 1, or "num_samples" if there is none. "start" must be
+ * at least 1, as sample "start" - 1 is compared too */
+typedef size_t (*bpm_integ_find_fp) (const int16_t *data, size_t start,
+        size_t num_samples);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    bpm_integ_find_fp find;
+} bpm_integ_ops_t;
+
+/* Channels of "cur" that are not "prev" plus 1 */
+static uint32_t _bpm_integ_chan_mask (const int16_t *prev, const int16_t *cur)
+{
+    uint32_t mask = 0;
+
+    for (uint32_t c = 0; c < BPM_INTEG_NUM_CHAN; ++c) {
+        if ((uint16_t) (prev [c] + 1) != (uint16_t) cur [c]) {
+            mask |= 1 << c;
+        }
+    }
+
+    return mask;
+}
+
+/************ Scalar kernels **********/
+
+static size_t _bpm_integ_find_scalar (const int16_t *data, size_t start,
+        size_t num_samples)
+{
+    size_t i = start;
+
+    for (; i < num_samples; ++i) {
+        if (_bpm_integ_chan_mask (data + (i-1)*BPM_INTEG_NUM_CHAN,
+                    data + i*BPM_INTEG_NUM_CHAN) != 0) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+#if defined (BPM_INTEG_X86)
+
+/************ SSE2 kernels **********/
+
+/* 2 samples per iteration, compared with the 2 samples one sample before */
+__attribute__ ((target ("sse2")))
+static size_t _bpm_integ_find_sse2 (const int16_t *data, size_t start,
+        size_t num_samples)
+{
+    const __m128i one = _mm_set1_epi16 (1);
+    size_t i = start;
+
+    for (; i + 2 <= num_samples; i += 2) {
+        const int16_t *p = data + i*BPM_INTEG_NUM_CHAN;
+        __m128i cur = _mm_loadu_si128 ((const __m128i *) p);
+        __m128i prev = _mm_loadu_si128 ((const __m128i *) (p - BPM_INTEG_NUM_CHAN));
+
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi16 (_mm_add_epi16 (prev, one),
+                        cur)) != 0xFFFF) {
+            break;
+        }
+    }
+
+    return _bpm_integ_find_scalar (data, i, num_samples);
+}
+
+/************ AVX2 kernels **********/
+
+/* 8 samples per iteration, in 2 vectors of 4 */
+__attribute__ ((target ("avx2")))
+static size_t _bpm_integ_find_avx2 (const int16_t *data, size_t start,
+        size_t num_samples)
+{
+    const __m256i one = _mm256_set1_epi16 (1);
+    size_t i = start;
+
+    for (; i + 8 <= num_samples; i += 8) {
+        const int16_t *p = data + i*BPM_INTEG_NUM_CHAN;
+        const int16_t *q = p - BPM_INTEG_NUM_CHAN;
+        __m256i cur0 = _mm256_loadu_si256 ((const __m256i *) p);
+        __m256i cur1 = _mm256_loadu_si256 ((const __m256i *) (p + 4*BPM_INTEG_NUM_CHAN));
+        __m256i prev0 = _mm256_loadu_si256 ((const __m256i *) q);
+        __m256i prev1 = _mm256_loadu_si256 ((const __m256i *) (q + 4*BPM_INTEG_NUM_CHAN));
+
+        __m256i eq = _mm256_and_si256 (
+                _mm256_cmpeq_epi16 (_mm256_add_epi16 (prev0, one), cur0),
+                _mm256_cmpeq_epi16 (_mm256_add_epi16 (prev1, one), cur1));
+        if (_mm256_movemask_epi8 (eq) != -1) {
+            break;
+        }
+    }
+
+    return _bpm_integ_find_scalar (data, i, num_samples);
+}
+
+#endif
+
+#if defined (BPM_INTEG_NEON)
+
+/************ NEON kernels **********/
+
+/* 2 samples per iteration, as the SSE2 one */
+static size_t _bpm_integ_find_neon (const int16_t *data, size_t start,
+        size_t num_samples)
+{
+    const int16x8_t one = vdupq_n_s16 (1);
+    size_t i = start;
+
+    for (; i + 2 <= num_samples; i += 2) {
+        const int16_t *p = data + i*BPM_INTEG_NUM_CHAN;
+        int16x8_t cur = vld1q_s16 (p);
+        int16x8_t prev = vld1q_s16 (p - BPM_INTEG_NUM_CHAN);
+
+        uint64x2_t eq = vreinterpretq_u64_u16 (vceqq_s16 (vaddq_s16 (prev, one), cur));
+        if ((vgetq_lane_u64 (eq, 0) & vgetq_lane_u64 (eq, 1)) != UINT64_MAX) {
+            break;
+        }
+    }
+
+    return _bpm_integ_find_scalar (data, i, num_samples);
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used */
+static const bpm_integ_ops_t bpm_integ_ops [] = {
+#if defined (BPM_INTEG_X86)
+    {.name = "avx2",    .find = _bpm_integ_find_avx2},
+    {.name = "sse2",    .find = _bpm_integ_find_sse2},
+#endif
+#if defined (BPM_INTEG_NEON)
+    {.name = "neon",    .find = _bpm_integ_find_neon},
+#endif
+    {.name = "scalar",  .find = _bpm_integ_find_scalar}
+};
+
+#define BPM_INTEG_OPS_NUM               (sizeof (bpm_integ_ops) / \
+                                            sizeof (bpm_integ_ops [0]))
+
+static bool _bpm_integ_supported (const bpm_integ_ops_t *ops)
+{
+#if defined (BPM_INTEG_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "avx2")) {
+        return __builtin_cpu_supports ("avx2");
+    }
+    if (streq (ops->name, "sse2")) {
+        return __builtin_cpu_supports ("sse2");
+    }
+#endif
+    (void) ops;
+    return true;
+}
+
+static const bpm_integ_ops_t *_bpm_integ_get_ops (void)
+{
+    /* Selecting it twice from different threads is harmless */
+    static const bpm_integ_ops_t *ops = NULL;
+
+    if (ops == NULL) {
+        size_t i;
+        for (i = 0; i < BPM_INTEG_OPS_NUM - 1; ++i) {
+            if (_bpm_integ_supported (&bpm_integ_ops [i])) {
+                break;
+            }
+        }
+        /* The scalar kernel is always supported */
+        ops = &bpm_integ_ops [i];
+    }
+
+    return ops;
+}
+
+const char *bpm_integ_kernel_name (void)
+{
+    return _bpm_integ_get_ops ()->name;
+}
+
+void bpm_integ_reset (bpm_integ_state_t *state)
+{
+    assert (state);
+    memset (state, 0, sizeof (*state));
+}
+
+/* Count the gap of sample "i" of "data", after "prev", and report it if
+ * there is room left */
+static size_t _bpm_integ_gap (bpm_integ_state_t *state, const int16_t *prev,
+        const int16_t *data, size_t i, bpm_integ_gap_t *gaps, size_t num_gaps,
+        size_t max_gaps)
+{
+    const int16_t *cur = data + i*BPM_INTEG_NUM_CHAN;
+
+    ++state->num_gaps;
+    if (num_gaps >= max_gaps) {
+        return num_gaps;
+    }
+
+    bpm_integ_gap_t *gap = &gaps [num_gaps];
+    gap->offset = state->num_samples + i;
+    gap->chan_mask = _bpm_integ_chan_mask (prev, cur);
+    for (uint32_t c = 0; c < BPM_INTEG_NUM_CHAN; ++c) {
+        gap->expected [c] = (int16_t) (uint16_t) (prev [c] + 1);
+        gap->found [c] = cur [c];
+    }
+
+    return num_gaps + 1;
+}
+
+size_t bpm_integ_check (bpm_integ_state_t *state, const int16_t *data,
+        size_t num_samples, bpm_integ_gap_t *gaps, size_t max_gaps)
+{
+    assert (state);
+    assert (data || num_samples == 0);
+    assert (gaps || max_gaps == 0);
+
+    if (num_samples == 0) {
+        return 0;
+    }
+
+    size_t num_gaps = 0;
+    /* The first sample follows the last one of the previous block */
+    if (state->num_samples > 0 &&
+            _bpm_integ_chan_mask (state->last, data) != 0) {
+        num_gaps = _bpm_integ_gap (state, state->last, data, 0, gaps, num_gaps,
+                max_gaps);
+    }
+
+    const bpm_integ_find_fp find = _bpm_integ_get_ops ()->find;
+    for (size_t i = find (data, 1, num_samples); i < num_samples;
+            i = find (data, i + 1, num_samples)) {
+        num_gaps = _bpm_integ_gap (state, data + (i-1)*BPM_INTEG_NUM_CHAN,
+                data, i, gaps, num_gaps, max_gaps);
+    }
+
+    memcpy (state->last, data + (num_samples-1)*BPM_INTEG_NUM_CHAN,
+            sizeof (state->last));
+    state->num_samples += num_samples;
+
+    return num_gaps;
+}
@@ -0,0 +1,493 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define BPM_POS_X86
+#include <immintrin.h>
+#elif defined (__aarch64__)
+/* Vector division is only available on AArch64 */
+#define BPM_POS_NEON
+#include <arm_neon.h>
+#endif
+
+/* Largest KX, KY and KSUM accepted by the POS_CALC core */
+#define BPM_POS_K_MAX                   ((1 << 25) - 1)
+#define BPM_POS_Q_UNITY                 (1 << BPM_POS_Q_FRAC_BITS)
+
+/* Parameters in the precision of each of the calculations. The fixed-point
+ * one is carried in double precision, which holds the sums and the deltas of
+ * 32-bit amplitudes exactly, so every kernel rounds at the same steps */
+typedef struct {
+    double kx;
+    double ky;
+    double ksum;
+    double thres;
+} bpm_pos_fix_k_t;
+
+typedef struct {
+    float kx;
+    float ky;
+    float ksum;
+    float thres;
+} bpm_pos_float_k_t;
+
+typedef void (*bpm_pos_fix_fp) (uint32_t *data, size_t num_samples,
+        const bpm_pos_fix_k_t *k);
+typedef void (*bpm_pos_float_fp) (float *data, size_t num_samples,
+        const bpm_pos_float_k_t *k);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    bpm_pos_fix_fp fix;
+    bpm_pos_float_fp flt;
+} bpm_pos_ops_t;
+
+/************ Scalar kernels **********/
+
+static void _bpm_pos_fix_scalar (uint32_t *data, size_t num_samples,
+        const bpm_pos_fix_k_t *k)
+{
+    for (size_t i = 0; i < num_samples; ++i) {
+        uint32_t *p = data + i*BPM_POS_NUM_CHAN;
+        double a = p [0], b = p [1], c = p [2], d = p [3];
+        double s = a + b + c + d;
+        bool valid = s > 0 && s >= k->thres;
+
+        double sum = s * k->ksum;
+        if (sum > INT32_MAX) {
+            sum = INT32_MAX;
+        }
+
+        p [0] = valid ? (int32_t) (((a + d) - (b + c)) / s * k->kx) : 0;
+        p [1] = valid ? (int32_t) (((a + b) - (c + d)) / s * k->ky) : 0;
+        p [2] = valid ? (int32_t) (((a + c) - (b + d)) / s * BPM_POS_Q_UNITY) : 0;
+        p [3] = (int32_t) sum;
+    }
+}
+
+static void _bpm_pos_float_scalar (float *data, size_t num_samples,
+        const bpm_pos_float_k_t *k)
+{
+    for (size_t i = 0; i < num_samples; ++i) {
+        float *p = data + i*BPM_POS_NUM_CHAN;
+        float a = p [0], b = p [1], c = p [2], d = p [3];
+        float s = (a + b) + (c + d);
+        bool valid = s > 0 && s >= k->thres;
+
+        p [0] = valid ? ((a + d) - (b + c)) / s * k->kx : 0;
+        p [1] = valid ? ((a + b) - (c + d)) / s * k->ky : 0;
+        p [2] = valid ? ((a + c) - (b + d)) / s : 0;
+        p [3] = s * k->ksum;
+    }
+}
+
+#if defined (BPM_POS_X86)
+
+/************ SSE2 kernels **********/
+
+/* Transpose 4 samples of 4 channels into 4 channels of 4 samples, and back */
+__attribute__ ((target ("sse2")))
+static inline void _bpm_pos_transpose_sse2 (__m128i v [BPM_POS_NUM_CHAN])
+{
+    __m128i t0 = _mm_unpacklo_epi32 (v [0], v [1]);
+    __m128i t1 = _mm_unpacklo_epi32 (v [2], v [3]);
+    __m128i t2 = _mm_unpackhi_epi32 (v [0], v [1]);
+    __m128i t3 = _mm_unpackhi_epi32 (v [2], v [3]);
+
+    v [0] = _mm_unpacklo_epi64 (t0, t1);
+    v [1] = _mm_unpackhi_epi64 (t0, t1);
+    v [2] = _mm_unpacklo_epi64 (t2, t3);
+    v [3] = _mm_unpackhi_epi64 (t2, t3);
+}
+
+/* Unsigned 32-bit to double. The sign flip makes them fit the signed
+ * conversion, and is undone exactly in double precision */
+__attribute__ ((target ("sse2")))
+static inline __m128d _bpm_pos_u32_pd_sse2 (__m128i v)
+{
+    v = _mm_xor_si128 (v, _mm_set1_epi32 (INT32_MIN));
+    return _mm_add_pd (_mm_cvtepi32_pd (v), _mm_set1_pd (-(double) INT32_MIN));
+}
+
+/* X, Y, Q and SUM of 2 samples, in the low half of each of "out" */
+__attribute__ ((target ("sse2")))
+static inline void _bpm_pos_fix_pd_sse2 (__m128d a, __m128d b, __m128d c,
+        __m128d d, const bpm_pos_fix_k_t *k, __m128i out [BPM_POS_NUM_CHAN])
+{
+    __m128d s = _mm_add_pd (_mm_add_pd (_mm_add_pd (a, b), c), d);
+    __m128d valid = _mm_and_pd (_mm_cmpgt_pd (s, _mm_setzero_pd ()),
+            _mm_cmpge_pd (s, _mm_set1_pd (k->thres)));
+
+    __m128d x = _mm_sub_pd (_mm_add_pd (a, d), _mm_add_pd (b, c));
+    __m128d y = _mm_sub_pd (_mm_add_pd (a, b), _mm_add_pd (c, d));
+    __m128d q = _mm_sub_pd (_mm_add_pd (a, c), _mm_add_pd (b, d));
+    x = _mm_mul_pd (_mm_div_pd (x, s), _mm_set1_pd (k->kx));
+    y = _mm_mul_pd (_mm_div_pd (y, s), _mm_set1_pd (k->ky));
+    q = _mm_mul_pd (_mm_div_pd (q, s), _mm_set1_pd (BPM_POS_Q_UNITY));
+
+    out [0] = _mm_cvttpd_epi32 (_mm_and_pd (valid, x));
+    out [1] = _mm_cvttpd_epi32 (_mm_and_pd (valid, y));
+    out [2] = _mm_cvttpd_epi32 (_mm_and_pd (valid, q));
+    out [3] = _mm_cvttpd_epi32 (_mm_min_pd (_mm_mul_pd (s,
+                    _mm_set1_pd (k->ksum)), _mm_set1_pd (INT32_MAX)));
+}
+
+/* 4 samples per iteration, in two halves of 2 samples */
+__attribute__ ((target ("sse2")))
+static void _bpm_pos_fix_sse2 (uint32_t *data, size_t num_samples,
+        const bpm_pos_fix_k_t *k)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        __m128i *p = (__m128i *) (data + i*BPM_POS_NUM_CHAN);
+        __m128i v [BPM_POS_NUM_CHAN] = {_mm_loadu_si128 (p),
+            _mm_loadu_si128 (p + 1), _mm_loadu_si128 (p + 2),
+            _mm_loadu_si128 (p + 3)};
+        __m128i lo [BPM_POS_NUM_CHAN];
+        __m128i hi [BPM_POS_NUM_CHAN];
+
+        _bpm_pos_transpose_sse2 (v);
+        _bpm_pos_fix_pd_sse2 (_bpm_pos_u32_pd_sse2 (v [0]),
+                _bpm_pos_u32_pd_sse2 (v [1]), _bpm_pos_u32_pd_sse2 (v [2]),
+                _bpm_pos_u32_pd_sse2 (v [3]), k, lo);
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            v [c] = _mm_shuffle_epi32 (v [c], _MM_SHUFFLE(1, 0, 3, 2));
+        }
+        _bpm_pos_fix_pd_sse2 (_bpm_pos_u32_pd_sse2 (v [0]),
+                _bpm_pos_u32_pd_sse2 (v [1]), _bpm_pos_u32_pd_sse2 (v [2]),
+                _bpm_pos_u32_pd_sse2 (v [3]), k, hi);
+
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            v [c] = _mm_unpacklo_epi64 (lo [c], hi [c]);
+        }
+        _bpm_pos_transpose_sse2 (v);
+
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            _mm_storeu_si128 (p + c, v [c]);
+        }
+    }
+
+    _bpm_pos_fix_scalar (data + i*BPM_POS_NUM_CHAN, num_samples - i, k);
+}
+
+/* X, Y, Q and SUM of 4 samples, one channel per vector */
+__attribute__ ((target ("sse2")))
+static inline void _bpm_pos_float_ps_sse2 (__m128 v [BPM_POS_NUM_CHAN],
+        const bpm_pos_float_k_t *k)
+{
+    __m128 s = _mm_add_ps (_mm_add_ps (v [0], v [1]), _mm_add_ps (v [2], v [3]));
+    __m128 valid = _mm_and_ps (_mm_cmpgt_ps (s, _mm_setzero_ps ()),
+            _mm_cmpge_ps (s, _mm_set1_ps (k->thres)));
+
+    __m128 x = _mm_sub_ps (_mm_add_ps (v [0], v [3]), _mm_add_ps (v [1], v [2]));
+    __m128 y = _mm_sub_ps (_mm_add_ps (v [0], v [1]), _mm_add_ps (v [2], v [3]));
+    __m128 q = _mm_sub_ps (_mm_add_ps (v [0], v [2]), _mm_add_ps (v [1], v [3]));
+
+    v [0] = _mm_and_ps (valid, _mm_mul_ps (_mm_div_ps (x, s), _mm_set1_ps (k->kx)));
+    v [1] = _mm_and_ps (valid, _mm_mul_ps (_mm_div_ps (y, s), _mm_set1_ps (k->ky)));
+    v [2] = _mm_and_ps (valid, _mm_div_ps (q, s));
+    v [3] = _mm_mul_ps (s, _mm_set1_ps (k->ksum));
+}
+
+__attribute__ ((target ("sse2")))
+static void _bpm_pos_float_sse2 (float *data, size_t num_samples,
+        const bpm_pos_float_k_t *k)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        float *p = data + i*BPM_POS_NUM_CHAN;
+        __m128 v [BPM_POS_NUM_CHAN] = {_mm_loadu_ps (p),
+            _mm_loadu_ps (p + 4), _mm_loadu_ps (p + 8), _mm_loadu_ps (p + 12)};
+
+        _MM_TRANSPOSE4_PS (v [0], v [1], v [2], v [3]);
+        _bpm_pos_float_ps_sse2 (v, k);
+        _MM_TRANSPOSE4_PS (v [0], v [1], v [2], v [3]);
+
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            _mm_storeu_ps (p + c*4, v [c]);
+        }
+    }
+
+    _bpm_pos_float_scalar (data + i*BPM_POS_NUM_CHAN, num_samples - i, k);
+}
+
+/************ AVX kernels **********/
+
+/* 4 samples per iteration, all of them in a double precision vector */
+__attribute__ ((target ("avx")))
+static void _bpm_pos_fix_avx (uint32_t *data, size_t num_samples,
+        const bpm_pos_fix_k_t *k)
+{
+    const __m256d bias = _mm256_set1_pd (-(double) INT32_MIN);
+    const __m128i flip = _mm_set1_epi32 (INT32_MIN);
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        __m128i *p = (__m128i *) (data + i*BPM_POS_NUM_CHAN);
+        __m128i v [BPM_POS_NUM_CHAN] = {_mm_loadu_si128 (p),
+            _mm_loadu_si128 (p + 1), _mm_loadu_si128 (p + 2),
+            _mm_loadu_si128 (p + 3)};
+
+        _bpm_pos_transpose_sse2 (v);
+        __m256d a = _mm256_add_pd (_mm256_cvtepi32_pd (_mm_xor_si128 (v [0], flip)), bias);
+        __m256d b = _mm256_add_pd (_mm256_cvtepi32_pd (_mm_xor_si128 (v [1], flip)), bias);
+        __m256d c = _mm256_add_pd (_mm256_cvtepi32_pd (_mm_xor_si128 (v [2], flip)), bias);
+        __m256d d = _mm256_add_pd (_mm256_cvtepi32_pd (_mm_xor_si128 (v [3], flip)), bias);
+
+        __m256d s = _mm256_add_pd (_mm256_add_pd (_mm256_add_pd (a, b), c), d);
+        __m256d valid = _mm256_and_pd (
+                _mm256_cmp_pd (s, _mm256_setzero_pd (), _CMP_GT_OQ),
+                _mm256_cmp_pd (s, _mm256_set1_pd (k->thres), _CMP_GE_OQ));
+
+        __m256d x = _mm256_sub_pd (_mm256_add_pd (a, d), _mm256_add_pd (b, c));
+        __m256d y = _mm256_sub_pd (_mm256_add_pd (a, b), _mm256_add_pd (c, d));
+        __m256d q = _mm256_sub_pd (_mm256_add_pd (a, c), _mm256_add_pd (b, d));
+        x = _mm256_mul_pd (_mm256_div_pd (x, s), _mm256_set1_pd (k->kx));
+        y = _mm256_mul_pd (_mm256_div_pd (y, s), _mm256_set1_pd (k->ky));
+        q = _mm256_mul_pd (_mm256_div_pd (q, s), _mm256_set1_pd (BPM_POS_Q_UNITY));
+
+        v [0] = _mm256_cvttpd_epi32 (_mm256_and_pd (valid, x));
+        v [1] = _mm256_cvttpd_epi32 (_mm256_and_pd (valid, y));
+        v [2] = _mm256_cvttpd_epi32 (_mm256_and_pd (valid, q));
+        v [3] = _mm256_cvttpd_epi32 (_mm256_min_pd (_mm256_mul_pd (s,
+                        _mm256_set1_pd (k->ksum)), _mm256_set1_pd (INT32_MAX)));
+        _bpm_pos_transpose_sse2 (v);
+
+        for (uint32_t ch = 0; ch < BPM_POS_NUM_CHAN; ++ch) {
+            _mm_storeu_si128 (p + ch, v [ch]);
+        }
+    }
+
+    _bpm_pos_fix_scalar (data + i*BPM_POS_NUM_CHAN, num_samples - i, k);
+}
+
+/* 8 samples per iteration, transposed in two blocks of 4 that end up in the
+ * two lanes of each vector */
+__attribute__ ((target ("avx")))
+static void _bpm_pos_float_avx (float *data, size_t num_samples,
+        const bpm_pos_float_k_t *k)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= num_samples; i += 8) {
+        float *p = data + i*BPM_POS_NUM_CHAN;
+        __m128 lo [BPM_POS_NUM_CHAN] = {_mm_loadu_ps (p),
+            _mm_loadu_ps (p + 4), _mm_loadu_ps (p + 8), _mm_loadu_ps (p + 12)};
+        __m128 hi [BPM_POS_NUM_CHAN] = {_mm_loadu_ps (p + 16),
+            _mm_loadu_ps (p + 20), _mm_loadu_ps (p + 24), _mm_loadu_ps (p + 28)};
+        __m256 v [BPM_POS_NUM_CHAN];
+
+        _MM_TRANSPOSE4_PS (lo [0], lo [1], lo [2], lo [3]);
+        _MM_TRANSPOSE4_PS (hi [0], hi [1], hi [2], hi [3]);
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            v [c] = _mm256_insertf128_ps (_mm256_castps128_ps256 (lo [c]), hi [c], 1);
+        }
+
+        __m256 s = _mm256_add_ps (_mm256_add_ps (v [0], v [1]),
+                _mm256_add_ps (v [2], v [3]));
+        __m256 valid = _mm256_and_ps (
+                _mm256_cmp_ps (s, _mm256_setzero_ps (), _CMP_GT_OQ),
+                _mm256_cmp_ps (s, _mm256_set1_ps (k->thres), _CMP_GE_OQ));
+
+        __m256 x = _mm256_sub_ps (_mm256_add_ps (v [0], v [3]), _mm256_add_ps (v [1], v [2]));
+        __m256 y = _mm256_sub_ps (_mm256_add_ps (v [0], v [1]), _mm256_add_ps (v [2], v [3]));
+        __m256 q = _mm256_sub_ps (_mm256_add_ps (v [0], v [2]), _mm256_add_ps (v [1], v [3]));
+
+        v [0] = _mm256_and_ps (valid, _mm256_mul_ps (_mm256_div_ps (x, s), _mm256_set1_ps (k->kx)));
+        v [1] = _mm256_and_ps (valid, _mm256_mul_ps (_mm256_div_ps (y, s), _mm256_set1_ps (k->ky)));
+        v [2] = _mm256_and_ps (valid, _mm256_div_ps (q, s));
+        v [3] = _mm256_mul_ps (s, _mm256_set1_ps (k->ksum));
+
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            lo [c] = _mm256_castps256_ps128 (v [c]);
+            hi [c] = _mm256_extractf128_ps (v [c], 1);
+        }
+        _MM_TRANSPOSE4_PS (lo [0], lo [1], lo [2], lo [3]);
+        _MM_TRANSPOSE4_PS (hi [0], hi [1], hi [2], hi [3]);
+
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            _mm_storeu_ps (p + c*4, lo [c]);
+            _mm_storeu_ps (p + 16 + c*4, hi [c]);
+        }
+    }
+
+    _bpm_pos_float_sse2 (data + i*BPM_POS_NUM_CHAN, num_samples - i, k);
+}
+
+#endif
+
+#if defined (BPM_POS_NEON)
+
+/************ NEON kernels **********/
+
+/* X, Y, Q or SUM of 2 samples, truncated to 32-bit */
+static inline int32x2_t _bpm_pos_s32_neon (float64x2_t v)
+{
+    return vmovn_s64 (vcvtq_s64_f64 (v));
+}
+
+/* 4 samples per iteration, deinterleaved by the load itself and computed in
+ * two halves of 2 samples */
+static void _bpm_pos_fix_neon (uint32_t *data, size_t num_samples,
+        const bpm_pos_fix_k_t *k)
+{
+    const float64x2_t zero = vdupq_n_f64 (0);
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        uint32_t *p = data + i*BPM_POS_NUM_CHAN;
+        uint32x4x4_t v = vld4q_u32 (p);
+        int32x2_t out [2][BPM_POS_NUM_CHAN];
+
+        for (uint32_t h = 0; h < 2; ++h) {
+            float64x2_t ch [BPM_POS_NUM_CHAN];
+            for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+                uint32x2_t half = h ? vget_high_u32 (v.val [c]) : vget_low_u32 (v.val [c]);
+                ch [c] = vcvtq_f64_u64 (vmovl_u32 (half));
+            }
+
+            float64x2_t s = vaddq_f64 (vaddq_f64 (vaddq_f64 (ch [0], ch [1]), ch [2]), ch [3]);
+            uint64x2_t valid = vandq_u64 (vcgtq_f64 (s, zero),
+                    vcgeq_f64 (s, vdupq_n_f64 (k->thres)));
+
+            float64x2_t x = vsubq_f64 (vaddq_f64 (ch [0], ch [3]), vaddq_f64 (ch [1], ch [2]));
+            float64x2_t y = vsubq_f64 (vaddq_f64 (ch [0], ch [1]), vaddq_f64 (ch [2], ch [3]));
+            float64x2_t q = vsubq_f64 (vaddq_f64 (ch [0], ch [2]), vaddq_f64 (ch [1], ch [3]));
+            x = vmulq_n_f64 (vdivq_f64 (x, s), k->kx);
+            y = vmulq_n_f64 (vdivq_f64 (y, s), k->ky);
+            q = vmulq_n_f64 (vdivq_f64 (q, s), BPM_POS_Q_UNITY);
+
+            out [h][0] = _bpm_pos_s32_neon (vbslq_f64 (valid, x, zero));
+            out [h][1] = _bpm_pos_s32_neon (vbslq_f64 (valid, y, zero));
+            out [h][2] = _bpm_pos_s32_neon (vbslq_f64 (valid, q, zero));
+            out [h][3] = _bpm_pos_s32_neon (vminq_f64 (vmulq_n_f64 (s, k->ksum),
+                        vdupq_n_f64 (INT32_MAX)));
+        }
+
+        for (uint32_t c = 0; c < BPM_POS_NUM_CHAN; ++c) {
+            v.val [c] = vreinterpretq_u32_s32 (vcombine_s32 (out [0][c], out [1][c]));
+        }
+        vst4q_u32 (p, v);
+    }
+
+    _bpm_pos_fix_scalar (data + i*BPM_POS_NUM_CHAN, num_samples - i, k);
+}
+
+static void _bpm_pos_float_neon (float *data, size_t num_samples,
+        const bpm_pos_float_k_t *k)
+{
+    const float32x4_t zero = vdupq_n_f32 (0);
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        float *p = data + i*BPM_POS_NUM_CHAN;
+        float32x4x4_t v = vld4q_f32 (p);
+
+        float32x4_t s = vaddq_f32 (vaddq_f32 (v.val [0], v.val [1]),
+                vaddq_f32 (v.val [2], v.val [3]));
+        uint32x4_t valid = vandq_u32 (vcgtq_f32 (s, zero),
+                vcgeq_f32 (s, vdupq_n_f32 (k->thres)));
+
+        float32x4_t x = vsubq_f32 (vaddq_f32 (v.val [0], v.val [3]), vaddq_f32 (v.val [1], v.val [2]));
+        float32x4_t y = vsubq_f32 (vaddq_f32 (v.val [0], v.val [1]), vaddq_f32 (v.val [2], v.val [3]));
+        float32x4_t q = vsubq_f32 (vaddq_f32 (v.val [0], v.val [2]), vaddq_f32 (v.val [1], v.val [3]));
+
+        v.val [0] = vbslq_f32 (valid, vmulq_n_f32 (vdivq_f32 (x, s), k->kx), zero);
+        v.val [1] = vbslq_f32 (valid, vmulq_n_f32 (vdivq_f32 (y, s), k->ky), zero);
+        v.val [2] = vbslq_f32 (valid, vdivq_f32 (q, s), zero);
+        v.val [3] = vmulq_n_f32 (s, k->ksum);
+        vst4q_f32 (p, v);
+    }
+
+    _bpm_pos_float_scalar (data + i*BPM_POS_NUM_CHAN, num_samples - i, k);
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used */
+static const bpm_pos_ops_t bpm_pos_ops [] = {
+#if defined (BPM_POS_X86)
+    {.name = "avx",     .fix = _bpm_pos_fix_avx,    .flt = _bpm_pos_float_avx},
+    {.name = "sse2",    .fix = _bpm_pos_fix_sse2,   .flt = _bpm_pos_float_sse2},
+#endif
+#if defined (BPM_POS_NEON)
+    {.name = "neon",    .fix = _bpm_pos_fix_neon,   .flt = _bpm_pos_float_neon},
+#endif
+    {.name = "scalar",  .fix = _bpm_pos_fix_scalar, .flt = _bpm_pos_float_scalar}
+};
+
+#define BPM_POS_OPS_NUM                 (sizeof (bpm_pos_ops) / \
+                                            sizeof (bpm_pos_ops [0]))
+
+static bool _bpm_pos_supported (const bpm_pos_ops_t *ops)
+{
+#if defined (BPM_POS_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "avx")) {
+        return __builtin_cpu_supports ("avx");
+    }
+    if (streq (ops->name, "sse2")) {
+        return __builtin_cpu_supports ("sse2");
+    }
+#endif
+    /* NEON is part of AArch64 */
+    (void) ops;
+    return true;
+}
+
+static const bpm_pos_ops_t *_bpm_pos_get_ops (void)
+{
+    /* Selecting it twice from different threads is harmless */
+    static const bpm_pos_ops_t *ops = NULL;
+
+    if (ops == NULL) {
+        size_t i;
+        for (i = 0; i < BPM_POS_OPS_NUM - 1; ++i) {
+            if (_bpm_pos_supported (&bpm_pos_ops [i])) {
+                break;
+            }
+        }
+        /* The scalar kernel is always supported */
+        ops = &bpm_pos_ops [i];
+    }
+
+    return ops;
+}
+
+const char *bpm_pos_kernel_name (void)
+{
+    return _bpm_pos_get_ops ()->name;
+}
+
+void bpm_pos_calc (uint32_t *data, size_t num_samples, const bpm_pos_k_t *k)
+{
+    assert (data);
+    assert (k);
+    assert (k->kx <= BPM_POS_K_MAX && k->ky <= BPM_POS_K_MAX &&
+            k->ksum <= BPM_POS_K_MAX);
+
+    const bpm_pos_fix_k_t kd = {.kx = k->kx, .ky = k->ky, .ksum = k->ksum,
+        .thres = k->thres};
+    _bpm_pos_get_ops ()->fix (data, num_samples, &kd);
+}
+
+void bpm_pos_calc_float (float *data, size_t num_samples, const bpm_pos_k_t *k)
+{
+    assert (data);
+    assert (k);
+
+    const bpm_pos_float_k_t kf = {.kx = k->kx, .ky = k->ky, .ksum = k->ksum,
+        .thres = k->thres};
+    _bpm_pos_get_ops ()->flt (data, num_samples, &kf);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define BPM_PSTREAM_CPU_RELAX()         _mm_pause ()
+#else
+#define BPM_PSTREAM_CPU_RELAX()         do {} while (0)
+#endif
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:pstream]", \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:pstream]", \
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:pstream]",   \
+            bpm_client_err_str (err_type))
+
+struct _bpm_pstream_t {
+    const smio_acq_pstream_hdr_t *hdr;  /* Mapped ring */
+    size_t size;                        /* Size of the mapping */
+    const uint8_t *data;                /* Samples of the ring */
+    uint64_t cursor;                    /* Next sample to read */
+    uint64_t lost;                      /* Samples skipped */
+};
+
+static void _bpm_pstream_copy (bpm_pstream_t *self, uint8_t *data,
+        uint64_t pos, uint32_t num_samples);
+
+bpm_pstream_t *bpm_pstream_open (const char *service)
+{
+    assert (service);
+
+    char shm_name [ACQ_SHM_NAME_MAX_LEN];
+    int rc = snprintf (shm_name, sizeof (shm_name), "%s%s",
+            ACQ_PSTREAM_SHM_NAME_PREFIX, service);
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (shm_name),
+           "Shared memory name is too long", err_shm_name);
+
+    int fd = shm_open (shm_name, O_RDONLY, 0);
+    ASSERT_TEST(fd >= 0, "Could not open shared memory object", err_shm_open);
+
+    struct stat shm_stat;
+    rc = fstat (fd, &shm_stat);
+    ASSERT_TEST(rc == 0 && (size_t) shm_stat.st_size >= sizeof (smio_acq_pstream_hdr_t),
+            "Position stream has an unexpected size", err_shm_stat);
+
+    size_t size = shm_stat.st_size;
+    void *buf = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    ASSERT_TEST(buf != MAP_FAILED, "Could not map shared memory region",
+            err_shm_mmap);
+    /* The mapping stays valid after closing the descriptor */
+    close (fd);
+
+    /* The rest of the header is valid once the magic is */
+    const smio_acq_pstream_hdr_t *hdr = (const smio_acq_pstream_hdr_t *) buf;
+    ASSERT_TEST(__atomic_load_n (&hdr->magic, __ATOMIC_ACQUIRE) == ACQ_PSTREAM_MAGIC &&
+            hdr->version == ACQ_PSTREAM_VERSION &&
+            hdr->data_offs + (uint64_t) hdr->capacity * hdr->sample_size <= size,
+            "Position stream is not valid", err_hdr_inv);
+
+    bpm_pstream_t *self = (bpm_pstream_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+    self->hdr = hdr;
+    self->size = size;
+    self->data = (const uint8_t *) buf + hdr->data_offs;
+    self->cursor = __atomic_load_n (&hdr->head, __ATOMIC_ACQUIRE);
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_INFO, "[libclient:pstream] Mapped "
+            "position stream %s of %u samples of channel %u\n", shm_name,
+            hdr->capacity, hdr->chan);
+
+    return self;
+
+err_self_alloc:
+err_hdr_inv:
+    munmap (buf, size);
+    return NULL;
+err_shm_mmap:
+err_shm_stat:
+    close (fd);
+err_shm_open:
+err_shm_name:
+    return NULL;
+}
+
+void bpm_pstream_close (bpm_pstream_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_pstream_t *self = *self_p;
+
+        munmap ((void *) self->hdr, self->size);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+uint32_t bpm_pstream_get_chan (bpm_pstream_t *self)
+{
+    assert (self);
+    return self->hdr->chan;
+}
+
+uint32_t bpm_pstream_get_sample_size (bpm_pstream_t *self)
+{
+    assert (self);
+    return self->hdr->sample_size;
+}
+
+uint64_t bpm_pstream_get_lost (bpm_pstream_t *self)
+{
+    assert (self);
+    return self->lost;
+}
+
+bpm_client_err_e bpm_pstream_read (bpm_pstream_t *self, void *data,
+        uint32_t max_samples, int64_t timeout_us, uint32_t *num_samples,
+        uint64_t *start)
+{
+    assert (self);
+    assert (data);
+    assert (num_samples);
+
+    const smio_acq_pstream_hdr_t *hdr = self->hdr;
+    uint64_t capacity = hdr->capacity;
+    int64_t deadline = (timeout_us < 0) ? -1 : zclock_usecs () + timeout_us;
+    *num_samples = 0;
+
+    while (1) {
+        uint64_t head = __atomic_load_n (&hdr->head, __ATOMIC_ACQUIRE);
+
+        if (head > self->cursor && max_samples > 0) {
+            uint64_t n = head - self->cursor;
+            n = (n > max_samples) ? max_samples : n;
+            n = (n > capacity) ? capacity : n;
+            _bpm_pstream_copy (self, (uint8_t *) data, self->cursor, n);
+            __atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+            /* Samples below reserve - capacity may have been overwritten
+             * while we copied them */
+            uint64_t reserve = __atomic_load_n (&hdr->reserve, __ATOMIC_RELAXED);
+            if (reserve > capacity && self->cursor < reserve - capacity) {
+                self->lost += reserve - capacity - self->cursor;
+                self->cursor = reserve - capacity;
+                continue;
+            }
+
+            if (start != NULL) {
+                *start = self->cursor;
+            }
+            *num_samples = n;
+            self->cursor += n;
+            return BPM_CLIENT_SUCCESS;
+        }
+
+        /* Once stopped, nothing is written after the last head */
+        if (head <= self->cursor &&
+                (__atomic_load_n (&hdr->flags, __ATOMIC_ACQUIRE) & ACQ_PSTREAM_FLAG_STOPPED) &&
+                __atomic_load_n (&hdr->head, __ATOMIC_ACQUIRE) == head) {
+            return BPM_CLIENT_ERR_SERVER;
+        }
+
+        if (deadline >= 0 && zclock_usecs () >= deadline) {
+            return BPM_CLIENT_ERR_TIMEOUT;
+        }
+        BPM_PSTREAM_CPU_RELAX ();
+    }
+}
+
+/***************** Static functions *****************/
+
+/* Copy "num_samples" samples from sample "pos" on, wrapping around the
+ * end of the ring */
+static void _bpm_pstream_copy (bpm_pstream_t *self, uint8_t *data,
+        uint64_t pos, uint32_t num_samples)
+{
+    uint32_t capacity = self->hdr->capacity;
+    uint32_t sample_size = self->hdr->sample_size;
+    uint32_t slot = pos & (capacity - 1);
+    uint32_t n = (num_samples > capacity - slot) ? capacity - slot : num_samples;
+
+    memcpy (data, self->data + (size_t) slot * sample_size,
+            (size_t) n * sample_size);
+    if (n < num_samples) {
+        memcpy (data + (size_t) n * sample_size, self->data,
+                (size_t) (num_samples - n) * sample_size);
+    }
+}
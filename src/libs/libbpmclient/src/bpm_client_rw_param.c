@@ -34,6 +34,9 @@
     CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:rw_param_client]",   \
             bpm_client_err_str (err_type))
 
+static zmsg_t *_param_client_msg_new (uint32_t operation, uint32_t rw,
+        void *param1, size_t size1, void *param2, size_t size2);
+
 bpm_client_err_e param_client_send_gen_rw (bpm_client_t *self, char *service,
         uint32_t operation, uint32_t rw, void *param1, size_t size1,
         void *param2, size_t size2)
@@ -47,22 +50,30 @@ bpm_client_err_e param_client_send_gen_rw (bpm_client_t *self, char *service,
     ASSERT_TEST(client != NULL, "Could not get BPM client handler", err_get_handler,
             BPM_CLIENT_ERR_SERVER);
 
-    zmsg_t *request = zmsg_new ();
+    zmsg_t *request = _param_client_msg_new (operation, rw, param1, size1,
+            param2, size2);
     ASSERT_ALLOC(request, err_send_msg_alloc, BPM_CLIENT_ERR_ALLOC);
-    zmsg_addmem (request, &operation, sizeof (operation));
-    zmsg_addmem (request, &rw, sizeof (rw));
-    zmsg_addmem (request, param1, size1);
-    if (param2 != NULL) {
-        zmsg_addmem (request, param2, size2);
+
+    /* Reads might be answered along with identical ones */
+    const char *subject = (rw == READ_MODE) ? RW_REQ_SHARED_SUBJECT :
+        RW_REPLY_PACKED_SUBJECT;
+    if (bpm_client_get_wire_format (self) == RW_WIRE_PACKED_V1) {
+        err = param_client_msg_pack (request);
+        ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not pack message", err_pack);
+        subject = RW_REQ_PACKED_V1_SUBJECT;
     }
 
     /* Get poller and timeout from client */
     uint32_t timeout = bpm_client_get_timeout (self);
 
-    int rc = mlm_client_sendto (client, service, NULL, NULL, timeout, &request);
-    ASSERT_TEST(rc >= 0, "Could not send message", err_get_handler,
+    int rc = bpm_client_sendto (self, service, subject,
+            bpm_func_sync_tracker_new (self), timeout, &request, true);
+    ASSERT_TEST(rc >= 0, "Could not send message", err_pack,
             BPM_CLIENT_ERR_SERVER);
+    bpm_client_sync_op_begin (self, service, operation, 0);
 
+err_pack:
+    zmsg_destroy (&request);
 err_send_msg_alloc:
 err_get_handler:
 err_param1_null:
@@ -100,31 +111,46 @@ bpm_client_err_e param_client_write_gen (bpm_client_t *self, char *service,
     bpm_client_err_e err = BPM_CLIENT_SUCCESS;
     zmsg_t *report;
 
+    /* Only single parameter writes are written behind, as only these might
+     * be superseded by the server (see RW_REQ_COALESCE_SUBJECT) */
+    if (bpm_client_get_write_behind (self) && rw == WRITE_MODE &&
+            param1 != NULL && param2 == NULL) {
+        zmsg_t *request = _param_client_msg_new (operation, rw, param1, size1,
+                NULL, 0);
+        ASSERT_ALLOC(request, err_send_msg, BPM_CLIENT_ERR_ALLOC);
+        bpm_param_cache_invalidate (self, service);
+        return bpm_param_write_behind (self, service, &request);
+    }
+
+    /* Writes are applied in the order they were made */
+    err = bpm_param_write_behind_wait (self);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not wait for write-behind "
+            "writes", err_send_msg);
+
     err = param_client_send_gen_rw (self, service, operation, rw, param1,
             size1, param2, size2);
     ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not send message", err_send_msg);
+    /* Even if we get no reply, the parameter might have changed. Our own
+     * changes are seen right away, without waiting for the change event */
+    bpm_param_cache_invalidate (self, service);
     err = param_client_recv_rw (self, service, &report);
     ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not receive message", err_recv_msg);
 
     /* Message is:
      * frame 0: error code      */
+    RW_REPLY_TYPE reply_code;
+    const uint8_t *data;
+    size_t data_size;
+    err = param_client_reply_parse (report, &reply_code, &data, &data_size);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS && data == NULL,
+            "Unexpected message received", err_msg, BPM_CLIENT_ERR_SERVER);
 
-    /* Handling malformed messages */
-    size_t msg_size = zmsg_size (report);
-    ASSERT_TEST(msg_size == MSG_ERR_CODE_SIZE, "Unexpected message received", err_msg);
-
-    /* Get message contents */
-    zframe_t *err_code = zmsg_pop (report);
-    ASSERT_TEST(err_code != NULL, "Could not receive error code", err_null_code,
-            BPM_CLIENT_ERR_SERVER);
     /* Check for return code from server */
-    ASSERT_TEST(*(RW_REPLY_TYPE *) zframe_data(err_code) == RW_OK,
+    ASSERT_TEST(reply_code == RW_OK,
             "rw_param_client: parameter SET error, try again",
             err_set_param, BPM_CLIENT_ERR_AGAIN);
 
 err_set_param:
-    zframe_destroy (&err_code);
-err_null_code:
 err_msg:
     zmsg_destroy (&report);
 err_recv_msg:
@@ -181,6 +207,20 @@ bpm_client_err_e param_client_read_gen (bpm_client_t *self, char *service,
     bpm_client_err_e err = BPM_CLIENT_SUCCESS;
     zmsg_t *report;
 
+    /* Only reads taking an argument (see param_client_write_read ()) send
+     * a meaningful first parameter, so only these are cached by it */
+    const void *cache_arg = (param2 != NULL) ? param1 : NULL;
+    size_t cache_arg_size = (param2 != NULL) ? size1 : 0;
+    if (rw == READ_MODE && bpm_param_cache_get (self, service, operation,
+                cache_arg, cache_arg_size, param_out, size_out)) {
+        goto param_cached;
+    }
+
+    /* Reads see the writes made before them */
+    err = bpm_param_write_behind_wait (self);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Could not wait for write-behind "
+            "writes", err_send_msg);
+
     /* Even though we don't use the second parameter, we have the same
      * message strucuture and the server will check for strict consistency
      * (number of arguments and size) of all parameters. So, use the size of
@@ -195,58 +235,41 @@ bpm_client_err_e param_client_read_gen (bpm_client_t *self, char *service,
     /* Message is:
      * frame 0: error code
      * frame 1: number of bytes read (optional)
-     * frame 2: data read (optional) */
-
-    /* Handling malformed messages */
-    size_t msg_size = zmsg_size (report);
-    ASSERT_TEST(msg_size == MSG_ERR_CODE_SIZE || msg_size == MSG_FULL_SIZE,
-            "Unexpected message received", err_msg);
-
-    /* Get message contents */
-    zframe_t *err_code = zmsg_pop(report);
-    ASSERT_TEST(err_code != NULL, "Could not receive error code", err_null_code);
+     * frame 2: data read (optional)
+     * or the packed equivalent */
+    RW_REPLY_TYPE reply_code;
+    const uint8_t *data;
+    size_t data_size;
+    err = param_client_reply_parse (report, &reply_code, &data, &data_size);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Unexpected message received", err_msg);
 
     /* Check for return code from server */
-    ASSERT_TEST(*(RW_REPLY_TYPE *) zframe_data(err_code) == RW_OK,
+    ASSERT_TEST(reply_code == RW_OK,
             "rw_param_client: parameter GET error, try again",
             err_error_code, BPM_CLIENT_ERR_AGAIN);
 
-    zframe_t *bytes_read_frm = NULL;
-    zframe_t *data_out_frm = NULL;
-    if (msg_size == MSG_FULL_SIZE) {
-        bytes_read_frm = zmsg_pop(report);
-        ASSERT_TEST(bytes_read_frm != NULL, "Could not receive number of bytes read", err_null_bytes_read);
-        data_out_frm = zmsg_pop(report);
-        ASSERT_TEST(data_out_frm != NULL, "Could not receive parameter", err_null_param);
-
-        ASSERT_TEST(zframe_size (bytes_read_frm) == RW_REPLY_SIZE,
-                "Wrong <number of payload bytes> parameter size", err_msg_fmt);
-
-        /* Size in the second frame must match the frame size of the third */
-        ASSERT_TEST(*(RW_REPLY_TYPE *) zframe_data (bytes_read_frm) == zframe_size (data_out_frm),
-                "<payload> parameter size does not match size in <number of payload bytes> parameter",
-                err_msg_fmt);
-
+    if (data != NULL) {
         /* We accept any payload that is less than the specified size */
-        ASSERT_TEST(zframe_size (data_out_frm) <= size_out,
-                "Wrong <payload> parameter size", err_msg_fmt);
+        ASSERT_TEST(data_size <= size_out,
+                "Wrong <payload> parameter size", err_msg_fmt,
+                BPM_CLIENT_ERR_MSG);
 
         /* Copy the message contents to the user */
-        memcpy (param_out, zframe_data (data_out_frm), size_out);
+        memcpy (param_out, data, data_size);
+
+        if (rw == READ_MODE) {
+            bpm_param_cache_put (self, service, operation, cache_arg,
+                    cache_arg_size, data, data_size);
+        }
     }
 
 err_msg_fmt:
-    zframe_destroy (&data_out_frm);
-err_null_param:
-    zframe_destroy (&bytes_read_frm);
-err_null_bytes_read:
 err_error_code:
-    zframe_destroy (&err_code);
-err_null_code:
 err_msg:
     zmsg_destroy (&report);
 err_recv_msg:
 err_send_msg:
+param_cached:
     return err;
 }
 
@@ -283,38 +306,208 @@ bpm_client_err_e param_client_write_read_double (bpm_client_t *self, char *servi
 }
 
 /********************* Utility functions ************************************/
+/* Poll the reply sockets without blocking for up to the busy poll time of
+ * the client, or until "deadline" (zclock_mono (), -1 for none). Returns
+ * the socket with a message or NULL if none came */
+static zsock_t *_param_client_spin (bpm_client_t *self, zpoller_t *poller,
+        int64_t deadline)
+{
+    uint32_t busy_poll = bpm_client_get_busy_poll (self);
+    if (busy_poll == 0) {
+        return NULL;
+    }
+
+    int64_t spin_end = zclock_usecs () + busy_poll;
+    if (deadline >= 0 && spin_end > deadline * 1000) {
+        spin_end = deadline * 1000;
+    }
+
+    do {
+        zsock_t *which = zpoller_wait (poller, 0);
+        if (which != NULL || zpoller_terminated (poller)) {
+            return which;
+        }
+    } while (zclock_usecs () < spin_end);
+
+    return NULL;
+}
+
 /* Wait for message to arrive up to timeout msecs */
 zmsg_t *param_client_recv_timeout (bpm_client_t *self)
 {
     zmsg_t *msg = NULL;
 
     /* Get poller and timeout from client */
-    uint32_t timeout = bpm_client_get_timeout (self);
-    zpoller_t *poller = bpm_client_get_poller (self);
+    int timeout = bpm_client_sync_op_timeout (self);
+    zpoller_t *poller = bpm_client_get_reply_poller (self);
 
     /* Get MLM socket for use with poller */
     zsock_t *msgpipe = mlm_client_msgpipe (bpm_get_mlm_client (self));
     ASSERT_TEST (msgpipe != NULL, "Invalid MLM client socket reference",
             err_mlm_inv_client_socket);
 
-    zsock_t *which = zpoller_wait (poller, timeout);
-    /* Check if poller expired */
-    ASSERT_TEST(!zpoller_expired (poller),
-            "Server took too long too respond", err_poller_timeout);
-    /* If not we should have a valid message */
-    ASSERT_TEST(!zpoller_terminated (poller),
-            "Poller terminated", err_poller_terminated);
-    ASSERT_TEST(which != NULL, "Could not poll on sockets",
-            err_poller_invalid);
-
-    /* Check for activity socket */
-    if (which == msgpipe) {
-        msg = mlm_client_recv (bpm_get_mlm_client (self));
+    /* Replies to asynchronous requests might arrive before ours. These
+     * are completed here and do not count as ours. Late replies to
+     * synchronous requests that timed out are dropped */
+    int64_t deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+    while (msg == NULL) {
+        /* Spin first, if asked for, then block for the rest of the time */
+        zsock_t *which = _param_client_spin (self, poller, deadline);
+        if (which == NULL) {
+            int wait = -1;
+            if (deadline >= 0) {
+                int64_t remaining = deadline - zclock_mono ();
+                wait = (remaining > 0) ? (int) remaining : 0;
+            }
+            which = zpoller_wait (poller, wait);
+        }
+        /* Check if poller expired */
+        if (zpoller_expired (poller)) {
+            bpm_client_local_expired (self);
+        }
+        ASSERT_TEST(!zpoller_expired (poller),
+                "Server took too long too respond", err_poller_timeout);
+        /* If not we should have a valid message */
+        ASSERT_TEST(!zpoller_terminated (poller),
+                "Poller terminated", err_poller_terminated);
+        ASSERT_TEST(which != NULL, "Could not poll on sockets",
+                err_poller_invalid);
+
+        /* Check for activity socket */
+        if (which == msgpipe) {
+            msg = mlm_client_recv (bpm_get_mlm_client (self));
+            if (msg == NULL) {
+                break;
+            }
+            if (bpm_func_async_complete (self, &msg)) {
+                msg = NULL;
+            }
+            else if (!bpm_func_sync_reply_match (self)) {
+                zmsg_destroy (&msg);
+            }
+        }
+        else {
+            /* Only the local fast paths are polled besides */
+            msg = bpm_client_local_recv (self, which);
+        }
     }
 
 err_poller_invalid:
 err_poller_terminated:
 err_poller_timeout:
 err_mlm_inv_client_socket:
+    bpm_client_sync_op_end (self, msg);
     return msg;
 }
+
+bpm_client_err_e param_client_reply_parse (zmsg_t *report, uint32_t *code,
+        const uint8_t **data, size_t *data_size)
+{
+    assert (report);
+    assert (code);
+    assert (data);
+    assert (data_size);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    size_t msg_size = zmsg_size (report);
+    zframe_t *code_frm = zmsg_first (report);
+
+    ASSERT_TEST((msg_size == MSG_ERR_CODE_SIZE || msg_size == MSG_FULL_SIZE) &&
+            code_frm != NULL && zframe_size (code_frm) >= RW_REPLY_SIZE,
+            "Unexpected message received", err_msg, BPM_CLIENT_ERR_MSG);
+
+    const uint8_t *code_data = zframe_data (code_frm);
+    RW_REPLY_TYPE size;
+    memcpy (code, code_data, RW_REPLY_SIZE);
+    *data = NULL;
+    *data_size = 0;
+
+    if (msg_size == MSG_FULL_SIZE) {
+        /* frame 0: error code, frame 1: size, frame 2: data */
+        zframe_t *size_frm = zmsg_next (report);
+        zframe_t *data_frm = zmsg_next (report);
+        ASSERT_TEST(zframe_size (code_frm) == RW_REPLY_SIZE &&
+                zframe_size (size_frm) == RW_REPLY_SIZE,
+                "Wrong <number of payload bytes> parameter size", err_msg,
+                BPM_CLIENT_ERR_MSG);
+
+        /* Size in the second frame must match the frame size of the third */
+        memcpy (&size, zframe_data (size_frm), RW_REPLY_SIZE);
+        ASSERT_TEST(size == zframe_size (data_frm),
+                "<payload> parameter size does not match size in <number of payload bytes> parameter",
+                err_msg, BPM_CLIENT_ERR_MSG);
+
+        *data = zframe_data (data_frm);
+        *data_size = size;
+    }
+    else if (zframe_size (code_frm) > RW_REPLY_SIZE) {
+        /* frame 0: error code, size and data */
+        ASSERT_TEST(zframe_size (code_frm) >= RW_REPLY_PACKED_HDR_SIZE,
+                "Wrong packed reply size", err_msg, BPM_CLIENT_ERR_MSG);
+
+        memcpy (&size, code_data + RW_REPLY_SIZE, RW_REPLY_SIZE);
+        ASSERT_TEST(size == zframe_size (code_frm) - RW_REPLY_PACKED_HDR_SIZE,
+                "<payload> parameter size does not match size in <number of payload bytes> parameter",
+                err_msg, BPM_CLIENT_ERR_MSG);
+
+        *data = code_data + RW_REPLY_PACKED_HDR_SIZE;
+        *data_size = size;
+    }
+
+err_msg:
+    return err;
+}
+
+bpm_client_err_e param_client_msg_pack (zmsg_t *msg)
+{
+    assert (msg);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    size_t packed_size = 0;
+    zframe_t *frame;
+
+    for (frame = zmsg_first (msg); frame != NULL; frame = zmsg_next (msg)) {
+        packed_size += RW_REQ_PACKED_ARG_HDR_SIZE + zframe_size (frame);
+    }
+
+    zframe_t *packed = zframe_new (NULL, packed_size);
+    ASSERT_ALLOC(packed, err_packed_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    uint8_t *p = zframe_data (packed);
+    while ((frame = zmsg_pop (msg)) != NULL) {
+        uint32_t size = zframe_size (frame);
+        memcpy (p, &size, RW_REQ_PACKED_ARG_HDR_SIZE);
+        p += RW_REQ_PACKED_ARG_HDR_SIZE;
+        memcpy (p, zframe_data (frame), size);
+        p += size;
+        zframe_destroy (&frame);
+    }
+
+    int zerr = zmsg_append (msg, &packed);
+    ASSERT_TEST(zerr == 0, "Could not add packed frame", err_append,
+            BPM_CLIENT_ERR_ALLOC);
+
+err_append:
+    zframe_destroy (&packed);
+err_packed_alloc:
+    return err;
+}
+
+/* Build a parameter request of the RW_WIRE_FRAMES form */
+static zmsg_t *_param_client_msg_new (uint32_t operation, uint32_t rw,
+        void *param1, size_t size1, void *param2, size_t size2)
+{
+    zmsg_t *request = zmsg_new ();
+    if (request == NULL) {
+        return NULL;
+    }
+
+    zmsg_addmem (request, &operation, sizeof (operation));
+    zmsg_addmem (request, &rw, sizeof (rw));
+    zmsg_addmem (request, param1, size1);
+    if (param2 != NULL) {
+        zmsg_addmem (request, param2, size2);
+    }
+
+    return request;
+}
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <pthread.h>
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:shared]",  \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:shared]",  \
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:shared]",    \
+            bpm_client_err_str (err_type))
+
+#define BPM_SHARED_WAKE_ENDP_FMT        "inproc://bpm_shared_wake-%p"
+
+/* Request of a caller thread. It lives on the stack of the caller, which
+ * sleeps on "cond" until the I/O thread sets "done" */
+typedef struct {
+    const disp_op_t *func;
+    char *service;
+    uint32_t *input;
+    uint32_t *output;
+    int64_t deadline;                           /* Reply due, -1 for never */
+    bpm_client_err_e err;
+    bool done;
+    pthread_cond_t cond;
+    struct _bpm_shared_client_t *owner;
+    void *handle;                               /* Handle in "in_flight" */
+} bpm_shared_req_t;
+
+/* Our structure */
+struct _bpm_shared_client_t {
+    bpm_client_t *client;                       /* Only used by the I/O thread */
+    pthread_t io_thread;                        /* I/O thread */
+    pthread_mutex_t lock;                       /* Protects everything below */
+    zlistx_t *queue;                            /* Requests not sent yet */
+    zlistx_t *in_flight;                        /* Requests waiting for their
+                                                   replies. Only used by the
+                                                   I/O thread */
+    size_t pending;                             /* Requests queued or in flight */
+    zsock_t *wake_send;                         /* Wakes the I/O thread up when
+                                                   requests are queued */
+    zsock_t *wake_recv;                         /* Read by the I/O thread */
+    bool stop;                                  /* I/O thread must exit */
+};
+
+static void *_bpm_shared_io_thread (void *arg);
+static void _bpm_shared_req_done (bpm_client_t *client, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg);
+static void _bpm_shared_req_finish (bpm_shared_client_t *self,
+        bpm_shared_req_t *req, bpm_client_err_e err);
+
+bpm_shared_client_t *bpm_shared_client_new (char *broker_endp, int verbose,
+        const char *log_file_name, int timeout)
+{
+    assert (broker_endp);
+
+    bpm_shared_client_t *self = (bpm_shared_client_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->client = bpm_client_new_time (broker_endp, verbose, log_file_name,
+            timeout);
+    ASSERT_TEST(self->client != NULL, "Could not create client", err_client);
+
+    self->queue = zlistx_new ();
+    ASSERT_ALLOC(self->queue, err_queue_alloc);
+    self->in_flight = zlistx_new ();
+    ASSERT_ALLOC(self->in_flight, err_in_flight_alloc);
+
+    char wake_endp [64];
+    snprintf (wake_endp, sizeof (wake_endp), BPM_SHARED_WAKE_ENDP_FMT,
+            (void *) self);
+    self->wake_recv = zsock_new_pull (wake_endp);
+    ASSERT_TEST(self->wake_recv != NULL, "Could not create wake socket",
+            err_wake_recv);
+    self->wake_send = zsock_new_push (wake_endp);
+    ASSERT_TEST(self->wake_send != NULL, "Could not create wake socket",
+            err_wake_send);
+
+    pthread_mutex_init (&self->lock, NULL);
+    int rc = pthread_create (&self->io_thread, NULL, _bpm_shared_io_thread, self);
+    ASSERT_TEST(rc == 0, "Could not start I/O thread", err_thread);
+
+    return self;
+
+err_thread:
+    pthread_mutex_destroy (&self->lock);
+    zsock_destroy (&self->wake_send);
+err_wake_send:
+    zsock_destroy (&self->wake_recv);
+err_wake_recv:
+    zlistx_destroy (&self->in_flight);
+err_in_flight_alloc:
+    zlistx_destroy (&self->queue);
+err_queue_alloc:
+    bpm_client_destroy (&self->client);
+err_client:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+void bpm_shared_client_destroy (bpm_shared_client_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_shared_client_t *self = *self_p;
+
+        pthread_mutex_lock (&self->lock);
+        self->stop = true;
+        zsock_signal (self->wake_send, 0);
+        pthread_mutex_unlock (&self->lock);
+        pthread_join (self->io_thread, NULL);
+
+        /* The I/O thread is gone, so whatever it did not send is failed */
+        pthread_mutex_lock (&self->lock);
+        bpm_shared_req_t *req;
+        while ((req = (bpm_shared_req_t *) zlistx_detach (self->queue, NULL)) != NULL) {
+            _bpm_shared_req_finish (self, req, BPM_CLIENT_INT);
+        }
+        pthread_mutex_unlock (&self->lock);
+
+        if (self->pending != 0) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient:shared] Destroying "
+                    "client with %zu requests in flight\n", self->pending);
+        }
+
+        pthread_mutex_destroy (&self->lock);
+        zsock_destroy (&self->wake_send);
+        zsock_destroy (&self->wake_recv);
+        zlistx_destroy (&self->in_flight);
+        zlistx_destroy (&self->queue);
+        bpm_client_destroy (&self->client);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+bpm_client_err_e bpm_shared_func_exec (bpm_shared_client_t *self,
+        const disp_op_t *func, char *service, uint32_t *input, uint32_t *output)
+{
+    assert (self);
+    assert (func);
+    assert (service);
+
+    bpm_shared_req_t req = {
+        .func = func,
+        .service = service,
+        .input = input,
+        .output = output,
+        .deadline = -1,
+        .err = BPM_CLIENT_SUCCESS,
+        .done = false,
+        .owner = self,
+    };
+    pthread_cond_init (&req.cond, NULL);
+
+    pthread_mutex_lock (&self->lock);
+    if (self->stop) {
+        req.err = BPM_CLIENT_INT;
+        goto err_stop;
+    }
+
+    zlistx_add_end (self->queue, &req);
+    self->pending++;
+    /* One signal per request, so none is lost while the I/O thread is
+     * draining the queue */
+    zsock_signal (self->wake_send, 0);
+
+    while (!req.done) {
+        pthread_cond_wait (&req.cond, &self->lock);
+    }
+
+err_stop:
+    pthread_mutex_unlock (&self->lock);
+    pthread_cond_destroy (&req.cond);
+    return req.err;
+}
+
+size_t bpm_shared_client_pending (bpm_shared_client_t *self)
+{
+    assert (self);
+
+    pthread_mutex_lock (&self->lock);
+    size_t pending = self->pending;
+    pthread_mutex_unlock (&self->lock);
+    return pending;
+}
+
+/**************** Helper Functions ***************/
+
+static void *_bpm_shared_io_thread (void *arg)
+{
+    bpm_shared_client_t *self = (bpm_shared_client_t *) arg;
+    int timeout = bpm_client_get_timeout (self->client);
+
+    zsock_t *msgpipe = mlm_client_msgpipe (bpm_get_mlm_client (self->client));
+    zpoller_t *poller = zpoller_new (self->wake_recv, msgpipe, NULL);
+    ASSERT_ALLOC(poller, err_poller_alloc);
+
+    while (true) {
+        /* Wake up for the earliest deadline, so requests time out even if
+         * nothing arrives */
+        int wait = -1;
+        int64_t now = zclock_mono ();
+        bpm_shared_req_t *req = (bpm_shared_req_t *) zlistx_first (self->in_flight);
+        for (; req != NULL; req = (bpm_shared_req_t *) zlistx_next (self->in_flight)) {
+            if (req->deadline >= 0) {
+                int remaining = (req->deadline > now) ? (int) (req->deadline - now) : 0;
+                wait = (wait < 0 || remaining < wait) ? remaining : wait;
+            }
+        }
+
+        void *which = zpoller_wait (poller, wait);
+        if (which == NULL && zpoller_terminated (poller)) {
+            break;
+        }
+
+        if (which == self->wake_recv) {
+            zsock_wait (self->wake_recv);
+        }
+
+        /* Replies first, which completes the expired requests as well */
+        bpm_client_err_e err = bpm_func_async_dispatch (self->client, 0);
+        if (err == BPM_CLIENT_INT) {
+            break;
+        }
+
+        pthread_mutex_lock (&self->lock);
+        if (self->stop) {
+            pthread_mutex_unlock (&self->lock);
+            break;
+        }
+
+        /* Requests are sent in the I/O thread only, as the sockets of the
+         * client are not to be used by the callers */
+        while ((req = (bpm_shared_req_t *) zlistx_detach (self->queue, NULL)) != NULL) {
+            req->deadline = (timeout < 0) ? -1 : zclock_mono () + timeout;
+            req->handle = zlistx_add_end (self->in_flight, req);
+            err = bpm_func_exec_async (self->client, req->func, req->service,
+                    req->input, req->output, _bpm_shared_req_done, req, NULL);
+            if (err != BPM_CLIENT_SUCCESS) {
+                zlistx_delete (self->in_flight, req->handle);
+                _bpm_shared_req_finish (self, req, err);
+            }
+        }
+        pthread_mutex_unlock (&self->lock);
+    }
+
+    /* Requests in flight are not waited for */
+    pthread_mutex_lock (&self->lock);
+    bpm_shared_req_t *req;
+    while ((req = (bpm_shared_req_t *) zlistx_detach (self->in_flight, NULL)) != NULL) {
+        _bpm_shared_req_finish (self, req, BPM_CLIENT_INT);
+    }
+    pthread_mutex_unlock (&self->lock);
+
+    zpoller_destroy (&poller);
+err_poller_alloc:
+    return NULL;
+}
+
+/* Completion of a request, called by the I/O thread */
+static void _bpm_shared_req_done (bpm_client_t *client, uint32_t req_id,
+        bpm_client_err_e err, uint32_t *output, void *arg)
+{
+    (void) client;
+    (void) req_id;
+    (void) output;
+    bpm_shared_req_t *req = (bpm_shared_req_t *) arg;
+    bpm_shared_client_t *self = req->owner;
+
+    pthread_mutex_lock (&self->lock);
+    zlistx_delete (self->in_flight, req->handle);
+    _bpm_shared_req_finish (self, req, err);
+    pthread_mutex_unlock (&self->lock);
+}
+
+/* Wake the caller of a request up. Must be called with the lock held. The
+ * request is gone afterwards */
+static void _bpm_shared_req_finish (bpm_shared_client_t *self,
+        bpm_shared_req_t *req, bpm_client_err_e err)
+{
+    req->err = err;
+    req->done = true;
+    self->pending--;
+    pthread_cond_signal (&req->cond);
+}
@@ -0,0 +1,598 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define BPM_SPEC_X86
+#include <immintrin.h>
+#elif defined (__aarch64__)
+#define BPM_SPEC_NEON
+#include <arm_neon.h>
+#endif
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:spec]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:spec]",   \
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:spec]",      \
+            bpm_client_err_str (err_type))
+
+/* Butterflies of one radix-2 stage, of half size "h", over the "n" points
+ * of "re" and "im". "wr" and "wi" are the "h" twiddles of the stage */
+typedef void (*bpm_spec_stage_fp) (float *re, float *im, size_t n, size_t h,
+        const float *wr, const float *wi);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    bpm_spec_stage_fp stage;
+} bpm_spec_ops_t;
+
+/* Our structure. The FFT is done in place, on split real and imaginary
+ * arrays, so the butterflies of a stage vectorize on consecutive points */
+struct _bpm_spec_t {
+    size_t fft_size;                /* Number of points */
+    bpm_spec_win_e win;             /* Window */
+    float *window;                  /* Window coefficients */
+    double win_sum;                 /* Sum of the window coefficients */
+    uint32_t *rev;                  /* Bit reversed index of each point */
+    float *wr;                      /* Twiddles of all the stages. Stage of */
+    float *wi;                      /* half size h starts at h-1 */
+};
+
+/************ Scalar kernels **********/
+
+static void _bpm_spec_stage_scalar (float *re, float *im, size_t n, size_t h,
+        const float *wr, const float *wi)
+{
+    for (size_t k = 0; k < n; k += 2*h) {
+        for (size_t j = 0; j < h; ++j) {
+            size_t a = k + j;
+            size_t b = a + h;
+            float tr = wr [j]*re [b] - wi [j]*im [b];
+            float ti = wr [j]*im [b] + wi [j]*re [b];
+
+            re [b] = re [a] - tr;
+            im [b] = im [a] - ti;
+            re [a] += tr;
+            im [a] += ti;
+        }
+    }
+}
+
+#if defined (BPM_SPEC_X86)
+
+/************ SSE2 kernels **********/
+
+/* 4 butterflies per iteration. Stages narrower than that are left to the
+ * scalar kernel */
+__attribute__ ((target ("sse2")))
+static void _bpm_spec_stage_sse2 (float *re, float *im, size_t n, size_t h,
+        const float *wr, const float *wi)
+{
+    if (h < 4) {
+        _bpm_spec_stage_scalar (re, im, n, h, wr, wi);
+        return;
+    }
+
+    for (size_t k = 0; k < n; k += 2*h) {
+        for (size_t j = 0; j < h; j += 4) {
+            float *ra = re + k + j, *ia = im + k + j;
+            float *rb = ra + h, *ib = ia + h;
+            __m128 vwr = _mm_loadu_ps (wr + j);
+            __m128 vwi = _mm_loadu_ps (wi + j);
+            __m128 vra = _mm_loadu_ps (ra), via = _mm_loadu_ps (ia);
+            __m128 vrb = _mm_loadu_ps (rb), vib = _mm_loadu_ps (ib);
+
+            __m128 tr = _mm_sub_ps (_mm_mul_ps (vwr, vrb), _mm_mul_ps (vwi, vib));
+            __m128 ti = _mm_add_ps (_mm_mul_ps (vwr, vib), _mm_mul_ps (vwi, vrb));
+
+            _mm_storeu_ps (rb, _mm_sub_ps (vra, tr));
+            _mm_storeu_ps (ib, _mm_sub_ps (via, ti));
+            _mm_storeu_ps (ra, _mm_add_ps (vra, tr));
+            _mm_storeu_ps (ia, _mm_add_ps (via, ti));
+        }
+    }
+}
+
+/************ AVX kernels **********/
+
+/* 8 butterflies per iteration */
+__attribute__ ((target ("avx")))
+static void _bpm_spec_stage_avx (float *re, float *im, size_t n, size_t h,
+        const float *wr, const float *wi)
+{
+    if (h < 8) {
+        _bpm_spec_stage_sse2 (re, im, n, h, wr, wi);
+        return;
+    }
+
+    for (size_t k = 0; k < n; k += 2*h) {
+        for (size_t j = 0; j < h; j += 8) {
+            float *ra = re + k + j, *ia = im + k + j;
+            float *rb = ra + h, *ib = ia + h;
+            __m256 vwr = _mm256_loadu_ps (wr + j);
+            __m256 vwi = _mm256_loadu_ps (wi + j);
+            __m256 vra = _mm256_loadu_ps (ra), via = _mm256_loadu_ps (ia);
+            __m256 vrb = _mm256_loadu_ps (rb), vib = _mm256_loadu_ps (ib);
+
+            __m256 tr = _mm256_sub_ps (_mm256_mul_ps (vwr, vrb), _mm256_mul_ps (vwi, vib));
+            __m256 ti = _mm256_add_ps (_mm256_mul_ps (vwr, vib), _mm256_mul_ps (vwi, vrb));
+
+            _mm256_storeu_ps (rb, _mm256_sub_ps (vra, tr));
+            _mm256_storeu_ps (ib, _mm256_sub_ps (via, ti));
+            _mm256_storeu_ps (ra, _mm256_add_ps (vra, tr));
+            _mm256_storeu_ps (ia, _mm256_add_ps (via, ti));
+        }
+    }
+}
+
+#endif
+
+#if defined (BPM_SPEC_NEON)
+
+/************ NEON kernels **********/
+
+/* 4 butterflies per iteration */
+static void _bpm_spec_stage_neon (float *re, float *im, size_t n, size_t h,
+        const float *wr, const float *wi)
+{
+    if (h < 4) {
+        _bpm_spec_stage_scalar (re, im, n, h, wr, wi);
+        return;
+    }
+
+    for (size_t k = 0; k < n; k += 2*h) {
+        for (size_t j = 0; j < h; j += 4) {
+            float *ra = re + k + j, *ia = im + k + j;
+            float *rb = ra + h, *ib = ia + h;
+            float32x4_t vwr = vld1q_f32 (wr + j);
+            float32x4_t vwi = vld1q_f32 (wi + j);
+            float32x4_t vra = vld1q_f32 (ra), via = vld1q_f32 (ia);
+            float32x4_t vrb = vld1q_f32 (rb), vib = vld1q_f32 (ib);
+
+            float32x4_t tr = vmlsq_f32 (vmulq_f32 (vwr, vrb), vwi, vib);
+            float32x4_t ti = vmlaq_f32 (vmulq_f32 (vwr, vib), vwi, vrb);
+
+            vst1q_f32 (rb, vsubq_f32 (vra, tr));
+            vst1q_f32 (ib, vsubq_f32 (via, ti));
+            vst1q_f32 (ra, vaddq_f32 (vra, tr));
+            vst1q_f32 (ia, vaddq_f32 (via, ti));
+        }
+    }
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used */
+static const bpm_spec_ops_t bpm_spec_ops [] = {
+#if defined (BPM_SPEC_X86)
+    {.name = "avx",     .stage = _bpm_spec_stage_avx},
+    {.name = "sse2",    .stage = _bpm_spec_stage_sse2},
+#endif
+#if defined (BPM_SPEC_NEON)
+    {.name = "neon",    .stage = _bpm_spec_stage_neon},
+#endif
+    {.name = "scalar",  .stage = _bpm_spec_stage_scalar}
+};
+
+#define BPM_SPEC_OPS_NUM                (sizeof (bpm_spec_ops) / \
+                                            sizeof (bpm_spec_ops [0]))
+
+static bool _bpm_spec_supported (const bpm_spec_ops_t *ops)
+{
+#if defined (BPM_SPEC_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "avx")) {
+        return __builtin_cpu_supports ("avx");
+    }
+    if (streq (ops->name, "sse2")) {
+        return __builtin_cpu_supports ("sse2");
+    }
+#endif
+    /* NEON is part of AArch64 */
+    (void) ops;
+    return true;
+}
+
+static const bpm_spec_ops_t *_bpm_spec_get_ops (void)
+{
+    /* Selecting it twice from different threads is harmless */
+    static const bpm_spec_ops_t *ops = NULL;
+
+    if (ops == NULL) {
+        size_t i;
+        for (i = 0; i < BPM_SPEC_OPS_NUM - 1; ++i) {
+            if (_bpm_spec_supported (&bpm_spec_ops [i])) {
+                break;
+            }
+        }
+        /* The scalar kernel is always supported */
+        ops = &bpm_spec_ops [i];
+    }
+
+    return ops;
+}
+
+const char *bpm_spec_kernel_name (void)
+{
+    return _bpm_spec_get_ops ()->name;
+}
+
+/***************** Plans *****************/
+
+bpm_spec_t *bpm_spec_new (size_t fft_size, bpm_spec_win_e win)
+{
+    ASSERT_TEST(fft_size >= BPM_SPEC_FFT_SIZE_MIN && fft_size <= BPM_SPEC_FFT_SIZE_MAX &&
+            (fft_size & (fft_size - 1)) == 0, "FFT size must be a power of 2",
+            err_inv_param);
+    ASSERT_TEST(win < BPM_SPEC_WIN_END, "Invalid window", err_inv_param);
+
+    bpm_spec_t *self = (bpm_spec_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+    self->fft_size = fft_size;
+    self->win = win;
+
+    self->window = (float *) malloc (fft_size * sizeof (*self->window));
+    ASSERT_ALLOC(self->window, err_window_alloc);
+    self->rev = (uint32_t *) malloc (fft_size * sizeof (*self->rev));
+    ASSERT_ALLOC(self->rev, err_rev_alloc);
+    self->wr = (float *) malloc (fft_size * sizeof (*self->wr));
+    ASSERT_ALLOC(self->wr, err_wr_alloc);
+    self->wi = (float *) malloc (fft_size * sizeof (*self->wi));
+    ASSERT_ALLOC(self->wi, err_wi_alloc);
+
+    /* Periodic window, so the spectral leakage is the textbook one */
+    self->win_sum = 0;
+    for (size_t i = 0; i < fft_size; ++i) {
+        double w = (win == BPM_SPEC_WIN_HANN) ?
+            0.5 - 0.5*cos (2*M_PI*i/fft_size) : 1;
+        self->window [i] = w;
+        self->win_sum += w;
+    }
+
+    uint32_t log2_size = 0;
+    while ((1ULL << log2_size) < fft_size) {
+        ++log2_size;
+    }
+    for (size_t i = 0; i < fft_size; ++i) {
+        uint32_t r = 0;
+        for (uint32_t b = 0; b < log2_size; ++b) {
+            r |= ((i >> b) & 1) << (log2_size - 1 - b);
+        }
+        self->rev [i] = r;
+    }
+
+    /* Twiddles are computed in double precision, so the error does not
+     * grow from one to the next */
+    for (size_t h = 1; h < fft_size; h <<= 1) {
+        for (size_t j = 0; j < h; ++j) {
+            self->wr [h - 1 + j] = cos (-M_PI*j/h);
+            self->wi [h - 1 + j] = sin (-M_PI*j/h);
+        }
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient:spec] Created plan "
+            "of %zu points, using %s kernels\n", fft_size, bpm_spec_kernel_name ());
+    return self;
+
+err_wi_alloc:
+    free (self->wr);
+err_wr_alloc:
+    free (self->rev);
+err_rev_alloc:
+    free (self->window);
+err_window_alloc:
+    free (self);
+err_self_alloc:
+err_inv_param:
+    return NULL;
+}
+
+void bpm_spec_destroy (bpm_spec_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_spec_t *self = *self_p;
+
+        free (self->wi);
+        free (self->wr);
+        free (self->rev);
+        free (self->window);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+size_t bpm_spec_get_fft_size (bpm_spec_t *self)
+{
+    assert (self);
+    return self->fft_size;
+}
+
+/***************** Static functions *****************/
+
+/* FFT of atom "chan" of "data" into "re" and "im", fft_size points each.
+ * The mean is removed and the window applied on the way in */
+static void _bpm_spec_fft (bpm_spec_t *self, const int32_t *data,
+        size_t num_samples, uint32_t chan, float *re, float *im)
+{
+    size_t n = self->fft_size;
+    size_t num_used = (num_samples < n) ? num_samples : n;
+
+    double sum = 0;
+    for (size_t i = 0; i < num_used; ++i) {
+        sum += data [i*BPM_SPEC_NUM_CHAN + chan];
+    }
+    double mean = (num_used > 0) ? sum / num_used : 0;
+
+    /* Zero padded past the end of the curve */
+    memset (re, 0, n * sizeof (*re));
+    memset (im, 0, n * sizeof (*im));
+    for (size_t i = 0; i < num_used; ++i) {
+        re [self->rev [i]] = (data [i*BPM_SPEC_NUM_CHAN + chan] - mean) *
+            self->window [i];
+    }
+
+    bpm_spec_stage_fp stage = _bpm_spec_get_ops ()->stage;
+    for (size_t h = 1; h < n; h <<= 1) {
+        stage (re, im, n, h, self->wr + h - 1, self->wi + h - 1);
+    }
+}
+
+/* Amplitude of bin "k" */
+static inline double _bpm_spec_bin_ampl (const bpm_spec_t *self,
+        const float *re, const float *im, size_t k)
+{
+    return 2 * hypot (re [k], im [k]) / self->win_sum;
+}
+
+/* Interpolated DFT: offset of the peak at bin "k" from it, in bins, from
+ * the ratio of the amplitudes of the larger of its neighbours and its own,
+ * and the amplitude corrected accordingly */
+static void _bpm_spec_interp (const bpm_spec_t *self, const float *re,
+        const float *im, size_t k, double *delta, double *ampl)
+{
+    double a = _bpm_spec_bin_ampl (self, re, im, k);
+    double left = _bpm_spec_bin_ampl (self, re, im, k - 1);
+    double right = _bpm_spec_bin_ampl (self, re, im, k + 1);
+    double side = (right > left) ? right : left;
+    double sign = (right > left) ? 1 : -1;
+    double d = 0;
+
+    if (a + side > 0) {
+        d = (self->win == BPM_SPEC_WIN_HANN) ?
+            (2*side - a) / (a + side) : side / (a + side);
+    }
+    d = (d < 0) ? 0 : d;
+
+    /* Scalloping loss of the window at "d" bins from the peak */
+    double corr = 1;
+    if (d > 0) {
+        corr = M_PI*d / sin (M_PI*d);
+        if (self->win == BPM_SPEC_WIN_HANN) {
+            corr *= 1 - d*d;
+        }
+    }
+
+    *delta = sign * d;
+    *ampl = a * corr;
+}
+
+/* bpm_spec_tune () with work buffers of fft_size points given */
+static bpm_client_err_e _bpm_spec_tune (bpm_spec_t *self, const int32_t *data,
+        size_t num_samples, uint32_t chan, double tune_min, double tune_max,
+        float *re, float *im, bpm_spec_tune_t *tune)
+{
+    size_t n = self->fft_size;
+
+    /* The peak must have neighbours on both sides */
+    double bin_min = ceil (tune_min * n);
+    double bin_max = floor (tune_max * n);
+    size_t k_min = (bin_min < 1) ? 1 : (size_t) bin_min;
+    size_t k_max = (bin_max > n/2 - 1) ? n/2 - 1 : (size_t) bin_max;
+    if (k_min > k_max) {
+        return BPM_CLIENT_ERR_INV_PARAM;
+    }
+
+    _bpm_spec_fft (self, data, num_samples, chan, re, im);
+
+    /* Comparing the squared magnitudes is enough to find the peak */
+    size_t k_peak = k_min;
+    float mag_peak = -1;
+    for (size_t k = k_min; k <= k_max; ++k) {
+        float mag = re [k]*re [k] + im [k]*im [k];
+        if (mag > mag_peak) {
+            mag_peak = mag;
+            k_peak = k;
+        }
+    }
+
+    double delta = 0;
+    _bpm_spec_interp (self, re, im, k_peak, &delta, &tune->amplitude);
+    tune->tune = (k_peak + delta) / n;
+
+    return BPM_CLIENT_SUCCESS;
+}
+
+/***************** Analysis *****************/
+
+bpm_client_err_e bpm_spec_amplitude (bpm_spec_t *self, const int32_t *data,
+        size_t num_samples, uint32_t chan, float *spectrum)
+{
+    assert (self);
+    assert (data);
+    assert (spectrum);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    ASSERT_TEST(chan < BPM_SPEC_NUM_CHAN, "Invalid channel", err_inv_param,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    size_t n = self->fft_size;
+    float *re = (float *) malloc (2 * n * sizeof (*re));
+    ASSERT_ALLOC(re, err_work_alloc, BPM_CLIENT_ERR_ALLOC);
+    float *im = re + n;
+
+    _bpm_spec_fft (self, data, num_samples, chan, re, im);
+    for (size_t k = 0; k <= n/2; ++k) {
+        spectrum [k] = _bpm_spec_bin_ampl (self, re, im, k);
+    }
+    /* DC and Nyquist have no negative frequency counterpart */
+    spectrum [0] /= 2;
+    spectrum [n/2] /= 2;
+
+    free (re);
+
+err_work_alloc:
+err_inv_param:
+    return err;
+}
+
+bpm_client_err_e bpm_spec_tune (bpm_spec_t *self, const int32_t *data,
+        size_t num_samples, uint32_t chan, double tune_min, double tune_max,
+        bpm_spec_tune_t *tune)
+{
+    assert (self);
+    assert (data);
+    assert (tune);
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+
+    ASSERT_TEST(chan < BPM_SPEC_NUM_CHAN, "Invalid channel", err_inv_param,
+            BPM_CLIENT_ERR_INV_PARAM);
+
+    size_t n = self->fft_size;
+    float *re = (float *) malloc (2 * n * sizeof (*re));
+    ASSERT_ALLOC(re, err_work_alloc, BPM_CLIENT_ERR_ALLOC);
+
+    err = _bpm_spec_tune (self, data, num_samples, chan, tune_min, tune_max,
+            re, re + n, tune);
+    ASSERT_TEST(err == BPM_CLIENT_SUCCESS, "Tune range has no bins",
+            err_tune_range);
+
+err_tune_range:
+    free (re);
+err_work_alloc:
+err_inv_param:
+    return err;
+}
+
+/* State shared by the threads of a batch. Each thread takes the next job
+ * until there are none left */
+typedef struct {
+    bpm_spec_t *spec;
+    bpm_spec_job_t *jobs;
+    size_t num_jobs;
+    size_t next_job;                /* Next job to take */
+    double tune_min;
+    double tune_max;
+} bpm_spec_batch_t;
+
+static void *_bpm_spec_batch_worker (void *arg)
+{
+    bpm_spec_batch_t *batch = (bpm_spec_batch_t *) arg;
+    size_t n = batch->spec->fft_size;
+
+    /* The jobs left are taken by the other threads */
+    float *re = (float *) malloc (2 * n * sizeof (*re));
+    if (re == NULL) {
+        return NULL;
+    }
+
+    while (1) {
+        size_t i = __atomic_fetch_add (&batch->next_job, 1, __ATOMIC_RELAXED);
+        if (i >= batch->num_jobs) {
+            break;
+        }
+
+        bpm_spec_job_t *job = &batch->jobs [i];
+        job->err = (job->chan < BPM_SPEC_NUM_CHAN && job->data != NULL) ?
+            _bpm_spec_tune (batch->spec, job->data, job->num_samples, job->chan,
+                    batch->tune_min, batch->tune_max, re, re + n, &job->tune) :
+            BPM_CLIENT_ERR_INV_PARAM;
+    }
+
+    free (re);
+    return NULL;
+}
+
+bpm_client_err_e bpm_spec_tune_batch (bpm_spec_t *self, bpm_spec_job_t *jobs,
+        size_t num_jobs, double tune_min, double tune_max, uint32_t num_threads)
+{
+    assert (self);
+    assert (jobs || num_jobs == 0);
+
+    if (num_threads == 0) {
+        long num_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+        num_threads = (num_cpus > 0) ? (uint32_t) num_cpus : 1;
+    }
+    if (num_threads > num_jobs) {
+        num_threads = (num_jobs > 0) ? num_jobs : 1;
+    }
+
+    /* Jobs no thread got to, if they all fail to allocate */
+    for (size_t i = 0; i < num_jobs; ++i) {
+        jobs [i].err = BPM_CLIENT_ERR_ALLOC;
+    }
+
+    bpm_spec_batch_t batch = {.spec = self, .jobs = jobs, .num_jobs = num_jobs,
+        .next_job = 0, .tune_min = tune_min, .tune_max = tune_max};
+
+    /* The calling thread is one of the workers. If threads can not be
+     * created, the ones we have do all of the work */
+    pthread_t *threads = (pthread_t *) malloc (num_threads * sizeof (*threads));
+    uint32_t num_started = 0;
+    for (uint32_t t = 1; threads != NULL && t < num_threads; ++t) {
+        if (pthread_create (&threads [num_started], NULL,
+                    _bpm_spec_batch_worker, &batch) != 0) {
+            DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_WARN, "[libclient:spec] "
+                    "Could only start %u of %u threads\n", num_started + 1,
+                    num_threads);
+            break;
+        }
+        ++num_started;
+    }
+
+    _bpm_spec_batch_worker (&batch);
+    for (uint32_t t = 0; t < num_started; ++t) {
+        pthread_join (threads [t], NULL);
+    }
+    free (threads);
+
+    bpm_client_err_e err = BPM_CLIENT_SUCCESS;
+    for (size_t i = 0; i < num_jobs && err == BPM_CLIENT_SUCCESS; ++i) {
+        err = jobs [i].err;
+    }
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_TRACE, "[libclient:spec] Tunes of %zu "
+            "curves computed with %u threads\n", num_jobs, num_started + 1);
+
+    return err;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <immintrin.h>
+#define BPM_STATUS_CPU_RELAX()          _mm_pause ()
+#else
+#define BPM_STATUS_CPU_RELAX()          do {} while (0)
+#endif
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LIB_CLIENT, "[libclient:status]", \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LIB_CLIENT, "[libclient:status]", \
+            bpm_client_err_str(BPM_CLIENT_ERR_ALLOC),       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LIB_CLIENT, "[libclient:status]",    \
+            bpm_client_err_str (err_type))
+
+struct _bpm_status_t {
+    const smio_status_page_t *page;     /* Mapped status page */
+};
+
+static bpm_client_err_e _bpm_status_read (const smio_status_hdr_t *hdr,
+        void *sect, size_t size);
+
+bpm_status_t *bpm_status_open (const char *devio_name)
+{
+    assert (devio_name);
+
+    char shm_name [SMIO_STATUS_SHM_NAME_MAX_LEN];
+    int rc = snprintf (shm_name, sizeof (shm_name), "%s%s",
+            SMIO_STATUS_SHM_NAME_PREFIX, devio_name);
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (shm_name),
+           "Shared memory name is too long", err_shm_name);
+
+    int fd = shm_open (shm_name, O_RDONLY, 0);
+    ASSERT_TEST(fd >= 0, "Could not open shared memory object", err_shm_open);
+
+    /* A page of another layout is of no use to us */
+    struct stat shm_stat;
+    rc = fstat (fd, &shm_stat);
+    ASSERT_TEST(rc == 0 && (size_t) shm_stat.st_size == sizeof (smio_status_page_t),
+            "Status page has an unexpected size", err_shm_stat);
+
+    void *page = mmap (NULL, sizeof (smio_status_page_t), PROT_READ, MAP_SHARED,
+            fd, 0);
+    ASSERT_TEST(page != MAP_FAILED, "Could not map shared memory region",
+            err_shm_mmap);
+    /* The mapping stays valid after closing the descriptor */
+    close (fd);
+
+    const smio_status_page_t *status = (const smio_status_page_t *) page;
+    ASSERT_TEST(__atomic_load_n (&status->magic, __ATOMIC_ACQUIRE) == SMIO_STATUS_MAGIC &&
+            status->version == SMIO_STATUS_VERSION, "Status page is not valid",
+            err_page_inv);
+
+    bpm_status_t *self = (bpm_status_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+    self->page = status;
+
+    DBE_DEBUG (DBG_LIB_CLIENT | DBG_LVL_INFO, "[libclient:status] Mapped "
+            "status page %s\n", shm_name);
+
+    return self;
+
+err_self_alloc:
+err_page_inv:
+    munmap (page, sizeof (smio_status_page_t));
+    return NULL;
+err_shm_mmap:
+err_shm_stat:
+    close (fd);
+err_shm_open:
+err_shm_name:
+    return NULL;
+}
+
+void bpm_status_close (bpm_status_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        bpm_status_t *self = *self_p;
+
+        munmap ((void *) self->page, sizeof (*self->page));
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+bpm_client_err_e bpm_status_read_dsp (bpm_status_t *self, uint32_t inst_id,
+        smio_status_dsp_t *dsp)
+{
+    assert (self);
+    assert (dsp);
+
+    if (inst_id >= SMIO_STATUS_MAX_INST) {
+        return BPM_CLIENT_ERR_INV_PARAM;
+    }
+
+    const smio_status_dsp_t *sect = &self->page->dsp [inst_id];
+    return _bpm_status_read (&sect->hdr, dsp, sizeof (*dsp));
+}
+
+bpm_client_err_e bpm_status_read_acq (bpm_status_t *self, uint32_t inst_id,
+        smio_status_acq_t *acq)
+{
+    assert (self);
+    assert (acq);
+
+    if (inst_id >= SMIO_STATUS_MAX_INST) {
+        return BPM_CLIENT_ERR_INV_PARAM;
+    }
+
+    const smio_status_acq_t *sect = &self->page->acq [inst_id];
+    return _bpm_status_read (&sect->hdr, acq, sizeof (*acq));
+}
+
+bpm_client_err_e bpm_status_read_rffe (bpm_status_t *self, uint32_t inst_id,
+        smio_status_rffe_t *rffe)
+{
+    assert (self);
+    assert (rffe);
+
+    if (inst_id >= SMIO_STATUS_MAX_INST) {
+        return BPM_CLIENT_ERR_INV_PARAM;
+    }
+
+    const smio_status_rffe_t *sect = &self->page->rffe [inst_id];
+    return _bpm_status_read (&sect->hdr, rffe, sizeof (*rffe));
+}
+
+/***************** Static functions *****************/
+
+/* Copy the "size" bytes of the section starting at "hdr" to "sect", under
+ * the sequence lock. The copy is only good if no write was in progress
+ * before or after it */
+static bpm_client_err_e _bpm_status_read (const smio_status_hdr_t *hdr,
+        void *sect, size_t size)
+{
+    for (uint32_t i = 0; i < BPM_STATUS_READ_TRIES; ++i) {
+        uint32_t seq = __atomic_load_n (&hdr->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            BPM_STATUS_CPU_RELAX ();
+            continue;
+        }
+
+        memcpy (sect, hdr, size);
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n (&hdr->seq, __ATOMIC_RELAXED) == seq) {
+            const smio_status_hdr_t *copy = (const smio_status_hdr_t *) sect;
+            return (copy->timestamp != 0) ? BPM_CLIENT_SUCCESS :
+                BPM_CLIENT_ERR_AGAIN;
+        }
+        BPM_STATUS_CPU_RELAX ();
+    }
+
+    return BPM_CLIENT_ERR_AGAIN;
+}
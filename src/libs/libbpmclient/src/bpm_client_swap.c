@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_client.h"
+/* Private headers */
+#include "errhand.h"
+#include "sm_io_swap_useful_macros.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define BPM_SWAP_X86
+#include <immintrin.h>
+#elif defined (__ARM_NEON)
+#define BPM_SWAP_NEON
+#include <arm_neon.h>
+#endif
+
+/* Partner of a channel in the inverted state. A <-> C and B <-> D */
+#define BPM_SWAP_PARTNER(chan)          ((chan) ^ 2)
+
+/* Deswitch "num_samples" samples, all in the same state, with the gains of
+ * that state. If "inv" is set, signal X is taken from its partner channel */
+typedef void (*bpm_swap_run_fp) (float *const dst [BPM_SWAP_NUM_CHAN],
+        const int16_t *src, size_t num_samples, const float *gains, bool inv);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    bpm_swap_run_fp run;
+} bpm_swap_ops_t;
+
+/************ Scalar kernels **********/
+
+static void _bpm_swap_run_scalar (float *const dst [BPM_SWAP_NUM_CHAN],
+        const int16_t *src, size_t num_samples, const float *gains, bool inv)
+{
+    for (size_t i = 0; i < num_samples; ++i) {
+        for (uint32_t c = 0; c < BPM_SWAP_NUM_CHAN; ++c) {
+            uint32_t chan = inv ? BPM_SWAP_PARTNER(c) : c;
+            dst [c][i] = src [i*BPM_SWAP_NUM_CHAN + chan] * gains [c];
+        }
+    }
+}
+
+#if defined (BPM_SWAP_X86)
+
+/************ SSE2 kernels **********/
+
+/* Sign extend the 4 channels of the sample at "p" to floats */
+__attribute__ ((target ("sse2")))
+static inline __m128 _bpm_swap_load_sse2 (const int16_t *p)
+{
+    __m128i v = _mm_loadl_epi64 ((const __m128i *) p);
+    return _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16));
+}
+
+/* 4 samples per iteration, transposed to 4 signals */
+__attribute__ ((target ("sse2")))
+static void _bpm_swap_run_sse2 (float *const dst [BPM_SWAP_NUM_CHAN],
+        const int16_t *src, size_t num_samples, const float *gains, bool inv)
+{
+    const __m128 g = _mm_loadu_ps (gains);
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        const int16_t *p = src + i*BPM_SWAP_NUM_CHAN;
+        __m128 s0 = _bpm_swap_load_sse2 (p);
+        __m128 s1 = _bpm_swap_load_sse2 (p + BPM_SWAP_NUM_CHAN);
+        __m128 s2 = _bpm_swap_load_sse2 (p + 2*BPM_SWAP_NUM_CHAN);
+        __m128 s3 = _bpm_swap_load_sse2 (p + 3*BPM_SWAP_NUM_CHAN);
+
+        if (inv) {
+            s0 = _mm_shuffle_ps (s0, s0, _MM_SHUFFLE(1, 0, 3, 2));
+            s1 = _mm_shuffle_ps (s1, s1, _MM_SHUFFLE(1, 0, 3, 2));
+            s2 = _mm_shuffle_ps (s2, s2, _MM_SHUFFLE(1, 0, 3, 2));
+            s3 = _mm_shuffle_ps (s3, s3, _MM_SHUFFLE(1, 0, 3, 2));
+        }
+
+        s0 = _mm_mul_ps (s0, g);
+        s1 = _mm_mul_ps (s1, g);
+        s2 = _mm_mul_ps (s2, g);
+        s3 = _mm_mul_ps (s3, g);
+        _MM_TRANSPOSE4_PS (s0, s1, s2, s3);
+
+        _mm_storeu_ps (dst [0] + i, s0);
+        _mm_storeu_ps (dst [1] + i, s1);
+        _mm_storeu_ps (dst [2] + i, s2);
+        _mm_storeu_ps (dst [3] + i, s3);
+    }
+
+    float *const rest [BPM_SWAP_NUM_CHAN] = {dst [0] + i, dst [1] + i,
+        dst [2] + i, dst [3] + i};
+    _bpm_swap_run_scalar (rest, src + i*BPM_SWAP_NUM_CHAN,
+            num_samples - i, gains, inv);
+}
+
+/************ AVX2 kernels **********/
+
+/* 8 samples per iteration. Each 128-bit load holds 2 samples, which end up
+ * in the two lanes of a vector. The lanes are regrouped so that lane 0 has
+ * samples 0 to 3 and lane 1 samples 4 to 7, and each lane is transposed */
+__attribute__ ((target ("avx2")))
+static void _bpm_swap_run_avx2 (float *const dst [BPM_SWAP_NUM_CHAN],
+        const int16_t *src, size_t num_samples, const float *gains, bool inv)
+{
+    const __m256 g = _mm256_broadcast_ps ((const __m128 *) gains);
+    size_t i = 0;
+
+    for (; i + 8 <= num_samples; i += 8) {
+        const __m128i *p = (const __m128i *) (src + i*BPM_SWAP_NUM_CHAN);
+        __m256 r0 = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm_loadu_si128 (p)));
+        __m256 r1 = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm_loadu_si128 (p + 1)));
+        __m256 r2 = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm_loadu_si128 (p + 2)));
+        __m256 r3 = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm_loadu_si128 (p + 3)));
+
+        if (inv) {
+            r0 = _mm256_permute_ps (r0, _MM_SHUFFLE(1, 0, 3, 2));
+            r1 = _mm256_permute_ps (r1, _MM_SHUFFLE(1, 0, 3, 2));
+            r2 = _mm256_permute_ps (r2, _MM_SHUFFLE(1, 0, 3, 2));
+            r3 = _mm256_permute_ps (r3, _MM_SHUFFLE(1, 0, 3, 2));
+        }
+
+        r0 = _mm256_mul_ps (r0, g);
+        r1 = _mm256_mul_ps (r1, g);
+        r2 = _mm256_mul_ps (r2, g);
+        r3 = _mm256_mul_ps (r3, g);
+
+        /* Samples (0, 4), (2, 6), (1, 5) and (3, 7) */
+        __m256 t0 = _mm256_permute2f128_ps (r0, r2, 0x20);
+        __m256 t1 = _mm256_permute2f128_ps (r1, r3, 0x20);
+        __m256 t2 = _mm256_permute2f128_ps (r0, r2, 0x31);
+        __m256 t3 = _mm256_permute2f128_ps (r1, r3, 0x31);
+
+        __m256 ab01 = _mm256_unpacklo_ps (t0, t2);
+        __m256 cd01 = _mm256_unpackhi_ps (t0, t2);
+        __m256 ab23 = _mm256_unpacklo_ps (t1, t3);
+        __m256 cd23 = _mm256_unpackhi_ps (t1, t3);
+
+        _mm256_storeu_ps (dst [0] + i, _mm256_shuffle_ps (ab01, ab23, _MM_SHUFFLE(1, 0, 1, 0)));
+        _mm256_storeu_ps (dst [1] + i, _mm256_shuffle_ps (ab01, ab23, _MM_SHUFFLE(3, 2, 3, 2)));
+        _mm256_storeu_ps (dst [2] + i, _mm256_shuffle_ps (cd01, cd23, _MM_SHUFFLE(1, 0, 1, 0)));
+        _mm256_storeu_ps (dst [3] + i, _mm256_shuffle_ps (cd01, cd23, _MM_SHUFFLE(3, 2, 3, 2)));
+    }
+
+    float *const rest [BPM_SWAP_NUM_CHAN] = {dst [0] + i, dst [1] + i,
+        dst [2] + i, dst [3] + i};
+    _bpm_swap_run_sse2 (rest, src + i*BPM_SWAP_NUM_CHAN,
+            num_samples - i, gains, inv);
+}
+
+#endif
+
+#if defined (BPM_SWAP_NEON)
+
+/************ NEON kernels **********/
+
+/* 4 samples per iteration, deinterleaved by the load itself */
+static void _bpm_swap_run_neon (float *const dst [BPM_SWAP_NUM_CHAN],
+        const int16_t *src, size_t num_samples, const float *gains, bool inv)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4) {
+        int16x4x4_t v = vld4_s16 (src + i*BPM_SWAP_NUM_CHAN);
+
+        for (uint32_t c = 0; c < BPM_SWAP_NUM_CHAN; ++c) {
+            int16x4_t chan = v.val [inv ? BPM_SWAP_PARTNER(c) : c];
+            float32x4_t f = vcvtq_f32_s32 (vmovl_s16 (chan));
+            vst1q_f32 (dst [c] + i, vmulq_n_f32 (f, gains [c]));
+        }
+    }
+
+    float *const rest [BPM_SWAP_NUM_CHAN] = {dst [0] + i, dst [1] + i,
+        dst [2] + i, dst [3] + i};
+    _bpm_swap_run_scalar (rest, src + i*BPM_SWAP_NUM_CHAN,
+            num_samples - i, gains, inv);
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used */
+static const bpm_swap_ops_t bpm_swap_ops [] = {
+#if defined (BPM_SWAP_X86)
+    {.name = "avx2",    .run = _bpm_swap_run_avx2},
+    {.name = "sse2",    .run = _bpm_swap_run_sse2},
+#endif
+#if defined (BPM_SWAP_NEON)
+    {.name = "neon",    .run = _bpm_swap_run_neon},
+#endif
+    {.name = "scalar",  .run = _bpm_swap_run_scalar}
+};
+
+#define BPM_SWAP_OPS_NUM                (sizeof (bpm_swap_ops) / \
+                                            sizeof (bpm_swap_ops [0]))
+
+static bool _bpm_swap_supported (const bpm_swap_ops_t *ops)
+{
+#if defined (BPM_SWAP_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "avx2")) {
+        return __builtin_cpu_supports ("avx2");
+    }
+    if (streq (ops->name, "sse2")) {
+        return __builtin_cpu_supports ("sse2");
+    }
+#endif
+    /* NEON is part of the architecture if the compiler targets it */
+    return true;
+}
+
+static const bpm_swap_ops_t *_bpm_swap_get_ops (void)
+{
+    /* Selecting it twice from different threads is harmless */
+    static const bpm_swap_ops_t *ops = NULL;
+
+    if (ops == NULL) {
+        size_t i;
+        for (i = 0; i < BPM_SWAP_OPS_NUM - 1; ++i) {
+            if (_bpm_swap_supported (&bpm_swap_ops [i])) {
+                break;
+            }
+        }
+        /* The scalar kernel is always supported */
+        ops = &bpm_swap_ops [i];
+    }
+
+    return ops;
+}
+
+void bpm_swap_gains_from_profile (bpm_swap_gains_t *gains,
+        const struct _smio_swap_profile_t *profile)
+{
+    assert (gains);
+    assert (profile);
+
+    const uint32_t regs [BPM_SWAP_NUM_CHAN] = {profile->gain_a,
+        profile->gain_b, profile->gain_c, profile->gain_d};
+
+    for (uint32_t c = 0; c < BPM_SWAP_NUM_CHAN; ++c) {
+        gains->dir [c] = (float) RW_SWAP_GAIN_LOWER_R(regs [c]) / BPM_SWAP_GAIN_UNITY;
+        gains->inv [c] = (float) RW_SWAP_GAIN_UPPER_R(regs [c]) / BPM_SWAP_GAIN_UNITY;
+    }
+}
+
+const char *bpm_swap_kernel_name (void)
+{
+    return _bpm_swap_get_ops ()->name;
+}
+
+void bpm_swap_deswitch (float *dst [BPM_SWAP_NUM_CHAN], const int16_t *src,
+        size_t num_samples, const bpm_swap_gains_t *gains, uint32_t half_period,
+        uint32_t phase)
+{
+    assert (dst);
+    assert (src);
+    assert (gains);
+
+    const bpm_swap_ops_t *ops = _bpm_swap_get_ops ();
+
+    if (half_period == 0) {
+        ops->run (dst, src, num_samples, gains->dir, false);
+        return;
+    }
+
+    /* One run per switching state */
+    phase %= 2*half_period;
+    bool inv = phase >= half_period;
+    size_t run_len = half_period - phase % half_period;
+
+    for (size_t i = 0; i < num_samples; i += run_len, run_len = half_period) {
+        if (run_len > num_samples - i) {
+            run_len = num_samples - i;
+        }
+
+        float *const run_dst [BPM_SWAP_NUM_CHAN] = {dst [0] + i, dst [1] + i,
+            dst [2] + i, dst [3] + i};
+        ops->run (run_dst, src + i*BPM_SWAP_NUM_CHAN, run_len,
+                inv ? gains->inv : gains->dir, inv);
+        inv = !inv;
+    }
+}
+
+size_t bpm_swap_average (float *dst [BPM_SWAP_NUM_CHAN],
+        float *const src [BPM_SWAP_NUM_CHAN], size_t num_samples,
+        uint32_t half_period)
+{
+    assert (dst);
+    assert (src);
+    assert (half_period > 0);
+
+    const size_t period = 2*(size_t) half_period;
+    const size_t num_avgs = num_samples / period;
+
+    for (uint32_t c = 0; c < BPM_SWAP_NUM_CHAN; ++c) {
+        for (size_t k = 0; k < num_avgs; ++k) {
+            const float *s = src [c] + k*period;
+            /* Independent partial sums, so the compiler can vectorize it */
+            float acc [8] = {0};
+            size_t i = 0;
+
+            for (; i + 8 <= period; i += 8) {
+                for (uint32_t j = 0; j < 8; ++j) {
+                    acc [j] += s [i + j];
+                }
+            }
+            for (; i < period; ++i) {
+                acc [0] += s [i];
+            }
+
+            dst [c][k] = (acc [0] + acc [1] + acc [2] + acc [3] + acc [4] +
+                    acc [5] + acc [6] + acc [7]) / period;
+        }
+    }
+
+    return num_avgs;
+}
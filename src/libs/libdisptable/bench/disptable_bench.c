@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Micro-benchmark of the dispatch table lookup + call path for each of the
+ * available backends. Keys are dense opcodes, just like the ones used
+ * by the SMIOs */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "disptable.h"
+
+#define DFLT_NUM_OPS                16
+#define MAX_NUM_OPS                 1024
+#define DFLT_NUM_CALLS              (1 << 22)
+
+static int _bench_func (void *owner, void *args, void *ret)
+{
+    (void) args;
+    (void) ret;
+    ++*(uint64_t *) owner;
+    return 0;
+}
+
+static disp_table_err_e _bench_check_msg_args (disp_table_t *disp_table,
+        const disp_op_t *disp_op, const disp_op_sig_t *sig, void *args)
+{
+    (void) disp_table;
+    (void) disp_op;
+    (void) sig;
+    (void) args;
+    return DISP_TABLE_SUCCESS;
+}
+
+static const disp_table_ops_t bench_disp_table_ops = {
+    .check_msg_args = _bench_check_msg_args
+};
+
+static const char *backend_names [DISP_TABLE_BACKEND_END] = {
+    [DISP_TABLE_BACKEND_ARRAY] = "array",
+    [DISP_TABLE_BACKEND_HASH] = "hash"
+};
+
+static int _bench_backend (disp_table_backend_e backend, const disp_op_t **ops,
+        uint32_t num_ops, uint32_t num_calls, int csv)
+{
+    disp_table_t *disp_table = disp_table_new_backend (&bench_disp_table_ops,
+            backend);
+    if (disp_table == NULL) {
+        fprintf (stderr, "[disptable_bench] Could not create %s dispatch table\n",
+                backend_names [backend]);
+        return -1;
+    }
+
+    int err = 0;
+    disp_table_err_e derr = disp_table_insert_all (disp_table, ops);
+    if (derr != DISP_TABLE_SUCCESS) {
+        fprintf (stderr, "[disptable_bench] Could not insert operations: %s\n",
+                disp_table_err_str (derr));
+        err = -1;
+        goto err_insert_all;
+    }
+
+    uint64_t count = 0;
+    int64_t start = zclock_usecs ();
+    for (uint32_t i = 0; i < num_calls; ++i) {
+        disp_table_call (disp_table, i % num_ops, &count, NULL, NULL);
+    }
+    int64_t elapsed = zclock_usecs () - start;
+
+    if (count != num_calls) {
+        fprintf (stderr, "[disptable_bench] Only %"PRIu64" out of %u calls "
+                "were dispatched\n", count, num_calls);
+        err = -1;
+    }
+
+    if (csv) {
+        fprintf (stdout, "disptable,%s,%u,%u,%.1f\n", backend_names [backend],
+                num_ops, num_calls, (double) elapsed * 1000.0 / num_calls);
+    }
+    else {
+        fprintf (stdout, "%8s %10u %12.1f\n", backend_names [backend], num_ops,
+                (double) elapsed * 1000.0 / num_calls);
+    }
+
+err_insert_all:
+    disp_table_destroy (&disp_table);
+    return err;
+}
+
+/* Usage: disptable_bench [-x] [num_ops] [num_calls]. -x selects
+ * machine-readable (CSV) output */
+int main (int argc, char *argv [])
+{
+    int csv = 0;
+    if (argc > 1 && strcmp (argv [1], "-x") == 0) {
+        csv = 1;
+        --argc;
+        ++argv;
+    }
+
+    uint32_t num_ops = (argc > 1) ? strtoul (argv [1], NULL, 10) : DFLT_NUM_OPS;
+    uint32_t num_calls = (argc > 2) ? strtoul (argv [2], NULL, 10) : DFLT_NUM_CALLS;
+
+    if (num_ops == 0 || num_ops > MAX_NUM_OPS) {
+        fprintf (stderr, "[disptable_bench] Number of operations must be "
+                "between 1 and %u\n", MAX_NUM_OPS);
+        return 1;
+    }
+
+    /* Suppress all log messages, so we measure only the dispatch path */
+    errhand_set_log (NULL, "w");
+
+    disp_op_t **ops = zmalloc ((num_ops + 1) * sizeof (*ops));
+    if (ops == NULL) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < num_ops; ++i) {
+        /* One extra word for the DISP_ARG_END argument terminator */
+        ops [i] = zmalloc (sizeof (disp_op_t) + sizeof (uint32_t));
+        ops [i]->name = "bench_func";
+        ops [i]->opcode = i;
+        ops [i]->func_fp = _bench_func;
+        ops [i]->retval = DISP_ARG_END;
+        ops [i]->retval_owner = DISP_OWNER_OTHER;
+        ops [i]->args [0] = DISP_ARG_END;
+    }
+    ops [num_ops] = NULL;
+
+    if (csv) {
+        fprintf (stdout, "bench,backend,ops,calls,ns_call\n");
+    }
+    else {
+        fprintf (stdout, "%8s %10s %12s\n", "backend", "ops", "ns/call");
+    }
+    int err = 0;
+    for (int backend = 0; backend < DISP_TABLE_BACKEND_END; ++backend) {
+        err |= _bench_backend (backend, (const disp_op_t **) ops, num_ops,
+                num_calls, csv);
+    }
+
+    for (uint32_t i = 0; i < num_ops; ++i) {
+        free (ops [i]);
+    }
+    free (ops);
+
+    return (err == 0) ? 0 : 1;
+}
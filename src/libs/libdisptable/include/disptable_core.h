@@ -20,6 +20,21 @@ extern "C" {
 
 /* Opaque class structure */
 typedef struct _disp_table_t disp_table_t;
+/* Opaque recycler of return buffers */
+typedef struct _disp_ret_slab_t disp_ret_slab_t;
+
+/* Storage backend for the dispatch table */
+typedef enum {
+    DISP_TABLE_BACKEND_ARRAY = 0,   /* Array indexed directly by the key. Keys
+                                       must be small integers, up to
+                                       DISP_TABLE_ARRAY_MAX_SIZE-1 */
+    DISP_TABLE_BACKEND_HASH,        /* Hash table keyed by the stringified key */
+    DISP_TABLE_BACKEND_END
+} disp_table_backend_e;
+
+#define DISP_TABLE_BACKEND_DFLT         DISP_TABLE_BACKEND_ARRAY
+/* Maximum number of entries of the array backend */
+#define DISP_TABLE_ARRAY_MAX_SIZE       (1 << 16)
 
 /* Generic function pointer */
 typedef int (*disp_table_func_fp)(void *owner, void * args, void *ret);
@@ -68,9 +83,17 @@ typedef struct {
     uint32_t args [];                       /* Zero-terminated */
 } disp_op_t;
 
+/* Shape of the arguments of an operation, computed from disp_op->args when
+ * it is inserted, so that messages are checked without decoding it */
+typedef struct {
+    uint32_t num_args;                      /* Number of arguments */
+    uint32_t size;                          /* Sum of the argument sizes */
+    bool var_size;                          /* Any DISP_ATYPE_VAR argument */
+} disp_op_sig_t;
+
 /* Check message arguments function pointer */
 typedef disp_table_err_e (*check_msg_args_fp)(disp_table_t *self,
-        const disp_op_t *disp_op, void *args);
+        const disp_op_t *disp_op, const disp_op_sig_t *sig, void *args);
 
 /* Dispatch table operations */
 typedef struct {
@@ -80,7 +103,9 @@ typedef struct {
 /* Handler for the Dispatch exported function */
 typedef struct {
     const disp_op_t *op;                    /* Function description */
+    disp_op_sig_t sig;                      /* Shape of the arguments */
     void *ret;                              /* Buffer for function return value */
+    disp_ret_slab_t *ret_slab;              /* Buffers of disp_table_get_ret () */
 } disp_op_handler_t;
 
 /************************************************************/
@@ -89,13 +114,17 @@ typedef struct {
 
 /* Check message arguments */
 disp_table_err_e disp_table_ops_check_msg (disp_table_t *self, const disp_op_t *disp_op,
-        void *args);
+        const disp_op_sig_t *sig, void *args);
 
 /************************************************************/
 /************************* Our methods **********************/
 /************************************************************/
 
+/* Creates a new dispatch table with the default backend */
 disp_table_t *disp_table_new (const disp_table_ops_t *ops);
+/* Creates a new dispatch table with the specified backend */
+disp_table_t *disp_table_new_backend (const disp_table_ops_t *ops,
+        disp_table_backend_e backend);
 disp_table_err_e disp_table_destroy (disp_table_t **self_p);
 
 disp_table_err_e disp_table_insert (disp_table_t *self, const disp_op_t *disp_op);
@@ -115,7 +144,25 @@ int disp_table_call (disp_table_t *self, uint32_t key, void *owner, void *args,
         void *ret);
 int disp_table_check_call (disp_table_t *self, uint32_t key, void *owner,
         void *args, void **ret);
+/* Same as disp_table_check_call (), but with a single lookup of the handler
+ * for the argument check, the return value and the call */
+int disp_table_dispatch (disp_table_t *self, uint32_t key, void *owner,
+        void *args, void **ret);
 disp_table_err_e disp_table_set_ret (disp_table_t *self, uint32_t key, void **ret);
+/* Get a return buffer of function "key" for a reply which outlives the call
+ * (e.g., a deferred one), as the one used by disp_table_dispatch () is reused
+ * by the next call. Buffers are recycled, so their contents are undefined.
+ * NULL if the function has no return value or owns it */
+void *disp_table_get_ret (disp_table_t *self, uint32_t key);
+/* Give back a buffer from disp_table_get_ret (), once the reply is sent.
+ * This may be called from any thread, even after the table is destroyed */
+void disp_table_put_ret (void *ret);
+/* Allocate all of the return buffers kept for reuse by function "key" now,
+ * so disp_table_get_ret () does not allocate them on the first requests */
+disp_table_err_e disp_table_prealloc_ret (disp_table_t *self, uint32_t key);
+/* Same as disp_table_put_ret (), with the signature of a zmq_free_fn, so
+ * buffers can be handed to zmq_msg_init_data () without copying them */
+void disp_table_ret_free (void *ret, void *hint);
 
 /************************************************************/
 /**************** Disp Op Handler functions *****************/
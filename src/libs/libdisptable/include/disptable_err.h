@@ -22,6 +22,8 @@ enum _disp_table_err_e
     DISP_TABLE_ERR_NULL_POINTER,          /* Null pointer received */
     DISP_TABLE_ERR_NO_FUNC_REG,           /* No function registered */
     DISP_TABLE_ERR_BAD_MSG,               /* Bad message detected */
+    DISP_TABLE_ERR_KEY_EXISTS,            /* Key is already registered */
+    DISP_TABLE_ERR_KEY_OOR,               /* Key is out of range for the backend */
     DISP_TABLE_ERR_END
 };
 
@@ -11,6 +11,8 @@
  * In the end, I changed much of the original code and only the main
  * idea with a couple of the original structures remain */
 
+#include <pthread.h>
+
 #include "disptable.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
@@ -36,15 +38,44 @@
     CHECK_HAL_ERR(err, HAL_UTILS, "[disp_table]",                               \
             disp_table_err_str (err_type))
 
+/* Initial number of entries of the array backend. Grows as needed */
+#define DISP_TABLE_ARRAY_DFLT_SIZE          32
+/* Maximum number of return buffers kept for reuse by each handler */
+#define DISP_RET_SLAB_SIZE                  8
+/* Room in front of each recycled return buffer for its slab pointer. This
+ * keeps the malloc alignment of the buffer itself */
+#define DISP_RET_HDR_SIZE                   16
+
 struct _disp_table_t {
+    /* Storage backend for the handlers */
+    disp_table_backend_e backend;
+    /* Array containing all the operations that we need to handle, indexed
+     * directly by the opcode. Used by the DISP_TABLE_BACKEND_ARRAY backend */
+    disp_op_handler_t **table_a;
+    /* Number of entries in table_a */
+    uint32_t table_a_size;
     /* Hash containg all the sm_io thsafe operations
      * that we need to handle. It is composed
-     * of key (4-char ID) / value (pointer to funtion) */
+     * of key (4-char ID) / value (pointer to funtion).
+     * Used by the DISP_TABLE_BACKEND_HASH backend */
     zhashx_t *table_h;
     /* Dispatch table operations */
     const disp_table_ops_t *ops;
 };
 
+/* Return buffers of one handler. Buffers may be given back by other threads
+ * (e.g., by zmq when a zero-copy message is done with) and after the
+ * handler is gone, so the slab is reference counted by the handler and by
+ * each buffer in use */
+struct _disp_ret_slab_t {
+    pthread_mutex_t lock;                   /* Protects everything below */
+    size_t size;                            /* Size of each buffer */
+    uint32_t refs;                          /* Handler + buffers in use */
+    bool orphan;                            /* The handler is gone */
+    uint32_t num_free;                      /* Buffers in free_bufs */
+    void *free_bufs [DISP_RET_SLAB_SIZE];   /* Buffers ready for reuse */
+};
+
 static disp_table_err_e _disp_table_insert (disp_table_t *self, const disp_op_t* disp_op);
 static disp_table_err_e _disp_table_insert_all (disp_table_t *self, const disp_op_t **disp_ops);
 static disp_table_err_e _disp_table_remove (disp_table_t *self, uint32_t key);
@@ -55,27 +86,65 @@ static disp_table_err_e _disp_table_check_args (disp_table_t *self, uint32_t key
 static int _disp_table_call (disp_table_t *self, uint32_t key, void *owner, void *args,
         void *ret);
 static disp_table_err_e _disp_table_alloc_ret (const disp_op_t *disp_op, void **ret);
+static void _disp_table_fill_sig (const disp_op_t *disp_op, disp_op_sig_t *sig);
 static disp_table_err_e _disp_table_set_ret (disp_table_t *self, uint32_t key, void **ret);
+static disp_ret_slab_t *_disp_ret_slab_new (size_t size);
+static void _disp_ret_slab_unref (disp_ret_slab_t *slab, bool orphan);
+
+/* Backend functions */
+static disp_table_err_e _disp_table_store (disp_table_t *self, uint32_t key,
+        disp_op_handler_t *disp_op_handler);
+static void _disp_table_erase (disp_table_t *self, uint32_t key);
 
 /* Disp Op Handler functions */
 static disp_op_handler_t *_disp_table_lookup (disp_table_t *self, uint32_t key);
 static disp_table_err_e _disp_table_set_ret_op (disp_op_handler_t *disp_op_handler, void **ret);
+static int _disp_table_call_op (disp_op_handler_t *disp_op_handler, void *owner,
+        void *args, void *ret);
 static disp_table_err_e _disp_table_cleanup_args_op (disp_op_handler_t *disp_op);
 
 disp_table_t *disp_table_new (const disp_table_ops_t *ops)
+{
+    return disp_table_new_backend (ops, DISP_TABLE_BACKEND_DFLT);
+}
+
+disp_table_t *disp_table_new_backend (const disp_table_ops_t *ops,
+        disp_table_backend_e backend)
 {
     assert (ops);
 
     disp_table_t *self = zmalloc (sizeof *self);
     ASSERT_ALLOC (self, err_self_alloc);
-    self->table_h = zhashx_new ();
-    ASSERT_ALLOC (self->table_h, err_table_h_alloc);
-    zhashx_set_destructor (self->table_h, _disp_table_free_item);
+    self->backend = backend;
+    self->table_a = NULL;
+    self->table_a_size = 0;
+    self->table_h = NULL;
+
+    switch (backend) {
+        case DISP_TABLE_BACKEND_ARRAY:
+            self->table_a = zmalloc (DISP_TABLE_ARRAY_DFLT_SIZE *
+                    sizeof (*self->table_a));
+            ASSERT_ALLOC (self->table_a, err_table_alloc);
+            self->table_a_size = DISP_TABLE_ARRAY_DFLT_SIZE;
+            break;
+
+        case DISP_TABLE_BACKEND_HASH:
+            self->table_h = zhashx_new ();
+            ASSERT_ALLOC (self->table_h, err_table_alloc);
+            zhashx_set_destructor (self->table_h, _disp_table_free_item);
+            break;
+
+        default:
+            DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_ERR,
+                    "[disp_table] Unknown backend %d\n", backend);
+            goto err_table_alloc;
+    }
+
     self->ops = ops;
 
     return self;
 
-err_table_h_alloc:
+err_table_alloc:
     free (self);
 err_self_alloc:
     return NULL;
@@ -91,6 +160,7 @@ disp_table_err_e disp_table_destroy (disp_table_t **self_p)
         _disp_table_remove_all (self);
         self->ops = NULL;
         zhashx_destroy (&self->table_h);
+        free (self->table_a);
         free (self);
         *self_p = NULL;
     }
@@ -167,7 +237,7 @@ err_disp_op_handler_null:
 const disp_op_t *disp_table_lookup (disp_table_t *self, uint32_t key)
 {
     disp_op_handler_t *disp_op_handler = _disp_table_lookup (self, key);
-    return disp_op_handler->op;
+    return (disp_op_handler != NULL) ? disp_op_handler->op : NULL;
 }
 
 int disp_table_call (disp_table_t *self, uint32_t key, void *owner, void *args,
@@ -179,20 +249,51 @@ int disp_table_call (disp_table_t *self, uint32_t key, void *owner, void *args,
 int disp_table_check_call (disp_table_t *self, uint32_t key, void *owner, void *args,
         void **ret)
 {
-    disp_table_err_e herr = DISP_TABLE_SUCCESS;
-    int err = -1;
+    return disp_table_dispatch (self, key, owner, args, ret);
+}
 
-    herr = _disp_table_check_args (self, key, args, ret);
-    ASSERT_TEST(herr == DISP_TABLE_SUCCESS, "Wrong arguments received",
-            err_invalid_args, -1);
+int disp_table_dispatch (disp_table_t *self, uint32_t key, void *owner, void *args,
+        void **ret)
+{
+    int err = -1;
+    /* Resolve the handler only once for the whole request */
+    disp_op_handler_t *disp_op_handler = _disp_table_lookup (self, key);
+    ASSERT_TEST (disp_op_handler != NULL, "Could not find registered key",
+            err_disp_op_handler_null, -1);
 
-    /* Received arguments are OK, and the return value "ret" was allocated if the
-     * ownership is ours */
+    disp_table_err_e herr = disp_table_ops_check_msg (self, disp_op_handler->op,
+            &disp_op_handler->sig, args);
+    ASSERT_TEST (herr == DISP_TABLE_SUCCESS, "Arguments received are invalid",
+            err_inv_args, -1);
 
-    /* Do the actual work... */
-    err = _disp_table_call (self, key, owner, args, *ret);
+    /* Point "ret" to previously allocated return value */
+    uint32_t acct = hutils_mem_acct_push (HUTILS_MEM_ACCT_DISP);
+    herr = _disp_table_set_ret_op (disp_op_handler, ret);
+    hutils_mem_acct_pop (acct);
+    ASSERT_TEST (herr == DISP_TABLE_SUCCESS, "Could not set return value",
+            err_set_ret, -1);
+
+    /* Handlers should not allocate in real-time mode, so the ones that do
+     * are told */
+    bool rt = hutils_mem_rt_enabled ();
+    if (rt) {
+        hutils_mem_rt_guard_begin ();
+    }
+    acct = hutils_mem_acct_push (HUTILS_MEM_ACCT_HANDLER);
+    err = _disp_table_call_op (disp_op_handler, owner, args, *ret);
+    hutils_mem_acct_pop (acct);
+    if (rt) {
+        uint32_t allocs = hutils_mem_rt_guard_end ();
+        if (allocs > 0) {
+            DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_ERR, "[disp_table] Function "
+                    "\"%s\" allocated memory %u times in real-time mode\n",
+                    disp_op_handler->op->name, allocs);
+        }
+    }
 
-err_invalid_args:
+err_set_ret:
+err_inv_args:
+err_disp_op_handler_null:
     return err;
 }
 
@@ -201,6 +302,114 @@ disp_table_err_e disp_table_set_ret (disp_table_t *self, uint32_t key, void **re
     return _disp_table_set_ret (self, key, ret);
 }
 
+void *disp_table_get_ret (disp_table_t *self, uint32_t key)
+{
+    disp_op_handler_t *disp_op_handler = _disp_table_lookup (self, key);
+    ASSERT_TEST (disp_op_handler != NULL, "Could not find registered key",
+            err_disp_op_handler_null);
+
+    const disp_op_t *disp_op = disp_op_handler->op;
+    uint32_t size = DISP_GET_ASIZE(disp_op->retval);
+    if (disp_op->retval_owner == DISP_OWNER_FUNC || size == 0) {
+        goto err_no_ret;
+    }
+
+    /* Only requests outliving the call need it, so create it lazily */
+    if (disp_op_handler->ret_slab == NULL) {
+        disp_op_handler->ret_slab = _disp_ret_slab_new (size);
+        ASSERT_ALLOC (disp_op_handler->ret_slab, err_slab_alloc);
+    }
+    disp_ret_slab_t *slab = disp_op_handler->ret_slab;
+
+    uint8_t *buf = NULL;
+    pthread_mutex_lock (&slab->lock);
+    ++slab->refs;
+    if (slab->num_free > 0) {
+        buf = slab->free_bufs [--slab->num_free];
+    }
+    pthread_mutex_unlock (&slab->lock);
+
+    if (buf == NULL) {
+        buf = (uint8_t *) zmalloc (DISP_RET_HDR_SIZE + slab->size);
+        ASSERT_ALLOC (buf, err_buf_alloc);
+        *(disp_ret_slab_t **) buf = slab;
+    }
+
+    return buf + DISP_RET_HDR_SIZE;
+
+err_buf_alloc:
+    _disp_ret_slab_unref (slab, false);
+err_slab_alloc:
+err_no_ret:
+err_disp_op_handler_null:
+    return NULL;
+}
+
+disp_table_err_e disp_table_prealloc_ret (disp_table_t *self, uint32_t key)
+{
+    disp_table_err_e err = DISP_TABLE_SUCCESS;
+    disp_op_handler_t *disp_op_handler = _disp_table_lookup (self, key);
+    ASSERT_TEST (disp_op_handler != NULL, "Could not find registered key",
+            err_disp_op_handler_null, DISP_TABLE_ERR_NO_FUNC_REG);
+
+    const disp_op_t *disp_op = disp_op_handler->op;
+    uint32_t size = DISP_GET_ASIZE(disp_op->retval);
+    if (disp_op->retval_owner == DISP_OWNER_FUNC || size == 0) {
+        goto err_no_ret;
+    }
+
+    if (disp_op_handler->ret_slab == NULL) {
+        disp_op_handler->ret_slab = _disp_ret_slab_new (size);
+        ASSERT_ALLOC (disp_op_handler->ret_slab, err_slab_alloc,
+                DISP_TABLE_ERR_ALLOC);
+    }
+    disp_ret_slab_t *slab = disp_op_handler->ret_slab;
+
+    /* Free buffers don't hold a reference to the slab */
+    pthread_mutex_lock (&slab->lock);
+    while (slab->num_free < DISP_RET_SLAB_SIZE) {
+        uint8_t *buf = (uint8_t *) zmalloc (DISP_RET_HDR_SIZE + slab->size);
+        if (buf == NULL) {
+            err = DISP_TABLE_ERR_ALLOC;
+            break;
+        }
+        *(disp_ret_slab_t **) buf = slab;
+        slab->free_bufs [slab->num_free++] = buf;
+    }
+    pthread_mutex_unlock (&slab->lock);
+
+err_slab_alloc:
+err_no_ret:
+err_disp_op_handler_null:
+    return err;
+}
+
+void disp_table_put_ret (void *ret)
+{
+    if (ret == NULL) {
+        return;
+    }
+
+    uint8_t *buf = (uint8_t *) ret - DISP_RET_HDR_SIZE;
+    disp_ret_slab_t *slab = *(disp_ret_slab_t **) buf;
+
+    pthread_mutex_lock (&slab->lock);
+    if (!slab->orphan && slab->num_free < DISP_RET_SLAB_SIZE) {
+        slab->free_bufs [slab->num_free++] = buf;
+        buf = NULL;
+    }
+    pthread_mutex_unlock (&slab->lock);
+
+    free (buf);
+    _disp_ret_slab_unref (slab, false);
+}
+
+void disp_table_ret_free (void *ret, void *hint)
+{
+    (void) hint;
+    disp_table_put_ret (ret);
+}
+
 /******************************************************************************/
 /************************** Local static functions ****************************/
 /******************************************************************************/
@@ -220,23 +429,19 @@ static disp_table_err_e _disp_table_insert (disp_table_t *self, const disp_op_t
 
     disp_op_handler->op = disp_op;
     disp_op_handler->ret = NULL;
+    _disp_table_fill_sig (disp_op, &disp_op_handler->sig);
 
     disp_table_err_e herr = _disp_table_alloc_ret (disp_op_handler->op, &disp_op_handler->ret);
     ASSERT_TEST (herr == DISP_TABLE_SUCCESS, "Return value could not be allocated",
             err_alloc_ret);
 
-    char *key_c = hutils_stringify_hex_key (disp_op_handler->op->opcode);
-    ASSERT_ALLOC (key_c, err_key_c_alloc);
-    int zerr = zhashx_insert (self->table_h, key_c, disp_op_handler);
-    ASSERT_TEST(zerr == 0, "Could not insert item into dispatch table",
-            err_insert_hash);
+    herr = _disp_table_store (self, disp_op_handler->op->opcode, disp_op_handler);
+    ASSERT_TEST(herr == DISP_TABLE_SUCCESS, "Could not insert item into dispatch table",
+            err_insert_table);
 
-    free (key_c);
     return DISP_TABLE_SUCCESS;
 
-err_insert_hash:
-    free (key_c);
-err_key_c_alloc:
+err_insert_table:
     _disp_table_cleanup_args_op (disp_op_handler);
 err_alloc_ret:
     disp_op_handler_destroy (&disp_op_handler);
@@ -275,9 +480,6 @@ err_disp_insert:
 
 static disp_table_err_e _disp_table_remove (disp_table_t *self, uint32_t key)
 {
-    char *key_c = hutils_stringify_hex_key (key);
-    ASSERT_ALLOC (key_c, err_key_c_alloc);
-
     /* Do a lookup first to free the return value */
     disp_op_handler_t *disp_op_handler = _disp_table_lookup (self, key);
     ASSERT_TEST (disp_op_handler != NULL, "Could not find registered key",
@@ -290,15 +492,11 @@ static disp_table_err_e _disp_table_remove (disp_table_t *self, uint32_t key)
     DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_TRACE,
         "[disp_table] Removing function (key = %u) into dispatch table\n",
         key);
-    /* This will trigger the free function previously registered */
-    zhashx_delete (self->table_h, key_c);
+    _disp_table_erase (self, key);
 
-    free (key_c);
     return DISP_TABLE_SUCCESS;
 
 err_disp_op_handler_null:
-    free (key_c);
-err_key_c_alloc:
     return DISP_TABLE_ERR_ALLOC;
 }
 
@@ -306,6 +504,16 @@ static disp_table_err_e _disp_table_remove_all (disp_table_t *self)
 {
     assert (self);
 
+    if (self->backend == DISP_TABLE_BACKEND_ARRAY) {
+        for (uint32_t key = 0; key < self->table_a_size; ++key) {
+            if (self->table_a[key] != NULL) {
+                _disp_table_remove (self, key);
+            }
+        }
+
+        return DISP_TABLE_SUCCESS;
+    }
+
     zlistx_t *hash_keys = zhashx_keys (self->table_h);
     void * table_item = zlistx_first (hash_keys);
 
@@ -345,6 +553,23 @@ err_no_ownership:
     return err;
 }
 
+static void _disp_table_fill_sig (const disp_op_t *disp_op, disp_op_sig_t *sig)
+{
+    assert (disp_op);
+    assert (sig);
+
+    sig->num_args = 0;
+    sig->size = 0;
+    sig->var_size = false;
+
+    for (const uint32_t *args_it = disp_op->args; *args_it != DISP_ARG_END;
+            ++args_it) {
+        ++sig->num_args;
+        sig->size += DISP_GET_ASIZE(*args_it);
+        sig->var_size |= (DISP_GET_ATYPE(*args_it) == DISP_ATYPE_VAR);
+    }
+}
+
 static disp_table_err_e _disp_table_set_ret (disp_table_t *self, uint32_t key, void **ret)
 {
     disp_table_err_e err = DISP_TABLE_SUCCESS;
@@ -368,7 +593,8 @@ static disp_table_err_e _disp_table_check_args (disp_table_t *self, uint32_t key
 
     /* Check arguments for consistency */
     /* Call registered function to check message */
-    err =  disp_table_ops_check_msg (self, disp_op_handler->op, args);
+    err =  disp_table_ops_check_msg (self, disp_op_handler->op,
+            &disp_op_handler->sig, args);
     ASSERT_TEST (err == DISP_TABLE_SUCCESS, "Arguments received are invalid",
             err_inv_args);
 
@@ -392,6 +618,18 @@ static int _disp_table_call (disp_table_t *self, uint32_t key, void *owner, void
     ASSERT_TEST (disp_op_handler != NULL, "Could not find registered key",
             err_disp_op_handler_null, -1);
 
+    err = _disp_table_call_op (disp_op_handler, owner, args, ret);
+
+err_disp_op_handler_null:
+    return err;
+}
+
+static int _disp_table_call_op (disp_op_handler_t *disp_op_handler, void *owner,
+        void *args, void *ret)
+{
+    assert (disp_op_handler);
+    int err = 0;
+
     /* Check if there is a registered function */
     ASSERT_TEST (disp_op_handler->op->func_fp != NULL, "No function registered",
             err_disp_op_handler_func_fp_null, -1);
@@ -405,7 +643,6 @@ static int _disp_table_call (disp_table_t *self, uint32_t key, void *owner, void
 
 err_inv_ret_value_null:
 err_disp_op_handler_func_fp_null:
-err_disp_op_handler_null:
     return err;
 }
 
@@ -419,6 +656,7 @@ disp_op_handler_t *disp_op_handler_new ()
     ASSERT_ALLOC (self, err_disp_op_handler_alloc);
 
     self->ret = NULL;
+    self->ret_slab = NULL;
 
     return self;
 
@@ -433,6 +671,10 @@ disp_table_err_e disp_op_handler_destroy (disp_op_handler_t **self_p)
     if (*self_p) {
         disp_op_handler_t *self = *self_p;
 
+        /* Buffers still in use keep the slab alive */
+        if (self->ret_slab != NULL) {
+            _disp_ret_slab_unref (self->ret_slab, true);
+        }
         free (self);
         *self_p = NULL;
     }
@@ -440,20 +682,126 @@ disp_table_err_e disp_op_handler_destroy (disp_op_handler_t **self_p)
     return DISP_TABLE_SUCCESS;
 }
 
+/******************************************************************************/
+/************************* Return buffer recycling ****************************/
+/******************************************************************************/
+
+static disp_ret_slab_t *_disp_ret_slab_new (size_t size)
+{
+    disp_ret_slab_t *slab = (disp_ret_slab_t *) zmalloc (sizeof *slab);
+    ASSERT_ALLOC (slab, err_slab_alloc);
+
+    pthread_mutex_init (&slab->lock, NULL);
+    slab->size = size;
+    /* The handler reference */
+    slab->refs = 1;
+
+err_slab_alloc:
+    return slab;
+}
+
+/* Drop a reference to "slab", the one of the handler if "orphan" is set */
+static void _disp_ret_slab_unref (disp_ret_slab_t *slab, bool orphan)
+{
+    pthread_mutex_lock (&slab->lock);
+    if (orphan) {
+        slab->orphan = true;
+        while (slab->num_free > 0) {
+            free (slab->free_bufs [--slab->num_free]);
+        }
+    }
+    bool last = (--slab->refs == 0);
+    pthread_mutex_unlock (&slab->lock);
+
+    if (last) {
+        pthread_mutex_destroy (&slab->lock);
+        free (slab);
+    }
+}
+
+/******************************************************************************/
+/**************************** Backend functions *******************************/
+/******************************************************************************/
+
+static disp_table_err_e _disp_table_store (disp_table_t *self, uint32_t key,
+        disp_op_handler_t *disp_op_handler)
+{
+    disp_table_err_e err = DISP_TABLE_SUCCESS;
+
+    if (self->backend == DISP_TABLE_BACKEND_HASH) {
+        char key_c [HUTILS_KEY_STR_MAX_LEN];
+        hutils_stringify_hex_key_buf (key_c, sizeof (key_c), key);
+        int zerr = zhashx_insert (self->table_h, key_c, disp_op_handler);
+        ASSERT_TEST(zerr == 0, "Key is already registered", err_key_exists,
+                DISP_TABLE_ERR_KEY_EXISTS);
+        return err;
+    }
+
+    ASSERT_TEST(key < DISP_TABLE_ARRAY_MAX_SIZE, "Key is too large for the "
+            "array backend", err_key_oor, DISP_TABLE_ERR_KEY_OOR);
+
+    /* Grow the array to fit the new key */
+    if (key >= self->table_a_size) {
+        uint32_t new_size = self->table_a_size;
+        while (key >= new_size) {
+            new_size *= 2;
+        }
+
+        disp_op_handler_t **table_a = realloc (self->table_a,
+                new_size * sizeof (*table_a));
+        ASSERT_ALLOC (table_a, err_table_realloc, DISP_TABLE_ERR_ALLOC);
+        memset (table_a + self->table_a_size, 0,
+                (new_size - self->table_a_size) * sizeof (*table_a));
+
+        self->table_a = table_a;
+        self->table_a_size = new_size;
+    }
+
+    ASSERT_TEST(self->table_a[key] == NULL, "Key is already registered",
+            err_key_exists, DISP_TABLE_ERR_KEY_EXISTS);
+    self->table_a[key] = disp_op_handler;
+
+err_key_exists:
+err_table_realloc:
+err_key_oor:
+    return err;
+}
+
+static void _disp_table_erase (disp_table_t *self, uint32_t key)
+{
+    if (self->backend == DISP_TABLE_BACKEND_ARRAY) {
+        disp_op_handler_destroy (&self->table_a[key]);
+        return;
+    }
+
+    char key_c [HUTILS_KEY_STR_MAX_LEN];
+    hutils_stringify_hex_key_buf (key_c, sizeof (key_c), key);
+    /* This will trigger the free function previously registered */
+    zhashx_delete (self->table_h, key_c);
+}
+
 static disp_op_handler_t *_disp_table_lookup (disp_table_t *self, uint32_t key)
 {
     disp_op_handler_t *disp_op_handler = NULL;
 
-    char *key_c = hutils_stringify_hex_key (key);
-    ASSERT_ALLOC (key_c, err_key_c_alloc);
+    /* Fast path. No allocations needed, just an index */
+    if (self->backend == DISP_TABLE_BACKEND_ARRAY) {
+        disp_op_handler = (key < self->table_a_size) ? self->table_a[key] : NULL;
+        ASSERT_TEST (disp_op_handler != NULL, "Could not find registered function",
+                err_array_func_p_wrapper_null);
+        return disp_op_handler;
+    }
+
+    /* Hex keys always fit */
+    char key_c [HUTILS_KEY_STR_MAX_LEN];
+    hutils_stringify_hex_key_buf (key_c, sizeof (key_c), key);
 
     disp_op_handler = zhashx_lookup (self->table_h, key_c);
     ASSERT_TEST (disp_op_handler != NULL, "Could not find registered function",
             err_func_p_wrapper_null);
 
 err_func_p_wrapper_null:
-    free (key_c);
-err_key_c_alloc:
+err_array_func_p_wrapper_null:
     return disp_op_handler;
 }
 
@@ -526,6 +874,6 @@ err_no_ownership:
 
 /**** Check message arguments ****/
 disp_table_err_e disp_table_ops_check_msg (disp_table_t *self, const disp_op_t *disp_op,
-        void *args)
-    DISP_TABLE_FUNC_WRAPPER(check_msg_args, disp_op, args);
+        const disp_op_sig_t *sig, void *args)
+    DISP_TABLE_FUNC_WRAPPER(check_msg_args, disp_op, sig, args);
 
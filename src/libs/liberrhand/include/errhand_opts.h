@@ -71,6 +71,13 @@ extern "C" {
 
 #endif /* ERRHAND_SUBSYS_ON */
 
+/* Define if the fast trace channel (ERRHAND_TRACE) is compiled in. It is
+ * still off at runtime until a trace file is set */
+
+#ifndef ERRHAND_TRACE_ON
+#define ERRHAND_TRACE_ON 1
+#endif /* ERRHAND_TRACE_ON */
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,90 @@ struct _zmsg_t;
 void errhand_print (const char *fmt, ...) __attribute__((format(printf,1,2)));
 void errhand_print_vec (const char *fmt, const char *data, int len);
 void errhand_log_print (int dbg_lvl, const char *fmt, ...) __attribute__((format(printf,2,3)));
+/* Write out the lines logged so far. Lines are written asynchronously
+ * otherwise. Called on exit too */
+void errhand_log_flush (void);
+/* Number of lines dropped since the start, because they were logged faster
+ * than they could be written */
+uint64_t errhand_log_get_drops (void);
+/* Create the log ring of the calling thread now, instead of on its first
+ * line, so logging never allocates afterwards */
+void errhand_log_prealloc (void);
+
+/* Fast trace channel. ERRHAND_TRACE () records its integer arguments,
+ * unformatted, as binary records in a trace file. Tracing is off until a
+ * trace file is set with errhand_set_trace (), or with the environment
+ * variable ERRHAND_TRACE_FILE_ENV, taken as a prefix to which
+ * errhand_set_log () appends ".<pid>".
+ *
+ * The trace file starts with an errhand_trace_file_hdr_t and is followed by
+ * records, all in the byte order of the writer machine. A record is either
+ * an errhand_trace_fmt_rec_t, followed by the format string it defines for
+ * its id, or an errhand_trace_event_rec_t, which uses the last format string
+ * defined for its id.
+ *
+ * Stage records (ERRHAND_TRACE_STAGE ()) mark where a thread starts and stops
+ * working on a request. They are event records whose format string is the
+ * stage name, with the request id in args [0] and the ERRHAND_TRACE_BEGIN or
+ * ERRHAND_TRACE_END phase in args [1]. The request id is the one the thread
+ * set with errhand_trace_set_req (), 0 if none */
+#define ERRHAND_TRACE_FILE_ENV          "ERRHAND_TRACE_FILE"
+#define ERRHAND_TRACE_MAGIC             "ERRTRCE"
+#define ERRHAND_TRACE_MAGIC_SIZE        8
+#define ERRHAND_TRACE_VERSION           1
+#define ERRHAND_TRACE_ARGS_MAX          4
+
+#define ERRHAND_TRACE_REC_FMT           0
+#define ERRHAND_TRACE_REC_EVENT         1
+#define ERRHAND_TRACE_REC_STAGE         2
+
+#define ERRHAND_TRACE_BEGIN             0
+#define ERRHAND_TRACE_END               1
+
+typedef struct {
+    char magic [ERRHAND_TRACE_MAGIC_SIZE];      /* ERRHAND_TRACE_MAGIC, NUL terminated */
+    uint32_t version;                           /* ERRHAND_TRACE_VERSION */
+    uint32_t hdr_size;                          /* Size of this header */
+} errhand_trace_file_hdr_t;
+
+typedef struct {
+    uint32_t type;                              /* ERRHAND_TRACE_REC_FMT */
+    uint32_t id;                                /* Format string id */
+    uint32_t len;                               /* Bytes following this record. The
+                                                   string is NUL terminated and padded
+                                                   to a multiple of 8 bytes */
+    uint32_t reserved;
+} errhand_trace_fmt_rec_t;
+
+typedef struct {
+    uint32_t type;                              /* ERRHAND_TRACE_REC_EVENT or
+                                                   ERRHAND_TRACE_REC_STAGE */
+    uint32_t id;                                /* Format string id */
+    uint64_t timestamp;                         /* ns since the Epoch */
+    uint32_t tid;                               /* Thread id */
+    uint32_t dbg;                               /* Subsystem and level */
+    uint32_t num_args;                          /* Valid entries in args */
+    uint32_t reserved;
+    uint64_t args [ERRHAND_TRACE_ARGS_MAX];
+} errhand_trace_event_rec_t;
+
+/* Non-zero while a trace file is set */
+extern int errhand_trace_on;
+
+void errhand_trace_record (int dbg, const char *fmt, uint32_t num_args,
+        uint64_t arg0, uint64_t arg1, uint64_t arg2, uint64_t arg3);
+/* Start writing trace records to "trace_file_name", overwriting it, or stop
+ * tracing if NULL. Returns 0 if ok and -1 if the file could not be created */
+int errhand_set_trace (const char *trace_file_name);
+/* Number of trace records dropped since the start */
+uint64_t errhand_trace_get_drops (void);
+void errhand_trace_stage (int dbg, const char *stage, uint32_t phase);
+/* Set the request the calling thread works on, for its stage records */
+void errhand_trace_set_req (uint64_t req_id);
+uint64_t errhand_trace_get_req (void);
+/* Request id of the message "tracker" sent by "sender". Both ends of a
+ * request compute the same id this way. Never 0 */
+uint64_t errhand_trace_req_id (const char *sender, const char *tracker);
 /* Set the output logfile Defaults to STDOUT */
 void errhand_set_log_file (FILE *log_file);
 int errhand_set_log (const char *log_file_name, const char *mode);
@@ -52,13 +136,17 @@ void errhand_log_print_zmq_msg (struct _zmsg_t *msg);
  *  ERRHAND_SUBSYS   ERRHAND_LVL   ERRHAND_HALT
  */
 
+/* Whether "dbg" messages are enabled. This is a constant expression, so
+ * disabled messages, arguments included, compile to nothing */
+#define ERRHAND_ENABLED(dbg)                            \
+    (((dbg) & ERRHAND_SUBSYS_ON) &&                     \
+     (((dbg) & ERRHAND_LVL_MASK) >= ERRHAND_MIN_LEVEL))
+
 #ifdef ERRHAND_DBG
 
 #define ERRHAND_DEBUG(dbg, fmt, ...)                    \
     do {                                                \
-        if (((dbg) & ERRHAND_SUBSYS_ON) &&              \
-            (((dbg) & ERRHAND_LVL_MASK) >=              \
-            ERRHAND_MIN_LEVEL)) {                       \
+        if (ERRHAND_ENABLED(dbg)) {                     \
             errhand_log_print((dbg) & ERRHAND_LVL_MASK, \
                     fmt, ## __VA_ARGS__);               \
                                                         \
@@ -70,9 +158,7 @@ void errhand_log_print_zmq_msg (struct _zmsg_t *msg);
 
 #define ERRHAND_DEBUG_ARRAY(dbg, fmt, data, len)        \
     do {                                                \
-        if (((dbg) & ERRHAND_SUBSYS_ON) &&              \
-            (((dbg) & ERRHAND_LVL_MASK) >=              \
-            ERRHAND_MIN_LEVEL)) {                       \
+        if (ERRHAND_ENABLED(dbg)) {                     \
             errhand_print_vec(fmt, data, len);          \
                                                         \
             if ((dbg) & ERRHAND_LVL_HALT)               \
@@ -92,6 +178,52 @@ void errhand_log_print_zmq_msg (struct _zmsg_t *msg);
 
 #endif /* ERRHAND_DBG */
 
+/* Record up to ERRHAND_TRACE_ARGS_MAX integer arguments to the trace file,
+ * if tracing is on and "dbg" subsystem is in ERRHAND_SUBSYS_ON. The level is
+ * only kept in the record. Pointers must be cast to uintptr_t */
+#if ERRHAND_TRACE_ON
+
+/* Whether trace records are taken at all. Lets callers skip the work of
+ * computing request ids */
+#define ERRHAND_TRACING()                               \
+    __builtin_expect (__atomic_load_n (&errhand_trace_on, __ATOMIC_RELAXED), 0)
+
+#define ERRHAND_TRACE(dbg, fmt, ...)                    \
+    do {                                                \
+        if (((dbg) & ERRHAND_SUBSYS_ON) &&              \
+            ERRHAND_TRACING()) {                        \
+            errhand_trace_record ((dbg), fmt,           \
+                _ERRHAND_TRACE_NARGS(__VA_ARGS__),      \
+                _ERRHAND_TRACE_ARGS(__VA_ARGS__));      \
+        }                                               \
+    } while(0)
+
+#define _ERRHAND_TRACE_NARGS(...)                       \
+    _ERRHAND_TRACE_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define _ERRHAND_TRACE_NARGS_(_z, _1, _2, _3, _4, n, ...) n
+#define _ERRHAND_TRACE_ARGS(...)                        \
+    _ERRHAND_TRACE_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0)
+#define _ERRHAND_TRACE_ARGS_(_z, a0, a1, a2, a3, ...)   \
+    (uint64_t) (a0), (uint64_t) (a1), (uint64_t) (a2), (uint64_t) (a3)
+
+/* Record that the calling thread enters (ERRHAND_TRACE_BEGIN) or leaves
+ * (ERRHAND_TRACE_END) "stage" of its current request */
+#define ERRHAND_TRACE_STAGE(dbg, stage, phase)          \
+    do {                                                \
+        if (((dbg) & ERRHAND_SUBSYS_ON) &&              \
+            ERRHAND_TRACING()) {                        \
+            errhand_trace_stage ((dbg), stage, phase);  \
+        }                                               \
+    } while(0)
+
+#else
+
+#define ERRHAND_TRACE(dbg, fmt, ...)
+#define ERRHAND_TRACE_STAGE(dbg, stage, phase)
+#define ERRHAND_TRACING()       0
+
+#endif /* ERRHAND_TRACE_ON */
+
 /* Convenient name */
 #define ERRHAND_PRINT           ERRHAND_DEBUG
 
@@ -99,6 +231,9 @@ void errhand_log_print_zmq_msg (struct _zmsg_t *msg);
 #define DBE_DEBUG               ERRHAND_DEBUG
 #define DBE_DEBUG_ARRAY         ERRHAND_DEBUG_ARRAY
 #define DBE_ERR                 ERRHAND_ERR
+#define DBE_TRACE               ERRHAND_TRACE
+#define DBE_TRACE_STAGE         ERRHAND_TRACE_STAGE
+#define DBE_TRACING             ERRHAND_TRACING
 
 #ifdef __cplusplus
 }
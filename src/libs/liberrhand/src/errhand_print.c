@@ -5,12 +5,108 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+#include <stddef.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+
 #include "errhand.h"
 
 #define ERRHAND_PRINT_PAD_FMT           "-5"
 
+/* Log lines are not written by the logging thread. Each thread formats its
+ * lines into its own ring of fixed size slots and a writer thread drains all
+ * rings and writes the lines out in batches. A ring has a single producer
+ * (its thread) and a single consumer (whoever holds _errhand_log_mutex), so
+ * logging itself takes no locks. Lines longer than a slot are truncated and
+ * lines that find the ring full are dropped and counted */
+#define ERRHAND_LOG_LINE_MAX            512
+/* Must be a power of 2 */
+#define ERRHAND_LOG_RING_SLOTS          128
+/* Lines are written out in chunks of up to this size */
+#define ERRHAND_LOG_BATCH_SIZE          (16*1024)
+/* Writer polling period, when there is nothing to write */
+#define ERRHAND_LOG_IDLE_US             1000
+#define ERRHAND_LOG_DATE_SIZE           20
+
+/* Fast trace records go through a second ring of each thread. Must be a
+ * power of 2 */
+#define ERRHAND_TRACE_RING_SLOTS        256
+/* Format string ids are indexes in a direct mapped cache of the format
+ * strings already written to the trace file. Must be a power of 2 */
+#define ERRHAND_TRACE_FMT_CACHE_SIZE    1024
+
+typedef struct {
+    uint32_t len;
+    char text [ERRHAND_LOG_LINE_MAX];
+} errhand_log_slot_t;
+
+/* Cached date string, reformatted only when the second changes */
+typedef struct {
+    time_t sec;
+    char str [ERRHAND_LOG_DATE_SIZE];
+} errhand_log_date_t;
+
+typedef struct {
+    const char *fmt;
+    uint64_t timestamp;
+    uint32_t type;
+    uint32_t dbg;
+    uint32_t num_args;
+    uint64_t args [ERRHAND_TRACE_ARGS_MAX];
+} errhand_trace_slot_t;
+
+typedef struct _errhand_log_ring_t {
+    uint32_t head;                      /* Only written by the producer */
+    uint32_t tail;                      /* Only written by the consumer */
+    uint64_t drops;                     /* Only written by the producer */
+    uint64_t drops_reported;            /* Only used by the consumer */
+    uint32_t trace_head;                /* Only written by the producer */
+    uint32_t trace_tail;                /* Only written by the consumer */
+    uint64_t trace_drops;               /* Only written by the producer */
+    uint32_t tid;                       /* Producer thread id */
+    bool dead;                          /* Producer thread has exited */
+    errhand_log_date_t date;            /* Only used by the producer */
+    struct _errhand_log_ring_t *next;
+    errhand_log_slot_t slot [ERRHAND_LOG_RING_SLOTS];
+    errhand_trace_slot_t trace [ERRHAND_TRACE_RING_SLOTS];
+} errhand_log_ring_t;
+
 /* Our logfile */
 static FILE *_errhand_logfile = NULL;
+/* Our trace file. NULL if tracing is off */
+static FILE *_errhand_tracefile = NULL;
+
+int errhand_trace_on = 0;
+
+/* Protects the ring list, the writer state and the consumer side of the
+ * rings */
+static pthread_mutex_t _errhand_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t _errhand_log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _errhand_log_key;
+static errhand_log_ring_t *_errhand_log_rings = NULL;
+/* Drops of the rings already freed */
+static uint64_t _errhand_log_drops_freed = 0;
+static uint64_t _errhand_trace_drops_freed = 0;
+static bool _errhand_log_writer_running = false;
+static char _errhand_log_batch [ERRHAND_LOG_BATCH_SIZE];
+static errhand_log_date_t _errhand_log_writer_date;
+static char _errhand_trace_batch [ERRHAND_LOG_BATCH_SIZE];
+static const char *_errhand_trace_fmt_cache [ERRHAND_TRACE_FMT_CACHE_SIZE];
+
+static __thread errhand_log_ring_t *_errhand_log_ring = NULL;
+/* Request being served by this thread */
+static __thread uint64_t _errhand_trace_req = 0;
+
+static const char *_errhand_log_date (errhand_log_date_t *date);
+static void _errhand_log_format (errhand_log_slot_t *slot,
+        errhand_log_date_t *date, int errhand_lvl, const char *fmt,
+        va_list args);
+static errhand_log_ring_t *_errhand_log_ring_get (void);
+static void _errhand_trace_push (uint32_t type, int dbg, const char *fmt,
+        uint32_t num_args, uint64_t arg0, uint64_t arg1, uint64_t arg2,
+        uint64_t arg3);
+static size_t _errhand_log_drain (void);
 
 void errhand_print (const char *fmt, ...)
 {
@@ -21,52 +117,171 @@ void errhand_print (const char *fmt, ...)
     va_end (args);
 }
 
-/* Based on CZMQ s_log () function. Available in
+/* Based on CZMQ zsys_error () function. Available in
  * https://github.com/zeromq/czmq/blob/master/src/zsys.c */
-static void _errhand_log_write (char *errhand_lvl_str, char *msg)
+void errhand_log_print (int errhand_lvl, const char *fmt, ...)
 {
-    /* Default to stdout */
-    if (!_errhand_logfile) {
-        _errhand_logfile = stdout;
+    va_list argptr;
+    errhand_log_ring_t *ring = _errhand_log_ring_get ();
+
+    if (ring == NULL) {
+        /* No ring for this thread. Write the line ourselves */
+        errhand_log_slot_t slot;
+        errhand_log_date_t date = {0};
+
+        va_start (argptr, fmt);
+        _errhand_log_format (&slot, &date, errhand_lvl, fmt, argptr);
+        va_end (argptr);
+
+        pthread_mutex_lock (&_errhand_log_mutex);
+        _errhand_log_drain ();
+        fwrite (slot.text, 1, slot.len, _errhand_logfile);
+        fflush (_errhand_logfile);
+        pthread_mutex_unlock (&_errhand_log_mutex);
+        return;
     }
 
-    time_t curtime = time (NULL);
-    struct tm *loctime = localtime (&curtime);
-    char date [20];
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) >=
+            ERRHAND_LOG_RING_SLOTS) {
+        __atomic_store_n (&ring->drops, ring->drops + 1, __ATOMIC_RELAXED);
+        return;
+    }
 
-    strftime (date, 20, "%y-%m-%d %H:%M:%S", loctime);
+    va_start (argptr, fmt);
+    _errhand_log_format (&ring->slot [head & (ERRHAND_LOG_RING_SLOTS-1)],
+            &ring->date, errhand_lvl, fmt, argptr);
+    va_end (argptr);
+    __atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
 
-    char log_text [1024];
-    snprintf (log_text, 1024, "%" ERRHAND_PRINT_PAD_FMT "s: [%s] %s",
-            errhand_lvl_str, date, msg);
-    fprintf (_errhand_logfile, "%s", log_text);
-    fflush (_errhand_logfile);
+    /* Write at once if there is nobody to do it for us, or if the process
+     * is likely about to die */
+    if (!__atomic_load_n (&_errhand_log_writer_running, __ATOMIC_ACQUIRE) ||
+            ERRHAND_LVL_DEGEN(errhand_lvl) >= ERRHAND_LVL_FATAL_RAW) {
+        errhand_log_flush ();
+    }
 }
 
-/* Based on CZMQ zsys_error () function. Available in
- * https://github.com/zeromq/czmq/blob/master/src/zsys.c */
-void errhand_log_print (int errhand_lvl, const char *fmt, ...)
+void errhand_log_flush (void)
 {
-    va_list argptr;
-    va_start (argptr, fmt);
-    char *msg = errhand_lprint_vprintf (fmt, argptr);
-    va_end (argptr);
+    pthread_mutex_lock (&_errhand_log_mutex);
+    _errhand_log_drain ();
+    pthread_mutex_unlock (&_errhand_log_mutex);
+}
 
-    /* Convert errhand level code to string */
-    char *errhand_lvl_str = errhand_lvl_to_str (errhand_lvl);
-    _errhand_log_write (errhand_lvl_str, msg);
-    free (msg);
-    free (errhand_lvl_str);
+void errhand_trace_record (int dbg, const char *fmt, uint32_t num_args,
+        uint64_t arg0, uint64_t arg1, uint64_t arg2, uint64_t arg3)
+{
+    _errhand_trace_push (ERRHAND_TRACE_REC_EVENT, dbg, fmt, num_args, arg0,
+            arg1, arg2, arg3);
 }
 
-void errhand_log_print_zmq_msg (zmsg_t *msg)
+void errhand_trace_stage (int dbg, const char *stage, uint32_t phase)
 {
-    /* Default to stdout */
-    if (!_errhand_logfile) {
-        _errhand_logfile = stdout;
+    _errhand_trace_push (ERRHAND_TRACE_REC_STAGE, dbg, stage, 2,
+            _errhand_trace_req, phase, 0, 0);
+}
+
+void errhand_trace_set_req (uint64_t req_id)
+{
+    _errhand_trace_req = req_id;
+}
+
+uint64_t errhand_trace_get_req (void)
+{
+    return _errhand_trace_req;
+}
+
+/* FNV-1a, over both strings and the NUL in between */
+uint64_t errhand_trace_req_id (const char *sender, const char *tracker)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const char *strs [] = {sender, tracker};
+
+    for (size_t i = 0; i < sizeof (strs)/sizeof (strs [0]); ++i) {
+        for (const char *c = strs [i]; c != NULL && *c != '\0'; ++c) {
+            hash = (hash ^ (uint8_t) *c) * 0x100000001b3ULL;
+        }
+        hash = hash * 0x100000001b3ULL;
     }
 
+    /* 0 means no request */
+    return (hash != 0) ? hash : 1;
+}
+
+int errhand_set_trace (const char *trace_file_name)
+{
+    FILE *trace_file = NULL;
+
+    if (trace_file_name != NULL) {
+        trace_file = fopen (trace_file_name, "wb");
+        if (trace_file == NULL) {
+            return -1;
+        }
+
+        errhand_trace_file_hdr_t hdr = {
+            .magic = ERRHAND_TRACE_MAGIC,
+            .version = ERRHAND_TRACE_VERSION,
+            .hdr_size = sizeof (hdr)
+        };
+        if (fwrite (&hdr, sizeof (hdr), 1, trace_file) != 1) {
+            fclose (trace_file);
+            return -1;
+        }
+    }
+
+    /* Records taken so far go to the previous trace file */
+    pthread_mutex_lock (&_errhand_log_mutex);
+    _errhand_log_drain ();
+    if (_errhand_tracefile != NULL) {
+        fclose (_errhand_tracefile);
+    }
+    _errhand_tracefile = trace_file;
+    memset (_errhand_trace_fmt_cache, 0, sizeof (_errhand_trace_fmt_cache));
+    __atomic_store_n (&errhand_trace_on, trace_file != NULL, __ATOMIC_RELEASE);
+    pthread_mutex_unlock (&_errhand_log_mutex);
+
+    return 0;
+}
+
+uint64_t errhand_trace_get_drops (void)
+{
+    pthread_mutex_lock (&_errhand_log_mutex);
+    uint64_t drops = _errhand_trace_drops_freed;
+    for (errhand_log_ring_t *ring = _errhand_log_rings; ring != NULL;
+            ring = ring->next) {
+        drops += __atomic_load_n (&ring->trace_drops, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock (&_errhand_log_mutex);
+
+    return drops;
+}
+
+uint64_t errhand_log_get_drops (void)
+{
+    pthread_mutex_lock (&_errhand_log_mutex);
+    uint64_t drops = _errhand_log_drops_freed;
+    for (errhand_log_ring_t *ring = _errhand_log_rings; ring != NULL;
+            ring = ring->next) {
+        drops += __atomic_load_n (&ring->drops, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock (&_errhand_log_mutex);
+
+    return drops;
+}
+
+void errhand_log_prealloc (void)
+{
+    _errhand_log_ring_get ();
+}
+
+void errhand_log_print_zmq_msg (zmsg_t *msg)
+{
+    /* Keep the message in order with the lines already logged */
+    pthread_mutex_lock (&_errhand_log_mutex);
+    _errhand_log_drain ();
     errhand_lprint_zmq_msg (msg, _errhand_logfile);
+    pthread_mutex_unlock (&_errhand_log_mutex);
 }
 
 void errhand_print_vec (const char *fmt, const char *data, int len)
@@ -80,7 +295,11 @@ void errhand_print_vec (const char *fmt, const char *data, int len)
 
 static void _errhand_set_log_file (FILE *log_file)
 {
+    /* Lines logged so far go to the previous logfile */
+    pthread_mutex_lock (&_errhand_log_mutex);
+    _errhand_log_drain ();
     _errhand_logfile = log_file;
+    pthread_mutex_unlock (&_errhand_log_mutex);
 }
 
 void errhand_set_log_file (FILE *log_file)
@@ -125,6 +344,364 @@ int errhand_set_log (const char *log_file_name, const char *mode)
     }
 
     _errhand_set_log_file (log_file);
+
+    /* Fast tracing can be turned on without changing the applications */
+    const char *trace_prefix = getenv (ERRHAND_TRACE_FILE_ENV);
+    if (trace_prefix != NULL && _errhand_tracefile == NULL) {
+        char trace_file_name [PATH_MAX];
+        snprintf (trace_file_name, sizeof (trace_file_name), "%s.%d",
+                trace_prefix, (int) getpid ());
+        errhand_set_trace (trace_file_name);
+    }
+
     return err;
 }
 
+
+/***************************** Static Functions ******************************/
+
+static const char *_errhand_log_date (errhand_log_date_t *date)
+{
+    time_t curtime = time (NULL);
+
+    if (curtime != date->sec || date->str [0] == '\0') {
+        struct tm loctime;
+        localtime_r (&curtime, &loctime);
+        strftime (date->str, sizeof (date->str), "%y-%m-%d %H:%M:%S", &loctime);
+        date->sec = curtime;
+    }
+
+    return date->str;
+}
+
+static void _errhand_log_format (errhand_log_slot_t *slot,
+        errhand_log_date_t *date, int errhand_lvl, const char *fmt,
+        va_list args)
+{
+    uint32_t lvl = ERRHAND_LVL_DEGEN(errhand_lvl);
+    const char *lvl_str = (lvl >= 1 && lvl <= ERRHAND_LVL_NUM) ?
+        errhand_lvl_str [lvl-1] : "";
+
+    int len = snprintf (slot->text, sizeof (slot->text),
+            "%" ERRHAND_PRINT_PAD_FMT "s: [%s] ", lvl_str,
+            _errhand_log_date (date));
+    int msg_len = vsnprintf (slot->text + len, sizeof (slot->text) - len,
+            fmt, args);
+
+    if (msg_len < 0) {
+        msg_len = 0;
+    }
+    if ((size_t) (len + msg_len) >= sizeof (slot->text)) {
+        /* Truncated. Do not merge it with the next line */
+        len = sizeof (slot->text) - 1;
+        slot->text [len-1] = '\n';
+    }
+    else {
+        len += msg_len;
+    }
+
+    slot->len = len;
+}
+
+/* Must be called with _errhand_log_mutex held */
+static void _errhand_log_batch_flush (size_t *batch_len)
+{
+    if (*batch_len > 0) {
+        fwrite (_errhand_log_batch, 1, *batch_len, _errhand_logfile);
+        *batch_len = 0;
+    }
+}
+
+/* Must be called with _errhand_log_mutex held */
+static void _errhand_trace_put (size_t *batch_len, const void *data, size_t size)
+{
+    if (*batch_len + size > sizeof (_errhand_trace_batch)) {
+        fwrite (_errhand_trace_batch, 1, *batch_len, _errhand_tracefile);
+        *batch_len = 0;
+    }
+    memcpy (_errhand_trace_batch + *batch_len, data, size);
+    *batch_len += size;
+}
+
+/* Write out the trace records of "ring", or throw them away if tracing is
+ * off. Must be called with _errhand_log_mutex held. Returns the number of
+ * records written */
+static size_t _errhand_trace_drain (errhand_log_ring_t *ring)
+{
+    size_t records = 0;
+    size_t batch_len = 0;
+    uint32_t head = __atomic_load_n (&ring->trace_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->trace_tail;
+
+    for (; _errhand_tracefile != NULL && tail != head; ++tail) {
+        errhand_trace_slot_t *slot =
+            &ring->trace [tail & (ERRHAND_TRACE_RING_SLOTS-1)];
+        uint32_t id = ((uintptr_t) slot->fmt * 2654435761U) &
+            (ERRHAND_TRACE_FMT_CACHE_SIZE-1);
+
+        if (_errhand_trace_fmt_cache [id] != slot->fmt) {
+            /* Format strings are written once, at their first use. The
+             * terminating NUL is included and the length rounded up, so
+             * records stay 8-byte aligned */
+            size_t len = strlen (slot->fmt) + 1;
+            errhand_trace_fmt_rec_t rec = {
+                .type = ERRHAND_TRACE_REC_FMT,
+                .id = id,
+                .len = (len + 7) & ~7
+            };
+            char pad [8] = {0};
+
+            if (sizeof (rec) + rec.len > sizeof (_errhand_trace_batch)) {
+                /* Too long to be of any use. Drop the record */
+                continue;
+            }
+            _errhand_trace_put (&batch_len, &rec, sizeof (rec));
+            _errhand_trace_put (&batch_len, slot->fmt, len);
+            _errhand_trace_put (&batch_len, pad, rec.len - len);
+            _errhand_trace_fmt_cache [id] = slot->fmt;
+        }
+
+        errhand_trace_event_rec_t rec = {
+            .type = slot->type,
+            .id = id,
+            .timestamp = slot->timestamp,
+            .tid = ring->tid,
+            .dbg = slot->dbg,
+            .num_args = slot->num_args
+        };
+        memcpy (rec.args, slot->args, sizeof (rec.args));
+        _errhand_trace_put (&batch_len, &rec, sizeof (rec));
+        ++records;
+    }
+    __atomic_store_n (&ring->trace_tail, head, __ATOMIC_RELEASE);
+
+    if (batch_len > 0) {
+        fwrite (_errhand_trace_batch, 1, batch_len, _errhand_tracefile);
+    }
+
+    return records;
+}
+
+/* Write out everything in the rings and free the rings of exited threads.
+ * Must be called with _errhand_log_mutex held. Returns the number of lines
+ * and trace records written */
+static size_t _errhand_log_drain (void)
+{
+    size_t lines = 0;
+    size_t records = 0;
+    size_t batch_len = 0;
+
+    /* Default to stdout */
+    if (!_errhand_logfile) {
+        _errhand_logfile = stdout;
+    }
+
+    errhand_log_ring_t **ring_p = &_errhand_log_rings;
+    while (*ring_p != NULL) {
+        errhand_log_ring_t *ring = *ring_p;
+        /* Read before head, so no line pushed before the thread exited is
+         * missed */
+        bool dead = __atomic_load_n (&ring->dead, __ATOMIC_ACQUIRE);
+        uint32_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+        uint32_t tail = ring->tail;
+
+        for (; tail != head; ++tail) {
+            errhand_log_slot_t *slot =
+                &ring->slot [tail & (ERRHAND_LOG_RING_SLOTS-1)];
+
+            if (batch_len + slot->len > sizeof (_errhand_log_batch)) {
+                _errhand_log_batch_flush (&batch_len);
+            }
+            memcpy (_errhand_log_batch + batch_len, slot->text, slot->len);
+            batch_len += slot->len;
+            ++lines;
+        }
+        __atomic_store_n (&ring->tail, tail, __ATOMIC_RELEASE);
+
+        uint64_t drops = __atomic_load_n (&ring->drops, __ATOMIC_RELAXED);
+        if (drops != ring->drops_reported) {
+            if (batch_len + ERRHAND_LOG_LINE_MAX > sizeof (_errhand_log_batch)) {
+                _errhand_log_batch_flush (&batch_len);
+            }
+            batch_len += snprintf (_errhand_log_batch + batch_len,
+                    ERRHAND_LOG_LINE_MAX, "%" ERRHAND_PRINT_PAD_FMT "s: [%s] "
+                    "[errhand] %" PRIu64 " log messages dropped\n",
+                    ERRHAND_LVL_WARN_STR,
+                    _errhand_log_date (&_errhand_log_writer_date),
+                    drops - ring->drops_reported);
+            ring->drops_reported = drops;
+            ++lines;
+        }
+
+        records += _errhand_trace_drain (ring);
+
+        if (dead) {
+            _errhand_log_drops_freed += drops;
+            _errhand_trace_drops_freed +=
+                __atomic_load_n (&ring->trace_drops, __ATOMIC_RELAXED);
+            *ring_p = ring->next;
+            free (ring);
+        }
+        else {
+            ring_p = &ring->next;
+        }
+    }
+
+    if (lines > 0) {
+        _errhand_log_batch_flush (&batch_len);
+        fflush (_errhand_logfile);
+    }
+    if (records > 0) {
+        fflush (_errhand_tracefile);
+    }
+
+    return lines + records;
+}
+
+static void *_errhand_log_writer (void *arg)
+{
+    (void) arg;
+
+    while (1) {
+        pthread_mutex_lock (&_errhand_log_mutex);
+        size_t lines = _errhand_log_drain ();
+        pthread_mutex_unlock (&_errhand_log_mutex);
+
+        if (lines == 0) {
+            usleep (ERRHAND_LOG_IDLE_US);
+        }
+    }
+
+    return NULL;
+}
+
+/* Must be called with _errhand_log_mutex held */
+static void _errhand_log_writer_start (void)
+{
+    if (_errhand_log_writer_running) {
+        return;
+    }
+
+    pthread_attr_t attr;
+    pthread_t writer;
+    sigset_t all_signals;
+    sigset_t old_signals;
+
+    /* Leave signal handling to the application threads */
+    sigfillset (&all_signals);
+    pthread_sigmask (SIG_SETMASK, &all_signals, &old_signals);
+
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create (&writer, &attr, _errhand_log_writer, NULL) == 0) {
+        __atomic_store_n (&_errhand_log_writer_running, true, __ATOMIC_RELEASE);
+    }
+    /* Otherwise, every thread writes its lines itself */
+    pthread_attr_destroy (&attr);
+
+    pthread_sigmask (SIG_SETMASK, &old_signals, NULL);
+}
+
+static void _errhand_log_ring_release (void *arg)
+{
+    errhand_log_ring_t *ring = (errhand_log_ring_t *) arg;
+    /* The consumer frees it after writing out what is left */
+    __atomic_store_n (&ring->dead, true, __ATOMIC_RELEASE);
+}
+
+static void _errhand_log_atfork_prepare (void)
+{
+    pthread_mutex_lock (&_errhand_log_mutex);
+}
+
+static void _errhand_log_atfork_parent (void)
+{
+    pthread_mutex_unlock (&_errhand_log_mutex);
+}
+
+static void _errhand_log_atfork_child (void)
+{
+    /* Only the forking thread exists in the child and the parent is still
+     * writing out what is pending in the rings. Start over with a new
+     * writer on the next line logged */
+    for (errhand_log_ring_t *ring = _errhand_log_rings; ring != NULL;
+            ring = ring->next) {
+        ring->tail = ring->head;
+        ring->drops_reported = ring->drops;
+        ring->trace_tail = ring->trace_head;
+        ring->dead = (ring != _errhand_log_ring);
+    }
+    _errhand_log_writer_running = false;
+    /* The trace file belongs to the parent */
+    _errhand_tracefile = NULL;
+    errhand_trace_on = 0;
+    pthread_mutex_unlock (&_errhand_log_mutex);
+}
+
+static void _errhand_log_init (void)
+{
+    pthread_key_create (&_errhand_log_key, _errhand_log_ring_release);
+    pthread_atfork (_errhand_log_atfork_prepare, _errhand_log_atfork_parent,
+            _errhand_log_atfork_child);
+    /* Do not lose the last lines on exit */
+    atexit (errhand_log_flush);
+}
+
+static void _errhand_trace_push (uint32_t type, int dbg, const char *fmt,
+        uint32_t num_args, uint64_t arg0, uint64_t arg1, uint64_t arg2,
+        uint64_t arg3)
+{
+    errhand_log_ring_t *ring = _errhand_log_ring_get ();
+    if (ring == NULL) {
+        return;
+    }
+
+    uint32_t head = ring->trace_head;
+    if (head - __atomic_load_n (&ring->trace_tail, __ATOMIC_ACQUIRE) >=
+            ERRHAND_TRACE_RING_SLOTS) {
+        __atomic_store_n (&ring->trace_drops, ring->trace_drops + 1,
+                __ATOMIC_RELAXED);
+        return;
+    }
+
+    errhand_trace_slot_t *slot = &ring->trace [head & (ERRHAND_TRACE_RING_SLOTS-1)];
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+
+    slot->fmt = fmt;
+    slot->timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+    slot->type = type;
+    slot->dbg = dbg;
+    slot->num_args = num_args;
+    slot->args [0] = arg0;
+    slot->args [1] = arg1;
+    slot->args [2] = arg2;
+    slot->args [3] = arg3;
+    __atomic_store_n (&ring->trace_head, head + 1, __ATOMIC_RELEASE);
+}
+
+static errhand_log_ring_t *_errhand_log_ring_get (void)
+{
+    if (_errhand_log_ring != NULL) {
+        return _errhand_log_ring;
+    }
+
+    pthread_once (&_errhand_log_once, _errhand_log_init);
+
+    errhand_log_ring_t *ring = (errhand_log_ring_t *) malloc (sizeof *ring);
+    if (ring == NULL) {
+        return NULL;
+    }
+    memset (ring, 0, offsetof (errhand_log_ring_t, slot));
+    ring->tid = (uint32_t) syscall (SYS_gettid);
+    pthread_setspecific (_errhand_log_key, ring);
+    _errhand_log_ring = ring;
+
+    pthread_mutex_lock (&_errhand_log_mutex);
+    ring->next = _errhand_log_rings;
+    _errhand_log_rings = ring;
+    _errhand_log_writer_start ();
+    pthread_mutex_unlock (&_errhand_log_mutex);
+
+    return ring;
+}
@@ -48,5 +48,8 @@
 #include "hutils_core.h"
 #include "hutils_math.h"
 #include "hutils_utils.h"
+#include "hutils_codec.h"
+#include "hutils_mem.h"
+#include "hutils_crc.h"
 
 #endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _HUTILS_CODEC_H_
+#define _HUTILS_CODEC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lossless delta codec for sampled data. Samples are made of "num_atoms"
+ * interleaved signed atoms of "atom_size" bytes (2 or 4), in host byte
+ * order. Each atom is replaced by its difference to the same atom of the
+ * previous sample, and the differences of each atom are bit-packed in frames
+ * of HUTILS_CODEC_FRAME_SAMPLES samples, with the smallest width that fits
+ * all of them. Slowly varying signals take a few bits per atom this way */
+
+#define HUTILS_CODEC_FRAME_SAMPLES          128
+
+/* Maximum encoded size of "size" bytes of samples */
+size_t hutils_codec_delta_bound (size_t size, uint32_t atom_size,
+        uint32_t num_atoms);
+
+/* Encode the "size" bytes of samples at "src" to "dst", which can hold
+ * "dst_size" bytes. Trailing bytes not making a whole sample are ignored.
+ * Returns the encoded size or -1 if it does not fit in "dst" */
+ssize_t hutils_codec_delta_encode (uint8_t *dst, size_t dst_size,
+        const uint8_t *src, size_t size, uint32_t atom_size, uint32_t num_atoms);
+
+/* Decode "size" bytes of samples from the "src_size" bytes at "src". Returns
+ * the number of bytes decoded or -1 if "src" is not a valid encoding */
+ssize_t hutils_codec_delta_decode (uint8_t *dst, size_t size,
+        const uint8_t *src, size_t src_size, uint32_t atom_size,
+        uint32_t num_atoms);
+
+/* Lossy codec for sampled data of "num_atoms" interleaved signed 32-bit
+ * atoms, e.g., positions in nm, in host byte order. Each atom of the block
+ * is sent as an offset, the midpoint of its span, and a power of 2 scale,
+ * the smallest one that fits the span in 16 bits, both 32-bit, followed by
+ * the 16-bit differences of every sample to the offset, divided by the
+ * scale and rounded, interleaved as the samples were. Decoded atoms are off
+ * by up to half of their scale, i.e., by less than about span / 65536, and
+ * are exact when the span of the atom in the block is less than 65535.
+ * Blocks shrink to about half of their size */
+
+#define HUTILS_CODEC_SCALED16_HDR_SIZE(num_atoms) \
+    (2 * sizeof (uint32_t) * (num_atoms))
+
+/* Encoded size of "size" bytes of samples */
+size_t hutils_codec_scaled16_bound (size_t size, uint32_t num_atoms);
+
+/* Encode the "size" bytes of samples at "src" to "dst", which can hold
+ * "dst_size" bytes. Trailing bytes not making a whole sample are ignored.
+ * Returns the encoded size or -1 if it does not fit in "dst" */
+ssize_t hutils_codec_scaled16_encode (uint8_t *dst, size_t dst_size,
+        const uint8_t *src, size_t size, uint32_t num_atoms);
+
+/* Decode "size" bytes of samples from the "src_size" bytes at "src". Returns
+ * the number of bytes decoded or -1 if "src" is not a valid encoding */
+ssize_t hutils_codec_scaled16_decode (uint8_t *dst, size_t size,
+        const uint8_t *src, size_t src_size, uint32_t num_atoms);
+
+/* Delta codec for records of up to HUTILS_CODEC_FIELDS_MAX 32-bit fields,
+ * sent one after the other. Only the fields that changed from the previous
+ * record are encoded, as a varint bitmask of them followed by their
+ * zigzag encoded differences, as varints too. A record encoded against a
+ * zeroed one stands on its own */
+
+#define HUTILS_CODEC_FIELDS_MAX             32
+
+/* Maximum encoded size of a record of "num_fields" fields */
+#define HUTILS_CODEC_FIELDS_BOUND(num_fields) \
+    (5 + 5 * (num_fields))
+
+/* Encode the "num_fields" fields of "cur" against the ones of "prev" to
+ * "dst", which can hold "dst_size" bytes. Returns the encoded size or -1
+ * if it does not fit in "dst" */
+ssize_t hutils_codec_fields_encode (uint8_t *dst, size_t dst_size,
+        const uint32_t *cur, const uint32_t *prev, uint32_t num_fields);
+
+/* Decode a record from the "src_size" bytes at "src", applying it to the
+ * "num_fields" fields of "fields", which hold the previous record. Returns
+ * the number of bytes consumed or -1 if "src" is not a valid encoding, in
+ * which case "fields" is left untouched */
+ssize_t hutils_codec_fields_decode (uint32_t *fields, uint32_t num_fields,
+        const uint8_t *src, size_t src_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _HUTILS_CRC_H_
+#define _HUTILS_CRC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CRC32C (Castagnoli polynomial, reflected), the same as iSCSI and ext4
+ * use. The SSE4.2 CRC32 instruction is used when the CPU has it, as is the
+ * ARMv8 one when built for it, so blocks can be checked at memory speed */
+
+/* Update "crc" with the "size" bytes at "data". Start with 0. The CRC of
+ * a buffer is the same whether it is computed at once or in pieces */
+uint32_t hutils_crc32c (uint32_t crc, const void *data, size_t size);
+
+/* Whether hutils_crc32c () uses CRC instructions of the CPU */
+bool hutils_crc32c_hw (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -20,6 +20,9 @@ enum _hutils_err_e
     HUTILS_SUCCESS = 0,               /* No error */
     HUTILS_ERR_ALLOC,                 /* Could not allocate memory */
     HUTILS_ERR_CFG,                   /* Could not get property from config file */
+    HUTILS_ERR_SCHED,                 /* Could not set thread affinity or scheduling policy */
+    HUTILS_ERR_NUMA,                  /* Could not set NUMA memory policy */
+    HUTILS_ERR_MLOCK,                 /* Could not lock memory */
     HUTILS_ERR_END
 };
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _HUTILS_MEM_H_
+#define _HUTILS_MEM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Memory placement for large buffers. NUMA nodes are numbered as by the
+ * kernel, -1 meaning no particular node */
+
+#define HUTILS_MEM_NODE_ANY                 (-1)
+/* Highest NUMA node number supported, plus one */
+#define HUTILS_MEM_MAX_NODES                64
+/* Huge page size assumed for the mappings */
+#define HUTILS_MEM_HUGE_PAGE_SIZE           (2UL << 20)
+
+/* NUMA node of the device behind the character device file "dev_path"
+ * (e.g., /dev/fpga-0). HUTILS_MEM_NODE_ANY if it can't be told */
+int hutils_mem_dev_numa_node (const char *dev_path);
+
+/* Make the memory allocated from now on by the calling thread prefer
+ * "numa_node". Threads created afterwards inherit it */
+hutils_err_e hutils_mem_set_thread_node (int numa_node);
+
+/* Make the pages of the mapping at "addr" not faulted in yet prefer
+ * "numa_node" */
+hutils_err_e hutils_mem_bind (void *addr, size_t size, int numa_node);
+
+/* Map at least "size" bytes of anonymous memory, backed by huge pages if
+ * possible, preferably on "numa_node", and fault them all in. The size of
+ * the mapping is returned in "map_size", to be given back to
+ * hutils_mem_unmap (). NULL on error */
+void *hutils_mem_map (size_t size, int numa_node, size_t *map_size);
+void hutils_mem_unmap (void *addr, size_t map_size);
+
+/* Real-time mode. The memory of the process is locked and faulted in, so
+ * it is never paged out, and the buffers that would be allocated on the
+ * first requests are allocated upfront instead */
+
+/* Stack faulted in by each thread, in bytes */
+#define HUTILS_MEM_RT_STACK_PREFAULT        (256 * 1024)
+
+/* Enter real-time mode, locking the current and future memory of the
+ * process. Call it before creating any thread, so their stacks are locked
+ * and faulted in as they are mapped. This takes CAP_IPC_LOCK or a large
+ * enough RLIMIT_MEMLOCK. The mode is entered anyway, but HUTILS_ERR_MLOCK is
+ * returned, if the memory could not be locked */
+hutils_err_e hutils_mem_rt_enable (void);
+/* Check if real-time mode was entered */
+bool hutils_mem_rt_enabled (void);
+/* Prepare the calling thread for real-time mode, if entered: fault in its
+ * stack and create its log ring */
+void hutils_mem_rt_thread_init (void);
+
+/* Allocations made by the calling thread between hutils_mem_rt_guard_begin
+ * () and hutils_mem_rt_guard_end (), which returns their number. They are
+ * only counted by programs built with an allocator wrapper that increments
+ * hutils_mem_rt_allocs while hutils_mem_rt_guard is set, see ebpm_rt.c.
+ * Otherwise hutils_mem_rt_guard_end () always returns 0 */
+extern __thread uint32_t hutils_mem_rt_guard;
+extern __thread uint32_t hutils_mem_rt_allocs;
+void hutils_mem_rt_guard_begin (void);
+uint32_t hutils_mem_rt_guard_end (void);
+
+/* Allocation accounting. Allocations are counted, along with the bytes
+ * asked for, by the subsystem (HUTILS_MEM_ACCT_*) and by the opcode being
+ * served when made, into the counters the calling thread attached with
+ * hutils_mem_acct_attach (). Like the real-time guard, they are only
+ * counted by programs built with the allocator wrapper of ebpm_rt.c
+ * (ALLOC_ACCT=y), which sets hutils_mem_acct_wrapped */
+#define HUTILS_MEM_ACCT_OTHER               0   /* Anything not tagged */
+#define HUTILS_MEM_ACCT_MSG                 1   /* Messages and frames, sent
+                                                   and received */
+#define HUTILS_MEM_ACCT_STR                 2   /* hutils strings */
+#define HUTILS_MEM_ACCT_DISP                3   /* Dispatch table */
+#define HUTILS_MEM_ACCT_HANDLER             4   /* Operation handlers and
+                                                   periodic tasks */
+#define HUTILS_MEM_ACCT_END                 5
+
+/* Opcodes told apart, at least MSG_OPCODE_MAX */
+#define HUTILS_MEM_ACCT_MAX_OPCODES         200
+#define HUTILS_MEM_ACCT_NO_OPCODE           UINT32_MAX
+
+typedef struct {
+    uint64_t allocs [HUTILS_MEM_ACCT_END];              /* By subsystem */
+    uint64_t bytes [HUTILS_MEM_ACCT_END];
+    uint64_t op_allocs [HUTILS_MEM_ACCT_MAX_OPCODES];   /* By opcode */
+    uint64_t op_bytes [HUTILS_MEM_ACCT_MAX_OPCODES];
+} hutils_mem_acct_t;
+
+extern bool hutils_mem_acct_wrapped;
+extern __thread hutils_mem_acct_t *hutils_mem_acct;
+extern __thread uint32_t hutils_mem_acct_subsys;
+extern __thread uint32_t hutils_mem_acct_opcode;
+
+/* Count the allocations of the calling thread into "acct", NULL to stop.
+ * Returns the counters attached before, to be attached back once done */
+hutils_mem_acct_t *hutils_mem_acct_attach (hutils_mem_acct_t *acct);
+/* Tag the allocations of the calling thread with "subsys" from now on.
+ * Returns the previous tag, to be given back to hutils_mem_acct_pop () */
+uint32_t hutils_mem_acct_push (uint32_t subsys);
+void hutils_mem_acct_pop (uint32_t prev_subsys);
+/* Tag the allocations of the calling thread with "opcode" from now on,
+ * HUTILS_MEM_ACCT_NO_OPCODE for none */
+void hutils_mem_acct_set_opcode (uint32_t opcode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,6 +19,10 @@ extern "C" {
 
 /* We don't expect our hash key to be bigger than this */
 #define HUTILS_CFG_HASH_KEY_MAX_LEN         64
+
+/* Enough for any uint32_t key, in decimal or hexadecimal, with the
+ * terminating null character */
+#define HUTILS_KEY_STR_MAX_LEN              11
 /* Our config hash key is composed of this pattern: board%u/bpm%u/afe
  * or board%u/bpm%u/dbe */
 #define HUTILS_CFG_BOARD_TYPE               "%s"
@@ -32,11 +36,50 @@ extern "C" {
 #define HUTILS_CFG_HASH_KEY_PATTERN_COMPL   HUTILS_CFG_BOARD_PATTERN \
                                             "/" HUTILS_CFG_BPM_PATTERN
 
+/* Thread placement. A zero cpu_mask keeps the inherited affinity and a
+ * zero fifo_prio keeps the inherited scheduling policy */
+typedef struct {
+    uint64_t cpu_mask;          /* CPUs the thread may run on, one bit per CPU */
+    int fifo_prio;              /* SCHED_FIFO priority */
+} hutils_sched_t;
+
+/* ZeroMQ tuning of the process. A zero keeps the ZeroMQ default. The
+ * HWMs are in messages and the kernel buffers, only used by TCP, in bytes */
+typedef struct {
+    int io_threads;             /* ZeroMQ I/O threads */
+    int sndhwm;                 /* Send high-water mark of new sockets */
+    int rcvhwm;                 /* Receive high-water mark of new sockets */
+    int pipehwm;                /* High-water mark of the inproc PIPEs */
+    int sndbuf;                 /* SO_SNDBUF of the bulk data sockets */
+    int rcvbuf;                 /* SO_RCVBUF of the bulk data sockets */
+} hutils_zmq_opts_t;
+
+/* Defaults tuned for bulk transfers. A multi-MB curve is queued as a few
+ * large messages, so the HWMs only have to absorb bursts of them, while
+ * the kernel buffers are sized to keep a 10 Gbps link busy over a LAN round
+ * trip. The kernel caps these to net.core.wmem_max and net.core.rmem_max */
+#define HUTILS_ZMQ_DFLT_IO_THREADS          2
+#define HUTILS_ZMQ_DFLT_SNDHWM              10000
+#define HUTILS_ZMQ_DFLT_RCVHWM              10000
+#define HUTILS_ZMQ_DFLT_PIPEHWM             10000
+#define HUTILS_ZMQ_DFLT_SNDBUF              (4 * 1024 * 1024)
+#define HUTILS_ZMQ_DFLT_RCVBUF              (4 * 1024 * 1024)
+
+#define HUTILS_ZMQ_OPTS_DFLT {                                          \
+        .io_threads = HUTILS_ZMQ_DFLT_IO_THREADS,                       \
+        .sndhwm = HUTILS_ZMQ_DFLT_SNDHWM,                               \
+        .rcvhwm = HUTILS_ZMQ_DFLT_RCVHWM,                               \
+        .pipehwm = HUTILS_ZMQ_DFLT_PIPEHWM,                             \
+        .sndbuf = HUTILS_ZMQ_DFLT_SNDBUF,                               \
+        .rcvbuf = HUTILS_ZMQ_DFLT_RCVBUF                                \
+    }
+
 typedef struct {
     char *bind;                 /* AFE Endpoint address to bind to */
     char *fmc_board;            /* FMC board type */
     bool spawn_dbe_epics_ioc;   /* DBE IOC spawn selection */
     bool spawn_afe_epics_ioc;   /* AFE IOC spawn selection */
+    hutils_sched_t sched;       /* DBE threads placement */
 } hutils_hints_t;
 
 /************************ Our methods *****************************/
@@ -62,6 +105,15 @@ char *hutils_stringify_dec_key (uint32_t key);
 /* Allocates a string with the necessary size to fit an hexadecimal key */
 char *hutils_stringify_hex_key (uint32_t key);
 
+/* Same as the hutils_stringify_*key functions, but writing the string to
+ * "buf", of "size" bytes, instead of allocating it. HUTILS_KEY_STR_MAX_LEN
+ * bytes fit any key. Returns the string length or -1 if the base is invalid
+ * or the string does not fit */
+int hutils_stringify_key_buf (char *buf, size_t size, uint32_t key,
+        uint32_t base);
+int hutils_stringify_dec_key_buf (char *buf, size_t size, uint32_t key);
+int hutils_stringify_hex_key_buf (char *buf, size_t size, uint32_t key);
+
 /* Converts a key string into the specified numeric base. Must fit into
  * a uint32_t */
 uint32_t hutils_numerify_key (const char *key, uint32_t base);
@@ -87,6 +139,16 @@ char *hutils_concat_strings_no_sep (const char *str1, const char* str2);
 char *hutils_concat_strings3 (const char *str1, const char* str2,
         const char* str3, char sep);
 
+/* Same as the hutils_concat_strings* functions, but writing the string to
+ * "buf", of "size" bytes, instead of allocating it. Returns the string
+ * length or -1 if it does not fit */
+int hutils_concat_strings_buf (char *buf, size_t size, const char *str1,
+        const char* str2, char sep);
+int hutils_concat_strings_no_sep_buf (char *buf, size_t size, const char *str1,
+        const char* str2);
+int hutils_concat_strings3_buf (char *buf, size_t size, const char *str1,
+        const char* str2, const char* str3, char sep);
+
 /* Spawns (fork and exec) a new process. Returns, for the parent process, -1
  * in case of error and child's PID (> 0) if success. For the child process,
  * returns -1 in case of error and 0 in case of success */
@@ -96,6 +158,12 @@ int hutils_spawn_chld (const char *program, char *const argv[]);
  * in the global LOG. Returns 0 in case of success and -1 in case of error */
 int hutils_wait_chld (void);
 
+/* Open a file descriptor referring to the child process "pid". It gets
+ * readable once the child exits, so it can be polled along with sockets.
+ * It is close-on-exec. Returns -1 in case of error, with errno set to
+ * ENOSYS if the kernel does not support it */
+int hutils_pidfd_open (pid_t pid);
+
 /* Wait for a child process with a looped timeout, printing the exit status
  * and possible errors in the global LOG. Returns 0 in case of success and
  * -1 in case of error */
@@ -109,10 +177,45 @@ char *hutils_clone_str (const char *str);
  * a maximum of size bytes */
 int hutils_copy_str (char *dest, const char *src, size_t size);
 
+/* Broker shards. The services of a board are all on the same broker shard,
+ * picked by board ID (the one of "BPM<board ID>:DEVIO" and the like). Shard
+ * 0 is on the broker endpoint itself, so a single shard is the usual single
+ * broker */
+
+/* Shard, out of "num_shards", the services of board "board_id" are on */
+uint32_t hutils_broker_shard (uint32_t board_id, uint32_t num_shards);
+/* Endpoint of broker shard "shard". TCP endpoints, e.g., tcp://host:9999, get
+ * the port incremented by the shard number, the others "-<shard>" appended.
+ * Returns the endpoint if OK, NULL in case of error */
+char *hutils_broker_shard_endp (const char *endp, uint32_t shard);
+/* Board ID of a service named "<prefix><board ID>:...", with "prefix" made of
+ * letters only, e.g., "BPM0:DEVIO:ACQ0". Returns -1 if it is not */
+int64_t hutils_service_board_id (const char *service);
+
 /* Get properties from config file (defined in http://rfc.zeromq.org/spec:4)
  * and store them in hash table in the form <property name / property value> */
 hutils_err_e hutils_get_hints (zconfig_t *root_cfg, zhashx_t *hints_h);
 
+/* Parses a CPU list, e.g., "0,2-3", into a mask with one bit per CPU. Only
+ * CPUs 0 to 63 are supported */
+hutils_err_e hutils_parse_cpu_list (const char *cpu_list, uint64_t *cpu_mask);
+/* Applies "sched" to the calling thread and logs the resulting placement,
+ * identified by "thread_name" */
+hutils_err_e hutils_set_thread_sched (const hutils_sched_t *sched,
+        const char *thread_name);
+
+/* Override "opts" with the properties found in config file section "path",
+ * e.g., "/dev_io_zmq". Missing or empty properties are left untouched */
+hutils_err_e hutils_get_zmq_opts (zconfig_t *root_cfg, const char *path,
+        hutils_zmq_opts_t *opts);
+/* Applies "opts" to the process. The I/O threads and HWMs only take effect
+ * if no ZeroMQ socket was created yet, so this must be called before any.
+ * The kernel buffers are applied by hutils_set_sock_bufs () */
+void hutils_set_zmq_opts (const hutils_zmq_opts_t *opts);
+/* Applies the kernel buffers of the last hutils_set_zmq_opts () to "sock",
+ * before it is bound or connected */
+void hutils_set_sock_bufs (zsock_t *sock);
+
 #ifdef __cplusplus
 }
 #endif
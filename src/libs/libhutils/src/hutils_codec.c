@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "hutils.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, HAL_UTILS, "[hutils:codec]",          \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)           \
+    ASSERT_HAL_ALLOC(ptr, HAL_UTILS, "[hutils:codec]",                  \
+            hutils_err_str(HUTILS_ERR_ALLOC),                           \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                        \
+    CHECK_HAL_ERR(err, HAL_UTILS, "[hutils:codec]",                     \
+            hutils_err_str (err_type))
+
+/* Encoded stream is, for each atom and each frame: one byte with the bit
+ * width of the differences, followed by the differences, zigzag encoded and
+ * packed LSB first. Each frame of an atom starts at a byte boundary */
+
+static uint32_t _hutils_codec_load (const uint8_t *p, uint32_t atom_size);
+static void _hutils_codec_store (uint8_t *p, uint32_t atom_size, uint32_t v);
+static uint32_t _hutils_codec_width (uint32_t v);
+static uint8_t *_hutils_codec_varint_put (uint8_t *p, const uint8_t *end,
+        uint32_t v);
+static const uint8_t *_hutils_codec_varint_get (const uint8_t *p,
+        const uint8_t *end, uint32_t *v);
+
+size_t hutils_codec_delta_bound (size_t size, uint32_t atom_size,
+        uint32_t num_atoms)
+{
+    size_t num_samples = size / (atom_size * num_atoms);
+    size_t num_frames = (num_samples + HUTILS_CODEC_FRAME_SAMPLES - 1) /
+        HUTILS_CODEC_FRAME_SAMPLES;
+
+    return num_samples * atom_size * num_atoms + num_frames * num_atoms;
+}
+
+ssize_t hutils_codec_delta_encode (uint8_t *dst, size_t dst_size,
+        const uint8_t *src, size_t size, uint32_t atom_size, uint32_t num_atoms)
+{
+    assert (dst);
+    assert (src);
+    assert (atom_size == sizeof (uint16_t) || atom_size == sizeof (uint32_t));
+
+    const uint32_t atom_bits = atom_size * 8;
+    const uint32_t sign_shift = 32 - atom_bits;
+    const size_t sample_size = atom_size * num_atoms;
+    size_t num_samples = size / sample_size;
+    uint8_t *p = dst;
+    uint8_t *end = dst + dst_size;
+
+    for (uint32_t a = 0; a < num_atoms; ++a) {
+        uint32_t prev = 0;
+
+        for (size_t f = 0; f < num_samples; f += HUTILS_CODEC_FRAME_SAMPLES) {
+            size_t n = num_samples - f;
+            if (n > HUTILS_CODEC_FRAME_SAMPLES) {
+                n = HUTILS_CODEC_FRAME_SAMPLES;
+            }
+
+            /* Zigzag encoded differences, so small negative ones take
+             * few bits too */
+            uint32_t zz [HUTILS_CODEC_FRAME_SAMPLES];
+            uint32_t all = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t v = _hutils_codec_load (src + (f + i)*sample_size +
+                        a*atom_size, atom_size);
+                int32_t d = (int32_t) ((v - prev) << sign_shift) >> sign_shift;
+                zz [i] = ((uint32_t) d << 1) ^ (uint32_t) (d >> 31);
+                /* Only the atom bits are significant */
+                zz [i] &= (atom_bits == 32) ? 0xFFFFFFFF : ((1U << atom_bits) - 1);
+                all |= zz [i];
+                prev = v;
+            }
+
+            uint32_t width = _hutils_codec_width (all);
+            size_t packed_size = (n * width + 7) / 8;
+            if ((size_t) (end - p) < 1 + packed_size) {
+                return -1;
+            }
+
+            *p++ = (uint8_t) width;
+            uint64_t acc = 0;
+            uint32_t acc_bits = 0;
+            for (size_t i = 0; i < n; ++i) {
+                acc |= (uint64_t) zz [i] << acc_bits;
+                acc_bits += width;
+                while (acc_bits >= 8) {
+                    *p++ = (uint8_t) acc;
+                    acc >>= 8;
+                    acc_bits -= 8;
+                }
+            }
+            if (acc_bits > 0) {
+                *p++ = (uint8_t) acc;
+            }
+        }
+    }
+
+    return p - dst;
+}
+
+ssize_t hutils_codec_delta_decode (uint8_t *dst, size_t size,
+        const uint8_t *src, size_t src_size, uint32_t atom_size,
+        uint32_t num_atoms)
+{
+    assert (dst);
+    assert (src);
+    assert (atom_size == sizeof (uint16_t) || atom_size == sizeof (uint32_t));
+
+    const uint32_t atom_bits = atom_size * 8;
+    const size_t sample_size = atom_size * num_atoms;
+    size_t num_samples = size / sample_size;
+    const uint8_t *p = src;
+    const uint8_t *end = src + src_size;
+
+    for (uint32_t a = 0; a < num_atoms; ++a) {
+        uint32_t prev = 0;
+
+        for (size_t f = 0; f < num_samples; f += HUTILS_CODEC_FRAME_SAMPLES) {
+            size_t n = num_samples - f;
+            if (n > HUTILS_CODEC_FRAME_SAMPLES) {
+                n = HUTILS_CODEC_FRAME_SAMPLES;
+            }
+
+            if (p >= end) {
+                return -1;
+            }
+            uint32_t width = *p++;
+            if (width > atom_bits || (size_t) (end - p) < (n * width + 7) / 8) {
+                return -1;
+            }
+
+            const uint64_t mask = (width == 32) ? 0xFFFFFFFF : ((1ULL << width) - 1);
+            uint64_t acc = 0;
+            uint32_t acc_bits = 0;
+            for (size_t i = 0; i < n; ++i) {
+                while (acc_bits < width) {
+                    acc |= (uint64_t) *p++ << acc_bits;
+                    acc_bits += 8;
+                }
+                uint32_t zz = (uint32_t) (acc & mask);
+                acc >>= width;
+                acc_bits -= width;
+
+                prev += (zz >> 1) ^ -(zz & 1);
+                _hutils_codec_store (dst + (f + i)*sample_size + a*atom_size,
+                        atom_size, prev);
+            }
+        }
+    }
+
+    return num_samples * sample_size;
+}
+
+size_t hutils_codec_scaled16_bound (size_t size, uint32_t num_atoms)
+{
+    size_t num_samples = size / (sizeof (uint32_t) * num_atoms);
+    return HUTILS_CODEC_SCALED16_HDR_SIZE(num_atoms) +
+        num_samples * sizeof (uint16_t) * num_atoms;
+}
+
+ssize_t hutils_codec_scaled16_encode (uint8_t *dst, size_t dst_size,
+        const uint8_t *src, size_t size, uint32_t num_atoms)
+{
+    assert (dst);
+    assert (src);
+
+    const size_t sample_size = sizeof (uint32_t) * num_atoms;
+    size_t num_samples = size / sample_size;
+    if (hutils_codec_scaled16_bound (size, num_atoms) > dst_size) {
+        return -1;
+    }
+
+    uint8_t *p = dst + HUTILS_CODEC_SCALED16_HDR_SIZE(num_atoms);
+    for (uint32_t a = 0; a < num_atoms; ++a) {
+        int64_t min = INT32_MAX;
+        int64_t max = INT32_MIN;
+        for (size_t i = 0; i < num_samples; ++i) {
+            int64_t v = (int32_t) _hutils_codec_load (src + i*sample_size +
+                    a*sizeof (uint32_t), sizeof (uint32_t));
+            min = (v < min) ? v : min;
+            max = (v > max) ? v : max;
+        }
+
+        /* Smallest scale that fits the span around its midpoint, rounded */
+        int64_t offset = (num_samples == 0) ? 0 : min + (max - min) / 2;
+        uint32_t shift = 0;
+        while (num_samples > 0 && ((max - offset + ((1LL << shift) >> 1)) >> shift) >
+                INT16_MAX) {
+            ++shift;
+        }
+
+        _hutils_codec_store (dst + a*HUTILS_CODEC_SCALED16_HDR_SIZE(1),
+                sizeof (uint32_t), (uint32_t) offset);
+        _hutils_codec_store (dst + a*HUTILS_CODEC_SCALED16_HDR_SIZE(1) +
+                sizeof (uint32_t), sizeof (uint32_t), shift);
+
+        const int64_t half = (1LL << shift) >> 1;
+        for (size_t i = 0; i < num_samples; ++i) {
+            int64_t v = (int32_t) _hutils_codec_load (src + i*sample_size +
+                    a*sizeof (uint32_t), sizeof (uint32_t));
+            /* Arithmetic shift, so negative differences round the same */
+            int64_t q = (v - offset + half) >> shift;
+            q = (q > INT16_MAX) ? INT16_MAX : (q < INT16_MIN) ? INT16_MIN : q;
+            _hutils_codec_store (p + (i*num_atoms + a)*sizeof (uint16_t),
+                    sizeof (uint16_t), (uint16_t) (int16_t) q);
+        }
+    }
+
+    return hutils_codec_scaled16_bound (size, num_atoms);
+}
+
+ssize_t hutils_codec_scaled16_decode (uint8_t *dst, size_t size,
+        const uint8_t *src, size_t src_size, uint32_t num_atoms)
+{
+    assert (dst);
+    assert (src);
+
+    const size_t sample_size = sizeof (uint32_t) * num_atoms;
+    size_t num_samples = size / sample_size;
+    if (hutils_codec_scaled16_bound (size, num_atoms) != src_size) {
+        return -1;
+    }
+
+    const uint8_t *p = src + HUTILS_CODEC_SCALED16_HDR_SIZE(num_atoms);
+    for (uint32_t a = 0; a < num_atoms; ++a) {
+        int64_t offset = (int32_t) _hutils_codec_load (src +
+                a*HUTILS_CODEC_SCALED16_HDR_SIZE(1), sizeof (uint32_t));
+        uint32_t shift = _hutils_codec_load (src + a*HUTILS_CODEC_SCALED16_HDR_SIZE(1) +
+                sizeof (uint32_t), sizeof (uint32_t));
+        if (shift > 32) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < num_samples; ++i) {
+            int64_t q = (int16_t) _hutils_codec_load (p + (i*num_atoms + a)*
+                    sizeof (uint16_t), sizeof (uint16_t));
+            int64_t v = offset + q * (1LL << shift);
+            v = (v > INT32_MAX) ? INT32_MAX : (v < INT32_MIN) ? INT32_MIN : v;
+            _hutils_codec_store (dst + i*sample_size + a*sizeof (uint32_t),
+                    sizeof (uint32_t), (uint32_t) (int32_t) v);
+        }
+    }
+
+    return num_samples * sample_size;
+}
+
+ssize_t hutils_codec_fields_encode (uint8_t *dst, size_t dst_size,
+        const uint32_t *cur, const uint32_t *prev, uint32_t num_fields)
+{
+    assert (dst);
+    assert (cur);
+    assert (prev);
+    assert (num_fields <= HUTILS_CODEC_FIELDS_MAX);
+
+    uint32_t changed = 0;
+    for (uint32_t i = 0; i < num_fields; ++i) {
+        if (cur [i] != prev [i]) {
+            changed |= 1U << i;
+        }
+    }
+
+    uint8_t *p = _hutils_codec_varint_put (dst, dst + dst_size, changed);
+    for (uint32_t i = 0; p != NULL && i < num_fields; ++i) {
+        if (changed & (1U << i)) {
+            int32_t d = (int32_t) (cur [i] - prev [i]);
+            p = _hutils_codec_varint_put (p, dst + dst_size,
+                    ((uint32_t) d << 1) ^ (uint32_t) (d >> 31));
+        }
+    }
+
+    return (p != NULL) ? p - dst : -1;
+}
+
+ssize_t hutils_codec_fields_decode (uint32_t *fields, uint32_t num_fields,
+        const uint8_t *src, size_t src_size)
+{
+    assert (fields);
+    assert (src);
+    assert (num_fields <= HUTILS_CODEC_FIELDS_MAX);
+
+    const uint8_t *end = src + src_size;
+    uint32_t changed;
+    const uint8_t *p = _hutils_codec_varint_get (src, end, &changed);
+    if (p == NULL || (num_fields < 32 && (changed >> num_fields) != 0)) {
+        return -1;
+    }
+
+    /* Only touch the fields once the whole record is known to be valid */
+    uint32_t diffs [HUTILS_CODEC_FIELDS_MAX];
+    for (uint32_t i = 0; i < num_fields; ++i) {
+        diffs [i] = 0;
+        if (changed & (1U << i)) {
+            uint32_t zz;
+            p = _hutils_codec_varint_get (p, end, &zz);
+            if (p == NULL) {
+                return -1;
+            }
+            diffs [i] = (zz >> 1) ^ -(zz & 1);
+        }
+    }
+
+    for (uint32_t i = 0; i < num_fields; ++i) {
+        fields [i] += diffs [i];
+    }
+
+    return p - src;
+}
+
+/***************************** Static Functions ******************************/
+
+static uint32_t _hutils_codec_load (const uint8_t *p, uint32_t atom_size)
+{
+    if (atom_size == sizeof (uint16_t)) {
+        uint16_t v;
+        memcpy (&v, p, sizeof (v));
+        return v;
+    }
+
+    uint32_t v;
+    memcpy (&v, p, sizeof (v));
+    return v;
+}
+
+static void _hutils_codec_store (uint8_t *p, uint32_t atom_size, uint32_t v)
+{
+    if (atom_size == sizeof (uint16_t)) {
+        uint16_t v16 = (uint16_t) v;
+        memcpy (p, &v16, sizeof (v16));
+        return;
+    }
+
+    memcpy (p, &v, sizeof (v));
+}
+
+/* Number of bits needed to represent "v" */
+static uint32_t _hutils_codec_width (uint32_t v)
+{
+    return (v == 0) ? 0 : 32 - __builtin_clz (v);
+}
+
+/* Varints take 7 bits per byte, least significant first, with the top bit
+ * set on all bytes but the last. NULL if "v" does not fit before "end" */
+static uint8_t *_hutils_codec_varint_put (uint8_t *p, const uint8_t *end,
+        uint32_t v)
+{
+    do {
+        if (p >= end) {
+            return NULL;
+        }
+        *p++ = (uint8_t) ((v & 0x7F) | ((v > 0x7F) ? 0x80 : 0));
+        v >>= 7;
+    } while (v != 0);
+
+    return p;
+}
+
+/* NULL if there is no valid 32-bit varint before "end" */
+static const uint8_t *_hutils_codec_varint_get (const uint8_t *p,
+        const uint8_t *end, uint32_t *v)
+{
+    *v = 0;
+    for (uint32_t shift = 0; shift < 35; shift += 7) {
+        if (p >= end) {
+            return NULL;
+        }
+        uint8_t b = *p++;
+        *v |= (uint32_t) (b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return p;
+        }
+    }
+
+    return NULL;
+}
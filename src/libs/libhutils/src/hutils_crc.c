@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "hutils.h"
+
+#include <pthread.h>
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/* Reflected CRC32C polynomial */
+#define HUTILS_CRC32C_POLY                  0x82F63B78
+
+typedef uint32_t (*hutils_crc32c_fp) (uint32_t crc, const uint8_t *p,
+        size_t size);
+
+static void _hutils_crc32c_init (void);
+static uint32_t _hutils_crc32c_sw (uint32_t crc, const uint8_t *p, size_t size);
+#if defined(__x86_64__) && defined(__GNUC__)
+static uint32_t _hutils_crc32c_sse42 (uint32_t crc, const uint8_t *p,
+        size_t size);
+#endif
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+static uint32_t _hutils_crc32c_armv8 (uint32_t crc, const uint8_t *p,
+        size_t size);
+#endif
+
+/* Slicing-by-8 tables of the software fallback */
+static uint32_t hutils_crc32c_tbl [8][256];
+static hutils_crc32c_fp hutils_crc32c_impl = NULL;
+static bool hutils_crc32c_is_hw = false;
+static pthread_once_t hutils_crc32c_once = PTHREAD_ONCE_INIT;
+
+uint32_t hutils_crc32c (uint32_t crc, const void *data, size_t size)
+{
+    assert (data != NULL || size == 0);
+
+    pthread_once (&hutils_crc32c_once, _hutils_crc32c_init);
+    return ~hutils_crc32c_impl (~crc, (const uint8_t *) data, size);
+}
+
+bool hutils_crc32c_hw (void)
+{
+    pthread_once (&hutils_crc32c_once, _hutils_crc32c_init);
+    return hutils_crc32c_is_hw;
+}
+
+/************ Static Functions ************/
+
+static void _hutils_crc32c_init (void)
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ (HUTILS_CRC32C_POLY & -(crc & 1));
+        }
+        hutils_crc32c_tbl [0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int t = 1; t < 8; ++t) {
+            uint32_t prev = hutils_crc32c_tbl [t-1][i];
+            hutils_crc32c_tbl [t][i] = (prev >> 8) ^
+                hutils_crc32c_tbl [0][prev & 0xFF];
+        }
+    }
+
+    hutils_crc32c_impl = _hutils_crc32c_sw;
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("sse4.2")) {
+        hutils_crc32c_impl = _hutils_crc32c_sse42;
+        hutils_crc32c_is_hw = true;
+    }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    hutils_crc32c_impl = _hutils_crc32c_armv8;
+    hutils_crc32c_is_hw = true;
+#endif
+}
+
+static uint32_t _hutils_crc32c_sw (uint32_t crc, const uint8_t *p, size_t size)
+{
+    while (size > 0 && ((uintptr_t) p & 7) != 0) {
+        crc = (crc >> 8) ^ hutils_crc32c_tbl [0][(crc ^ *p++) & 0xFF];
+        size--;
+    }
+
+    /* Little endian only, as the rest of the data path */
+    while (size >= 8) {
+        uint32_t lo;
+        uint32_t hi;
+        memcpy (&lo, p, sizeof (lo));
+        memcpy (&hi, p + 4, sizeof (hi));
+        lo ^= crc;
+        crc = hutils_crc32c_tbl [7][lo & 0xFF] ^
+            hutils_crc32c_tbl [6][(lo >> 8) & 0xFF] ^
+            hutils_crc32c_tbl [5][(lo >> 16) & 0xFF] ^
+            hutils_crc32c_tbl [4][lo >> 24] ^
+            hutils_crc32c_tbl [3][hi & 0xFF] ^
+            hutils_crc32c_tbl [2][(hi >> 8) & 0xFF] ^
+            hutils_crc32c_tbl [1][(hi >> 16) & 0xFF] ^
+            hutils_crc32c_tbl [0][hi >> 24];
+        p += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc = (crc >> 8) ^ hutils_crc32c_tbl [0][(crc ^ *p++) & 0xFF];
+        size--;
+    }
+
+    return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+/* Built for SSE4.2 regardless of the compiler flags, and only called if
+ * the CPU has it */
+__attribute__ ((target ("sse4.2")))
+static uint32_t _hutils_crc32c_sse42 (uint32_t crc, const uint8_t *p,
+        size_t size)
+{
+    uint64_t crc64 = crc;
+
+    while (size > 0 && ((uintptr_t) p & 7) != 0) {
+        crc64 = __builtin_ia32_crc32qi ((uint32_t) crc64, *p++);
+        size--;
+    }
+
+    while (size >= 8) {
+        uint64_t v;
+        memcpy (&v, p, sizeof (v));
+        crc64 = __builtin_ia32_crc32di (crc64, v);
+        p += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc64 = __builtin_ia32_crc32qi ((uint32_t) crc64, *p++);
+        size--;
+    }
+
+    return (uint32_t) crc64;
+}
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+static uint32_t _hutils_crc32c_armv8 (uint32_t crc, const uint8_t *p,
+        size_t size)
+{
+    while (size > 0 && ((uintptr_t) p & 7) != 0) {
+        crc = __crc32cb (crc, *p++);
+        size--;
+    }
+
+    while (size >= 8) {
+        uint64_t v;
+        memcpy (&v, p, sizeof (v));
+        crc = __crc32cd (crc, v);
+        p += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc = __crc32cb (crc, *p++);
+        size--;
+    }
+
+    return crc;
+}
+#endif
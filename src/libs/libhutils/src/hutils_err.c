@@ -14,7 +14,10 @@ static const char *hutils_err [HUTILS_ERR_END] =
 {
     [HUTILS_SUCCESS]              = "Success",
     [HUTILS_ERR_ALLOC]            = "Could not allocate memory",
-    [HUTILS_ERR_CFG]              = "Could not get property from config file"
+    [HUTILS_ERR_CFG]              = "Could not get property from config file",
+    [HUTILS_ERR_SCHED]            = "Could not set thread affinity or scheduling policy",
+    [HUTILS_ERR_NUMA]             = "Could not set NUMA memory policy",
+    [HUTILS_ERR_MLOCK]            = "Could not lock memory"
 };
 
 /* Convert enumeration type to string */
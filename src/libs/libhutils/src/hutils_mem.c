@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* For MAP_HUGETLB and MADV_HUGEPAGE */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <linux/mempolicy.h>
+
+#include "hutils.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, HAL_UTILS, "[hutils:mem]",            \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)           \
+    ASSERT_HAL_ALLOC(ptr, HAL_UTILS, "[hutils:mem]",                    \
+            hutils_err_str(HUTILS_ERR_ALLOC),                           \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                        \
+    CHECK_HAL_ERR(err, HAL_UTILS, "[hutils:mem]",                       \
+            hutils_err_str (err_type))
+
+#define HUTILS_MEM_SYSFS_PATH_LEN           128
+#define HUTILS_MEM_PAGE_SIZE                4096
+
+/* Node mask for the mempolicy syscalls. The kernel ignores the last bit of
+ * "maxnode", hence the + 1 */
+#define HUTILS_MEM_NODE_MASK(numa_node)     {1UL << (numa_node)}
+#define HUTILS_MEM_MAXNODE                  (HUTILS_MEM_MAX_NODES + 1)
+
+/* There is no glibc wrapper for these, and we don't want to depend
+ * on libnuma */
+static long _hutils_mem_set_mempolicy (int mode, const unsigned long *nodemask,
+        unsigned long maxnode)
+{
+    return syscall (SYS_set_mempolicy, mode, nodemask, maxnode);
+}
+
+static long _hutils_mem_mbind (void *addr, size_t size, int mode,
+        const unsigned long *nodemask, unsigned long maxnode)
+{
+    return syscall (SYS_mbind, addr, size, mode, nodemask, maxnode, 0);
+}
+
+/* Real-time mode was entered */
+static bool hutils_mem_rt = false;
+
+/* Initial-exec, so an allocator wrapper can use them without the TLS
+ * access itself allocating */
+__thread uint32_t hutils_mem_rt_guard __attribute__ ((tls_model ("initial-exec"))) = 0;
+__thread uint32_t hutils_mem_rt_allocs __attribute__ ((tls_model ("initial-exec"))) = 0;
+
+/* Same for the allocation accounting */
+bool hutils_mem_acct_wrapped = false;
+__thread hutils_mem_acct_t *hutils_mem_acct __attribute__ ((tls_model ("initial-exec"))) = NULL;
+__thread uint32_t hutils_mem_acct_subsys __attribute__ ((tls_model ("initial-exec"))) =
+    HUTILS_MEM_ACCT_OTHER;
+__thread uint32_t hutils_mem_acct_opcode __attribute__ ((tls_model ("initial-exec"))) =
+    HUTILS_MEM_ACCT_NO_OPCODE;
+
+/* Write to every page of HUTILS_MEM_RT_STACK_PREFAULT bytes of the stack
+ * below us, so later calls that deep don't fault */
+static void __attribute__ ((noinline)) _hutils_mem_prefault_stack (void)
+{
+    volatile uint8_t stack [HUTILS_MEM_RT_STACK_PREFAULT];
+    for (size_t offs = 0; offs < sizeof (stack); offs += HUTILS_MEM_PAGE_SIZE) {
+        stack [offs] = 0;
+    }
+}
+
+int hutils_mem_dev_numa_node (const char *dev_path)
+{
+    assert (dev_path);
+
+    int numa_node = HUTILS_MEM_NODE_ANY;
+    struct stat dev_stat;
+    if (stat (dev_path, &dev_stat) != 0 || !S_ISCHR (dev_stat.st_mode)) {
+        goto err_not_chr;
+    }
+
+    char path [HUTILS_MEM_SYSFS_PATH_LEN];
+    snprintf (path, sizeof (path), "/sys/dev/char/%u:%u/device/numa_node",
+            major (dev_stat.st_rdev), minor (dev_stat.st_rdev));
+
+    FILE *fp = fopen (path, "r");
+    if (fp == NULL) {
+        goto err_fopen;
+    }
+
+    /* The kernel reports -1 itself for devices with no node */
+    if (fscanf (fp, "%d", &numa_node) != 1 || numa_node < 0 ||
+            numa_node >= HUTILS_MEM_MAX_NODES) {
+        numa_node = HUTILS_MEM_NODE_ANY;
+    }
+    fclose (fp);
+
+    DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_INFO, "[hutils:mem] Device %s is on "
+            "NUMA node %d\n", dev_path, numa_node);
+
+err_fopen:
+err_not_chr:
+    return numa_node;
+}
+
+hutils_err_e hutils_mem_set_thread_node (int numa_node)
+{
+    hutils_err_e err = HUTILS_SUCCESS;
+
+    if (numa_node == HUTILS_MEM_NODE_ANY) {
+        goto err_no_node;
+    }
+
+    ASSERT_TEST (numa_node >= 0 && numa_node < HUTILS_MEM_MAX_NODES,
+            "Invalid NUMA node", err_inv_node, HUTILS_ERR_NUMA);
+
+    const unsigned long nodemask [] = HUTILS_MEM_NODE_MASK(numa_node);
+    long rc = _hutils_mem_set_mempolicy (MPOL_PREFERRED, nodemask,
+            HUTILS_MEM_MAXNODE);
+    ASSERT_TEST (rc == 0, "Could not set thread memory policy", err_mempolicy,
+            HUTILS_ERR_NUMA);
+
+err_mempolicy:
+err_inv_node:
+err_no_node:
+    return err;
+}
+
+hutils_err_e hutils_mem_bind (void *addr, size_t size, int numa_node)
+{
+    assert (addr);
+    hutils_err_e err = HUTILS_SUCCESS;
+
+    if (numa_node == HUTILS_MEM_NODE_ANY) {
+        goto err_no_node;
+    }
+
+    ASSERT_TEST (numa_node >= 0 && numa_node < HUTILS_MEM_MAX_NODES,
+            "Invalid NUMA node", err_inv_node, HUTILS_ERR_NUMA);
+
+    const unsigned long nodemask [] = HUTILS_MEM_NODE_MASK(numa_node);
+    long rc = _hutils_mem_mbind (addr, size, MPOL_PREFERRED, nodemask,
+            HUTILS_MEM_MAXNODE);
+    ASSERT_TEST (rc == 0, "Could not bind memory to NUMA node", err_mbind,
+            HUTILS_ERR_NUMA);
+
+err_mbind:
+err_inv_node:
+err_no_node:
+    return err;
+}
+
+void *hutils_mem_map (size_t size, int numa_node, size_t *map_size)
+{
+    assert (map_size);
+
+    size_t len = (size + HUTILS_MEM_HUGE_PAGE_SIZE - 1) &
+        ~(HUTILS_MEM_HUGE_PAGE_SIZE - 1);
+    bool huge = true;
+
+    /* Huge pages are reserved here, so this fails if the pool is too small,
+     * instead of at fault time */
+    void *addr = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE |
+            MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr == MAP_FAILED) {
+        huge = false;
+        addr = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE |
+                MAP_ANONYMOUS, -1, 0);
+        ASSERT_TEST (addr != MAP_FAILED, "Could not map memory", err_mmap);
+        /* Try transparent huge pages at least */
+        madvise (addr, len, MADV_HUGEPAGE);
+    }
+
+    /* Not fatal, the memory is just wherever the kernel puts it */
+    hutils_mem_bind (addr, len, numa_node);
+
+    /* Fault everything in now, on the right node, instead of on the
+     * first transfer */
+    for (size_t offs = 0; offs < len; offs += HUTILS_MEM_PAGE_SIZE) {
+        ((volatile uint8_t *) addr) [offs] = 0;
+    }
+
+    DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_INFO, "[hutils:mem] Mapped %zu bytes "
+            "with %s pages on NUMA node %d\n", len, huge ? "huge" : "regular",
+            numa_node);
+
+    *map_size = len;
+    return addr;
+
+err_mmap:
+    return NULL;
+}
+
+void hutils_mem_unmap (void *addr, size_t map_size)
+{
+    if (addr != NULL) {
+        munmap (addr, map_size);
+    }
+}
+
+hutils_err_e hutils_mem_rt_enable (void)
+{
+    hutils_err_e err = HUTILS_SUCCESS;
+    __atomic_store_n (&hutils_mem_rt, true, __ATOMIC_RELAXED);
+
+    int rc = mlockall (MCL_CURRENT | MCL_FUTURE);
+    ASSERT_TEST (rc == 0, "Could not lock memory. Is CAP_IPC_LOCK missing or "
+            "RLIMIT_MEMLOCK too small?", err_mlockall, HUTILS_ERR_MLOCK);
+
+    DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_INFO, "[hutils:mem] Memory locked for "
+            "real-time mode\n");
+
+err_mlockall:
+    hutils_mem_rt_thread_init ();
+    return err;
+}
+
+bool hutils_mem_rt_enabled (void)
+{
+    return __atomic_load_n (&hutils_mem_rt, __ATOMIC_RELAXED);
+}
+
+void hutils_mem_rt_thread_init (void)
+{
+    if (!hutils_mem_rt_enabled ()) {
+        return;
+    }
+
+    _hutils_mem_prefault_stack ();
+    /* The log ring of a thread is created on its first line otherwise */
+    errhand_log_prealloc ();
+}
+
+void hutils_mem_rt_guard_begin (void)
+{
+    hutils_mem_rt_allocs = 0;
+    hutils_mem_rt_guard = 1;
+}
+
+uint32_t hutils_mem_rt_guard_end (void)
+{
+    hutils_mem_rt_guard = 0;
+    return hutils_mem_rt_allocs;
+}
+
+hutils_mem_acct_t *hutils_mem_acct_attach (hutils_mem_acct_t *acct)
+{
+    hutils_mem_acct_t *prev = hutils_mem_acct;
+    hutils_mem_acct = acct;
+    return prev;
+}
+
+uint32_t hutils_mem_acct_push (uint32_t subsys)
+{
+    uint32_t prev = hutils_mem_acct_subsys;
+    hutils_mem_acct_subsys = subsys;
+    return prev;
+}
+
+void hutils_mem_acct_pop (uint32_t prev_subsys)
+{
+    hutils_mem_acct_subsys = prev_subsys;
+}
+
+void hutils_mem_acct_set_opcode (uint32_t opcode)
+{
+    hutils_mem_acct_opcode = opcode;
+}
@@ -5,6 +5,15 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+/* For the CPU affinity functions */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
 #include "hutils.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
@@ -31,11 +40,19 @@
             hutils_err_str (err_type))
 
 #define MIN_WAIT_TIME           1                           /* in ms */
+#define HUTILS_SCHED_MAX_CPUS   64                          /* Bits in hutils_sched_t.cpu_mask */
+#define HUTILS_SCHED_LOG_LEN    256                         /* CPU list buffer length */
 #define MSECS                   1000                        /* in seconds */
+#define HUTILS_SHARD_SUFFIX_LEN 16                          /* Room for a shard port or suffix */
 
 static char *_hutils_concat_strings_raw (const char *str1, const char* str2,
         const char *str3, bool with_sep, char sep);
 static void _hutils_hints_free_item (void **data);
+static void _hutils_log_thread_sched (const char *thread_name);
+
+/* Kernel buffers of the bulk data sockets, see hutils_set_sock_bufs () */
+static int hutils_sndbuf = 0;
+static int hutils_rcvbuf = 0;
 
 /*******************************************************************/
 /*****************  String manipulation functions ******************/
@@ -64,31 +81,56 @@ uint32_t hutils_dec_to_str_len (uint32_t key)
     return hutils_num_to_str_len (key, 10);
 }
 
-char *hutils_stringify_key (uint32_t key, uint32_t base)
+int hutils_stringify_key_buf (char *buf, size_t size, uint32_t key,
+        uint32_t base)
 {
-    uint32_t key_len = hutils_num_to_str_len (key, base) + 1; /* +1 for \0 */
-    char *key_c = zmalloc (key_len * sizeof (char));
-    ASSERT_ALLOC (key_c, err_key_c_alloc);
+    assert (buf);
 
+    int len;
     switch (base) {
         case 10:
-            snprintf(key_c, key_len, "%u", key);
+            len = snprintf (buf, size, "%u", key);
         break;
 
         case 16:
-            snprintf(key_c, key_len, "%x", key);
+            len = snprintf (buf, size, "%x", key);
         break;
 
         default:
             DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_ERR,
                     "[hutils:stringify_key] invalid base = %u\n",
                     base);
-            goto err_inv_base;
+            return -1;
     }
 
+    return (len >= 0 && (size_t) len < size) ? len : -1;
+}
+
+int hutils_stringify_dec_key_buf (char *buf, size_t size, uint32_t key)
+{
+    return hutils_stringify_key_buf (buf, size, key, 10);
+}
+
+int hutils_stringify_hex_key_buf (char *buf, size_t size, uint32_t key)
+{
+    return hutils_stringify_key_buf (buf, size, key, 16);
+}
+
+char *hutils_stringify_key (uint32_t key, uint32_t base)
+{
+    uint32_t key_len = hutils_num_to_str_len (key, base) + 1; /* +1 for \0 */
+    uint32_t acct = hutils_mem_acct_push (HUTILS_MEM_ACCT_STR);
+    char *key_c = zmalloc (key_len * sizeof (char));
+    hutils_mem_acct_pop (acct);
+    ASSERT_ALLOC (key_c, err_key_c_alloc);
+
+    int len = hutils_stringify_key_buf (key_c, key_len, key, base);
+    ASSERT_TEST (len >= 0, "Could not stringify key", err_stringify);
+
     return key_c;
 
-err_inv_base:
+err_stringify:
+    free (key_c);
 err_key_c_alloc:
     return NULL;
 }
@@ -119,48 +161,108 @@ uint32_t hutils_numerify_hex_key (const char *key)
 }
 
 #define SEPARATOR_BYTES 1
-/* FIXME: poorly written */
+
+static int _hutils_concat_strings_buf_raw (char *buf, size_t size,
+        const char *str1, const char* str2, const char *str3, bool with_sep,
+        char sep)
+{
+    assert (buf);
+    assert (str1);
+    assert (str2);
+
+    if (str3 == NULL) {
+        str3 = "";
+    }
+
+    int len = (with_sep) ?
+        snprintf (buf, size, "%s%c%s%s", str1, sep, str2, str3) :
+        snprintf (buf, size, "%s%s%s", str1, str2, str3);
+
+    return (len >= 0 && (size_t) len < size) ? len : -1;
+}
+
 static char *_hutils_concat_strings_raw (const char *str1, const char* str2,
         const char *str3, bool with_sep, char sep)
 {
     assert (str1);
     assert (str2);
 
-    uint32_t num_sep_bytes = (with_sep)? SEPARATOR_BYTES : 0;
+    size_t size = strlen (str1) + strlen (str2) + ((str3 != NULL) ? strlen (str3) : 0) +
+        ((with_sep) ? SEPARATOR_BYTES : 0) /* separator length */ + 1 /* \0 */;
+    uint32_t acct = hutils_mem_acct_push (HUTILS_MEM_ACCT_STR);
+    char *str = zmalloc (size);
+    hutils_mem_acct_pop (acct);
+    ASSERT_ALLOC(str, err_str_alloc);
 
-    char *str = NULL;
-    if (str3 != NULL) {
-        str = zmalloc (strlen (str1) + strlen (str2) + strlen (str3) +
-                num_sep_bytes /* separator length */+ 1 /* \0 */);
-        ASSERT_ALLOC(str, err_str3_alloc);
+    _hutils_concat_strings_buf_raw (str, size, str1, str2, str3, with_sep, sep);
 
-        if (with_sep) {
-            sprintf (str, "%s%c%s%s", str1, sep, str2, str3);
-        }
-        else {
-            sprintf (str, "%s%s%s", str1, str2, str3);
-        }
+    return str;
+
+err_str_alloc:
+    return NULL;
+}
+
+uint32_t hutils_broker_shard (uint32_t board_id, uint32_t num_shards)
+{
+    return (num_shards > 1) ? board_id % num_shards : 0;
+}
+
+char *hutils_broker_shard_endp (const char *endp, uint32_t shard)
+{
+    assert (endp);
+
+    if (shard == 0) {
+        return strdup (endp);
     }
-    else {
-        str = zmalloc (strlen(str1) + strlen(str2) +
-                num_sep_bytes /* separator length */+ 1 /* \0 */);
-        ASSERT_ALLOC(str, err_str2_alloc);
 
-        if (with_sep) {
-            sprintf (str, "%s%c%s", str1, sep, str2);
-        }
-        else {
-            sprintf (str, "%s%s", str1, str2);
-        }
+    size_t len = strlen (endp);
+    char *shard_endp = (char *) zmalloc (len + HUTILS_SHARD_SUFFIX_LEN);
+    ASSERT_ALLOC(shard_endp, err_shard_endp_alloc);
+
+    const char *port_str = strrchr (endp, ':');
+    if (strncmp (endp, "tcp://", strlen ("tcp://")) == 0 && port_str != NULL &&
+            port_str > endp + strlen ("tcp:")) {
+        char *endptr = NULL;
+        unsigned long port = strtoul (port_str + 1, &endptr, 10);
+        ASSERT_TEST(*endptr == '\0' && port + shard <= 65535, "Invalid TCP "
+                "port for broker shard", err_inv_port);
+        snprintf (shard_endp, len + HUTILS_SHARD_SUFFIX_LEN, "%.*s:%lu",
+                (int) (port_str - endp), endp, port + shard);
+    }
+    else {
+        snprintf (shard_endp, len + HUTILS_SHARD_SUFFIX_LEN, "%s-%"PRIu32, endp,
+                shard);
     }
 
-    return str;
+    return shard_endp;
 
-err_str3_alloc:
-err_str2_alloc:
+err_inv_port:
+    free (shard_endp);
+err_shard_endp_alloc:
     return NULL;
 }
 
+int64_t hutils_service_board_id (const char *service)
+{
+    assert (service);
+
+    const char *p = service;
+    while (isalpha ((unsigned char) *p)) {
+        ++p;
+    }
+    if (p == service || !isdigit ((unsigned char) *p)) {
+        return -1;
+    }
+
+    char *endptr = NULL;
+    unsigned long board_id = strtoul (p, &endptr, 10);
+    if ((*endptr != ':' && *endptr != '\0') || board_id > UINT32_MAX) {
+        return -1;
+    }
+
+    return (int64_t) board_id;
+}
+
 char *hutils_concat_strings (const char *str1, const char* str2, char sep)
 {
     return _hutils_concat_strings_raw (str1, str2, NULL, true, sep);
@@ -177,6 +279,24 @@ char *hutils_concat_strings3 (const char *str1, const char* str2,
     return _hutils_concat_strings_raw (str1, str2, str3, true, sep);
 }
 
+int hutils_concat_strings_buf (char *buf, size_t size, const char *str1,
+        const char* str2, char sep)
+{
+    return _hutils_concat_strings_buf_raw (buf, size, str1, str2, NULL, true, sep);
+}
+
+int hutils_concat_strings_no_sep_buf (char *buf, size_t size, const char *str1,
+        const char* str2)
+{
+    return _hutils_concat_strings_buf_raw (buf, size, str1, str2, NULL, false, 0);
+}
+
+int hutils_concat_strings3_buf (char *buf, size_t size, const char *str1,
+        const char* str2, const char* str3, char sep)
+{
+    return _hutils_concat_strings_buf_raw (buf, size, str1, str2, str3, true, sep);
+}
+
 /*******************************************************************/
 /*****************  System Fork/Exec functions *********************/
 /*******************************************************************/
@@ -197,7 +317,8 @@ int hutils_spawn_chld (const char *program, char *const argv[])
         if (err < 0) {
             DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_FATAL, "[hutils:utils] Could not exec child. "
                     "Errno = %d, %s\n", errno, strerror(errno));
-            return -1;
+            /* Do not return to a copy of the caller */
+            _exit (EXIT_FAILURE);
         }
     }
     else { /* Parent */
@@ -248,6 +369,17 @@ int hutils_wait_chld (void)
     return chld_pid;
 }
 
+int hutils_pidfd_open (pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return (int) syscall (SYS_pidfd_open, pid, 0);
+#else
+    (void) pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 int hutils_wait_chld_timed (int timeout)
 {
     int err = 0;
@@ -283,7 +415,9 @@ char *hutils_clone_str (const char *str)
     assert (str);
 
     size_t str_size = strlen (str)+1;
+    uint32_t acct = hutils_mem_acct_push (HUTILS_MEM_ACCT_STR);
     char *new_str = zmalloc (str_size);
+    hutils_mem_acct_pop (acct);
     ASSERT_ALLOC (new_str, err_str_alloc);
 
     int errs = snprintf (new_str, str_size, "%s", str);
@@ -456,6 +590,29 @@ hutils_err_e hutils_get_hints (zconfig_t *root_cfg, zhashx_t *hints_h)
                 goto err_inv_spawn_afe_epics_ioc;
             }
 
+            /* The DBE threads placement is optional */
+            char *cpu_affinity = zconfig_resolve (bpm_cfg, "/dbe/cpu_affinity",
+                    NULL);
+            if (cpu_affinity != NULL && !streq (cpu_affinity, "")) {
+                err = hutils_parse_cpu_list (cpu_affinity, &item->sched.cpu_mask);
+                ASSERT_TEST (err == HUTILS_SUCCESS, "[hutils:utils] Invalid CPU "
+                        "list (cpu_affinity = <value>) in configuration file",
+                        err_cpu_affinity, HUTILS_ERR_CFG);
+            }
+
+            char *sched_fifo_prio = zconfig_resolve (bpm_cfg, "/dbe/sched_fifo_prio",
+                    NULL);
+            if (sched_fifo_prio != NULL && !streq (sched_fifo_prio, "")) {
+                char *endptr = NULL;
+                long fifo_prio = strtol (sched_fifo_prio, &endptr, 10);
+                ASSERT_TEST (*endptr == '\0' && fifo_prio >= 0 &&
+                        fifo_prio <= sched_get_priority_max (SCHED_FIFO),
+                        "[hutils:utils] Invalid SCHED_FIFO priority "
+                        "(sched_fifo_prio = <value>) in configuration file",
+                        err_sched_fifo_prio, HUTILS_ERR_CFG);
+                item->sched.fifo_prio = fifo_prio;
+            }
+
             /* Now, we only need to generate a valid key to insert in the hash.
              * we choose the combination of the type "board%u/bpm%u/afe" or
              * board%u/bpm%u/dbe */
@@ -487,6 +644,8 @@ hutils_err_e hutils_get_hints (zconfig_t *root_cfg, zhashx_t *hints_h)
 
     /* Free only the last item on error. The other ones will be freed by the hash table,
      * on destruction */
+err_sched_fifo_prio:
+err_cpu_affinity:
 err_inv_spawn_afe_epics_ioc:
 err_spawn_afe_epics_ioc:
 err_inv_spawn_dbe_epics_ioc:
@@ -503,3 +662,206 @@ err_cfg_exit:
     return err;
 }
 
+/*******************************************************************/
+/******************* Thread placement functions ********************/
+/*******************************************************************/
+
+hutils_err_e hutils_parse_cpu_list (const char *cpu_list, uint64_t *cpu_mask)
+{
+    assert (cpu_list);
+    assert (cpu_mask);
+
+    hutils_err_e err = HUTILS_SUCCESS;
+    uint64_t mask = 0;
+    const char *p = cpu_list;
+
+    while (*p != '\0') {
+        char *endptr = NULL;
+        unsigned long first = strtoul (p, &endptr, 10);
+        ASSERT_TEST (endptr != p, "Malformed CPU list", err_parse, HUTILS_ERR_CFG);
+        unsigned long last = first;
+
+        p = endptr;
+        if (*p == '-') {
+            ++p;
+            last = strtoul (p, &endptr, 10);
+            ASSERT_TEST (endptr != p, "Malformed CPU range", err_parse,
+                    HUTILS_ERR_CFG);
+            p = endptr;
+        }
+
+        ASSERT_TEST (first <= last && last < HUTILS_SCHED_MAX_CPUS, "CPU "
+                "number out of range", err_parse, HUTILS_ERR_CFG);
+        for (; first <= last; ++first) {
+            mask |= UINT64_C(1) << first;
+        }
+
+        if (*p == ',') {
+            ++p;
+        }
+        else {
+            ASSERT_TEST (*p == '\0', "Malformed CPU list", err_parse,
+                    HUTILS_ERR_CFG);
+        }
+    }
+
+    *cpu_mask = mask;
+
+err_parse:
+    return err;
+}
+
+hutils_err_e hutils_set_thread_sched (const hutils_sched_t *sched,
+        const char *thread_name)
+{
+    assert (sched);
+    assert (thread_name);
+
+    hutils_err_e err = HUTILS_SUCCESS;
+    int rc = 0;
+
+    if (sched->cpu_mask != 0) {
+        cpu_set_t cpus;
+        CPU_ZERO (&cpus);
+
+        unsigned int i;
+        for (i = 0; i < HUTILS_SCHED_MAX_CPUS; ++i) {
+            if (sched->cpu_mask & (UINT64_C(1) << i)) {
+                CPU_SET (i, &cpus);
+            }
+        }
+
+        rc = pthread_setaffinity_np (pthread_self (), sizeof (cpus), &cpus);
+        ASSERT_TEST (rc == 0, "Could not set thread CPU affinity", err_affinity,
+                HUTILS_ERR_SCHED);
+    }
+
+    if (sched->fifo_prio > 0) {
+        struct sched_param param = {.sched_priority = sched->fifo_prio};
+        rc = pthread_setschedparam (pthread_self (), SCHED_FIFO, &param);
+        ASSERT_TEST (rc == 0, "Could not set SCHED_FIFO policy. Is CAP_SYS_NICE "
+                "missing?", err_sched, HUTILS_ERR_SCHED);
+    }
+
+err_sched:
+err_affinity:
+    /* Log where we ended up, even if we could not get what was asked */
+    _hutils_log_thread_sched (thread_name);
+    return err;
+}
+
+hutils_err_e hutils_get_zmq_opts (zconfig_t *root_cfg, const char *path,
+        hutils_zmq_opts_t *opts)
+{
+    assert (root_cfg);
+    assert (path);
+    assert (opts);
+
+    hutils_err_e err = HUTILS_SUCCESS;
+    /* Not an error. The defaults are kept then */
+    zconfig_t *zmq_cfg = zconfig_locate (root_cfg, path);
+    if (zmq_cfg == NULL) {
+        goto err_no_zmq_cfg;
+    }
+
+    const struct {
+        const char *name;
+        int *value;
+    } props [] = {
+        {"/io_threads", &opts->io_threads},
+        {"/sndhwm", &opts->sndhwm},
+        {"/rcvhwm", &opts->rcvhwm},
+        {"/pipehwm", &opts->pipehwm},
+        {"/sndbuf", &opts->sndbuf},
+        {"/rcvbuf", &opts->rcvbuf},
+    };
+
+    size_t i;
+    for (i = 0; i < sizeof (props) / sizeof (props [0]); ++i) {
+        char *value_str = zconfig_resolve (zmq_cfg, props [i].name, NULL);
+        if (value_str == NULL || streq (value_str, "")) {
+            continue;
+        }
+
+        char *endptr = NULL;
+        long value = strtol (value_str, &endptr, 10);
+        ASSERT_TEST (*endptr == '\0' && value >= 0 && value <= INT_MAX,
+                "Invalid ZeroMQ option in configuration file", err_inv_value,
+                HUTILS_ERR_CFG);
+        *props [i].value = (int) value;
+    }
+
+    DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_INFO, "[hutils:utils] ZeroMQ options "
+            "from %s: io_threads = %d, sndhwm = %d, rcvhwm = %d, pipehwm = %d, "
+            "sndbuf = %d, rcvbuf = %d\n", path, opts->io_threads, opts->sndhwm,
+            opts->rcvhwm, opts->pipehwm, opts->sndbuf, opts->rcvbuf);
+
+err_inv_value:
+err_no_zmq_cfg:
+    return err;
+}
+
+void hutils_set_zmq_opts (const hutils_zmq_opts_t *opts)
+{
+    assert (opts);
+
+    if (opts->io_threads > 0) {
+        zsys_set_io_threads (opts->io_threads);
+    }
+    if (opts->sndhwm > 0) {
+        zsys_set_sndhwm (opts->sndhwm);
+    }
+    if (opts->rcvhwm > 0) {
+        zsys_set_rcvhwm (opts->rcvhwm);
+    }
+    if (opts->pipehwm > 0) {
+        zsys_set_pipehwm (opts->pipehwm);
+    }
+
+    __atomic_store_n (&hutils_sndbuf, opts->sndbuf, __ATOMIC_RELAXED);
+    __atomic_store_n (&hutils_rcvbuf, opts->rcvbuf, __ATOMIC_RELAXED);
+}
+
+void hutils_set_sock_bufs (zsock_t *sock)
+{
+    assert (sock);
+
+    int sndbuf = __atomic_load_n (&hutils_sndbuf, __ATOMIC_RELAXED);
+    int rcvbuf = __atomic_load_n (&hutils_rcvbuf, __ATOMIC_RELAXED);
+
+    if (sndbuf > 0) {
+        zsock_set_sndbuf (sock, sndbuf);
+    }
+    if (rcvbuf > 0) {
+        zsock_set_rcvbuf (sock, rcvbuf);
+    }
+}
+
+static void _hutils_log_thread_sched (const char *thread_name)
+{
+    char cpu_list [HUTILS_SCHED_LOG_LEN] = "?";
+    cpu_set_t cpus;
+
+    if (pthread_getaffinity_np (pthread_self (), sizeof (cpus), &cpus) == 0) {
+        size_t len = 0;
+        unsigned int i;
+
+        cpu_list [0] = '\0';
+        for (i = 0; i < CPU_SETSIZE && len < sizeof (cpu_list); ++i) {
+            if (CPU_ISSET (i, &cpus)) {
+                len += snprintf (cpu_list + len, sizeof (cpu_list) - len,
+                        (len == 0) ? "%u" : ",%u", i);
+            }
+        }
+    }
+
+    int policy = SCHED_OTHER;
+    struct sched_param param = {.sched_priority = 0};
+    pthread_getschedparam (pthread_self (), &policy, &param);
+
+    DBE_DEBUG (DBG_HAL_UTILS | DBG_LVL_INFO, "[hutils:utils] Thread %s placed "
+            "on CPUs %s, policy %s, priority %d\n", thread_name, cpu_list,
+            (policy == SCHED_FIFO) ? "SCHED_FIFO" :
+            (policy == SCHED_RR) ? "SCHED_RR" : "SCHED_OTHER",
+            param.sched_priority);
+}
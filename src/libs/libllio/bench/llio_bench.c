@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Micro-benchmark of the LLIO backends, to qualify crate CPUs, PCIe
+ * switches and driver changes. For each memory region of the device it
+ * measures the latency of single 32-bit accesses and the throughput of
+ * block reads (PIO and DMA) across block sizes, both page aligned and
+ * straddling a page boundary, so the page switching of the PCIe backend is
+ * exercised. Only the SDRAM (BAR2) is written to, so run it while no
+ * acquisition is in progress. Wishbone (BAR4) is only read */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "ll_io.h"
+#include "hw/pcie_regs.h"
+
+#define DFLT_NUM_ITERS              10000
+#define DFLT_MAX_BLOCK_SIZE         (1 << 20)   /* in bytes */
+#define MIN_BLOCK_SIZE              4           /* in bytes */
+/* Block reads of each size add up to at least this much */
+#define BLOCK_BYTES_PER_SIZE        (16 << 20)  /* in bytes */
+#define MAX_NUM_REGIONS             2
+
+/* Memory region of the device */
+typedef struct {
+    const char *name;
+    uint64_t base;                  /* Address of the region, BAR included */
+    uint64_t pg_size;               /* Page size, 0 for an unpaged region */
+    int writable;                   /* Safe to write to */
+} bench_region_t;
+
+static int64_t _bench_nsecs (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* One row per test. "max_ns" is the slowest single access, or -1 when the
+ * accesses are not timed one by one */
+static void _bench_print (const char *op, const bench_region_t *region,
+        const char *place, size_t size, uint32_t num_iters, int64_t total_ns,
+        int64_t max_ns, int csv)
+{
+    double ns_op = (double) total_ns / num_iters;
+    double mb_s = (double) size * 1000.0 / ns_op;
+
+    if (csv) {
+        fprintf (stdout, "llio,%s,%s,%s,%zu,%u,%.1f,%"PRId64",%.1f\n", op,
+                region->name, place, size, num_iters, ns_op, max_ns, mb_s);
+    }
+    else {
+        fprintf (stdout, "%-10s %-6s %-8s %8zu %8u %12.1f %10"PRId64" %10.1f\n",
+                op, region->name, place, size, num_iters, ns_op, max_ns, mb_s);
+    }
+}
+
+/* Latency of single 32-bit accesses */
+static int _bench_lat (llio_t *llio, const bench_region_t *region,
+        uint32_t num_iters, int csv)
+{
+    uint32_t data = 0;
+    int64_t total_ns = 0, max_ns = 0;
+
+    for (uint32_t i = 0; i < num_iters; ++i) {
+        int64_t start = _bench_nsecs ();
+        ssize_t ret = llio_read_32 (llio, region->base, &data);
+        int64_t elapsed = _bench_nsecs () - start;
+        if (ret < 0) {
+            fprintf (stderr, "[llio_bench] Could not read from %s\n", region->name);
+            return -1;
+        }
+        total_ns += elapsed;
+        max_ns = (elapsed > max_ns) ? elapsed : max_ns;
+    }
+    _bench_print ("read_32", region, "-", sizeof (data), num_iters, total_ns,
+            max_ns, csv);
+
+    if (!region->writable) {
+        return 0;
+    }
+
+    total_ns = max_ns = 0;
+    for (uint32_t i = 0; i < num_iters; ++i) {
+        int64_t start = _bench_nsecs ();
+        ssize_t ret = llio_write_32 (llio, region->base, &i);
+        int64_t elapsed = _bench_nsecs () - start;
+        if (ret < 0) {
+            fprintf (stderr, "[llio_bench] Could not write to %s\n", region->name);
+            return -1;
+        }
+        total_ns += elapsed;
+        max_ns = (elapsed > max_ns) ? elapsed : max_ns;
+    }
+    _bench_print ("write_32", region, "-", sizeof (data), num_iters, total_ns,
+            max_ns, csv);
+
+    return 0;
+}
+
+/* Throughput of "size" bytes block reads at "offs" of the region, with
+ * "read_fp" being either llio_read_block or llio_read_dma. Returns 1 if the
+ * backend does not support it */
+static int _bench_bw (llio_t *llio, const bench_region_t *region,
+        ssize_t (*read_fp) (llio_t *, uint64_t, size_t, uint32_t *),
+        const char *op, const char *place, uint64_t offs, size_t size,
+        uint32_t *buf, int csv)
+{
+    uint32_t num_iters = BLOCK_BYTES_PER_SIZE / size;
+    num_iters = (num_iters == 0) ? 1 : num_iters;
+
+    int64_t start = _bench_nsecs ();
+    for (uint32_t i = 0; i < num_iters; ++i) {
+        ssize_t ret = read_fp (llio, region->base + offs, size, buf);
+        if (ret < 0) {
+            return 1;
+        }
+    }
+    int64_t total_ns = _bench_nsecs () - start;
+
+    _bench_print (op, region, place, size, num_iters, total_ns, -1, csv);
+    return 0;
+}
+
+static int _bench_region (llio_t *llio, const bench_region_t *region,
+        uint32_t num_iters, size_t max_block_size, uint32_t *buf, int csv)
+{
+    int err = _bench_lat (llio, region, num_iters, csv);
+    if (err != 0) {
+        return err;
+    }
+
+    int dma = region->writable;
+    for (size_t size = MIN_BLOCK_SIZE; size <= max_block_size; size <<= 1) {
+        err = _bench_bw (llio, region, llio_read_block, "read_block",
+                "aligned", 0, size, buf, csv);
+        if (err != 0) {
+            fprintf (stderr, "[llio_bench] Could not read blocks from %s\n",
+                    region->name);
+            return -1;
+        }
+
+        /* Half of the block on each side of the first page boundary, so
+         * every read switches pages */
+        if (region->pg_size != 0 && size > MIN_BLOCK_SIZE &&
+                size <= region->pg_size) {
+            _bench_bw (llio, region, llio_read_block, "read_block",
+                    "straddle", region->pg_size - size/2, size, buf, csv);
+        }
+
+        /* DMA is only done from the SDRAM. Stop trying once the backend
+         * tells it can't */
+        if (dma && _bench_bw (llio, region, llio_read_dma, "read_dma",
+                    "aligned", 0, size, buf, csv) != 0) {
+            fprintf (stderr, "[llio_bench] No DMA on %s. Skipping it\n",
+                    region->name);
+            dma = 0;
+        }
+    }
+
+    return 0;
+}
+
+/* Usage: llio_bench [-x] <pcie | vfio | eth | ebone | sim> <endpoint> [num_iters]
+ * [max_block_size]. -x selects machine-readable (CSV) output */
+int main (int argc, char *argv [])
+{
+    int csv = 0;
+    if (argc > 1 && strcmp (argv [1], "-x") == 0) {
+        csv = 1;
+        --argc;
+        ++argv;
+    }
+
+    if (argc < 3) {
+        fprintf (stderr, "Usage: llio_bench [-x] <pcie | vfio | eth | ebone | sim> "
+                "<endpoint> [num_iters] [max_block_size]\n");
+        return 1;
+    }
+
+    llio_type_e type = llio_str_to_type (argv [1]);
+    uint32_t num_iters = (argc > 3) ? strtoul (argv [3], NULL, 10) : DFLT_NUM_ITERS;
+    size_t max_block_size = (argc > 4) ? strtoul (argv [4], NULL, 10) :
+        DFLT_MAX_BLOCK_SIZE;
+
+    if (type == INVALID_DEV || num_iters == 0 || max_block_size < MIN_BLOCK_SIZE) {
+        fprintf (stderr, "[llio_bench] Invalid device type, number of "
+                "iterations or block size\n");
+        return 1;
+    }
+
+    /* Suppress all log messages, so we measure only the access path */
+    errhand_set_log (NULL, "w");
+
+    /* Ethernet reaches the Wishbone bus only, with no BARs. Etherbone takes
+     * the PCIe offsets, but has the SDRAM only if the board maps it */
+    bench_region_t regions [MAX_NUM_REGIONS];
+    unsigned int num_regions = 0;
+    if (type == PCIE_DEV || type == VFIO_DEV || type == SIM_DEV) {
+        regions [num_regions++] = (bench_region_t) {"sdram", BAR2_ADDR,
+            PCIE_SDRAM_PG_SIZE, 1};
+        regions [num_regions++] = (bench_region_t) {"wb", BAR4_ADDR,
+            PCIE_WB_PG_SIZE, 0};
+    }
+    else if (type == EBONE_DEV) {
+        if (getenv (LLIO_EBONE_ENV_SDRAM_BASE) != NULL) {
+            regions [num_regions++] = (bench_region_t) {"sdram", BAR2_ADDR,
+                0, 1};
+        }
+        regions [num_regions++] = (bench_region_t) {"wb", BAR4_ADDR, 0, 0};
+    }
+    else {
+        regions [num_regions++] = (bench_region_t) {"wb", 0, 0, 0};
+    }
+
+    int err = 1;
+    llio_t *llio = llio_new ("llio_bench", argv [2], type, 0);
+    if (llio == NULL) {
+        fprintf (stderr, "[llio_bench] Could not create LLIO\n");
+        goto err_llio_alloc;
+    }
+
+    if (llio_open (llio, NULL) != 0) {
+        fprintf (stderr, "[llio_bench] Could not open %s\n", argv [2]);
+        goto err_llio_open;
+    }
+
+    uint32_t *buf = zmalloc (max_block_size);
+    if (buf == NULL) {
+        goto err_buf_alloc;
+    }
+
+    if (csv) {
+        fprintf (stdout, "bench,op,region,place,size,iters,ns_op,max_ns,mb_s\n");
+    }
+    else {
+        fprintf (stdout, "%-10s %-6s %-8s %8s %8s %12s %10s %10s\n", "op",
+                "region", "place", "size", "iters", "ns/op", "max ns", "MB/s");
+    }
+
+    err = 0;
+    for (unsigned int i = 0; i < num_regions && err == 0; ++i) {
+        err = _bench_region (llio, &regions [i], num_iters, max_block_size,
+                buf, csv);
+    }
+
+    free (buf);
+err_buf_alloc:
+    llio_release (llio, NULL);
+err_llio_open:
+    llio_destroy (&llio);
+err_llio_alloc:
+    return (err != 0) ? 1 : 0;
+}
@@ -77,6 +77,17 @@
 #define PCIE_CFG_REG_DMA_DS_CTRL            (27 << WB_DWORD_ACC)
 #define PCIE_CFG_REG_DMA_DS_STA             (28 << WB_DWORD_ACC)
 
+/* DMA channel control bits. Same for Upstream and Downstream channels */
+#define PCIE_CFG_DMA_CTRL_AINC              (0x1 << 15) /* Peripheral address increment */
+#define PCIE_CFG_DMA_CTRL_UPA               (0x1 << 20) /* Use 64-bit peripheral address */
+#define PCIE_CFG_DMA_CTRL_LAST              (0x1 << 24) /* Last descriptor of the chain */
+#define PCIE_CFG_DMA_CTRL_VALID             (0x1 << 25) /* Descriptor valid. Starts the transfer */
+#define PCIE_CFG_DMA_CTRL_CHANNEL_RST       0x0A
+
+/* DMA channel status bits. Same for Upstream and Downstream channels */
+#define PCIE_CFG_DMA_STA_DONE               (0x1 << 0)
+#define PCIE_CFG_DMA_STA_BUSY               (0x1 << 1)
+
 /* Address for MRd channel control */
 #define PCIE_CFG_REG_MRD_CTRL               (29 << WB_DWORD_ACC)
 /* Address for Tx module control */
@@ -177,6 +188,21 @@
 #define BAR2_RW(barp, addr, datap, rw)                              \
     BAR_RW_8(barp, addr, datap, rw)
 
+/* Single 64-bit access, so the host issues one 8-byte TLP. "addr" must be
+ * 8-byte aligned */
+#define BAR_RW_8_64(barp, addr, datap, rw)                          \
+    do {                                                            \
+        (rw) ?                                                      \
+        (*(datap) = *(volatile uint64_t *)(((uint8_t *)barp) + (addr))) : \
+        (*(volatile uint64_t *)(((uint8_t *)barp) + (addr)) = *(datap)); \
+    } while (0)
+
+#define BAR0_RW_64(barp, addr, datap, rw)                           \
+    BAR_RW_8_64(barp, addr, datap, rw)
+
+#define BAR2_RW_64(barp, addr, datap, rw)                           \
+    BAR_RW_8_64(barp, addr, datap, rw)
+
 /* BAR4 is BYTE addresses for the user */
 /* On PCIe Core FPGA firmware the wishbone address is provided with
  * only 29 bits, with the LSB zeroed:
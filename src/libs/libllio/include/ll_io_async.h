@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _LL_IO_ASYNC_H_
+#define _LL_IO_ASYNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Block transfers are done by the worker in chunks of this size. The device
+ * is locked only for one chunk at a time, so synchronous register accesses
+ * are served in between the chunks of a long transfer. Pending transfers
+ * are done a chunk at a time each, in turns */
+#define LLIO_ASYNC_CHUNK_SIZE       (64*1024)   /* in bytes */
+
+/* Completion callback. "ret" is what the synchronous function would have
+ * returned. It is called from llio_process_completions () */
+typedef void (*llio_async_cb_fp) (llio_t *self, ssize_t ret, void *arg);
+
+/* Block transfer function pointer. Same as read_block_fp */
+typedef ssize_t (*llio_async_xfer_fp) (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data);
+
+/************************************************************/
+/************************* Our methods **********************/
+/************************************************************/
+
+/* Creates a new asynchronous engine for "llio", with its own worker thread */
+llio_async_t *llio_async_new (llio_t *llio);
+/* Destroy an asynchronous engine. Pending requests are completed first */
+llio_err_e llio_async_destroy (llio_async_t **self_p);
+
+/* Queue a block transfer. "xfer" is called from the worker thread, chunk by
+ * chunk, with the device lock held */
+llio_err_e llio_async_submit (llio_async_t *self, llio_async_xfer_fp xfer,
+        uint64_t offs, size_t size, uint32_t *data, llio_async_cb_fp cb, void *arg);
+/* Wait for all pending requests and run their callbacks */
+llio_err_e llio_async_flush (llio_async_t *self);
+/* Get the fd that becomes readable when there are completions */
+int llio_async_get_fd (llio_async_t *self);
+/* Run the callbacks of all the finished requests. Returns the number
+ * of callbacks run */
+int llio_async_process (llio_async_t *self);
+
+/* Serialize the device accesses with the worker thread */
+void llio_async_lock (llio_async_t *self);
+void llio_async_unlock (llio_async_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -49,17 +49,24 @@ typedef struct _llio_dev_info_t llio_dev_info_t;
 typedef struct _llio_endpoint_t llio_endpoint_t;
 /* Opaque llio_t structure */
 typedef struct _llio_t llio_t;
+/* Opaque llio_async_t structure */
+typedef struct _llio_async_t llio_async_t;
 
 /* LL_IO */
 #include "ll_io_err.h"
 #include "ll_io_utils.h"
 #include "ll_io_dev_info.h"
 #include "ll_io_endpoint.h"
+#include "ll_io_async.h"
 #include "ll_io_core.h"
 
 /* LL_IO operations */
+#include "ll_io_pcie_utils.h"
 #include "ll_io_pcie.h"
 #include "ll_io_eth_utils.h"
 #include "ll_io_eth.h"
+#include "ll_io_sim.h"
+#include "ll_io_vfio.h"
+#include "ll_io_ebone.h"
 
 #endif
@@ -12,6 +12,16 @@
 extern "C" {
 #endif
 
+/* Maximum number of extents of a vectored block access */
+#define LLIO_IOV_MAX                        64
+
+/* Extent of a vectored block access */
+typedef struct {
+    uint64_t offs;                  /* Device offset */
+    size_t size;                    /* Size in bytes */
+    uint32_t *data;                 /* Data read or to be written */
+} llio_iov_t;
+
 /* Open device function pointer */
 typedef int (*open_fp)(llio_t *self, llio_endpoint_t *endpoint);
 /* Release device function pointer */
@@ -32,6 +42,12 @@ typedef ssize_t (*write_block_fp)(llio_t *self, uint64_t offs, size_t size, uint
 typedef ssize_t (*read_dma_fp)(llio_t *self, uint64_t offs, size_t size, uint32_t *data);
 /* Write data block via DMA from device function pointer, size in bytes */
 typedef ssize_t (*write_dma_fp)(llio_t *self, uint64_t offs, size_t size, uint32_t *data);
+/* Read "iovcnt" data blocks from device function pointer, in a single transfer
+ * if the device can */
+typedef ssize_t (*read_blockv_fp)(llio_t *self, const llio_iov_t *iov, size_t iovcnt);
+/* Write "iovcnt" data blocks to device function pointer, in a single transfer
+ * if the device can */
+typedef ssize_t (*write_blockv_fp)(llio_t *self, const llio_iov_t *iov, size_t iovcnt);
 /* Read device information function pointer */
 /* typedef int (*read_info_fp)(struct _llio_t *self, struct _llio_dev_info_t *dev_info); moved to dev_io */
 
@@ -52,6 +68,13 @@ typedef struct {
                                        parameter size in bytes */
     write_dma_fp write_dma;         /* Write arbitrary block size data via DMA,
                                        parameter size in bytes */
+    read_blockv_fp read_blockv;     /* Read scattered blocks. Emulated with
+                                       read_block if NULL */
+    write_blockv_fp write_blockv;   /* Write scattered blocks. Emulated with
+                                       write_block if NULL */
+    bool mt_safe;                   /* Single register accesses can be made
+                                       from any thread, concurrently with the
+                                       other operations, see llio_get_mt_safe () */
     /*read_info_fp read_info; Moved to dev_io */         /* Read device information data */
 } llio_ops_t;
 
@@ -82,6 +105,10 @@ char *llio_clone_endpoint_name (llio_t *self);
 llio_err_e llio_set_dev_handler (llio_t *self, void *dev_handler);
 /* Get dev handler */
 void *llio_get_dev_handler (llio_t *self);
+/* Check if single register accesses (llio_read/write_<16|32|64>) can be made
+ * from any thread, concurrently with the other operations. Otherwise, all of
+ * the accesses must come from the same thread */
+bool llio_get_mt_safe (llio_t *self);
 
 /************************************************************/
 /**************** Low Level generic methods API *************/
@@ -107,9 +134,48 @@ ssize_t llio_write_block (llio_t *self, uint64_t offs, size_t size, uint32_t *da
 ssize_t llio_read_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data);
 /* Write data block via DMA from device, size in bytes */
 ssize_t llio_write_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data);
+/* Read "iovcnt" (up to LLIO_IOV_MAX) data blocks from device, e.g., the two
+ * extents of a curve that wraps around its memory region, in a single
+ * transfer if the device can. Returns the total number of bytes read */
+ssize_t llio_read_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt);
+/* Write "iovcnt" (up to LLIO_IOV_MAX) data blocks to device, in a single
+ * transfer if the device can. Returns the total number of bytes written */
+ssize_t llio_write_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt);
 /* Read device information */
 /* int llio_read_info (llio_t *self, llio_dev_info_t *dev_info); Moved to dev_io */
 
+/************************************************************/
+/*************** Asynchronous generic methods API ***********/
+/************************************************************/
+
+/* Start the asynchronous engine worker thread. From now on, synchronous
+ * accesses are serialized with the worker */
+llio_err_e llio_enable_async (llio_t *self);
+/* Complete all pending requests and stop the worker thread */
+llio_err_e llio_disable_async (llio_t *self);
+/* Wait for all pending requests and run their callbacks */
+llio_err_e llio_flush_async (llio_t *self);
+/* Check if the asynchronous engine is enabled */
+bool llio_get_async_enabled (llio_t *self);
+/* Get the fd that becomes readable when there are completions, to be polled
+ * by the caller. -1 if the asynchronous engine is not enabled */
+int llio_get_completion_fd (llio_t *self);
+/* Run the callbacks of the finished requests, in the caller thread */
+int llio_process_completions (llio_t *self);
+/* Read data block from device, size in bytes. "data" must be valid until
+ * "cb" is called */
+llio_err_e llio_read_block_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg);
+/* Write data block to device, size in bytes */
+llio_err_e llio_write_block_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg);
+/* Read data block via DMA from device, size in bytes */
+llio_err_e llio_read_dma_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg);
+/* Write data block via DMA to device, size in bytes */
+llio_err_e llio_write_dma_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
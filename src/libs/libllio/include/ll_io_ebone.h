@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _LL_IO_EBONE_H_
+#define _LL_IO_EBONE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Etherbone (Wishbone over UDP) device. The endpoint looks like
+ * udp://10.0.0.0:60368, 60368 being the usual Etherbone port. Register
+ * accesses are batched into datagrams, each one answered by the board, and
+ * are retransmitted when the answer does not come in time. Block reads keep
+ * a window of datagrams in flight.
+ *
+ * Offsets are the same as for the PCIe device: BAR4 selects the Wishbone
+ * bus, so the SMIOs work unchanged. BAR2 (SDRAM) is only reachable if the
+ * board maps it into the Wishbone bus, see LLIO_EBONE_ENV_SDRAM_BASE */
+
+/* Environment variables used to tune the etherbone device. They are read
+ * when the device is opened */
+
+/* Largest datagram payload, in bytes. 8972 fits a jumbo frame of 9000 bytes */
+#define LLIO_EBONE_ENV_MTU                  "LLIO_EBONE_MTU"
+/* Number of datagrams of a block read in flight at once */
+#define LLIO_EBONE_ENV_WINDOW               "LLIO_EBONE_WINDOW"
+/* Time to wait for the answer of a datagram before sending it again, in
+ * milliseconds */
+#define LLIO_EBONE_ENV_TIMEOUT              "LLIO_EBONE_TIMEOUT_MS"
+/* Number of times a datagram is sent again before the access fails */
+#define LLIO_EBONE_ENV_RETRIES              "LLIO_EBONE_RETRIES"
+/* Wishbone address the board maps its SDRAM at. Unset makes BAR2 accesses
+ * fail */
+#define LLIO_EBONE_ENV_SDRAM_BASE           "LLIO_EBONE_SDRAM_BASE"
+/* LLIO_ETH_ENV_RCVBUF also applies. Unset, the receive buffer is made to
+ * fit the answers to two windows */
+
+#define LLIO_EBONE_MTU_DFLT                 1472    /* in bytes */
+#define LLIO_EBONE_MTU_MAX                  8972    /* in bytes */
+#define LLIO_EBONE_WINDOW_DFLT              16
+#define LLIO_EBONE_WINDOW_MAX               64
+#define LLIO_EBONE_TIMEOUT_DFLT             20      /* in msec */
+#define LLIO_EBONE_RETRIES_DFLT             5
+
+/* For use by llio_t general structure */
+extern const llio_ops_t llio_ops_ebone;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -12,6 +12,19 @@
 extern "C" {
 #endif
 
+/* Environment variables used to tune the ethernet device sockets. They are
+ * read when the device is opened */
+
+/* Socket send buffer size, in bytes. Unset keeps the system default */
+#define LLIO_ETH_ENV_SNDBUF                 "LLIO_ETH_SNDBUF"
+/* Socket receive buffer size, in bytes. Unset keeps the system default */
+#define LLIO_ETH_ENV_RCVBUF                 "LLIO_ETH_RCVBUF"
+/* Receive timeout of UDP sockets, in milliseconds. A lost datagram fails
+ * the read after this instead of blocking it forever. 0 means no timeout */
+#define LLIO_ETH_ENV_UDP_TIMEOUT            "LLIO_ETH_UDP_TIMEOUT_MS"
+
+#define LLIO_ETH_UDP_TIMEOUT_DFLT           100     /* in msec */
+
 /* For use by llio_t general structure */
 extern const llio_ops_t llio_ops_eth;
 
@@ -21,6 +21,21 @@ extern "C" {
 /* For use by llio_t general structure */
 extern const llio_ops_t llio_ops_pcie;
 
+/* PCIe core timeout counters, for monitoring the link health. Block reads
+ * are checked for timeouts in chunks, and only the chunks that timed out
+ * are read again */
+typedef struct {
+    uint64_t chunks;                /* Chunks read */
+    uint64_t timeouts;              /* Chunk reads that timed out */
+    uint64_t recovered;             /* Chunks read correctly after a timeout */
+    uint64_t failures;              /* Chunks still timing out after all
+                                       the tries */
+} llio_pcie_timeout_stats_t;
+
+/* Get the timeout counters of an opened PCIe device */
+llio_err_e llio_pcie_get_timeout_stats (llio_t *self,
+        llio_pcie_timeout_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _LL_IO_PCIE_UTILS_H_
+#define _LL_IO_PCIE_UTILS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Environment variable to force a copy kernel by name, instead of the best
+ * one for this CPU. Useful for benchmarking */
+#define LLIO_PCIE_ENV_COPY          "LLIO_PCIE_COPY"
+
+/* Copy "size" bytes between host memory and a BAR mapping. Only whole
+ * 32-bit words are copied, as with the BAR_RW_BLOCK macros */
+typedef void (*llio_pcie_copy_fp) (void *dst, const void *src, size_t size);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    llio_pcie_copy_fp from_bar;     /* BAR to host memory */
+    llio_pcie_copy_fp to_bar;       /* Host memory to BAR */
+} llio_pcie_copy_ops_t;
+
+/************** Utility functions ****************/
+
+/* Get the fastest copy kernel the CPU supports */
+const llio_pcie_copy_ops_t *llio_pcie_copy_get_ops (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
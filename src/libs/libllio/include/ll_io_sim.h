@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _LL_IO_SIM_H_
+#define _LL_IO_SIM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Environment variables used to configure the simulated device. They are
+ * read when the device is opened */
+
+/* Artificial latency of every access, in nanoseconds */
+#define LLIO_SIM_ENV_LATENCY                "LLIO_SIM_LATENCY_NS"
+/* Artificial bandwidth of block and DMA transfers, in MB/s. 0 means
+ * unlimited */
+#define LLIO_SIM_ENV_BANDWIDTH              "LLIO_SIM_BW_MBPS"
+/* Size of the simulated FPGA SDRAM, in bytes */
+#define LLIO_SIM_ENV_SDRAM_SIZE             "LLIO_SIM_SDRAM_SIZE"
+/* Time an ACQ core takes to complete an acquisition, in microseconds */
+#define LLIO_SIM_ENV_ACQ_TIME               "LLIO_SIM_ACQ_TIME_US"
+/* __WR_SHIFT_FIX__ the SMIOs were compiled with. It determines the
+ * simulated registers addresses */
+#define LLIO_SIM_ENV_WR_SHIFT               "LLIO_SIM_WR_SHIFT"
+
+/* For use by llio_t general structure */
+extern const llio_ops_t llio_ops_sim;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
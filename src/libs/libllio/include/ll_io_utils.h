@@ -17,6 +17,9 @@ enum _llio_type_e {
     GENERIC_DEV = 0,
     PCIE_DEV = 1,
     ETH_DEV,
+    SIM_DEV,
+    VFIO_DEV,
+    EBONE_DEV,
     INVALID_DEV,
     /* Give this enum the ability to represent CONVC_TYPE_END */
     END_DEV = CONVC_TYPE_END
@@ -27,6 +30,9 @@ typedef enum _llio_type_e llio_type_e;
 #define GENERIC_DEV_STR             "generic"
 #define PCIE_DEV_STR                "pcie"
 #define ETH_DEV_STR                 "eth"
+#define SIM_DEV_STR                 "sim"
+#define VFIO_DEV_STR                "vfio"
+#define EBONE_DEV_STR               "ebone"
 #define INVALID_DEV_STR             "invalid"
 
 /************** Utility functions ****************/
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _LL_IO_VFIO_H_
+#define _LL_IO_VFIO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The "vfio" device type drives the same FPGA PCIe core as "pcie", but
+ * through VFIO instead of the pciDriver kernel module. The endpoint is the
+ * PCI address of the board, e.g. "0000:01:00.0", which must be bound to
+ * vfio-pci. It is implemented along with llio_ops_pcie, sharing its data
+ * paths */
+extern const llio_ops_t llio_ops_vfio;
+
+/* VFIO device handle. Opens the IOMMU group of a PCI device in a
+ * container of its own */
+typedef struct _llio_vfio_t llio_vfio_t;
+
+/************** Utility functions ****************/
+
+/* Open the PCI device "pci_addr", e.g. "0000:01:00.0". Returns NULL in
+ * case of error */
+llio_vfio_t *llio_vfio_new (const char *pci_addr);
+/* Close the device. BARs still mapped are unmapped, DMA mappings are gone
+ * with the container and the MSI eventfd is closed */
+void llio_vfio_destroy (llio_vfio_t **self_p);
+
+/* Map BAR "bar_no" into our address space, setting its size in "size".
+ * Returns NULL in case of error */
+void *llio_vfio_map_bar (llio_vfio_t *self, uint32_t bar_no, uint32_t *size);
+/* Map "size" bytes at "vaddr" for device DMA, at bus address "iova". Both
+ * must be page aligned. The pages are pinned until unmapped. Returns 0 in
+ * case of success and -1 in case of error */
+int llio_vfio_dma_map (llio_vfio_t *self, void *vaddr, size_t size, uint64_t iova);
+/* Unmap the DMA mapping of "size" bytes at "iova" */
+int llio_vfio_dma_unmap (llio_vfio_t *self, size_t size, uint64_t iova);
+/* eventfd signalled on each MSI of the device. -1 if MSI could not be
+ * set up */
+int llio_vfio_get_irq_fd (llio_vfio_t *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "ll_io.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LL_IO, "[ll_io:async]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LL_IO, "[ll_io:async]",           \
+            llio_err_str(LLIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LL_IO, "[ll_io:async]",              \
+            llio_err_str (err_type))
+
+typedef struct _llio_async_req_t llio_async_req_t;
+
+struct _llio_async_req_t {
+    llio_async_xfer_fp xfer;            /* Transfer function */
+    uint64_t offs;                      /* Device offset */
+    size_t size;                        /* Transfer size in bytes */
+    uint32_t *data;                     /* Caller buffer */
+    llio_async_cb_fp cb;                /* Completion callback */
+    void *arg;                          /* Completion callback argument */
+    size_t done;                        /* Bytes transferred so far */
+    ssize_t ret;                        /* Transfer result */
+    llio_async_req_t *next;             /* Next request in the same list */
+};
+
+/* Simple FIFO of requests */
+typedef struct {
+    llio_async_req_t *head;
+    llio_async_req_t *tail;
+} llio_async_list_t;
+
+struct _llio_async_t {
+    llio_t *llio;                       /* Device we do the transfers on */
+    pthread_t worker;                   /* Transfer thread */
+    pthread_mutex_t dev_lock;           /* Serializes the device accesses */
+    pthread_mutex_t lock;               /* Protects everything below */
+    pthread_cond_t req_cond;            /* Signaled on new requests */
+    pthread_cond_t idle_cond;           /* Signaled when nothing is pending */
+    llio_async_list_t reqs;             /* Requests waiting for the worker */
+    llio_async_list_t done;             /* Requests waiting for their callback */
+    unsigned int pending;               /* Requests not completed yet */
+    bool stop;                          /* Worker must exit */
+    int fd;                             /* Completion doorbell */
+};
+
+static void *_llio_async_worker (void *args);
+static bool _llio_async_exec_chunk (llio_async_t *self, llio_async_req_t *req);
+static void _llio_async_list_push (llio_async_list_t *list, llio_async_req_t *req);
+static llio_async_req_t *_llio_async_list_pop (llio_async_list_t *list);
+
+/* Creates a new asynchronous engine for "llio", with its own worker thread */
+llio_async_t *llio_async_new (llio_t *llio)
+{
+    assert (llio);
+
+    llio_async_t *self = (llio_async_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->llio = llio;
+    self->fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ASSERT_TEST(self->fd != -1, "Could not create completion doorbell",
+            err_fd);
+
+    pthread_mutex_init (&self->dev_lock, NULL);
+    pthread_mutex_init (&self->lock, NULL);
+    pthread_cond_init (&self->req_cond, NULL);
+    pthread_cond_init (&self->idle_cond, NULL);
+
+    int err = pthread_create (&self->worker, NULL, _llio_async_worker, self);
+    ASSERT_TEST(err == 0, "Could not create worker thread", err_worker);
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io:async] Created asynchronous "
+            "engine\n");
+    return self;
+
+err_worker:
+    pthread_cond_destroy (&self->idle_cond);
+    pthread_cond_destroy (&self->req_cond);
+    pthread_mutex_destroy (&self->lock);
+    pthread_mutex_destroy (&self->dev_lock);
+    close (self->fd);
+err_fd:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy an asynchronous engine. Pending requests are completed first */
+llio_err_e llio_async_destroy (llio_async_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        llio_async_t *self = *self_p;
+
+        llio_async_flush (self);
+
+        pthread_mutex_lock (&self->lock);
+        self->stop = true;
+        pthread_cond_signal (&self->req_cond);
+        pthread_mutex_unlock (&self->lock);
+        pthread_join (self->worker, NULL);
+
+        pthread_cond_destroy (&self->idle_cond);
+        pthread_cond_destroy (&self->req_cond);
+        pthread_mutex_destroy (&self->lock);
+        pthread_mutex_destroy (&self->dev_lock);
+        close (self->fd);
+
+        free (self);
+        *self_p = NULL;
+    }
+
+    return LLIO_SUCCESS;
+}
+
+llio_err_e llio_async_submit (llio_async_t *self, llio_async_xfer_fp xfer,
+        uint64_t offs, size_t size, uint32_t *data, llio_async_cb_fp cb, void *arg)
+{
+    assert (self);
+    assert (xfer);
+    assert (cb);
+
+    llio_err_e err = LLIO_SUCCESS;
+    llio_async_req_t *req = (llio_async_req_t *) zmalloc (sizeof *req);
+    ASSERT_ALLOC(req, err_req_alloc, LLIO_ERR_ALLOC);
+
+    req->xfer = xfer;
+    req->offs = offs;
+    req->size = size;
+    req->data = data;
+    req->cb = cb;
+    req->arg = arg;
+    req->ret = -1;
+
+    pthread_mutex_lock (&self->lock);
+    _llio_async_list_push (&self->reqs, req);
+    self->pending++;
+    pthread_cond_signal (&self->req_cond);
+    pthread_mutex_unlock (&self->lock);
+
+err_req_alloc:
+    return err;
+}
+
+llio_err_e llio_async_flush (llio_async_t *self)
+{
+    assert (self);
+
+    pthread_mutex_lock (&self->lock);
+    while (self->pending > 0) {
+        pthread_cond_wait (&self->idle_cond, &self->lock);
+    }
+    pthread_mutex_unlock (&self->lock);
+
+    llio_async_process (self);
+    return LLIO_SUCCESS;
+}
+
+int llio_async_get_fd (llio_async_t *self)
+{
+    assert (self);
+    return self->fd;
+}
+
+int llio_async_process (llio_async_t *self)
+{
+    assert (self);
+
+    /* Reset the doorbell before looking at the list, so a completion
+     * arriving after we took the list rings it again */
+    uint64_t count;
+    ssize_t rc = read (self->fd, &count, sizeof (count));
+    (void) rc;
+
+    pthread_mutex_lock (&self->lock);
+    llio_async_req_t *req = self->done.head;
+    self->done.head = self->done.tail = NULL;
+    pthread_mutex_unlock (&self->lock);
+
+    int num = 0;
+    while (req != NULL) {
+        llio_async_req_t *next = req->next;
+        req->cb (self->llio, req->ret, req->arg);
+        free (req);
+        req = next;
+        num++;
+    }
+
+    return num;
+}
+
+void llio_async_lock (llio_async_t *self)
+{
+    pthread_mutex_lock (&self->dev_lock);
+}
+
+void llio_async_unlock (llio_async_t *self)
+{
+    pthread_mutex_unlock (&self->dev_lock);
+}
+
+/**************** Helper Functions ***************/
+
+static void *_llio_async_worker (void *args)
+{
+    llio_async_t *self = (llio_async_t *) args;
+
+    pthread_mutex_lock (&self->lock);
+    while (1) {
+        while (self->reqs.head == NULL && !self->stop) {
+            pthread_cond_wait (&self->req_cond, &self->lock);
+        }
+
+        if (self->reqs.head == NULL) {
+            break;
+        }
+
+        llio_async_req_t *req = _llio_async_list_pop (&self->reqs);
+        pthread_mutex_unlock (&self->lock);
+
+        bool finished = _llio_async_exec_chunk (self, req);
+
+        pthread_mutex_lock (&self->lock);
+        /* Transfers take turns, a chunk each, so the ones of different
+         * requesters (e.g., several ACQ cores) progress together and a long
+         * one does not hold back the ones queued after it */
+        if (!finished) {
+            _llio_async_list_push (&self->reqs, req);
+            continue;
+        }
+
+        _llio_async_list_push (&self->done, req);
+        self->pending--;
+        if (self->pending == 0) {
+            pthread_cond_broadcast (&self->idle_cond);
+        }
+
+        uint64_t one = 1;
+        ssize_t rc = write (self->fd, &one, sizeof (one));
+        (void) rc;
+    }
+    pthread_mutex_unlock (&self->lock);
+
+    return NULL;
+}
+
+/* Do the next chunk of the transfer, releasing the device afterwards.
+ * Returns true once the transfer is over, with its result in req->ret */
+static bool _llio_async_exec_chunk (llio_async_t *self, llio_async_req_t *req)
+{
+    if (req->done >= req->size) {
+        req->ret = req->done;
+        return true;
+    }
+
+    size_t chunk = req->size - req->done;
+    if (chunk > LLIO_ASYNC_CHUNK_SIZE) {
+        chunk = LLIO_ASYNC_CHUNK_SIZE;
+    }
+
+    pthread_mutex_lock (&self->dev_lock);
+    ssize_t ret = req->xfer (self->llio, req->offs + req->done, chunk,
+            req->data + req->done / sizeof (*req->data));
+    pthread_mutex_unlock (&self->dev_lock);
+
+    if (ret < 0) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR, "[ll_io:async] Transfer failed "
+                "at offset 0x%"PRIx64"\n", req->offs + req->done);
+        req->ret = ret;
+        return true;
+    }
+
+    req->done += ret;
+    /* Short transfer. Nothing else to do */
+    if ((size_t) ret < chunk || req->done >= req->size) {
+        req->ret = req->done;
+        return true;
+    }
+
+    return false;
+}
+
+static void _llio_async_list_push (llio_async_list_t *list, llio_async_req_t *req)
+{
+    req->next = NULL;
+    if (list->tail != NULL) {
+        list->tail->next = req;
+    }
+    else {
+        list->head = req;
+    }
+    list->tail = req;
+}
+
+static llio_async_req_t *_llio_async_list_pop (llio_async_list_t *list)
+{
+    llio_async_req_t *req = list->head;
+    if (req != NULL) {
+        list->head = req->next;
+        if (list->head == NULL) {
+            list->tail = NULL;
+        }
+    }
+    return req;
+}
@@ -45,6 +45,8 @@ struct _llio_t {
     /* struct _llio_dev_info_t *dev_info; Moved to dev_io */
     /* Device operations */
     const llio_ops_t *ops;
+    /* Asynchronous engine. NULL if not enabled */
+    llio_async_t *async;
 };
 
 /* Register Low-level operations to llio instance. Helpper function */
@@ -113,6 +115,7 @@ llio_err_e llio_destroy (llio_t **self_p)
         llio_t *self = *self_p;
 
         /* Starting destructing by the last resource */
+        llio_async_destroy (&self->async);
         _llio_unregister_ops (&self->ops);
         /* llio_dev_info_destroy (&self->dev_info); Moved to dev_io */
         llio_endpoint_destroy (&self->endpoint);
@@ -189,6 +192,12 @@ void *llio_get_dev_handler (llio_t *self)
     return self->dev_handler;
 }
 
+bool llio_get_mt_safe (llio_t *self)
+{
+    assert (self);
+    return self->ops != NULL && self->ops->mt_safe;
+}
+
 /**************** Static function ****************/
 
 static bool _llio_get_endpoint_open (llio_t *self)
@@ -214,6 +223,18 @@ static llio_err_e _llio_register_ops (llio_type_e type, const llio_ops_t **ops)
             *ops = &llio_ops_eth;
             break;
 
+        case SIM_DEV:
+            *ops = &llio_ops_sim;
+            break;
+
+        case VFIO_DEV:
+            *ops = &llio_ops_vfio;
+            break;
+
+        case EBONE_DEV:
+            *ops = &llio_ops_ebone;
+            break;
+
         default:
             *ops = NULL;
             return LLIO_ERR_INV_FUNC_PARAM;
@@ -258,45 +279,254 @@ static llio_err_e _llio_unregister_ops (const llio_ops_t **ops)
     return self->ops->func_name (self, ##__VA_ARGS__);  \
 }
 
+/* Same as LLIO_FUNC_WRAPPER, but serialized with the asynchronous
+ * engine, if there is one */
+#define LLIO_FUNC_WRAPPER_LOCKED(func_name, ...)        \
+{                                                       \
+    ASSERT_FUNC(func_name);                             \
+    if (self->async == NULL) {                          \
+        return self->ops->func_name (self, ##__VA_ARGS__); \
+    }                                                   \
+    llio_async_lock (self->async);                      \
+    ssize_t ret = self->ops->func_name (self, ##__VA_ARGS__); \
+    llio_async_unlock (self->async);                    \
+    return ret;                                         \
+}
+
+/* Single register accesses are only serialized with the asynchronous
+ * engine if the device does not serialize them itself */
+#define LLIO_FUNC_WRAPPER_REG(func_name, ...)           \
+{                                                       \
+    ASSERT_FUNC(func_name);                             \
+    if (self->async == NULL || self->ops->mt_safe) {    \
+        return self->ops->func_name (self, ##__VA_ARGS__); \
+    }                                                   \
+    llio_async_lock (self->async);                      \
+    ssize_t ret = self->ops->func_name (self, ##__VA_ARGS__); \
+    llio_async_unlock (self->async);                    \
+    return ret;                                         \
+}
+
+/* Declare asynchronous wrapper for the block LLIO functions API */
+#define LLIO_FUNC_WRAPPER_ASYNC(func_name, ...)         \
+{                                                       \
+    assert (self);                                      \
+    assert (self->ops);                                 \
+    if (self->ops->func_name == NULL) {                 \
+        return LLIO_ERR_FUNC_NOT_IMPL;                  \
+    }                                                   \
+    if (self->async == NULL) {                          \
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,             \
+                "[ll_io] Asynchronous engine not enabled\n"); \
+        return LLIO_ERR_FUNC_NOT_IMPL;                  \
+    }                                                   \
+    return llio_async_submit (self->async, self->ops->func_name, \
+            ##__VA_ARGS__);                             \
+}
+
 /**** Open device ****/
 int llio_open (llio_t *self, llio_endpoint_t *endpoint)
     LLIO_FUNC_WRAPPER (open, endpoint)
 
 /**** Release device ****/
 int llio_release (llio_t *self, llio_endpoint_t *endpoint)
-    LLIO_FUNC_WRAPPER (release, endpoint)
+{
+    ASSERT_FUNC(release);
+    /* Don't pull the device from under the worker */
+    if (self->async != NULL) {
+        llio_async_flush (self->async);
+    }
+    return self->ops->release (self, endpoint);
+}
 
 /**** Read data from device ****/
 ssize_t llio_read_16 (llio_t *self, uint64_t offs, uint16_t *data)
-    LLIO_FUNC_WRAPPER (read_16, offs, data)
+    LLIO_FUNC_WRAPPER_REG (read_16, offs, data)
 ssize_t llio_read_32 (llio_t *self, uint64_t offs, uint32_t *data)
-    LLIO_FUNC_WRAPPER (read_32, offs, data)
+    LLIO_FUNC_WRAPPER_REG (read_32, offs, data)
 ssize_t llio_read_64 (llio_t *self, uint64_t offs, uint64_t *data)
-    LLIO_FUNC_WRAPPER (read_64, offs, data)
+    LLIO_FUNC_WRAPPER_REG (read_64, offs, data)
 
 /**** Write data to device ****/
 ssize_t llio_write_16 (llio_t *self, uint64_t offs, const uint16_t *data)
-    LLIO_FUNC_WRAPPER (write_16, offs, data)
+    LLIO_FUNC_WRAPPER_REG (write_16, offs, data)
 ssize_t llio_write_32 (llio_t *self, uint64_t offs, const uint32_t *data)
-    LLIO_FUNC_WRAPPER (write_32, offs, data)
+    LLIO_FUNC_WRAPPER_REG (write_32, offs, data)
 ssize_t llio_write_64 (llio_t *self, uint64_t offs, const uint64_t *data)
-    LLIO_FUNC_WRAPPER (write_64, offs, data)
+    LLIO_FUNC_WRAPPER_REG (write_64, offs, data)
 
 /**** Read data block from device function pointer, size in bytes ****/
+static ssize_t _llio_read_block (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data)
+    LLIO_FUNC_WRAPPER_LOCKED (read_block, offs, size, data)
+
 ssize_t llio_read_block (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
-    LLIO_FUNC_WRAPPER (read_block, offs, size, data)
+{
+    DBE_TRACE_STAGE (DBG_LL_IO | DBG_LVL_TRACE, "llio:read_block", ERRHAND_TRACE_BEGIN);
+    ssize_t ret = _llio_read_block (self, offs, size, data);
+    DBE_TRACE_STAGE (DBG_LL_IO | DBG_LVL_TRACE, "llio:read_block", ERRHAND_TRACE_END);
+    return ret;
+}
 
 /**** Write data block from device function pointer, size in bytes ****/
 ssize_t llio_write_block (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
-    LLIO_FUNC_WRAPPER (write_block, offs, size, data)
+    LLIO_FUNC_WRAPPER_LOCKED (write_block, offs, size, data)
 
 /**** Read data block via DMA from device, size in bytes ****/
 ssize_t llio_read_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
-    LLIO_FUNC_WRAPPER (read_dma, offs, size, data)
+    LLIO_FUNC_WRAPPER_LOCKED (read_dma, offs, size, data)
 
 /**** Write data block via DMA from device, size in bytes ****/
 ssize_t llio_write_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
-    LLIO_FUNC_WRAPPER (write_dma, offs, size, data)
+    LLIO_FUNC_WRAPPER_LOCKED (write_dma, offs, size, data)
+
+/* Vectored accesses are emulated one block at a time for the devices that
+ * can't do them natively. The whole vector is still serialized with the
+ * asynchronous engine, so no other access gets in between its blocks */
+static ssize_t _llio_rw_blockv_emul (llio_t *self, const llio_iov_t *iov,
+        size_t iovcnt, bool rw_read)
+{
+    read_block_fp rw_block = rw_read ? self->ops->read_block :
+        self->ops->write_block;
+    CHECK_FUNC (rw_block);
+    ssize_t total = 0;
+    size_t i;
+
+    for (i = 0; i < iovcnt; ++i) {
+        ssize_t ret = rw_block (self, iov [i].offs, iov [i].size, iov [i].data);
+        if (ret < 0) {
+            return ret;
+        }
+
+        total += ret;
+        if ((size_t) ret < iov [i].size) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+static ssize_t _llio_rw_blockv (llio_t *self, const llio_iov_t *iov,
+        size_t iovcnt, bool rw_read)
+{
+    assert (self);
+    assert (self->ops);
+    assert (iov);
+
+    if (iovcnt > LLIO_IOV_MAX) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR, "[ll_io] Vector of %zu blocks "
+                "exceeds the maximum of %u\n", iovcnt, LLIO_IOV_MAX);
+        return -LLIO_ERR_INV_FUNC_PARAM;
+    }
+
+    if (self->async != NULL) {
+        llio_async_lock (self->async);
+    }
+
+    ssize_t ret = 0;
+    if (rw_read && self->ops->read_blockv != NULL) {
+        ret = self->ops->read_blockv (self, iov, iovcnt);
+    }
+    else if (!rw_read && self->ops->write_blockv != NULL) {
+        ret = self->ops->write_blockv (self, iov, iovcnt);
+    }
+    else {
+        ret = _llio_rw_blockv_emul (self, iov, iovcnt, rw_read);
+    }
+
+    if (self->async != NULL) {
+        llio_async_unlock (self->async);
+    }
+
+    return ret;
+}
+
+/**** Read data blocks from device, in a single transfer if possible ****/
+ssize_t llio_read_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt)
+{
+    DBE_TRACE_STAGE (DBG_LL_IO | DBG_LVL_TRACE, "llio:read_blockv", ERRHAND_TRACE_BEGIN);
+    ssize_t ret = _llio_rw_blockv (self, iov, iovcnt, true);
+    DBE_TRACE_STAGE (DBG_LL_IO | DBG_LVL_TRACE, "llio:read_blockv", ERRHAND_TRACE_END);
+    return ret;
+}
+
+/**** Write data blocks to device, in a single transfer if possible ****/
+ssize_t llio_write_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt)
+{
+    return _llio_rw_blockv (self, iov, iovcnt, false);
+}
+
+/************************************************************/
+/*************** Asynchronous generic methods API ***********/
+/************************************************************/
+
+llio_err_e llio_enable_async (llio_t *self)
+{
+    assert (self);
+    llio_err_e err = LLIO_SUCCESS;
+
+    if (self->async != NULL) {
+        goto err_async_enabled;
+    }
+
+    self->async = llio_async_new (self);
+    ASSERT_ALLOC(self->async, err_async_alloc, LLIO_ERR_ALLOC);
+
+err_async_alloc:
+err_async_enabled:
+    return err;
+}
+
+llio_err_e llio_disable_async (llio_t *self)
+{
+    assert (self);
+    return llio_async_destroy (&self->async);
+}
+
+llio_err_e llio_flush_async (llio_t *self)
+{
+    assert (self);
+    return (self->async != NULL) ? llio_async_flush (self->async) : LLIO_SUCCESS;
+}
+
+bool llio_get_async_enabled (llio_t *self)
+{
+    assert (self);
+    return self->async != NULL;
+}
+
+int llio_get_completion_fd (llio_t *self)
+{
+    assert (self);
+    return (self->async != NULL) ? llio_async_get_fd (self->async) : -1;
+}
+
+int llio_process_completions (llio_t *self)
+{
+    assert (self);
+    return (self->async != NULL) ? llio_async_process (self->async) : 0;
+}
+
+/**** Read data block from device asynchronously, size in bytes ****/
+llio_err_e llio_read_block_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg)
+    LLIO_FUNC_WRAPPER_ASYNC (read_block, offs, size, data, cb, arg)
+
+/**** Write data block to device asynchronously, size in bytes ****/
+llio_err_e llio_write_block_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg)
+    LLIO_FUNC_WRAPPER_ASYNC (write_block, offs, size, data, cb, arg)
+
+/**** Read data block via DMA from device asynchronously, size in bytes ****/
+llio_err_e llio_read_dma_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg)
+    LLIO_FUNC_WRAPPER_ASYNC (read_dma, offs, size, data, cb, arg)
+
+/**** Write data block via DMA to device asynchronously, size in bytes ****/
+llio_err_e llio_write_dma_async (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, llio_async_cb_fp cb, void *arg)
+    LLIO_FUNC_WRAPPER_ASYNC (write_dma, offs, size, data, cb, arg)
 
 /**** Read device information function pointer ****/
 /* int llio_read_info (llio_t *self, llio_dev_info_t *dev_info)
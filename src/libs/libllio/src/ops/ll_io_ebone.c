@@ -0,0 +1,975 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <poll.h>
+
+#include "ll_io.h"
+#include "hw/pcie_regs.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LL_IO, "[ll_io:ebone]",  \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LL_IO, "[ll_io:ebone]",           \
+            llio_err_str(LLIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LL_IO, "[ll_io:ebone]",              \
+            llio_err_str (err_type))
+
+/* Our expected endpoint looks like the following:
+ * udp://10.0.0.0:60368
+ * */
+#define LLIO_EBONE_REGEX                                    \
+    "^udp://(\\d+\\.\\d+\\.\\d+\\.\\d+):(\\d+)$"
+
+/* Number of expected hits (address, port number) + whole pattern */
+#define LLIO_EBONE_REGEX_HITS               3
+/* Hit indexes */
+#define LLIO_EBONE_REGEX_ADDR_HIT           1
+#define LLIO_EBONE_REGEX_PORT_HIT           2
+
+/* Etherbone datagram header. All fields are big-endian:
+ *
+ *  byte 0-1         byte 2                  byte 3
+ *  magic        version | flags     address size | port size
+ */
+#define LLIO_EBONE_MAGIC                    0x4e6f
+#define LLIO_EBONE_VERSION                  1
+#define LLIO_EBONE_HDR_SIZE                 4
+#define LLIO_EBONE_HDR_NR                   0x04    /* No reads */
+#define LLIO_EBONE_HDR_PR                   0x02    /* Probe response */
+#define LLIO_EBONE_HDR_PF                   0x01    /* Probe */
+/* Address and port sizes are bitmaps of the supported widths. We only do
+ * 32-bit */
+#define LLIO_EBONE_WIDTH_32                 0x04
+
+/* Record header. Followed by the base write address and "wcount" words to
+ * write, if any, then by the base return address and "rcount" addresses to
+ * read, if any
+ *
+ *  byte 0     byte 1          byte 2     byte 3
+ *  flags    byte enable       wcount     rcount
+ */
+#define LLIO_EBONE_REC_HDR_SIZE             4
+#define LLIO_EBONE_REC_BCA                  0x80    /* Return address is config space */
+#define LLIO_EBONE_REC_RCA                  0x40    /* Read from config space */
+#define LLIO_EBONE_REC_RFF                  0x20    /* Read from a FIFO */
+#define LLIO_EBONE_REC_CYC                  0x08    /* End the bus cycle afterwards */
+#define LLIO_EBONE_REC_WCA                  0x04    /* Write to config space */
+#define LLIO_EBONE_REC_WFF                  0x02    /* Write to a FIFO */
+#define LLIO_EBONE_REC_BE_32                0x0f    /* All byte lanes */
+#define LLIO_EBONE_REC_MAX_WORDS            255
+
+/* The board answers each read record with a write record to the base
+ * return address we gave it. We make it up from the sequence number of
+ * the datagram and the index of the first word read by the record, so
+ * answers are matched to datagrams with any standard Etherbone slave */
+#define LLIO_EBONE_RET_ADDR(seq, idx)       (((uint32_t) (seq) << 16) | \
+                                                ((uint32_t) (idx) << 2))
+#define LLIO_EBONE_RET_ADDR_SEQ(addr)       ((uint16_t) ((addr) >> 16))
+#define LLIO_EBONE_RET_ADDR_IDX(addr)       (((addr) & 0xffff) >> 2)
+
+/* Datagrams with no reads get none of the board either. They end with a
+ * read of the error status register of the slave, at the start of its config
+ * space, as acknowledgement. Room for it is kept in every datagram */
+#define LLIO_EBONE_ACK_SIZE                 (LLIO_EBONE_REC_HDR_SIZE + \
+                                                2 * sizeof (uint32_t))
+#define LLIO_EBONE_ACK_ADDR                 0
+
+/* Receive buffer size. Fits any UDP datagram */
+#define LLIO_EBONE_RX_BUF_SIZE              65536
+
+/* Datagram waiting for its answer */
+typedef struct {
+    bool busy;                          /* Sent and not answered yet */
+    uint16_t seq;                       /* Sequence number */
+    uint8_t *buf;                       /* Datagram, kept to be sent again */
+    size_t len;
+    uint32_t **dst;                     /* Where each word read goes */
+    uint32_t num_reads;
+    int64_t deadline;                   /* zclock_mono () to send it again */
+    uint32_t retries;
+} llio_ebone_pkt_t;
+
+/* Consecutive words of a transfer */
+typedef struct {
+    uint32_t addr;                      /* Wishbone byte address */
+    uint32_t num_words;
+    uint32_t *data;                     /* Not modified by writes */
+    bool write;
+} llio_ebone_seg_t;
+
+/* Next word of a transfer to be put in a datagram */
+typedef struct {
+    const llio_ebone_seg_t *segs;
+    size_t num_segs;
+    size_t seg;
+    uint32_t word;
+} llio_ebone_cursor_t;
+
+/* Device endpoint */
+typedef struct {
+    int fd;
+    char *hostname;
+    char *port;
+    size_t mtu;                         /* Largest datagram, in bytes */
+    uint32_t window;                    /* Datagrams in flight of block reads */
+    uint32_t timeout;                   /* in msec */
+    uint32_t retries;
+    bool sdram_mapped;                  /* BAR2 is reachable at sdram_base */
+    uint64_t sdram_base;
+    uint16_t seq;                       /* Sequence number of the next datagram */
+    llio_ebone_pkt_t *pkts;             /* "window" of them */
+    uint32_t max_reads;                 /* Most words a datagram reads */
+    uint8_t *rx_buf;
+    uint32_t ack;                       /* Where acknowledgements are read to */
+    /* Statistics, logged when the device is released */
+    uint64_t num_pkts;
+    uint64_t num_retrans;
+    uint64_t num_dropped;               /* Answers matching no datagram */
+} llio_dev_ebone_t;
+
+static int _llio_ebone_conn (llio_dev_ebone_t *self);
+static int _llio_ebone_probe (llio_dev_ebone_t *self);
+static long _llio_ebone_getenv_long (const char *name, long dflt);
+static uint8_t *_ebone_put_32 (uint8_t *p, uint32_t value);
+static uint32_t _ebone_get_32 (const uint8_t *p);
+static uint8_t *_ebone_put_hdr (uint8_t *p, uint8_t flags);
+static bool _ebone_hdr_valid (const uint8_t *p, size_t len);
+static void _ebone_build_pkt (llio_dev_ebone_t *self, llio_ebone_pkt_t *pkt,
+        llio_ebone_cursor_t *cur);
+static void _ebone_send_pkt (llio_dev_ebone_t *self, llio_ebone_pkt_t *pkt);
+static llio_ebone_pkt_t *_ebone_parse_answer (llio_dev_ebone_t *self,
+        uint32_t window, size_t len);
+static int _ebone_wait (llio_dev_ebone_t *self, uint32_t window,
+        uint32_t *in_flight);
+static ssize_t _ebone_xfer (llio_dev_ebone_t *self,
+        const llio_ebone_seg_t *segs, size_t num_segs);
+static int _ebone_wb_addr (llio_dev_ebone_t *self, uint64_t offs, size_t size,
+        uint32_t *addr);
+static ssize_t _ebone_rw_generic (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, bool write);
+static ssize_t _ebone_rw_blockv (llio_t *self, const llio_iov_t *iov,
+        size_t iovcnt, bool write);
+
+/************ Our methods implementation **********/
+
+/* Creates a new instance of the dev_ebone */
+static llio_dev_ebone_t * llio_dev_ebone_new (const char *hostname,
+        const char *port)
+{
+    assert (hostname);
+    assert (port);
+
+    llio_dev_ebone_t *self = (llio_dev_ebone_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC (self, err_llio_dev_ebone_alloc);
+
+    /* Not connected yet */
+    self->fd = -1;
+
+    long mtu = _llio_ebone_getenv_long (LLIO_EBONE_ENV_MTU, LLIO_EBONE_MTU_DFLT);
+    long window = _llio_ebone_getenv_long (LLIO_EBONE_ENV_WINDOW,
+            LLIO_EBONE_WINDOW_DFLT);
+    long timeout = _llio_ebone_getenv_long (LLIO_EBONE_ENV_TIMEOUT,
+            LLIO_EBONE_TIMEOUT_DFLT);
+    long retries = _llio_ebone_getenv_long (LLIO_EBONE_ENV_RETRIES,
+            LLIO_EBONE_RETRIES_DFLT);
+    ASSERT_TEST(mtu >= (long) (LLIO_EBONE_HDR_SIZE + LLIO_EBONE_REC_HDR_SIZE +
+                2 * sizeof (uint32_t) + LLIO_EBONE_ACK_SIZE) &&
+            mtu <= LLIO_EBONE_MTU_MAX, "Invalid etherbone MTU", err_inv_param);
+    ASSERT_TEST(window > 0 && window <= LLIO_EBONE_WINDOW_MAX,
+            "Invalid etherbone window", err_inv_param);
+    ASSERT_TEST(timeout > 0 && retries >= 0,
+            "Invalid etherbone timeout or retries", err_inv_param);
+    self->mtu = mtu;
+    self->window = window;
+    self->timeout = timeout;
+    self->retries = retries;
+
+    const char *sdram_base = getenv (LLIO_EBONE_ENV_SDRAM_BASE);
+    if (sdram_base != NULL && *sdram_base != '\0') {
+        self->sdram_mapped = true;
+        self->sdram_base = strtoull (sdram_base, NULL, 0);
+    }
+
+    self->hostname = strdup (hostname);
+    ASSERT_ALLOC(self->hostname, err_hostname_alloc);
+    self->port = strdup (port);
+    ASSERT_ALLOC(self->port, err_port_alloc);
+    self->rx_buf = (uint8_t *) zmalloc (LLIO_EBONE_RX_BUF_SIZE);
+    ASSERT_ALLOC(self->rx_buf, err_rx_buf_alloc);
+
+    /* Every word read costs at least its address in the datagram */
+    self->max_reads = self->mtu / sizeof (uint32_t);
+    self->pkts = (llio_ebone_pkt_t *) zmalloc (self->window * sizeof (*self->pkts));
+    ASSERT_ALLOC(self->pkts, err_pkts_alloc);
+
+    uint32_t i;
+    for (i = 0; i < self->window; ++i) {
+        self->pkts [i].buf = (uint8_t *) zmalloc (self->mtu);
+        ASSERT_ALLOC(self->pkts [i].buf, err_pkt_alloc);
+        self->pkts [i].dst = (uint32_t **) zmalloc (self->max_reads *
+                sizeof (*self->pkts [i].dst));
+        ASSERT_ALLOC(self->pkts [i].dst, err_pkt_alloc);
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_ebone] Created instance of "
+            "llio_dev_ebone. MTU is %zu bytes, window is %u datagrams\n",
+            self->mtu, self->window);
+
+    return self;
+
+err_pkt_alloc:
+    for (i = 0; i < self->window; ++i) {
+        free (self->pkts [i].dst);
+        free (self->pkts [i].buf);
+    }
+    free (self->pkts);
+err_pkts_alloc:
+    free (self->rx_buf);
+err_rx_buf_alloc:
+    free (self->port);
+err_port_alloc:
+    free (self->hostname);
+err_hostname_alloc:
+err_inv_param:
+    free (self);
+err_llio_dev_ebone_alloc:
+    return NULL;
+}
+
+/* Destroy an instance of the Endpoint */
+static llio_err_e llio_dev_ebone_destroy (llio_dev_ebone_t **self_p)
+{
+    if (*self_p) {
+        llio_dev_ebone_t *self = *self_p;
+
+        if (self->fd != -1) {
+            close (self->fd);
+        }
+        for (uint32_t i = 0; i < self->window; ++i) {
+            free (self->pkts [i].dst);
+            free (self->pkts [i].buf);
+        }
+        free (self->pkts);
+        free (self->rx_buf);
+        free (self->hostname);
+        free (self->port);
+        free (self);
+
+        *self_p = NULL;
+    }
+
+    return LLIO_SUCCESS;
+}
+
+/************ llio_ops_ebone Implementation **********/
+
+/* Open Etherbone device */
+static int ebone_open (llio_t *self, llio_endpoint_t *endpoint)
+{
+    if (llio_get_endpoint_open (self)) {
+        /* Device is already opened. So, we return success */
+        return 0;
+    }
+
+    llio_err_e lerr = LLIO_SUCCESS;
+    int err = 0;
+    if (endpoint != NULL) {
+        lerr = llio_set_endpoint (self, endpoint);
+        ASSERT_TEST(lerr == LLIO_SUCCESS, "Could not set endpoint on etherbone device",
+                err_endpoint_set, -1);
+    }
+
+    /* Parse the endpoint name */
+    zrex_t *endp_regex = zrex_new (LLIO_EBONE_REGEX);
+    ASSERT_ALLOC(endp_regex, err_endp_regex_alloc, -1);
+
+    bool valid = zrex_valid (endp_regex);
+    /* Verify possible error on regex expression */
+    ASSERT_TEST(valid, "Regex expression is not valid", err_inv_regex_exp, -1);
+
+    const char *endpoint_name = llio_get_endpoint_name (self);
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO,
+            "[ll_io_ebone] Endpoint is %s\n", endpoint_name);
+
+    /* Extract the host address and port number from the endpoint name */
+    bool endp_matches = zrex_matches (endp_regex, endpoint_name);
+    ASSERT_TEST(endp_matches == true,
+            "Could not match endpoint string to the expected pattern",
+            err_endp_match, -1);
+
+    int hits = zrex_hits (endp_regex);
+    ASSERT_TEST(hits == LLIO_EBONE_REGEX_HITS,
+            "Number of LLIO endpoint hits was unexpected",
+            err_endp_hits, -1);
+
+    const char *endp_addr = zrex_hit (endp_regex, LLIO_EBONE_REGEX_ADDR_HIT);
+    ASSERT_TEST(endp_addr != NULL, "Could not retrieve address string",
+            err_endp_addr_retrieve, -1);
+
+    const char *endp_port = zrex_hit (endp_regex, LLIO_EBONE_REGEX_PORT_HIT);
+    ASSERT_TEST(endp_port != NULL, "Could not retrieve port string",
+            err_endp_port_retrieve, -1);
+
+    /* Create new private etherbone handler */
+    llio_dev_ebone_t *dev_ebone = llio_dev_ebone_new (endp_addr, endp_port);
+    ASSERT_TEST(dev_ebone != NULL, "Could not allocate dev_handler",
+            err_dev_handler_alloc, -1);
+
+    err = _llio_ebone_conn (dev_ebone);
+    ASSERT_TEST(err == 0, "Could not connect to endpoint", err_ebone_conn);
+
+    /* No answer is not fatal, the board might just not be up yet. Every
+     * access retries on its own */
+    err = _llio_ebone_probe (dev_ebone);
+    ASSERT_TEST(err >= 0, "Board does not support 32-bit etherbone accesses",
+            err_ebone_probe);
+    err = 0;
+
+    llio_set_dev_handler (self, dev_ebone);
+    /* Signal that the endpoint is opened and ready to work */
+    llio_set_endpoint_open (self, true);
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO,
+            "[ll_io_ebone] Opened etherbone device located at %s\n",
+            endpoint_name);
+
+    zrex_destroy (&endp_regex);
+    return err;
+
+err_ebone_probe:
+err_ebone_conn:
+    llio_dev_ebone_destroy (&dev_ebone);
+err_dev_handler_alloc:
+err_endp_port_retrieve:
+err_endp_addr_retrieve:
+err_endp_hits:
+err_endp_match:
+err_inv_regex_exp:
+    zrex_destroy (&endp_regex);
+err_endp_regex_alloc:
+err_endpoint_set:
+    return err;
+}
+
+/* Release Etherbone device */
+static int ebone_release (llio_t *self, llio_endpoint_t *endpoint)
+{
+    (void) endpoint;
+
+    if (!llio_get_endpoint_open (self)) {
+        /* Nothing to close */
+        return 0;
+    }
+
+    llio_err_e lerr = LLIO_SUCCESS;
+    int err = 0;
+    llio_dev_ebone_t *dev_ebone = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_ebone != NULL, "Could not get etherbone handler",
+            err_dev_ebone_handler, -1);
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io_ebone] %"PRIu64" datagrams "
+            "sent, %"PRIu64" sent again, %"PRIu64" unmatched answers\n",
+            dev_ebone->num_pkts, dev_ebone->num_retrans, dev_ebone->num_dropped);
+
+    /* Deattach specific device handler to generic one */
+    lerr = llio_dev_ebone_destroy (&dev_ebone);
+    ASSERT_TEST (lerr==LLIO_SUCCESS, "Could not close device appropriately",
+            err_dealloc, -1);
+
+    llio_set_dev_handler (self, NULL);
+    llio_set_endpoint_open (self, false);
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO,
+            "[ll_io_ebone] Closed etherbone device located at %s\n",
+            llio_get_endpoint_name (self));
+
+err_dealloc:
+err_dev_ebone_handler:
+    return err;
+}
+
+/* Read data from Etherbone device */
+static ssize_t ebone_read_32 (llio_t *self, uint64_t offs, uint32_t *data)
+{
+    return _ebone_rw_generic (self, offs, sizeof (*data), data, false);
+}
+
+/* Two words, the low one first, as the PCIe device does */
+static ssize_t ebone_read_64 (llio_t *self, uint64_t offs, uint64_t *data)
+{
+    return _ebone_rw_generic (self, offs, sizeof (*data), (uint32_t *) data,
+            false);
+}
+
+/* Write data to Etherbone device */
+static ssize_t ebone_write_32 (llio_t *self, uint64_t offs, const uint32_t *data)
+{
+    return _ebone_rw_generic (self, offs, sizeof (*data), (uint32_t *) data,
+            true);
+}
+
+static ssize_t ebone_write_64 (llio_t *self, uint64_t offs, const uint64_t *data)
+{
+    return _ebone_rw_generic (self, offs, sizeof (*data), (uint32_t *) data,
+            true);
+}
+
+/* Read data block from Etherbone device, size in bytes */
+static ssize_t ebone_read_block (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    return _ebone_rw_generic (self, offs, size, data, false);
+}
+
+/* Write data block to Etherbone device, size in bytes */
+static ssize_t ebone_write_block (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    return _ebone_rw_generic (self, offs, size, data, true);
+}
+
+/* Read data blocks from Etherbone device, sharing the datagrams */
+static ssize_t ebone_read_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt)
+{
+    return _ebone_rw_blockv (self, iov, iovcnt, false);
+}
+
+/* Write data blocks to Etherbone device, sharing the datagrams */
+static ssize_t ebone_write_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt)
+{
+    return _ebone_rw_blockv (self, iov, iovcnt, true);
+}
+
+/******************************* Static Functions *****************************/
+
+static ssize_t _ebone_rw_generic (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, bool write)
+{
+    llio_iov_t iov = {.offs = offs, .size = size, .data = data};
+    return _ebone_rw_blockv (self, &iov, 1, write);
+}
+
+static ssize_t _ebone_rw_blockv (llio_t *self, const llio_iov_t *iov,
+        size_t iovcnt, bool write)
+{
+    assert (self);
+    ssize_t err = -1;
+    ASSERT_TEST(llio_get_endpoint_open (self), "Could not perform RW operation. "
+            "Device is not opened", err_endp_open, -1);
+
+    llio_dev_ebone_t *dev_ebone = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_ebone != NULL, "Could not get etherbone handler",
+            err_dev_ebone_handler, -1);
+
+    /* At most LLIO_IOV_MAX, checked by llio_read_blockv () */
+    llio_ebone_seg_t segs [LLIO_IOV_MAX];
+    size_t i;
+    for (i = 0; i < iovcnt; ++i) {
+        /* Partial words are left out, as the PCIe device does */
+        segs [i].num_words = iov [i].size / sizeof (uint32_t);
+        segs [i].data = iov [i].data;
+        segs [i].write = write;
+        err = _ebone_wb_addr (dev_ebone, iov [i].offs, iov [i].size,
+                &segs [i].addr);
+        ASSERT_TEST(err == 0, "Could not map offset to the Wishbone bus",
+                err_wb_addr, -1);
+    }
+
+    err = _ebone_xfer (dev_ebone, segs, iovcnt);
+
+err_wb_addr:
+err_dev_ebone_handler:
+err_endp_open:
+    return err;
+}
+
+/* Runs a transfer to completion. Returns the number of bytes transferred
+ * or -1 if some datagram was not answered after all of the retries */
+static ssize_t _ebone_xfer (llio_dev_ebone_t *self,
+        const llio_ebone_seg_t *segs, size_t num_segs)
+{
+    llio_ebone_cursor_t cur = {.segs = segs, .num_segs = num_segs};
+    ssize_t total = 0;
+    bool has_writes = false;
+
+    size_t i;
+    for (i = 0; i < num_segs; ++i) {
+        total += segs [i].num_words * sizeof (uint32_t);
+        has_writes |= segs [i].write;
+    }
+
+    /* Datagrams may be lost and sent again, so the board can get them in
+     * any order. Writes must keep theirs, so transfers with any go one
+     * datagram at a time. Reads fill the window */
+    uint32_t window = has_writes ? 1 : self->window;
+    uint32_t in_flight = 0;
+
+    while (1) {
+        uint32_t j;
+        for (j = 0; j < window && cur.seg < cur.num_segs; ++j) {
+            llio_ebone_pkt_t *pkt = &self->pkts [j];
+            if (pkt->busy) {
+                continue;
+            }
+
+            pkt->seq = self->seq++;
+            pkt->retries = 0;
+            pkt->busy = true;
+            _ebone_build_pkt (self, pkt, &cur);
+            _ebone_send_pkt (self, pkt);
+            ++self->num_pkts;
+            ++in_flight;
+        }
+
+        if (in_flight == 0) {
+            break;
+        }
+
+        if (_ebone_wait (self, window, &in_flight) != 0) {
+            /* Late answers to these are dropped, as no datagram matches
+             * them anymore */
+            for (j = 0; j < window; ++j) {
+                self->pkts [j].busy = false;
+            }
+            return -1;
+        }
+    }
+
+    return total;
+}
+
+/* Fills the datagram with as much of the transfer as it fits, from "cur"
+ * on, and moves "cur" past it */
+static void _ebone_build_pkt (llio_dev_ebone_t *self, llio_ebone_pkt_t *pkt,
+        llio_ebone_cursor_t *cur)
+{
+    uint8_t *p = _ebone_put_hdr (pkt->buf, 0);
+    const uint8_t *end = pkt->buf + self->mtu - LLIO_EBONE_ACK_SIZE;
+    pkt->num_reads = 0;
+
+    while (cur->seg < cur->num_segs) {
+        const llio_ebone_seg_t *seg = &cur->segs [cur->seg];
+        if (cur->word == seg->num_words) {
+            ++cur->seg;
+            cur->word = 0;
+            continue;
+        }
+
+        /* Either way, a word costs 4 bytes on top of the record header and
+         * its base address */
+        size_t left = end - p;
+        size_t room = (left > LLIO_EBONE_REC_HDR_SIZE + sizeof (uint32_t)) ?
+            (left - LLIO_EBONE_REC_HDR_SIZE - sizeof (uint32_t)) /
+            sizeof (uint32_t) : 0;
+        uint32_t n = seg->num_words - cur->word;
+        n = (n > room) ? room : n;
+        n = (n > LLIO_EBONE_REC_MAX_WORDS) ? LLIO_EBONE_REC_MAX_WORDS : n;
+        if (!seg->write && n > self->max_reads - pkt->num_reads) {
+            n = self->max_reads - pkt->num_reads;
+        }
+        if (n == 0) {
+            break;
+        }
+
+        uint32_t addr = seg->addr + cur->word * sizeof (uint32_t);
+        uint32_t *data = seg->data + cur->word;
+        uint32_t k;
+        if (seg->write) {
+            *p++ = LLIO_EBONE_REC_CYC;
+            *p++ = LLIO_EBONE_REC_BE_32;
+            *p++ = n;
+            *p++ = 0;
+            p = _ebone_put_32 (p, addr);
+            for (k = 0; k < n; ++k) {
+                p = _ebone_put_32 (p, data [k]);
+            }
+        }
+        else {
+            *p++ = LLIO_EBONE_REC_CYC;
+            *p++ = LLIO_EBONE_REC_BE_32;
+            *p++ = 0;
+            *p++ = n;
+            p = _ebone_put_32 (p, LLIO_EBONE_RET_ADDR(pkt->seq, pkt->num_reads));
+            for (k = 0; k < n; ++k) {
+                pkt->dst [pkt->num_reads++] = &data [k];
+                p = _ebone_put_32 (p, addr + k * sizeof (uint32_t));
+            }
+        }
+
+        cur->word += n;
+    }
+
+    if (pkt->num_reads == 0) {
+        *p++ = LLIO_EBONE_REC_RCA | LLIO_EBONE_REC_CYC;
+        *p++ = LLIO_EBONE_REC_BE_32;
+        *p++ = 0;
+        *p++ = 1;
+        p = _ebone_put_32 (p, LLIO_EBONE_RET_ADDR(pkt->seq, 0));
+        p = _ebone_put_32 (p, LLIO_EBONE_ACK_ADDR);
+        pkt->dst [pkt->num_reads++] = &self->ack;
+    }
+
+    pkt->len = p - pkt->buf;
+}
+
+/* A failed send is handled as a lost datagram, so it is sent again after
+ * the timeout */
+static void _ebone_send_pkt (llio_dev_ebone_t *self, llio_ebone_pkt_t *pkt)
+{
+    pkt->deadline = zclock_mono () + self->timeout;
+
+    ssize_t n;
+    do {
+        n = send (self->fd, pkt->buf, pkt->len, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+
+    if (n != (ssize_t) pkt->len) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_ebone] Could not send "
+                "datagram %u: %s\n", pkt->seq, strerror(errno));
+    }
+}
+
+/* Waits until a datagram is answered or one is due to be sent again.
+ * Returns -1 if a datagram ran out of retries */
+static int _ebone_wait (llio_dev_ebone_t *self, uint32_t window,
+        uint32_t *in_flight)
+{
+    int64_t deadline = INT64_MAX;
+    uint32_t i;
+    for (i = 0; i < window; ++i) {
+        if (self->pkts [i].busy && self->pkts [i].deadline < deadline) {
+            deadline = self->pkts [i].deadline;
+        }
+    }
+
+    int64_t now = zclock_mono ();
+    struct pollfd pfd = {.fd = self->fd, .events = POLLIN};
+    int rc = poll (&pfd, 1, (deadline > now) ? (int) (deadline - now) : 0);
+    if (rc > 0) {
+        ssize_t n = recv (self->fd, self->rx_buf, LLIO_EBONE_RX_BUF_SIZE, 0);
+        /* ICMP errors show up here too. Whatever was lost is sent again
+         * after the timeout */
+        if (n > 0) {
+            llio_ebone_pkt_t *pkt = _ebone_parse_answer (self, window, n);
+            if (pkt != NULL) {
+                pkt->busy = false;
+                --*in_flight;
+            }
+        }
+        return 0;
+    }
+
+    if (rc < 0 && errno != EINTR) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR, "[ll_io_ebone] Could not poll "
+                "socket: %s\n", strerror(errno));
+        return -1;
+    }
+
+    now = zclock_mono ();
+    for (i = 0; i < window; ++i) {
+        llio_ebone_pkt_t *pkt = &self->pkts [i];
+        if (!pkt->busy || pkt->deadline > now) {
+            continue;
+        }
+
+        if (pkt->retries == self->retries) {
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR, "[ll_io_ebone] No answer from "
+                    "%s:%s to datagram %u after %u retries\n", self->hostname,
+                    self->port, pkt->seq, pkt->retries);
+            return -1;
+        }
+
+        /* Writes may get to the board twice if only the answer was lost */
+        ++pkt->retries;
+        ++self->num_retrans;
+        _ebone_send_pkt (self, pkt);
+    }
+
+    return 0;
+}
+
+/* Copies the words of the answer where they go. Returns the datagram it
+ * answers, or NULL if there is none, e.g., a late answer to a datagram that
+ * was sent again */
+static llio_ebone_pkt_t *_ebone_parse_answer (llio_dev_ebone_t *self,
+        uint32_t window, size_t len)
+{
+    const uint8_t *p = self->rx_buf;
+    const uint8_t *end = p + len;
+    llio_ebone_pkt_t *pkt = NULL;
+    uint32_t num_words = 0;
+
+    if (!_ebone_hdr_valid (p, len) || (p [2] & LLIO_EBONE_HDR_PR)) {
+        goto err_drop;
+    }
+    p += LLIO_EBONE_HDR_SIZE;
+
+    while ((size_t) (end - p) >= LLIO_EBONE_REC_HDR_SIZE) {
+        uint32_t wcount = p [2];
+        uint32_t rcount = p [3];
+        p += LLIO_EBONE_REC_HDR_SIZE;
+
+        /* Records with no reads are answered with an empty one */
+        if (wcount == 0 && rcount == 0) {
+            continue;
+        }
+
+        /* We were asked to read. We are no slave */
+        if (rcount != 0 || (size_t) (end - p) < (wcount + 1) * sizeof (uint32_t)) {
+            goto err_drop;
+        }
+
+        uint32_t ret_addr = _ebone_get_32 (p);
+        p += sizeof (uint32_t);
+        uint16_t seq = LLIO_EBONE_RET_ADDR_SEQ(ret_addr);
+        uint32_t idx = LLIO_EBONE_RET_ADDR_IDX(ret_addr);
+
+        if (pkt == NULL) {
+            uint32_t i;
+            for (i = 0; i < window; ++i) {
+                if (self->pkts [i].busy && self->pkts [i].seq == seq) {
+                    pkt = &self->pkts [i];
+                    break;
+                }
+            }
+        }
+
+        if (pkt == NULL || pkt->seq != seq || idx + wcount > pkt->num_reads) {
+            goto err_drop;
+        }
+
+        uint32_t k;
+        for (k = 0; k < wcount; ++k) {
+            *pkt->dst [idx + k] = _ebone_get_32 (p);
+            p += sizeof (uint32_t);
+        }
+        num_words += wcount;
+    }
+
+    if (pkt == NULL || num_words != pkt->num_reads) {
+        goto err_drop;
+    }
+
+    return pkt;
+
+err_drop:
+    ++self->num_dropped;
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_ebone] Dropped answer of "
+            "%zu bytes\n", len);
+    return NULL;
+}
+
+/* Wishbone address of the device offset. BAR4 is the Wishbone bus itself,
+ * BAR2 is mapped into it by some boards. Returns -1 if the offset can't be
+ * reached */
+static int _ebone_wb_addr (llio_dev_ebone_t *self, uint64_t offs, size_t size,
+        uint32_t *addr)
+{
+    uint64_t full_offs = PCIE_ADDR_GEN (offs);
+
+    switch (PCIE_ADDR_BAR (offs)) {
+        case BAR4NO:
+            break;
+
+        case BAR2NO:
+            if (!self->sdram_mapped) {
+                DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR, "[ll_io_ebone] SDRAM is "
+                        "not mapped. Set %s\n", LLIO_EBONE_ENV_SDRAM_BASE);
+                return -1;
+            }
+            full_offs += self->sdram_base;
+            break;
+
+        default:
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR, "[ll_io_ebone] Invalid BAR "
+                    "access, offset 0x%"PRIx64"\n", offs);
+            return -1;
+    }
+
+    /* Wishbone addresses are 32-bit, of whole words */
+    if ((full_offs & (sizeof (uint32_t) - 1)) != 0 ||
+            full_offs + size > (1ULL << 32)) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR, "[ll_io_ebone] Offset 0x%"PRIx64
+                " out of the Wishbone bus\n", offs);
+        return -1;
+    }
+
+    *addr = (uint32_t) full_offs;
+    return 0;
+}
+
+/******************************* Helper Functions *****************************/
+
+static int _llio_ebone_conn (llio_dev_ebone_t *self)
+{
+    int err = 0;
+    struct addrinfo hints, *servinfo, *p;
+
+    memset (&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    int rv = getaddrinfo (self->hostname, self->port, &hints, &servinfo);
+    ASSERT_TEST (rv == 0, "Could not get address information",
+            err_getaddrinfo, -1);
+
+    /* loop through all the results and connect to the first we can */
+    for (p = servinfo; p != NULL; p = p->ai_next) {
+        self->fd = socket (p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (self->fd == -1) {
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+                    "[ll_io_ebone] Error executing socket: %s\n", strerror(errno));
+            continue;
+        }
+
+        /* This only sets the peer of every send () and recv () */
+        if (connect (self->fd, p->ai_addr, p->ai_addrlen) == -1) {
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+                    "[ll_io_ebone] Error executing connect: %s\n", strerror(errno));
+            close (self->fd);
+            self->fd = -1;
+            continue;
+        }
+
+        break;
+    }
+
+    freeaddrinfo (servinfo);
+    ASSERT_TEST (p != NULL, "Could not connect", err_connect, -1);
+
+    /* Answers to a whole window must fit, or they are lost and sent again.
+     * Not fatal, the default just costs retransmissions */
+    int rcvbuf = (int) _llio_ebone_getenv_long (LLIO_ETH_ENV_RCVBUF,
+            2 * self->window * self->mtu);
+    if (setsockopt (self->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf)) != 0) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN,
+                "[ll_io_ebone] Could not set receive buffer size: %s\n", strerror(errno));
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io_ebone] Sending to %s:%s\n",
+            self->hostname, self->port);
+
+err_connect:
+err_getaddrinfo:
+    return err;
+}
+
+/* Asks the board for its bus widths. Returns 0 if it supports ours, 1 if
+ * it did not answer and -1 if it does not */
+static int _llio_ebone_probe (llio_dev_ebone_t *self)
+{
+    uint8_t probe [LLIO_EBONE_HDR_SIZE];
+    _ebone_put_hdr (probe, LLIO_EBONE_HDR_PF | LLIO_EBONE_HDR_NR);
+
+    uint32_t attempt;
+    for (attempt = 0; attempt <= self->retries; ++attempt) {
+        if (send (self->fd, probe, sizeof (probe), MSG_NOSIGNAL) !=
+                sizeof (probe)) {
+            continue;
+        }
+
+        struct pollfd pfd = {.fd = self->fd, .events = POLLIN};
+        int64_t deadline = zclock_mono () + self->timeout;
+        int64_t now;
+        while ((now = zclock_mono ()) < deadline &&
+                poll (&pfd, 1, (int) (deadline - now)) > 0) {
+            ssize_t n = recv (self->fd, self->rx_buf, LLIO_EBONE_RX_BUF_SIZE, 0);
+            if (n <= 0 || !_ebone_hdr_valid (self->rx_buf, n) ||
+                    !(self->rx_buf [2] & LLIO_EBONE_HDR_PR)) {
+                continue;
+            }
+
+            uint8_t widths = self->rx_buf [3];
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io_ebone] Board answered "
+                    "the probe. Address widths 0x%x, data widths 0x%x\n",
+                    widths >> 4, widths & 0xf);
+            return ((widths >> 4) & LLIO_EBONE_WIDTH_32) &&
+                (widths & LLIO_EBONE_WIDTH_32) ? 0 : -1;
+        }
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN, "[ll_io_ebone] No answer to the "
+            "probe from %s:%s\n", self->hostname, self->port);
+    return 1;
+}
+
+static long _llio_ebone_getenv_long (const char *name, long dflt)
+{
+    const char *value = getenv (name);
+    if (value == NULL || *value == '\0') {
+        return dflt;
+    }
+
+    return strtol (value, NULL, 0);
+}
+
+static uint8_t *_ebone_put_32 (uint8_t *p, uint32_t value)
+{
+    uint32_t be = htonl (value);
+    memcpy (p, &be, sizeof (be));
+    return p + sizeof (be);
+}
+
+static uint32_t _ebone_get_32 (const uint8_t *p)
+{
+    uint32_t be;
+    memcpy (&be, p, sizeof (be));
+    return ntohl (be);
+}
+
+static uint8_t *_ebone_put_hdr (uint8_t *p, uint8_t flags)
+{
+    *p++ = LLIO_EBONE_MAGIC >> 8;
+    *p++ = LLIO_EBONE_MAGIC & 0xff;
+    *p++ = (LLIO_EBONE_VERSION << 4) | flags;
+    *p++ = (LLIO_EBONE_WIDTH_32 << 4) | LLIO_EBONE_WIDTH_32;
+    return p;
+}
+
+static bool _ebone_hdr_valid (const uint8_t *p, size_t len)
+{
+    return len >= LLIO_EBONE_HDR_SIZE &&
+        p [0] == (LLIO_EBONE_MAGIC >> 8) && p [1] == (LLIO_EBONE_MAGIC & 0xff) &&
+        (p [2] >> 4) == LLIO_EBONE_VERSION;
+}
+
+const llio_ops_t llio_ops_ebone = {
+    .open           = ebone_open,       /* Open device */
+    .release        = ebone_release,    /* Release device */
+    .read_16        = NULL,             /* Read 16-bit data */
+    .read_32        = ebone_read_32,    /* Read 32-bit data */
+    .read_64        = ebone_read_64,    /* Read 64-bit data */
+    .write_16       = NULL,             /* Write 16-bit data */
+    .write_32       = ebone_write_32,   /* Write 32-bit data */
+    .write_64       = ebone_write_64,   /* Write 64-bit data */
+    .read_block     = ebone_read_block, /* Read arbitrary block size data,
+                                           parameter size in bytes */
+    .write_block    = ebone_write_block,/* Write arbitrary block size data,
+                                           parameter size in bytes */
+    .read_dma       = NULL,             /* Read arbitrary block size data via DMA,
+                                           parameter size in bytes */
+    .write_dma      = NULL,             /* Write arbitrary block size data via DMA,
+                                           parameter size in bytes */
+    .read_blockv    = ebone_read_blockv,/* Read scattered blocks, sharing
+                                           datagrams */
+    .write_blockv   = ebone_write_blockv,/* Write scattered blocks, sharing
+                                           datagrams */
+    .mt_safe        = false             /* One transfer at a time */
+};
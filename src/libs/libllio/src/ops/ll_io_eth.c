@@ -45,19 +45,41 @@
 #define LLIO_ETH_REGEX_ADDR_HIT             2
 #define LLIO_ETH_REGEX_PORT_HIT             3
 
+/* Receive buffer size. Fits any UDP datagram, as anything not fitting in
+ * the buffer would be lost */
+#define LLIO_ETH_RX_BUF_SIZE                65536
+
+/* Reconnect attempts after the connection is lost are spaced exponentially,
+ * between these, in msec. Accesses fail right away between attempts */
+#define LLIO_ETH_BACKOFF_MIN                100
+#define LLIO_ETH_BACKOFF_MAX                10000
+
 /* Device endpoint */
 typedef struct {
     llio_eth_type_e type;
     int fd;
     char *hostname;
     char *port;
+    /* Data received but not read yet. Small reads, as the header and body of
+     * a BSMP message, are served from here instead of costing a recv ()
+     * each. For UDP, this holds the rest of the last datagram */
+    uint8_t *rx_buf;
+    size_t rx_head;
+    size_t rx_tail;
+    /* The connection is reestablished if lost. fd is -1 while it is down */
+    int64_t reconnect_time;             /* zclock_mono () of the next attempt */
+    uint32_t backoff;                   /* Current backoff in msec */
 } llio_dev_eth_t;
 
 static int _llio_eth_conn (int *fd, llio_eth_type_e type, char *hostname,
         char* port);
+static void _llio_eth_set_sockopts (int fd, llio_eth_type_e type);
+static void _llio_eth_disconnect (llio_dev_eth_t *self);
+static int _llio_eth_reconnect (llio_dev_eth_t *self);
+static long _llio_eth_getenv_long (const char *name, long dflt);
 static void *_get_in_addr(struct sockaddr *sa);
 static ssize_t _eth_sendall (int fd, uint8_t *buf, size_t len);
-static ssize_t _eth_recvall (int fd, uint8_t *buf, size_t len);
+static ssize_t _eth_recvall (llio_dev_eth_t *self, uint8_t *buf, size_t len);
 static ssize_t _eth_read_generic (llio_t *self, uint64_t offs, uint32_t *data,
         size_t size);
 static ssize_t _eth_write_generic (llio_t *self, uint64_t offs, const uint32_t *data,
@@ -86,16 +108,22 @@ static llio_dev_eth_t * llio_dev_eth_new (const char *sock_type, const char *hos
 
     /* *Initialize socket type */
     self->type = type;
+    /* Not connected yet */
+    self->fd = -1;
 
     self->hostname = strdup (hostname);
     ASSERT_ALLOC(self->hostname, err_hostname_alloc);
     self->port = strdup (port);
     ASSERT_ALLOC(self->port, err_port_alloc);
+    self->rx_buf = (uint8_t *) zmalloc (LLIO_ETH_RX_BUF_SIZE);
+    ASSERT_ALLOC(self->rx_buf, err_rx_buf_alloc);
 
     DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_eth] Created instance of llio_dev_eth\n");
 
     return self;
 
+err_rx_buf_alloc:
+    free (self->port);
 err_port_alloc:
     free (self->hostname);
 err_hostname_alloc:
@@ -111,7 +139,10 @@ static llio_err_e llio_dev_eth_destroy (llio_dev_eth_t **self_p)
     if (*self_p) {
         llio_dev_eth_t *self = *self_p;
 
-        close (self->fd);
+        if (self->fd != -1) {
+            close (self->fd);
+        }
+        free (self->rx_buf);
         free (self->hostname);
         free (self->port);
         free (self);
@@ -311,8 +342,17 @@ static ssize_t _eth_read_generic (llio_t *self, uint64_t offs, uint32_t *data,
     ASSERT_TEST(dev_eth != NULL, "Could not get ETH handler",
             err_dev_eth_handler, -1);
 
-    err = _eth_recvall (dev_eth->fd, (uint8_t *) data, size);
+    err = _llio_eth_reconnect (dev_eth);
+    ASSERT_TEST(err == 0, "ETH device is disconnected", err_disconnected, -1);
 
+    /* An answer cut by a lost connection can't be recovered. Fail this
+     * read, the next access gets a new connection */
+    err = _eth_recvall (dev_eth, (uint8_t *) data, size);
+    if (err < 0) {
+        _llio_eth_disconnect (dev_eth);
+    }
+
+err_disconnected:
 err_dev_eth_handler:
     return err;
 }
@@ -327,8 +367,23 @@ static ssize_t _eth_write_generic (llio_t *self, uint64_t offs, const uint32_t *
     ASSERT_TEST(dev_eth != NULL, "Could not get ETH handler",
             err_dev_eth_handler, -1);
 
+    err = _llio_eth_reconnect (dev_eth);
+    ASSERT_TEST(err == 0, "ETH device is disconnected", err_disconnected, -1);
+
     err = _eth_sendall (dev_eth->fd, (uint8_t *) data, size);
+    /* A broken connection is usually only noticed when sending. Nothing was
+     * answered yet, so it is safe to send it all again over a new one */
+    if (err < 0) {
+        _llio_eth_disconnect (dev_eth);
+        if (_llio_eth_reconnect (dev_eth) == 0) {
+            err = _eth_sendall (dev_eth->fd, (uint8_t *) data, size);
+            if (err < 0) {
+                _llio_eth_disconnect (dev_eth);
+            }
+        }
+    }
 
+err_disconnected:
 err_dev_eth_handler:
     return err;
 }
@@ -344,14 +399,14 @@ static int _llio_eth_conn (int *fd, llio_eth_type_e type, char *hostname,
     char s[INET6_ADDRSTRLEN];
     int yes = 1;
 
-    /* Ignored for now */
-    ASSERT_TEST (type == TCP_ETH_SOCK, "Unsupported socket type",
-            err_unsup, -1);
+    *fd = -1;
+    ASSERT_TEST (type == TCP_ETH_SOCK || type == UDP_ETH_SOCK,
+            "Unsupported socket type", err_unsup, -1);
 
     // Socket specific part
     memset (&hints, 0, sizeof hints);
     hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_socktype = (type == UDP_ETH_SOCK) ? SOCK_DGRAM : SOCK_STREAM;
 
     rv = getaddrinfo (hostname, port, &hints, &servinfo);
     /* DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
@@ -369,16 +424,21 @@ static int _llio_eth_conn (int *fd, llio_eth_type_e type, char *hostname,
         }
 
         /* This is important for correct behaviour */
-        rv = setsockopt(*fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(int));
-        /* DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
-           "[ll_io_eth] Error executing setsockpot: %s\n", strerror(errno));*/
-        ASSERT_TEST (rv == 0, "Could not set endpoint options",
-                err_setsockopt, -1);
+        if (type == TCP_ETH_SOCK) {
+            rv = setsockopt(*fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(int));
+            /* DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+               "[ll_io_eth] Error executing setsockpot: %s\n", strerror(errno));*/
+            ASSERT_TEST (rv == 0, "Could not set endpoint options",
+                    err_setsockopt, -1);
+        }
+        _llio_eth_set_sockopts (*fd, type);
 
+        /* For UDP, this only sets the peer of every send () and recv () */
         if (connect(*fd, p->ai_addr, p->ai_addrlen) == -1) {
             DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
                     "[ll_io_eth] Error executing connect: %s\n", strerror(errno));
             close(*fd);
+            *fd = -1;
             continue;
         }
 
@@ -397,13 +457,110 @@ static int _llio_eth_conn (int *fd, llio_eth_type_e type, char *hostname,
     return err;
 
 err_connect:
-    close (*fd);
 err_setsockopt:
+    /* Called again on every reconnect, so don't leak anything */
+    if (*fd != -1) {
+        close (*fd);
+        *fd = -1;
+    }
+    freeaddrinfo (servinfo);
 err_getaddrinfo:
 err_unsup:
     return err;
 }
 
+/* Drop a lost connection. Anything buffered belongs to it */
+static void _llio_eth_disconnect (llio_dev_eth_t *self)
+{
+    if (self->fd == -1) {
+        return;
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN, "[ll_io_eth] Lost connection to "
+            "%s:%s: %s\n", self->hostname, self->port, strerror(errno));
+    close (self->fd);
+    self->fd = -1;
+    self->rx_head = 0;
+    self->rx_tail = 0;
+}
+
+/* Make sure we are connected. Returns 0 if we are and -1 if we are not and
+ * it is either too early to try again or the attempt failed */
+static int _llio_eth_reconnect (llio_dev_eth_t *self)
+{
+    if (self->fd != -1) {
+        return 0;
+    }
+
+    int64_t now = zclock_mono ();
+    if (now < self->reconnect_time) {
+        return -1;
+    }
+
+    int err = _llio_eth_conn (&self->fd, self->type, self->hostname,
+            self->port);
+    if (err != 0) {
+        self->fd = -1;
+        self->backoff = (self->backoff == 0) ? LLIO_ETH_BACKOFF_MIN :
+            self->backoff * 2;
+        if (self->backoff > LLIO_ETH_BACKOFF_MAX) {
+            self->backoff = LLIO_ETH_BACKOFF_MAX;
+        }
+        self->reconnect_time = now + self->backoff;
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN, "[ll_io_eth] Could not reconnect "
+                "to %s:%s. Trying again in %u ms\n", self->hostname, self->port,
+                self->backoff);
+        return -1;
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io_eth] Reconnected to %s:%s\n",
+            self->hostname, self->port);
+    self->backoff = 0;
+    self->reconnect_time = 0;
+
+    return 0;
+}
+
+/* Optional socket tuning. Failures are not fatal, the defaults still work */
+static void _llio_eth_set_sockopts (int fd, llio_eth_type_e type)
+{
+    int sndbuf = (int) _llio_eth_getenv_long (LLIO_ETH_ENV_SNDBUF, 0);
+    if (sndbuf > 0 &&
+            setsockopt (fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof (sndbuf)) != 0) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN,
+                "[ll_io_eth] Could not set send buffer size: %s\n", strerror(errno));
+    }
+
+    int rcvbuf = (int) _llio_eth_getenv_long (LLIO_ETH_ENV_RCVBUF, 0);
+    if (rcvbuf > 0 &&
+            setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf)) != 0) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN,
+                "[ll_io_eth] Could not set receive buffer size: %s\n", strerror(errno));
+    }
+
+    if (type == UDP_ETH_SOCK) {
+        long timeout = _llio_eth_getenv_long (LLIO_ETH_ENV_UDP_TIMEOUT,
+                LLIO_ETH_UDP_TIMEOUT_DFLT);
+        struct timeval tv = {.tv_sec = timeout / 1000,
+            .tv_usec = (timeout % 1000) * 1000};
+        if (timeout > 0 &&
+                setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv)) != 0) {
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN,
+                    "[ll_io_eth] Could not set receive timeout: %s\n", strerror(errno));
+        }
+    }
+}
+
+static long _llio_eth_getenv_long (const char *name, long dflt)
+{
+    const char *value = getenv (name);
+    if (value == NULL || *value == '\0') {
+        return dflt;
+    }
+
+    return strtol (value, NULL, 0);
+}
+
 /* get sockaddr, IPv4 or IPv6: */
 static void *_get_in_addr (struct sockaddr *sa)
 {
@@ -423,11 +580,15 @@ static ssize_t _eth_sendall (int fd, uint8_t *buf, size_t len)
     DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_eth] Sending %lu bytes\n", len);
 
     while (total < len) {
-        n = send (fd, (char *) buf+total, bytesleft, 0);
+        /* A lost connection must fail the send, not kill us with SIGPIPE */
+        n = send (fd, (char *) buf+total, bytesleft, MSG_NOSIGNAL);
         DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_eth] Sent %ld bytes\n", n);
 
         /* On error, don't try to recover, just inform it to the caller*/
         if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
             return -1;
         }
 
@@ -438,20 +599,41 @@ static ssize_t _eth_sendall (int fd, uint8_t *buf, size_t len)
     return total; /* return number actually sent here */
 }
 
-static ssize_t _eth_recvall (int fd, uint8_t *buf, size_t len)
+static ssize_t _eth_recvall (llio_dev_eth_t *self, uint8_t *buf, size_t len)
 {
     size_t total = 0;        /* how many bytes we've recv */
-    size_t bytesleft = len; /* how many we have left to recv */
     ssize_t n;
 
     DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_eth] Receiving %lu bytes\n", len);
 
     while (total < len) {
-        n = recv (fd, (char *) buf+total, bytesleft, 0);
+        size_t bytesleft = len - total; /* how many we have left to recv */
+
+        /* Serve what we already have first */
+        if (self->rx_head < self->rx_tail) {
+            size_t avail = self->rx_tail - self->rx_head;
+            size_t copy = (avail < bytesleft) ? avail : bytesleft;
+            memcpy (buf+total, self->rx_buf+self->rx_head, copy);
+            self->rx_head += copy;
+            total += copy;
+            continue;
+        }
+
+        /* Big TCP reads gain nothing from the extra copy */
+        if (self->type == TCP_ETH_SOCK && bytesleft >= LLIO_ETH_RX_BUF_SIZE) {
+            n = recv (self->fd, (char *) buf+total, bytesleft, 0);
+        }
+        else {
+            /* Take whatever is there, up to a whole datagram */
+            n = recv (self->fd, (char *) self->rx_buf, LLIO_ETH_RX_BUF_SIZE, 0);
+        }
         DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_eth] Received %ld bytes\n", n);
 
         /* On error, don't try to recover, just inform it to the caller*/
         if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
             return -1;
         }
 
@@ -460,8 +642,13 @@ static ssize_t _eth_recvall (int fd, uint8_t *buf, size_t len)
             return -1;
         }
 
-        total += n;
-        bytesleft -= n;
+        if (self->type == TCP_ETH_SOCK && bytesleft >= LLIO_ETH_RX_BUF_SIZE) {
+            total += n;
+        }
+        else {
+            self->rx_head = 0;
+            self->rx_tail = n;
+        }
     }
 
     return total; /* return actual number of bytes sent here */
@@ -5,6 +5,10 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
 #include "ll_io.h"
 
 /* PCIe specifics */
@@ -45,27 +49,127 @@
 #define PCIE_TIMEOUT_PATT_INIT                  0xFF
 /* Number of timeout pattern bytes in a row to detect a timeout */
 #define PCIE_TIMEOUT_PATT_SIZE                  32
+/* Block reads are checked for timeouts, and retried, in chunks of this
+ * size, in bytes. Chunks never cross a BAR page */
+#define PCIE_TIMEOUT_CHUNK_SIZE                 (1 << 16)
+
+/* DMA buffer size, in bytes. This must be allocated as contiguous
+ * kernel memory, so don't make it too big */
+#define PCIE_DMA_BUF_SIZE                       (1 << 20)
+#define PCIE_DMA_MAX_TRIES                      100000
+/* Wait between DMA status polls, in usecs */
+#define PCIE_DMA_WAIT                           10
+
+/* Descriptors of a DMA chain are kept at the end of the DMA buffer, one for
+ * each block of a vectored transfer. The engine fetches them with the same
+ * layout as the channel registers, from PAH to CTRL */
+#define PCIE_DMA_DESC_SIZE                      (sizeof (pcie_dma_desc_t))
+#define PCIE_DMA_DESC_AREA_SIZE                 (LLIO_IOV_MAX * PCIE_DMA_DESC_SIZE)
+
+/* Upstream and Downstream DMA channels have the same register layout. So we
+ * get the address of a register relative to the first one of the channel */
+/* Page register value when we don't know what the device holds */
+#define PCIE_PG_INVALID                         UINT32_MAX
+
+/* Bus addresses the DMA buffer and the caller buffers are mapped at, for
+ * VFIO devices. The IOMMU context is ours only, so any will do */
+#define PCIE_VFIO_DMA_BUF_IOVA                  (1ULL << 32)
+#define PCIE_VFIO_ZC_IOVA                       (1ULL << 36)
+/* Caller buffers of VFIO devices are DMA'ed to/from directly from this
+ * size on, if page aligned. Mapping them costs more than the copy below
+ * it */
+#define PCIE_VFIO_ZC_MIN_SIZE                   (1 << 18)
+/* Largest transfer of a single descriptor */
+#define PCIE_DMA_MAX_XFER_SIZE                  (1 << 24)
+
+#define PCIE_DMA_REG(chan_base, reg)            (BAR0_ADDR | ((chan_base) + \
+                                                    (PCIE_CFG_REG_DMA_US_##reg - \
+                                                     PCIE_CFG_REG_DMA_US_PAH)))
 
 /* Device endpoint */
 typedef struct {
-    pd_device_t *dev;                   /* PCIe device handler */
+    pd_device_t *dev;                   /* PCIe device handler. NULL for VFIO
+                                           devices */
+    llio_vfio_t *vfio;                  /* VFIO device handler. NULL for
+                                           pciDriver devices */
     uint32_t *bar0;                     /* PCIe BAR0 */
     uint32_t bar0_size;                 /* PCIe BAR0 size */
     uint32_t *bar2;                     /* PCIe BAR2 */
     uint32_t bar2_size;                 /* PCIe BAR2 size */
     uint64_t *bar4;                     /* PCIe BAR4 */
     uint32_t bar4_size;                 /* PCIe BAR4 size */
+    pd_kmem_t *dma_kmem;                /* Kernel memory used as DMA buffer */
+    uint32_t *dma_buf;                  /* DMA buffer, mapped to userspace */
+    uint32_t dma_buf_size;              /* DMA buffer size */
+    uint64_t dma_bus_addr;              /* DMA buffer address, as seen by the
+                                           DMA engine */
+    int irq_fd;                         /* Signalled on device interrupts.
+                                           -1 if DMA completions are polled */
+    uint32_t sdram_pg;                  /* Last SDRAM page written to BAR0 */
+    uint32_t wb_pg;                     /* Last Wishbone page written to BAR0 */
+    pthread_mutex_t sdram_lock;         /* Held while the SDRAM page is selected
+                                           and accessed through BAR2 */
+    pthread_mutex_t wb_lock;            /* Held while the Wishbone page is selected
+                                           and accessed through BAR4 */
+    const llio_pcie_copy_ops_t *copy_ops; /* BAR2 block copy kernels */
+    llio_pcie_timeout_stats_t timeout_stats; /* Timeout counters */
 } llio_dev_pcie_t;
 
+/* DMA descriptor in host memory */
+typedef struct {
+    uint32_t pah;                       /* Peripheral (SDRAM) address, high */
+    uint32_t pal;                       /* Peripheral (SDRAM) address, low */
+    uint32_t hah;                       /* Host address, high */
+    uint32_t hal;                       /* Host address, low */
+    uint32_t bdah;                      /* Next descriptor address, high */
+    uint32_t bdal;                      /* Next descriptor address, low */
+    uint32_t leng;                      /* Length in bytes */
+    uint32_t ctrl;                      /* PCIE_CFG_DMA_CTRL_* */
+} pcie_dma_desc_t;
+
+/* Segment of a DMA chain, between the SDRAM and the DMA buffer */
+typedef struct {
+    uint64_t dev_addr;                  /* SDRAM address */
+    uint64_t host_addr;                 /* Host bus address */
+    uint32_t buf_offs;                  /* Offset in the DMA buffer */
+    uint32_t size;                      /* Size in bytes */
+    uint8_t *data;                      /* Caller data */
+} pcie_dma_seg_t;
+
+/* Read/Write a block within a single BAR page */
+typedef ssize_t (*pcie_rw_block_raw_fp) (llio_t *self, uint32_t pg_start,
+        uint64_t pg_offs, uint32_t *data, uint32_t size, int rw);
+
 static uint32_t pcie_timeout_patt [PCIE_TIMEOUT_PATT_SIZE];
 
+static void _pcie_set_sdram_pg (llio_dev_pcie_t *dev_pcie, uint32_t pg);
+static void _pcie_set_wb_pg (llio_dev_pcie_t *dev_pcie, uint32_t pg);
+static void _pcie_invalidate_pg (llio_t *self);
 static ssize_t _pcie_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw);
+static ssize_t _pcie_rw_64 (llio_t *self, uint64_t offs, uint64_t *data, int rw);
 static ssize_t _pcie_rw_bar2_block_raw (llio_t *self, uint32_t pg_start, uint64_t pg_offs,
         uint32_t *data, uint32_t size, int rw);
 static ssize_t _pcie_rw_bar4_block_raw (llio_t *self, uint32_t pg_start, uint64_t pg_offs,
         uint32_t *data, uint32_t size, int rw);
+static ssize_t _pcie_rw_block_td (llio_t *self, pcie_rw_block_raw_fp rw_raw,
+        uint32_t bar_size, uint32_t pg_start, uint64_t pg_offs, uint32_t *data,
+        uint32_t size, int rw);
 static ssize_t _pcie_rw_block (llio_t *self, uint64_t offs, size_t size,
         uint32_t *data, int rw);
+static ssize_t _pcie_rw_dma (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, int rw);
+static ssize_t _pcie_rw_dmav (llio_t *self, const llio_iov_t *iov, size_t iovcnt,
+        int rw);
+static ssize_t _pcie_rw_dma_chain (llio_t *self, const pcie_dma_seg_t *segs,
+        size_t nsegs, uint32_t size, int rw);
+static ssize_t _pcie_dma_xfer (llio_t *self, uint64_t dev_addr,
+        uint64_t host_addr, uint32_t size, int rw);
+static ssize_t _pcie_rw_dma_zc (llio_t *self, uint64_t dev_addr, size_t size,
+        uint8_t *data, int rw);
+static void _pcie_dma_sync (llio_dev_pcie_t *dev_pcie, int rw);
+static void _pcie_dma_wait (llio_dev_pcie_t *dev_pcie);
+static ssize_t _pcie_dma_xfer_chain (llio_t *self, const pcie_dma_seg_t *segs,
+        size_t nsegs, int rw);
 static ssize_t _pcie_timeout_reset (llio_t *self);
 static ssize_t _pcie_reset_fpga (llio_t *self);
 
@@ -76,6 +180,10 @@ static llio_dev_pcie_t * llio_dev_pcie_new (const char *dev_entry)
 {
     llio_dev_pcie_t *self = (llio_dev_pcie_t *) zmalloc (sizeof *self);
     ASSERT_ALLOC (self, err_llio_dev_pcie_alloc);
+    /* pciDriver does not deliver interrupts to userspace */
+    self->irq_fd = -1;
+    pthread_mutex_init (&self->sdram_lock, NULL);
+    pthread_mutex_init (&self->wb_lock, NULL);
 
     self->dev = (pd_device_t *) zmalloc (sizeof *self->dev);
     ASSERT_ALLOC (self->dev, err_dev_pcie_alloc);
@@ -108,12 +216,38 @@ static llio_dev_pcie_t * llio_dev_pcie_new (const char *dev_entry)
     self->bar4_size = pd_getBARsize (self->dev, BAR4NO);
     ASSERT_TEST(self->bar4_size > 0, "Could not get bar4 size", err_bar4_size);
 
+    /* Allocate kernel memory for DMA transfers. This is not fatal, as we
+     * can always fallback to regular BAR accesses */
+    self->dma_kmem = (pd_kmem_t *) zmalloc (sizeof *self->dma_kmem);
+    ASSERT_ALLOC (self->dma_kmem, err_dma_kmem_alloc);
+    self->dma_buf = (uint32_t *) pd_allocKernelMemory (self->dev, PCIE_DMA_BUF_SIZE,
+            self->dma_kmem);
+    if (self->dma_buf == NULL) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN, "[ll_io_pcie] Could not allocate "
+                "DMA buffer. DMA transfers will fallback to BAR accesses\n");
+        free (self->dma_kmem);
+        self->dma_kmem = NULL;
+        self->dma_buf_size = 0;
+    }
+    else {
+        self->dma_buf_size = PCIE_DMA_BUF_SIZE;
+        self->dma_bus_addr = (uint64_t) self->dma_kmem->pa;
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_pcie] DMA buffer addr = %p, "
+                "size = %u\n", self->dma_buf, self->dma_buf_size);
+    }
+
+    /* Pick the fastest BAR2 copy kernel for this CPU */
+    self->copy_ops = llio_pcie_copy_get_ops ();
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io_pcie] Using %s BAR2 copy kernel\n",
+            self->copy_ops->name);
+
     /* Initialize PCIE timeout pattern */
     memset (&pcie_timeout_patt, PCIE_TIMEOUT_PATT_INIT, sizeof (pcie_timeout_patt));
     DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_pcie] Created instance of llio_dev_pcie\n");
 
     return self;
 
+err_dma_kmem_alloc:
 err_bar4_size:
 err_bar2_size:
 err_bar0_size:
@@ -127,6 +261,70 @@ err_bar0_alloc:
 err_dev_pcie_open:
     free (self->dev);
 err_dev_pcie_alloc:
+    pthread_mutex_destroy (&self->wb_lock);
+    pthread_mutex_destroy (&self->sdram_lock);
+    free (self);
+err_llio_dev_pcie_alloc:
+    return NULL;
+}
+
+/* Creates a new instance of the dev_pcie, accessed through VFIO */
+static llio_dev_pcie_t * llio_dev_vfio_new (const char *pci_addr)
+{
+    llio_dev_pcie_t *self = (llio_dev_pcie_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC (self, err_llio_dev_pcie_alloc);
+    self->irq_fd = -1;
+    pthread_mutex_init (&self->sdram_lock, NULL);
+    pthread_mutex_init (&self->wb_lock, NULL);
+
+    self->vfio = llio_vfio_new (pci_addr);
+    ASSERT_TEST(self->vfio != NULL, "Error opening VFIO device", err_dev_vfio_open);
+
+    /* BARs are unmapped by llio_vfio_destroy () */
+    self->bar0 = (uint32_t *) llio_vfio_map_bar (self->vfio, BAR0NO, &self->bar0_size);
+    ASSERT_TEST(self->bar0!=NULL, "Could not map bar0", err_bar_map);
+    self->bar2 = (uint32_t *) llio_vfio_map_bar (self->vfio, BAR2NO, &self->bar2_size);
+    ASSERT_TEST(self->bar2!=NULL, "Could not map bar2", err_bar_map);
+    self->bar4 = (uint64_t *) llio_vfio_map_bar (self->vfio, BAR4NO, &self->bar4_size);
+    ASSERT_TEST(self->bar4!=NULL, "Could not map bar4", err_bar_map);
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_pcie] BAR2 addr = %p, "
+            "BAR4 addr = %p\n", self->bar2, self->bar4);
+
+    /* Any memory will do for the DMA buffer, as the IOMMU maps it
+     * contiguously for the device. This is not fatal either */
+    void *dma_buf = mmap (NULL, PCIE_DMA_BUF_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (dma_buf != MAP_FAILED && llio_vfio_dma_map (self->vfio, dma_buf,
+                PCIE_DMA_BUF_SIZE, PCIE_VFIO_DMA_BUF_IOVA) == 0) {
+        self->dma_buf = (uint32_t *) dma_buf;
+        self->dma_buf_size = PCIE_DMA_BUF_SIZE;
+        self->dma_bus_addr = PCIE_VFIO_DMA_BUF_IOVA;
+    }
+    else {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN, "[ll_io_pcie] Could not map "
+                "DMA buffer. DMA transfers will fallback to BAR accesses\n");
+        if (dma_buf != MAP_FAILED) {
+            munmap (dma_buf, PCIE_DMA_BUF_SIZE);
+        }
+    }
+
+    self->irq_fd = llio_vfio_get_irq_fd (self->vfio);
+
+    self->copy_ops = llio_pcie_copy_get_ops ();
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io_pcie] Using %s BAR2 copy kernel\n",
+            self->copy_ops->name);
+
+    memset (&pcie_timeout_patt, PCIE_TIMEOUT_PATT_INIT, sizeof (pcie_timeout_patt));
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_pcie] Created instance of "
+            "llio_dev_pcie through VFIO\n");
+
+    return self;
+
+err_bar_map:
+    llio_vfio_destroy (&self->vfio);
+err_dev_vfio_open:
+    pthread_mutex_destroy (&self->wb_lock);
+    pthread_mutex_destroy (&self->sdram_lock);
     free (self);
 err_llio_dev_pcie_alloc:
     return NULL;
@@ -138,12 +336,32 @@ static llio_err_e llio_dev_pcie_destroy (llio_dev_pcie_t **self_p)
     if (*self_p) {
         llio_dev_pcie_t *self = *self_p;
 
-        /* Unmap all bars first and then destroy the remaining structures */
+        if (self->vfio != NULL) {
+            /* The DMA mappings go away with the device */
+            llio_vfio_destroy (&self->vfio);
+            if (self->dma_buf != NULL) {
+                munmap (self->dma_buf, self->dma_buf_size);
+            }
+            pthread_mutex_destroy (&self->wb_lock);
+            pthread_mutex_destroy (&self->sdram_lock);
+            free (self);
+            self_p = NULL;
+            return LLIO_SUCCESS;
+        }
+
+        /* Free DMA buffer, unmap all bars and then destroy the remaining
+         * structures */
+        if (self->dma_kmem != NULL) {
+            pd_freeKernelMemory (self->dma_kmem);
+            free (self->dma_kmem);
+        }
         pd_unmapBAR (self->dev, BAR4NO, self->bar4);
         pd_unmapBAR (self->dev, BAR2NO, self->bar2);
         pd_unmapBAR (self->dev, BAR0NO, self->bar0);
         pd_close (self->dev);
 
+        pthread_mutex_destroy (&self->wb_lock);
+        pthread_mutex_destroy (&self->sdram_lock);
         free (self->dev);
         free (self);
 
@@ -155,8 +373,8 @@ static llio_err_e llio_dev_pcie_destroy (llio_dev_pcie_t **self_p)
 
 /************ llio_ops_pcie Implementation **********/
 
-/* Open PCIe device */
-static int pcie_open (llio_t *self, llio_endpoint_t *endpoint)
+/* Open PCIe device, through pciDriver or VFIO */
+static int _pcie_open (llio_t *self, llio_endpoint_t *endpoint, bool vfio)
 {
     if (llio_get_endpoint_open (self)) {
         /* Device is already opened. So, we return success */
@@ -172,13 +390,17 @@ static int pcie_open (llio_t *self, llio_endpoint_t *endpoint)
     }
 
     /* Create new private PCIe handler */
-    llio_dev_pcie_t *dev_pcie = llio_dev_pcie_new (llio_get_endpoint_name (self));
+    llio_dev_pcie_t *dev_pcie = vfio ?
+        llio_dev_vfio_new (llio_get_endpoint_name (self)) :
+        llio_dev_pcie_new (llio_get_endpoint_name (self));
     ASSERT_TEST(dev_pcie != NULL, "Could not allocate dev_handler",
-            err_dev_handler_alloc);
+            err_dev_handler_alloc, -1);
 
     /* Initialize Wishbone and SDRAM pages to 0 */
-    SET_SDRAM_PG(dev_pcie->bar0, 0);
-    SET_WB_PG(dev_pcie->bar0, 0);
+    dev_pcie->sdram_pg = PCIE_PG_INVALID;
+    dev_pcie->wb_pg = PCIE_PG_INVALID;
+    _pcie_set_sdram_pg (dev_pcie, 0);
+    _pcie_set_wb_pg (dev_pcie, 0);
 
     /* Attach this PCIe device to LLIO instance */
     llio_set_dev_handler (self, dev_pcie);
@@ -194,6 +416,13 @@ static int pcie_open (llio_t *self, llio_endpoint_t *endpoint)
     /* Reset PCIe Timeout */
     _pcie_timeout_reset (self);
 
+    /* Let the FPGA interrupt us, so DMA completions wake us up right
+     * away */
+    if (dev_pcie->irq_fd >= 0) {
+        uint32_t data = 1;
+        _pcie_rw_32 (self, BAR0_ADDR | PCIE_CFG_REG_IRQ_EN, &data, WRITE_TO_BAR);
+    }
+
     return err;
 
 err_dev_handler_alloc:
@@ -201,6 +430,17 @@ err_endpoint_set:
     return err;
 }
 
+static int pcie_open (llio_t *self, llio_endpoint_t *endpoint)
+{
+    return _pcie_open (self, endpoint, false);
+}
+
+/* Open PCIe device through VFIO */
+static int vfio_open (llio_t *self, llio_endpoint_t *endpoint)
+{
+    return _pcie_open (self, endpoint, true);
+}
+
 /* Release PCIe device */
 static int pcie_release (llio_t *self, llio_endpoint_t *endpoint)
 {
@@ -217,6 +457,19 @@ static int pcie_release (llio_t *self, llio_endpoint_t *endpoint)
     ASSERT_TEST(dev_pcie != NULL, "Could not get PCIe handler",
             err_dev_pcie_handler, -1);
 
+    const llio_pcie_timeout_stats_t *stats = &dev_pcie->timeout_stats;
+    if (stats->timeouts > 0) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN,
+                "[ll_io_pcie] %"PRIu64" timeouts in %"PRIu64" chunk reads, "
+                "%"PRIu64" recovered, %"PRIu64" failed\n", stats->timeouts,
+                stats->chunks, stats->recovered, stats->failures);
+    }
+
+    if (dev_pcie->irq_fd >= 0) {
+        uint32_t data = 0;
+        _pcie_rw_32 (self, BAR0_ADDR | PCIE_CFG_REG_IRQ_EN, &data, WRITE_TO_BAR);
+    }
+
     /* Deattach specific device handler to generic one */
     lerr = llio_dev_pcie_destroy (&dev_pcie);
     ASSERT_TEST (lerr==LLIO_SUCCESS, "Could not close device appropriately",
@@ -247,11 +500,7 @@ static ssize_t pcie_read_32 (llio_t *self, uint64_t offs, uint32_t *data)
 
 static ssize_t pcie_read_64 (llio_t *self, uint64_t offs, uint64_t *data)
 {
-    return _pcie_rw_32 (self, offs,
-            (uint32_t *) data, READ_FROM_BAR)
-            +
-            _pcie_rw_32 (self, offs,
-            (uint32_t *)((uint8_t *) data + sizeof (uint32_t)), READ_FROM_BAR);
+    return _pcie_rw_64 (self, offs, data, READ_FROM_BAR);
 }
 
 /* Write data to PCIe device */
@@ -264,11 +513,7 @@ static ssize_t pcie_write_32 (llio_t *self, uint64_t offs, const uint32_t *data)
 static ssize_t pcie_write_64 (llio_t *self, uint64_t offs, const uint64_t *data)
 {
     uint64_t _data = *data;
-    return _pcie_rw_32 (self, offs,
-            (uint32_t *) &_data, WRITE_TO_BAR)
-            +
-            _pcie_rw_32 (self, offs,
-            (uint32_t *)((uint8_t *) &_data + sizeof (uint32_t)), WRITE_TO_BAR);
+    return _pcie_rw_64 (self, offs, &_data, WRITE_TO_BAR);
 }
 
 /* Read data block from PCIe device, size in bytes */
@@ -284,24 +529,30 @@ static ssize_t pcie_write_block (llio_t *self, uint64_t offs, size_t size, uint3
     return _pcie_rw_block (self, offs, size, data, WRITE_TO_BAR);
 }
 
-/* Read data block from PCIe device, size in bytes */
+/* Read data block via DMA from PCIe device, size in bytes */
 static ssize_t pcie_read_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
 {
-    (void) self;
-    (void) offs;
-    (void) size;
-    (void) data;
-    return -1;
+    return _pcie_rw_dma (self, offs, size, data, READ_FROM_BAR);
 }
 
-/* Write data block from PCIe device, size in bytes */
+/* Write data block via DMA from PCIe device, size in bytes */
 static ssize_t pcie_write_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
 {
-    (void) self;
-    (void) offs;
-    (void) size;
-    (void) data;
-    return -1;
+    /* _pcie_rw_dma with WRITE_TO_BAR does not modify "data" */
+    return _pcie_rw_dma (self, offs, size, data, WRITE_TO_BAR);
+}
+
+/* Read data blocks from PCIe device, with a single DMA chain */
+static ssize_t pcie_read_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt)
+{
+    return _pcie_rw_dmav (self, iov, iovcnt, READ_FROM_BAR);
+}
+
+/* Write data blocks to PCIe device, with a single DMA chain */
+static ssize_t pcie_write_blockv (llio_t *self, const llio_iov_t *iov, size_t iovcnt)
+{
+    /* _pcie_rw_dmav with WRITE_TO_BAR does not modify the blocks */
+    return _pcie_rw_dmav (self, iov, iovcnt, WRITE_TO_BAR);
 }
 
 /* Read PCIe device information */
@@ -314,6 +565,40 @@ static ssize_t pcie_write_dma (llio_t *self, uint64_t offs, size_t size, uint32_
 */
 
 /************ Helper functions **********/
+
+/* Page registers are only written when the page changes. This saves a
+ * posted write to BAR0 for every access to an already selected page */
+static void _pcie_set_sdram_pg (llio_dev_pcie_t *dev_pcie, uint32_t pg)
+{
+    if (dev_pcie->sdram_pg != pg) {
+        SET_SDRAM_PG (dev_pcie->bar0, pg);
+        dev_pcie->sdram_pg = pg;
+    }
+}
+
+static void _pcie_set_wb_pg (llio_dev_pcie_t *dev_pcie, uint32_t pg)
+{
+    if (dev_pcie->wb_pg != pg) {
+        SET_WB_PG (dev_pcie->bar0, pg);
+        dev_pcie->wb_pg = pg;
+    }
+}
+
+/* Forget the cached pages, so the next access writes them again. Used
+ * whenever the FPGA might have lost them */
+static void _pcie_invalidate_pg (llio_t *self)
+{
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    if (dev_pcie != NULL) {
+        pthread_mutex_lock (&dev_pcie->sdram_lock);
+        dev_pcie->sdram_pg = PCIE_PG_INVALID;
+        pthread_mutex_unlock (&dev_pcie->sdram_lock);
+        pthread_mutex_lock (&dev_pcie->wb_lock);
+        dev_pcie->wb_pg = PCIE_PG_INVALID;
+        pthread_mutex_unlock (&dev_pcie->wb_lock);
+    }
+}
+
 static ssize_t _pcie_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw)
 {
     assert (self);
@@ -352,7 +637,8 @@ static ssize_t _pcie_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw)
                     "[ll_io_pcie:_pcie_rw_32] Going to read/write in BAR2\n");
             pg_num = PCIE_ADDR_SDRAM_PG (full_offs);
             pg_offs = PCIE_ADDR_SDRAM_PG_OFFS (full_offs);
-            SET_SDRAM_PG (dev_pcie->bar0, pg_num);
+            pthread_mutex_lock (&dev_pcie->sdram_lock);
+            _pcie_set_sdram_pg (dev_pcie, pg_num);
             DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
                     "[ll_io_pcie:_pcie_rw_32] bar_no = %d, pg_num  = %d,\n\tfull_offs = 0x%lx, pg_offs = 0x%lx\n",
                     bar_no, pg_num, full_offs, pg_offs);
@@ -361,6 +647,7 @@ static ssize_t _pcie_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw)
                     "-------------------------------------------------------------------------------------\n",
                     ((llio_dev_pcie_t *) llio_get_dev_handler (self))->bar2 + pg_offs);
             BAR2_RW(dev_pcie->bar2, pg_offs, data, rw);
+            pthread_mutex_unlock (&dev_pcie->sdram_lock);
             break;
 
         /* FPGA Wishbone */
@@ -370,7 +657,8 @@ static ssize_t _pcie_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw)
                     "[ll_io_pcie:_pcie_rw_32] Going to read/write in BAR4\n");
             pg_num = PCIE_ADDR_WB_PG (full_offs);
             pg_offs = PCIE_ADDR_WB_PG_OFFS (full_offs);
-            SET_WB_PG (dev_pcie->bar0, pg_num);
+            pthread_mutex_lock (&dev_pcie->wb_lock);
+            _pcie_set_wb_pg (dev_pcie, pg_num);
             DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
                     "[ll_io_pcie:_pcie_rw_32] bar_no = %d, pg_num  = %d,\n\tfull_offs = 0x%lx, pg_offs = 0x%lx\n",
                     bar_no, pg_num, full_offs, pg_offs);
@@ -379,6 +667,7 @@ static ssize_t _pcie_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw)
                     "-------------------------------------------------------------------------------------\n",
                     ((llio_dev_pcie_t *) llio_get_dev_handler (self))->bar4 + pg_offs);
             BAR4_RW(dev_pcie->bar4, pg_offs, data, rw);
+            pthread_mutex_unlock (&dev_pcie->wb_lock);
             break;
 
         /* Invalid BAR */
@@ -394,6 +683,72 @@ err_endp_open:
     return err;
 }
 
+/* 64-bit data is the 32-bit word at "offs" (low) followed by the one at
+ * "offs" + 4 (high). BAR0 and BAR2 are byte addressed, so an aligned
+ * access is a single 8-byte load/store. On BAR4 each Wishbone word has a
+ * 64-bit slot of its own (see BAR4_RW), so there it takes two accesses,
+ * within the same page */
+static ssize_t _pcie_rw_64 (llio_t *self, uint64_t offs, uint64_t *data, int rw)
+{
+    assert (self);
+    int err = sizeof (*data);
+    ASSERT_TEST(llio_get_endpoint_open (self), "Could not perform RW operation. Device is not opened",
+            err_endp_open, -1);
+
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_pcie != NULL, "Could not get PCIe handler",
+            err_dev_pcie_handler, -1);
+
+    int bar_no = PCIE_ADDR_BAR (offs);
+    uint64_t full_offs = PCIE_ADDR_GEN (offs);
+    uint32_t *data_32 = (uint32_t *) data;
+
+    /* Unaligned accesses might cross a page, which only the 32-bit path
+     * handles */
+    if (full_offs % sizeof (*data) != 0) {
+        ssize_t lo = _pcie_rw_32 (self, offs, data_32, rw);
+        ssize_t hi = _pcie_rw_32 (self, offs + sizeof (uint32_t), data_32 + 1, rw);
+        return (lo < 0 || hi < 0) ? -1 : lo + hi;
+    }
+
+    uint64_t pg_offs;
+    switch (bar_no) {
+        /* PCIe config registers */
+        case BAR0NO:
+            BAR0_RW_64(dev_pcie->bar0, full_offs, data, rw);
+            break;
+
+        /* FPGA SDRAM */
+        case BAR2NO:
+            pthread_mutex_lock (&dev_pcie->sdram_lock);
+            _pcie_set_sdram_pg (dev_pcie, PCIE_ADDR_SDRAM_PG (full_offs));
+            pg_offs = PCIE_ADDR_SDRAM_PG_OFFS (full_offs);
+            BAR2_RW_64(dev_pcie->bar2, pg_offs, data, rw);
+            pthread_mutex_unlock (&dev_pcie->sdram_lock);
+            break;
+
+        /* FPGA Wishbone */
+        case BAR4NO:
+            pthread_mutex_lock (&dev_pcie->wb_lock);
+            _pcie_set_wb_pg (dev_pcie, PCIE_ADDR_WB_PG (full_offs));
+            pg_offs = PCIE_ADDR_WB_PG_OFFS (full_offs);
+            BAR4_RW(dev_pcie->bar4, pg_offs, data_32, rw);
+            BAR4_RW(dev_pcie->bar4, pg_offs + sizeof (uint32_t), data_32 + 1, rw);
+            pthread_mutex_unlock (&dev_pcie->wb_lock);
+            break;
+
+        /* Invalid BAR */
+        default:
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+                    "[ll_io_pcie:_pcie_rw_64] Invalid BAR access\n");
+            return -1;
+    }
+
+err_dev_pcie_handler:
+err_endp_open:
+    return err;
+}
+
 static ssize_t _pcie_rw_bar2_block_raw (llio_t *self, uint32_t pg_start, uint64_t pg_offs,
         uint32_t *data, uint32_t size, int rw)
 {
@@ -416,22 +771,28 @@ static ssize_t _pcie_rw_bar2_block_raw (llio_t *self, uint32_t pg_start, uint64_
     for (unsigned int pg = pg_start;
             pg < (pg_start + (pg_offs+size)/bar_size + 1);
             ++pg) {
-        SET_SDRAM_PG (dev_pcie->bar0, pg);
+        /* Locked a page at a time, so single accesses from the other
+         * threads get in between the pages */
+        pthread_mutex_lock (&dev_pcie->sdram_lock);
+        _pcie_set_sdram_pg (dev_pcie, pg);
         uint32_t num_bytes_page = (offs + num_bytes_rem > bar_size) ?
             (bar_size-offs) : (num_bytes_rem);
         num_bytes_rem -= num_bytes_page;
         num_bytes_rw += num_bytes_page;
 
-        DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
-            "[ll_io_pcie:_pcie_rw_bar2_block_raw] offs = %u, num_bytes_rem = %u,\n"
-            "bar_size = %u, num_byte_page = %u\n", offs, num_bytes_rem, bar_size,
-            num_bytes_page);
-        DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
-                "[ll_io_pcie:_pcie_rw_bar2_block_raw] Reading %u bytes from addr: %p\n"
-                "-------------------------------------------------------------------------------------\n",
-                num_bytes_page, dev_pcie->bar2);
-        BAR2_RW_BLOCK(dev_pcie->bar2, offs, num_bytes_page,
-                datap, rw);
+        /* Called for every page, so keep it off the text log */
+        DBE_TRACE (DBG_LL_IO | DBG_LVL_TRACE,
+            "[ll_io_pcie:_pcie_rw_bar2_block_raw] pg = %u, offs = %u, "
+            "num_bytes_rem = %u, num_bytes_page = %u\n", pg, offs,
+            num_bytes_rem, num_bytes_page);
+        uint8_t *barp = (uint8_t *) dev_pcie->bar2 + offs;
+        if (rw == READ_FROM_BAR) {
+            dev_pcie->copy_ops->from_bar (datap, barp, num_bytes_page);
+        }
+        else {
+            dev_pcie->copy_ops->to_bar (barp, datap, num_bytes_page);
+        }
+        pthread_mutex_unlock (&dev_pcie->sdram_lock);
         datap = (uint32_t *)((uint8_t *)datap + num_bytes_page);
 
         /* Always 0 after the first page */
@@ -443,40 +804,83 @@ err_dev_pcie_handler:
     return err;
 }
 
-/* Read/Write BAR2 block with timeout detection */
-static ssize_t _pcie_rw_bar2_block_td (llio_t *self, uint32_t pg_start, uint64_t pg_offs,
-        uint32_t *data, uint32_t size, int rw)
+/* Read/Write block with timeout detection. A timeout makes the PCIe core
+ * return the timeout pattern from then on, until it is reset, so checking the
+ * end of each chunk catches one that started anywhere in it. Only the chunk
+ * that timed out is read again */
+static ssize_t _pcie_rw_block_td (llio_t *self, pcie_rw_block_raw_fp rw_raw,
+        uint32_t bar_size, uint32_t pg_start, uint64_t pg_offs, uint32_t *data,
+        uint32_t size, int rw)
 {
-    size_t num_bytes_rw = 0;
+    ssize_t err = 0;
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_pcie != NULL, "Could not get PCIe handler",
+            err_dev_pcie_handler, -1);
+
+    /* Writes can't be checked. Do them in one go */
+    if (rw != READ_FROM_BAR) {
+        return rw_raw (self, pg_start, pg_offs, data, size, rw);
+    }
+
+    llio_pcie_timeout_stats_t *stats = &dev_pcie->timeout_stats;
+    uint32_t num_bytes_rw = 0;
+
+    while (num_bytes_rw < size) {
+        uint64_t offs = pg_offs + num_bytes_rw;
+        uint32_t chunk_pg = pg_start + offs / bar_size;
+        uint32_t chunk_offs = offs % bar_size;
+        uint32_t chunk_size = size - num_bytes_rw;
+        if (chunk_size > PCIE_TIMEOUT_CHUNK_SIZE) {
+            chunk_size = PCIE_TIMEOUT_CHUNK_SIZE;
+        }
+        if (chunk_size > bar_size - chunk_offs) {
+            chunk_size = bar_size - chunk_offs;
+        }
+
+        uint8_t *chunk = (uint8_t *) data + num_bytes_rw;
+        ++stats->chunks;
 
-    uint32_t i;
-    for (i = 0; i < PCIE_TIMEOUT_MAX_TRIES; ++i) {
-        num_bytes_rw = _pcie_rw_bar2_block_raw (self, pg_start, pg_offs, data,
-                size, rw);
+        uint32_t i;
+        for (i = 0; i < PCIE_TIMEOUT_MAX_TRIES; ++i) {
+            err = rw_raw (self, chunk_pg, chunk_offs, (uint32_t *) chunk,
+                    chunk_size, rw);
+            ASSERT_TEST(err == (ssize_t) chunk_size, "Could not read chunk",
+                    err_rw_raw, -1);
 
-        /* If sufficient number of bytes read, try to detect a PCIe core
-         * timeout by reading specified number of words and comparing to
-         * the timeout pattern */
-        if (num_bytes_rw >= PCIE_TIMEOUT_PATT_SIZE && !memcmp (data,
-                    pcie_timeout_patt, PCIE_TIMEOUT_PATT_SIZE)) {
+            /* Chunks too small to hold the pattern are not checked */
+            if (chunk_size < PCIE_TIMEOUT_PATT_SIZE || memcmp (chunk + chunk_size -
+                        PCIE_TIMEOUT_PATT_SIZE, pcie_timeout_patt,
+                        PCIE_TIMEOUT_PATT_SIZE)) {
+                break;
+            }
+
+            ++stats->timeouts;
             DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
-                    "[ll_io_pcie:_pcie_rw_bar2_td] Timeout detected. Retrying\n");
+                    "[ll_io_pcie:_pcie_rw_block_td] Timeout detected on page %u, "
+                    "offset 0x%x. Retrying\n", chunk_pg, chunk_offs);
             _pcie_timeout_reset (self);
             usleep (PCIE_TIMEOUT_WAIT);
         }
-        else {
-            break;
+
+        if (i >= PCIE_TIMEOUT_MAX_TRIES) {
+            ++stats->failures;
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+                    "[ll_io_pcie:_pcie_rw_block_td] Unrecoverable timeout detected. "
+                    "Exceeded maximum number of tries\n");
+            return -1;
         }
-    }
 
-    if (i >= PCIE_TIMEOUT_MAX_TRIES) {
-        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
-                "[ll_io_pcie:_pcie_rw_bar2_td] Unrecoverable timeout detected. Exceeded "
-                "maximum number of tries\n");
-        return -1;
+        if (i > 0) {
+            ++stats->recovered;
+        }
+        num_bytes_rw += chunk_size;
     }
 
     return num_bytes_rw;
+
+err_rw_raw:
+err_dev_pcie_handler:
+    return err;
 }
 
 static ssize_t _pcie_rw_bar4_block_raw (llio_t *self, uint32_t pg_start, uint64_t pg_offs,
@@ -500,7 +904,8 @@ static ssize_t _pcie_rw_bar4_block_raw (llio_t *self, uint32_t pg_start, uint64_
     for (unsigned int pg = pg_start;
             pg < pg_start + (pg_offs+size)/bar_size + 1;
             ++pg) {
-        SET_WB_PG (dev_pcie->bar0, pg);
+        pthread_mutex_lock (&dev_pcie->wb_lock);
+        _pcie_set_wb_pg (dev_pcie, pg);
         uint32_t num_bytes_page = (num_bytes_rem > bar_size) ?
             (bar_size-offs) : (num_bytes_rem);
         num_bytes_rem -= num_bytes_page;
@@ -512,6 +917,7 @@ static ssize_t _pcie_rw_bar4_block_raw (llio_t *self, uint32_t pg_start, uint64_
                 num_bytes_page, dev_pcie->bar4);
         BAR4_RW_BLOCK(dev_pcie->bar4, offs, num_bytes_page,
                 (uint32_t *)((uint8_t *)data + (pg-pg_start)*bar_size), rw);
+        pthread_mutex_unlock (&dev_pcie->wb_lock);
 
         /* Always 0 after the first page */
         offs = 0;
@@ -522,43 +928,6 @@ err_dev_pcie_handler:
     return err;
 }
 
-/* Read/Write BAR4 block with timeout detection.
- * FIXME: Reduce code repetition. _pcie_rw_bar2_block_td () is almost the same */
-static ssize_t _pcie_rw_bar4_block_td (llio_t *self, uint32_t pg_start, uint64_t pg_offs,
-        uint32_t *data, uint32_t size, int rw)
-{
-    size_t num_bytes_rw = 0;
-
-    uint32_t i;
-    for (i = 0; i < PCIE_TIMEOUT_MAX_TRIES; ++i) {
-        num_bytes_rw = _pcie_rw_bar4_block_raw (self, pg_start, pg_offs, data,
-                size, rw);
-
-        /* If sufficient number of bytes read, try to detect a PCIe core
-         * timeout by reading specified number of words and comparing to
-         * the timeout pattern */
-        if (num_bytes_rw >= PCIE_TIMEOUT_PATT_SIZE && !memcmp (data,
-                    pcie_timeout_patt, PCIE_TIMEOUT_PATT_SIZE)) {
-            DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
-                    "[ll_io_pcie:_pcie_rw_bar4_td] Timeout detected. Retrying\n");
-            _pcie_timeout_reset (self);
-            usleep (PCIE_TIMEOUT_WAIT);
-        }
-        else {
-            break;
-        }
-    }
-
-    if (i >= PCIE_TIMEOUT_MAX_TRIES) {
-        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
-                "[ll_io_pcie:_pcie_rw_bar4_td] Unrecoverable timeout detected. Exceeded "
-                "maximum number of tries\n");
-        return -1;
-    }
-
-    return num_bytes_rw;
-}
-
 static ssize_t _pcie_rw_block (llio_t *self, uint64_t offs, size_t size, uint32_t *data, int rw)
 {
     assert (self);
@@ -596,7 +965,8 @@ static ssize_t _pcie_rw_block (llio_t *self, uint64_t offs, size_t size, uint32_
                     "[ll_io_pcie:_pcie_rw_block] full_addr = 0x%p\n"
                     "-------------------------------------------------------------------------------------\n",
                     dev_pcie->bar2 + pg_offs);
-            err = _pcie_rw_bar2_block_td (self, pg_start, pg_offs, data, size, rw);
+            err = _pcie_rw_block_td (self, _pcie_rw_bar2_block_raw,
+                    dev_pcie->bar2_size, pg_start, pg_offs, data, size, rw);
             break;
 
         /* FPGA Wishbone */
@@ -613,7 +983,8 @@ static ssize_t _pcie_rw_block (llio_t *self, uint64_t offs, size_t size, uint32_
                     "[ll_io_pcie:_pcie_rw_block] full_addr = %p\n"
                     "-------------------------------------------------------------------------------------\n",
                     dev_pcie->bar4 + pg_offs);
-            err =  _pcie_rw_bar4_block_td (self, pg_start, pg_offs, data, size, rw);
+            err = _pcie_rw_block_td (self, _pcie_rw_bar4_block_raw,
+                    dev_pcie->bar4_size, pg_start, pg_offs, data, size, rw);
             break;
 
         /* Invalid BAR */
@@ -629,6 +1000,377 @@ err_endp_open:
     return err;
 }
 
+/* Read/Write block via DMA. Only the FPGA SDRAM (BAR2) is reachable by the
+ * DMA engine, so everything else falls back to regular BAR accesses */
+static ssize_t _pcie_rw_dma (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, int rw)
+{
+    assert (self);
+    ssize_t err = 0;
+    ASSERT_TEST(llio_get_endpoint_open (self), "Could not perform DMA operation. Device is not opened",
+            err_endp_open, -1);
+
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_pcie != NULL, "Could not get PCIe handler",
+            err_dev_pcie_handler, -1);
+
+    if (PCIE_ADDR_BAR (offs) != BAR2NO || dev_pcie->dma_buf == NULL) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
+                "[ll_io_pcie:_pcie_rw_dma] DMA not available for this address. "
+                "Falling back to BAR access\n");
+        return _pcie_rw_block (self, offs, size, data, rw);
+    }
+
+    /* The DMA engine sees the SDRAM linearly, so no paging is needed here */
+    uint64_t dev_addr = PCIE_ADDR_GEN (offs);
+    size_t num_bytes_rem = size;
+    uint8_t *datap = (uint8_t *) data;
+
+    /* Through VFIO, large enough caller buffers are DMA'ed to/from
+     * directly, without the copy */
+    if (dev_pcie->vfio != NULL && size >= PCIE_VFIO_ZC_MIN_SIZE &&
+            (uintptr_t) datap % sysconf (_SC_PAGESIZE) == 0) {
+        err = _pcie_rw_dma_zc (self, dev_addr, size, datap, rw);
+        /* 0 if it could not be mapped. Go through the DMA buffer then */
+        if (err != 0) {
+            return err;
+        }
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
+            "----------------------------------------------------------\n"
+            "[ll_io_pcie:_pcie_rw_dma] dev_addr = 0x%"PRIx64", size = %zu\n",
+            dev_addr, size);
+    while (num_bytes_rem > 0) {
+        uint32_t num_bytes_chunk = (num_bytes_rem > dev_pcie->dma_buf_size) ?
+            dev_pcie->dma_buf_size : num_bytes_rem;
+
+        if (rw == WRITE_TO_BAR) {
+            memcpy (dev_pcie->dma_buf, datap, num_bytes_chunk);
+            _pcie_dma_sync (dev_pcie, WRITE_TO_BAR);
+        }
+
+        ssize_t num_bytes_xfer = _pcie_dma_xfer (self, dev_addr,
+                dev_pcie->dma_bus_addr, num_bytes_chunk, rw);
+        ASSERT_TEST(num_bytes_xfer == (ssize_t) num_bytes_chunk, "DMA transfer failed",
+                err_dma_xfer, -1);
+
+        if (rw == READ_FROM_BAR) {
+            _pcie_dma_sync (dev_pcie, READ_FROM_BAR);
+            memcpy (datap, dev_pcie->dma_buf, num_bytes_chunk);
+        }
+
+        datap += num_bytes_chunk;
+        dev_addr += num_bytes_chunk;
+        num_bytes_rem -= num_bytes_chunk;
+    }
+
+    err = size;
+
+err_dma_xfer:
+err_dev_pcie_handler:
+err_endp_open:
+    return err;
+}
+
+/* Read/Write blocks via DMA. Each DMA chain moves as many of the blocks as
+ * fit in the DMA buffer, so a whole curve usually takes a single one. Blocks
+ * out of the FPGA SDRAM can't be reached by the DMA engine and fall back to
+ * regular BAR accesses, one at a time */
+static ssize_t _pcie_rw_dmav (llio_t *self, const llio_iov_t *iov, size_t iovcnt,
+        int rw)
+{
+    assert (self);
+    assert (iov);
+    ssize_t err = 0;
+    ASSERT_TEST(llio_get_endpoint_open (self), "Could not perform DMA operation. Device is not opened",
+            err_endp_open, -1);
+
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_pcie != NULL, "Could not get PCIe handler",
+            err_dev_pcie_handler, -1);
+
+    bool dma_avail = dev_pcie->dma_buf != NULL &&
+        dev_pcie->dma_buf_size > PCIE_DMA_DESC_AREA_SIZE;
+    size_t i;
+    for (i = 0; i < iovcnt && dma_avail; ++i) {
+        dma_avail = PCIE_ADDR_BAR (iov [i].offs) == BAR2NO;
+    }
+
+    ssize_t total = 0;
+    if (!dma_avail) {
+        for (i = 0; i < iovcnt; ++i) {
+            ssize_t ret = _pcie_rw_dma (self, iov [i].offs, iov [i].size,
+                    iov [i].data, rw);
+            ASSERT_TEST(ret == (ssize_t) iov [i].size, "Block transfer failed",
+                    err_rw_block, -1);
+            total += ret;
+        }
+
+        err = total;
+        goto err_rw_block;
+    }
+
+    const uint32_t data_area = dev_pcie->dma_buf_size - PCIE_DMA_DESC_AREA_SIZE;
+    pcie_dma_seg_t segs [LLIO_IOV_MAX];
+    size_t nsegs = 0;
+    uint32_t buf_used = 0;
+    size_t ext_done = 0;
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
+            "----------------------------------------------------------\n"
+            "[ll_io_pcie:_pcie_rw_dmav] %zu blocks\n", iovcnt);
+    i = 0;
+    while (i < iovcnt) {
+        /* Blocks larger than what is left of the DMA buffer span chains */
+        size_t size = iov [i].size - ext_done;
+        if (size > data_area - buf_used) {
+            size = data_area - buf_used;
+        }
+
+        if (size > 0) {
+            segs [nsegs++] = (pcie_dma_seg_t) {
+                .dev_addr = PCIE_ADDR_GEN (iov [i].offs) + ext_done,
+                .host_addr = dev_pcie->dma_bus_addr + buf_used,
+                .buf_offs = buf_used,
+                .size = size,
+                .data = (uint8_t *) iov [i].data + ext_done
+            };
+            buf_used += size;
+            ext_done += size;
+        }
+
+        if (ext_done == iov [i].size) {
+            ++i;
+            ext_done = 0;
+        }
+
+        if (nsegs > 0 && (nsegs == LLIO_IOV_MAX || buf_used == data_area ||
+                    i == iovcnt)) {
+            ssize_t ret = _pcie_rw_dma_chain (self, segs, nsegs, buf_used, rw);
+            ASSERT_TEST(ret == (ssize_t) buf_used, "DMA chain transfer failed",
+                    err_rw_block, -1);
+            total += ret;
+            nsegs = 0;
+            buf_used = 0;
+        }
+    }
+
+    err = total;
+
+err_rw_block:
+err_dev_pcie_handler:
+err_endp_open:
+    return err;
+}
+
+/* Move "nsegs" segments, "size" bytes in total, between the caller data and
+ * the SDRAM with a single DMA chain */
+static ssize_t _pcie_rw_dma_chain (llio_t *self, const pcie_dma_seg_t *segs,
+        size_t nsegs, uint32_t size, int rw)
+{
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    uint8_t *buf = (uint8_t *) dev_pcie->dma_buf;
+    size_t i;
+
+    if (rw == WRITE_TO_BAR) {
+        for (i = 0; i < nsegs; ++i) {
+            memcpy (buf + segs [i].buf_offs, segs [i].data, segs [i].size);
+        }
+        _pcie_dma_sync (dev_pcie, WRITE_TO_BAR);
+    }
+
+    ssize_t num_bytes_xfer = _pcie_dma_xfer_chain (self, segs, nsegs, rw);
+    if (num_bytes_xfer != (ssize_t) size) {
+        return -1;
+    }
+
+    if (rw == READ_FROM_BAR) {
+        _pcie_dma_sync (dev_pcie, READ_FROM_BAR);
+        for (i = 0; i < nsegs; ++i) {
+            memcpy (segs [i].data, buf + segs [i].buf_offs, segs [i].size);
+        }
+    }
+
+    return num_bytes_xfer;
+}
+
+/* DMA "size" bytes between the FPGA SDRAM and the caller buffer "data",
+ * mapping it for the device for the duration of the transfer. Only for
+ * VFIO devices, with a page aligned "data". Returns "size" if successful,
+ * -1 if the transfer failed and 0 if "data" could not be mapped */
+static ssize_t _pcie_rw_dma_zc (llio_t *self, uint64_t dev_addr, size_t size,
+        uint8_t *data, int rw)
+{
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    size_t page_size = sysconf (_SC_PAGESIZE);
+    size_t map_size = (size + page_size - 1) & ~(page_size - 1);
+
+    if (llio_vfio_dma_map (dev_pcie->vfio, data, map_size, PCIE_VFIO_ZC_IOVA) != 0) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
+                "[ll_io_pcie:_pcie_rw_dma_zc] Could not map caller buffer\n");
+        return 0;
+    }
+
+    ssize_t err = size;
+    size_t done = 0;
+    while (done < size) {
+        uint32_t num_bytes_chunk = (size - done > PCIE_DMA_MAX_XFER_SIZE) ?
+            PCIE_DMA_MAX_XFER_SIZE : size - done;
+        ssize_t num_bytes_xfer = _pcie_dma_xfer (self, dev_addr + done,
+                PCIE_VFIO_ZC_IOVA + done, num_bytes_chunk, rw);
+        ASSERT_TEST(num_bytes_xfer == (ssize_t) num_bytes_chunk, "DMA transfer failed",
+                err_dma_xfer, -1);
+        done += num_bytes_chunk;
+    }
+
+err_dma_xfer:
+    llio_vfio_dma_unmap (dev_pcie->vfio, map_size, PCIE_VFIO_ZC_IOVA);
+    return err;
+}
+
+/* Make the DMA buffer coherent before ("rw" WRITE_TO_BAR) or after
+ * (READ_FROM_BAR) the device accesses it. Memory mapped through VFIO is
+ * cache coherent already */
+static void _pcie_dma_sync (llio_dev_pcie_t *dev_pcie, int rw)
+{
+    if (dev_pcie->dma_kmem != NULL) {
+        pd_syncKernelMemory (dev_pcie->dma_kmem, (rw == WRITE_TO_BAR) ?
+                PD_DIR_TODEVICE : PD_DIR_FROMDEVICE);
+    }
+}
+
+/* Wait between DMA status polls. With interrupts, this returns as soon as
+ * the FPGA raises one */
+static void _pcie_dma_wait (llio_dev_pcie_t *dev_pcie)
+{
+    if (dev_pcie->irq_fd < 0) {
+        usleep (PCIE_DMA_WAIT);
+        return;
+    }
+
+    struct pollfd irq_pollfd = {.fd = dev_pcie->irq_fd, .events = POLLIN};
+    const struct timespec wait = {.tv_sec = 0, .tv_nsec = PCIE_DMA_WAIT * 1000};
+    if (ppoll (&irq_pollfd, 1, &wait, NULL) > 0) {
+        uint64_t count;
+        ssize_t rc = read (dev_pcie->irq_fd, &count, sizeof (count));
+        (void) rc;
+    }
+}
+
+/* Program a single descriptor DMA transfer between the FPGA SDRAM and the
+ * host address "host_addr" and wait for its completion */
+static ssize_t _pcie_dma_xfer (llio_t *self, uint64_t dev_addr,
+        uint64_t host_addr, uint32_t size, int rw)
+{
+    const pcie_dma_seg_t seg = {.dev_addr = dev_addr, .host_addr = host_addr,
+        .buf_offs = 0, .size = size};
+    return _pcie_dma_xfer_chain (self, &seg, 1, rw);
+}
+
+/* Program a DMA transfer of "nsegs" segments between the FPGA SDRAM and the
+ * DMA buffer and wait for its completion. The first descriptor goes to the
+ * channel registers and the engine fetches the rest from the DMA buffer */
+static ssize_t _pcie_dma_xfer_chain (llio_t *self, const pcie_dma_seg_t *segs,
+        size_t nsegs, int rw)
+{
+    assert (nsegs > 0 && nsegs <= LLIO_IOV_MAX);
+
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    /* Upstream is from the FPGA to the host and Downstream the opposite */
+    uint64_t chan_base = (rw == READ_FROM_BAR) ? PCIE_CFG_REG_DMA_US_PAH :
+        PCIE_CFG_REG_DMA_DS_PAH;
+    uint32_t desc_offs = dev_pcie->dma_buf_size - PCIE_DMA_DESC_AREA_SIZE;
+    uint64_t desc_addr = dev_pcie->dma_bus_addr + desc_offs;
+    pcie_dma_desc_t *descs = (pcie_dma_desc_t *)
+        ((uint8_t *) dev_pcie->dma_buf + desc_offs);
+    uint32_t total_size = 0;
+    uint32_t data;
+    size_t i;
+
+    for (i = 0; i < nsegs; ++i) {
+        uint64_t seg_host_addr = segs [i].host_addr;
+        uint64_t next_addr = (i + 1 < nsegs) ? desc_addr + (i + 1) * PCIE_DMA_DESC_SIZE : 0;
+
+        descs [i] = (pcie_dma_desc_t) {
+            .pah = segs [i].dev_addr >> 32,
+            .pal = segs [i].dev_addr & 0xFFFFFFFF,
+            .hah = seg_host_addr >> 32,
+            .hal = seg_host_addr & 0xFFFFFFFF,
+            .bdah = next_addr >> 32,
+            .bdal = next_addr & 0xFFFFFFFF,
+            .leng = segs [i].size,
+            .ctrl = PCIE_CFG_DMA_CTRL_VALID | PCIE_CFG_DMA_CTRL_AINC
+        };
+        if (i + 1 == nsegs) {
+            descs [i].ctrl |= PCIE_CFG_DMA_CTRL_LAST;
+        }
+        if (segs [i].dev_addr >> 32) {
+            descs [i].ctrl |= PCIE_CFG_DMA_CTRL_UPA;
+        }
+        total_size += segs [i].size;
+    }
+
+    /* The engine reads the next descriptors from host memory */
+    if (nsegs > 1) {
+        _pcie_dma_sync (dev_pcie, WRITE_TO_BAR);
+    }
+
+    /* Start from a known state */
+    data = PCIE_CFG_DMA_CTRL_CHANNEL_RST;
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, CTRL), &data, WRITE_TO_BAR);
+
+    /* Peripheral (SDRAM) address */
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, PAH), &descs [0].pah, WRITE_TO_BAR);
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, PAL), &descs [0].pal, WRITE_TO_BAR);
+    /* Host (DMA buffer) address */
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, HAH), &descs [0].hah, WRITE_TO_BAR);
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, HAL), &descs [0].hal, WRITE_TO_BAR);
+    /* Next descriptor, if any */
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, BDAH), &descs [0].bdah, WRITE_TO_BAR);
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, BDAL), &descs [0].bdal, WRITE_TO_BAR);
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, LENG), &descs [0].leng, WRITE_TO_BAR);
+
+    /* Writing a valid descriptor starts the transfer */
+    _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, CTRL), &descs [0].ctrl, WRITE_TO_BAR);
+
+    for (i = 0; i < PCIE_DMA_MAX_TRIES; ++i) {
+        _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, STA), &data, READ_FROM_BAR);
+        if (data & PCIE_CFG_DMA_STA_DONE) {
+            break;
+        }
+        _pcie_dma_wait (dev_pcie);
+    }
+
+    if (i >= PCIE_DMA_MAX_TRIES) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+                "[ll_io_pcie:_pcie_dma_xfer_chain] DMA transfer timeout. Exceeded "
+                "maximum number of tries\n");
+        data = PCIE_CFG_DMA_CTRL_CHANNEL_RST;
+        _pcie_rw_32 (self, PCIE_DMA_REG(chan_base, CTRL), &data, WRITE_TO_BAR);
+        return -1;
+    }
+
+    return total_size;
+}
+
+llio_err_e llio_pcie_get_timeout_stats (llio_t *self,
+        llio_pcie_timeout_stats_t *stats)
+{
+    assert (self);
+    assert (stats);
+
+    llio_err_e err = LLIO_SUCCESS;
+    llio_dev_pcie_t *dev_pcie = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_pcie != NULL, "Could not get PCIe handler",
+            err_dev_pcie_handler, LLIO_ERR_INV_FUNC_PARAM);
+
+    *stats = dev_pcie->timeout_stats;
+
+err_dev_pcie_handler:
+    return err;
+}
+
 static ssize_t _pcie_timeout_reset (llio_t *self)
 {
     DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE,
@@ -636,7 +1378,10 @@ static ssize_t _pcie_timeout_reset (llio_t *self)
 
     uint64_t offs = BAR0_ADDR | PCIE_CFG_REG_TX_CTRL;
     uint32_t data = PCIE_CFG_TX_CTRL_CHANNEL_RST;
-    return _pcie_rw_32 (self, offs, &data, WRITE_TO_BAR);
+    ssize_t err = _pcie_rw_32 (self, offs, &data, WRITE_TO_BAR);
+    /* Page writes might have been lost with the timeout */
+    _pcie_invalidate_pg (self);
+    return err;
 }
 
 static ssize_t _pcie_reset_fpga (llio_t *self)
@@ -646,7 +1391,9 @@ static ssize_t _pcie_reset_fpga (llio_t *self)
 
     uint64_t offs = BAR0_ADDR | PCIE_CFG_REG_EB_STACON;
     uint32_t data = PCIE_CFG_TX_CTRL_CHANNEL_RST;
-    return _pcie_rw_32 (self, offs, &data, WRITE_TO_BAR);
+    ssize_t err = _pcie_rw_32 (self, offs, &data, WRITE_TO_BAR);
+    _pcie_invalidate_pg (self);
+    return err;
 }
 
 const llio_ops_t llio_ops_pcie = {
@@ -664,7 +1411,39 @@ const llio_ops_t llio_ops_pcie = {
                                            parameter size in bytes */
     .read_dma       = pcie_read_dma,    /* Read arbitrary block size data via DMA,
                                             parameter size in bytes */
-    .write_dma      = pcie_write_dma    /* Write arbitrary block size data via DMA,
+    .write_dma      = pcie_write_dma,   /* Write arbitrary block size data via DMA,
                                             parameter size in bytes */
+    .read_blockv    = pcie_read_blockv, /* Read scattered blocks with a single
+                                           DMA chain */
+    .write_blockv   = pcie_write_blockv,/* Write scattered blocks with a single
+                                           DMA chain */
+    .mt_safe        = true              /* BAR2 and BAR4 pages are locked
+                                           separately */
     /*.read_info      = pcie_read_info */   /* Read device information data */
 };
+
+/* Same as llio_ops_pcie, but through VFIO */
+const llio_ops_t llio_ops_vfio = {
+    .open           = vfio_open,        /* Open device */
+    .release        = pcie_release,     /* Release device */
+    .read_16        = NULL,             /* Read 16-bit data */
+    .read_32        = pcie_read_32,     /* Read 32-bit data */
+    .read_64        = pcie_read_64,     /* Read 64-bit data */
+    .write_16       = NULL,             /* Write 16-bit data */
+    .write_32       = pcie_write_32,    /* Write 32-bit data */
+    .write_64       = pcie_write_64,    /* Write 64-bit data */
+    .read_block     = pcie_read_block,  /* Read arbitrary block size data,
+                                           parameter size in bytes */
+    .write_block    = pcie_write_block, /* Write arbitrary block size data,
+                                           parameter size in bytes */
+    .read_dma       = pcie_read_dma,    /* Read arbitrary block size data via DMA,
+                                            parameter size in bytes */
+    .write_dma      = pcie_write_dma,   /* Write arbitrary block size data via DMA,
+                                            parameter size in bytes */
+    .read_blockv    = pcie_read_blockv, /* Read scattered blocks with a single
+                                           DMA chain */
+    .write_blockv   = pcie_write_blockv,/* Write scattered blocks with a single
+                                           DMA chain */
+    .mt_safe        = true              /* BAR2 and BAR4 pages are locked
+                                           separately */
+};
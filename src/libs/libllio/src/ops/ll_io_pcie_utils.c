@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* BAR block copy kernels. Accesses to an uncached BAR are split in TLPs of
+ * the access width, so wider loads/stores move more data per PCIe round-trip.
+ * Writes use non-temporal stores, which the CPU combines into full lines */
+
+#include "ll_io.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define LLIO_PCIE_COPY_X86
+#include <immintrin.h>
+#endif
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LL_IO, "[ll_io:pcie_utils]",      \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)       \
+    ASSERT_HAL_ALLOC(ptr, LL_IO, "[ll_io:pcie_utils]",              \
+            llio_err_str(LLIO_ERR_ALLOC),                           \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                    \
+    CHECK_HAL_ERR(err, LL_IO, "[ll_io:pcie_utils]",                 \
+            llio_err_str (err_type))
+
+#define LLIO_PCIE_COPY_WORD_SIZE            sizeof (uint32_t)
+
+static void _llio_pcie_copy_words (uint8_t **dst, const uint8_t **src,
+        size_t num_words);
+static size_t _llio_pcie_copy_head (uint8_t **dst, const uint8_t **src,
+        size_t *num_words, uintptr_t bar, size_t align);
+
+/************ Scalar kernels **********/
+
+/* Same as BAR_RW_8_BLOCK. Used when nothing better is available */
+static void _llio_pcie_copy_scalar (void *dst, const void *src, size_t size)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const uint8_t *s = (const uint8_t *) src;
+    _llio_pcie_copy_words (&d, &s, size / LLIO_PCIE_COPY_WORD_SIZE);
+}
+
+#if defined (LLIO_PCIE_COPY_X86)
+
+/************ SSE2 kernels **********/
+
+__attribute__ ((target ("sse2")))
+static void _llio_pcie_copy_from_bar_sse2 (void *dst, const void *src, size_t size)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const uint8_t *s = (const uint8_t *) src;
+    size_t num_words = size / LLIO_PCIE_COPY_WORD_SIZE;
+    size_t num_vec = _llio_pcie_copy_head (&d, &s, &num_words, (uintptr_t) s,
+            sizeof (__m128i));
+
+    for (size_t i = 0; i < num_vec; ++i) {
+        _mm_storeu_si128 ((__m128i *) d, _mm_load_si128 ((const __m128i *) s));
+        d += sizeof (__m128i);
+        s += sizeof (__m128i);
+    }
+
+    _llio_pcie_copy_words (&d, &s, num_words);
+}
+
+__attribute__ ((target ("sse2")))
+static void _llio_pcie_copy_to_bar_sse2 (void *dst, const void *src, size_t size)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const uint8_t *s = (const uint8_t *) src;
+    size_t num_words = size / LLIO_PCIE_COPY_WORD_SIZE;
+    size_t num_vec = _llio_pcie_copy_head (&d, &s, &num_words, (uintptr_t) d,
+            sizeof (__m128i));
+
+    for (size_t i = 0; i < num_vec; ++i) {
+        _mm_stream_si128 ((__m128i *) d, _mm_loadu_si128 ((const __m128i *) s));
+        d += sizeof (__m128i);
+        s += sizeof (__m128i);
+    }
+    /* Non-temporal stores are weakly ordered */
+    _mm_sfence ();
+
+    _llio_pcie_copy_words (&d, &s, num_words);
+}
+
+/************ SSE4.1 kernels **********/
+
+/* Streaming loads (MOVNTDQA) read whole lines from write-combining memory
+ * and behave as regular loads otherwise */
+__attribute__ ((target ("sse4.1")))
+static void _llio_pcie_copy_from_bar_sse41 (void *dst, const void *src, size_t size)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const uint8_t *s = (const uint8_t *) src;
+    size_t num_words = size / LLIO_PCIE_COPY_WORD_SIZE;
+    size_t num_vec = _llio_pcie_copy_head (&d, &s, &num_words, (uintptr_t) s,
+            sizeof (__m128i));
+
+    for (size_t i = 0; i < num_vec; ++i) {
+        _mm_storeu_si128 ((__m128i *) d,
+                _mm_stream_load_si128 ((__m128i *) s));
+        d += sizeof (__m128i);
+        s += sizeof (__m128i);
+    }
+
+    _llio_pcie_copy_words (&d, &s, num_words);
+}
+
+/************ AVX2 kernels **********/
+
+__attribute__ ((target ("avx2")))
+static void _llio_pcie_copy_from_bar_avx2 (void *dst, const void *src, size_t size)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const uint8_t *s = (const uint8_t *) src;
+    size_t num_words = size / LLIO_PCIE_COPY_WORD_SIZE;
+    size_t num_vec = _llio_pcie_copy_head (&d, &s, &num_words, (uintptr_t) s,
+            sizeof (__m256i));
+
+    for (size_t i = 0; i < num_vec; ++i) {
+        _mm256_storeu_si256 ((__m256i *) d,
+                _mm256_stream_load_si256 ((__m256i *) s));
+        d += sizeof (__m256i);
+        s += sizeof (__m256i);
+    }
+
+    _llio_pcie_copy_words (&d, &s, num_words);
+}
+
+__attribute__ ((target ("avx2")))
+static void _llio_pcie_copy_to_bar_avx2 (void *dst, const void *src, size_t size)
+{
+    uint8_t *d = (uint8_t *) dst;
+    const uint8_t *s = (const uint8_t *) src;
+    size_t num_words = size / LLIO_PCIE_COPY_WORD_SIZE;
+    size_t num_vec = _llio_pcie_copy_head (&d, &s, &num_words, (uintptr_t) d,
+            sizeof (__m256i));
+
+    for (size_t i = 0; i < num_vec; ++i) {
+        _mm256_stream_si256 ((__m256i *) d,
+                _mm256_loadu_si256 ((const __m256i *) s));
+        d += sizeof (__m256i);
+        s += sizeof (__m256i);
+    }
+    /* Non-temporal stores are weakly ordered */
+    _mm_sfence ();
+
+    _llio_pcie_copy_words (&d, &s, num_words);
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used */
+static const llio_pcie_copy_ops_t llio_pcie_copy_ops [] = {
+#if defined (LLIO_PCIE_COPY_X86)
+    {.name = "avx2",    .from_bar = _llio_pcie_copy_from_bar_avx2,
+                        .to_bar = _llio_pcie_copy_to_bar_avx2},
+    {.name = "sse4.1",  .from_bar = _llio_pcie_copy_from_bar_sse41,
+                        .to_bar = _llio_pcie_copy_to_bar_sse2},
+    {.name = "sse2",    .from_bar = _llio_pcie_copy_from_bar_sse2,
+                        .to_bar = _llio_pcie_copy_to_bar_sse2},
+#endif
+    {.name = "scalar",  .from_bar = _llio_pcie_copy_scalar,
+                        .to_bar = _llio_pcie_copy_scalar}
+};
+
+#define LLIO_PCIE_COPY_OPS_NUM              (sizeof (llio_pcie_copy_ops) / \
+                                                sizeof (llio_pcie_copy_ops [0]))
+
+static bool _llio_pcie_copy_supported (const llio_pcie_copy_ops_t *ops)
+{
+#if defined (LLIO_PCIE_COPY_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "avx2")) {
+        return __builtin_cpu_supports ("avx2");
+    }
+    if (streq (ops->name, "sse4.1")) {
+        return __builtin_cpu_supports ("sse4.1");
+    }
+    if (streq (ops->name, "sse2")) {
+        return __builtin_cpu_supports ("sse2");
+    }
+#endif
+    return streq (ops->name, "scalar");
+}
+
+const llio_pcie_copy_ops_t *llio_pcie_copy_get_ops (void)
+{
+    const char *forced = getenv (LLIO_PCIE_ENV_COPY);
+    const llio_pcie_copy_ops_t *best = NULL;
+
+    for (size_t i = 0; i < LLIO_PCIE_COPY_OPS_NUM; ++i) {
+        if (!_llio_pcie_copy_supported (&llio_pcie_copy_ops [i])) {
+            continue;
+        }
+
+        if (best == NULL) {
+            best = &llio_pcie_copy_ops [i];
+        }
+
+        if (forced == NULL) {
+            break;
+        }
+
+        if (streq (forced, llio_pcie_copy_ops [i].name)) {
+            return &llio_pcie_copy_ops [i];
+        }
+    }
+
+    if (forced != NULL) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN, "[ll_io:pcie_utils] Copy kernel %s "
+                "is not supported. Using %s\n", forced, best->name);
+    }
+
+    /* The scalar kernel is always supported */
+    return best;
+}
+
+/************ Helper functions **********/
+
+static void _llio_pcie_copy_words (uint8_t **dst, const uint8_t **src,
+        size_t num_words)
+{
+    uint32_t *d = (uint32_t *) *dst;
+    const uint32_t *s = (const uint32_t *) *src;
+
+    for (size_t j = 0; j < num_words; ++j) {
+        d [j] = s [j];
+    }
+
+    *dst += num_words * LLIO_PCIE_COPY_WORD_SIZE;
+    *src += num_words * LLIO_PCIE_COPY_WORD_SIZE;
+}
+
+/* Copy words until the BAR side is aligned to "align" bytes. Returns the
+ * number of vectors left to copy and leaves the remaining words in
+ * "num_words" */
+static size_t _llio_pcie_copy_head (uint8_t **dst, const uint8_t **src,
+        size_t *num_words, uintptr_t bar, size_t align)
+{
+    size_t words_per_vec = align / LLIO_PCIE_COPY_WORD_SIZE;
+
+    /* BAR accesses are always word aligned, but be safe */
+    if (bar % LLIO_PCIE_COPY_WORD_SIZE != 0) {
+        _llio_pcie_copy_words (dst, src, *num_words);
+        *num_words = 0;
+        return 0;
+    }
+
+    size_t head = ((align - (bar & (align - 1))) & (align - 1)) /
+        LLIO_PCIE_COPY_WORD_SIZE;
+    if (head > *num_words) {
+        head = *num_words;
+    }
+    _llio_pcie_copy_words (dst, src, head);
+    *num_words -= head;
+
+    size_t num_vec = *num_words / words_per_vec;
+    *num_words -= num_vec * words_per_vec;
+    return num_vec;
+}
@@ -0,0 +1,628 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Simulated device. It keeps BAR0 (PCIe config registers), BAR2 (FPGA SDRAM)
+ * and BAR4 (FPGA Wishbone) in memory, using the same address layout as the
+ * PCIe device, so the whole DEVIO -> SMIO -> client stack can be exercised
+ * (and benchmarked) without hardware */
+
+#include <sys/mman.h>
+
+#include "ll_io.h"
+
+/* We share the address layout with the PCIe device */
+#include "hw/pcie_regs.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LL_IO, "[ll_io:sim]",     \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, LL_IO, "[ll_io:sim]",             \
+            llio_err_str(LLIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, LL_IO, "[ll_io:sim]",                \
+            llio_err_str (err_type))
+
+#define READ_FROM_BAR                           1
+#define WRITE_TO_BAR                            0
+
+/* Default SDRAM size, in bytes. Memory is only committed when touched */
+#define SIM_SDRAM_DFLT_SIZE                     (1ULL << 31)
+/* Number of Wishbone words. This covers all of our cores */
+#define SIM_WB_NUM_WORDS                        (1ULL << 23)
+/* Delays shorter than this are busy-waited, as a real BAR access stalls
+ * the CPU as well. Longer ones sleep. In nanoseconds */
+#define SIM_DELAY_SPIN_MAX                      50000
+
+/* SDB table. Same address as the one used by the FPGA firmware */
+#define SIM_SDB_ADDRESS                         0x00300000ULL
+#define SIM_SDB_RECORD_SIZE                     64
+#define SIM_SDB_MAGIC                           0x5344422d /* "SDB-" */
+#define SIM_SDB_VENDOR_ID                       0x1000000000001215ULL /* LNLS */
+#define SIM_SDB_NAME_SIZE                       19
+#define SIM_SDB_TYPE_INTERCONNECT               0x00
+#define SIM_SDB_TYPE_DEVICE                     0x01
+#define SIM_SDB_WB_ACCESS32                     0x04
+#define SIM_SDB_CORE_SIZE                       0x10000ULL
+#define SIM_SDB_DATE                            0x20140101
+
+/* ACQ core. These must match wb_acq_core_regs.h. Register addresses depend
+ * on the __WR_SHIFT_FIX__ the SMIOs were compiled with, so the shift is
+ * configurable */
+#define SIM_ACQ_SDB_DEVID                       0x4519a0ad
+#define SIM_ACQ_REG_CTL                         0x00000000
+#define SIM_ACQ_REG_STA                         0x00000004
+#define SIM_ACQ_CTL_FSM_START_ACQ               (0x1 << 0)
+#define SIM_ACQ_CTL_FSM_STOP_ACQ                (0x1 << 1)
+#define SIM_ACQ_STA_FSM_IDLE                    0x1
+#define SIM_ACQ_STA_FSM_ACQ                     0x2
+#define SIM_ACQ_STA_DONE                        (SIM_ACQ_STA_FSM_IDLE | \
+                                                    (0x1 << 3) /* FSM_ACQ_DONE */ | \
+                                                    (0x1 << 8) /* FC_TRANS_DONE */ | \
+                                                    (0x1 << 16) /* DDR3_TRANS_DONE */)
+
+/* Cores described in the simulated SDB table. This follows the AFCv3
+ * memory layout */
+typedef struct {
+    uint32_t devid;
+    uint64_t base;
+    const char *name;
+} llio_sim_core_t;
+
+static const llio_sim_core_t sim_cores [] = {
+    {0x1bafbf1e,  0x00310000, "LNLS_BPM_DSP"},
+    {0x7085ef15,  0x00320000, "LNLS_FMC130M_4CH"},
+    {SIM_ACQ_SDB_DEVID, 0x00330000, "LNLS_BPM_ACQ_CORE"},
+    {0x1bafbf1e,  0x00340000, "LNLS_BPM_DSP"},
+    {0x7085ef15,  0x00350000, "LNLS_FMC130M_4CH"},
+    {SIM_ACQ_SDB_DEVID, 0x00360000, "LNLS_BPM_ACQ_CORE"},
+    {0x51954750,  0x00380000, "LNLS_AFC_DIAG"},
+    {0xbcbb78d2,  0x00390000, "LNLS_TRIGGER_IFACE"}
+};
+
+#define SIM_NUM_CORES                           (sizeof (sim_cores) / sizeof (sim_cores [0]))
+
+/* ACQ core FSM state */
+typedef struct {
+    uint64_t base;                      /* Core base address */
+    bool running;                       /* Acquisition in progress */
+    uint64_t done_ns;                   /* Acquisition end time */
+} llio_sim_acq_t;
+
+/* Device endpoint */
+typedef struct {
+    uint32_t bar0 [PCIE_CFG_REG_NUM_OF_ADDRESSES]; /* PCIe config registers */
+    uint8_t *sdram;                     /* FPGA SDRAM (BAR2) */
+    uint64_t sdram_size;                /* FPGA SDRAM size, in bytes */
+    uint32_t *wb;                       /* FPGA Wishbone (BAR4), word addressed */
+    uint64_t latency_ns;                /* Artificial latency of every access */
+    uint64_t bw_mbps;                   /* Artificial bandwidth, 0 for unlimited */
+    uint64_t acq_time_ns;               /* Duration of a simulated acquisition */
+    uint64_t acq_reg_ctl;               /* ACQ control register offset */
+    uint64_t acq_reg_sta;               /* ACQ status register offset */
+    llio_sim_acq_t acq [SIM_NUM_CORES]; /* ACQ cores state */
+    uint32_t num_acq;                   /* Number of ACQ cores */
+} llio_dev_sim_t;
+
+static uint64_t _sim_getenv_u64 (const char *name, uint64_t dflt);
+static uint64_t _sim_now_ns (void);
+static void _sim_delay (llio_dev_sim_t *self, size_t size);
+static void _sim_put_be (uint8_t *rec, uint32_t pos, uint64_t value, uint32_t size);
+static void _sim_put_component (uint8_t *rec, uint64_t addr_first, uint64_t addr_last,
+        uint32_t devid, const char *name, uint8_t record_type);
+static void _sim_sdb_fill (llio_dev_sim_t *self);
+static void _sim_acq_ctl_write (llio_dev_sim_t *self, uint64_t addr, uint32_t data);
+static void _sim_acq_sta_update (llio_dev_sim_t *self, uint64_t addr);
+static ssize_t _sim_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw);
+static ssize_t _sim_rw_block (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, int rw);
+
+/************ Our methods implementation **********/
+
+/* Creates a new instance of the dev_sim */
+static llio_dev_sim_t * llio_dev_sim_new (const char *dev_entry)
+{
+    (void) dev_entry;
+
+    llio_dev_sim_t *self = (llio_dev_sim_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC (self, err_llio_dev_sim_alloc);
+
+    self->latency_ns = _sim_getenv_u64 (LLIO_SIM_ENV_LATENCY, 0);
+    self->bw_mbps = _sim_getenv_u64 (LLIO_SIM_ENV_BANDWIDTH, 0);
+    self->acq_time_ns = _sim_getenv_u64 (LLIO_SIM_ENV_ACQ_TIME, 0) * 1000;
+    self->sdram_size = _sim_getenv_u64 (LLIO_SIM_ENV_SDRAM_SIZE,
+            SIM_SDRAM_DFLT_SIZE);
+    uint64_t wr_shift = _sim_getenv_u64 (LLIO_SIM_ENV_WR_SHIFT, 0);
+    self->acq_reg_ctl = SIM_ACQ_REG_CTL >> wr_shift;
+    self->acq_reg_sta = SIM_ACQ_REG_STA >> wr_shift;
+
+    /* Reserve the address space only. Pages are committed on first touch,
+     * so large memories are cheap */
+    self->sdram = (uint8_t *) mmap (NULL, self->sdram_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    ASSERT_TEST(self->sdram != MAP_FAILED, "Could not allocate SDRAM",
+            err_sdram_alloc);
+    self->wb = (uint32_t *) mmap (NULL, SIM_WB_NUM_WORDS * sizeof (uint32_t),
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+            -1, 0);
+    ASSERT_TEST(self->wb != MAP_FAILED, "Could not allocate Wishbone space",
+            err_wb_alloc);
+
+    /* The DDR is always ready */
+    self->bar0 [PCIE_CFG_REG_STATUS >> WB_DWORD_ACC] = PCIE_CFG_STATUS_DDR_RDY;
+
+    /* Describe our cores and get the ACQs ones to idle */
+    _sim_sdb_fill (self);
+    for (uint32_t i = 0; i < SIM_NUM_CORES; ++i) {
+        if (sim_cores [i].devid != SIM_ACQ_SDB_DEVID) {
+            continue;
+        }
+
+        self->acq [self->num_acq].base = sim_cores [i].base;
+        self->wb [sim_cores [i].base + self->acq_reg_sta] = SIM_ACQ_STA_FSM_IDLE;
+        self->num_acq++;
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[ll_io_sim] Created instance of llio_dev_sim. "
+            "latency = %"PRIu64" ns, bandwidth = %"PRIu64" MB/s, SDRAM size = %"PRIu64" bytes\n",
+            self->latency_ns, self->bw_mbps, self->sdram_size);
+
+    return self;
+
+err_wb_alloc:
+    munmap (self->sdram, self->sdram_size);
+err_sdram_alloc:
+    free (self);
+err_llio_dev_sim_alloc:
+    return NULL;
+}
+
+/* Destroy an instance of the Endpoint */
+static llio_err_e llio_dev_sim_destroy (llio_dev_sim_t **self_p)
+{
+    if (*self_p) {
+        llio_dev_sim_t *self = *self_p;
+
+        munmap (self->wb, SIM_WB_NUM_WORDS * sizeof (uint32_t));
+        munmap (self->sdram, self->sdram_size);
+        free (self);
+
+        *self_p = NULL;
+    }
+
+    return LLIO_SUCCESS;
+}
+
+/************ llio_ops_sim Implementation **********/
+
+/* Open simulated device */
+static int sim_open (llio_t *self, llio_endpoint_t *endpoint)
+{
+    if (llio_get_endpoint_open (self)) {
+        /* Device is already opened. So, we return success */
+        return 0;
+    }
+
+    llio_err_e lerr = LLIO_SUCCESS;
+    int err = 0;
+    if (endpoint != NULL) {
+        lerr = llio_set_endpoint (self, endpoint);
+        ASSERT_TEST(lerr == LLIO_SUCCESS, "Could not set endpoint on simulated device",
+                err_endpoint_set, -1);
+    }
+
+    /* Create new private simulated handler */
+    llio_dev_sim_t *dev_sim = llio_dev_sim_new (llio_get_endpoint_name (self));
+    ASSERT_TEST(dev_sim != NULL, "Could not allocate dev_handler",
+            err_dev_handler_alloc, -1);
+
+    /* Attach this simulated device to LLIO instance */
+    llio_set_dev_handler (self, dev_sim);
+
+    /* Signal that the endpoint is opened and ready to work */
+    llio_set_endpoint_open (self, true);
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO,
+            "[ll_io_sim] Opened simulated device %s\n",
+            llio_get_endpoint_name (self));
+
+    return err;
+
+err_dev_handler_alloc:
+err_endpoint_set:
+    return err;
+}
+
+/* Release simulated device */
+static int sim_release (llio_t *self, llio_endpoint_t *endpoint)
+{
+    (void) endpoint;
+
+    if (!llio_get_endpoint_open (self)) {
+        /* Nothing to close */
+        return 0;
+    }
+
+    llio_err_e lerr = LLIO_SUCCESS;
+    int err = 0;
+    llio_dev_sim_t *dev_sim = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_sim != NULL, "Could not get simulated handler",
+            err_dev_sim_handler, -1);
+
+    /* Deattach specific device handler to generic one */
+    lerr = llio_dev_sim_destroy (&dev_sim);
+    ASSERT_TEST (lerr==LLIO_SUCCESS, "Could not close device appropriately",
+            err_dealloc, -1);
+
+    llio_set_dev_handler (self, NULL);
+    llio_set_endpoint_open (self, false);
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO,
+            "[ll_io_sim] Closed simulated device %s\n",
+            llio_get_endpoint_name (self));
+
+    return err;
+
+err_dealloc:
+err_dev_sim_handler:
+    return err;
+}
+
+/* Read data from simulated device */
+static ssize_t sim_read_32 (llio_t *self, uint64_t offs, uint32_t *data)
+{
+    return _sim_rw_32 (self, offs, data, READ_FROM_BAR);
+}
+
+static ssize_t sim_read_64 (llio_t *self, uint64_t offs, uint64_t *data)
+{
+    return _sim_rw_32 (self, offs,
+            (uint32_t *) data, READ_FROM_BAR)
+            +
+            _sim_rw_32 (self, offs + sizeof (uint32_t),
+            (uint32_t *)((uint8_t *) data + sizeof (uint32_t)), READ_FROM_BAR);
+}
+
+/* Write data to simulated device */
+static ssize_t sim_write_32 (llio_t *self, uint64_t offs, const uint32_t *data)
+{
+    uint32_t _data = *data;
+    return _sim_rw_32 (self, offs, &_data, WRITE_TO_BAR);
+}
+
+static ssize_t sim_write_64 (llio_t *self, uint64_t offs, const uint64_t *data)
+{
+    uint64_t _data = *data;
+    return _sim_rw_32 (self, offs,
+            (uint32_t *) &_data, WRITE_TO_BAR)
+            +
+            _sim_rw_32 (self, offs + sizeof (uint32_t),
+            (uint32_t *)((uint8_t *) &_data + sizeof (uint32_t)), WRITE_TO_BAR);
+}
+
+/* Read data block from simulated device, size in bytes */
+static ssize_t sim_read_block (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    return _sim_rw_block (self, offs, size, data, READ_FROM_BAR);
+}
+
+/* Write data block to simulated device, size in bytes */
+static ssize_t sim_write_block (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    /* _sim_rw_block with WRITE_TO_BAR does not modify "data" */
+    return _sim_rw_block (self, offs, size, data, WRITE_TO_BAR);
+}
+
+/* There is no DMA engine to simulate, so DMA transfers are just block
+ * transfers. The artificial bandwidth applies to both */
+static ssize_t sim_read_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    return _sim_rw_block (self, offs, size, data, READ_FROM_BAR);
+}
+
+static ssize_t sim_write_dma (llio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    return _sim_rw_block (self, offs, size, data, WRITE_TO_BAR);
+}
+
+/************ Helper functions **********/
+
+static uint64_t _sim_getenv_u64 (const char *name, uint64_t dflt)
+{
+    const char *value = getenv (name);
+    if (value == NULL || *value == '\0') {
+        return dflt;
+    }
+
+    return strtoull (value, NULL, 0);
+}
+
+static uint64_t _sim_now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Wait for the access latency plus the time "size" bytes take to be
+ * transferred */
+static void _sim_delay (llio_dev_sim_t *self, size_t size)
+{
+    uint64_t delay_ns = self->latency_ns;
+    if (self->bw_mbps != 0) {
+        /* 1 MB/s is 1 byte every 1000 ns */
+        delay_ns += (uint64_t) size * 1000 / self->bw_mbps;
+    }
+
+    if (delay_ns == 0) {
+        return;
+    }
+
+    if (delay_ns > SIM_DELAY_SPIN_MAX) {
+        struct timespec ts = {
+            .tv_sec = delay_ns / 1000000000ULL,
+            .tv_nsec = delay_ns % 1000000000ULL
+        };
+        while (nanosleep (&ts, &ts) == -1 && errno == EINTR);
+        return;
+    }
+
+    uint64_t end_ns = _sim_now_ns () + delay_ns;
+    while (_sim_now_ns () < end_ns);
+}
+
+static void _sim_put_be (uint8_t *rec, uint32_t pos, uint64_t value, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i) {
+        rec [pos + i] = value >> (8 * (size - 1 - i));
+    }
+}
+
+static void _sim_put_component (uint8_t *rec, uint64_t addr_first, uint64_t addr_last,
+        uint32_t devid, const char *name, uint8_t record_type)
+{
+    _sim_put_be (rec, 0x08, addr_first, 8);
+    _sim_put_be (rec, 0x10, addr_last, 8);
+    _sim_put_be (rec, 0x18, SIM_SDB_VENDOR_ID, 8);
+    _sim_put_be (rec, 0x20, devid, 4);
+    _sim_put_be (rec, 0x24, 1, 4);
+    _sim_put_be (rec, 0x28, SIM_SDB_DATE, 4);
+    /* SDB names are padded with spaces */
+    memset (rec + 0x2c, ' ', SIM_SDB_NAME_SIZE);
+    memcpy (rec + 0x2c, name, strnlen (name, SIM_SDB_NAME_SIZE));
+    rec [0x3f] = record_type;
+}
+
+/* Write an SDB table describing our cores. It is read back exactly like
+ * the one in the FPGA ROM, with the word layout used by block reads */
+static void _sim_sdb_fill (llio_dev_sim_t *self)
+{
+    uint8_t table [(SIM_NUM_CORES + 1) * SIM_SDB_RECORD_SIZE];
+    memset (table, 0, sizeof (table));
+
+    /* Interconnect record */
+    _sim_put_be (table, 0x00, SIM_SDB_MAGIC, 4);
+    _sim_put_be (table, 0x04, SIM_NUM_CORES + 1, 2);
+    table [0x06] = 1; /* SDB version */
+    table [0x07] = 0; /* Wishbone */
+    _sim_put_component (table, sim_cores [0].base,
+            sim_cores [SIM_NUM_CORES-1].base + SIM_SDB_CORE_SIZE - 1,
+            0, "LNLS_BPM_SIM", SIM_SDB_TYPE_INTERCONNECT);
+
+    /* Device records */
+    for (uint32_t i = 0; i < SIM_NUM_CORES; ++i) {
+        uint8_t *rec = table + (i + 1) * SIM_SDB_RECORD_SIZE;
+        _sim_put_be (rec, 0x04, SIM_SDB_WB_ACCESS32, 4);
+        _sim_put_component (rec, sim_cores [i].base,
+                sim_cores [i].base + SIM_SDB_CORE_SIZE - 1,
+                sim_cores [i].devid, sim_cores [i].name, SIM_SDB_TYPE_DEVICE);
+    }
+
+    /* Block reads get word "j" from address + (j << WB_DWORD_ACC) */
+    for (uint32_t j = 0; j < sizeof (table) / sizeof (uint32_t); ++j) {
+        memcpy (&self->wb [SIM_SDB_ADDRESS + (j << WB_DWORD_ACC)],
+                table + j * sizeof (uint32_t), sizeof (uint32_t));
+    }
+}
+
+/* ACQ core FSM. Starting an acquisition moves it out of idle and it
+ * completes after the configured acquisition time */
+static void _sim_acq_ctl_write (llio_dev_sim_t *self, uint64_t addr, uint32_t data)
+{
+    for (uint32_t i = 0; i < self->num_acq; ++i) {
+        llio_sim_acq_t *acq = &self->acq [i];
+        if (addr != acq->base + self->acq_reg_ctl) {
+            continue;
+        }
+
+        uint32_t *sta = &self->wb [acq->base + self->acq_reg_sta];
+        if (data & SIM_ACQ_CTL_FSM_STOP_ACQ) {
+            acq->running = false;
+            *sta = SIM_ACQ_STA_FSM_IDLE;
+        }
+        else if (data & SIM_ACQ_CTL_FSM_START_ACQ) {
+            acq->running = true;
+            acq->done_ns = _sim_now_ns () + self->acq_time_ns;
+            *sta = SIM_ACQ_STA_FSM_ACQ;
+        }
+        /* Start/Stop are strobes */
+        self->wb [addr] = data & ~(SIM_ACQ_CTL_FSM_START_ACQ |
+                SIM_ACQ_CTL_FSM_STOP_ACQ);
+        return;
+    }
+}
+
+static void _sim_acq_sta_update (llio_dev_sim_t *self, uint64_t addr)
+{
+    for (uint32_t i = 0; i < self->num_acq; ++i) {
+        llio_sim_acq_t *acq = &self->acq [i];
+        if (addr != acq->base + self->acq_reg_sta) {
+            continue;
+        }
+
+        if (acq->running && _sim_now_ns () >= acq->done_ns) {
+            acq->running = false;
+            self->wb [addr] = SIM_ACQ_STA_DONE;
+        }
+        return;
+    }
+}
+
+static ssize_t _sim_rw_32 (llio_t *self, uint64_t offs, uint32_t *data, int rw)
+{
+    assert (self);
+    ssize_t err = sizeof (*data);
+    ASSERT_TEST(llio_get_endpoint_open (self), "Could not perform RW operation. Device is not opened",
+            err_endp_open, -1);
+
+    llio_dev_sim_t *dev_sim = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_sim != NULL, "Could not get simulated handler",
+            err_dev_sim_handler, -1);
+
+    uint64_t full_offs = PCIE_ADDR_GEN (offs);
+    uint32_t *reg = NULL;
+
+    switch (PCIE_ADDR_BAR (offs)) {
+        /* PCIe config registers */
+        case BAR0NO:
+            ASSERT_TEST((full_offs >> WB_DWORD_ACC) < PCIE_CFG_REG_NUM_OF_ADDRESSES,
+                    "BAR0 access out of range", err_out_of_range, -1);
+            reg = &dev_sim->bar0 [full_offs >> WB_DWORD_ACC];
+            break;
+
+        /* FPGA SDRAM. Pages are transparent here, as the full address
+         * tells us where to go */
+        case BAR2NO:
+            ASSERT_TEST(full_offs + sizeof (*data) <= dev_sim->sdram_size,
+                    "BAR2 access out of range", err_out_of_range, -1);
+            dev_sim->bar0 [PCIE_CFG_REG_SDRAM_PG >> WB_DWORD_ACC] =
+                PCIE_ADDR_SDRAM_PG (full_offs);
+            reg = (uint32_t *) (dev_sim->sdram + full_offs);
+            break;
+
+        /* FPGA Wishbone */
+        case BAR4NO:
+            ASSERT_TEST(full_offs < SIM_WB_NUM_WORDS,
+                    "BAR4 access out of range", err_out_of_range, -1);
+            dev_sim->bar0 [PCIE_CFG_REG_WB_PG >> WB_DWORD_ACC] =
+                PCIE_ADDR_WB_PG (full_offs);
+
+            if (rw == WRITE_TO_BAR) {
+                dev_sim->wb [full_offs] = *data;
+                _sim_acq_ctl_write (dev_sim, full_offs, *data);
+            }
+            else {
+                _sim_acq_sta_update (dev_sim, full_offs);
+                *data = dev_sim->wb [full_offs];
+            }
+            break;
+
+        /* Invalid BAR */
+        default:
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+                    "[ll_io_sim:_sim_rw_32] Invalid BAR access\n");
+            return -1;
+    }
+
+    if (reg != NULL) {
+        (rw) ? (*data = *reg) : (*reg = *data);
+    }
+
+    _sim_delay (dev_sim, sizeof (*data));
+
+err_out_of_range:
+err_dev_sim_handler:
+err_endp_open:
+    return err;
+}
+
+static ssize_t _sim_rw_block (llio_t *self, uint64_t offs, size_t size,
+        uint32_t *data, int rw)
+{
+    assert (self);
+    ssize_t err = 0;
+    ASSERT_TEST(llio_get_endpoint_open (self), "Could not perform RW operation. Device is not opened",
+            err_endp_open, -1);
+
+    llio_dev_sim_t *dev_sim = llio_get_dev_handler (self);
+    ASSERT_TEST(dev_sim != NULL, "Could not get simulated handler",
+            err_dev_sim_handler, -1);
+
+    uint64_t full_offs = PCIE_ADDR_GEN (offs);
+    uint64_t num_words = (size + sizeof (uint32_t) - 1) / sizeof (uint32_t);
+
+    switch (PCIE_ADDR_BAR (offs)) {
+        /* PCIe config registers */
+        case BAR0NO:
+            /* Not available */
+            break;
+
+        /* FPGA SDRAM */
+        case BAR2NO:
+            ASSERT_TEST(full_offs + size <= dev_sim->sdram_size,
+                    "BAR2 access out of range", err_out_of_range, -1);
+            (rw) ? memcpy (data, dev_sim->sdram + full_offs, size) :
+                memcpy (dev_sim->sdram + full_offs, data, size);
+            err = size;
+            break;
+
+        /* FPGA Wishbone. Same word layout as BAR4_RW_BLOCK */
+        case BAR4NO:
+            ASSERT_TEST(num_words == 0 || full_offs + ((num_words-1) << WB_DWORD_ACC) <
+                    SIM_WB_NUM_WORDS, "BAR4 access out of range", err_out_of_range, -1);
+            for (uint64_t j = 0; j < num_words; ++j) {
+                uint32_t *reg = &dev_sim->wb [full_offs + (j << WB_DWORD_ACC)];
+                (rw) ? (data [j] = *reg) : (*reg = data [j]);
+            }
+            err = size;
+            break;
+
+        /* Invalid BAR */
+        default:
+            DBE_DEBUG (DBG_LL_IO | DBG_LVL_ERR,
+                    "[ll_io_sim:_sim_rw_block] Invalid BAR access\n");
+            break;
+    }
+
+    _sim_delay (dev_sim, size);
+
+err_out_of_range:
+err_dev_sim_handler:
+err_endp_open:
+    return err;
+}
+
+const llio_ops_t llio_ops_sim = {
+    .open           = sim_open,         /* Open device */
+    .release        = sim_release,      /* Release device */
+    .read_16        = NULL,             /* Read 16-bit data */
+    .read_32        = sim_read_32,      /* Read 32-bit data */
+    .read_64        = sim_read_64,      /* Read 64-bit data */
+    .write_16       = NULL,             /* Write 16-bit data */
+    .write_32       = sim_write_32,     /* Write 32-bit data */
+    .write_64       = sim_write_64,     /* Write 64-bit data */
+    .read_block     = sim_read_block,   /* Read arbitrary block size data,
+                                           parameter size in bytes */
+    .write_block    = sim_write_block,  /* Write arbitrary block size data,
+                                           parameter size in bytes */
+    .read_dma       = sim_read_dma,     /* Read arbitrary block size data via DMA,
+                                            parameter size in bytes */
+    .write_dma      = sim_write_dma     /* Write arbitrary block size data via DMA,
+                                            parameter size in bytes */
+};
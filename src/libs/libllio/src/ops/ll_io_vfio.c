@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* VFIO access to a PCI device: BAR mappings, IOMMU DMA mappings and MSI
+ * delivery through an eventfd. See the kernel Documentation/vfio.txt */
+
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/vfio.h>
+
+#include "ll_io.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, LL_IO, "[ll_io:vfio]",            \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)       \
+    ASSERT_HAL_ALLOC(ptr, LL_IO, "[ll_io:vfio]",                    \
+            llio_err_str(LLIO_ERR_ALLOC),                           \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                    \
+    CHECK_HAL_ERR(err, LL_IO, "[ll_io:vfio]",                       \
+            llio_err_str (err_type))
+
+#define LLIO_VFIO_CONTAINER             "/dev/vfio/vfio"
+#define LLIO_VFIO_GROUP_PATTERN         "/dev/vfio/%s"
+#define LLIO_VFIO_SYSFS_GROUP_PATTERN   "/sys/bus/pci/devices/%s/iommu_group"
+#define LLIO_VFIO_PATH_LEN              256
+#define LLIO_VFIO_NUM_BARS              (VFIO_PCI_BAR5_REGION_INDEX + 1)
+
+struct _llio_vfio_t {
+    int container;                      /* VFIO container, holding the IOMMU
+                                           context */
+    int group;                          /* IOMMU group of the device */
+    int device;                         /* Device */
+    int irq_fd;                         /* MSI eventfd. -1 if not set up */
+    void *bars [LLIO_VFIO_NUM_BARS];    /* BAR mappings. NULL if not mapped */
+    size_t bars_size [LLIO_VFIO_NUM_BARS];
+};
+
+static int _llio_vfio_open_group (const char *pci_addr);
+static int _llio_vfio_setup_irq (llio_vfio_t *self);
+
+llio_vfio_t *llio_vfio_new (const char *pci_addr)
+{
+    assert (pci_addr);
+
+    llio_vfio_t *self = (llio_vfio_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+    self->irq_fd = -1;
+
+    self->container = open (LLIO_VFIO_CONTAINER, O_RDWR | O_CLOEXEC);
+    ASSERT_TEST(self->container >= 0, "Could not open VFIO container",
+            err_container_open);
+    ASSERT_TEST(ioctl (self->container, VFIO_GET_API_VERSION) == VFIO_API_VERSION,
+            "Unknown VFIO API version", err_api_version);
+    ASSERT_TEST(ioctl (self->container, VFIO_CHECK_EXTENSION, VFIO_TYPE1_IOMMU) > 0,
+            "VFIO Type1 IOMMU is not supported", err_api_version);
+
+    self->group = _llio_vfio_open_group (pci_addr);
+    ASSERT_TEST(self->group >= 0, "Could not open IOMMU group. Is the device "
+            "bound to vfio-pci?", err_group_open);
+
+    struct vfio_group_status group_status = {.argsz = sizeof (group_status)};
+    int rc = ioctl (self->group, VFIO_GROUP_GET_STATUS, &group_status);
+    ASSERT_TEST(rc == 0 && (group_status.flags & VFIO_GROUP_FLAGS_VIABLE),
+            "IOMMU group is not viable. All of its devices must be bound to "
+            "vfio-pci", err_group_viable);
+
+    rc = ioctl (self->group, VFIO_GROUP_SET_CONTAINER, &self->container);
+    ASSERT_TEST(rc == 0, "Could not add IOMMU group to container",
+            err_group_viable);
+    rc = ioctl (self->container, VFIO_SET_IOMMU, VFIO_TYPE1_IOMMU);
+    ASSERT_TEST(rc == 0, "Could not set IOMMU type", err_group_viable);
+
+    self->device = ioctl (self->group, VFIO_GROUP_GET_DEVICE_FD, pci_addr);
+    ASSERT_TEST(self->device >= 0, "Could not get VFIO device", err_group_viable);
+
+    /* Not fatal. DMA completions are then polled for only */
+    if (_llio_vfio_setup_irq (self) != 0) {
+        DBE_DEBUG (DBG_LL_IO | DBG_LVL_WARN, "[ll_io:vfio] Could not set up "
+                "MSI for %s. Falling back to polling\n", pci_addr);
+    }
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_INFO, "[ll_io:vfio] Opened VFIO device %s\n",
+            pci_addr);
+    return self;
+
+err_group_viable:
+    close (self->group);
+err_group_open:
+err_api_version:
+    close (self->container);
+err_container_open:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+void llio_vfio_destroy (llio_vfio_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        llio_vfio_t *self = *self_p;
+
+        for (uint32_t i = 0; i < LLIO_VFIO_NUM_BARS; ++i) {
+            if (self->bars [i] != NULL) {
+                munmap (self->bars [i], self->bars_size [i]);
+            }
+        }
+
+        if (self->irq_fd >= 0) {
+            struct vfio_irq_set irq_set = {
+                .argsz = sizeof (irq_set),
+                .flags = VFIO_IRQ_SET_DATA_NONE | VFIO_IRQ_SET_ACTION_TRIGGER,
+                .index = VFIO_PCI_MSI_IRQ_INDEX,
+                .start = 0,
+                .count = 0};
+            ioctl (self->device, VFIO_DEVICE_SET_IRQS, &irq_set);
+            close (self->irq_fd);
+        }
+
+        /* Closing the container drops all of the DMA mappings */
+        close (self->device);
+        close (self->group);
+        close (self->container);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+void *llio_vfio_map_bar (llio_vfio_t *self, uint32_t bar_no, uint32_t *size)
+{
+    assert (self);
+    assert (size);
+    ASSERT_TEST(bar_no < LLIO_VFIO_NUM_BARS, "Invalid BAR number", err_inv_bar);
+
+    if (self->bars [bar_no] != NULL) {
+        goto mapped;
+    }
+
+    struct vfio_region_info reg_info = {
+        .argsz = sizeof (reg_info),
+        .index = VFIO_PCI_BAR0_REGION_INDEX + bar_no};
+    int rc = ioctl (self->device, VFIO_DEVICE_GET_REGION_INFO, &reg_info);
+    ASSERT_TEST(rc == 0 && reg_info.size > 0 && reg_info.size <= UINT32_MAX,
+            "Could not get BAR region info", err_region_info);
+    ASSERT_TEST(reg_info.flags & VFIO_REGION_INFO_FLAG_MMAP, "BAR can't be "
+            "mapped", err_region_info);
+
+    void *bar = mmap (NULL, reg_info.size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            self->device, reg_info.offset);
+    ASSERT_TEST(bar != MAP_FAILED, "Could not map BAR", err_mmap);
+
+    self->bars [bar_no] = bar;
+    self->bars_size [bar_no] = reg_info.size;
+
+mapped:
+    *size = (uint32_t) self->bars_size [bar_no];
+    return self->bars [bar_no];
+
+err_mmap:
+err_region_info:
+err_inv_bar:
+    return NULL;
+}
+
+int llio_vfio_dma_map (llio_vfio_t *self, void *vaddr, size_t size, uint64_t iova)
+{
+    assert (self);
+
+    struct vfio_iommu_type1_dma_map dma_map = {
+        .argsz = sizeof (dma_map),
+        .flags = VFIO_DMA_MAP_FLAG_READ | VFIO_DMA_MAP_FLAG_WRITE,
+        .vaddr = (uintptr_t) vaddr,
+        .iova = iova,
+        .size = size};
+    return (ioctl (self->container, VFIO_IOMMU_MAP_DMA, &dma_map) == 0) ? 0 : -1;
+}
+
+int llio_vfio_dma_unmap (llio_vfio_t *self, size_t size, uint64_t iova)
+{
+    assert (self);
+
+    struct vfio_iommu_type1_dma_unmap dma_unmap = {
+        .argsz = sizeof (dma_unmap),
+        .iova = iova,
+        .size = size};
+    return (ioctl (self->container, VFIO_IOMMU_UNMAP_DMA, &dma_unmap) == 0) ? 0 : -1;
+}
+
+int llio_vfio_get_irq_fd (llio_vfio_t *self)
+{
+    assert (self);
+    return self->irq_fd;
+}
+
+/**************** Helper Functions ***************/
+
+/* Open the IOMMU group of "pci_addr", named after the sysfs link */
+static int _llio_vfio_open_group (const char *pci_addr)
+{
+    char sysfs_path [LLIO_VFIO_PATH_LEN];
+    char group_link [LLIO_VFIO_PATH_LEN];
+    char group_path [LLIO_VFIO_PATH_LEN];
+
+    snprintf (sysfs_path, sizeof (sysfs_path), LLIO_VFIO_SYSFS_GROUP_PATTERN,
+            pci_addr);
+    ssize_t len = readlink (sysfs_path, group_link, sizeof (group_link) - 1);
+    if (len < 0) {
+        return -1;
+    }
+    group_link [len] = '\0';
+
+    snprintf (group_path, sizeof (group_path), LLIO_VFIO_GROUP_PATTERN,
+            basename (group_link));
+    return open (group_path, O_RDWR | O_CLOEXEC);
+}
+
+/* Route the (single) MSI vector of the device to an eventfd */
+static int _llio_vfio_setup_irq (llio_vfio_t *self)
+{
+    struct vfio_irq_info irq_info = {
+        .argsz = sizeof (irq_info),
+        .index = VFIO_PCI_MSI_IRQ_INDEX};
+    int rc = ioctl (self->device, VFIO_DEVICE_GET_IRQ_INFO, &irq_info);
+    if (rc != 0 || irq_info.count == 0 ||
+            !(irq_info.flags & VFIO_IRQ_INFO_EVENTFD)) {
+        return -1;
+    }
+
+    int irq_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (irq_fd < 0) {
+        return -1;
+    }
+
+    uint8_t buf [sizeof (struct vfio_irq_set) + sizeof (int32_t)];
+    struct vfio_irq_set *irq_set = (struct vfio_irq_set *) buf;
+    *irq_set = (struct vfio_irq_set) {
+        .argsz = sizeof (buf),
+        .flags = VFIO_IRQ_SET_DATA_EVENTFD | VFIO_IRQ_SET_ACTION_TRIGGER,
+        .index = VFIO_PCI_MSI_IRQ_INDEX,
+        .start = 0,
+        .count = 1};
+    memcpy (irq_set->data, &irq_fd, sizeof (int32_t));
+
+    rc = ioctl (self->device, VFIO_DEVICE_SET_IRQS, irq_set);
+    if (rc != 0) {
+        close (irq_fd);
+        return -1;
+    }
+
+    self->irq_fd = irq_fd;
+    return 0;
+}
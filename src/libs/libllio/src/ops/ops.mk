@@ -1,5 +1,9 @@
 ll_io_ops_DIR = $(SRC_DIR)/ops
 
 ll_io_ops_OBJS = $(ll_io_ops_DIR)/ll_io_pcie.o \
+		 $(ll_io_ops_DIR)/ll_io_pcie_utils.o \
 		 $(ll_io_ops_DIR)/ll_io_eth.o \
-		 $(ll_io_ops_DIR)/ll_io_eth_utils.o
+		 $(ll_io_ops_DIR)/ll_io_eth_utils.o \
+		 $(ll_io_ops_DIR)/ll_io_sim.o \
+		 $(ll_io_ops_DIR)/ll_io_vfio.o \
+		 $(ll_io_ops_DIR)/ll_io_ebone.o
@@ -43,12 +43,43 @@ static msg_err_e _msg_format_client_response (int disp_table_ret,
 /* Helper functions */
 static RW_REPLY_TYPE _msg_format_reply_code (int reply_code);
 static zmsg_t * _msg_create_client_response (RW_REPLY_TYPE reply_code, uint32_t reply_size,
-        uint32_t *data_out, bool with_data_frame);
+        uint32_t *data_out, bool with_data_frame, bool packed);
 static void _msg_send_client_response_mlm (RW_REPLY_TYPE reply_code, uint32_t reply_size,
         uint32_t *data_out, bool with_data_frame, mlm_client_t *worker,
-        zframe_t *reply_to);
+        exp_msg_zmq_t *msg);
+static void _msg_send_client_response_mlm_to (RW_REPLY_TYPE reply_code,
+        uint32_t reply_size, uint32_t *data_out, bool with_data_frame,
+        mlm_client_t *worker, const char *sender, const char *tracker, bool packed);
+static void _msg_send_client_response_local (RW_REPLY_TYPE reply_code,
+        uint32_t reply_size, uint32_t *data_out, bool with_data_frame,
+        zsock_t *sock, zframe_t *identity, const char *tracker, bool packed);
+static bool _msg_reply_packed (const char *subject);
+static msg_err_e _msg_unpack_request (zmsg_t *zmq_msg);
+static int _msg_handle_mlm_batch_op (void *owner, exp_msg_zmq_t *msg,
+        disp_table_t *disp_table, msg_stats_t *stats, const uint8_t *req,
+        uint32_t req_size, void **ret);
 static void _msg_send_client_response_sock (RW_REPLY_TYPE reply_code, uint32_t reply_size,
         uint32_t *data_out, bool with_data_frame, zframe_t *reply_to);
+static void _msg_send_client_response_sock_zero_copy (RW_REPLY_TYPE reply_code,
+        uint32_t reply_size, uint32_t *data_out, bool with_data_frame,
+        void *reply_to);
+
+/* Everything needed to reply to a request after its handler returned */
+struct _msg_deferred_t {
+    void *reply_to;                     /* Where to send the reply to */
+    uint32_t opcode;                    /* Request opcode, for the statistics */
+    uint64_t start_ns;                  /* Request dispatch time */
+    msg_stats_t *stats;                 /* Statistics to account the request in */
+    /* MLM protocol requests only. The worker is reused by other requests
+     * in the meantime, so the sender and tracker are copied */
+    mlm_client_t *worker;               /* Worker to reply through */
+    char *sender;                       /* Where to send the reply to */
+    char *tracker;                      /* Request tracker, echoed back */
+    bool packed;                        /* Reply in the packed format */
+    /* Local fast path requests only */
+    zsock_t *local_sock;                /* Socket to reply through */
+    zframe_t *local_id;                 /* Client identity */
+};
 
 msg_type_e msg_guess_type (void *msg)
 {
@@ -62,7 +93,7 @@ msg_err_e msg_validate (void *msg, msg_type_e expected_msg_type)
 
 /* Handle MLM protocol (used by SMIOs, for instance) request */
 msg_err_e msg_handle_mlm_request (void *owner, void *args,
-        disp_table_t *disp_table)
+        disp_table_t *disp_table, msg_stats_t *stats)
 {
     msg_err_e err = MSG_SUCCESS;
     uint32_t opcode_data = 0;
@@ -82,15 +113,42 @@ msg_err_e msg_handle_mlm_request (void *owner, void *args,
             MSG_ERR_ALLOC);
 
     exp_msg_zmq_t *msg = (exp_msg_zmq_t *) args;
+    /* Packed requests are expanded to one frame per field, so the argument
+     * checks and the handlers only see the multi-frame form */
+    const char *subject = msg->subject;
+    if (subject != NULL && streq (subject, RW_REQ_PACKED_V1_SUBJECT)) {
+        err = _msg_unpack_request (EXP_MSG_ZMQ(msg));
+        ASSERT_TEST(err == MSG_SUCCESS, "Could not unpack request", err_get_opcode);
+    }
+
     /* Get opcode */
     err = _msg_exp_zmq_get_opcode (msg, &opcode_data);
     ASSERT_TEST(err == MSG_SUCCESS, "Could not get message opcode", err_get_opcode);
+    /* Allocations from now on, the reply included, are the operation's */
+    hutils_mem_acct_set_opcode (opcode_data);
+
+    /* Time the request from dispatching to replying */
+    uint64_t start_ns = (stats != NULL) ? msg_stats_now_ns () : 0;
+
+    msg->worker = worker;
+    msg->opcode = opcode_data;
+    msg->start_ns = start_ns;
+    msg->stats = stats;
+    msg->deferred = false;
 
     /* Check registered function arguments */
     void *ret = NULL;
-    int disp_table_ret = disp_table_check_call (disp_table, opcode_data, owner,
+    int disp_table_ret = disp_table_dispatch (disp_table, opcode_data, owner,
             args, &ret);
 
+    /* Let caching clients know, if a parameter was changed */
+    smio_publish_param_change (self, opcode_data);
+
+    /* The handler will reply by itself */
+    if (msg->deferred) {
+        return err;
+    }
+
     RW_REPLY_TYPE reply_code = PARAM_ERR;
     bool with_data_frame = false;
     err = _msg_format_client_response (disp_table_ret, &reply_code, &with_data_frame);
@@ -99,14 +157,158 @@ msg_err_e msg_handle_mlm_request (void *owner, void *args,
 
     /* Send response back to client */
     _msg_send_client_response_mlm (reply_code, disp_table_ret, ret, with_data_frame,
-           worker, msg->reply_to);
+           worker, msg);
+    for (uint32_t i = 0; i < msg->num_followers; ++i) {
+        _msg_send_client_response_mlm (reply_code, disp_table_ret, ret,
+                with_data_frame, worker, &msg->followers [i]);
+    }
+    msg->followers_replied = true;
+
+    if (stats != NULL) {
+        msg_stats_record (stats, opcode_data, msg_stats_now_ns () - start_ns,
+                disp_table_ret < 0);
+    }
 
     return err;
 
 err_format_response:
 err_get_opcode:
+    _msg_send_client_response_mlm (PARAM_ERR, 0, NULL, false, worker, msg);
+err_get_smio_worker:
+err_inv_msg:
+    return err;
+}
+
+int msg_handle_mlm_batch (void *owner, void *args, disp_table_t *disp_table,
+        msg_stats_t *stats, uint32_t num_ops, const uint8_t *batch,
+        size_t batch_size, uint8_t *out, size_t out_size)
+{
+    msg_err_e err = _msg_validate (args, MSG_EXP_ZMQ);
+    ASSERT_TEST(err == MSG_SUCCESS, "Invalid batch request", err_inv_batch);
+    ASSERT_TEST(num_ops <= SMIO_BATCH_MAX_OPS, "Too many operations in batch",
+            err_inv_batch);
+
+    exp_msg_zmq_t *msg = (exp_msg_zmq_t *) args;
+    const uint8_t *p = batch;
+    size_t left = batch_size;
+    size_t out_used = 0;
+
+    for (uint32_t i = 0; i < num_ops; ++i) {
+        uint32_t req_size;
+        ASSERT_TEST(left >= RW_REQ_PACKED_ARG_HDR_SIZE, "Truncated batch "
+                "operation size", err_inv_batch);
+        memcpy (&req_size, p, RW_REQ_PACKED_ARG_HDR_SIZE);
+        p += RW_REQ_PACKED_ARG_HDR_SIZE;
+        left -= RW_REQ_PACKED_ARG_HDR_SIZE;
+        ASSERT_TEST(req_size <= left, "Truncated batch operation",
+                err_inv_batch);
+        ASSERT_TEST(out_size - out_used >= RW_REPLY_PACKED_HDR_SIZE,
+                "Batch replies do not fit", err_inv_batch);
+
+        void *ret = NULL;
+        int disp_table_ret = _msg_handle_mlm_batch_op (owner, msg, disp_table,
+                stats, p, req_size, &ret);
+        p += req_size;
+        left -= req_size;
+
+        /* Same reply code and payload as a request of its own */
+        RW_REPLY_TYPE reply_code = PARAM_ERR;
+        bool with_data_frame = false;
+        _msg_format_client_response (disp_table_ret, &reply_code,
+                &with_data_frame);
+        uint32_t reply_size = with_data_frame ? disp_table_ret : 0;
+        if (reply_size > out_size - out_used - RW_REPLY_PACKED_HDR_SIZE) {
+            DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[msg] Reply of batch operation "
+                    "#%u does not fit\n", i);
+            reply_code = PARAM_ERR;
+            reply_size = 0;
+        }
+
+        uint8_t *out_p = out + out_used;
+        memcpy (out_p, &reply_code, RW_REPLY_SIZE);
+        memcpy (out_p + RW_REPLY_SIZE, &reply_size, RW_REPLY_SIZE);
+        if (reply_size > 0) {
+            memcpy (out_p + RW_REPLY_PACKED_HDR_SIZE, ret, reply_size);
+        }
+        out_used += RW_REPLY_PACKED_HDR_SIZE + reply_size;
+    }
+
+    ASSERT_TEST(left == 0, "Extra data after batch operations", err_inv_batch);
+    return out_used;
+
+err_inv_batch:
+    return -PARAM_ERR;
+}
+
+/* Get the opcode of an MLM protocol request received with "subject",
+ * without changing the request */
+msg_err_e msg_peek_mlm_opcode (zmsg_t *zmq_msg, const char *subject,
+        uint32_t *opcode)
+{
+    assert (zmq_msg);
+    assert (opcode);
+
+    msg_err_e err = MSG_SUCCESS;
+    zframe_t *frame = zmsg_first (zmq_msg);
+    ASSERT_TEST(frame != NULL, "Could not receive opcode", err_inv_opcode,
+            MSG_ERR_WRONG_ARGS);
+
+    /* The opcode is the first field of a packed request */
+    const uint8_t *data = zframe_data (frame);
+    size_t size = zframe_size (frame);
+    if (subject != NULL && streq (subject, RW_REQ_PACKED_V1_SUBJECT)) {
+        uint32_t field_size = 0;
+        ASSERT_TEST(size >= RW_REQ_PACKED_ARG_HDR_SIZE, "Truncated packed "
+                "request field size", err_inv_opcode, MSG_ERR_WRONG_ARGS);
+        memcpy (&field_size, data, RW_REQ_PACKED_ARG_HDR_SIZE);
+        data += RW_REQ_PACKED_ARG_HDR_SIZE;
+        size -= RW_REQ_PACKED_ARG_HDR_SIZE;
+        ASSERT_TEST(field_size <= size, "Truncated packed request field",
+                err_inv_opcode, MSG_ERR_WRONG_ARGS);
+        size = field_size;
+    }
+
+    ASSERT_TEST(size == MSG_OPCODE_SIZE, "Invalid opcode size received",
+            err_inv_opcode, MSG_ERR_WRONG_ARGS);
+    memcpy (opcode, data, MSG_OPCODE_SIZE);
+
+err_inv_opcode:
+    return err;
+}
+
+/* Reply with an error to an MLM protocol request, without serving it */
+msg_err_e msg_reject_mlm_request (void *owner, void *args)
+{
+    msg_err_e err = _msg_validate (args, MSG_EXP_ZMQ);
+    ASSERT_TEST(err == MSG_SUCCESS, "Invalid request to reject", err_inv_msg);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    mlm_client_t *worker = smio_get_worker (self);
+    ASSERT_TEST(worker != NULL, "Could not get SMIO worker", err_get_smio_worker,
+            MSG_ERR_ALLOC);
+
     _msg_send_client_response_mlm (PARAM_ERR, 0, NULL, false, worker,
-            msg->reply_to);
+            (exp_msg_zmq_t *) args);
+
+err_get_smio_worker:
+err_inv_msg:
+    return err;
+}
+
+/* Reply with success to an MLM protocol request, without serving it */
+msg_err_e msg_ack_mlm_request (void *owner, void *args)
+{
+    msg_err_e err = _msg_validate (args, MSG_EXP_ZMQ);
+    ASSERT_TEST(err == MSG_SUCCESS, "Invalid request to acknowledge", err_inv_msg);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    mlm_client_t *worker = smio_get_worker (self);
+    ASSERT_TEST(worker != NULL, "Could not get SMIO worker", err_get_smio_worker,
+            MSG_ERR_ALLOC);
+
+    _msg_send_client_response_mlm (PARAM_OK, 0, NULL, false, worker,
+            (exp_msg_zmq_t *) args);
+
 err_get_smio_worker:
 err_inv_msg:
     return err;
@@ -114,7 +316,7 @@ err_inv_msg:
 
 /* Handle regular protocol (used by DEVIOs, for instance) request */
 msg_err_e msg_handle_sock_request (void *owner, void *args,
-        disp_table_t *disp_table)
+        disp_table_t *disp_table, msg_stats_t *stats)
 {
     msg_err_e err = MSG_SUCCESS;
     uint32_t opcode_data = 0;
@@ -133,11 +335,24 @@ msg_err_e msg_handle_sock_request (void *owner, void *args,
     err = _msg_thsafe_zmq_get_opcode (msg, &opcode_data);
     ASSERT_TEST(err == MSG_SUCCESS, "Could not get message opcode", err_get_opcode);
 
+    /* Time the request from dispatching to replying */
+    uint64_t start_ns = (stats != NULL) ? msg_stats_now_ns () : 0;
+
+    msg->opcode = opcode_data;
+    msg->start_ns = start_ns;
+    msg->stats = stats;
+    msg->deferred = false;
+
     /* Check registered function arguments */
     void *ret = NULL;
-    int disp_table_ret = disp_table_check_call (disp_table, opcode_data, owner,
+    int disp_table_ret = disp_table_dispatch (disp_table, opcode_data, owner,
             args, &ret);
 
+    /* The handler will reply by itself */
+    if (msg->deferred) {
+        return err;
+    }
+
     RW_REPLY_TYPE reply_code = PARAM_ERR;
     bool with_data_frame = false;
     err = _msg_format_client_response (disp_table_ret, &reply_code, &with_data_frame);
@@ -148,6 +363,11 @@ msg_err_e msg_handle_sock_request (void *owner, void *args,
     _msg_send_client_response_sock (reply_code, disp_table_ret, ret, with_data_frame,
            msg->reply_to);
 
+    if (stats != NULL) {
+        msg_stats_record (stats, opcode_data, msg_stats_now_ns () - start_ns,
+                disp_table_ret < 0);
+    }
+
     return err;
 
 err_format_response:
@@ -157,30 +377,175 @@ err_inv_msg:
     return err;
 }
 
-msg_err_e msg_check_gen_zmq_args (const disp_op_t *disp_op, zmsg_t *zmq_msg)
+msg_deferred_t *msg_defer_reply (void *args)
+{
+    assert (args);
+
+    msg_deferred_t *self = (msg_deferred_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    if (_msg_guess_type (args) == MSG_EXP_ZMQ) {
+        exp_msg_zmq_t *msg = (exp_msg_zmq_t *) args;
+        ASSERT_TEST(msg->worker != NULL, "Request is not being handled",
+                err_inv_msg);
+
+        if (msg->local_sock != NULL) {
+            self->local_sock = msg->local_sock;
+            self->local_id = zframe_dup (msg->reply_to);
+            ASSERT_ALLOC(self->local_id, err_sender_alloc);
+        }
+        else {
+            self->sender = strdup (msg->sender);
+            ASSERT_ALLOC(self->sender, err_sender_alloc);
+        }
+        if (msg->tracker != NULL) {
+            self->tracker = strdup (msg->tracker);
+            ASSERT_ALLOC(self->tracker, err_tracker_alloc);
+        }
+
+        self->worker = msg->worker;
+        self->packed = _msg_reply_packed (msg->subject);
+        self->opcode = msg->opcode;
+        self->start_ns = msg->start_ns;
+        self->stats = msg->stats;
+        msg->deferred = true;
+
+        return self;
+    }
+
+    msg_err_e err = _msg_validate (args, MSG_THSAFE_ZMQ);
+    ASSERT_TEST(err == MSG_SUCCESS, "Only MLM or regular protocol requests "
+            "can be deferred", err_inv_msg);
+
+    zmq_server_args_t *msg = (zmq_server_args_t *) args;
+    self->reply_to = msg->reply_to;
+    self->opcode = msg->opcode;
+    self->start_ns = msg->start_ns;
+    self->stats = msg->stats;
+    msg->deferred = true;
+
+    return self;
+
+err_tracker_alloc:
+err_sender_alloc:
+err_inv_msg:
+    msg_deferred_destroy (&self);
+err_self_alloc:
+    return NULL;
+}
+
+void msg_deferred_destroy (msg_deferred_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        msg_deferred_t *self = *self_p;
+
+        free (self->sender);
+        free (self->tracker);
+        zframe_destroy (&self->local_id);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+void msg_deferred_reply (msg_deferred_t **self_p, int ret, void *data)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        msg_deferred_t *self = *self_p;
+
+        RW_REPLY_TYPE reply_code = PARAM_ERR;
+        bool with_data_frame = false;
+        _msg_format_client_response (ret, &reply_code, &with_data_frame);
+        if (self->local_sock != NULL) {
+            _msg_send_client_response_local (reply_code, ret, data,
+                    with_data_frame, self->local_sock, self->local_id,
+                    self->tracker, self->packed);
+        }
+        else if (self->worker != NULL) {
+            _msg_send_client_response_mlm_to (reply_code, ret, data,
+                    with_data_frame, self->worker, self->sender, self->tracker,
+                    self->packed);
+        }
+        else {
+            _msg_send_client_response_sock (reply_code, ret, data, with_data_frame,
+                    self->reply_to);
+        }
+
+        if (self->stats != NULL) {
+            msg_stats_record (self->stats, self->opcode,
+                    msg_stats_now_ns () - self->start_ns, ret < 0);
+        }
+
+        msg_deferred_destroy (self_p);
+    }
+}
+
+void msg_deferred_reply_zero_copy (msg_deferred_t **self_p, int ret, void *data)
+{
+    assert (self_p);
+
+    /* MLM replies are always copied */
+    if (*self_p && (*self_p)->worker != NULL) {
+        msg_deferred_reply (self_p, ret, data);
+        disp_table_put_ret (data);
+    }
+    else if (*self_p) {
+        msg_deferred_t *self = *self_p;
+
+        RW_REPLY_TYPE reply_code = PARAM_ERR;
+        bool with_data_frame = false;
+        _msg_format_client_response (ret, &reply_code, &with_data_frame);
+        _msg_send_client_response_sock_zero_copy (reply_code, ret, data,
+                with_data_frame, self->reply_to);
+
+        if (self->stats != NULL) {
+            msg_stats_record (self->stats, self->opcode,
+                    msg_stats_now_ns () - self->start_ns, ret < 0);
+        }
+
+        msg_deferred_destroy (self_p);
+    }
+    else {
+        disp_table_put_ret (data);
+    }
+}
+
+msg_err_e msg_check_gen_zmq_args (const disp_op_t *disp_op,
+        const disp_op_sig_t *sig, zmsg_t *zmq_msg)
 {
+    assert (sig);
     msg_err_e err = MSG_SUCCESS;
-    GEN_MSG_ZMQ_ARG_TYPE zmq_arg = GEN_MSG_ZMQ_PEEK_FIRST(zmq_msg);
 
-    /* Iterate over all arguments and check if they match in size with the
-     * specified disp_op parameters */
+    /* The number of frames and their total size are kept by the message
+     * itself, so most malformed messages are caught without walking it */
+    size_t num_args = zmsg_size (zmq_msg);
+    if (num_args != sig->num_args) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR,
+                "[msg] %s arguments in message received for function \"%s\"\n",
+                (num_args < sig->num_args) ? "Missing" : "Extra", disp_op->name);
+        err = (num_args < sig->num_args) ? MSG_ERR_INV_LESS_ARGS :
+            MSG_ERR_INV_MORE_ARGS;
+        goto err_inv_num_args;
+    }
+
+    if ((sig->var_size && zmsg_content_size (zmq_msg) > sig->size) ||
+            (!sig->var_size && zmsg_content_size (zmq_msg) != sig->size)) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR,
+                "[msg] Invalid size of arguments received for function "
+                "\"%s\"\n", disp_op->name);
+        err = MSG_ERR_INV_SIZE_ARG;
+        goto err_inv_num_args;
+    }
+
+    /* Still check the size of each argument, as the handlers dereference
+     * each frame as the type they expect */
+    GEN_MSG_ZMQ_ARG_TYPE zmq_arg = GEN_MSG_ZMQ_PEEK_FIRST(zmq_msg);
     const uint32_t *args_it = disp_op->args;
     unsigned i;
-    for (i = 0 ; *args_it != DISP_ARG_END; ++args_it, ++i) {
-        DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE,
-                "[msg] Checking argument #%u for function \"%s\"\n",
-                i, disp_op->name);
-        /* We have argument to check according to disp_op->args */
-        if (zmq_arg == NULL) {
-            DBE_DEBUG (DBG_MSG | DBG_LVL_ERR,
-                    "[msg] Missing arguments in message"
-                    " received for function \"%s\"\n", disp_op->name);
-            err = MSG_ERR_INV_LESS_ARGS;
-            goto err_inv_less_args;
-        }
-
-        /* We have received something and will check for (byte) size
-         * correctness */
+    for (i = 0; *args_it != DISP_ARG_END; ++args_it, ++i) {
         if ((GEN_MSG_ZMQ_ARG_SIZE(zmq_arg) > DISP_GET_ASIZE(*args_it)) ||
                 (DISP_GET_ATYPE(*args_it) != DISP_ATYPE_VAR &&
                  GEN_MSG_ZMQ_ARG_SIZE(zmq_arg) != DISP_GET_ASIZE(*args_it))) {
@@ -194,24 +559,9 @@ msg_err_e msg_check_gen_zmq_args (const disp_op_t *disp_op, zmsg_t *zmq_msg)
         zmq_arg = GEN_MSG_ZMQ_PEEK_NEXT_ARG(zmq_msg);
     }
 
-    /* According to disp_op->args we are done. So, check if the message received
-     * has any more arguments */
-    if (zmq_arg != NULL) {
-        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR,
-                "[msg] Extra arguments in message"
-                " received for function \"%s\"\n", disp_op->name);
-        err = MSG_ERR_INV_MORE_ARGS;
-        goto err_inv_more_args;
-    }
-
-    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE,
-            "[msg] No errors detected on the received arguments "
-            "for function \"%s\"\n", disp_op->name);
-
-err_inv_more_args:
 err_inv_size_args:
-err_inv_less_args:
     GEN_MSG_ZMQ_PEEK_EXIT(zmq_msg);
+err_inv_num_args:
     return err;
 }
 
@@ -306,7 +656,7 @@ static msg_err_e _msg_format_client_response (int disp_table_ret,
 {
     /* Log only error message */
     if (disp_table_ret < 0) {
-        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[msg] disp_table_check_call returned "
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[msg] disp_table_dispatch returned "
                 "status %d\n", disp_table_ret);
     }
 
@@ -335,15 +685,56 @@ static RW_REPLY_TYPE _msg_format_reply_code (int reply_code)
 
 static void _msg_send_client_response_mlm (RW_REPLY_TYPE reply_code, uint32_t reply_size,
         uint32_t *data_out, bool with_data_frame, mlm_client_t *worker,
-        zframe_t *reply_to)
+        exp_msg_zmq_t *msg)
+{
+    bool packed = _msg_reply_packed (msg->subject);
+    if (msg->local_sock != NULL) {
+        _msg_send_client_response_local (reply_code, reply_size, data_out,
+                with_data_frame, msg->local_sock, msg->reply_to,
+                msg->tracker, packed);
+        return;
+    }
+
+    _msg_send_client_response_mlm_to (reply_code, reply_size, data_out,
+            with_data_frame, worker, msg->sender, msg->tracker, packed);
+}
+
+static void _msg_send_client_response_mlm_to (RW_REPLY_TYPE reply_code,
+        uint32_t reply_size, uint32_t *data_out, bool with_data_frame,
+        mlm_client_t *worker, const char *sender, const char *tracker, bool packed)
 {
-    (void) reply_to;
     zmsg_t *msg = _msg_create_client_response (reply_code, reply_size, data_out,
-            with_data_frame);
+            with_data_frame, packed);
     ASSERT_TEST(msg != NULL, "Could format client message",
             err_fmt_client_message);
 
-    mlm_client_sendto (worker, mlm_client_sender (worker), NULL, NULL, 0, &msg);
+    /* Send the request tracker back, so clients with many requests in
+     * flight can match replies to them */
+    mlm_client_sendto (worker, sender, NULL, tracker, 0, &msg);
+err_fmt_client_message:
+    return;
+}
+
+/* Reply to a request of the local fast path. The ROUTER socket routes the
+ * reply by the identity frame, and the tracker goes right after it, as
+ * there is no broker envelope to carry it */
+static void _msg_send_client_response_local (RW_REPLY_TYPE reply_code,
+        uint32_t reply_size, uint32_t *data_out, bool with_data_frame,
+        zsock_t *sock, zframe_t *identity, const char *tracker, bool packed)
+{
+    zmsg_t *msg = _msg_create_client_response (reply_code, reply_size, data_out,
+            with_data_frame, packed);
+    ASSERT_TEST(msg != NULL, "Could format client message",
+            err_fmt_client_message);
+
+    int zerr = zmsg_pushstr (msg, (tracker != NULL) ? tracker : "");
+    ASSERT_TEST(zerr == 0, "Could not add tracker to message", err_msg_push);
+    zerr = zmsg_pushmem (msg, zframe_data (identity), zframe_size (identity));
+    ASSERT_TEST(zerr == 0, "Could not add identity to message", err_msg_push);
+
+    zmsg_send (&msg, sock);
+err_msg_push:
+    zmsg_destroy (&msg);
 err_fmt_client_message:
     return;
 }
@@ -352,7 +743,7 @@ static void _msg_send_client_response_sock (RW_REPLY_TYPE reply_code, uint32_t r
         uint32_t *data_out, bool with_data_frame, zframe_t *reply_to)
 {
     zmsg_t *msg = _msg_create_client_response (reply_code, reply_size, data_out,
-            with_data_frame);
+            with_data_frame, false);
     ASSERT_TEST(msg != NULL, "Could format client message",
             err_fmt_client_message);
 
@@ -361,19 +752,166 @@ err_fmt_client_message:
     return;
 }
 
+/* Same frames as _msg_send_client_response_sock (), but the data frame
+ * points to "data_out" instead of holding a copy of it. zmq gives
+ * "data_out" back to the dispatch table when the receiver is done with it */
+static void _msg_send_client_response_sock_zero_copy (RW_REPLY_TYPE reply_code,
+        uint32_t reply_size, uint32_t *data_out, bool with_data_frame,
+        void *reply_to)
+{
+    void *sock = zsock_resolve (reply_to);
+    int flags = with_data_frame ? ZMQ_SNDMORE : 0;
+
+    int zerr = zmq_send (sock, &reply_code, sizeof (reply_code), flags);
+    ASSERT_TEST(zerr >= 0, "Could not send reply code", err_send);
+    if (!with_data_frame) {
+        goto err_no_data_frame;
+    }
+
+    zerr = zmq_send (sock, &reply_size, sizeof (reply_size), ZMQ_SNDMORE);
+    ASSERT_TEST(zerr >= 0, "Could not send reply size", err_send);
+
+    zmq_msg_t data_msg;
+    zerr = zmq_msg_init_data (&data_msg, data_out, reply_size,
+            disp_table_ret_free, NULL);
+    ASSERT_TEST(zerr == 0, "Could not wrap reply data", err_send);
+    zerr = zmq_msg_send (&data_msg, sock, 0);
+    if (zerr < 0) {
+        /* Still ours, so this gives data_out back */
+        zmq_msg_close (&data_msg);
+    }
+    ASSERT_TEST(zerr >= 0, "Could not send reply data", err_send_data);
+    return;
+
+err_no_data_frame:
+err_send:
+    disp_table_put_ret (data_out);
+err_send_data:
+    return;
+}
+
+/* Clients ask for packed replies through the request subject */
+static bool _msg_reply_packed (const char *subject)
+{
+    return subject != NULL && (streq (subject, RW_REPLY_PACKED_SUBJECT) ||
+            streq (subject, RW_REQ_PACKED_V1_SUBJECT) ||
+            streq (subject, RW_REQ_COALESCE_SUBJECT) ||
+            streq (subject, RW_REQ_SHARED_SUBJECT));
+}
+
+/* Replace the single frame of a RW_WIRE_PACKED_V1 request by one frame per
+ * field */
+static msg_err_e _msg_unpack_request (zmsg_t *zmq_msg)
+{
+    msg_err_e err = MSG_SUCCESS;
+
+    ASSERT_TEST(zmsg_size (zmq_msg) == 1, "Packed request must have a single "
+            "frame", err_inv_packed, MSG_ERR_WRONG_ARGS);
+    zframe_t *packed = zmsg_pop (zmq_msg);
+    const uint8_t *p = zframe_data (packed);
+    size_t left = zframe_size (packed);
+
+    while (left > 0) {
+        uint32_t size;
+        ASSERT_TEST(left >= RW_REQ_PACKED_ARG_HDR_SIZE, "Truncated packed "
+                "request field size", err_inv_field, MSG_ERR_WRONG_ARGS);
+        memcpy (&size, p, RW_REQ_PACKED_ARG_HDR_SIZE);
+        p += RW_REQ_PACKED_ARG_HDR_SIZE;
+        left -= RW_REQ_PACKED_ARG_HDR_SIZE;
+
+        ASSERT_TEST(size <= left, "Truncated packed request field",
+                err_inv_field, MSG_ERR_WRONG_ARGS);
+        int zerr = zmsg_addmem (zmq_msg, p, size);
+        ASSERT_TEST(zerr == 0, "Could not add packed request field",
+                err_inv_field, MSG_ERR_ALLOC);
+        p += size;
+        left -= size;
+    }
+
+err_inv_field:
+    zframe_destroy (&packed);
+err_inv_packed:
+    return err;
+}
+
+/* Serve one operation of a SMIO_OPCODE_BATCH request, "msg", encoded as a
+ * RW_WIRE_PACKED_V1 request. Returns the handler return value, with its
+ * output in "ret" */
+static int _msg_handle_mlm_batch_op (void *owner, exp_msg_zmq_t *msg,
+        disp_table_t *disp_table, msg_stats_t *stats, const uint8_t *req,
+        uint32_t req_size, void **ret)
+{
+    int err = -PARAM_ERR;
+    uint32_t opcode = 0;
+
+    zmsg_t *zmq_msg = zmsg_new ();
+    ASSERT_ALLOC(zmq_msg, err_msg_alloc);
+    int zerr = zmsg_addmem (zmq_msg, req, req_size);
+    ASSERT_TEST(zerr == 0, "Could not add batch operation", err_unpack);
+
+    msg_err_e merr = _msg_unpack_request (zmq_msg);
+    ASSERT_TEST(merr == MSG_SUCCESS, "Could not unpack batch operation",
+            err_unpack);
+    merr = _msg_gen_get_opcode (zmq_msg, &opcode);
+    ASSERT_TEST(merr == MSG_SUCCESS, "Could not get batch operation opcode",
+            err_unpack);
+    ASSERT_TEST(opcode != SMIO_OPCODE_BATCH, "Batches cannot be nested",
+            err_unpack);
+
+    /* Same envelope as the batch. With no worker, handlers cannot defer
+     * their replies, which must go in the batch reply */
+    exp_msg_zmq_t op_msg = *msg;
+    op_msg.msg = &zmq_msg;
+    op_msg.worker = NULL;
+    op_msg.opcode = opcode;
+    op_msg.start_ns = (stats != NULL) ? msg_stats_now_ns () : 0;
+    op_msg.deferred = false;
+
+    err = disp_table_dispatch (disp_table, opcode, owner, &op_msg, ret);
+    smio_publish_param_change (SMIO_EXP_OWNER(owner), opcode);
+
+    if (stats != NULL) {
+        msg_stats_record (stats, opcode, msg_stats_now_ns () - op_msg.start_ns,
+                err < 0);
+    }
+
+err_unpack:
+    zmsg_destroy (&zmq_msg);
+err_msg_alloc:
+    return err;
+}
+
 static zmsg_t * _msg_create_client_response (RW_REPLY_TYPE reply_code, uint32_t reply_size,
-        uint32_t *data_out, bool with_data_frame)
+        uint32_t *data_out, bool with_data_frame, bool packed)
 {
     /* Send reply back to client */
     zmsg_t *report = zmsg_new ();
     ASSERT_ALLOC(report, err_send_msg_alloc);
 
+    int zerr = 0;
+    if (packed && with_data_frame) {
+        /* Message is:
+         * frame 0: error code, size (in bytes) and data
+         * */
+        zframe_t *frame = zframe_new (NULL, RW_REPLY_PACKED_HDR_SIZE + reply_size);
+        ASSERT_ALLOC(frame, err_reply_code);
+
+        uint8_t *frame_data = zframe_data (frame);
+        memcpy (frame_data, &reply_code, RW_REPLY_SIZE);
+        memcpy (frame_data + RW_REPLY_SIZE, &reply_size, RW_REPLY_SIZE);
+        memcpy (frame_data + RW_REPLY_PACKED_HDR_SIZE, data_out, reply_size);
+
+        zerr = zmsg_append (report, &frame);
+        ASSERT_TEST(zerr==0, "Could not add packed reply in message", err_reply_code);
+        goto packed_reply;
+    }
+
     /* Message is:
      * frame 0: error code
      * frame 1: size (in bytes) or return code
      * frame 2: data
      * */
-    int zerr = zmsg_addmem (report, &reply_code, sizeof(reply_code));
+    zerr = zmsg_addmem (report, &reply_code, sizeof(reply_code));
     ASSERT_TEST(zerr==0, "Could not add reply code in message", err_reply_code);
 
     if (with_data_frame) {
@@ -385,6 +923,7 @@ static zmsg_t * _msg_create_client_response (RW_REPLY_TYPE reply_code, uint32_t
                 err_data);
     }
 
+packed_reply:
     DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[sm_io:rw_param] send_client_response: "
             "Sending message:\n");
 #ifdef LOCAL_MSG_DBG
@@ -5,5 +5,6 @@ msg_DIR = $(SRC_DIR)/msg
 
 msg_OBJS = $(msg_DIR)/msg.o \
 	   $(msg_DIR)/msg_err.o \
+	   $(msg_DIR)/msg_stats.o \
 	   $(exp_ops_OBJS) \
 	   $(smio_thsafe_ops_OBJS)
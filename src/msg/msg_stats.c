@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <time.h>
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, MSG, "[msg_stats]",               \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)       \
+    ASSERT_HAL_ALLOC(ptr, MSG, "[msg_stats]",                       \
+            msg_err_str(MSG_ERR_ALLOC),                             \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                    \
+    CHECK_HAL_ERR(err, MSG, "[msg_stats]",                          \
+            msg_err_str (err_type))
+
+#if SMIO_OPCODE_GET_OP_STATS >= MSG_OPCODE_MAX
+#error "SMIO_OPCODE_GET_OP_STATS must be a valid opcode"
+#endif
+
+/* Our structure. Opcodes are validated against MSG_OPCODE_MAX before
+ * dispatching, so a flat array covers all of them */
+struct _msg_stats_t {
+    smio_op_stats_t ops [MSG_OPCODE_MAX];
+    uint64_t errors;                /* Failed requests, never reset */
+    uint32_t last_err_opcode;       /* Opcode of the last failed request */
+    uint64_t last_err_ns;           /* When it failed. 0 if none did */
+};
+
+/* Creates a new instance of the operation statistics */
+msg_stats_t *msg_stats_new (void)
+{
+    msg_stats_t *self = (msg_stats_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    uint32_t i;
+    for (i = 0; i < MSG_OPCODE_MAX; ++i) {
+        msg_stats_reset (self, i);
+    }
+
+    return self;
+
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy an instance of the operation statistics */
+msg_err_e msg_stats_destroy (msg_stats_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        msg_stats_t *self = *self_p;
+
+        free (self);
+        *self_p = NULL;
+    }
+
+    return MSG_SUCCESS;
+}
+
+uint64_t msg_stats_now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void msg_stats_record (msg_stats_t *self, uint32_t opcode, uint64_t elapsed_ns,
+        bool is_err)
+{
+    assert (self);
+
+    if (opcode >= MSG_OPCODE_MAX) {
+        return;
+    }
+
+    smio_op_stats_t *stats = &self->ops [opcode];
+    ++stats->count;
+    if (is_err) {
+        ++stats->errors;
+        ++self->errors;
+        self->last_err_opcode = opcode;
+        self->last_err_ns = msg_stats_now_ns ();
+    }
+    stats->total_ns += elapsed_ns;
+    if (elapsed_ns < stats->min_ns) {
+        stats->min_ns = elapsed_ns;
+    }
+    if (elapsed_ns > stats->max_ns) {
+        stats->max_ns = elapsed_ns;
+    }
+    ++stats->hist [smio_op_stats_bucket (elapsed_ns)];
+}
+
+const smio_op_stats_t *msg_stats_get (msg_stats_t *self, uint32_t opcode)
+{
+    assert (self);
+    return (opcode < MSG_OPCODE_MAX) ? &self->ops [opcode] : NULL;
+}
+
+uint64_t msg_stats_get_last_err (msg_stats_t *self, uint32_t *opcode,
+        uint64_t *ns)
+{
+    assert (self);
+    assert (opcode);
+    assert (ns);
+
+    *opcode = self->last_err_opcode;
+    *ns = self->last_err_ns;
+    return self->errors;
+}
+
+void msg_stats_reset (msg_stats_t *self, uint32_t opcode)
+{
+    assert (self);
+
+    if (opcode >= MSG_OPCODE_MAX) {
+        return;
+    }
+
+    memset (&self->ops [opcode], 0, sizeof (self->ops [opcode]));
+    self->ops [opcode].min_ns = UINT64_MAX;
+}
+
+void msg_stats_print (msg_stats_t *self, const char *owner_name)
+{
+    assert (self);
+
+    uint32_t i;
+    for (i = 0; i < MSG_OPCODE_MAX; ++i) {
+        const smio_op_stats_t *stats = &self->ops [i];
+        if (stats->count == 0) {
+            continue;
+        }
+
+        DBE_DEBUG (DBG_MSG | DBG_LVL_INFO, "[msg_stats] %s: opcode %u: "
+                "count = %"PRIu64", errors = %"PRIu64", avg = %"PRIu64" ns, "
+                "min = %"PRIu64" ns, p50 = %"PRIu64" ns, p99 = %"PRIu64" ns, "
+                "max = %"PRIu64" ns\n", owner_name, i, stats->count,
+                stats->errors, stats->total_ns / stats->count, stats->min_ns,
+                smio_op_stats_percentile (stats, 50.0),
+                smio_op_stats_percentile (stats, 99.0), stats->max_ns);
+    }
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+static ssize_t _thsafe_direct_client_ret (ssize_t ret, uint64_t offs,
+        const char *op);
+
+/* If the SMIO was not given the device, fall back to the ring */
+#define THSAFE_DIRECT_CLIENT_FALLBACK(func_name, ...)                       \
+    do {                                                                    \
+        if (smio_get_direct_llio (self) == NULL) {                          \
+            return smio_thsafe_client_ring_ops.func_name (self, ##__VA_ARGS__); \
+        }                                                                   \
+    } while (0)
+
+/**** Read data from device ****/
+static ssize_t thsafe_direct_client_read_16 (smio_t *self, uint64_t offs, uint16_t *data)
+{
+    THSAFE_DIRECT_CLIENT_FALLBACK(thsafe_client_read_16, offs, data);
+    return _thsafe_direct_client_ret (llio_read_16 (smio_get_direct_llio (self),
+                offs, data), offs, "read from");
+}
+
+static ssize_t thsafe_direct_client_read_32 (smio_t *self, uint64_t offs, uint32_t *data)
+{
+    THSAFE_DIRECT_CLIENT_FALLBACK(thsafe_client_read_32, offs, data);
+    return _thsafe_direct_client_ret (llio_read_32 (smio_get_direct_llio (self),
+                offs, data), offs, "read from");
+}
+
+static ssize_t thsafe_direct_client_read_64 (smio_t *self, uint64_t offs, uint64_t *data)
+{
+    THSAFE_DIRECT_CLIENT_FALLBACK(thsafe_client_read_64, offs, data);
+    return _thsafe_direct_client_ret (llio_read_64 (smio_get_direct_llio (self),
+                offs, data), offs, "read from");
+}
+
+/**** Write data to device ****/
+
+/* Writes are done right away, whether posted or not. The device gets them
+ * in the order the root complex takes them, so they reach it ahead of any
+ * access the DEVIO does for us afterwards */
+static ssize_t thsafe_direct_client_write_16 (smio_t *self, uint64_t offs, const uint16_t *data)
+{
+    THSAFE_DIRECT_CLIENT_FALLBACK(thsafe_client_write_16, offs, data);
+    return _thsafe_direct_client_ret (llio_write_16 (smio_get_direct_llio (self),
+                offs, data), offs, "write to");
+}
+
+static ssize_t thsafe_direct_client_write_32 (smio_t *self, uint64_t offs, const uint32_t *data)
+{
+    THSAFE_DIRECT_CLIENT_FALLBACK(thsafe_client_write_32, offs, data);
+    return _thsafe_direct_client_ret (llio_write_32 (smio_get_direct_llio (self),
+                offs, data), offs, "write to");
+}
+
+static ssize_t thsafe_direct_client_write_64 (smio_t *self, uint64_t offs, const uint64_t *data)
+{
+    THSAFE_DIRECT_CLIENT_FALLBACK(thsafe_client_write_64, offs, data);
+    return _thsafe_direct_client_ret (llio_write_64 (smio_get_direct_llio (self),
+                offs, data), offs, "write to");
+}
+
+/**** Read/Write data blocks and batches from/to device ****/
+
+/* These still go to the DEVIO, through the ring ops, which serialize them
+ * with the writes posted on the ring when the SMIO has no device */
+static ssize_t thsafe_direct_client_read_block (smio_t *self, uint64_t offs,
+        size_t size, uint32_t *data)
+{
+    return smio_thsafe_client_ring_ops.thsafe_client_read_block (self, offs,
+            size, data);
+}
+
+static ssize_t thsafe_direct_client_write_block (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data)
+{
+    return smio_thsafe_client_ring_ops.thsafe_client_write_block (self, offs,
+            size, data);
+}
+
+static ssize_t thsafe_direct_client_read_dma (smio_t *self, uint64_t offs,
+        size_t size, uint32_t *data)
+{
+    return smio_thsafe_client_ring_ops.thsafe_client_read_dma (self, offs,
+            size, data);
+}
+
+static ssize_t thsafe_direct_client_write_dma (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data)
+{
+    return smio_thsafe_client_ring_ops.thsafe_client_write_dma (self, offs,
+            size, data);
+}
+
+static ssize_t thsafe_direct_client_batch (smio_t *self, thsafe_batch_op_t *ops,
+        size_t num_ops)
+{
+    return smio_thsafe_client_ring_ops.thsafe_client_batch (self, ops, num_ops);
+}
+
+static ssize_t thsafe_direct_client_read_blockv (smio_t *self,
+        const llio_iov_t *iov, size_t iovcnt)
+{
+    return smio_thsafe_client_ring_ops.thsafe_client_read_blockv (self, iov,
+            iovcnt);
+}
+
+/**** Wait for the posted writes ****/
+static ssize_t thsafe_direct_client_fence (smio_t *self)
+{
+    /* Nothing is left behind by the direct writes */
+    THSAFE_DIRECT_CLIENT_FALLBACK(thsafe_client_fence);
+    return 0;
+}
+
+/*************** Helper functions **************/
+
+static ssize_t _thsafe_direct_client_ret (ssize_t ret, uint64_t offs,
+        const char *op)
+{
+    if (ret < 0) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_client:direct] Could "
+                "not %s offset 0x%"PRIx64"\n", op, offs);
+        return -1;
+    }
+
+    return ret;
+}
+
+/*************** Our constant structure **************/
+
+/* Single register accesses are done by the SMIO thread itself, on the
+ * device shared by the DEVIO. Everything else goes through the ring ops */
+const smio_thsafe_client_ops_t smio_thsafe_client_direct_ops = {
+    .thsafe_client_open           = thsafe_zmq_client_open,          /* Open device */
+    .thsafe_client_release        = thsafe_zmq_client_release,       /* Release device */
+    .thsafe_client_read_16        = thsafe_direct_client_read_16,    /* Read 16-bit data */
+    .thsafe_client_read_32        = thsafe_direct_client_read_32,    /* Read 32-bit data */
+    .thsafe_client_read_64        = thsafe_direct_client_read_64,    /* Read 64-bit data */
+    .thsafe_client_write_16       = thsafe_direct_client_write_16,   /* Write 16-bit data */
+    .thsafe_client_write_32       = thsafe_direct_client_write_32,   /* Write 32-bit data */
+    .thsafe_client_write_64       = thsafe_direct_client_write_64,   /* Write 64-bit data */
+    .thsafe_client_read_block     = thsafe_direct_client_read_block, /* Read arbitrary block size data,
+                                                                          parameter size in bytes */
+    .thsafe_client_write_block    = thsafe_direct_client_write_block,/* Write arbitrary block size data,
+                                                                          parameter size in bytes */
+    .thsafe_client_read_dma       = thsafe_direct_client_read_dma,   /* Read arbitrary block size data via DMA,
+                                                                          parameter size in bytes */
+    .thsafe_client_write_dma      = thsafe_direct_client_write_dma,  /* Write arbitrary block size data via DMA,
+                                                                          parameter size in bytes */
+    .thsafe_client_batch          = thsafe_direct_client_batch,      /* Execute a batch of register
+                                                                          operations */
+    .thsafe_client_read_blockv    = thsafe_direct_client_read_blockv,/* Read scattered blocks in
+                                                                          a single request */
+    .thsafe_client_fence          = thsafe_direct_client_fence       /* Wait for the posted writes */
+};
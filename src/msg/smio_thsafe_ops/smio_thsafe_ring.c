@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <sys/eventfd.h>
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, MSG, "[smio_thsafe_ring]",        \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, MSG, "[smio_thsafe_ring]",        \
+            msg_err_str(MSG_ERR_ALLOC),                     \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, MSG, "[smio_thsafe_ring]",           \
+            msg_err_str (err_type))
+
+#define THSAFE_RING_CACHE_LINE_SIZE         64
+#define THSAFE_RING_SLOT_MASK               (THSAFE_RING_NUM_SLOTS-1)
+
+#if (THSAFE_RING_NUM_SLOTS & THSAFE_RING_SLOT_MASK) != 0
+#error "THSAFE_RING_NUM_SLOTS must be a power of 2"
+#endif
+
+/* Our structure. head is only written by the producer and tail only
+ * by the consumer. Keep them in different cache lines, so the threads
+ * don't keep stealing the line from each other */
+struct _thsafe_ring_t {
+    uint64_t head __attribute__ ((aligned (THSAFE_RING_CACHE_LINE_SIZE)));
+                                        /* Next slot to be produced */
+    uint64_t tail __attribute__ ((aligned (THSAFE_RING_CACHE_LINE_SIZE)));
+                                        /* Next slot to be consumed */
+    uint32_t posted_errs;               /* Posted writes that failed. Counted by
+                                           the consumer and cleared by the
+                                           producer */
+    thsafe_ring_slot_t slots [THSAFE_RING_NUM_SLOTS]
+        __attribute__ ((aligned (THSAFE_RING_CACHE_LINE_SIZE)));
+    int req_fd;                         /* Request doorbell. Rung by the producer */
+    int rep_fd;                         /* Reply doorbell. Rung by the consumer */
+};
+
+static int _thsafe_ring_ring_doorbell (int fd);
+static ssize_t _thsafe_ring_wait_completion (thsafe_ring_t *self, uint64_t seq);
+static thsafe_ring_slot_t *_thsafe_ring_publish (thsafe_ring_t *self,
+        uint32_t opcode, uint64_t offset, uint64_t data, bool posted);
+static ssize_t _thsafe_ring_posted_status (thsafe_ring_t *self);
+
+/* Creates a new instance of the register access ring */
+thsafe_ring_t *thsafe_ring_new (void)
+{
+    thsafe_ring_t *self = NULL;
+    int err = posix_memalign ((void **) &self, THSAFE_RING_CACHE_LINE_SIZE,
+            sizeof *self);
+    ASSERT_TEST(err == 0, "Could not allocate ring", err_self_alloc);
+    memset (self, 0, sizeof *self);
+
+    /* The consumer polls the request doorbell, so it must not block */
+    self->req_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ASSERT_TEST(self->req_fd != -1, "Could not create request doorbell",
+            err_req_fd);
+    /* The producer sleeps on the reply doorbell */
+    self->rep_fd = eventfd (0, EFD_CLOEXEC);
+    ASSERT_TEST(self->rep_fd != -1, "Could not create reply doorbell",
+            err_rep_fd);
+
+    return self;
+
+err_rep_fd:
+    close (self->req_fd);
+err_req_fd:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy an instance of the register access ring */
+msg_err_e thsafe_ring_destroy (thsafe_ring_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        thsafe_ring_t *self = *self_p;
+
+        close (self->rep_fd);
+        close (self->req_fd);
+
+        free (self);
+        *self_p = NULL;
+    }
+
+    return MSG_SUCCESS;
+}
+
+int thsafe_ring_get_fd (thsafe_ring_t *self)
+{
+    assert (self);
+    return self->req_fd;
+}
+
+ssize_t thsafe_ring_call (thsafe_ring_t *self, uint32_t opcode, uint64_t offset,
+        uint64_t *data)
+{
+    assert (self);
+    assert (data);
+
+    ssize_t ret = -1;
+    /* We are the only one writing head */
+    uint64_t head = self->head;
+
+    thsafe_ring_slot_t *slot = _thsafe_ring_publish (self, opcode, offset,
+            *data, false);
+    ASSERT_TEST(slot != NULL, "Could not publish request", err_publish);
+
+    ret = _thsafe_ring_wait_completion (self, head);
+    ASSERT_TEST(ret == 0, "Could not wait for the request completion",
+            err_wait_completion);
+
+    *data = slot->data;
+    ret = slot->ret;
+
+    /* Requests are consumed in order, so the writes posted before this one
+     * are complete as well */
+    if (_thsafe_ring_posted_status (self) < 0) {
+        ret = -1;
+    }
+
+err_wait_completion:
+err_publish:
+    return ret;
+}
+
+ssize_t thsafe_ring_post (thsafe_ring_t *self, uint32_t opcode, uint64_t offset,
+        uint64_t data)
+{
+    assert (self);
+
+    thsafe_ring_slot_t *slot = _thsafe_ring_publish (self, opcode, offset,
+            data, true);
+    return (slot != NULL) ? 0 : -1;
+}
+
+ssize_t thsafe_ring_fence (thsafe_ring_t *self)
+{
+    assert (self);
+
+    /* We are the only one writing head */
+    uint64_t head = self->head;
+
+    if (head != 0) {
+        ssize_t ret = _thsafe_ring_wait_completion (self, head - 1);
+        ASSERT_TEST(ret == 0, "Could not wait for the requests completion",
+                err_wait_completion);
+    }
+
+    return _thsafe_ring_posted_status (self);
+
+err_wait_completion:
+    return -1;
+}
+
+msg_err_e thsafe_ring_consume (thsafe_ring_t *self, thsafe_ring_exec_fp exec_fp,
+        void *owner)
+{
+    assert (self);
+    assert (exec_fp);
+
+    /* Acknowledge the doorbell before looking at the ring, so requests
+     * published from now on ring it again */
+    uint64_t count;
+    ssize_t ret = read (self->req_fd, &count, sizeof (count));
+    (void) ret;
+
+    /* We are the only one writing tail */
+    uint64_t tail = self->tail;
+    uint64_t head = __atomic_load_n (&self->head, __ATOMIC_ACQUIRE);
+
+    if (tail == head) {
+        return MSG_SUCCESS;
+    }
+
+    while (tail != head) {
+        thsafe_ring_slot_t *slot = &self->slots [tail & THSAFE_RING_SLOT_MASK];
+        exec_fp (owner, slot);
+        /* Released along with tail below */
+        if (slot->posted && slot->ret < 0) {
+            __atomic_fetch_add (&self->posted_errs, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n (&self->tail, ++tail, __ATOMIC_RELEASE);
+
+        /* Pick up requests published in the meantime */
+        if (tail == head) {
+            head = __atomic_load_n (&self->head, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    int err = _thsafe_ring_ring_doorbell (self->rep_fd);
+    ASSERT_TEST(err == 0, "Could not ring reply doorbell", err_ring_doorbell);
+
+    return MSG_SUCCESS;
+
+err_ring_doorbell:
+    return MSG_ERR_INV;
+}
+
+/**************** Helper Functions ***************/
+
+static int _thsafe_ring_ring_doorbell (int fd)
+{
+    uint64_t one = 1;
+    ssize_t ret;
+
+    do {
+        ret = write (fd, &one, sizeof (one));
+    } while (ret == -1 && errno == EINTR);
+
+    return (ret == sizeof (one)) ? 0 : -1;
+}
+
+/* Fill the next slot and publish it to the consumer, waiting for a free
+ * slot if the ring is full. Returns the slot or NULL in case of error */
+static thsafe_ring_slot_t *_thsafe_ring_publish (thsafe_ring_t *self,
+        uint32_t opcode, uint64_t offset, uint64_t data, bool posted)
+{
+    /* We are the only one writing head */
+    uint64_t head = self->head;
+
+    /* Posted writes might fill the ring. Wait for the oldest request to
+     * complete, if they did */
+    if (head - __atomic_load_n (&self->tail, __ATOMIC_ACQUIRE) >=
+            THSAFE_RING_NUM_SLOTS) {
+        ssize_t ret = _thsafe_ring_wait_completion (self,
+                head - THSAFE_RING_NUM_SLOTS);
+        ASSERT_TEST(ret == 0, "Could not wait for a free slot", err_wait_slot);
+    }
+
+    thsafe_ring_slot_t *slot = &self->slots [head & THSAFE_RING_SLOT_MASK];
+    slot->opcode = opcode;
+    slot->ret = -1;
+    slot->offset = offset;
+    slot->data = data;
+    slot->posted = posted;
+
+    /* Publish the slot and ring the doorbell */
+    __atomic_store_n (&self->head, head + 1, __ATOMIC_RELEASE);
+    int err = _thsafe_ring_ring_doorbell (self->req_fd);
+    ASSERT_TEST(err == 0, "Could not ring request doorbell", err_ring_doorbell);
+
+    return slot;
+
+err_ring_doorbell:
+err_wait_slot:
+    return NULL;
+}
+
+/* Return -1 and clear the count if any of the posted writes consumed so
+ * far failed, 0 otherwise */
+static ssize_t _thsafe_ring_posted_status (thsafe_ring_t *self)
+{
+    /* Only pay for the exchange when there is something to clear */
+    if (__atomic_load_n (&self->posted_errs, __ATOMIC_RELAXED) == 0) {
+        return 0;
+    }
+
+    uint32_t errs = __atomic_exchange_n (&self->posted_errs, 0, __ATOMIC_RELAXED);
+    DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_ring] %u posted write(s) "
+            "failed\n", errs);
+    return -1;
+}
+
+/* Wait until the slot with sequence number "seq" is consumed. Spin for a
+ * while, as the DEVIO usually replies quickly, and then sleep on the reply
+ * doorbell */
+static ssize_t _thsafe_ring_wait_completion (thsafe_ring_t *self, uint64_t seq)
+{
+    uint32_t tries = 0;
+
+    while (__atomic_load_n (&self->tail, __ATOMIC_ACQUIRE) <= seq) {
+        if (tries < THSAFE_RING_SPIN_TRIES) {
+            ++tries;
+            continue;
+        }
+
+        /* The consumer rings the doorbell after advancing tail, so either
+         * we see the new tail above or the read below returns */
+        uint64_t count;
+        ssize_t ret = read (self->rep_fd, &count, sizeof (count));
+        if (ret == -1 && errno != EINTR) {
+            DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_ring] Could not "
+                    "read reply doorbell: %s\n", strerror (errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+static ssize_t _thsafe_ring_client_read_generic (smio_t *self, uint64_t offs,
+        uint64_t *data, uint32_t opcode);
+static ssize_t _thsafe_ring_client_write_generic (smio_t *self, uint64_t offs,
+        uint64_t data, uint32_t opcode, size_t size);
+static ssize_t _thsafe_ring_client_fence_posted (smio_t *self);
+
+/* If the SMIO was not given a ring, fall back to zeroMQ */
+#define THSAFE_RING_CLIENT_FALLBACK(func_name, ...)                         \
+    do {                                                                    \
+        if (smio_get_thsafe_ring (self) == NULL) {                          \
+            return smio_thsafe_client_zmq_ops.func_name (self, ##__VA_ARGS__); \
+        }                                                                   \
+    } while (0)
+
+/* Requests going through zeroMQ could overtake the writes still posted on
+ * the ring, so wait for these first */
+#define THSAFE_RING_CLIENT_ORDERED(func_name, ...)                          \
+    do {                                                                    \
+        if (_thsafe_ring_client_fence_posted (self) < 0) {                  \
+            return -1;                                                      \
+        }                                                                   \
+        return func_name (self, ##__VA_ARGS__);                             \
+    } while (0)
+
+/**** Read data from device ****/
+static ssize_t thsafe_ring_client_read_16 (smio_t *self, uint64_t offs, uint16_t *data)
+{
+    THSAFE_RING_CLIENT_FALLBACK(thsafe_client_read_16, offs, data);
+
+    uint64_t value = 0;
+    ssize_t ret = _thsafe_ring_client_read_generic (self, offs, &value,
+            THSAFE_OPCODE_READ_16);
+    *data = value;
+    return (ret < 0) ? ret : (ssize_t) THSAFE_READ_16_DSIZE;
+}
+
+static ssize_t thsafe_ring_client_read_32 (smio_t *self, uint64_t offs, uint32_t *data)
+{
+    THSAFE_RING_CLIENT_FALLBACK(thsafe_client_read_32, offs, data);
+
+    uint64_t value = 0;
+    ssize_t ret = _thsafe_ring_client_read_generic (self, offs, &value,
+            THSAFE_OPCODE_READ_32);
+    *data = value;
+    return (ret < 0) ? ret : (ssize_t) THSAFE_READ_32_DSIZE;
+}
+
+static ssize_t thsafe_ring_client_read_64 (smio_t *self, uint64_t offs, uint64_t *data)
+{
+    THSAFE_RING_CLIENT_FALLBACK(thsafe_client_read_64, offs, data);
+
+    ssize_t ret = _thsafe_ring_client_read_generic (self, offs, data,
+            THSAFE_OPCODE_READ_64);
+    return (ret < 0) ? ret : (ssize_t) THSAFE_READ_64_DSIZE;
+}
+
+/**** Write data to device ****/
+static ssize_t thsafe_ring_client_write_16 (smio_t *self, uint64_t offs, const uint16_t *data)
+{
+    THSAFE_RING_CLIENT_FALLBACK(thsafe_client_write_16, offs, data);
+    return _thsafe_ring_client_write_generic (self, offs, *data,
+            THSAFE_OPCODE_WRITE_16, THSAFE_WRITE_16_DSIZE);
+}
+
+static ssize_t thsafe_ring_client_write_32 (smio_t *self, uint64_t offs, const uint32_t *data)
+{
+    THSAFE_RING_CLIENT_FALLBACK(thsafe_client_write_32, offs, data);
+    return _thsafe_ring_client_write_generic (self, offs, *data,
+            THSAFE_OPCODE_WRITE_32, THSAFE_WRITE_32_DSIZE);
+}
+
+static ssize_t thsafe_ring_client_write_64 (smio_t *self, uint64_t offs, const uint64_t *data)
+{
+    THSAFE_RING_CLIENT_FALLBACK(thsafe_client_write_64, offs, data);
+    return _thsafe_ring_client_write_generic (self, offs, *data,
+            THSAFE_OPCODE_WRITE_64, THSAFE_WRITE_64_DSIZE);
+}
+
+/**** Read/Write data blocks and batches from/to device ****/
+static ssize_t thsafe_ring_client_read_block (smio_t *self, uint64_t offs,
+        size_t size, uint32_t *data)
+{
+    THSAFE_RING_CLIENT_ORDERED(thsafe_zmq_client_read_block, offs, size, data);
+}
+
+static ssize_t thsafe_ring_client_write_block (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data)
+{
+    THSAFE_RING_CLIENT_ORDERED(thsafe_zmq_client_write_block, offs, size, data);
+}
+
+static ssize_t thsafe_ring_client_read_dma (smio_t *self, uint64_t offs,
+        size_t size, uint32_t *data)
+{
+    THSAFE_RING_CLIENT_ORDERED(thsafe_zmq_client_read_dma, offs, size, data);
+}
+
+static ssize_t thsafe_ring_client_write_dma (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data)
+{
+    THSAFE_RING_CLIENT_ORDERED(thsafe_zmq_client_write_dma, offs, size, data);
+}
+
+static ssize_t thsafe_ring_client_batch (smio_t *self, thsafe_batch_op_t *ops,
+        size_t num_ops)
+{
+    THSAFE_RING_CLIENT_ORDERED(thsafe_zmq_client_batch, ops, num_ops);
+}
+
+static ssize_t thsafe_ring_client_read_blockv (smio_t *self,
+        const llio_iov_t *iov, size_t iovcnt)
+{
+    THSAFE_RING_CLIENT_ORDERED(thsafe_zmq_client_read_blockv, iov, iovcnt);
+}
+
+/**** Wait for the posted writes ****/
+static ssize_t thsafe_ring_client_fence (smio_t *self)
+{
+    THSAFE_RING_CLIENT_FALLBACK(thsafe_client_fence);
+
+    ssize_t ret = thsafe_ring_fence (smio_get_thsafe_ring (self));
+    if (ret < 0) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_client:ring] Posted "
+                "writes failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*************** Helper functions **************/
+
+static ssize_t _thsafe_ring_client_read_generic (smio_t *self, uint64_t offs,
+        uint64_t *data, uint32_t opcode)
+{
+    ssize_t ret = thsafe_ring_call (smio_get_thsafe_ring (self), opcode, offs,
+            data);
+    if (ret < 0) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_client:ring] Could not "
+                "read from offset 0x%"PRIx64"\n", offs);
+        return -1;
+    }
+
+    return ret;
+}
+
+static ssize_t _thsafe_ring_client_write_generic (smio_t *self, uint64_t offs,
+        uint64_t data, uint32_t opcode, size_t size)
+{
+    ssize_t ret;
+
+    if (smio_get_posted_writes (self)) {
+        ret = thsafe_ring_post (smio_get_thsafe_ring (self), opcode, offs, data);
+        /* Reported as written. Failures show up at the next fence */
+        ret = (ret < 0) ? ret : (ssize_t) size;
+    }
+    else {
+        ret = thsafe_ring_call (smio_get_thsafe_ring (self), opcode, offs,
+                &data);
+    }
+
+    if (ret < 0) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_client:ring] Could not "
+                "write to offset 0x%"PRIx64"\n", offs);
+        return -1;
+    }
+
+    return ret;
+}
+
+/* Fence the writes posted on the ring, if any. Returns 0 or -1 if any
+ * of them failed */
+static ssize_t _thsafe_ring_client_fence_posted (smio_t *self)
+{
+    if (!smio_get_posted_writes (self) || smio_get_thsafe_ring (self) == NULL) {
+        return 0;
+    }
+
+    return thsafe_ring_client_fence (self);
+}
+
+/*************** Our constant structure **************/
+
+/* Only the single register accesses go through the ring. Everything else
+ * is still handled by zeroMQ, after the writes posted on the ring */
+const smio_thsafe_client_ops_t smio_thsafe_client_ring_ops = {
+    .thsafe_client_open           = thsafe_zmq_client_open,        /* Open device */
+    .thsafe_client_release        = thsafe_zmq_client_release,     /* Release device */
+    .thsafe_client_read_16        = thsafe_ring_client_read_16,    /* Read 16-bit data */
+    .thsafe_client_read_32        = thsafe_ring_client_read_32,    /* Read 32-bit data */
+    .thsafe_client_read_64        = thsafe_ring_client_read_64,    /* Read 64-bit data */
+    .thsafe_client_write_16       = thsafe_ring_client_write_16,   /* Write 16-bit data */
+    .thsafe_client_write_32       = thsafe_ring_client_write_32,   /* Write 32-bit data */
+    .thsafe_client_write_64       = thsafe_ring_client_write_64,   /* Write 64-bit data */
+    .thsafe_client_read_block     = thsafe_ring_client_read_block, /* Read arbitrary block size data,
+                                                                        parameter size in bytes */
+    .thsafe_client_write_block    = thsafe_ring_client_write_block,/* Write arbitrary block size data,
+                                                                        parameter size in bytes */
+    .thsafe_client_read_dma       = thsafe_ring_client_read_dma,   /* Read arbitrary block size data via DMA,
+                                                                        parameter size in bytes */
+    .thsafe_client_write_dma      = thsafe_ring_client_write_dma,  /* Write arbitrary block size data via DMA,
+                                                                        parameter size in bytes */
+    .thsafe_client_batch          = thsafe_ring_client_batch,      /* Execute a batch of register
+                                                                        operations */
+    .thsafe_client_read_blockv    = thsafe_ring_client_read_blockv,/* Read scattered blocks in
+                                                                        a single request */
+    .thsafe_client_fence          = thsafe_ring_client_fence       /* Wait for the posted writes */
+};
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+/* Execute a single register access request from the ring. This is the
+ * counterpart of the READ/WRITE thsafe zeroMQ server operations */
+void smio_thsafe_ring_server_exec (void *owner, thsafe_ring_slot_t *slot)
+{
+    assert (owner);
+    assert (slot);
+
+    DEVIO_OWNER_TYPE *self = DEVIO_EXP_OWNER(owner);
+    llio_t *llio = devio_get_llio (self);
+    int32_t llio_ret = -1;
+
+    switch (slot->opcode) {
+        case THSAFE_OPCODE_READ_16:
+        {
+            uint16_t data = 0;
+            llio_ret = llio_read_16 (llio, slot->offset, &data);
+            slot->data = data;
+        }
+        break;
+
+        case THSAFE_OPCODE_READ_32:
+        {
+            uint32_t data = 0;
+            llio_ret = llio_read_32 (llio, slot->offset, &data);
+            slot->data = data;
+        }
+        break;
+
+        case THSAFE_OPCODE_READ_64:
+            llio_ret = llio_read_64 (llio, slot->offset, &slot->data);
+        break;
+
+        case THSAFE_OPCODE_WRITE_16:
+        {
+            uint16_t data = slot->data;
+            llio_ret = llio_write_16 (llio, slot->offset, &data);
+        }
+        break;
+
+        case THSAFE_OPCODE_WRITE_32:
+        {
+            uint32_t data = slot->data;
+            llio_ret = llio_write_32 (llio, slot->offset, &data);
+        }
+        break;
+
+        case THSAFE_OPCODE_WRITE_64:
+            llio_ret = llio_write_64 (llio, slot->offset, &slot->data);
+        break;
+
+        default:
+            DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_server:ring] "
+                    "Unsupported opcode %u\n", slot->opcode);
+    }
+
+    slot->ret = llio_ret;
+}
@@ -38,6 +38,12 @@ static ssize_t _thsafe_zmq_client_write_generic (smio_t *self, uint64_t offs, co
         uint32_t size);
 static ssize_t _thsafe_zmq_client_recv_rw (smio_t *self, uint8_t *data,
         uint32_t size, bool accept_empty_data);
+static ssize_t _thsafe_zmq_client_recv_rwv (smio_t *self, const llio_iov_t *iov,
+        size_t iovcnt, bool accept_empty_data);
+static ssize_t _thsafe_zmq_client_read_block_generic (smio_t *self, uint64_t offs,
+        size_t size, uint32_t *data, uint32_t opcode);
+static ssize_t _thsafe_zmq_client_write_block_generic (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data, uint32_t opcode);
 
 /**** Open device ****/
 int thsafe_zmq_client_open (smio_t *self, llio_endpoint_t *endpoint)
@@ -86,20 +92,176 @@ ssize_t thsafe_zmq_client_write_64 (smio_t *self, uint64_t offs, const uint64_t
 
 /**** Read data block from device function pointer, size in bytes ****/
 ssize_t thsafe_zmq_client_read_block (smio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    return _thsafe_zmq_client_read_block_generic (self, offs, size, data,
+            THSAFE_OPCODE_READ_BLOCK);
+}
+
+/**** Write data block from device function pointer, size in bytes ****/
+ssize_t thsafe_zmq_client_write_block (smio_t *self, uint64_t offs, size_t size, const uint32_t *data)
+{
+    return _thsafe_zmq_client_write_block_generic (self, offs, size, data,
+            THSAFE_OPCODE_WRITE_BLOCK);
+}
+
+/**** Read data block via DMA from device, size in bytes ****/
+ssize_t thsafe_zmq_client_read_dma (smio_t *self, uint64_t offs, size_t size, uint32_t *data)
+{
+    return _thsafe_zmq_client_read_block_generic (self, offs, size, data,
+            THSAFE_OPCODE_READ_DMA);
+}
+
+/**** Write data block via DMA from device, size in bytes ****/
+ssize_t thsafe_zmq_client_write_dma (smio_t *self, uint64_t offs, size_t size, const uint32_t *data)
+{
+    return _thsafe_zmq_client_write_block_generic (self, offs, size, data,
+            THSAFE_OPCODE_WRITE_DMA);
+}
+
+/**** Execute a batch of register operations, in order ****/
+ssize_t thsafe_zmq_client_batch (smio_t *self, thsafe_batch_op_t *ops, size_t num_ops)
 {
     assert (self);
+    assert (ops);
     ssize_t ret_size = -1;
+    size_t size = num_ops * sizeof (*ops);
+    ASSERT_TEST(num_ops > 0 && num_ops <= THSAFE_BATCH_MAX_OPS,
+            "Invalid number of batch operations", err_inv_num_ops);
+
     zmsg_t *send_msg = zmsg_new ();
     ASSERT_ALLOC(send_msg, err_msg_alloc);
-    uint32_t opcode = THSAFE_OPCODE_READ_BLOCK;
     zsock_t *pipe_msg = smio_get_pipe_msg (self);
     ASSERT_TEST(pipe_msg != NULL, "Could not get SMIO PIPE MSG",
             err_get_pipe_msg);
 
-    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Calling thsafe_read_block\n");
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Calling thsafe_batch\n");
+
+    /* Message is:
+     * frame 0: BATCH opcode
+     * frame 1: array of operations */
+    uint32_t opcode = THSAFE_OPCODE_BATCH;
+    int zerr = zmsg_addmem (send_msg, &opcode, sizeof (opcode));
+    ASSERT_TEST(zerr == 0, "Could not add BATCH opcode in message",
+            err_add_opcode);
+    zerr = zmsg_addmem (send_msg, ops, size);
+    ASSERT_TEST(zerr == 0, "Could not add operations in message",
+            err_add_ops);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Sending message:\n");
+#ifdef LOCAL_MSG_DBG
+    errhand_log_print_zmq_msg (send_msg);
+#endif
+
+    zerr = zmsg_send (&send_msg, pipe_msg);
+    ASSERT_TEST(zerr == 0, "Could not send message", err_send_msg);
+    /* Ends when the reply is received */
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "thsafe:batch", ERRHAND_TRACE_BEGIN);
+
+    /* Message is:
+     * frame 0: reply code
+     * frame 1: return code
+     * frame 2: array of operations, with the values read/written */
+    ret_size = _thsafe_zmq_client_recv_rw (self, (uint8_t *) ops, size, false);
+
+err_send_msg:
+err_add_ops:
+err_add_opcode:
+err_get_pipe_msg:
+    zmsg_destroy (&send_msg);
+err_msg_alloc:
+err_inv_num_ops:
+    return ret_size;
+}
+
+/**** Read scattered data blocks from device, in a single request ****/
+ssize_t thsafe_zmq_client_read_blockv (smio_t *self, const llio_iov_t *iov,
+        size_t iovcnt)
+{
+    assert (self);
+    assert (iov);
+    ssize_t ret_size = -1;
+    ASSERT_TEST(iovcnt > 0 && iovcnt <= THSAFE_BLOCKV_MAX_EXTS,
+            "Invalid number of vectored read extents", err_inv_iovcnt);
+
+    thsafe_blockv_ext_t exts [THSAFE_BLOCKV_MAX_EXTS];
+    size_t i;
+    for (i = 0; i < iovcnt; ++i) {
+        exts [i] = (thsafe_blockv_ext_t) {
+            .offset = iov [i].offs,
+            .size = iov [i].size
+        };
+    }
+
+    zmsg_t *send_msg = zmsg_new ();
+    ASSERT_ALLOC(send_msg, err_msg_alloc);
+    zsock_t *pipe_msg = smio_get_pipe_msg (self);
+    ASSERT_TEST(pipe_msg != NULL, "Could not get SMIO PIPE MSG",
+            err_get_pipe_msg);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Calling thsafe_read_blockv\n");
+
+    /* Message is:
+     * frame 0: READ_BLOCKV opcode
+     * frame 1: array of extents */
+    uint32_t opcode = THSAFE_OPCODE_READ_BLOCKV;
+    int zerr = zmsg_addmem (send_msg, &opcode, sizeof (opcode));
+    ASSERT_TEST(zerr == 0, "Could not add READ_BLOCKV opcode in message",
+            err_add_opcode);
+    zerr = zmsg_addmem (send_msg, exts, iovcnt * sizeof (*exts));
+    ASSERT_TEST(zerr == 0, "Could not add extents in message",
+            err_add_exts);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Sending message:\n");
+#ifdef LOCAL_MSG_DBG
+    errhand_log_print_zmq_msg (send_msg);
+#endif
+
+    zerr = zmsg_send (&send_msg, pipe_msg);
+    ASSERT_TEST(zerr == 0, "Could not send message", err_send_msg);
+    /* Ends when the reply is received */
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "thsafe:read_blockv", ERRHAND_TRACE_BEGIN);
 
     /* Message is:
-     * frame 0: READ_BLOCK opcode
+     * frame 0: reply code
+     * frame 1: return code
+     * frame 2: data of all of the extents, in order */
+    ret_size = _thsafe_zmq_client_recv_rwv (self, iov, iovcnt, false);
+
+err_send_msg:
+err_add_exts:
+err_add_opcode:
+err_get_pipe_msg:
+    zmsg_destroy (&send_msg);
+err_msg_alloc:
+err_inv_iovcnt:
+    return ret_size;
+}
+
+/**** Read device information function pointer ****/
+/* int thsafe_zmq_client_read_info (smio_t *self, thsafe_dev_info_t *dev_info)
+ *{
+ *  (void) self;
+ *  (void) dev_info;
+ *   return -1;
+ *} */
+
+/*************** Helper functions **************/
+
+static ssize_t _thsafe_zmq_client_read_block_generic (smio_t *self, uint64_t offs,
+        size_t size, uint32_t *data, uint32_t opcode)
+{
+    assert (self);
+    ssize_t ret_size = -1;
+    zmsg_t *send_msg = zmsg_new ();
+    ASSERT_ALLOC(send_msg, err_msg_alloc);
+    zsock_t *pipe_msg = smio_get_pipe_msg (self);
+    ASSERT_TEST(pipe_msg != NULL, "Could not get SMIO PIPE MSG",
+            err_get_pipe_msg);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Calling thsafe_read_block/dma\n");
+
+    /* Message is:
+     * frame 0: READ_BLOCK or READ_DMA opcode
      * frame 1: offset
      * frame 2: number of bytes to be read */
     int zerr = zmsg_addmem (send_msg, &opcode, sizeof (opcode));
@@ -119,6 +281,8 @@ ssize_t thsafe_zmq_client_read_block (smio_t *self, uint64_t offs, size_t size,
 
     zerr = zmsg_send (&send_msg, pipe_msg);
     ASSERT_TEST(zerr == 0, "Could not send message", err_send_msg);
+    /* Ends when the reply is received */
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "thsafe:read_block", ERRHAND_TRACE_BEGIN);
 
     /* Message is:
      * frame 0: reply code
@@ -136,21 +300,20 @@ err_msg_alloc:
     return ret_size;
 }
 
-/**** Write data block from device function pointer, size in bytes ****/
-ssize_t thsafe_zmq_client_write_block (smio_t *self, uint64_t offs, size_t size, const uint32_t *data)
+static ssize_t _thsafe_zmq_client_write_block_generic (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data, uint32_t opcode)
 {
     assert (self);
     zmsg_t *send_msg = zmsg_new ();
     ASSERT_ALLOC(send_msg, err_msg_alloc);
-    uint32_t opcode = THSAFE_OPCODE_WRITE_BLOCK;
     zsock_t *pipe_msg = smio_get_pipe_msg (self);
     ASSERT_TEST(pipe_msg != NULL, "Could not get SMIO PIPE MSG",
             err_get_pipe_msg);
 
-    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Calling thsafe_write_block\n");
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_client:zmq] Calling thsafe_write_block/dma\n");
 
     /* Message is:
-     * frame 0: WRITE_BLOCK opcode
+     * frame 0: WRITE_BLOCK or WRITE_DMA opcode
      * frame 1: offset
      * frame 2: data to be written
      * */
@@ -171,6 +334,8 @@ ssize_t thsafe_zmq_client_write_block (smio_t *self, uint64_t offs, size_t size,
 
     zerr = zmsg_send (&send_msg, pipe_msg);
     ASSERT_TEST(zerr == 0, "Could not send message", err_send_msg);
+    /* Ends when the reply is received */
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "thsafe:write_block", ERRHAND_TRACE_BEGIN);
 
     /* Message is:
      * frame 0: reply code
@@ -196,36 +361,6 @@ err_msg_alloc:
     return -1;
 }
 
-/**** Read data block via DMA from device, size in bytes ****/
-ssize_t thsafe_zmq_client_read_dma (smio_t *self, uint64_t offs, size_t size, uint32_t *data)
-{
-    (void) self;
-    (void) offs;
-    (void) size;
-    (void) data;
-    return -1;
-}
-
-/**** Write data block via DMA from device, size in bytes ****/
-ssize_t thsafe_zmq_client_write_dma (smio_t *self, uint64_t offs, size_t size, const uint32_t *data)
-{
-    (void) self;
-    (void) offs;
-    (void) size;
-    (void) data;
-    return -1;
-}
-
-/**** Read device information function pointer ****/
-/* int thsafe_zmq_client_read_info (smio_t *self, thsafe_dev_info_t *dev_info)
- *{
- *  (void) self;
- *  (void) dev_info;
- *   return -1;
- *} */
-
-/*************** Helper functions **************/
-
 int _thsafe_zmq_client_open_release (smio_t *self, llio_endpoint_t *endpoint, uint32_t opcode)
 {
     (void) endpoint;
@@ -343,6 +478,8 @@ static ssize_t _thsafe_zmq_client_read_generic (smio_t *self, uint64_t offs, uin
 
     zerr = zmsg_send (&send_msg, pipe_msg);
     ASSERT_TEST(zerr == 0, "Could not send message", err_send_msg);
+    /* Ends when the reply is received */
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "thsafe:read", ERRHAND_TRACE_BEGIN);
 
     /* Message is:
      * frame 0: reply code
@@ -412,6 +549,8 @@ static ssize_t _thsafe_zmq_client_write_generic (smio_t *self, uint64_t offs, co
     zerr = zmsg_send (&send_msg, pipe_msg);
     ASSERT_TEST(zerr == 0, "Could not send message",
             err_send_msg);
+    /* Ends when the reply is received */
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "thsafe:write", ERRHAND_TRACE_BEGIN);
 
     /* Message is:
      * frame 0: reply code
@@ -486,8 +625,21 @@ err_get_pipe_msg:
 
 static ssize_t _thsafe_zmq_client_recv_rw (smio_t *self, uint8_t *data,
         uint32_t size, bool accept_empty_data)
+{
+    const llio_iov_t iov = {.offs = 0, .size = size, .data = (uint32_t *) data};
+    return _thsafe_zmq_client_recv_rwv (self, &iov, 1, accept_empty_data);
+}
+
+/* Receive a reply, scattering its data to "iov" */
+static ssize_t _thsafe_zmq_client_recv_rwv (smio_t *self, const llio_iov_t *iov,
+        size_t iovcnt, bool accept_empty_data)
 {
     ssize_t ret_size = -1;
+    size_t size = 0;
+    size_t i;
+    for (i = 0; i < iovcnt; ++i) {
+        size += iov [i].size;
+    }
 
     /* Returns NULL if confirmation was not OK or in case of error.
      * Returns the original message if the confirmation was OK */
@@ -533,7 +685,10 @@ static ssize_t _thsafe_zmq_client_recv_rw (smio_t *self, uint8_t *data,
                 err_buf_size_data);
 
         uint8_t* raw_data = (uint8_t *) zframe_data (data_frame);
-        memcpy (data, raw_data, size);
+        for (i = 0; i < iovcnt; ++i) {
+            memcpy (iov [i].data, raw_data, iov [i].size);
+            raw_data += iov [i].size;
+        }
         ret_size = size;
     }
 
@@ -548,9 +703,19 @@ err_wrong_size_ret_frame:
 err_null_ret_code_frame:
     zmsg_destroy (&recv_msg);
 err_null_recv_msg:
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "thsafe", ERRHAND_TRACE_END);
     return ret_size;
 }
 
+/**** Wait for the posted writes ****/
+/* Writes through zeroMQ always wait for their reply, so there is never
+ * anything to wait for */
+static ssize_t thsafe_zmq_client_fence (smio_t *self)
+{
+    (void) self;
+    return 0;
+}
+
 /*************** Our constant structure **************/
 const smio_thsafe_client_ops_t smio_thsafe_client_zmq_ops = {
     .thsafe_client_open           = thsafe_zmq_client_open,        /* Open device */
@@ -567,7 +732,12 @@ const smio_thsafe_client_ops_t smio_thsafe_client_zmq_ops = {
                                                                         parameter size in bytes */
     .thsafe_client_read_dma       = thsafe_zmq_client_read_dma,    /* Read arbitrary block size data via DMA,
      _                                                                  parameter size in bytes */
-    .thsafe_client_write_dma      = thsafe_zmq_client_write_dma    /* Write arbitrary block size data via DMA,
+    .thsafe_client_write_dma      = thsafe_zmq_client_write_dma,   /* Write arbitrary block size data via DMA,
                                                                         parameter size in bytes */
+    .thsafe_client_batch          = thsafe_zmq_client_batch,       /* Execute a batch of register
+                                                                        operations */
+    .thsafe_client_read_blockv    = thsafe_zmq_client_read_blockv, /* Read scattered blocks in
+                                                                        a single request */
+    .thsafe_client_fence          = thsafe_zmq_client_fence        /* Wait for the posted writes */
     /*.thsafe_client_read_info      = thsafe_zmq_client_read_info */   /* Read device information data */
 };
@@ -30,6 +30,20 @@
     CHECK_HAL_ERR(err, MSG, "[smio_thsafe_server:zmq]",     \
             msg_err_str (err_type))
 
+/* Asynchronous llio block read function pointer */
+typedef llio_err_e (*thsafe_zmq_server_read_async_fp) (llio_t *self, uint64_t offs,
+        size_t size, uint32_t *data, llio_async_cb_fp cb, void *arg);
+
+/* A block read in flight */
+typedef struct {
+    msg_deferred_t *reply;              /* Deferred reply to the client */
+    uint32_t *data;                     /* Read buffer, owned by us */
+} thsafe_zmq_server_read_async_t;
+
+static int _thsafe_zmq_server_read_async (DEVIO_OWNER_TYPE *self, void *args,
+        uint32_t opcode, thsafe_zmq_server_read_async_fp read_async,
+        uint64_t offset, size_t read_bsize);
+
 /**** Open device ****/
 static int _thsafe_zmq_server_open (void *owner, void *args, void *ret)
 {
@@ -313,6 +327,13 @@ static int _thsafe_zmq_server_read_block (void *owner, void *args, void *ret)
 
     DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Offset = %lu, "
             "size = %ld\n", offset, read_bsize);
+    /* Don't hold the other requests while the block is read. The
+     * client is replied to when the read is done */
+    if (llio_get_async_enabled (llio)) {
+        return _thsafe_zmq_server_read_async (self, args, THSAFE_OPCODE_READ_BLOCK,
+                llio_read_block_async, offset, read_bsize);
+    }
+
     /* Call llio to perform the actual operation */
     int32_t llio_ret = llio_read_block (llio, offset, read_bsize,
             (uint32_t *) ret);
@@ -381,10 +402,29 @@ disp_op_t thsafe_zmq_server_write_block_exp = {
 /**** Read data block via DMA from device, size in bytes ****/
 static int _thsafe_zmq_server_read_dma (void *owner, void *args, void *ret)
 {
-    (void) owner;
-    (void) args;
-    (void) ret;
-    return -1;
+    assert (owner);
+    assert (args);
+    DEVIO_OWNER_TYPE *self = DEVIO_EXP_OWNER(owner);
+    llio_t *llio = devio_get_llio (self);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Calling thsafe_read_dma\n");
+    uint64_t offset = *(uint64_t *) THSAFE_MSG_ZMQ_FIRST_ARG(args);
+    size_t read_bsize = *(size_t *) THSAFE_MSG_ZMQ_NEXT_ARG(args);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Offset = %lu, "
+            "size = %ld\n", offset, read_bsize);
+    /* Don't hold the other requests while the block is read. The
+     * client is replied to when the read is done */
+    if (llio_get_async_enabled (llio)) {
+        return _thsafe_zmq_server_read_async (self, args, THSAFE_OPCODE_READ_DMA,
+                llio_read_dma_async, offset, read_bsize);
+    }
+
+    /* Call llio to perform the actual operation */
+    int32_t llio_ret = llio_read_dma (llio, offset, read_bsize,
+            (uint32_t *) ret);
+
+    return llio_ret;
 }
 
 disp_op_t thsafe_zmq_server_read_dma_exp = {
@@ -403,10 +443,31 @@ disp_op_t thsafe_zmq_server_read_dma_exp = {
 /**** Write data block via DMA from device, size in bytes ****/
 static int _thsafe_zmq_server_write_dma (void *owner, void *args, void *ret)
 {
-    (void) owner;
-    (void) args;
-    (void) ret;
-    return -1;
+    assert (owner);
+    assert (args);
+    DEVIO_OWNER_TYPE *self = DEVIO_EXP_OWNER(owner);
+    llio_t *llio = devio_get_llio (self);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Calling thsafe_write_dma\n");
+    THSAFE_MSG_ZMQ_ARG_TYPE offset_arg = THSAFE_MSG_ZMQ_POP_NEXT_ARG(args);
+    uint64_t offset = *(uint64_t *) GEN_MSG_ZMQ_ARG_DATA(offset_arg);
+    /* We now own the argument and must clean it after use */
+    THSAFE_MSG_ZMQ_ARG_TYPE data_write_arg = THSAFE_MSG_ZMQ_POP_NEXT_ARG(args);
+    uint32_t *data_write = (uint32_t *)
+        ((zmq_server_data_block_t *) THSAFE_MSG_ZMQ_ARG_DATA(data_write_arg))->data;
+    uint32_t data_write_size = THSAFE_MSG_ZMQ_ARG_SIZE(data_write_arg);
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Arg is %u bytes\n",
+            data_write_size);
+
+    int32_t llio_ret = llio_write_dma (llio, offset, data_write_size,
+            data_write);
+    *(int32_t *) ret = llio_ret;
+
+    /* Cleanup arguments that we now own */
+    THSAFE_MSG_CLENUP_ARG(&offset_arg);
+    THSAFE_MSG_CLENUP_ARG(&data_write_arg);
+
+    return sizeof (int32_t);
 }
 
 disp_op_t thsafe_zmq_server_write_dma_exp = {
@@ -422,6 +483,240 @@ disp_op_t thsafe_zmq_server_write_dma_exp = {
     }
 };
 
+/* Poll a register until the bits in op->mask read as op->value, leaving the
+ * last value read in op->value. Returns -1 on timeout */
+static ssize_t _thsafe_zmq_server_batch_poll (llio_t *llio, thsafe_batch_op_t *op)
+{
+    const uint32_t expected = op->value & op->mask;
+    struct timespec start;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    while (1) {
+        ssize_t llio_ret = llio_read_32 (llio, op->offset, &op->value);
+        if (llio_ret != sizeof (uint32_t)) {
+            return llio_ret;
+        }
+
+        if ((op->value & op->mask) == expected) {
+            return llio_ret;
+        }
+
+        struct timespec now;
+        clock_gettime (CLOCK_MONOTONIC, &now);
+        int64_t elapsed_us = (int64_t) (now.tv_sec - start.tv_sec) * 1000000 +
+            (now.tv_nsec - start.tv_nsec) / 1000;
+        if (elapsed_us >= THSAFE_BATCH_POLL_TIMEOUT_US) {
+            DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_server:zmq] Timeout "
+                    "polling offset 0x%"PRIx64"\n", op->offset);
+            return -1;
+        }
+    }
+}
+
+/* Serve the run of READ_32 operations to consecutive registers starting at
+ * "ops", if any, with a single block read. Returns the number of operations
+ * served, 0 if there is no such run, or -1 on error */
+static ssize_t _thsafe_zmq_server_batch_combine (llio_t *llio,
+        thsafe_batch_op_t *ops, uint32_t num_ops)
+{
+    uint32_t run = 1;
+    while (run < num_ops && run < THSAFE_BATCH_COMBINE_MAX &&
+            ops[run].op == THSAFE_BATCH_OP_READ_32 &&
+            ops[run].offset == ops[0].offset + run * sizeof (uint32_t)) {
+        ++run;
+    }
+
+    if (run == 1) {
+        return 0;
+    }
+
+    uint32_t regs [THSAFE_BATCH_COMBINE_MAX];
+    ssize_t llio_ret = llio_read_block (llio, ops[0].offset,
+            run * sizeof (uint32_t), regs);
+    if (llio_ret != (ssize_t) (run * sizeof (uint32_t))) {
+        return -1;
+    }
+
+    uint32_t i;
+    for (i = 0; i < run; ++i) {
+        ops[i].value = regs [i];
+    }
+
+    return run;
+}
+
+/**** Execute a batch of register operations, in order ****/
+static int _thsafe_zmq_server_batch (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    DEVIO_OWNER_TYPE *self = DEVIO_EXP_OWNER(owner);
+    llio_t *llio = devio_get_llio (self);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Calling thsafe_batch\n");
+    /* We now own the argument and must clean it after use */
+    THSAFE_MSG_ZMQ_ARG_TYPE ops_arg = THSAFE_MSG_ZMQ_POP_NEXT_ARG(args);
+    const thsafe_batch_op_t *ops = (const thsafe_batch_op_t *)
+        THSAFE_MSG_ZMQ_ARG_DATA(ops_arg);
+    uint32_t ops_size = THSAFE_MSG_ZMQ_ARG_SIZE(ops_arg);
+    int err = -1;
+
+    if (ops_size == 0 || ops_size % sizeof (*ops) != 0) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_server:zmq] Invalid "
+                "batch size: %u bytes\n", ops_size);
+        goto err_inv_size;
+    }
+
+    /* The reply is the same batch, with the values read/written */
+    thsafe_batch_op_t *ops_ret = ((zmq_server_batch_t *) ret)->ops;
+    memcpy (ops_ret, ops, ops_size);
+
+    uint32_t num_ops = ops_size / sizeof (*ops);
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Batch has "
+            "%u operations\n", num_ops);
+
+    uint32_t i;
+    for (i = 0; i < num_ops; ++i) {
+        thsafe_batch_op_t *op = &ops_ret[i];
+        ssize_t llio_ret = -1;
+
+        switch (op->op) {
+            case THSAFE_BATCH_OP_READ_32:
+            {
+                /* Nearby status/counter registers are often read back to
+                 * back. Save the device the single accesses */
+                ssize_t run = _thsafe_zmq_server_batch_combine (llio, op,
+                        num_ops - i);
+                if (run > 0) {
+                    i += run - 1;
+                    llio_ret = sizeof (uint32_t);
+                    break;
+                }
+
+                llio_ret = (run == 0) ?
+                    llio_read_32 (llio, op->offset, &op->value) : -1;
+            }
+            break;
+
+            case THSAFE_BATCH_OP_WRITE_32:
+                llio_ret = llio_write_32 (llio, op->offset, &op->value);
+            break;
+
+            case THSAFE_BATCH_OP_WRITE_MASK_32:
+            {
+                uint32_t reg = 0;
+                llio_ret = llio_read_32 (llio, op->offset, &reg);
+                if (llio_ret != sizeof (reg)) {
+                    break;
+                }
+
+                op->value = (reg & ~op->mask) | (op->value & op->mask);
+                llio_ret = llio_write_32 (llio, op->offset, &op->value);
+            }
+            break;
+
+            case THSAFE_BATCH_OP_POLL_32:
+                llio_ret = _thsafe_zmq_server_batch_poll (llio, op);
+            break;
+
+            default:
+                DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_server:zmq] "
+                        "Invalid batch operation #%u: %u\n", i, op->op);
+        }
+
+        if (llio_ret != sizeof (uint32_t)) {
+            DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_server:zmq] Batch "
+                    "operation #%u at offset 0x%"PRIx64" failed\n", i, op->offset);
+            goto err_llio;
+        }
+    }
+
+    err = ops_size;
+
+err_llio:
+err_inv_size:
+    /* Cleanup arguments that we now own */
+    THSAFE_MSG_CLENUP_ARG(&ops_arg);
+    return err;
+}
+
+disp_op_t thsafe_zmq_server_batch_exp = {
+    .name = THSAFE_NAME_BATCH,
+    .opcode = THSAFE_OPCODE_BATCH,
+    .func_fp = _thsafe_zmq_server_batch,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_VAR, zmq_server_batch_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_VAR, zmq_server_batch_t),
+        DISP_ARG_END
+    }
+};
+
+/**** Read scattered data blocks from device, in a single transfer ****/
+static int _thsafe_zmq_server_read_blockv (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    DEVIO_OWNER_TYPE *self = DEVIO_EXP_OWNER(owner);
+    llio_t *llio = devio_get_llio (self);
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Calling thsafe_read_blockv\n");
+    /* We now own the argument and must clean it after use */
+    THSAFE_MSG_ZMQ_ARG_TYPE exts_arg = THSAFE_MSG_ZMQ_POP_NEXT_ARG(args);
+    const thsafe_blockv_ext_t *exts = (const thsafe_blockv_ext_t *)
+        THSAFE_MSG_ZMQ_ARG_DATA(exts_arg);
+    uint32_t exts_size = THSAFE_MSG_ZMQ_ARG_SIZE(exts_arg);
+    int err = -1;
+
+    if (exts_size == 0 || exts_size % sizeof (*exts) != 0) {
+        DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_server:zmq] Invalid "
+                "vectored read size: %u bytes\n", exts_size);
+        goto err_inv_size;
+    }
+
+    /* The extents are read back to back into the reply */
+    uint8_t *data = ((zmq_server_data_block_t *) ret)->data;
+    uint32_t num_exts = exts_size / sizeof (*exts);
+    llio_iov_t iov [THSAFE_BLOCKV_MAX_EXTS];
+    uint64_t total = 0;
+    uint32_t i;
+    for (i = 0; i < num_exts; ++i) {
+        if (exts [i].size > ZMQ_SERVER_BLOCK_SIZE - total) {
+            DBE_DEBUG (DBG_MSG | DBG_LVL_ERR, "[smio_thsafe_server:zmq] Vectored "
+                    "read exceeds %u bytes\n", ZMQ_SERVER_BLOCK_SIZE);
+            goto err_inv_size;
+        }
+
+        iov [i] = (llio_iov_t) {
+            .offs = exts [i].offset,
+            .size = exts [i].size,
+            .data = (uint32_t *) (data + total)
+        };
+        total += exts [i].size;
+    }
+
+    DBE_DEBUG (DBG_MSG | DBG_LVL_TRACE, "[smio_thsafe_server:zmq] Vectored "
+            "read of %u extents, %"PRIu64" bytes\n", num_exts, total);
+    err = llio_read_blockv (llio, iov, num_exts);
+
+err_inv_size:
+    /* Cleanup arguments that we now own */
+    THSAFE_MSG_CLENUP_ARG(&exts_arg);
+    return err;
+}
+
+disp_op_t thsafe_zmq_server_read_blockv_exp = {
+    .name = THSAFE_NAME_READ_BLOCKV,
+    .opcode = THSAFE_OPCODE_READ_BLOCKV,
+    .func_fp = _thsafe_zmq_server_read_blockv,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_VAR, zmq_server_data_block_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_VAR, zmq_server_blockv_t),
+        DISP_ARG_END
+    }
+};
+
 /**** Read device information function pointer ****/
 /* int thsafe_zmq_server_read_info (void *owner, void *args, void *ret)
  *{
@@ -431,6 +726,61 @@ disp_op_t thsafe_zmq_server_write_dma_exp = {
  *  return NULL;
  *} */
 
+/*************** Helper functions **************/
+
+static void _thsafe_zmq_server_read_async_cb (llio_t *llio, ssize_t ret, void *arg)
+{
+    (void) llio;
+    thsafe_zmq_server_read_async_t *read = (thsafe_zmq_server_read_async_t *) arg;
+
+    /* The reply takes the buffer over and gives it back to the dispatch
+     * table once the SMIO is done with it */
+    msg_deferred_reply_zero_copy (&read->reply, ret, read->data);
+    free (read);
+}
+
+static int _thsafe_zmq_server_read_async (DEVIO_OWNER_TYPE *self, void *args,
+        uint32_t opcode, thsafe_zmq_server_read_async_fp read_async,
+        uint64_t offset, size_t read_bsize)
+{
+    int err = -1;
+    llio_t *llio = devio_get_llio (self);
+
+    /* Same limit as the synchronous reply buffer */
+    ASSERT_TEST(read_bsize <= ZMQ_SERVER_BLOCK_SIZE, "Block size is too big",
+            err_read_bsize);
+
+    thsafe_zmq_server_read_async_t *read = (thsafe_zmq_server_read_async_t *)
+        zmalloc (sizeof *read);
+    ASSERT_ALLOC(read, err_read_alloc);
+    /* Reply buffers are recycled by the dispatch table, so a stream of
+     * block reads doesn't allocate a new one for each of them */
+    read->data = (uint32_t *) disp_table_get_ret (
+            devio_get_thsafe_disp_table (self), opcode);
+    ASSERT_ALLOC(read->data, err_data_alloc);
+
+    read->reply = msg_defer_reply (args);
+    ASSERT_TEST(read->reply != NULL, "Could not defer reply", err_defer_reply);
+
+    llio_err_e lerr = read_async (llio, offset, read_bsize, read->data,
+            _thsafe_zmq_server_read_async_cb, read);
+    ASSERT_TEST(lerr == LLIO_SUCCESS, "Could not queue block read",
+            err_read_async);
+
+    return 0;
+
+err_read_async:
+    /* The reply was deferred already, so we must send it ourselves */
+    msg_deferred_reply (&read->reply, -1, NULL);
+err_defer_reply:
+    disp_table_put_ret (read->data);
+err_data_alloc:
+    free (read);
+err_read_alloc:
+err_read_bsize:
+    return err;
+}
+
 /*************** Our constant structure **************/
 
 const disp_op_t *smio_thsafe_zmq_server_ops [] = {
@@ -446,6 +796,8 @@ const disp_op_t *smio_thsafe_zmq_server_ops [] = {
     &thsafe_zmq_server_write_block_exp,
     &thsafe_zmq_server_read_dma_exp,
     &thsafe_zmq_server_write_dma_exp,
+    &thsafe_zmq_server_batch_exp,
+    &thsafe_zmq_server_read_blockv_exp,
     NULL
 };
 
@@ -9,4 +9,6 @@ sm_io_chips_OBJS =  $(sm_io_chips_DIR)/sm_ch_ad9510.o \
             $(sm_io_chips_DIR)/sm_ch_pca9547.o \
             $(sm_io_chips_DIR)/sm_ch_si57x.o \
             $(sm_io_chips_DIR)/sm_ch_rffe.o \
+            $(sm_io_chips_DIR)/sm_ch_reg_tbl.o \
+            $(sm_io_chips_DIR)/sm_ch_shadow.o \
 			$(sm_io_chips_DIR)/sm_ch_err.o
@@ -45,12 +45,17 @@
 struct _smch_24aa64_t {
     smpr_t *i2c;                    /* I2C protocol object */
     uint32_t addr;                  /* I2C address for this 24AA64 chip */
+    bool cache_valid;               /* Cache holds the whole EEPROM */
+    uint8_t cache[E24AA64_SIZE];    /* EEPROM contents, read at creation */
 };
 
 static ssize_t _smch_24aa64_write_generic (smch_24aa64_t *self, uint16_t addr,
         const uint8_t *data, size_t size);
 static ssize_t _smch_24aa64_read_generic (smch_24aa64_t *self, uint16_t addr,
         uint8_t *data, size_t size);
+static smch_err_e _smch_24aa64_load_cache (smch_24aa64_t *self);
+static bool _smch_24aa64_cached (smch_24aa64_t *self, uint16_t addr,
+        size_t size);
 
 /* Creates a new instance of the SMCH 24AA64 */
 smch_24aa64_t * smch_24aa64_new (smio_t *parent, uint64_t base, uint32_t addr,
@@ -71,6 +76,14 @@ smch_24aa64_t * smch_24aa64_new (smio_t *parent, uint64_t base, uint32_t addr,
 
     self->addr = addr;
 
+    /* Read the whole EEPROM once, so the reads afterwards do not touch the
+     * bus. Without it, we just go to the chip every time */
+    smch_err_e err = _smch_24aa64_load_cache (self);
+    if (err != SMCH_SUCCESS) {
+        DBE_DEBUG (DBG_SM_CH | DBG_LVL_WARN, "[sm_ch:24aa64] Could not read "
+                "EEPROM contents. Reads will not be cached\n");
+    }
+
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO, "[sm_ch:24aa64] Created instance of SMCH\n");
     return self;
 
@@ -109,6 +122,11 @@ smch_err_e smch_24aa64_write_8 (smch_24aa64_t *self, uint16_t addr,
 smch_err_e smch_24aa64_read_8 (smch_24aa64_t *self, uint16_t addr,
         uint8_t *data)
 {
+    if (_smch_24aa64_cached (self, addr, sizeof(*data))) {
+        *data = self->cache[addr];
+        return SMCH_SUCCESS;
+    }
+
     return (_smch_24aa64_read_generic (self, addr, data, sizeof(*data)) ==
             sizeof(*data))? SMCH_SUCCESS : SMCH_ERR_RW_SMPR;
 }
@@ -124,6 +142,11 @@ smch_err_e smch_24aa64_write_block (smch_24aa64_t *self, uint16_t addr,
 smch_err_e smch_24aa64_read_block (smch_24aa64_t *self, uint16_t addr,
         uint32_t *data, size_t size)
 {
+    if (_smch_24aa64_cached (self, addr, size)) {
+        memcpy (data, self->cache + addr, size);
+        return SMCH_SUCCESS;
+    }
+
     ssize_t ret = _smch_24aa64_read_generic (self, addr, (uint8_t *) data, size);
     return (ret >= 0 && (size_t) ret == size)? SMCH_SUCCESS : SMCH_ERR_RW_SMPR;
 }
@@ -173,6 +196,11 @@ static ssize_t _smch_24aa64_write_generic (smch_24aa64_t *self, uint16_t addr,
     /* Return just the number of data bytes written */
     err = smpr_err - E24AA64_ADDR_TRANS_SIZE/SMPR_BYTE_2_BIT;
 
+    /* Keep the cache in sync with the chip */
+    if (_smch_24aa64_cached (self, addr, size)) {
+        memcpy (self->cache + addr, data, size);
+    }
+
     /* 24AA64 takes up to 2 ms to write the page */
     SMCH_24AA64_WAIT_DFLT;
 
@@ -219,16 +247,45 @@ static ssize_t _smch_24aa64_read_generic (smch_24aa64_t *self, uint16_t addr,
     ASSERT_TEST(smpr_err == trans_size/SMPR_BYTE_2_BIT /* in bytes */,
             "Could not READ from SMPR", err_smpr_read, -1);
 
+    /* Reads do not start a write cycle, so there is nothing to wait for */
     err = smpr_err;
 
-    /* 24AA64 takes up to 2 ms to write the page */
-    SMCH_24AA64_WAIT_DFLT;
-
 err_smpr_read:
 err_smpr_write:
     return err;
 }
 
+static smch_err_e _smch_24aa64_load_cache (smch_24aa64_t *self)
+{
+    smch_err_e err = SMCH_SUCCESS;
+    self->cache_valid = false;
+
+    /* Sequential reads go through the whole array, but a single I2C
+     * transaction is limited in size, so read it a page at a time */
+    uint32_t addr;
+    for (addr = 0; addr < E24AA64_SIZE; addr += E24AA64_PAGE_DATA_BYTES_MAX) {
+        ssize_t ret = _smch_24aa64_read_generic (self, addr, self->cache + addr,
+                E24AA64_PAGE_DATA_BYTES_MAX);
+        ASSERT_TEST(ret == E24AA64_PAGE_DATA_BYTES_MAX, "Could not read EEPROM "
+                "contents", err_exit, SMCH_ERR_RW_SMPR);
+    }
+
+    self->cache_valid = true;
+    DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO, "[sm_ch:24aa64] Cached %u bytes "
+            "of EEPROM contents\n", E24AA64_SIZE);
+
+err_exit:
+    return err;
+}
+
+/* Whether [addr, addr+size) is served from the cache. Accesses past the
+ * end wrap around in the chip, so leave these to it */
+static bool _smch_24aa64_cached (smch_24aa64_t *self, uint16_t addr,
+        size_t size)
+{
+    return self->cache_valid && (size_t) addr + size <= E24AA64_SIZE;
+}
+
 ssize_t smch_24aa64_probe_bus (smch_24aa64_t *self)
 {
     ssize_t err = 0;
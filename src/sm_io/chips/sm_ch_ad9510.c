@@ -45,15 +45,112 @@
 struct _smch_ad9510_t {
     smpr_t *spi;                    /* SPI protocol object */
     uint32_t ss;                    /* Slave select line for this AD9510 chip */
+    smch_shadow_t shadow;           /* Last known register contents */
 };
 
 static ssize_t _smch_ad9510_write_8 (smch_ad9510_t *self, uint8_t addr,
         const uint8_t *data);
 static ssize_t _smch_ad9510_read_8 (smch_ad9510_t *self, uint8_t addr,
         uint8_t *data);
+static bool _smch_ad9510_reg_is_volatile (uint8_t addr);
 static smch_err_e _smch_ad9510_init (smch_ad9510_t *self);
 static bool _smch_ad9510_wait_completion (smch_ad9510_t *self, unsigned int tries);
 static smch_err_e _smch_ad9510_reg_update (smch_ad9510_t *self);
+static ssize_t _smch_ad9510_write_burst (void *chip, uint16_t addr,
+        const uint8_t *data, size_t size);
+static ssize_t _smch_ad9510_read_reg (void *chip, uint16_t addr, uint8_t *data);
+static smch_err_e _smch_ad9510_write_tbl (smch_ad9510_t *self,
+        const smch_reg_t *regs, size_t num_regs);
+
+/* Streaming writes are limited by the 128-bit SPI transfer size: 16-bit
+ * instruction plus data */
+#define SMCH_AD9510_BURST_MAX               \
+    ((SPI_PROTO_REG_RXTX_NUM*SMPR_WB_REG_2_BIT - AD9510_TRASNS_SIZE + AD9510_DATA_SIZE) / \
+     AD9510_DATA_SIZE)
+
+static const smch_reg_tbl_ops_t _smch_ad9510_reg_tbl_ops = {
+    .write = _smch_ad9510_write_burst,
+    .read = _smch_ad9510_read_reg,
+    .burst_max = SMCH_AD9510_BURST_MAX
+};
+
+/* PLL defaults. Sorted by address, so contiguous registers are written
+ * together */
+static const smch_reg_t _smch_ad9510_pll_dflt [] = {
+    /* Setup A and B PLL divider */
+    {AD9510_REG_PLL_A_COUNTER,      AD9510_PLL_A_COUNTER_W(0),                  SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_PLL_B_MSB_COUNTER,  AD9510_PLL_B_MSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_B_COUNTER >>
+                                        AD9510_PLL_B_LSB_COUNTER_SIZE),         SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_PLL_B_LSB_COUNTER,  AD9510_PLL_B_LSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_B_COUNTER),
+                                                                                SMCH_REG_TBL_MASK_ALL},
+    /* Setup MUX status pin: CP normal operation, Digital Lock Detect,
+     * PFD positive polarity */
+    {AD9510_REG_PLL_2,              AD9510_PLL_2_CP_MODE_W(0x03) |
+                                        AD9510_PLL_2_MUX_SEL_W(0x01) |
+                                        AD9510_PLL_2_PFD_POL_POS,               SMCH_REG_TBL_MASK_ALL},
+    /* Setup Prescaler (divide by 1) and Power PLL Up */
+    {AD9510_REG_PLL_4,              AD9510_PLL_4_PRESCALER_P_W(0) |
+                                        AD9510_PLL_4_PLL_PDOWN_W(0x0),          SMCH_REG_TBL_MASK_ALL},
+    /* Setup R divider */
+    {AD9510_REG_PLL_R_MSB_COUNTER,  AD9510_PLL_R_MSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_R_COUNTER >>
+                                        AD9510_PLL_R_LSB_COUNTER_SIZE),         SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_PLL_R_LSB_COUNTER,  AD9510_PLL_R_LSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_R_COUNTER),
+                                                                                SMCH_REG_TBL_MASK_ALL},
+    /* Power-up LVPECL outputs 0-3, 810 mV output */
+#define SMCH_AD9510_LVPECL_DFLT     (AD9510_LVPECL_OUT_LVL_W(0x02) | AD9510_LVPECL_OUT_PDOWN_W(0x0))
+    {AD9510_REG_LVPECL_OUT0,        SMCH_AD9510_LVPECL_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_LVPECL_OUT1,        SMCH_AD9510_LVPECL_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_LVPECL_OUT2,        SMCH_AD9510_LVPECL_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_LVPECL_OUT3,        SMCH_AD9510_LVPECL_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+#undef SMCH_AD9510_LVPECL_DFLT
+    /* Power-up LVCMOS/LVDS output 4 (DEBUG), 3.5 mA, 100 Ohm */
+    {AD9510_REG_LVDS_CMOS_OUT4,     AD9510_LVDS_CMOS_CURR_W(0x1) &
+                                        ~AD9510_LVDS_CMOS_PDOWN,                SMCH_REG_TBL_MASK_ALL},
+    /* Power-down LVCMOS/LVDS outputs 5-7 */
+#define SMCH_AD9510_LVDS_PDOWN      (AD9510_LVDS_CMOS_CURR_W(0x1) | AD9510_LVDS_CMOS_PDOWN)
+    {AD9510_REG_LVDS_CMOS_OUT5,     SMCH_AD9510_LVDS_PDOWN,                     SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_LVDS_CMOS_OUT6,     SMCH_AD9510_LVDS_PDOWN,                     SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_LVDS_CMOS_OUT7,     SMCH_AD9510_LVDS_PDOWN,                     SMCH_REG_TBL_MASK_ALL},
+#undef SMCH_AD9510_LVDS_PDOWN
+    /* Set-up clock selection (distribution mode)
+     * CLK1 - power off
+     * CLK2 - power on
+     * Clock select = CLK2
+     * Prescaler Clock -  Power-Up
+     * REFIN - Power-Up
+     */
+    {AD9510_REG_CLK_OPT,            AD9510_CLK_OPT_CLK1_PD & (
+                                        ~AD9510_CLK_OPT_REFIN_PD &
+                                        ~AD9510_CLK_OPT_PS_PD &
+                                        ~AD9510_CLK_OPT_SEL_CLK1),              SMCH_REG_TBL_MASK_ALL},
+};
+
+/* Clock dividers OUT0 - OUT7: bypassed (ratio 1), duty cycle 50%, lo-hi
+ * 0x00, phase offset 0, start high. Function pin is SYNCB */
+#define SMCH_AD9510_DCYCLE_DFLT     (AD9510_DIV_DCYCLE_LOW_W(0x0) | AD9510_DIV_DCYCLE_HIGH_W(0x0))
+#define SMCH_AD9510_DIV_OPT_DFLT    (AD9510_DIV_BYPASS | AD9510_DIV_START_HIGH | \
+                                        AD9510_DIV_OPT_PHASE_W(0x0))
+static const smch_reg_t _smch_ad9510_div_dflt [] = {
+    {AD9510_REG_DIV0_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV0_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV1_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV1_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV2_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV2_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV3_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV3_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV4_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV4_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV5_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV5_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV6_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV6_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV7_DCYCLE,        SMCH_AD9510_DCYCLE_DFLT,                    SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_DIV7_OPT,           SMCH_AD9510_DIV_OPT_DFLT,                   SMCH_REG_TBL_MASK_ALL},
+    {AD9510_REG_FUNCTION,           AD9510_FUNCTION_FUNC_SEL_W(0x1),            SMCH_REG_TBL_MASK_ALL},
+};
+#undef SMCH_AD9510_DIV_OPT_DFLT
+#undef SMCH_AD9510_DCYCLE_DFLT
 
 /* Creates a new instance of the SMCH AD9510 */
 smch_ad9510_t * smch_ad9510_new (smio_t *parent, uint64_t base, uint32_t ss,
@@ -154,6 +251,13 @@ smch_err_e smch_ad9510_reg_update (smch_ad9510_t *self)
     return _smch_ad9510_reg_update (self);
 }
 
+smch_err_e smch_ad9510_resync (smch_ad9510_t *self)
+{
+    assert (self);
+    smch_shadow_reset (&self->shadow);
+    return SMCH_SUCCESS;
+}
+
 smch_err_e smch_ad9510_cfg_defaults (smch_ad9510_t *self)
 {
     smch_err_e err = SMCH_SUCCESS;
@@ -162,122 +266,26 @@ smch_err_e smch_ad9510_cfg_defaults (smch_ad9510_t *self)
     ASSERT_TEST(err == SMCH_SUCCESS, "Could not initialize AD9510",
             err_smpr_write, SMCH_ERR_RW_SMPR);
 
-    /* Setup A and B PLL divider */
-    uint8_t data = AD9510_PLL_A_COUNTER_W(0);
-    _smch_ad9510_write_8 (self, AD9510_REG_PLL_A_COUNTER, &data);
-
-    /* Extract MSB part of the divider */
-    data = AD9510_PLL_B_MSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_B_COUNTER >>
-            AD9510_PLL_B_LSB_COUNTER_SIZE);
-    _smch_ad9510_write_8 (self, AD9510_REG_PLL_B_MSB_COUNTER, &data);
-
-        /* Extract LSB part of the divider */
-    data = AD9510_PLL_B_LSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_B_COUNTER);
-    _smch_ad9510_write_8 (self, AD9510_REG_PLL_B_LSB_COUNTER, &data);
-
-    /* Setup MUX status pin */
-    data = AD9510_PLL_2_CP_MODE_W(0x03 /* CP normal operation*/) |
-        AD9510_PLL_2_MUX_SEL_W(0x01 /* Digital Lock Detect */) |
-        AD9510_PLL_2_PFD_POL_POS; /* PFD positive polarity */
-    _smch_ad9510_write_8 (self, AD9510_REG_PLL_2, &data);
-
-    /* Setup Prescaler and Power PLL Up*/
-    data = AD9510_PLL_4_PRESCALER_P_W(0 /* Divide by 1 */) |
-        AD9510_PLL_4_PLL_PDOWN_W(0x0);
-    _smch_ad9510_write_8 (self, AD9510_REG_PLL_4, &data);
-
-    /* Setup R divider */
-    data = AD9510_PLL_R_MSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_R_COUNTER >>
-            AD9510_PLL_R_LSB_COUNTER_SIZE);
-    _smch_ad9510_write_8 (self, AD9510_REG_PLL_R_MSB_COUNTER, &data);
-    data = AD9510_PLL_R_LSB_COUNTER_W(SMCH_AD9510_DFLT_PLL_R_COUNTER);
-    _smch_ad9510_write_8 (self, AD9510_REG_PLL_R_LSB_COUNTER, &data);
-
-    /* Power-up LVPECL outputs */
+    /* PLL, output drivers and clock selection */
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO,
-            "[sm_ch:ad9510] Powering up LVPECL outputs 0-3\n");
-    data = AD9510_LVPECL_OUT_LVL_W(0x02) /* 810 mV output */ |
-        AD9510_LVPECL_OUT_PDOWN_W(0x0) /* Do not power down */;
-    _smch_ad9510_write_8 (self, AD9510_REG_LVPECL_OUT0, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_LVPECL_OUT1, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_LVPECL_OUT2, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_LVPECL_OUT3, &data);
-
-    /* Power-up LVCMOS/LVDS output 4 (DEBUG) */
-    DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO,
-            "[sm_ch:ad9510] Powering up LVDS/CMOS output 4\n");
-    data = AD9510_LVDS_CMOS_CURR_W(0x1) /* 3.5 mA, 100 Ohm */ & (
-        ~AD9510_LVDS_CMOS_PDOWN /* Do not power down */);
-    _smch_ad9510_write_8 (self, AD9510_REG_LVDS_CMOS_OUT4, &data);
-
-    /* Power-down LVCMOS/LVDS outputs 5-7*/
-    DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO,
-            "[sm_ch:ad9510] Powering down LVDS/CMOS outputs 5-7\n");
-    data = AD9510_LVDS_CMOS_CURR_W(0x1) /* 3.5 mA, 100 Ohm */ | (
-        AD9510_LVDS_CMOS_PDOWN /* Power down */);
-    _smch_ad9510_write_8 (self, AD9510_REG_LVDS_CMOS_OUT5, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_LVDS_CMOS_OUT6, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_LVDS_CMOS_OUT7, &data);
-
-    /* Set-up clock selection (distribution mode)
-     * CLK1 - power off
-     * CLK2 - power on
-     * Clock select = CLK2
-     * Prescaler Clock -  Power-Up
-     * REFIN - Power-Up
-     */
-    data = AD9510_CLK_OPT_CLK1_PD /* Power CLK1 down */ & (
-                ~AD9510_CLK_OPT_REFIN_PD /* Power Reference In Up*/ &
-                ~AD9510_CLK_OPT_PS_PD /* Power Prescaler Up*/ &
-                ~AD9510_CLK_OPT_SEL_CLK1 /* Select CLK2*/);
-    _smch_ad9510_write_8 (self, AD9510_REG_CLK_OPT, &data);
-
-    /* Update registers */
-    _smch_ad9510_reg_update (self);
+            "[sm_ch:ad9510] Programming PLL and output defaults\n");
+    err = _smch_ad9510_write_tbl (self, _smch_ad9510_pll_dflt,
+            ARRAY_SIZE(_smch_ad9510_pll_dflt));
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not program AD9510 PLL defaults",
+            err_smpr_write);
     SMCH_AD9510_WAIT_DFLT;
 
-    /* Clock dividers OUT0 - OUT7
-     * divide = off (bypassed, ratio 1)
-     * duty cycle 50%
-     * lo-hi 0x00
-     */
-    data = AD9510_DIV_DCYCLE_LOW_W(0x0) | AD9510_DIV_DCYCLE_HIGH_W(0x0);
-
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV0_DCYCLE, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV1_DCYCLE, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV2_DCYCLE, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV3_DCYCLE, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV4_DCYCLE, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV5_DCYCLE, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV6_DCYCLE, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV7_DCYCLE, &data);
-
-    /* Clock dividers OUT0 - OUT7
-     * phase offset = 0
-     * start high
-     * bypass
-     */
-    data = AD9510_DIV_BYPASS | AD9510_DIV_START_HIGH | AD9510_DIV_OPT_PHASE_W(0x0);
-
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV0_OPT, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV1_OPT, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV2_OPT, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV3_OPT, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV4_OPT, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV5_OPT, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV6_OPT, &data);
-    _smch_ad9510_write_8 (self, AD9510_REG_DIV7_OPT, &data);
-
-    /* Function pin is SYNCB */
-    data = AD9510_FUNCTION_FUNC_SEL_W(0x1);
-    _smch_ad9510_write_8 (self, AD9510_REG_FUNCTION, &data);
-
-    /* Update registers */
-    _smch_ad9510_reg_update (self);
+    /* Clock dividers and function pin */
+    DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO,
+            "[sm_ch:ad9510] Programming divider defaults\n");
+    err = _smch_ad9510_write_tbl (self, _smch_ad9510_div_dflt,
+            ARRAY_SIZE(_smch_ad9510_div_dflt));
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not program AD9510 divider defaults",
+            err_smpr_write);
     SMCH_AD9510_WAIT_DFLT;
 
     /* Software sync */
-    data |= AD9510_FUNCTION_SYNC_REG;
+    uint8_t data = AD9510_FUNCTION_FUNC_SEL_W(0x1) | AD9510_FUNCTION_SYNC_REG;
     _smch_ad9510_write_8 (self, AD9510_REG_FUNCTION, &data);
 
     /* Update registers */
@@ -293,6 +301,144 @@ err_smpr_write:
     return err;
 }
 
+/* Append a register write to "prog" */
+static void _smch_ad9510_prog_add (smch_ad9510_prog_t *prog, uint16_t addr,
+        uint8_t value, uint8_t mask)
+{
+    assert (prog->num_regs < SMCH_AD9510_PROG_MAX_REGS);
+    prog->regs [prog->num_regs++] = (smch_reg_t) {addr, value, mask};
+}
+
+smch_err_e smch_ad9510_cfg_compile (const smch_ad9510_cfg_t *cfg,
+        smch_ad9510_prog_t *prog)
+{
+    assert (cfg);
+    assert (prog);
+
+    smch_err_e err = SMCH_SUCCESS;
+    prog->num_regs = 0;
+
+    /* Same checks as the single setting functions */
+    ASSERT_TEST(cfg->pll_a_div == SMCH_AD9510_CFG_KEEP ||
+            cfg->pll_a_div < AD9510_PLL_A_COUNTER_MASK+1,
+            "PLL A divider is out of range", err_inv_cfg,
+            SMCH_ERR_INV_FUNC_PARAM);
+    ASSERT_TEST(cfg->pll_b_div == SMCH_AD9510_CFG_KEEP || cfg->pll_b_div == 0 ||
+            (cfg->pll_b_div > AD9510_PLL_B_MIN_VALUE-1 &&
+             cfg->pll_b_div < AD9510_PLL_B_COUNTER_MASK+1),
+            "PLL B divider is out of range", err_inv_cfg,
+            SMCH_ERR_INV_FUNC_PARAM);
+    ASSERT_TEST(cfg->pll_prescaler == SMCH_AD9510_CFG_KEEP ||
+            cfg->pll_prescaler < (1 << AD9510_PLL_4_PRESCALER_P_SIZE),
+            "PLL prescaler is out of range", err_inv_cfg,
+            SMCH_ERR_INV_FUNC_PARAM);
+    ASSERT_TEST(cfg->r_div == SMCH_AD9510_CFG_KEEP ||
+            cfg->r_div < AD9510_PLL_R_COUNTER_MASK+1,
+            "PLL R divider is out of range", err_inv_cfg,
+            SMCH_ERR_INV_FUNC_PARAM);
+    ASSERT_TEST(cfg->cp_current == SMCH_AD9510_CFG_KEEP ||
+            (cfg->cp_current > AD9510_PLL3_CP_CURRENT_MIN-1 &&
+             cfg->cp_current < AD9510_PLL3_CP_CURRENT_MAX+1 &&
+             cfg->cp_current % AD9510_PLL3_CP_CURRENT_MIN == 0),
+            "PLL Charge Pump current is invalid or out of range", err_inv_cfg,
+            SMCH_ERR_INV_FUNC_PARAM);
+    ASSERT_TEST(cfg->outputs == SMCH_AD9510_CFG_KEEP ||
+            cfg->outputs < AD9510_OUTPUT_EN_MASK+1,
+            "Output enable selection is out of range", err_inv_cfg,
+            SMCH_ERR_INV_FUNC_PARAM);
+    ASSERT_TEST(cfg->pll_clk_sel == SMCH_AD9510_CFG_KEEP ||
+            (cfg->pll_clk_sel > AD9510_PLL_CLK_MIN_SEL-1 &&
+             cfg->pll_clk_sel < AD9510_PLL_CLK_MAX_SEL+1),
+            "Clock number is out of range", err_inv_cfg,
+            SMCH_ERR_INV_FUNC_PARAM);
+
+    if (cfg->pll_a_div != SMCH_AD9510_CFG_KEEP) {
+        _smch_ad9510_prog_add (prog, AD9510_REG_PLL_A_COUNTER,
+                AD9510_PLL_A_COUNTER_W(cfg->pll_a_div), SMCH_REG_TBL_MASK_ALL);
+    }
+
+    if (cfg->pll_b_div != SMCH_AD9510_CFG_KEEP && cfg->pll_b_div != 0) {
+        _smch_ad9510_prog_add (prog, AD9510_REG_PLL_B_MSB_COUNTER,
+                AD9510_PLL_B_MSB_COUNTER_W(cfg->pll_b_div >>
+                    AD9510_PLL_B_LSB_COUNTER_SIZE), SMCH_REG_TBL_MASK_ALL);
+        _smch_ad9510_prog_add (prog, AD9510_REG_PLL_B_LSB_COUNTER,
+                AD9510_PLL_B_LSB_COUNTER_W(cfg->pll_b_div), SMCH_REG_TBL_MASK_ALL);
+    }
+
+    if (cfg->cp_current != SMCH_AD9510_CFG_KEEP) {
+        _smch_ad9510_prog_add (prog, AD9510_REG_PLL_3,
+                AD9510_PLL_3_CP_CURRENT_W(cfg->cp_current/AD9510_PLL3_CP_CURRENT_MIN - 1),
+                AD9510_PLL_3_CP_CURRENT_MASK);
+    }
+
+    /* Prescaler and B bypass share PLL_4 */
+    uint8_t pll_4 = 0;
+    uint8_t pll_4_mask = 0;
+    if (cfg->pll_prescaler != SMCH_AD9510_CFG_KEEP) {
+        pll_4 |= AD9510_PLL_4_PRESCALER_P_W(cfg->pll_prescaler);
+        pll_4_mask |= AD9510_PLL_4_PRESCALER_P_MASK;
+    }
+    if (cfg->pll_b_div != SMCH_AD9510_CFG_KEEP) {
+        pll_4 |= (cfg->pll_b_div == 0) ? AD9510_PLL_4_B_BYPASS : 0;
+        pll_4_mask |= AD9510_PLL_4_B_BYPASS;
+    }
+    if (pll_4_mask != 0) {
+        _smch_ad9510_prog_add (prog, AD9510_REG_PLL_4, pll_4, pll_4_mask);
+    }
+
+    if (cfg->r_div != SMCH_AD9510_CFG_KEEP) {
+        _smch_ad9510_prog_add (prog, AD9510_REG_PLL_R_MSB_COUNTER,
+                AD9510_PLL_R_MSB_COUNTER_W(cfg->r_div >> AD9510_PLL_R_LSB_COUNTER_SIZE),
+                SMCH_REG_TBL_MASK_ALL);
+        _smch_ad9510_prog_add (prog, AD9510_REG_PLL_R_LSB_COUNTER,
+                AD9510_PLL_R_LSB_COUNTER_W(cfg->r_div), SMCH_REG_TBL_MASK_ALL);
+    }
+
+    if (cfg->outputs != SMCH_AD9510_CFG_KEEP) {
+        uint32_t out_en = AD9510_OUTPUT_EN_R(cfg->outputs);
+        uint32_t i;
+        /* LVPECL outputs. Disabled ones are in safe power down */
+        for (i = 0; i < AD9510_NUM_LVPECL_OUTPUTS; ++i, out_en >>=
+                AD9510_OUTPUT_EN_LSB_SIZE) {
+            _smch_ad9510_prog_add (prog, AD9510_REG_OUTPUT_START+i,
+                    AD9510_LVPECL_OUT_PDOWN_W((out_en & AD9510_OUTPUT_EN_LSB_MASK) ?
+                        0x00 : 0x02), AD9510_LVPECL_OUT_PDOWN_MASK);
+        }
+        /* LVDS/CMOS Outputs */
+        for ( ; i < AD9510_NUM_OUTPUTS; ++i, out_en >>=
+                AD9510_OUTPUT_EN_LSB_SIZE) {
+            _smch_ad9510_prog_add (prog, AD9510_REG_OUTPUT_START+i,
+                    (out_en & AD9510_OUTPUT_EN_LSB_MASK) ? 0 : AD9510_LVDS_CMOS_PDOWN,
+                    AD9510_LVDS_CMOS_PDOWN);
+        }
+    }
+
+    if (cfg->pll_clk_sel != SMCH_AD9510_CFG_KEEP) {
+        _smch_ad9510_prog_add (prog, AD9510_REG_CLK_OPT,
+                (cfg->pll_clk_sel == AD9510_PLL_CLK1_SEL) ? AD9510_CLK_OPT_SEL_CLK1 : 0,
+                AD9510_CLK_OPT_SEL_CLK1);
+    }
+
+err_inv_cfg:
+    return err;
+}
+
+smch_err_e smch_ad9510_cfg_apply (smch_ad9510_t *self,
+        const smch_ad9510_prog_t *prog)
+{
+    assert (self);
+    assert (prog);
+
+    smch_err_e err = _smch_ad9510_write_tbl (self, prog->regs, prog->num_regs);
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not apply AD9510 settings",
+            err_write_tbl);
+    /* Wait for reset to complete */
+    SMCH_AD9510_WAIT_DFLT;
+
+err_write_tbl:
+    return err;
+}
+
 smch_err_e smch_ad9510_set_pll_a_div (smch_ad9510_t *self, uint32_t *div)
 {
     smch_err_e err = SMCH_SUCCESS;
@@ -739,6 +885,9 @@ static smch_err_e _smch_ad9510_init (smch_ad9510_t *self)
      * ammount of time to be sure the chip is indeed reset */
     SMCH_AD9510_WAIT_DFLT;
 
+    /* All of the registers are back to their reset values */
+    smch_shadow_reset (&self->shadow);
+
     /* Clear reset */
     data &= ~AD9510_CFG_SERIAL_SOFT_RST;
     rw_err = _smch_ad9510_write_8 (self, AD9510_REG_CFG_SERIAL, &data);
@@ -781,6 +930,10 @@ static ssize_t _smch_ad9510_write_8 (smch_ad9510_t *self, uint8_t addr,
     ASSERT_TEST(smpr_err == sizeof(uint32_t), "Could not write to SMPR",
             err_smpr_write, -1);
 
+    if (!_smch_ad9510_reg_is_volatile (addr)) {
+        smch_shadow_set (&self->shadow, addr, *data);
+    }
+
 err_smpr_write:
     return err;
 }
@@ -790,6 +943,12 @@ static ssize_t _smch_ad9510_read_8 (smch_ad9510_t *self, uint8_t addr,
 {
     ssize_t err = sizeof(uint8_t);
 
+    /* We know what is in there, as we wrote it ourselves */
+    if (!_smch_ad9510_reg_is_volatile (addr) &&
+            smch_shadow_get (&self->shadow, addr, data)) {
+        return err;
+    }
+
     /* We do only 24-bit cycles composed of:
      *
      * 16-bit instruction bits + 8-bit data bits
@@ -811,10 +970,23 @@ static ssize_t _smch_ad9510_read_8 (smch_ad9510_t *self, uint8_t addr,
     /* Only the 8 LSB are valid for one byte reading (AD9510_HDR_BT_W(0x0)) */
     memcpy(data, &__data, sizeof(uint8_t));
 
+    if (!_smch_ad9510_reg_is_volatile (addr)) {
+        smch_shadow_set (&self->shadow, addr, *data);
+    }
+
 err_smpr_write:
     return err;
 }
 
+/* Registers that change by themselves and must always be read from the
+ * chip */
+static bool _smch_ad9510_reg_is_volatile (uint8_t addr)
+{
+    /* CFG_SERIAL has the self clearing soft reset bit, UPDATE_REGS clears
+     * itself once the update is done */
+    return addr == AD9510_REG_CFG_SERIAL || addr == AD9510_REG_UPDATE_REGS;
+}
+
 static bool _smch_ad9510_wait_completion (smch_ad9510_t *self, unsigned int tries)
 {
     assert (self);
@@ -848,6 +1020,82 @@ err_read_8:
     return finished;
 }
 
+/* Write "size" contiguous registers in a single transfer. The chip is in
+ * MSB first mode, so the instruction carries the highest address and the
+ * data goes from it downwards. Registers written this way are buffered
+ * until the next register update */
+static ssize_t _smch_ad9510_write_burst (void *chip, uint16_t addr,
+        const uint8_t *data, size_t size)
+{
+    assert (chip);
+    assert (data);
+
+    smch_ad9510_t *self = (smch_ad9510_t *) chip;
+    ssize_t err = size;
+
+    ASSERT_TEST(size > 0 && size <= SMCH_AD9510_BURST_MAX,
+            "Invalid burst size", err_inv_size, -1);
+
+    /* Up to 3 bytes are described by the instruction, more than that
+     * requires streaming mode */
+    uint32_t top = addr + size - 1;
+    uint32_t hdr = ~AD9510_HDR_RW & (
+                AD9510_HDR_BT_W((size < 4) ? size - 1 : 0x3) |
+                AD9510_HDR_ADDR_W(top)
+            );
+
+    /* Byte stream, in transmission order: 2 instruction bytes, then data */
+    uint32_t charlen = AD9510_TRASNS_SIZE + (size - 1)*AD9510_DATA_SIZE;
+    uint32_t __data[SPI_PROTO_REG_RXTX_NUM] = {0};
+    uint32_t i;
+    for (i = 0; i < size + 2; ++i) {
+        uint32_t byte = (i < 2) ?
+            (hdr >> (AD9510_TRASNS_SIZE - (i+1)*SMPR_BYTE_2_BIT)) & 0xFF :
+            data [top - addr - (i - 2)];
+        /* The SPI core shifts out the TX registers from bit charlen-1 */
+        uint32_t bit = charlen - (i+1)*SMPR_BYTE_2_BIT;
+        __data [bit / SMPR_WB_REG_2_BIT] |= byte << (bit % SMPR_WB_REG_2_BIT);
+    }
+
+    uint32_t flags = SMPR_PROTO_SPI_SS_FLAGS_W(self->ss) |
+            SMPR_PROTO_SPI_CHARLEN_FLAGS_W(charlen);
+    size_t num_words = (charlen + SMPR_WB_REG_2_BIT - 1) / SMPR_WB_REG_2_BIT;
+    ssize_t smpr_err = smpr_write_block (self->spi, 0,
+            num_words*SMPR_WB_REG_2_BYTE, __data, flags);
+    ASSERT_TEST(smpr_err >= 0 && (size_t) smpr_err == num_words*SMPR_WB_REG_2_BYTE,
+            "Could not write to SMPR", err_smpr_write, -1);
+
+    for (i = 0; i < size; ++i) {
+        if (!_smch_ad9510_reg_is_volatile (addr + i)) {
+            smch_shadow_set (&self->shadow, addr + i, data [i]);
+        }
+    }
+
+err_smpr_write:
+err_inv_size:
+    return err;
+}
+
+static ssize_t _smch_ad9510_read_reg (void *chip, uint16_t addr, uint8_t *data)
+{
+    return _smch_ad9510_read_8 ((smch_ad9510_t *) chip, addr, data);
+}
+
+/* Program a register table and make it effective */
+static smch_err_e _smch_ad9510_write_tbl (smch_ad9510_t *self,
+        const smch_reg_t *regs, size_t num_regs)
+{
+    smch_err_e err = smch_reg_tbl_write (self, &_smch_ad9510_reg_tbl_ops,
+            regs, num_regs);
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not write register table",
+            err_write_tbl);
+
+    err = _smch_ad9510_reg_update (self);
+
+err_write_tbl:
+    return err;
+}
+
 static smch_err_e _smch_ad9510_reg_update (smch_ad9510_t *self)
 {
     smch_err_e err = SMCH_SUCCESS;
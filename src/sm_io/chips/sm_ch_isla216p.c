@@ -30,15 +30,16 @@
     CHECK_HAL_ERR(err, SM_CH, "[sm_ch:isla216p]",                       \
             smch_err_str (err_type))
 
-#define SMCH_ISLA216P_WAIT_TRIES            10
 #define SMCH_ISLA216P_NAME                  "SPI_ISLA216P"
-#define SMCH_ISLA216P_USECS_WAIT            1000
+/* Interval between reads of a status register, while waiting on it */
+#define SMCH_ISLA216P_USECS_POLL            100
 #define SMCH_ISLA216P_WAIT(usecs)           usleep(usecs)
-#define SMCH_ISLA216P_WAIT_DFLT             SMCH_ISLA216P_WAIT(SMCH_ISLA216P_USECS_WAIT)
+#define SMCH_ISLA216P_WAIT_POLL             SMCH_ISLA216P_WAIT(SMCH_ISLA216P_USECS_POLL)
 
 struct _smch_isla216p_t {
     smpr_t *spi;                    /* SPI protocol object */
     uint32_t ss;                    /* Slave select line for this ISLA216P chip */
+    smch_shadow_t shadow;           /* Last known register contents */
 };
 
 static smch_err_e _smch_isla216p_init (smch_isla216p_t *self);
@@ -47,6 +48,7 @@ static ssize_t _smch_isla216p_write_8 (smch_isla216p_t *self, uint8_t addr,
         const uint8_t *data);
 static ssize_t _smch_isla216p_read_8 (smch_isla216p_t *self, uint8_t addr,
         uint8_t *data);
+static bool _smch_isla216p_reg_is_volatile (uint8_t addr);
 
 /* Creates a new instance of the SMCH ISLA216P */
 smch_isla216p_t * smch_isla216p_new (smio_t *parent, uint64_t base, uint32_t ss,
@@ -114,6 +116,13 @@ smch_err_e smch_isla216p_read_8 (smch_isla216p_t *self, uint8_t addr,
         SMCH_SUCCESS : SMCH_ERR_RW_SMPR;
 }
 
+smch_err_e smch_isla216p_resync (smch_isla216p_t *self)
+{
+    assert (self);
+    smch_shadow_reset (&self->shadow);
+    return SMCH_SUCCESS;
+}
+
 smch_err_e smch_isla216p_set_test_mode (smch_isla216p_t *self, uint8_t mode)
 {
     smch_err_e err = SMCH_SUCCESS;
@@ -129,8 +138,6 @@ smch_err_e smch_isla216p_set_test_mode (smch_isla216p_t *self, uint8_t mode)
     ASSERT_TEST(rw_err == sizeof(uint8_t), "Could not write to TESTIO register",
             err_smpr_write, SMCH_ERR_RW_SMPR);
 
-    SMCH_ISLA216P_WAIT_DFLT;
-
 err_smpr_write:
 err_smpr_read:
     return err;
@@ -145,8 +152,6 @@ smch_err_e smch_isla216p_get_chipid (smch_isla216p_t *self, uint8_t *chipid)
     ASSERT_TEST(rw_err == sizeof(uint8_t), "Could not read from CHIPID register",
             err_smpr_read, SMCH_ERR_RW_SMPR);
 
-    SMCH_ISLA216P_WAIT_DFLT;
-
 err_smpr_read:
     return err;
 }
@@ -160,8 +165,34 @@ smch_err_e smch_isla216p_get_chipver (smch_isla216p_t *self, uint8_t *chipver)
     ASSERT_TEST(rw_err == sizeof(uint8_t), "Could not read from CHIPVER register",
             err_smpr_read, SMCH_ERR_RW_SMPR);
 
-    SMCH_ISLA216P_WAIT_DFLT;
+err_smpr_read:
+    return err;
+}
+
+smch_err_e smch_isla216p_wait_cal (smch_isla216p_t *self, int64_t deadline)
+{
+    assert (self);
+    smch_err_e err = SMCH_SUCCESS;
+    ssize_t rw_err = -1;
+    uint8_t data = 0;
+
+    /* Calibration only runs once the chip has a stable clock, so this is
+     * also what tells us the ADC is up */
+    while (1) {
+        rw_err = _smch_isla216p_read_8 (self, ISLA216P_REG_CALSTATUS, &data);
+        ASSERT_TEST(rw_err == sizeof(uint8_t), "Could not read from CALSTATUS register",
+                err_smpr_read, SMCH_ERR_RW_SMPR);
 
+        if (data & ISLA216P_CALCSTATUS_CALCDONE) {
+            break;
+        }
+
+        ASSERT_TEST(zclock_mono () < deadline, "Timeout waiting for calibration",
+                err_timeout, SMCH_ERR_TIMEOUT);
+        SMCH_ISLA216P_WAIT_POLL;
+    }
+
+err_timeout:
 err_smpr_read:
     return err;
 }
@@ -181,8 +212,6 @@ static smch_err_e _smch_isla216p_init (smch_isla216p_t *self)
     ASSERT_TEST(rw_err == sizeof(uint8_t), "Could not write to ISLA216P_REG_PORTCONFIG",
             err_smpr_write, SMCH_ERR_RW_SMPR);
 
-    SMCH_ISLA216P_WAIT_DFLT;
-
 #if 0
     /* Reset registers */
     data |= ISLA216P_PORTCONFIG_SOFT_RESET;
@@ -204,8 +233,6 @@ static smch_err_e _smch_isla216p_init (smch_isla216p_t *self)
     ASSERT_TEST(rw_err == sizeof(uint8_t), "Could not write to ISLA216P_REG_NAPSLP",
             err_smpr_write, SMCH_ERR_RW_SMPR);
 
-    SMCH_ISLA216P_WAIT_DFLT;
-
 err_smpr_write:
     return err;
 }
@@ -235,6 +262,14 @@ static ssize_t _smch_isla216p_write_8 (smch_isla216p_t *self, uint8_t addr,
     ASSERT_TEST(smpr_err == sizeof(uint32_t), "Could not write to SMPR",
             err_smpr_write, -1);
 
+    if (addr == ISLA216P_REG_PORTCONFIG && (*data & ISLA216P_PORTCONFIG_SOFT_RESET)) {
+        /* All of the registers are back to their reset values */
+        smch_shadow_reset (&self->shadow);
+    }
+    else if (!_smch_isla216p_reg_is_volatile (addr)) {
+        smch_shadow_set (&self->shadow, addr, *data);
+    }
+
 err_smpr_write:
     return err;
 }
@@ -244,6 +279,12 @@ static ssize_t _smch_isla216p_read_8 (smch_isla216p_t *self, uint8_t addr,
 {
     ssize_t err = sizeof(uint8_t);
 
+    /* We know what is in there, as we wrote it ourselves */
+    if (!_smch_isla216p_reg_is_volatile (addr) &&
+            smch_shadow_get (&self->shadow, addr, data)) {
+        return err;
+    }
+
     /* We do Instruction + Data transactions composed of:
      *
      * 16-bit instruction bits + 8-bit data bits (up to 4 beats)
@@ -265,6 +306,18 @@ static ssize_t _smch_isla216p_read_8 (smch_isla216p_t *self, uint8_t addr,
     /* Only the 8 LSB are valid for one byte reading (ISLA216P_HDR_BT_W(0x0)) */
     memcpy(data, &__data, sizeof(uint8_t));
 
+    if (!_smch_isla216p_reg_is_volatile (addr)) {
+        smch_shadow_set (&self->shadow, addr, *data);
+    }
+
 err_smpr_write:
     return err;
 }
+
+/* Registers that change by themselves and must always be read from the
+ * chip */
+static bool _smch_isla216p_reg_is_volatile (uint8_t addr)
+{
+    /* PORTCONFIG has the self clearing soft reset bit */
+    return addr == ISLA216P_REG_PORTCONFIG || addr == ISLA216P_REG_CALSTATUS;
+}
@@ -37,6 +37,8 @@
 struct _smch_pca9547_t {
     smpr_t *i2c;                    /* I2C protocol object */
     uint32_t addr;                  /* I2C address for this PCA9547 chip */
+    bool ctrl_valid;                /* Whether ctrl matches the chip */
+    uint8_t ctrl;                   /* Last control byte written or read */
 };
 
 static smch_err_e _smch_pca9547_write_8 (smch_pca9547_t *self, const uint8_t *data);
@@ -116,10 +118,16 @@ static smch_err_e _smch_pca9547_write_8 (smch_pca9547_t *self, const uint8_t *da
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_TRACE, "[sm_ch:pca9547_write_8] data =  0x%02X\n",
             *data);
 
+    /* We do not know what the chip got if the write fails */
+    self->ctrl_valid = false;
+
     ssize_t smpr_err = smpr_write_32 (self->i2c, 0, (uint32_t *) data, flags);
     ASSERT_TEST(smpr_err == PCA9547_DATA_TRANS_SIZE/SMPR_BYTE_2_BIT /* in bytes*/,
             "Could not write data to I2C", err_exit, SMCH_ERR_RW_SMPR);
 
+    self->ctrl = *data;
+    self->ctrl_valid = true;
+
 err_exit:
     return err;
 }
@@ -141,6 +149,9 @@ static smch_err_e _smch_pca9547_read_8 (smch_pca9547_t *self, uint8_t *data)
     ASSERT_TEST(smpr_err == PCA9547_DATA_TRANS_SIZE/SMPR_BYTE_2_BIT /* in bytes*/,
             "Could not read data to I2C", err_exit, SMCH_ERR_RW_SMPR);
 
+    self->ctrl = *data;
+    self->ctrl_valid = true;
+
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_TRACE, "[sm_ch:pca9547_read_8] data =  0x%02X\n",
             *data);
 
@@ -165,6 +176,14 @@ smch_err_e smch_pca9547_en_chan (smch_pca9547_t *self, uint8_t chan)
         data = PCA9547_CHANNEL_SEL_EN | chan;
     }
 
+    /* The channel is kept until changed, so avoid a bus transaction if it
+     * is selected already */
+    if (self->ctrl_valid && self->ctrl == data) {
+        DBE_DEBUG (DBG_SM_CH | DBG_LVL_TRACE, "[sm_ch:pca9547] Channel "
+                "already selected\n");
+        goto err_exit;
+    }
+
     err =  _smch_pca9547_write_8 (self, &data);
     ASSERT_TEST(err == SMCH_SUCCESS, "Could not enable channel", err_exit);
 
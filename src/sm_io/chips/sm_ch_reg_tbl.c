@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_CH, "[sm_ch:reg_tbl]",         \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)       \
+    ASSERT_HAL_ALLOC(ptr, SM_CH, "[sm_ch:reg_tbl]",                 \
+            smch_err_str(SMCH_ERR_ALLOC),                           \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                    \
+    CHECK_HAL_ERR(err, SM_CH, "[sm_ch:reg_tbl]",                    \
+            smch_err_str (err_type))
+
+static smch_err_e _smch_reg_tbl_flush (void *chip, const smch_reg_tbl_ops_t *ops,
+        uint16_t addr, const uint8_t *data, size_t *size);
+
+smch_err_e smch_reg_tbl_write (void *chip, const smch_reg_tbl_ops_t *ops,
+        const smch_reg_t *regs, size_t num_regs)
+{
+    assert (chip);
+    assert (ops);
+    assert (ops->write);
+    assert (regs);
+    assert (ops->burst_max > 0 && ops->burst_max <= SMCH_REG_TBL_BURST_MAX);
+
+    smch_err_e err = SMCH_SUCCESS;
+    uint8_t burst [SMCH_REG_TBL_BURST_MAX];
+    uint16_t burst_addr = 0;
+    size_t burst_size = 0;
+
+    size_t i;
+    for (i = 0; i < num_regs; ++i) {
+        const smch_reg_t *reg = &regs [i];
+
+        /* Start a new burst if this one can't be extended */
+        if (burst_size > 0 && (reg->addr != burst_addr + burst_size ||
+                    burst_size == ops->burst_max)) {
+            err = _smch_reg_tbl_flush (chip, ops, burst_addr, burst, &burst_size);
+            ASSERT_TEST(err == SMCH_SUCCESS, "Could not write register burst",
+                    err_write);
+        }
+
+        uint8_t value = reg->value;
+        if (reg->mask != SMCH_REG_TBL_MASK_ALL) {
+            ASSERT_TEST(ops->read != NULL, "Masked register, but no read function",
+                    err_inv_param, SMCH_ERR_INV_FUNC_PARAM);
+
+            /* The previous registers of this burst are not written yet, but
+             * this one is not among them */
+            uint8_t cur = 0;
+            ASSERT_TEST(ops->read (chip, reg->addr, &cur) == 1,
+                    "Could not read register", err_read, SMCH_ERR_RW_SMPR);
+            value = (cur & ~reg->mask) | (reg->value & reg->mask);
+        }
+
+        if (burst_size == 0) {
+            burst_addr = reg->addr;
+        }
+        burst [burst_size++] = value;
+    }
+
+    if (burst_size > 0) {
+        err = _smch_reg_tbl_flush (chip, ops, burst_addr, burst, &burst_size);
+        ASSERT_TEST(err == SMCH_SUCCESS, "Could not write register burst",
+                err_write);
+    }
+
+err_read:
+err_inv_param:
+err_write:
+    return err;
+}
+
+/***************** Static functions *****************/
+
+static smch_err_e _smch_reg_tbl_flush (void *chip, const smch_reg_tbl_ops_t *ops,
+        uint16_t addr, const uint8_t *data, size_t *size)
+{
+    DBE_DEBUG (DBG_SM_CH | DBG_LVL_TRACE, "[sm_ch:reg_tbl] Writing %zu "
+            "registers at 0x%04X\n", *size, addr);
+
+    ssize_t ret = ops->write (chip, addr, data, *size);
+    smch_err_e err = (ret >= 0 && (size_t) ret == *size) ?
+        SMCH_SUCCESS : SMCH_ERR_RW_SMPR;
+    *size = 0;
+
+    return err;
+}
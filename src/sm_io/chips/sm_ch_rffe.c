@@ -121,3 +121,61 @@ err_smpr_read_var:
     return err;
 }
 
+smch_err_e smch_rffe_read_vars (smch_rffe_t *self, const uint32_t *ids,
+        uint8_t **data, size_t size, size_t num_ids)
+{
+    assert (self);
+    assert (ids);
+    assert (data);
+
+    smch_err_e err = SMCH_SUCCESS;
+
+    smpr_err_e smpr_err = smpr_bsmp_read_vars_by_id (self->bsmp, ids, data,
+            size, num_ids);
+    ASSERT_TEST(smpr_err == SMPR_SUCCESS, "Could not read variables to SMPR",
+            err_smpr_read_vars, SMCH_ERR_RW_SMPR);
+
+err_smpr_read_vars:
+    return err;
+}
+
+smch_err_e smch_rffe_create_group (smch_rffe_t *self, const uint32_t *ids,
+        size_t num_ids, uint32_t *group_id)
+{
+    assert (self);
+    assert (ids);
+    assert (group_id);
+
+    smch_err_e err = SMCH_SUCCESS;
+
+    /* Groups outlive us in the server, so get rid of the ones left by
+     * previous instances before they run out */
+    smpr_err_e smpr_err = smpr_bsmp_remove_groups (self->bsmp);
+    ASSERT_TEST(smpr_err == SMPR_SUCCESS, "Could not remove SMPR groups",
+            err_smpr_remove_groups, SMCH_ERR_RW_SMPR);
+
+    smpr_err = smpr_bsmp_create_group (self->bsmp, ids, num_ids, group_id);
+    ASSERT_TEST(smpr_err == SMPR_SUCCESS, "Could not create SMPR group",
+            err_smpr_create_group, SMCH_ERR_RW_SMPR);
+
+err_smpr_create_group:
+err_smpr_remove_groups:
+    return err;
+}
+
+smch_err_e smch_rffe_read_group (smch_rffe_t *self, uint32_t group_id,
+        uint8_t **data, size_t size, size_t num_vars)
+{
+    assert (self);
+    assert (data);
+
+    smch_err_e err = SMCH_SUCCESS;
+
+    smpr_err_e smpr_err = smpr_bsmp_read_group_by_id (self->bsmp, group_id,
+            data, size, num_vars);
+    ASSERT_TEST(smpr_err == SMPR_SUCCESS, "Could not read group to SMPR",
+            err_smpr_read_group, SMCH_ERR_RW_SMPR);
+
+err_smpr_read_group:
+    return err;
+}
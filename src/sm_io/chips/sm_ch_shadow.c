@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+void smch_shadow_reset (smch_shadow_t *self)
+{
+    assert (self);
+    memset (self->valid, 0, sizeof (self->valid));
+}
+
+void smch_shadow_set (smch_shadow_t *self, uint16_t addr, uint8_t value)
+{
+    assert (self);
+
+    if (addr < SMCH_SHADOW_REGS) {
+        self->value [addr] = value;
+        self->valid [addr/8] |= 1 << (addr % 8);
+    }
+}
+
+bool smch_shadow_get (smch_shadow_t *self, uint16_t addr, uint8_t *value)
+{
+    assert (self);
+    assert (value);
+
+    if (addr >= SMCH_SHADOW_REGS || !(self->valid [addr/8] & (1 << (addr % 8)))) {
+        return false;
+    }
+
+    *value = self->value [addr];
+    return true;
+}
@@ -41,6 +41,9 @@
 #define SMCH_SI57X_USECS_WAIT               10000
 #define SMCH_SI57X_WAIT(usecs)              usleep(usecs)
 #define SMCH_SI57X_WAIT_DFLT                SMCH_SI57X_WAIT(SMCH_SI57X_USECS_WAIT)
+/* Changes up to this from the center frequency only need a new RFREQ, and
+ * are applied without freezing the DCO, so the output does not glitch */
+#define SMCH_SI57X_SMALL_CHANGE_PPM         3500
 
 struct _smch_si57x_t {
     smpr_t *i2c;                    /* I2C protocol object */
@@ -50,6 +53,9 @@ struct _smch_si57x_t {
     unsigned int hs_div;            /* High Speed divider value */
     uint64_t rfreq;                 /* RFreq value */
     double frequency;               /* Output crystal frequency */
+    double fcenter;                 /* Frequency set with the DCO frozen. The
+                                       small changes are relative to it */
+    smch_shadow_t shadow;           /* Last known register contents */
 };
 
 static smch_err_e _smch_si57x_write_8 (smch_si57x_t *self, uint8_t addr,
@@ -58,6 +64,7 @@ static smch_err_e _smch_si57x_write_block (smch_si57x_t *self, uint8_t addr,
         const uint8_t *data, size_t size);
 static ssize_t _smch_si57x_write_generic (smch_si57x_t *self, uint8_t addr,
         const uint8_t *data, size_t size);
+static bool _smch_si57x_reg_is_volatile (uint8_t addr);
 
 static smch_err_e _smch_si57x_read_8 (smch_si57x_t *self, uint8_t addr,
         uint8_t *data);
@@ -69,8 +76,17 @@ static ssize_t _smch_si57x_read_generic (smch_si57x_t *self, uint8_t addr,
 static smch_err_e _smch_si57x_get_divs (smch_si57x_t *self, uint64_t *rfreq,
         unsigned int *n1, unsigned int *hs_div);
 static smch_err_e _smch_si57x_get_defaults (smch_si57x_t *self, double fout);
+static smch_err_e _smch_si57x_calibrate (smch_si57x_t *self);
+static smch_err_e _smch_si57x_write_changed (smch_si57x_t *self, uint8_t addr,
+        const uint8_t *data, size_t size);
 static smch_err_e _smch_si57x_set_freq_raw (smch_si57x_t *self, uint8_t *data,
         size_t size);
+static smch_err_e _smch_si57x_set_rfreq_raw (smch_si57x_t *self, uint8_t *data,
+        size_t size);
+static void _smch_si57x_fmt_divs (uint64_t rfreq, unsigned int n1,
+        unsigned int hs_div, uint8_t *divs);
+static uint64_t _smch_si57x_calc_rfreq (smch_si57x_t *self, double fdco);
+static bool _smch_si57x_is_small_change (smch_si57x_t *self, double frequency);
 static smch_err_e _smch_si57x_calc_divs (smch_si57x_t *self, double frequency,
         uint64_t *out_rfreq, unsigned int *out_n1, unsigned int *out_hs_div);
 static smch_err_e _smch_si57x_wait_new_freq (smch_si57x_t *self);
@@ -100,6 +116,7 @@ smch_si57x_t * smch_si57x_new (smio_t *parent, uint64_t base, uint32_t addr,
     self->hs_div    = SMCH_SI57X_DFLT_HSDIV;
     self->rfreq     = SMCH_SI57X_DFLT_RFREQ;
     self->frequency = SMCH_SI57X_DFLT_FREQUENCY;
+    self->fcenter   = 0.0;
 
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO, "[sm_ch:si57x] Created instance of SMCH\n");
     return self;
@@ -177,6 +194,26 @@ smch_err_e smch_si57x_set_freq (smch_si57x_t *self, double *freq)
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_TRACE, "[sm_ch:si57x_set_freq] Configuring "
             "frequency to %f Hz\n", frequency);
 
+    /* The crystal frequency is only read from the chip the first time */
+    err = _smch_si57x_calibrate (self);
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not calibrate crystal frequency",
+            err_exit);
+
+    uint8_t divs[SI57X_NUM_DIV_REGS];
+    if (_smch_si57x_is_small_change (self, frequency)) {
+        /* Same dividers, only RFREQ changes */
+        uint64_t rfreq = _smch_si57x_calc_rfreq (self,
+                frequency * self->hs_div * self->n1);
+        _smch_si57x_fmt_divs (rfreq, self->n1, self->hs_div, divs);
+
+        err = _smch_si57x_set_rfreq_raw (self, divs, SI57X_NUM_DIV_REGS);
+        ASSERT_TEST(err == SMCH_SUCCESS, "Could not set new RFREQ",
+                err_exit);
+
+        self->rfreq = rfreq;
+        goto err_exit;
+    }
+
     /* Get optimal divider values */
     err = _smch_si57x_calc_divs (self, frequency, &self->rfreq, &self->n1,
             &self->hs_div);
@@ -184,21 +221,15 @@ smch_err_e smch_si57x_set_freq (smch_si57x_t *self, double *freq)
             err_exit);
 
     /* Format divider values */
-    uint8_t divs[SI57X_NUM_DIV_REGS];
-    divs[0] = SI57X_HS_N1_HS_W(self->hs_div - SI57X_HS_N1_HS_OFFSET) |
-        (((self->n1 - 1) >> SI57X_HS_N1_N1_6_2_SHIFT_MSB) & SI57X_HS_N1_N1_6_2_MASK);
-    divs[1] = SI57X_N1_RFREQ0_N1_1_0_W(self->n1 - 1) |
-        SI57X_N1_RFREQ0_RFREQ_37_32_W(self->rfreq >> 32);
-    divs[2] = SI57X_RFREQ1_RFREQ_31_24_W(self->rfreq >> 24);
-    divs[3] = SI57X_RFREQ2_RFREQ_23_16_W(self->rfreq >> 16);
-    divs[4] = SI57X_RFREQ3_RFREQ_15_8_W(self->rfreq >> 8);
-    divs[5] = SI57X_RFREQ4_RFREQ_7_0_W(self->rfreq);
+    _smch_si57x_fmt_divs (self->rfreq, self->n1, self->hs_div, divs);
 
     /* Setup new frequency */
     err = _smch_si57x_set_freq_raw (self, divs, SI57X_NUM_DIV_REGS);
     ASSERT_TEST(err == SMCH_SUCCESS, "Could not set new frequency",
             err_exit);
 
+    self->fcenter = frequency;
+
 err_exit:
     return err;
 }
@@ -275,6 +306,20 @@ static ssize_t _smch_si57x_write_generic (smch_si57x_t *self, uint8_t addr,
     ASSERT_TEST(smpr_err == trans_size/SMPR_BYTE_2_BIT /* in bytes*/,
             "Could not write data to I2C", err_exit, -1);
 
+    if (addr == SI57X_REG_CONTROL &&
+            (*data & (SI57X_CONTROL_RECALL | SI57X_CONTROL_RESET))) {
+        /* The frequency registers are reloaded from NVM */
+        smch_shadow_reset (&self->shadow);
+    }
+    else {
+        size_t i;
+        for (i = 0; i < size; ++i) {
+            if (!_smch_si57x_reg_is_volatile (addr + i)) {
+                smch_shadow_set (&self->shadow, addr + i, data [i]);
+            }
+        }
+    }
+
     /* Return just the number of data bytes written */
     err = smpr_err - SI57X_ADDR_TRANS_SIZE/SMPR_BYTE_2_BIT;
 
@@ -304,6 +349,20 @@ static ssize_t _smch_si57x_read_generic (smch_si57x_t *self, uint8_t addr, uint8
     assert (data);
 
     ssize_t err = -1;
+
+    /* We know what is in there, as we wrote it ourselves */
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        if (_smch_si57x_reg_is_volatile (addr + i) ||
+                !smch_shadow_get (&self->shadow, addr + i, data + i)) {
+            break;
+        }
+    }
+
+    if (i == size) {
+        return size;
+    }
+
     uint32_t trans_size = SI57X_ADDR_TRANS_SIZE;
     /* Si571 needs a repeated start between the write and read commands */
     uint32_t flags = SMPR_PROTO_I2C_REP_START  |
@@ -336,6 +395,12 @@ static ssize_t _smch_si57x_read_generic (smch_si57x_t *self, uint8_t addr, uint8
     ASSERT_TEST(smpr_err == trans_size/SMPR_BYTE_2_BIT /* in bytes */,
             "Could not read data from I2C", err_exit, -1);
 
+    for (i = 0; i < size; ++i) {
+        if (!_smch_si57x_reg_is_volatile (addr + i)) {
+            smch_shadow_set (&self->shadow, addr + i, data [i]);
+        }
+    }
+
     err = smpr_err;
 
 err_exit:
@@ -407,6 +472,8 @@ static smch_err_e _smch_si57x_get_defaults (smch_si57x_t *self, double fout)
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_TRACE, "[sm_ch:si57x_get_defaults] fxtal: %f, "
             "fdco: %" PRIu64 ", rfreq: %f\n", self->fxtal, fdco, self->rfreq / POW_2_28);
 
+    /* The factory frequency was applied as a new frequency */
+    self->fcenter = SI57X_FOUT_FACTORY_DFLT;
     self->frequency = fout;
 
 err_exit:
@@ -424,15 +491,13 @@ static smch_err_e _smch_si57x_set_freq_raw (smch_si57x_t *self, uint8_t *data,
     err = _smch_si57x_write_8 (self, SI57X_REG_FREEZE_DCO, &__data);
     ASSERT_TEST(err == SMCH_SUCCESS, "Could not freeze DCO", err_exit);
 
-    SMCH_SI57X_WAIT_DFLT;
-
-    /* Write frequency registers to Chip (for 20ppm and 50ppm devices) */
-    err = _smch_si57x_write_block (self, SI57X_REG_START, data, size);
+    /* Write frequency registers to Chip (for 20ppm and 50ppm devices). No
+     * waiting is needed while the DCO is frozen, and the new frequency must
+     * be applied within 10 ms of unfreezing it */
+    err = _smch_si57x_write_changed (self, SI57X_REG_START, data, size);
     ASSERT_TEST(err == SMCH_SUCCESS, "Could not write frequency registers to chip",
             err_exit);
 
-    SMCH_SI57X_WAIT_DFLT;
-
     /* Unfreeze DCO */
     __data &= ~SI57X_FREEZE_DCO;
     err = _smch_si57x_write_8 (self, SI57X_REG_FREEZE_DCO, &__data);
@@ -455,6 +520,46 @@ err_exit:
     return err;
 }
 
+/* Small frequency change. The M value (RFREQ) is frozen while its registers
+ * are written, so the output moves to the new frequency in one step */
+static smch_err_e _smch_si57x_set_rfreq_raw (smch_si57x_t *self, uint8_t *data,
+        size_t size)
+{
+    assert (self);
+    assert (size == SI57X_NUM_DIV_REGS);
+    smch_err_e err = SMCH_SUCCESS;
+
+    /* Freeze M */
+    uint8_t __data = SI57X_CONTROL_FREEZE_M;
+    err = _smch_si57x_write_8 (self, SI57X_REG_CONTROL, &__data);
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not freeze M", err_exit);
+
+    /* HS_DIV is the same, so start at the register with RFREQ MSBs */
+    err = _smch_si57x_write_changed (self, SI57X_REG_N1_RFREQ0,
+            data + (SI57X_REG_N1_RFREQ0 - SI57X_REG_START),
+            size - (SI57X_REG_N1_RFREQ0 - SI57X_REG_START));
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not write RFREQ registers to chip",
+            err_exit);
+
+    /* Unfreeze M */
+    __data = 0;
+    err = _smch_si57x_write_8 (self, SI57X_REG_CONTROL, &__data);
+    ASSERT_TEST(err == SMCH_SUCCESS, "Could not unfreeze M", err_exit);
+
+    DBE_DEBUG (DBG_SM_CH | DBG_LVL_INFO, "[sm_ch:si57x_set_rfreq_raw] Setup new "
+            "RFREQ completed\n");
+
+err_exit:
+    return err;
+}
+
+smch_err_e smch_si57x_resync (smch_si57x_t *self)
+{
+    assert (self);
+    smch_shadow_reset (&self->shadow);
+    return SMCH_SUCCESS;
+}
+
 /* FIXME: reuse 24AA64 probe function */
 ssize_t smch_si57x_probe_bus (smch_si57x_t *self)
 {
@@ -485,6 +590,96 @@ ssize_t smch_si57x_probe_bus (smch_si57x_t *self)
 
 /******************************* Helper Functions ****************************/
 
+/* Read the crystal frequency from the factory startup registers, if not
+ * done yet. This returns the chip to its factory frequency */
+static smch_err_e _smch_si57x_calibrate (smch_si57x_t *self)
+{
+    assert (self);
+
+    if (self->fxtal != SMCH_SI57X_DFLT_FXTAL) {
+        return SMCH_SUCCESS;
+    }
+
+    return _smch_si57x_get_defaults (self, SI57X_FOUT_FACTORY_DFLT);
+}
+
+/* Write only the bytes from the first to the last one that differ from the
+ * shadow copy, in a single transaction */
+static smch_err_e _smch_si57x_write_changed (smch_si57x_t *self, uint8_t addr,
+        const uint8_t *data, size_t size)
+{
+    size_t first = 0;
+    size_t last = size;
+    uint8_t cur;
+
+    while (first < last && smch_shadow_get (&self->shadow, addr + first, &cur) &&
+            cur == data [first]) {
+        ++first;
+    }
+    while (last > first && smch_shadow_get (&self->shadow, addr + last - 1, &cur) &&
+            cur == data [last - 1]) {
+        --last;
+    }
+
+    if (first == last) {
+        return SMCH_SUCCESS;
+    }
+
+    return _smch_si57x_write_block (self, addr + first, data + first,
+            last - first);
+}
+
+/* Register contents of the divider values, from SI57X_REG_START */
+static void _smch_si57x_fmt_divs (uint64_t rfreq, unsigned int n1,
+        unsigned int hs_div, uint8_t *divs)
+{
+    divs[0] = SI57X_HS_N1_HS_W(hs_div - SI57X_HS_N1_HS_OFFSET) |
+        (((n1 - 1) >> SI57X_HS_N1_N1_6_2_SHIFT_MSB) & SI57X_HS_N1_N1_6_2_MASK);
+    divs[1] = SI57X_N1_RFREQ0_N1_1_0_W(n1 - 1) |
+        SI57X_N1_RFREQ0_RFREQ_37_32_W(rfreq >> 32);
+    divs[2] = SI57X_RFREQ1_RFREQ_31_24_W(rfreq >> 24);
+    divs[3] = SI57X_RFREQ2_RFREQ_23_16_W(rfreq >> 16);
+    divs[4] = SI57X_RFREQ3_RFREQ_15_8_W(rfreq >> 8);
+    divs[5] = SI57X_RFREQ4_RFREQ_7_0_W(rfreq);
+}
+
+/* RFREQ for a DCO frequency, in its binary representation */
+static uint64_t _smch_si57x_calc_rfreq (smch_si57x_t *self, double fdco)
+{
+    double rfreq_tmp = fdco / self->fxtal;
+
+    /* Integer part is a 10-bit number */
+    uint64_t rfreq_integer = FLOOR(rfreq_tmp);
+    /* Fractional part is a 28-bit number */
+    uint64_t rfreq_frac = FLOOR((rfreq_tmp - rfreq_integer) * POW_2_28);
+
+    /* Concatenate the integer and fractional parts */
+    return (rfreq_integer << SI57X_RFREQ_FRAC_SIZE) | rfreq_frac;
+}
+
+/* Check if "frequency" can be reached with the current dividers, within
+ * SMCH_SI57X_SMALL_CHANGE_PPM of the center frequency */
+static bool _smch_si57x_is_small_change (smch_si57x_t *self, double frequency)
+{
+    if (self->fcenter <= 0 || self->n1 == 0 || self->hs_div == 0) {
+        return false;
+    }
+
+    double fdco = frequency * self->hs_div * self->n1;
+    double delta = frequency > self->fcenter ? frequency - self->fcenter :
+        self->fcenter - frequency;
+    return delta * 1e6 <= SMCH_SI57X_SMALL_CHANGE_PPM * self->fcenter &&
+        fdco >= SI57X_FDCO_MIN && fdco <= SI57X_FDCO_MAX;
+}
+
+/* Registers that change by themselves and must always be read from the
+ * chip */
+static bool _smch_si57x_reg_is_volatile (uint8_t addr)
+{
+    /* The RECALL, NEWFREQ and RESET bits clear themselves */
+    return addr == SI57X_REG_CONTROL;
+}
+
 static smch_err_e _smch_si57x_wait_new_freq (smch_si57x_t *self)
 {
     assert (self);
@@ -520,9 +715,6 @@ static smch_err_e _smch_si57x_calc_divs (smch_si57x_t *self, double frequency,
     smch_err_e err = SMCH_SUCCESS;
     unsigned int n1, hs_div;
     double fdco, best_fdco = DBL_MAX;
-    double rfreq_tmp;
-    uint64_t rfreq_integer = 0;
-    uint64_t rfreq_frac = 0;
     static const uint8_t si57x_hs_div_values [] = { 11, 9, 7, 6, 5, 4 };
 
     uint32_t i;
@@ -545,19 +737,7 @@ static smch_err_e _smch_si57x_calc_divs (smch_si57x_t *self, double frequency,
             if (fdco >= SI57X_FDCO_MIN && fdco < best_fdco) {
                 *out_n1 = n1;
                 *out_hs_div = hs_div;
-
-                rfreq_tmp = fdco / self->fxtal;
-
-                /* convert new RFREQ to the binary representation
-                 * separate the integer part */
-
-                /* Integer part is a 10-bit number */
-                rfreq_integer = FLOOR(rfreq_tmp);
-                /* Fractional part is a 28-bit number */
-                rfreq_frac = FLOOR((rfreq_tmp - rfreq_integer) * POW_2_28);
-
-                /* Concatenate the integer and fractional parts */
-                *out_rfreq = (rfreq_integer << SI57X_RFREQ_FRAC_SIZE) | rfreq_frac;
+                *out_rfreq = _smch_si57x_calc_rfreq (self, fdco);
                 best_fdco = fdco;
             }
 
@@ -570,9 +750,8 @@ static smch_err_e _smch_si57x_calc_divs (smch_si57x_t *self, double frequency,
     }
 
     DBE_DEBUG (DBG_SM_CH | DBG_LVL_TRACE, "[sm_ch:si57x_calc_divs] Divider values:\n"
-            "\tfrequency: %f, rfreq: %" PRIu64 ", rfreq_integer: %" PRIu64 ", "
-            "rfreq_frac: %" PRIu64 ", n1: %u, hs_div: %u\n", frequency, *out_rfreq,
-            rfreq_integer, rfreq_frac, *out_n1, *out_hs_div);
+            "\tfrequency: %f, rfreq: %" PRIu64 ", n1: %u, hs_div: %u\n",
+            frequency, *out_rfreq, *out_n1, *out_hs_div);
 
     return err;
 }
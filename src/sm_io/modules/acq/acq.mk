@@ -2,4 +2,10 @@ sm_io_acq_DIR = $(SRC_DIR)/sm_io/modules/acq
 
 sm_io_acq_OBJS = $(sm_io_acq_DIR)/sm_io_acq_core.o \
 		 $(sm_io_acq_DIR)/sm_io_acq_exp.o \
-		 $(sm_io_acq_DIR)/sm_io_acq_exports.o
+		 $(sm_io_acq_DIR)/sm_io_acq_exports.o \
+		 $(sm_io_acq_DIR)/sm_io_acq_reduce.o \
+		 $(sm_io_acq_DIR)/sm_io_acq_stats.o \
+		 $(sm_io_acq_DIR)/sm_io_acq_env.o \
+		 $(sm_io_acq_DIR)/sm_io_acq_cache.o \
+		 $(sm_io_acq_DIR)/sm_io_acq_rec.o \
+		 $(sm_io_acq_DIR)/sm_io_acq_pstream.o
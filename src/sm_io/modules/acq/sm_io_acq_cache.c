@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Acquisition data cache. The last curve of each channel is kept in host
+ * memory as it is read, so other clients reading the same acquisition are
+ * served without going to the board again. Curves are identified by the
+ * channel acquisition sequence number and the least recently used ones are
+ * evicted when the memory limit is reached */
+
+#include "bpm_server.h"
+/* Private headers */
+#include "sm_io_acq_codes.h"
+#include "sm_io_acq_cache.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io:acq_cache]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)   \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io:acq_cache]",           \
+            smio_err_str(SMIO_ERR_ALLOC),                       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io:acq_cache]",              \
+            smio_err_str (err_type))
+
+typedef struct {
+    uint32_t seq;                       /* Acquisition the curve belongs to */
+    uint64_t size;                      /* Curve size in bytes */
+    uint8_t *data;                      /* Curve data. NULL if nothing is cached */
+    uint8_t *valid;                     /* One flag per chunk read */
+    uint64_t last_used;                 /* Cache tick of the last access */
+} acq_cache_entry_t;
+
+struct _smio_acq_cache_t {
+    acq_cache_entry_t *entries;         /* One entry per channel */
+    uint32_t num_chans;                 /* Number of channels */
+    size_t size;                        /* Memory in use in bytes */
+    size_t size_max;                    /* Memory limit in bytes */
+    uint64_t tick;                      /* Incremented on every access */
+    uint64_t hits;                      /* Statistics */
+    uint64_t misses;
+};
+
+static void _acq_cache_entry_free (smio_acq_cache_t *self, acq_cache_entry_t *entry);
+static bool _acq_cache_evict_lru (smio_acq_cache_t *self);
+
+/* Creates a new cache for "num_chans" channels using up to "size_max" bytes */
+smio_acq_cache_t *smio_acq_cache_new (uint32_t num_chans, size_t size_max)
+{
+    smio_acq_cache_t *self = (smio_acq_cache_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->entries = (acq_cache_entry_t *) zmalloc (num_chans *
+            sizeof (*self->entries));
+    ASSERT_ALLOC(self->entries, err_entries_alloc);
+
+    self->num_chans = num_chans;
+    self->size_max = size_max;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq_cache] Created cache "
+            "of up to %zu bytes\n", size_max);
+    return self;
+
+err_entries_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy the cache and free all the cached data */
+void smio_acq_cache_destroy (smio_acq_cache_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_acq_cache_t *self = *self_p;
+
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq_cache] %"PRIu64" hits, "
+                "%"PRIu64" misses\n", self->hits, self->misses);
+
+        for (uint32_t i = 0; i < self->num_chans; ++i) {
+            _acq_cache_entry_free (self, &self->entries [i]);
+        }
+
+        free (self->entries);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+bool smio_acq_cache_get (smio_acq_cache_t *self, uint32_t chan, uint32_t seq,
+        uint64_t offs, size_t size, uint8_t *data)
+{
+    assert (self);
+    assert (data);
+
+    if (chan >= self->num_chans) {
+        return false;
+    }
+
+    acq_cache_entry_t *entry = &self->entries [chan];
+    if (entry->data == NULL || entry->seq != seq || size == 0 ||
+            offs + size > entry->size) {
+        goto err_miss;
+    }
+
+    for (uint64_t c = offs / ACQ_CACHE_CHUNK_SIZE;
+            c <= (offs + size - 1) / ACQ_CACHE_CHUNK_SIZE; ++c) {
+        if (!entry->valid [c]) {
+            goto err_miss;
+        }
+    }
+
+    memcpy (data, entry->data + offs, size);
+    entry->last_used = ++self->tick;
+    self->hits++;
+    return true;
+
+err_miss:
+    self->misses++;
+    return false;
+}
+
+void smio_acq_cache_put (smio_acq_cache_t *self, uint32_t chan, uint32_t seq,
+        uint64_t curve_size, uint64_t offs, size_t size, const uint8_t *data)
+{
+    assert (self);
+    assert (data);
+
+    if (chan >= self->num_chans || size == 0 || curve_size > self->size_max ||
+            offs + size > curve_size) {
+        return;
+    }
+
+    acq_cache_entry_t *entry = &self->entries [chan];
+
+    /* Data of a previous acquisition is useless now */
+    if (entry->data != NULL && (entry->seq != seq || entry->size != curve_size)) {
+        _acq_cache_entry_free (self, entry);
+    }
+
+    if (entry->data == NULL) {
+        while (self->size + curve_size > self->size_max) {
+            if (!_acq_cache_evict_lru (self)) {
+                return;
+            }
+        }
+
+        uint64_t num_chunks = (curve_size + ACQ_CACHE_CHUNK_SIZE - 1) /
+            ACQ_CACHE_CHUNK_SIZE;
+        entry->data = (uint8_t *) malloc (curve_size);
+        entry->valid = (uint8_t *) zmalloc (num_chunks);
+        if (entry->data == NULL || entry->valid == NULL) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq_cache] Could not "
+                    "allocate %"PRIu64" bytes for channel %u\n", curve_size, chan);
+            free (entry->data);
+            free (entry->valid);
+            entry->data = NULL;
+            entry->valid = NULL;
+            return;
+        }
+
+        entry->seq = seq;
+        entry->size = curve_size;
+        self->size += curve_size;
+    }
+
+    memcpy (entry->data + offs, data, size);
+    entry->last_used = ++self->tick;
+
+    /* Only whole chunks are valid, except for the last one of the curve */
+    for (uint64_t c = (offs + ACQ_CACHE_CHUNK_SIZE - 1) / ACQ_CACHE_CHUNK_SIZE;
+            c * ACQ_CACHE_CHUNK_SIZE < offs + size; ++c) {
+        uint64_t chunk_end = (c + 1) * ACQ_CACHE_CHUNK_SIZE;
+        if (chunk_end <= offs + size || offs + size == curve_size) {
+            entry->valid [c] = 1;
+        }
+    }
+}
+
+void smio_acq_cache_invalidate (smio_acq_cache_t *self, uint32_t chan)
+{
+    assert (self);
+
+    if (chan < self->num_chans) {
+        _acq_cache_entry_free (self, &self->entries [chan]);
+    }
+}
+
+/**************** Helper Functions ***************/
+
+static void _acq_cache_entry_free (smio_acq_cache_t *self, acq_cache_entry_t *entry)
+{
+    if (entry->data != NULL) {
+        self->size -= entry->size;
+    }
+
+    free (entry->data);
+    free (entry->valid);
+    entry->data = NULL;
+    entry->valid = NULL;
+    entry->size = 0;
+}
+
+/* Returns false if there was nothing to evict */
+static bool _acq_cache_evict_lru (smio_acq_cache_t *self)
+{
+    acq_cache_entry_t *lru = NULL;
+
+    for (uint32_t i = 0; i < self->num_chans; ++i) {
+        acq_cache_entry_t *entry = &self->entries [i];
+        if (entry->data != NULL && (lru == NULL || entry->last_used < lru->last_used)) {
+            lru = entry;
+        }
+    }
+
+    if (lru == NULL) {
+        return false;
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq_cache] Evicting curve "
+            "of channel %u\n", (uint32_t) (lru - self->entries));
+    _acq_cache_entry_free (self, lru);
+    return true;
+}
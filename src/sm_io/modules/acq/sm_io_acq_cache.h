@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+*/
+
+#ifndef _SM_IO_ACQ_CACHE_H_
+#define _SM_IO_ACQ_CACHE_H_
+
+/* Data is cached in chunks of this size. Blocks are powers of 2 of at
+ * least ACQ_BLOCK_SIZE_MIN bytes, so they always start at a chunk */
+#define ACQ_CACHE_CHUNK_SIZE            ACQ_BLOCK_SIZE_MIN
+
+/* Maximum amount of memory used by the cache of each ACQ SMIO, in MB.
+ * It can be changed with the environment variable below. 0 disables it */
+#define ACQ_CACHE_SIZE_MAX_DFLT         256
+#define ACQ_CACHE_ENV_SIZE_MAX          "SMIO_ACQ_CACHE_SIZE_MB"
+
+typedef struct _smio_acq_cache_t smio_acq_cache_t;
+
+/***************** Our methods *****************/
+
+/* Creates a new cache for "num_chans" channels using up to "size_max" bytes */
+smio_acq_cache_t *smio_acq_cache_new (uint32_t num_chans, size_t size_max);
+/* Destroy the cache and free all the cached data */
+void smio_acq_cache_destroy (smio_acq_cache_t **self_p);
+
+/* Copy "size" bytes at offset "offs" of the curve acquired with sequence
+ * number "seq" on channel "chan" to "data". Returns true if all of it was
+ * in the cache, false otherwise */
+bool smio_acq_cache_get (smio_acq_cache_t *self, uint32_t chan, uint32_t seq,
+        uint64_t offs, size_t size, uint8_t *data);
+/* Store "size" bytes read at offset "offs" of the curve acquired with
+ * sequence number "seq" on channel "chan". "curve_size" is the size of the
+ * whole curve. The least recently used curves are evicted to make room */
+void smio_acq_cache_put (smio_acq_cache_t *self, uint32_t chan, uint32_t seq,
+        uint64_t curve_size, uint64_t offs, size_t size, const uint8_t *data);
+/* Drop the curve cached for channel "chan" */
+void smio_acq_cache_invalidate (smio_acq_cache_t *self, uint32_t chan);
+
+#endif
@@ -15,6 +15,474 @@ struct _smio_acq_data_block_t {
     uint8_t data[BLOCK_SIZE];       /* data buffer */
 };
 
+/* Limits for the negotiated block size. Must be a power of 2 */
+#define ACQ_BLOCK_SIZE_MIN              4096
+#define ACQ_BLOCK_SIZE_MAX              (1 << 23)
+
+/* Same as smio_acq_data_block_t, but large enough for any
+ * negotiated block size */
+struct _smio_acq_data_block_var_t {
+    uint32_t valid_bytes;           /* how much of the requested bytes are valid */
+    uint8_t data[ACQ_BLOCK_SIZE_MAX];   /* data buffer */
+};
+
+/* Block transfer codecs. The ACQ SMIO only uses the codec a client asked for
+ * when it makes the block smaller, so clients must check the one actually
+ * used. ACQ_CODEC_DELTA is the lossless delta codec of libhutils, applied to
+ * the ACQ_REDUCE_NUM_ATOMS atoms of each sample. ACQ_CODEC_SCALED16 is the
+ * lossy scaled 16-bit codec of libhutils (see hutils_codec_scaled16_encode),
+ * for 32-bit atoms only, e.g., positions. It halves the block, each atom of
+ * a block being then off by less than about 1/65536 of its span in the block,
+ * which is fine for displays but not for analysis */
+#define ACQ_CODEC_NONE                  0
+#define ACQ_CODEC_DELTA                 1
+#define ACQ_CODEC_SCALED16              2
+#define ACQ_CODEC_END                   3
+
+/* Same as smio_acq_data_block_var_t, but possibly encoded */
+struct _smio_acq_data_block_coded_t {
+    uint32_t codec;                 /* codec used, ACQ_CODEC_* */
+    uint32_t atom_size;             /* atom size the codec was applied to */
+    uint32_t raw_bytes;             /* size of the block once decoded */
+    uint32_t valid_bytes;           /* how much of the data buffer is valid */
+    uint8_t data[ACQ_BLOCK_SIZE_MAX];   /* data buffer */
+};
+
+/* Same as smio_acq_data_block_coded_t, preceded by the CRC32C (see
+ * hutils_crc32c ()) of the coded block, from its codec up to the end of
+ * its valid bytes, so clients can check it arrived intact */
+struct _smio_acq_data_block_crc_t {
+    uint32_t crc;                   /* CRC32C of "block" */
+    smio_acq_data_block_coded_t block;  /* coded block */
+};
+
+/* Shared memory descriptor. Returned instead of the data itself when the
+ * client is colocated with the server and maps the ACQ shared memory region */
+struct _smio_acq_shm_desc_t {
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel the block belongs to */
+    uint32_t offset;                /* offset of the block from the start of the region */
+    uint32_t valid_bytes;           /* how much of the BLOCK_SIZE bytes are valid */
+};
+
+/* Header of each block pushed by a streaming curve transfer. Each streamed
+ * message is composed of this header frame followed by the data frame */
+struct _smio_acq_stream_hdr_t {
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel the block belongs to */
+    uint32_t block_n;               /* block index */
+    uint32_t valid_bytes;           /* size of the data frame */
+};
+
+/* Server-side reduction of the acquisition data. Each sample is composed of
+ * ACQ_REDUCE_NUM_ATOMS interleaved atoms of sample_size/ACQ_REDUCE_NUM_ATOMS
+ * bytes (e.g., ADC channels 0 to 3 or X/Y/Q/SUM). Clients can ask for a subset
+ * of the atoms (bit i of the mask selects atom i), for one out of every
+ * "decim" samples, or both */
+#define ACQ_REDUCE_NUM_ATOMS            4
+#define ACQ_REDUCE_ATOM_MASK_ALL        ((1 << ACQ_REDUCE_NUM_ATOMS) - 1)
+
+/* Server-side statistics of a completed acquisition, for clients that only
+ * want a summary of the curve. They are computed per atom (see
+ * ACQ_REDUCE_NUM_ATOMS), with atoms taken as signed integers. Percentiles
+ * take a second pass over the curve, so they are only computed if
+ * ACQ_STATS_FLAGS_PCTL is given. They come from a histogram of
+ * ACQ_STATS_HIST_BINS bins between the minimum and the maximum, so they
+ * are exact if these are less than ACQ_STATS_HIST_BINS apart and are the
+ * lower edge of the bin otherwise */
+#define ACQ_STATS_FLAGS_PCTL            (1 << 0)
+#define ACQ_STATS_FLAGS_ALL             ACQ_STATS_FLAGS_PCTL
+#define ACQ_STATS_HIST_BINS             4096
+/* Percentiles computed: 1st, 5th, 50th (median), 95th and 99th */
+#define ACQ_STATS_NUM_PCTL              5
+
+struct _smio_acq_atom_stats_t {
+    int64_t min;                    /* minimum */
+    int64_t max;                    /* maximum */
+    double mean;                    /* mean */
+    double rms;                     /* root mean square */
+    double std;                     /* standard deviation */
+    double pctl[ACQ_STATS_NUM_PCTL];    /* percentiles. 0 if not asked for */
+};
+
+struct _smio_acq_curve_stats_t {
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel acquired */
+    uint32_t num_samples;           /* number of samples of the curve */
+    uint32_t atom_size;             /* atom size, in bytes */
+    smio_acq_atom_stats_t atom[ACQ_REDUCE_NUM_ATOMS];  /* per atom */
+};
+
+/* Server-side envelope of a range of a completed acquisition, for plotting
+ * long curves. The range is split in up to ACQ_ENV_MAX_BUCKETS buckets of
+ * bucket_samples samples, the last one possibly shorter, and the minimum,
+ * maximum and mean of each atom of every bucket are returned. With
+ * ACQ_ENV_FLAGS_PYRAMID, the SMIO keeps a multi-level envelope of the whole
+ * curve the first time it is asked for, and serves the next requests on the
+ * same curve from it. Buckets are then rounded out to the cells of the
+ * pyramid, so they may overlap a little, and the flag is set in the reply
+ * if the pyramid was used */
+#define ACQ_ENV_MAX_BUCKETS             4096
+#define ACQ_ENV_FLAGS_PYRAMID           (1 << 0)
+#define ACQ_ENV_FLAGS_ALL               ACQ_ENV_FLAGS_PYRAMID
+
+struct _smio_acq_env_bucket_t {
+    int32_t min[ACQ_REDUCE_NUM_ATOMS];  /* minimum, per atom */
+    int32_t max[ACQ_REDUCE_NUM_ATOMS];  /* maximum, per atom */
+    float mean[ACQ_REDUCE_NUM_ATOMS];   /* mean, per atom */
+};
+
+struct _smio_acq_envelope_t {
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel acquired */
+    uint32_t start;                 /* first sample of the range */
+    uint32_t num_samples;           /* samples of the range */
+    uint32_t bucket_samples;        /* samples per bucket */
+    uint32_t num_buckets;           /* number of valid buckets */
+    uint32_t atom_size;             /* atom size, in bytes */
+    uint32_t flags;                 /* ACQ_ENV_FLAGS_* actually used */
+    smio_acq_env_bucket_t buckets[ACQ_ENV_MAX_BUCKETS];
+};
+
+#define ACQ_STREAM_MSG_SIZE             2   /* header + data frames */
+/* Maximum number of blocks granted per streaming request */
+#define ACQ_STREAM_MAX_BLOCKS           64
+
+/* Single request acquisitions. ACQ_NAME_ACQUIRE_CURVE starts an acquisition,
+ * waits for it inside the SMIO and streams the whole curve back, as
+ * streaming transfers do, ACQ_STREAM_MAX_BLOCKS blocks per poll. The regular
+ * reply (number of blocks sent) comes after the last block, or alone if the
+ * acquisition failed or did not complete within the timeout given, in msec.
+ * A timeout of ACQ_ACQUIRE_CURVE_NO_TIMEOUT waits forever */
+#define ACQ_ACQUIRE_CURVE_NO_TIMEOUT    0
+
+/* Direct data path. Blocks are pushed by the ACQ SMIO straight to the client
+ * through a ROUTER socket, instead of being relayed by the broker. Control
+ * requests still go through the broker. Clients get the endpoint with
+ * ACQ_NAME_GET_DIRECT_ENDP, connect a DEALER socket to it, with its identity
+ * set to a string of less than ACQ_DIRECT_PEER_MAX_LEN characters, and pass
+ * that identity to ACQ_NAME_GET_CURVE_DIRECT. Each block is sent as in
+ * streaming transfers, a smio_acq_stream_hdr_t frame followed by the data
+ * frame, and the regular reply marks the end of each grant */
+#define ACQ_DIRECT_ENDP_MAX_LEN         256
+#define ACQ_DIRECT_PEER_MAX_LEN         64
+/* Endpoint the ROUTER socket is bound to. Wildcard ports are resolved and
+ * wildcard TCP hosts are advertised as the host name */
+#define ACQ_DIRECT_ENV_BIND             "BPM_ACQ_DIRECT_BIND"
+#define ACQ_DIRECT_BIND_DFLT            "tcp://*:*"
+
+struct _smio_acq_direct_endp_t {
+    char endp[ACQ_DIRECT_ENDP_MAX_LEN];     /* endpoint to connect to, NUL terminated */
+};
+
+struct _smio_acq_direct_peer_t {
+    char id[ACQ_DIRECT_PEER_MAX_LEN];       /* DEALER socket identity, NUL terminated */
+};
+
+/* Shared memory region name is the concatenation of this prefix and
+ * the ACQ SMIO service name */
+#define ACQ_SHM_NAME_PREFIX             "/bpm_acq_shm:"
+#define ACQ_SHM_NAME_MAX_LEN            256
+
+/* Acquisition completion events are published on the SMIO event stream
+ * "<ACQ SMIO service name>:EVENTS", with one smio_acq_event_t frame */
+#define ACQ_EVENT_STREAM_SUFFIX         SMIO_EVENT_STREAM_SUFFIX
+#define ACQ_EVENT_SUBJECT_DONE          "ACQ_DONE"
+/* Interval in which the ACQ status is checked while an acquisition
+ * is in progress */
+#define ACQ_EVENT_POLL_INTERVAL         1   /* in msec */
+/* The status of an acquisition with no trigger wait is not read before
+ * its completion is due, as predicted from the time per sample learned on
+ * the previous ones of the channel. Reading starts ACQ_PREDICT_GUARD plus
+ * 1/ACQ_PREDICT_GUARD_DIV of the expected duration before it */
+#define ACQ_PREDICT_GUARD               2000    /* in usec */
+#define ACQ_PREDICT_GUARD_DIV           8
+
+struct _smio_acq_event_t {
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel acquired (the last one, for
+                                       multi-channel acquisitions) */
+    uint32_t chan_mask;             /* all the channels acquired */
+    uint64_t timestamp;             /* completion time of the channel, see
+                                       smio_acq_curve_info_t */
+};
+
+/* Acquisitions are timestamped with the host wall clock, in ns since the
+ * Epoch, when their completion is detected. This is done on every poll while
+ * an acquisition is pending, so the timestamp is at most about
+ * ACQ_EVENT_POLL_INTERVAL late. Hosts are expected to be synchronized (NTP
+ * or PTP) for timestamps of different BPMs to be compared */
+struct _smio_acq_curve_info_t {
+    uint64_t timestamp;             /* completion time. 0 if not completed */
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel acquired */
+    uint32_t trig_addr;             /* trigger address (the last one, for
+                                       multishot acquisitions) */
+    uint32_t num_samples_pre;       /* number of pre-trigger samples */
+    uint32_t num_samples_post;      /* number of post-trigger samples */
+    uint32_t num_shots;             /* number of shots */
+};
+
+/* The last ACQ_TRIG_LOG_SIZE completed acquisitions of all the channels are
+ * kept in a log, so clients can correlate them after the fact */
+#define ACQ_TRIG_LOG_SIZE               64
+
+struct _smio_acq_trig_log_t {
+    uint64_t count;                 /* number of acquisitions logged so far */
+    uint32_t num_entries;           /* number of valid entries */
+    uint32_t reserved;
+    smio_acq_curve_info_t entries[ACQ_TRIG_LOG_SIZE];   /* oldest first */
+};
+
+/* Channel map of the ACQ SMIO, as generated from the board description
+ * (ACQ_CHAN_FOREACH). Entry i describes channel i, so clients can size their
+ * requests without a table of their own, whatever board they were built for */
+#define ACQ_CHAN_MAP_MAX_CHANS          32
+
+struct _smio_acq_chan_desc_t {
+    uint32_t id;                    /* channel ID */
+    uint32_t sample_size;           /* sample size in bytes */
+    uint32_t max_samples;           /* maximum number of samples */
+    uint32_t start_addr;            /* first byte of the channel DDR3 region */
+    uint32_t end_addr;              /* last sample of the channel DDR3 region */
+};
+
+struct _smio_acq_chan_map_t {
+    uint32_t num_chans;             /* number of valid entries, END_CHAN_ID */
+    uint32_t reserved;
+    smio_acq_chan_desc_t chans[ACQ_CHAN_MAP_MAX_CHANS];
+};
+
+/* Partition of the DDR3 of the ACQ core among its channels. Entry i is the
+ * size of the region of channel i, in bytes, regions being laid out one
+ * after the other in channel order from the start of the ACQ core memory.
+ * Sizes must be multiples of ACQ_PART_ALIGN, which keeps regions, and their
+ * ping-pong halves, aligned to DDR3 payloads and whole samples, and add up
+ * to at most mem_size. A size of 0 leaves the channel without memory. The
+ * memory can only be repartitioned while no acquisition is in progress, and
+ * the last acquisition of every channel is lost. The resulting regions are
+ * reported by the channel map (see smio_acq_chan_map_t) */
+#define ACQ_PART_ALIGN                  (1 << 20)
+
+struct _smio_acq_partition_t {
+    uint32_t num_chans;             /* number of valid entries, END_CHAN_ID */
+    uint32_t mem_size;              /* memory of the ACQ core in bytes. Read only */
+    uint32_t chan_size[ACQ_CHAN_MAP_MAX_CHANS];   /* region size of each channel */
+};
+
+/* Multishot acquisitions. Shots are stored one after the other, shot i
+ * starting at byte i*shot_size of the curve. The ACQ core acquires more
+ * pre and post-trigger samples than requested, as it needs them aligned to
+ * DDR3_PAYLOAD_SIZE, but only the requested ones are read back: the last
+ * num_samples_pre_req pre-trigger and the first num_samples_post_req
+ * post-trigger ones of each shot. So valid_offs is 0 and valid_size is
+ * shot_size */
+struct _smio_acq_shot_index_t {
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel acquired */
+    uint32_t num_shots;             /* number of shots */
+    uint32_t sample_size;           /* sample size in bytes */
+    uint32_t num_samples_pre;       /* pre-trigger samples acquired per shot */
+    uint32_t num_samples_post;      /* post-trigger samples acquired per shot */
+    uint32_t num_samples_pre_req;   /* pre-trigger samples requested per shot */
+    uint32_t num_samples_post_req;  /* post-trigger samples requested per shot */
+    uint64_t shot_size;             /* size of each shot in bytes */
+    uint64_t valid_offs;            /* offset of the first sample requested */
+    uint64_t valid_size;            /* size of the samples requested in bytes */
+};
+
+/* Multi-channel acquisition. Channels are selected by a mask (bit i selects
+ * channel i). The ACQ core writes a single channel at a time, so they are
+ * acquired one after the other, without waiting for the client in between.
+ * A single completion event is published when the last one is done */
+#define ACQ_MULTI_MAX_CHANS             32
+
+/* Blocks of the same index of several channels. Data of each channel
+ * follows the one of the previous channel in the mask */
+struct _smio_acq_data_block_multi_t {
+    uint32_t chan_mask;             /* channels returned */
+    uint32_t valid_bytes[ACQ_MULTI_MAX_CHANS];  /* valid bytes of each channel */
+    uint8_t data[ACQ_BLOCK_SIZE_MAX];   /* data buffer */
+};
+
+/* Continuous acquisition. The memory of a channel is split in segments that
+ * the ACQ core fills one after the other, in a circle. Samples are counted
+ * from the start of the continuous acquisition, so clients can keep a cursor
+ * and only ask for what is new. A few samples are lost between segments, while
+ * the next one is armed */
+#define ACQ_RING_MIN_NUM_SEGS           2
+
+/* Some samples were overwritten before being read. The data returned starts
+ * at the oldest sample available */
+#define ACQ_RING_FLAG_OVERRUN           (1 << 0)
+/* Continuous acquisition is stopped. No more samples are coming */
+#define ACQ_RING_FLAG_STOPPED           (1 << 1)
+
+struct _smio_acq_ring_data_t {
+    uint64_t head;                  /* number of samples acquired so far */
+    uint64_t start;                 /* index of the first sample returned */
+    uint32_t flags;                 /* ACQ_RING_FLAG_* */
+    uint32_t valid_bytes;           /* how much of the requested bytes are valid */
+    uint8_t data[ACQ_BLOCK_SIZE_MAX];   /* data buffer */
+};
+
+/* Position stream, for consumers on the same host, e.g., fast orbit
+ * feedback. With a capacity set by ACQ_NAME_CFG_PSTREAM, the continuous
+ * acquisitions also copy every segment, as soon as it is acquired, to a
+ * shared memory ring at "ACQ_PSTREAM_SHM_NAME_PREFIX<service>", which
+ * consumers poll with no request to the server.
+ *
+ * The ACQ SMIO is the only writer and never waits for the readers: sample
+ * i is at data_offs + (i % capacity)*sample_size until sample i + capacity
+ * is written. Before writing samples up to "reserve" it publishes that
+ * value, and it advances "head" once they are written. Readers keep their
+ * own cursor, copy the samples between it and "head" and read "reserve"
+ * again afterwards: samples below reserve - capacity may have been
+ * overwritten meanwhile. The ring is unlinked when the continuous
+ * acquisition stops, with ACQ_PSTREAM_FLAG_STOPPED set, so consumers open
+ * it again for the next one */
+#define ACQ_PSTREAM_SHM_NAME_PREFIX     "/bpm_pstream:"
+#define ACQ_PSTREAM_MAGIC               0x53504250      /* "PBPS" */
+#define ACQ_PSTREAM_VERSION             1
+#define ACQ_PSTREAM_CACHE_LINE_SIZE     64
+/* Capacity, in samples. Must be a power of 2 */
+#define ACQ_PSTREAM_MIN_SAMPLES         (1 << 10)
+#define ACQ_PSTREAM_MAX_SAMPLES         (1 << 24)
+
+/* Continuous acquisition is stopped. No more samples are coming */
+#define ACQ_PSTREAM_FLAG_STOPPED        (1 << 0)
+
+struct _smio_acq_pstream_hdr_t {
+    uint32_t magic;                 /* ACQ_PSTREAM_MAGIC */
+    uint32_t version;               /* ACQ_PSTREAM_VERSION */
+    uint32_t chan;                  /* channel streamed */
+    uint32_t sample_size;           /* sample size in bytes */
+    uint32_t capacity;              /* samples held by the ring */
+    uint32_t reserved;
+    uint64_t data_offs;             /* offset of the samples from the start of
+                                       the shared memory region */
+    /* Written by the ACQ SMIO only, on a cache line of their own */
+    uint64_t reserve __attribute__ ((aligned (ACQ_PSTREAM_CACHE_LINE_SIZE)));
+                                    /* samples being written up to */
+    uint64_t head;                  /* samples written so far */
+    uint64_t timestamp;             /* time "head" was last advanced, in ns
+                                       since the Epoch */
+    uint32_t flags;                 /* ACQ_PSTREAM_FLAG_* */
+} __attribute__ ((aligned (ACQ_PSTREAM_CACHE_LINE_SIZE)));
+
+/* Acquisition queue. A series of acquisitions of the same channel and
+ * parameters, each in its own slot of the channel memory, so all of them are
+ * kept until read. The ACQ SMIO starts the next acquisition as soon as the
+ * previous one is done, writing only the slot addresses, so there is no
+ * client round-trip in between. All of the slots must fit in the channel
+ * memory */
+#define ACQ_QUEUE_MAX_ACQS              256
+
+/* The queue is still acquiring */
+#define ACQ_QUEUE_FLAG_ACTIVE           (1 << 0)
+
+struct _smio_acq_queue_info_t {
+    uint32_t num_acqs;              /* number of acquisitions queued */
+    uint32_t num_done;              /* number of acquisitions done so far */
+    uint32_t flags;                 /* ACQ_QUEUE_FLAG_* */
+    uint32_t reserved;
+    smio_acq_curve_info_t curve;    /* acquisition asked for. timestamp is 0
+                                       if it was not done */
+};
+
+/* Ping-pong acquisitions. The memory of a channel is split into two halves,
+ * and each acquisition fills the half not holding the last one. The last
+ * acquisition can then be read while the next one is acquired, until the
+ * next one completes. The curves are limited to half of the channel memory.
+ * The first acquisition after enabling ping-pong might overwrite the last
+ * one, which used the whole memory */
+#define ACQ_PINGPONG_DISABLED           0
+#define ACQ_PINGPONG_ENABLED            1
+
+/* Post-mortem recorder. Once armed with ACQ_NAME_CFG_PM, every acquisition
+ * completed on one of the channels of its mask, however it was started, is
+ * read by the ACQ SMIO and written to a capture file (see
+ * bpm_capture_hdr_t) on the server host, without going through the
+ * broker. Files are named "<service>_CH<chan>_<seq>_<timestamp>.cap" and
+ * written to the directory given by the environment variable below. The
+ * recording of a curve is dropped if a new acquisition of its channel
+ * overwrites it first */
+#define ACQ_PM_ENV_DIR                  "BPM_ACQ_PM_DIR"
+#define ACQ_PM_FILE_SUFFIX              ".cap"
+
+struct _smio_acq_pm_info_t {
+    uint32_t chan_mask;             /* channels recorded */
+    uint32_t pending_mask;          /* channels waiting to be recorded */
+    uint32_t num_files;             /* files recorded */
+    uint32_t num_failed;            /* files that could not be written */
+    uint32_t num_dropped;           /* curves overwritten before being recorded */
+    uint32_t reserved;
+    uint64_t bytes_written;         /* payload bytes written */
+    smio_acq_curve_info_t last;     /* last curve recorded. timestamp is 0
+                                       if none */
+};
+
+/* Acquisition multicast. Once enabled with ACQ_NAME_CFG_MCAST, every
+ * acquisition completed on one of the channels of its mask, however it was
+ * started, is read once by the ACQ SMIO and published block by block on the
+ * ACQ event stream, with subject ACQ_EVENT_SUBJECT_DATA. Each message has a
+ * smio_acq_mcast_hdr_t frame followed by a frame with the data of the block.
+ * The broker copies the blocks to every consumer of the stream, so any
+ * number of them get each curve for a single readout of the memory. At most
+ * ACQ_MCAST_MAX_BLOCKS blocks of ACQ_MCAST_BLOCK_SIZE bytes are published
+ * per poll. The rest of a curve is dropped if a new acquisition of its
+ * channel overwrites it before being published, so consumers must check
+ * the sequence number and offset of each block. Like any stream message,
+ * blocks might also be dropped by the broker for slow consumers */
+#define ACQ_EVENT_SUBJECT_DATA          "ACQ_DATA"
+#define ACQ_MCAST_BLOCK_SIZE            (1 << 18)
+#define ACQ_MCAST_MAX_BLOCKS            16
+/* Last block of the curve */
+#define ACQ_MCAST_FLAG_LAST             (1 << 0)
+
+struct _smio_acq_mcast_hdr_t {
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel acquired */
+    uint32_t sample_size;           /* bytes per sample */
+    uint32_t flags;                 /* ACQ_MCAST_FLAG_* */
+    uint64_t timestamp;             /* completion time, see
+                                       smio_acq_curve_info_t */
+    uint64_t curve_size;            /* size of the whole curve, in bytes */
+    uint64_t offs;                  /* offset of the block in the curve */
+    uint32_t size;                  /* size of the block, in bytes */
+    uint32_t reserved;
+};
+
+/* Early delivery of the pre-trigger data. The pre-trigger samples of an
+ * acquisition are final as soon as its trigger comes, so, while a single
+ * shot acquisition waits for its trigger, the poll watches the FSM and reads
+ * the trigger address as soon as it goes past the trigger wait. Once
+ * ACQ_EARLY_SETTLE went by, for the samples before the trigger to be written
+ * to the memory, the pre-trigger samples requested can be read with
+ * ACQ_NAME_GET_DATA_BLOCK while the post-trigger ones are being acquired,
+ * and a smio_acq_trig_info_t frame is published on the ACQ event stream with
+ * subject ACQ_EVENT_SUBJECT_TRIG. Acquisitions with no trigger wait,
+ * multishot and ping-pong ones are only readable once completed. See
+ * ACQ_NAME_GET_TRIG_INFO */
+#define ACQ_EVENT_SUBJECT_TRIG          "ACQ_TRIG"
+#define ACQ_EARLY_SETTLE                1000    /* in usec */
+
+struct _smio_acq_trig_info_t {
+    uint64_t timestamp;             /* time the trigger was seen, as for
+                                       smio_acq_curve_info_t, or completion
+                                       time if it was not seen before. 0 if
+                                       none yet */
+    uint32_t seq;                   /* acquisition sequence number */
+    uint32_t chan;                  /* channel acquired */
+    uint32_t trig_addr;             /* trigger address. 0 if not seen yet */
+    uint32_t done;                  /* acquisition completed */
+    uint64_t size;                  /* bytes of the curve that can be read
+                                       from its start: the pre-trigger
+                                       samples requested while the post-trigger
+                                       ones are being acquired, the whole curve
+                                       once completed. 0 if none yet */
+};
+
 /* Messaging OPCODES */
 #define ACQ_OPCODE_TYPE                  uint32_t
 #define ACQ_OPCODE_SIZE                  (sizeof (ACQ_OPCODE_TYPE))
@@ -43,7 +511,75 @@ struct _smio_acq_data_block_t {
 #define ACQ_NAME_FSM_STOP               "acq_fsm_stop"
 #define ACQ_OPCODE_HW_DATA_TRIG_CHAN    11
 #define ACQ_NAME_HW_DATA_TRIG_CHAN      "acq_hw_data_trig_chan"
-#define ACQ_OPCODE_END                  12
+#define ACQ_OPCODE_GET_DATA_BLOCK_SHM   12
+#define ACQ_NAME_GET_DATA_BLOCK_SHM     "acq_get_data_block_shm"
+#define ACQ_OPCODE_GET_CURVE_STREAM     13
+#define ACQ_NAME_GET_CURVE_STREAM       "acq_get_curve_stream"
+#define ACQ_OPCODE_GET_DATA_BLOCK_VAR   14
+#define ACQ_NAME_GET_DATA_BLOCK_VAR     "acq_get_data_block_var"
+#define ACQ_OPCODE_BLOCK_SIZE_MAX       15
+#define ACQ_NAME_BLOCK_SIZE_MAX         "acq_block_size_max"
+#define ACQ_OPCODE_GET_DATA_BLOCK_REDUCED   16
+#define ACQ_NAME_GET_DATA_BLOCK_REDUCED     "acq_get_data_block_reduced"
+#define ACQ_OPCODE_RING_START           17
+#define ACQ_NAME_RING_START             "acq_ring_start"
+#define ACQ_OPCODE_RING_STOP            18
+#define ACQ_NAME_RING_STOP              "acq_ring_stop"
+#define ACQ_OPCODE_RING_GET_DATA        19
+#define ACQ_NAME_RING_GET_DATA          "acq_ring_get_data"
+#define ACQ_OPCODE_DATA_ACQUIRE_MULTI   20
+#define ACQ_NAME_DATA_ACQUIRE_MULTI     "acq_data_acquire_multi"
+#define ACQ_OPCODE_GET_DATA_BLOCK_MULTI 21
+#define ACQ_NAME_GET_DATA_BLOCK_MULTI   "acq_get_data_block_multi"
+#define ACQ_OPCODE_GET_CURVE_INFO       22
+#define ACQ_NAME_GET_CURVE_INFO         "acq_get_curve_info"
+#define ACQ_OPCODE_GET_TRIG_LOG         23
+#define ACQ_NAME_GET_TRIG_LOG           "acq_get_trig_log"
+#define ACQ_OPCODE_GET_SHOT_INDEX       24
+#define ACQ_NAME_GET_SHOT_INDEX         "acq_get_shot_index"
+#define ACQ_OPCODE_GET_SHOT_BLOCK       25
+#define ACQ_NAME_GET_SHOT_BLOCK         "acq_get_shot_block"
+#define ACQ_OPCODE_GET_DATA_BLOCK_CODED 26
+#define ACQ_NAME_GET_DATA_BLOCK_CODED   "acq_get_data_block_coded"
+#define ACQ_OPCODE_GET_DIRECT_ENDP      27
+#define ACQ_NAME_GET_DIRECT_ENDP        "acq_get_direct_endp"
+#define ACQ_OPCODE_GET_CURVE_DIRECT     28
+#define ACQ_NAME_GET_CURVE_DIRECT       "acq_get_curve_direct"
+#define ACQ_OPCODE_GET_CHAN_MAP         29
+#define ACQ_NAME_GET_CHAN_MAP           "acq_get_chan_map"
+#define ACQ_OPCODE_ACQUIRE_CURVE        30
+#define ACQ_NAME_ACQUIRE_CURVE          "acq_acquire_curve"
+#define ACQ_OPCODE_QUEUE_START          31
+#define ACQ_NAME_QUEUE_START            "acq_queue_start"
+#define ACQ_OPCODE_QUEUE_STOP           32
+#define ACQ_NAME_QUEUE_STOP             "acq_queue_stop"
+#define ACQ_OPCODE_QUEUE_GET_INFO       33
+#define ACQ_NAME_QUEUE_GET_INFO         "acq_queue_get_info"
+#define ACQ_OPCODE_QUEUE_GET_BLOCK      34
+#define ACQ_NAME_QUEUE_GET_BLOCK        "acq_queue_get_block"
+#define ACQ_OPCODE_CFG_PINGPONG         35
+#define ACQ_NAME_CFG_PINGPONG           "acq_cfg_pingpong"
+#define ACQ_OPCODE_GET_DATA_BLOCK_CRC   36
+#define ACQ_NAME_GET_DATA_BLOCK_CRC     "acq_get_data_block_crc"
+#define ACQ_OPCODE_GET_CURVE_STATS      37
+#define ACQ_NAME_GET_CURVE_STATS        "acq_get_curve_stats"
+#define ACQ_OPCODE_CFG_PM               38
+#define ACQ_NAME_CFG_PM                 "acq_cfg_pm"
+#define ACQ_OPCODE_GET_PM_INFO          39
+#define ACQ_NAME_GET_PM_INFO            "acq_get_pm_info"
+#define ACQ_OPCODE_GET_RANGE            40
+#define ACQ_NAME_GET_RANGE              "acq_get_range"
+#define ACQ_OPCODE_GET_ENVELOPE         41
+#define ACQ_NAME_GET_ENVELOPE           "acq_get_envelope"
+#define ACQ_OPCODE_CFG_PARTITION        42
+#define ACQ_NAME_CFG_PARTITION          "acq_cfg_partition"
+#define ACQ_OPCODE_CFG_PSTREAM          43
+#define ACQ_NAME_CFG_PSTREAM            "acq_cfg_pstream"
+#define ACQ_OPCODE_CFG_MCAST            44
+#define ACQ_NAME_CFG_MCAST              "acq_cfg_mcast"
+#define ACQ_OPCODE_GET_TRIG_INFO        45
+#define ACQ_NAME_GET_TRIG_INFO          "acq_get_trig_info"
+#define ACQ_OPCODE_END                  46
 
 /* Messaging Reply OPCODES */
 #define ACQ_REPLY_TYPE                  uint32_t
@@ -57,6 +593,28 @@ struct _smio_acq_data_block_t {
 #define ACQ_NUM_CHAN_OOR                5   /* Channel number out of range */
 #define ACQ_COULD_NOT_READ              6   /* Could not read memory block */
 #define ACQ_TRIG_TYPE                   7   /* Incompatible trigger type */
-#define ACQ_REPLY_END                   8   /* End marker */
+#define ACQ_SHM_UNAVAILABLE             8   /* Shared memory region could not be set up */
+#define ACQ_BLOCK_SIZE_OOR              9   /* Block size out of range */
+#define ACQ_REDUCE_INV                  10  /* Invalid atom mask or decimation factor */
+#define ACQ_RING_INACTIVE               11  /* No continuous acquisition data available */
+#define ACQ_RING_ACTIVE                 12  /* Continuous acquisition in progress */
+#define ACQ_CHAN_OVERLAP                13  /* Channels share the same memory */
+#define ACQ_SHOT_OOR                    14  /* Shot number out of range */
+#define ACQ_CODEC_INV                   15  /* Invalid codec */
+#define ACQ_DIRECT_UNAVAILABLE          16  /* Direct data path could not be set up */
+#define ACQ_PEER_UNREACH                17  /* Client is not connected to the direct
+                                               data path (yet) */
+#define ACQ_QUEUE_OOR                   18  /* Queued acquisition out of range */
+#define ACQ_QUEUE_ACTIVE                19  /* Acquisition queue in progress */
+#define ACQ_STATS_INV                   20  /* Invalid statistics flags or channel
+                                               sample size */
+#define ACQ_PM_UNAVAILABLE              21  /* Post-mortem recorder could not be set up */
+#define ACQ_ENV_INV                     22  /* Invalid envelope range, bucket count
+                                               or flags */
+#define ACQ_PART_INV                    23  /* Invalid memory partition */
+#define ACQ_PART_BUSY                   24  /* Acquisition in progress, memory cannot
+                                               be repartitioned */
+#define ACQ_PSTREAM_INV                 25  /* Invalid position stream capacity */
+#define ACQ_REPLY_END                   26  /* End marker */
 
 #endif
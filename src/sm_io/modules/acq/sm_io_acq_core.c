@@ -5,9 +5,20 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
 #include "bpm_server.h"
 /* Private headers */
 #include "ddr3_map.h"
+#include "sm_io_acq_codes.h"
+#include "sm_io_acq_reduce.h"
+#include "sm_io_acq_stats.h"
+#include "sm_io_acq_env.h"
+#include "sm_io_acq_cache.h"
+#include "sm_io_acq_rec.h"
+#include "sm_io_acq_pstream.h"
 #include "sm_io_acq_core.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
@@ -41,26 +52,70 @@ smio_acq_t * smio_acq_new (smio_t *parent, uint32_t num_samples_pre,
     ASSERT_ALLOC(self, err_self_alloc);
     uint32_t inst_id = smio_get_inst_id (parent);
 
-    self->acq_buf = __acq_buf[inst_id];
+    /* initilize acquisition buffer areas. Defined in ddr3_map.h */
+    if (inst_id > NUM_ACQ_CORE_SMIOS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq_core] Instance ID invalid\n");
+        goto err_inst_id;
+    }
+
+    memcpy (self->acq_buf, __acq_buf[inst_id], sizeof (self->acq_buf));
+    /* The channel regions of ddr3_map.h are laid out one after the other */
+    self->mem_start = self->acq_buf[0].start_addr;
+    self->mem_end = self->acq_buf[0].start_addr;
+    for (uint32_t i = 0; i < END_CHAN_ID; i++) {
+        uint32_t end = self->acq_buf[i].end_addr +
+            ((self->acq_buf[i].max_samples > 0) ? self->acq_buf[i].sample_size : 0);
+        self->mem_start = (self->acq_buf[i].start_addr < self->mem_start) ?
+            self->acq_buf[i].start_addr : self->mem_start;
+        self->mem_end = (end > self->mem_end) ? end : self->mem_end;
+    }
     self->curr_chan = 0;
+    self->block_size_max = ACQ_BLOCK_SIZE_MAX;
+    self->reduce_ops = smio_acq_reduce_get_ops ();
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq_core] Using %s data "
+            "reduction kernels\n", self->reduce_ops->name);
+    self->stats_ops = smio_acq_stats_get_ops ();
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq_core] Using %s curve "
+            "statistics kernels\n", self->stats_ops->name);
+    self->acq_pending = false;
+
+    /* Curves read are kept for the other clients, unless disabled */
+    const char *cache_size_env = getenv (ACQ_CACHE_ENV_SIZE_MAX);
+    size_t cache_size_max = (cache_size_env != NULL) ?
+        strtoul (cache_size_env, NULL, 0) : ACQ_CACHE_SIZE_MAX_DFLT;
+    if (cache_size_max > 0) {
+        self->cache = smio_acq_cache_new (END_CHAN_ID, cache_size_max << 20);
+        if (self->cache == NULL) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq_core] Could not "
+                    "create the acquisition cache. Curves will not be cached\n");
+        }
+    }
+
+    self->shm_fd = -1;
+    self->shm_buf = NULL;
+    self->shm_size = 0;
+
+    self->direct_sock = NULL;
+    self->direct_endp[0] = '\0';
 
     /* Set default value for all channels */
     for (uint32_t i = 0; i < END_CHAN_ID; i++) {
         self->acq_params[i].num_samples_pre = num_samples_pre;
         self->acq_params[i].num_samples_post = num_samples_post;
         self->acq_params[i].num_shots = num_shots;
+        self->acq_params[i].num_samples_pre_req = num_samples_pre;
+        self->acq_params[i].num_samples_post_req = num_samples_post;
         /* Default trigger address is the beggining of the channel address */
         self->acq_params[i].trig_addr = self->acq_buf[i].start_addr;
-    }
-
-    /* initilize acquisition buffer areas. Defined in ddr3_map.h */
-    if (inst_id > NUM_ACQ_CORE_SMIOS-1) {
-        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq_core] Instance ID invalid\n");
-        return NULL;
+        self->acq_params[i].seq = 0;
+        self->acq_params[i].timestamp = 0;
+        self->acq_params[i].half = ACQ_MEM_WHOLE;
     }
 
     return self;
 
+err_inst_id:
+    free (self);
 err_self_alloc:
     return NULL;
 }
@@ -73,7 +128,23 @@ smio_err_e smio_acq_destroy (smio_acq_t **self_p)
     if (*self_p) {
         smio_acq_t *self = *self_p;
 
-        self->acq_buf = NULL;
+        /* The worker is gone by now, so the request is not replied to */
+        msg_deferred_destroy (&self->capture.reply);
+        free (self->capture.peer);
+        smio_acq_direct_close (self);
+        smio_acq_shm_close (self);
+        free (self->ring.seg_addr);
+        free (self->queue.entries);
+        smio_acq_cache_destroy (&self->cache);
+        /* The curve being recorded is incomplete */
+        if (self->pm.active) {
+            smio_acq_rec_close (self->pm.rec, true);
+        }
+        smio_acq_rec_destroy (&self->pm.rec);
+        free (self->codec_buf);
+        free (self->stats_buf);
+        smio_acq_pyr_destroy (&self->pyr);
+        smio_acq_pstream_destroy (&self->pstream);
         free (self);
         *self_p = NULL;
     }
@@ -81,3 +152,163 @@ smio_err_e smio_acq_destroy (smio_acq_t **self_p)
     return SMIO_SUCCESS;
 }
 
+
+/* Creates the shared memory region large enough to hold the biggest
+ * channel. Block N of a channel is always placed at N*BLOCK_SIZE, so
+ * a whole curve is contiguous in the region */
+smio_err_e smio_acq_shm_open (smio_acq_t *self, const char *service)
+{
+    assert (self);
+    assert (service);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    /* Already mapped */
+    if (self->shm_buf != NULL) {
+        goto err_shm_mapped;
+    }
+
+    size_t shm_size = 0;
+    for (uint32_t i = 0; i < END_CHAN_ID; i++) {
+        size_t chan_size = self->acq_buf[i].end_addr - self->acq_buf[i].start_addr +
+            self->acq_buf[i].sample_size;
+        shm_size = (chan_size > shm_size) ? chan_size : shm_size;
+    }
+    /* Round up to a multiple of BLOCK_SIZE */
+    shm_size = ((shm_size + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE;
+
+    int rc = snprintf (self->shm_name, sizeof (self->shm_name), "%s%s",
+            ACQ_SHM_NAME_PREFIX, service);
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (self->shm_name),
+            "Shared memory name is too long", err_shm_name, SMIO_ERR_ALLOC);
+
+    self->shm_fd = shm_open (self->shm_name, O_CREAT | O_RDWR, 0644);
+    ASSERT_TEST(self->shm_fd >= 0, "Could not open shared memory object",
+            err_shm_open, SMIO_ERR_ALLOC);
+
+    rc = ftruncate (self->shm_fd, shm_size);
+    ASSERT_TEST(rc == 0, "Could not set shared memory size", err_shm_truncate,
+            SMIO_ERR_ALLOC);
+
+    void *shm_buf = mmap (NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            self->shm_fd, 0);
+    ASSERT_TEST(shm_buf != MAP_FAILED, "Could not map shared memory region",
+            err_shm_mmap, SMIO_ERR_ALLOC);
+
+    /* Back the region with huge pages if shmem allows it. This is only a
+     * hint, so don't bother if it fails */
+    madvise (shm_buf, shm_size, MADV_HUGEPAGE);
+
+    self->shm_buf = (uint8_t *) shm_buf;
+    self->shm_size = shm_size;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_acq_core] Shared memory region "
+            "%s with %zu bytes created\n", self->shm_name, self->shm_size);
+
+    return err;
+
+err_shm_mmap:
+err_shm_truncate:
+    close (self->shm_fd);
+    self->shm_fd = -1;
+    shm_unlink (self->shm_name);
+err_shm_open:
+err_shm_name:
+    self->shm_name[0] = '\0';
+err_shm_mapped:
+    return err;
+}
+
+smio_err_e smio_acq_shm_close (smio_acq_t *self)
+{
+    assert (self);
+
+    if (self->shm_buf != NULL) {
+        munmap (self->shm_buf, self->shm_size);
+        self->shm_buf = NULL;
+        self->shm_size = 0;
+    }
+
+    if (self->shm_fd >= 0) {
+        close (self->shm_fd);
+        self->shm_fd = -1;
+        shm_unlink (self->shm_name);
+        self->shm_name[0] = '\0';
+    }
+
+    return SMIO_SUCCESS;
+}
+
+/* Creates the ROUTER socket of the direct data path. Sends to clients that
+ * are not connected fail, instead of being silently dropped, so they can
+ * be told to retry */
+smio_err_e smio_acq_direct_open (smio_acq_t *self)
+{
+    assert (self);
+    smio_err_e err = SMIO_SUCCESS;
+
+    /* Already bound */
+    if (self->direct_sock != NULL) {
+        goto err_direct_bound;
+    }
+
+    const char *bind_env = getenv (ACQ_DIRECT_ENV_BIND);
+    const char *bind_endp = (bind_env != NULL) ? bind_env : ACQ_DIRECT_BIND_DFLT;
+
+    self->direct_sock = zsock_new (ZMQ_ROUTER);
+    ASSERT_TEST(self->direct_sock != NULL, "Could not create direct data path "
+            "socket", err_sock_alloc, SMIO_ERR_ALLOC);
+    zsock_set_router_mandatory (self->direct_sock, 1);
+    hutils_set_sock_bufs (self->direct_sock);
+
+    int port = zsock_bind (self->direct_sock, "%s", bind_endp);
+    ASSERT_TEST(port >= 0, "Could not bind direct data path socket",
+            err_sock_bind, SMIO_ERR_ALLOC);
+
+    int rc = 0;
+    const char *port_sep = strrchr (bind_endp, ':');
+    if (strncmp (bind_endp, "tcp://", 6) == 0 && port_sep != NULL) {
+        /* Clients can't connect to a wildcard host */
+        const char *host = bind_endp + 6;
+        int host_len = (int) (port_sep - host);
+        char *hostname = NULL;
+        if (host_len == 1 && *host == '*') {
+            hostname = zsys_hostname ();
+            ASSERT_TEST(hostname != NULL, "Could not get the host name",
+                    err_sock_bind, SMIO_ERR_ALLOC);
+            host = hostname;
+            host_len = (int) strlen (hostname);
+        }
+        rc = snprintf (self->direct_endp, sizeof (self->direct_endp),
+                "tcp://%.*s:%d", host_len, host, port);
+        free (hostname);
+    }
+    else {
+        rc = snprintf (self->direct_endp, sizeof (self->direct_endp), "%s",
+                bind_endp);
+    }
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (self->direct_endp),
+            "Direct data path endpoint is too long", err_endp, SMIO_ERR_ALLOC);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_acq_core] Direct data path "
+            "bound to %s\n", self->direct_endp);
+    return err;
+
+err_endp:
+    self->direct_endp[0] = '\0';
+err_sock_bind:
+    zsock_destroy (&self->direct_sock);
+err_sock_alloc:
+err_direct_bound:
+    return err;
+}
+
+smio_err_e smio_acq_direct_close (smio_acq_t *self)
+{
+    assert (self);
+
+    zsock_destroy (&self->direct_sock);
+    self->direct_endp[0] = '\0';
+
+    return SMIO_SUCCESS;
+}
@@ -26,19 +26,224 @@ typedef enum {
 
 #define ACQ_CORE_NUM_TRIGGERS               TYPE_ACQ_CORE_END
 
+/* Where the curve of an acquisition is in the channel memory. It wraps
+ * around the end of it at most once, so it takes two extents at most */
+#define ACQ_PLAN_MAX_EXTENTS                2
+
+/* The ACQ core acquires more samples than requested, to keep them aligned.
+ * Only the ones requested are read: shot_size bytes at shot_offs of every
+ * shot_stride bytes of the extents */
+typedef struct {
+    bool valid;                             /* Computed for the last acquisition */
+    uint64_t size;                          /* Curve size in bytes, as read */
+    uint32_t num_ext;                       /* Number of extents */
+    uint64_t ext_addr[ACQ_PLAN_MAX_EXTENTS];    /* Extent start address */
+    uint64_t ext_size[ACQ_PLAN_MAX_EXTENTS];    /* Extent size in bytes */
+    uint64_t shot_stride;                   /* Shot size in bytes, as acquired */
+    uint64_t shot_offs;                     /* Offset of the samples requested */
+    uint64_t shot_size;                     /* Size of the samples requested */
+} acq_plan_t;
+
+/* The acquisition used the whole channel memory, instead of one of its
+ * ping-pong halves */
+#define ACQ_MEM_WHOLE                       2
+
 typedef struct {
     uint32_t num_samples_pre;               /* Number of pre-trigger samples */
     uint32_t num_samples_post;              /* Number of post-trigger samples */
     uint32_t num_shots;                     /* Number of shots */
+    uint32_t num_samples_pre_req;           /* Number of pre-trigger samples requested,
+                                               before alignment */
+    uint32_t num_samples_post_req;          /* Number of post-trigger samples requested,
+                                               before alignment */
     /* Last trigger address. In case of multishot acquisition, this will
        contain only the last trigger address*/
     uint32_t trig_addr;
+    uint32_t seq;                           /* Sequence number of the last acquisition */
+    uint64_t timestamp;                     /* Completion time of the last acquisition,
+                                               in ns since the Epoch. 0 if not completed */
+    acq_plan_t plan;                        /* Readout plan of the last acquisition */
+    uint32_t half;                          /* Half of the channel memory of the last
+                                               acquisition, or ACQ_MEM_WHOLE */
 } acq_params_t;
 
+/* Ping-pong acquisitions of a channel. Each one fills the half of the channel
+ * memory not holding the last acquisition, so the last one can still be read
+ * meanwhile. The new one replaces it once completed */
+typedef struct {
+    bool enabled;                           /* Acquisitions are ping-pong */
+    bool pending;                           /* "next" is being acquired */
+    acq_params_t next;                      /* Acquisition in progress */
+} acq_pingpong_t;
+
+/* Last completed acquisitions. Entry i%ACQ_TRIG_LOG_SIZE holds the i-th one */
+typedef struct {
+    smio_acq_curve_info_t entries[ACQ_TRIG_LOG_SIZE];
+    uint64_t count;                         /* Number of acquisitions logged */
+} acq_trig_log_t;
+
+/* Continuous acquisition state. Segment i is acquired in the window
+ * [win_start + i*seg_samples*sample_size, win_start + (i+1)*seg_samples*sample_size) */
+typedef struct {
+    bool active;                            /* Segments are being acquired */
+    uint32_t chan;                          /* Channel being acquired */
+    uint32_t seg_samples;                   /* Number of samples per segment */
+    uint32_t num_segs;                      /* Number of segments */
+    uint64_t win_start;                     /* Address of the first segment window */
+    uint64_t *seg_addr;                     /* Address of the first sample of each
+                                               segment, inside its window */
+    uint64_t head;                          /* Number of samples acquired (producer pointer) */
+} acq_ring_t;
+
+/* Multi-channel acquisition state */
+typedef struct {
+    uint32_t chan_mask;                     /* Channels requested. 0 if this is
+                                               not a multi-channel acquisition */
+    uint32_t pending_mask;                  /* Channels not started yet */
+    uint32_t num_samples_pre;               /* Parameters shared by the channels */
+    uint32_t num_samples_post;
+    uint32_t num_shots;
+} acq_multi_t;
+
+/* Acquisition of the queue that is done */
+typedef struct {
+    uint32_t seq;                           /* Sequence number */
+    uint32_t trig_addr;                     /* Trigger address */
+    uint64_t timestamp;                     /* Completion time, in ns since the Epoch */
+} acq_queue_entry_t;
+
+/* Acquisition queue state. Acquisition i is done in the slot
+ * [slot_start + i*slot_size, slot_start + (i+1)*slot_size) */
+typedef struct {
+    bool active;                            /* Acquisitions are being done */
+    uint32_t chan;                          /* Channel being acquired */
+    uint32_t num_acqs;                      /* Number of acquisitions */
+    uint32_t num_done;                      /* Number of acquisitions done */
+    uint32_t num_samples_pre;               /* Parameters shared by the acquisitions, */
+    uint32_t num_samples_post;              /* after alignment */
+    uint32_t num_shots;
+    uint64_t slot_start;                    /* Address of the first slot */
+    uint64_t slot_size;                     /* Slot and curve size in bytes */
+    acq_queue_entry_t *entries;             /* Acquisitions done */
+} acq_queue_t;
+
+/* Acquisition served from start to end by a single request, see
+ * ACQ_NAME_ACQUIRE_CURVE */
+typedef struct {
+    msg_deferred_t *reply;                  /* Reply to the request. NULL if there
+                                               is no such acquisition */
+    char *peer;                             /* Address the blocks are pushed to */
+    uint32_t chan;                          /* Channel acquired */
+    int64_t deadline;                       /* Acquisition timeout, in msec of
+                                               zclock_mono (). -1 if none */
+    uint32_t next_block;                    /* Next block to push */
+} acq_capture_t;
+
+/* Post-mortem recorder state, see ACQ_NAME_CFG_PM */
+typedef struct {
+    smio_acq_rec_t *rec;                    /* Recorder. Only created when first
+                                               armed */
+    uint32_t chan_mask;                     /* Channels recorded */
+    uint32_t pending_mask;                  /* Channels waiting to be recorded */
+    uint32_t num_dropped;                   /* Curves overwritten before being
+                                               recorded */
+    bool active;                            /* A curve is being recorded */
+    uint32_t half;                          /* Memory half of the curve being
+                                               recorded */
+    acq_plan_t plan;                        /* Readout plan of the curve being
+                                               recorded */
+    uint64_t offs;                          /* Bytes of it read so far */
+    smio_acq_curve_info_t curve;            /* Curve being recorded */
+    smio_acq_curve_info_t last;             /* Last curve recorded */
+} acq_pm_t;
+
+/* Acquisition multicast state, see ACQ_NAME_CFG_MCAST */
+typedef struct {
+    uint32_t chan_mask;                     /* Channels published */
+    uint32_t pending_mask;                  /* Channels waiting to be published */
+    uint32_t num_dropped;                   /* Curves overwritten before being
+                                               fully published */
+    bool active;                            /* A curve is being published */
+    uint32_t half;                          /* Memory half of the curve being
+                                               published */
+    acq_plan_t plan;                        /* Readout plan of the curve being
+                                               published */
+    uint64_t offs;                          /* Bytes of it published so far */
+    smio_acq_curve_info_t curve;            /* Curve being published */
+} acq_mcast_t;
+
+/* Early delivery of the pre-trigger data of the acquisition in progress,
+ * see ACQ_EVENT_SUBJECT_TRIG */
+typedef struct {
+    bool enabled;                           /* Trigger is watched for */
+    int64_t seen;                           /* Time it was seen, in usec of
+                                               zclock_usecs. 0 if not yet */
+    smio_acq_trig_info_t info;              /* Of the last acquisition started */
+} acq_early_t;
+
+/* Completion prediction of the acquisition in progress, see
+ * ACQ_PREDICT_GUARD. Only acquisitions with no trigger wait are predicted,
+ * as nothing tells when a trigger comes */
+typedef struct {
+    uint64_t sample_ps[END_CHAN_ID];        /* Acquisition time per sample of each
+                                               channel, in ps. 0 until learned */
+    bool learn;                             /* Acquisition in progress has no
+                                               trigger wait */
+    int64_t start;                          /* Its start, in usec of zclock_usecs */
+    uint64_t num_samples;                   /* Its number of samples. 0 once done */
+    int64_t wake;                           /* Its status is not read before this,
+                                               in usec of zclock_usecs. 0 if not
+                                               predicted */
+    uint32_t num_checks;                    /* Status reads since "wake" */
+    bool asleep;                            /* Poll interval was stretched up to
+                                               "wake" */
+} acq_predict_t;
+
 typedef struct {
     acq_params_t acq_params[END_CHAN_ID];   /* Parameters for each channel */
+    acq_pingpong_t pingpong[END_CHAN_ID];   /* Ping-pong state for each channel */
     uint32_t curr_chan;                     /* Current channel being acquired */
-    const acq_buf_t *acq_buf;               /* Channel properties */
+    acq_buf_t acq_buf[END_CHAN_ID];         /* Channel properties. Regions start
+                                               as in ddr3_map.h and can be changed
+                                               with ACQ_NAME_CFG_PARTITION */
+    uint32_t mem_start;                     /* DDR3 span of the ACQ core, split */
+    uint32_t mem_end;                       /* among the channels. End is exclusive */
+    uint32_t block_size_max;                /* Maximum block size a client can negotiate */
+    const smio_acq_reduce_ops_t *reduce_ops;    /* Data reduction kernels */
+    const smio_acq_stats_ops_t *stats_ops;      /* Curve statistics kernels */
+    acq_ring_t ring;                        /* Continuous acquisition */
+    acq_multi_t multi;                      /* Multi-channel acquisition */
+    acq_capture_t capture;                  /* Single request acquisition */
+    acq_queue_t queue;                      /* Acquisition queue */
+    acq_trig_log_t trig_log;                /* Completed acquisitions */
+    acq_pm_t pm;                            /* Post-mortem recorder */
+    acq_mcast_t mcast;                      /* Acquisition multicast */
+    smio_acq_cache_t *cache;                /* Curves already read. NULL if disabled */
+    uint8_t *codec_buf;                     /* Raw blocks being encoded. Only allocated
+                                               on the first coded block request */
+    uint8_t *stats_buf;                     /* Curve chunks statistics are computed
+                                               on. Only allocated on the first
+                                               statistics request */
+    smio_acq_pyr_t *pyr;                    /* Envelope pyramid of the last curve
+                                               asked for. NULL until the first
+                                               pyramid envelope request */
+    uint32_t pstream_capacity;              /* Position stream capacity, in samples.
+                                               0 if disabled */
+    smio_acq_pstream_t *pstream;            /* Position stream of the continuous
+                                               acquisition. NULL if not running */
+    bool acq_pending;                       /* Acquisition started, but its completion
+                                               was not published yet */
+    acq_predict_t predict;                  /* Completion prediction */
+    acq_early_t early;                      /* Early pre-trigger data */
+    /* Shared memory region for local clients. Only created on the first
+     * request for a shared memory transfer */
+    char shm_name[ACQ_SHM_NAME_MAX_LEN];    /* Shared memory object name */
+    int shm_fd;                             /* Shared memory file descriptor */
+    uint8_t *shm_buf;                       /* Mapped shared memory region */
+    size_t shm_size;                        /* Shared memory region size in bytes */
+    /* Direct data path. Only set up on the first request for it */
+    zsock_t *direct_sock;                   /* ROUTER socket blocks are pushed through */
+    char direct_endp[ACQ_DIRECT_ENDP_MAX_LEN];  /* Endpoint advertised to clients */
 } smio_acq_t;
 
 /***************** Our methods *****************/
@@ -48,5 +253,13 @@ smio_acq_t * smio_acq_new (smio_t *parent, uint32_t num_samples_pre,
         uint32_t num_samples_post, uint32_t num_shots);
 /* Destroys the smio realizationn */
 smio_err_e smio_acq_destroy (smio_acq_t **self_p);
+/* Creates and maps the shared memory region, if not done already */
+smio_err_e smio_acq_shm_open (smio_acq_t *self, const char *service);
+/* Unmaps and removes the shared memory region */
+smio_err_e smio_acq_shm_close (smio_acq_t *self);
+/* Creates and binds the direct data path socket, if not done already */
+smio_err_e smio_acq_direct_open (smio_acq_t *self);
+/* Closes the direct data path socket */
+smio_err_e smio_acq_direct_close (smio_acq_t *self);
 
 #endif
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Acquisition envelopes. A range of the curve is split in buckets, and the
+ * minimum, maximum and mean of each atom of every bucket are computed with
+ * the statistics kernels, so plotting a long curve takes a few kB. The
+ * envelope pyramid of the last curve asked for can be kept, so zooming
+ * around it does not read the curve again */
+
+#include "bpm_server.h"
+/* Private headers */
+#include "sm_io_acq_codes.h"
+#include "sm_io_acq_stats.h"
+#include "sm_io_acq_env.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io:acq_env]",     \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)   \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io:acq_env]",             \
+            smio_err_str(SMIO_ERR_ALLOC),                       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io:acq_env]",                \
+            smio_err_str (err_type))
+
+/* Level i has num_cells [i] cells of cell_samples [i] samples, the last one
+ * possibly shorter */
+struct _smio_acq_pyr_t {
+    uint32_t chan;                  /* Channel of the curve */
+    uint32_t seq;                   /* Sequence number of the curve */
+    uint64_t num_samples;           /* Samples of the curve */
+    uint32_t num_levels;            /* Number of levels */
+    uint64_t cell_samples [ACQ_ENV_PYR_MAX_LEVELS];
+    uint64_t num_cells [ACQ_ENV_PYR_MAX_LEVELS];
+    /* ACQ_REDUCE_NUM_ATOMS accumulators per cell */
+    smio_acq_stats_acc_t *cells [ACQ_ENV_PYR_MAX_LEVELS];
+};
+
+static void _acq_env_merge (smio_acq_stats_acc_t *dst,
+        const smio_acq_stats_acc_t *src);
+
+int smio_acq_env_accumulate (const smio_acq_stats_ops_t *ops,
+        smio_acq_stats_acc_t *acc, uint64_t cell_samples, uint64_t pos,
+        const uint8_t *data, size_t size, uint32_t sample_size)
+{
+    assert (ops);
+    assert (acc);
+    assert (data);
+    assert (cell_samples > 0);
+
+    size_t num_samples = size / sample_size;
+
+    /* One kernel call per cell the data spans */
+    while (num_samples > 0) {
+        uint64_t cell = pos / cell_samples;
+        size_t n = cell_samples - pos % cell_samples;
+        n = (n > num_samples) ? num_samples : n;
+
+        int err = smio_acq_stats_accumulate (ops, acc + cell*ACQ_REDUCE_NUM_ATOMS,
+                data, n * sample_size, sample_size);
+        if (err != 0) {
+            return err;
+        }
+
+        pos += n;
+        data += n * sample_size;
+        num_samples -= n;
+    }
+
+    return 0;
+}
+
+void smio_acq_env_finish (const smio_acq_stats_acc_t *acc,
+        smio_acq_env_bucket_t *bucket)
+{
+    assert (acc);
+    assert (bucket);
+
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+        if (acc [a].num == 0) {
+            bucket->min [a] = 0;
+            bucket->max [a] = 0;
+            bucket->mean [a] = 0;
+            continue;
+        }
+
+        bucket->min [a] = (int32_t) acc [a].min;
+        bucket->max [a] = (int32_t) acc [a].max;
+        bucket->mean [a] = (float) ((double) acc [a].sum / (double) acc [a].num);
+    }
+}
+
+smio_acq_pyr_t *smio_acq_pyr_new (uint32_t chan, uint32_t seq,
+        uint64_t num_samples)
+{
+    assert (num_samples > 0);
+
+    smio_acq_pyr_t *self = (smio_acq_pyr_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+    self->chan = chan;
+    self->seq = seq;
+    self->num_samples = num_samples;
+
+    /* The first level is kept within ACQ_ENV_PYR_MAX_CELLS cells */
+    uint64_t cell_samples = ACQ_ENV_PYR_CELL_SAMPLES;
+    while (num_samples / cell_samples >= ACQ_ENV_PYR_MAX_CELLS) {
+        cell_samples *= ACQ_ENV_PYR_FACTOR;
+    }
+
+    /* Up to a level of a single cell */
+    for (uint32_t l = 0; l < ACQ_ENV_PYR_MAX_LEVELS; ++l) {
+        uint64_t num_cells = (num_samples + cell_samples - 1) / cell_samples;
+        self->cell_samples [l] = cell_samples;
+        self->num_cells [l] = num_cells;
+        self->cells [l] = (smio_acq_stats_acc_t *) malloc (num_cells *
+                ACQ_REDUCE_NUM_ATOMS * sizeof (smio_acq_stats_acc_t));
+        ASSERT_ALLOC(self->cells [l], err_cells_alloc);
+        self->num_levels++;
+
+        for (uint64_t c = 0; c < num_cells; ++c) {
+            smio_acq_stats_init (self->cells [l] + c*ACQ_REDUCE_NUM_ATOMS);
+        }
+
+        if (num_cells == 1) {
+            break;
+        }
+        cell_samples *= ACQ_ENV_PYR_FACTOR;
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq_env] Pyramid of %u levels "
+            "for %"PRIu64" samples of channel %u, cells of %"PRIu64" samples\n",
+            self->num_levels, num_samples, chan, self->cell_samples [0]);
+
+    return self;
+
+err_cells_alloc:
+    smio_acq_pyr_destroy (&self);
+err_self_alloc:
+    return NULL;
+}
+
+void smio_acq_pyr_destroy (smio_acq_pyr_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_acq_pyr_t *self = *self_p;
+
+        for (uint32_t l = 0; l < self->num_levels; ++l) {
+            free (self->cells [l]);
+        }
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+bool smio_acq_pyr_match (const smio_acq_pyr_t *self, uint32_t chan,
+        uint32_t seq)
+{
+    return self != NULL && self->chan == chan && self->seq == seq;
+}
+
+uint64_t smio_acq_pyr_cell_samples (const smio_acq_pyr_t *self)
+{
+    assert (self);
+    return self->cell_samples [0];
+}
+
+int smio_acq_pyr_accumulate (smio_acq_pyr_t *self,
+        const smio_acq_stats_ops_t *ops, uint64_t pos, const uint8_t *data,
+        size_t size, uint32_t sample_size)
+{
+    assert (self);
+    return smio_acq_env_accumulate (ops, self->cells [0], self->cell_samples [0],
+            pos, data, size, sample_size);
+}
+
+void smio_acq_pyr_build (smio_acq_pyr_t *self)
+{
+    assert (self);
+
+    for (uint32_t l = 1; l < self->num_levels; ++l) {
+        const smio_acq_stats_acc_t *src = self->cells [l-1];
+        for (uint64_t c = 0; c < self->num_cells [l-1]; ++c) {
+            _acq_env_merge (self->cells [l] + (c / ACQ_ENV_PYR_FACTOR) *
+                    ACQ_REDUCE_NUM_ATOMS, src + c*ACQ_REDUCE_NUM_ATOMS);
+        }
+    }
+}
+
+void smio_acq_pyr_query (const smio_acq_pyr_t *self, uint64_t start,
+        uint64_t num_samples, smio_acq_stats_acc_t *acc)
+{
+    assert (self);
+    assert (acc);
+
+    uint32_t l = 0;
+    while (l + 1 < self->num_levels && self->cell_samples [l+1] <= num_samples) {
+        ++l;
+    }
+
+    uint64_t cell_samples = self->cell_samples [l];
+    uint64_t first = start / cell_samples;
+    uint64_t last = (start + num_samples + cell_samples - 1) / cell_samples;
+    last = (last > self->num_cells [l]) ? self->num_cells [l] : last;
+
+    for (uint64_t c = first; c < last; ++c) {
+        _acq_env_merge (acc, self->cells [l] + c*ACQ_REDUCE_NUM_ATOMS);
+    }
+}
+
+/**************** Helper Functions ***************/
+
+static void _acq_env_merge (smio_acq_stats_acc_t *dst,
+        const smio_acq_stats_acc_t *src)
+{
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+        dst [a].num += src [a].num;
+        dst [a].min = (src [a].min < dst [a].min) ? src [a].min : dst [a].min;
+        dst [a].max = (src [a].max > dst [a].max) ? src [a].max : dst [a].max;
+        dst [a].sum += src [a].sum;
+        dst [a].sum_sq += src [a].sum_sq;
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+*/
+
+#ifndef _SM_IO_ACQ_ENV_H_
+#define _SM_IO_ACQ_ENV_H_
+
+/* Cells of the first level of the pyramid are at least this many samples
+ * large, and larger for curves that would take more than
+ * ACQ_ENV_PYR_MAX_CELLS of them. Each level has cells ACQ_ENV_PYR_FACTOR
+ * times larger than the one below */
+#define ACQ_ENV_PYR_CELL_SAMPLES        1024
+#define ACQ_ENV_PYR_MAX_CELLS           (1 << 16)
+#define ACQ_ENV_PYR_FACTOR              8
+#define ACQ_ENV_PYR_MAX_LEVELS          8
+
+typedef struct _smio_acq_pyr_t smio_acq_pyr_t;
+
+/***************** Our methods *****************/
+
+/* Accumulate "size" bytes of "sample_size" samples, which start at sample
+ * "pos" of the range, into cells of "cell_samples" samples. "acc" holds
+ * ACQ_REDUCE_NUM_ATOMS accumulators per cell, cell i covering samples
+ * [i*cell_samples, (i+1)*cell_samples) of the range. Returns 0 if ok or -1
+ * if the sample size is not supported */
+int smio_acq_env_accumulate (const smio_acq_stats_ops_t *ops,
+        smio_acq_stats_acc_t *acc, uint64_t cell_samples, uint64_t pos,
+        const uint8_t *data, size_t size, uint32_t sample_size);
+/* Fill "bucket" from the ACQ_REDUCE_NUM_ATOMS accumulators "acc" */
+void smio_acq_env_finish (const smio_acq_stats_acc_t *acc,
+        smio_acq_env_bucket_t *bucket);
+
+/* Creates an empty pyramid for the "num_samples" samples of the curve
+ * acquired with sequence number "seq" on channel "chan" */
+smio_acq_pyr_t *smio_acq_pyr_new (uint32_t chan, uint32_t seq,
+        uint64_t num_samples);
+/* Destroy the pyramid */
+void smio_acq_pyr_destroy (smio_acq_pyr_t **self_p);
+/* Check if the pyramid is built for the curve acquired with sequence
+ * number "seq" on channel "chan" */
+bool smio_acq_pyr_match (const smio_acq_pyr_t *self, uint32_t chan,
+        uint32_t seq);
+/* Samples of the cells of the first level */
+uint64_t smio_acq_pyr_cell_samples (const smio_acq_pyr_t *self);
+/* Accumulate "size" bytes of the curve, from sample "pos" on, into the first
+ * level. Returns the same as smio_acq_env_accumulate () */
+int smio_acq_pyr_accumulate (smio_acq_pyr_t *self,
+        const smio_acq_stats_ops_t *ops, uint64_t pos, const uint8_t *data,
+        size_t size, uint32_t sample_size);
+/* Build the upper levels, once the whole curve was accumulated */
+void smio_acq_pyr_build (smio_acq_pyr_t *self);
+/* Merge the cells covering samples [start, start+num_samples) into the
+ * ACQ_REDUCE_NUM_ATOMS accumulators "acc". The coarsest level whose cells
+ * are not larger than the range is used, so the range is rounded out to
+ * its cells */
+void smio_acq_pyr_query (const smio_acq_pyr_t *self, uint64_t start,
+        uint64_t num_samples, smio_acq_stats_acc_t *acc);
+
+#endif
@@ -10,6 +10,12 @@
 #include "ddr3_map.h"
 #include "sm_io_acq_codes.h"
 #include "sm_io_acq_exports.h"
+#include "sm_io_acq_reduce.h"
+#include "sm_io_acq_stats.h"
+#include "sm_io_acq_env.h"
+#include "sm_io_acq_cache.h"
+#include "sm_io_acq_rec.h"
+#include "sm_io_acq_pstream.h"
 #include "sm_io_acq_core.h"
 #include "sm_io_acq_exp.h"
 #include "hw/wb_acq_core_regs.h"
@@ -55,6 +61,10 @@
 #define ACQ_CORE_COMPLETE_VALUE (ACQ_CORE_STA_FSM_STATE_W(0x1) | ACQ_CORE_STA_FSM_ACQ_DONE | \
                                     ACQ_CORE_STA_FC_TRANS_DONE | ACQ_CORE_STA_DDR3_TRANS_DONE)
 
+/* FSM states are IDLE (1), PRE_TRIG (2), WAIT_TRIG (3), POST_TRIG (4) and
+ * DECR_SHOT (5). From POST_TRIG on, the trigger came */
+#define ACQ_CORE_FSM_STATE_POST_TRIG    0x4
+
 static int _acq_check_status (SMIO_OWNER_TYPE *self, uint32_t status_mask,
         uint32_t status_value);
 static int _acq_set_trigger_type (SMIO_OWNER_TYPE *self, uint32_t trigger_type);
@@ -62,44 +72,86 @@ static int _acq_get_trigger_type (SMIO_OWNER_TYPE *self, uint32_t *trigger_type)
 static uint64_t _acq_get_start_address (uint64_t acq_core_trig_addr,
         uint64_t acq_size_bytes, uint64_t start_mem_space_addr,
         uint64_t end_mem_space_addr);
-static uint64_t _acq_get_read_block_addr (uint64_t start_addr, uint64_t offset,
-        uint64_t channel_start_addr, uint64_t end_mem_space_addr);
+static int _acq_get_block_params (smio_acq_t *acq, uint32_t chan,
+        uint32_t block_n, uint32_t block_size_max, uint64_t *block_offs,
+        uint32_t *block_size);
+static const acq_plan_t *_acq_get_plan (smio_acq_t *acq, uint32_t chan);
+static void _acq_plan_compute (smio_acq_t *acq, uint32_t chan);
+static void _acq_complete_chan (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan);
+static void _acq_status_update (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_get_curve_info_chan (smio_acq_t *acq, uint32_t chan,
+        smio_acq_curve_info_t *info);
+static void _acq_get_shot_index_chan (smio_acq_t *acq, uint32_t chan,
+        smio_acq_shot_index_t *index);
+static uint64_t _acq_get_curve_start_addr (smio_acq_t *acq, uint32_t chan);
+static ssize_t _acq_read_block (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, uint64_t block_offs, uint32_t block_size, uint8_t *data);
+static ssize_t _acq_read_block_win (SMIO_OWNER_TYPE *self,
+        uint64_t start_mem_space_addr, uint64_t end_mem_space_addr,
+        uint64_t block_addr, uint32_t block_size, uint8_t *data);
+static void _acq_ring_arm (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_multi_start_next (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_ring_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_pstream_publish (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t seg);
+static int _acq_push_blocks (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, uint32_t block_start, uint32_t num_blocks,
+        mlm_client_t *worker, zsock_t *direct_sock, const char *peer,
+        uint32_t *blocks_sent);
+static int _acq_stream_send_block (mlm_client_t *worker, zsock_t *direct_sock,
+        const char *peer, smio_acq_stream_hdr_t *hdr, zframe_t **data_frame);
+static int _acq_start_single (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t num_samples_pre, uint32_t num_samples_post, uint32_t num_shots,
+        uint32_t chan);
+static void _acq_capture_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_capture_end (smio_acq_t *acq, int ret, uint32_t blocks_sent);
+static void _acq_pm_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_pm_drop_overlap (smio_acq_t *acq, uint32_t chan, uint32_t half);
+static bool _acq_pm_busy (smio_acq_t *acq);
+static void _acq_mcast_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_early_start (smio_acq_t *acq, uint32_t chan,
+        const acq_params_t *params, bool skip_trig);
+static void _acq_early_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static bool _acq_in_progress (smio_acq_t *acq, uint32_t chan);
+static void _acq_get_trig_info_chan (smio_acq_t *acq, uint32_t chan,
+        smio_acq_trig_info_t *info);
+static void _acq_mcast_drop_overlap (smio_acq_t *acq, uint32_t chan,
+        uint32_t half);
+static void _acq_predict_start (smio_acq_t *acq, uint32_t chan,
+        uint64_t num_samples, bool skip_trig);
+static bool _acq_predict_due (acq_predict_t *predict, int64_t now);
+static void _acq_predict_sleep (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        int64_t now);
+static void _acq_predict_done (smio_acq_t *acq, uint32_t chan);
+static void _acq_program_chan (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, acq_params_t *params, uint32_t num_samples_pre,
+        uint32_t num_samples_post, uint32_t num_shots);
+static void _acq_get_region (smio_acq_t *acq, uint32_t chan, uint32_t half,
+        uint64_t *start_addr, uint64_t *end_addr);
+static void _acq_get_window (const acq_params_t *params, uint32_t *pre_req,
+        uint32_t *post_req);
+static ssize_t _acq_read_plan (SMIO_OWNER_TYPE *self, const acq_plan_t *plan,
+        uint64_t block_offs, uint32_t block_size, uint8_t *data);
+static ssize_t _acq_read_plan_ext (SMIO_OWNER_TYPE *self, const acq_plan_t *plan,
+        uint64_t block_offs, uint32_t block_size, uint8_t *data);
+static ssize_t _acq_read_plan_v (SMIO_OWNER_TYPE *self, const acq_plan_t *plan,
+        uint64_t block_offs, uint32_t block_size, uint8_t *data);
+static void _acq_queue_arm (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_queue_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq);
+static void _acq_queue_plan (smio_acq_t *acq, uint32_t index, acq_plan_t *plan);
+static void _acq_queue_get_curve_info (smio_acq_t *acq, uint32_t index,
+        smio_acq_curve_info_t *info);
 
 /************************************************************/
 /***************** Specific ACQ Operations ******************/
 /************************************************************/
 
-static int _acq_data_acquire (void *owner, void *args, void *ret)
+/* Check the parameters of an acquisition of channel "chan" */
+static int _acq_check_params (smio_acq_t *acq, uint32_t chan,
+        uint32_t num_samples_pre, uint32_t num_samples_post, uint32_t num_shots,
+        uint32_t trigger_type)
 {
-    (void) ret;
-    assert (owner);
-    assert (args);
-    int err = -ACQ_OK;
-
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
-            "Calling _acq_data_acquire\n");
-    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
-    smio_acq_t *acq = smio_get_handler (self);
-    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
-            err_get_acq_handler, -ACQ_ERR);
-
-    /* First step is to check if the FPGA is already doing an acquisition. If it
-     * is, then return an error. Otherwise proceed normally. */
-    err = _acq_check_status (self, ACQ_CORE_IDLE_MASK, ACQ_CORE_IDLE_VALUE);
-    ASSERT_TEST(err == -ACQ_OK, "Previous acquisition in progress. "
-            "New acquisition not started", err_acq_not_completed);
-
-    /* Message is:
-     * frame 0: operation code
-     * frame 1: number of pre-trigger samples
-     * frame 2: number of post-trigger samples
-     * frame 3: number of shots
-     * frame 4: channel                 */
-    uint32_t num_samples_pre = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
-    uint32_t num_samples_post = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
-    uint32_t num_shots = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
-    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
-
     /* channel required is out of the limit */
     if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
         DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] data_acquire: "
@@ -130,17 +182,35 @@ static int _acq_data_acquire (void *owner, void *args, void *ret)
         return -ACQ_NUM_SAMPLES_OOR;
     }
 
+    /* Ping-pong curves must fit in half of the channel memory */
+    const acq_buf_t *buf = &acq->acq_buf[chan];
+    uint64_t half_samples = (buf->split_addr - buf->start_addr) / buf->sample_size;
+    if (acq->pingpong[chan].enabled &&
+            (uint64_t) (num_samples_pre + num_samples_post) * num_shots > half_samples) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] data_acquire: "
+                "Number of samples required (%u) is out of the ping-pong limit "
+                "(%"PRIu64")\n", (num_samples_pre + num_samples_post) * num_shots,
+                half_samples);
+        return -ACQ_NUM_SAMPLES_OOR;
+    }
+
     /* If skip trigger is set, we must set post_trigger_samples to 0 */
-    uint32_t trigger_type = 0;
-    err = _acq_get_trigger_type (self, &trigger_type);
-    ASSERT_TEST(err == -ACQ_OK, "Could not check for trigger type",
-            err_acq_get_trig);
     if (trigger_type == TYPE_ACQ_CORE_SKIP && num_samples_post > 0) {
         DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] data_acquire: "
                 "Incompatible trigger type. Post trigger samples is greater than 0\n");
         return -ACQ_TRIG_TYPE;
     }
 
+    return -ACQ_OK;
+}
+
+/* Program the number of shots and samples of an acquisition of channel
+ * "chan". Parameters must have been checked with _acq_check_params */
+/* Program the acquisition parameters of "chan", recording them in "params" */
+static void _acq_program_chan (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, acq_params_t *params, uint32_t num_samples_pre,
+        uint32_t num_samples_post, uint32_t num_shots)
+{
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] data_acquire:\n"
             "\tCurrent acq params for channel #%u: number of pre-trigger samples = %u\n"
             "\tnumber of post-trigger samples = %u, number of shots = %u\n",
@@ -149,9 +219,8 @@ static int _acq_data_acquire (void *owner, void *args, void *ret)
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] data_acquire:\n"
             "\tPrevious acq params for channel #%u: number of pre-trigger samples = %u\n"
             "\tnumber of post-trigger samples = %u, number of shots = %u\n",
-            chan, acq->acq_params[chan].num_samples_pre,
-            acq->acq_params[chan].num_samples_post,
-            acq->acq_params[chan].num_shots);
+            chan, params->num_samples_pre, params->num_samples_post,
+            params->num_shots);
 
     /* Setting the number of shots */
     uint32_t acq_core_shots = ACQ_CORE_SHOTS_NB_W(num_shots);
@@ -160,7 +229,8 @@ static int _acq_data_acquire (void *owner, void *args, void *ret)
     smio_thsafe_client_write_32 (self, ACQ_CORE_REG_SHOTS, &acq_core_shots);
 
     /* FIXME FPGA Firmware requires number of samples to be divisible by
-     * acquisition channel sample size */
+     * acquisition channel sample size. The samples requested are kept, so
+     * only those are read back (see _acq_plan_compute) */
     uint32_t samples_alignment =
         DDR3_PAYLOAD_SIZE/acq->acq_buf[chan].sample_size;
     uint32_t num_samples_pre_aligned = num_samples_pre + samples_alignment -
@@ -170,9 +240,11 @@ static int _acq_data_acquire (void *owner, void *args, void *ret)
         (num_samples_post % samples_alignment);
 
     /* Set the parameters: number of samples of this channel */
-    acq->acq_params[chan].num_samples_pre = num_samples_pre_aligned;
-    acq->acq_params[chan].num_samples_post = num_samples_post_aligned;
-    acq->acq_params[chan].num_shots = num_shots;
+    params->num_samples_pre = num_samples_pre_aligned;
+    params->num_samples_post = num_samples_post_aligned;
+    params->num_shots = num_shots;
+    params->num_samples_pre_req = num_samples_pre;
+    params->num_samples_post_req = num_samples_post;
 
     /* Pre trigger samples */
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] data_acquire: "
@@ -185,10 +257,44 @@ static int _acq_data_acquire (void *owner, void *args, void *ret)
             "Number of post-trigger samples = %u\n",
             num_samples_post_aligned);
     smio_thsafe_client_write_32 (self, ACQ_CORE_REG_POST_SAMPLES, &num_samples_post_aligned);
+}
+
+/* Program the ACQ core for an acquisition of channel "chan" and start it.
+ * Parameters must have been checked with _acq_check_params */
+static void _acq_start_chan (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, uint32_t num_samples_pre, uint32_t num_samples_post,
+        uint32_t num_shots)
+{
+    /* Don't wait for each of the registers written. The reads of the
+     * control registers below wait for them */
+    bool posted = smio_get_posted_writes (self);
+    smio_set_posted_writes (self, true);
+
+    acq_pingpong_t *pingpong = &acq->pingpong[chan];
+    acq_params_t *params = &acq->acq_params[chan];
+    uint32_t half = ACQ_MEM_WHOLE;
+    if (pingpong->enabled) {
+        /* The last acquisition is kept until this one completes */
+        half = (params->half == 0) ? 1 : 0;
+        pingpong->next = *params;
+        params = &pingpong->next;
+    }
+
+    /* Curves waiting to be recorded in the memory about to be
+     * overwritten are lost */
+    _acq_pm_drop_overlap (acq, chan, half);
+    _acq_mcast_drop_overlap (acq, chan, half);
+
+    _acq_program_chan (self, acq, chan, params, num_samples_pre,
+            num_samples_post, num_shots);
+    params->half = half;
 
     /* DDR3 start address. Byte addressed */
-    uint32_t start_addr = (uint32_t) acq->acq_buf[chan].start_addr;
-    uint32_t end_addr = (uint32_t) acq->acq_buf[chan].end_addr;
+    uint64_t region_start = 0;
+    uint64_t region_end = 0;
+    _acq_get_region (acq, chan, half, &region_start, &region_end);
+    uint32_t start_addr = (uint32_t) region_start;
+    uint32_t end_addr = (uint32_t) region_end;
 
     /* Start address */
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] data_acquire: "
@@ -215,10 +321,119 @@ static int _acq_data_acquire (void *owner, void *args, void *ret)
     smio_thsafe_client_read_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
     acq_core_ctl_reg |= ACQ_CORE_CTL_FSM_START_ACQ;
     smio_thsafe_client_write_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+    smio_set_posted_writes (self, posted);
 
     /* If we are here, the FPGA is acquiring samples from the
      * specified channel. Set current channel field */
     acq->curr_chan = chan;
+    _acq_predict_start (acq, chan, (uint64_t) (params->num_samples_pre +
+                params->num_samples_post) * params->num_shots,
+            acq_core_ctl_reg & ACQ_CORE_CTL_FSM_ACQ_NOW);
+    /* Blocks read from now on belong to a new acquisition. On ping-pong,
+     * only once it completes */
+    params->seq++;
+    params->timestamp = 0;
+    params->plan.valid = false;
+    _acq_early_start (acq, chan, params, acq_core_ctl_reg & ACQ_CORE_CTL_FSM_ACQ_NOW);
+    if (pingpong->enabled) {
+        pingpong->pending = true;
+    }
+    else if (acq->cache != NULL) {
+        smio_acq_cache_invalidate (acq->cache, chan);
+    }
+
+    _acq_status_update (self, acq);
+}
+
+static int _acq_data_acquire (void *owner, void *args, void *ret)
+{
+    (void) ret;
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_data_acquire\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: number of pre-trigger samples
+     * frame 2: number of post-trigger samples
+     * frame 3: number of shots
+     * frame 4: channel                 */
+    uint32_t num_samples_pre = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t num_samples_post = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_shots = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    err = _acq_start_single (self, acq, num_samples_pre, num_samples_post,
+            num_shots, chan);
+
+err_get_acq_handler:
+    return err;
+}
+
+/* Check the parameters of a single channel acquisition and start it */
+static int _acq_start_single (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t num_samples_pre, uint32_t num_samples_post, uint32_t num_shots,
+        uint32_t chan)
+{
+    int err = -ACQ_OK;
+
+    /* The continuous acquisition owns the ACQ core until it is stopped */
+    ASSERT_TEST(!acq->ring.active, "Continuous acquisition in progress. "
+            "New acquisition not started", err_acq_not_completed, -ACQ_RING_ACTIVE);
+    /* The ACQ core is idle in between the channels of a multi-channel
+     * acquisition */
+    ASSERT_TEST(acq->multi.pending_mask == 0, "Multi-channel acquisition in "
+            "progress. New acquisition not started", err_acq_not_completed,
+            -ACQ_NOT_COMPLETED);
+    /* ... and while the curve of a single request acquisition is pushed */
+    ASSERT_TEST(acq->capture.reply == NULL, "Single request acquisition in "
+            "progress. New acquisition not started", err_acq_not_completed,
+            -ACQ_NOT_COMPLETED);
+    ASSERT_TEST(!acq->queue.active, "Acquisition queue in progress. "
+            "New acquisition not started", err_acq_not_completed, -ACQ_QUEUE_ACTIVE);
+
+    /* First step is to check if the FPGA is already doing an acquisition. If it
+     * is, then return an error. Otherwise proceed normally. */
+    err = _acq_check_status (self, ACQ_CORE_IDLE_MASK, ACQ_CORE_IDLE_VALUE);
+    ASSERT_TEST(err == -ACQ_OK, "Previous acquisition in progress. "
+            "New acquisition not started", err_acq_not_completed);
+
+    /* If skip trigger is set, we must set post_trigger_samples to 0 */
+    uint32_t trigger_type = 0;
+    err = _acq_get_trigger_type (self, &trigger_type);
+    ASSERT_TEST(err == -ACQ_OK, "Could not check for trigger type",
+            err_acq_get_trig);
+    err = _acq_check_params (acq, chan, num_samples_pre, num_samples_post,
+            num_shots, trigger_type);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    /* Single channel acquisition */
+    acq->multi.chan_mask = 0;
+    acq->multi.pending_mask = 0;
+    _acq_start_chan (self, acq, chan, num_samples_pre, num_samples_post,
+            num_shots);
+
+    /* Whatever was left of a continuous acquisition is overwritten now */
+    free (acq->ring.seg_addr);
+    acq->ring.seg_addr = NULL;
+
+    /* Let the poll timer watch for the completion of this acquisition, so
+     * clients can be notified without polling us */
+    acq->acq_pending = true;
+    smio_err_e serr = smio_set_poll_interval (self, ACQ_EVENT_POLL_INTERVAL);
+    if (serr != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] data_acquire: "
+                "Could not set poll timer. Completion event will not be published\n");
+    }
 
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] data_acquire: "
             "Acquisition Started!\n");
@@ -226,6 +441,190 @@ static int _acq_data_acquire (void *owner, void *args, void *ret)
     return -ACQ_OK;
 
 err_acq_get_trig:
+err_acq_not_completed:
+    return err;
+}
+
+/* Start an acquisition of a single channel and reply only when it is over,
+ * after streaming the whole curve back, as _acq_get_curve_stream does. The
+ * poll timer watches for the completion and then pushes the blocks, so
+ * other requests are still served in the meantime. This replaces the
+ * start, check and per-block get requests of a regular acquisition */
+static int _acq_acquire_curve (void *owner, void *args, void *ret)
+{
+    (void) ret;
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_acquire_curve\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+    mlm_client_t *worker = smio_get_worker (self);
+    ASSERT_TEST(worker != NULL, "Could not get SMIO worker",
+            err_get_acq_handler, -ACQ_ERR);
+    /* Blocks are streamed through the broker only */
+    ASSERT_TEST(!EXP_MSG_ZMQ_IS_LOCAL(args), "Curves cannot be streamed "
+            "through the local fast path", err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: number of pre-trigger samples
+     * frame 2: number of post-trigger samples
+     * frame 3: number of shots
+     * frame 4: channel
+     * frame 5: timeout, in msec        */
+    uint32_t num_samples_pre = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t num_samples_post = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_shots = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t timeout = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] acquire_curve: "
+            "chan = %u, timeout = %u ms\n", chan, timeout);
+
+    char *peer = strdup (EXP_MSG_ZMQ_SENDER(args));
+    ASSERT_ALLOC(peer, err_peer_alloc, -ACQ_ERR);
+
+    err = _acq_start_single (self, acq, num_samples_pre, num_samples_post,
+            num_shots, chan);
+    ASSERT_TEST(err == -ACQ_OK, "Could not start acquisition", err_start);
+
+    /* The acquisition is running already, so the request can only be
+     * replied to now if this fails */
+    acq->capture.reply = msg_defer_reply (args);
+    ASSERT_TEST(acq->capture.reply != NULL, "Could not defer reply",
+            err_defer, -ACQ_ERR);
+
+    acq->capture.peer = peer;
+    acq->capture.chan = chan;
+    acq->capture.deadline = (timeout == ACQ_ACQUIRE_CURVE_NO_TIMEOUT) ? -1 :
+        zclock_mono () + timeout;
+    acq->capture.next_block = 0;
+
+    return -ACQ_OK;
+
+err_defer:
+err_start:
+    free (peer);
+err_peer_alloc:
+err_get_acq_handler:
+    return err;
+}
+
+/* Acquire several channels with the same parameters. The ACQ core only
+ * writes one channel at a time, so the channels are started one after the
+ * other from the poll timer, in increasing order, and a single completion
+ * event is published at the end */
+static int _acq_data_acquire_multi (void *owner, void *args, void *ret)
+{
+    (void) ret;
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_data_acquire_multi\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    ASSERT_TEST(!acq->ring.active, "Continuous acquisition in progress. "
+            "New acquisition not started", err_acq_not_completed, -ACQ_RING_ACTIVE);
+    ASSERT_TEST(acq->multi.pending_mask == 0, "Multi-channel acquisition in "
+            "progress. New acquisition not started", err_acq_not_completed,
+            -ACQ_NOT_COMPLETED);
+    ASSERT_TEST(acq->capture.reply == NULL, "Single request acquisition in "
+            "progress. New acquisition not started", err_acq_not_completed,
+            -ACQ_NOT_COMPLETED);
+    ASSERT_TEST(!acq->queue.active, "Acquisition queue in progress. "
+            "New acquisition not started", err_acq_not_completed, -ACQ_QUEUE_ACTIVE);
+    err = _acq_check_status (self, ACQ_CORE_IDLE_MASK, ACQ_CORE_IDLE_VALUE);
+    ASSERT_TEST(err == -ACQ_OK, "Previous acquisition in progress. "
+            "New acquisition not started", err_acq_not_completed);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: number of pre-trigger samples
+     * frame 2: number of post-trigger samples
+     * frame 3: number of shots
+     * frame 4: channel mask            */
+    uint32_t num_samples_pre = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t num_samples_post = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_shots = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t chan_mask = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] data_acquire_multi: "
+            "chan_mask = 0x%08x\n", chan_mask);
+
+    ASSERT_TEST(chan_mask != 0, "No channel selected", err_inv_param,
+            -ACQ_NUM_CHAN_OOR);
+
+    uint32_t trigger_type = 0;
+    err = _acq_get_trigger_type (self, &trigger_type);
+    ASSERT_TEST(err == -ACQ_OK, "Could not check for trigger type",
+            err_acq_get_trig);
+
+    for (uint32_t chan = 0; chan < ACQ_MULTI_MAX_CHANS; ++chan) {
+        if (!(chan_mask & (1U << chan))) {
+            continue;
+        }
+
+        err = _acq_check_params (acq, chan, num_samples_pre, num_samples_post,
+                num_shots, trigger_type);
+        if (err != -ACQ_OK) {
+            return err;
+        }
+
+        /* Channels sharing memory would overwrite each other */
+        uint64_t start = acq->acq_buf[chan].start_addr;
+        uint64_t end = acq->acq_buf[chan].end_addr + acq->acq_buf[chan].sample_size;
+        for (uint32_t other = 0; other < chan; ++other) {
+            if (!(chan_mask & (1U << other))) {
+                continue;
+            }
+
+            uint64_t other_start = acq->acq_buf[other].start_addr;
+            uint64_t other_end = acq->acq_buf[other].end_addr +
+                acq->acq_buf[other].sample_size;
+            if (start < other_end && other_start < end) {
+                DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] data_acquire_multi: "
+                        "Channels %u and %u share the same memory\n", other, chan);
+                return -ACQ_CHAN_OVERLAP;
+            }
+        }
+    }
+
+    acq->multi.chan_mask = chan_mask;
+    acq->multi.pending_mask = chan_mask;
+    acq->multi.num_samples_pre = num_samples_pre;
+    acq->multi.num_samples_post = num_samples_post;
+    acq->multi.num_shots = num_shots;
+    _acq_multi_start_next (self, acq);
+
+    /* Whatever was left of a continuous acquisition is overwritten now */
+    free (acq->ring.seg_addr);
+    acq->ring.seg_addr = NULL;
+
+    /* The poll timer starts the next channels, so it must run even if
+     * no one is waiting for the completion event */
+    acq->acq_pending = true;
+    smio_err_e serr = smio_set_poll_interval (self, ACQ_EVENT_POLL_INTERVAL);
+    if (serr != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] data_acquire_multi: "
+                "Could not set poll timer. Only the first channel will be acquired\n");
+        acq->multi.pending_mask = 0;
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] data_acquire_multi: "
+            "Acquisition Started!\n");
+
+    return -ACQ_OK;
+
+err_acq_get_trig:
+err_inv_param:
 err_acq_not_completed:
 err_get_acq_handler:
     return err;
@@ -251,17 +650,31 @@ static int _acq_check_data_acquire (void *owner, void *args, void *ret)
 
     uint32_t chan = acq->curr_chan;
 
+    /* Some channels of a multi-channel acquisition were not started yet */
+    if (acq->multi.pending_mask != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] acq_check_data_acquire: "
+                "Acquisition is not done for channels 0x%08x\n",
+                acq->multi.pending_mask);
+        return -ACQ_NOT_COMPLETED;
+    }
+
+    /* Not due yet. Spare the register read */
+    if (acq->acq_pending && !_acq_predict_due (&acq->predict, zclock_usecs ())) {
+        return -ACQ_NOT_COMPLETED;
+    }
+
     err = _acq_check_status (self, ACQ_CORE_COMPLETE_MASK, ACQ_CORE_COMPLETE_VALUE);
     if (err != -ACQ_OK) {
         DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] acq_check_data_acquire: "
                 "Acquisition is not done for channel %u\n", chan);
     }
     else {
-        uint32_t acq_core_trig_addr;
         DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] acq_check_data_acquire: "
                 "Acquisition is done for channel %u\n", chan);
-        smio_thsafe_client_read_32 (self, ACQ_CORE_REG_TRIG_POS, &acq_core_trig_addr);
-        acq->acq_params[chan].trig_addr = acq_core_trig_addr;
+        if (acq->acq_pending) {
+            _acq_predict_done (acq, chan);
+        }
+        _acq_complete_chan (self, acq, chan);
     }
 
 err_get_acq_handler:
@@ -311,98 +724,2174 @@ static int _acq_get_data_block (void *owner, void *args, void *ret)
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
             "chan = %u, block_n = %u\n", chan, block_n);
 
-    /* channel required is out of the limit */
-    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
-        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] data_acquire: "
-                "Channel required is out of the maximum limit\n");
+    uint64_t block_offs = 0;
+    uint32_t block_size = 0;
+    int err = _acq_get_block_params (acq, chan, block_n, BLOCK_SIZE,
+            &block_offs, &block_size);
+    if (err != -ACQ_OK) {
+        return err;
+    }
 
-        return -ACQ_NUM_CHAN_OOR;
+    /* While the acquisition is in progress, only its pre-trigger samples
+     * can be read, once its trigger was seen */
+    if (_acq_in_progress (acq, chan)) {
+        smio_acq_trig_info_t trig_info;
+        _acq_get_trig_info_chan (acq, chan, &trig_info);
+        if (block_offs >= trig_info.size) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
+                    "Block %u of channel %u is not acquired yet\n", block_n, chan);
+            return -ACQ_NOT_COMPLETED;
+        }
+        if (block_size > trig_info.size - block_offs) {
+            block_size = trig_info.size - block_offs;
+        }
     }
 
-    /* Channel features */
-    uint32_t channel_sample_size = acq->acq_buf[chan].sample_size;
-    uint32_t channel_start_addr = acq->acq_buf[chan].start_addr;
-    uint32_t channel_end_addr = acq->acq_buf[chan].end_addr;
-    uint32_t channel_max_samples = acq->acq_buf[chan].max_samples;
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "\t[channel = %u], id = %u, start addr = 0x%08x\n"
-            "\tend addr = 0x%08x, max samples = %u, sample size = %u\n",
-            chan,
-            acq->acq_buf[chan].id,
-            channel_start_addr,
-            channel_end_addr,
-            channel_max_samples,
-            channel_sample_size);
-
-    uint32_t block_n_max = (channel_max_samples*channel_sample_size) /
-        BLOCK_SIZE;
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "block_n_max = %u\n", block_n_max);
+    smio_acq_data_block_t *data_block = (smio_acq_data_block_t *) ret;
+    ssize_t valid_bytes = _acq_read_block (self, acq, chan, block_offs, block_size,
+            data_block->data);
 
-    if (block_n > block_n_max) {    /* block required out of the limits */
-        /* TODO error level in this case */
-        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] get_data_block: "
-                "Block %u of channel %u is out of range\n", block_n, chan);
-        return -ACQ_BLOCK_OOR;
+    /* Check if we could read successfully */
+    int retf = 0;
+    if (valid_bytes >= 0) {
+        data_block->valid_bytes = (uint32_t) valid_bytes;
+        retf = valid_bytes + (ssize_t) sizeof (data_block->valid_bytes);
+    }
+    else {
+        data_block->valid_bytes = 0;
+        retf = -ACQ_COULD_NOT_READ;
     }
 
-    /* Get number of samples and shots */
-    uint32_t num_samples_pre =
-        acq->acq_params[chan].num_samples_pre;
-    uint32_t num_samples_post =
-        acq->acq_params[chan].num_samples_post;
-    uint32_t num_samples_shot = num_samples_pre + num_samples_post;
-    uint32_t num_shots =
-        acq->acq_params[chan].num_shots;
-    uint32_t num_samples_multishot = num_samples_shot*num_shots;
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "last num_samples_pre = %u\n", num_samples_pre);
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "last num_samples_post = %u\n", num_samples_post);
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "last num_shots = %u\n", num_shots);
+    return retf;
 
-    uint32_t n_max_samples = BLOCK_SIZE/channel_sample_size;
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "n_max_samples = %u\n", n_max_samples);
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+static int _acq_get_data_block_shm (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_data_block_shm\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: block required      */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_n = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block_shm: "
+            "chan = %u, block_n = %u\n", chan, block_n);
 
-    uint32_t over_samples = num_samples_multishot % n_max_samples;
-    uint32_t block_n_valid = num_samples_multishot / n_max_samples;
-    /* When the last block is full 'block_n_valid' exceeds by one */
-    if (block_n_valid != 0 && over_samples == 0) {
-        block_n_valid--;
+    uint64_t block_offs = 0;
+    uint32_t block_size = 0;
+    int err = _acq_get_block_params (acq, chan, block_n, BLOCK_SIZE,
+            &block_offs, &block_size);
+    if (err != -ACQ_OK) {
+        return err;
     }
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "block_n_valid= %u, over_samples= %u\n",
-            block_n_valid, over_samples);
 
-    /* check if block required is valid and if it is full or not */
-    if (block_n > block_n_valid) {
-        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] get_data_block: "
-                "Block %u of channel %u is not valid\n", block_n, chan);
-        return -ACQ_BLOCK_OOR;
-    }   /* Last valid data conditions check done */
+    /* Lazily create the shared memory region. Remote clients never use
+     * this, so we don't pay for it unless asked to */
+    smio_err_e serr = smio_acq_shm_open (acq, smio_get_service (self));
+    if (serr != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] get_data_block_shm: "
+                "Shared memory region is not available\n");
+        return -ACQ_SHM_UNAVAILABLE;
+    }
 
-    uint32_t reply_size;
-    if (block_n == block_n_valid && over_samples > 0){
-        reply_size = over_samples*channel_sample_size;
+    uint64_t offset = (uint64_t) block_n * BLOCK_SIZE;
+    if (offset + block_size > acq->shm_size) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] get_data_block_shm: "
+                "Block %u does not fit into the shared memory region\n", block_n);
+        return -ACQ_BLOCK_OOR;
     }
-    else { /* if block_n < block_n_valid */
-        reply_size = BLOCK_SIZE;
+
+    ssize_t valid_bytes = _acq_read_block (self, acq, chan, block_offs, block_size,
+            acq->shm_buf + offset);
+    if (valid_bytes < 0) {
+        return -ACQ_COULD_NOT_READ;
     }
 
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "Reading block %u of channel %u with %u valid samples\n",
-            block_n, chan, reply_size);
+    smio_acq_shm_desc_t *desc = (smio_acq_shm_desc_t *) ret;
+    desc->seq = acq->acq_params[chan].seq;
+    desc->chan = chan;
+    desc->offset = (uint32_t) offset;
+    desc->valid_bytes = (uint32_t) valid_bytes;
 
-    /* For all modes the start valid address is given by:
-     * start_addr = trigger_addr -
-     * ((num_samples_pre+num_samples_post)*(num_shots-1) + num_samples_pre)*
-     * sample_size
-     * */
+    return sizeof (*desc);
 
-    /* First step if to get the trigger address from the channel. 
-     * Even on skip trigger mode, this will contain the address after 
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Push a range of blocks back-to-back to the requester, without waiting for
+ * a request per block. The client grants credits by asking for at most
+ * ACQ_STREAM_MAX_BLOCKS blocks at a time and can have several grants
+ * queued, so the SMIO is never idle waiting for a round-trip. The regular
+ * reply (number of blocks sent) is sent after the last streamed block and
+ * marks the end of this grant */
+static int _acq_get_curve_stream (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_curve_stream\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+    mlm_client_t *worker = smio_get_worker (self);
+    ASSERT_TEST(worker != NULL, "Could not get SMIO worker",
+            err_get_acq_handler);
+    /* Blocks are streamed through the broker only */
+    ASSERT_TEST(!EXP_MSG_ZMQ_IS_LOCAL(args), "Curves cannot be streamed "
+            "through the local fast path", err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: first block required
+     * frame 2: number of blocks required */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_start = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_blocks = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_stream: "
+            "chan = %u, block_start = %u, num_blocks = %u\n", chan,
+            block_start, num_blocks);
+
+    uint32_t blocks_sent = 0;
+    int err = _acq_push_blocks (self, acq, chan, block_start, num_blocks,
+            worker, NULL, EXP_MSG_ZMQ_SENDER(args), &blocks_sent);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_stream: "
+            "%u blocks streamed\n", blocks_sent);
+
+    *(uint32_t *) ret = blocks_sent;
+    return sizeof (blocks_sent);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Push blocks [block_start, block_start + num_blocks) of "chan" to the
+ * requester, or "peer" if set, through the broker or, if "direct_sock" is
+ * set, straight to "peer" through the direct data path. Reaching the end of the curve before
+ * that is fine, as long as a block was sent */
+static int _acq_push_blocks (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, uint32_t block_start, uint32_t num_blocks,
+        mlm_client_t *worker, zsock_t *direct_sock, const char *peer,
+        uint32_t *blocks_sent)
+{
+    if (num_blocks == 0 || num_blocks > ACQ_STREAM_MAX_BLOCKS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] push_blocks: "
+                "Number of blocks requested is out of range\n");
+        return -ACQ_BLOCK_OOR;
+    }
+
+    *blocks_sent = 0;
+    for (uint32_t block_n = block_start; block_n < block_start + num_blocks;
+            block_n++) {
+        uint64_t block_offs = 0;
+        uint32_t block_size = 0;
+        int err = _acq_get_block_params (acq, chan, block_n, BLOCK_SIZE,
+                &block_offs, &block_size);
+        if (err != -ACQ_OK) {
+            /* Reaching the end of the curve inside a grant is fine */
+            if (*blocks_sent > 0 && err == -ACQ_BLOCK_OOR) {
+                break;
+            }
+            return err;
+        }
+
+        zframe_t *data_frame = zframe_new (NULL, block_size);
+        if (data_frame == NULL) {
+            return -ACQ_ERR;
+        }
+
+        ssize_t valid_bytes = _acq_read_block (self, acq, chan, block_offs, block_size,
+                zframe_data (data_frame));
+        if (valid_bytes < 0) {
+            zframe_destroy (&data_frame);
+            return -ACQ_COULD_NOT_READ;
+        }
+
+        smio_acq_stream_hdr_t hdr = {
+            .seq = acq->acq_params[chan].seq,
+            .chan = chan,
+            .block_n = block_n,
+            .valid_bytes = (uint32_t) valid_bytes
+        };
+
+        err = _acq_stream_send_block (worker, direct_sock, peer, &hdr,
+                &data_frame);
+        if (err != -ACQ_OK) {
+            return err;
+        }
+        (*blocks_sent)++;
+    }
+
+    return -ACQ_OK;
+}
+
+/* Tell the client where to connect to for the direct data path, setting
+ * it up on the first request */
+static int _acq_get_direct_endp (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_direct_endp\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: operation code */
+    smio_err_e serr = smio_acq_direct_open (acq);
+    if (serr != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] get_direct_endp: "
+                "Could not set up the direct data path\n");
+        return -ACQ_DIRECT_UNAVAILABLE;
+    }
+
+    smio_acq_direct_endp_t *direct_endp = (smio_acq_direct_endp_t *) ret;
+    memset (direct_endp, 0, sizeof (*direct_endp));
+    strncpy (direct_endp->endp, acq->direct_endp, sizeof (direct_endp->endp) - 1);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_direct_endp: "
+            "endpoint = %s\n", direct_endp->endp);
+
+    return sizeof (*direct_endp);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Same as _acq_get_curve_stream, but the blocks are pushed through the
+ * direct data path, so only the control messages go through the broker */
+static int _acq_get_curve_direct (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_curve_direct\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: first block required
+     * frame 2: number of blocks required
+     * frame 3: client identity on the direct data path */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_start = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_blocks = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    smio_acq_direct_peer_t *peer = (smio_acq_direct_peer_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    peer->id[sizeof (peer->id) - 1] = '\0';
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_direct: "
+            "chan = %u, block_start = %u, num_blocks = %u, peer = %s\n", chan,
+            block_start, num_blocks, peer->id);
+
+    if (acq->direct_sock == NULL) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_curve_direct: "
+                "Direct data path was not set up\n");
+        return -ACQ_DIRECT_UNAVAILABLE;
+    }
+
+    uint32_t blocks_sent = 0;
+    int err = _acq_push_blocks (self, acq, chan, block_start, num_blocks,
+            NULL, acq->direct_sock, peer->id, &blocks_sent);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_direct: "
+            "%u blocks pushed\n", blocks_sent);
+
+    *(uint32_t *) ret = blocks_sent;
+    return sizeof (blocks_sent);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Fill "chan_map" with the channels of "acq", returning its size */
+static size_t _acq_fill_chan_map (smio_acq_t *acq, smio_acq_chan_map_t *chan_map)
+{
+    chan_map->num_chans = END_CHAN_ID;
+    chan_map->reserved = 0;
+    for (uint32_t i = 0; i < END_CHAN_ID; ++i) {
+        chan_map->chans [i].id = acq->acq_buf[i].id;
+        chan_map->chans [i].sample_size = acq->acq_buf[i].sample_size;
+        chan_map->chans [i].max_samples = acq->acq_buf[i].max_samples;
+        chan_map->chans [i].start_addr = acq->acq_buf[i].start_addr;
+        chan_map->chans [i].end_addr = acq->acq_buf[i].end_addr;
+    }
+
+    return offsetof (smio_acq_chan_map_t, chans) +
+        END_CHAN_ID * sizeof (chan_map->chans [0]);
+}
+
+static int _acq_get_chan_map (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_chan_map\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: operation code */
+    return _acq_fill_chan_map (acq, (smio_acq_chan_map_t *) ret);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Check that no acquisition uses the channel memory */
+static bool _acq_mem_busy (smio_acq_t *acq)
+{
+    if (acq->acq_pending || acq->ring.active || acq->queue.active ||
+            acq->multi.pending_mask != 0 || acq->capture.reply != NULL ||
+            acq->pm.active || acq->mcast.active) {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < END_CHAN_ID; ++i) {
+        if (acq->pingpong[i].pending) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Lay the channel regions out one after the other, as in ddr3_map.h,
+ * "chan_size" bytes each. Returns -ACQ_OK or -ACQ_PART_INV if the sizes
+ * are not valid */
+static int _acq_partition_apply (smio_acq_t *acq, const uint32_t *chan_size)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < END_CHAN_ID; ++i) {
+        if (chan_size [i] % ACQ_PART_ALIGN != 0 ||
+                chan_size [i] % (2 * acq->acq_buf[i].sample_size) != 0) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] cfg_partition: "
+                    "Size %u of channel %u is not aligned\n", chan_size [i], i);
+            return -ACQ_PART_INV;
+        }
+        total += chan_size [i];
+    }
+
+    if (total > acq->mem_end - acq->mem_start) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] cfg_partition: "
+                "%"PRIu64" bytes do not fit in the %u bytes of memory\n", total,
+                acq->mem_end - acq->mem_start);
+        return -ACQ_PART_INV;
+    }
+
+    uint32_t addr = acq->mem_start;
+    for (uint32_t i = 0; i < END_CHAN_ID; ++i) {
+        acq_buf_t *buf = &acq->acq_buf[i];
+        uint32_t sample_size = (chan_size [i] > 0) ? buf->sample_size : 0;
+
+        buf->start_addr = addr;
+        buf->end_addr = addr + chan_size [i] - sample_size;
+        buf->max_samples = (chan_size [i] > 0) ? chan_size [i] / buf->sample_size : 0;
+        buf->split_addr = addr + chan_size [i] / 2;
+        addr += chan_size [i];
+
+        /* The last acquisitions were overwritten or are somewhere else now */
+        acq->acq_params[i].trig_addr = buf->start_addr;
+        acq->acq_params[i].timestamp = 0;
+        acq->acq_params[i].half = ACQ_MEM_WHOLE;
+        acq->pingpong[i].enabled = false;
+        if (acq->cache != NULL) {
+            smio_acq_cache_invalidate (acq->cache, i);
+        }
+    }
+
+    smio_acq_pyr_destroy (&acq->pyr);
+    return -ACQ_OK;
+}
+
+/* Split the memory of the ACQ core among its channels, see
+ * smio_acq_partition_t, or read the partition back */
+static int _acq_cfg_partition (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_cfg_partition\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: partition */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    smio_acq_partition_t *part = (smio_acq_partition_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        smio_acq_partition_t *rpart = (smio_acq_partition_t *) ret;
+        memset (rpart, 0, sizeof (*rpart));
+        rpart->num_chans = END_CHAN_ID;
+        rpart->mem_size = acq->mem_end - acq->mem_start;
+        for (uint32_t i = 0; i < END_CHAN_ID; ++i) {
+            const acq_buf_t *buf = &acq->acq_buf[i];
+            rpart->chan_size [i] = (buf->max_samples > 0) ?
+                buf->end_addr - buf->start_addr + buf->sample_size : 0;
+        }
+        return sizeof (*rpart);
+    }
+
+    ASSERT_TEST(part->num_chans == END_CHAN_ID, "Partition does not match "
+            "the channels", err_inv_param, -ACQ_PART_INV);
+    ASSERT_TEST(!_acq_mem_busy (acq), "Acquisition in progress", err_inv_param,
+            -ACQ_PART_BUSY);
+
+    err = _acq_partition_apply (acq, part->chan_size);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    /* The shared memory region must hold the biggest channel. Clients map
+     * it again on their next request */
+    if (acq->shm_buf != NULL) {
+        smio_acq_shm_close (acq);
+    }
+
+    /* Registering again replaces the channel map of the directory */
+    smio_acq_chan_map_t chan_map;
+    size_t chan_map_size = _acq_fill_chan_map (acq, &chan_map);
+    if (smio_set_dir_info (self, &chan_map, chan_map_size) != SMIO_SUCCESS ||
+            smio_dir_register (self) != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] cfg_partition: "
+                "Could not update the channel map of the directory\n");
+    }
+    smio_set_param_changed (self);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] cfg_partition: "
+            "Memory repartitioned among %u channels\n", END_CHAN_ID);
+
+err_inv_param:
+err_get_acq_handler:
+    return err;
+}
+
+/* Set the capacity of the position stream, in samples, or disable it with 0.
+ * It takes effect on the next continuous acquisition */
+static int _acq_cfg_pstream (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_cfg_pstream\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: capacity */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t capacity = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = acq->pstream_capacity;
+        return sizeof (uint32_t);
+    }
+
+    ASSERT_TEST(capacity == 0 || (capacity >= ACQ_PSTREAM_MIN_SAMPLES &&
+            capacity <= ACQ_PSTREAM_MAX_SAMPLES &&
+            (capacity & (capacity - 1)) == 0), "Position stream capacity "
+            "is invalid", err_inv_param, -ACQ_PSTREAM_INV);
+    ASSERT_TEST(!acq->ring.active, "Continuous acquisition in progress",
+            err_inv_param, -ACQ_RING_ACTIVE);
+
+    acq->pstream_capacity = capacity;
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] cfg_pstream: "
+            "Position stream capacity set to %u samples\n", capacity);
+
+err_inv_param:
+err_get_acq_handler:
+    return err;
+}
+
+/* Same as _acq_get_data_block, but with the block size chosen by the client
+ * for this request, up to the configured maximum */
+static int _acq_get_data_block_var (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_data_block_var\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: block required
+     * frame 2: block size          */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_n = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t block_size_req = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block_var: "
+            "chan = %u, block_n = %u, block_size = %u\n", chan, block_n,
+            block_size_req);
+
+    /* Block sizes must be powers of 2, so they are always a multiple
+     * of the sample size */
+    if (block_size_req < ACQ_BLOCK_SIZE_MIN || block_size_req > acq->block_size_max ||
+            (block_size_req & (block_size_req - 1)) != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_var: "
+                "Block size %u is not valid\n", block_size_req);
+        return -ACQ_BLOCK_SIZE_OOR;
+    }
+
+    uint64_t block_offs = 0;
+    uint32_t block_size = 0;
+    int err = _acq_get_block_params (acq, chan, block_n, block_size_req,
+            &block_offs, &block_size);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    smio_acq_data_block_var_t *data_block = (smio_acq_data_block_var_t *) ret;
+    ssize_t valid_bytes = _acq_read_block (self, acq, chan, block_offs, block_size,
+            data_block->data);
+
+    /* Check if we could read successfully */
+    int retf = 0;
+    if (valid_bytes >= 0) {
+        data_block->valid_bytes = (uint32_t) valid_bytes;
+        retf = valid_bytes + (ssize_t) sizeof (data_block->valid_bytes);
+    }
+    else {
+        data_block->valid_bytes = 0;
+        retf = -ACQ_COULD_NOT_READ;
+    }
+
+    return retf;
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Same as _acq_get_data_block_var, but only the atoms selected by the
+ * atom mask of one out of every "decim" samples are returned. Decimation
+ * is done on the curve, so consecutive blocks keep the same phase */
+static int _acq_get_data_block_reduced (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_data_block_reduced\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: block required
+     * frame 2: block size
+     * frame 3: atom mask
+     * frame 4: decimation factor   */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_n = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t block_size_req = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t atom_mask = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t decim = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block_reduced: "
+            "chan = %u, block_n = %u, block_size = %u, atom_mask = 0x%x, "
+            "decim = %u\n", chan, block_n, block_size_req, atom_mask, decim);
+
+    if (block_size_req < ACQ_BLOCK_SIZE_MIN || block_size_req > acq->block_size_max ||
+            (block_size_req & (block_size_req - 1)) != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_reduced: "
+                "Block size %u is not valid\n", block_size_req);
+        return -ACQ_BLOCK_SIZE_OOR;
+    }
+
+    if (atom_mask == 0 || (atom_mask & ~ACQ_REDUCE_ATOM_MASK_ALL) != 0 ||
+            decim == 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_reduced: "
+                "Atom mask 0x%x or decimation factor %u is not valid\n",
+                atom_mask, decim);
+        return -ACQ_REDUCE_INV;
+    }
+
+    uint64_t block_offs = 0;
+    uint32_t block_size = 0;
+    int err = _acq_get_block_params (acq, chan, block_n, block_size_req,
+            &block_offs, &block_size);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    smio_acq_data_block_var_t *data_block = (smio_acq_data_block_var_t *) ret;
+    ssize_t valid_bytes = _acq_read_block (self, acq, chan, block_offs, block_size,
+            data_block->data);
+    if (valid_bytes < 0) {
+        data_block->valid_bytes = 0;
+        return -ACQ_COULD_NOT_READ;
+    }
+
+    /* Reduce the block in place. The first sample of the block we keep
+     * depends on where the block is in the curve */
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    uint64_t block_first_sample = (uint64_t) block_n * (block_size_req / sample_size);
+    uint32_t first = (decim - block_first_sample % decim) % decim;
+    ssize_t reduced_bytes = smio_acq_reduce (acq->reduce_ops, data_block->data,
+            valid_bytes, sample_size, first, decim, atom_mask);
+    if (reduced_bytes < 0) {
+        data_block->valid_bytes = 0;
+        return -ACQ_REDUCE_INV;
+    }
+
+    data_block->valid_bytes = (uint32_t) reduced_bytes;
+    return reduced_bytes + (ssize_t) sizeof (data_block->valid_bytes);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Start a continuous acquisition on a channel. Only the skip trigger is
+ * supported, as segments must follow each other without waiting */
+static int _acq_ring_start (void *owner, void *args, void *ret)
+{
+    (void) ret;
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_ring_start\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: channel
+     * frame 2: number of samples per segment */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t seg_samples = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] ring_start: "
+            "chan = %u, seg_samples = %u\n", chan, seg_samples);
+
+    ASSERT_TEST(chan < SMIO_ACQ_NUM_CHANNELS, "Channel required is out of "
+            "the maximum limit", err_inv_param, -ACQ_NUM_CHAN_OOR);
+    ASSERT_TEST(!acq->ring.active, "Continuous acquisition already in progress",
+            err_inv_param, -ACQ_RING_ACTIVE);
+    ASSERT_TEST(acq->multi.pending_mask == 0, "Multi-channel acquisition in "
+            "progress", err_inv_param, -ACQ_NOT_COMPLETED);
+    ASSERT_TEST(acq->capture.reply == NULL, "Single request acquisition in "
+            "progress", err_inv_param, -ACQ_NOT_COMPLETED);
+    ASSERT_TEST(!acq->queue.active, "Acquisition queue in progress",
+            err_inv_param, -ACQ_QUEUE_ACTIVE);
+
+    err = _acq_check_status (self, ACQ_CORE_IDLE_MASK, ACQ_CORE_IDLE_VALUE);
+    ASSERT_TEST(err == -ACQ_OK, "Previous acquisition in progress. "
+            "Continuous acquisition not started", err_inv_param);
+
+    uint32_t trigger_type = 0;
+    err = _acq_get_trigger_type (self, &trigger_type);
+    ASSERT_TEST(err == -ACQ_OK, "Could not check for trigger type",
+            err_inv_param);
+    ASSERT_TEST(trigger_type == TYPE_ACQ_CORE_SKIP, "Continuous acquisition "
+            "requires the skip trigger", err_inv_param, -ACQ_TRIG_TYPE);
+
+    /* FPGA Firmware requires number of samples to be divisible by
+     * acquisition channel sample size */
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    uint32_t samples_alignment = DDR3_PAYLOAD_SIZE/sample_size;
+    ASSERT_TEST(seg_samples != 0 && (seg_samples % samples_alignment) == 0,
+            "Number of samples per segment is not aligned", err_inv_param,
+            -ACQ_NUM_SAMPLES_OOR);
+    uint32_t num_segs = acq->acq_buf[chan].max_samples / seg_samples;
+    ASSERT_TEST(num_segs >= ACQ_RING_MIN_NUM_SEGS, "Number of samples per "
+            "segment is too large for the channel memory", err_inv_param,
+            -ACQ_NUM_SAMPLES_OOR);
+
+    uint64_t *seg_addr = realloc (acq->ring.seg_addr, num_segs * sizeof (*seg_addr));
+    ASSERT_ALLOC(seg_addr, err_seg_addr_alloc, -ACQ_ERR);
+
+    acq->ring.seg_addr = seg_addr;
+    acq->ring.chan = chan;
+    acq->ring.seg_samples = seg_samples;
+    acq->ring.num_segs = num_segs;
+    acq->ring.win_start = acq->acq_buf[chan].start_addr;
+    acq->ring.head = 0;
+
+    /* Every segment is a single-shot acquisition with pre-trigger
+     * samples only */
+    uint32_t acq_core_shots = ACQ_CORE_SHOTS_NB_W(ACQ_CORE_MIN_NUM_SHOTS);
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_SHOTS, &acq_core_shots);
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_PRE_SAMPLES, &seg_samples);
+    uint32_t num_samples_post = 0;
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_POST_SAMPLES, &num_samples_post);
+
+    uint32_t acq_chan_ctl = 0;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_ACQ_CHAN_CTL, &acq_chan_ctl);
+    acq_chan_ctl = (acq_chan_ctl & ~ACQ_CORE_ACQ_CHAN_CTL_WHICH_MASK) |
+         ACQ_CORE_ACQ_CHAN_CTL_WHICH_W(chan);
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_ACQ_CHAN_CTL, &acq_chan_ctl);
+
+    /* A fresh stream for every continuous acquisition, so readers see the
+     * channel and sample size of this one */
+    smio_acq_pstream_destroy (&acq->pstream);
+    if (acq->pstream_capacity != 0) {
+        acq->pstream = smio_acq_pstream_new (smio_get_service (self), chan,
+                sample_size, acq->pstream_capacity);
+        ASSERT_TEST(acq->pstream != NULL, "Could not create the position "
+                "stream", err_inv_param, -ACQ_SHM_UNAVAILABLE);
+    }
+
+    acq->curr_chan = chan;
+    acq->ring.active = true;
+    acq->pingpong[chan].pending = false;
+    /* Curves of this channel are overwritten from now on */
+    if (acq->cache != NULL) {
+        smio_acq_cache_invalidate (acq->cache, chan);
+    }
+    _acq_ring_arm (self, acq);
+
+    /* Segments are chained from the poll timer */
+    smio_err_e serr = smio_set_poll_interval (self, ACQ_EVENT_POLL_INTERVAL);
+    ASSERT_TEST(serr == SMIO_SUCCESS, "Could not set poll timer. Continuous "
+            "acquisition not started", err_poll_interval, -ACQ_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] ring_start: "
+            "Continuous acquisition started on channel %u with %u segments of "
+            "%u samples\n", chan, num_segs, seg_samples);
+
+    return -ACQ_OK;
+
+err_poll_interval:
+    acq->ring.active = false;
+    smio_acq_pstream_destroy (&acq->pstream);
+err_seg_addr_alloc:
+err_inv_param:
+err_get_acq_handler:
+    return err;
+}
+
+/* Stop a continuous acquisition. The samples acquired can still be read
+ * until the next acquisition is started */
+static int _acq_ring_stop (void *owner, void *args, void *ret)
+{
+    (void) ret;
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_ring_stop\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+    ASSERT_TEST(acq->ring.active, "Continuous acquisition is not running",
+            err_ring_inactive, -ACQ_RING_INACTIVE);
+
+    /* The segment being acquired is dropped */
+    uint32_t acq_core_ctl_reg = 0;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+    acq_core_ctl_reg |= ACQ_CORE_CTL_FSM_STOP_ACQ;
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+
+    acq->ring.active = false;
+    smio_acq_pstream_destroy (&acq->pstream);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] ring_stop: "
+            "Continuous acquisition stopped on channel %u after %"PRIu64
+            " samples\n", acq->ring.chan, acq->ring.head);
+
+err_ring_inactive:
+err_get_acq_handler:
+    return err;
+}
+
+/* Read the samples of a continuous acquisition starting from the client
+ * cursor, up to the requested size */
+static int _acq_ring_get_data (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_ring_get_data\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: cursor (index of the first sample wanted)
+     * frame 2: maximum number of bytes */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint64_t cursor = *(uint64_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t max_bytes = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] ring_get_data: "
+            "chan = %u, cursor = %"PRIu64", max_bytes = %u\n", chan, cursor,
+            max_bytes);
+
+    acq_ring_t *ring = &acq->ring;
+    if (ring->seg_addr == NULL || chan != ring->chan) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] ring_get_data: "
+                "No continuous acquisition data for channel %u\n", chan);
+        return -ACQ_RING_INACTIVE;
+    }
+
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    if (max_bytes < sample_size || max_bytes > acq->block_size_max) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] ring_get_data: "
+                "Size %u is not valid\n", max_bytes);
+        return -ACQ_BLOCK_SIZE_OOR;
+    }
+
+    smio_acq_ring_data_t *ring_data = (smio_acq_ring_data_t *) ret;
+    ring_data->flags = ring->active ? 0 : ACQ_RING_FLAG_STOPPED;
+
+    /* The segment after the last one acquired is being overwritten */
+    uint64_t valid_samples = (uint64_t) (ring->num_segs - 1) * ring->seg_samples;
+    uint64_t oldest = (ring->head > valid_samples) ? ring->head - valid_samples : 0;
+    if (cursor < oldest) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] ring_get_data: "
+                "%"PRIu64" samples were overwritten\n", oldest - cursor);
+        cursor = oldest;
+        ring_data->flags |= ACQ_RING_FLAG_OVERRUN;
+    }
+    if (cursor > ring->head) {
+        cursor = ring->head;
+    }
+
+    uint64_t num_samples = ring->head - cursor;
+    if (num_samples > max_bytes / sample_size) {
+        num_samples = max_bytes / sample_size;
+    }
+
+    uint64_t seg_bytes = (uint64_t) ring->seg_samples * sample_size;
+    uint64_t pos = cursor;
+    uint8_t *data = ring_data->data;
+    while (pos < cursor + num_samples) {
+        uint32_t seg = (pos / ring->seg_samples) % ring->num_segs;
+        uint32_t seg_offs = pos % ring->seg_samples;
+        uint64_t n = ring->seg_samples - seg_offs;
+        if (n > cursor + num_samples - pos) {
+            n = cursor + num_samples - pos;
+        }
+
+        /* Segments may not start at the beginning of their window */
+        uint64_t win_start = ring->win_start + seg * seg_bytes;
+        uint64_t win_end = win_start + seg_bytes;
+        uint64_t addr = ring->seg_addr [seg] + (uint64_t) seg_offs * sample_size;
+        if (addr >= win_end) {
+            addr -= seg_bytes;
+        }
+
+        ssize_t valid_bytes = _acq_read_block_win (self, win_start, win_end, addr,
+                n * sample_size, data);
+        if (valid_bytes != (ssize_t) (n * sample_size)) {
+            ring_data->valid_bytes = 0;
+            return -ACQ_COULD_NOT_READ;
+        }
+
+        data += valid_bytes;
+        pos += n;
+    }
+
+    ring_data->head = ring->head;
+    ring_data->start = cursor;
+    ring_data->valid_bytes = num_samples * sample_size;
+
+    return offsetof (smio_acq_ring_data_t, data) + ring_data->valid_bytes;
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Start a queue of acquisitions of the same channel and parameters. Each one
+ * goes to its own slot of the channel memory. The poll timer re-arms the ACQ
+ * core for the next slot as soon as an acquisition is done, so only the slot
+ * addresses are written in between */
+static int _acq_queue_start (void *owner, void *args, void *ret)
+{
+    (void) ret;
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_queue_start\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: number of pre-trigger samples
+     * frame 2: number of post-trigger samples
+     * frame 3: number of shots
+     * frame 4: channel
+     * frame 5: number of acquisitions  */
+    uint32_t num_samples_pre = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t num_samples_post = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_shots = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_acqs = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] queue_start: "
+            "chan = %u, num_acqs = %u\n", chan, num_acqs);
+
+    ASSERT_TEST(num_acqs > 0 && num_acqs <= ACQ_QUEUE_MAX_ACQS, "Number of "
+            "acquisitions is out of range", err_inv_param, -ACQ_QUEUE_OOR);
+    ASSERT_TEST(!acq->ring.active, "Continuous acquisition in progress",
+            err_inv_param, -ACQ_RING_ACTIVE);
+    ASSERT_TEST(!acq->queue.active, "Acquisition queue already in progress",
+            err_inv_param, -ACQ_QUEUE_ACTIVE);
+    /* The completion of a regular acquisition must be published first */
+    ASSERT_TEST(!acq->acq_pending && acq->multi.pending_mask == 0 &&
+            acq->capture.reply == NULL, "Acquisition in progress", err_inv_param,
+            -ACQ_NOT_COMPLETED);
+
+    err = _acq_check_status (self, ACQ_CORE_IDLE_MASK, ACQ_CORE_IDLE_VALUE);
+    ASSERT_TEST(err == -ACQ_OK, "Previous acquisition in progress. "
+            "Acquisition queue not started", err_inv_param);
+
+    uint32_t trigger_type = 0;
+    err = _acq_get_trigger_type (self, &trigger_type);
+    ASSERT_TEST(err == -ACQ_OK, "Could not check for trigger type",
+            err_inv_param);
+    err = _acq_check_params (acq, chan, num_samples_pre, num_samples_post,
+            num_shots, trigger_type);
+    ASSERT_TEST(err == -ACQ_OK, "Invalid acquisition parameters", err_inv_param);
+
+    acq_queue_entry_t *entries = realloc (acq->queue.entries,
+            num_acqs * sizeof (*entries));
+    ASSERT_ALLOC(entries, err_entries_alloc, -ACQ_ERR);
+    acq->queue.entries = entries;
+    acq->queue.num_acqs = 0;
+
+    /* The samples are only aligned once programmed. Nothing is started
+     * before checking they fit, though */
+    _acq_program_chan (self, acq, chan, &acq->acq_params[chan],
+            num_samples_pre, num_samples_post, num_shots);
+
+    /* The channel memory no longer holds the last regular acquisition */
+    acq->curr_chan = chan;
+    acq->acq_params[chan].half = ACQ_MEM_WHOLE;
+    acq->pingpong[chan].pending = false;
+    acq->acq_params[chan].seq++;
+    acq->acq_params[chan].timestamp = 0;
+    acq->acq_params[chan].plan.valid = false;
+    if (acq->cache != NULL) {
+        smio_acq_cache_invalidate (acq->cache, chan);
+    }
+
+    const acq_params_t *params = &acq->acq_params[chan];
+    uint64_t slot_size = (uint64_t) (params->num_samples_pre +
+            params->num_samples_post) * params->num_shots *
+        acq->acq_buf[chan].sample_size;
+    uint64_t mem_size = acq->acq_buf[chan].end_addr -
+        acq->acq_buf[chan].start_addr + acq->acq_buf[chan].sample_size;
+    ASSERT_TEST(slot_size * num_acqs <= mem_size, "Acquisitions do not fit "
+            "in the channel memory", err_inv_param, -ACQ_NUM_SAMPLES_OOR);
+
+    uint32_t acq_chan_ctl = 0;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_ACQ_CHAN_CTL, &acq_chan_ctl);
+    acq_chan_ctl = (acq_chan_ctl & ~ACQ_CORE_ACQ_CHAN_CTL_WHICH_MASK) |
+         ACQ_CORE_ACQ_CHAN_CTL_WHICH_W(chan);
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_ACQ_CHAN_CTL, &acq_chan_ctl);
+
+    acq->queue.chan = chan;
+    acq->queue.num_acqs = num_acqs;
+    acq->queue.num_done = 0;
+    acq->queue.num_samples_pre = params->num_samples_pre;
+    acq->queue.num_samples_post = params->num_samples_post;
+    acq->queue.num_shots = params->num_shots;
+    acq->queue.slot_start = acq->acq_buf[chan].start_addr;
+    acq->queue.slot_size = slot_size;
+    acq->queue.active = true;
+
+    _acq_queue_arm (self, acq);
+
+    smio_err_e serr = smio_set_poll_interval (self, ACQ_EVENT_POLL_INTERVAL);
+    ASSERT_TEST(serr == SMIO_SUCCESS, "Could not set poll timer. Acquisition "
+            "queue not started", err_poll_interval, -ACQ_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] queue_start: "
+            "Acquisition queue of %u acquisitions of %"PRIu64" bytes started "
+            "on channel %u\n", num_acqs, slot_size, chan);
+
+    return -ACQ_OK;
+
+err_poll_interval:
+    acq->queue.active = false;
+err_entries_alloc:
+err_inv_param:
+err_get_acq_handler:
+    return err;
+}
+
+/* Stop the acquisition queue. The acquisitions already done can still be
+ * read until a new acquisition is started */
+static int _acq_queue_stop (void *owner, void *args, void *ret)
+{
+    (void) ret;
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_queue_stop\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+    ASSERT_TEST(acq->queue.active, "Acquisition queue is not running",
+            err_queue_inactive, -ACQ_QUEUE_OOR);
+
+    /* The acquisition in progress is dropped */
+    uint32_t acq_core_ctl_reg = 0;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+    acq_core_ctl_reg |= ACQ_CORE_CTL_FSM_STOP_ACQ;
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+
+    acq->queue.active = false;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] queue_stop: "
+            "Acquisition queue stopped on channel %u after %u of %u "
+            "acquisitions\n", acq->queue.chan, acq->queue.num_done,
+            acq->queue.num_acqs);
+
+err_queue_inactive:
+err_get_acq_handler:
+    return err;
+}
+
+/* Get the progress of the acquisition queue and the metadata of one of
+ * its acquisitions */
+static int _acq_queue_get_info (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_queue_get_info\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: acquisition index */
+    uint32_t index = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    if (index >= acq->queue.num_acqs) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] queue_get_info: "
+                "Acquisition %u is not in the queue\n", index);
+        return -ACQ_QUEUE_OOR;
+    }
+
+    smio_acq_queue_info_t *info = (smio_acq_queue_info_t *) ret;
+    memset (info, 0, sizeof (*info));
+    info->num_acqs = acq->queue.num_acqs;
+    info->num_done = acq->queue.num_done;
+    info->flags = acq->queue.active ? ACQ_QUEUE_FLAG_ACTIVE : 0;
+    _acq_queue_get_curve_info (acq, index, &info->curve);
+
+    return sizeof (*info);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Same as _acq_get_data_block, for an acquisition of the queue */
+static int _acq_queue_get_block (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_queue_get_block\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: acquisition index
+     * frame 1: block required */
+    uint32_t index = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_n = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] queue_get_block: "
+            "index = %u, block_n = %u\n", index, block_n);
+
+    if (index >= acq->queue.num_acqs) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] queue_get_block: "
+                "Acquisition %u is not in the queue\n", index);
+        return -ACQ_QUEUE_OOR;
+    }
+    if (index >= acq->queue.num_done) {
+        return -ACQ_NOT_COMPLETED;
+    }
+
+    acq_plan_t plan;
+    _acq_queue_plan (acq, index, &plan);
+    uint64_t block_offs = (uint64_t) block_n * BLOCK_SIZE;
+    if (block_n > 0 && block_offs >= plan.size) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] queue_get_block: "
+                "Block %u of acquisition %u is not valid\n", block_n, index);
+        return -ACQ_BLOCK_OOR;
+    }
+    uint32_t block_size = (plan.size - block_offs < BLOCK_SIZE) ?
+        plan.size - block_offs : BLOCK_SIZE;
+
+    smio_acq_data_block_t *data_block = (smio_acq_data_block_t *) ret;
+    ssize_t valid_bytes = _acq_read_plan (self, &plan, block_offs, block_size,
+            data_block->data);
+    if (valid_bytes < 0) {
+        data_block->valid_bytes = 0;
+        return -ACQ_COULD_NOT_READ;
+    }
+
+    data_block->valid_bytes = (uint32_t) valid_bytes;
+    return valid_bytes + (ssize_t) sizeof (data_block->valid_bytes);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Enable or disable ping-pong acquisitions on a channel. See struct
+ * acq_pingpong_t */
+static int _acq_cfg_pingpong (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_cfg_pingpong\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: channel
+     * frame 3: ping-pong (0 -> disabled, 1 -> enabled) */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t pingpong = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    ASSERT_TEST(chan < SMIO_ACQ_NUM_CHANNELS, "Channel required is out of "
+            "the maximum limit", err_inv_param, -ACQ_NUM_CHAN_OOR);
+
+    if (rw) {
+        *((uint32_t *) ret) = acq->pingpong[chan].enabled ?
+            ACQ_PINGPONG_ENABLED : ACQ_PINGPONG_DISABLED;
+        return sizeof (uint32_t);
+    }
+
+    ASSERT_TEST(pingpong <= ACQ_PINGPONG_ENABLED, "Ping-pong option is not "
+            "valid", err_inv_param, -ACQ_ERR);
+    /* The acquisition in progress would be read from the wrong half */
+    ASSERT_TEST(!(acq->acq_pending && acq->curr_chan == chan) &&
+            !acq->pingpong[chan].pending, "Acquisition in progress. Cannot "
+            "change ping-pong mode", err_inv_param, -ACQ_NOT_COMPLETED);
+
+    acq->pingpong[chan].enabled = (pingpong == ACQ_PINGPONG_ENABLED);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] cfg_pingpong: "
+            "Ping-pong acquisitions %s on channel %u\n",
+            acq->pingpong[chan].enabled ? "enabled" : "disabled", chan);
+
+err_inv_param:
+err_get_acq_handler:
+    return err;
+}
+
+/* Same as _acq_get_data_block_var, for several channels at once. Blocks
+ * are returned in increasing channel order */
+static int _acq_get_data_block_multi (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_data_block_multi\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel mask
+     * frame 1: block required
+     * frame 2: block size of each channel */
+    uint32_t chan_mask = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_n = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t block_size_req = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block_multi: "
+            "chan_mask = 0x%08x, block_n = %u, block_size = %u\n", chan_mask,
+            block_n, block_size_req);
+
+    uint32_t num_chans = 0;
+    for (uint32_t chan = 0; chan < ACQ_MULTI_MAX_CHANS; ++chan) {
+        if (chan_mask & (1U << chan)) {
+            num_chans++;
+        }
+    }
+
+    if (num_chans == 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_multi: "
+                "No channel selected\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    /* All the blocks must fit in a single reply */
+    if (block_size_req < ACQ_BLOCK_SIZE_MIN ||
+            (block_size_req & (block_size_req - 1)) != 0 ||
+            (uint64_t) block_size_req * num_chans > acq->block_size_max) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_multi: "
+                "Block size %u is not valid for %u channels\n", block_size_req,
+                num_chans);
+        return -ACQ_BLOCK_SIZE_OOR;
+    }
+
+    smio_acq_data_block_multi_t *data_block = (smio_acq_data_block_multi_t *) ret;
+    memset (data_block->valid_bytes, 0, sizeof (data_block->valid_bytes));
+    data_block->chan_mask = chan_mask;
+    uint8_t *data = data_block->data;
+
+    for (uint32_t chan = 0; chan < ACQ_MULTI_MAX_CHANS; ++chan) {
+        if (!(chan_mask & (1U << chan))) {
+            continue;
+        }
+
+        uint64_t block_offs = 0;
+        uint32_t block_size = 0;
+        int err = _acq_get_block_params (acq, chan, block_n, block_size_req,
+                &block_offs, &block_size);
+        if (err != -ACQ_OK) {
+            return err;
+        }
+
+        ssize_t valid_bytes = _acq_read_block (self, acq, chan, block_offs,
+                block_size, data);
+        if (valid_bytes < 0) {
+            return -ACQ_COULD_NOT_READ;
+        }
+
+        data_block->valid_bytes [chan] = (uint32_t) valid_bytes;
+        data += valid_bytes;
+    }
+
+    return offsetof (smio_acq_data_block_multi_t, data) + (data - data_block->data);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+static int _acq_get_curve_info (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_curve_info\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_info: "
+            "chan = %u\n", chan);
+
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_curve_info: "
+                "Channel required is out of the maximum limit\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    if (acq->acq_params[chan].timestamp == 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_info: "
+                "Acquisition of channel %u is not completed\n", chan);
+        return -ACQ_NOT_COMPLETED;
+    }
+
+    smio_acq_curve_info_t *info = (smio_acq_curve_info_t *) ret;
+    _acq_get_curve_info_chan (acq, chan, info);
+
+    return sizeof (*info);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+static int _acq_get_trig_info (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_trig_info\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_trig_info: "
+            "chan = %u\n", chan);
+
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_trig_info: "
+                "Channel required is out of the maximum limit\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    smio_acq_trig_info_t *info = (smio_acq_trig_info_t *) ret;
+    _acq_get_trig_info_chan (acq, chan, info);
+
+    return sizeof (*info);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+static int _acq_get_trig_log (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_trig_log\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: operation code */
+    const acq_trig_log_t *log = &acq->trig_log;
+    smio_acq_trig_log_t *trig_log = (smio_acq_trig_log_t *) ret;
+    uint64_t num_entries = (log->count < ACQ_TRIG_LOG_SIZE) ? log->count :
+        ACQ_TRIG_LOG_SIZE;
+    uint64_t first = log->count - num_entries;
+
+    trig_log->count = log->count;
+    trig_log->num_entries = (uint32_t) num_entries;
+    trig_log->reserved = 0;
+    for (uint64_t i = 0; i < num_entries; ++i) {
+        trig_log->entries [i] = log->entries [(first + i) % ACQ_TRIG_LOG_SIZE];
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_trig_log: "
+            "%u entries returned\n", trig_log->num_entries);
+
+    return offsetof (smio_acq_trig_log_t, entries) +
+        num_entries * sizeof (trig_log->entries [0]);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+static int _acq_get_shot_index (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_shot_index\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_shot_index: "
+            "chan = %u\n", chan);
+
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_shot_index: "
+                "Channel required is out of the maximum limit\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    smio_acq_shot_index_t *index = (smio_acq_shot_index_t *) ret;
+    _acq_get_shot_index_chan (acq, chan, index);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_shot_index: "
+            "%u shots of %"PRIu64" bytes, %"PRIu64" valid bytes at offset %"PRIu64"\n",
+            index->num_shots, index->shot_size, index->valid_size,
+            index->valid_offs);
+
+    return sizeof (*index);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Same as _acq_get_data_block_var, but block indexes are counted from the
+ * start of a single shot of a multishot acquisition */
+static int _acq_get_shot_block (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_shot_block\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: shot required
+     * frame 2: block required
+     * frame 3: block size          */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t shot = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t block_n = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t block_size_req = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_shot_block: "
+            "chan = %u, shot = %u, block_n = %u, block_size = %u\n", chan,
+            shot, block_n, block_size_req);
+
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_shot_block: "
+                "Channel required is out of the maximum limit\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    if (block_size_req < ACQ_BLOCK_SIZE_MIN || block_size_req > acq->block_size_max ||
+            (block_size_req & (block_size_req - 1)) != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_shot_block: "
+                "Block size %u is not valid\n", block_size_req);
+        return -ACQ_BLOCK_SIZE_OOR;
+    }
+
+    smio_acq_shot_index_t index;
+    _acq_get_shot_index_chan (acq, chan, &index);
+    if (shot >= index.num_shots) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_shot_block: "
+                "Shot %u of channel %u is not valid\n", shot, chan);
+        return -ACQ_SHOT_OOR;
+    }
+
+    uint64_t offs = (uint64_t) block_n * block_size_req;
+    if (block_n > 0 && offs >= index.shot_size) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_shot_block: "
+                "Block %u of shot %u is not valid\n", block_n, shot);
+        return -ACQ_BLOCK_OOR;
+    }
+    uint32_t block_size = (index.shot_size - offs < block_size_req) ?
+        index.shot_size - offs : block_size_req;
+
+    smio_acq_data_block_var_t *data_block = (smio_acq_data_block_var_t *) ret;
+    ssize_t valid_bytes = _acq_read_block (self, acq, chan,
+            (uint64_t) shot * index.shot_size + offs, block_size, data_block->data);
+    if (valid_bytes < 0) {
+        data_block->valid_bytes = 0;
+        return -ACQ_COULD_NOT_READ;
+    }
+
+    data_block->valid_bytes = (uint32_t) valid_bytes;
+    return valid_bytes + (ssize_t) sizeof (data_block->valid_bytes);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Read "num_samples" samples of a shot, from sample "start" on, so a range
+ * of a large curve can be looked at without computing blocks. Samples are
+ * counted as read, alignment samples left out. At most block_size_max
+ * bytes, and never past the end of the shot, are returned */
+static int _acq_get_range (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_range\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: shot required
+     * frame 2: first sample
+     * frame 3: number of samples   */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t shot = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t start = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_samples = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_range: "
+            "chan = %u, shot = %u, start = %u, num_samples = %u\n", chan,
+            shot, start, num_samples);
+
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_range: "
+                "Channel required is out of the maximum limit\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    smio_acq_shot_index_t index;
+    _acq_get_shot_index_chan (acq, chan, &index);
+    if (shot >= index.num_shots) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_range: "
+                "Shot %u of channel %u is not valid\n", shot, chan);
+        return -ACQ_SHOT_OOR;
+    }
+
+    uint64_t offs = (uint64_t) start * index.sample_size;
+    if (num_samples == 0 || offs >= index.shot_size) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_range: "
+                "Range of %u samples at %u of shot %u is not valid\n",
+                num_samples, start, shot);
+        return -ACQ_NUM_SAMPLES_OOR;
+    }
+
+    uint64_t size = (uint64_t) num_samples * index.sample_size;
+    if (size > index.shot_size - offs) {
+        size = index.shot_size - offs;
+    }
+    /* Whole samples only */
+    uint32_t size_max = acq->block_size_max - acq->block_size_max % index.sample_size;
+    if (size > size_max) {
+        size = size_max;
+    }
+
+    smio_acq_data_block_var_t *data_block = (smio_acq_data_block_var_t *) ret;
+    ssize_t valid_bytes = _acq_read_block (self, acq, chan,
+            (uint64_t) shot * index.shot_size + offs, (uint32_t) size,
+            data_block->data);
+    if (valid_bytes < 0) {
+        data_block->valid_bytes = 0;
+        return -ACQ_COULD_NOT_READ;
+    }
+
+    data_block->valid_bytes = (uint32_t) valid_bytes;
+    return valid_bytes + (ssize_t) sizeof (data_block->valid_bytes);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Same as _acq_get_data_block_var, but the block is encoded with the codec
+ * the client asked for, if that makes it smaller */
+static int _acq_get_data_block_coded (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_data_block_coded\n");
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: block required
+     * frame 2: block size
+     * frame 3: codec               */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_n = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t block_size_req = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t codec = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block_coded: "
+            "chan = %u, block_n = %u, block_size = %u, codec = %u\n", chan,
+            block_n, block_size_req, codec);
+
+    if (codec >= ACQ_CODEC_END) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_coded: "
+                "Codec %u is not valid\n", codec);
+        return -ACQ_CODEC_INV;
+    }
+
+    if (block_size_req < ACQ_BLOCK_SIZE_MIN || block_size_req > acq->block_size_max ||
+            (block_size_req & (block_size_req - 1)) != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_coded: "
+                "Block size %u is not valid\n", block_size_req);
+        return -ACQ_BLOCK_SIZE_OOR;
+    }
+
+    uint64_t block_offs = 0;
+    uint32_t block_size = 0;
+    int err = _acq_get_block_params (acq, chan, block_n, block_size_req,
+            &block_offs, &block_size);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    smio_acq_data_block_coded_t *data_block = (smio_acq_data_block_coded_t *) ret;
+    uint32_t atom_size = acq->acq_buf[chan].sample_size / ACQ_REDUCE_NUM_ATOMS;
+    if ((atom_size != sizeof (uint16_t) && atom_size != sizeof (uint32_t)) ||
+            (codec == ACQ_CODEC_SCALED16 && atom_size != sizeof (uint32_t))) {
+        codec = ACQ_CODEC_NONE;
+    }
+
+    if (codec != ACQ_CODEC_NONE && acq->codec_buf == NULL) {
+        acq->codec_buf = (uint8_t *) malloc (ACQ_BLOCK_SIZE_MAX);
+        if (acq->codec_buf == NULL) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_data_block_coded: "
+                    "Could not allocate encoding buffer. Sending raw block\n");
+            codec = ACQ_CODEC_NONE;
+        }
+    }
+
+    /* Raw blocks are read straight to the reply */
+    uint8_t *raw = (codec == ACQ_CODEC_NONE) ? data_block->data : acq->codec_buf;
+    ssize_t valid_bytes = _acq_read_block (self, acq, chan, block_offs, block_size,
+            raw);
+    if (valid_bytes < 0) {
+        return -ACQ_COULD_NOT_READ;
+    }
+
+    data_block->codec = ACQ_CODEC_NONE;
+    data_block->atom_size = atom_size;
+    data_block->raw_bytes = (uint32_t) valid_bytes;
+    data_block->valid_bytes = (uint32_t) valid_bytes;
+
+    /* The codec only handles whole samples */
+    if (codec == ACQ_CODEC_DELTA && valid_bytes > 0 &&
+            valid_bytes % (atom_size * ACQ_REDUCE_NUM_ATOMS) == 0) {
+        /* Not worth it unless smaller than the raw data */
+        ssize_t coded_bytes = hutils_codec_delta_encode (data_block->data,
+                valid_bytes - 1, raw, valid_bytes, atom_size, ACQ_REDUCE_NUM_ATOMS);
+        if (coded_bytes >= 0) {
+            data_block->codec = ACQ_CODEC_DELTA;
+            data_block->valid_bytes = (uint32_t) coded_bytes;
+        }
+        else {
+            memcpy (data_block->data, raw, valid_bytes);
+        }
+    }
+    else if (codec == ACQ_CODEC_SCALED16 && valid_bytes > 0 &&
+            valid_bytes % (atom_size * ACQ_REDUCE_NUM_ATOMS) == 0) {
+        /* Smaller than the raw data, but for blocks of a few samples */
+        ssize_t coded_bytes = hutils_codec_scaled16_encode (data_block->data,
+                valid_bytes - 1, raw, valid_bytes, ACQ_REDUCE_NUM_ATOMS);
+        if (coded_bytes >= 0) {
+            data_block->codec = ACQ_CODEC_SCALED16;
+            data_block->valid_bytes = (uint32_t) coded_bytes;
+        }
+        else {
+            memcpy (data_block->data, raw, valid_bytes);
+        }
+    }
+    else if (codec != ACQ_CODEC_NONE) {
+        memcpy (data_block->data, raw, valid_bytes);
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block_coded: "
+            "%zd bytes sent as %u bytes with codec %u\n", valid_bytes,
+            data_block->valid_bytes, data_block->codec);
+
+    return offsetof (smio_acq_data_block_coded_t, data) + data_block->valid_bytes;
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Same as _acq_get_data_block_coded, but the block is preceded by its
+ * CRC32C, for clients to check it end to end */
+static int _acq_get_data_block_crc (void *owner, void *args, void *ret)
+{
+    assert (ret);
+
+    smio_acq_data_block_crc_t *crc_block = (smio_acq_data_block_crc_t *) ret;
+    int block_bytes = _acq_get_data_block_coded (owner, args, &crc_block->block);
+    if (block_bytes < 0) {
+        return block_bytes;
+    }
+
+    crc_block->crc = hutils_crc32c (0, &crc_block->block, block_bytes);
+    return offsetof (smio_acq_data_block_crc_t, block) + block_bytes;
+}
+
+/* Compute the statistics of the last acquisition of "chan" over "size"
+ * bytes of curve, "plan", read a chunk at a time. A second pass is done for
+ * the percentiles, if asked for */
+static int _acq_curve_stats_compute (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, uint64_t size, uint32_t flags,
+        smio_acq_atom_stats_t *stats)
+{
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    smio_acq_stats_acc_t acc [ACQ_REDUCE_NUM_ATOMS];
+    uint32_t *hist = NULL;
+    int err = -ACQ_OK;
+
+    if (acq->stats_buf == NULL) {
+        acq->stats_buf = (uint8_t *) malloc (ACQ_STATS_CHUNK_SIZE);
+        ASSERT_ALLOC(acq->stats_buf, err_exit, -ACQ_ERR);
+    }
+
+    smio_acq_stats_init (acc);
+    uint32_t num_passes = (flags & ACQ_STATS_FLAGS_PCTL) ? 2 : 1;
+    for (uint32_t pass = 0; pass < num_passes; ++pass) {
+        if (pass == 1) {
+            /* Nothing to bin */
+            if (acc [0].num == 0) {
+                break;
+            }
+
+            hist = (uint32_t *) zmalloc (ACQ_REDUCE_NUM_ATOMS *
+                    ACQ_STATS_HIST_BINS * sizeof (*hist));
+            ASSERT_ALLOC(hist, err_exit, -ACQ_ERR);
+        }
+
+        for (uint64_t offs = 0; offs < size; offs += ACQ_STATS_CHUNK_SIZE) {
+            uint32_t chunk_size = (size - offs < ACQ_STATS_CHUNK_SIZE) ?
+                size - offs : ACQ_STATS_CHUNK_SIZE;
+            ssize_t valid_bytes = _acq_read_block (self, acq, chan, offs,
+                    chunk_size, acq->stats_buf);
+            ASSERT_TEST(valid_bytes == (ssize_t) chunk_size, "Could not read "
+                    "curve for statistics", err_exit, -ACQ_COULD_NOT_READ);
+
+            if (pass == 0) {
+                int ret = smio_acq_stats_accumulate (acq->stats_ops, acc,
+                        acq->stats_buf, chunk_size, sample_size);
+                ASSERT_TEST(ret == 0, "Sample size not supported for "
+                        "statistics", err_exit, -ACQ_STATS_INV);
+            }
+            else {
+                smio_acq_stats_hist (hist, acc, acq->stats_buf, chunk_size,
+                        sample_size);
+            }
+        }
+    }
+
+    smio_acq_stats_finish (acc, hist, stats);
+
+err_exit:
+    free (hist);
+    return err;
+}
+
+/* Summary of the last acquisition of a channel, so clients do not need
+ * to read the whole curve for it */
+static int _acq_get_curve_stats (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_curve_stats\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: flags               */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t flags = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_stats: "
+            "chan = %u, flags = 0x%x\n", chan, flags);
+
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_curve_stats: "
+                "Channel required is out of the maximum limit\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    if ((flags & ~ACQ_STATS_FLAGS_ALL) != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_curve_stats: "
+                "Flags 0x%x are not valid\n", flags);
+        return -ACQ_STATS_INV;
+    }
+
+    if (acq->acq_params[chan].timestamp == 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_stats: "
+                "Acquisition of channel %u is not completed\n", chan);
+        return -ACQ_NOT_COMPLETED;
+    }
+
+    const acq_plan_t *plan = _acq_get_plan (acq, chan);
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    smio_acq_curve_stats_t *stats = (smio_acq_curve_stats_t *) ret;
+
+    stats->seq = acq->acq_params[chan].seq;
+    stats->chan = chan;
+    stats->num_samples = plan->size / sample_size;
+    stats->atom_size = sample_size / ACQ_REDUCE_NUM_ATOMS;
+
+    int err = _acq_curve_stats_compute (self, acq, chan,
+            (uint64_t) stats->num_samples * sample_size, flags, stats->atom);
+    if (err != -ACQ_OK) {
+        return err;
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_curve_stats: "
+            "Statistics of %u samples of acquisition #%u computed\n",
+            stats->num_samples, stats->seq);
+
+    return sizeof (*stats);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Build the envelope pyramid of the last acquisition of "chan", of
+ * "num_samples" samples, replacing the one of the previous curve */
+static int _acq_env_pyr_build (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, uint64_t num_samples)
+{
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    uint64_t size = num_samples * sample_size;
+    int err = -ACQ_OK;
+
+    smio_acq_pyr_destroy (&acq->pyr);
+    smio_acq_pyr_t *pyr = smio_acq_pyr_new (chan, acq->acq_params[chan].seq,
+            num_samples);
+    ASSERT_ALLOC(pyr, err_pyr_alloc, -ACQ_ERR);
+
+    for (uint64_t offs = 0; offs < size; offs += ACQ_STATS_CHUNK_SIZE) {
+        uint32_t chunk_size = (size - offs < ACQ_STATS_CHUNK_SIZE) ?
+            size - offs : ACQ_STATS_CHUNK_SIZE;
+        ssize_t valid_bytes = _acq_read_block (self, acq, chan, offs,
+                chunk_size, acq->stats_buf);
+        ASSERT_TEST(valid_bytes == (ssize_t) chunk_size, "Could not read "
+                "curve for envelope pyramid", err_read, -ACQ_COULD_NOT_READ);
+
+        int ret = smio_acq_pyr_accumulate (pyr, acq->stats_ops,
+                offs / sample_size, acq->stats_buf, chunk_size, sample_size);
+        ASSERT_TEST(ret == 0, "Sample size not supported for envelope",
+                err_read, -ACQ_STATS_INV);
+    }
+
+    smio_acq_pyr_build (pyr);
+    acq->pyr = pyr;
+    return err;
+
+err_read:
+    smio_acq_pyr_destroy (&pyr);
+err_pyr_alloc:
+    return err;
+}
+
+/* Envelope of a range of the last acquisition of "chan", computed from the
+ * curve itself, "env" bucket layout already set */
+static int _acq_env_compute (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, smio_acq_envelope_t *env)
+{
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    uint64_t offs_start = (uint64_t) env->start * sample_size;
+    uint64_t size = (uint64_t) env->num_samples * sample_size;
+    int err = -ACQ_OK;
+
+    smio_acq_stats_acc_t *acc = (smio_acq_stats_acc_t *) malloc (env->num_buckets *
+            ACQ_REDUCE_NUM_ATOMS * sizeof (*acc));
+    ASSERT_ALLOC(acc, err_acc_alloc, -ACQ_ERR);
+    for (uint32_t b = 0; b < env->num_buckets; ++b) {
+        smio_acq_stats_init (acc + b*ACQ_REDUCE_NUM_ATOMS);
+    }
+
+    for (uint64_t offs = 0; offs < size; offs += ACQ_STATS_CHUNK_SIZE) {
+        uint32_t chunk_size = (size - offs < ACQ_STATS_CHUNK_SIZE) ?
+            size - offs : ACQ_STATS_CHUNK_SIZE;
+        ssize_t valid_bytes = _acq_read_block (self, acq, chan,
+                offs_start + offs, chunk_size, acq->stats_buf);
+        ASSERT_TEST(valid_bytes == (ssize_t) chunk_size, "Could not read "
+                "curve for envelope", err_read, -ACQ_COULD_NOT_READ);
+
+        int ret = smio_acq_env_accumulate (acq->stats_ops, acc,
+                env->bucket_samples, offs / sample_size, acq->stats_buf,
+                chunk_size, sample_size);
+        ASSERT_TEST(ret == 0, "Sample size not supported for envelope",
+                err_read, -ACQ_STATS_INV);
+    }
+
+    for (uint32_t b = 0; b < env->num_buckets; ++b) {
+        smio_acq_env_finish (acc + b*ACQ_REDUCE_NUM_ATOMS, &env->buckets [b]);
+    }
+
+err_read:
+    free (acc);
+err_acc_alloc:
+    return err;
+}
+
+/* Min/max/mean envelope of a range of the last acquisition of a channel, so
+ * long curves can be plotted, and zoomed into, without reading them */
+static int _acq_get_envelope (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_envelope\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: channel
+     * frame 1: first sample
+     * frame 2: number of samples
+     * frame 3: number of buckets
+     * frame 4: flags               */
+    uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t start = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_samples = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t num_buckets = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    uint32_t flags = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_envelope: "
+            "chan = %u, start = %u, num_samples = %u, num_buckets = %u, "
+            "flags = 0x%x\n", chan, start, num_samples, num_buckets, flags);
+
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_envelope: "
+                "Channel required is out of the maximum limit\n");
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    if ((flags & ~ACQ_ENV_FLAGS_ALL) != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_envelope: "
+                "Flags 0x%x are not valid\n", flags);
+        return -ACQ_ENV_INV;
+    }
+
+    if (acq->acq_params[chan].timestamp == 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_envelope: "
+                "Acquisition of channel %u is not completed\n", chan);
+        return -ACQ_NOT_COMPLETED;
+    }
+
+    const acq_plan_t *plan = _acq_get_plan (acq, chan);
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    uint64_t curve_samples = plan->size / sample_size;
+
+    /* The range is clipped to the end of the curve */
+    if (num_samples == 0 || start >= curve_samples ||
+            num_buckets == 0 || num_buckets > ACQ_ENV_MAX_BUCKETS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_envelope: "
+                "%u buckets of %u samples at %u are not valid\n",
+                num_buckets, num_samples, start);
+        return -ACQ_ENV_INV;
+    }
+    if (num_samples > curve_samples - start) {
+        num_samples = curve_samples - start;
+    }
+
+    if (acq->stats_buf == NULL) {
+        acq->stats_buf = (uint8_t *) malloc (ACQ_STATS_CHUNK_SIZE);
+        ASSERT_ALLOC(acq->stats_buf, err_get_acq_handler);
+    }
+
+    smio_acq_envelope_t *env = (smio_acq_envelope_t *) ret;
+    env->seq = acq->acq_params[chan].seq;
+    env->chan = chan;
+    env->start = start;
+    env->num_samples = num_samples;
+    env->bucket_samples = (num_samples + num_buckets - 1) / num_buckets;
+    env->num_buckets = (num_samples + env->bucket_samples - 1) / env->bucket_samples;
+    env->atom_size = sample_size / ACQ_REDUCE_NUM_ATOMS;
+    env->flags = 0;
+
+    int err = -ACQ_OK;
+    /* Buckets smaller than the cells of the pyramid are read from the curve */
+    bool use_pyr = (flags & ACQ_ENV_FLAGS_PYRAMID) &&
+            env->bucket_samples >= ACQ_ENV_PYR_CELL_SAMPLES;
+    if (use_pyr && !smio_acq_pyr_match (acq->pyr, chan, env->seq)) {
+        err = _acq_env_pyr_build (self, acq, chan, curve_samples);
+        if (err != -ACQ_OK) {
+            return err;
+        }
+    }
+    use_pyr = use_pyr &&
+            env->bucket_samples >= smio_acq_pyr_cell_samples (acq->pyr);
+
+    if (use_pyr) {
+        for (uint32_t b = 0; b < env->num_buckets; ++b) {
+            uint64_t bucket_start = (uint64_t) b * env->bucket_samples;
+            uint64_t bucket_samples = (num_samples - bucket_start < env->bucket_samples) ?
+                num_samples - bucket_start : env->bucket_samples;
+            smio_acq_stats_acc_t acc [ACQ_REDUCE_NUM_ATOMS];
+
+            smio_acq_stats_init (acc);
+            smio_acq_pyr_query (acq->pyr, start + bucket_start, bucket_samples, acc);
+            smio_acq_env_finish (acc, &env->buckets [b]);
+        }
+        env->flags = ACQ_ENV_FLAGS_PYRAMID;
+    }
+    else {
+        err = _acq_env_compute (self, acq, chan, env);
+        if (err != -ACQ_OK) {
+            return err;
+        }
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_envelope: "
+            "%u buckets of %u samples of acquisition #%u computed%s\n",
+            env->num_buckets, env->bucket_samples, env->seq,
+            (env->flags & ACQ_ENV_FLAGS_PYRAMID) ? " from pyramid" : "");
+
+    return offsetof (smio_acq_envelope_t, buckets) +
+        env->num_buckets * sizeof (smio_acq_env_bucket_t);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+static int _acq_block_size_max (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_block_size_max\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: maximum block size
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t block_size_max = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = acq->block_size_max;
+        err = sizeof (acq->block_size_max);
+    }
+    else {
+        ASSERT_TEST(block_size_max >= ACQ_BLOCK_SIZE_MIN &&
+                block_size_max <= ACQ_BLOCK_SIZE_MAX &&
+                (block_size_max & (block_size_max - 1)) == 0,
+                "Maximum block size is not valid", err_inv_block_size,
+                -ACQ_BLOCK_SIZE_OOR);
+        acq->block_size_max = block_size_max;
+    }
+
+err_inv_block_size:
+err_get_acq_handler:
+    return err;
+}
+
+/* Send a streamed block through the broker to "peer", if set, or to the
+ * requester or, if "direct_sock" is set, to "peer" through the direct data
+ * path */
+static int _acq_stream_send_block (mlm_client_t *worker, zsock_t *direct_sock,
+        const char *peer, smio_acq_stream_hdr_t *hdr, zframe_t **data_frame)
+{
+    int err = -ACQ_OK;
+
+    /* Message is:
+     * frame 0: stream header
+     * frame 1: data */
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, -ACQ_ERR);
+    int zerr = zmsg_addmem (msg, hdr, sizeof (*hdr));
+    ASSERT_TEST(zerr == 0, "Could not add stream header to message",
+            err_msg_add, -ACQ_ERR);
+    zerr = zmsg_append (msg, data_frame);
+    ASSERT_TEST(zerr == 0, "Could not add stream data to message",
+            err_msg_add, -ACQ_ERR);
+
+    if (direct_sock == NULL) {
+        mlm_client_sendto (worker, (peer != NULL) ? peer : mlm_client_sender (worker),
+                NULL, NULL, 0, &msg);
+        return err;
+    }
+
+    /* The ROUTER socket routes the message by the identity frame */
+    zerr = zmsg_pushstr (msg, peer);
+    ASSERT_TEST(zerr == 0, "Could not add peer identity to message",
+            err_msg_add, -ACQ_ERR);
+    zerr = zmsg_send (&msg, direct_sock);
+    if (zerr != 0) {
+        int send_errno = errno;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] stream_send_block: "
+                "Could not push block to peer %s: %s\n", peer, strerror (send_errno));
+        err = (send_errno == EHOSTUNREACH) ? -ACQ_PEER_UNREACH : -ACQ_ERR;
+        zmsg_destroy (&msg);
+    }
+    return err;
+
+err_msg_add:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    zframe_destroy (data_frame);
+    return err;
+}
+
+/* Get the address of the first sample of the last acquisition of "chan" */
+static uint64_t _acq_get_curve_start_addr (smio_acq_t *acq, uint32_t chan)
+{
+    uint32_t channel_sample_size = acq->acq_buf[chan].sample_size;
+    uint32_t num_samples_pre = acq->acq_params[chan].num_samples_pre;
+    uint32_t num_samples_shot = num_samples_pre +
+        acq->acq_params[chan].num_samples_post;
+    uint32_t num_shots = acq->acq_params[chan].num_shots;
+
+    /* First step if to get the trigger address from the channel. 
+     * Even on skip trigger mode, this will contain the address after 
      * the last valid sample (end of acquisition address) */
     uint32_t acq_core_trig_addr = acq->acq_params[chan].trig_addr;
 
@@ -411,55 +2900,685 @@ static int _acq_get_data_block (void *owner, void *args, void *ret)
             num_samples_pre)*channel_sample_size;
     /* Our "end address" is the start of the last valid address available for a
      * sample. So, our "end address" needs to be accounted for one sample more */
-    uint32_t end_mem_space_addr = channel_end_addr + channel_sample_size;
+    uint64_t start_mem_space_addr = 0;
+    uint64_t end_mem_space_addr = 0;
+    _acq_get_region (acq, chan, acq->acq_params[chan].half,
+            &start_mem_space_addr, &end_mem_space_addr);
+    end_mem_space_addr += channel_sample_size;
 
     /* Third step is to get the absolute start address of the acquisition, taking
      * care for wraps in the beginning of the current memory space */
-    uint64_t start_addr = _acq_get_start_address (acq_core_trig_addr,
-            acq_size_bytes, channel_start_addr, end_mem_space_addr);
-
-    /* Forth step is to calculate the offset from the start_addr, taking care
-     * for wraps in the end of the current memory space */
-    uint64_t addr_i = _acq_get_read_block_addr (start_addr, block_n * BLOCK_SIZE,
-            channel_start_addr, end_mem_space_addr);
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block:\n"
-            "\tBlock %u of channel %u:\n"
-            "\tChannel start address = 0x%08x,\n"
-            "\tTrigger address = 0x%08x,\n"
-            "\tAcquisition read start address\n"
-            "\t\t(trig_addr - ((num_samples_pre+num_samples_post)*(num_shots-1)\n"
-            "\t\t+ num_samples_pre)*sample_size = 0x%"PRIx64 ",\n"
-            "\tCurrent block start address (read_start_addr + block_n*BLOCK_SIZE) = 0x%"PRIx64 "\n",
-            block_n, chan,
-            channel_start_addr,
-            acq_core_trig_addr,
-            start_addr,
-            addr_i);
+    return _acq_get_start_address (acq_core_trig_addr, acq_size_bytes,
+            start_mem_space_addr, end_mem_space_addr);
+}
 
-    smio_acq_data_block_t *data_block = (smio_acq_data_block_t *) ret;
+/* Get the bounds of "half" of the memory of "chan", or of the whole memory
+ * for ACQ_MEM_WHOLE. As in acq_buf_t, "end_addr" is the start of the last
+ * sample */
+static void _acq_get_region (smio_acq_t *acq, uint32_t chan, uint32_t half,
+        uint64_t *start_addr, uint64_t *end_addr)
+{
+    const acq_buf_t *buf = &acq->acq_buf[chan];
+
+    switch (half) {
+        case 0:
+            *start_addr = buf->start_addr;
+            *end_addr = buf->split_addr - buf->sample_size;
+            break;
+        case 1:
+            *start_addr = buf->split_addr;
+            *end_addr = buf->end_addr;
+            break;
+        default:
+            *start_addr = buf->start_addr;
+            *end_addr = buf->end_addr;
+            break;
+    }
+}
 
-    /* Here we must use the "raw" version, as we can't have
-     * LARGE_MEM_ADDR mangled with the bas address of this SMIO */
-    ssize_t valid_bytes = smio_thsafe_raw_client_read_block (self, LARGE_MEM_ADDR | addr_i,
-            reply_size, (uint32_t *) data_block->data);
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] get_data_block: "
-            "%ld bytes read\n", valid_bytes);
+/* Compute where the curve of the last acquisition of "chan" is in the channel
+ * memory. Done once per acquisition, so reading a block is a simple lookup */
+static void _acq_plan_compute (smio_acq_t *acq, uint32_t chan)
+{
+    acq_plan_t *plan = &acq->acq_params[chan].plan;
+    uint64_t channel_start_addr = 0;
+    uint64_t end_mem_space_addr = 0;
+    _acq_get_region (acq, chan, acq->acq_params[chan].half,
+            &channel_start_addr, &end_mem_space_addr);
+    /* Our "end address" is the start of the last valid address available for a
+     * sample. So, our "end address" needs to be accounted for one sample more */
+    end_mem_space_addr += acq->acq_buf[chan].sample_size;
+    uint64_t start_addr = _acq_get_curve_start_addr (acq, chan);
+    const acq_params_t *params = &acq->acq_params[chan];
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+
+    plan->shot_stride = (uint64_t) (params->num_samples_pre +
+            params->num_samples_post) * sample_size;
+    uint64_t acq_size = plan->shot_stride * params->num_shots;
+
+    /* The curve wraps around the end of the channel memory if it does not
+     * fit before it */
+    plan->ext_addr [0] = start_addr;
+    plan->ext_size [0] = end_mem_space_addr - start_addr;
+    if (plan->ext_size [0] >= acq_size) {
+        plan->ext_size [0] = acq_size;
+        plan->num_ext = 1;
+    }
+    else {
+        plan->ext_addr [1] = channel_start_addr;
+        plan->ext_size [1] = acq_size - plan->ext_size [0];
+        plan->num_ext = 2;
+    }
+
+    /* Only the window requested of each shot is read */
+    uint32_t pre_req = 0;
+    uint32_t post_req = 0;
+    _acq_get_window (params, &pre_req, &post_req);
+    plan->shot_offs = (uint64_t) (params->num_samples_pre - pre_req) * sample_size;
+    plan->shot_size = (uint64_t) (pre_req + post_req) * sample_size;
+    plan->size = plan->shot_size * params->num_shots;
+    plan->valid = true;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] plan_compute: "
+            "Curve of channel %u has %"PRIu64" bytes at 0x%"PRIx64" (%"PRIu64
+            " bytes) and 0x%"PRIx64" (%"PRIu64" bytes), %"PRIu64" of them "
+            "requested\n", chan, acq_size, plan->ext_addr [0], plan->ext_size [0],
+            (plan->num_ext > 1) ? plan->ext_addr [1] : 0,
+            (plan->num_ext > 1) ? plan->ext_size [1] : 0, plan->size);
+}
+
+/* Samples requested of each shot of the last acquisition of a channel: the
+ * last "pre_req" pre-trigger and the first "post_req" post-trigger ones.
+ * Alignment only ever adds samples, but the defaults set at start up are not
+ * aligned */
+static void _acq_get_window (const acq_params_t *params, uint32_t *pre_req,
+        uint32_t *post_req)
+{
+    *pre_req = (params->num_samples_pre_req < params->num_samples_pre) ?
+        params->num_samples_pre_req : params->num_samples_pre;
+    *post_req = (params->num_samples_post_req < params->num_samples_post) ?
+        params->num_samples_post_req : params->num_samples_post;
+}
+
+static const acq_plan_t *_acq_get_plan (smio_acq_t *acq, uint32_t chan)
+{
+    if (!acq->acq_params[chan].plan.valid) {
+        _acq_plan_compute (acq, chan);
+    }
+
+    return &acq->acq_params[chan].plan;
+}
+
+/* Record the completion of the acquisition of "chan": its trigger address,
+ * readout plan and timestamp, and log it. Completion may be detected by
+ * both the poll and the clients, so only the first call does anything */
+static void _acq_complete_chan (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan)
+{
+    acq_params_t *params = &acq->acq_params[chan];
+    acq_pingpong_t *pingpong = &acq->pingpong[chan];
+    if (pingpong->pending) {
+        /* The last acquisition is replaced only now */
+        *params = pingpong->next;
+        pingpong->pending = false;
+        if (acq->cache != NULL) {
+            smio_acq_cache_invalidate (acq->cache, chan);
+        }
+    }
+
+    if (params->timestamp != 0) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+    params->timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+    uint32_t acq_core_trig_addr;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_TRIG_POS, &acq_core_trig_addr);
+    params->trig_addr = acq_core_trig_addr;
+    _acq_plan_compute (acq, chan);
+
+    /* All of the curve can be read now */
+    acq_early_t *early = &acq->early;
+    if (early->info.chan == chan && early->info.seq == params->seq) {
+        if (early->info.timestamp == 0) {
+            early->info.timestamp = params->timestamp;
+        }
+        early->info.trig_addr = params->trig_addr;
+        early->info.done = 1;
+        early->info.size = params->plan.size;
+        early->enabled = false;
+    }
+
+    acq_trig_log_t *log = &acq->trig_log;
+    _acq_get_curve_info_chan (acq, chan,
+            &log->entries [log->count % ACQ_TRIG_LOG_SIZE]);
+    log->count++;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] complete_chan: "
+            "Acquisition #%u of channel %u completed at %"PRIu64" ns, trigger "
+            "address 0x%08x\n", params->seq, chan, params->timestamp,
+            params->trig_addr);
+
+    /* The curve is recorded from the next polls on */
+    if (acq->pm.chan_mask & (1U << chan)) {
+        acq->pm.pending_mask |= (1U << chan);
+        smio_set_poll_interval (self, ACQ_EVENT_POLL_INTERVAL);
+    }
+
+    /* And published */
+    if (acq->mcast.chan_mask & (1U << chan)) {
+        acq->mcast.pending_mask |= (1U << chan);
+        smio_set_poll_interval (self, ACQ_EVENT_POLL_INTERVAL);
+    }
+
+    _acq_status_update (self, acq);
+}
+
+/* Update our section of the status page with the FSM state and the
+ * acquisitions completed */
+static void _acq_status_update (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    smio_status_page_t *status = smio_get_status_page (self);
+    uint32_t inst_id = smio_get_inst_id (self);
+    if (status == NULL || inst_id >= SMIO_STATUS_MAX_INST) {
+        return;
+    }
+
+    uint32_t acq_core_sta = 0;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_STA, &acq_core_sta);
+
+    const acq_trig_log_t *log = &acq->trig_log;
+    const smio_acq_curve_info_t *last = (log->count > 0) ?
+        &log->entries [(log->count - 1) % ACQ_TRIG_LOG_SIZE] : NULL;
+
+    smio_status_acq_t *sect = &status->acq [inst_id];
+    devio_status_write_begin (&sect->hdr);
+    sect->fsm_state = ACQ_CORE_STA_FSM_STATE_R(acq_core_sta);
+    sect->acq_pending = acq->acq_pending;
+    sect->curr_chan = acq->curr_chan;
+    sect->last_seq = (last != NULL) ? last->seq : 0;
+    sect->num_acqs = log->count;
+    sect->last_timestamp = (last != NULL) ? last->timestamp : 0;
+    devio_status_write_end (&sect->hdr);
+}
+
+static void _acq_get_curve_info_chan (smio_acq_t *acq, uint32_t chan,
+        smio_acq_curve_info_t *info)
+{
+    const acq_params_t *params = &acq->acq_params[chan];
+    /* As read, alignment samples are left out */
+    uint32_t pre_req = 0;
+    uint32_t post_req = 0;
+    _acq_get_window (params, &pre_req, &post_req);
+
+    info->timestamp = params->timestamp;
+    info->seq = params->seq;
+    info->chan = chan;
+    info->trig_addr = params->trig_addr;
+    info->num_samples_pre = pre_req;
+    info->num_samples_post = post_req;
+    info->num_shots = params->num_shots;
+}
+
+static void _acq_get_shot_index_chan (smio_acq_t *acq, uint32_t chan,
+        smio_acq_shot_index_t *index)
+{
+    const acq_params_t *params = &acq->acq_params[chan];
+    uint32_t sample_size = acq->acq_buf[chan].sample_size;
+    uint32_t pre_req = 0;
+    uint32_t post_req = 0;
+    _acq_get_window (params, &pre_req, &post_req);
+
+    index->seq = params->seq;
+    index->chan = chan;
+    index->num_shots = params->num_shots;
+    index->sample_size = sample_size;
+    index->num_samples_pre = params->num_samples_pre;
+    index->num_samples_post = params->num_samples_post;
+    index->num_samples_pre_req = pre_req;
+    index->num_samples_post_req = post_req;
+    /* Shots are read without their alignment samples */
+    index->shot_size = (uint64_t) (pre_req + post_req) * sample_size;
+    index->valid_offs = 0;
+    index->valid_size = index->shot_size;
+}
+
+static int _acq_get_block_params (smio_acq_t *acq, uint32_t chan,
+        uint32_t block_n, uint32_t block_size_max, uint64_t *block_offs,
+        uint32_t *block_size)
+{
+    /* channel required is out of the limit */
+    if (chan > SMIO_ACQ_NUM_CHANNELS-1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] get_block_params: "
+                "Channel required is out of the maximum limit\n");
+
+        return -ACQ_NUM_CHAN_OOR;
+    }
+
+    const acq_plan_t *plan = _acq_get_plan (acq, chan);
+    uint64_t offs = (uint64_t) block_n * block_size_max;
+
+    /* check if block required is valid and if it is full or not */
+    if (block_n > 0 && offs >= plan->size) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] get_block_params: "
+                "Block %u of channel %u is not valid\n", block_n, chan);
+        return -ACQ_BLOCK_OOR;
+    }
+
+    *block_offs = offs;
+    *block_size = (plan->size - offs < block_size_max) ?
+        plan->size - offs : block_size_max;
+
+    return -ACQ_OK;
+}
+
+/* Read "block_size" bytes at offset "block_offs" of the curve of channel
+ * "chan". The blocks read are kept in the cache for the other clients */
+static ssize_t _acq_read_block (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t chan, uint64_t block_offs, uint32_t block_size, uint8_t *data)
+{
+    const acq_plan_t *plan = _acq_get_plan (acq, chan);
+    uint32_t seq = acq->acq_params[chan].seq;
+
+    /* Data of an acquisition in progress can not be cached. On ping-pong,
+     * the data read is the last acquisition, not the one in progress */
+    bool cacheable = acq->cache != NULL &&
+        !(acq->acq_pending && acq->curr_chan == chan &&
+                !acq->pingpong[chan].pending) &&
+        !(acq->ring.seg_addr != NULL && acq->ring.chan == chan);
+    if (cacheable && smio_acq_cache_get (acq->cache, chan, seq, block_offs,
+                block_size, data)) {
+        return block_size;
+    }
+
+    ssize_t valid_bytes = _acq_read_plan (self, plan, block_offs, block_size,
+            data);
+
+    if (cacheable && valid_bytes == (ssize_t) block_size) {
+        smio_acq_cache_put (acq->cache, chan, seq, plan->size, block_offs,
+                block_size, data);
+    }
+
+    return valid_bytes;
+}
+
+/* Read "block_size" bytes at offset "block_offs" of the curve laid out
+ * as "plan", i.e., of the samples requested of its shots */
+static ssize_t _acq_read_plan (SMIO_OWNER_TYPE *self, const acq_plan_t *plan,
+        uint64_t block_offs, uint32_t block_size, uint8_t *data)
+{
+    if (plan->shot_size == plan->shot_stride) {
+        return _acq_read_plan_ext (self, plan, block_offs, block_size, data);
+    }
+
+    /* One read per shot the block spans */
+    ssize_t valid_bytes = 0;
+    while ((uint32_t) valid_bytes < block_size) {
+        uint64_t offs = block_offs + valid_bytes;
+        uint64_t shot = offs / plan->shot_size;
+        uint64_t shot_offs = offs % plan->shot_size;
+        uint32_t size = block_size - valid_bytes;
+        if (size > plan->shot_size - shot_offs) {
+            size = plan->shot_size - shot_offs;
+        }
+
+        ssize_t ret = _acq_read_plan_ext (self, plan, shot * plan->shot_stride +
+                plan->shot_offs + shot_offs, size, data + valid_bytes);
+        if (ret < 0) {
+            return ret;
+        }
+
+        valid_bytes += ret;
+        if (ret < size) {
+            break;
+        }
+    }
+
+    return valid_bytes;
+}
+
+/* Read "block_size" bytes at offset "block_offs" of the extents of "plan",
+ * alignment samples included */
+static ssize_t _acq_read_plan_ext (SMIO_OWNER_TYPE *self, const acq_plan_t *plan,
+        uint64_t block_offs, uint32_t block_size, uint8_t *data)
+{
+    /* A block that spans both extents is read with a single vectored
+     * transfer, if it fits in one */
+    if (block_size <= ZMQ_SERVER_BLOCK_SIZE) {
+        ssize_t valid_bytes = _acq_read_plan_v (self, plan, block_offs,
+                block_size, data);
+        if (valid_bytes == (ssize_t) block_size) {
+            return valid_bytes;
+        }
+    }
+
+    /* A block spans both extents at most */
+    ssize_t valid_bytes = 0;
+    uint64_t offs = block_offs;
+    for (uint32_t i = 0; i < plan->num_ext && valid_bytes < block_size; ++i) {
+        if (offs >= plan->ext_size [i]) {
+            offs -= plan->ext_size [i];
+            continue;
+        }
+
+        uint64_t ext_end = plan->ext_addr [i] + plan->ext_size [i];
+        uint32_t size = block_size - valid_bytes;
+        if (size > plan->ext_size [i] - offs) {
+            size = plan->ext_size [i] - offs;
+        }
+
+        ssize_t ret = _acq_read_block_win (self, plan->ext_addr [i], ext_end,
+                plan->ext_addr [i] + offs, size, data + valid_bytes);
+        if (ret < 0) {
+            return ret;
+        }
+
+        valid_bytes += ret;
+        if (ret < size) {
+            break;
+        }
+        offs = 0;
+    }
+
+    return valid_bytes;
+}
+
+/* Read a block that spans the extents of "plan" with a single vectored
+ * transfer. Returns 0 if the block lies within a single extent, as it takes
+ * a single transfer anyway, and a negative number if the DEVIO can't do
+ * vectored reads */
+static ssize_t _acq_read_plan_v (SMIO_OWNER_TYPE *self, const acq_plan_t *plan,
+        uint64_t block_offs, uint32_t block_size, uint8_t *data)
+{
+    llio_iov_t iov [ACQ_PLAN_MAX_EXTENTS];
+    size_t iovcnt = 0;
+    uint32_t size_rem = block_size;
+    uint64_t offs = block_offs;
+
+    for (uint32_t i = 0; i < plan->num_ext && size_rem > 0; ++i) {
+        if (offs >= plan->ext_size [i]) {
+            offs -= plan->ext_size [i];
+            continue;
+        }
+
+        uint32_t size = size_rem;
+        if (size > plan->ext_size [i] - offs) {
+            size = plan->ext_size [i] - offs;
+        }
+
+        /* Raw addresses, as LARGE_MEM_ADDR must not be mangled with the
+         * base address of this SMIO */
+        iov [iovcnt++] = (llio_iov_t) {
+            .offs = LARGE_MEM_ADDR | (plan->ext_addr [i] + offs),
+            .size = size,
+            .data = (uint32_t *) (data + (block_size - size_rem))
+        };
+        size_rem -= size;
+        offs = 0;
+    }
+
+    if (iovcnt < 2 || size_rem > 0) {
+        return 0;
+    }
+
+    ssize_t valid_bytes = smio_thsafe_raw_client_read_blockv (self, iov, iovcnt);
+    if (valid_bytes < 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] read_block: "
+                "Vectored read failed. Falling back to one read per extent\n");
+    }
+
+    return valid_bytes;
+}
+
+/* Same as _acq_read_block, but wrapping around the given memory space */
+static ssize_t _acq_read_block_win (SMIO_OWNER_TYPE *self,
+        uint64_t start_mem_space_addr, uint64_t end_mem_space_addr,
+        uint64_t block_addr, uint32_t block_size, uint8_t *data)
+{
+    /* Blocks can be larger than what a single thsafe transfer carries and
+     * can wrap around the end of the channel memory space, so read them
+     * in chunks */
+    uint64_t addr = block_addr;
+    ssize_t total_bytes = 0;
+
+    while ((uint32_t) total_bytes < block_size) {
+        uint32_t chunk_size = block_size - total_bytes;
+        chunk_size = (chunk_size > ZMQ_SERVER_BLOCK_SIZE) ? ZMQ_SERVER_BLOCK_SIZE :
+            chunk_size;
+        chunk_size = (addr + chunk_size > end_mem_space_addr) ?
+            end_mem_space_addr - addr : chunk_size;
+
+        /* Here we must use the "raw" version, as we can't have
+         * LARGE_MEM_ADDR mangled with the bas address of this SMIO.
+         * Try DMA first and fallback to regular block reads if the
+         * device does not support it */
+        ssize_t valid_bytes = smio_thsafe_raw_client_read_dma (self, LARGE_MEM_ADDR | addr,
+                chunk_size, (uint32_t *) (data + total_bytes));
+        if (valid_bytes < 0) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] read_block: "
+                    "DMA read failed. Falling back to block read\n");
+            valid_bytes = smio_thsafe_raw_client_read_block (self, LARGE_MEM_ADDR | addr,
+                    chunk_size, (uint32_t *) (data + total_bytes));
+        }
+
+        if (valid_bytes <= 0) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] read_block: "
+                    "Could not read from address 0x%"PRIx64 "\n", addr);
+            return -1;
+        }
+
+        total_bytes += valid_bytes;
+        addr += valid_bytes;
+        if (addr >= end_mem_space_addr) {
+            addr = start_mem_space_addr + (addr - end_mem_space_addr);
+        }
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] read_block: "
+            "%ld bytes read\n", total_bytes);
+
+    return total_bytes;
+}
+
+/* Start the next channel of a multi-channel acquisition */
+static void _acq_multi_start_next (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    uint32_t chan = 0;
+    while (!(acq->multi.pending_mask & (1U << chan))) {
+        chan++;
+    }
+
+    acq->multi.pending_mask &= ~(1U << chan);
+    _acq_start_chan (self, acq, chan, acq->multi.num_samples_pre,
+            acq->multi.num_samples_post, acq->multi.num_shots);
+}
+
+/* Start acquiring the segment after the last one acquired */
+static void _acq_ring_arm (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    acq_ring_t *ring = &acq->ring;
+    uint32_t sample_size = acq->acq_buf[ring->chan].sample_size;
+    uint64_t seg_bytes = (uint64_t) ring->seg_samples * sample_size;
+    uint32_t seg = (ring->head / ring->seg_samples) % ring->num_segs;
+
+    /* Our "end address" is the start of the last sample of the segment */
+    uint32_t start_addr = ring->win_start + seg * seg_bytes;
+    uint32_t end_addr = start_addr + seg_bytes - sample_size;
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_DDR3_START_ADDR, &start_addr);
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_DDR3_END_ADDR, &end_addr);
+
+    uint32_t acq_core_ctl_reg = 0;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+    acq_core_ctl_reg |= ACQ_CORE_CTL_FSM_START_ACQ;
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+}
+
+/* Account for the segment being acquired, if it is done, and start
+ * the next one */
+static void _acq_ring_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    int err = _acq_check_status (self, ACQ_CORE_COMPLETE_MASK,
+            ACQ_CORE_COMPLETE_VALUE);
+    if (err != -ACQ_OK) {
+        return;
+    }
+
+    acq_ring_t *ring = &acq->ring;
+    uint32_t sample_size = acq->acq_buf[ring->chan].sample_size;
+    uint64_t seg_bytes = (uint64_t) ring->seg_samples * sample_size;
+    uint32_t seg = (ring->head / ring->seg_samples) % ring->num_segs;
+    uint64_t win_start = ring->win_start + seg * seg_bytes;
+
+    /* The trigger address is right after the last sample of the segment */
+    uint32_t acq_core_trig_addr;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_TRIG_POS, &acq_core_trig_addr);
+    ring->seg_addr [seg] = _acq_get_start_address (acq_core_trig_addr, seg_bytes,
+            win_start, win_start + seg_bytes);
+    ring->head += ring->seg_samples;
+
+    _acq_ring_arm (self, acq);
+
+    /* Published after arming, so the next segment is acquired meanwhile */
+    if (acq->pstream != NULL) {
+        _acq_pstream_publish (self, acq, seg);
+    }
+}
+
+/* Copy segment "seg" of the continuous acquisition into the position
+ * stream, straight from the FPGA memory into the shared ring */
+static void _acq_pstream_publish (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        uint32_t seg)
+{
+    acq_ring_t *ring = &acq->ring;
+    uint32_t sample_size = acq->acq_buf[ring->chan].sample_size;
+    uint64_t seg_bytes = (uint64_t) ring->seg_samples * sample_size;
+    uint64_t win_start = ring->win_start + seg * seg_bytes;
+    uint64_t win_end = win_start + seg_bytes;
+    uint64_t addr = ring->seg_addr [seg];
+
+    uint32_t pos = 0;
+    while (pos < ring->seg_samples) {
+        uint32_t n = ring->seg_samples - pos;
+        uint8_t *data = smio_acq_pstream_reserve (acq->pstream, &n);
+
+        ssize_t valid_bytes = _acq_read_block_win (self, win_start, win_end,
+                addr, n * sample_size, data);
+        if (valid_bytes != (ssize_t) (n * sample_size)) {
+            /* The segment is dropped from the stream */
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] pstream_publish: "
+                    "Could not read segment %u\n", seg);
+            smio_acq_pstream_commit (acq->pstream, 0);
+            return;
+        }
+        smio_acq_pstream_commit (acq->pstream, n);
+
+        pos += n;
+        addr += valid_bytes;
+        if (addr >= win_end) {
+            addr -= seg_bytes;
+        }
+    }
+}
+
+/* Start the next acquisition of the queue, in its own slot. The other
+ * registers were already programmed when the queue was started */
+static void _acq_queue_arm (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    acq_queue_t *queue = &acq->queue;
+    uint32_t sample_size = acq->acq_buf[queue->chan].sample_size;
+
+    /* Our "end address" is the start of the last sample of the slot */
+    uint32_t start_addr = queue->slot_start + queue->num_done * queue->slot_size;
+    uint32_t end_addr = start_addr + queue->slot_size - sample_size;
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_DDR3_START_ADDR, &start_addr);
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_DDR3_END_ADDR, &end_addr);
+
+    uint32_t acq_core_ctl_reg = 0;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+    acq_core_ctl_reg |= ACQ_CORE_CTL_FSM_START_ACQ;
+    smio_thsafe_client_write_32 (self, ACQ_CORE_REG_CTL, &acq_core_ctl_reg);
+}
+
+/* Record the acquisition of the queue being done, if it is, and start
+ * the next one */
+static void _acq_queue_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    int err = _acq_check_status (self, ACQ_CORE_COMPLETE_MASK,
+            ACQ_CORE_COMPLETE_VALUE);
+    if (err != -ACQ_OK) {
+        return;
+    }
+
+    acq_queue_t *queue = &acq->queue;
+    acq_queue_entry_t *entry = &queue->entries [queue->num_done];
+
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+    entry->timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+    smio_thsafe_client_read_32 (self, ACQ_CORE_REG_TRIG_POS, &entry->trig_addr);
+    entry->seq = acq->acq_params[queue->chan].seq++;
+    queue->num_done++;
+
+    acq_trig_log_t *log = &acq->trig_log;
+    _acq_queue_get_curve_info (acq, queue->num_done - 1,
+            &log->entries [log->count % ACQ_TRIG_LOG_SIZE]);
+    log->count++;
+
+    if (queue->num_done < queue->num_acqs) {
+        _acq_queue_arm (self, acq);
+        return;
+    }
+
+    queue->active = false;
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] queue_poll: "
+            "All of the %u acquisitions of the queue are done\n",
+            queue->num_acqs);
+}
 
-    /* Check if we could read successfully */
-    int retf = 0;
-    if (valid_bytes >= 0) {
-        data_block->valid_bytes = (uint32_t) valid_bytes;
-        retf = valid_bytes + (ssize_t) sizeof (data_block->valid_bytes);
+/* Compute where the curve of acquisition "index" of the queue is. It wraps
+ * around the end of its slot, instead of the channel memory */
+static void _acq_queue_plan (smio_acq_t *acq, uint32_t index, acq_plan_t *plan)
+{
+    const acq_queue_t *queue = &acq->queue;
+    uint64_t slot_addr = queue->slot_start + index * queue->slot_size;
+    uint64_t slot_end = slot_addr + queue->slot_size;
+    uint64_t start_addr = _acq_get_start_address (queue->entries [index].trig_addr,
+            queue->slot_size, slot_addr, slot_end);
+
+    plan->size = queue->slot_size;
+    plan->ext_addr [0] = start_addr;
+    plan->ext_size [0] = slot_end - start_addr;
+    if (plan->ext_size [0] >= plan->size) {
+        plan->ext_size [0] = plan->size;
+        plan->num_ext = 1;
     }
     else {
-        data_block->valid_bytes = 0;
-        retf = -ACQ_COULD_NOT_READ;
+        plan->ext_addr [1] = slot_addr;
+        plan->ext_size [1] = plan->size - plan->ext_size [0];
+        plan->num_ext = 2;
     }
+    /* Queued curves are read as acquired */
+    plan->shot_stride = plan->size;
+    plan->shot_offs = 0;
+    plan->shot_size = plan->size;
+    plan->valid = true;
+}
 
-    return retf;
-
-err_get_acq_handler:
-    return -ACQ_ERR;
+static void _acq_queue_get_curve_info (smio_acq_t *acq, uint32_t index,
+        smio_acq_curve_info_t *info)
+{
+    const acq_queue_t *queue = &acq->queue;
+    bool done = index < queue->num_done;
+
+    info->timestamp = done ? queue->entries [index].timestamp : 0;
+    info->seq = done ? queue->entries [index].seq : 0;
+    info->chan = queue->chan;
+    info->trig_addr = done ? queue->entries [index].trig_addr : 0;
+    info->num_samples_pre = queue->num_samples_pre;
+    info->num_samples_post = queue->num_samples_post;
+    info->num_shots = queue->num_shots;
 }
 
 static uint64_t _acq_get_start_address (uint64_t acq_core_trig_addr,
@@ -481,24 +3600,6 @@ static uint64_t _acq_get_start_address (uint64_t acq_core_trig_addr,
     return addr;
 }
 
-static uint64_t _acq_get_read_block_addr (uint64_t start_addr, uint64_t offset,
-        uint64_t channel_start_addr, uint64_t end_mem_space_addr)
-{
-    uint64_t addr = 0;
-
-    /* Memory space last address relative to the start address */
-    uint64_t rel_end_mem_space_addr = end_mem_space_addr - start_addr;
-    /* Check if an address wrap can occur */
-    if (offset <= rel_end_mem_space_addr) {
-        addr = start_addr + offset;
-    }
-    else {
-        addr = channel_start_addr + (offset - rel_end_mem_space_addr);
-    }
-
-    return addr;
-}
-
 static int _acq_cfg_trigger (void *owner, void *args, void *ret)
 {
     (void) ret;
@@ -546,6 +3647,7 @@ static int _acq_cfg_trigger (void *owner, void *args, void *ret)
     else {
         err = _acq_set_trigger_type (self, trigger_type);
         ASSERT_TEST(err == -ACQ_OK, "Trigger type is not valid", err_acq_inv_trig);
+        smio_set_param_changed (self);
     }
 
     return err;
@@ -740,6 +3842,131 @@ RW_PARAM_FUNC(acq, hw_data_trig_chan) {
             ACQ_DATA_DRIVEN_CHAN_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
+/* Arm the post-mortem recorder for the channels of a mask, or disarm it
+ * with an empty one. The curve being recorded, if any, is still finished */
+static int _acq_cfg_pm (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_cfg_pm\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: channel mask */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t chan_mask = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = acq->pm.chan_mask;
+        return sizeof (uint32_t);
+    }
+
+    ASSERT_TEST((chan_mask >> SMIO_ACQ_NUM_CHANNELS) == 0, "Channel mask is "
+            "out of the maximum limit", err_inv_param, -ACQ_NUM_CHAN_OOR);
+
+    if (chan_mask != 0 && acq->pm.rec == NULL) {
+        const char *dir = getenv (ACQ_PM_ENV_DIR);
+        ASSERT_TEST(dir != NULL && *dir != '\0', "Post-mortem recorder "
+                "directory is not set", err_rec_alloc, -ACQ_PM_UNAVAILABLE);
+        acq->pm.rec = smio_acq_rec_new (dir);
+        ASSERT_TEST(acq->pm.rec != NULL, "Could not create post-mortem "
+                "recorder", err_rec_alloc, -ACQ_PM_UNAVAILABLE);
+    }
+
+    acq->pm.chan_mask = chan_mask;
+    acq->pm.pending_mask &= chan_mask;
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] cfg_pm: "
+            "Post-mortem recorder armed for channels 0x%08x\n", chan_mask);
+
+err_rec_alloc:
+err_inv_param:
+err_get_acq_handler:
+    return err;
+}
+
+static int _acq_get_pm_info (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_get_pm_info\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler);
+
+    /* Message is:
+     * frame 0: operation code */
+    smio_acq_pm_info_t *info = (smio_acq_pm_info_t *) ret;
+    memset (info, 0, sizeof (*info));
+    info->chan_mask = acq->pm.chan_mask;
+    info->pending_mask = acq->pm.pending_mask;
+    info->num_dropped = acq->pm.num_dropped;
+    info->last = acq->pm.last;
+    if (acq->pm.rec != NULL) {
+        smio_acq_rec_get_stats (acq->pm.rec, &info->num_files,
+                &info->num_failed, &info->bytes_written);
+    }
+
+    return sizeof (*info);
+
+err_get_acq_handler:
+    return -ACQ_ERR;
+}
+
+/* Publish the acquisitions completed on the channels of the mask to all of
+ * the consumers of the ACQ event stream, or stop it with 0 */
+static int _acq_cfg_mcast (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -ACQ_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] "
+            "Calling _acq_cfg_mcast\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get SMIO ACQ handler",
+            err_get_acq_handler, -ACQ_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: channel mask */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t chan_mask = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = acq->mcast.chan_mask;
+        return sizeof (uint32_t);
+    }
+
+    ASSERT_TEST((chan_mask >> SMIO_ACQ_NUM_CHANNELS) == 0, "Channel mask is "
+            "out of the maximum limit", err_inv_param, -ACQ_NUM_CHAN_OOR);
+
+    acq->mcast.chan_mask = chan_mask;
+    acq->mcast.pending_mask &= chan_mask;
+    /* The curve being published is cut short */
+    if (acq->mcast.active && !(chan_mask & (1U << acq->mcast.curve.chan))) {
+        acq->mcast.active = false;
+    }
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq] cfg_mcast: "
+            "Multicast enabled for channels 0x%08x\n", chan_mask);
+
+err_inv_param:
+err_get_acq_handler:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp acq_exp_fp [] = {
     _acq_data_acquire,
@@ -754,6 +3981,40 @@ const disp_table_func_fp acq_exp_fp [] = {
     RW_PARAM_FUNC_NAME(acq, sw_trig),
     RW_PARAM_FUNC_NAME(acq, fsm_stop),
     RW_PARAM_FUNC_NAME(acq, hw_data_trig_chan),
+    _acq_get_data_block_shm,
+    _acq_get_curve_stream,
+    _acq_get_data_block_var,
+    _acq_block_size_max,
+    _acq_get_data_block_reduced,
+    _acq_ring_start,
+    _acq_ring_stop,
+    _acq_ring_get_data,
+    _acq_data_acquire_multi,
+    _acq_get_data_block_multi,
+    _acq_get_curve_info,
+    _acq_get_trig_log,
+    _acq_get_shot_index,
+    _acq_get_shot_block,
+    _acq_get_data_block_coded,
+    _acq_get_direct_endp,
+    _acq_get_curve_direct,
+    _acq_get_chan_map,
+    _acq_acquire_curve,
+    _acq_queue_start,
+    _acq_queue_stop,
+    _acq_queue_get_info,
+    _acq_queue_get_block,
+    _acq_cfg_pingpong,
+    _acq_get_data_block_crc,
+    _acq_get_curve_stats,
+    _acq_cfg_pm,
+    _acq_get_pm_info,
+    _acq_get_range,
+    _acq_get_envelope,
+    _acq_cfg_partition,
+    _acq_cfg_pstream,
+    _acq_cfg_mcast,
+    _acq_get_trig_info,
     NULL
 };
 
@@ -808,12 +4069,618 @@ smio_err_e acq_do_op (void *self, void *msg)
     return _acq_do_op (self, msg);
 }
 
+/* Periodic handler. Publishes the completion of the acquisition in progress
+ * on the ACQ event stream */
+smio_err_e acq_poll (smio_t *self)
+{
+    smio_err_e err = SMIO_SUCCESS;
+    smio_acq_t *acq = smio_get_handler (self);
+    ASSERT_TEST(acq != NULL, "Could not get ACQ handler",
+            err_acq_handler, SMIO_ERR_ALLOC /* FIXME: improve return code */);
+
+    /* Continuous acquisition. No completion events for it */
+    if (acq->ring.active) {
+        _acq_ring_poll (self, acq);
+        goto ring_active;
+    }
+
+    /* Acquisition queue. Clients check its progress instead */
+    if (acq->queue.active) {
+        _acq_queue_poll (self, acq);
+        goto queue_active;
+    }
+
+    _acq_pm_poll (self, acq);
+    _acq_mcast_poll (self, acq);
+
+    /* Nothing to watch for, except for the curve of a single request
+     * acquisition being pushed or for the curves being recorded */
+    if (!acq->acq_pending) {
+        _acq_capture_poll (self, acq);
+        if (acq->capture.reply == NULL && !_acq_pm_busy (acq)) {
+            smio_set_poll_interval (self, 0);
+        }
+        goto no_acq_pending;
+    }
+
+    /* Sleep until the completion is due, then poll tightly */
+    int64_t now = zclock_usecs ();
+    if (!_acq_predict_due (&acq->predict, now)) {
+        _acq_predict_sleep (self, acq, now);
+        _acq_capture_poll (self, acq);
+        goto acq_not_completed;
+    }
+    if (acq->predict.asleep) {
+        acq->predict.asleep = false;
+        smio_set_poll_interval (self, ACQ_EVENT_POLL_INTERVAL);
+    }
+
+    int aerr = _acq_check_status (self, ACQ_CORE_COMPLETE_MASK,
+            ACQ_CORE_COMPLETE_VALUE);
+    if (aerr != -ACQ_OK) {
+        /* Let the status page follow the FSM while waiting */
+        _acq_status_update (self, acq);
+        _acq_early_poll (self, acq);
+        /* Single request acquisition timeout */
+        _acq_capture_poll (self, acq);
+        goto acq_not_completed;
+    }
+
+    uint32_t chan = acq->curr_chan;
+    _acq_predict_done (acq, chan);
+    _acq_complete_chan (self, acq, chan);
+
+    /* Multi-channel acquisition. Go on with the next channel */
+    if (acq->multi.pending_mask != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] acq_poll: "
+                "Acquisition is done for channel %u. Starting the next one\n", chan);
+        _acq_multi_start_next (self, acq);
+        goto multi_next_chan;
+    }
+
+    acq->acq_pending = false;
+    _acq_status_update (self, acq);
+    /* The curve is pushed or recorded from the next polls on */
+    if (acq->capture.reply == NULL && !_acq_pm_busy (acq)) {
+        smio_set_poll_interval (self, 0);
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] acq_poll: "
+            "Acquisition is done for channel %u. Publishing event\n", chan);
+
+    smio_acq_event_t event = {
+        .seq = acq->acq_params[chan].seq,
+        .chan = chan,
+        .chan_mask = (acq->multi.chan_mask != 0) ? acq->multi.chan_mask :
+            (1U << chan),
+        .timestamp = acq->acq_params[chan].timestamp
+    };
+
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, SMIO_ERR_ALLOC);
+    int rc = zmsg_addmem (msg, &event, sizeof (event));
+    ASSERT_TEST(rc == 0, "Could not add event to message", err_msg_addmem,
+            SMIO_ERR_ALLOC);
+
+    rc = mlm_client_send (smio_get_worker (self), ACQ_EVENT_SUBJECT_DONE, &msg);
+    ASSERT_TEST(rc == 0, "Could not publish acquisition event", err_msg_send,
+            SMIO_ERR_BAD_MSG);
+
+err_msg_send:
+err_msg_addmem:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+acq_not_completed:
+multi_next_chan:
+no_acq_pending:
+queue_active:
+ring_active:
+err_acq_handler:
+    return err;
+}
+
+/* Serve the single request acquisition, if any: reply if it timed out and
+ * push the next blocks of its curve once it is done. At most
+ * ACQ_STREAM_MAX_BLOCKS blocks are pushed per call, so the other requests
+ * and tasks are not held for long */
+static void _acq_capture_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    acq_capture_t *capture = &acq->capture;
+    if (capture->reply == NULL) {
+        return;
+    }
+
+    if (acq->acq_pending) {
+        if (capture->deadline >= 0 && zclock_mono () >= capture->deadline) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] acquire_curve: "
+                    "Acquisition of channel %u was not completed in time\n",
+                    capture->chan);
+            _acq_capture_end (acq, -ACQ_NOT_COMPLETED, 0);
+        }
+        return;
+    }
+
+    uint32_t blocks_sent = 0;
+    int err = _acq_push_blocks (self, acq, capture->chan, capture->next_block,
+            ACQ_STREAM_MAX_BLOCKS, smio_get_worker (self), NULL, capture->peer,
+            &blocks_sent);
+
+    /* The previous push ended right at the end of the curve */
+    if (err == -ACQ_BLOCK_OOR && capture->next_block > 0) {
+        _acq_capture_end (acq, -ACQ_OK, capture->next_block);
+        return;
+    }
+
+    if (err != -ACQ_OK) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] acquire_curve: "
+                "Could not push block %u of channel %u\n",
+                capture->next_block + blocks_sent, capture->chan);
+        _acq_capture_end (acq, err, 0);
+        return;
+    }
+
+    capture->next_block += blocks_sent;
+    if (blocks_sent < ACQ_STREAM_MAX_BLOCKS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] acquire_curve: "
+                "%u blocks streamed\n", capture->next_block);
+        _acq_capture_end (acq, -ACQ_OK, capture->next_block);
+    }
+}
+
+/* Send the final reply of the single request acquisition */
+static void _acq_capture_end (smio_acq_t *acq, int ret, uint32_t blocks_sent)
+{
+    acq_capture_t *capture = &acq->capture;
+
+    if (ret == -ACQ_OK) {
+        msg_deferred_reply (&capture->reply, sizeof (blocks_sent), &blocks_sent);
+    }
+    else {
+        msg_deferred_reply (&capture->reply, ret, NULL);
+    }
+
+    free (capture->peer);
+    capture->peer = NULL;
+}
+
+/* Record the next chunks of the curve being recorded, or start recording
+ * the next curve waiting, if the recorder is done with the last one. At
+ * most ACQ_REC_NUM_BUFS buffers are read per call, as the writer thread
+ * frees them, so the other requests and tasks are not held for long */
+static void _acq_pm_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    acq_pm_t *pm = &acq->pm;
+    if (pm->rec == NULL) {
+        return;
+    }
+
+    if (!pm->active) {
+        if (pm->pending_mask == 0 || !smio_acq_rec_idle (pm->rec)) {
+            return;
+        }
+
+        uint32_t chan = __builtin_ctz (pm->pending_mask);
+        pm->pending_mask &= ~(1U << chan);
+        pm->plan = *_acq_get_plan (acq, chan);
+        pm->half = acq->acq_params[chan].half;
+        pm->offs = 0;
+        _acq_get_curve_info_chan (acq, chan, &pm->curve);
+
+        bpm_capture_hdr_t hdr;
+        memset (&hdr, 0, sizeof (hdr));
+        strncpy (hdr.magic, BPM_CAPTURE_MAGIC, sizeof (hdr.magic));
+        hdr.version = BPM_CAPTURE_VERSION;
+        hdr.hdr_size = sizeof (hdr);
+        hdr.chan = chan;
+        hdr.sample_size = acq->acq_buf[chan].sample_size;
+        hdr.num_samples_pre = pm->curve.num_samples_pre;
+        hdr.num_samples_post = pm->curve.num_samples_post;
+        hdr.num_shots = pm->curve.num_shots;
+        hdr.trig_addr = pm->curve.trig_addr;
+        hdr.timestamp = pm->curve.timestamp;
+        hdr.payload_offs = ACQ_REC_ALIGN;
+
+        char name [PATH_MAX];
+        snprintf (name, sizeof (name), "%s_CH%u_%u_%"PRIu64 ACQ_PM_FILE_SUFFIX,
+                smio_get_service (self), chan, pm->curve.seq, pm->curve.timestamp);
+        if (smio_acq_rec_open (pm->rec, name, &hdr) != SMIO_SUCCESS) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] pm_poll: "
+                    "Could not record acquisition #%u of channel %u\n",
+                    pm->curve.seq, chan);
+            pm->num_dropped++;
+            return;
+        }
+        pm->active = true;
+    }
+
+    while (pm->offs < pm->plan.size) {
+        uint8_t *buf = smio_acq_rec_get_buf (pm->rec);
+        if (buf == NULL) {
+            return;
+        }
+
+        uint32_t size = (pm->plan.size - pm->offs < ACQ_REC_BUF_SIZE) ?
+            pm->plan.size - pm->offs : ACQ_REC_BUF_SIZE;
+        ssize_t valid_bytes = _acq_read_plan (self, &pm->plan, pm->offs, size, buf);
+        if (valid_bytes != (ssize_t) size ||
+                smio_acq_rec_submit (pm->rec, size) != SMIO_SUCCESS) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] pm_poll: "
+                    "Could not read acquisition #%u of channel %u at offset "
+                    "%"PRIu64"\n", pm->curve.seq, pm->curve.chan, pm->offs);
+            smio_acq_rec_close (pm->rec, true);
+            pm->active = false;
+            return;
+        }
+        pm->offs += size;
+    }
+
+    smio_acq_rec_close (pm->rec, false);
+    pm->active = false;
+    pm->last = pm->curve;
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] pm_poll: "
+            "Acquisition #%u of channel %u read, %"PRIu64" bytes\n",
+            pm->curve.seq, pm->curve.chan, pm->offs);
+}
+
+/* Drop the curves of channel "chan" waiting to be recorded, or being
+ * recorded, that a new acquisition in memory half "half" overwrites */
+static void _acq_pm_drop_overlap (smio_acq_t *acq, uint32_t chan, uint32_t half)
+{
+    acq_pm_t *pm = &acq->pm;
+
+#define ACQ_PM_HALVES_OVERLAP(h1, h2) \
+    ((h1) == ACQ_MEM_WHOLE || (h2) == ACQ_MEM_WHOLE || (h1) == (h2))
+
+    if (pm->active && pm->curve.chan == chan &&
+            ACQ_PM_HALVES_OVERLAP(pm->half, half)) {
+        smio_acq_rec_close (pm->rec, true);
+        pm->active = false;
+        pm->num_dropped++;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] pm: Acquisition #%u "
+                "of channel %u overwritten while being recorded\n",
+                pm->curve.seq, chan);
+    }
+
+    if ((pm->pending_mask & (1U << chan)) &&
+            ACQ_PM_HALVES_OVERLAP(acq->acq_params[chan].half, half)) {
+        pm->pending_mask &= ~(1U << chan);
+        pm->num_dropped++;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] pm: Acquisition #%u "
+                "of channel %u overwritten before being recorded\n",
+                acq->acq_params[chan].seq, chan);
+    }
+
+#undef ACQ_PM_HALVES_OVERLAP
+}
+
+/* Curves are being recorded or published, or waiting to be */
+static bool _acq_pm_busy (smio_acq_t *acq)
+{
+    return acq->pm.active || acq->pm.pending_mask != 0 ||
+        (acq->pm.rec != NULL && !smio_acq_rec_idle (acq->pm.rec)) ||
+        acq->mcast.active || acq->mcast.pending_mask != 0;
+}
+
+/* Publish the next blocks of the curve being published, or start with the
+ * next curve waiting. Each block is read straight into the frame sent, so
+ * the data is not copied on our side. At most ACQ_MCAST_MAX_BLOCKS blocks
+ * are published per call, so the other requests and tasks are not held
+ * for long */
+static void _acq_mcast_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    acq_mcast_t *mcast = &acq->mcast;
+
+    if (!mcast->active) {
+        if (mcast->pending_mask == 0) {
+            return;
+        }
+
+        uint32_t chan = __builtin_ctz (mcast->pending_mask);
+        mcast->pending_mask &= ~(1U << chan);
+        mcast->plan = *_acq_get_plan (acq, chan);
+        mcast->half = acq->acq_params[chan].half;
+        mcast->offs = 0;
+        _acq_get_curve_info_chan (acq, chan, &mcast->curve);
+        mcast->active = true;
+    }
+
+    smio_acq_mcast_hdr_t hdr;
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.seq = mcast->curve.seq;
+    hdr.chan = mcast->curve.chan;
+    hdr.sample_size = acq->acq_buf[hdr.chan].sample_size;
+    hdr.timestamp = mcast->curve.timestamp;
+    hdr.curve_size = mcast->plan.size;
+
+    for (uint32_t i = 0; i < ACQ_MCAST_MAX_BLOCKS &&
+            mcast->offs < mcast->plan.size; ++i) {
+        hdr.offs = mcast->offs;
+        hdr.size = (mcast->plan.size - mcast->offs < ACQ_MCAST_BLOCK_SIZE) ?
+            mcast->plan.size - mcast->offs : ACQ_MCAST_BLOCK_SIZE;
+        hdr.flags = (mcast->offs + hdr.size == mcast->plan.size) ?
+            ACQ_MCAST_FLAG_LAST : 0;
+
+        zmsg_t *msg = zmsg_new ();
+        zframe_t *data = zframe_new (NULL, hdr.size);
+        if (msg == NULL || data == NULL) {
+            zframe_destroy (&data);
+            zmsg_destroy (&msg);
+            goto err_publish;
+        }
+
+        ssize_t valid_bytes = _acq_read_plan (self, &mcast->plan, mcast->offs,
+                hdr.size, zframe_data (data));
+        if (valid_bytes != (ssize_t) hdr.size ||
+                zmsg_addmem (msg, &hdr, sizeof (hdr)) != 0 ||
+                zmsg_append (msg, &data) != 0 ||
+                mlm_client_send (smio_get_worker (self), ACQ_EVENT_SUBJECT_DATA,
+                    &msg) != 0) {
+            zframe_destroy (&data);
+            zmsg_destroy (&msg);
+            goto err_publish;
+        }
+        mcast->offs += hdr.size;
+    }
+
+    if (mcast->offs == mcast->plan.size) {
+        mcast->active = false;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] mcast_poll: "
+                "Acquisition #%u of channel %u published, %"PRIu64" bytes\n",
+                mcast->curve.seq, mcast->curve.chan, mcast->offs);
+    }
+    return;
+
+err_publish:
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq] mcast_poll: "
+            "Could not publish acquisition #%u of channel %u at offset "
+            "%"PRIu64"\n", mcast->curve.seq, mcast->curve.chan, mcast->offs);
+    mcast->active = false;
+    mcast->num_dropped++;
+}
+
+/* Drop the curves of channel "chan" waiting to be published, or being
+ * published, that a new acquisition in memory half "half" overwrites */
+static void _acq_mcast_drop_overlap (smio_acq_t *acq, uint32_t chan,
+        uint32_t half)
+{
+    acq_mcast_t *mcast = &acq->mcast;
+
+#define ACQ_MCAST_HALVES_OVERLAP(h1, h2) \
+    ((h1) == ACQ_MEM_WHOLE || (h2) == ACQ_MEM_WHOLE || (h1) == (h2))
+
+    if (mcast->active && mcast->curve.chan == chan &&
+            ACQ_MCAST_HALVES_OVERLAP(mcast->half, half)) {
+        mcast->active = false;
+        mcast->num_dropped++;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] mcast: Acquisition "
+                "#%u of channel %u overwritten while being published\n",
+                mcast->curve.seq, chan);
+    }
+
+    if ((mcast->pending_mask & (1U << chan)) &&
+            ACQ_MCAST_HALVES_OVERLAP(acq->acq_params[chan].half, half)) {
+        mcast->pending_mask &= ~(1U << chan);
+        mcast->num_dropped++;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] mcast: Acquisition "
+                "#%u of channel %u overwritten before being published\n",
+                acq->acq_params[chan].seq, chan);
+    }
+
+#undef ACQ_MCAST_HALVES_OVERLAP
+}
+
+/* Predict when the acquisition of "num_samples" of "chan" just started is
+ * done, if it has no trigger wait and the time per sample of the channel
+ * is known. The clock and decimation of the channel are not known here, so
+ * the time per sample is learned from the previous acquisitions */
+static void _acq_predict_start (smio_acq_t *acq, uint32_t chan,
+        uint64_t num_samples, bool skip_trig)
+{
+    acq_predict_t *predict = &acq->predict;
+    int64_t now = zclock_usecs ();
+
+    predict->learn = skip_trig;
+    predict->start = now;
+    predict->num_samples = num_samples;
+    predict->wake = 0;
+    predict->num_checks = 0;
+
+    uint64_t sample_ps = predict->sample_ps[chan];
+    if (!skip_trig || sample_ps == 0) {
+        return;
+    }
+
+    int64_t expected = (int64_t) (num_samples * sample_ps / 1000000);
+    int64_t guard = ACQ_PREDICT_GUARD + expected / ACQ_PREDICT_GUARD_DIV;
+    if (expected > guard) {
+        predict->wake = now + expected - guard;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] predict_start: "
+                "Acquisition of channel %u expected in %"PRId64" us\n", chan,
+                expected);
+    }
+}
+
+/* Whether the status of the acquisition in progress is worth reading now */
+static bool _acq_predict_due (acq_predict_t *predict, int64_t now)
+{
+    if (predict->wake != 0 && now < predict->wake) {
+        return false;
+    }
+
+    predict->num_checks++;
+    return true;
+}
+
+/* Stretch the poll interval up to the predicted completion, unless the
+ * poll has something else to serve sooner */
+static void _acq_predict_sleep (SMIO_OWNER_TYPE *self, smio_acq_t *acq,
+        int64_t now)
+{
+    int64_t sleep = (acq->predict.wake - now) / 1000;
+
+    if (_acq_pm_busy (acq)) {
+        sleep = ACQ_EVENT_POLL_INTERVAL;
+    }
+
+    /* Single request acquisition timeout */
+    if (acq->capture.reply != NULL && acq->capture.deadline >= 0) {
+        int64_t left = acq->capture.deadline - zclock_mono ();
+        sleep = (left < sleep) ? left : sleep;
+    }
+
+    sleep = (sleep < ACQ_EVENT_POLL_INTERVAL) ? ACQ_EVENT_POLL_INTERVAL : sleep;
+    acq->predict.asleep = true;
+    smio_set_poll_interval (self, (size_t) sleep);
+}
+
+/* Learn the time per sample of "chan" from the acquisition just done. If
+ * it was done by the first status read after the predicted completion, we
+ * may have slept past it, so the time per sample is learned again from the
+ * next acquisition, polled all along */
+static void _acq_predict_done (smio_acq_t *acq, uint32_t chan)
+{
+    acq_predict_t *predict = &acq->predict;
+    if (predict->num_samples == 0) {
+        return;
+    }
+
+    if (predict->wake != 0 && predict->num_checks <= 1) {
+        predict->sample_ps[chan] = 0;
+    }
+    else if (predict->learn) {
+        predict->sample_ps[chan] = (uint64_t) (zclock_usecs () - predict->start) *
+            1000000 / predict->num_samples;
+    }
+
+    predict->num_samples = 0;
+    predict->wake = 0;
+}
+
+/* Watch for the trigger of the acquisition of "chan" just started, if its
+ * pre-trigger samples can be read before it completes. With a single
+ * shot, the curve starts right before the trigger address, wherever the
+ * post-trigger samples end up. With no trigger wait, the trigger address
+ * is only known at the end */
+static void _acq_early_start (smio_acq_t *acq, uint32_t chan,
+        const acq_params_t *params, bool skip_trig)
+{
+    acq_early_t *early = &acq->early;
+
+    early->enabled = !skip_trig && params->num_shots == 1 &&
+        !acq->pingpong[chan].enabled;
+    early->seen = 0;
+    memset (&early->info, 0, sizeof (early->info));
+    early->info.seq = params->seq;
+    early->info.chan = chan;
+}
+
+/* Look for the trigger of the acquisition in progress, and make its
+ * pre-trigger samples readable and publish it ACQ_EARLY_SETTLE after */
+static void _acq_early_poll (SMIO_OWNER_TYPE *self, smio_acq_t *acq)
+{
+    acq_early_t *early = &acq->early;
+    if (!early->enabled || early->info.size != 0) {
+        return;
+    }
+
+    uint32_t chan = early->info.chan;
+    acq_params_t *params = &acq->acq_params[chan];
+    int64_t now = zclock_usecs ();
+
+    if (early->seen == 0) {
+        uint32_t acq_core_sta = 0;
+        smio_thsafe_client_read_32 (self, ACQ_CORE_REG_STA, &acq_core_sta);
+        if (ACQ_CORE_STA_FSM_STATE_R(acq_core_sta) < ACQ_CORE_FSM_STATE_POST_TRIG) {
+            return;
+        }
+
+        uint32_t acq_core_trig_addr;
+        smio_thsafe_client_read_32 (self, ACQ_CORE_REG_TRIG_POS, &acq_core_trig_addr);
+        struct timespec ts;
+        clock_gettime (CLOCK_REALTIME, &ts);
+
+        early->seen = now;
+        early->info.timestamp = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        early->info.trig_addr = acq_core_trig_addr;
+
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] early_poll: "
+                "Trigger of acquisition #%u of channel %u seen, trigger "
+                "address 0x%08x\n", early->info.seq, chan, acq_core_trig_addr);
+    }
+
+    if (now - early->seen < ACQ_EARLY_SETTLE) {
+        return;
+    }
+
+    /* The plan is the same as the one computed on completion, which reads
+     * the trigger address again */
+    params->trig_addr = early->info.trig_addr;
+    _acq_plan_compute (acq, chan);
+
+    uint32_t pre_req = 0;
+    uint32_t post_req = 0;
+    _acq_get_window (params, &pre_req, &post_req);
+    early->info.size = (uint64_t) pre_req * acq->acq_buf[chan].sample_size;
+    early->enabled = false;
+
+    /* Nothing to read before the trigger */
+    if (early->info.size == 0) {
+        return;
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq] early_poll: "
+            "%"PRIu64" bytes of pre-trigger data of channel %u can be read. "
+            "Publishing event\n", early->info.size, chan);
+
+    zmsg_t *msg = zmsg_new ();
+    if (msg == NULL || zmsg_addmem (msg, &early->info, sizeof (early->info)) != 0 ||
+            mlm_client_send (smio_get_worker (self), ACQ_EVENT_SUBJECT_TRIG,
+                &msg) != 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq] early_poll: "
+                "Could not publish trigger event\n");
+    }
+    zmsg_destroy (&msg);
+}
+
+/* Whether the acquisition of "chan" is in progress, i.e., its memory is
+ * being written. On ping-pong, the memory read is that of the last
+ * acquisition */
+static bool _acq_in_progress (smio_acq_t *acq, uint32_t chan)
+{
+    return acq->acq_pending && acq->curr_chan == chan &&
+        acq->acq_params[chan].timestamp == 0 && !acq->pingpong[chan].pending;
+}
+
+/* Trigger information of the acquisition of "chan" in progress, or of the
+ * last one */
+static void _acq_get_trig_info_chan (smio_acq_t *acq, uint32_t chan,
+        smio_acq_trig_info_t *info)
+{
+    const acq_early_t *early = &acq->early;
+    const acq_params_t *params = &acq->acq_params[chan];
+
+    if (early->info.chan == chan && early->info.seq == params->seq) {
+        *info = early->info;
+        return;
+    }
+
+    bool done = params->timestamp != 0;
+    memset (info, 0, sizeof (*info));
+    info->timestamp = params->timestamp;
+    info->seq = params->seq;
+    info->chan = chan;
+    info->trig_addr = done ? params->trig_addr : 0;
+    info->done = done;
+    info->size = done ? _acq_get_plan (acq, chan)->size : 0;
+}
+
 const smio_ops_t acq_ops = {
     .attach             = acq_attach,          /* Attach sm_io instance to dev_io */
     .deattach           = acq_deattach,        /* Deattach sm_io instance to dev_io */
     .export_ops         = acq_export_ops,      /* Export sm_io operations to dev_io */
     .unexport_ops       = acq_unexport_ops,    /* Unexport sm_io operations to dev_io */
-    .do_op              = acq_do_op            /* Generic wrapper for handling specific operations */
+    .do_op              = acq_do_op,           /* Generic wrapper for handling specific operations */
+    .poll               = acq_poll             /* Publish acquisition completion events */
 };
 
 /************************************************************/
@@ -835,7 +4702,7 @@ smio_err_e acq_init (smio_t * self)
     err = smio_set_ops (self, &acq_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
@@ -860,6 +4727,15 @@ smio_err_e acq_init (smio_t * self)
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO handler",
             err_smio_set_handler);
 
+    /* Clients get our channels from the dev_mngr directory, along with
+     * our service */
+    smio_acq_chan_map_t chan_map;
+    size_t chan_map_size = _acq_fill_chan_map (smio_handler, &chan_map);
+    if (smio_set_dir_info (self, &chan_map, chan_map_size) != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:acq_exp] Could not set "
+                "the channel map of the directory\n");
+    }
+
     return err;
 
 err_smio_set_handler:
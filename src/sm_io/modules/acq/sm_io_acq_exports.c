@@ -154,6 +154,427 @@ disp_op_t acq_hw_data_trig_chan_exp = {
     }
 };
 
+disp_op_t acq_get_data_block_shm_exp = {
+    .name = ACQ_NAME_GET_DATA_BLOCK_SHM,
+    .opcode = ACQ_OPCODE_GET_DATA_BLOCK_SHM,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_shm_desc_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_curve_stream_exp = {
+    .name = ACQ_NAME_GET_CURVE_STREAM,
+    .opcode = ACQ_OPCODE_GET_CURVE_STREAM,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_data_block_var_exp = {
+    .name = ACQ_NAME_GET_DATA_BLOCK_VAR,
+    .opcode = ACQ_OPCODE_GET_DATA_BLOCK_VAR,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_var_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_block_size_max_exp = {
+    .name = ACQ_NAME_BLOCK_SIZE_MAX,
+    .opcode = ACQ_OPCODE_BLOCK_SIZE_MAX,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_data_block_reduced_exp = {
+    .name = ACQ_NAME_GET_DATA_BLOCK_REDUCED,
+    .opcode = ACQ_OPCODE_GET_DATA_BLOCK_REDUCED,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_var_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_ring_start_exp = {
+    .name = ACQ_NAME_RING_START,
+    .opcode = ACQ_OPCODE_RING_START,
+    .retval = DISP_ARG_END,
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_ring_stop_exp = {
+    .name = ACQ_NAME_RING_STOP,
+    .opcode = ACQ_OPCODE_RING_STOP,
+    .retval = DISP_ARG_END,
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_ring_get_data_exp = {
+    .name = ACQ_NAME_RING_GET_DATA,
+    .opcode = ACQ_OPCODE_RING_GET_DATA,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_ring_data_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT64, uint64_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_data_acquire_multi_exp = {
+    .name = ACQ_NAME_DATA_ACQUIRE_MULTI,
+    .opcode = ACQ_OPCODE_DATA_ACQUIRE_MULTI,
+    .retval = DISP_ARG_END,
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_data_block_multi_exp = {
+    .name = ACQ_NAME_GET_DATA_BLOCK_MULTI,
+    .opcode = ACQ_OPCODE_GET_DATA_BLOCK_MULTI,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_multi_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_curve_info_exp = {
+    .name = ACQ_NAME_GET_CURVE_INFO,
+    .opcode = ACQ_OPCODE_GET_CURVE_INFO,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_curve_info_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_trig_log_exp = {
+    .name = ACQ_NAME_GET_TRIG_LOG,
+    .opcode = ACQ_OPCODE_GET_TRIG_LOG,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_trig_log_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_shot_index_exp = {
+    .name = ACQ_NAME_GET_SHOT_INDEX,
+    .opcode = ACQ_OPCODE_GET_SHOT_INDEX,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_shot_index_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_shot_block_exp = {
+    .name = ACQ_NAME_GET_SHOT_BLOCK,
+    .opcode = ACQ_OPCODE_GET_SHOT_BLOCK,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_var_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_data_block_coded_exp = {
+    .name = ACQ_NAME_GET_DATA_BLOCK_CODED,
+    .opcode = ACQ_OPCODE_GET_DATA_BLOCK_CODED,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_coded_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_direct_endp_exp = {
+    .name = ACQ_NAME_GET_DIRECT_ENDP,
+    .opcode = ACQ_OPCODE_GET_DIRECT_ENDP,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_direct_endp_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_curve_direct_exp = {
+    .name = ACQ_NAME_GET_CURVE_DIRECT,
+    .opcode = ACQ_OPCODE_GET_CURVE_DIRECT,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_direct_peer_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_chan_map_exp = {
+    .name = ACQ_NAME_GET_CHAN_MAP,
+    .opcode = ACQ_OPCODE_GET_CHAN_MAP,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_chan_map_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_acquire_curve_exp = {
+    .name = ACQ_NAME_ACQUIRE_CURVE,
+    .opcode = ACQ_OPCODE_ACQUIRE_CURVE,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_queue_start_exp = {
+    .name = ACQ_NAME_QUEUE_START,
+    .opcode = ACQ_OPCODE_QUEUE_START,
+    .retval = DISP_ARG_END,
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_queue_stop_exp = {
+    .name = ACQ_NAME_QUEUE_STOP,
+    .opcode = ACQ_OPCODE_QUEUE_STOP,
+    .retval = DISP_ARG_END,
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_queue_get_info_exp = {
+    .name = ACQ_NAME_QUEUE_GET_INFO,
+    .opcode = ACQ_OPCODE_QUEUE_GET_INFO,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_queue_info_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_queue_get_block_exp = {
+    .name = ACQ_NAME_QUEUE_GET_BLOCK,
+    .opcode = ACQ_OPCODE_QUEUE_GET_BLOCK,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_cfg_pingpong_exp = {
+    .name = ACQ_NAME_CFG_PINGPONG,
+    .opcode = ACQ_OPCODE_CFG_PINGPONG,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_data_block_crc_exp = {
+    .name = ACQ_NAME_GET_DATA_BLOCK_CRC,
+    .opcode = ACQ_OPCODE_GET_DATA_BLOCK_CRC,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_crc_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_curve_stats_exp = {
+    .name = ACQ_NAME_GET_CURVE_STATS,
+    .opcode = ACQ_OPCODE_GET_CURVE_STATS,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_curve_stats_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_cfg_pm_exp = {
+    .name = ACQ_NAME_CFG_PM,
+    .opcode = ACQ_OPCODE_CFG_PM,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_pm_info_exp = {
+    .name = ACQ_NAME_GET_PM_INFO,
+    .opcode = ACQ_OPCODE_GET_PM_INFO,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_pm_info_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_range_exp = {
+    .name = ACQ_NAME_GET_RANGE,
+    .opcode = ACQ_OPCODE_GET_RANGE,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_data_block_var_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_envelope_exp = {
+    .name = ACQ_NAME_GET_ENVELOPE,
+    .opcode = ACQ_OPCODE_GET_ENVELOPE,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_envelope_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_cfg_partition_exp = {
+    .name = ACQ_NAME_CFG_PARTITION,
+    .opcode = ACQ_OPCODE_CFG_PARTITION,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_partition_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_partition_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_cfg_pstream_exp = {
+    .name = ACQ_NAME_CFG_PSTREAM,
+    .opcode = ACQ_OPCODE_CFG_PSTREAM,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_cfg_mcast_exp = {
+    .name = ACQ_NAME_CFG_MCAST,
+    .opcode = ACQ_OPCODE_CFG_MCAST,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t acq_get_trig_info_exp = {
+    .name = ACQ_NAME_GET_TRIG_INFO,
+    .opcode = ACQ_OPCODE_GET_TRIG_INFO,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_acq_trig_info_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *acq_exp_ops [] = {
     &acq_data_acquire_exp,
@@ -168,6 +589,40 @@ const disp_op_t *acq_exp_ops [] = {
     &acq_sw_trig_exp,
     &acq_fsm_stop_exp,
     &acq_hw_data_trig_chan_exp,
+    &acq_get_data_block_shm_exp,
+    &acq_get_curve_stream_exp,
+    &acq_get_data_block_var_exp,
+    &acq_block_size_max_exp,
+    &acq_get_data_block_reduced_exp,
+    &acq_ring_start_exp,
+    &acq_ring_stop_exp,
+    &acq_ring_get_data_exp,
+    &acq_data_acquire_multi_exp,
+    &acq_get_data_block_multi_exp,
+    &acq_get_curve_info_exp,
+    &acq_get_trig_log_exp,
+    &acq_get_shot_index_exp,
+    &acq_get_shot_block_exp,
+    &acq_get_data_block_coded_exp,
+    &acq_get_direct_endp_exp,
+    &acq_get_curve_direct_exp,
+    &acq_get_chan_map_exp,
+    &acq_acquire_curve_exp,
+    &acq_queue_start_exp,
+    &acq_queue_stop_exp,
+    &acq_queue_get_info_exp,
+    &acq_queue_get_block_exp,
+    &acq_cfg_pingpong_exp,
+    &acq_get_data_block_crc_exp,
+    &acq_get_curve_stats_exp,
+    &acq_cfg_pm_exp,
+    &acq_get_pm_info_exp,
+    &acq_get_range_exp,
+    &acq_get_envelope_exp,
+    &acq_cfg_partition_exp,
+    &acq_cfg_pstream_exp,
+    &acq_cfg_mcast_exp,
+    &acq_get_trig_info_exp,
     NULL
 };
 
@@ -22,6 +22,40 @@ extern disp_op_t acq_hw_trig_dly_exp;
 extern disp_op_t acq_sw_trig_exp;
 extern disp_op_t acq_fsm_stop_exp;
 extern disp_op_t acq_hw_data_trig_chan_exp;
+extern disp_op_t acq_get_data_block_shm_exp;
+extern disp_op_t acq_get_curve_stream_exp;
+extern disp_op_t acq_get_data_block_var_exp;
+extern disp_op_t acq_block_size_max_exp;
+extern disp_op_t acq_get_data_block_reduced_exp;
+extern disp_op_t acq_ring_start_exp;
+extern disp_op_t acq_ring_stop_exp;
+extern disp_op_t acq_ring_get_data_exp;
+extern disp_op_t acq_data_acquire_multi_exp;
+extern disp_op_t acq_get_data_block_multi_exp;
+extern disp_op_t acq_get_curve_info_exp;
+extern disp_op_t acq_get_trig_log_exp;
+extern disp_op_t acq_get_shot_index_exp;
+extern disp_op_t acq_get_shot_block_exp;
+extern disp_op_t acq_get_data_block_coded_exp;
+extern disp_op_t acq_get_direct_endp_exp;
+extern disp_op_t acq_get_curve_direct_exp;
+extern disp_op_t acq_get_chan_map_exp;
+extern disp_op_t acq_acquire_curve_exp;
+extern disp_op_t acq_queue_start_exp;
+extern disp_op_t acq_queue_stop_exp;
+extern disp_op_t acq_queue_get_info_exp;
+extern disp_op_t acq_queue_get_block_exp;
+extern disp_op_t acq_cfg_pingpong_exp;
+extern disp_op_t acq_get_data_block_crc_exp;
+extern disp_op_t acq_get_curve_stats_exp;
+extern disp_op_t acq_cfg_pm_exp;
+extern disp_op_t acq_get_pm_info_exp;
+extern disp_op_t acq_get_range_exp;
+extern disp_op_t acq_get_envelope_exp;
+extern disp_op_t acq_cfg_partition_exp;
+extern disp_op_t acq_cfg_pstream_exp;
+extern disp_op_t acq_cfg_mcast_exp;
+extern disp_op_t acq_get_trig_info_exp;
 
 extern const disp_op_t *acq_exp_ops [];
 
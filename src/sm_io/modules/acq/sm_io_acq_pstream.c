@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Position stream. Segments of the continuous acquisition are copied to a
+ * single writer shared memory ring that local consumers poll, see
+ * smio_acq_pstream_hdr_t */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#include "bpm_server.h"
+/* Private headers */
+#include "sm_io_acq_codes.h"
+#include "sm_io_acq_pstream.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io:acq_pstream]", \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)   \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io:acq_pstream]",         \
+            smio_err_str(SMIO_ERR_ALLOC),                       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io:acq_pstream]",            \
+            smio_err_str (err_type))
+
+struct _smio_acq_pstream_t {
+    char shm_name [ACQ_SHM_NAME_MAX_LEN];   /* Shared memory object name */
+    smio_acq_pstream_hdr_t *hdr;            /* Mapped ring */
+    size_t size;                            /* Size of the mapping */
+    uint8_t *data;                          /* Samples of the ring */
+    uint64_t head;                          /* Our copy of hdr->head */
+};
+
+smio_acq_pstream_t *smio_acq_pstream_new (const char *service, uint32_t chan,
+        uint32_t sample_size, uint32_t capacity)
+{
+    assert (service);
+    assert (capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    smio_acq_pstream_t *self = (smio_acq_pstream_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    int rc = snprintf (self->shm_name, sizeof (self->shm_name), "%s%s",
+            ACQ_PSTREAM_SHM_NAME_PREFIX, service);
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (self->shm_name),
+            "Shared memory name is too long", err_shm_name);
+
+    /* A ring left by a previous run would have readers on the wrong
+     * samples */
+    shm_unlink (self->shm_name);
+    int fd = shm_open (self->shm_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    ASSERT_TEST(fd >= 0, "Could not open shared memory object", err_shm_open);
+
+    uint64_t data_offs = sizeof (smio_acq_pstream_hdr_t);
+    self->size = data_offs + (size_t) capacity * sample_size;
+    rc = ftruncate (fd, self->size);
+    ASSERT_TEST(rc == 0, "Could not set shared memory size", err_shm_truncate);
+
+    void *buf = mmap (NULL, self->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+    ASSERT_TEST(buf != MAP_FAILED, "Could not map shared memory region",
+            err_shm_mmap);
+    /* The mapping stays valid after closing the descriptor */
+    close (fd);
+
+    self->hdr = (smio_acq_pstream_hdr_t *) buf;
+    self->data = (uint8_t *) buf + data_offs;
+    self->hdr->version = ACQ_PSTREAM_VERSION;
+    self->hdr->chan = chan;
+    self->hdr->sample_size = sample_size;
+    self->hdr->capacity = capacity;
+    self->hdr->data_offs = data_offs;
+    /* Readers check the magic last */
+    __atomic_store_n (&self->hdr->magic, ACQ_PSTREAM_MAGIC, __ATOMIC_RELEASE);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq_pstream] Position stream "
+            "%s of %u samples of channel %u created\n", self->shm_name,
+            capacity, chan);
+
+    return self;
+
+err_shm_mmap:
+err_shm_truncate:
+    close (fd);
+    shm_unlink (self->shm_name);
+err_shm_open:
+err_shm_name:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+void smio_acq_pstream_destroy (smio_acq_pstream_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_acq_pstream_t *self = *self_p;
+
+        __atomic_or_fetch (&self->hdr->flags, ACQ_PSTREAM_FLAG_STOPPED,
+                __ATOMIC_RELEASE);
+        munmap (self->hdr, self->size);
+        shm_unlink (self->shm_name);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+uint8_t *smio_acq_pstream_reserve (smio_acq_pstream_t *self,
+        uint32_t *num_samples)
+{
+    assert (self);
+    assert (num_samples);
+
+    uint32_t capacity = self->hdr->capacity;
+    uint32_t slot = self->head & (capacity - 1);
+    if (*num_samples > capacity - slot) {
+        *num_samples = capacity - slot;
+    }
+
+    /* Readers must see the samples being overwritten before they are */
+    __atomic_store_n (&self->hdr->reserve, self->head + *num_samples,
+            __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);
+
+    return self->data + (size_t) slot * self->hdr->sample_size;
+}
+
+void smio_acq_pstream_commit (smio_acq_pstream_t *self, uint32_t num_samples)
+{
+    assert (self);
+
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+
+    self->head += num_samples;
+    __atomic_store_n (&self->hdr->timestamp, (uint64_t) now.tv_sec * 1000000000ULL +
+            now.tv_nsec, __ATOMIC_RELAXED);
+    __atomic_store_n (&self->hdr->head, self->head, __ATOMIC_RELEASE);
+}
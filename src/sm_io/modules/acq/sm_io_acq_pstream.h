@@ -0,0 +1,30 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+*/
+
+#ifndef _SM_IO_ACQ_PSTREAM_H_
+#define _SM_IO_ACQ_PSTREAM_H_
+
+typedef struct _smio_acq_pstream_t smio_acq_pstream_t;
+
+/***************** Our methods *****************/
+
+/* Creates the shared memory ring of the position stream of "service", see
+ * smio_acq_pstream_hdr_t, for "capacity" samples of "sample_size" bytes of
+ * channel "chan" */
+smio_acq_pstream_t *smio_acq_pstream_new (const char *service, uint32_t chan,
+        uint32_t sample_size, uint32_t capacity);
+/* Mark the stream as stopped and unlink its ring. Readers that have it
+ * mapped keep it until they close it */
+void smio_acq_pstream_destroy (smio_acq_pstream_t **self_p);
+/* Get where the next samples are written, up to "*num_samples" of them.
+ * "*num_samples" is set to how many fit before the end of the ring */
+uint8_t *smio_acq_pstream_reserve (smio_acq_pstream_t *self,
+        uint32_t *num_samples);
+/* Publish the "num_samples" samples written since the last reserve */
+void smio_acq_pstream_commit (smio_acq_pstream_t *self, uint32_t num_samples);
+
+#endif
@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Capture file recorder. The ACQ SMIO reads the curve from the board into
+ * the recorder buffers and a writer thread writes them to the file
+ * meanwhile, with O_DIRECT, so the board and the disk are kept busy at
+ * the same time and the page cache is not polluted by the dumps. File
+ * systems not supporting O_DIRECT get regular writes instead */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <limits.h>
+
+#include "bpm_server.h"
+/* Private headers */
+#include "sm_io_acq_rec.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io:acq_rec]",     \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)   \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io:acq_rec]",             \
+            smio_err_str(SMIO_ERR_ALLOC),                       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io:acq_rec]",                \
+            smio_err_str (err_type))
+
+struct _smio_acq_rec_t {
+    char *dir;                          /* Directory files are written to */
+    pthread_t worker;                   /* Writer thread */
+    uint8_t *bufs;                      /* ACQ_REC_NUM_BUFS buffers, ACQ_REC_ALIGN
+                                           aligned */
+    uint8_t *hdr_buf;                   /* File header, padded to ACQ_REC_ALIGN */
+    uint64_t next_offs;                 /* File offset of the next buffer submitted */
+    bool short_buf;                     /* A buffer that was not full was submitted,
+                                           so no other can follow it */
+    pthread_mutex_t lock;               /* Protects everything below */
+    pthread_cond_t req_cond;            /* Signaled on new buffers, on close and
+                                           on stop */
+    size_t sizes [ACQ_REC_NUM_BUFS];    /* Bytes of samples of each buffer */
+    uint64_t offs [ACQ_REC_NUM_BUFS];   /* File offset of each buffer */
+    uint32_t head;                      /* Number of buffers submitted */
+    uint32_t tail;                      /* Number of buffers written */
+    int fd;                             /* File being written */
+    bool direct;                        /* "fd" was opened with O_DIRECT */
+    bool open;                          /* A file is being written, up to the end
+                                           of its close */
+    bool closing;                       /* File must be closed once its buffers
+                                           are written */
+    bool abort;                         /* File must be removed on close */
+    bool failed;                        /* A write of the file failed */
+    bool stop;                          /* Writer thread must exit */
+    char path [PATH_MAX];               /* Path of the file being written */
+    bpm_capture_hdr_t hdr;              /* Header of the file being written */
+    uint32_t num_files;                 /* Files written */
+    uint32_t num_failed;                /* Files that failed or were aborted */
+    uint64_t bytes_written;             /* Payload bytes written */
+};
+
+static void *_smio_acq_rec_worker (void *args);
+static bool _smio_acq_rec_pwrite (smio_acq_rec_t *self, uint8_t *data,
+        size_t size, uint64_t offs);
+static void _smio_acq_rec_finish (smio_acq_rec_t *self);
+
+smio_acq_rec_t *smio_acq_rec_new (const char *dir)
+{
+    assert (dir);
+
+    smio_acq_rec_t *self = (smio_acq_rec_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->dir = strdup (dir);
+    ASSERT_ALLOC(self->dir, err_dir_alloc);
+
+    int rc = posix_memalign ((void **) &self->bufs, ACQ_REC_ALIGN,
+            (size_t) ACQ_REC_NUM_BUFS * ACQ_REC_BUF_SIZE);
+    ASSERT_TEST(rc == 0, "Could not allocate recorder buffers", err_bufs_alloc);
+    rc = posix_memalign ((void **) &self->hdr_buf, ACQ_REC_ALIGN, ACQ_REC_ALIGN);
+    ASSERT_TEST(rc == 0, "Could not allocate recorder header buffer",
+            err_hdr_buf_alloc);
+
+    self->fd = -1;
+    pthread_mutex_init (&self->lock, NULL);
+    pthread_cond_init (&self->req_cond, NULL);
+
+    rc = pthread_create (&self->worker, NULL, _smio_acq_rec_worker, self);
+    ASSERT_TEST(rc == 0, "Could not create writer thread", err_worker);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:acq_rec] Recording to %s\n",
+            self->dir);
+    return self;
+
+err_worker:
+    pthread_cond_destroy (&self->req_cond);
+    pthread_mutex_destroy (&self->lock);
+    free (self->hdr_buf);
+err_hdr_buf_alloc:
+    free (self->bufs);
+err_bufs_alloc:
+    free (self->dir);
+err_dir_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+void smio_acq_rec_destroy (smio_acq_rec_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_acq_rec_t *self = *self_p;
+
+        /* The writer thread only exits once the file is finished */
+        smio_acq_rec_close (self, false);
+        pthread_mutex_lock (&self->lock);
+        self->stop = true;
+        pthread_cond_signal (&self->req_cond);
+        pthread_mutex_unlock (&self->lock);
+        pthread_join (self->worker, NULL);
+
+        pthread_cond_destroy (&self->req_cond);
+        pthread_mutex_destroy (&self->lock);
+        free (self->hdr_buf);
+        free (self->bufs);
+        free (self->dir);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+smio_err_e smio_acq_rec_open (smio_acq_rec_t *self, const char *name,
+        const bpm_capture_hdr_t *hdr)
+{
+    assert (self);
+    assert (name);
+    assert (hdr);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    ASSERT_TEST(hdr->payload_offs >= ACQ_REC_ALIGN &&
+            hdr->payload_offs % ACQ_REC_ALIGN == 0,
+            "Payload offset is not aligned", err_inv_param, SMIO_ERR_WRONG_PARAM);
+    ASSERT_TEST(smio_acq_rec_idle (self), "Recorder is busy", err_inv_param,
+            SMIO_ERR_WRONG_PARAM);
+
+    int len = snprintf (self->path, sizeof (self->path), "%s/%s", self->dir, name);
+    ASSERT_TEST(len > 0 && (size_t) len < sizeof (self->path),
+            "Recorder file path is too long", err_inv_param, SMIO_ERR_WRONG_PARAM);
+
+    int fd = open (self->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC |
+            O_DIRECT, 0644);
+    bool direct = true;
+    if (fd == -1 && errno == EINVAL) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq_rec] O_DIRECT is not "
+                "supported for %s. Using regular writes\n", self->path);
+        fd = open (self->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        direct = false;
+    }
+    ASSERT_TEST(fd != -1, "Could not create recorder file", err_open,
+            SMIO_ERR_WRONG_PARAM);
+
+    /* The header is written right away, so a file left behind by a crash
+     * is still recognized. Its payload size is only written on close */
+    memset (self->hdr_buf, 0, ACQ_REC_ALIGN);
+    memcpy (self->hdr_buf, hdr, sizeof (*hdr));
+    ((bpm_capture_hdr_t *) self->hdr_buf)->payload_size = 0;
+    ssize_t ret = pwrite (fd, self->hdr_buf, ACQ_REC_ALIGN, 0);
+    ASSERT_TEST(ret == ACQ_REC_ALIGN, "Could not write recorder file header",
+            err_write_hdr, SMIO_ERR_WRONG_PARAM);
+
+    self->next_offs = hdr->payload_offs;
+    self->short_buf = false;
+
+    pthread_mutex_lock (&self->lock);
+    self->fd = fd;
+    self->direct = direct;
+    self->hdr = *hdr;
+    self->hdr.payload_size = 0;
+    self->open = true;
+    self->closing = false;
+    self->abort = false;
+    self->failed = false;
+    pthread_mutex_unlock (&self->lock);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq_rec] Recording channel "
+            "%u to %s\n", hdr->chan, self->path);
+    return err;
+
+err_write_hdr:
+    close (fd);
+    unlink (self->path);
+err_open:
+err_inv_param:
+    return err;
+}
+
+uint8_t *smio_acq_rec_get_buf (smio_acq_rec_t *self)
+{
+    assert (self);
+
+    pthread_mutex_lock (&self->lock);
+    uint8_t *buf = (self->head - self->tail < ACQ_REC_NUM_BUFS) ?
+        self->bufs + (size_t) (self->head % ACQ_REC_NUM_BUFS) * ACQ_REC_BUF_SIZE :
+        NULL;
+    pthread_mutex_unlock (&self->lock);
+
+    return buf;
+}
+
+smio_err_e smio_acq_rec_submit (smio_acq_rec_t *self, size_t size)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    ASSERT_TEST(size > 0 && size <= ACQ_REC_BUF_SIZE && !self->short_buf,
+            "Invalid recorder buffer size", err_inv_param, SMIO_ERR_WRONG_PARAM);
+
+    pthread_mutex_lock (&self->lock);
+    uint32_t idx = self->head % ACQ_REC_NUM_BUFS;
+    self->sizes [idx] = size;
+    self->offs [idx] = self->next_offs;
+    self->hdr.payload_size += size;
+    self->head++;
+    pthread_cond_signal (&self->req_cond);
+    pthread_mutex_unlock (&self->lock);
+
+    self->next_offs += size;
+    self->short_buf = (size < ACQ_REC_BUF_SIZE);
+
+err_inv_param:
+    return err;
+}
+
+void smio_acq_rec_close (smio_acq_rec_t *self, bool abort)
+{
+    assert (self);
+
+    pthread_mutex_lock (&self->lock);
+    if (self->open && !self->closing) {
+        self->closing = true;
+        self->abort = abort;
+        pthread_cond_signal (&self->req_cond);
+    }
+    pthread_mutex_unlock (&self->lock);
+}
+
+bool smio_acq_rec_idle (smio_acq_rec_t *self)
+{
+    assert (self);
+
+    pthread_mutex_lock (&self->lock);
+    bool idle = !self->open;
+    pthread_mutex_unlock (&self->lock);
+
+    return idle;
+}
+
+void smio_acq_rec_get_stats (smio_acq_rec_t *self, uint32_t *num_files,
+        uint32_t *num_failed, uint64_t *bytes_written)
+{
+    assert (self);
+
+    pthread_mutex_lock (&self->lock);
+    *num_files = self->num_files;
+    *num_failed = self->num_failed;
+    *bytes_written = self->bytes_written;
+    pthread_mutex_unlock (&self->lock);
+}
+
+/* Write the buffers submitted, in order, and finish the file once asked
+ * to and all of them are written */
+static void *_smio_acq_rec_worker (void *args)
+{
+    smio_acq_rec_t *self = (smio_acq_rec_t *) args;
+
+    pthread_mutex_lock (&self->lock);
+    while (true) {
+        while (!self->stop && !self->closing && self->tail == self->head) {
+            pthread_cond_wait (&self->req_cond, &self->lock);
+        }
+
+        if (self->tail != self->head) {
+            uint32_t idx = self->tail % ACQ_REC_NUM_BUFS;
+            size_t size = self->sizes [idx];
+            uint64_t offs = self->offs [idx];
+            bool failed = self->failed;
+            pthread_mutex_unlock (&self->lock);
+
+            /* Buffers of a file that already failed are just dropped */
+            bool ok = !failed && _smio_acq_rec_pwrite (self, self->bufs +
+                    (size_t) idx * ACQ_REC_BUF_SIZE, size, offs);
+
+            pthread_mutex_lock (&self->lock);
+            if (ok) {
+                self->bytes_written += size;
+            }
+            else {
+                self->failed = true;
+            }
+            self->tail++;
+            continue;
+        }
+
+        if (self->closing) {
+            pthread_mutex_unlock (&self->lock);
+            _smio_acq_rec_finish (self);
+            pthread_mutex_lock (&self->lock);
+            continue;
+        }
+
+        if (self->stop) {
+            break;
+        }
+    }
+    pthread_mutex_unlock (&self->lock);
+
+    return NULL;
+}
+
+/* Write "size" bytes of "data" at "offs". With O_DIRECT, the last buffer of
+ * the file is padded to ACQ_REC_ALIGN, and the file truncated on close */
+static bool _smio_acq_rec_pwrite (smio_acq_rec_t *self, uint8_t *data,
+        size_t size, uint64_t offs)
+{
+    if (self->direct && size % ACQ_REC_ALIGN != 0) {
+        size_t padded_size = (size + ACQ_REC_ALIGN - 1) & ~((size_t) ACQ_REC_ALIGN - 1);
+        memset (data + size, 0, padded_size - size);
+        size = padded_size;
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pwrite (self->fd, data + done, size - done, offs + done);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (ret <= 0) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq_rec] Could not write "
+                    "to %s: %s\n", self->path, strerror (errno));
+            return false;
+        }
+        done += ret;
+    }
+
+    return true;
+}
+
+/* Write the final header of the file and close it, or remove it if it
+ * failed or was aborted */
+static void _smio_acq_rec_finish (smio_acq_rec_t *self)
+{
+    pthread_mutex_lock (&self->lock);
+    bool keep = !self->failed && !self->abort;
+    uint64_t payload_size = self->hdr.payload_size;
+    ((bpm_capture_hdr_t *) self->hdr_buf)->payload_size = payload_size;
+    pthread_mutex_unlock (&self->lock);
+
+    if (keep) {
+        keep = ftruncate (self->fd, self->hdr.payload_offs + payload_size) == 0 &&
+            pwrite (self->fd, self->hdr_buf, ACQ_REC_ALIGN, 0) == ACQ_REC_ALIGN &&
+            fdatasync (self->fd) == 0;
+        if (!keep) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq_rec] Could not "
+                    "finish %s: %s\n", self->path, strerror (errno));
+        }
+    }
+
+    close (self->fd);
+    if (!keep) {
+        unlink (self->path);
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:acq_rec] %s %s, %"PRIu64
+            " bytes of payload\n", keep ? "Recorded" : "Removed", self->path,
+            payload_size);
+
+    pthread_mutex_lock (&self->lock);
+    self->fd = -1;
+    self->open = false;
+    self->closing = false;
+    if (keep) {
+        self->num_files++;
+    }
+    else {
+        self->num_failed++;
+    }
+    pthread_mutex_unlock (&self->lock);
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+*/
+
+#ifndef _SM_IO_ACQ_REC_H_
+#define _SM_IO_ACQ_REC_H_
+
+/* Number of buffers handed to the writer thread, so the board is read
+ * into one while the others are written */
+#define ACQ_REC_NUM_BUFS                4
+/* Buffer size. All but the last buffer of a file must be full, as they
+ * are written with O_DIRECT */
+#define ACQ_REC_BUF_SIZE                (4 << 20)
+/* Alignment of the buffers, file offsets and sizes written with O_DIRECT */
+#define ACQ_REC_ALIGN                   BPM_CAPTURE_PAYLOAD_ALIGN
+
+/* Capture file recorder. Curves are written to capture files (see
+ * bpm_capture_hdr_t) by a thread of its own, bypassing the page cache
+ * when the file system allows it. One file is written at a time */
+typedef struct _smio_acq_rec_t smio_acq_rec_t;
+
+/***************** Our methods *****************/
+
+/* Creates a new recorder writing its files to the directory "dir" */
+smio_acq_rec_t *smio_acq_rec_new (const char *dir);
+/* Destroy the recorder. The file being written, if any, is finished first */
+void smio_acq_rec_destroy (smio_acq_rec_t **self_p);
+
+/* Create the file "name" in the recorder directory and write "hdr" to it.
+ * The payload offset of "hdr" must be ACQ_REC_ALIGN aligned. Fails if the
+ * previous file is not finished yet, see smio_acq_rec_idle () */
+smio_err_e smio_acq_rec_open (smio_acq_rec_t *self, const char *name,
+        const bpm_capture_hdr_t *hdr);
+/* Get a buffer of ACQ_REC_BUF_SIZE bytes to fill with the next samples of
+ * the file. Returns NULL if all of them are waiting to be written */
+uint8_t *smio_acq_rec_get_buf (smio_acq_rec_t *self);
+/* Hand the buffer from smio_acq_rec_get_buf (), holding "size" bytes of
+ * samples, to the writer thread */
+smio_err_e smio_acq_rec_submit (smio_acq_rec_t *self, size_t size);
+/* Finish the file once all of its buffers are written, writing the
+ * payload size to its header. If "abort" is set, the file is removed
+ * instead. Does not wait for the writer thread */
+void smio_acq_rec_close (smio_acq_rec_t *self, bool abort);
+/* No file is being written */
+bool smio_acq_rec_idle (smio_acq_rec_t *self);
+/* Get the number of files written, of files that failed or were aborted,
+ * and of payload bytes written */
+void smio_acq_rec_get_stats (smio_acq_rec_t *self, uint32_t *num_files,
+        uint32_t *num_failed, uint64_t *bytes_written);
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Acquisition data reduction kernels. Each sample is composed of
+ * ACQ_REDUCE_NUM_ATOMS interleaved atoms (e.g., the 4 ADC channels or
+ * X/Y/Q/SUM). The kernels deinterleave the atoms a client asked for and
+ * drop the samples it does not want, so only those are sent on the wire */
+
+#include "bpm_server.h"
+/* Private headers */
+#include "sm_io_acq_codes.h"
+#include "sm_io_acq_reduce.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define ACQ_REDUCE_X86
+#include <immintrin.h>
+#endif
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io:acq_reduce]",  \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)   \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io:acq_reduce]",          \
+            smio_err_str(SMIO_ERR_ALLOC),                       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io:acq_reduce]",             \
+            smio_err_str (err_type))
+
+#define ACQ_REDUCE_VEC_SIZE             16  /* in bytes */
+
+/************ Scalar kernels **********/
+
+/* Atoms are read before being written to a lower or equal position, so
+ * these work in place */
+static size_t _acq_reduce_16_scalar (uint8_t *dst, const uint8_t *src,
+        size_t num_samples, uint32_t first, uint32_t decim, uint32_t atom_mask)
+{
+    uint16_t *d = (uint16_t *) dst;
+    const uint16_t *s = (const uint16_t *) src;
+    size_t n = 0;
+
+    for (size_t i = first; i < num_samples; i += decim) {
+        for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+            if (atom_mask & (1 << a)) {
+                d [n++] = s [i*ACQ_REDUCE_NUM_ATOMS + a];
+            }
+        }
+    }
+
+    return n * sizeof (*d);
+}
+
+static size_t _acq_reduce_32_scalar (uint8_t *dst, const uint8_t *src,
+        size_t num_samples, uint32_t first, uint32_t decim, uint32_t atom_mask)
+{
+    uint32_t *d = (uint32_t *) dst;
+    const uint32_t *s = (const uint32_t *) src;
+    size_t n = 0;
+
+    for (size_t i = first; i < num_samples; i += decim) {
+        for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+            if (atom_mask & (1 << a)) {
+                d [n++] = s [i*ACQ_REDUCE_NUM_ATOMS + a];
+            }
+        }
+    }
+
+    return n * sizeof (*d);
+}
+
+#if defined (ACQ_REDUCE_X86)
+
+/************ SSSE3 kernels **********/
+
+/* Fill a PSHUFB control that packs the selected atoms of all the samples
+ * of a vector at its start. Returns the number of bytes packed */
+static size_t _acq_reduce_shuffle_ctl (uint8_t *ctl, size_t atom_size,
+        uint32_t atom_mask)
+{
+    size_t sample_size = atom_size * ACQ_REDUCE_NUM_ATOMS;
+    size_t n = 0;
+
+    memset (ctl, 0x80, ACQ_REDUCE_VEC_SIZE);
+    for (size_t s = 0; s < ACQ_REDUCE_VEC_SIZE; s += sample_size) {
+        for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+            if (!(atom_mask & (1 << a))) {
+                continue;
+            }
+            for (size_t b = 0; b < atom_size; ++b) {
+                ctl [n++] = s + a*atom_size + b;
+            }
+        }
+    }
+
+    return n;
+}
+
+/* Two samples per vector. The store may clobber the sample after the first
+ * one, but it was either loaded already (decim = 1) or is not wanted */
+__attribute__ ((target ("ssse3")))
+static size_t _acq_reduce_16_ssse3 (uint8_t *dst, const uint8_t *src,
+        size_t num_samples, uint32_t first, uint32_t decim, uint32_t atom_mask)
+{
+    const size_t sample_size = ACQ_REDUCE_NUM_ATOMS * sizeof (uint16_t);
+    uint8_t ctl_bytes [ACQ_REDUCE_VEC_SIZE];
+    size_t out_size = _acq_reduce_shuffle_ctl (ctl_bytes, sizeof (uint16_t),
+            atom_mask);
+    __m128i ctl = _mm_loadu_si128 ((const __m128i *) ctl_bytes);
+    uint8_t *d = dst;
+    size_t i = first;
+
+    for (; i + decim < num_samples; i += 2*decim) {
+        __m128i lo = _mm_loadl_epi64 ((const __m128i *) (src + i*sample_size));
+        __m128i hi = _mm_loadl_epi64 ((const __m128i *) (src + (i + decim)*sample_size));
+        _mm_storeu_si128 ((__m128i *) d,
+                _mm_shuffle_epi8 (_mm_unpacklo_epi64 (lo, hi), ctl));
+        d += out_size;
+    }
+
+    /* Last sample, if any */
+    d += _acq_reduce_16_scalar (d, src, num_samples, i, decim, atom_mask);
+    return d - dst;
+}
+
+/* One sample per vector */
+__attribute__ ((target ("ssse3")))
+static size_t _acq_reduce_32_ssse3 (uint8_t *dst, const uint8_t *src,
+        size_t num_samples, uint32_t first, uint32_t decim, uint32_t atom_mask)
+{
+    const size_t sample_size = ACQ_REDUCE_NUM_ATOMS * sizeof (uint32_t);
+    uint8_t ctl_bytes [ACQ_REDUCE_VEC_SIZE];
+    size_t out_size = _acq_reduce_shuffle_ctl (ctl_bytes, sizeof (uint32_t),
+            atom_mask);
+    __m128i ctl = _mm_loadu_si128 ((const __m128i *) ctl_bytes);
+    uint8_t *d = dst;
+
+    for (size_t i = first; i < num_samples; i += decim) {
+        __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i*sample_size));
+        _mm_storeu_si128 ((__m128i *) d, _mm_shuffle_epi8 (v, ctl));
+        d += out_size;
+    }
+
+    return d - dst;
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used */
+static const smio_acq_reduce_ops_t smio_acq_reduce_ops [] = {
+#if defined (ACQ_REDUCE_X86)
+    {.name = "ssse3",   .reduce_16 = _acq_reduce_16_ssse3,
+                        .reduce_32 = _acq_reduce_32_ssse3},
+#endif
+    {.name = "scalar",  .reduce_16 = _acq_reduce_16_scalar,
+                        .reduce_32 = _acq_reduce_32_scalar}
+};
+
+#define ACQ_REDUCE_OPS_NUM              (sizeof (smio_acq_reduce_ops) / \
+                                            sizeof (smio_acq_reduce_ops [0]))
+
+static bool _acq_reduce_supported (const smio_acq_reduce_ops_t *ops)
+{
+#if defined (ACQ_REDUCE_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "ssse3")) {
+        return __builtin_cpu_supports ("ssse3");
+    }
+#endif
+    return streq (ops->name, "scalar");
+}
+
+const smio_acq_reduce_ops_t *smio_acq_reduce_get_ops (void)
+{
+    for (size_t i = 0; i < ACQ_REDUCE_OPS_NUM; ++i) {
+        if (_acq_reduce_supported (&smio_acq_reduce_ops [i])) {
+            return &smio_acq_reduce_ops [i];
+        }
+    }
+
+    /* The scalar kernel is always supported */
+    return &smio_acq_reduce_ops [ACQ_REDUCE_OPS_NUM-1];
+}
+
+ssize_t smio_acq_reduce (const smio_acq_reduce_ops_t *ops, uint8_t *data,
+        size_t size, uint32_t sample_size, uint32_t first, uint32_t decim,
+        uint32_t atom_mask)
+{
+    assert (ops);
+    assert (data);
+    assert (decim > 0);
+
+    size_t num_samples = size / sample_size;
+
+    /* Nothing to do */
+    if (atom_mask == ACQ_REDUCE_ATOM_MASK_ALL && decim == 1) {
+        return num_samples * sample_size;
+    }
+
+    switch (sample_size) {
+        case ACQ_REDUCE_NUM_ATOMS * sizeof (uint16_t):
+            return ops->reduce_16 (data, data, num_samples, first, decim,
+                    atom_mask);
+
+        case ACQ_REDUCE_NUM_ATOMS * sizeof (uint32_t):
+            return ops->reduce_32 (data, data, num_samples, first, decim,
+                    atom_mask);
+
+        default:
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq_reduce] Sample size "
+                    "%u is not supported\n", sample_size);
+            return -1;
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+*/
+
+#ifndef _SM_IO_ACQ_REDUCE_H_
+#define _SM_IO_ACQ_REDUCE_H_
+
+/* Copy the atoms selected by "atom_mask" of every "decim"-th sample of "src",
+ * starting at sample "first", to "dst". Returns the number of bytes written.
+ * Up to 16 bytes past the output may be clobbered. "dst" may be the same
+ * as "src", in which case nothing past the input is touched */
+typedef size_t (*smio_acq_reduce_fp) (uint8_t *dst, const uint8_t *src,
+        size_t num_samples, uint32_t first, uint32_t decim, uint32_t atom_mask);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    smio_acq_reduce_fp reduce_16;   /* 16-bit atoms (8-byte samples, e.g. ADC) */
+    smio_acq_reduce_fp reduce_32;   /* 32-bit atoms (16-byte samples, e.g. positions) */
+} smio_acq_reduce_ops_t;
+
+/***************** Our methods *****************/
+
+/* Get the fastest reduction kernels the CPU supports */
+const smio_acq_reduce_ops_t *smio_acq_reduce_get_ops (void);
+/* Reduce "size" bytes of "sample_size" samples in place. Returns the
+ * reduced size in bytes or -1 if the sample size is not supported */
+ssize_t smio_acq_reduce (const smio_acq_reduce_ops_t *ops, uint8_t *data,
+        size_t size, uint32_t sample_size, uint32_t first, uint32_t decim,
+        uint32_t atom_mask);
+
+#endif
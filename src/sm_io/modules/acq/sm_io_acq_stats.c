@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+/* Acquisition statistics kernels. The atoms of each sample (see
+ * ACQ_REDUCE_NUM_ATOMS) are accumulated separately, so a client gets the
+ * mean, RMS and spread of each channel without reading the curve */
+
+#include <math.h>
+
+#include "bpm_server.h"
+/* Private headers */
+#include "sm_io_acq_codes.h"
+#include "sm_io_acq_stats.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#define ACQ_STATS_X86
+#include <emmintrin.h>
+#endif
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io:acq_stats]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...)   \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io:acq_stats]",           \
+            smio_err_str(SMIO_ERR_ALLOC),                       \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                                \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io:acq_stats]",              \
+            smio_err_str (err_type))
+
+/* Percentiles reported, see ACQ_STATS_NUM_PCTL */
+static const double acq_stats_pctl [ACQ_STATS_NUM_PCTL] = {1, 5, 50, 95, 99};
+
+/************ Scalar kernels **********/
+
+/* Squares of 16-bit atoms are summed exactly, as they fit in 64 bits for
+ * any curve that fits in memory */
+static void _acq_stats_16_scalar (smio_acq_stats_acc_t *acc,
+        const uint8_t *src, size_t num_samples)
+{
+    const int16_t *s = (const int16_t *) src;
+
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+        int64_t min = acc [a].min;
+        int64_t max = acc [a].max;
+        int64_t sum = 0;
+        uint64_t sum_sq = 0;
+
+        for (size_t i = 0; i < num_samples; ++i) {
+            int64_t v = s [i*ACQ_REDUCE_NUM_ATOMS + a];
+            min = (v < min) ? v : min;
+            max = (v > max) ? v : max;
+            sum += v;
+            sum_sq += (uint64_t) (v*v);
+        }
+
+        acc [a].num += num_samples;
+        acc [a].min = min;
+        acc [a].max = max;
+        acc [a].sum += sum;
+        acc [a].sum_sq += (double) sum_sq;
+    }
+}
+
+static void _acq_stats_32_scalar (smio_acq_stats_acc_t *acc,
+        const uint8_t *src, size_t num_samples)
+{
+    const int32_t *s = (const int32_t *) src;
+
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+        int64_t min = acc [a].min;
+        int64_t max = acc [a].max;
+        int64_t sum = 0;
+        double sum_sq = 0;
+
+        for (size_t i = 0; i < num_samples; ++i) {
+            int64_t v = s [i*ACQ_REDUCE_NUM_ATOMS + a];
+            min = (v < min) ? v : min;
+            max = (v > max) ? v : max;
+            sum += v;
+            sum_sq += (double) v * (double) v;
+        }
+
+        acc [a].num += num_samples;
+        acc [a].min = min;
+        acc [a].max = max;
+        acc [a].sum += sum;
+        acc [a].sum_sq += sum_sq;
+    }
+}
+
+#if defined (ACQ_STATS_X86)
+
+/************ SSE2 kernels **********/
+
+/* Vectors of 32-bit sums are flushed before they could overflow. Each
+ * lane gets two atoms of at most 2^15 per iteration */
+#define ACQ_STATS_16_FLUSH_ITERS        (1 << 15)
+
+/* Two samples per vector, so lanes i and i+4 hold atom i. Sums are kept
+ * in 32-bit lanes, one per atom, and squares in 64-bit lanes, as the
+ * squares of two atoms take up to 2^31 */
+__attribute__ ((target ("sse2")))
+static void _acq_stats_16_sse2 (smio_acq_stats_acc_t *acc,
+        const uint8_t *src, size_t num_samples)
+{
+    const size_t sample_size = ACQ_REDUCE_NUM_ATOMS * sizeof (int16_t);
+    const __m128i zero = _mm_setzero_si128 ();
+    __m128i vmin = _mm_set1_epi16 (INT16_MAX);
+    __m128i vmax = _mm_set1_epi16 (INT16_MIN);
+    __m128i vsq_01 = zero;          /* 64-bit squares of atoms 0 and 1 */
+    __m128i vsq_23 = zero;          /* 64-bit squares of atoms 2 and 3 */
+    int64_t sum [ACQ_REDUCE_NUM_ATOMS] = {0};
+    size_t i = 0;
+
+    while (i + 1 < num_samples) {
+        __m128i vsum = zero;
+        size_t iters = (num_samples - i) / 2;
+        iters = (iters > ACQ_STATS_16_FLUSH_ITERS) ? ACQ_STATS_16_FLUSH_ITERS : iters;
+
+        for (size_t n = 0; n < iters; ++n, i += 2) {
+            __m128i v = _mm_loadu_si128 ((const __m128i *) (src + i*sample_size));
+            vmin = _mm_min_epi16 (vmin, v);
+            vmax = _mm_max_epi16 (vmax, v);
+
+            /* Sign extended atoms of each sample */
+            __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+            __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+            vsum = _mm_add_epi32 (vsum, _mm_add_epi32 (lo, hi));
+
+            /* With the atoms zero extended to 32 bits, each pair of 16-bit
+             * products is the square of an atom alone. The sum of two
+             * squares is at most 2^31, so it is taken as unsigned */
+            __m128i zlo = _mm_unpacklo_epi16 (v, zero);
+            __m128i zhi = _mm_unpackhi_epi16 (v, zero);
+            __m128i sq = _mm_add_epi32 (_mm_madd_epi16 (zlo, zlo),
+                    _mm_madd_epi16 (zhi, zhi));
+            vsq_01 = _mm_add_epi64 (vsq_01, _mm_unpacklo_epi32 (sq, zero));
+            vsq_23 = _mm_add_epi64 (vsq_23, _mm_unpackhi_epi32 (sq, zero));
+        }
+
+        int32_t sum32 [ACQ_REDUCE_NUM_ATOMS];
+        _mm_storeu_si128 ((__m128i *) sum32, vsum);
+        for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+            sum [a] += sum32 [a];
+        }
+    }
+
+    int16_t min16 [2*ACQ_REDUCE_NUM_ATOMS];
+    int16_t max16 [2*ACQ_REDUCE_NUM_ATOMS];
+    uint64_t sq64 [ACQ_REDUCE_NUM_ATOMS];
+    _mm_storeu_si128 ((__m128i *) min16, vmin);
+    _mm_storeu_si128 ((__m128i *) max16, vmax);
+    _mm_storeu_si128 ((__m128i *) sq64, vsq_01);
+    _mm_storeu_si128 ((__m128i *) (sq64 + 2), vsq_23);
+
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS && i > 0; ++a) {
+        int64_t min = (min16 [a] < min16 [a + ACQ_REDUCE_NUM_ATOMS]) ?
+            min16 [a] : min16 [a + ACQ_REDUCE_NUM_ATOMS];
+        int64_t max = (max16 [a] > max16 [a + ACQ_REDUCE_NUM_ATOMS]) ?
+            max16 [a] : max16 [a + ACQ_REDUCE_NUM_ATOMS];
+
+        acc [a].num += i;
+        acc [a].min = (min < acc [a].min) ? min : acc [a].min;
+        acc [a].max = (max > acc [a].max) ? max : acc [a].max;
+        acc [a].sum += sum [a];
+        acc [a].sum_sq += (double) sq64 [a];
+    }
+
+    /* Last sample, if any */
+    _acq_stats_16_scalar (acc, src + i*sample_size, num_samples - i);
+}
+
+#endif
+
+/* Ordered from the best to the worst. The first one the CPU supports
+ * is used. 32-bit atoms are left to the compiler */
+static const smio_acq_stats_ops_t smio_acq_stats_ops [] = {
+#if defined (ACQ_STATS_X86)
+    {.name = "sse2",    .stats_16 = _acq_stats_16_sse2,
+                        .stats_32 = _acq_stats_32_scalar},
+#endif
+    {.name = "scalar",  .stats_16 = _acq_stats_16_scalar,
+                        .stats_32 = _acq_stats_32_scalar}
+};
+
+#define ACQ_STATS_OPS_NUM               (sizeof (smio_acq_stats_ops) / \
+                                            sizeof (smio_acq_stats_ops [0]))
+
+static bool _acq_stats_supported (const smio_acq_stats_ops_t *ops)
+{
+#if defined (ACQ_STATS_X86)
+    __builtin_cpu_init ();
+    if (streq (ops->name, "sse2")) {
+        return __builtin_cpu_supports ("sse2");
+    }
+#endif
+    return streq (ops->name, "scalar");
+}
+
+const smio_acq_stats_ops_t *smio_acq_stats_get_ops (void)
+{
+    for (size_t i = 0; i < ACQ_STATS_OPS_NUM; ++i) {
+        if (_acq_stats_supported (&smio_acq_stats_ops [i])) {
+            return &smio_acq_stats_ops [i];
+        }
+    }
+
+    /* The scalar kernel is always supported */
+    return &smio_acq_stats_ops [ACQ_STATS_OPS_NUM-1];
+}
+
+void smio_acq_stats_init (smio_acq_stats_acc_t *acc)
+{
+    assert (acc);
+
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+        acc [a] = (smio_acq_stats_acc_t) {
+            .num = 0,
+            .min = INT64_MAX,
+            .max = INT64_MIN,
+            .sum = 0,
+            .sum_sq = 0
+        };
+    }
+}
+
+int smio_acq_stats_accumulate (const smio_acq_stats_ops_t *ops,
+        smio_acq_stats_acc_t *acc, const uint8_t *data, size_t size,
+        uint32_t sample_size)
+{
+    assert (ops);
+    assert (acc);
+    assert (data);
+
+    size_t num_samples = size / sample_size;
+
+    switch (sample_size) {
+        case ACQ_REDUCE_NUM_ATOMS * sizeof (int16_t):
+            ops->stats_16 (acc, data, num_samples);
+            return 0;
+
+        case ACQ_REDUCE_NUM_ATOMS * sizeof (int32_t):
+            ops->stats_32 (acc, data, num_samples);
+            return 0;
+
+        default:
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:acq_stats] Sample size "
+                    "%u is not supported\n", sample_size);
+            return -1;
+    }
+}
+
+/* Bin of "v", out of ACQ_STATS_HIST_BINS spanning [min, min+range) */
+static inline uint32_t _acq_stats_bin (int64_t v, int64_t min, uint64_t range)
+{
+    return (uint32_t) ((uint64_t) (v - min) * ACQ_STATS_HIST_BINS / range);
+}
+
+void smio_acq_stats_hist (uint32_t *hist, const smio_acq_stats_acc_t *acc,
+        const uint8_t *data, size_t size, uint32_t sample_size)
+{
+    assert (hist);
+    assert (acc);
+    assert (data);
+
+    size_t num_samples = size / sample_size;
+    size_t atom_size = sample_size / ACQ_REDUCE_NUM_ATOMS;
+
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+        uint32_t *h = hist + a*ACQ_STATS_HIST_BINS;
+        int64_t min = acc [a].min;
+        uint64_t range = (uint64_t) (acc [a].max - min) + 1;
+
+        if (atom_size == sizeof (int16_t)) {
+            const int16_t *s = (const int16_t *) data;
+            for (size_t i = 0; i < num_samples; ++i) {
+                h [_acq_stats_bin (s [i*ACQ_REDUCE_NUM_ATOMS + a], min, range)]++;
+            }
+        }
+        else {
+            const int32_t *s = (const int32_t *) data;
+            for (size_t i = 0; i < num_samples; ++i) {
+                h [_acq_stats_bin (s [i*ACQ_REDUCE_NUM_ATOMS + a], min, range)]++;
+            }
+        }
+    }
+}
+
+void smio_acq_stats_finish (const smio_acq_stats_acc_t *acc,
+        const uint32_t *hist, smio_acq_atom_stats_t *stats)
+{
+    assert (acc);
+    assert (stats);
+
+    for (uint32_t a = 0; a < ACQ_REDUCE_NUM_ATOMS; ++a) {
+        memset (&stats [a], 0, sizeof (stats [a]));
+        if (acc [a].num == 0) {
+            continue;
+        }
+
+        double num = (double) acc [a].num;
+        double mean = (double) acc [a].sum / num;
+        double mean_sq = acc [a].sum_sq / num;
+        double var = mean_sq - mean*mean;
+
+        stats [a].min = acc [a].min;
+        stats [a].max = acc [a].max;
+        stats [a].mean = mean;
+        stats [a].rms = sqrt (mean_sq);
+        /* Rounding might take the variance of a flat curve below 0 */
+        stats [a].std = (var > 0) ? sqrt (var) : 0;
+
+        if (hist == NULL) {
+            continue;
+        }
+
+        /* Nearest rank. The value reported is the smallest one falling in
+         * the bin, which is exact if every bin holds a single value */
+        const uint32_t *h = hist + a*ACQ_STATS_HIST_BINS;
+        uint64_t range = (uint64_t) (acc [a].max - acc [a].min) + 1;
+        uint64_t count = 0;
+        uint32_t bin = 0;
+
+        for (uint32_t p = 0; p < ACQ_STATS_NUM_PCTL; ++p) {
+            uint64_t rank = (uint64_t) ceil (acq_stats_pctl [p] / 100 * num);
+            rank = (rank == 0) ? 1 : rank;
+
+            while (bin < ACQ_STATS_HIST_BINS - 1 && count + h [bin] < rank) {
+                count += h [bin++];
+            }
+
+            uint64_t offs = ((uint64_t) bin * range + ACQ_STATS_HIST_BINS - 1) /
+                ACQ_STATS_HIST_BINS;
+            stats [a].pctl [p] = (double) (acc [a].min + (int64_t) offs);
+        }
+    }
+}
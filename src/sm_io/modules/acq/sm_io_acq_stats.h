@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2015 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+*/
+
+#ifndef _SM_IO_ACQ_STATS_H_
+#define _SM_IO_ACQ_STATS_H_
+
+/* Curves are read and accumulated this much at a time */
+#define ACQ_STATS_CHUNK_SIZE            (1 << 20)   /* in bytes */
+
+/* Running sums of one atom */
+typedef struct {
+    uint64_t num;                   /* Number of samples accumulated */
+    int64_t min;                    /* Minimum */
+    int64_t max;                    /* Maximum */
+    int64_t sum;                    /* Sum */
+    double sum_sq;                  /* Sum of the squares */
+} smio_acq_stats_acc_t;
+
+/* Accumulate the ACQ_REDUCE_NUM_ATOMS atoms of the "num_samples" samples of
+ * "src" into "acc", one entry per atom */
+typedef void (*smio_acq_stats_fp) (smio_acq_stats_acc_t *acc,
+        const uint8_t *src, size_t num_samples);
+
+typedef struct {
+    const char *name;               /* Kernel name */
+    smio_acq_stats_fp stats_16;     /* 16-bit atoms (8-byte samples, e.g. ADC) */
+    smio_acq_stats_fp stats_32;     /* 32-bit atoms (16-byte samples, e.g. positions) */
+} smio_acq_stats_ops_t;
+
+/***************** Our methods *****************/
+
+/* Get the fastest statistics kernels the CPU supports */
+const smio_acq_stats_ops_t *smio_acq_stats_get_ops (void);
+/* Reset the running sums of all of the atoms */
+void smio_acq_stats_init (smio_acq_stats_acc_t *acc);
+/* Accumulate "size" bytes of "sample_size" samples into "acc". Returns 0
+ * if ok or -1 if the sample size is not supported */
+int smio_acq_stats_accumulate (const smio_acq_stats_ops_t *ops,
+        smio_acq_stats_acc_t *acc, const uint8_t *data, size_t size,
+        uint32_t sample_size);
+/* Add "size" bytes of "sample_size" samples to the ACQ_STATS_HIST_BINS
+ * bins histograms "hist" of each atom, spanning the minimum to the maximum
+ * found in "acc" */
+void smio_acq_stats_hist (uint32_t *hist, const smio_acq_stats_acc_t *acc,
+        const uint8_t *data, size_t size, uint32_t sample_size);
+/* Fill "stats" from the running sums of each atom and, if not NULL, from
+ * their histograms */
+void smio_acq_stats_finish (const smio_acq_stats_acc_t *acc,
+        const uint32_t *hist, smio_acq_atom_stats_t *stats);
+
+#endif
@@ -15,6 +15,17 @@ struct _smio_afc_diag_revision_data_t {
     uint8_t data[AFC_DIAG_REVISION_BLOCK_SIZE];       /* data buffer */
 };
 
+/* Identity of the board and of the software, read once by the SMIO as
+ * none of it changes while the FPGA is loaded. Strings are NULL terminated */
+struct _smio_afc_diag_identity_t {
+    uint32_t card_slot;                                 /* uTCA card slot */
+    uint32_t ipmi_addr;                                 /* IPMI address */
+    char build_revision [AFC_DIAG_REVISION_BLOCK_SIZE];
+    char build_date [AFC_DIAG_REVISION_BLOCK_SIZE];
+    char build_user_name [AFC_DIAG_REVISION_BLOCK_SIZE];
+    char build_user_email [AFC_DIAG_REVISION_BLOCK_SIZE];
+};
+
 /* Messaging OPCODES */
 #define AFC_DIAG_OPCODE_TYPE                        uint32_t
 #define AFC_DIAG_OPCODE_SIZE                        (sizeof (AFC_DIAG_OPCODE_TYPE))
@@ -31,7 +42,9 @@ struct _smio_afc_diag_revision_data_t {
 #define AFC_DIAG_NAME_GET_BUILD_USER_NAME           "afc_diag_build_user_name"
 #define AFC_DIAG_OPCODE_GET_BUILD_USER_EMAIL        5
 #define AFC_DIAG_NAME_GET_BUILD_USER_EMAIL          "afc_diag_build_user_email"
-#define AFC_DIAG_OPCODE_END                         6
+#define AFC_DIAG_OPCODE_GET_IDENTITY                6
+#define AFC_DIAG_NAME_GET_IDENTITY                  "afc_diag_identity"
+#define AFC_DIAG_OPCODE_END                         7
 
 /* Messaging Reply OPCODES */
 #define AFC_DIAG_REPLY_TYPE                         uint32_t
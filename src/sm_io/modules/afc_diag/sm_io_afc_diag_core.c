@@ -7,7 +7,9 @@
 
 #include "bpm_server.h"
 /* Private headers */
+#include "sm_io_afc_diag_codes.h"
 #include "sm_io_afc_diag_core.h"
+#include "hw/wb_afc_diag_regs.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
 #ifdef ASSERT_TEST
@@ -35,11 +37,25 @@
 /* Creates a new instance of Device Information */
 smio_afc_diag_t * smio_afc_diag_new (smio_t *parent)
 {
-    (void) parent;
-
     smio_afc_diag_t *self = (smio_afc_diag_t *) zmalloc (sizeof *self);
     ASSERT_ALLOC(self, err_self_alloc);
 
+    /* Truncated strings are still terminated, which is all we can do */
+    smio_afc_diag_identity_t *identity = &self->identity;
+    revision_copy_build_revision (identity->build_revision,
+            sizeof (identity->build_revision));
+    revision_copy_build_date (identity->build_date, sizeof (identity->build_date));
+    revision_copy_build_user_name (identity->build_user_name,
+            sizeof (identity->build_user_name));
+    revision_copy_build_user_email (identity->build_user_email,
+            sizeof (identity->build_user_email));
+
+    /* Not fatal. It is read again when asked for */
+    if (smio_afc_diag_read_geo_id (self, parent) != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_afc_diag_core] Could not "
+                "read card slot and IPMI address\n");
+    }
+
     return self;
 
 err_self_alloc:
@@ -61,3 +77,23 @@ smio_err_e smio_afc_diag_destroy (smio_afc_diag_t **self_p)
     return SMIO_SUCCESS;
 }
 
+smio_err_e smio_afc_diag_read_geo_id (smio_afc_diag_t *self, smio_t *parent)
+{
+    assert (self);
+    assert (parent);
+
+    smio_err_e err = SMIO_SUCCESS;
+    uint32_t geo_id = 0;
+    ssize_t ret = smio_thsafe_client_read_32 (parent, WB_AFC_DIAG_CTRL_RAW_REGS_OFFS |
+            BPM_AFC_DIAG_REG_GEO_ID, &geo_id);
+    ASSERT_TEST(ret == sizeof (geo_id), "Could not read GEO_ID register",
+            err_read_geo_id, SMIO_ERR_LLIO);
+
+    self->identity.card_slot = BPM_AFC_DIAG_GEO_ID_CARD_SLOT_R(geo_id);
+    self->identity.ipmi_addr = BPM_AFC_DIAG_GEO_ID_IPMI_ADDR_R(geo_id);
+    self->geo_id_valid = true;
+
+err_read_geo_id:
+    return err;
+}
+
@@ -9,7 +9,9 @@
 #define _SM_IO_AFC_DIAG_CORE_H_
 
 typedef struct {
-    const uint32_t example;
+    smio_afc_diag_identity_t identity;      /* Cached identity */
+    bool geo_id_valid;                      /* Card slot and IPMI address of
+                                               "identity" were read */
 } smio_afc_diag_t;
 
 /***************** Our methods *****************/
@@ -18,5 +20,8 @@ typedef struct {
 smio_afc_diag_t * smio_afc_diag_new (smio_t *parent);
 /* Destroys the smio realization */
 smio_err_e smio_afc_diag_destroy (smio_afc_diag_t **self_p);
+/* Read the card slot and IPMI address of the identity again, after they
+ * were written */
+smio_err_e smio_afc_diag_read_geo_id (smio_afc_diag_t *self, smio_t *parent);
 
 #endif
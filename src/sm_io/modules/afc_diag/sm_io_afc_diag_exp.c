@@ -41,22 +41,54 @@
 /*****************  Specific AFC_DIAG Operations *****************/
 /************************************************************/
 
-RW_PARAM_FUNC(afc_diag, card_slot) {
+RW_PARAM_FUNC(afc_diag, card_slot_reg) {
     SET_GET_PARAM(afc_diag, WB_AFC_DIAG_CTRL_RAW_REGS_OFFS, BPM_AFC_DIAG, GEO_ID,
             CARD_SLOT, MULT_BIT_PARAM, /* No minimum limit */,
             /* No maximum limit */, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
-RW_PARAM_FUNC(afc_diag, ipmi_addr) {
+RW_PARAM_FUNC(afc_diag, ipmi_addr_reg) {
     SET_GET_PARAM(afc_diag, WB_AFC_DIAG_CTRL_RAW_REGS_OFFS, BPM_AFC_DIAG, GEO_ID,
             IPMI_ADDR, MULT_BIT_PARAM, /* No minimum limit */,
             /* No maximum limit */, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
-/* Software ID functions */
+/* The GEO_ID fields are cached in the identity, so it is read again after
+ * each successful write */
+static int _afc_diag_geo_id_rw (void *owner, void *args, void *ret,
+        disp_table_func_fp rw_func)
+{
+    assert (owner);
+    assert (args);
 
-/* Macros to avoid repetition of the function body */
-typedef int (*smio_afc_diag_func_fp) (char *dest, size_t size);
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    int err = (rw_func) (owner, args, ret);
+
+    if (!rw && err == -RW_OK) {
+        SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+        smio_afc_diag_t *afc_diag = smio_get_handler (self);
+        ASSERT_TEST(afc_diag != NULL, "Could not get AFC DIAG handler",
+                err_get_afc_diag_handler);
+
+        afc_diag->geo_id_valid = false;
+        smio_afc_diag_read_geo_id (afc_diag, self);
+    }
+
+err_get_afc_diag_handler:
+    return err;
+}
+
+RW_PARAM_FUNC(afc_diag, card_slot) {
+    return _afc_diag_geo_id_rw (owner, args, ret,
+            RW_PARAM_FUNC_NAME(afc_diag, card_slot_reg));
+}
+
+RW_PARAM_FUNC(afc_diag, ipmi_addr) {
+    return _afc_diag_geo_id_rw (owner, args, ret,
+            RW_PARAM_FUNC_NAME(afc_diag, ipmi_addr_reg));
+}
+
+/* Software ID functions */
 
 /* Macros to avoid repetition of the function body */
 #define AFC_DIAG_INFO_FUNC_NAME(func_name)                                      \
@@ -65,9 +97,26 @@ typedef int (*smio_afc_diag_func_fp) (char *dest, size_t size);
 #define AFC_DIAG_INFO_FUNC_NAME_HEADER(func_name)                               \
     static int AFC_DIAG_INFO_FUNC_NAME(func_name) (void *owner, void *args, void *ret)
 
+/* Get the cached identity of the SMIO, NULL in case of error */
+static smio_afc_diag_identity_t *_afc_diag_get_identity (void *owner)
+{
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_afc_diag_t *afc_diag = smio_get_handler (self);
+    ASSERT_TEST(afc_diag != NULL, "Could not get AFC DIAG handler",
+            err_get_afc_diag_handler);
+
+    if (!afc_diag->geo_id_valid) {
+        smio_afc_diag_read_geo_id (afc_diag, self);
+    }
+
+    return &afc_diag->identity;
+
+err_get_afc_diag_handler:
+    return NULL;
+}
+
 static int _afc_diag_info_rw (void *owner, void *args, void *ret,
-        smio_afc_diag_func_fp read_func, AFC_DIAG_OPCODE_TYPE id,
-        const char *error_msg)
+        size_t field_offs, AFC_DIAG_OPCODE_TYPE id, const char *error_msg)
 {
     assert (owner);
     assert (args);
@@ -85,8 +134,13 @@ static int _afc_diag_info_rw (void *owner, void *args, void *ret,
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:afc_diag_exp] Calling "
             "AFC_DIAG function ID %u\n", id);
 
-    /* Call specific function */
-    int herr = (read_func) (ret, ret_size);
+    smio_afc_diag_identity_t *identity = _afc_diag_get_identity (owner);
+    ASSERT_TEST(identity != NULL, "Could not get AFC DIAG identity",
+            err_get_identity, -AFC_DIAG_ERR);
+
+    /* Copy from the cache, the strings never change */
+    int herr = snprintf ((char *) ret, ret_size, "%s",
+            (const char *) identity + field_offs);
 
     if (herr < 0 || (uint32_t) herr >= ret_size) {
         DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO,
@@ -103,33 +157,61 @@ static int _afc_diag_info_rw (void *owner, void *args, void *ret,
             afc_diag_exp_ops [id]->name,
             (err == -AFC_DIAG_ERR)? error_msg : "successfully executed");
 
+err_get_identity:
     return err;
 }
 
 AFC_DIAG_INFO_FUNC_NAME_HEADER(build_revision)
 {
-    return _afc_diag_info_rw(owner, args, ret, revision_copy_build_revision,
+    return _afc_diag_info_rw(owner, args, ret,
+            offsetof (smio_afc_diag_identity_t, build_revision),
             AFC_DIAG_OPCODE_GET_BUILD_REVISION, "Could not get build revision");
 }
 
 AFC_DIAG_INFO_FUNC_NAME_HEADER(build_date)
 {
-    return _afc_diag_info_rw(owner, args, ret, revision_copy_build_date,
+    return _afc_diag_info_rw(owner, args, ret,
+            offsetof (smio_afc_diag_identity_t, build_date),
             AFC_DIAG_OPCODE_GET_BUILD_DATE, "Could not get build date");
 }
 
 AFC_DIAG_INFO_FUNC_NAME_HEADER(build_user_name)
 {
-    return _afc_diag_info_rw(owner, args, ret, revision_copy_build_user_name,
+    return _afc_diag_info_rw(owner, args, ret,
+            offsetof (smio_afc_diag_identity_t, build_user_name),
             AFC_DIAG_OPCODE_GET_BUILD_USER_NAME, "Could not get build user name");
 }
 
 AFC_DIAG_INFO_FUNC_NAME_HEADER(build_user_email)
 {
-    return _afc_diag_info_rw(owner, args, ret, revision_copy_build_user_email,
+    return _afc_diag_info_rw(owner, args, ret,
+            offsetof (smio_afc_diag_identity_t, build_user_email),
             AFC_DIAG_OPCODE_GET_BUILD_USER_EMAIL, "Could not get build user email");
 }
 
+AFC_DIAG_INFO_FUNC_NAME_HEADER(identity)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -AFC_DIAG_OK;
+    /* Unused parameters */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    (void) rw;
+    uint32_t param = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    (void) param;
+
+    smio_afc_diag_identity_t *identity = _afc_diag_get_identity (owner);
+    ASSERT_TEST(identity != NULL, "Could not get AFC DIAG identity",
+            err_get_identity, -AFC_DIAG_ERR);
+
+    memcpy (ret, identity, sizeof (*identity));
+    err = sizeof (*identity);
+
+err_get_identity:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp afc_diag_exp_fp [] = {
     RW_PARAM_FUNC_NAME(afc_diag, card_slot),
@@ -138,6 +220,7 @@ const disp_table_func_fp afc_diag_exp_fp [] = {
     AFC_DIAG_INFO_FUNC_NAME(build_date),
     AFC_DIAG_INFO_FUNC_NAME(build_user_name),
     AFC_DIAG_INFO_FUNC_NAME(build_user_email),
+    AFC_DIAG_INFO_FUNC_NAME(identity),
     NULL
 };
 
@@ -217,7 +300,7 @@ smio_err_e afc_diag_init (smio_t * self)
     err = smio_set_ops (self, &afc_diag_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
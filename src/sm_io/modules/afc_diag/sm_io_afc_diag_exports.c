@@ -82,6 +82,18 @@ disp_op_t afc_diag_get_build_user_email_exp = {
     }
 };
 
+disp_op_t afc_diag_get_identity_exp = {
+    .name = AFC_DIAG_NAME_GET_IDENTITY,
+    .opcode = AFC_DIAG_OPCODE_GET_IDENTITY,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_VAR, smio_afc_diag_identity_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *afc_diag_exp_ops [] = {
     &afc_diag_set_get_card_slot_exp,
@@ -90,6 +102,7 @@ const disp_op_t *afc_diag_exp_ops [] = {
     &afc_diag_get_build_date_exp,
     &afc_diag_get_build_user_name_exp,
     &afc_diag_get_build_user_email_exp,
+    &afc_diag_get_identity_exp,
     NULL
 };
 
@@ -14,6 +14,7 @@ extern disp_op_t afc_diag_get_build_revision_exp;
 extern disp_op_t afc_diag_get_build_date_exp;
 extern disp_op_t afc_diag_get_build_user_name_exp;
 extern disp_op_t afc_diag_get_build_user_email_exp;
+extern disp_op_t afc_diag_get_identity_exp;
 
 extern const disp_op_t *afc_diag_exp_ops [];
 
@@ -42,6 +42,167 @@
 #define DSP_NAME_SET_GET_MONIT_POS_SUM      "dsp_set_get_monit_pos_sum"
 #define DSP_OPCODE_SET_GET_MONIT_UPDT       14
 #define DSP_NAME_SET_GET_MONIT_UPDT         "dsp_set_get_monit_updt"
-#define DSP_OPCODE_END                      15
+#define DSP_OPCODE_SET_GET_MONIT_POLL_TIME  15
+#define DSP_NAME_SET_GET_MONIT_POLL_TIME    "dsp_set_get_monit_poll_time"
+#define DSP_OPCODE_GET_MONIT_SNAPSHOT       16
+#define DSP_NAME_GET_MONIT_SNAPSHOT         "dsp_get_monit_snapshot"
+#define DSP_OPCODE_GET_MONIT_HISTORY        17
+#define DSP_NAME_GET_MONIT_HISTORY          "dsp_get_monit_history"
+#define DSP_OPCODE_SET_GET_MONIT_ENC        18
+#define DSP_NAME_SET_GET_MONIT_ENC          "dsp_set_get_monit_enc"
+#define DSP_OPCODE_SET_GET_TRIG             19
+#define DSP_NAME_SET_GET_TRIG               "dsp_set_get_trig"
+#define DSP_OPCODE_SET_GET_TRIG_COUNT       20
+#define DSP_NAME_SET_GET_TRIG_COUNT         "dsp_set_get_trig_count"
+#define DSP_OPCODE_SET_GET_MONIT_DS         21
+#define DSP_NAME_SET_GET_MONIT_DS           "dsp_set_get_monit_ds"
+#define DSP_OPCODE_END                      22
+
+/* Monitoring registers are read in a single sweep, so all of the values of
+ * a smio_dsp_monit_t belong to the same update. DSP_OPCODE_GET_MONIT_SNAPSHOT
+ * returns one of these directly, optionally latching new values first.
+ *
+ * Monitoring data is also published on the SMIO event stream
+ * "<DSP SMIO service name>:EVENTS", with one smio_dsp_monit_t frame per
+ * update. The DSP SMIO updates and reads the monitoring registers every
+ * "monit_poll_time" ms (DSP_OPCODE_SET_GET_MONIT_POLL_TIME). A poll time
+ * of 0 disables the stream */
+#define DSP_MONIT_STREAM_SUFFIX             SMIO_EVENT_STREAM_SUFFIX
+#define DSP_MONIT_SUBJECT_DATA              "MONIT_DATA"
+#define DSP_MONIT_POLL_TIME_MIN             0       /* in msec */
+#define DSP_MONIT_POLL_TIME_MAX             60000   /* in msec */
+
+/* Encodings of the monitoring stream, DSP_OPCODE_SET_GET_MONIT_ENC. Any
+ * combination of them can be published at once, each with a subject of
+ * its own. Only DSP_MONIT_ENC_FULL is published by default.
+ *
+ * DSP_MONIT_SUBJECT_DELTA carries only the fields that changed from the
+ * previous update. Its single frame is:
+ *   byte 0: flags. DSP_MONIT_DELTA_KEYFRAME if the update is encoded on
+ *           its own, against a zeroed smio_dsp_monit_t
+ *   byte 1: delta frame counter, incremented on every update, so
+ *           subscribers can tell they missed one
+ *   bytes 2 to the end: the DSP_MONIT_NUM_FIELDS 32-bit words of the
+ *           smio_dsp_monit_t, as encoded by hutils_codec_fields_encode ()
+ *           against the previous update
+ * A keyframe is sent every DSP_MONIT_DELTA_KEYFRAME_INTERVAL updates, so
+ * new subscribers and the ones that missed an update catch up */
+#define DSP_MONIT_ENC_FULL                  (1 << 0)
+#define DSP_MONIT_ENC_DELTA                 (1 << 1)
+#define DSP_MONIT_ENC_ALL                   (DSP_MONIT_ENC_FULL | DSP_MONIT_ENC_DELTA)
+
+#define DSP_MONIT_SUBJECT_DELTA             "MONIT_DELTA"
+#define DSP_MONIT_DELTA_KEYFRAME            (1 << 0)
+#define DSP_MONIT_DELTA_KEYFRAME_INTERVAL   64
+#define DSP_MONIT_DELTA_HDR_SIZE            2
+#define DSP_MONIT_NUM_FIELDS                (sizeof (smio_dsp_monit_t) / sizeof (uint32_t))
+#define DSP_MONIT_DELTA_MAX_SIZE            (DSP_MONIT_DELTA_HDR_SIZE + \
+                                                HUTILS_CODEC_FIELDS_BOUND(DSP_MONIT_NUM_FIELDS))
+
+struct _smio_dsp_monit_t {
+    uint32_t seq;                   /* update sequence number */
+    uint32_t amp_ch0;               /* monitoring amplitude, channel 0 */
+    uint32_t amp_ch1;               /* monitoring amplitude, channel 1 */
+    uint32_t amp_ch2;               /* monitoring amplitude, channel 2 */
+    uint32_t amp_ch3;               /* monitoring amplitude, channel 3 */
+    int32_t pos_x;                  /* monitoring position X */
+    int32_t pos_y;                  /* monitoring position Y */
+    int32_t pos_q;                  /* monitoring position Q */
+    int32_t pos_sum;                /* monitoring position SUM */
+    uint32_t updt;                  /* MONIT_UPDT register value */
+    uint64_t timestamp;             /* update time in ns since the Epoch,
+                                       taken from the host wall clock */
+};
+
+/* Downsampled monitoring streams, DSP_OPCODE_SET_GET_MONIT_DS. Up to
+ * DSP_MONIT_DS_MAX of them are published besides the full rate one, stream
+ * i with subject DSP_MONIT_SUBJECT_DS_PREFIX followed by i (e.g.,
+ * "MONIT_DS0"), so slow consumers subscribe to that only. Stream i averages
+ * blocks of "decim [i]" updates (a first order CIC, i.e., a boxcar decimator)
+ * and publishes one smio_dsp_monit_t per block, of rate
+ * 1000 / (monit_poll_time * decim [i]) Hz. AMP/POS fields hold the mean of
+ * the block, "seq" and "updt" those of its last update and "timestamp" its
+ * midpoint. A "decim" of 0 disables the stream. Decimations are also
+ * applied when the full rate stream is not published
+ * (DSP_OPCODE_SET_GET_MONIT_ENC) */
+#define DSP_MONIT_DS_MAX                    4
+#define DSP_MONIT_DS_DECIM_MAX              (1 << 16)
+#define DSP_MONIT_SUBJECT_DS_PREFIX         "MONIT_DS"
+#define DSP_MONIT_SUBJECT_DS_MAX_LEN        16
+
+struct _smio_dsp_monit_ds_t {
+    uint32_t decim[DSP_MONIT_DS_MAX];       /* updates per block, 0 if disabled */
+};
+
+/* The last DSP_MONIT_HIST_SIZE updates of the monitoring stream are also
+ * kept by the DSP SMIO, so clients can fetch them in batches instead of
+ * polling at the update rate. DSP_OPCODE_GET_MONIT_HISTORY returns, oldest
+ * first, up to DSP_MONIT_HIST_BATCH of the ones after a given sequence
+ * number (DSP_MONIT_HIST_SINCE_SEQ) or timestamp (DSP_MONIT_HIST_SINCE_TS).
+ * A full batch means there might be more to fetch. Records older than the
+ * history are lost, which shows up as a gap in the sequence numbers */
+#define DSP_MONIT_HIST_SIZE                 4096
+#define DSP_MONIT_HIST_BATCH                1024
+
+#define DSP_MONIT_HIST_SINCE_SEQ            0
+#define DSP_MONIT_HIST_SINCE_TS             1
+
+struct _smio_dsp_monit_hist_t {
+    uint64_t count;                 /* number of updates kept so far */
+    uint32_t num_records;           /* number of valid records */
+    uint32_t reserved;
+    smio_dsp_monit_t records[DSP_MONIT_HIST_BATCH];     /* oldest first */
+};
+
+/* Software trigger, DSP_OPCODE_SET_GET_TRIG. Every update of the monitoring
+ * stream is checked against up to DSP_TRIG_MAX_CONDS conditions, and once
+ * any of them (DSP_TRIG_MODE_ANY) or all of them (DSP_TRIG_MODE_ALL) hold,
+ * the software trigger of the ACQ core of the same BPM is fired, as
+ * bpm_set_acq_sw_trig () would. A condition holds when a field of the
+ * update (DSP_TRIG_FIELD_*) is below "min" or above "max". With
+ * DSP_TRIG_COND_ABS the absolute value of the field is checked, and with
+ * DSP_TRIG_COND_DELTA its change from the previous update, so a
+ * |X| > 100 um window is {X, ABS, 0, 100000} and a SUM drop of more than
+ * 1000 in an update is {SUM, DELTA, -1000, INT64_MAX}. The trigger does not
+ * fire again for "holdoff" ms. It is only checked while the monitoring
+ * stream is enabled, so it reacts within "monit_poll_time" ms.
+ * DSP_OPCODE_SET_GET_TRIG_COUNT counts the times it fired */
+#define DSP_TRIG_MAX_CONDS                  4
+
+#define DSP_TRIG_MODE_OFF                   0
+#define DSP_TRIG_MODE_ANY                   1
+#define DSP_TRIG_MODE_ALL                   2
+#define DSP_TRIG_MODE_END                   3
+
+#define DSP_TRIG_FIELD_AMP_CH0              0
+#define DSP_TRIG_FIELD_AMP_CH1              1
+#define DSP_TRIG_FIELD_AMP_CH2              2
+#define DSP_TRIG_FIELD_AMP_CH3              3
+#define DSP_TRIG_FIELD_POS_X                4
+#define DSP_TRIG_FIELD_POS_Y                5
+#define DSP_TRIG_FIELD_POS_Q                6
+#define DSP_TRIG_FIELD_POS_SUM              7
+#define DSP_TRIG_FIELD_END                  8
+
+#define DSP_TRIG_COND_ABS                   (1 << 0)
+#define DSP_TRIG_COND_DELTA                 (1 << 1)
+#define DSP_TRIG_COND_ALL                   (DSP_TRIG_COND_ABS | DSP_TRIG_COND_DELTA)
+
+#define DSP_TRIG_HOLDOFF_MAX                60000   /* in msec */
+
+struct _smio_dsp_trig_cond_t {
+    uint32_t field;                 /* DSP_TRIG_FIELD_* */
+    uint32_t flags;                 /* DSP_TRIG_COND_* */
+    int64_t min;                    /* holds below this */
+    int64_t max;                    /* holds above this */
+};
+
+struct _smio_dsp_trig_t {
+    uint32_t mode;                  /* DSP_TRIG_MODE_* */
+    uint32_t holdoff;               /* time not firing again, in msec */
+    uint32_t num_conds;             /* number of valid conditions */
+    uint32_t reserved;
+    smio_dsp_trig_cond_t conds[DSP_TRIG_MAX_CONDS];
+};
 
 #endif
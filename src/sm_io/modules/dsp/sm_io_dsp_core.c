@@ -7,6 +7,7 @@
 
 #include "bpm_server.h"
 /* Private headers */
+#include "sm_io_dsp_codes.h"
 #include "sm_io_dsp_core.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
@@ -32,6 +33,8 @@
     CHECK_HAL_ERR(err, SM_IO, "[sm_io_dsp_core]",   \
             smio_err_str (err_type))
 
+#define SMIO_DSP_CACHE_LINE_SIZE            64
+
 /* Creates a new instance of Device Information */
 smio_dsp_t * smio_dsp_new (smio_t *parent)
 {
@@ -40,8 +43,32 @@ smio_dsp_t * smio_dsp_new (smio_t *parent)
     smio_dsp_t *self = (smio_dsp_t *) zmalloc (sizeof *self);
     ASSERT_ALLOC(self, err_self_alloc);
 
+    /* Monitoring stream is only enabled on request */
+    self->monit_poll_time = 0;
+    self->monit_seq = 0;
+
+    /* Filled by the poll handler as the history is read through, so keep
+     * it on cache lines of its own */
+    int rc = posix_memalign ((void **) &self->monit_hist, SMIO_DSP_CACHE_LINE_SIZE,
+            DSP_MONIT_HIST_SIZE * sizeof (*self->monit_hist));
+    ASSERT_TEST(rc == 0, "Could not allocate monitoring history",
+            err_monit_hist_alloc);
+    self->monit_hist_count = 0;
+    self->monit_enc = DSP_MONIT_ENC_FULL;
+    self->monit_delta_count = 0;
+    /* Software trigger is only armed on request */
+    memset (&self->trig, 0, sizeof (self->trig));
+    self->trig_count = 0;
+    self->trig_time = 0;
+    self->trig_prev_valid = false;
+    /* Downsampled streams are only published on request */
+    memset (&self->monit_ds, 0, sizeof (self->monit_ds));
+    memset (self->monit_ds_acc, 0, sizeof (self->monit_ds_acc));
+
     return self;
 
+err_monit_hist_alloc:
+    free (self);
 err_self_alloc:
     return NULL;
 }
@@ -54,6 +81,7 @@ smio_err_e smio_dsp_destroy (smio_dsp_t **self_p)
     if (*self_p) {
         smio_dsp_t *self = *self_p;
 
+        free (self->monit_hist);
         free (self);
         *self_p = NULL;
     }
@@ -8,8 +8,35 @@
 #ifndef _SM_IO_DSP_CORE_H_
 #define _SM_IO_DSP_CORE_H_
 
+/* Block of a downsampled monitoring stream being averaged */
 typedef struct {
-    const uint32_t example;
+    int64_t sum [DSP_TRIG_FIELD_END];       /* Sums of AMP_CH0 up to POS_SUM,
+                                               by DSP_TRIG_FIELD_* */
+    uint32_t num;                           /* Updates so far */
+    uint64_t first_ts;                      /* Timestamp of the first one */
+} smio_dsp_monit_acc_t;
+
+typedef struct {
+    uint32_t monit_poll_time;               /* Monitoring stream period in ms.
+                                               0 if disabled */
+    uint32_t monit_seq;                     /* Monitoring updates published */
+    smio_dsp_monit_t *monit_hist;           /* Last DSP_MONIT_HIST_SIZE updates
+                                               published. Entry i%DSP_MONIT_HIST_SIZE
+                                               holds the i-th one */
+    uint64_t monit_hist_count;              /* Number of updates kept */
+    uint32_t monit_enc;                     /* Encodings of the monitoring
+                                               stream (DSP_MONIT_ENC_*) */
+    smio_dsp_monit_t monit_last;            /* Last update sent delta encoded */
+    uint32_t monit_delta_count;             /* Delta encoded updates sent */
+    smio_dsp_trig_t trig;                   /* Software trigger conditions */
+    uint32_t trig_count;                    /* Times the trigger fired */
+    int64_t trig_time;                      /* Time it last fired, in the
+                                               zclock_mono () base */
+    smio_dsp_monit_t trig_prev;             /* Update checked last, for the
+                                               DSP_TRIG_COND_DELTA conditions */
+    bool trig_prev_valid;                   /* "trig_prev" holds an update */
+    smio_dsp_monit_ds_t monit_ds;           /* Downsampled streams */
+    smio_dsp_monit_acc_t monit_ds_acc [DSP_MONIT_DS_MAX];
 } smio_dsp_t;
 
 /***************** Our methods *****************/
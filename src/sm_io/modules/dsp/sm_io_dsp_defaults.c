@@ -79,6 +79,10 @@ smio_err_e dsp_config_defaults (char *broker_endp, char *service,
     ASSERT_TEST(client_err == BPM_CLIENT_SUCCESS, "Could not set Delta-Sigma MONIT threshold",
             err_param_set, SMIO_ERR_CONFIG_DFLT);
 
+    client_err = bpm_set_monit_poll_time (config_client, service, DSP_DFLT_MONIT_POLL_TIME);
+    ASSERT_TEST(client_err == BPM_CLIENT_SUCCESS, "Could not set monitoring poll time",
+            err_param_set, SMIO_ERR_CONFIG_DFLT);
+
 err_param_set:
     bpm_client_destroy (&config_client);
 err_alloc_client:
@@ -18,6 +18,9 @@
 #define DSP_DFLT_DS_FOFB_THRES          0           /* No minimum threslhold */
 #define DSP_DFLT_DS_MONIT_THRES         0           /* No minimum threslhold */
 
+/****************** Monitoring Stream Period **********************/
+#define DSP_DFLT_MONIT_POLL_TIME        100         /* ms, 10 Hz monitoring rate */
+
 smio_err_e dsp_config_defaults (char *broker_endp, char *service,
         const char *log_file_name);
 
@@ -12,7 +12,9 @@
 #include "sm_io_dsp_exports.h"
 #include "sm_io_dsp_core.h"
 #include "sm_io_dsp_exp.h"
+#include "sm_io_acq_exp.h"
 #include "hw/wb_pos_calc_regs.h"
+#include "hw/wb_acq_core_regs.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
 #ifdef ASSERT_TEST
@@ -44,42 +46,42 @@
 #define KX_PARAM_MIN                        1
 #define KX_PARAM_MAX                        ((1<<25)-1)
 RW_PARAM_FUNC(dsp, kx) {
-    SET_GET_PARAM(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, KX, VAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, KX, VAL, MULT_BIT_PARAM,
             KX_PARAM_MIN, KX_PARAM_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define KY_PARAM_MIN                        1
 #define KY_PARAM_MAX                        ((1<<25)-1)
 RW_PARAM_FUNC(dsp, ky) {
-    SET_GET_PARAM(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, KY, VAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, KY, VAL, MULT_BIT_PARAM,
             KY_PARAM_MIN, KY_PARAM_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define KSUM_PARAM_MIN                      1
 #define KSUM_PARAM_MAX                      ((1<<25)-1)
 RW_PARAM_FUNC(dsp, ksum) {
-    SET_GET_PARAM(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, KSUM, VAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, KSUM, VAL, MULT_BIT_PARAM,
             KSUM_PARAM_MIN, KSUM_PARAM_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define DS_TBT_THRES_MIN                    0
 #define DS_TBT_THRES_MAX                    ((1<<26)-1)
 RW_PARAM_FUNC(dsp, ds_tbt_thres) {
-    SET_GET_PARAM(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, DS_TBT_THRES, VAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, DS_TBT_THRES, VAL, MULT_BIT_PARAM,
             DS_TBT_THRES_MIN, DS_TBT_THRES_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define DS_FOFB_THRES_MIN                   0
 #define DS_FOFB_THRES_MAX                   ((1<<26)-1)
 RW_PARAM_FUNC(dsp, ds_fofb_thres) {
-    SET_GET_PARAM(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, DS_FOFB_THRES, VAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, DS_FOFB_THRES, VAL, MULT_BIT_PARAM,
             DS_FOFB_THRES_MIN, DS_FOFB_THRES_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define DS_MONIT_THRES_MIN                  0
 #define DS_MONIT_THRES_MAX                  ((1<<26)-1)
 RW_PARAM_FUNC(dsp, ds_monit_thres) {
-    SET_GET_PARAM(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, DS_MONIT_THRES, VAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(dsp, DSP_CTRL_REGS_OFFS, POS_CALC, DS_MONIT_THRES, VAL, MULT_BIT_PARAM,
             DS_MONIT_THRES_MIN, DS_MONIT_THRES_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
@@ -173,6 +175,362 @@ RW_PARAM_FUNC(dsp, monit_updt) {
             NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
+/* Read all of the monitoring registers in a single sweep, optionally
+ * latching new values first, so they always belong to the same update */
+static int _dsp_monit_snapshot (SMIO_OWNER_TYPE *self, smio_dsp_t *dsp,
+        bool updt, smio_dsp_monit_t *monit)
+{
+    int err = -RW_OK;
+
+    /* Any write to the update register latches the AMP/POS values */
+    if (updt) {
+        uint32_t monit_updt = 1;
+        ssize_t ret = smio_thsafe_client_write_32 (self, DSP_CTRL_REGS_OFFS |
+                POS_CALC_REG_DSP_MONIT_UPDT, &monit_updt);
+        ASSERT_TEST(ret == sizeof (monit_updt), "Could not update monitoring "
+                "registers", err_monit_updt, -RW_WRITE_EAGAIN);
+        dsp->monit_seq++;
+    }
+
+    /* AMP_CH0 up to UPDT are contiguous */
+    uint32_t regs [(POS_CALC_REG_DSP_MONIT_UPDT -
+        POS_CALC_REG_DSP_MONIT_AMP_CH0) / sizeof (uint32_t) + 1];
+    ssize_t ret = smio_thsafe_client_read_block (self, DSP_CTRL_REGS_OFFS |
+            POS_CALC_REG_DSP_MONIT_AMP_CH0, sizeof (regs), regs);
+    ASSERT_TEST(ret == sizeof (regs), "Could not read monitoring registers",
+            err_monit_read, -RW_READ_EAGAIN);
+
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+
+    monit->seq = dsp->monit_seq;
+    monit->amp_ch0 = regs [0];
+    monit->amp_ch1 = regs [1];
+    monit->amp_ch2 = regs [2];
+    monit->amp_ch3 = regs [3];
+    monit->pos_x = (int32_t) regs [4];
+    monit->pos_y = (int32_t) regs [5];
+    monit->pos_q = (int32_t) regs [6];
+    monit->pos_sum = (int32_t) regs [7];
+    monit->updt = regs [8];
+    monit->timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+err_monit_read:
+err_monit_updt:
+    return err;
+}
+
+static int _dsp_get_monit_snapshot (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -RW_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] "
+            "Calling _dsp_get_monit_snapshot\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get SMIO DSP handler",
+            err_get_dsp_handler, -RW_INV);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: update flag. Latch new values before reading if != 0
+     */
+    uint32_t updt = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+
+    err = _dsp_monit_snapshot (self, dsp, updt != 0, (smio_dsp_monit_t *) ret);
+    ASSERT_TEST(err == -RW_OK, "Could not read monitoring snapshot",
+            err_monit_snapshot);
+
+    err = sizeof (smio_dsp_monit_t);
+
+err_monit_snapshot:
+err_get_dsp_handler:
+    return err;
+}
+
+/* Whether the history record "monit" is after "since", by sequence number
+ * (wrapping around) or by timestamp */
+static bool _dsp_monit_hist_after (const smio_dsp_monit_t *monit, uint32_t by,
+        uint64_t since)
+{
+    if (by == DSP_MONIT_HIST_SINCE_TS) {
+        return monit->timestamp > since;
+    }
+    return (int32_t) (monit->seq - (uint32_t) since) > 0;
+}
+
+static int _dsp_get_monit_history (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -RW_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] "
+            "Calling _dsp_get_monit_history\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get SMIO DSP handler",
+            err_get_dsp_handler, -RW_INV);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: DSP_MONIT_HIST_SINCE_SEQ or DSP_MONIT_HIST_SINCE_TS
+     * frame 2: sequence number or timestamp (64-bit) of the last record
+     *          the client has
+     */
+    uint32_t by = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint64_t since = *(uint64_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    ASSERT_TEST(by == DSP_MONIT_HIST_SINCE_SEQ || by == DSP_MONIT_HIST_SINCE_TS,
+            "Invalid monitoring history query", err_inv_query, -RW_INV);
+
+    /* Walk back from the newest record to the first one after "since".
+     * Clients fetching regularly only ask for the few newest ones */
+    uint64_t count = dsp->monit_hist_count;
+    uint64_t oldest = (count > DSP_MONIT_HIST_SIZE) ? count - DSP_MONIT_HIST_SIZE : 0;
+    uint64_t first = count;
+    while (first > oldest && _dsp_monit_hist_after (
+                &dsp->monit_hist [(first - 1) % DSP_MONIT_HIST_SIZE], by, since)) {
+        --first;
+    }
+
+    uint64_t num_records = count - first;
+    if (num_records > DSP_MONIT_HIST_BATCH) {
+        num_records = DSP_MONIT_HIST_BATCH;
+    }
+
+    smio_dsp_monit_hist_t *hist = (smio_dsp_monit_hist_t *) ret;
+    hist->count = count;
+    hist->num_records = (uint32_t) num_records;
+    hist->reserved = 0;
+    for (uint64_t i = 0; i < num_records; ++i) {
+        hist->records [i] = dsp->monit_hist [(first + i) % DSP_MONIT_HIST_SIZE];
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] get_monit_history: "
+            "%u records returned\n", hist->num_records);
+
+    err = offsetof (smio_dsp_monit_hist_t, records) +
+        num_records * sizeof (hist->records [0]);
+
+err_inv_query:
+err_get_dsp_handler:
+    return err;
+}
+
+static int _dsp_monit_poll_time (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -RW_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] "
+            "Calling _dsp_monit_poll_time\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get SMIO DSP handler",
+            err_get_dsp_handler, -RW_INV);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: monitoring poll time
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t monit_poll_time = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = dsp->monit_poll_time;
+        err = sizeof (dsp->monit_poll_time);
+    }
+    else {
+        ASSERT_TEST(monit_poll_time <= DSP_MONIT_POLL_TIME_MAX,
+                "Monitoring poll time is out of range", err_inv_poll_time,
+                -RW_OOR);
+        dsp->monit_poll_time = monit_poll_time;
+        smio_set_poll_interval (self, monit_poll_time);
+        smio_set_param_changed (self);
+    }
+
+err_inv_poll_time:
+err_get_dsp_handler:
+    return err;
+}
+
+static int _dsp_monit_enc (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -RW_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] "
+            "Calling _dsp_monit_enc\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get SMIO DSP handler",
+            err_get_dsp_handler, -RW_INV);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: monitoring stream encodings (DSP_MONIT_ENC_*)
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t monit_enc = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = dsp->monit_enc;
+        err = sizeof (dsp->monit_enc);
+    }
+    else {
+        ASSERT_TEST((monit_enc & ~DSP_MONIT_ENC_ALL) == 0,
+                "Invalid monitoring stream encoding", err_inv_enc, -RW_OOR);
+        /* Delta subscribers need a keyframe to start from */
+        if ((monit_enc & DSP_MONIT_ENC_DELTA) && !(dsp->monit_enc & DSP_MONIT_ENC_DELTA)) {
+            dsp->monit_delta_count = 0;
+        }
+        dsp->monit_enc = monit_enc;
+        smio_set_param_changed (self);
+    }
+
+err_inv_enc:
+err_get_dsp_handler:
+    return err;
+}
+
+static int _dsp_trig (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -RW_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] "
+            "Calling _dsp_trig\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get SMIO DSP handler",
+            err_get_dsp_handler, -RW_INV);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: trigger conditions
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    smio_dsp_trig_t *trig = (smio_dsp_trig_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((smio_dsp_trig_t *) ret) = dsp->trig;
+        return sizeof (dsp->trig);
+    }
+
+    ASSERT_TEST(trig->mode < DSP_TRIG_MODE_END &&
+            trig->num_conds <= DSP_TRIG_MAX_CONDS &&
+            (trig->mode == DSP_TRIG_MODE_OFF || trig->num_conds > 0) &&
+            trig->holdoff <= DSP_TRIG_HOLDOFF_MAX,
+            "Invalid software trigger", err_inv_trig, -RW_OOR);
+    for (uint32_t i = 0; i < trig->num_conds; ++i) {
+        const smio_dsp_trig_cond_t *cond = &trig->conds [i];
+        ASSERT_TEST(cond->field < DSP_TRIG_FIELD_END &&
+                (cond->flags & ~DSP_TRIG_COND_ALL) == 0 && cond->min <= cond->max,
+                "Invalid software trigger condition", err_inv_trig, -RW_OOR);
+    }
+
+    dsp->trig = *trig;
+    /* Changes are only seen from the next update on */
+    dsp->trig_prev_valid = false;
+    smio_set_param_changed (self);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:dsp] Software trigger %s, "
+            "%u conditions\n", (trig->mode == DSP_TRIG_MODE_OFF) ? "disarmed" :
+            "armed", trig->num_conds);
+
+err_inv_trig:
+err_get_dsp_handler:
+    return err;
+}
+
+static int _dsp_trig_count (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -RW_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] "
+            "Calling _dsp_trig_count\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get SMIO DSP handler",
+            err_get_dsp_handler, -RW_INV);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: times the software trigger fired
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t trig_count = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = dsp->trig_count;
+        err = sizeof (dsp->trig_count);
+    }
+    else {
+        dsp->trig_count = trig_count;
+    }
+
+err_get_dsp_handler:
+    return err;
+}
+
+static int _dsp_monit_ds (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -RW_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:dsp] "
+            "Calling _dsp_monit_ds\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get SMIO DSP handler",
+            err_get_dsp_handler, -RW_INV);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: decimations of the downsampled streams
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    smio_dsp_monit_ds_t *monit_ds = (smio_dsp_monit_ds_t *)
+        EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((smio_dsp_monit_ds_t *) ret) = dsp->monit_ds;
+        return sizeof (dsp->monit_ds);
+    }
+
+    for (uint32_t i = 0; i < DSP_MONIT_DS_MAX; ++i) {
+        ASSERT_TEST(monit_ds->decim [i] <= DSP_MONIT_DS_DECIM_MAX,
+                "Downsampled stream decimation is out of range", err_inv_decim,
+                -RW_OOR);
+    }
+
+    /* Streams changed start over with a new block */
+    for (uint32_t i = 0; i < DSP_MONIT_DS_MAX; ++i) {
+        if (monit_ds->decim [i] != dsp->monit_ds.decim [i]) {
+            memset (&dsp->monit_ds_acc [i], 0, sizeof (dsp->monit_ds_acc [i]));
+        }
+    }
+    dsp->monit_ds = *monit_ds;
+    smio_set_param_changed (self);
+
+err_inv_decim:
+err_get_dsp_handler:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp dsp_exp_fp [] = {
     RW_PARAM_FUNC_NAME(dsp, kx),
@@ -190,6 +548,13 @@ const disp_table_func_fp dsp_exp_fp [] = {
     RW_PARAM_FUNC_NAME(dsp, monit_pos_q),
     RW_PARAM_FUNC_NAME(dsp, monit_pos_sum),
     RW_PARAM_FUNC_NAME(dsp, monit_updt),
+    _dsp_monit_poll_time,
+    _dsp_get_monit_snapshot,
+    _dsp_get_monit_history,
+    _dsp_monit_enc,
+    _dsp_trig,
+    _dsp_trig_count,
+    _dsp_monit_ds,
     NULL
 };
 
@@ -244,12 +609,260 @@ smio_err_e dsp_do_op (void *self, void *msg)
     return _dsp_do_op (self, msg);
 }
 
+/* Publish the monitoring data "data" of "size" bytes with "subject" on the
+ * monitoring stream */
+static smio_err_e _dsp_monit_publish (smio_t *self, const char *subject,
+        const void *data, size_t size)
+{
+    smio_err_e err = SMIO_SUCCESS;
+
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, SMIO_ERR_ALLOC);
+    int rc = zmsg_addmem (msg, data, size);
+    ASSERT_TEST(rc == 0, "Could not add monitoring data to message",
+            err_msg_addmem, SMIO_ERR_ALLOC);
+
+    rc = mlm_client_send (smio_get_worker (self), subject, &msg);
+    ASSERT_TEST(rc == 0, "Could not publish monitoring data", err_msg_send,
+            SMIO_ERR_BAD_MSG);
+
+err_msg_send:
+err_msg_addmem:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    return err;
+}
+
+/* Encode "monit" against the last update sent delta encoded, or on its own
+ * for keyframes. Returns the size of the frame or -1 on error */
+static ssize_t _dsp_monit_delta_encode (smio_dsp_t *dsp,
+        const smio_dsp_monit_t *monit, uint8_t *frame, size_t frame_size)
+{
+    static const smio_dsp_monit_t monit_zero;
+    bool keyframe = (dsp->monit_delta_count % DSP_MONIT_DELTA_KEYFRAME_INTERVAL) == 0;
+    const smio_dsp_monit_t *prev = keyframe ? &monit_zero : &dsp->monit_last;
+
+    /* smio_dsp_monit_t is made of 32-bit words only */
+    uint32_t cur_fields [DSP_MONIT_NUM_FIELDS];
+    uint32_t prev_fields [DSP_MONIT_NUM_FIELDS];
+    memcpy (cur_fields, monit, sizeof (cur_fields));
+    memcpy (prev_fields, prev, sizeof (prev_fields));
+
+    frame [0] = keyframe ? DSP_MONIT_DELTA_KEYFRAME : 0;
+    frame [1] = (uint8_t) dsp->monit_delta_count;
+    ssize_t size = hutils_codec_fields_encode (frame + DSP_MONIT_DELTA_HDR_SIZE,
+            frame_size - DSP_MONIT_DELTA_HDR_SIZE, cur_fields, prev_fields,
+            DSP_MONIT_NUM_FIELDS);
+    if (size < 0) {
+        return -1;
+    }
+
+    dsp->monit_last = *monit;
+    dsp->monit_delta_count++;
+    return DSP_MONIT_DELTA_HDR_SIZE + size;
+}
+
+/* Value of "field" of the monitoring update "monit" */
+static int64_t _dsp_trig_field (const smio_dsp_monit_t *monit, uint32_t field)
+{
+    switch (field) {
+        case DSP_TRIG_FIELD_AMP_CH0:
+            return monit->amp_ch0;
+        case DSP_TRIG_FIELD_AMP_CH1:
+            return monit->amp_ch1;
+        case DSP_TRIG_FIELD_AMP_CH2:
+            return monit->amp_ch2;
+        case DSP_TRIG_FIELD_AMP_CH3:
+            return monit->amp_ch3;
+        case DSP_TRIG_FIELD_POS_X:
+            return monit->pos_x;
+        case DSP_TRIG_FIELD_POS_Y:
+            return monit->pos_y;
+        case DSP_TRIG_FIELD_POS_Q:
+            return monit->pos_q;
+        default:
+            return monit->pos_sum;
+    }
+}
+
+/* Check the monitoring update "monit" against the software trigger
+ * conditions, firing the software trigger of our ACQ core if they hold.
+ * This is one register write through the DEVIO, with no round trip to any
+ * client */
+static void _dsp_trig_check (smio_t *self, smio_dsp_t *dsp,
+        const smio_dsp_monit_t *monit)
+{
+    const smio_dsp_trig_t *trig = &dsp->trig;
+    if (trig->mode == DSP_TRIG_MODE_OFF) {
+        return;
+    }
+
+    bool all = (trig->mode == DSP_TRIG_MODE_ALL);
+    bool fire = all;
+    for (uint32_t i = 0; i < trig->num_conds; ++i) {
+        const smio_dsp_trig_cond_t *cond = &trig->conds [i];
+        int64_t value = _dsp_trig_field (monit, cond->field);
+
+        /* There is no change to check on the first update */
+        bool holds = false;
+        if (!(cond->flags & DSP_TRIG_COND_DELTA) || dsp->trig_prev_valid) {
+            if (cond->flags & DSP_TRIG_COND_DELTA) {
+                value -= _dsp_trig_field (&dsp->trig_prev, cond->field);
+            }
+            if ((cond->flags & DSP_TRIG_COND_ABS) && value < 0) {
+                value = -value;
+            }
+            holds = (value < cond->min || value > cond->max);
+        }
+
+        if (holds != all) {
+            fire = holds;
+            break;
+        }
+    }
+
+    dsp->trig_prev = *monit;
+    dsp->trig_prev_valid = true;
+
+    int64_t now = zclock_mono ();
+    if (!fire || (dsp->trig_count > 0 && now - dsp->trig_time < trig->holdoff)) {
+        return;
+    }
+
+    uint32_t sw_trig = 1;
+    smio_err_e err = smio_sibling_write_32 (self, ACQ_SDB_DEVID,
+            WB_ACQ_CORE_CTRL_REGS_OFFS | ACQ_CORE_REG_SW_TRIG, sw_trig);
+    if (err != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:dsp] Could not fire "
+                "software trigger\n");
+        return;
+    }
+
+    dsp->trig_count++;
+    dsp->trig_time = now;
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:dsp] Software trigger fired "
+            "on monitoring update %u\n", monit->seq);
+}
+
+/* Add the monitoring update "monit" to the blocks of the downsampled
+ * streams, publishing the mean of the ones completed */
+static smio_err_e _dsp_monit_ds_publish (smio_t *self, smio_dsp_t *dsp,
+        const smio_dsp_monit_t *monit)
+{
+    smio_err_e err = SMIO_SUCCESS;
+
+    for (uint32_t i = 0; i < DSP_MONIT_DS_MAX; ++i) {
+        uint32_t decim = dsp->monit_ds.decim [i];
+        if (decim == 0) {
+            continue;
+        }
+
+        smio_dsp_monit_acc_t *acc = &dsp->monit_ds_acc [i];
+        if (acc->num == 0) {
+            acc->first_ts = monit->timestamp;
+        }
+        for (uint32_t f = 0; f < DSP_TRIG_FIELD_END; ++f) {
+            acc->sum [f] += _dsp_trig_field (monit, f);
+        }
+        if (++acc->num < decim) {
+            continue;
+        }
+
+        int64_t num = acc->num;
+        smio_dsp_monit_t mean = {
+            .seq = monit->seq,
+            .amp_ch0 = (uint32_t) (acc->sum [DSP_TRIG_FIELD_AMP_CH0] / num),
+            .amp_ch1 = (uint32_t) (acc->sum [DSP_TRIG_FIELD_AMP_CH1] / num),
+            .amp_ch2 = (uint32_t) (acc->sum [DSP_TRIG_FIELD_AMP_CH2] / num),
+            .amp_ch3 = (uint32_t) (acc->sum [DSP_TRIG_FIELD_AMP_CH3] / num),
+            .pos_x = (int32_t) (acc->sum [DSP_TRIG_FIELD_POS_X] / num),
+            .pos_y = (int32_t) (acc->sum [DSP_TRIG_FIELD_POS_Y] / num),
+            .pos_q = (int32_t) (acc->sum [DSP_TRIG_FIELD_POS_Q] / num),
+            .pos_sum = (int32_t) (acc->sum [DSP_TRIG_FIELD_POS_SUM] / num),
+            .updt = monit->updt,
+            .timestamp = acc->first_ts + (monit->timestamp - acc->first_ts) / 2
+        };
+        memset (acc, 0, sizeof (*acc));
+
+        char subject [DSP_MONIT_SUBJECT_DS_MAX_LEN];
+        snprintf (subject, sizeof (subject), DSP_MONIT_SUBJECT_DS_PREFIX "%u", i);
+        err = _dsp_monit_publish (self, subject, &mean, sizeof (mean));
+        ASSERT_TEST(err == SMIO_SUCCESS, "Could not publish downsampled "
+                "monitoring data", err_publish);
+    }
+
+err_publish:
+    return err;
+}
+
+/* Periodic handler. Latches the monitoring registers, reads all of them in
+ * a single sweep, keeps them in the history and publishes them on the
+ * monitoring stream, in the encodings enabled, and on the downsampled
+ * streams */
+smio_err_e dsp_poll (smio_t *self)
+{
+    smio_err_e err = SMIO_SUCCESS;
+    smio_dsp_t *dsp = smio_get_handler (self);
+    ASSERT_TEST(dsp != NULL, "Could not get DSP handler",
+            err_dsp_handler, SMIO_ERR_ALLOC /* FIXME: improve return code */);
+
+    smio_dsp_monit_t monit;
+    int rerr = _dsp_monit_snapshot (self, dsp, true, &monit);
+    ASSERT_TEST(rerr == -RW_OK, "Could not read monitoring registers",
+            err_monit_snapshot, SMIO_ERR_LLIO);
+
+    dsp->monit_hist [dsp->monit_hist_count % DSP_MONIT_HIST_SIZE] = monit;
+    dsp->monit_hist_count++;
+
+    /* Checked before publishing, so the trigger does not wait for that */
+    _dsp_trig_check (self, dsp, &monit);
+
+    smio_status_page_t *status = smio_get_status_page (self);
+    uint32_t inst_id = smio_get_inst_id (self);
+    if (status != NULL && inst_id < SMIO_STATUS_MAX_INST) {
+        smio_status_dsp_t *sect = &status->dsp [inst_id];
+        devio_status_write_begin (&sect->hdr);
+        sect->monit = monit;
+        devio_status_write_end (&sect->hdr);
+    }
+
+    if (dsp->monit_enc & DSP_MONIT_ENC_FULL) {
+        err = _dsp_monit_publish (self, DSP_MONIT_SUBJECT_DATA, &monit,
+                sizeof (monit));
+        ASSERT_TEST(err == SMIO_SUCCESS, "Could not publish monitoring data",
+                err_publish_full);
+    }
+
+    if (dsp->monit_enc & DSP_MONIT_ENC_DELTA) {
+        uint8_t delta [DSP_MONIT_DELTA_MAX_SIZE];
+        ssize_t delta_size = _dsp_monit_delta_encode (dsp, &monit, delta,
+                sizeof (delta));
+        ASSERT_TEST(delta_size > 0, "Could not encode monitoring data",
+                err_delta_encode, SMIO_ERR_BAD_MSG);
+
+        err = _dsp_monit_publish (self, DSP_MONIT_SUBJECT_DELTA, delta,
+                delta_size);
+        ASSERT_TEST(err == SMIO_SUCCESS, "Could not publish delta encoded "
+                "monitoring data", err_publish_delta);
+    }
+
+    err = _dsp_monit_ds_publish (self, dsp, &monit);
+
+err_publish_delta:
+err_delta_encode:
+err_publish_full:
+err_monit_snapshot:
+err_dsp_handler:
+    return err;
+}
+
 const smio_ops_t dsp_ops = {
     .attach             = dsp_attach,          /* Attach sm_io instance to dev_io */
     .deattach           = dsp_deattach,        /* Deattach sm_io instance to dev_io */
     .export_ops         = dsp_export_ops,      /* Export sm_io operations to dev_io */
     .unexport_ops       = dsp_unexport_ops,    /* Unexport sm_io operations to dev_io */
-    .do_op              = dsp_do_op            /* Generic wrapper for handling specific operations */
+    .do_op              = dsp_do_op,           /* Generic wrapper for handling specific operations */
+    .poll               = dsp_poll             /* Publish monitoring data */
 };
 
 /************************************************************/
@@ -271,10 +884,18 @@ smio_err_e dsp_init (smio_t * self)
     err = smio_set_ops (self, &dsp_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
+    /* Configuration registers are only changed by us, so they can be
+     * served from the cache. Monitoring registers are updated by the
+     * hardware and are always read from the device */
+    err = smio_add_cache_region (self, DSP_CTRL_REGS_OFFS | POS_CALC_REG_DS_TBT_THRES,
+            POS_CALC_REG_KSUM - POS_CALC_REG_DS_TBT_THRES + sizeof (uint32_t));
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO cached registers",
+            err_add_cache_region);
+
     /* disp_op_t structure is const and all of the functions performing on it
      * obviously receives a const argument, but here (and only on the SMIO
      * initialization) we need to make an exception if we want to keep the
@@ -302,6 +923,7 @@ err_smio_handler_alloc:
     smio_set_exp_ops (self, NULL);
 err_smio_set_exp_ops:
 err_fill_desc:
+err_add_cache_region:
     smio_set_thsafe_client_ops (self, NULL);
 err_smio_set_thsafe_ops:
     smio_set_ops (self, NULL);
@@ -190,6 +190,89 @@ disp_op_t dsp_set_get_monit_updt_exp = {
     }
 };
 
+disp_op_t dsp_set_get_monit_poll_time_exp = {
+    .name = DSP_NAME_SET_GET_MONIT_POLL_TIME,
+    .opcode = DSP_OPCODE_SET_GET_MONIT_POLL_TIME,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t dsp_get_monit_snapshot_exp = {
+    .name = DSP_NAME_GET_MONIT_SNAPSHOT,
+    .opcode = DSP_OPCODE_GET_MONIT_SNAPSHOT,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_dsp_monit_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t dsp_get_monit_history_exp = {
+    .name = DSP_NAME_GET_MONIT_HISTORY,
+    .opcode = DSP_OPCODE_GET_MONIT_HISTORY,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_dsp_monit_hist_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT64, uint64_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t dsp_set_get_monit_enc_exp = {
+    .name = DSP_NAME_SET_GET_MONIT_ENC,
+    .opcode = DSP_OPCODE_SET_GET_MONIT_ENC,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t dsp_set_get_trig_exp = {
+    .name = DSP_NAME_SET_GET_TRIG,
+    .opcode = DSP_OPCODE_SET_GET_TRIG,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_dsp_trig_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_dsp_trig_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t dsp_set_get_trig_count_exp = {
+    .name = DSP_NAME_SET_GET_TRIG_COUNT,
+    .opcode = DSP_OPCODE_SET_GET_TRIG_COUNT,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t dsp_set_get_monit_ds_exp = {
+    .name = DSP_NAME_SET_GET_MONIT_DS,
+    .opcode = DSP_OPCODE_SET_GET_MONIT_DS,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_dsp_monit_ds_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_dsp_monit_ds_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *dsp_exp_ops [] = {
     &dsp_set_get_kx_exp,
@@ -207,6 +290,13 @@ const disp_op_t *dsp_exp_ops [] = {
     &dsp_set_get_monit_pos_q_exp,
     &dsp_set_get_monit_pos_sum_exp,
     &dsp_set_get_monit_updt_exp,
+    &dsp_set_get_monit_poll_time_exp,
+    &dsp_get_monit_snapshot_exp,
+    &dsp_get_monit_history_exp,
+    &dsp_set_get_monit_enc_exp,
+    &dsp_set_get_trig_exp,
+    &dsp_set_get_trig_count_exp,
+    &dsp_set_get_monit_ds_exp,
     NULL
 };
 
@@ -25,6 +25,13 @@ extern disp_op_t dsp_set_get_monit_pos_y_exp;
 extern disp_op_t dsp_set_get_monit_pos_q_exp;
 extern disp_op_t dsp_set_get_monit_pos_sum_exp;
 extern disp_op_t dsp_set_get_monit_updt_exp;
+extern disp_op_t dsp_set_get_monit_poll_time_exp;
+extern disp_op_t dsp_get_monit_snapshot_exp;
+extern disp_op_t dsp_get_monit_history_exp;
+extern disp_op_t dsp_set_get_monit_enc_exp;
+extern disp_op_t dsp_set_get_trig_exp;
+extern disp_op_t dsp_set_get_trig_count_exp;
+extern disp_op_t dsp_set_get_monit_ds_exp;
 
 extern const disp_op_t *dsp_exp_ops [];
 
@@ -60,7 +60,30 @@
 #define FMC130M_4CH_NAME_ADC_DLY2                       "fmc130m_4ch_adc_dly2"
 #define FMC130M_4CH_OPCODE_ADC_DLY3                     28
 #define FMC130M_4CH_NAME_ADC_DLY3                       "fmc130m_4ch_adc_dly3"
-#define FMC130M_4CH_OPCODE_END                          29
+#define FMC130M_4CH_OPCODE_ADC_DLY_CAL                  29
+#define FMC130M_4CH_NAME_ADC_DLY_CAL                    "fmc130m_4ch_adc_dly_cal"
+/* Same opcode as FMC250M_4CH_OPCODE_ADC_DATA_ALL, as for the other ADC data
+ * operations, so clients read both boards the same way */
+#define FMC130M_4CH_OPCODE_ADC_DATA_ALL                 52
+#define FMC130M_4CH_NAME_ADC_DATA_ALL                   "fmc130m_4ch_adc_data_all"
+#define FMC130M_4CH_OPCODE_END                          53
+
+/* ADC delay calibration. All of the delay taps of the four channels are
+ * swept with the FMC ADC common test ramp enabled, reading the ADC data
+ * registers "num_reads" times per tap. A tap is good for a channel if every
+ * read is ahead of the previous one, modulo 2^16, by less than half of the
+ * ramp period, i.e., no bit error made the ramp go backwards. Each channel
+ * is left at the center of its widest run of good taps, or at its previous
+ * delay if none was good (eye_width = 0) */
+#define FMC130M_4CH_DLY_CAL_NUM_CHAN                    4
+#define FMC130M_4CH_DLY_CAL_MAX_READS                   1024
+
+struct _smio_fmc130m_4ch_dly_cal_t {
+    uint32_t dly_val[FMC130M_4CH_DLY_CAL_NUM_CHAN];    /* delay applied */
+    uint32_t eye_start[FMC130M_4CH_DLY_CAL_NUM_CHAN];  /* first tap of the eye */
+    uint32_t eye_width[FMC130M_4CH_DLY_CAL_NUM_CHAN];  /* number of taps of the eye */
+    uint32_t pass_mask[FMC130M_4CH_DLY_CAL_NUM_CHAN];  /* bit i set if tap i is good */
+};
 
 /* Messaging Reply OPCODES */
 #define FMC130M_4CH_REPLY_TYPE                          uint32_t
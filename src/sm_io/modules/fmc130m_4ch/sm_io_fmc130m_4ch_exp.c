@@ -13,6 +13,7 @@
 #include "sm_io_fmc130m_4ch_core.h"
 #include "sm_io_fmc130m_4ch_exp.h"
 #include "hw/wb_fmc130m_4ch_regs.h"
+#include "hw/wb_fmc_adc_common_regs.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
 #ifdef ASSERT_TEST
@@ -61,42 +62,38 @@
 #define BPM_FMC130M_4CH_RAND_MIN                0 /* RAND disabled */
 #define BPM_FMC130M_4CH_RAND_MAX                1 /* RAND enabled  */
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_rand) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            ADC, RAND, SINGLE_BIT_PARAM,
-            BPM_FMC130M_4CH_RAND_MIN, BPM_FMC130M_4CH_RAND_MAX, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_rand,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                ADC, RAND, SINGLE_BIT_PARAM,
+                BPM_FMC130M_4CH_RAND_MIN, BPM_FMC130M_4CH_RAND_MAX, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 #define BPM_FMC130M_4CH_DITH_MIN                0 /* DITH disabled */
 #define BPM_FMC130M_4CH_DITH_MAX                1 /* DITH enabled  */
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_dith) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            ADC, DITH, SINGLE_BIT_PARAM,
-            BPM_FMC130M_4CH_DITH_MIN, BPM_FMC130M_4CH_DITH_MAX, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dith,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                ADC, DITH, SINGLE_BIT_PARAM,
+                BPM_FMC130M_4CH_DITH_MIN, BPM_FMC130M_4CH_DITH_MAX, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 #define BPM_FMC130M_4CH_SHDN_MIN                0 /* SHDN disabled */
 #define BPM_FMC130M_4CH_SHDN_MAX                1 /* SHDN enabled  */
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_shdn) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            ADC, SHDN, SINGLE_BIT_PARAM,
-            BPM_FMC130M_4CH_SHDN_MIN, BPM_FMC130M_4CH_SHDN_MAX, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_shdn,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                ADC, SHDN, SINGLE_BIT_PARAM,
+                BPM_FMC130M_4CH_SHDN_MIN, BPM_FMC130M_4CH_SHDN_MAX, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 #define BPM_FMC130M_4CH_PGA_MIN                 0 /* PGA disabled */
 #define BPM_FMC130M_4CH_PGA_MAX                 1 /* PGA enabled  */
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_pga) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            ADC, PGA, SINGLE_BIT_PARAM,
-            BPM_FMC130M_4CH_PGA_MIN, BPM_FMC130M_4CH_PGA_MAX, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_pga,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                ADC, PGA, SINGLE_BIT_PARAM,
+                BPM_FMC130M_4CH_PGA_MIN, BPM_FMC130M_4CH_PGA_MAX, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /********************* ADC RAW Data registers (for simple debug) **************/
 
@@ -118,137 +115,166 @@ static int _rw_bpm_fmc130m_4ch_data_fmt (uint32_t *data)
     return PARAM_OK;
 }
 
-rw_param_format_fp rw_bpm_fmc130m_4ch_data_fmt_fp = _rw_bpm_fmc130m_4ch_data_fmt;
-
 #define  WB_FMC_130M_4CH_CSR_DATA0_GLOBAL_MASK      WB_FMC_130M_4CH_CSR_DATA_GLOBAL_MASK
 #define  WB_FMC_130M_4CH_CSR_DATA0_GLOBAL_W(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_W(val)
 #define  WB_FMC_130M_4CH_CSR_DATA0_GLOBAL_R(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_R(val)
-RW_PARAM_FUNC(fmc130m_4ch, adc_data0) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            DATA0, GLOBAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc130m_4ch_data_fmt_fp, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_data0,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                DATA0, GLOBAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc130m_4ch_data_fmt, SET_FIELD))
 
 #define  WB_FMC_130M_4CH_CSR_DATA1_GLOBAL_MASK      WB_FMC_130M_4CH_CSR_DATA_GLOBAL_MASK
 #define  WB_FMC_130M_4CH_CSR_DATA1_GLOBAL_W(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_W(val)
 #define  WB_FMC_130M_4CH_CSR_DATA1_GLOBAL_R(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_R(val)
-RW_PARAM_FUNC(fmc130m_4ch, adc_data1) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            DATA1, GLOBAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc130m_4ch_data_fmt_fp, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_data1,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                DATA1, GLOBAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc130m_4ch_data_fmt, SET_FIELD))
 
 #define  WB_FMC_130M_4CH_CSR_DATA2_GLOBAL_MASK       WB_FMC_130M_4CH_CSR_DATA_GLOBAL_MASK
 #define  WB_FMC_130M_4CH_CSR_DATA2_GLOBAL_W(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_W(val)
 #define  WB_FMC_130M_4CH_CSR_DATA2_GLOBAL_R(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_R(val)
-RW_PARAM_FUNC(fmc130m_4ch, adc_data2) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            DATA2, GLOBAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc130m_4ch_data_fmt_fp, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_data2,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                DATA2, GLOBAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc130m_4ch_data_fmt, SET_FIELD))
 
 #define  WB_FMC_130M_4CH_CSR_DATA3_GLOBAL_MASK      WB_FMC_130M_4CH_CSR_DATA_GLOBAL_MASK
 #define  WB_FMC_130M_4CH_CSR_DATA3_GLOBAL_W(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_W(val)
 #define  WB_FMC_130M_4CH_CSR_DATA3_GLOBAL_R(val)    WB_FMC_130M_4CH_CSR_DATA_GLOBAL_R(val)
-RW_PARAM_FUNC(fmc130m_4ch, adc_data3) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            DATA3, GLOBAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc130m_4ch_data_fmt_fp, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_data3,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                DATA3, GLOBAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc130m_4ch_data_fmt, SET_FIELD))
+
+/* Read "num_samples" samples of the four channels. DATA0 to DATA3 are
+ * contiguous, so each sample is read in a single block access */
+#define FMC130M_4CH_DATA_BLOCK_SIZE  (WB_FMC_130M_4CH_CSR_REG_DATA3 - \
+        WB_FMC_130M_4CH_CSR_REG_DATA0 + sizeof (uint32_t))
+
+static int _fmc130m_4ch_adc_data_all (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:fmc130m_4ch] "
+            "Calling _fmc130m_4ch_adc_data_all\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_fmc_adc_data_t *adc_data = (smio_fmc_adc_data_t *) ret;
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: number of samples */
+    uint32_t num_samples = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    ASSERT_TEST(num_samples > 0 && num_samples <= FMC_ADC_DATA_MAX_SAMPLES,
+            "Number of samples is invalid", err_inv_param);
+
+    uint32_t data_block [FMC_ADC_DATA_NUM_CHAN];
+    for (uint32_t i = 0; i < num_samples; ++i) {
+        ssize_t bread = smio_thsafe_client_read_block (self,
+                FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_DATA0,
+                FMC130M_4CH_DATA_BLOCK_SIZE, data_block);
+        ASSERT_TEST(bread == FMC130M_4CH_DATA_BLOCK_SIZE, "Could not read "
+                "ADC data", err_read_data);
+
+        for (uint32_t chan = 0; chan < FMC_ADC_DATA_NUM_CHAN; ++chan) {
+            _rw_bpm_fmc130m_4ch_data_fmt (&data_block [chan]);
+            adc_data->data [i][chan] = (int32_t) data_block [chan];
+        }
+    }
 
-/******************************** ADC Delay Values ****************************/
+    adc_data->num_samples = num_samples;
+    adc_data->reserved = 0;
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_val0) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY0_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+    return offsetof (smio_fmc_adc_data_t, data) +
+        num_samples * sizeof (adc_data->data [0]);
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_val1) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY1_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
+err_read_data:
+err_inv_param:
+    return -FMC130M_4CH_ERR;
 }
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_val2) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY2_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+/******************************** ADC Delay Values ****************************/
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_val3) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY3_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_val0,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY0_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_val1,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY1_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_val2,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY2_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_val3,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY3_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /******************************** ADC Delay Lines *****************************/
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_line0) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY0_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_line1) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY1_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_line2) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY2_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_line3) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY3_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_line0,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY0_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_line1,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY1_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_line2,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY2_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_line3,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY3_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /******************************** ADC Delay Update ****************************/
 
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_updt0) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY0_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_updt1) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY1_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_updt2) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY2_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc130m_4ch, adc_dly_updt3) {
-    SET_GET_PARAM(fmc130m_4ch, FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
-            IDELAY3_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_updt0,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY0_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_updt1,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY1_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_updt2,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY2_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc130m_4ch, adc_dly_updt3,
+        RW_PARAM_DESC(FMC_130M_CTRL_REGS_OFFS, WB_FMC_130M_4CH_CSR,
+                IDELAY3_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /***************************** Convenient ADC Delay ***************************/
 
@@ -266,9 +292,9 @@ RW_PARAM_FUNC(fmc130m_4ch, adc_dly_updt3) {
 #define FMC_130M_4CH_IDELAY_CAL_VAL_W(value)        WB_FMC_130M_4CH_CSR_IDELAY0_CAL_VAL_W(value)
 #define FMC_130M_4CH_IDELAY_CAL_VAL_R(reg)          WB_FMC_130M_4CH_CSR_IDELAY0_CAL_VAL_R(reg)
 
-/* Low-level ADC delay function. Must be called with the correct arguments, so
- * only internal functions shall use this */
-static int _fmc130m_4ch_set_adc_dly_ll (smio_t* owner, uint64_t addr, uint32_t dly_val,
+/* Write an ADC delay value to the lines selected by dly_type and update them,
+ * without checking it */
+static void _fmc130m_4ch_write_adc_dly (smio_t* owner, uint64_t addr, uint32_t dly_val,
         uint32_t dly_type)
 {
     uint32_t val = 0;
@@ -292,9 +318,18 @@ static int _fmc130m_4ch_set_adc_dly_ll (smio_t* owner, uint64_t addr, uint32_t d
 
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE,
             "[sm_io:fmc130m_4ch] ADC delay value set to %u\n", dly_val);
+}
+
+/* Low-level ADC delay function. Must be called with the correct arguments, so
+ * only internal functions shall use this */
+static int _fmc130m_4ch_set_adc_dly_ll (smio_t* owner, uint64_t addr, uint32_t dly_val,
+        uint32_t dly_type)
+{
+    uint32_t val = 0;
+
+    _fmc130m_4ch_write_adc_dly (owner, addr, dly_val, dly_type);
 
     /* Do a readback test to guarantee the delay is set correctly */
-    val = 0;
     usleep (1000);
     smio_thsafe_client_read_32 (owner, addr, &val);
 
@@ -361,6 +396,161 @@ FMC130M_4CH_ADC_DLY_FUNC_HEADER(3)
     FMC130M_4CH_ADC_DLY_FUNC_BODY(owner, args, ret, 3);
 }
 
+/***************************** ADC Delay Calibration **************************/
+
+#define FMC130M_4CH_IDELAY_NUM_TAPS                 ((WB_FMC_130M_4CH_CSR_IDELAY0_CAL_VAL_MASK >> \
+                                                        WB_FMC_130M_4CH_CSR_IDELAY0_CAL_VAL_SHIFT) + 1)
+/* Time for the delay lines and the ADC data registers to settle after a
+ * delay update. The same is waited for in _fmc130m_4ch_set_adc_dly_ll, but
+ * once per tap for all of the channels here */
+#define FMC130M_4CH_DLY_CAL_SETTLE_TIME             1000        /* in us */
+/* The test ramp wraps at 2^16. Successive reads must be less than half
+ * of that apart */
+#define FMC130M_4CH_DLY_CAL_RAMP_MASK               0xFFFF
+#define FMC130M_4CH_DLY_CAL_RAMP_MAX_STEP           0x8000
+
+static const uint64_t fmc130m_4ch_dly_regs [FMC130M_4CH_DLY_CAL_NUM_CHAN] = {
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_IDELAY0_CAL,
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_IDELAY1_CAL,
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_IDELAY2_CAL,
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_IDELAY3_CAL
+};
+
+static const uint64_t fmc130m_4ch_data_regs [FMC130M_4CH_DLY_CAL_NUM_CHAN] = {
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_DATA0,
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_DATA1,
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_DATA2,
+    FMC_130M_CTRL_REGS_OFFS | WB_FMC_130M_4CH_CSR_REG_DATA3
+};
+
+/* Check the test ramp of channel "chan" with the current delay */
+static bool _fmc130m_4ch_dly_cal_check (smio_t *owner, uint32_t chan,
+        uint32_t num_reads)
+{
+    uint32_t prev = 0;
+    uint32_t val = 0;
+
+    smio_thsafe_client_read_32 (owner, fmc130m_4ch_data_regs [chan], &prev);
+    for (uint32_t i = 0; i < num_reads; ++i) {
+        smio_thsafe_client_read_32 (owner, fmc130m_4ch_data_regs [chan], &val);
+        uint32_t step = (val - prev) & FMC130M_4CH_DLY_CAL_RAMP_MASK;
+        if (step >= FMC130M_4CH_DLY_CAL_RAMP_MAX_STEP) {
+            return false;
+        }
+        prev = val;
+    }
+
+    return true;
+}
+
+/* Find the widest run of good taps in "pass_mask" */
+static void _fmc130m_4ch_dly_cal_eye (uint32_t pass_mask, uint32_t *eye_start,
+        uint32_t *eye_width)
+{
+    uint32_t run_start = 0;
+    uint32_t run_width = 0;
+
+    *eye_start = 0;
+    *eye_width = 0;
+    for (uint32_t tap = 0; tap < FMC130M_4CH_IDELAY_NUM_TAPS; ++tap) {
+        if (pass_mask & (1U << tap)) {
+            if (run_width == 0) {
+                run_start = tap;
+            }
+            run_width++;
+            if (run_width > *eye_width) {
+                *eye_start = run_start;
+                *eye_width = run_width;
+            }
+        }
+        else {
+            run_width = 0;
+        }
+    }
+}
+
+static int _fmc130m_4ch_adc_dly_cal (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:fmc130m_4ch] "
+            "Calling _fmc130m_4ch_adc_dly_cal\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_fmc130m_4ch_dly_cal_t *cal = (smio_fmc130m_4ch_dly_cal_t *) ret;
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: delay type
+     * frame 2: number of reads per tap */
+    uint32_t dly_type = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t num_reads = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    ASSERT_TEST(dly_type != 0 && (dly_type & ~DLY_TYPE_ALL) == 0,
+            "Delay type is invalid", err_inv_param);
+    ASSERT_TEST(num_reads > 0 && num_reads <= FMC130M_4CH_DLY_CAL_MAX_READS,
+            "Number of reads is invalid", err_inv_param);
+
+    /* Channels without any good tap keep their current delay */
+    uint32_t dly_orig [FMC130M_4CH_DLY_CAL_NUM_CHAN];
+    uint32_t val = 0;
+    for (uint32_t chan = 0; chan < FMC130M_4CH_DLY_CAL_NUM_CHAN; ++chan) {
+        smio_thsafe_client_read_32 (self, fmc130m_4ch_dly_regs [chan], &val);
+        dly_orig [chan] = FMC_130M_4CH_IDELAY_CAL_VAL_R(val);
+    }
+
+    /* Switch the ADC data to the test ramp of the FMC ADC common core */
+    uint64_t monitor_addr = FMC_130M_FMC_ADC_COMMON_OFFS |
+        WB_FMC_ADC_COMMON_CSR_REG_MONITOR;
+    uint32_t monitor_orig = 0;
+    smio_thsafe_client_read_32 (self, monitor_addr, &monitor_orig);
+    val = monitor_orig | WB_FMC_ADC_COMMON_CSR_MONITOR_TEST_DATA_EN;
+    smio_thsafe_client_write_32 (self, monitor_addr, &val);
+
+    memset (cal, 0, sizeof (*cal));
+    for (uint32_t tap = 0; tap < FMC130M_4CH_IDELAY_NUM_TAPS; ++tap) {
+        for (uint32_t chan = 0; chan < FMC130M_4CH_DLY_CAL_NUM_CHAN; ++chan) {
+            _fmc130m_4ch_write_adc_dly (self, fmc130m_4ch_dly_regs [chan], tap,
+                    dly_type);
+        }
+        usleep (FMC130M_4CH_DLY_CAL_SETTLE_TIME);
+
+        for (uint32_t chan = 0; chan < FMC130M_4CH_DLY_CAL_NUM_CHAN; ++chan) {
+            if (_fmc130m_4ch_dly_cal_check (self, chan, num_reads)) {
+                cal->pass_mask [chan] |= (1U << tap);
+            }
+        }
+    }
+
+    smio_thsafe_client_write_32 (self, monitor_addr, &monitor_orig);
+
+    int err = -FMC130M_4CH_OK;
+    for (uint32_t chan = 0; chan < FMC130M_4CH_DLY_CAL_NUM_CHAN; ++chan) {
+        _fmc130m_4ch_dly_cal_eye (cal->pass_mask [chan], &cal->eye_start [chan],
+                &cal->eye_width [chan]);
+        cal->dly_val [chan] = (cal->eye_width [chan] == 0) ? dly_orig [chan] :
+            cal->eye_start [chan] + (cal->eye_width [chan] - 1) / 2;
+
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:fmc130m_4ch] adc_dly_cal: "
+                "Channel %u: good taps 0x%08X, eye of %u taps at %u, delay set "
+                "to %u\n", chan, cal->pass_mask [chan], cal->eye_width [chan],
+                cal->eye_start [chan], cal->dly_val [chan]);
+
+        if (_fmc130m_4ch_set_adc_dly_ll (self, fmc130m_4ch_dly_regs [chan],
+                    cal->dly_val [chan], dly_type) != -FMC130M_4CH_OK) {
+            err = -FMC130M_4CH_ERR;
+        }
+    }
+    ASSERT_TEST(err == -FMC130M_4CH_OK, "Could not apply the calibrated "
+            "delays", err_set_dly);
+
+    return sizeof (*cal);
+
+err_set_dly:
+err_inv_param:
+    return -FMC130M_4CH_ERR;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp fmc130m_4ch_exp_fp [] = {
     RW_PARAM_FUNC_NAME(fmc130m_4ch, adc_rand),
@@ -387,6 +577,8 @@ const disp_table_func_fp fmc130m_4ch_exp_fp [] = {
     FMC130M_4CH_ADC_DLY_FUNC_NAME(1),
     FMC130M_4CH_ADC_DLY_FUNC_NAME(2),
     FMC130M_4CH_ADC_DLY_FUNC_NAME(3),
+    _fmc130m_4ch_adc_dly_cal,
+    _fmc130m_4ch_adc_data_all,
     NULL
 };
 
@@ -469,7 +661,7 @@ smio_err_e fmc130m_4ch_init (smio_t * self)
     err = smio_set_ops (self, &fmc130m_4ch_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
@@ -34,6 +34,8 @@ extern disp_op_t fmc130m_4ch_adc_dly0_exp;
 extern disp_op_t fmc130m_4ch_adc_dly1_exp;
 extern disp_op_t fmc130m_4ch_adc_dly2_exp;
 extern disp_op_t fmc130m_4ch_adc_dly3_exp;
+extern disp_op_t fmc130m_4ch_adc_dly_cal_exp;
+extern disp_op_t fmc130m_4ch_adc_data_all_exp;
 
 extern const disp_op_t *fmc130m_4ch_exp_ops [];
 
@@ -78,7 +78,9 @@
 #define FMC250M_4CH_NAME_TESTMODE2                      "fmc250m_4ch_test_mode2"
 #define FMC250M_4CH_OPCODE_TESTMODE3                    51
 #define FMC250M_4CH_NAME_TESTMODE3                      "fmc350m_4ch_test_mode3"
-#define FMC250M_4CH_OPCODE_END                          52
+#define FMC250M_4CH_OPCODE_ADC_DATA_ALL                 52
+#define FMC250M_4CH_NAME_ADC_DATA_ALL                   "fmc250m_4ch_adc_data_all"
+#define FMC250M_4CH_OPCODE_END                          53
 
 /* Messaging Reply OPCODES */
 #define FMC250M_4CH_REPLY_TYPE                          uint32_t
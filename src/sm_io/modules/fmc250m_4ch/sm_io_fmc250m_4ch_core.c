@@ -137,19 +137,26 @@ smio_fmc250m_4ch_t * smio_fmc250m_4ch_new (smio_t *parent)
         }
     }
 
-    /* FIXME: We need to be sure that, if the board is ACTIVE, the FMC_ACTIVE_CLK
-     * component has been sucseddfully initialized so that the ADCs has clock. 
-     * Otherwise, we won't be able to RESET the ADCs, leading to undefined 
-     * behavior */
-    sleep (1);
-
-    /* Setup ISLA216P ADC SPI communication */
+    /* Setup ISLA216P ADC SPI communication. All of the ADCs are brought up
+     * first, so they calibrate at the same time */
     uint32_t i;
     for (i = 0; i < NUM_FMC250M_4CH_ISLA216P; ++i) {
         self->smch_isla216p_adc[i] = NULL;
         self->smch_isla216p_adc[i] = smch_isla216p_new (parent, FMC_250M_ISLA216P_SPI_OFFS,
             fmc250m_4ch_isla216p_addr[inst_id][i], 0);
         ASSERT_ALLOC(self->smch_isla216p_adc[i], err_smch_isla216p_adc);
+    }
+
+    /* If the board is ACTIVE, the ADCs only get a clock after the
+     * FMC_ACTIVE_CLK component has been initialized, so wait until they
+     * are calibrated, instead of for a fixed time */
+    int64_t deadline = zclock_mono () + FMC250M_4CH_ISLA216P_CAL_TIMEOUT;
+    for (i = 0; i < NUM_FMC250M_4CH_ISLA216P; ++i) {
+        smch_err_e err = smch_isla216p_wait_cal (self->smch_isla216p_adc[i], deadline);
+        if (err != SMCH_SUCCESS) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:fmc250m_4ch_core] ISLA216P%u "
+                    "not calibrated. Does it have a clock?\n", i);
+        }
 
         uint8_t chipid = 0;
         uint8_t chipver = 0;
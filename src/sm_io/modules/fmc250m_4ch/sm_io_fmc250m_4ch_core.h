@@ -19,6 +19,10 @@
 #define FMC250M_4CH_ACTIVE_MD5              0x955393fc
 #define FMC250M_4CH_PASSIVE_MD5             0xf9556611
 
+/* Time allowed for the ISLA216P ADCs to calibrate after init, in ms. They
+ * only do so once their clock is stable */
+#define FMC250M_4CH_ISLA216P_CAL_TIMEOUT    1000
+
 /* Start writing on EEPROM address 0x0 */
 #define FMC250M_4CH_EEPROM_START_ADDR       0x0
 
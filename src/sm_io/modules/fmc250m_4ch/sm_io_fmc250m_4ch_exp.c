@@ -80,126 +80,167 @@ static int _rw_bpm_fmc250m_4ch_data_fmt (uint32_t *data)
     return PARAM_OK;
 }
 
-rw_param_format_fp rw_bpm_fmc250m_4ch_data_fmt_fp = _rw_bpm_fmc250m_4ch_data_fmt;
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_data0,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                CH0_STA, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc250m_4ch_data_fmt, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_data1,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                CH1_STA, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc250m_4ch_data_fmt, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_data2,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                CH2_STA, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc250m_4ch_data_fmt, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_data3,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                CH3_STA, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                _rw_bpm_fmc250m_4ch_data_fmt, SET_FIELD))
+
+/* Read "num_samples" samples of the four channels. Each sample is read in a
+ * single block access, from CH0_STA to CH3_STA, skipping the delay registers
+ * in between */
+#define FMC250M_4CH_DATA_BLOCK_SIZE  (WB_FMC_250M_4CH_CSR_REG_CH3_STA - \
+        WB_FMC_250M_4CH_CSR_REG_CH0_STA + sizeof (uint32_t))
+#define FMC250M_4CH_DATA_BLOCK_IDX(reg)  \
+        (((reg) - WB_FMC_250M_4CH_CSR_REG_CH0_STA) / sizeof (uint32_t))
+
+static const uint32_t fmc250m_4ch_data_idx [FMC_ADC_DATA_NUM_CHAN] = {
+    FMC250M_4CH_DATA_BLOCK_IDX(WB_FMC_250M_4CH_CSR_REG_CH0_STA),
+    FMC250M_4CH_DATA_BLOCK_IDX(WB_FMC_250M_4CH_CSR_REG_CH1_STA),
+    FMC250M_4CH_DATA_BLOCK_IDX(WB_FMC_250M_4CH_CSR_REG_CH2_STA),
+    FMC250M_4CH_DATA_BLOCK_IDX(WB_FMC_250M_4CH_CSR_REG_CH3_STA)
+};
 
-RW_PARAM_FUNC(fmc250m_4ch, adc_data0) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            CH0_STA, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc250m_4ch_data_fmt_fp, SET_FIELD);
-}
+static int _fmc250m_4ch_adc_data_all (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:fmc250m_4ch] "
+            "Calling _fmc250m_4ch_adc_data_all\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_fmc_adc_data_t *adc_data = (smio_fmc_adc_data_t *) ret;
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: number of samples */
+    uint32_t num_samples = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    ASSERT_TEST(num_samples > 0 && num_samples <= FMC_ADC_DATA_MAX_SAMPLES,
+            "Number of samples is invalid", err_inv_param);
+
+    uint32_t data_block [FMC250M_4CH_DATA_BLOCK_SIZE / sizeof (uint32_t)];
+    for (uint32_t i = 0; i < num_samples; ++i) {
+        ssize_t bread = smio_thsafe_client_read_block (self,
+                FMC_250M_CTRL_REGS_OFFS | WB_FMC_250M_4CH_CSR_REG_CH0_STA,
+                FMC250M_4CH_DATA_BLOCK_SIZE, data_block);
+        ASSERT_TEST(bread == FMC250M_4CH_DATA_BLOCK_SIZE, "Could not read "
+                "ADC data", err_read_data);
+
+        for (uint32_t chan = 0; chan < FMC_ADC_DATA_NUM_CHAN; ++chan) {
+            uint32_t val = WB_FMC_250M_4CH_CSR_CH0_STA_VAL_R(
+                    data_block [fmc250m_4ch_data_idx [chan]]);
+            _rw_bpm_fmc250m_4ch_data_fmt (&val);
+            adc_data->data [i][chan] = (int32_t) val;
+        }
+    }
 
-RW_PARAM_FUNC(fmc250m_4ch, adc_data1) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            CH1_STA, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc250m_4ch_data_fmt_fp, SET_FIELD);
-}
+    adc_data->num_samples = num_samples;
+    adc_data->reserved = 0;
 
-RW_PARAM_FUNC(fmc250m_4ch, adc_data2) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            CH2_STA, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc250m_4ch_data_fmt_fp, SET_FIELD);
-}
+    return offsetof (smio_fmc_adc_data_t, data) +
+        num_samples * sizeof (adc_data->data [0]);
 
-RW_PARAM_FUNC(fmc250m_4ch, adc_data3) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            CH3_STA, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            rw_bpm_fmc250m_4ch_data_fmt_fp, SET_FIELD);
+err_read_data:
+err_inv_param:
+    return -FMC250M_4CH_ERR;
 }
 
 #if 0
 /******************************** ADC Delay Values ****************************/
 
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_val0) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY0_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_val1) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY1_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_val2) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY2_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_val3) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY3_CAL, VAL, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_val0,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY0_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_val1,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY1_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_val2,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY2_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_val3,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY3_CAL, VAL, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /******************************** ADC Delay Lines *****************************/
 
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_line0) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY0_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_line1) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY1_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_line2) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY2_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_line3) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY3_CAL, LINE, MULT_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_line0,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY0_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_line1,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY1_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_line2,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY2_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_line3,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY3_CAL, LINE, MULT_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /******************************** ADC Delay Update ****************************/
 
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_updt0) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY0_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_updt1) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY1_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_updt2) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY2_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
-
-RW_PARAM_FUNC(fmc250m_4ch, adc_dly_updt3) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            IDELAY3_CAL, UPDATE, SINGLE_BIT_PARAM,
-            /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_updt0,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY0_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_updt1,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY1_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_updt2,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY2_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
+
+RW_PARAM_DESC_FUNC(fmc250m_4ch, adc_dly_updt3,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                IDELAY3_CAL, UPDATE, SINGLE_BIT_PARAM,
+                /* no minimum value */, /* no maximum value */, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /***************************** Convenient ADC Delay ***************************/
 
@@ -217,6 +258,11 @@ RW_PARAM_FUNC(fmc250m_4ch, adc_dly_updt3) {
 #define FMC_250M_4CH_IDELAY_CAL_VAL_W(value)        WB_FMC_250M_4CH_CSR_IDELAY0_CAL_VAL_W(value)
 #define FMC_250M_4CH_IDELAY_CAL_VAL_R(reg)          WB_FMC_250M_4CH_CSR_IDELAY0_CAL_VAL_R(reg)
 
+/* Time allowed for a delay update to show in the readback, in ms, and
+ * interval between reads, in us */
+#define FMC250M_4CH_IDELAY_UPDT_TIMEOUT             10
+#define FMC250M_4CH_IDELAY_UPDT_USECS_POLL          50
+
 /* Low-level ADC delay function. Must be called with the correct arguments, so
  * only internal functions shall use this */
 static int _fmc250m_4ch_set_adc_dly_ll (smio_t* owner, uint64_t addr, uint32_t dly_val,
@@ -244,10 +290,21 @@ static int _fmc250m_4ch_set_adc_dly_ll (smio_t* owner, uint64_t addr, uint32_t d
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE,
             "[sm_io:fmc250m_4ch] ADC delay value set to %u\n", dly_val);
 
-    /* Do a readback test to guarantee the delay is set correctly */
-    val = 0;
-    usleep (1000);
-    smio_thsafe_client_read_32 (owner, addr, &val);
+    /* Do a readback test to guarantee the delay is set correctly. The
+     * update takes a few clock cycles, so poll for it instead of waiting
+     * for a fixed time */
+    int64_t deadline = zclock_mono () + FMC250M_4CH_IDELAY_UPDT_TIMEOUT;
+    while (1) {
+        val = 0;
+        smio_thsafe_client_read_32 (owner, addr, &val);
+
+        if (FMC_250M_4CH_IDELAY_CAL_VAL_R(val) == dly_val ||
+                zclock_mono () >= deadline) {
+            break;
+        }
+
+        usleep (FMC250M_4CH_IDELAY_UPDT_USECS_POLL);
+    }
 
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE,
             "[sm_io:fmc250m_4ch] ADC delay read value is %u\n",
@@ -318,32 +375,29 @@ FMC250M_4CH_ADC_DLY_FUNC_HEADER(3)
 #define BPM_FMC250M_4CH_RST_ADCS_MIN            0 /* Do nothing on RST_ADCS pin */
 #define BPM_FMC250M_4CH_RST_ADCS_MAX            1 /* Pulse RST_ADCS pin */
 
-RW_PARAM_FUNC(fmc250m_4ch, rst_adcs) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            ADC_CTL, RST_ADCS, SINGLE_BIT_PARAM,
-            BPM_FMC250M_4CH_RST_ADCS_MIN, BPM_FMC250M_4CH_RST_ADCS_MAX, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc250m_4ch, rst_adcs,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                ADC_CTL, RST_ADCS, SINGLE_BIT_PARAM,
+                BPM_FMC250M_4CH_RST_ADCS_MIN, BPM_FMC250M_4CH_RST_ADCS_MAX, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 #define BPM_FMC250M_4CH_RST_DIV_ADCS_MIN        0  /* Do nothing on RST_DIV_ADCS pin */
 #define BPM_FMC250M_4CH_RST_DIV_ADCS_MAX        1  /* Pulse RST_DIV_ADCS pin */
 
-RW_PARAM_FUNC(fmc250m_4ch, rst_div_adcs) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            ADC_CTL, RST_DIV_ADCS, SINGLE_BIT_PARAM,
-            BPM_FMC250M_4CH_RST_DIV_ADCS_MIN, BPM_FMC250M_4CH_RST_DIV_ADCS_MAX, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc250m_4ch, rst_div_adcs,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                ADC_CTL, RST_DIV_ADCS, SINGLE_BIT_PARAM,
+                BPM_FMC250M_4CH_RST_DIV_ADCS_MIN, BPM_FMC250M_4CH_RST_DIV_ADCS_MAX, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 #define BPM_FMC250M_4CH_SLEEP_ADCS_MIN        	0  /* Do nothing on SLEEP_ADCS pin */
 #define BPM_FMC250M_4CH_SLEEP_ADCS_MAX        	1  /* Pulse SLEEP_ADCS pin */
 
-RW_PARAM_FUNC(fmc250m_4ch, sleep_adcs) {
-    SET_GET_PARAM(fmc250m_4ch, FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
-            ADC_CTL, SLEEP_ADCS, SINGLE_BIT_PARAM,
-            BPM_FMC250M_4CH_SLEEP_ADCS_MIN, BPM_FMC250M_4CH_SLEEP_ADCS_MAX, NO_CHK_FUNC,
-            NO_FMT_FUNC, SET_FIELD);
-}
+RW_PARAM_DESC_FUNC(fmc250m_4ch, sleep_adcs,
+        RW_PARAM_DESC(FMC_250M_CTRL_REGS_OFFS, WB_FMC_250M_4CH_CSR,
+                ADC_CTL, SLEEP_ADCS, SINGLE_BIT_PARAM,
+                BPM_FMC250M_4CH_SLEEP_ADCS_MIN, BPM_FMC250M_4CH_SLEEP_ADCS_MAX, NO_CHK_FUNC,
+                NO_FMT_FUNC, SET_FIELD))
 
 /* Macros to avoid repetition of the function body ISLA216P */
 typedef smch_err_e (*smch_isla216p_func_fp) (smch_isla216p_t *self, uint32_t *param);
@@ -489,6 +543,7 @@ const disp_table_func_fp fmc250m_4ch_exp_fp [] = {
     FMC250M_4CH_ISLA216P_FUNC_NAME(test_mode1),
     FMC250M_4CH_ISLA216P_FUNC_NAME(test_mode2),
     FMC250M_4CH_ISLA216P_FUNC_NAME(test_mode3),
+    _fmc250m_4ch_adc_data_all,
     NULL
 };
 
@@ -571,7 +626,7 @@ smio_err_e fmc250m_4ch_init (smio_t * self)
     err = smio_set_ops (self, &fmc250m_4ch_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
@@ -387,6 +387,17 @@ disp_op_t fmc250m_4ch_test_mode3_exp = {
     }
 };
 
+disp_op_t fmc250m_4ch_adc_data_all_exp = {
+    .name = FMC250M_4CH_NAME_ADC_DATA_ALL,
+    .opcode = FMC250M_4CH_OPCODE_ADC_DATA_ALL,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_fmc_adc_data_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *fmc250m_4ch_exp_ops [] = {
 #if 0
@@ -424,6 +435,7 @@ const disp_op_t *fmc250m_4ch_exp_ops [] = {
     &fmc250m_4ch_test_mode1_exp,
     &fmc250m_4ch_test_mode2_exp,
     &fmc250m_4ch_test_mode3_exp,
+    &fmc250m_4ch_adc_data_all_exp,
     NULL
 };
 
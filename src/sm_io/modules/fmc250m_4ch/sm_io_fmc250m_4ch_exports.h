@@ -45,6 +45,7 @@ extern disp_op_t fmc250m_4ch_test_mode0_exp;
 extern disp_op_t fmc250m_4ch_test_mode1_exp;
 extern disp_op_t fmc250m_4ch_test_mode2_exp;
 extern disp_op_t fmc250m_4ch_test_mode3_exp;
+extern disp_op_t fmc250m_4ch_adc_data_all_exp;
 
 extern const disp_op_t *fmc250m_4ch_exp_ops [];
 
@@ -8,6 +8,29 @@
 #ifndef _SM_IO_FMC_ACTIVE_CLK_CODES_H_
 #define _SM_IO_FMC_ACTIVE_CLK_CODES_H_
 
+/* Clock tree profiles. A profile holds the AD9510 and Si571 settings of a
+ * clock configuration, read from the "fmc_active_clk/profile" section of the
+ * configuration file and checked when the SMIO starts. Selecting one writes
+ * all of its AD9510 registers and makes them effective with a single
+ * register update */
+#define FMC_ACTIVE_CLK_PROFILE_NUM                         8
+#define FMC_ACTIVE_CLK_PROFILE_NAME_MAX                    32
+#define FMC_ACTIVE_CLK_PROFILE_NONE                        0xFFFFFFFF  /* No profile selected */
+#define FMC_ACTIVE_CLK_PROFILE_KEEP                        0xFFFFFFFF  /* Setting left unchanged */
+
+struct _smio_fmc_active_clk_profile_t {
+    char name [FMC_ACTIVE_CLK_PROFILE_NAME_MAX];    /* NULL terminated */
+    uint32_t pll_a_div;                             /* AD9510 settings, as */
+    uint32_t pll_b_div;                             /* the ones of the single */
+    uint32_t pll_prescaler;                         /* setting operations, or */
+    uint32_t r_div;                                 /* FMC_ACTIVE_CLK_PROFILE_KEEP */
+    uint32_t cp_current;
+    uint32_t outputs;
+    uint32_t pll_clk_sel;
+    uint32_t wait_lock;                             /* Wait for the PLL to lock */
+    double si571_freq;                              /* In Hz. 0 to keep it */
+};
+
 /* Messaging OPCODES */
 #define FMC_ACTIVE_CLK_OPCODE_TYPE                         uint32_t
 #define FMC_ACTIVE_CLK_OPCODE_SIZE                         (sizeof (FMC_ACTIVE_CLK_OPCODE_TYPE))
@@ -44,7 +67,11 @@
 #define FMC_ACTIVE_CLK_NAME_SI571_FREQ                     "fmc_active_clk_si571_freq"
 #define FMC_ACTIVE_CLK_OPCODE_SI571_GET_DEFAULTS           15
 #define FMC_ACTIVE_CLK_NAME_SI571_GET_DEFAULTS             "fmc_active_clk_si571_get_defaults"
-#define FMC_ACTIVE_CLK_OPCODE_END                          16
+#define FMC_ACTIVE_CLK_OPCODE_PROFILE                      16
+#define FMC_ACTIVE_CLK_NAME_PROFILE                        "fmc_active_clk_profile"
+#define FMC_ACTIVE_CLK_OPCODE_PROFILE_SEL                  17
+#define FMC_ACTIVE_CLK_NAME_PROFILE_SEL                    "fmc_active_clk_profile_sel"
+#define FMC_ACTIVE_CLK_OPCODE_END                          18
 
 /* Messaging Reply OPCODES */
 #define FMC_ACTIVE_CLK_REPLY_TYPE                          uint32_t
@@ -34,6 +34,132 @@
     CHECK_HAL_ERR(err, SM_IO, "[sm_io_fmc_active_clk_core]",                    \
             smio_err_str (err_type))
 
+/* Section of the configuration file with the clock tree profiles, in the
+ * form:
+ *
+ * fmc_active_clk
+ *     profile
+ *         <name>
+ *             pll_a_div = <value>
+ *             ...
+ *             si571_freq = <Hz>
+ *             wait_lock = <yes | no>
+ */
+#define FMC_ACTIVE_CLK_PROFILE_CFG_PATH         "/fmc_active_clk/profile"
+
+/* Read the unsigned setting "path" of "cfg", if there. Returns false if it
+ * is not a number */
+static bool _smio_fmc_active_clk_cfg_u32 (zconfig_t *cfg, const char *path,
+        uint32_t *value)
+{
+    char *str = zconfig_get (cfg, path, NULL);
+    if (str == NULL || *str == '\0') {
+        return true;
+    }
+
+    char *endptr = NULL;
+    unsigned long val = strtoul (str, &endptr, 0);
+    if (*endptr != '\0' || val >= FMC_ACTIVE_CLK_PROFILE_KEEP) {
+        return false;
+    }
+
+    *value = val;
+    return true;
+}
+
+/* Read and check a single profile. Returns false if it is invalid */
+static bool _smio_fmc_active_clk_load_profile (smio_fmc_active_clk_t *self,
+        zconfig_t *cfg, uint32_t slot)
+{
+    smio_fmc_active_clk_profile_t *profile = &self->profiles [slot];
+    smch_ad9510_cfg_t ad9510_cfg = {
+        .pll_a_div = SMCH_AD9510_CFG_KEEP,
+        .pll_b_div = SMCH_AD9510_CFG_KEEP,
+        .pll_prescaler = SMCH_AD9510_CFG_KEEP,
+        .r_div = SMCH_AD9510_CFG_KEEP,
+        .cp_current = SMCH_AD9510_CFG_KEEP,
+        .outputs = SMCH_AD9510_CFG_KEEP,
+        .pll_clk_sel = SMCH_AD9510_CFG_KEEP
+    };
+
+    if (!_smio_fmc_active_clk_cfg_u32 (cfg, "pll_a_div", &ad9510_cfg.pll_a_div) ||
+            !_smio_fmc_active_clk_cfg_u32 (cfg, "pll_b_div", &ad9510_cfg.pll_b_div) ||
+            !_smio_fmc_active_clk_cfg_u32 (cfg, "pll_prescaler", &ad9510_cfg.pll_prescaler) ||
+            !_smio_fmc_active_clk_cfg_u32 (cfg, "r_div", &ad9510_cfg.r_div) ||
+            !_smio_fmc_active_clk_cfg_u32 (cfg, "cp_current", &ad9510_cfg.cp_current) ||
+            !_smio_fmc_active_clk_cfg_u32 (cfg, "outputs", &ad9510_cfg.outputs) ||
+            !_smio_fmc_active_clk_cfg_u32 (cfg, "pll_clk_sel", &ad9510_cfg.pll_clk_sel)) {
+        return false;
+    }
+
+    /* Compiling checks the ranges too */
+    smch_err_e serr = smch_ad9510_cfg_compile (&ad9510_cfg,
+            &self->ad9510_progs [slot]);
+    if (serr != SMCH_SUCCESS) {
+        return false;
+    }
+
+    char *si571_freq = zconfig_get (cfg, "si571_freq", "0");
+    char *endptr = NULL;
+    profile->si571_freq = strtod (si571_freq, &endptr);
+    if (*endptr != '\0' || profile->si571_freq < 0) {
+        return false;
+    }
+
+    profile->wait_lock = !streq (zconfig_get (cfg, "wait_lock", "yes"), "no");
+    profile->pll_a_div = ad9510_cfg.pll_a_div;
+    profile->pll_b_div = ad9510_cfg.pll_b_div;
+    profile->pll_prescaler = ad9510_cfg.pll_prescaler;
+    profile->r_div = ad9510_cfg.r_div;
+    profile->cp_current = ad9510_cfg.cp_current;
+    profile->outputs = ad9510_cfg.outputs;
+    profile->pll_clk_sel = ad9510_cfg.pll_clk_sel;
+    snprintf (profile->name, sizeof (profile->name), "%s", zconfig_name (cfg));
+
+    return true;
+}
+
+/* Read the clock tree profiles from "cfg_file". Invalid ones are skipped */
+static void _smio_fmc_active_clk_load_profiles (smio_fmc_active_clk_t *self,
+        const char *cfg_file)
+{
+    self->num_profiles = 0;
+    self->profile_sel = FMC_ACTIVE_CLK_PROFILE_NONE;
+
+    if (cfg_file == NULL) {
+        return;
+    }
+
+    zconfig_t *root_cfg = zconfig_load (cfg_file);
+    if (root_cfg == NULL) {
+        return;
+    }
+
+    zconfig_t *profile_cfg = zconfig_locate (root_cfg,
+            FMC_ACTIVE_CLK_PROFILE_CFG_PATH);
+    zconfig_t *cfg = (profile_cfg != NULL) ? zconfig_child (profile_cfg) : NULL;
+    for (; cfg != NULL; cfg = zconfig_next (cfg)) {
+        if (self->num_profiles == FMC_ACTIVE_CLK_PROFILE_NUM) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:fmc_active_clk_core] "
+                    "Too many clock profiles. Ignoring %s and the next ones\n",
+                    zconfig_name (cfg));
+            break;
+        }
+
+        if (!_smio_fmc_active_clk_load_profile (self, cfg, self->num_profiles)) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io:fmc_active_clk_core] "
+                    "Clock profile %s is invalid. Ignoring it\n", zconfig_name (cfg));
+            continue;
+        }
+
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io:fmc_active_clk_core] "
+                "Clock profile %u: %s\n", self->num_profiles, zconfig_name (cfg));
+        self->num_profiles++;
+    }
+
+    zconfig_destroy (&root_cfg);
+}
+
 /* Creates a new instance of Device Information */
 smio_fmc_active_clk_t * smio_fmc_active_clk_new (smio_t *parent)
 {
@@ -56,6 +182,8 @@ smio_fmc_active_clk_t * smio_fmc_active_clk_new (smio_t *parent)
             fmc_active_clk_si571_addr, 0);
     ASSERT_ALLOC(self->smch_si571, err_smch_si571_alloc);
 
+    _smio_fmc_active_clk_load_profiles (self, smio_get_cfg_file (parent));
+
     return self;
 
 err_smch_si571_alloc:
@@ -14,6 +14,15 @@
 typedef struct {
     smch_ad9510_t *smch_ad9510;                 /* AD9510 chip handler */
     smch_si57x_t *smch_si571;                   /* SI571 chip handler */
+    smio_fmc_active_clk_profile_t profiles [FMC_ACTIVE_CLK_PROFILE_NUM];
+                                                /* Clock tree profiles */
+    smch_ad9510_prog_t ad9510_progs [FMC_ACTIVE_CLK_PROFILE_NUM];
+                                                /* AD9510 registers of each profile */
+    uint32_t num_profiles;                      /* Profiles read from the
+                                                   configuration file */
+    uint32_t profile_sel;                       /* Last selected profile.
+                                                   FMC_ACTIVE_CLK_PROFILE_NONE
+                                                   if none */
 } smio_fmc_active_clk_t;
 
 /***************** Our methods *****************/
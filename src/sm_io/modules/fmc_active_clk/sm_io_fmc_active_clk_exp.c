@@ -320,6 +320,137 @@ FMC_ACTIVE_CLK_SI571_FUNC_NAME_HEADER(get_defaults)
             smch_si57x_get_defaults_compat, "Could not restart SI571 to its defaults");
 }
 
+/* Clock tree profile functions.
+ * Profiles are read from the configuration file when the SMIO starts. The
+ * AD9510 registers of each one are computed and checked there, so selecting
+ * a profile only writes them and updates the chip once */
+#define FMC_ACTIVE_CLK_PLL_LOCK_TRIES               100
+#define FMC_ACTIVE_CLK_PLL_LOCK_WAIT                1000 /* in us */
+
+static int _fmc_active_clk_wait_pll_lock (SMIO_OWNER_TYPE *self)
+{
+    uint32_t i;
+    for (i = 0; i < FMC_ACTIVE_CLK_PLL_LOCK_TRIES; ++i) {
+        uint32_t data = 0;
+        ssize_t ret = smio_thsafe_client_read_32 (self, FMC_ACTIVE_CLK_CTRL_REGS_OFFS |
+                WB_FMC_ACTIVE_CLK_CSR_REG_CLK_DISTRIB, &data);
+        if (ret != sizeof (data)) {
+            return -FMC_ACTIVE_CLK_ERR;
+        }
+
+        if (data & WB_FMC_ACTIVE_CLK_CSR_CLK_DISTRIB_PLL_STATUS) {
+            return -FMC_ACTIVE_CLK_OK;
+        }
+
+        usleep (FMC_ACTIVE_CLK_PLL_LOCK_WAIT);
+    }
+
+    return -FMC_ACTIVE_CLK_ERR;
+}
+
+/* Read a profile slot back */
+static int _fmc_active_clk_profile (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -FMC_ACTIVE_CLK_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_fmc_active_clk_t *fmcaclk = smio_get_handler (self);
+    ASSERT_TEST(fmcaclk != NULL, "Could not get SMIO FMC ACTIVE CLK handler",
+            err_get_fmcaclk_handler, -FMC_ACTIVE_CLK_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:fmc_active_clk_exp] Calling "
+            "_fmc_active_clk_profile\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: slot
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t slot = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    ASSERT_TEST(rw, "Clock profiles are read from the configuration file only",
+            err_inv_rw, -FMC_ACTIVE_CLK_UNINPL);
+    ASSERT_TEST(slot < fmcaclk->num_profiles, "Clock profile slot is empty",
+            err_inv_slot, -FMC_ACTIVE_CLK_ERR);
+
+    memcpy (ret, &fmcaclk->profiles [slot], sizeof (fmcaclk->profiles [slot]));
+    err = sizeof (fmcaclk->profiles [slot]);
+
+err_inv_slot:
+err_inv_rw:
+err_get_fmcaclk_handler:
+    return err;
+}
+
+/* Apply a profile or read which one was last selected */
+static int _fmc_active_clk_profile_sel (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -FMC_ACTIVE_CLK_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_fmc_active_clk_t *fmcaclk = smio_get_handler (self);
+    ASSERT_TEST(fmcaclk != NULL, "Could not get SMIO FMC ACTIVE CLK handler",
+            err_get_fmcaclk_handler, -FMC_ACTIVE_CLK_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:fmc_active_clk_exp] Calling "
+            "_fmc_active_clk_profile_sel\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: slot
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t slot = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = fmcaclk->profile_sel;
+        err = sizeof (fmcaclk->profile_sel);
+        goto err_get_fmcaclk_handler;
+    }
+
+    ASSERT_TEST(slot < fmcaclk->num_profiles, "Clock profile slot is empty",
+            err_inv_slot, -FMC_ACTIVE_CLK_ERR);
+
+    /* Whatever happens next, the clock tree no longer matches the last
+     * selected profile */
+    fmcaclk->profile_sel = FMC_ACTIVE_CLK_PROFILE_NONE;
+    smio_set_param_changed (self);
+    smio_fmc_active_clk_profile_t *profile = &fmcaclk->profiles [slot];
+
+    /* The Si571 is the reference of the AD9510 PLL, so change it first */
+    smch_err_e serr = SMCH_SUCCESS;
+    if (profile->si571_freq != 0) {
+        double freq = profile->si571_freq;
+        serr = smch_si57x_set_freq (SMIO_SI57X_HANDLER(fmcaclk), &freq);
+        ASSERT_TEST(serr == SMCH_SUCCESS, "Could not set SI571 frequency",
+                err_apply, -FMC_ACTIVE_CLK_ERR);
+    }
+
+    serr = smch_ad9510_cfg_apply (SMIO_AD9510_HANDLER(fmcaclk),
+            &fmcaclk->ad9510_progs [slot]);
+    ASSERT_TEST(serr == SMCH_SUCCESS, "Could not write AD9510 profile",
+            err_apply, -FMC_ACTIVE_CLK_ERR);
+
+    if (profile->wait_lock) {
+        err = _fmc_active_clk_wait_pll_lock (self);
+        ASSERT_TEST(err == -FMC_ACTIVE_CLK_OK, "AD9510 PLL did not lock",
+                err_apply);
+    }
+
+    fmcaclk->profile_sel = slot;
+
+err_apply:
+err_inv_slot:
+err_get_fmcaclk_handler:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp fmc_active_clk_exp_fp [] = {
     RW_PARAM_FUNC_NAME(fmc_active_clk, si571_oe),
@@ -338,6 +469,8 @@ const disp_table_func_fp fmc_active_clk_exp_fp [] = {
     FMC_ACTIVE_CLK_AD9510_FUNC_NAME(pll_clk_sel),
     FMC_ACTIVE_CLK_SI571_FUNC_NAME(freq),
     FMC_ACTIVE_CLK_SI571_FUNC_NAME(get_defaults),
+    _fmc_active_clk_profile,
+    _fmc_active_clk_profile_sel,
     NULL
 };
 
@@ -420,7 +553,7 @@ smio_err_e fmc_active_clk_init (smio_t * self)
     err = smio_set_ops (self, &fmc_active_clk_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
@@ -202,6 +202,30 @@ disp_op_t fmc_active_clk_si571_get_defaults_exp = {
     }
 };
 
+disp_op_t fmc_active_clk_profile_exp = {
+    .name = FMC_ACTIVE_CLK_NAME_PROFILE,
+    .opcode = FMC_ACTIVE_CLK_OPCODE_PROFILE,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_fmc_active_clk_profile_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t fmc_active_clk_profile_sel_exp = {
+    .name = FMC_ACTIVE_CLK_NAME_PROFILE_SEL,
+    .opcode = FMC_ACTIVE_CLK_OPCODE_PROFILE_SEL,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *fmc_active_clk_exp_ops [] = {
     &fmc_active_clk_si571_oe_exp,
@@ -220,6 +244,8 @@ const disp_op_t *fmc_active_clk_exp_ops [] = {
     &fmc_active_clk_ad9510_pll_clk_sel_exp,
     &fmc_active_clk_si571_freq_exp,
     &fmc_active_clk_si571_get_defaults_exp,
+    &fmc_active_clk_profile_exp,
+    &fmc_active_clk_profile_sel_exp,
     NULL
 };
 
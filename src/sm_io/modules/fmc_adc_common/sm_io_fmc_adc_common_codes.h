@@ -24,6 +24,19 @@
 #define FMC_ADC_COMMON_NAME_TRIG_VAL                        "fmc_adc_common_trig_val"
 #define FMC_ADC_COMMON_OPCODE_END                           5
 
+/* Raw data of the four ADC channels, as returned by the ADC_DATA_ALL
+ * operation of the FMC SMIOs. The four channels of each sample are read in
+ * the same register block access, and samples are read one after the other.
+ * Sample i of channel c is data[i][c], sign extended */
+#define FMC_ADC_DATA_NUM_CHAN                               4
+#define FMC_ADC_DATA_MAX_SAMPLES                            256
+
+struct _smio_fmc_adc_data_t {
+    uint32_t num_samples;           /* number of samples read */
+    uint32_t reserved;
+    int32_t data[FMC_ADC_DATA_MAX_SAMPLES][FMC_ADC_DATA_NUM_CHAN];
+};
+
 /* Messaging Reply OPCODES */
 #define FMC_ADC_COMMON_REPLY_TYPE                           uint32_t
 #define FMC_ADC_COMMON_REPLY_SIZE                           (sizeof (FMC_ADC_COMMON_REPLY_TYPE))
@@ -23,6 +23,25 @@ struct _smio_rffe_version_t {
     char data[RFFE_VERSION_SIZE];               /* data buffer */
 };
 
+/* Monitored RFFE variables, read all at once. They are also kept in a cache,
+ * refreshed every "cache_poll_time" ms (RFFE_OPCODE_SET_GET_CACHE_POLL_TIME).
+ * Reads of them are served from the cache while it is fresh. A poll time of
+ * 0 disables the cache */
+#define RFFE_CACHE_POLL_TIME_MAX                60000   /* in msec */
+
+struct _smio_rffe_monit_t {
+    double att1;                                /* Attenuator 1 */
+    double att2;                                /* Attenuator 2 */
+    double temp1;                               /* Temperature 1 */
+    double temp2;                               /* Temperature 2 */
+    double temp3;                               /* Temperature 3 */
+    double temp4;                               /* Temperature 4 */
+    double set_point1;                          /* Temperature set point 1 */
+    double set_point2;                          /* Temperature set point 2 */
+    uint64_t age;                               /* Time since the values were
+                                                   read from the RFFE, in ms */
+};
+
 /* Messaging OPCODES */
 #define RFFE_OPCODE_TYPE                        uint32_t
 #define RFFE_OPCODE_SIZE                        (sizeof (RFFE_OPCODE_TYPE))
@@ -61,7 +80,11 @@ struct _smio_rffe_version_t {
 #define RFFE_NAME_SET_GET_VERSION               "rffe_version"
 #define RFFE_OPCODE_SET_GET_SW_LVL              16
 #define RFFE_NAME_SET_GET_SW_LVL                "rffe_sw_lvl"
-#define RFFE_OPCODE_END                         17
+#define RFFE_OPCODE_GET_MONIT                   17
+#define RFFE_NAME_GET_MONIT                     "rffe_get_monit"
+#define RFFE_OPCODE_SET_GET_CACHE_POLL_TIME     18
+#define RFFE_NAME_SET_GET_CACHE_POLL_TIME       "rffe_set_get_cache_poll_time"
+#define RFFE_OPCODE_END                         19
 
 /* Messaging Reply OPCODES */
 #define RFFE_REPLY_TYPE                         uint32_t
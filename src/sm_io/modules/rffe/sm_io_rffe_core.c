@@ -32,6 +32,39 @@
     CHECK_HAL_ERR(err, SM_IO, "[sm_io_rffe_core]",                  \
             smio_err_str (err_type))
 
+/* Variables read by smio_rffe_read_monit (), in the smio_rffe_monit_t
+ * order. Keep them in ascending order, as BSMP groups are */
+static const uint32_t smio_rffe_monit_ids [] = {
+    SMCH_RFFE_ATT1_ID,
+    SMCH_RFFE_ATT2_ID,
+    SMCH_RFFE_TEMP1_ID,
+    SMCH_RFFE_TEMP2_ID,
+    SMCH_RFFE_TEMP3_ID,
+    SMCH_RFFE_TEMP4_ID,
+    SMCH_RFFE_SET_POINT1_ID,
+    SMCH_RFFE_SET_POINT2_ID
+};
+
+/* Where each one of the smio_rffe_monit_ids goes */
+static const size_t smio_rffe_monit_offs [] = {
+    offsetof (smio_rffe_monit_t, att1),
+    offsetof (smio_rffe_monit_t, att2),
+    offsetof (smio_rffe_monit_t, temp1),
+    offsetof (smio_rffe_monit_t, temp2),
+    offsetof (smio_rffe_monit_t, temp3),
+    offsetof (smio_rffe_monit_t, temp4),
+    offsetof (smio_rffe_monit_t, set_point1),
+    offsetof (smio_rffe_monit_t, set_point2)
+};
+
+#define SMIO_RFFE_MONIT_NUM_IDS     ARRAY_SIZE(smio_rffe_monit_ids)
+
+/* Cached values are still served if one refresh is missed, as when the
+ * link is busy with a client request */
+#define SMIO_RFFE_CACHE_MAX_AGE(poll_time)  (2 * (int64_t) (poll_time))
+
+static bool _smio_rffe_cache_fresh (smio_rffe_t *self);
+
 /* Creates a new instance of Device Information */
 smio_rffe_t * smio_rffe_new (smio_t *parent)
 {
@@ -43,6 +76,17 @@ smio_rffe_t * smio_rffe_new (smio_t *parent)
     self->ctl = smch_rffe_new (parent, 0);
     ASSERT_ALLOC(self->ctl, err_rffe_alloc);
 
+    /* Not every RFFE firmware supports groups. Without it, we still read
+     * monitored variables with a single round trip, pipelining them */
+    smch_err_e serr = smch_rffe_create_group (self->ctl, smio_rffe_monit_ids,
+            SMIO_RFFE_MONIT_NUM_IDS, &self->monit_group_id);
+    self->monit_group_valid = (serr == SMCH_SUCCESS);
+    if (!self->monit_group_valid) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_rffe_core] Could not "
+                "create BSMP group of the monitored variables. Reading them "
+                "one by one\n");
+    }
+
     return self;
 
 err_rffe_alloc:
@@ -67,3 +111,98 @@ smio_err_e smio_rffe_destroy (smio_rffe_t **self_p)
     return SMIO_SUCCESS;
 }
 
+smio_err_e smio_rffe_read_monit (smio_rffe_t *self, smio_rffe_monit_t *monit)
+{
+    assert (self);
+    assert (monit);
+
+    smio_err_e err = SMIO_SUCCESS;
+    uint8_t *data [SMIO_RFFE_MONIT_NUM_IDS];
+    size_t i;
+    for (i = 0; i < SMIO_RFFE_MONIT_NUM_IDS; ++i) {
+        data [i] = (uint8_t *) monit + smio_rffe_monit_offs [i];
+    }
+
+    smch_err_e serr = SMCH_ERR_RW_SMPR;
+    if (self->monit_group_valid) {
+        serr = smch_rffe_read_group (self->ctl, self->monit_group_id, data,
+                sizeof (double), SMIO_RFFE_MONIT_NUM_IDS);
+    }
+
+    /* The group could be gone if the RFFE was restarted */
+    if (serr != SMCH_SUCCESS) {
+        serr = smch_rffe_read_vars (self->ctl, smio_rffe_monit_ids, data,
+                sizeof (double), SMIO_RFFE_MONIT_NUM_IDS);
+    }
+    ASSERT_TEST(serr == SMCH_SUCCESS, "Could not read RFFE monitored variables",
+            err_read_monit, SMIO_ERR_LLIO);
+
+    monit->age = 0;
+
+err_read_monit:
+    return err;
+}
+
+smio_err_e smio_rffe_refresh_cache (smio_rffe_t *self)
+{
+    assert (self);
+
+    smio_err_e err = smio_rffe_read_monit (self, &self->cache);
+    self->cache_time = (err == SMIO_SUCCESS) ? zclock_mono () : 0;
+
+    return err;
+}
+
+smio_err_e smio_rffe_get_monit (smio_rffe_t *self, smio_rffe_monit_t *monit)
+{
+    assert (self);
+    assert (monit);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    if (!_smio_rffe_cache_fresh (self)) {
+        err = smio_rffe_refresh_cache (self);
+        ASSERT_TEST(err == SMIO_SUCCESS, "Could not refresh RFFE cache",
+                err_refresh_cache);
+    }
+
+    *monit = self->cache;
+    monit->age = zclock_mono () - self->cache_time;
+
+err_refresh_cache:
+    return err;
+}
+
+const double *smio_rffe_cache_lookup (smio_rffe_t *self, uint32_t id)
+{
+    assert (self);
+
+    if (!_smio_rffe_cache_fresh (self)) {
+        return NULL;
+    }
+
+    size_t i;
+    for (i = 0; i < SMIO_RFFE_MONIT_NUM_IDS; ++i) {
+        if (smio_rffe_monit_ids [i] == id) {
+            return (const double *) ((uint8_t *) &self->cache +
+                    smio_rffe_monit_offs [i]);
+        }
+    }
+
+    return NULL;
+}
+
+void smio_rffe_cache_invalidate (smio_rffe_t *self)
+{
+    assert (self);
+    self->cache_time = 0;
+}
+
+/***************************** Static Functions ******************************/
+
+static bool _smio_rffe_cache_fresh (smio_rffe_t *self)
+{
+    return self->cache_poll_time != 0 && self->cache_time != 0 &&
+        zclock_mono () - self->cache_time <=
+        SMIO_RFFE_CACHE_MAX_AGE(self->cache_poll_time);
+}
@@ -12,6 +12,15 @@
 
 typedef struct {
     smch_rffe_t *ctl;
+    bool monit_group_valid;             /* BSMP group of the monitored
+                                           variables was created */
+    uint32_t monit_group_id;            /* BSMP group of the monitored
+                                           variables */
+    uint32_t cache_poll_time;           /* Cache refresh period in ms. 0
+                                           disables the cache */
+    smio_rffe_monit_t cache;            /* Last monitored values read */
+    int64_t cache_time;                 /* zclock_mono () of the last cache
+                                           refresh. 0 if not valid */
 } smio_rffe_t;
 
 /***************** Our methods *****************/
@@ -20,5 +29,18 @@ typedef struct {
 smio_rffe_t * smio_rffe_new (smio_t *parent);
 /* Destroys the smio realization */
 smio_err_e smio_rffe_destroy (smio_rffe_t **self_p);
+/* Read all of the monitored RFFE variables in a single BSMP transaction */
+smio_err_e smio_rffe_read_monit (smio_rffe_t *self, smio_rffe_monit_t *monit);
+/* Read all of the monitored RFFE variables to the cache */
+smio_err_e smio_rffe_refresh_cache (smio_rffe_t *self);
+/* Get the monitored RFFE variables from the cache if it is fresh, or from
+ * the RFFE, refreshing the cache, otherwise */
+smio_err_e smio_rffe_get_monit (smio_rffe_t *self, smio_rffe_monit_t *monit);
+/* Get the cached value of RFFE variable "id". Returns NULL if the variable
+ * is not cached or the cache is not fresh */
+const double *smio_rffe_cache_lookup (smio_rffe_t *self, uint32_t id);
+/* Drop the cached values, so they are read from the RFFE until the next
+ * refresh */
+void smio_rffe_cache_invalidate (smio_rffe_t *self);
 
 #endif
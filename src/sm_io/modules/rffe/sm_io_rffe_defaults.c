@@ -66,6 +66,11 @@ smio_err_e rffe_config_defaults (char *broker_endp, char *service,
     ASSERT_TEST(client_err == BPM_CLIENT_SUCCESS, "Could not set RFFE attenuator 2 value",
             err_param_set, SMIO_ERR_CONFIG_DFLT);
 
+    client_err = bpm_set_rffe_cache_poll_time (config_client, service,
+            RFFE_DFLT_CACHE_POLL_TIME);
+    ASSERT_TEST(client_err == BPM_CLIENT_SUCCESS, "Could not set RFFE cache poll time",
+            err_param_set, SMIO_ERR_CONFIG_DFLT);
+
 err_param_set:
     bpm_client_destroy (&config_client);
 err_alloc_client:
@@ -11,6 +11,7 @@
 #define RFFE_DFLT_SW                                0x1             /* No switching, direct position */
 #define RFFE_DFLT_ATT1                              31.5            /* 31.1 dB attenuation */
 #define RFFE_DFLT_ATT2                              31.5            /* 31.1 dB attenuation */
+#define RFFE_DFLT_CACHE_POLL_TIME                   1000            /* Refresh cache every 1 s */
 
 smio_err_e rffe_config_defaults (char *broker_endp, char *service,
         const char *log_file_name);
@@ -76,6 +76,15 @@ static int _rffe_var_rw (void *owner, void *args, void *ret,
     smch_err_e serr = SMCH_SUCCESS;
     /* Call specific function */
     if (rw) {
+        /* Monitored variables are served from the cache while it is fresh,
+         * so clients don't wait on the RFFE link */
+        const double *cached = smio_rffe_cache_lookup (rffe, id);
+        if (cached != NULL && ret_size == sizeof (*cached)) {
+            memcpy (ret, cached, ret_size);
+            err = ret_size;
+            goto err_cached;
+        }
+
         serr = (read_func) (smch_rffe, id, (uint8_t *) ret, ret_size);
         if (serr != SMCH_SUCCESS) {
             err = -RFFE_ERR;
@@ -92,12 +101,15 @@ static int _rffe_var_rw (void *owner, void *args, void *ret,
         else {
             err = -RFFE_OK;
         }
+        /* Don't serve the old value until the next refresh */
+        smio_rffe_cache_invalidate (rffe);
     }
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE,
             "[sm_io:rffe_exp] Function %s %s\n",
             rffe_exp_ops [id]->name,
             (err == -RFFE_ERR)? error_msg : "successfully executed");
 
+err_cached:
 err_get_rffe_handler:
     return err;
 }
@@ -225,6 +237,71 @@ RFFE_FUNC_NAME_HEADER(sw_lvl)
             "Could not set/get RFFE switching level");
 }
 
+static int _rffe_get_monit (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -RFFE_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_rffe_t *rffe = smio_get_handler (self);
+    ASSERT_TEST(rffe != NULL, "Could not get SMIO RFFE handler",
+            err_get_rffe_handler, -RFFE_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:rffe_exp] Calling "
+            "_rffe_get_monit\n");
+
+    smio_err_e serr = smio_rffe_get_monit (rffe, (smio_rffe_monit_t *) ret);
+    ASSERT_TEST(serr == SMIO_SUCCESS, "Could not get RFFE monitored variables",
+            err_read_monit, -RFFE_ERR);
+
+    err = sizeof (smio_rffe_monit_t);
+
+err_read_monit:
+err_get_rffe_handler:
+    return err;
+}
+
+static int _rffe_cache_poll_time (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -RFFE_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_rffe_t *rffe = smio_get_handler (self);
+    ASSERT_TEST(rffe != NULL, "Could not get SMIO RFFE handler",
+            err_get_rffe_handler, -RFFE_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:rffe_exp] Calling "
+            "_rffe_cache_poll_time\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: cache poll time
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t cache_poll_time = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = rffe->cache_poll_time;
+        err = sizeof (rffe->cache_poll_time);
+    }
+    else {
+        ASSERT_TEST(cache_poll_time <= RFFE_CACHE_POLL_TIME_MAX,
+                "Cache poll time is out of range", err_inv_poll_time,
+                -RFFE_ERR);
+        rffe->cache_poll_time = cache_poll_time;
+        smio_rffe_cache_invalidate (rffe);
+        smio_set_poll_interval (self, cache_poll_time);
+    }
+
+err_inv_poll_time:
+err_get_rffe_handler:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp rffe_exp_fp [] = {
     RFFE_FUNC_NAME(sw),
@@ -244,6 +321,8 @@ const disp_table_func_fp rffe_exp_fp [] = {
     RFFE_FUNC_NAME(data),
     RFFE_FUNC_NAME(version),
     RFFE_FUNC_NAME(sw_lvl),
+    _rffe_get_monit,
+    _rffe_cache_poll_time,
     NULL
 };
 
@@ -296,12 +375,41 @@ smio_err_e rffe_do_op (void *self, void *msg)
     return _rffe_do_op (self, msg);
 }
 
+/* Periodic handler. Refreshes the cache of the monitored variables and
+ * updates the status page with them */
+smio_err_e rffe_poll (smio_t *self)
+{
+    smio_err_e err = SMIO_SUCCESS;
+    smio_rffe_t *rffe = smio_get_handler (self);
+    ASSERT_TEST(rffe != NULL, "Could not get RFFE handler",
+            err_rffe_handler, SMIO_ERR_ALLOC /* FIXME: improve return code */);
+
+    err = smio_rffe_refresh_cache (rffe);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not refresh RFFE cache",
+            err_refresh_cache);
+
+    smio_status_page_t *status = smio_get_status_page (self);
+    uint32_t inst_id = smio_get_inst_id (self);
+    if (status != NULL && inst_id < SMIO_STATUS_MAX_INST) {
+        smio_status_rffe_t *sect = &status->rffe [inst_id];
+        devio_status_write_begin (&sect->hdr);
+        sect->monit = rffe->cache;
+        sect->monit.age = 0;
+        devio_status_write_end (&sect->hdr);
+    }
+
+err_refresh_cache:
+err_rffe_handler:
+    return err;
+}
+
 const smio_ops_t rffe_ops = {
     .attach             = rffe_attach,          /* Attach sm_io instance to dev_io */
     .deattach           = rffe_deattach,        /* Deattach sm_io instance to dev_io */
     .export_ops         = rffe_export_ops,      /* Export sm_io operations to dev_io */
     .unexport_ops       = rffe_unexport_ops,    /* Unexport sm_io operations to dev_io */
-    .do_op              = rffe_do_op            /* Generic wrapper for handling specific operations */
+    .do_op              = rffe_do_op,           /* Generic wrapper for handling specific operations */
+    .poll               = rffe_poll             /* Refresh monitored variables cache */
 };
 
 /************************************************************/
@@ -323,7 +431,7 @@ smio_err_e rffe_init (smio_t * self)
     err = smio_set_ops (self, &rffe_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
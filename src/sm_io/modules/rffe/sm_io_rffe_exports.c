@@ -212,6 +212,28 @@ disp_op_t rffe_set_get_sw_lvl_exp = {
     }
 };
 
+disp_op_t rffe_get_monit_exp = {
+    .name = RFFE_NAME_GET_MONIT,
+    .opcode = RFFE_OPCODE_GET_MONIT,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_rffe_monit_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t rffe_set_get_cache_poll_time_exp = {
+    .name = RFFE_NAME_SET_GET_CACHE_POLL_TIME,
+    .opcode = RFFE_OPCODE_SET_GET_CACHE_POLL_TIME,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *rffe_exp_ops [] = {
     &rffe_set_get_sw_exp,
@@ -231,6 +253,8 @@ const disp_op_t *rffe_exp_ops [] = {
     &rffe_set_get_data_exp,
     &rffe_set_get_version_exp,
     &rffe_set_get_sw_lvl_exp,
+    &rffe_get_monit_exp,
+    &rffe_set_get_cache_poll_time_exp,
     NULL
 };
 
@@ -27,6 +27,8 @@ extern disp_op_t rffe_set_get_reprog_exp;
 extern disp_op_t rffe_set_get_data_exp;
 extern disp_op_t rffe_get_version_exp;
 extern disp_op_t rffe_set_get_sw_lvl_exp;
+extern disp_op_t rffe_get_monit_exp;
+extern disp_op_t rffe_set_get_cache_poll_time_exp;
 
 extern const disp_op_t *rffe_exp_ops [];
 
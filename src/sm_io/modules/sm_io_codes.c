@@ -5,8 +5,107 @@
  * Released according to the GNU GPL, version 3 or any later version.
  */
 
+#include "sm_io_exports_helper.h"
 #include "sm_io_codes.h"
 
+/* Description of the generic SMIO functions */
+
+disp_op_t smio_get_op_stats_exp = {
+    .name = SMIO_NAME_GET_OP_STATS,
+    .opcode = SMIO_OPCODE_GET_OP_STATS,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_op_stats_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t smio_set_get_rate_limit_exp = {
+    .name = SMIO_NAME_SET_GET_RATE_LIMIT,
+    .opcode = SMIO_OPCODE_SET_GET_RATE_LIMIT,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t smio_get_queue_stats_exp = {
+    .name = SMIO_NAME_GET_QUEUE_STATS,
+    .opcode = SMIO_OPCODE_GET_QUEUE_STATS,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_queue_stats_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t smio_batch_exp = {
+    .name = SMIO_NAME_BATCH,
+    .opcode = SMIO_OPCODE_BATCH,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_VAR, smio_batch_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_VAR, smio_batch_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t smio_get_startup_stats_exp = {
+    .name = SMIO_NAME_GET_STARTUP_STATS,
+    .opcode = SMIO_OPCODE_GET_STARTUP_STATS,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_startup_stats_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t smio_get_alloc_stats_exp = {
+    .name = SMIO_NAME_GET_ALLOC_STATS,
+    .opcode = SMIO_OPCODE_GET_ALLOC_STATS,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_alloc_stats_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t smio_ping_exp = {
+    .name = SMIO_NAME_PING,
+    .opcode = SMIO_OPCODE_PING,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_ping_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
+/* Exported function description */
+const disp_op_t *smio_generic_exp_ops [] = {
+    &smio_get_op_stats_exp,
+    &smio_set_get_rate_limit_exp,
+    &smio_get_queue_stats_exp,
+    &smio_batch_exp,
+    &smio_get_startup_stats_exp,
+    &smio_get_alloc_stats_exp,
+    &smio_ping_exp,
+    NULL
+};
+
 const disp_op_t **smio_exp_ops [] = {
     acq_exp_ops,
     dsp_exp_ops,
@@ -19,6 +118,73 @@ const disp_op_t **smio_exp_ops [] = {
     afc_diag_exp_ops,
     trigger_iface_exp_ops,
     trigger_mux_exp_ops,
+    smio_generic_exp_ops,
     NULL
 };
 
+/* Latency histogram helpers. These are shared by the server, which fills
+ * the histogram, and the clients, which interpret it */
+
+uint32_t smio_op_stats_bucket (uint64_t ns)
+{
+    if (ns < (1 << SMIO_OP_STATS_HIST_SUB_BITS)) {
+        return ns;
+    }
+
+    uint32_t msb = 63 - __builtin_clzll (ns);
+    uint32_t sub = (ns >> (msb - SMIO_OP_STATS_HIST_SUB_BITS)) &
+        ((1 << SMIO_OP_STATS_HIST_SUB_BITS) - 1);
+    uint64_t bucket = ((uint64_t) (msb - SMIO_OP_STATS_HIST_SUB_BITS + 1) <<
+            SMIO_OP_STATS_HIST_SUB_BITS) + sub;
+
+    return (bucket < SMIO_OP_STATS_HIST_BUCKETS) ?
+        bucket : SMIO_OP_STATS_HIST_BUCKETS - 1;
+}
+
+uint64_t smio_op_stats_bucket_value (uint32_t bucket)
+{
+    if (bucket < (1 << SMIO_OP_STATS_HIST_SUB_BITS)) {
+        return bucket;
+    }
+
+    uint32_t msb = (bucket >> SMIO_OP_STATS_HIST_SUB_BITS) +
+        SMIO_OP_STATS_HIST_SUB_BITS - 1;
+    uint64_t sub = bucket & ((1 << SMIO_OP_STATS_HIST_SUB_BITS) - 1);
+
+    return ((1ULL << SMIO_OP_STATS_HIST_SUB_BITS) + sub) <<
+        (msb - SMIO_OP_STATS_HIST_SUB_BITS);
+}
+
+uint64_t smio_op_stats_percentile (const smio_op_stats_t *stats, double pct)
+{
+    if (stats == NULL || stats->count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t) (pct / 100.0 * stats->count + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+
+    uint64_t acc = 0;
+    uint32_t i;
+    for (i = 0; i < SMIO_OP_STATS_HIST_BUCKETS; ++i) {
+        acc += stats->hist [i];
+        if (acc >= target) {
+            break;
+        }
+    }
+
+    /* The bucket only gives us a lower bound. Keep it inside the observed
+     * range */
+    uint64_t value = smio_op_stats_bucket_value (
+            (i < SMIO_OP_STATS_HIST_BUCKETS) ? i : SMIO_OP_STATS_HIST_BUCKETS - 1);
+    if (value < stats->min_ns) {
+        value = stats->min_ns;
+    }
+    if (value > stats->max_ns) {
+        value = stats->max_ns;
+    }
+
+    return value;
+}
@@ -14,12 +14,337 @@
 
 /* Forward smio_acq_data_block_t declaration structure */
 typedef struct _smio_acq_data_block_t smio_acq_data_block_t;
+/* Forward smio_acq_data_block_var_t declaration structure */
+typedef struct _smio_acq_data_block_var_t smio_acq_data_block_var_t;
+/* Forward smio_acq_event_t declaration structure */
+typedef struct _smio_acq_event_t smio_acq_event_t;
+/* Forward smio_acq_ring_data_t declaration structure */
+typedef struct _smio_acq_ring_data_t smio_acq_ring_data_t;
+/* Forward smio_acq_data_block_multi_t declaration structure */
+typedef struct _smio_acq_data_block_multi_t smio_acq_data_block_multi_t;
+/* Forward smio_acq_curve_info_t declaration structure */
+typedef struct _smio_acq_curve_info_t smio_acq_curve_info_t;
+/* Forward smio_acq_trig_log_t declaration structure */
+typedef struct _smio_acq_trig_log_t smio_acq_trig_log_t;
+/* Forward smio_acq_queue_info_t declaration structure */
+typedef struct _smio_acq_queue_info_t smio_acq_queue_info_t;
+/* Forward smio_acq_chan_desc_t declaration structure */
+typedef struct _smio_acq_chan_desc_t smio_acq_chan_desc_t;
+/* Forward smio_acq_chan_map_t declaration structure */
+typedef struct _smio_acq_chan_map_t smio_acq_chan_map_t;
+/* Forward smio_acq_shot_index_t declaration structure */
+typedef struct _smio_acq_shot_index_t smio_acq_shot_index_t;
+/* Forward smio_acq_data_block_coded_t declaration structure */
+typedef struct _smio_acq_data_block_coded_t smio_acq_data_block_coded_t;
+/* Forward smio_acq_data_block_crc_t declaration structure */
+typedef struct _smio_acq_data_block_crc_t smio_acq_data_block_crc_t;
+/* Forward smio_acq_atom_stats_t declaration structure */
+typedef struct _smio_acq_atom_stats_t smio_acq_atom_stats_t;
+/* Forward smio_acq_curve_stats_t declaration structure */
+typedef struct _smio_acq_curve_stats_t smio_acq_curve_stats_t;
+/* Forward smio_acq_env_bucket_t declaration structure */
+typedef struct _smio_acq_env_bucket_t smio_acq_env_bucket_t;
+/* Forward smio_acq_envelope_t declaration structure */
+typedef struct _smio_acq_envelope_t smio_acq_envelope_t;
+/* Forward smio_acq_partition_t declaration structure */
+typedef struct _smio_acq_partition_t smio_acq_partition_t;
+/* Forward smio_acq_pstream_hdr_t declaration structure */
+typedef struct _smio_acq_pstream_hdr_t smio_acq_pstream_hdr_t;
+/* Forward smio_acq_pm_info_t declaration structure */
+typedef struct _smio_acq_pm_info_t smio_acq_pm_info_t;
+/* Forward smio_acq_mcast_hdr_t declaration structure */
+typedef struct _smio_acq_mcast_hdr_t smio_acq_mcast_hdr_t;
+/* Forward smio_acq_trig_info_t declaration structure */
+typedef struct _smio_acq_trig_info_t smio_acq_trig_info_t;
+/* Forward smio_acq_shm_desc_t declaration structure */
+typedef struct _smio_acq_shm_desc_t smio_acq_shm_desc_t;
+/* Forward smio_acq_stream_hdr_t declaration structure */
+typedef struct _smio_acq_stream_hdr_t smio_acq_stream_hdr_t;
+/* Forward smio_acq_direct_endp_t declaration structure */
+typedef struct _smio_acq_direct_endp_t smio_acq_direct_endp_t;
+/* Forward smio_acq_direct_peer_t declaration structure */
+typedef struct _smio_acq_direct_peer_t smio_acq_direct_peer_t;
+/* Forward smio_dsp_monit_t declaration structure */
+typedef struct _smio_dsp_monit_t smio_dsp_monit_t;
+/* Forward smio_dsp_monit_hist_t declaration structure */
+typedef struct _smio_dsp_monit_hist_t smio_dsp_monit_hist_t;
+/* Forward smio_dsp_trig_cond_t declaration structure */
+typedef struct _smio_dsp_trig_cond_t smio_dsp_trig_cond_t;
+/* Forward smio_dsp_trig_t declaration structure */
+typedef struct _smio_dsp_trig_t smio_dsp_trig_t;
+/* Forward smio_dsp_monit_ds_t declaration structure */
+typedef struct _smio_dsp_monit_ds_t smio_dsp_monit_ds_t;
+/* Forward smio_dir_devio_t declaration structure */
+typedef struct _smio_dir_devio_t smio_dir_devio_t;
+/* Forward smio_dir_service_t declaration structure */
+typedef struct _smio_dir_service_t smio_dir_service_t;
+/* Forward smio_status_hdr_t declaration structure */
+typedef struct _smio_status_hdr_t smio_status_hdr_t;
+/* Forward smio_status_dsp_t declaration structure */
+typedef struct _smio_status_dsp_t smio_status_dsp_t;
+/* Forward smio_status_acq_t declaration structure */
+typedef struct _smio_status_acq_t smio_status_acq_t;
+/* Forward smio_status_rffe_t declaration structure */
+typedef struct _smio_status_rffe_t smio_status_rffe_t;
+/* Forward smio_status_page_t declaration structure */
+typedef struct _smio_status_page_t smio_status_page_t;
+/* Forward smio_trace_file_hdr_t declaration structure */
+typedef struct _smio_trace_file_hdr_t smio_trace_file_hdr_t;
+/* Forward smio_trace_rec_t declaration structure */
+typedef struct _smio_trace_rec_t smio_trace_rec_t;
 /* Forward smio_afc_diag_revision_data_t declaration structure */
 typedef struct _smio_afc_diag_revision_data_t smio_afc_diag_revision_data_t;
+/* Forward smio_afc_diag_identity_t declaration structure */
+typedef struct _smio_afc_diag_identity_t smio_afc_diag_identity_t;
 /* Forward smio_rffe_data_block_t declaration structure */
 typedef struct _smio_rffe_data_block_t smio_rffe_data_block_t;
 /* Forward smio_rffe_version_t declaration structure */
 typedef struct _smio_rffe_version_t smio_rffe_version_t;
+/* Forward smio_rffe_monit_t declaration structure */
+typedef struct _smio_rffe_monit_t smio_rffe_monit_t;
+/* Forward smio_fmc_adc_data_t declaration structure */
+typedef struct _smio_fmc_adc_data_t smio_fmc_adc_data_t;
+/* Forward smio_fmc130m_4ch_dly_cal_t declaration structure */
+typedef struct _smio_fmc130m_4ch_dly_cal_t smio_fmc130m_4ch_dly_cal_t;
+/* Forward smio_fmc_active_clk_profile_t declaration structure */
+typedef struct _smio_fmc_active_clk_profile_t smio_fmc_active_clk_profile_t;
+/* Forward smio_swap_profile_t declaration structure */
+typedef struct _smio_swap_profile_t smio_swap_profile_t;
+/* Forward smio_trigger_iface_table_t declaration structure */
+typedef struct _smio_trigger_iface_table_t smio_trigger_iface_table_t;
+/* Forward smio_trigger_iface_counters_t declaration structure */
+typedef struct _smio_trigger_iface_counters_t smio_trigger_iface_counters_t;
+/* Forward smio_trigger_iface_event_t declaration structure */
+typedef struct _smio_trigger_iface_event_t smio_trigger_iface_event_t;
+/* Forward smio_trigger_mux_table_t declaration structure */
+typedef struct _smio_trigger_mux_table_t smio_trigger_mux_table_t;
+/* Forward smio_op_stats_t declaration structure */
+typedef struct _smio_op_stats_t smio_op_stats_t;
+/* Forward smio_queue_stats_t declaration structure */
+typedef struct _smio_queue_stats_t smio_queue_stats_t;
+/* Forward smio_batch_t declaration structure */
+typedef struct _smio_batch_t smio_batch_t;
+/* Forward smio_startup_stats_t declaration structure */
+typedef struct _smio_startup_stats_t smio_startup_stats_t;
+/* Forward smio_alloc_stats_t declaration structure */
+typedef struct _smio_alloc_stats_t smio_alloc_stats_t;
+/* Forward smio_ping_t declaration structure */
+typedef struct _smio_ping_t smio_ping_t;
+
+/* Generic SMIO operations. These are exported by every SMIO, in addition
+ * to the module specific ones. Their opcodes are kept at the end of the
+ * valid opcode range (see MSG_OPCODE_MAX), so they never clash with the
+ * module opcodes */
+#define SMIO_OPCODE_GET_OP_STATS            199
+#define SMIO_NAME_GET_OP_STATS              "smio_get_op_stats"
+
+/* SMIO_OPCODE_GET_OP_STATS flags */
+#define SMIO_OP_STATS_FLAG_RESET            (1 << 0)    /* Reset the counters
+                                                           after reading them */
+
+/* Requests are served in turns, one from each sender with requests
+ * waiting, so a client flooding a service does not hold back the others.
+ * Each sender might also be limited to a number of requests per second
+ * (0 for no limit), kept as a token bucket holding one second worth of
+ * requests */
+#define SMIO_OPCODE_SET_GET_RATE_LIMIT      198
+#define SMIO_NAME_SET_GET_RATE_LIMIT        "smio_set_get_rate_limit"
+#define SMIO_OPCODE_GET_QUEUE_STATS         197
+#define SMIO_NAME_GET_QUEUE_STATS           "smio_get_queue_stats"
+
+/* SMIO_OPCODE_GET_QUEUE_STATS flags */
+#define SMIO_QUEUE_STATS_FLAG_RESET         (1 << 0)    /* Reset the counters
+                                                           after reading them */
+
+/* Request queue counters */
+struct _smio_queue_stats_t {
+    uint32_t rate_limit;                            /* Requests per second allowed
+                                                       to each sender. 0 if none */
+    uint32_t senders;                               /* Senders with requests waiting */
+    uint32_t depth;                                 /* Requests waiting */
+    uint32_t max_depth;                             /* Most requests ever waiting */
+    uint64_t served;                                /* Requests served */
+    uint64_t throttled;                             /* Requests delayed by the rate
+                                                       limit */
+    uint64_t rejected;                              /* Requests rejected, as their
+                                                       sender had too many waiting */
+    uint64_t coalesced;                             /* Writes superseded by a newer
+                                                       one before being served. See
+                                                       RW_REQ_COALESCE_SUBJECT */
+    uint64_t shared;                                /* Reads answered with the reply
+                                                       of an identical one. See
+                                                       RW_REQ_SHARED_SUBJECT */
+};
+
+/* Several operations of the SMIO, of any kind, sent as a single request.
+ * They are served in order, as if each one was received on its own, and
+ * the reply holds all of their replies. Arguments are the number of
+ * operations and the operations, each one as its size, as a uint32_t,
+ * followed by the RW_WIRE_PACKED_V1 encoding of its request (see
+ * RW_REQ_PACKED_V1_SUBJECT). The reply holds, for each operation, its reply
+ * code, its payload size and its payload, as a packed reply (see
+ * RW_REPLY_PACKED_SUBJECT). Operations whose reply does not fit are
+ * replied to with PARAM_ERR, as are the ones of a batch, which cannot be
+ * nested. Handlers cannot defer their replies inside a batch */
+#define SMIO_OPCODE_BATCH                   196
+#define SMIO_NAME_BATCH                     "smio_batch"
+
+#define SMIO_BATCH_MAX_OPS                  64
+#define SMIO_BATCH_MAX_SIZE                 8192
+
+/* Batch requests and replies */
+struct _smio_batch_t {
+    uint8_t data [SMIO_BATCH_MAX_SIZE];
+};
+
+/* Where the startup time of the SMIO went. Arguments are rw, which must be
+ * read, and a reserved uint32_t, which must be 0 */
+#define SMIO_OPCODE_GET_STARTUP_STATS       195
+#define SMIO_NAME_GET_STARTUP_STATS         "smio_get_startup_stats"
+
+/* Startup phases, in us. Phases the SMIO did not go through are 0 */
+struct _smio_startup_stats_t {
+    uint64_t spawn_us;                              /* DEVIO creation to the SMIO
+                                                       spawn */
+    uint64_t boot_us;                               /* Whole boot, i.e., the phases
+                                                       below up to dir_us */
+    uint64_t connect_us;                            /* SMIO creation, mostly the
+                                                       broker registration */
+    uint64_t init_us;                               /* Module init () */
+    uint64_t snapshot_us;                           /* Register snapshot load */
+    uint64_t export_us;                             /* Operation export */
+    uint64_t dir_us;                                /* Directory registration */
+    uint64_t config_us;                             /* Module config_defaults (),
+                                                       chip initialization included */
+    uint64_t up_us;                                 /* Spawn to the end of the
+                                                       configuration */
+};
+
+/* Allocations made by the SMIO, while receiving, serving and replying to
+ * requests and running its poll task, by subsystem (HUTILS_MEM_ACCT_*) and
+ * by opcode. They are only counted by DEVIOs built with ALLOC_ACCT=y.
+ * Arguments are rw, which must be read, and the SMIO_ALLOC_STATS_FLAG_*
+ * flags */
+#define SMIO_OPCODE_GET_ALLOC_STATS         194
+#define SMIO_NAME_GET_ALLOC_STATS           "smio_get_alloc_stats"
+
+/* SMIO_OPCODE_GET_ALLOC_STATS flags */
+#define SMIO_ALLOC_STATS_FLAG_RESET         (1 << 0)    /* Reset the counters
+                                                           after reading them */
+
+struct _smio_alloc_stats_t {
+    uint32_t enabled;                               /* Allocations are counted */
+    uint32_t reserved;
+    hutils_mem_acct_t acct;                         /* Counters. Bytes are the
+                                                       ones asked for */
+};
+
+/* Liveness of the SMIO, for health scans. It is served as soon as it is
+ * received, ahead of the requests waiting and of the rate limit, and never
+ * touches the hardware. It still waits for the request being served, if
+ * any. Arguments are rw, which must be read, and a reserved uint32_t,
+ * which must be 0 */
+#define SMIO_OPCODE_PING                    193
+#define SMIO_NAME_PING                      "smio_ping"
+
+struct _smio_ping_t {
+    uint64_t uptime_us;                             /* Since the SMIO was
+                                                       spawned */
+    uint64_t served;                                /* Requests served */
+    uint32_t depth;                                 /* Requests waiting */
+    uint32_t last_err_opcode;                       /* Opcode of the last
+                                                       failed request */
+    uint64_t errors;                                /* Failed requests */
+    uint64_t last_err_age_us;                       /* Since the last failed
+                                                       request. 0 if none */
+};
+
+/* Number of latency histogram buckets. Buckets are log-linear: values
+ * below 2^SMIO_OP_STATS_HIST_SUB_BITS nanoseconds have a bucket of their
+ * own and every power of 2 above that is split in 2^SMIO_OP_STATS_HIST_SUB_BITS
+ * buckets. The last bucket holds everything from ~7.5 s up */
+#define SMIO_OP_STATS_HIST_SUB_BITS         2
+#define SMIO_OP_STATS_HIST_BUCKETS          128
+
+/* Per-opcode counters and latency histogram */
+struct _smio_op_stats_t {
+    uint64_t count;                                 /* Number of requests */
+    uint64_t errors;                                /* Number of failed requests */
+    uint64_t total_ns;                              /* Sum of all latencies */
+    uint64_t min_ns;                                /* Minimum latency */
+    uint64_t max_ns;                                /* Maximum latency */
+    uint32_t hist [SMIO_OP_STATS_HIST_BUCKETS];     /* Latency histogram */
+};
+
+/* Get the histogram bucket of a latency, in nanoseconds */
+uint32_t smio_op_stats_bucket (uint64_t ns);
+/* Get the lowest latency, in nanoseconds, that falls into a bucket */
+uint64_t smio_op_stats_bucket_value (uint32_t bucket);
+/* Get an estimate of the latency percentile "pct" (0.0 - 100.0), in
+ * nanoseconds */
+uint64_t smio_op_stats_percentile (const smio_op_stats_t *stats, double pct);
+
+/* Every SMIO publishes its events on the malamute stream
+ * "<SMIO service name>:EVENTS". Events are told apart by their subject */
+#define SMIO_EVENT_STREAM_SUFFIX            "EVENTS"
+/* A SET operation changed a parameter of the SMIO. The event has one frame,
+ * with the opcode (uint32_t) of the operation */
+#define SMIO_EVENT_SUBJECT_PARAM_CHANGED    "PARAM_CHANGED"
+
+/* The dev_mngr keeps a directory of the DEVIOs it runs and of the services
+ * of their SMIOs, at the malamute mailbox SMIO_DIR_SERVICE of every broker
+ * shard. SMIOs register themselves once booted and unregister on halt, so
+ * lazy SMIOs are only listed once spawned.
+ *
+ * SMIO_DIR_SUBJECT_REGISTER is:
+ * frame 0: smio_dir_service_t
+ * frame 1: exported operation names, separated by spaces
+ * frame 2: service specific information, see smio_set_dir_info (). Might
+ *          be empty. The ACQ services send their smio_acq_chan_map_t
+ *
+ * SMIO_DIR_SUBJECT_UNREGISTER is:
+ * frame 0: service name
+ *
+ * SMIO_DIR_SUBJECT_LIST has no frames and is answered with the same subject
+ * and tracker by:
+ * frame 0: number of DEVIOs (uint32_t)
+ * frame 1 .. n: smio_dir_devio_t of each DEVIO
+ * frame n+1 ..: the 3 frames of SMIO_DIR_SUBJECT_REGISTER of each service */
+#define SMIO_DIR_SERVICE                    "DMNGR:DIRECTORY"
+#define SMIO_DIR_SUBJECT_REGISTER           "REGISTER"
+#define SMIO_DIR_SUBJECT_UNREGISTER         "UNREGISTER"
+#define SMIO_DIR_SUBJECT_LIST               "LIST"
+/* Registrations are dropped by the broker if not delivered by then, so
+ * DEVIOs run without a dev_mngr don't pile them up */
+#define SMIO_DIR_REGISTER_TTL               10000       /* in ms */
+#define SMIO_DIR_SERVICE_MAX_LEN            64
+#define SMIO_DIR_INFO_MAX_SIZE              4096
+
+/* State of a DEVIO in the directory */
+#define SMIO_DIR_DEVIO_READY_TO_RUN         0   /* Found, not spawned yet */
+#define SMIO_DIR_DEVIO_STARTING             1   /* Spawned, SMIOs coming up */
+#define SMIO_DIR_DEVIO_RUNNING              2   /* All of its SMIOs are up */
+#define SMIO_DIR_DEVIO_STOPPED              3   /* Stopped momentarily */
+#define SMIO_DIR_DEVIO_KILLED               4   /* Exited */
+
+struct _smio_dir_devio_t {
+    uint32_t board_id;                          /* Board ID */
+    uint32_t bpm_id;                            /* BPM ID */
+    uint32_t state;                             /* SMIO_DIR_DEVIO_* */
+    int32_t pid;                                /* PID of the DEVIO. 0 if
+                                                   not running */
+    uint32_t num_services;                      /* Services registered */
+    uint32_t reserved;
+};
+
+struct _smio_dir_service_t {
+    char service [SMIO_DIR_SERVICE_MAX_LEN];    /* Service name */
+    uint32_t smio_id;                           /* SMIO ID */
+    uint32_t inst_id;                           /* Instance ID */
+    int32_t pid;                                /* PID of the DEVIO running
+                                                   it */
+    uint32_t reserved;
+};
 
 /* Include all module's codes */
 #include "sm_io_fmc130m_4ch_codes.h"
@@ -33,6 +358,8 @@ typedef struct _smio_rffe_version_t smio_rffe_version_t;
 #include "sm_io_afc_diag_codes.h"
 #include "sm_io_trigger_iface_codes.h"
 #include "sm_io_trigger_mux_codes.h"
+#include "sm_io_status_codes.h"
+#include "sm_io_trace_codes.h"
 
 /* Include all function descriptors */
 #include "sm_io_fmc130m_4ch_exports.h"
@@ -47,6 +374,15 @@ typedef struct _smio_rffe_version_t smio_rffe_version_t;
 #include "sm_io_trigger_iface_exports.h"
 #include "sm_io_trigger_mux_exports.h"
 
+/* Generic function descriptors */
+extern disp_op_t smio_get_op_stats_exp;
+extern disp_op_t smio_set_get_rate_limit_exp;
+extern disp_op_t smio_get_queue_stats_exp;
+extern disp_op_t smio_batch_exp;
+extern disp_op_t smio_get_startup_stats_exp;
+
+extern const disp_op_t *smio_generic_exp_ops [];
+
 /* Merge all function descriptors in a single structure */
 extern const disp_op_t **smio_exp_ops [];
 
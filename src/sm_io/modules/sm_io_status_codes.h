@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SM_IO_STATUS_CODES_H_
+#define _SM_IO_STATUS_CODES_H_
+
+/* Status page of a DEVIO, for readers on the same host. The DEVIO maps it
+ * at "SMIO_STATUS_SHM_NAME_PREFIX<DEVIO name>" and its SMIOs update their
+ * own sections from their periodic handlers, so each section has a single
+ * writer.
+ *
+ * Sections are protected by a sequence lock: the writer makes "seq" odd
+ * before changing a section and even again afterwards, so readers copy the
+ * section and retry if "seq" was odd or changed meanwhile. Sections are on
+ * cache lines of their own, so writing one does not disturb readers of
+ * the others. Instance i of an SMIO is section i of its kind, up to
+ * SMIO_STATUS_MAX_INST */
+#define SMIO_STATUS_SHM_NAME_PREFIX         "/bpm_status:"
+#define SMIO_STATUS_SHM_NAME_MAX_LEN        256
+#define SMIO_STATUS_MAGIC                   0x53504d42      /* "BMPS" */
+#define SMIO_STATUS_VERSION                 1
+#define SMIO_STATUS_MAX_INST                4
+#define SMIO_STATUS_CACHE_LINE_SIZE         64
+
+struct _smio_status_hdr_t {
+    uint32_t seq;                   /* sequence lock. Odd while the section
+                                       is being written */
+    uint32_t reserved;
+    uint64_t timestamp;             /* last update time in ns since the
+                                       Epoch. 0 if never updated */
+};
+
+/* Last monitoring update published by the DSP SMIO, every "monit_poll_time"
+ * ms while the monitoring stream is enabled */
+struct _smio_status_dsp_t {
+    smio_status_hdr_t hdr;
+    smio_dsp_monit_t monit;
+} __attribute__ ((aligned (SMIO_STATUS_CACHE_LINE_SIZE)));
+
+/* State of the ACQ SMIO, updated as acquisitions start and complete */
+struct _smio_status_acq_t {
+    smio_status_hdr_t hdr;
+    uint32_t fsm_state;             /* ACQ core FSM state (STA register) */
+    uint32_t acq_pending;           /* an acquisition is in progress */
+    uint32_t curr_chan;             /* channel of the last acquisition started */
+    uint32_t last_seq;              /* sequence number of the last acquisition
+                                       completed */
+    uint64_t num_acqs;              /* acquisitions (triggers) completed so far */
+    uint64_t last_timestamp;        /* completion time of the last acquisition,
+                                       in ns since the Epoch */
+} __attribute__ ((aligned (SMIO_STATUS_CACHE_LINE_SIZE)));
+
+/* Monitored variables of the RFFE SMIO, every "cache_poll_time" ms while its
+ * cache is enabled. "monit.age" is always 0, see "hdr.timestamp" instead */
+struct _smio_status_rffe_t {
+    smio_status_hdr_t hdr;
+    smio_rffe_monit_t monit;
+} __attribute__ ((aligned (SMIO_STATUS_CACHE_LINE_SIZE)));
+
+struct _smio_status_page_t {
+    uint32_t magic;                 /* SMIO_STATUS_MAGIC */
+    uint32_t version;               /* SMIO_STATUS_VERSION */
+    uint32_t size;                  /* size of the page in bytes */
+    uint32_t max_inst;              /* SMIO_STATUS_MAX_INST */
+    uint64_t start_time;            /* DEVIO start time in ns since the Epoch */
+    smio_status_dsp_t dsp[SMIO_STATUS_MAX_INST];
+    smio_status_acq_t acq[SMIO_STATUS_MAX_INST];
+    smio_status_rffe_t rffe[SMIO_STATUS_MAX_INST];
+};
+
+#endif
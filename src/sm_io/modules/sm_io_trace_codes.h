@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#ifndef _SM_IO_TRACE_CODES_H_
+#define _SM_IO_TRACE_CODES_H_
+
+/* Request trace of an SMIO, written while it runs with a trace directory
+ * set (see devio_set_trace) and replayed by examples/rpc_replay. The file
+ * is a smio_trace_file_hdr_t followed by one record per request received,
+ * in arrival order. Each record is a smio_trace_rec_t followed by
+ * "size" bytes: the sender, the subject (neither NUL-terminated) and
+ * "num_frames" frames, each one as its uint32_t size and data. Everything
+ * is in the byte order of the host that wrote it */
+#define SMIO_TRACE_MAGIC                    0x54504d42      /* "BMPT" */
+#define SMIO_TRACE_VERSION                  1
+#define SMIO_TRACE_SERVICE_MAX_LEN          64
+#define SMIO_TRACE_FILE_SUFFIX              ".trace"
+/* Opcode of the requests that could not be parsed */
+#define SMIO_TRACE_NO_OPCODE                0xffffffff
+
+/* Request came through the local fast path. "sender" is the client
+ * identity, in hex */
+#define SMIO_TRACE_FLAG_LOCAL               (1 << 0)
+
+struct _smio_trace_file_hdr_t {
+    uint32_t magic;                 /* SMIO_TRACE_MAGIC */
+    uint32_t version;               /* SMIO_TRACE_VERSION */
+    uint64_t start_time;            /* trace start, in ns since the Epoch */
+    char service [SMIO_TRACE_SERVICE_MAX_LEN]; /* service traced, NUL-terminated */
+};
+
+struct _smio_trace_rec_t {
+    uint64_t timestamp;             /* arrival, in ns since the trace start */
+    uint32_t opcode;                /* SMIO_TRACE_NO_OPCODE if unknown */
+    uint32_t size;                  /* bytes following the record */
+    uint16_t sender_len;            /* sender bytes */
+    uint16_t subject_len;           /* subject bytes */
+    uint16_t num_frames;            /* request frames */
+    uint16_t flags;                 /* SMIO_TRACE_FLAG_* */
+};
+
+#endif
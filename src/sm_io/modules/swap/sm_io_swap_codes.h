@@ -10,6 +10,27 @@
 
 #include <inttypes.h>
 
+/* Switching and gain profiles. A profile holds the whole switching setup,
+ * applied at once. Up to SWAP_PROFILE_NUM of them can be stored in the SMIO
+ * and selected by slot number */
+#define SWAP_PROFILE_NUM                    8
+#define SWAP_PROFILE_NAME_MAX               32
+#define SWAP_PROFILE_NONE                   0xFFFFFFFF  /* No profile selected */
+
+struct _smio_swap_profile_t {
+    char name [SWAP_PROFILE_NAME_MAX];      /* NULL terminated */
+    uint32_t sw;                            /* Switching mode */
+    uint32_t sw_en;                         /* Switching clock enable */
+    uint32_t div_clk;                       /* Switching clock divisor */
+    uint32_t sw_dly;                        /* Deswitching delay */
+    uint32_t wdw_en;                        /* Windowing enable */
+    uint32_t wdw_dly;                       /* Windowing delay */
+    uint32_t gain_a;                        /* Gains, direct path in the lower */
+    uint32_t gain_b;                        /* 16 bits and inverted path in the */
+    uint32_t gain_c;                        /* upper 16 bits */
+    uint32_t gain_d;
+};
+
 /* Messaging OPCODES */
 #define SWAP_OPCODE_TYPE                    uint32_t
 #define SWAP_OPCODE_SIZE                    (sizeof (SWAP_OPCODE_TYPE))
@@ -34,7 +55,13 @@
 #define SWAP_NAME_SET_GET_GAIN_C            "swap_set_get_gain_c"
 #define SWAP_OPCODE_SET_GET_GAIN_D          10
 #define SWAP_NAME_SET_GET_GAIN_D            "swap_set_get_gain_d"
-#define SWAP_OPCODE_END                     11
+#define SWAP_OPCODE_SET_GET_PROFILE         11
+#define SWAP_NAME_SET_GET_PROFILE           "swap_set_get_profile"
+#define SWAP_OPCODE_SET_GET_PROFILE_SLOT    12
+#define SWAP_NAME_SET_GET_PROFILE_SLOT      "swap_set_get_profile_slot"
+#define SWAP_OPCODE_SET_GET_PROFILE_SEL     13
+#define SWAP_NAME_SET_GET_PROFILE_SEL       "swap_set_get_profile_sel"
+#define SWAP_OPCODE_END                     14
 
 #endif
 
@@ -41,6 +41,8 @@ smio_swap_t * smio_swap_new (smio_t *parent)
     smio_swap_t *self = (smio_swap_t *) zmalloc (sizeof *self);
     ASSERT_ALLOC(self, err_self_alloc);
 
+    self->profile_sel = SWAP_PROFILE_NONE;
+
     return self;
 
 err_self_alloc:
@@ -9,7 +9,10 @@
 #define _SM_IO_SWAP_CORE_H_
 
 typedef struct {
-    const uint32_t example;
+    smio_swap_profile_t profiles [SWAP_PROFILE_NUM];    /* Stored profiles */
+    bool profile_valid [SWAP_PROFILE_NUM];              /* Slot holds a profile */
+    uint32_t profile_sel;               /* Slot of the last selected profile
+                                           or SWAP_PROFILE_NONE */
 } smio_swap_t;
 
 /***************** Our methods *****************/
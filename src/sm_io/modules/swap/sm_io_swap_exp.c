@@ -53,21 +53,21 @@
 #define BPM_SWAP_CTRL_MODE_GLOBAL_W(val)        (BPM_SWAP_CTRL_MODE1_W(val) | BPM_SWAP_CTRL_MODE2_W(val))
 #define BPM_SWAP_CTRL_MODE_GLOBAL_R(val)        (BPM_SWAP_CTRL_MODE1_R(val) | BPM_SWAP_CTRL_MODE2_R(val))
 RW_PARAM_FUNC(swap, sw) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, CTRL, MODE_GLOBAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, CTRL, MODE_GLOBAL, MULT_BIT_PARAM,
             SW_MIN, SW_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define BPM_SW_EN_MIN                           0 /* Switching enabled */
 #define BPM_SW_EN_MAX                           1 /* Switching disabled */
 RW_PARAM_FUNC(swap, sw_en) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, CTRL, CLK_SWAP_EN, SINGLE_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, CTRL, CLK_SWAP_EN, SINGLE_BIT_PARAM,
             BPM_SW_EN_MIN, BPM_SW_EN_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define BPM_SWAP_DIV_F_MIN                      1
 #define BPM_SWAP_DIV_F_MAX                      ((1<<16)-1)
 RW_PARAM_FUNC(swap, div_clk) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, CTRL, SWAP_DIV_F, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, CTRL, SWAP_DIV_F, MULT_BIT_PARAM,
             BPM_SWAP_DIV_F_MIN, BPM_SWAP_DIV_F_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
@@ -79,7 +79,7 @@ RW_PARAM_FUNC(swap, div_clk) {
 #define BPM_SWAP_DLY_GLOBAL_W(val)              (BPM_SWAP_DLY_1_W(val) | BPM_SWAP_DLY_2_W(val))
 #define BPM_SWAP_DLY_GLOBAL_R(val)              (BPM_SWAP_DLY_1_R(val) | BPM_SWAP_DLY_2_R(val))
 RW_PARAM_FUNC(swap, sw_dly) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, DLY, GLOBAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, DLY, GLOBAL, MULT_BIT_PARAM,
             BPM_SWAP_SW_DLY_MIN, BPM_SWAP_SW_DLY_MAX, NO_CHK_FUNC, NO_FMT_FUNC,
             SET_FIELD);
 }
@@ -89,14 +89,14 @@ RW_PARAM_FUNC(swap, sw_dly) {
 
 #define BPM_SWAP_WDW_CTL_EN_GLOBAL              (BPM_SWAP_WDW_CTL_USE | BPM_SWAP_WDW_CTL_SWCLK_EXT)
 RW_PARAM_FUNC(swap, wdw_en) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, WDW_CTL, EN_GLOBAL, SINGLE_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, WDW_CTL, EN_GLOBAL, SINGLE_BIT_PARAM,
             BPM_SWAP_WDW_EN_MIN, BPM_SWAP_WDW_EN_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
 #define BPM_SWAP_WDW_DLY_MIN                    0
 #define BPM_SWAP_WDW_DLY_MAX                    ((1<<16)-1)
 RW_PARAM_FUNC(swap, wdw_dly) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, WDW_CTL, DLY, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, WDW_CTL, DLY, MULT_BIT_PARAM,
             BPM_SWAP_WDW_DLY_MIN, BPM_SWAP_WDW_DLY_MAX, NO_CHK_FUNC, NO_FMT_FUNC, SET_FIELD);
 }
 
@@ -132,7 +132,7 @@ rw_param_check_fp rw_bpm_swap_gain_chk_fp = _rw_bpm_swap_gain_chk;
 #define BPM_SWAP_A_GLOBAL_W(val)                (val)
 #define BPM_SWAP_A_GLOBAL_R(val)                (val)
 RW_PARAM_FUNC(swap, gain_a) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, A, GLOBAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, A, GLOBAL, MULT_BIT_PARAM,
             BPM_SWAP_GAIN_MIN, BPM_SWAP_GAIN_MAX, rw_bpm_swap_gain_chk_fp,
             NO_FMT_FUNC, SET_FIELD);
 }
@@ -141,7 +141,7 @@ RW_PARAM_FUNC(swap, gain_a) {
 #define BPM_SWAP_B_GLOBAL_W(val)                (val)
 #define BPM_SWAP_B_GLOBAL_R(val)                (val)
 RW_PARAM_FUNC(swap, gain_b) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, B, GLOBAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, B, GLOBAL, MULT_BIT_PARAM,
             BPM_SWAP_GAIN_MIN, BPM_SWAP_GAIN_MAX, rw_bpm_swap_gain_chk_fp,
             NO_FMT_FUNC, SET_FIELD);
 }
@@ -150,7 +150,7 @@ RW_PARAM_FUNC(swap, gain_b) {
 #define BPM_SWAP_C_GLOBAL_W(val)                (val)
 #define BPM_SWAP_C_GLOBAL_R(val)                (val)
 RW_PARAM_FUNC(swap, gain_c) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, C, GLOBAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, C, GLOBAL, MULT_BIT_PARAM,
             BPM_SWAP_GAIN_MIN, BPM_SWAP_GAIN_MAX, rw_bpm_swap_gain_chk_fp,
             NO_FMT_FUNC, SET_FIELD);
 }
@@ -159,11 +159,254 @@ RW_PARAM_FUNC(swap, gain_c) {
 #define BPM_SWAP_D_GLOBAL_W(val)                (val)
 #define BPM_SWAP_D_GLOBAL_R(val)                (val)
 RW_PARAM_FUNC(swap, gain_d) {
-    SET_GET_PARAM(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, D, GLOBAL, MULT_BIT_PARAM,
+    SET_GET_PARAM_CACHED(swap, DSP_BPM_SWAP_OFFS, BPM_SWAP, D, GLOBAL, MULT_BIT_PARAM,
             BPM_SWAP_GAIN_MIN, BPM_SWAP_GAIN_MAX, rw_bpm_swap_gain_chk_fp,
             NO_FMT_FUNC, SET_FIELD);
 }
 
+/* SWAP profile functions.
+ * A profile is applied with a single block write over all of the swap
+ * registers, so no other operation sees it half applied */
+
+/* Registers from CTRL up to WDW_CTL, written by the profiles */
+#define BPM_SWAP_PROFILE_REGS                   ((BPM_SWAP_REG_WDW_CTL - \
+            BPM_SWAP_REG_CTRL) / sizeof (uint32_t) + 1)
+#define BPM_SWAP_PROFILE_IDX(reg)               ((CONCAT_NAME3(BPM_SWAP, REG, reg) - \
+            BPM_SWAP_REG_CTRL) / sizeof (uint32_t))
+
+static int _swap_profile_chk (const smio_swap_profile_t *profile)
+{
+    if (profile->sw > SW_MAX ||
+            profile->sw_en > BPM_SW_EN_MAX ||
+            profile->div_clk < BPM_SWAP_DIV_F_MIN ||
+            profile->div_clk > BPM_SWAP_DIV_F_MAX ||
+            profile->sw_dly > BPM_SWAP_SW_DLY_MAX ||
+            profile->wdw_en > BPM_SWAP_WDW_EN_MAX ||
+            profile->wdw_dly > BPM_SWAP_WDW_DLY_MAX ||
+            _rw_bpm_swap_gain_chk (profile->gain_a) != PARAM_OK ||
+            _rw_bpm_swap_gain_chk (profile->gain_b) != PARAM_OK ||
+            _rw_bpm_swap_gain_chk (profile->gain_c) != PARAM_OK ||
+            _rw_bpm_swap_gain_chk (profile->gain_d) != PARAM_OK) {
+        return PARAM_ERR;
+    }
+
+    return PARAM_OK;
+}
+
+static int _swap_apply_profile (SMIO_OWNER_TYPE *self,
+        const smio_swap_profile_t *profile)
+{
+    int err = -RW_OK;
+    uint32_t regs [BPM_SWAP_PROFILE_REGS];
+
+    ASSERT_TEST(_swap_profile_chk (profile) == PARAM_OK, "SWAP profile is "
+            "out of range", err_inv_profile, -RW_OOR);
+
+    /* Keep the CTRL and WDW_CTL bits that are not part of a profile. These
+     * come from the register cache */
+    ssize_t ret = smio_thsafe_client_cached_read_32 (self, DSP_BPM_SWAP_OFFS |
+            BPM_SWAP_REG_CTRL, &regs [BPM_SWAP_PROFILE_IDX(CTRL)]);
+    ret += smio_thsafe_client_cached_read_32 (self, DSP_BPM_SWAP_OFFS |
+            BPM_SWAP_REG_WDW_CTL, &regs [BPM_SWAP_PROFILE_IDX(WDW_CTL)]);
+    ASSERT_TEST(ret == 2*sizeof (uint32_t), "Could not read SWAP registers",
+            err_read, -RW_READ_EAGAIN);
+
+    regs [BPM_SWAP_PROFILE_IDX(CTRL)] &= ~(BPM_SWAP_CTRL_MODE_GLOBAL_MASK |
+            BPM_SWAP_CTRL_CLK_SWAP_EN | BPM_SWAP_CTRL_SWAP_DIV_F_MASK);
+    regs [BPM_SWAP_PROFILE_IDX(CTRL)] |= BPM_SWAP_CTRL_MODE_GLOBAL_W(profile->sw) |
+        (profile->sw_en ? BPM_SWAP_CTRL_CLK_SWAP_EN : 0) |
+        BPM_SWAP_CTRL_SWAP_DIV_F_W(profile->div_clk);
+    regs [BPM_SWAP_PROFILE_IDX(DLY)] = BPM_SWAP_DLY_GLOBAL_W(profile->sw_dly);
+    regs [BPM_SWAP_PROFILE_IDX(A)] = profile->gain_a;
+    regs [BPM_SWAP_PROFILE_IDX(B)] = profile->gain_b;
+    regs [BPM_SWAP_PROFILE_IDX(C)] = profile->gain_c;
+    regs [BPM_SWAP_PROFILE_IDX(D)] = profile->gain_d;
+    regs [BPM_SWAP_PROFILE_IDX(WDW_CTL)] &= ~(BPM_SWAP_WDW_CTL_EN_GLOBAL |
+            BPM_SWAP_WDW_CTL_DLY_MASK);
+    regs [BPM_SWAP_PROFILE_IDX(WDW_CTL)] |=
+        (profile->wdw_en ? BPM_SWAP_WDW_CTL_EN_GLOBAL : 0) |
+        BPM_SWAP_WDW_CTL_DLY_W(profile->wdw_dly);
+
+    ret = smio_thsafe_client_cached_write_block (self, DSP_BPM_SWAP_OFFS |
+            BPM_SWAP_REG_CTRL, sizeof (regs), regs);
+    ASSERT_TEST(ret == sizeof (regs), "Could not write SWAP profile",
+            err_write, -RW_WRITE_EAGAIN);
+
+err_write:
+err_read:
+err_inv_profile:
+    return err;
+}
+
+static int _swap_read_profile (SMIO_OWNER_TYPE *self, smio_swap_profile_t *profile)
+{
+    int err = -RW_OK;
+    uint32_t regs [BPM_SWAP_PROFILE_REGS];
+    uint32_t i;
+
+    for (i = 0; i < BPM_SWAP_PROFILE_REGS; ++i) {
+        ssize_t ret = smio_thsafe_client_cached_read_32 (self, DSP_BPM_SWAP_OFFS |
+                (BPM_SWAP_REG_CTRL + i*sizeof (uint32_t)), &regs [i]);
+        ASSERT_TEST(ret == sizeof (uint32_t), "Could not read SWAP registers",
+                err_read, -RW_READ_EAGAIN);
+    }
+
+    uint32_t ctrl = regs [BPM_SWAP_PROFILE_IDX(CTRL)];
+    uint32_t wdw_ctl = regs [BPM_SWAP_PROFILE_IDX(WDW_CTL)];
+    profile->sw = BPM_SWAP_CTRL_MODE_GLOBAL_R(ctrl);
+    profile->sw_en = !!(ctrl & BPM_SWAP_CTRL_CLK_SWAP_EN);
+    profile->div_clk = BPM_SWAP_CTRL_SWAP_DIV_F_R(ctrl);
+    profile->sw_dly = BPM_SWAP_DLY_GLOBAL_R(regs [BPM_SWAP_PROFILE_IDX(DLY)]);
+    profile->wdw_en = !!(wdw_ctl & BPM_SWAP_WDW_CTL_EN_GLOBAL);
+    profile->wdw_dly = BPM_SWAP_WDW_CTL_DLY_R(wdw_ctl);
+    profile->gain_a = regs [BPM_SWAP_PROFILE_IDX(A)];
+    profile->gain_b = regs [BPM_SWAP_PROFILE_IDX(B)];
+    profile->gain_c = regs [BPM_SWAP_PROFILE_IDX(C)];
+    profile->gain_d = regs [BPM_SWAP_PROFILE_IDX(D)];
+
+err_read:
+    return err;
+}
+
+/* Apply a profile right away or read the current one */
+static int _swap_profile (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -RW_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_swap_t *swap = smio_get_handler (self);
+    ASSERT_TEST(swap != NULL, "Could not get SMIO SWAP handler",
+            err_get_swap_handler, -RW_USR_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:swap_exp] Calling "
+            "_swap_profile\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: profile
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    smio_swap_profile_t *profile = (smio_swap_profile_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        smio_swap_profile_t *rprofile = (smio_swap_profile_t *) ret;
+        memset (rprofile, 0, sizeof (*rprofile));
+        err = _swap_read_profile (self, rprofile);
+        ASSERT_TEST(err == -RW_OK, "Could not read SWAP profile", err_rw);
+
+        if (swap->profile_sel != SWAP_PROFILE_NONE) {
+            memcpy (rprofile->name, swap->profiles [swap->profile_sel].name,
+                    sizeof (rprofile->name));
+        }
+        err = sizeof (*rprofile);
+    }
+    else {
+        err = _swap_apply_profile (self, profile);
+        ASSERT_TEST(err == -RW_OK, "Could not apply SWAP profile", err_rw);
+        swap->profile_sel = SWAP_PROFILE_NONE;
+        smio_set_param_changed (self);
+    }
+
+err_rw:
+err_get_swap_handler:
+    return err;
+}
+
+/* Store a profile in a slot or read it back. Storing does not apply it */
+static int _swap_profile_slot (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -RW_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_swap_t *swap = smio_get_handler (self);
+    ASSERT_TEST(swap != NULL, "Could not get SMIO SWAP handler",
+            err_get_swap_handler, -RW_USR_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:swap_exp] Calling "
+            "_swap_profile_slot\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: slot
+     * frame 3: profile
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t slot = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    smio_swap_profile_t *profile = (smio_swap_profile_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    ASSERT_TEST(slot < SWAP_PROFILE_NUM, "SWAP profile slot is out of range",
+            err_inv_slot, -RW_OOR);
+
+    if (rw) {
+        ASSERT_TEST(swap->profile_valid [slot], "SWAP profile slot is empty",
+                err_empty_slot, -RW_USR_ERR);
+        memcpy (ret, &swap->profiles [slot], sizeof (swap->profiles [slot]));
+        err = sizeof (swap->profiles [slot]);
+    }
+    else {
+        ASSERT_TEST(_swap_profile_chk (profile) == PARAM_OK, "SWAP profile is "
+                "out of range", err_inv_profile, -RW_OOR);
+        swap->profiles [slot] = *profile;
+        swap->profiles [slot].name [SWAP_PROFILE_NAME_MAX-1] = '\0';
+        swap->profile_valid [slot] = true;
+        smio_set_param_changed (self);
+    }
+
+err_inv_profile:
+err_empty_slot:
+err_inv_slot:
+err_get_swap_handler:
+    return err;
+}
+
+/* Apply a stored profile or read which one was last selected */
+static int _swap_profile_sel (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -RW_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_swap_t *swap = smio_get_handler (self);
+    ASSERT_TEST(swap != NULL, "Could not get SMIO SWAP handler",
+            err_get_swap_handler, -RW_USR_ERR);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:swap_exp] Calling "
+            "_swap_profile_sel\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: slot
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t slot = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = swap->profile_sel;
+        err = sizeof (swap->profile_sel);
+    }
+    else {
+        ASSERT_TEST(slot < SWAP_PROFILE_NUM && swap->profile_valid [slot],
+                "SWAP profile slot is invalid", err_inv_slot, -RW_INV);
+        err = _swap_apply_profile (self, &swap->profiles [slot]);
+        ASSERT_TEST(err == -RW_OK, "Could not apply SWAP profile", err_rw);
+        swap->profile_sel = slot;
+        smio_set_param_changed (self);
+    }
+
+err_rw:
+err_inv_slot:
+err_get_swap_handler:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp swap_exp_fp [] = {
     RW_PARAM_FUNC_NAME(swap, sw),
@@ -176,6 +419,9 @@ const disp_table_func_fp swap_exp_fp [] = {
     RW_PARAM_FUNC_NAME(swap, gain_b),
     RW_PARAM_FUNC_NAME(swap, gain_c),
     RW_PARAM_FUNC_NAME(swap, gain_d),
+    _swap_profile,
+    _swap_profile_slot,
+    _swap_profile_sel,
     NULL
 };
 
@@ -257,10 +503,16 @@ smio_err_e swap_init (smio_t * self)
     err = smio_set_ops (self, &swap_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
+    /* All of the swap registers are configuration ones */
+    err = smio_add_cache_region (self, DSP_BPM_SWAP_OFFS | BPM_SWAP_REG_CTRL,
+            BPM_SWAP_REG_WDW_CTL - BPM_SWAP_REG_CTRL + sizeof (uint32_t));
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO cached registers",
+            err_add_cache_region);
+
     /* Fill the disp_op_t description structure with the callbacks. */
 
     /* disp_op_t structure is const and all of the functions performing on it
@@ -290,6 +542,7 @@ err_smio_handler_alloc:
     smio_set_exp_ops (self, NULL);
 err_smio_set_exp_ops:
 err_fill_desc:
+err_add_cache_region:
     smio_set_thsafe_client_ops (self, NULL);
 err_smio_set_thsafe_ops:
     smio_set_ops (self, NULL);
@@ -130,6 +130,43 @@ disp_op_t swap_set_get_gain_d_exp = {
     }
 };
 
+disp_op_t swap_set_get_profile_exp = {
+    .name = SWAP_NAME_SET_GET_PROFILE,
+    .opcode = SWAP_OPCODE_SET_GET_PROFILE,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_swap_profile_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_swap_profile_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t swap_set_get_profile_slot_exp = {
+    .name = SWAP_NAME_SET_GET_PROFILE_SLOT,
+    .opcode = SWAP_OPCODE_SET_GET_PROFILE_SLOT,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_swap_profile_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_swap_profile_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t swap_set_get_profile_sel_exp = {
+    .name = SWAP_NAME_SET_GET_PROFILE_SEL,
+    .opcode = SWAP_OPCODE_SET_GET_PROFILE_SEL,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *swap_exp_ops [] = {
     &swap_set_get_sw_exp,
@@ -142,5 +179,8 @@ const disp_op_t *swap_exp_ops [] = {
     &swap_set_get_gain_b_exp,
     &swap_set_get_gain_c_exp,
     &swap_set_get_gain_d_exp,
+    &swap_set_get_profile_exp,
+    &swap_set_get_profile_slot_exp,
+    &swap_set_get_profile_sel_exp,
     NULL
 };
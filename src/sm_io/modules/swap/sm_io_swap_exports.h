@@ -20,6 +20,9 @@ extern disp_op_t swap_set_get_gain_a_exp;
 extern disp_op_t swap_set_get_gain_b_exp;
 extern disp_op_t swap_set_get_gain_c_exp;
 extern disp_op_t swap_set_get_gain_d_exp;
+extern disp_op_t swap_set_get_profile_exp;
+extern disp_op_t swap_set_get_profile_slot_exp;
+extern disp_op_t swap_set_get_profile_sel_exp;
 
 extern const disp_op_t *swap_exp_ops [];
 
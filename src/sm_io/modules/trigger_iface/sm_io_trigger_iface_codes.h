@@ -8,6 +8,64 @@
 #ifndef _SM_IO_TRIGGER_IFACE_CODES_H_
 #define _SM_IO_TRIGGER_IFACE_CODES_H_
 
+/* This must match the FPGA maximum number of channels */
+#define TRIGGER_IFACE_NUM_CHAN                              24
+
+/* Configuration of a trigger channel */
+struct _smio_trigger_iface_chan_t {
+    uint32_t dir;                                   /* Direction */
+    uint32_t dir_pol;                               /* Direction polarity */
+    uint32_t rcv_count_rst;                         /* Receive counter reset */
+    uint32_t transm_count_rst;                      /* Transmit counter reset */
+    uint32_t rcv_len;                               /* Receiver debounce length */
+    uint32_t transm_len;                            /* Transmitter extension length */
+};
+
+/* Configuration of all of the trigger channels */
+struct _smio_trigger_iface_table_t {
+    struct _smio_trigger_iface_chan_t chan [TRIGGER_IFACE_NUM_CHAN];
+};
+
+/* Pulse counters of all of the trigger channels */
+struct _smio_trigger_iface_counters_t {
+    uint64_t timestamp;                             /* read time in ns since the
+                                                       Epoch, host clock */
+    uint32_t rcv [TRIGGER_IFACE_NUM_CHAN];          /* Receiver counters */
+    uint32_t transm [TRIGGER_IFACE_NUM_CHAN];       /* Transmitter counters */
+};
+
+/* Trigger events are published on the SMIO event stream
+ * "<TRIGGER_IFACE SMIO service name>:EVENTS". The TRIGGER_IFACE SMIO reads
+ * the pulse counters of all of the channels every "event_poll_time" ms
+ * (TRIGGER_IFACE_OPCODE_SET_GET_EVENT_POLL_TIME) and publishes one
+ * smio_trigger_iface_event_t for each channel whose counters changed, with
+ * subject TRIGGER_IFACE_EVENT_SUBJECT_PREFIX followed by the channel number
+ * (e.g., "TRIG_EVENT3"). Pulses are only known to have happened between
+ * "since" and "timestamp", so the poll time bounds the time resolution. The
+ * counters are 16-bit wide, so more than 65535 pulses in a poll time go
+ * unnoticed, and the pulse counts of the first event after a counter reset
+ * are not meaningful. A poll time of 0 disables the stream */
+#define TRIGGER_IFACE_EVENT_STREAM_SUFFIX                   SMIO_EVENT_STREAM_SUFFIX
+#define TRIGGER_IFACE_EVENT_SUBJECT_PREFIX                  "TRIG_EVENT"
+#define TRIGGER_IFACE_EVENT_SUBJECT_MAX_LEN                 16
+#define TRIGGER_IFACE_EVENT_POLL_TIME_MIN                   0       /* in msec */
+#define TRIGGER_IFACE_EVENT_POLL_TIME_MAX                   60000   /* in msec */
+
+/* Trigger event of a channel */
+struct _smio_trigger_iface_event_t {
+    uint64_t timestamp;                             /* read time in ns since the
+                                                       Epoch, host clock */
+    uint64_t since;                                 /* previous read time */
+    uint32_t chan;                                  /* Channel */
+    uint32_t rcv;                                   /* Receiver counter */
+    uint32_t transm;                                /* Transmitter counter */
+    uint32_t rcv_pulses;                            /* Pulses received since
+                                                       the previous read */
+    uint32_t transm_pulses;                         /* Pulses transmitted since
+                                                       the previous read */
+    uint32_t reserved;
+};
+
 /* Messaging OPCODES */
 #define TRIGGER_IFACE_OPCODE_TYPE                           uint32_t
 #define TRIGGER_IFACE_OPCODE_SIZE                           (sizeof (TRIGGER_IFACE_OPCODE_TYPE))
@@ -28,7 +86,13 @@
 #define TRIGGER_IFACE_NAME_COUNT_RCV                        "trigger_iface_count_rcv"
 #define TRIGGER_IFACE_OPCODE_COUNT_TRANSM                   7
 #define TRIGGER_IFACE_NAME_COUNT_TRANSM                     "trigger_iface_count_transm"
-#define TRIGGER_IFACE_OPCODE_END                            8
+#define TRIGGER_IFACE_OPCODE_TABLE                          8
+#define TRIGGER_IFACE_NAME_TABLE                            "trigger_iface_table"
+#define TRIGGER_IFACE_OPCODE_GET_COUNTERS                   9
+#define TRIGGER_IFACE_NAME_GET_COUNTERS                     "trigger_iface_get_counters"
+#define TRIGGER_IFACE_OPCODE_SET_GET_EVENT_POLL_TIME        10
+#define TRIGGER_IFACE_NAME_SET_GET_EVENT_POLL_TIME          "trigger_iface_set_get_event_poll_time"
+#define TRIGGER_IFACE_OPCODE_END                            11
 
 /* Messaging Reply OPCODES */
 #define TRIGGER_IFACE_REPLY_TYPE                            uint32_t
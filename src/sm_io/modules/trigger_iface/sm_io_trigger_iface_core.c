@@ -41,6 +41,10 @@ smio_trigger_iface_t * smio_trigger_iface_new (smio_t *parent)
     smio_trigger_iface_t *self = (smio_trigger_iface_t *) zmalloc (sizeof *self);
     ASSERT_ALLOC(self, err_self_alloc);
 
+    /* Trigger event stream is only enabled on request */
+    self->event_poll_time = 0;
+    self->event_last_valid = false;
+
     return self;
 
 err_self_alloc:
@@ -9,7 +9,12 @@
 #define _SM_IO_TRIGGER_IFACE_CORE_H_
 
 typedef struct {
-    const uint32_t example;
+    uint32_t event_poll_time;                       /* Trigger event stream period
+                                                       in ms. 0 if disabled */
+    bool event_last_valid;                          /* event_last holds a read
+                                                       of the counters */
+    smio_trigger_iface_counters_t event_last;       /* Counters read last by the
+                                                       poll handler */
 } smio_trigger_iface_t;
 
 /***************** Our methods *****************/
@@ -33,7 +33,7 @@
             smio_err_str (err_type))
 
 #define SMIO_TRIGGER_IFACE_LIBBPMCLIENT_LOG_MODE                "a"
-#define SMIO_TRIGGER_IFACE_MAX_CHAN                             24
+#define SMIO_TRIGGER_IFACE_MAX_CHAN                             TRIGGER_IFACE_NUM_CHAN
 
 /* We use the actual libclient to send and configure our default values,
  * maintaining internal consistency. So, in fact, we are sending ourselves
@@ -56,19 +56,27 @@ smio_err_e trigger_iface_config_defaults (char *broker_endp, char *service,
             log_file_name, SMIO_TRIGGER_IFACE_LIBBPMCLIENT_LOG_MODE);
     ASSERT_ALLOC(config_client, err_alloc_client);
 
+    smio_trigger_iface_table_t table;
     uint32_t chan;
     for (chan = 0; chan < SMIO_TRIGGER_IFACE_MAX_CHAN; ++chan) {
-        client_err = bpm_set_trigger_dir (config_client, service, chan, TRIGGER_IFACE_DFLT_DIR);
-        client_err |= bpm_set_trigger_dir_pol (config_client, service, chan, TRIGGER_IFACE_DFLT_DIR_POL);
-        client_err |= bpm_set_trigger_rcv_count_rst (config_client, service, chan, TRIGGER_IFACE_DFLT_RCV_RST);
-        client_err |= bpm_set_trigger_transm_count_rst (config_client, service, chan, TRIGGER_IFACE_DFLT_TRANSM_RST);
-        client_err |= bpm_set_trigger_rcv_len (config_client, service, chan, TRIGGER_IFACE_DFLT_RCV_LEN);
-        client_err |= bpm_set_trigger_transm_len (config_client, service, chan, TRIGGER_IFACE_DFLT_TRANSM_LEN);
+        table.chan [chan].dir = TRIGGER_IFACE_DFLT_DIR;
+        table.chan [chan].dir_pol = TRIGGER_IFACE_DFLT_DIR_POL;
+        table.chan [chan].rcv_count_rst = TRIGGER_IFACE_DFLT_RCV_RST;
+        table.chan [chan].transm_count_rst = TRIGGER_IFACE_DFLT_TRANSM_RST;
+        table.chan [chan].rcv_len = TRIGGER_IFACE_DFLT_RCV_LEN;
+        table.chan [chan].transm_len = TRIGGER_IFACE_DFLT_TRANSM_LEN;
     }
 
+    client_err = bpm_set_trigger_iface_table (config_client, service, &table);
+
     ASSERT_TEST(client_err == BPM_CLIENT_SUCCESS, "Could set trigger defaults",
             err_param_set, SMIO_ERR_CONFIG_DFLT);
 
+    client_err = bpm_set_trigger_event_poll_time (config_client, service,
+            TRIGGER_IFACE_DFLT_EVENT_POLL_TIME);
+    ASSERT_TEST(client_err == BPM_CLIENT_SUCCESS, "Could not set trigger event "
+            "poll time", err_param_set, SMIO_ERR_CONFIG_DFLT);
+
 err_param_set:
     bpm_client_destroy (&config_client);
 err_alloc_client:
@@ -16,6 +16,7 @@
 #define TRIGGER_IFACE_DFLT_TRANSM_RST               1      /* Pulse Reset */
 #define TRIGGER_IFACE_DFLT_RCV_LEN                  1      /* Debounce Length */
 #define TRIGGER_IFACE_DFLT_TRANSM_LEN               1      /* Pulse Extension Length */
+#define TRIGGER_IFACE_DFLT_EVENT_POLL_TIME          10     /* ms, trigger event stream */
 
 smio_err_e trigger_iface_config_defaults (char *broker_endp, char *service,
         const char *log_file_name);
@@ -37,9 +37,11 @@
     CHECK_HAL_ERR(err, SM_IO, "[sm_io:trigger_iface_exp]",                      \
             smio_err_str (err_type))
 
-/* This must match the FPGA maximum number of channels */
-#define TRIGGER_IFACE_NUM_CHAN                          24
 #define TRIGGER_IFACE_CHAN_OFFSET                       0x00c /* 3 32-bit registers */
+#define TRIGGER_IFACE_CHAN_REGS                         (TRIGGER_IFACE_CHAN_OFFSET / sizeof (uint32_t))
+#define TRIGGER_IFACE_CTL_IDX                           (WB_TRIG_IFACE_REG_CH0_CTL / sizeof (uint32_t))
+#define TRIGGER_IFACE_CFG_IDX                           (WB_TRIG_IFACE_REG_CH0_CFG / sizeof (uint32_t))
+#define TRIGGER_IFACE_COUNT_IDX                         (WB_TRIG_IFACE_REG_CH0_COUNT / sizeof (uint32_t))
 
 /*****************************************************************/
 /************ Specific TRIGGER INTERFACE Operations **************/
@@ -113,6 +115,176 @@ RW_PARAM_FUNC(trigger_iface, count_transm) {
             NO_FMT_FUNC, SET_FIELD);
 }
 
+/* Write or read the configuration of all of the channels at once, with a
+ * single block access over the channel registers */
+static int _trigger_iface_table (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -TRIGGER_IFACE_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:trigger_iface_exp] Calling "
+            "_trigger_iface_table\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: channels table
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    smio_trigger_iface_table_t *table = (smio_trigger_iface_table_t *)
+        EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    uint32_t regs [TRIGGER_IFACE_NUM_CHAN * TRIGGER_IFACE_CHAN_REGS];
+    uint32_t chan;
+    ssize_t rw_size;
+
+    if (rw) {
+        rw_size = smio_thsafe_client_read_block (self, WB_TRIGGER_IFACE_RAW_REG_OFFS,
+                sizeof (regs), regs);
+        ASSERT_TEST(rw_size == sizeof (regs), "Could not read trigger channels",
+                err_rw, -TRIGGER_IFACE_ERR);
+
+        smio_trigger_iface_table_t *rtable = (smio_trigger_iface_table_t *) ret;
+        for (chan = 0; chan < TRIGGER_IFACE_NUM_CHAN; ++chan) {
+            uint32_t ctl = regs [chan*TRIGGER_IFACE_CHAN_REGS + TRIGGER_IFACE_CTL_IDX];
+            uint32_t cfg = regs [chan*TRIGGER_IFACE_CHAN_REGS + TRIGGER_IFACE_CFG_IDX];
+            rtable->chan [chan].dir = !!(ctl & WB_TRIG_IFACE_CH0_CTL_DIR);
+            rtable->chan [chan].dir_pol = !!(ctl & WB_TRIG_IFACE_CH0_CTL_DIR_POL);
+            rtable->chan [chan].rcv_count_rst = !!(ctl & WB_TRIG_IFACE_CH0_CTL_RCV_COUNT_RST);
+            rtable->chan [chan].transm_count_rst = !!(ctl & WB_TRIG_IFACE_CH0_CTL_TRANSM_COUNT_RST);
+            rtable->chan [chan].rcv_len = WB_TRIG_IFACE_CH0_CFG_RCV_LEN_R(cfg);
+            rtable->chan [chan].transm_len = WB_TRIG_IFACE_CH0_CFG_TRANSM_LEN_R(cfg);
+        }
+
+        err = sizeof (*rtable);
+    }
+    else {
+        /* The counter registers are read-only, so writing them along with
+         * the others does no harm and keeps it a single block */
+        memset (regs, 0, sizeof (regs));
+        for (chan = 0; chan < TRIGGER_IFACE_NUM_CHAN; ++chan) {
+            const struct _smio_trigger_iface_chan_t *cfg = &table->chan [chan];
+            ASSERT_TEST(cfg->dir <= BPM_TRIGGER_IFACE_DIR_MAX &&
+                    cfg->dir_pol <= BPM_TRIGGER_IFACE_DIR_POL_MAX &&
+                    cfg->rcv_count_rst <= BPM_TRIGGER_IFACE_RCV_COUNT_RST_MAX &&
+                    cfg->transm_count_rst <= BPM_TRIGGER_IFACE_TRANSM_COUNT_RST_MAX &&
+                    cfg->rcv_len <= BPM_TRIGGER_IFACE_RCV_LEN_MAX &&
+                    cfg->transm_len <= BPM_TRIGGER_IFACE_TRANSM_LEN_MAX,
+                    "Trigger channel configuration is out of range",
+                    err_rw, -TRIGGER_IFACE_ERR);
+
+            regs [chan*TRIGGER_IFACE_CHAN_REGS + TRIGGER_IFACE_CTL_IDX] =
+                (cfg->dir ? WB_TRIG_IFACE_CH0_CTL_DIR : 0) |
+                (cfg->dir_pol ? WB_TRIG_IFACE_CH0_CTL_DIR_POL : 0) |
+                (cfg->rcv_count_rst ? WB_TRIG_IFACE_CH0_CTL_RCV_COUNT_RST : 0) |
+                (cfg->transm_count_rst ? WB_TRIG_IFACE_CH0_CTL_TRANSM_COUNT_RST : 0);
+            regs [chan*TRIGGER_IFACE_CHAN_REGS + TRIGGER_IFACE_CFG_IDX] =
+                WB_TRIG_IFACE_CH0_CFG_RCV_LEN_W(cfg->rcv_len) |
+                WB_TRIG_IFACE_CH0_CFG_TRANSM_LEN_W(cfg->transm_len);
+        }
+
+        rw_size = smio_thsafe_client_write_block (self, WB_TRIGGER_IFACE_RAW_REG_OFFS,
+                sizeof (regs), regs);
+        ASSERT_TEST(rw_size == sizeof (regs), "Could not write trigger channels",
+                err_rw, -TRIGGER_IFACE_ERR);
+        smio_set_param_changed (self);
+    }
+
+err_rw:
+    return err;
+}
+
+/* Read the pulse counters of all of the channels at once. The counter
+ * registers are strided with the others, so the whole channel map is read
+ * in a single block */
+static int _trigger_iface_read_counters (smio_t *self,
+        smio_trigger_iface_counters_t *counters)
+{
+    int err = -TRIGGER_IFACE_OK;
+    uint32_t regs [TRIGGER_IFACE_NUM_CHAN * TRIGGER_IFACE_CHAN_REGS];
+    ssize_t rsize = smio_thsafe_client_read_block (self, WB_TRIGGER_IFACE_RAW_REG_OFFS,
+            sizeof (regs), regs);
+    ASSERT_TEST(rsize == sizeof (regs), "Could not read trigger counters",
+            err_read, -TRIGGER_IFACE_ERR);
+
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+
+    uint32_t chan;
+    for (chan = 0; chan < TRIGGER_IFACE_NUM_CHAN; ++chan) {
+        uint32_t count = regs [chan*TRIGGER_IFACE_CHAN_REGS + TRIGGER_IFACE_COUNT_IDX];
+        counters->rcv [chan] = WB_TRIG_IFACE_CH0_COUNT_RCV_R(count);
+        counters->transm [chan] = WB_TRIG_IFACE_CH0_COUNT_TRANSM_R(count);
+    }
+    counters->timestamp = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+err_read:
+    return err;
+}
+
+static int _trigger_iface_get_counters (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_trigger_iface_counters_t *counters = (smio_trigger_iface_counters_t *) ret;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:trigger_iface_exp] Calling "
+            "_trigger_iface_get_counters\n");
+
+    int err = _trigger_iface_read_counters (self, counters);
+    if (err == -TRIGGER_IFACE_OK) {
+        err = sizeof (*counters);
+    }
+
+    return err;
+}
+
+static int _trigger_iface_event_poll_time (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    int err = -TRIGGER_IFACE_OK;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:trigger_iface_exp] Calling "
+            "_trigger_iface_event_poll_time\n");
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    smio_trigger_iface_t *trig_iface = smio_get_handler (self);
+    ASSERT_TEST(trig_iface != NULL, "Could not get SMIO TRIGGER_IFACE handler",
+            err_get_trig_iface_handler, -TRIGGER_IFACE_ERR);
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: trigger event poll time
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t event_poll_time = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *((uint32_t *) ret) = trig_iface->event_poll_time;
+        err = sizeof (trig_iface->event_poll_time);
+    }
+    else {
+        ASSERT_TEST(event_poll_time <= TRIGGER_IFACE_EVENT_POLL_TIME_MAX,
+                "Trigger event poll time is out of range", err_inv_poll_time,
+                -TRIGGER_IFACE_ERR);
+        trig_iface->event_poll_time = event_poll_time;
+        /* Pulses counted while the stream was disabled are not events */
+        trig_iface->event_last_valid = false;
+        smio_set_poll_interval (self, event_poll_time);
+        smio_set_param_changed (self);
+    }
+
+err_inv_poll_time:
+err_get_trig_iface_handler:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp trigger_iface_exp_fp [] = {
     RW_PARAM_FUNC_NAME(trigger_iface, dir),
@@ -123,6 +295,9 @@ const disp_table_func_fp trigger_iface_exp_fp [] = {
     RW_PARAM_FUNC_NAME(trigger_iface, transm_len),
     RW_PARAM_FUNC_NAME(trigger_iface, count_rcv),
     RW_PARAM_FUNC_NAME(trigger_iface, count_transm),
+    _trigger_iface_table,
+    _trigger_iface_get_counters,
+    _trigger_iface_event_poll_time,
     NULL
 };
 
@@ -178,12 +353,95 @@ smio_err_e trigger_iface_do_op (void *self, void *msg)
     return _trigger_iface_do_op (self, msg);
 }
 
+/* Publish the trigger event "event" on the trigger event stream */
+static smio_err_e _trigger_iface_event_publish (smio_t *self,
+        const smio_trigger_iface_event_t *event)
+{
+    smio_err_e err = SMIO_SUCCESS;
+
+    char subject [TRIGGER_IFACE_EVENT_SUBJECT_MAX_LEN];
+    snprintf (subject, sizeof (subject), TRIGGER_IFACE_EVENT_SUBJECT_PREFIX "%u",
+            event->chan);
+
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, SMIO_ERR_ALLOC);
+    int rc = zmsg_addmem (msg, event, sizeof (*event));
+    ASSERT_TEST(rc == 0, "Could not add trigger event to message",
+            err_msg_addmem, SMIO_ERR_ALLOC);
+
+    rc = mlm_client_send (smio_get_worker (self), subject, &msg);
+    ASSERT_TEST(rc == 0, "Could not publish trigger event", err_msg_send,
+            SMIO_ERR_BAD_MSG);
+
+err_msg_send:
+err_msg_addmem:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    return err;
+}
+
+/* Periodic handler. Reads the pulse counters of all of the channels in a
+ * single block and publishes a trigger event for each channel whose
+ * counters changed since the previous read. There are no trigger
+ * interrupts, so this is what watches the counters on behalf of the
+ * clients */
+smio_err_e trigger_iface_poll (smio_t *self)
+{
+    smio_err_e err = SMIO_SUCCESS;
+    smio_trigger_iface_t *trig_iface = smio_get_handler (self);
+    ASSERT_TEST(trig_iface != NULL, "Could not get trig_iface handler",
+            err_trig_iface_handler, SMIO_ERR_ALLOC /* FIXME: improve return code */);
+
+    smio_trigger_iface_counters_t counters;
+    int rerr = _trigger_iface_read_counters (self, &counters);
+    ASSERT_TEST(rerr == -TRIGGER_IFACE_OK, "Could not read trigger counters",
+            err_read_counters, SMIO_ERR_LLIO);
+
+    /* The first read after enabling the stream is only a reference */
+    if (trig_iface->event_last_valid) {
+        const smio_trigger_iface_counters_t *last = &trig_iface->event_last;
+        uint32_t chan;
+        for (chan = 0; chan < TRIGGER_IFACE_NUM_CHAN; ++chan) {
+            if (counters.rcv [chan] == last->rcv [chan] &&
+                    counters.transm [chan] == last->transm [chan]) {
+                continue;
+            }
+
+            /* Counters are 16-bit wide and wrap around */
+            smio_trigger_iface_event_t event = {
+                .timestamp = counters.timestamp,
+                .since = last->timestamp,
+                .chan = chan,
+                .rcv = counters.rcv [chan],
+                .transm = counters.transm [chan],
+                .rcv_pulses = (counters.rcv [chan] - last->rcv [chan]) & 0xffff,
+                .transm_pulses = (counters.transm [chan] - last->transm [chan]) & 0xffff,
+                .reserved = 0
+            };
+
+            err = _trigger_iface_event_publish (self, &event);
+            ASSERT_TEST(err == SMIO_SUCCESS, "Could not publish trigger event",
+                    err_publish);
+        }
+    }
+
+err_publish:
+    /* Events that could not be published are dropped, instead of being
+     * sent again on the next read */
+    trig_iface->event_last = counters;
+    trig_iface->event_last_valid = true;
+err_read_counters:
+err_trig_iface_handler:
+    return err;
+}
+
 const smio_ops_t trigger_iface_ops = {
     .attach             = trigger_iface_attach,          /* Attach sm_io instance to dev_io */
     .deattach           = trigger_iface_deattach,        /* Deattach sm_io instance to dev_io */
     .export_ops         = trigger_iface_export_ops,      /* Export sm_io operations to dev_io */
     .unexport_ops       = trigger_iface_unexport_ops,    /* Unexport sm_io operations to dev_io */
-    .do_op              = trigger_iface_do_op            /* Generic wrapper for handling specific operations */
+    .do_op              = trigger_iface_do_op,           /* Generic wrapper for handling specific operations */
+    .poll               = trigger_iface_poll             /* Publish trigger events */
 };
 
 /************************************************************/
@@ -205,7 +463,7 @@ smio_err_e trigger_iface_init (smio_t * self)
     err = smio_set_ops (self, &trigger_iface_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
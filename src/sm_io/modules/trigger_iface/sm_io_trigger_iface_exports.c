@@ -114,6 +114,40 @@ disp_op_t trigger_iface_count_transm_exp = {
     }
 };
 
+disp_op_t trigger_iface_table_exp = {
+    .name = TRIGGER_IFACE_NAME_TABLE,
+    .opcode = TRIGGER_IFACE_OPCODE_TABLE,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_trigger_iface_table_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_trigger_iface_table_t),
+        DISP_ARG_END
+    }
+};
+
+disp_op_t trigger_iface_get_counters_exp = {
+    .name = TRIGGER_IFACE_NAME_GET_COUNTERS,
+    .opcode = TRIGGER_IFACE_OPCODE_GET_COUNTERS,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_trigger_iface_counters_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_END
+    }
+};
+
+disp_op_t trigger_iface_set_get_event_poll_time_exp = {
+    .name = TRIGGER_IFACE_NAME_SET_GET_EVENT_POLL_TIME,
+    .opcode = TRIGGER_IFACE_OPCODE_SET_GET_EVENT_POLL_TIME,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *trigger_iface_exp_ops [] = {
     &trigger_iface_dir_exp,
@@ -124,6 +158,9 @@ const disp_op_t *trigger_iface_exp_ops [] = {
     &trigger_iface_transm_len_exp,
     &trigger_iface_count_rcv_exp,
     &trigger_iface_count_transm_exp,
+    &trigger_iface_table_exp,
+    &trigger_iface_get_counters_exp,
+    &trigger_iface_set_get_event_poll_time_exp,
     NULL
 };
 
@@ -18,6 +18,9 @@ extern disp_op_t trigger_iface_rcv_len_exp;
 extern disp_op_t trigger_iface_transm_len_exp;
 extern disp_op_t trigger_iface_count_rcv_exp;
 extern disp_op_t trigger_iface_count_transm_exp;
+extern disp_op_t trigger_iface_table_exp;
+extern disp_op_t trigger_iface_get_counters_exp;
+extern disp_op_t trigger_iface_set_get_event_poll_time_exp;
 
 extern const disp_op_t *trigger_iface_exp_ops [];
 
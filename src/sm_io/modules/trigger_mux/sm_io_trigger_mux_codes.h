@@ -8,6 +8,22 @@
 #ifndef _SM_IO_TRIGGER_MUX_CODES_H_
 #define _SM_IO_TRIGGER_MUX_CODES_H_
 
+/* This must match the FPGA maximum number of channels */
+#define TRIGGER_MUX_NUM_CHAN                              24
+
+/* Routing of a trigger channel */
+struct _smio_trigger_mux_chan_t {
+    uint32_t rcv_src;                               /* Receive source */
+    uint32_t rcv_in_sel;                            /* Receive selection */
+    uint32_t transm_src;                            /* Transmit source */
+    uint32_t transm_out_sel;                        /* Transmit selection */
+};
+
+/* Routing of all of the trigger channels */
+struct _smio_trigger_mux_table_t {
+    struct _smio_trigger_mux_chan_t chan [TRIGGER_MUX_NUM_CHAN];
+};
+
 /* Messaging OPCODES */
 #define TRIGGER_MUX_OPCODE_TYPE                           uint32_t
 #define TRIGGER_MUX_OPCODE_SIZE                           (sizeof (TRIGGER_MUX_OPCODE_TYPE))
@@ -20,7 +36,9 @@
 #define TRIGGER_MUX_NAME_TRANSM_SRC                       "trigger_mux_transm_src"
 #define TRIGGER_MUX_OPCODE_TRANSM_OUT_SEL                 3
 #define TRIGGER_MUX_NAME_TRANSM_OUT_SEL                   "trigger_mux_transm_out_sel"
-#define TRIGGER_MUX_OPCODE_END                            4
+#define TRIGGER_MUX_OPCODE_TABLE                          4
+#define TRIGGER_MUX_NAME_TABLE                            "trigger_mux_table"
+#define TRIGGER_MUX_OPCODE_END                            5
 
 /* Messaging Reply OPCODES */
 #define TRIGGER_MUX_REPLY_TYPE                            uint32_t
@@ -33,7 +33,7 @@
             smio_err_str (err_type))
 
 #define SMIO_TRIGGER_MUX_LIBBPMCLIENT_LOG_MODE                "a"
-#define SMIO_TRIGGER_MUX_MAX_CHAN                             24
+#define SMIO_TRIGGER_MUX_MAX_CHAN                             TRIGGER_MUX_NUM_CHAN
 
 /* We use the actual libclient to send and configure our default values,
  * maintaining internal consistency. So, in fact, we are sending ourselves
@@ -56,23 +56,22 @@ smio_err_e trigger_mux_config_defaults (char *broker_endp, char *service,
             log_file_name, SMIO_TRIGGER_MUX_LIBBPMCLIENT_LOG_MODE);
     ASSERT_ALLOC(config_client, err_alloc_client);
 
+    smio_trigger_mux_table_t table;
     uint32_t chan;
     for (chan = 0; chan < SMIO_TRIGGER_MUX_MAX_CHAN; ++chan) {
-        client_err = bpm_set_trigger_rcv_src (config_client, service, chan, TRIGGER_MUX_DFLT_RCV_SRC);
-        client_err |= bpm_set_trigger_rcv_in_sel (config_client, service, chan, TRIGGER_MUX_DFLT_RCV_IN_SEL);
-        client_err |= bpm_set_trigger_transm_src (config_client, service, chan, TRIGGER_MUX_DFLT_TRANSM_SRC);
-        client_err |= bpm_set_trigger_transm_out_sel (config_client, service, chan, TRIGGER_MUX_DFLT_TRANSM_IN_SEL);
+        table.chan [chan].rcv_src = TRIGGER_MUX_DFLT_RCV_SRC;
+        table.chan [chan].rcv_in_sel = TRIGGER_MUX_DFLT_RCV_IN_SEL;
+        table.chan [chan].transm_src = TRIGGER_MUX_DFLT_TRANSM_SRC;
+        table.chan [chan].transm_out_sel = TRIGGER_MUX_DFLT_TRANSM_IN_SEL;
     }
 
     /* Switching Trigger. Change it to correct parameters */
-    client_err = bpm_set_trigger_rcv_src (config_client, service, TRIGGER_MUX_SW_CLK_CHAN, 
-        TRIGGER_MUX_SW_CLK_DFLT_RCV_SRC);
-    client_err |= bpm_set_trigger_rcv_in_sel (config_client, service, TRIGGER_MUX_SW_CLK_CHAN, 
-        TRIGGER_MUX_SW_CLK_DFLT_RCV_IN_SEL);
-    client_err |= bpm_set_trigger_transm_src (config_client, service, TRIGGER_MUX_SW_CLK_CHAN, 
-        TRIGGER_MUX_SW_CLK_DFLT_TRANSM_SRC);
-    client_err |= bpm_set_trigger_transm_out_sel (config_client, service, TRIGGER_MUX_SW_CLK_CHAN, 
-        TRIGGER_MUX_SW_CLK_DFLT_TRANSM_IN_SEL);
+    table.chan [TRIGGER_MUX_SW_CLK_CHAN].rcv_src = TRIGGER_MUX_SW_CLK_DFLT_RCV_SRC;
+    table.chan [TRIGGER_MUX_SW_CLK_CHAN].rcv_in_sel = TRIGGER_MUX_SW_CLK_DFLT_RCV_IN_SEL;
+    table.chan [TRIGGER_MUX_SW_CLK_CHAN].transm_src = TRIGGER_MUX_SW_CLK_DFLT_TRANSM_SRC;
+    table.chan [TRIGGER_MUX_SW_CLK_CHAN].transm_out_sel = TRIGGER_MUX_SW_CLK_DFLT_TRANSM_IN_SEL;
+
+    client_err = bpm_set_trigger_mux_table (config_client, service, &table);
 
     ASSERT_TEST(client_err == BPM_CLIENT_SUCCESS, "Could set trigger mux defaults",
             err_param_set, SMIO_ERR_CONFIG_DFLT);
@@ -37,9 +37,9 @@
     CHECK_HAL_ERR(err, SM_IO, "[sm_io:trigger_mux_exp]",                        \
             smio_err_str (err_type))
 
-/* This must match the FPGA maximum number of channels */
-#define TRIGGER_MUX_NUM_CHAN                          24
 #define TRIGGER_MUX_CHAN_OFFSET                       0x008 /* 2 32-bit registers */
+#define TRIGGER_MUX_CHAN_REGS                         (TRIGGER_MUX_CHAN_OFFSET / sizeof (uint32_t))
+#define TRIGGER_MUX_CTL_IDX                           (WB_TRIG_MUX_REG_CH0_CTL / sizeof (uint32_t))
 
 /*****************************************************************/
 /************ Specific TRIGGER MUX Operations **************/
@@ -48,7 +48,7 @@
 #define BPM_TRIGGER_MUX_RCV_SRC_MIN                         0 /* Trigger Source Selection (= Trigger Backplane) */
 #define BPM_TRIGGER_MUX_RCV_SRC_MAX                         1 /* Trigger Source Selection (= FPGA internal) */
 RW_PARAM_FUNC(trigger_mux, rcv_src) {
-    SET_GET_PARAM_CHANNEL(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
+    SET_GET_PARAM_CHANNEL_CACHED(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
             CH0_CTL, RCV_SRC, TRIGGER_MUX_CHAN_OFFSET, TRIGGER_MUX_NUM_CHAN, SINGLE_BIT_PARAM,
             BPM_TRIGGER_MUX_RCV_SRC_MIN, BPM_TRIGGER_MUX_RCV_SRC_MAX, NO_CHK_FUNC,
             NO_FMT_FUNC, SET_FIELD);
@@ -57,7 +57,7 @@ RW_PARAM_FUNC(trigger_mux, rcv_src) {
 #define BPM_TRIGGER_MUX_RCV_IN_SEL_MIN                       0              /* Minimum selection */
 #define BPM_TRIGGER_MUX_RCV_IN_SEL_MAX                       ((1 << 8) -1)  /* Maximum selection */
 RW_PARAM_FUNC(trigger_mux, rcv_in_sel) {
-    SET_GET_PARAM_CHANNEL(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
+    SET_GET_PARAM_CHANNEL_CACHED(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
             CH0_CTL, RCV_IN_SEL, TRIGGER_MUX_CHAN_OFFSET, TRIGGER_MUX_NUM_CHAN, MULT_BIT_PARAM,
             BPM_TRIGGER_MUX_RCV_IN_SEL_MIN, BPM_TRIGGER_MUX_RCV_IN_SEL_MAX, NO_CHK_FUNC,
             NO_FMT_FUNC, SET_FIELD);
@@ -66,7 +66,7 @@ RW_PARAM_FUNC(trigger_mux, rcv_in_sel) {
 #define BPM_TRIGGER_MUX_TRANSM_SRC_MIN                       0 /* Trigger Source Selection (= Trigger Backplane) */
 #define BPM_TRIGGER_MUX_TRANSM_SRC_MAX                       1 /* Trigger Source Selection (= FPGA internal) */
 RW_PARAM_FUNC(trigger_mux, transm_src) {
-    SET_GET_PARAM_CHANNEL(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
+    SET_GET_PARAM_CHANNEL_CACHED(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
             CH0_CTL, TRANSM_SRC, TRIGGER_MUX_CHAN_OFFSET, TRIGGER_MUX_NUM_CHAN, SINGLE_BIT_PARAM,
             BPM_TRIGGER_MUX_TRANSM_SRC_MIN, BPM_TRIGGER_MUX_TRANSM_SRC_MAX, NO_CHK_FUNC,
             NO_FMT_FUNC, SET_FIELD);
@@ -75,18 +75,93 @@ RW_PARAM_FUNC(trigger_mux, transm_src) {
 #define BPM_TRIGGER_MUX_TRANSM_OUT_SEL_MIN                   0              /* Minimum selection */
 #define BPM_TRIGGER_MUX_TRANSM_OUT_SEL_MAX                   ((1 << 8) -1)  /* Maximum selection */
 RW_PARAM_FUNC(trigger_mux, transm_out_sel) {
-    SET_GET_PARAM_CHANNEL(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
+    SET_GET_PARAM_CHANNEL_CACHED(trigger_mux, WB_TRIGGER_MUX_RAW_REG_OFFS, WB_TRIG_MUX,
             CH0_CTL, TRANSM_OUT_SEL, TRIGGER_MUX_CHAN_OFFSET, TRIGGER_MUX_NUM_CHAN, MULT_BIT_PARAM,
             BPM_TRIGGER_MUX_TRANSM_OUT_SEL_MIN, BPM_TRIGGER_MUX_TRANSM_OUT_SEL_MAX, NO_CHK_FUNC,
             NO_FMT_FUNC, SET_FIELD);
 }
 
+/* Write or read the routing of all of the channels at once, with a single
+ * block access over the channel registers */
+static int _trigger_mux_table (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+
+    int err = -TRIGGER_MUX_OK;
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:trigger_mux_exp] Calling "
+            "_trigger_mux_table\n");
+
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw
+     * frame 2: channels table
+     */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    smio_trigger_mux_table_t *table = (smio_trigger_mux_table_t *)
+        EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    uint32_t regs [TRIGGER_MUX_NUM_CHAN * TRIGGER_MUX_CHAN_REGS];
+    uint32_t chan;
+    ssize_t rw_size;
+
+    if (rw) {
+        rw_size = smio_thsafe_client_read_block (self, WB_TRIGGER_MUX_RAW_REG_OFFS,
+                sizeof (regs), regs);
+        ASSERT_TEST(rw_size == sizeof (regs), "Could not read trigger channels",
+                err_rw, -TRIGGER_MUX_ERR);
+
+        smio_trigger_mux_table_t *rtable = (smio_trigger_mux_table_t *) ret;
+        for (chan = 0; chan < TRIGGER_MUX_NUM_CHAN; ++chan) {
+            uint32_t ctl = regs [chan*TRIGGER_MUX_CHAN_REGS + TRIGGER_MUX_CTL_IDX];
+            rtable->chan [chan].rcv_src = !!(ctl & WB_TRIG_MUX_CH0_CTL_RCV_SRC);
+            rtable->chan [chan].rcv_in_sel = WB_TRIG_MUX_CH0_CTL_RCV_IN_SEL_R(ctl);
+            rtable->chan [chan].transm_src = !!(ctl & WB_TRIG_MUX_CH0_CTL_TRANSM_SRC);
+            rtable->chan [chan].transm_out_sel = WB_TRIG_MUX_CH0_CTL_TRANSM_OUT_SEL_R(ctl);
+        }
+
+        err = sizeof (*rtable);
+    }
+    else {
+        memset (regs, 0, sizeof (regs));
+        for (chan = 0; chan < TRIGGER_MUX_NUM_CHAN; ++chan) {
+            const struct _smio_trigger_mux_chan_t *cfg = &table->chan [chan];
+            ASSERT_TEST(cfg->rcv_src <= BPM_TRIGGER_MUX_RCV_SRC_MAX &&
+                    cfg->rcv_in_sel <= BPM_TRIGGER_MUX_RCV_IN_SEL_MAX &&
+                    cfg->transm_src <= BPM_TRIGGER_MUX_TRANSM_SRC_MAX &&
+                    cfg->transm_out_sel <= BPM_TRIGGER_MUX_TRANSM_OUT_SEL_MAX,
+                    "Trigger channel routing is out of range",
+                    err_rw, -TRIGGER_MUX_ERR);
+
+            regs [chan*TRIGGER_MUX_CHAN_REGS + TRIGGER_MUX_CTL_IDX] =
+                (cfg->rcv_src ? WB_TRIG_MUX_CH0_CTL_RCV_SRC : 0) |
+                WB_TRIG_MUX_CH0_CTL_RCV_IN_SEL_W(cfg->rcv_in_sel) |
+                (cfg->transm_src ? WB_TRIG_MUX_CH0_CTL_TRANSM_SRC : 0) |
+                WB_TRIG_MUX_CH0_CTL_TRANSM_OUT_SEL_W(cfg->transm_out_sel);
+        }
+
+        /* The channel registers are all cached, so a table that is
+         * already programmed does not reach the hardware */
+        rw_size = smio_thsafe_client_cached_write_block (self, WB_TRIGGER_MUX_RAW_REG_OFFS,
+                sizeof (regs), regs);
+        ASSERT_TEST(rw_size == sizeof (regs), "Could not write trigger channels",
+                err_rw, -TRIGGER_MUX_ERR);
+        smio_set_param_changed (self);
+    }
+
+err_rw:
+    return err;
+}
+
 /* Exported function pointers */
 const disp_table_func_fp trigger_mux_exp_fp [] = {
     RW_PARAM_FUNC_NAME(trigger_mux, rcv_src),
     RW_PARAM_FUNC_NAME(trigger_mux, rcv_in_sel),
     RW_PARAM_FUNC_NAME(trigger_mux, transm_src),
     RW_PARAM_FUNC_NAME(trigger_mux, transm_out_sel),
+    _trigger_mux_table,
     NULL
 };
 
@@ -169,10 +244,16 @@ smio_err_e trigger_mux_init (smio_t * self)
     err = smio_set_ops (self, &trigger_mux_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO operations",
             err_smio_set_ops);
-    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_zmq_ops);
+    err = smio_set_thsafe_client_ops (self, &smio_thsafe_client_direct_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO thsafe operations",
             err_smio_set_thsafe_ops);
 
+    /* All of the channel registers are configuration ones */
+    err = smio_add_cache_region (self, WB_TRIGGER_MUX_RAW_REG_OFFS,
+            TRIGGER_MUX_NUM_CHAN * TRIGGER_MUX_CHAN_OFFSET);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not set SMIO cached registers",
+            err_add_cache_region);
+
     /* Fill the disp_op_t description structure with the callbacks. */
 
     /* disp_op_t structure is const and all of the functions performing on it
@@ -203,6 +284,7 @@ err_smio_handler_alloc:
     smio_set_exp_ops (self, NULL);
 err_smio_set_exp_ops:
 err_fill_desc:
+err_add_cache_region:
     smio_set_thsafe_client_ops (self, NULL);
 err_smio_set_thsafe_ops:
     smio_set_ops (self, NULL);
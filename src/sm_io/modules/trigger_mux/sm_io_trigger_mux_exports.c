@@ -62,12 +62,25 @@ disp_op_t trigger_mux_transm_out_sel_exp = {
     }
 };
 
+disp_op_t trigger_mux_table_exp = {
+    .name = TRIGGER_MUX_NAME_TABLE,
+    .opcode = TRIGGER_MUX_OPCODE_TABLE,
+    .retval = DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_trigger_mux_table_t),
+    .retval_owner = DISP_OWNER_OTHER,
+    .args = {
+        DISP_ARG_ENCODE(DISP_ATYPE_UINT32, uint32_t),
+        DISP_ARG_ENCODE(DISP_ATYPE_STRUCT, smio_trigger_mux_table_t),
+        DISP_ARG_END
+    }
+};
+
 /* Exported function description */
 const disp_op_t *trigger_mux_exp_ops [] = {
     &trigger_mux_rcv_src_exp,
     &trigger_mux_rcv_in_sel_exp,
     &trigger_mux_transm_src_exp,
     &trigger_mux_transm_out_sel_exp,
+    &trigger_mux_table_exp,
     NULL
 };
 
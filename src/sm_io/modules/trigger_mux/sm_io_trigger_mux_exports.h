@@ -14,6 +14,7 @@ extern disp_op_t trigger_mux_rcv_src_exp;
 extern disp_op_t trigger_mux_rcv_in_sel_exp;
 extern disp_op_t trigger_mux_transm_src_exp;
 extern disp_op_t trigger_mux_transm_out_sel_exp;
+extern disp_op_t trigger_mux_table_exp;
 
 extern const disp_op_t *trigger_mux_exp_ops [];
 
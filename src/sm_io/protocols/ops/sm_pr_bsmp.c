@@ -32,9 +32,30 @@
 
 #define SMPR_PROTO_BSMP_CLIENT(smpr_handler)         (smpr_handler->client)
 
+/* BSMP variable read command and its answer. See BSMP documentation */
+#define SMPR_PROTO_BSMP_CMD_VAR_READ                0x10
+#define SMPR_PROTO_BSMP_CMD_VAR_VALUE               0x11
+#define SMPR_PROTO_BSMP_VAR_READ_SIZE               (BSMP_HEADER_SIZE + 1)
+/* Maximum BSMP variable size */
+#define SMPR_PROTO_BSMP_VAR_MAX_SIZE                128
+/* BSMP curve block read command and its answer. Both start with the curve
+ * ID and the block offset */
+#define SMPR_PROTO_BSMP_CMD_CURVE_BLOCK_REQUEST     0x40
+#define SMPR_PROTO_BSMP_CMD_CURVE_BLOCK             0x41
+#define SMPR_PROTO_BSMP_CURVE_HEADER_SIZE           3
+#define SMPR_PROTO_BSMP_CURVE_REQUEST_SIZE          (BSMP_HEADER_SIZE + \
+        SMPR_PROTO_BSMP_CURVE_HEADER_SIZE)
+/* Curves with bigger blocks are read by libbsmp, one block at a time */
+#define SMPR_PROTO_BSMP_CURVE_BLOCK_MAX_SIZE        4096
+/* Number of curve blocks requested ahead */
+#define SMPR_PROTO_BSMP_CURVE_WINDOW                4
+
 /* BSMP glue structure. Needed to overcome the need of global variables */
 typedef struct {
     smio_t *parent;
+    uint8_t next_header [BSMP_HEADER_SIZE];     /* Header of the next pipelined
+                                                   answer, if already read */
+    bool next_header_valid;
 } smpr_proto_glue_bsmp_t;
 
 /* BSMP glue structure */
@@ -54,6 +75,10 @@ typedef struct {
 static smpr_err_e _smpr_proto_bsmp_get_handlers (smpr_t *self);
 static int _smpr_proto_bsmp_send (uint8_t *data, uint32_t *count);
 static int _smpr_proto_bsmp_recv (uint8_t *data, uint32_t *count);
+static int _smpr_proto_bsmp_recv_pipelined (uint8_t *data, uint32_t *count,
+        uint32_t max_len, bool more);
+static int _smpr_proto_bsmp_read_curve_pipelined (struct bsmp_curve_info *curve_info,
+        uint8_t *data, uint32_t *valid_bytes);
 
 /*************** Our methods implementation **********/
 
@@ -245,6 +270,198 @@ err_proto_handler:
     return err;
 }
 
+/* Read several RFFE vars by ID. All of the requests are sent at once and the
+ * answers are read back as they arrive, so the whole read costs a single
+ * round trip to the BSMP server, instead of one per variable */
+smpr_err_e smpr_bsmp_read_vars_by_id (smpr_t *self, const uint32_t *ids,
+        uint8_t **data, size_t size, size_t num_ids)
+{
+    assert (self);
+    assert (ids);
+    assert (data);
+
+    smpr_err_e err = SMPR_SUCCESS;
+    smpr_proto_bsmp_t *bsmp_proto = smpr_get_handler (self);
+    ASSERT_TEST(bsmp_proto != NULL, "Could not get SMPR protocol handler",
+            err_proto_handler, SMPR_ERR_PROTO_INFO);
+    ASSERT_TEST(num_ids > 0 && num_ids <= SMPR_BSMP_PIPELINE_MAX,
+            "Invalid number of BSMP variables", err_inv_num_ids,
+            SMPR_ERR_INV_FUNC_PARAM);
+
+    uint8_t request [SMPR_BSMP_PIPELINE_MAX * SMPR_PROTO_BSMP_VAR_READ_SIZE];
+    uint32_t request_size = 0;
+    size_t i;
+    for (i = 0; i < num_ids; ++i) {
+        ASSERT_TEST(ids [i] < bsmp_proto->vars_list->count, "Invalid BSMP "
+                "variable ID", err_inv_id, SMPR_ERR_INV_FUNC_PARAM);
+        ASSERT_TEST(bsmp_proto->vars_list->list[ids [i]].size <= size,
+                "Variable size is too small for BSMP variable",
+                err_size_too_small, SMPR_ERR_INV_FUNC_PARAM);
+
+        uint8_t *req = request + request_size;
+        req [0] = SMPR_PROTO_BSMP_CMD_VAR_READ;
+        req [1] = 0;
+        req [2] = 1;
+        req [3] = (uint8_t) ids [i];
+        request_size += SMPR_PROTO_BSMP_VAR_READ_SIZE;
+    }
+
+    int serr = _smpr_proto_bsmp_send (request, &request_size);
+    ASSERT_TEST(serr == 0, "Could not send BSMP variable read requests",
+            err_send, SMPR_ERR_RW_SMIO);
+
+    /* Every request gets an answer, even the failed ones, so we always read
+     * all of them back to keep the stream in sync */
+    bsmp_glue.next_header_valid = false;
+    uint8_t answer [BSMP_HEADER_SIZE + SMPR_PROTO_BSMP_VAR_MAX_SIZE +
+        BSMP_HEADER_SIZE];
+    for (i = 0; i < num_ids; ++i) {
+        uint32_t answer_size = 0;
+        serr = _smpr_proto_bsmp_recv_pipelined (answer, &answer_size,
+                SMPR_PROTO_BSMP_VAR_MAX_SIZE, i < num_ids - 1);
+        ASSERT_TEST(serr == 0, "Could not receive BSMP variable value",
+                err_recv, SMPR_ERR_RW_SMIO);
+
+        struct bsmp_var_info *var_info = &bsmp_proto->vars_list->list[ids [i]];
+        uint32_t value_size = answer_size - BSMP_HEADER_SIZE;
+        if (answer [0] != SMPR_PROTO_BSMP_CMD_VAR_VALUE ||
+                value_size != var_info->size) {
+            DBE_DEBUG (DBG_SM_PR | DBG_LVL_ERR, "[sm_pr:bsmp] Could not read "
+                    "BSMP variable %u. Got answer 0x%02X\n", ids [i], answer [0]);
+            err = SMPR_ERR_RW_SMIO;
+            continue;
+        }
+
+        memcpy (data [i], answer + BSMP_HEADER_SIZE, value_size);
+    }
+
+err_recv:
+err_send:
+err_size_too_small:
+err_inv_id:
+err_inv_num_ids:
+err_proto_handler:
+    return err;
+}
+
+/* Create a BSMP group with the RFFE vars "ids" */
+smpr_err_e smpr_bsmp_create_group (smpr_t *self, const uint32_t *ids,
+        size_t num_ids, uint32_t *group_id)
+{
+    assert (self);
+    assert (ids);
+    assert (group_id);
+
+    smpr_err_e err = SMPR_SUCCESS;
+    smpr_proto_bsmp_t *bsmp_proto = smpr_get_handler (self);
+    ASSERT_TEST(bsmp_proto != NULL, "Could not get SMPR protocol handler",
+            err_proto_handler, SMPR_ERR_PROTO_INFO);
+    bsmp_client_t *bsmp_client = SMPR_PROTO_BSMP_CLIENT(bsmp_proto);
+    ASSERT_TEST(num_ids > 0 && num_ids <= SMPR_BSMP_PIPELINE_MAX,
+            "Invalid number of BSMP variables", err_inv_num_ids,
+            SMPR_ERR_INV_FUNC_PARAM);
+
+    /* NULL terminated, as libbsmp wants it */
+    struct bsmp_var_info *vars [SMPR_BSMP_PIPELINE_MAX + 1];
+    size_t i;
+    for (i = 0; i < num_ids; ++i) {
+        ASSERT_TEST(ids [i] < bsmp_proto->vars_list->count, "Invalid BSMP "
+                "variable ID", err_inv_id, SMPR_ERR_INV_FUNC_PARAM);
+        vars [i] = &bsmp_proto->vars_list->list[ids [i]];
+    }
+    vars [num_ids] = NULL;
+
+    enum bsmp_err berr = bsmp_create_group (bsmp_client, vars);
+    ASSERT_TEST(berr == BSMP_SUCCESS, "Could not create BSMP group",
+            err_bsmp, SMPR_ERR_RW_SMIO);
+
+    /* The client updates its group list and the new one is the last one */
+    *group_id = bsmp_proto->groups_list->count - 1;
+
+    DBE_DEBUG (DBG_SM_PR | DBG_LVL_INFO, "[sm_pr:bsmp] Created BSMP group "
+            "%u with %zu variable(s)\n", *group_id, num_ids);
+
+err_bsmp:
+err_inv_id:
+err_inv_num_ids:
+err_proto_handler:
+    return err;
+}
+
+/* Remove all of the BSMP groups created by clients */
+smpr_err_e smpr_bsmp_remove_groups (smpr_t *self)
+{
+    assert (self);
+
+    smpr_err_e err = SMPR_SUCCESS;
+    smpr_proto_bsmp_t *bsmp_proto = smpr_get_handler (self);
+    ASSERT_TEST(bsmp_proto != NULL, "Could not get SMPR protocol handler",
+            err_proto_handler, SMPR_ERR_PROTO_INFO);
+    bsmp_client_t *bsmp_client = SMPR_PROTO_BSMP_CLIENT(bsmp_proto);
+
+    enum bsmp_err berr = bsmp_remove_all_groups (bsmp_client);
+    ASSERT_TEST(berr == BSMP_SUCCESS, "Could not remove BSMP groups",
+            err_bsmp, SMPR_ERR_RW_SMIO);
+
+err_bsmp:
+err_proto_handler:
+    return err;
+}
+
+/* Read RFFE group by ID. The value of each variable of the group goes to
+ * data [i], in the order of the group */
+smpr_err_e smpr_bsmp_read_group_by_id (smpr_t *self, uint32_t id,
+        uint8_t **data, size_t size, size_t num_vars)
+{
+    assert (self);
+    assert (data);
+
+    smpr_err_e err = SMPR_SUCCESS;
+    smpr_proto_bsmp_t *bsmp_proto = smpr_get_handler (self);
+    ASSERT_TEST(bsmp_proto != NULL, "Could not get SMPR protocol handler",
+            err_proto_handler, SMPR_ERR_PROTO_INFO);
+    bsmp_client_t *bsmp_client = SMPR_PROTO_BSMP_CLIENT(bsmp_proto);
+
+    /* Check if the ID is valid */
+    ASSERT_TEST(id < bsmp_proto->groups_list->count, "Invalid BSMP group ID",
+            err_inv_id, SMPR_ERR_INV_FUNC_PARAM);
+
+    /* Get associated group info */
+    struct bsmp_group *group = &bsmp_proto->groups_list->list[id];
+    ASSERT_TEST(group->vars.count == num_vars, "Number of variables does not "
+            "match the BSMP group", err_num_vars_differs, SMPR_ERR_INV_FUNC_PARAM);
+
+    uint8_t values [SMPR_BSMP_PIPELINE_MAX * SMPR_PROTO_BSMP_VAR_MAX_SIZE];
+    ASSERT_TEST(group->size <= sizeof (values), "BSMP group is too big",
+            err_group_too_big, SMPR_ERR_INV_FUNC_PARAM);
+
+    uint32_t i;
+    for (i = 0; i < group->vars.count; ++i) {
+        ASSERT_TEST(group->vars.list[i]->size <= size, "Variable size is too "
+                "small for BSMP variable", err_size_too_small,
+                SMPR_ERR_INV_FUNC_PARAM);
+    }
+
+    enum bsmp_err berr = bsmp_read_group (bsmp_client, group, values);
+    ASSERT_TEST(berr == BSMP_SUCCESS, "Could not read BSMP group",
+            err_bsmp, SMPR_ERR_RW_SMIO /* FIXME: return better error? */ );
+
+    /* Values are packed back to back, in the group order */
+    uint8_t *value = values;
+    for (i = 0; i < group->vars.count; ++i) {
+        memcpy (data [i], value, group->vars.list[i]->size);
+        value += group->vars.list[i]->size;
+    }
+
+err_bsmp:
+err_size_too_small:
+err_group_too_big:
+err_num_vars_differs:
+err_inv_id:
+err_proto_handler:
+    return err;
+}
+
 /* Call RFFE functions by ID */
 smpr_err_e smpr_bsmp_func_exec_by_id (smpr_t *self, uint32_t id, uint8_t *write_data,
         size_t write_size, uint8_t *read_data, size_t read_size)
@@ -314,10 +531,18 @@ smpr_err_e smpr_bsmp_read_curve_by_id (smpr_t *self, uint32_t id, uint8_t *read_
             err_curve_size_small, SMPR_ERR_INV_FUNC_PARAM);
 
     uint32_t valid_bytes_read = 0;
-    enum bsmp_err berr = bsmp_read_curve (bsmp_client, curve_info, read_data,
-            &valid_bytes_read);
-    ASSERT_TEST(berr == BSMP_SUCCESS, "Could not read BSMP curve",
-            err_bsmp, SMPR_ERR_RW_SMIO /* FIXME: return better error? */ );
+    if (curve_info->block_size <= SMPR_PROTO_BSMP_CURVE_BLOCK_MAX_SIZE) {
+        int perr = _smpr_proto_bsmp_read_curve_pipelined (curve_info, read_data,
+                &valid_bytes_read);
+        ASSERT_TEST(perr == 0, "Could not read BSMP curve",
+                err_bsmp, SMPR_ERR_RW_SMIO /* FIXME: return better error? */ );
+    }
+    else {
+        enum bsmp_err berr = bsmp_read_curve (bsmp_client, curve_info, read_data,
+                &valid_bytes_read);
+        ASSERT_TEST(berr == BSMP_SUCCESS, "Could not read BSMP curve",
+                err_bsmp, SMPR_ERR_RW_SMIO /* FIXME: return better error? */ );
+    }
 
     /* Tell user how many were actually read */
     if (valid_bytes != NULL) {
@@ -482,6 +707,139 @@ err_packet_header:
     return err;
 }
 
+/* Read a curve keeping SMPR_PROTO_BSMP_CURVE_WINDOW block requests in
+ * flight, instead of waiting for each block before asking for the next.
+ * Answers come back in the order the blocks were requested */
+static int _smpr_proto_bsmp_read_curve_pipelined (struct bsmp_curve_info *curve_info,
+        uint8_t *data, uint32_t *valid_bytes)
+{
+    const uint32_t nblocks = curve_info->nblocks;
+    const uint32_t block_size = curve_info->block_size;
+    uint32_t requested = 0;
+    uint32_t received = 0;
+    uint32_t total = 0;
+    int err = 0;
+
+    uint8_t answer [BSMP_HEADER_SIZE + SMPR_PROTO_BSMP_CURVE_HEADER_SIZE +
+        SMPR_PROTO_BSMP_CURVE_BLOCK_MAX_SIZE + BSMP_HEADER_SIZE];
+    bsmp_glue.next_header_valid = false;
+
+    while (received < nblocks) {
+        /* Keep the window full. Stop asking after an error, but still read
+         * the answers on the way, to keep the stream in sync */
+        while (err == 0 && requested < nblocks &&
+                requested - received < SMPR_PROTO_BSMP_CURVE_WINDOW) {
+            uint8_t request [SMPR_PROTO_BSMP_CURVE_REQUEST_SIZE] = {
+                SMPR_PROTO_BSMP_CMD_CURVE_BLOCK_REQUEST,
+                0,
+                SMPR_PROTO_BSMP_CURVE_HEADER_SIZE,
+                curve_info->id,
+                (uint8_t) (requested >> 8),
+                (uint8_t) requested
+            };
+            uint32_t request_size = sizeof (request);
+            if (_smpr_proto_bsmp_send (request, &request_size) != 0) {
+                err = -1;
+                break;
+            }
+            ++requested;
+        }
+
+        if (received == requested) {
+            break;
+        }
+
+        uint32_t answer_size = 0;
+        int rerr = _smpr_proto_bsmp_recv_pipelined (answer, &answer_size,
+                SMPR_PROTO_BSMP_CURVE_HEADER_SIZE + SMPR_PROTO_BSMP_CURVE_BLOCK_MAX_SIZE,
+                received + 1 < requested);
+        ASSERT_TEST(rerr == 0, "Could not receive BSMP curve block",
+                err_recv, -1);
+
+        uint8_t *block_hdr = answer + BSMP_HEADER_SIZE;
+        uint32_t block_len = answer_size - BSMP_HEADER_SIZE;
+        if (answer [0] != SMPR_PROTO_BSMP_CMD_CURVE_BLOCK ||
+                block_len < SMPR_PROTO_BSMP_CURVE_HEADER_SIZE ||
+                block_hdr [0] != curve_info->id ||
+                ((uint32_t) block_hdr [1] << 8) + block_hdr [2] != received ||
+                block_len - SMPR_PROTO_BSMP_CURVE_HEADER_SIZE > block_size) {
+            DBE_DEBUG (DBG_SM_PR | DBG_LVL_ERR, "[sm_pr:bsmp] Could not read "
+                    "block %u of BSMP curve %u. Got answer 0x%02X\n", received,
+                    curve_info->id, answer [0]);
+            err = -1;
+        }
+        else {
+            block_len -= SMPR_PROTO_BSMP_CURVE_HEADER_SIZE;
+            memcpy (data + received*block_size,
+                    block_hdr + SMPR_PROTO_BSMP_CURVE_HEADER_SIZE, block_len);
+            total += block_len;
+        }
+        ++received;
+    }
+
+    *valid_bytes = total;
+    return err;
+
+err_recv:
+    /* The stream is lost. Nothing more to be read from it */
+    *valid_bytes = total;
+    return -1;
+}
+
+/* Receive one answer of a pipeline, with a payload of up to "max_len" bytes.
+ * "data" must hold the header, the payload and another header. If "more" is
+ * set, another answer is known to follow, so its header is read along with
+ * this answer payload, saving one read per answer. It is kept for the next
+ * call */
+static int _smpr_proto_bsmp_recv_pipelined (uint8_t *data, uint32_t *count,
+        uint32_t max_len, bool more)
+{
+    int err = 0;
+
+    if (bsmp_glue.next_header_valid) {
+        memcpy (data, bsmp_glue.next_header, BSMP_HEADER_SIZE);
+        bsmp_glue.next_header_valid = false;
+    }
+    else {
+        ssize_t ret = smio_thsafe_client_read_block (bsmp_glue.parent, 0,
+                BSMP_HEADER_SIZE, (uint32_t *) data);
+        if (ret != BSMP_HEADER_SIZE) {
+            err = -1;
+            goto err_packet_header;
+        }
+    }
+
+    uint32_t len = (data [1] << 8) + data [2];
+    ASSERT_TEST(len <= max_len, "BSMP answer is too big", err_packet_size, -1);
+    uint32_t read_len = len + ((more) ? BSMP_HEADER_SIZE : 0);
+
+    DBE_DEBUG (DBG_LL_IO | DBG_LVL_TRACE, "[sm_pr:bsmp] Receiving another %u "
+            "bytes\n", read_len);
+    if (read_len > 0) {
+        ssize_t ret = smio_thsafe_client_read_block (bsmp_glue.parent, 0,
+                read_len, (uint32_t *)(data + BSMP_HEADER_SIZE));
+        if (ret != (ssize_t) read_len) {
+            err = -1;
+            goto err_packet_payload;
+        }
+    }
+
+    if (more) {
+        memcpy (bsmp_glue.next_header, data + BSMP_HEADER_SIZE + len,
+                BSMP_HEADER_SIZE);
+        bsmp_glue.next_header_valid = true;
+    }
+
+    *count = BSMP_HEADER_SIZE + len;
+    return err;
+
+err_packet_payload:
+err_packet_size:
+err_packet_header:
+    *count = 0;
+    return err;
+}
+
 const smpr_proto_ops_t smpr_proto_ops_bsmp = {
     .proto_open           = bsmp_open,          /* Open device */
     .proto_release        = bsmp_release,       /* Release device */
@@ -37,8 +37,10 @@
     CHECK_HAL_ERR(err, SM_PR, "[sm_pr:i2c]",                    \
             smpr_err_str (err_type))
 
-#define SM_PR_I2C_MAX_TRIES                 10
-#define SM_PR_I2C_USLEEP                    1000
+/* Largest transfer, in bytes */
+#define SM_PR_I2C_BYTES_MAX                 ((SMPR_PROTO_I2C_TRANS_SIZE_FLAGS_MAX+1)/SMPR_BYTE_2_BIT)
+/* Address and command, plus data, command and completion poll per byte */
+#define SM_PR_I2C_BATCH_MAX_OPS             (3 + 3*SM_PR_I2C_BYTES_MAX)
 
 /* Device endpoint */
 typedef struct {
@@ -50,13 +52,17 @@ typedef struct {
 } smpr_proto_i2c_t;
 
 static smpr_err_e _i2c_init (smpr_t *self);
-static ssize_t _i2c_check_transfer (smpr_t *self, bool ack_check);
 static smpr_err_e _i2c_set_mode (smpr_t *self, uint32_t flags);
-static ssize_t _i2c_read_write_header (smpr_t *self, uint32_t flags, bool rw);
+static ssize_t _i2c_transfer (smpr_t *self, uint8_t *data,
+        size_t size, uint32_t flags, bool rw);
 static ssize_t _i2c_read_generic (smpr_t *self, uint8_t *data,
         size_t size, uint32_t flags);
 static ssize_t _i2c_write_generic (smpr_t *self, uint8_t *data,
         size_t size, uint32_t flags);
+static void _i2c_batch_add (thsafe_batch_op_t *ops, uint32_t *num_ops,
+        uint64_t offset, uint32_t op, uint32_t value, uint32_t mask);
+static uint32_t _i2c_batch_add_cmd (thsafe_batch_op_t *ops, uint32_t *num_ops,
+        uint64_t base, uint32_t cmd);
 
 /************ Our methods implementation **********/
 
@@ -325,55 +331,6 @@ err_proto_handler:
     return err;
 }
 
-static ssize_t _i2c_check_transfer (smpr_t *self, bool ack_check)
-{
-    assert (self);
-
-    ssize_t err = 0;
-    smio_t *parent = smpr_get_parent (self);
-    smpr_proto_i2c_t *i2c_proto = smpr_get_handler (self);
-    ASSERT_TEST(i2c_proto != NULL, "Could not get SMPR protocol handler",
-            err_proto_handler, -1);
-
-    /* Check for completion */
-    uint32_t tip = 0;
-    uint32_t tries = 0;
-    RW_REPLY_TYPE rw_err = RW_OK;
-
-    while (1) {
-        rw_err = GET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO,
-                SR, TIP, SINGLE_BIT_PARAM, tip, NO_FMT_FUNC);
-        ASSERT_TEST(rw_err == RW_OK, "Could not get TIP parameter", err_exit, -1);
-
-        if (!tip) {
-            break;
-        }
-
-        usleep (SM_PR_I2C_USLEEP);
-        ++tries;
-        ASSERT_TEST(tries < SM_PR_I2C_MAX_TRIES, "Transfer timeout", err_exit, -1);
-    }
-
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_check_transfer: Wait completed successfully\n");
-
-    if (ack_check == 0) { /* not checking if core is in reading mode */
-        goto err_exit;
-    }
-
-    /* Check RX ACK (should be 0) */
-    uint32_t rxack = 0;
-    rw_err = GET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO,
-            SR, RXACK, SINGLE_BIT_PARAM, rxack, NO_FMT_FUNC);
-    ASSERT_TEST(rw_err == RW_OK, "Could not get RX Ack parameter", err_exit, -1);
-
-    ASSERT_TEST(rxack == 0, "RX Ack should be 0", err_exit, -1);
-
-err_exit:
-err_proto_handler:
-    return err;
-}
-
 static smpr_err_e _i2c_set_mode (smpr_t *self, uint32_t flags)
 {
     assert (self);
@@ -395,75 +352,17 @@ err_proto_handler:
     return err;
 }
 
-static ssize_t _i2c_read_write_header (smpr_t *self, uint32_t flags, bool rw)
-{
-    assert (self);
-
-    ssize_t err = 0;
-    RW_REPLY_TYPE rw_err = RW_OK;
-
-    smio_t *parent = smpr_get_parent (self);
-    smpr_proto_i2c_t *i2c_proto = smpr_get_handler (self);
-    ASSERT_TEST(i2c_proto != NULL, "Could not get SMPR protocol handler",
-            err_proto_handler, -1);
-
-    /* Decode flags */
-    uint32_t i2c_addr = SMPR_PROTO_I2C_ADDR_FLAGS_R(flags);
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_read_write_header: I2C addr 0x%08X\n", i2c_addr);
-
-    /* Send address */
-    uint32_t i2c_data = I2C_PROTO_TXR_ADDR_W(i2c_addr);
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_read_write_header: I2C data 0x%08X\n", i2c_data);
-
-    /* Read or Write mode*/
-    if (rw) {
-        i2c_data |= I2C_PROTO_TXR_RW;
-    }
-    else {
-        i2c_data &= ~I2C_PROTO_TXR_RW;
-    }
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_read_write_header: I2C address w/ rw bit= 0x%02X\n", i2c_data);
-
-    rw_err = SET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO, TXR,
-            /* field = NULL */, MULT_BIT_PARAM, i2c_data /* value */ , /* min */, /* max */,
-            NO_CHK_FUNC, SET_FIELD);
-    ASSERT_TEST(rw_err == RW_OK, "Could not set I2C address parameter", err_exit, -1);
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_read_write_header: TXR register = 0x%08X\n", i2c_data);
-
-    /* Start transfer in Write mode */
-    i2c_data = I2C_PROTO_CR_STA | I2C_PROTO_CR_WR;
-
-    rw_err = SET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO, CR,
-            /* field = NULL */, MULT_BIT_PARAM, i2c_data /* value */ , /* min */, /* max */,
-            NO_CHK_FUNC, SET_FIELD);
-    ASSERT_TEST(rw_err == RW_OK, "Could not start I2C transfer", err_exit, -1);
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_read_write_header: CR register = 0x%08X\n", i2c_data);
-
-    /* Check transfer */
-    err = _i2c_check_transfer (self, true);
-    ASSERT_TEST(err == 0, "Could not check I2C transfer", err_exit, -1);
-
-    err = sizeof (uint8_t);
-
-err_exit:
-err_proto_handler:
-    return err;
-}
-
-/* Generic write to I2C */
-static ssize_t _i2c_write_generic (smpr_t *self, uint8_t *data,
-        size_t size, uint32_t flags)
+/* Generic read or write burst. The address header and all of the bytes go
+ * in a single batch: each byte command is followed by a poll for the end of
+ * the transfer, done by the DEVIO, so the whole transaction costs a single
+ * round trip instead of a few for each byte */
+static ssize_t _i2c_transfer (smpr_t *self, uint8_t *data,
+        size_t size, uint32_t flags, bool rw)
 {
     assert (self);
 
     ssize_t err = 0;
     ssize_t num_bytes = 0;
-    RW_REPLY_TYPE rw_err = RW_OK;
     ASSERT_TEST(size*SMPR_BYTE_2_BIT /* bits */ <
             SMPR_PROTO_I2C_TRANS_SIZE_FLAGS_MAX+1, "Invalid size for I2C transfer",
             err_inv_size, -1);
@@ -473,157 +372,149 @@ static ssize_t _i2c_write_generic (smpr_t *self, uint8_t *data,
     ASSERT_TEST(i2c_proto != NULL, "Could not get SMPR protocol handler",
             err_proto_handler, -1);
 
-    err = _i2c_read_write_header (self, flags, false /* write mode*/);
-    ASSERT_TEST(err > 0, "Could not write I2C header", err_exit, -1);
-
     /* Set I2C mode: NORMAL, REP_START */
     _i2c_set_mode (self, flags);
 
     uint32_t trans_size = SMPR_PROTO_I2C_TRANS_SIZE_FLAGS_R(flags)/SMPR_BYTE_2_BIT; /* in bytes */
-    ASSERT_TEST(trans_size*SMPR_BYTE_2_BIT /* bits */ <
-            SMPR_PROTO_I2C_TRANS_SIZE_FLAGS_MAX+1, "Invalid transfer size for I2C",
-            err_inv_size, -1);
-
     if (trans_size != size) {
         DBE_DEBUG (DBG_SM_PR | DBG_LVL_WARN,
-                "[sm_pr:i2c] _i2c_write_generic: Data size differs from Transfer size.\n"
+                "[sm_pr:i2c] _i2c_transfer: Data size differs from Transfer size.\n"
                 "\tChoosing the smallest value between trans_size (%u) and size (%lu)\n", trans_size, size);
     }
 
     /* Choose the smallest one */
     trans_size = (trans_size > size) ? size : trans_size;
     DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_write_generic: Transmission size (flags) = %u bytes\n", trans_size);
+            "[sm_pr:i2c] _i2c_transfer: Transmission size = %u bytes, %s\n",
+            trans_size, rw ? "read" : "write");
+
+    thsafe_batch_op_t ops [SM_PR_I2C_BATCH_MAX_OPS];
+    uint32_t num_ops = 0;
+    /* Polls after which the slave must have ACKed */
+    uint32_t ack_ops [SM_PR_I2C_BYTES_MAX+1];
+    uint32_t num_ack_ops = 0;
+    /* RXR reads, one per byte read */
+    uint32_t rx_ops [SM_PR_I2C_BYTES_MAX];
+
+    /* Send address, with the read/write bit */
+    uint32_t i2c_addr = SMPR_PROTO_I2C_ADDR_FLAGS_R(flags);
+    uint32_t i2c_data = I2C_PROTO_TXR_ADDR_W(i2c_addr);
+    if (rw) {
+        i2c_data |= I2C_PROTO_TXR_RW;
+    }
+    else {
+        i2c_data &= ~I2C_PROTO_TXR_RW;
+    }
+    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
+            "[sm_pr:i2c] _i2c_transfer: I2C address w/ rw bit= 0x%02X\n", i2c_data);
+
+    _i2c_batch_add (ops, &num_ops, i2c_proto->base | I2C_PROTO_REG_TXR,
+            THSAFE_BATCH_OP_WRITE_32, i2c_data, 0);
+    ack_ops [num_ack_ops++] = _i2c_batch_add_cmd (ops, &num_ops, i2c_proto->base,
+            I2C_PROTO_CR_STA | I2C_PROTO_CR_WR);
 
-    /* Send actual data, byte by byte*/
     uint32_t i;
     for (i = 0; i < trans_size; ++i) {
-        /* Write data to transmit register */
-        rw_err = SET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO, TXR,
-                /* field = NULL */, MULT_BIT_PARAM, *(data + i) /* value */,
-                /* min */, /* max */, NO_CHK_FUNC, SET_FIELD);
-        ASSERT_TEST(rw_err == RW_OK, "Could not send I2C data", err_exit, -1);
-        DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-                "[sm_pr:i2c] _i2c_write_generic: TXR data register #%u = 0x%02X\n", i, *(data+i));
-
-        uint32_t i2c_data;
-        /* if this is the last byte, then stop transfer */
-        if (i == (trans_size - 1) && i2c_proto->mode == I2C_MODE_NORMAL) {    /* used for repeated start */
-            i2c_data = I2C_PROTO_CR_STO | I2C_PROTO_CR_WR;
+        bool last = (i == trans_size - 1);
+
+        if (!rw) {
+            _i2c_batch_add (ops, &num_ops, i2c_proto->base | I2C_PROTO_REG_TXR,
+                    THSAFE_BATCH_OP_WRITE_32, I2C_PROTO_TXR_W(data [i]), 0);
+
+            /* if this is the last byte, then stop transfer, unless the
+             * caller wants a repeated start */
+            i2c_data = (last && i2c_proto->mode == I2C_MODE_NORMAL) ?
+                I2C_PROTO_CR_STO | I2C_PROTO_CR_WR : I2C_PROTO_CR_WR;
+            ack_ops [num_ack_ops++] = _i2c_batch_add_cmd (ops, &num_ops,
+                    i2c_proto->base, i2c_data);
         }
         else {
-            i2c_data = I2C_PROTO_CR_WR;
+            /* NACK and stop after the last byte */
+            i2c_data = last ?
+                I2C_PROTO_CR_STO | I2C_PROTO_CR_RD | I2C_PROTO_CR_ACK :
+                I2C_PROTO_CR_RD & ~I2C_PROTO_CR_ACK;
+            _i2c_batch_add_cmd (ops, &num_ops, i2c_proto->base, i2c_data);
+
+            rx_ops [i] = num_ops;
+            _i2c_batch_add (ops, &num_ops, i2c_proto->base | I2C_PROTO_REG_RXR,
+                    THSAFE_BATCH_OP_READ_32, 0, 0);
         }
+    }
 
-        rw_err = SET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO, CR,
-                /* field = NULL */, MULT_BIT_PARAM, i2c_data /* value */,
-                /* min */, /* max */, NO_CHK_FUNC, SET_FIELD);
-        ASSERT_TEST(rw_err == RW_OK, "Could not set I2C CR register", err_exit, -1);
-        DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-                "[sm_pr:i2c] _i2c_write_generic: CR register #%u = 0x%08X\n", i, i2c_data);
-
-        /* Check transfer */
-        err = _i2c_check_transfer (self, true);
-        ASSERT_TEST(err == 0, "Could not check I2C transfer", err_exit, -1);
-        num_bytes++;
+    ssize_t batch_bytes = smio_thsafe_client_batch (parent, ops, num_ops);
+    ASSERT_TEST(batch_bytes >= 0 && (size_t) batch_bytes == num_ops*sizeof (*ops),
+            "Could not execute I2C transfer", err_exit, -1);
+
+    /* Check RX ACK (should be 0) of the address and of every byte written */
+    for (i = 0; i < num_ack_ops; ++i) {
+        ASSERT_TEST((ops [ack_ops [i]].value & I2C_PROTO_SR_RXACK) == 0,
+                "RX Ack should be 0", err_exit, -1);
+    }
+
+    if (rw) {
+        for (i = 0; i < trans_size; ++i) {
+            data [i] = I2C_PROTO_RXR_R(ops [rx_ops [i]].value);
+            DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
+                    "[sm_pr:i2c] _i2c_transfer: RXR register #%u = 0x%02X\n", i, data [i]);
+        }
     }
 
+    num_bytes = trans_size;
+
     /* Transmission done */
     DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_write_generic: Transmission done\n");
+            "[sm_pr:i2c] _i2c_transfer: Transmission done\n");
 
     err = num_bytes;
 
-err_inv_size:
 err_exit:
 err_proto_handler:
+err_inv_size:
     return err;
 }
 
+/* Generic write to I2C */
+static ssize_t _i2c_write_generic (smpr_t *self, uint8_t *data,
+        size_t size, uint32_t flags)
+{
+    return _i2c_transfer (self, data, size, flags, false /* write mode */);
+}
+
 /* Generic read from I2C */
 static ssize_t _i2c_read_generic (smpr_t *self, uint8_t *data,
         size_t size, uint32_t flags)
 {
-    assert (self);
-
-    ssize_t err = 0;
-    ssize_t num_bytes = 0;
-    RW_REPLY_TYPE rw_err = RW_OK;
-    ASSERT_TEST(size*SMPR_BYTE_2_BIT /* bits */ <
-            SMPR_PROTO_I2C_TRANS_SIZE_FLAGS_MAX+1, "Invalid size for I2C transfer",
-            err_inv_size, -1);
-
-    smio_t *parent = smpr_get_parent (self);
-    smpr_proto_i2c_t *i2c_proto = smpr_get_handler (self);
-    ASSERT_TEST(i2c_proto != NULL, "Could not get SMPR protocol handler",
-            err_proto_handler, -1);
-
-    err = _i2c_read_write_header (self, flags, true /* read mode*/);
-    ASSERT_TEST(err > 0, "Could not write I2C header", err_exit, -1);
-
-    /* Set I2C mode: NORMAL, REP_START */
-    _i2c_set_mode (self, flags);
-
-    uint32_t trans_size = SMPR_PROTO_I2C_TRANS_SIZE_FLAGS_R(flags)/SMPR_BYTE_2_BIT; /* in bytes */
-    ASSERT_TEST(trans_size*SMPR_BYTE_2_BIT /* bits */ <
-            SMPR_PROTO_I2C_TRANS_SIZE_FLAGS_MAX+1, "Invalid transfer size for I2C",
-            err_inv_size, -1);
-
-    if (trans_size != size) {
-        DBE_DEBUG (DBG_SM_PR | DBG_LVL_WARN,
-                "[sm_pr:i2c] _i2c_read_generic: Data size differs from Transfer size.\n"
-                "\tChoosing the smallest value between trans_size (%u) and size (%lu)\n", trans_size, size);
-    }
-
-    /* Choose the smallest one */
-    trans_size = (trans_size > size) ? size : trans_size;
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_read_generic: Transmission size = %u bytes\n", trans_size);
-
-    /* Receive data, byte by byte*/
-    uint32_t i;
-    for (i = 0; i < trans_size; ++i) {
-        /* if this is the last byte, then stop transfer */
-        uint32_t i2c_data;
-        if (i == trans_size - 1) {
-            i2c_data = I2C_PROTO_CR_STO | I2C_PROTO_CR_RD | I2C_PROTO_CR_ACK;
-        }
-        else {
-            i2c_data = I2C_PROTO_CR_RD & ~I2C_PROTO_CR_ACK;
-        }
+    return _i2c_transfer (self, data, size, flags, true /* read mode */);
+}
 
-        rw_err = SET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO, CR,
-                /* field = NULL */, MULT_BIT_PARAM, i2c_data /* value */,
-                /* min */, /* max */, NO_CHK_FUNC, SET_FIELD);
-        ASSERT_TEST(rw_err == RW_OK, "Could not set I2C CR register", err_exit, -1);
-        DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-                "[sm_pr:i2c] _i2c_read_generic: CR register #%u = 0x%08X\n", i, i2c_data);
-
-        /* Check transfer */
-        err = _i2c_check_transfer (self, false /* read mode */);
-        ASSERT_TEST(err == 0, "Could not check I2C transfer", err_exit, -1);
-
-        /* Copy data to user */
-        rw_err = GET_PARAM(parent, sm_pr_i2c, i2c_proto->base, I2C_PROTO, RXR,
-                /* field = NULL */, MULT_BIT_PARAM, *(data + i) /* value */,
-                NO_FMT_FUNC);
-        ASSERT_TEST(rw_err == RW_OK, "Could not rget I2C RXR register", err_exit, -1);
-        DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-                "[sm_pr:i2c] _i2c_read_generic: RXR register #%u = 0x%08X\n", i, *(data+i));
-
-        num_bytes++;
-    }
+static void _i2c_batch_add (thsafe_batch_op_t *ops, uint32_t *num_ops,
+        uint64_t offset, uint32_t op, uint32_t value, uint32_t mask)
+{
+    assert (*num_ops < SM_PR_I2C_BATCH_MAX_OPS);
+
+    ops [*num_ops] = (thsafe_batch_op_t) {
+        .offset = offset,
+        .op = op,
+        .value = value,
+        .mask = mask
+    };
+    ++*num_ops;
+}
 
-    /* Transmission done */
+/* Issue a command and wait for it to complete. Returns the index of the
+ * poll operation, whose value ends up being the status register */
+static uint32_t _i2c_batch_add_cmd (thsafe_batch_op_t *ops, uint32_t *num_ops,
+        uint64_t base, uint32_t cmd)
+{
+    _i2c_batch_add (ops, num_ops, base | I2C_PROTO_REG_CR,
+            THSAFE_BATCH_OP_WRITE_32, cmd, 0);
     DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:i2c] _i2c_read_generic: Transmission done\n");
-
-    err = num_bytes;
+            "[sm_pr:i2c] _i2c_batch_add_cmd: CR register = 0x%08X\n", cmd);
 
-err_inv_size:
-err_exit:
-err_proto_handler:
-    return err;
+    uint32_t poll_op = *num_ops;
+    _i2c_batch_add (ops, num_ops, base | I2C_PROTO_REG_SR,
+            THSAFE_BATCH_OP_POLL_32, 0 /* TIP cleared */, I2C_PROTO_SR_TIP);
+    return poll_op;
 }
 
 #if 0
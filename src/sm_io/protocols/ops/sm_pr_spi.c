@@ -14,6 +14,8 @@
  *                 MOSI line)
  */
 
+#include <pthread.h>
+
 #include "bpm_server.h"
 
 /* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
@@ -39,34 +41,64 @@
     CHECK_HAL_ERR(err, SM_PR, "[sm_pr:spi]",                    \
             smpr_err_str (err_type))
 
-#define SM_PR_SPI_MAX_TRIES                 10
-#define SM_PR_SPI_USLEEP                    1000
+/* Give up on a transfer after its expected time plus this */
+#define SM_PR_SPI_TIMEOUT_NS                10000000ULL
+/* SS, CHARLEN (2 for bidir), TX registers and GO_BSY */
+#define SM_PR_SPI_BATCH_MAX_OPS             (SPI_PROTO_REG_RXTX_NUM + 4)
+
+/* Last configuration programmed to a SPI core. Several chips can sit on the
+ * same core (e.g. the ADCs of the FMC250M), each one with its own protocol
+ * handler, so this is shared by all of the handlers of a core */
+typedef struct _smpr_proto_spi_core_t {
+    smio_t *parent;             /* SMIO the core is accessed through */
+    uint64_t base;              /* Core base address */
+    uint32_t refcount;          /* Number of handlers using this core */
+    bool valid;                 /* The fields below match the hardware */
+    uint32_t ss;                /* Selected slave */
+    uint32_t charlen;           /* Character length, as programmed */
+    bool bidir;                 /* Charlen is in the CFG_BIDIR register */
+    struct _smpr_proto_spi_core_t *next;
+} smpr_proto_spi_core_t;
 
 /* Device endpoint */
 typedef struct {
     uint64_t base;              /* Core base address */
+    smpr_proto_spi_core_t *core;    /* Shared core state */
     uint32_t sys_freq;          /* System clock [Hz] */
     uint32_t spi_freq;          /* SPI clock [Hz] */
     uint32_t init_config;       /* SPI initial config register */
     bool bidir;                 /* SPI bidirectional control enable */
 } smpr_proto_spi_t;
 
+/* All of the SPI cores in use. The list is only changed when opening and
+ * releasing the protocol, but the SMIOs do that from their own threads */
+static smpr_proto_spi_core_t *_spi_cores = NULL;
+static pthread_mutex_t _spi_cores_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static smpr_proto_spi_core_t *_spi_core_get (smio_t *parent, uint64_t base);
+static void _spi_core_put (smpr_proto_spi_core_t **core_p);
 static smpr_err_e _spi_init (smpr_t *self);
 static ssize_t _spi_read_write_generic (smpr_t *self, uint8_t *data,
         size_t size, spi_mode_e mode, uint32_t flags);
+static void _spi_batch_add (thsafe_batch_op_t *ops, uint32_t *num_ops,
+        uint64_t offset, uint32_t op, uint32_t value, uint32_t mask);
 
 /************ Our methods implementation **********/
 
 /* Creates a new instance of the proto_spi */
-static smpr_proto_spi_t * smpr_proto_spi_new (uint64_t base)
+static smpr_proto_spi_t * smpr_proto_spi_new (smio_t *parent, uint64_t base)
 {
     smpr_proto_spi_t *self = (smpr_proto_spi_t *) zmalloc (sizeof *self);
     ASSERT_ALLOC (self, err_smpr_proto_spi_alloc);
 
     self->base = base;
+    self->core = _spi_core_get (parent, base);
+    ASSERT_ALLOC (self->core, err_core_alloc);
 
     return self;
 
+err_core_alloc:
+    free (self);
 err_smpr_proto_spi_alloc:
     return NULL;
 }
@@ -79,6 +111,7 @@ static smpr_err_e smpr_proto_spi_destroy (smpr_proto_spi_t **self_p)
     if (*self_p) {
         smpr_proto_spi_t *self = *self_p;
 
+        _spi_core_put (&self->core);
         free (self);
         self_p = NULL;
     }
@@ -94,7 +127,8 @@ int spi_open (smpr_t *self, uint64_t base, void *args)
     assert (self);
 
     /* Create new spi */
-    smpr_proto_spi_t *spi_proto = smpr_proto_spi_new (base);
+    smpr_proto_spi_t *spi_proto = smpr_proto_spi_new (smpr_get_parent (self),
+            base);
     ASSERT_TEST(spi_proto != NULL, "Could not allocate proto_handler",
             err_proto_handler_alloc);
 
@@ -237,6 +271,56 @@ ssize_t spi_write_block (smpr_t *self, uint64_t offs, size_t size, const uint32_
 }
 
 /************ Static functions **********/
+
+/* Get the shared state of the core at "base", creating it if needed */
+static smpr_proto_spi_core_t *_spi_core_get (smio_t *parent, uint64_t base)
+{
+    pthread_mutex_lock (&_spi_cores_lock);
+
+    smpr_proto_spi_core_t *core = _spi_cores;
+    while (core != NULL && (core->parent != parent || core->base != base)) {
+        core = core->next;
+    }
+
+    if (core == NULL) {
+        core = (smpr_proto_spi_core_t *) zmalloc (sizeof *core);
+        if (core != NULL) {
+            core->parent = parent;
+            core->base = base;
+            core->next = _spi_cores;
+            _spi_cores = core;
+        }
+    }
+
+    if (core != NULL) {
+        core->refcount++;
+    }
+
+    pthread_mutex_unlock (&_spi_cores_lock);
+    return core;
+}
+
+static void _spi_core_put (smpr_proto_spi_core_t **core_p)
+{
+    assert (core_p);
+
+    if (*core_p) {
+        smpr_proto_spi_core_t *core = *core_p;
+
+        pthread_mutex_lock (&_spi_cores_lock);
+        if (--core->refcount == 0) {
+            smpr_proto_spi_core_t **pp = &_spi_cores;
+            while (*pp != core) {
+                pp = &(*pp)->next;
+            }
+            *pp = core->next;
+            free (core);
+        }
+        pthread_mutex_unlock (&_spi_cores_lock);
+
+        *core_p = NULL;
+    }
+}
 static smpr_err_e _spi_init (smpr_t *self)
 {
     assert (self);
@@ -273,9 +357,10 @@ static smpr_err_e _spi_init (smpr_t *self)
             err_exit, SMPR_ERR_RW_SMIO);
 #endif
 
-    /* Configure config register */
+    /* Configure config register. This overwrites the character length */
     DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
             "[sm_pr:spi] SPI config register = 0x%08X\n", spi_proto->init_config);
+    spi_proto->core->valid = false;
     rw_err = SET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO, CTRL, /* field = NULL */,
             MULT_BIT_PARAM, /* value */ spi_proto->init_config, /* min */, /* max */,
             NO_CHK_FUNC, SET_FIELD);
@@ -316,24 +401,20 @@ static ssize_t _spi_read_write_generic (smpr_t *self, uint8_t *data,
     ASSERT_TEST(spi_proto != NULL, "Could not get SMPR protocol handler",
             err_proto_handler, -1);
 
-    uint32_t config;
-    rw_err = GET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO,
-            CTRL, /* field = NULL */, MULT_BIT_PARAM, config, NO_FMT_FUNC);
-    ASSERT_TEST(rw_err == RW_OK, "Could not get CONFIG parameter", err_exit, -1);
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:spi] _spi_rw_generic: Config register = 0x%08X\n", config);
-
     /* Decode flags */
     uint32_t ss = SMPR_PROTO_SPI_SS_FLAGS_R(flags);
     uint32_t charlen = SMPR_PROTO_SPI_CHARLEN_FLAGS_R(flags);
-
-    /* Configure SS line */
-    rw_err = SET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO, SS, /* field = NULL */,
-            MULT_BIT_PARAM, /* value */ ss, /* min */, /* max */,
-            NO_CHK_FUNC, SET_FIELD);
-    ASSERT_TEST(rw_err == RW_OK, "Could not set SS parameter", err_exit, -1);
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:spi] _spi_rw_generic: SS register = 0x%08X\n", ss);
+    /* One SPI clock cycle per bit. 0 stands for the full 128-bit word */
+    uint32_t num_bits = (charlen == 0) ?
+        SPI_PROTO_REG_RXTX_NUM * SMPR_WB_REG_2_BIT : charlen;
+    uint64_t expected_ns = (uint64_t) num_bits * 1000000000ULL /
+        spi_proto->spi_freq;
+
+    /* Check the TX data size before touching anything, as the whole transfer
+     * is issued at once below */
+    ASSERT_TEST(!(mode == SPI_MODE_WRITE || mode == SPI_MODE_WRITE_READ) ||
+            size % SMPR_WB_REG_2_BYTE == 0,
+            "Could not write everything to TX registers", err_exit, -1);
 
     /* Configure character length. For the opencores SPI,
      * 0 is 128-bit data word, 1 is 1 bit, 2 is 2-bit and so on */
@@ -341,65 +422,88 @@ static ssize_t _spi_read_write_generic (smpr_t *self, uint8_t *data,
         charlen = 0;
     }
 
+    /* Configure the SS line and the character length, write the TX registers
+     * and start the transfer with a single batch, so we don't pay a DEVIO
+     * round trip for each one of these register accesses */
+    thsafe_batch_op_t ops [SM_PR_SPI_BATCH_MAX_OPS];
+    uint32_t num_ops = 0;
+
+    /* Consecutive transfers usually go to the same slave with the same
+     * length, so only program what changed since the last transfer */
+    smpr_proto_spi_core_t *core = spi_proto->core;
+    bool ss_changed = !core->valid || core->ss != ss;
+    bool charlen_changed = !core->valid || core->charlen != charlen ||
+        core->bidir != spi_proto->bidir;
+
+    if (ss_changed) {
+        _spi_batch_add (ops, &num_ops, spi_proto->base | SPI_PROTO_REG_SS,
+                THSAFE_BATCH_OP_WRITE_MASK_32, SPI_PROTO_SS_W(ss), SPI_PROTO_SS_MASK);
+        DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
+                "[sm_pr:spi] _spi_rw_generic: SS register = 0x%08X\n", ss);
+    }
+
     /* If we are using the reguler four-mode SPI, the character length register
      * used if the regular SPI_PROTO_REG_CTRL. Otherwise, it is the 7 LSB of
      * SPI_PROTO_REG_CFG_BIDIR */
-    if (!spi_proto->bidir) {
-        rw_err = SET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO, CTRL, CHARLEN,
-                MULT_BIT_PARAM, /* value */ charlen, /* min */ , /* max */,
-                NO_CHK_FUNC, SET_FIELD);
+    if (charlen_changed && !spi_proto->bidir) {
+        _spi_batch_add (ops, &num_ops, spi_proto->base | SPI_PROTO_REG_CTRL,
+                THSAFE_BATCH_OP_WRITE_MASK_32, SPI_PROTO_CTRL_CHARLEN_W(charlen),
+                SPI_PROTO_CTRL_CHARLEN_MASK);
     }
-    else {
-        rw_err = SET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO, CFG_BIDIR, CHARLEN,
-                MULT_BIT_PARAM, /* value */ charlen, /* min */ , /* max */,
-                NO_CHK_FUNC, SET_FIELD);
-        rw_err |= SET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO, CFG_BIDIR, EN,
-                SINGLE_BIT_PARAM, /* value */ 0x1, /* min */ , /* max */,
-                NO_CHK_FUNC, SET_FIELD);
+    else if (charlen_changed) {
+        _spi_batch_add (ops, &num_ops, spi_proto->base | SPI_PROTO_REG_CFG_BIDIR,
+                THSAFE_BATCH_OP_WRITE_MASK_32, SPI_PROTO_CFG_BIDIR_CHARLEN_W(charlen),
+                SPI_PROTO_CFG_BIDIR_CHARLEN_MASK);
+        _spi_batch_add (ops, &num_ops, spi_proto->base | SPI_PROTO_REG_CFG_BIDIR,
+                THSAFE_BATCH_OP_WRITE_MASK_32, SPI_PROTO_CFG_BIDIR_EN,
+                SPI_PROTO_CFG_BIDIR_EN);
+    }
+    if (charlen_changed) {
+        DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
+                "[sm_pr:spi] _spi_rw_generic: Charecter Length = 0x%08X, Bidir = 0x%08X\n",
+                charlen, spi_proto->bidir);
     }
-    ASSERT_TEST(rw_err == RW_OK, "Could not set CHARLEN/BIDIR parameter", err_exit, -1);
-    DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-            "[sm_pr:spi] _spi_rw_generic: Charecter Length = 0x%08X, Bidir = 0x%08X\n",
-            charlen, spi_proto->bidir);
 
     /* Write data to TX regs */
     if (mode == SPI_MODE_WRITE || mode == SPI_MODE_WRITE_READ) {
         /* Copy data to temp */
-        uint8_t data_write[SPI_PROTO_REG_RXTX_NUM * SMPR_WB_REG_2_BYTE] = {0};
+        uint32_t data_write[SPI_PROTO_REG_RXTX_NUM] = {0};
         memcpy (data_write, data, size);
 
         uint32_t i;
         /* We write 32-bit at a time */
-
         for (i = 0; i < size/SMPR_WB_REG_2_BYTE; ++i) {
-            /* As the TXs are just a single register, we write using the SMIO
-             * functions directly */
             DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
                     "[sm_pr:spi] _spi_rw_generic: Writing 0x%08X to TX%u\n",
-                    *((uint32_t *) (data_write + SMPR_WB_REG_2_BYTE*i)), i);
-            num_bytes = smio_thsafe_client_write_32 (parent,
+                    data_write[i], i);
+            _spi_batch_add (ops, &num_ops,
                     (spi_proto->base | SPI_PROTO_REG_TX0) + i*SMPR_WB_REG_2_BYTE,
-                    (uint32_t *) (data_write + SMPR_WB_REG_2_BYTE*i));
-            err += (num_bytes == -1) ? 0 : num_bytes;
-            ASSERT_TEST(num_bytes != -1, "Could not set TX register", err_exit);
+                    THSAFE_BATCH_OP_WRITE_32, data_write[i], 0);
         }
-
-        /* Return error if we could not write everything */
-        ASSERT_TEST(err >= 0 && (size_t) err == size,
-                "Could not write everything to TX registers", err_exit, -1);
     }
 
     /* Start transfer */
-    rw_err = SET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO, CTRL, GO_BSY,
-            SINGLE_BIT_PARAM, /* value */ 1, /* min */, /* max */,
-            NO_CHK_FUNC, SET_FIELD);
-    ASSERT_TEST(rw_err == RW_OK, "Could not set parameter", err_exit, -1);
+    _spi_batch_add (ops, &num_ops, spi_proto->base | SPI_PROTO_REG_CTRL,
+            THSAFE_BATCH_OP_WRITE_MASK_32, SPI_PROTO_CTRL_GO_BSY,
+            SPI_PROTO_CTRL_GO_BSY);
+
+    /* We don't know how much of the batch made it to the hardware if it
+     * fails */
+    core->valid = false;
+    num_bytes = smio_thsafe_client_batch (parent, ops, num_ops);
+    ASSERT_TEST(num_bytes >= 0 && (size_t) num_bytes == num_ops*sizeof (*ops),
+            "Could not configure and start the transfer", err_exit, -1);
+    core->valid = true;
+    core->ss = ss;
+    core->charlen = charlen;
+    core->bidir = spi_proto->bidir;
     DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
             "[sm_pr:spi] _spi_rw_generic: Transfer started\n");
 
     /* Check for completion */
     uint32_t busy = 0;
-    uint32_t tries = 0;
+    smpr_wait_t wait;
+    smpr_wait_init (&wait, expected_ns, expected_ns + SM_PR_SPI_TIMEOUT_NS);
     while (1) {
         rw_err = GET_PARAM(parent, sm_pr_spi, spi_proto->base, SPI_PROTO,
                 CTRL, BSY, SINGLE_BIT_PARAM, busy, NO_FMT_FUNC);
@@ -409,9 +513,7 @@ static ssize_t _spi_read_write_generic (smpr_t *self, uint8_t *data,
             break;
         }
 
-        usleep (SM_PR_SPI_USLEEP);
-        ++tries;
-        ASSERT_TEST(tries < SM_PR_SPI_MAX_TRIES, "Transfer timeout", err_exit, -1);
+        ASSERT_TEST(smpr_wait_next (&wait), "Transfer timeout", err_exit, -1);
     }
 
     DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
@@ -422,26 +524,34 @@ static ssize_t _spi_read_write_generic (smpr_t *self, uint8_t *data,
 
     /* Read data from RX regsiters */
     uint32_t i;
-    uint8_t data_read[SPI_PROTO_REG_RXTX_NUM * SMPR_WB_REG_2_BYTE] = {0};
+    uint32_t data_read[SPI_PROTO_REG_RXTX_NUM] = {0};
     /* If we are using Bidirectional SPI, the receved data is located on base address 
      * SPI_PROTO_REG_RX0. Otherwise, the data is on a different register 
      * SPI_PROTO_REG_RX0_SINGLE */
     uint32_t read_base_addr = (spi_proto->bidir) ? SPI_PROTO_REG_RX0 : SPI_PROTO_REG_RX0_SINGLE;
-    /* We read 32-bit at a time */
+    /* We read 32-bit at a time, all of them in a single batch */
+    num_ops = 0;
     for (i = 0; i < size/SMPR_WB_REG_2_BYTE; ++i) {
         DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
                 "[sm_pr:spi] _spi_rw_generic: Reading from RX%u\n", i);
-        /* As the RXs are just a single register, we write using the SMIO
-         * functions directly */
-            num_bytes = smio_thsafe_client_read_32 (parent,
-                    (spi_proto->base | read_base_addr) + SMPR_WB_REG_2_BYTE*i,
-                    (uint32_t *)(data_read + SMPR_WB_REG_2_BYTE*i));
-        DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
-                "[sm_pr:spi] _spi_rw_generic: Read 0x%08X from RX%u\n",
-                *((uint32_t *) (data_read + SMPR_WB_REG_2_BYTE*i)), i);
-        err += (num_bytes == -1) ? 0 : num_bytes;
+        _spi_batch_add (ops, &num_ops,
+                (spi_proto->base | read_base_addr) + SMPR_WB_REG_2_BYTE*i,
+                THSAFE_BATCH_OP_READ_32, 0, 0);
+    }
+
+    if (num_ops > 0) {
+        num_bytes = smio_thsafe_client_batch (parent, ops, num_ops);
+        ASSERT_TEST(num_bytes >= 0 && (size_t) num_bytes == num_ops*sizeof (*ops),
+                "Could not read RX registers", err_exit, -1);
+
+        for (i = 0; i < num_ops; ++i) {
+            data_read[i] = ops[i].value;
+            DBE_DEBUG (DBG_SM_PR | DBG_LVL_TRACE,
+                    "[sm_pr:spi] _spi_rw_generic: Read 0x%08X from RX%u\n",
+                    data_read[i], i);
+        }
         /* Return the number of bytes effectively read */
-        ASSERT_TEST(num_bytes != -1, "Could not set RX regsiter", err_exit);
+        err = num_ops*SMPR_WB_REG_2_BYTE;
     }
 
     /* TODO: Reduce the ammount of memcpy () throughout this simple code*/
@@ -453,6 +563,21 @@ err_proto_handler:
     return err;
 }
 
+/* Append a register operation to a batch */
+static void _spi_batch_add (thsafe_batch_op_t *ops, uint32_t *num_ops,
+        uint64_t offset, uint32_t op, uint32_t value, uint32_t mask)
+{
+    assert (*num_ops < SM_PR_SPI_BATCH_MAX_OPS);
+
+    ops [*num_ops] = (thsafe_batch_op_t) {
+        .offset = offset,
+        .op = op,
+        .value = value,
+        .mask = mask
+    };
+    ++*num_ops;
+}
+
 const smpr_proto_ops_t smpr_proto_ops_spi = {
     .proto_open           = spi_open,           /* Open device */
     .proto_release        = spi_release,        /* Release device */
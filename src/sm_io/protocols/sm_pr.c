@@ -48,6 +48,7 @@ struct _smpr_t {
 static smpr_err_e _smpr_register_proto_ops (smpr_type_e type,
         const smpr_proto_ops_t **ops);
 static smpr_err_e _smpr_unregister_proto_ops (const smpr_proto_ops_t **ops);
+static uint64_t _smpr_now_ns (void);
 
 /* Creates a new instance of the Low-level I/O */
 smpr_t * smpr_new (char *name, smio_t *parent, smpr_type_e type, int verbose)
@@ -148,8 +149,51 @@ smio_t *smpr_get_parent (smpr_t *self)
     return self->parent;
 }
 
+void smpr_wait_init (smpr_wait_t *self, uint64_t expected_ns, uint64_t timeout_ns)
+{
+    assert (self);
+
+    self->start_ns = _smpr_now_ns ();
+    self->spin_ns = expected_ns + SMPR_WAIT_SPIN_MARGIN_NS;
+    self->timeout_ns = (timeout_ns > self->spin_ns) ? timeout_ns : self->spin_ns;
+    self->sleep_us = SMPR_WAIT_SLEEP_MIN_US;
+}
+
+bool smpr_wait_next (smpr_wait_t *self)
+{
+    assert (self);
+
+    uint64_t elapsed_ns = _smpr_now_ns () - self->start_ns;
+    if (elapsed_ns >= self->timeout_ns) {
+        return false;
+    }
+
+    /* The transfer is most likely not done yet. Sleeping here would cost
+     * far more than the transfer itself */
+    if (elapsed_ns < self->spin_ns) {
+        return true;
+    }
+
+    usleep (self->sleep_us);
+    if (self->sleep_us < SMPR_WAIT_SLEEP_MAX_US) {
+        self->sleep_us *= 2;
+        if (self->sleep_us > SMPR_WAIT_SLEEP_MAX_US) {
+            self->sleep_us = SMPR_WAIT_SLEEP_MAX_US;
+        }
+    }
+
+    return true;
+}
+
 /**************** Helper Functions ***************/
 
+static uint64_t _smpr_now_ns (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
 /* Register Specific Protocol operations to smpr instance. Helper function */
 static smpr_err_e _smpr_register_proto_ops (smpr_type_e type, const smpr_proto_ops_t **ops)
 {
@@ -36,3 +36,77 @@ uint32_t check_param_limits (uint32_t value, uint32_t min, uint32_t max) {
     }
     return PARAM_OK;
 }
+
+int rw_param_set_get (void *owner, void *args, void *ret,
+        const rw_param_desc_t *desc)
+{
+    assert (owner);
+    assert (args);
+    assert (desc);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    /* Message is:
+     * frame 0: operation code
+     * frame 1: rw      R /W    1 = read mode, 0 = write mode
+     * frame 2: channel (0 to num_channels -1), if desc->chan_num != 0
+     * frame 3: value to be written (rw = 0) or dummy value (rw = 1) */
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint64_t addr = desc->addr;
+    if (desc->chan_num != 0) {
+        uint32_t chan = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+        if (chan >= desc->chan_num) {
+            return -RW_INV;
+        }
+        addr += chan*desc->chan_offset;
+    }
+    uint32_t value = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:rw_param] SET_GET_PARAM: "
+            "rw = %u, address 0x%"PRIx64"\n", rw, smio_get_base (self) | addr);
+
+    uint32_t reg = 0;
+    ssize_t rw_ret = smio_thsafe_client_read_32 (self, addr, &reg);
+    if (rw_ret != sizeof (reg)) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:rw_param] SET_GET_PARAM: "
+                "Could not read from address 0x%"PRIx64"\n",
+                smio_get_base (self) | addr);
+        return rw ? -RW_READ_EAGAIN : -RW_WRITE_EAGAIN;
+    }
+
+    if (rw) {
+        value = desc->single_bit ?
+            ((reg & desc->mask) ? BIT_SET : BIT_CLR) :
+            (reg & desc->mask) >> desc->shift;
+        if (desc->fmt_funcp != NULL) {
+            desc->fmt_funcp (&value);
+        }
+
+        *(uint32_t *) ret = value;
+        return sizeof (value);
+    }
+
+    if ((desc->check_lim && check_param_limits (value, desc->min,
+                    desc->max) != PARAM_OK) ||
+            (desc->chk_funcp != NULL && desc->chk_funcp (value) != PARAM_OK)) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io:rw_param] SET_GET_PARAM: "
+                "invalid parameter: 0x%08x\n", value);
+        return -RW_USR_ERR;
+    }
+
+    reg &= ~desc->mask;
+    if (!desc->clr_field) {
+        reg |= desc->single_bit ? (value ? desc->mask : 0) :
+            (value << desc->shift) & desc->mask;
+    }
+
+    rw_ret = smio_thsafe_client_write_32 (self, addr, &reg);
+    if (rw_ret != sizeof (reg)) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io:rw_param] SET_GET_PARAM: "
+                "Could not write to address 0x%"PRIx64"\n",
+                smio_get_base (self) | addr);
+        return -RW_WRITE_EAGAIN;
+    }
+
+    smio_set_param_changed (self);
+    return -RW_OK;
+}
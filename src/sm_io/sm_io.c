@@ -42,18 +42,35 @@ struct _smio_t {
     uint64_t base;                      /* Base SMIO address */
     char *name;                         /* Identification of this sm_io instance */
     char *service;                      /* Exported service name */
+    const char *cfg_file;               /* Configuration file. Owned by the
+                                           parent. NULL if none */
     /* int verbose; */                  /* Print activity to stdout */
     mlm_client_t *worker;               /* zeroMQ Malamute client (worker) */
+    zsock_t *local_sock;                /* ROUTER socket of the local fast path,
+                                           see RW_LOCAL_ENDP_SEP. NULL if the
+                                           broker is not an ipc endpoint */
     devio_t *parent;                    /* Pointer back to parent dev_io */
     void *smio_handler;                 /* Generic pointer to a device handler. This
                                             must be cast to a specific type by the
                                             devices functions */
     zloop_t *loop;                      /* Reactor for server sockets */
+    bool shared_loop;                   /* Reactor is shared with other SMIOs
+                                           and owned by the caller */
     zsock_t *pipe_mgmt;                 /* Pipe back to parent to exchange Management messages */
     zsock_t *pipe_msg;                  /* Pipe back to parent to exchange Payload messages */
+    thsafe_ring_t *ring;                /* Ring to parent for single register accesses. Owned
+                                           by the parent */
+    llio_t *llio;                       /* Device for direct single register accesses.
+                                           Owned by the parent. NULL if none */
+    bool posted_writes;                 /* Register writes don't wait for the
+                                           DEVIO, see smio_set_posted_writes () */
     zsock_t *pipe_frontend;             /* Force zloop to interrupt and rebuild poll set. This is used to send messages */
     zsock_t *pipe_backend;              /* Force zloop to interrupt and rebuild poll set. This is used to receive messages */
     int timer_id;                       /* Timer ID */
+    smio_tasks_t *tasks;                /* Periodic tasks run by the loop */
+    int poll_task_id;                   /* Task calling the "poll" operation.
+                                           -1 if there is none */
+    smio_fairq_t *fairq;                /* Requests waiting to be served */
 
     /* Specific SMIO operations dispatch table for exported operations */
     disp_table_t *exp_ops_dtable;
@@ -67,15 +84,45 @@ struct _smio_t {
      * ones available in llio, changing the llio_t self pointer to a void
      * pointer (socket to parent thread) */
     const smio_thsafe_client_ops_t *thsafe_client_ops;
+    /* Shadow register cache. NULL if the SMIO did not register any
+     * cacheable region */
+    smio_cache_t *cache;
+    /* Per-opcode counters and latency histograms of the exported
+     * operations */
+    msg_stats_t *exp_stats;
+    /* The request being served changed a parameter, see
+     * smio_set_param_changed () */
+    bool param_changed;
+    /* Load metrics, owned by the parent. NULL if none */
+    devio_metrics_node_t *metrics;
+    /* Status page, owned by the parent. NULL if none */
+    smio_status_page_t *status;
+    /* Requests received by the DEVIO before we were spawned, served as
+     * soon as we start. NULL if none */
+    zlistx_t *boot_reqs;
+    /* Information sent along with our directory registration. NULL if
+     * none */
+    void *dir_info;
+    size_t dir_info_size;
+    /* Startup phases, owned by the parent. NULL if none */
+    smio_startup_stats_t *startup;
+    /* Allocations made serving requests, see hutils_mem_acct_attach () */
+    hutils_mem_acct_t *alloc_acct;
+    /* Trace of the requests received, see smio_start_trace (). NULL if
+     * none */
+    smio_trace_t *trace;
+    /* When we were spawned, as zclock_usecs () */
+    int64_t start_us;
 };
 
 /* SMIO dispatch table operations */
 const disp_table_ops_t smio_disp_table_ops;
 
 static smio_err_e _smio_do_op (void *owner, void *msg);
+static int _smio_get_op_stats (void *owner, void *args, void *ret);
 /* Dispatch table message check handler */
 static disp_table_err_e _smio_check_msg_args (disp_table_t *disp_table,
-        const disp_op_t *disp_op, void *args);
+        const disp_op_t *disp_op, const disp_op_sig_t *sig, void *args);
 static smio_err_e _smio_set_name (smio_t *self, const char *name);
 static const char *_smio_get_name (smio_t *self);
 static char *_smio_clone_name (smio_t *self);
@@ -84,6 +131,33 @@ static smio_err_e _smio_engine_handle_socket (smio_t *smio, void *sock,
         zloop_reader_fn handler);
 static int _smio_handle_timer (zloop_t *loop, int timer_id, void *arg);
 static int _smio_handle_pipe_backend (zloop_t *loop, zsock_t *reader, void *args);
+static zsock_t *_smio_local_bind (const char *broker, const char *service);
+static int _smio_serve_requests (smio_t *smio);
+static int _smio_queue_requests (smio_t *smio);
+static void _smio_queue_request (smio_t *smio, smio_fairq_req_t **req_p);
+static void _smio_serve_request (smio_t *smio, smio_fairq_req_t *req);
+static void _smio_ack_request (smio_t *smio, smio_fairq_req_t *req);
+static bool _smio_serve_one (smio_t *smio, smio_fairq_req_t *req,
+        exp_msg_zmq_t *followers, size_t num_followers);
+static void _smio_fairq_wake (void *owner);
+static int _smio_set_get_rate_limit (void *owner, void *args, void *ret);
+static int _smio_get_queue_stats (void *owner, void *args, void *ret);
+static int _smio_batch (void *owner, void *args, void *ret);
+static int _smio_get_startup_stats (void *owner, void *args, void *ret);
+static int _smio_get_alloc_stats (void *owner, void *args, void *ret);
+static int _smio_ping (void *owner, void *args, void *ret);
+
+/* Generic exported function pointers. Same order as smio_generic_exp_ops */
+static const disp_table_func_fp smio_generic_exp_fp [] = {
+    _smio_get_op_stats,
+    _smio_set_get_rate_limit,
+    _smio_get_queue_stats,
+    _smio_batch,
+    _smio_get_startup_stats,
+    _smio_get_alloc_stats,
+    _smio_ping,
+    NULL
+};
 
 /* Boot new SMIO instance. Better used as a thread (CZMQ actor) init function */
 smio_t *smio_new (th_boot_args_t *args, zsock_t *pipe_mgmt,
@@ -104,17 +178,36 @@ smio_t *smio_new (th_boot_args_t *args, zsock_t *pipe_mgmt,
     self->exp_ops_dtable = disp_table_new (&smio_disp_table_ops);
     ASSERT_ALLOC(self->exp_ops_dtable, err_exp_ops_dtable_alloc);
 
+    self->exp_stats = msg_stats_new ();
+    ASSERT_ALLOC(self->exp_stats, err_exp_stats_alloc);
+
+    self->alloc_acct = (hutils_mem_acct_t *) zmalloc (sizeof *self->alloc_acct);
+    ASSERT_ALLOC(self->alloc_acct, err_alloc_acct_alloc);
+    self->start_us = zclock_usecs ();
+
     self->smio_handler = NULL;      /* This is set by the device functions */
     self->pipe_mgmt = pipe_mgmt;
     self->pipe_msg = pipe_msg;
+    self->ring = args->ring;
+    self->llio = args->llio;
     self->inst_id = args->inst_id;
+    self->cfg_file = args->cfg_file;
+    self->metrics = args->metrics;
+    self->status = args->status;
+    self->startup = args->startup;
 
     /* Setup pipes for zloop interrupting */
     self->pipe_frontend = zsys_create_pipe (&self->pipe_backend);
     ASSERT_ALLOC(self->pipe_frontend, err_pipe_frontend_alloc);
 
     /* Setup loop */
-    self->loop = zloop_new ();
+    self->shared_loop = (args->loop != NULL);
+    if (self->shared_loop) {
+        self->loop = args->loop;
+    }
+    else {
+        self->loop = zloop_new ();
+    }
     ASSERT_ALLOC(self->loop, err_loop_alloc);
 
     /* Set loop timeout. This is needed to ensure zloop will
@@ -122,6 +215,14 @@ smio_t *smio_new (th_boot_args_t *args, zsock_t *pipe_mgmt,
     self->timer_id = zloop_timer (self->loop, SMIO_POLLER_TIMEOUT, SMIO_POLLER_NTIMES,
         _smio_handle_timer, NULL);
     ASSERT_TEST(self->timer_id != -1, "Could not create zloop timer", err_timer_alloc);
+    self->tasks = smio_tasks_new (self->loop, self);
+    ASSERT_ALLOC(self->tasks, err_tasks_alloc);
+    self->fairq = smio_fairq_new (self->loop, _smio_fairq_wake, self);
+    ASSERT_ALLOC(self->fairq, err_fairq_alloc);
+    /* Poll task is only added if the SMIO asks for it */
+    self->poll_task_id = -1;
+    /* Cache is only created if the SMIO registers a cacheable region */
+    self->cache = NULL;
 
     /* Set-up backend handler for forcing interrupting the zloop and rebuild
      * the poll set. This avoids having to setup a short timer to periodically
@@ -141,19 +242,50 @@ smio_t *smio_new (th_boot_args_t *args, zsock_t *pipe_mgmt,
     int rc = mlm_client_connect (self->worker, args->broker, 1000, service);
     ASSERT_TEST(rc >= 0, "Could not connect MLM to broker", err_mlm_connect);
 
+    /* Events are published on a stream named after our service */
+    char *event_stream = hutils_concat_strings (service, SMIO_EVENT_STREAM_SUFFIX,
+            ':');
+    ASSERT_ALLOC(event_stream, err_event_stream_alloc);
+    rc = mlm_client_set_producer (self->worker, event_stream);
+    free (event_stream);
+    ASSERT_TEST(rc == 0, "Could not set SMIO event stream", err_set_producer);
+    self->param_changed = false;
+
+    /* Clients on the same host might skip the broker. This is optional,
+     * so errors only leave it out */
+    self->local_sock = _smio_local_bind (args->broker, service);
+
+    /* Only taken once nothing can fail, so the caller still owns them
+     * otherwise */
+    self->boot_reqs = args->reqs;
+    args->reqs = NULL;
+
     return self;
 
+err_set_producer:
+err_event_stream_alloc:
 err_mlm_connect:
     mlm_client_destroy (&self->worker);
 err_worker_alloc:
+    smio_fairq_destroy (&self->fairq);
+err_fairq_alloc:
+    smio_tasks_destroy (&self->tasks);
+err_tasks_alloc:
     zloop_timer_end (self->loop, self->timer_id);
 err_timer_alloc:
-    zloop_destroy (&self->loop);
+    _smio_engine_handle_socket (self, self->pipe_backend, NULL);
+    if (!self->shared_loop) {
+        zloop_destroy (&self->loop);
+    }
 err_loop_alloc:
     zsock_destroy (&self->pipe_backend);
     zsock_destroy (&self->pipe_frontend);
 err_pipe_frontend_alloc:
     zsock_destroy (&self->pipe_msg);
+    free (self->alloc_acct);
+err_alloc_acct_alloc:
+    msg_stats_destroy (&self->exp_stats);
+err_exp_stats_alloc:
     disp_table_destroy (&self->exp_ops_dtable);
 err_exp_ops_dtable_alloc:
     free (self->service);
@@ -170,21 +302,47 @@ smio_err_e smio_destroy (smio_t **self_p)
     if (*self_p) {
         smio_t *self = *self_p;
 
+        /* A shared reactor goes on serving other SMIOs, so leave none of
+         * our sockets or timers in it */
+        _smio_engine_handle_socket (self, mlm_client_msgpipe (self->worker), NULL);
+        if (self->local_sock != NULL) {
+            _smio_engine_handle_socket (self, self->local_sock, NULL);
+            zsock_destroy (&self->local_sock);
+        }
+        _smio_engine_handle_socket (self, self->pipe_backend, NULL);
+        /* Requests waiting hold references to the local fast path socket */
+        smio_fairq_destroy (&self->fairq);
+        zlistx_destroy (&self->boot_reqs);
+        smio_trace_destroy (&self->trace);
         mlm_client_destroy (&self->worker);
+        smio_tasks_print_stats (self->tasks, self->service);
+        smio_tasks_destroy (&self->tasks);
         zloop_timer_end (self->loop, self->timer_id);
-        zloop_destroy (&self->loop);
+        if (!self->shared_loop) {
+            zloop_destroy (&self->loop);
+        }
         zsock_destroy (&self->pipe_backend);
         zsock_destroy (&self->pipe_frontend);
         zsock_destroy (&self->pipe_msg);
+        /* Don't leave writes behind on the ring. It is destroyed by
+         * the DEVIO */
+        smio_set_posted_writes (self, false);
+        self->ring = NULL;
+        self->llio = NULL;
         /* Don't destroy pipe_mgmt as this is taken care of by the
          * zactor infrastructure, s_thread_shim (void *args) on CZMQ 
          * 3.0.2 src/zactor.c 
          * zsock_destroy (&self->pipe_mgmt);
          */
+        smio_cache_destroy (&self->cache);
+        msg_stats_print (self->exp_stats, self->service);
+        msg_stats_destroy (&self->exp_stats);
+        free (self->alloc_acct);
         disp_table_destroy (&self->exp_ops_dtable);
         self->thsafe_client_ops = NULL;
         self->ops = NULL;
         self->parent = NULL;
+        free (self->dir_info);
         free (self->service);
         free (self->name);
 
@@ -250,6 +408,21 @@ static int _smio_handle_timer (zloop_t *loop, int timer_id, void *arg)
     return 0;
 }
 
+/* Task calling the "poll" operation */
+static smio_err_e _smio_poll_task (void *owner, void *arg)
+{
+    (void) arg;
+    smio_t *smio = (smio_t *) owner;
+
+    hutils_mem_acct_t *prev_acct = hutils_mem_acct_attach (smio->alloc_acct);
+    uint32_t prev_subsys = hutils_mem_acct_push (HUTILS_MEM_ACCT_HANDLER);
+    smio_err_e err = smio_poll (smio);
+    hutils_mem_acct_pop (prev_subsys);
+    hutils_mem_acct_attach (prev_acct);
+
+    return err;
+}
+
 /* zloop handler for CFG PIPE */
 static int _smio_handle_pipe_mgmt (zloop_t *loop, zsock_t *reader, void *args)
 {
@@ -258,7 +431,6 @@ static int _smio_handle_pipe_mgmt (zloop_t *loop, zsock_t *reader, void *args)
     char *command = NULL;
     /* We expect a smio instance e as reference */
     smio_t *smio = (smio_t *) args;
-    (void) smio;
 
     /* Receive message */
     zmsg_t *recv_msg = zmsg_recv (reader);
@@ -274,6 +446,20 @@ static int _smio_handle_pipe_mgmt (zloop_t *loop, zsock_t *reader, void *args)
         return -1;
     }
 
+    /* New CPU placement of our thread, see devio_update_smio_sched () */
+    if (streq (command, "$SET_SCHED")) {
+        zframe_t *sched_frame = zmsg_pop (recv_msg);
+        if (sched_frame != NULL && zframe_size (sched_frame) == sizeof (hutils_sched_t)) {
+            hutils_sched_t sched;
+            memcpy (&sched, zframe_data (sched_frame), sizeof (sched));
+            hutils_set_thread_sched (&sched, smio->name);
+        }
+        zframe_destroy (&sched_frame);
+        free (command);
+        zmsg_destroy (&recv_msg);
+        return 0;
+    }
+
     /* Invalid message received. Discard message and continue normally */
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[dev_io_core:_devio_handle_pipe] PIPE "
             "received an invalid command\n");
@@ -281,41 +467,298 @@ static int _smio_handle_pipe_mgmt (zloop_t *loop, zsock_t *reader, void *args)
     return 0;
 }
 
-/* zloop handler for MSG PIPE */
+/* zloop handler for MSG PIPE and the local fast path */
 static int _smio_handle_pipe_msg (zloop_t *loop, zsock_t *reader, void *args)
 {
     (void) loop;
-    smio_err_e err = SMIO_SUCCESS;
+    (void) reader;
     /* We expect a smio instance e as reference */
     smio_t *smio = (smio_t *) args;
 
-    /* We process as many messages as we can, to reduce the overhead
-     * of polling and the reactor */
-    while (zsock_events (reader) & ZMQ_POLLIN) {
+    return _smio_serve_requests (smio);
+}
+
+/* Called when senders held back by the rate limit might be served */
+static void _smio_fairq_wake (void *owner)
+{
+    _smio_serve_requests ((smio_t *) owner);
+}
+
+/* Serve the requests waiting, taking in whatever arrives in between, so
+ * that senders take turns even if one of them sent a burst of requests */
+static int _smio_serve_requests (smio_t *smio)
+{
+    /* SMIOs might share the thread, so attach our counters meanwhile.
+     * Anything not tagged otherwise is receiving or replying */
+    hutils_mem_acct_t *prev_acct = hutils_mem_acct_attach (smio->alloc_acct);
+    uint32_t prev_subsys = hutils_mem_acct_push (HUTILS_MEM_ACCT_MSG);
+
+    int rc = _smio_queue_requests (smio);
+    smio_fairq_req_t *req = NULL;
+    while (rc == 0 && (req = smio_fairq_pop (smio->fairq)) != NULL) {
+        _smio_serve_request (smio, req);
+        smio_fairq_req_destroy (&req);
+        rc = _smio_queue_requests (smio);
+    }
+
+    /* Whatever is left waits for the rate limit */
+    if (smio->metrics != NULL) {
+        smio_queue_stats_t stats;
+        smio_fairq_get_stats (smio->fairq, &stats, false);
+        devio_metrics_node_queue (smio->metrics, &stats);
+    }
+
+    hutils_mem_acct_pop (prev_subsys);
+    hutils_mem_acct_attach (prev_acct);
+    return rc;
+}
+
+/* Queue the requests received on the broker and local fast path sockets.
+ * We take as many messages as we can, to reduce the overhead of polling
+ * and the reactor. Returns -1 if interrupted */
+static int _smio_queue_requests (smio_t *smio)
+{
+    zsock_t *msgpipe = mlm_client_msgpipe (smio->worker);
+    while (zsock_events (msgpipe) & ZMQ_POLLIN) {
         zmsg_t *recv_msg = mlm_client_recv (smio->worker);
         if (recv_msg == NULL) {
             return -1; /* Interrupted */
         }
 
-        exp_msg_zmq_t smio_args = {
+        const char *subject = mlm_client_subject (smio->worker);
+        const char *tracker = mlm_client_tracker (smio->worker);
+        smio_fairq_req_t *req = (smio_fairq_req_t *) zmalloc (sizeof *req);
+        if (req == NULL) {
+            zmsg_destroy (&recv_msg);
+            continue;
+        }
+        req->msg = recv_msg;
+        req->sender = strdup (mlm_client_sender (smio->worker));
+        req->subject = (subject != NULL) ? strdup (subject) : NULL;
+        req->tracker = (tracker != NULL) ? strdup (tracker) : NULL;
+        _smio_queue_request (smio, &req);
+    }
+
+    while (smio->local_sock != NULL &&
+            (zsock_events (smio->local_sock) & ZMQ_POLLIN)) {
+        zmsg_t *recv_msg = zmsg_recv (smio->local_sock);
+        if (recv_msg == NULL) {
+            return -1; /* Interrupted */
+        }
+
+        /* Message is:
+         * frame 0: client identity, added by the ROUTER socket
+         * frame 1: subject
+         * frame 2: tracker
+         * frame n: same as through the broker */
+        smio_fairq_req_t *req = (smio_fairq_req_t *) zmalloc (sizeof *req);
+        if (req == NULL) {
+            zmsg_destroy (&recv_msg);
+            continue;
+        }
+        req->msg = recv_msg;
+        req->local_sock = smio->local_sock;
+        req->reply_to = zmsg_pop (recv_msg);
+        req->subject = zmsg_popstr (recv_msg);
+        req->tracker = zmsg_popstr (recv_msg);
+        if (req->reply_to == NULL || req->subject == NULL || req->tracker == NULL) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] "
+                    "Malformed local request discarded\n");
+            smio_fairq_req_destroy (&req);
+            continue;
+        }
+        /* Local clients are told apart by their identity */
+        req->sender = zframe_strhex (req->reply_to);
+        _smio_queue_request (smio, &req);
+    }
+
+    return 0;
+}
+
+/* Queue a request, rejecting it if its sender has too many waiting.
+ * Pings are served straight away. Writes superseded while waiting are
+ * answered right away */
+static void _smio_queue_request (smio_t *smio, smio_fairq_req_t **req_p)
+{
+    smio_fairq_req_t *req = *req_p;
+    if (req->sender == NULL) {
+        smio_fairq_req_destroy (req_p);
+        return;
+    }
+
+    /* Recorded as received, whatever happens to it next */
+    if (smio->trace != NULL) {
+        smio_trace_record (smio->trace, req);
+    }
+
+    uint32_t opcode = 0;
+    if (msg_peek_mlm_opcode (req->msg, req->subject, &opcode) == MSG_SUCCESS &&
+            opcode == SMIO_OPCODE_PING) {
+        _smio_serve_request (smio, req);
+        smio_fairq_req_destroy (req_p);
+        return;
+    }
+
+    smio_fairq_req_t *superseded = NULL;
+    if (smio_fairq_push (smio->fairq, req_p, &superseded) == SMIO_SUCCESS) {
+        if (superseded != NULL) {
+            _smio_ack_request (smio, superseded);
+            smio_fairq_req_destroy (&superseded);
+            if (smio->metrics != NULL) {
+                devio_metrics_node_coalesced (smio->metrics);
+            }
+        }
+        return;
+    }
+
+    exp_msg_zmq_t smio_args = {
+        .tag = EXP_MSG_ZMQ_TAG,
+        .msg = &req->msg,
+        .reply_to = req->reply_to,
+        .sender = (req->local_sock != NULL) ? NULL : req->sender,
+        .subject = req->subject,
+        .tracker = req->tracker,
+        .local_sock = req->local_sock
+    };
+    msg_reject_mlm_request (smio, &smio_args);
+    smio_fairq_req_destroy (req_p);
+    if (smio->metrics != NULL) {
+        devio_metrics_node_rejected (smio->metrics);
+    }
+}
+
+/* Answer a write superseded in the queue as if it was applied */
+static void _smio_ack_request (smio_t *smio, smio_fairq_req_t *req)
+{
+    exp_msg_zmq_t smio_args = {
+        .tag = EXP_MSG_ZMQ_TAG,
+        .msg = &req->msg,
+        .reply_to = req->reply_to,
+        .sender = (req->local_sock != NULL) ? NULL : req->sender,
+        .subject = req->subject,
+        .tracker = req->tracker,
+        .local_sock = req->local_sock
+    };
+    msg_ack_mlm_request (smio, &smio_args);
+}
+
+/* Serve a request taken from the queue. Identical reads waiting get the
+ * same reply, so the device is read once for all of them */
+static void _smio_serve_request (smio_t *smio, smio_fairq_req_t *req)
+{
+    smio_fairq_req_t *identical [SMIO_FAIRQ_SHARED_MAX];
+    size_t num_identical = smio_fairq_take_identical (smio->fairq, req,
+            identical, SMIO_FAIRQ_SHARED_MAX);
+    exp_msg_zmq_t followers [SMIO_FAIRQ_SHARED_MAX];
+    for (size_t i = 0; i < num_identical; ++i) {
+        followers [i] = (exp_msg_zmq_t) {
             .tag = EXP_MSG_ZMQ_TAG,
-            .msg = &recv_msg,
-            .reply_to = NULL /* Unused field in MLM protocol */
+            .msg = &identical [i]->msg,
+            .reply_to = identical [i]->reply_to,
+            .sender = (identical [i]->local_sock != NULL) ? NULL :
+                identical [i]->sender,
+            .subject = identical [i]->subject,
+            .tracker = identical [i]->tracker,
+            .local_sock = identical [i]->local_sock
         };
-        err = smio_do_op (smio, &smio_args);
+    }
+
+    bool replied = _smio_serve_one (smio, req, followers, num_identical);
+    if (num_identical > 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io_bootstrap] %zu identical "
+                "reads %s\n", num_identical, replied ? "answered along" :
+                "served on their own");
+    }
+
+    if (replied && smio->metrics != NULL) {
+        devio_metrics_node_shared (smio->metrics, num_identical);
+    }
 
-        /* What can I do in case of error ?*/
-        if (err != SMIO_SUCCESS) {
-            DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE,
-                    "[sm_io_bootstrap] smio_do_op: %s\n",
-                    smio_err_str (err));
+    /* Replies that were not shared, e.g., deferred ones, are not lost */
+    for (size_t i = 0; i < num_identical; ++i) {
+        if (!replied) {
+            _smio_serve_one (smio, identical [i], NULL, 0);
         }
+        smio_fairq_req_destroy (&identical [i]);
+    }
+}
 
-        /* Cleanup */
-        zmsg_destroy (&recv_msg);
+/* Serve "req", replying the same to the "num_followers" "followers".
+ * Returns true if these were replied to */
+static bool _smio_serve_one (smio_t *smio, smio_fairq_req_t *req,
+        exp_msg_zmq_t *followers, size_t num_followers)
+{
+    bool local = (req->local_sock != NULL);
+    exp_msg_zmq_t smio_args = {
+        .tag = EXP_MSG_ZMQ_TAG,
+        .msg = &req->msg,
+        .reply_to = req->reply_to, /* Unused field in MLM protocol */
+        .sender = local ? NULL : req->sender,
+        .subject = req->subject,
+        .tracker = req->tracker,
+        .local_sock = req->local_sock,
+        .followers = followers,
+        .num_followers = num_followers
+    };
+
+    /* Clients compute the same id from their address and tracker */
+    if (DBE_TRACING () && !local) {
+        errhand_trace_set_req (errhand_trace_req_id (req->sender, req->tracker));
+    }
+    /* The request is consumed by the operation */
+    size_t bytes = (smio->metrics != NULL) ? zmsg_content_size (req->msg) : 0;
+    uint64_t start_ns = (smio->metrics != NULL) ? msg_stats_now_ns () : 0;
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "smio:do_op", ERRHAND_TRACE_BEGIN);
+    smio_err_e err = smio_do_op (smio, &smio_args);
+    /* Tagged with the opcode once it is known */
+    hutils_mem_acct_set_opcode (HUTILS_MEM_ACCT_NO_OPCODE);
+    DBE_TRACE_STAGE (DBG_SM_IO | DBG_LVL_TRACE, "smio:do_op", ERRHAND_TRACE_END);
+    if (smio->metrics != NULL) {
+        devio_metrics_node_request (smio->metrics, bytes,
+                msg_stats_now_ns () - start_ns, err != SMIO_SUCCESS);
+    }
+    if (DBE_TRACING () && !local) {
+        errhand_trace_set_req (0);
     }
 
-    return 0;
+    /* What can I do in case of error ?*/
+    if (err != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE,
+                "[sm_io_bootstrap] smio_do_op: %s\n",
+                smio_err_str (err));
+    }
+
+    return smio_args.followers_replied;
+}
+
+/* Bind the local fast path of "service", if "broker" is an ipc endpoint */
+static zsock_t *_smio_local_bind (const char *broker, const char *service)
+{
+    if (strncmp (broker, RW_LOCAL_ENDP_PREFIX,
+                strlen (RW_LOCAL_ENDP_PREFIX)) != 0) {
+        return NULL;
+    }
+
+    char *endp = hutils_concat_strings (broker, service, RW_LOCAL_ENDP_SEP);
+    ASSERT_ALLOC(endp, err_endp_alloc);
+    zsock_t *sock = zsock_new (ZMQ_ROUTER);
+    ASSERT_ALLOC(sock, err_sock_alloc);
+    hutils_set_sock_bufs (sock);
+
+    int rc = zsock_bind (sock, "%s", endp);
+    ASSERT_TEST(rc == 0, "Could not bind local fast path", err_bind);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] Local fast path "
+            "bound to %s\n", endp);
+    free (endp);
+    return sock;
+
+err_bind:
+    zsock_destroy (&sock);
+err_sock_alloc:
+    free (endp);
+err_endp_alloc:
+    return NULL;
 }
 
 /* zloop handler for PIPE backend */
@@ -360,11 +803,47 @@ smio_err_e smio_loop (smio_t *self)
 
     /* Set-up server register commands handler */
     _smio_engine_handle_socket (self, self->pipe_mgmt, _smio_handle_pipe_mgmt);
-    _smio_engine_handle_socket (self, mlm_client_msgpipe (self->worker), _smio_handle_pipe_msg);
+    err = smio_start (self);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not start serving requests",
+            err_start);
 
     /* Run reactor until there's a termination signal */
     zloop_start (self->loop);
 
+err_start:
+    return err;
+}
+
+smio_err_e smio_start (smio_t *self)
+{
+    assert (self);
+    smio_err_e err = _smio_engine_handle_socket (self,
+            mlm_client_msgpipe (self->worker), _smio_handle_pipe_msg);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not serve broker requests",
+            err_worker);
+
+    if (self->local_sock != NULL) {
+        err = _smio_engine_handle_socket (self, self->local_sock,
+                _smio_handle_pipe_msg);
+        ASSERT_TEST(err == SMIO_SUCCESS, "Could not serve local requests",
+                err_local);
+    }
+
+    /* Requests that made the DEVIO spawn us, see devio_set_smio_lazy () */
+    if (self->boot_reqs != NULL) {
+        smio_fairq_req_t *req;
+        while ((req = (smio_fairq_req_t *) zlistx_detach (self->boot_reqs, NULL)) != NULL) {
+            _smio_queue_request (self, &req);
+        }
+        zlistx_destroy (&self->boot_reqs);
+        _smio_serve_requests (self);
+    }
+
+    return err;
+
+err_local:
+    _smio_engine_handle_socket (self, mlm_client_msgpipe (self->worker), NULL);
+err_worker:
     return err;
 }
 
@@ -383,12 +862,27 @@ err_register_sm:
     return err;
 }
 
+smio_err_e smio_sibling_write_32 (smio_t *self, uint32_t smio_id, uint64_t offs,
+        uint32_t data)
+{
+    assert (self);
+    smio_err_e err = SMIO_SUCCESS;
+
+    int zerr = zsock_send (self->pipe_mgmt, "s4844", "$WRITE_SMIO", smio_id, offs,
+            self->inst_id, data);
+    ASSERT_TEST(zerr == 0, "Could not write to sibling SMIO", err_write_sibling,
+           SMIO_ERR_BAD_MSG);
+
+err_write_sibling:
+    return err;
+}
+
 /************************************************************/
 /***************** Dispatch table callbacks *****************/
 /************************************************************/
 
 static disp_table_err_e _smio_check_msg_args (disp_table_t *disp_table,
-        const disp_op_t *disp_op, void *args)
+        const disp_op_t *disp_op, const disp_op_sig_t *sig, void *args)
 {
     assert (disp_table);
     assert (disp_op);
@@ -399,7 +893,7 @@ static disp_table_err_e _smio_check_msg_args (disp_table_t *disp_table,
     /* Check if the message tis the correct one */
     ASSERT_TEST (msg_guess_type (args) == MSG_EXP_ZMQ, "Invalid message tag",
             err_inv_msg, DISP_TABLE_ERR_BAD_MSG);
-    msg_err_e merr = msg_check_gen_zmq_args (disp_op, EXP_MSG_ZMQ(args));
+    msg_err_e merr = msg_check_gen_zmq_args (disp_op, sig, EXP_MSG_ZMQ(args));
     ASSERT_TEST (merr == MSG_SUCCESS, "Unrecognized message. Message arguments "
             "checking failed", err_msg_args_check, DISP_TABLE_ERR_BAD_MSG);
 
@@ -458,6 +952,15 @@ smio_err_e smio_export_ops (smio_t *self, const disp_op_t** smio_exp_ops)
     ASSERT_TEST(derr == DISP_TABLE_SUCCESS, "smio_export_ops: Could not export"
             " SMIO ops", err_export_op, SMIO_ERR_EXPORT_OP);
 
+    /* Generic operations, available in every SMIO */
+    derr = disp_table_fill_desc (self->exp_ops_dtable,
+            (disp_op_t **) smio_generic_exp_ops, smio_generic_exp_fp);
+    ASSERT_TEST(derr == DISP_TABLE_SUCCESS, "smio_export_ops: Could not fill"
+            " generic SMIO ops description", err_export_op, SMIO_ERR_EXPORT_OP);
+    derr = disp_table_insert_all (self->exp_ops_dtable, smio_generic_exp_ops);
+    ASSERT_TEST(derr == DISP_TABLE_SUCCESS, "smio_export_ops: Could not export"
+            " generic SMIO ops", err_export_op, SMIO_ERR_EXPORT_OP);
+
     err = SMIO_FUNC_OPS_NOFAIL_WRAPPER(err, export_ops, smio_exp_ops);
     ASSERT_TEST(err == SMIO_SUCCESS, "Registered SMIO \"export_ops\" function error",
         err_func);
@@ -492,6 +995,20 @@ smio_err_e smio_do_op (void *owner, void *msg)
     return _smio_do_op (owner, msg);
 }
 
+/* Periodic handler */
+smio_err_e smio_poll (smio_t *self)
+{
+    assert (self);
+    smio_err_e err = SMIO_SUCCESS;
+
+    err = SMIO_FUNC_OPS_NOFAIL_WRAPPER(err, poll);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Registered SMIO \"poll\" function error",
+        err_func);
+
+err_func:
+    return err;
+}
+
 smio_err_e smio_init_exp_ops (smio_t *self, disp_op_t** smio_exp_ops,
         const disp_table_func_fp *func_fps)
 {
@@ -579,6 +1096,18 @@ char *smio_clone_name (smio_t *self)
     return _smio_clone_name (self);
 }
 
+const char *smio_get_service (smio_t *self)
+{
+    assert (self);
+    return self->service;
+}
+
+const char *smio_get_cfg_file (smio_t *self)
+{
+    assert (self);
+    return self->cfg_file;
+}
+
 smio_err_e smio_set_exp_ops (smio_t *self, const disp_op_t **exp_ops)
 {
     assert (self);
@@ -628,8 +1157,260 @@ const smio_thsafe_client_ops_t *smio_get_thsafe_client_ops (smio_t *self)
     return self->thsafe_client_ops;
 }
 
+smio_err_e smio_add_cache_region (smio_t *self, uint64_t offset, size_t size)
+{
+    assert (self);
+    smio_err_e err = SMIO_SUCCESS;
+
+    if (self->cache == NULL) {
+        self->cache = smio_cache_new ();
+        ASSERT_ALLOC(self->cache, err_cache_alloc, SMIO_ERR_ALLOC);
+    }
+
+    err = smio_cache_add_region (self->cache, offset, size);
+
+err_cache_alloc:
+    return err;
+}
+
+void smio_invalidate_cache_reg (smio_t *self, uint64_t offs)
+{
+    assert (self);
+
+    if (self->cache != NULL) {
+        smio_cache_invalidate (self->cache, offs);
+    }
+}
+
+void smio_invalidate_cache (smio_t *self)
+{
+    assert (self);
+
+    if (self->cache != NULL) {
+        smio_cache_invalidate_all (self->cache);
+    }
+}
+
+static ssize_t _smio_cache_read_hw (void *owner, uint64_t offs, uint32_t *data)
+{
+    return smio_thsafe_client_read_32 ((smio_t *) owner, offs, data);
+}
+
+smio_err_e smio_map_cache_snapshot (smio_t *self, const char *path)
+{
+    assert (self);
+    assert (path);
+
+    /* Nothing to keep */
+    if (self->cache == NULL) {
+        return SMIO_SUCCESS;
+    }
+
+    uint32_t num_warm = 0;
+    smio_err_e err = smio_cache_map_snapshot (self->cache, path,
+            _smio_cache_read_hw, self, &num_warm);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not map register snapshot",
+            err_map_snapshot);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io] %s: %u registers kept "
+            "from snapshot %s\n", self->service, num_warm, path);
+
+err_map_snapshot:
+    return err;
+}
+
+smio_err_e smio_start_trace (smio_t *self, const char *path, uint64_t max_size)
+{
+    assert (self);
+    assert (path);
+
+    smio_err_e err = SMIO_SUCCESS;
+    smio_trace_destroy (&self->trace);
+    self->trace = smio_trace_new (path, self->service, max_size);
+    ASSERT_ALLOC(self->trace, err_trace_alloc, SMIO_ERR_ALLOC);
+
+err_trace_alloc:
+    return err;
+}
+
 /**************** Static Functions ***************/
 
+/* Generic SMIO_OPCODE_GET_OP_STATS operation. Arguments are the opcode to
+ * get the statistics from and the SMIO_OP_STATS_FLAG_* flags */
+static int _smio_get_op_stats (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    assert (ret);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    uint32_t opcode = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t flags = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    const smio_op_stats_t *stats = msg_stats_get (self->exp_stats, opcode);
+    ASSERT_TEST(stats != NULL, "Invalid opcode for operation statistics",
+            err_inv_opcode);
+
+    memcpy (ret, stats, sizeof (*stats));
+    if (flags & SMIO_OP_STATS_FLAG_RESET) {
+        msg_stats_reset (self->exp_stats, opcode);
+    }
+
+    return sizeof (*stats);
+
+err_inv_opcode:
+    return -PARAM_ERR;
+}
+
+/* Generic SMIO_OPCODE_SET_GET_RATE_LIMIT operation. Arguments are rw and
+ * the requests per second allowed to each sender */
+static int _smio_set_get_rate_limit (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    assert (ret);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t rate_limit = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+
+    if (rw) {
+        *(uint32_t *) ret = smio_fairq_get_rate_limit (self->fairq);
+        return sizeof (uint32_t);
+    }
+
+    smio_fairq_set_rate_limit (self->fairq, rate_limit);
+    return -PARAM_OK;
+}
+
+/* Generic SMIO_OPCODE_GET_QUEUE_STATS operation. Arguments are rw, which
+ * must be read, and the SMIO_QUEUE_STATS_FLAG_* flags */
+static int _smio_get_queue_stats (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    assert (ret);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t flags = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    ASSERT_TEST(rw, "Queue statistics are read only", err_inv_rw);
+
+    smio_fairq_get_stats (self->fairq, (smio_queue_stats_t *) ret,
+            flags & SMIO_QUEUE_STATS_FLAG_RESET);
+    return sizeof (smio_queue_stats_t);
+
+err_inv_rw:
+    return -PARAM_ERR;
+}
+
+/* Generic SMIO_OPCODE_GET_STARTUP_STATS operation. Arguments are rw, which
+ * must be read, and a reserved uint32_t */
+static int _smio_get_startup_stats (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    assert (ret);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    ASSERT_TEST(rw, "Startup statistics are read only", err_inv_rw);
+
+    smio_startup_stats_t *stats = (smio_startup_stats_t *) ret;
+    memset (stats, 0, sizeof (*stats));
+    if (self->startup != NULL) {
+        /* The config thread might still be writing its phase */
+        const uint64_t *src = (const uint64_t *) self->startup;
+        uint64_t *dst = (uint64_t *) stats;
+        for (size_t i = 0; i < sizeof (*stats) / sizeof (uint64_t); ++i) {
+            dst [i] = __atomic_load_n (&src [i], __ATOMIC_RELAXED);
+        }
+    }
+
+    return sizeof (smio_startup_stats_t);
+
+err_inv_rw:
+    return -PARAM_ERR;
+}
+
+/* Generic SMIO_OPCODE_GET_ALLOC_STATS operation. Arguments are rw, which
+ * must be read, and the SMIO_ALLOC_STATS_FLAG_* flags */
+static int _smio_get_alloc_stats (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    assert (ret);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    uint32_t flags = *(uint32_t *) EXP_MSG_ZMQ_NEXT_ARG(args);
+    ASSERT_TEST(rw, "Allocation statistics are read only", err_inv_rw);
+
+    smio_alloc_stats_t *stats = (smio_alloc_stats_t *) ret;
+    stats->enabled = hutils_mem_acct_wrapped;
+    stats->reserved = 0;
+    stats->acct = *self->alloc_acct;
+    if (flags & SMIO_ALLOC_STATS_FLAG_RESET) {
+        memset (self->alloc_acct, 0, sizeof (*self->alloc_acct));
+    }
+
+    return sizeof (smio_alloc_stats_t);
+
+err_inv_rw:
+    return -PARAM_ERR;
+}
+
+/* Generic SMIO_OPCODE_PING operation. Arguments are rw, which must be
+ * read, and a reserved uint32_t */
+static int _smio_ping (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    assert (ret);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    uint32_t rw = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    ASSERT_TEST(rw, "Ping is read only", err_inv_rw);
+
+    smio_queue_stats_t queue_stats;
+    smio_fairq_get_stats (self->fairq, &queue_stats, false);
+    uint64_t last_err_ns = 0;
+
+    smio_ping_t *ping = (smio_ping_t *) ret;
+    memset (ping, 0, sizeof (*ping));
+    ping->uptime_us = zclock_usecs () - self->start_us;
+    ping->served = queue_stats.served;
+    ping->depth = queue_stats.depth;
+    ping->errors = msg_stats_get_last_err (self->exp_stats,
+            &ping->last_err_opcode, &last_err_ns);
+    if (last_err_ns != 0) {
+        ping->last_err_age_us = (msg_stats_now_ns () - last_err_ns) / 1000;
+    }
+
+    return sizeof (smio_ping_t);
+
+err_inv_rw:
+    return -PARAM_ERR;
+}
+
+/* Generic SMIO_OPCODE_BATCH operation. Arguments are the number of
+ * operations and the operations */
+static int _smio_batch (void *owner, void *args, void *ret)
+{
+    assert (owner);
+    assert (args);
+    assert (ret);
+
+    SMIO_OWNER_TYPE *self = SMIO_EXP_OWNER(owner);
+    uint32_t num_ops = *(uint32_t *) EXP_MSG_ZMQ_FIRST_ARG(args);
+    EXP_MSG_ZMQ_ARG_TYPE batch_arg = EXP_MSG_ZMQ_PEEK_NEXT_ARG(args);
+
+    return msg_handle_mlm_batch (owner, args, self->exp_ops_dtable,
+            self->exp_stats, num_ops, EXP_MSG_ZMQ_ARG_DATA(batch_arg),
+            EXP_MSG_ZMQ_ARG_SIZE(batch_arg), (uint8_t *) ret,
+            sizeof (smio_batch_t));
+}
+
 static smio_err_e _smio_do_op (void *owner, void *msg)
 {
     assert (owner);
@@ -646,7 +1427,8 @@ static smio_err_e _smio_do_op (void *owner, void *msg)
             err_do_op);
 
     disp_table_t *disp_table = self->exp_ops_dtable;
-    msg_err_e merr = msg_handle_mlm_request (owner, msg, disp_table);
+    msg_err_e merr = msg_handle_mlm_request (owner, msg, disp_table,
+            self->exp_stats);
     ASSERT_TEST (merr == MSG_SUCCESS, "Error handling request", err_hand_req,
            SMIO_ERR_MSG_NOT_SUPP /* returning a more meaningful error? */);
 
@@ -708,6 +1490,147 @@ mlm_client_t *smio_get_worker (smio_t *self)
     return self->worker;
 }
 
+void smio_set_param_changed (smio_t *self)
+{
+    assert (self);
+    self->param_changed = true;
+}
+
+smio_err_e smio_publish_param_change (smio_t *self, uint32_t opcode)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    if (!self->param_changed) {
+        goto param_not_changed;
+    }
+    self->param_changed = false;
+
+    /* Message is:
+     * frame 0: opcode of the operation that changed the parameter */
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, SMIO_ERR_ALLOC);
+    int rc = zmsg_addmem (msg, &opcode, sizeof (opcode));
+    ASSERT_TEST(rc == 0, "Could not add opcode to message", err_msg_addmem,
+            SMIO_ERR_ALLOC);
+
+    rc = mlm_client_send (self->worker, SMIO_EVENT_SUBJECT_PARAM_CHANGED, &msg);
+    ASSERT_TEST(rc == 0, "Could not publish parameter change", err_msg_send,
+            SMIO_ERR_BAD_MSG);
+
+err_msg_send:
+err_msg_addmem:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+param_not_changed:
+    return err;
+}
+
+smio_err_e smio_set_dir_info (smio_t *self, const void *info, size_t size)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+    ASSERT_TEST(size <= SMIO_DIR_INFO_MAX_SIZE, "Directory information is "
+            "too big", err_info_size, SMIO_ERR_WRONG_PARAM);
+
+    void *dir_info = NULL;
+    if (size > 0) {
+        dir_info = zmalloc (size);
+        ASSERT_ALLOC(dir_info, err_info_alloc, SMIO_ERR_ALLOC);
+        memcpy (dir_info, info, size);
+    }
+
+    free (self->dir_info);
+    self->dir_info = dir_info;
+    self->dir_info_size = size;
+
+err_info_alloc:
+err_info_size:
+    return err;
+}
+
+smio_err_e smio_dir_register (smio_t *self)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+    char *ops_names = NULL;
+
+    smio_dir_service_t desc = {.smio_id = self->id, .inst_id = self->inst_id,
+        .pid = (int32_t) getpid ()};
+    int rc = snprintf (desc.service, sizeof (desc.service), "%s", self->service);
+    ASSERT_TEST(rc > 0 && (size_t) rc < sizeof (desc.service), "Service name "
+            "is too long for the directory", err_service_len, SMIO_ERR_WRONG_PARAM);
+
+    /* Exported operation names, separated by spaces */
+    size_t ops_len = 1;
+    for (const disp_op_t **op = self->exp_ops; op != NULL && *op != NULL; ++op) {
+        ops_len += strlen ((*op)->name) + 1;
+    }
+    ops_names = (char *) zmalloc (ops_len);
+    ASSERT_ALLOC(ops_names, err_ops_names_alloc, SMIO_ERR_ALLOC);
+    for (const disp_op_t **op = self->exp_ops; op != NULL && *op != NULL; ++op) {
+        if (*ops_names != '\0') {
+            strcat (ops_names, " ");
+        }
+        strcat (ops_names, (*op)->name);
+    }
+
+    /* Message is:
+     * frame 0: smio_dir_service_t
+     * frame 1: exported operation names
+     * frame 2: service specific information */
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, SMIO_ERR_ALLOC);
+    rc = zmsg_addmem (msg, &desc, sizeof (desc));
+    rc |= zmsg_addstr (msg, ops_names);
+    rc |= zmsg_addmem (msg, self->dir_info, self->dir_info_size);
+    ASSERT_TEST(rc == 0, "Could not build directory registration", err_msg_add,
+            SMIO_ERR_ALLOC);
+
+    rc = mlm_client_sendto (self->worker, SMIO_DIR_SERVICE,
+            SMIO_DIR_SUBJECT_REGISTER, NULL, SMIO_DIR_REGISTER_TTL, &msg);
+    ASSERT_TEST(rc == 0, "Could not send directory registration", err_msg_send,
+            SMIO_ERR_BAD_MSG);
+
+err_msg_send:
+err_msg_add:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    free (ops_names);
+err_ops_names_alloc:
+err_service_len:
+    return err;
+}
+
+smio_err_e smio_dir_unregister (smio_t *self)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    /* Message is:
+     * frame 0: service name */
+    zmsg_t *msg = zmsg_new ();
+    ASSERT_ALLOC(msg, err_msg_alloc, SMIO_ERR_ALLOC);
+    int rc = zmsg_addstr (msg, self->service);
+    ASSERT_TEST(rc == 0, "Could not build directory unregistration",
+            err_msg_add, SMIO_ERR_ALLOC);
+
+    rc = mlm_client_sendto (self->worker, SMIO_DIR_SERVICE,
+            SMIO_DIR_SUBJECT_UNREGISTER, NULL, SMIO_DIR_REGISTER_TTL, &msg);
+    ASSERT_TEST(rc == 0, "Could not send directory unregistration",
+            err_msg_send, SMIO_ERR_BAD_MSG);
+
+err_msg_send:
+err_msg_add:
+    zmsg_destroy (&msg);
+err_msg_alloc:
+    return err;
+}
+
 zsock_t *smio_get_pipe_msg (smio_t *self)
 {
     return self->pipe_msg;
@@ -718,6 +1641,96 @@ zsock_t *smio_get_pipe_mgmt (smio_t *self)
     return self->pipe_mgmt;
 }
 
+thsafe_ring_t *smio_get_thsafe_ring (smio_t *self)
+{
+    return self->ring;
+}
+
+llio_t *smio_get_direct_llio (smio_t *self)
+{
+    return self->llio;
+}
+
+smio_status_page_t *smio_get_status_page (smio_t *self)
+{
+    return self->status;
+}
+
+smio_err_e smio_set_posted_writes (smio_t *self, bool posted)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    if (self->posted_writes && !posted && smio_thsafe_client_fence (self) < 0) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io] Posted writes of SMIO %s "
+                "failed\n", self->service);
+        err = SMIO_ERR_LLIO;
+    }
+    self->posted_writes = posted;
+
+    return err;
+}
+
+bool smio_get_posted_writes (smio_t *self)
+{
+    assert (self);
+    return self->posted_writes;
+}
+
+smio_err_e smio_set_poll_interval (smio_t *self, size_t interval)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    /* Tasks can restart themselves, so this is safe to call from the
+     * "poll" operation itself */
+    if (self->poll_task_id != -1) {
+        err = smio_tasks_set_period (self->tasks, self->poll_task_id, interval);
+        goto poll_task_set;
+    }
+
+    if (interval == 0) {
+        goto poll_task_set;
+    }
+
+    self->poll_task_id = smio_tasks_add (self->tasks, "poll", interval, 0,
+            _smio_poll_task, NULL);
+    ASSERT_TEST(self->poll_task_id != -1, "Could not add SMIO poll task",
+            err_task_alloc, SMIO_ERR_ALLOC);
+
+err_task_alloc:
+poll_task_set:
+    return err;
+}
+
+int smio_add_task (smio_t *self, const char *name, size_t period,
+        size_t jitter, smio_task_fp task_fp, void *arg)
+{
+    assert (self);
+    return smio_tasks_add (self->tasks, name, period, jitter, task_fp, arg);
+}
+
+smio_err_e smio_set_task_period (smio_t *self, int task_id, size_t period)
+{
+    assert (self);
+    return smio_tasks_set_period (self->tasks, task_id, period);
+}
+
+smio_err_e smio_remove_task (smio_t *self, int task_id)
+{
+    assert (self);
+    return smio_tasks_remove (self->tasks, task_id);
+}
+
+smio_err_e smio_get_task_stats (smio_t *self, int task_id,
+        smio_task_stats_t *stats)
+{
+    assert (self);
+    return smio_tasks_get_stats (self->tasks, task_id, stats);
+}
+
 /************************************************************/
 /************* SMIO thsafe wrapper functions   **************/
 /************************************************************/
@@ -746,6 +1759,26 @@ zsock_t *smio_get_pipe_mgmt (smio_t *self)
     return self->thsafe_client_ops->func_name (self, ##__VA_ARGS__);  \
 }
 
+/* Declare wrapper for the register and block accesses, accounting their
+ * round trip and the bytes moved in the load metrics */
+#define SMIO_THSAFE_WRAPPER(is_write, func_name, ...)       \
+{                                                           \
+    ASSERT_FUNC(func_name);                                 \
+    uint64_t start_ns = (self->metrics != NULL) ? msg_stats_now_ns () : 0; \
+    ssize_t ret = self->thsafe_client_ops->func_name (self, ##__VA_ARGS__); \
+    _smio_thsafe_account (self, start_ns, is_write, ret);   \
+    return ret;                                             \
+}
+
+static inline void _smio_thsafe_account (smio_t *self, uint64_t start_ns,
+        bool is_write, ssize_t ret)
+{
+    if (self->metrics != NULL) {
+        devio_metrics_node_thsafe (self->metrics, is_write, (ret > 0) ? ret : 0,
+                msg_stats_now_ns () - start_ns, ret < 0);
+    }
+}
+
 /**** Open device ****/
 int smio_thsafe_client_open (smio_t *self, llio_endpoint_t *endpoint)
     SMIO_FUNC_WRAPPER (thsafe_client_open, endpoint)
@@ -756,103 +1789,207 @@ int smio_thsafe_client_release (smio_t *self, llio_endpoint_t *endpoint)
 
 /**** Read data from device ****/
 ssize_t smio_thsafe_client_read_16 (smio_t *self, uint64_t offs, uint16_t *data)
-{
-    ASSERT_FUNC(thsafe_client_read_16);
-    return self->thsafe_client_ops->thsafe_client_read_16 (self, self->base | offs, data);
-}
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_16, self->base | offs, data)
 
 ssize_t smio_thsafe_client_read_32 (smio_t *self, uint64_t offs, uint32_t *data)
-{
-    ASSERT_FUNC(thsafe_client_read_32);
-    return self->thsafe_client_ops->thsafe_client_read_32 (self, self->base | offs, data);
-}
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_32, self->base | offs, data)
 
 ssize_t smio_thsafe_client_read_64 (smio_t *self, uint64_t offs, uint64_t *data)
-{
-    ASSERT_FUNC(thsafe_client_read_64);
-    return self->thsafe_client_ops->thsafe_client_read_64 (self, self->base | offs, data);
-}
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_64, self->base | offs, data)
 
 ssize_t smio_thsafe_raw_client_read_16 (smio_t *self, uint64_t offs, uint16_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_read_16, offs, data)
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_16, offs, data)
 ssize_t smio_thsafe_raw_client_read_32 (smio_t *self, uint64_t offs, uint32_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_read_32, offs, data)
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_32, offs, data)
 ssize_t smio_thsafe_raw_client_read_64 (smio_t *self, uint64_t offs, uint64_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_read_64, offs, data)
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_64, offs, data)
 
 /**** Write data to device ****/
 ssize_t smio_thsafe_client_write_16 (smio_t *self, uint64_t offs, const uint16_t *data)
-{
-    ASSERT_FUNC(thsafe_client_write_16);
-    return self->thsafe_client_ops->thsafe_client_write_16 (self, self->base | offs, data);
-}
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_16, self->base | offs, data)
 
 ssize_t smio_thsafe_client_write_32 (smio_t *self, uint64_t offs, const uint32_t *data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_32, self->base | offs, data)
+
+ssize_t smio_thsafe_client_write_64 (smio_t *self, uint64_t offs, const uint64_t *data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_64, self->base | offs, data)
+
+/**** Read/Write data to device through the shadow register cache ****/
+ssize_t smio_thsafe_client_cached_read_32 (smio_t *self, uint64_t offs, uint32_t *data)
 {
-    ASSERT_FUNC(thsafe_client_write_32);
-    return self->thsafe_client_ops->thsafe_client_write_32 (self, self->base | offs, data);
+    if (self->cache != NULL && smio_cache_lookup (self->cache, offs, data)) {
+        return sizeof (*data);
+    }
+
+    ssize_t ret = smio_thsafe_client_read_32 (self, offs, data);
+    if (self->cache != NULL && ret == sizeof (*data)) {
+        smio_cache_update (self->cache, offs, *data);
+    }
+
+    return ret;
 }
 
-ssize_t smio_thsafe_client_write_64 (smio_t *self, uint64_t offs, const uint64_t *data)
+ssize_t smio_thsafe_client_cached_write_32 (smio_t *self, uint64_t offs, const uint32_t *data)
 {
-    ASSERT_FUNC(thsafe_client_write_64);
-    return self->thsafe_client_ops->thsafe_client_write_64 (self, self->base | offs, data);
+    /* The hardware already holds it. This is what saves the reprogramming
+     * of the defaults after a warm restart */
+    uint32_t cached;
+    if (self->cache != NULL && smio_cache_lookup (self->cache, offs, &cached) &&
+            cached == *data) {
+        return sizeof (*data);
+    }
+
+    ssize_t ret = smio_thsafe_client_write_32 (self, offs, data);
+
+    if (self->cache != NULL) {
+        if (ret == sizeof (*data)) {
+            smio_cache_update (self->cache, offs, *data);
+        }
+        else {
+            /* We don't know what the register holds now */
+            smio_cache_invalidate (self->cache, offs);
+        }
+    }
+
+    return ret;
 }
 
 ssize_t smio_thsafe_raw_client_write_16 (smio_t *self, uint64_t offs, const uint16_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_write_16, offs, data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_16, offs, data)
 ssize_t smio_thsafe_raw_client_write_32 (smio_t *self, uint64_t offs, const uint32_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_write_32, offs, data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_32, offs, data)
 ssize_t smio_thsafe_raw_client_write_64 (smio_t *self, uint64_t offs, const uint64_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_write_64, offs, data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_64, offs, data)
 
 /**** Read data block from device function pointer, size in bytes ****/
 ssize_t smio_thsafe_client_read_block (smio_t *self, uint64_t offs, size_t size,
         uint32_t *data)
-{
-    ASSERT_FUNC(thsafe_client_read_block);
-    return self->thsafe_client_ops->thsafe_client_read_block (self, self->base | offs,
-            size, data);
-}
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_block, self->base | offs, size, data)
 
 ssize_t smio_thsafe_raw_client_read_block (smio_t *self, uint64_t offs, size_t size, uint32_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_read_block, offs, size, data)
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_block, offs, size, data)
 
 /**** Write data block from device function pointer, size in bytes ****/
 ssize_t smio_thsafe_client_write_block (smio_t *self, uint64_t offs, size_t size,
         const uint32_t *data)
-{
-    ASSERT_FUNC(thsafe_client_write_block);
-    return self->thsafe_client_ops->thsafe_client_write_block (self, self->base | offs,
-            size, data);
-}
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_block, self->base | offs, size, data)
 
 ssize_t smio_thsafe_raw_client_write_block (smio_t *self, uint64_t offs, size_t size, const uint32_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_write_block, offs, size, data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_block, offs, size, data)
+
+ssize_t smio_thsafe_client_cached_write_block (smio_t *self, uint64_t offs,
+        size_t size, const uint32_t *data)
+{
+    const size_t num_regs = size / sizeof (*data);
+    size_t i;
+
+    if (self->cache != NULL) {
+        for (i = 0; i < num_regs; ++i) {
+            uint32_t cached;
+            if (!smio_cache_lookup (self->cache, offs + i*sizeof (*data), &cached) ||
+                    cached != data [i]) {
+                break;
+            }
+        }
+
+        if (i == num_regs) {
+            return size;
+        }
+    }
+
+    ssize_t ret = smio_thsafe_client_write_block (self, offs, size, data);
+
+    if (self->cache != NULL) {
+        for (i = 0; i < num_regs; ++i) {
+            if (ret == (ssize_t) size) {
+                smio_cache_update (self->cache, offs + i*sizeof (*data), data [i]);
+            }
+            else {
+                smio_cache_invalidate (self->cache, offs + i*sizeof (*data));
+            }
+        }
+    }
+
+    return ret;
+}
 
 /**** Read data block via DMA from device, size in bytes ****/
 ssize_t smio_thsafe_client_read_dma (smio_t *self, uint64_t offs, size_t size,
         uint32_t *data)
-{
-    ASSERT_FUNC(thsafe_client_read_dma);
-    return self->thsafe_client_ops->thsafe_client_read_dma (self, self->base | offs,
-            size, data);
-}
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_dma, self->base | offs, size, data)
 
 ssize_t smio_thsafe_raw_client_read_dma (smio_t *self, uint64_t offs, size_t size, uint32_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_read_dma, offs, size, data)
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_dma, offs, size, data)
 
 /**** Write data block via DMA from device, size in bytes ****/
 ssize_t smio_thsafe_client_write_dma (smio_t *self, uint64_t offs, size_t size,
         const uint32_t *data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_dma, self->base | offs, size, data)
+
+ssize_t smio_thsafe_raw_client_write_dma (smio_t *self, uint64_t offs, size_t size, const uint32_t *data)
+    SMIO_THSAFE_WRAPPER (true, thsafe_client_write_dma, offs, size, data)
+
+/**** Execute a batch of register operations, in order ****/
+ssize_t smio_thsafe_client_batch (smio_t *self, thsafe_batch_op_t *ops, size_t num_ops)
 {
-    ASSERT_FUNC(thsafe_client_write_dma);
-    return self->thsafe_client_ops->thsafe_client_write_dma (self, self->base | offs,
-            size, data);
+    ASSERT_FUNC(thsafe_client_batch);
+    if (num_ops > THSAFE_BATCH_MAX_OPS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io] Batch of %zu operations "
+                "exceeds the maximum of %u\n", num_ops, THSAFE_BATCH_MAX_OPS);
+        return -SMIO_ERR_WRONG_PARAM;
+    }
+
+    /* Don't change the caller offsets, as it might want to reuse them */
+    thsafe_batch_op_t ops_base [THSAFE_BATCH_MAX_OPS];
+    size_t i;
+    for (i = 0; i < num_ops; ++i) {
+        ops_base [i] = ops [i];
+        ops_base [i].offset = self->base | ops [i].offset;
+    }
+
+    uint64_t start_ns = (self->metrics != NULL) ? msg_stats_now_ns () : 0;
+    ssize_t ret = self->thsafe_client_ops->thsafe_client_batch (self, ops_base,
+            num_ops);
+    /* Batches move registers both ways. Only their round trip counts */
+    _smio_thsafe_account (self, start_ns, false, (ret < 0) ? ret : 0);
+
+    for (i = 0; i < num_ops; ++i) {
+        ops [i].value = ops_base [i].value;
+    }
+
+    return ret;
 }
 
-ssize_t smio_thsafe_raw_client_write_dma (smio_t *self, uint64_t offs, size_t size, const uint32_t *data)
-    SMIO_FUNC_WRAPPER (thsafe_client_write_dma, offs, size, data)
+ssize_t smio_thsafe_raw_client_batch (smio_t *self, thsafe_batch_op_t *ops, size_t num_ops)
+    SMIO_FUNC_WRAPPER (thsafe_client_batch, ops, num_ops)
+
+/**** Read scattered data blocks from device, in a single request ****/
+ssize_t smio_thsafe_client_read_blockv (smio_t *self, const llio_iov_t *iov, size_t iovcnt)
+{
+    ASSERT_FUNC(thsafe_client_read_blockv);
+    if (iovcnt > THSAFE_BLOCKV_MAX_EXTS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_ERR, "[sm_io] Vectored read of %zu blocks "
+                "exceeds the maximum of %u\n", iovcnt, THSAFE_BLOCKV_MAX_EXTS);
+        return -SMIO_ERR_WRONG_PARAM;
+    }
+
+    /* Don't change the caller offsets, as it might want to reuse them */
+    llio_iov_t iov_base [THSAFE_BLOCKV_MAX_EXTS];
+    size_t i;
+    for (i = 0; i < iovcnt; ++i) {
+        iov_base [i] = iov [i];
+        iov_base [i].offs = self->base | iov [i].offs;
+    }
+
+    return smio_thsafe_raw_client_read_blockv (self, iov_base, iovcnt);
+}
+
+ssize_t smio_thsafe_raw_client_read_blockv (smio_t *self, const llio_iov_t *iov, size_t iovcnt)
+    SMIO_THSAFE_WRAPPER (false, thsafe_client_read_blockv, iov, iovcnt)
+
+/**** Wait for the writes posted so far ****/
+ssize_t smio_thsafe_client_fence (smio_t *self)
+    SMIO_FUNC_WRAPPER (thsafe_client_fence)
 
 /**** Read device information function pointer ****/
 /* int smio_thsafe_raw_client_read_info (smio_t *self, llio_dev_info_t *dev_info)
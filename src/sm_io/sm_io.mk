@@ -8,6 +8,11 @@ sm_io_DIR = $(SRC_DIR)/sm_io
 sm_io_OBJS = $(sm_io_DIR)/sm_io.o \
 	     $(sm_io_DIR)/sm_io_bootstrap.o \
 	     $(sm_io_DIR)/sm_io_err.o \
+	     $(sm_io_DIR)/sm_io_cache.o \
+	     $(sm_io_DIR)/sm_io_tasks.o \
+	     $(sm_io_DIR)/sm_io_fairq.o \
+	     $(sm_io_DIR)/sm_io_trace.o \
+	     $(sm_io_DIR)/sm_io_reactor.o \
 	     $(sm_io_modules_OBJS) \
 	     $(sm_io_rw_param_OBJS) \
 	     $(sm_io_protocols_OBJS) \
@@ -34,44 +34,73 @@
 /****************** SMIO Thread entry-point  ****************/
 /************************************************************/
 /* FIXME: Do some sanity check before calling functions from smio_mod_dispatch*/
-void smio_startup (zsock_t *pipe, void *args)
+smio_t *smio_boot (th_boot_args_t *th_args, zsock_t *pipe_mgmt)
 {
     /* FIXME: priv pointer is unused for now! We should use it to differentiate
      * between multiple smio instances of the same type controlling multiple
      * modules of the same type */
-    th_boot_args_t *th_args = (th_boot_args_t *) args;
-    zsock_t *pipe_mgmt = pipe;
     zsock_t *pipe_msg = th_args->pipe_msg;
     volatile const smio_mod_dispatch_t *smio_mod_dispatch = th_args->smio_handler;
-    /* Signal parent we are initializing */
-    zsock_signal (pipe_mgmt, 0);
+    smio_startup_stats_t *startup = th_args->startup;
+    int64_t boot_start = zclock_usecs ();
+    int64_t phase_start = boot_start;
 
     /* We must export our service as the combination of the
      * devio name (coming from devio parent) and our own name ID
      * followed by an optional parameter coming from priv pointer */
-    char *inst_id_str = hutils_stringify_dec_key (th_args->inst_id);
-    ASSERT_ALLOC(inst_id_str, err_inst_id_str_alloc);
+    char inst_id_str [HUTILS_KEY_STR_MAX_LEN];
+    hutils_stringify_dec_key_buf (inst_id_str, sizeof (inst_id_str),
+            th_args->inst_id);
     char *smio_service = hutils_concat_strings3 (th_args->service,
             smio_mod_dispatch->name, inst_id_str, ':');
     ASSERT_ALLOC(smio_service, err_smio_service_alloc);
 
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] SMIO Thread %s "
-            "starting ...\n", smio_service);
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] SMIO Thread %s "
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] SMIO %s "
             "allocating resources ...\n", smio_service);
 
     smio_t *self = smio_new (th_args, pipe_mgmt, pipe_msg, smio_service);
     ASSERT_ALLOC(self, err_self_alloc);
+    SMIO_STARTUP_SET(startup, connect_us, phase_start);
 
     /* Atach this SMIO instance to its parent */
     smio_err_e err = smio_attach (self, th_args->parent);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not attach SMIO", err_call_attach);
 
     /* Call SMIO init function to finish initializing its internal strucutres */
+    phase_start = zclock_usecs ();
     err = SMIO_DISPATCH_FUNC_WRAPPER (init, smio_mod_dispatch);
     ASSERT_TEST(err == SMIO_SUCCESS, "Could not initialize SMIO", err_call_init);
+    SMIO_STARTUP_SET(startup, init_us, phase_start);
+
+    /* Pick up the registers left by the last run, before exporting the
+     * operations, so the config thread already sees them */
+    if (th_args->snapshot_dir != NULL) {
+        phase_start = zclock_usecs ();
+        char *snapshot_path = zsys_sprintf ("%s/%s.snap", th_args->snapshot_dir,
+                smio_service);
+        if (snapshot_path == NULL ||
+                smio_map_cache_snapshot (self, snapshot_path) != SMIO_SUCCESS) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] SMIO %s "
+                    "has no register snapshot. Starting cold\n", smio_service);
+        }
+        zstr_free (&snapshot_path);
+        SMIO_STARTUP_SET(startup, snapshot_us, phase_start);
+    }
+
+    /* Not fatal. Requests are just not recorded */
+    if (th_args->trace_dir != NULL) {
+        char *trace_path = zsys_sprintf ("%s/%s"SMIO_TRACE_FILE_SUFFIX,
+                th_args->trace_dir, smio_service);
+        if (trace_path == NULL || smio_start_trace (self, trace_path,
+                    th_args->trace_max_size) != SMIO_SUCCESS) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] SMIO %s "
+                    "could not start its request trace\n", smio_service);
+        }
+        zstr_free (&trace_path);
+    }
 
     /* Export SMIO specific operations */
+    phase_start = zclock_usecs ();
     const disp_op_t **smio_exp_ops = smio_get_exp_ops (self);
     ASSERT_TEST (smio_exp_ops != NULL, "Could not get SMIO exported operations",
             err_smio_get_exp_ops);
@@ -79,20 +108,25 @@ void smio_startup (zsock_t *pipe, void *args)
     err = smio_export_ops (self, smio_exp_ops);
     ASSERT_TEST (err == SMIO_SUCCESS, "Could not export specific SMIO operations",
             err_smio_export);
+    SMIO_STARTUP_SET(startup, export_us, phase_start);
 
-    /* Main loop request-action */
-    err = smio_loop (self);
-    ASSERT_TEST (err == SMIO_SUCCESS, "Could not loop the SMIO messages",
-            err_smio_loop);
+    /* Not fatal. We are just not listed by the dev_mngr */
+    phase_start = zclock_usecs ();
+    err = smio_dir_register (self);
+    if (err != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] SMIO %s "
+                "could not register in the directory\n", smio_service);
+    }
+    SMIO_STARTUP_SET(startup, dir_us, phase_start);
+    SMIO_STARTUP_SET(startup, boot_us, boot_start);
+
+    free (smio_service);
+    return self;
 
-err_smio_loop:
-    /* Unexport SMIO specific operations */
-    smio_unexport_ops (self);
 err_smio_export:
     /* Nullify exp ops */
     smio_set_exp_ops (self, NULL);
 err_smio_get_exp_ops:
-    /* FIXME: Poll PIPE sockets and on receiving any message calls shutdown () */
     SMIO_DISPATCH_FUNC_WRAPPER (shutdown, smio_mod_dispatch);
 err_call_init:
     smio_deattach (self);
@@ -100,15 +134,71 @@ err_call_attach:
     /* Destroy what we did in _smio_new */
     smio_destroy (&self);
 err_self_alloc:
-    /* We can't output this message at a later time as we depend on the smio_service
-     * variable. This is not so bad, though, as most of the time we will not fail
-     * in hutils_concat_strings () function */
-    DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] SMIO Thread %s exiting\n",
-            smio_service);
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] SMIO %s could "
+            "not boot\n", smio_service);
     free (smio_service);
 err_smio_service_alloc:
-    free (inst_id_str);
-err_inst_id_str_alloc:
+    return NULL;
+}
+
+void smio_halt (smio_t **self_p, th_boot_args_t *th_args)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_t *self = *self_p;
+        volatile const smio_mod_dispatch_t *smio_mod_dispatch = th_args->smio_handler;
+
+        smio_dir_unregister (self);
+        /* Unexport SMIO specific operations */
+        smio_unexport_ops (self);
+        /* Nullify exp ops */
+        smio_set_exp_ops (self, NULL);
+        /* FIXME: Poll PIPE sockets and on receiving any message calls shutdown () */
+        SMIO_DISPATCH_FUNC_WRAPPER (shutdown, smio_mod_dispatch);
+        smio_deattach (self);
+        /* Destroy what we did in _smio_new */
+        smio_destroy (self_p);
+    }
+}
+
+void smio_startup (zsock_t *pipe, void *args)
+{
+    th_boot_args_t *th_args = (th_boot_args_t *) args;
+    zsock_t *pipe_mgmt = pipe;
+    volatile const smio_mod_dispatch_t *smio_mod_dispatch = th_args->smio_handler;
+    /* Signal parent we are initializing */
+    zsock_signal (pipe_mgmt, 0);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] SMIO Thread %s:%s%u "
+            "starting ...\n", th_args->service, smio_mod_dispatch->name,
+            th_args->inst_id);
+
+    hutils_err_e herr = hutils_set_thread_sched (&th_args->sched,
+            smio_mod_dispatch->name);
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] Could not set "
+                "CPU placement of SMIO Thread %s. Using the DEVIO one\n",
+                smio_mod_dispatch->name);
+    }
+    hutils_mem_rt_thread_init ();
+
+    smio_t *self = smio_boot (th_args, pipe_mgmt);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    /* Main loop request-action */
+    smio_err_e err = smio_loop (self);
+    ASSERT_TEST (err == SMIO_SUCCESS, "Could not loop the SMIO messages",
+            err_smio_loop);
+
+err_smio_loop:
+    smio_halt (&self, th_args);
+err_self_alloc:
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_bootstrap] SMIO Thread %s:%s%u "
+            "exiting\n", th_args->service, smio_mod_dispatch->name,
+            th_args->inst_id);
+    /* Left here if we could not boot */
+    zlistx_destroy (&th_args->reqs);
     free (th_args);
 }
 
@@ -126,8 +216,9 @@ void smio_config_defaults (zsock_t *pipe, void *args)
     /* We must export our service as the combination of the
      * devio name (coming from devio parent) and our own name ID
      * followed by an optional parameter coming from priv pointer */
-    char *inst_id_str = hutils_stringify_dec_key (th_args->inst_id);
-    ASSERT_ALLOC(inst_id_str, err_inst_id_str_alloc);
+    char inst_id_str [HUTILS_KEY_STR_MAX_LEN];
+    hutils_stringify_dec_key_buf (inst_id_str, sizeof (inst_id_str),
+            th_args->inst_id);
     char *smio_service = hutils_concat_strings3 (th_args->service,
             smio_mod_dispatch->name, inst_id_str, ':');
     ASSERT_ALLOC(smio_service, err_smio_service_alloc);
@@ -137,13 +228,19 @@ void smio_config_defaults (zsock_t *pipe, void *args)
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] Config Thread %s "
             "allocating resources ...\n", smio_service);
 
+    /* Chip initialization, e.g., smch_ad9510_cfg_defaults (), is done in
+     * here, through the SMIO itself */
+    int64_t config_start = zclock_usecs ();
     SMIO_DISPATCH_FUNC_WRAPPER_GEN(config_defaults, smio_mod_dispatch,
             th_args->broker, smio_service, th_args->log_file);
+    SMIO_STARTUP_SET(th_args->startup, config_us, config_start);
 
     /* We've finished configuring the SMIO. Tell DEVIO we are done */
-    char *smio_service_suffix = hutils_concat_strings_no_sep (
-            smio_mod_dispatch->name, inst_id_str);
-    ASSERT_ALLOC(smio_service_suffix, err_smio_service_suffix_alloc);
+    char smio_service_suffix [HUTILS_CFG_HASH_KEY_MAX_LEN];
+    int suffix_len = hutils_concat_strings_no_sep_buf (smio_service_suffix,
+            sizeof (smio_service_suffix), smio_mod_dispatch->name, inst_id_str);
+    ASSERT_TEST(suffix_len >= 0, "SMIO service suffix is too long",
+            err_smio_service_suffix_len);
 
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] Sending CONFIG DONE message over PIPE\n");
     int zerr = zstr_sendx (pipe, smio_service_suffix, "CONFIG DONE", NULL);
@@ -179,12 +276,9 @@ err_pipe_mgmt_bad_msg:
     DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_bootstrap] Config Thread %s "
             "terminating with %s\n", smio_service, (terminated)? "success" : "error");
 
-err_smio_service_suffix_alloc:
-    free (smio_service_suffix);
+err_smio_service_suffix_len:
 err_send_config_done:
     free (smio_service);
 err_smio_service_alloc:
-    free (inst_id_str);
-err_inst_id_str_alloc:
     free (th_args);
 }
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include <sys/mman.h>
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io_cache]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io_cache]",           \
+            smio_err_str(SMIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io_cache]",              \
+            smio_err_str (err_type))
+
+#define SMIO_CACHE_REG_SIZE                 (sizeof (uint32_t))
+
+#define SMIO_CACHE_SNAP_MAGIC               "SMIOSNP"
+#define SMIO_CACHE_SNAP_MAGIC_SIZE          8
+#define SMIO_CACHE_SNAP_VERSION             1
+
+/* Cached register. It is also the layout of the registers in the snapshot
+ * files */
+typedef struct {
+    uint32_t value;                     /* Last value read from/written to the register */
+    uint32_t valid;                     /* Value is valid */
+} smio_cache_reg_t;
+
+/* Snapshot file header. The registers of each region follow, in order */
+typedef struct {
+    char magic [SMIO_CACHE_SNAP_MAGIC_SIZE];    /* SMIO_CACHE_SNAP_MAGIC */
+    uint32_t version;                           /* SMIO_CACHE_SNAP_VERSION */
+    uint32_t num_regions;
+    struct {
+        uint64_t offset;
+        uint32_t num_regs;
+        uint32_t reserved;
+    } regions [SMIO_CACHE_MAX_REGIONS];
+} smio_cache_snap_hdr_t;
+
+/* Contiguous region of cached registers */
+typedef struct {
+    uint64_t offset;                    /* Region start offset */
+    uint32_t num_regs;                  /* Number of 32-bit registers in region */
+    smio_cache_reg_t *regs;             /* Cached registers */
+} smio_cache_region_t;
+
+/* Our structure */
+struct _smio_cache_t {
+    smio_cache_region_t regions [SMIO_CACHE_MAX_REGIONS];
+    uint32_t num_regions;               /* Number of regions in use */
+    void *snap;                         /* Mapped snapshot file. The registers of
+                                           the regions live there if not NULL */
+    size_t snap_size;                   /* Size of the mapped snapshot file */
+};
+
+static smio_cache_reg_t *_smio_cache_find_reg (smio_cache_t *self, uint64_t offset);
+static void _smio_cache_snap_hdr (smio_cache_t *self, smio_cache_snap_hdr_t *hdr);
+
+/* Creates a new instance of the shadow register cache */
+smio_cache_t *smio_cache_new (void)
+{
+    smio_cache_t *self = (smio_cache_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->num_regions = 0;
+
+    return self;
+
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy an instance of the shadow register cache */
+smio_err_e smio_cache_destroy (smio_cache_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_cache_t *self = *self_p;
+
+        if (self->snap != NULL) {
+            munmap (self->snap, self->snap_size);
+        }
+        else {
+            uint32_t i;
+            for (i = 0; i < self->num_regions; ++i) {
+                free (self->regions [i].regs);
+            }
+        }
+
+        free (self);
+        *self_p = NULL;
+    }
+
+    return SMIO_SUCCESS;
+}
+
+smio_err_e smio_cache_add_region (smio_cache_t *self, uint64_t offset, size_t size)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+
+    ASSERT_TEST(self->snap == NULL, "Cannot add regions to a mapped snapshot",
+            err_snap_mapped, SMIO_ERR_WRONG_PARAM);
+    ASSERT_TEST(self->num_regions < SMIO_CACHE_MAX_REGIONS,
+            "Maximum number of cached regions reached", err_max_regions,
+            SMIO_ERR_WRONG_PARAM);
+    ASSERT_TEST(size > 0 && size <= SMIO_CACHE_MAX_REGION_SIZE &&
+            size % SMIO_CACHE_REG_SIZE == 0 && offset % SMIO_CACHE_REG_SIZE == 0,
+            "Invalid cached region", err_inv_region, SMIO_ERR_WRONG_PARAM);
+
+    smio_cache_region_t *region = &self->regions [self->num_regions];
+    region->num_regs = size / SMIO_CACHE_REG_SIZE;
+    /* zmalloc initializes every register as invalid */
+    region->regs = zmalloc (region->num_regs * sizeof (*region->regs));
+    ASSERT_ALLOC(region->regs, err_regs_alloc, SMIO_ERR_ALLOC);
+    region->offset = offset;
+    ++self->num_regions;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_cache] Caching %u registers "
+            "starting at offset 0x%"PRIx64"\n", region->num_regs, offset);
+
+err_regs_alloc:
+err_inv_region:
+err_max_regions:
+err_snap_mapped:
+    return err;
+}
+
+bool smio_cache_is_cached (smio_cache_t *self, uint64_t offset)
+{
+    return _smio_cache_find_reg (self, offset) != NULL;
+}
+
+bool smio_cache_lookup (smio_cache_t *self, uint64_t offset, uint32_t *value)
+{
+    assert (value);
+
+    smio_cache_reg_t *reg = _smio_cache_find_reg (self, offset);
+    if (reg == NULL || !reg->valid) {
+        return false;
+    }
+
+    *value = reg->value;
+    return true;
+}
+
+void smio_cache_update (smio_cache_t *self, uint64_t offset, uint32_t value)
+{
+    smio_cache_reg_t *reg = _smio_cache_find_reg (self, offset);
+    if (reg != NULL) {
+        reg->value = value;
+        reg->valid = true;
+    }
+}
+
+void smio_cache_invalidate (smio_cache_t *self, uint64_t offset)
+{
+    smio_cache_reg_t *reg = _smio_cache_find_reg (self, offset);
+    if (reg != NULL) {
+        reg->valid = false;
+    }
+}
+
+void smio_cache_invalidate_all (smio_cache_t *self)
+{
+    assert (self);
+
+    uint32_t i;
+    for (i = 0; i < self->num_regions; ++i) {
+        smio_cache_region_t *region = &self->regions [i];
+        memset (region->regs, 0, region->num_regs * sizeof (*region->regs));
+    }
+}
+
+smio_err_e smio_cache_map_snapshot (smio_cache_t *self, const char *path,
+        smio_cache_read_fp read_fp, void *owner, uint32_t *num_warm)
+{
+    assert (self);
+    assert (path);
+    assert (read_fp);
+    assert (num_warm);
+
+    smio_err_e err = SMIO_SUCCESS;
+    *num_warm = 0;
+
+    ASSERT_TEST(self->snap == NULL, "Snapshot already mapped", err_snap_mapped,
+            SMIO_ERR_WRONG_PARAM);
+
+    smio_cache_snap_hdr_t hdr;
+    _smio_cache_snap_hdr (self, &hdr);
+    size_t snap_size = sizeof (hdr);
+    uint32_t i;
+    for (i = 0; i < self->num_regions; ++i) {
+        snap_size += self->regions [i].num_regs * sizeof (smio_cache_reg_t);
+    }
+
+    int fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    ASSERT_TEST(fd >= 0, "Could not open snapshot file", err_open,
+            SMIO_ERR_WRONG_PARAM);
+
+    /* A snapshot of other regions (e.g., from another firmware) is useless */
+    struct stat st;
+    smio_cache_snap_hdr_t file_hdr;
+    bool warm = fstat (fd, &st) == 0 && (size_t) st.st_size == snap_size &&
+        pread (fd, &file_hdr, sizeof (file_hdr), 0) == sizeof (file_hdr) &&
+        memcmp (&file_hdr, &hdr, sizeof (hdr)) == 0;
+    if (!warm) {
+        /* Truncate first, so every register starts as invalid */
+        int rc = ftruncate (fd, 0);
+        rc |= ftruncate (fd, snap_size);
+        ASSERT_TEST(rc == 0, "Could not size snapshot file", err_truncate,
+                SMIO_ERR_WRONG_PARAM);
+    }
+
+    void *snap = mmap (NULL, snap_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ASSERT_TEST(snap != MAP_FAILED, "Could not map snapshot file", err_mmap,
+            SMIO_ERR_WRONG_PARAM);
+    if (!warm) {
+        memcpy (snap, &hdr, sizeof (hdr));
+    }
+
+    /* Move the registers to the snapshot. The ones known already are newer
+     * than anything in it */
+    smio_cache_reg_t *snap_regs = (smio_cache_reg_t *) ((char *) snap + sizeof (hdr));
+    for (i = 0; i < self->num_regions; ++i) {
+        smio_cache_region_t *region = &self->regions [i];
+
+        uint32_t j;
+        for (j = 0; j < region->num_regs; ++j) {
+            smio_cache_reg_t *snap_reg = &snap_regs [j];
+
+            if (region->regs [j].valid) {
+                *snap_reg = region->regs [j];
+            }
+            else if (snap_reg->valid) {
+                uint32_t value;
+                ssize_t ret = read_fp (owner, region->offset + j*SMIO_CACHE_REG_SIZE,
+                        &value);
+                if (ret == sizeof (value) && value == snap_reg->value) {
+                    ++*num_warm;
+                }
+                else {
+                    snap_reg->valid = false;
+                }
+            }
+        }
+
+        free (region->regs);
+        region->regs = snap_regs;
+        snap_regs += region->num_regs;
+    }
+
+    self->snap = snap;
+    self->snap_size = snap_size;
+
+err_mmap:
+err_truncate:
+    close (fd);
+err_open:
+err_snap_mapped:
+    return err;
+}
+
+/**************** Helper Functions ***************/
+
+static smio_cache_reg_t *_smio_cache_find_reg (smio_cache_t *self, uint64_t offset)
+{
+    assert (self);
+
+    /* Only a handful of regions are expected, so a linear search is fine */
+    uint32_t i;
+    for (i = 0; i < self->num_regions; ++i) {
+        smio_cache_region_t *region = &self->regions [i];
+
+        if (offset >= region->offset &&
+                offset < region->offset + region->num_regs * SMIO_CACHE_REG_SIZE &&
+                (offset - region->offset) % SMIO_CACHE_REG_SIZE == 0) {
+            return &region->regs [(offset - region->offset) / SMIO_CACHE_REG_SIZE];
+        }
+    }
+
+    return NULL;
+}
+
+/* Snapshot file header matching the current regions */
+static void _smio_cache_snap_hdr (smio_cache_t *self, smio_cache_snap_hdr_t *hdr)
+{
+    memset (hdr, 0, sizeof (*hdr));
+    memcpy (hdr->magic, SMIO_CACHE_SNAP_MAGIC, sizeof (SMIO_CACHE_SNAP_MAGIC));
+    hdr->version = SMIO_CACHE_SNAP_VERSION;
+    hdr->num_regions = self->num_regions;
+
+    uint32_t i;
+    for (i = 0; i < self->num_regions; ++i) {
+        hdr->regions [i].offset = self->regions [i].offset;
+        hdr->regions [i].num_regs = self->regions [i].num_regs;
+    }
+}
@@ -0,0 +1,556 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io_fairq]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io_fairq]",           \
+            smio_err_str(SMIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io_fairq]",              \
+            smio_err_str (err_type))
+
+/* Requests of a sender, served in order. Senders are kept for a while after
+ * their queue empties, so their token bucket is not refilled by just
+ * pausing */
+typedef struct {
+    char *name;                         /* Sender, also the hash key */
+    zlistx_t *reqs;                     /* Requests waiting */
+    double tokens;                      /* Requests that might be served right
+                                           away under the rate limit */
+    int64_t refill_us;                  /* Time the tokens were last refilled */
+    void *turn;                         /* Handle in the list of turns. NULL if
+                                           there are no requests waiting */
+} smio_fairq_sender_t;
+
+/* Our structure */
+struct _smio_fairq_t {
+    zloop_t *loop;                      /* Reactor running the wake timer. Owned
+                                           by the caller */
+    smio_fairq_wake_fp wake_fp;         /* Called when the timer expires */
+    void *owner;                        /* Passed to "wake_fp" */
+    zhashx_t *senders;                  /* Senders, keyed by name */
+    zlistx_t *turns;                    /* Senders with requests waiting, next
+                                           one to be served first */
+    uint32_t rate_limit;                /* Requests per second for each sender.
+                                           0 if none */
+    int timer_id;                       /* Wake timer ID. -1 if not armed */
+    smio_queue_stats_t stats;           /* Queue counters */
+};
+
+static smio_fairq_sender_t *_smio_fairq_sender_get (smio_fairq_t *self,
+        const char *name);
+static void _smio_fairq_sender_destroy (void **item);
+static void _smio_fairq_sender_refill (smio_fairq_t *self,
+        smio_fairq_sender_t *sender, int64_t now);
+static void _smio_fairq_gc (smio_fairq_t *self);
+static void *_smio_fairq_find_superseded (smio_fairq_sender_t *sender,
+        smio_fairq_req_t *req);
+static bool _smio_fairq_req_coalesces (smio_fairq_req_t *req);
+static bool _smio_fairq_req_shares (const smio_fairq_req_t *req);
+static bool _smio_fairq_req_identical (const smio_fairq_req_t *req,
+        smio_fairq_req_t *other);
+static smio_fairq_req_t *_smio_fairq_sender_take (smio_fairq_t *self,
+        smio_fairq_sender_t *sender);
+static void _smio_fairq_arm (smio_fairq_t *self, int64_t wait_us);
+static int _smio_fairq_handle_timer (zloop_t *loop, int timer_id, void *arg);
+
+/* Creates a new request queue */
+smio_fairq_t *smio_fairq_new (zloop_t *loop, smio_fairq_wake_fp wake_fp,
+        void *owner)
+{
+    assert (loop);
+    assert (wake_fp);
+
+    smio_fairq_t *self = (smio_fairq_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->loop = loop;
+    self->wake_fp = wake_fp;
+    self->owner = owner;
+    self->timer_id = -1;
+    self->rate_limit = 0;
+
+    self->senders = zhashx_new ();
+    ASSERT_ALLOC(self->senders, err_senders_alloc);
+    zhashx_set_destructor (self->senders, _smio_fairq_sender_destroy);
+    /* Senders are owned by the hash */
+    self->turns = zlistx_new ();
+    ASSERT_ALLOC(self->turns, err_turns_alloc);
+
+    return self;
+
+err_turns_alloc:
+    zhashx_destroy (&self->senders);
+err_senders_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy a request queue */
+smio_err_e smio_fairq_destroy (smio_fairq_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_fairq_t *self = *self_p;
+
+        if (self->timer_id != -1) {
+            zloop_timer_end (self->loop, self->timer_id);
+            self->timer_id = -1;
+        }
+
+        if (self->stats.depth > 0) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_fairq] Dropping %u "
+                    "requests waiting\n", self->stats.depth);
+        }
+
+        zlistx_destroy (&self->turns);
+        zhashx_destroy (&self->senders);
+        free (self);
+        *self_p = NULL;
+    }
+
+    return SMIO_SUCCESS;
+}
+
+smio_err_e smio_fairq_push (smio_fairq_t *self, smio_fairq_req_t **req_p,
+        smio_fairq_req_t **superseded_p)
+{
+    assert (self);
+    assert (req_p);
+    assert (*req_p);
+    assert (superseded_p);
+
+    smio_err_e err = SMIO_SUCCESS;
+    smio_fairq_req_t *req = *req_p;
+    *superseded_p = NULL;
+
+    smio_fairq_sender_t *sender = _smio_fairq_sender_get (self, req->sender);
+    ASSERT_ALLOC(sender, err_sender_alloc, SMIO_ERR_ALLOC);
+
+    /* The newest write goes to the end of the queue, so it is still
+     * applied after the other requests sent before it */
+    void *superseded = _smio_fairq_find_superseded (sender, req);
+    if (superseded != NULL) {
+        void *handle = zlistx_add_end (sender->reqs, req);
+        ASSERT_ALLOC(handle, err_req_add, SMIO_ERR_ALLOC);
+        *req_p = NULL;
+        *superseded_p = (smio_fairq_req_t *) zlistx_detach (sender->reqs,
+                superseded);
+        self->stats.coalesced++;
+        return err;
+    }
+
+    if (zlistx_size (sender->reqs) >= SMIO_FAIRQ_SENDER_DEPTH_MAX) {
+        self->stats.rejected++;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io_fairq] Sender %s has "
+                "too many requests waiting\n", sender->name);
+        err = SMIO_ERR_ALLOC;
+        goto err_sender_full;
+    }
+
+    void *handle = zlistx_add_end (sender->reqs, req);
+    ASSERT_ALLOC(handle, err_req_add, SMIO_ERR_ALLOC);
+    *req_p = NULL;
+
+    /* Senders take their turn from the first request queued */
+    if (sender->turn == NULL) {
+        sender->turn = zlistx_add_end (self->turns, sender);
+        ASSERT_ALLOC(sender->turn, err_turn_add, SMIO_ERR_ALLOC);
+    }
+
+    self->stats.depth++;
+    if (self->stats.depth > self->stats.max_depth) {
+        self->stats.max_depth = self->stats.depth;
+    }
+
+    return err;
+
+err_turn_add:
+    /* Give the request back */
+    *req_p = (smio_fairq_req_t *) zlistx_detach (sender->reqs, handle);
+err_req_add:
+err_sender_full:
+err_sender_alloc:
+    return err;
+}
+
+smio_fairq_req_t *smio_fairq_pop (smio_fairq_t *self)
+{
+    assert (self);
+
+    int64_t now = zclock_usecs ();
+    int64_t wait_us = -1;
+    size_t nsenders = zlistx_size (self->turns);
+    size_t i;
+
+    for (i = 0; i < nsenders; ++i) {
+        smio_fairq_sender_t *sender = (smio_fairq_sender_t *) zlistx_first (self->turns);
+        /* Whatever happens, its turn is over */
+        zlistx_move_end (self->turns, sender->turn);
+
+        _smio_fairq_sender_refill (self, sender, now);
+        if (self->rate_limit != 0 && sender->tokens < 1.0) {
+            smio_fairq_req_t *waiting = (smio_fairq_req_t *) zlistx_first (sender->reqs);
+            if (!waiting->throttled) {
+                waiting->throttled = true;
+                self->stats.throttled++;
+            }
+
+            int64_t sender_wait = (int64_t) ((1.0 - sender->tokens) * 1000000.0 /
+                    self->rate_limit) + 1;
+            if (wait_us < 0 || sender_wait < wait_us) {
+                wait_us = sender_wait;
+            }
+            continue;
+        }
+
+        if (self->rate_limit != 0) {
+            sender->tokens -= 1.0;
+        }
+
+        smio_fairq_req_t *req = _smio_fairq_sender_take (self, sender);
+        self->stats.served++;
+        return req;
+    }
+
+    if (wait_us >= 0) {
+        _smio_fairq_arm (self, wait_us);
+    }
+
+    return NULL;
+}
+
+size_t smio_fairq_take_identical (smio_fairq_t *self, const smio_fairq_req_t *req,
+        smio_fairq_req_t **identical, size_t max)
+{
+    assert (self);
+    assert (req);
+    assert (identical);
+
+    if (!_smio_fairq_req_shares (req)) {
+        return 0;
+    }
+
+    /* Only the first request of each sender is taken, so their own
+     * requests are still served in order. Senders are taken from the
+     * turns after looking at all of them */
+    smio_fairq_sender_t *senders [SMIO_FAIRQ_SHARED_MAX];
+    max = (max > SMIO_FAIRQ_SHARED_MAX) ? SMIO_FAIRQ_SHARED_MAX : max;
+    size_t n = 0;
+    smio_fairq_sender_t *sender = (smio_fairq_sender_t *) zlistx_first (self->turns);
+    for ( ; sender != NULL && n < max;
+            sender = (smio_fairq_sender_t *) zlistx_next (self->turns)) {
+        if (_smio_fairq_req_identical (req,
+                    (smio_fairq_req_t *) zlistx_first (sender->reqs))) {
+            senders [n++] = sender;
+        }
+    }
+
+    /* They cost nothing, so they are not held back by the rate limit */
+    for (size_t i = 0; i < n; ++i) {
+        identical [i] = _smio_fairq_sender_take (self, senders [i]);
+    }
+    self->stats.served += n;
+    self->stats.shared += n;
+
+    return n;
+}
+
+void smio_fairq_set_rate_limit (smio_fairq_t *self, uint32_t rate_limit)
+{
+    assert (self);
+
+    self->rate_limit = rate_limit;
+    /* Buckets are refilled, and capped, under the new limit from now on */
+    int64_t now = zclock_usecs ();
+    smio_fairq_sender_t *sender = (smio_fairq_sender_t *) zhashx_first (self->senders);
+    for ( ; sender != NULL;
+            sender = (smio_fairq_sender_t *) zhashx_next (self->senders)) {
+        sender->tokens = rate_limit;
+        sender->refill_us = now;
+    }
+
+    /* Senders held back might be served right away now */
+    if (self->timer_id != -1) {
+        zloop_timer_end (self->loop, self->timer_id);
+        self->timer_id = -1;
+    }
+    if (zlistx_size (self->turns) > 0) {
+        _smio_fairq_arm (self, 0);
+    }
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_fairq] Rate limit set to "
+            "%u requests per second\n", rate_limit);
+}
+
+uint32_t smio_fairq_get_rate_limit (smio_fairq_t *self)
+{
+    assert (self);
+    return self->rate_limit;
+}
+
+void smio_fairq_get_stats (smio_fairq_t *self, smio_queue_stats_t *stats,
+        bool reset)
+{
+    assert (self);
+    assert (stats);
+
+    self->stats.rate_limit = self->rate_limit;
+    self->stats.senders = zlistx_size (self->turns);
+    *stats = self->stats;
+
+    if (reset) {
+        self->stats.max_depth = self->stats.depth;
+        self->stats.served = 0;
+        self->stats.throttled = 0;
+        self->stats.rejected = 0;
+        self->stats.coalesced = 0;
+        self->stats.shared = 0;
+    }
+}
+
+void smio_fairq_req_destroy (smio_fairq_req_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_fairq_req_t *self = *self_p;
+
+        zmsg_destroy (&self->msg);
+        free (self->sender);
+        free (self->subject);
+        free (self->tracker);
+        zframe_destroy (&self->reply_to);
+        free (self);
+        *self_p = NULL;
+    }
+}
+
+/************************************************************/
+/*********************** Local methods **********************/
+/************************************************************/
+
+/* Get a sender, adding it if it is not known */
+static smio_fairq_sender_t *_smio_fairq_sender_get (smio_fairq_t *self,
+        const char *name)
+{
+    smio_fairq_sender_t *sender = (smio_fairq_sender_t *) zhashx_lookup (
+            self->senders, name);
+    if (sender != NULL) {
+        return sender;
+    }
+
+    if (zhashx_size (self->senders) >= SMIO_FAIRQ_SENDERS_GC) {
+        _smio_fairq_gc (self);
+    }
+
+    sender = (smio_fairq_sender_t *) zmalloc (sizeof *sender);
+    ASSERT_ALLOC(sender, err_sender_alloc);
+    sender->name = strdup (name);
+    ASSERT_ALLOC(sender->name, err_name_alloc);
+    sender->reqs = zlistx_new ();
+    ASSERT_ALLOC(sender->reqs, err_reqs_alloc);
+    zlistx_set_destructor (sender->reqs, (zlistx_destructor_fn *) smio_fairq_req_destroy);
+    /* New senders start with a full bucket */
+    sender->tokens = self->rate_limit;
+    sender->refill_us = zclock_usecs ();
+    sender->turn = NULL;
+
+    int rc = zhashx_insert (self->senders, name, sender);
+    ASSERT_TEST(rc == 0, "Could not add sender", err_insert);
+
+    return sender;
+
+err_insert:
+    zlistx_destroy (&sender->reqs);
+err_reqs_alloc:
+    free (sender->name);
+err_name_alloc:
+    free (sender);
+err_sender_alloc:
+    return NULL;
+}
+
+static void _smio_fairq_sender_destroy (void **item)
+{
+    if (*item) {
+        smio_fairq_sender_t *sender = (smio_fairq_sender_t *) *item;
+
+        zlistx_destroy (&sender->reqs);
+        free (sender->name);
+        free (sender);
+        *item = NULL;
+    }
+}
+
+static void _smio_fairq_sender_refill (smio_fairq_t *self,
+        smio_fairq_sender_t *sender, int64_t now)
+{
+    if (self->rate_limit == 0) {
+        return;
+    }
+
+    sender->tokens += (double) (now - sender->refill_us) * self->rate_limit /
+        1000000.0;
+    if (sender->tokens > self->rate_limit) {
+        sender->tokens = self->rate_limit;
+    }
+    sender->refill_us = now;
+}
+
+/* Forget the idle senders whose bucket is full again, as new senders get
+ * the same */
+static void _smio_fairq_gc (smio_fairq_t *self)
+{
+    int64_t now = zclock_usecs ();
+    zlistx_t *names = zhashx_keys (self->senders);
+    if (names == NULL) {
+        return;
+    }
+
+    const char *name = (const char *) zlistx_first (names);
+    for ( ; name != NULL; name = (const char *) zlistx_next (names)) {
+        smio_fairq_sender_t *sender = (smio_fairq_sender_t *) zhashx_lookup (
+                self->senders, name);
+        _smio_fairq_sender_refill (self, sender, now);
+        if (sender->turn == NULL && sender->tokens >= self->rate_limit) {
+            zhashx_delete (self->senders, name);
+        }
+    }
+
+    zlistx_destroy (&names);
+}
+
+/* Handle of the write of "sender" waiting that "req" supersedes, or NULL.
+ * There is at most one, as each one supersedes the previous */
+static void *_smio_fairq_find_superseded (smio_fairq_sender_t *sender,
+        smio_fairq_req_t *req)
+{
+    if (!_smio_fairq_req_coalesces (req)) {
+        return NULL;
+    }
+
+    zframe_t *opcode = zmsg_first (req->msg);
+    zframe_t *rw = zmsg_next (req->msg);
+
+    /* Newest first, as the same parameter is usually written in bursts */
+    smio_fairq_req_t *waiting = (smio_fairq_req_t *) zlistx_last (sender->reqs);
+    for ( ; waiting != NULL;
+            waiting = (smio_fairq_req_t *) zlistx_prev (sender->reqs)) {
+        if (_smio_fairq_req_coalesces (waiting) &&
+                zframe_eq (zmsg_first (waiting->msg), opcode) &&
+                zframe_eq (zmsg_next (waiting->msg), rw)) {
+            return zlistx_cursor (sender->reqs);
+        }
+    }
+
+    return NULL;
+}
+
+/* Take the first request of "sender", forgetting the sender if it has no
+ * other and there is no rate limit */
+static smio_fairq_req_t *_smio_fairq_sender_take (smio_fairq_t *self,
+        smio_fairq_sender_t *sender)
+{
+    smio_fairq_req_t *req = (smio_fairq_req_t *) zlistx_detach (sender->reqs, NULL);
+    if (zlistx_size (sender->reqs) == 0) {
+        zlistx_delete (self->turns, sender->turn);
+        sender->turn = NULL;
+        /* Without a rate limit, there is nothing to remember */
+        if (self->rate_limit == 0) {
+            zhashx_delete (self->senders, sender->name);
+        }
+    }
+
+    self->stats.depth--;
+    return req;
+}
+
+/* Reads might be shared only if their sender said so */
+static bool _smio_fairq_req_shares (const smio_fairq_req_t *req)
+{
+    return req->subject != NULL && streq (req->subject, RW_REQ_SHARED_SUBJECT);
+}
+
+/* Same operation, with the same arguments */
+static bool _smio_fairq_req_identical (const smio_fairq_req_t *req,
+        smio_fairq_req_t *other)
+{
+    if (!_smio_fairq_req_shares (other) ||
+            zmsg_size (req->msg) != zmsg_size (other->msg)) {
+        return false;
+    }
+
+    /* zmsg_t cursors are not part of the request */
+    zmsg_t *msg = (zmsg_t *) req->msg;
+    zframe_t *frame = zmsg_first (msg);
+    zframe_t *other_frame = zmsg_first (other->msg);
+    for ( ; frame != NULL; frame = zmsg_next (msg),
+            other_frame = zmsg_next (other->msg)) {
+        if (!zframe_eq (frame, other_frame)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Writes might be superseded only if their sender said so */
+static bool _smio_fairq_req_coalesces (smio_fairq_req_t *req)
+{
+    return req->subject != NULL && streq (req->subject, RW_REQ_COALESCE_SUBJECT) &&
+        zmsg_size (req->msg) == 3;
+}
+
+/* Call "wake_fp" in "wait_us" usec, unless it is to be called earlier */
+static void _smio_fairq_arm (smio_fairq_t *self, int64_t wait_us)
+{
+    if (self->timer_id != -1) {
+        return;
+    }
+
+    size_t delay = (size_t) ((wait_us + 999) / 1000);
+    self->timer_id = zloop_timer (self->loop, (delay > 0) ? delay : 1, 1,
+            _smio_fairq_handle_timer, self);
+    if (self->timer_id == -1) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_fairq] Could not create "
+                "zloop wake timer\n");
+    }
+}
+
+/* zloop handler for the wake timer */
+static int _smio_fairq_handle_timer (zloop_t *loop, int timer_id, void *arg)
+{
+    (void) loop;
+    (void) timer_id;
+
+    smio_fairq_t *self = (smio_fairq_t *) arg;
+    /* One-shot timers are gone once they expire */
+    self->timer_id = -1;
+    self->wake_fp (self->owner);
+
+    return 0;
+}
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io_reactor]", \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io_reactor]",         \
+            smio_err_str(SMIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io_reactor]",            \
+            smio_err_str (err_type))
+
+/* SMIO served by the reactor thread */
+typedef struct {
+    smio_t *smio;                       /* NULL if it could not boot */
+    th_boot_args_t *args;               /* Boot arguments. NULL if the slot is free */
+    zsock_t *pipe_mgmt;                 /* Management PIPE back to the DEVIO */
+} smio_reactor_node_t;
+
+/* State of the reactor thread */
+typedef struct {
+    const char *name;                   /* Reactor name */
+    zloop_t *loop;                      /* Reactor shared by the SMIOs */
+    smio_reactor_node_t nodes [SMIO_REACTOR_MAX_SMIOS];
+} smio_reactor_th_t;
+
+/* Startup arguments of the reactor thread */
+typedef struct {
+    char *name;
+    hutils_sched_t sched;
+} smio_reactor_args_t;
+
+/* Our structure */
+struct _smio_reactor_t {
+    zactor_t *actor;                    /* Reactor thread */
+    char *name;                         /* Reactor name */
+    pthread_mutex_t lock;               /* Protects the actor PIPE and the
+                                           counter below, as the reactor might
+                                           be shared by several DEVIOs */
+    uint32_t nsmios;                    /* Number of SMIOs added */
+};
+
+static void _smio_reactor_actor (zsock_t *pipe, void *args);
+
+/* Creates a new reactor thread */
+smio_reactor_t *smio_reactor_new (const char *name, const hutils_sched_t *sched)
+{
+    assert (name);
+    assert (sched);
+
+    smio_reactor_t *self = (smio_reactor_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->name = strdup (name);
+    ASSERT_ALLOC(self->name, err_name_alloc);
+    pthread_mutex_init (&self->lock, NULL);
+
+    smio_reactor_args_t th_args = {.name = self->name, .sched = *sched};
+    /* zactor_new () waits for the thread to signal it has copied the
+     * arguments, so they can live in our stack */
+    self->actor = zactor_new (_smio_reactor_actor, &th_args);
+    ASSERT_ALLOC(self->actor, err_actor_alloc);
+
+    return self;
+
+err_actor_alloc:
+    pthread_mutex_destroy (&self->lock);
+    free (self->name);
+err_name_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy a reactor thread */
+smio_err_e smio_reactor_destroy (smio_reactor_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_reactor_t *self = *self_p;
+
+        /* Any SMIO left is halted by the thread on $TERM */
+        zactor_destroy (&self->actor);
+        pthread_mutex_destroy (&self->lock);
+        free (self->name);
+
+        free (self);
+        *self_p = NULL;
+    }
+
+    return SMIO_SUCCESS;
+}
+
+zsock_t *smio_reactor_add (smio_reactor_t *self, th_boot_args_t *args)
+{
+    assert (self);
+    assert (args);
+
+    zsock_t *pipe_mgmt_backend = NULL;
+    zsock_t *pipe_mgmt = NULL;
+
+    pthread_mutex_lock (&self->lock);
+    ASSERT_TEST(self->nsmios < SMIO_REACTOR_MAX_SMIOS, "Too many SMIOs on "
+            "reactor", err_max_smios);
+
+    pipe_mgmt = zsys_create_pipe (&pipe_mgmt_backend);
+    ASSERT_ALLOC(pipe_mgmt, err_pipe_mgmt_alloc);
+
+    /* The SMIO boots asynchronously, as it might need the DEVIO to serve
+     * its register accesses meanwhile */
+    int zerr = zsock_send (self->actor, "spp", "$ADD", args, pipe_mgmt_backend);
+    ASSERT_TEST(zerr == 0, "Could not send SMIO to reactor", err_send_add);
+
+    self->nsmios++;
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_reactor] %s: SMIO %s%u added, "
+            "%u SMIOs\n", self->name, args->smio_handler->name, args->inst_id,
+            self->nsmios);
+    pthread_mutex_unlock (&self->lock);
+    return pipe_mgmt;
+
+err_send_add:
+    zsock_destroy (&pipe_mgmt_backend);
+    zsock_destroy (&pipe_mgmt);
+err_pipe_mgmt_alloc:
+err_max_smios:
+    pthread_mutex_unlock (&self->lock);
+    return NULL;
+}
+
+void smio_reactor_remove (smio_reactor_t *self, zsock_t **pipe_mgmt_p)
+{
+    assert (self);
+    assert (pipe_mgmt_p);
+
+    if (*pipe_mgmt_p) {
+        /* Same handshake as zactor_destroy () */
+        zstr_send (*pipe_mgmt_p, "$TERM");
+        zsock_wait (*pipe_mgmt_p);
+        zsock_destroy (pipe_mgmt_p);
+
+        pthread_mutex_lock (&self->lock);
+        self->nsmios--;
+        pthread_mutex_unlock (&self->lock);
+    }
+}
+
+uint32_t smio_reactor_get_nsmios (smio_reactor_t *self)
+{
+    assert (self);
+
+    pthread_mutex_lock (&self->lock);
+    uint32_t nsmios = self->nsmios;
+    pthread_mutex_unlock (&self->lock);
+    return nsmios;
+}
+
+/************************************************************/
+/********************* Reactor thread ***********************/
+/************************************************************/
+
+static void _smio_reactor_halt_node (zloop_t *loop, smio_reactor_node_t *node)
+{
+    zloop_reader_end (loop, node->pipe_mgmt);
+    smio_halt (&node->smio, node->args);
+    /* Left here if the SMIO could not boot */
+    zlistx_destroy (&node->args->reqs);
+    free (node->args);
+    node->args = NULL;
+}
+
+/* zloop handler for the management PIPE of an SMIO */
+static int _smio_reactor_handle_pipe_mgmt (zloop_t *loop, zsock_t *reader, void *args)
+{
+    smio_reactor_node_t *node = (smio_reactor_node_t *) args;
+
+    char *command = zstr_recv (reader);
+    if (command == NULL) {
+        return -1; /* Interrupted */
+    }
+
+    if (streq (command, "$TERM")) {
+        /* The other SMIOs go on. Tell the DEVIO this one is gone, as the
+         * thread of an SMIO actor does when it exits */
+        _smio_reactor_halt_node (loop, node);
+        zsock_signal (node->pipe_mgmt, 0);
+        zsock_destroy (&node->pipe_mgmt);
+    }
+    else {
+        /* Invalid message received. Discard message and continue normally */
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_reactor] SMIO PIPE "
+                "received an invalid command\n");
+    }
+
+    free (command);
+    return 0;
+}
+
+static void _smio_reactor_add_node (smio_reactor_th_t *th, th_boot_args_t *args,
+        zsock_t *pipe_mgmt)
+{
+    uint32_t i;
+    for (i = 0; i < SMIO_REACTOR_MAX_SMIOS; ++i) {
+        if (th->nodes [i].args == NULL) {
+            break;
+        }
+    }
+    /* The number of SMIOs is checked by smio_reactor_add () */
+    assert (i < SMIO_REACTOR_MAX_SMIOS);
+
+    smio_reactor_node_t *node = &th->nodes [i];
+    node->args = args;
+    node->pipe_mgmt = pipe_mgmt;
+    args->loop = th->loop;
+
+    /* The SMIO runs on the shared loop from now on */
+    node->smio = smio_boot (args, pipe_mgmt);
+    if (node->smio == NULL ||
+            smio_start (node->smio) != SMIO_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_reactor] %s: SMIO %s%u "
+                "could not start\n", th->name, args->smio_handler->name,
+                args->inst_id);
+        smio_halt (&node->smio, args);
+    }
+
+    /* Even if the SMIO could not start, the DEVIO still expects an answer
+     * when removing it */
+    zloop_reader (th->loop, pipe_mgmt, _smio_reactor_handle_pipe_mgmt, node);
+}
+
+/* zloop handler for the reactor PIPE */
+static int _smio_reactor_handle_pipe (zloop_t *loop, zsock_t *reader, void *args)
+{
+    (void) loop;
+
+    smio_reactor_th_t *th = (smio_reactor_th_t *) args;
+    char *command = NULL;
+    th_boot_args_t *smio_args = NULL;
+    zsock_t *pipe_mgmt = NULL;
+
+    zmsg_t *msg = zmsg_recv (reader);
+    if (msg == NULL) {
+        return -1; /* Interrupted */
+    }
+
+    command = zmsg_popstr (msg);
+    if (command == NULL || streq (command, "$TERM")) {
+        free (command);
+        zmsg_destroy (&msg);
+        return -1;
+    }
+
+    if (streq (command, "$ADD") && zmsg_size (msg) == 2) {
+        zframe_t *frame = zmsg_pop (msg);
+        smio_args = *(th_boot_args_t **) zframe_data (frame);
+        zframe_destroy (&frame);
+        frame = zmsg_pop (msg);
+        pipe_mgmt = *(zsock_t **) zframe_data (frame);
+        zframe_destroy (&frame);
+
+        _smio_reactor_add_node (th, smio_args, pipe_mgmt);
+    }
+    else {
+        /* Invalid message received. Discard message and continue normally */
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_reactor] Reactor PIPE "
+                "received an invalid command\n");
+    }
+
+    free (command);
+    zmsg_destroy (&msg);
+    return 0;
+}
+
+static void _smio_reactor_actor (zsock_t *pipe, void *args)
+{
+    smio_reactor_args_t *th_args = (smio_reactor_args_t *) args;
+    smio_reactor_th_t th = {.name = NULL};
+
+    char *name = strdup (th_args->name);
+    hutils_sched_t sched = th_args->sched;
+    /* Signal parent we are initializing. Our arguments are gone from now on */
+    zsock_signal (pipe, 0);
+    ASSERT_ALLOC(name, err_name_alloc);
+    th.name = name;
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_reactor] Reactor Thread %s "
+            "starting ...\n", name);
+
+    hutils_err_e herr = hutils_set_thread_sched (&sched, name);
+    if (herr != HUTILS_SUCCESS) {
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_reactor] Could not set "
+                "CPU placement of Reactor Thread %s. Using the DEVIO one\n",
+                name);
+    }
+    hutils_mem_rt_thread_init ();
+
+    th.loop = zloop_new ();
+    ASSERT_ALLOC(th.loop, err_loop_alloc);
+
+    int rc = zloop_reader (th.loop, pipe, _smio_reactor_handle_pipe, &th);
+    ASSERT_TEST(rc == 0, "Could not register reactor PIPE", err_reader);
+
+    /* Run until $TERM */
+    zloop_start (th.loop);
+
+    /* Halt the SMIOs the DEVIO did not remove. Nobody waits for them */
+    uint32_t i;
+    for (i = 0; i < SMIO_REACTOR_MAX_SMIOS; ++i) {
+        smio_reactor_node_t *node = &th.nodes [i];
+        if (node->args != NULL) {
+            _smio_reactor_halt_node (th.loop, node);
+            zsock_destroy (&node->pipe_mgmt);
+        }
+    }
+
+err_reader:
+    zloop_destroy (&th.loop);
+err_loop_alloc:
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_reactor] Reactor Thread %s "
+            "exiting\n", name);
+err_name_alloc:
+    free (name);
+}
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io_tasks]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io_tasks]",           \
+            smio_err_str(SMIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io_tasks]",              \
+            smio_err_str (err_type))
+
+/* Each task has its own zloop timer, so they are served along with the
+ * sockets of the loop and never in the middle of a client request */
+typedef struct {
+    bool in_use;                        /* Slot holds a task */
+    char name [SMIO_TASK_NAME_MAX];     /* Task name, for diagnostics */
+    size_t period;                      /* Run period in msec. 0 if paused */
+    size_t jitter;                      /* Maximum delay of a run, in msec */
+    smio_task_fp task_fp;               /* Task function */
+    void *arg;                          /* Task function argument */
+    int timer_id;                       /* zloop timer ID. -1 if paused */
+    int64_t due;                        /* Time of the next run, in msec */
+    smio_task_stats_t stats;            /* Run statistics */
+    smio_tasks_t *parent;               /* Pointer back to the task set */
+} smio_task_t;
+
+/* Our structure */
+struct _smio_tasks_t {
+    zloop_t *loop;                      /* Reactor running the tasks. Owned by the caller */
+    void *owner;                        /* Passed to every task */
+    smio_task_t tasks [SMIO_TASKS_MAX];
+};
+
+static int _smio_tasks_handle_timer (zloop_t *loop, int timer_id, void *arg);
+static smio_task_t *_smio_tasks_get (smio_tasks_t *self, int task_id);
+
+/* Creates a new set of periodic tasks */
+smio_tasks_t *smio_tasks_new (zloop_t *loop, void *owner)
+{
+    assert (loop);
+
+    smio_tasks_t *self = (smio_tasks_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->loop = loop;
+    self->owner = owner;
+
+    uint32_t i;
+    for (i = 0; i < SMIO_TASKS_MAX; ++i) {
+        self->tasks [i].timer_id = -1;
+        self->tasks [i].parent = self;
+    }
+
+    return self;
+
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy a set of periodic tasks */
+smio_err_e smio_tasks_destroy (smio_tasks_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_tasks_t *self = *self_p;
+
+        uint32_t i;
+        for (i = 0; i < SMIO_TASKS_MAX; ++i) {
+            if (self->tasks [i].in_use) {
+                smio_tasks_remove (self, i);
+            }
+        }
+
+        free (self);
+        *self_p = NULL;
+    }
+
+    return SMIO_SUCCESS;
+}
+
+int smio_tasks_add (smio_tasks_t *self, const char *name, size_t period,
+        size_t jitter, smio_task_fp task_fp, void *arg)
+{
+    assert (self);
+    assert (name);
+    assert (task_fp);
+
+    int task_id = -1;
+    uint32_t i;
+    for (i = 0; i < SMIO_TASKS_MAX; ++i) {
+        if (!self->tasks [i].in_use) {
+            break;
+        }
+    }
+    ASSERT_TEST(i < SMIO_TASKS_MAX, "Too many SMIO tasks", err_no_slot);
+
+    smio_task_t *task = &self->tasks [i];
+    memset (&task->stats, 0, sizeof (task->stats));
+    snprintf (task->name, sizeof (task->name), "%s", name);
+    task->jitter = jitter;
+    task->task_fp = task_fp;
+    task->arg = arg;
+    task->period = 0;
+    task->timer_id = -1;
+    task->in_use = true;
+
+    smio_err_e err = smio_tasks_set_period (self, i, period);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not start SMIO task", err_start);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io_tasks] Task %s added, "
+            "period = %zu ms\n", task->name, period);
+    task_id = i;
+    return task_id;
+
+err_start:
+    task->in_use = false;
+err_no_slot:
+    return task_id;
+}
+
+smio_err_e smio_tasks_set_period (smio_tasks_t *self, int task_id, size_t period)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+    smio_task_t *task = _smio_tasks_get (self, task_id);
+    ASSERT_TEST(task != NULL, "Invalid SMIO task", err_inv_task,
+            SMIO_ERR_WRONG_PARAM);
+
+    /* zloop allows ending a timer from within its own handler */
+    if (task->timer_id != -1) {
+        zloop_timer_end (self->loop, task->timer_id);
+        task->timer_id = -1;
+    }
+
+    task->period = period;
+    if (period == 0) {
+        goto task_paused;
+    }
+
+    task->timer_id = zloop_timer (self->loop, period, 0,
+            _smio_tasks_handle_timer, task);
+    ASSERT_TEST(task->timer_id != -1, "Could not create zloop task timer",
+            err_timer_alloc, SMIO_ERR_ALLOC);
+    task->due = zclock_mono () + period;
+
+err_timer_alloc:
+task_paused:
+err_inv_task:
+    return err;
+}
+
+smio_err_e smio_tasks_remove (smio_tasks_t *self, int task_id)
+{
+    assert (self);
+
+    smio_err_e err = SMIO_SUCCESS;
+    smio_task_t *task = _smio_tasks_get (self, task_id);
+    ASSERT_TEST(task != NULL, "Invalid SMIO task", err_inv_task,
+            SMIO_ERR_WRONG_PARAM);
+
+    if (task->timer_id != -1) {
+        zloop_timer_end (self->loop, task->timer_id);
+        task->timer_id = -1;
+    }
+    task->in_use = false;
+
+err_inv_task:
+    return err;
+}
+
+smio_err_e smio_tasks_get_stats (smio_tasks_t *self, int task_id,
+        smio_task_stats_t *stats)
+{
+    assert (self);
+    assert (stats);
+
+    smio_err_e err = SMIO_SUCCESS;
+    smio_task_t *task = _smio_tasks_get (self, task_id);
+    ASSERT_TEST(task != NULL, "Invalid SMIO task", err_inv_task,
+            SMIO_ERR_WRONG_PARAM);
+
+    *stats = task->stats;
+
+err_inv_task:
+    return err;
+}
+
+void smio_tasks_print_stats (smio_tasks_t *self, const char *owner_name)
+{
+    assert (self);
+
+    uint32_t i;
+    for (i = 0; i < SMIO_TASKS_MAX; ++i) {
+        const smio_task_t *task = &self->tasks [i];
+        if (!task->in_use || task->stats.runs == 0) {
+            continue;
+        }
+
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_tasks] %s: task %s: "
+                "runs = %"PRIu64", errors = %"PRIu64", overruns = %"PRIu64", "
+                "max late = %"PRIu64" ms, max duration = %"PRIu64" us\n",
+                owner_name, task->name, task->stats.runs, task->stats.errors,
+                task->stats.overruns, task->stats.max_late,
+                task->stats.max_duration);
+    }
+}
+
+/************************************************************/
+/*********************** Local methods **********************/
+/************************************************************/
+
+static smio_task_t *_smio_tasks_get (smio_tasks_t *self, int task_id)
+{
+    if (task_id < 0 || task_id >= SMIO_TASKS_MAX ||
+            !self->tasks [task_id].in_use) {
+        return NULL;
+    }
+
+    return &self->tasks [task_id];
+}
+
+/* zloop handler for the task timers */
+static int _smio_tasks_handle_timer (zloop_t *loop, int timer_id, void *arg)
+{
+    (void) loop;
+
+    smio_task_t *task = (smio_task_t *) arg;
+    smio_tasks_t *self = task->parent;
+
+    /* zloop rearms the timer from now, so late runs are not made up for */
+    int64_t now = zclock_mono ();
+    uint64_t late = (now > task->due) ? (uint64_t) (now - task->due) : 0;
+    size_t jitter = (task->jitter != 0) ? task->jitter : task->period;
+    task->due = now + task->period;
+
+    int64_t start = zclock_usecs ();
+    smio_err_e err = task->task_fp (self->owner, task->arg);
+    uint64_t duration = zclock_usecs () - start;
+
+    /* The task might have removed or restarted itself */
+    if (!task->in_use || task->timer_id != timer_id) {
+        return 0;
+    }
+
+    task->stats.runs++;
+    if (err != SMIO_SUCCESS) {
+        task->stats.errors++;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io_tasks] Task %s: %s\n",
+                task->name, smio_err_str (err));
+    }
+
+    if (late > jitter) {
+        task->stats.overruns++;
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_TRACE, "[sm_io_tasks] Task %s ran "
+                "%"PRIu64" ms late\n", task->name, late);
+    }
+
+    if (late > task->stats.max_late) {
+        task->stats.max_late = late;
+    }
+
+    if (duration > task->stats.max_duration) {
+        task->stats.max_duration = duration;
+    }
+
+    return 0;
+}
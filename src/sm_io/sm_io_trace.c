@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2014 LNLS (www.lnls.br)
+ * Author: Lucas Russo <lucas.russo@lnls.br>
+ *
+ * Released according to the GNU GPL, version 3 or any later version.
+ */
+
+#include "bpm_server.h"
+
+/* Undef ASSERT_ALLOC to avoid conflicting with other ASSERT_ALLOC */
+#ifdef ASSERT_TEST
+#undef ASSERT_TEST
+#endif
+#define ASSERT_TEST(test_boolean, err_str, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_TEST(test_boolean, SM_IO, "[sm_io_trace]",   \
+            err_str, err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef ASSERT_ALLOC
+#undef ASSERT_ALLOC
+#endif
+#define ASSERT_ALLOC(ptr, err_goto_label, /* err_core */ ...) \
+    ASSERT_HAL_ALLOC(ptr, SM_IO, "[sm_io_trace]",           \
+            smio_err_str(SMIO_ERR_ALLOC),                   \
+            err_goto_label, /* err_core */ __VA_ARGS__)
+
+#ifdef CHECK_ERR
+#undef CHECK_ERR
+#endif
+#define CHECK_ERR(err, err_type)                            \
+    CHECK_HAL_ERR(err, SM_IO, "[sm_io_trace]",              \
+            smio_err_str (err_type))
+
+/* Our structure */
+struct _smio_trace_t {
+    FILE *file;                         /* Trace file */
+    char *buf;                          /* Write buffer of the file */
+    uint64_t start_ns;                  /* Trace start, as msg_stats_now_ns () */
+    uint64_t size;                      /* Bytes written so far */
+    uint64_t max_size;                  /* Size limit. 0 if none */
+    uint64_t num_recs;                  /* Requests recorded */
+    uint64_t num_dropped;               /* Requests left out for the size limit */
+    bool failed;                        /* Writing failed. Nothing else is
+                                           recorded */
+};
+
+static smio_err_e _smio_trace_write (smio_trace_t *self, const void *data,
+        size_t size);
+
+/* Creates a new instance of the request trace */
+smio_trace_t *smio_trace_new (const char *path, const char *service,
+        uint64_t max_size)
+{
+    assert (path);
+    assert (service);
+
+    smio_trace_t *self = (smio_trace_t *) zmalloc (sizeof *self);
+    ASSERT_ALLOC(self, err_self_alloc);
+
+    self->buf = (char *) zmalloc (SMIO_TRACE_BUF_SIZE);
+    ASSERT_ALLOC(self->buf, err_buf_alloc);
+
+    self->file = fopen (path, "wbe");
+    ASSERT_TEST(self->file != NULL, "Could not create trace file", err_file_open);
+    setvbuf (self->file, self->buf, _IOFBF, SMIO_TRACE_BUF_SIZE);
+
+    struct timespec now;
+    clock_gettime (CLOCK_REALTIME, &now);
+    smio_trace_file_hdr_t hdr = {
+        .magic = SMIO_TRACE_MAGIC,
+        .version = SMIO_TRACE_VERSION,
+        .start_time = (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec
+    };
+    snprintf (hdr.service, sizeof (hdr.service), "%s", service);
+    self->start_ns = msg_stats_now_ns ();
+    self->max_size = max_size;
+
+    smio_err_e err = _smio_trace_write (self, &hdr, sizeof (hdr));
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not write trace file header",
+            err_hdr_write);
+
+    DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_trace] Tracing the requests "
+            "of %s to %s\n", service, path);
+
+    return self;
+
+err_hdr_write:
+    fclose (self->file);
+err_file_open:
+    free (self->buf);
+err_buf_alloc:
+    free (self);
+err_self_alloc:
+    return NULL;
+}
+
+/* Destroy an instance of the request trace */
+smio_err_e smio_trace_destroy (smio_trace_t **self_p)
+{
+    assert (self_p);
+
+    if (*self_p) {
+        smio_trace_t *self = *self_p;
+
+        DBE_DEBUG (DBG_SM_IO | DBG_LVL_INFO, "[sm_io_trace] %"PRIu64" requests "
+                "traced, %"PRIu64" left out\n", self->num_recs, self->num_dropped);
+        /* The buffer is in use until the file is closed */
+        fclose (self->file);
+        free (self->buf);
+        free (self);
+        *self_p = NULL;
+    }
+
+    return SMIO_SUCCESS;
+}
+
+smio_err_e smio_trace_record (smio_trace_t *self, const smio_fairq_req_t *req)
+{
+    assert (self);
+    assert (req);
+    assert (req->msg);
+
+    if (self->failed) {
+        return SMIO_ERR_WRONG_PARAM;
+    }
+
+    uint32_t opcode = SMIO_TRACE_NO_OPCODE;
+    if (msg_peek_mlm_opcode (req->msg, req->subject, &opcode) != MSG_SUCCESS) {
+        opcode = SMIO_TRACE_NO_OPCODE;
+    }
+
+    size_t sender_len = strlen (req->sender);
+    size_t subject_len = (req->subject != NULL) ? strlen (req->subject) : 0;
+    size_t num_frames = zmsg_size (req->msg);
+    sender_len = (sender_len > UINT16_MAX) ? UINT16_MAX : sender_len;
+    subject_len = (subject_len > UINT16_MAX) ? UINT16_MAX : subject_len;
+
+    smio_trace_rec_t rec = {
+        .timestamp = msg_stats_now_ns () - self->start_ns,
+        .opcode = opcode,
+        .size = sender_len + subject_len + num_frames * sizeof (uint32_t) +
+            zmsg_content_size (req->msg),
+        .sender_len = sender_len,
+        .subject_len = subject_len,
+        .num_frames = num_frames,
+        .flags = (req->local_sock != NULL) ? SMIO_TRACE_FLAG_LOCAL : 0
+    };
+
+    /* Requests are kept whole. The ones that don't fit are only counted */
+    if (num_frames > UINT16_MAX || (self->max_size != 0 &&
+                self->size + sizeof (rec) + rec.size > self->max_size)) {
+        if (self->num_dropped++ == 0) {
+            DBE_DEBUG (DBG_SM_IO | DBG_LVL_WARN, "[sm_io_trace] Trace is "
+                    "full. Requests that don't fit are left out\n");
+        }
+        return SMIO_SUCCESS;
+    }
+
+    smio_err_e err = _smio_trace_write (self, &rec, sizeof (rec));
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not write trace record", err_write);
+    err = _smio_trace_write (self, req->sender, sender_len);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not write trace record", err_write);
+    err = _smio_trace_write (self, req->subject, subject_len);
+    ASSERT_TEST(err == SMIO_SUCCESS, "Could not write trace record", err_write);
+
+    /* The frames are only looked at, so the request is left as it is */
+    for (zframe_t *frame = zmsg_first (req->msg); frame != NULL;
+            frame = zmsg_next (req->msg)) {
+        uint32_t frame_size = zframe_size (frame);
+        err = _smio_trace_write (self, &frame_size, sizeof (frame_size));
+        ASSERT_TEST(err == SMIO_SUCCESS, "Could not write trace record", err_write);
+        err = _smio_trace_write (self, zframe_data (frame), frame_size);
+        ASSERT_TEST(err == SMIO_SUCCESS, "Could not write trace record", err_write);
+    }
+
+    self->num_recs++;
+    return SMIO_SUCCESS;
+
+err_write:
+    /* A partial record would make the rest of the file unreadable */
+    self->failed = true;
+    return err;
+}
+
+void smio_trace_get_stats (smio_trace_t *self, uint64_t *num_recs,
+        uint64_t *num_dropped)
+{
+    assert (self);
+    assert (num_recs);
+    assert (num_dropped);
+
+    *num_recs = self->num_recs;
+    *num_dropped = self->num_dropped;
+}
+
+/***************** Static functions *****************/
+
+static smio_err_e _smio_trace_write (smio_trace_t *self, const void *data,
+        size_t size)
+{
+    if (size == 0) {
+        return SMIO_SUCCESS;
+    }
+
+    size_t written = fwrite (data, 1, size, self->file);
+    self->size += written;
+    return (written == size) ? SMIO_SUCCESS : SMIO_ERR_WRONG_PARAM;
+}